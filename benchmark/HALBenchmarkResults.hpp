@@ -0,0 +1,97 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_BENCHMARK_HALBENCHMARKRESULTS_HPP_
+#define _HAL_BENCHMARK_HALBENCHMARKRESULTS_HPP_
+
+#include <cstddef>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*!
+ @class
+
+ @discussion HALBenchmarkResults collects the timings of a benchmark
+ that doesn't use Google Benchmark, and writes them as the JSON of
+ --benchmark_out_format=json, so that HAL_Compare reads the results of
+ every benchmark target the same way. Each repetition of a benchmark
+ is one run sharing its run_name, from which HAL_Compare computes its
+ mean and confidence interval.
+ */
+class HALBenchmarkResults final {
+
+public:
+
+  explicit HALBenchmarkResults(const std::string& executable)
+  : executable__(executable) {
+  }
+
+  void Add(const std::string& name, std::size_t repetition_index, std::size_t repetitions, double milliseconds) {
+    runs__.push_back({ name, repetition_index, repetitions, milliseconds });
+  }
+
+  void Write(const std::string& path) const {
+    std::ofstream ofstream(path, std::ios_base::out | std::ios_base::trunc);
+    ofstream << "{\n"
+             << "  \"context\": {\n"
+             << "    \"executable\": " << Quote(executable__) << "\n"
+             << "  },\n"
+             << "  \"benchmarks\": [";
+    for (std::size_t i = 0; i < runs__.size(); ++i) {
+      const auto& run = runs__[i];
+      ofstream << (i == 0 ? "\n" : ",\n")
+               << "    {\n"
+               << "      \"name\": " << Quote(run.name) << ",\n"
+               << "      \"run_name\": " << Quote(run.name) << ",\n"
+               << "      \"run_type\": \"iteration\",\n"
+               << "      \"repetitions\": " << run.repetitions << ",\n"
+               << "      \"repetition_index\": " << run.repetition_index << ",\n"
+               << "      \"iterations\": 1,\n"
+               << "      \"real_time\": " << run.milliseconds << ",\n"
+               << "      \"cpu_time\": " << run.milliseconds << ",\n"
+               << "      \"time_unit\": \"ms\"\n"
+               << "    }";
+    }
+    ofstream << "\n  ]\n}\n";
+
+    ofstream.close();
+    if (ofstream.fail()) {
+      throw std::runtime_error("Unable to write " + path);
+    }
+  }
+
+private:
+
+  struct Run {
+    std::string name;
+    std::size_t repetition_index;
+    std::size_t repetitions;
+    double      milliseconds;
+  };
+
+  // The names are plain ASCII, so only quotes and backslashes need
+  // escaping.
+  static std::string Quote(const std::string& string) {
+    std::string quoted("\"");
+    for (const auto c : string) {
+      if (c == '"' || c == '\\') {
+        quoted += '\\';
+      }
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  std::string      executable__;
+  std::vector<Run> runs__;
+};
+
+#endif // _HAL_BENCHMARK_HALBENCHMARKRESULTS_HPP_
@@ -0,0 +1,220 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/HAL.hpp"
+#include "Widget.hpp"
+#include "JSCOverheadReporter.hpp"
+
+#include "benchmark/benchmark.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace HAL;
+
+namespace {
+  
+  // One context for every benchmark, so that its creation isn't
+  // measured.
+  JSContext& GetJSContext() {
+    static JSContextGroup js_context_group;
+    static JSContext      js_context = js_context_group.CreateContext();
+    return js_context;
+  }
+  
+  JSObject GetWidget() {
+    auto& js_context = GetJSContext();
+    auto  global_object = js_context.get_global_object();
+    if (!global_object.HasProperty("Widget")) {
+      global_object.SetProperty("Widget", js_context.CreateObject(JSExport<Widget>::Class()));
+    }
+    return static_cast<JSObject>(global_object.GetProperty("Widget"));
+  }
+  
+} // namespace {
+
+static void JSValueCopy(benchmark::State& state) {
+  const JSValue js_value = GetJSContext().CreateNumber(42);
+  for (auto _ : state) {
+    JSValue copy(js_value);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(JSValueCopy);
+
+static void JSValueMove(benchmark::State& state) {
+  JSValue js_value = GetJSContext().CreateNumber(42);
+  for (auto _ : state) {
+    JSValue moved(std::move(js_value));
+    js_value = std::move(moved);
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(JSValueMove);
+
+static void JSValueCreateAndDestroy(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  for (auto _ : state) {
+    JSValue js_value = js_context.CreateNumber(42);
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(JSValueCreateAndDestroy);
+
+static void JSObjectCopy(benchmark::State& state) {
+  const JSObject js_object = GetJSContext().CreateObject();
+  for (auto _ : state) {
+    JSObject copy(js_object);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+BENCHMARK(JSObjectCopy);
+
+static void JSObjectMove(benchmark::State& state) {
+  JSObject js_object = GetJSContext().CreateObject();
+  for (auto _ : state) {
+    JSObject moved(std::move(js_object));
+    js_object = std::move(moved);
+    benchmark::DoNotOptimize(js_object);
+  }
+}
+BENCHMARK(JSObjectMove);
+
+static void JSObjectCreateAndDestroy(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  for (auto _ : state) {
+    JSObject js_object = js_context.CreateObject();
+    benchmark::DoNotOptimize(js_object);
+  }
+}
+BENCHMARK(JSObjectCreateAndDestroy);
+
+static void JSStringFromStdString(benchmark::State& state) {
+  const std::string string(static_cast<std::size_t>(state.range(0)), 'x');
+  for (auto _ : state) {
+    JSString js_string(string);
+    benchmark::DoNotOptimize(js_string);
+  }
+}
+BENCHMARK(JSStringFromStdString)->Arg(8)->Arg(1024);
+
+static void JSStringToStdString(benchmark::State& state) {
+  const JSString js_string(std::string(static_cast<std::size_t>(state.range(0)), 'x'));
+  for (auto _ : state) {
+    auto string = static_cast<std::string>(js_string);
+    benchmark::DoNotOptimize(string);
+  }
+}
+BENCHMARK(JSStringToStdString)->Arg(8)->Arg(1024);
+
+static void JSObjectGetProperty(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  auto  js_object  = js_context.CreateObject();
+  js_object.SetProperty("name", js_context.CreateNumber(42));
+  for (auto _ : state) {
+    auto js_value = js_object.GetProperty("name");
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(JSObjectGetProperty);
+
+static void JSObjectSetProperty(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  auto  js_object  = js_context.CreateObject();
+  const auto js_value = js_context.CreateNumber(42);
+  for (auto _ : state) {
+    js_object.SetProperty("name", js_value);
+  }
+}
+BENCHMARK(JSObjectSetProperty);
+
+static void JSExportGetNamedProperty(benchmark::State& state) {
+  auto widget = GetWidget();
+  for (auto _ : state) {
+    auto js_value = widget.GetProperty("number");
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(JSExportGetNamedProperty);
+
+static void JSExportSetNamedProperty(benchmark::State& state) {
+  auto widget = GetWidget();
+  const auto js_value = GetJSContext().CreateNumber(42);
+  for (auto _ : state) {
+    widget.SetProperty("number", js_value);
+  }
+}
+BENCHMARK(JSExportSetNamedProperty);
+
+static void JSExportCallNamedFunction(benchmark::State& state) {
+  auto widget   = GetWidget();
+  auto sayHello = static_cast<JSObject>(widget.GetProperty("sayHello"));
+  for (auto _ : state) {
+    auto js_value = sayHello(widget);
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(JSExportCallNamedFunction);
+
+static void JSExportCallNamedFunctionFromScript(benchmark::State& state) {
+  GetWidget();
+  auto& js_context = GetJSContext();
+  auto  call = static_cast<JSObject>(js_context.JSEvaluateScript("(function (n) { for (var i = 0; i < n; ++i) { Widget.sayHello(); } })"));
+  const auto global_object = js_context.get_global_object();
+  std::vector<JSValue> arguments { js_context.CreateNumber(100) };
+  for (auto _ : state) {
+    call(arguments, global_object);
+  }
+  state.SetItemsProcessed(state.iterations() * 100);
+}
+BENCHMARK(JSExportCallNamedFunctionFromScript);
+
+static void JSArrayToVector(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  std::vector<JSValue> items;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    items.push_back(js_context.CreateNumber(static_cast<double>(i)));
+  }
+  const auto js_array = js_context.CreateArray(items);
+  for (auto _ : state) {
+    auto doubles = static_cast<std::vector<double>>(js_array);
+    benchmark::DoNotOptimize(doubles);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(JSArrayToVector)->Arg(16)->Arg(1024);
+
+static void CreateFunctionCallback(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  JSFunctionCallback callback = [](const std::vector<JSValue>& arguments, JSObject& this_object) {
+    return this_object.get_context().CreateNumber(static_cast<double>(arguments.size()));
+  };
+  auto js_function = js_context.CreateFunction("native", callback);
+  const auto global_object = js_context.get_global_object();
+  std::vector<JSValue> arguments { js_context.CreateNumber(1), js_context.CreateNumber(2) };
+  for (auto _ : state) {
+    auto js_value = js_function(arguments, global_object);
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(CreateFunctionCallback);
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  
+  // Register Widget before the Scaling benchmarks race to.
+  JSExport<Widget>::Class();
+  
+  JSCOverheadReporter reporter;
+  benchmark::RunSpecifiedBenchmarks(&reporter);
+  return 0;
+}
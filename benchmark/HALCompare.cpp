@@ -0,0 +1,283 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+// Compare the results of a benchmark with a stored baseline, and fail
+// if an operation got slower.
+//
+// Both files are the JSON of HAL_Benchmarks --benchmark_out_format=json
+// or of the --json option of HAL_Macro and HAL_Startup. Runs sharing a
+// run_name are repetitions of one benchmark, e.g. from
+// --benchmark_repetitions=10 or --rounds=10, and aggregates are
+// ignored, since they are recomputed from the repetitions.
+//
+// A benchmark is reported as slower when its mean real time grew by
+// more than --threshold percent, and the --confidence interval of the
+// change, from Welch's t-test, lies entirely above zero. With a single
+// repetition on either side there is no interval, and the threshold
+// alone decides. The exit status is 1 if any benchmark is slower.
+//
+// usage: HAL_Compare [--threshold=PERCENT] [--confidence=PERCENT] BASELINE CURRENT
+//
+// e.g.
+//
+//   HAL_Macro --rounds=10 --json=baseline.json
+//   ... change HAL ...
+//   HAL_Macro --rounds=10 --json=current.json
+//   HAL_Compare --threshold=5 baseline.json current.json
+
+#include "HAL/HAL.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace HAL;
+
+namespace {
+
+  // The real times of the repetitions of each benchmark, in
+  // nanoseconds, by run_name.
+  typedef std::map<std::string, std::vector<double>> Results;
+
+  double GetNanosecondsPerUnit(const std::string& time_unit) {
+    if (time_unit == "ns") {
+      return 1;
+    }
+    if (time_unit == "us") {
+      return 1e3;
+    }
+    if (time_unit == "ms") {
+      return 1e6;
+    }
+    if (time_unit == "s") {
+      return 1e9;
+    }
+    throw std::runtime_error("Unknown time unit " + time_unit);
+  }
+
+  std::string GetString(const JSObject& js_object, const char* name) {
+    return js_object.HasProperty(name) ? static_cast<std::string>(js_object.GetProperty(name)) : std::string();
+  }
+
+  Results ReadResults(const JSContext& js_context, const std::string& path) {
+    const auto root = js_context.CreateValueFromJSONFile(path);
+    if (!root.IsObject() || !static_cast<JSObject>(root).HasProperty("benchmarks")) {
+      throw std::runtime_error(path + " isn't the JSON output of a benchmark");
+    }
+
+    Results results;
+    const auto benchmarks = static_cast<JSArray>(static_cast<JSObject>(static_cast<JSObject>(root).GetProperty("benchmarks")));
+    for (uint32_t i = 0; i < benchmarks.GetLength(); ++i) {
+      const auto benchmark = static_cast<JSObject>(benchmarks.GetProperty(i));
+      if (GetString(benchmark, "run_type") == "aggregate" || benchmark.HasProperty("error_occurred")) {
+        continue;
+      }
+      auto name = GetString(benchmark, "run_name");
+      if (name.empty()) {
+        name = GetString(benchmark, "name");
+      }
+      const auto real_time = static_cast<double>(benchmark.GetProperty("real_time"));
+      results[name].push_back(real_time * GetNanosecondsPerUnit(GetString(benchmark, "time_unit")));
+    }
+    return results;
+  }
+
+  struct Sample final {
+    double      mean     { 0 };
+    double      variance { 0 };
+    std::size_t count    { 0 };
+  };
+
+  Sample GetSample(const std::vector<double>& values) {
+    Sample sample;
+    sample.count = values.size();
+    for (const auto value : values) {
+      sample.mean += value;
+    }
+    sample.mean /= static_cast<double>(sample.count);
+    if (sample.count > 1) {
+      for (const auto value : values) {
+        sample.variance += (value - sample.mean) * (value - sample.mean);
+      }
+      sample.variance /= static_cast<double>(sample.count - 1);
+    }
+    return sample;
+  }
+
+  // The continued fraction of the regularized incomplete beta
+  // function, by the modified Lentz method.
+  double GetBetaContinuedFraction(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1;
+    double d = 1 - (a + b) * x / (a + 1);
+    d = 1 / (std::fabs(d) < tiny ? tiny : d);
+    double h = d;
+    for (int m = 1; m <= 300; ++m) {
+      for (const bool even : { true, false }) {
+        const double numerator = even
+            ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+            : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        d = 1 + numerator * d;
+        d = 1 / (std::fabs(d) < tiny ? tiny : d);
+        c = 1 + numerator / c;
+        c = std::fabs(c) < tiny ? tiny : c;
+        h *= d * c;
+      }
+      if (std::fabs(d * c - 1) < 1e-12) {
+        break;
+      }
+    }
+    return h;
+  }
+
+  double GetIncompleteBeta(double a, double b, double x) {
+    if (x <= 0 || x >= 1) {
+      return x <= 0 ? 0 : 1;
+    }
+    const double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log(1 - x));
+    if (x < (a + 1) / (a + b + 2)) {
+      return front * GetBetaContinuedFraction(a, b, x) / a;
+    }
+    return 1 - front * GetBetaContinuedFraction(b, a, 1 - x) / b;
+  }
+
+  // The probability that Student's t with the degrees of freedom is at
+  // most t, for t >= 0.
+  double GetStudentTCDF(double t, double degrees_of_freedom) {
+    return 1 - 0.5 * GetIncompleteBeta(degrees_of_freedom / 2, 0.5, degrees_of_freedom / (degrees_of_freedom + t * t));
+  }
+
+  // The t with GetStudentTCDF(t) = probability, by bisection.
+  double GetStudentTQuantile(double probability, double degrees_of_freedom) {
+    double low  = 0;
+    double high = 1e4;
+    for (int i = 0; i < 200; ++i) {
+      const double middle = (low + high) / 2;
+      (GetStudentTCDF(middle, degrees_of_freedom) < probability ? low : high) = middle;
+    }
+    return (low + high) / 2;
+  }
+
+  bool ParseOption(const char* argument, const char* name, double& value) {
+    const auto length = std::strlen(name);
+    if (std::strncmp(argument, name, length) != 0 || argument[length] != '=') {
+      return false;
+    }
+    value = std::strtod(argument + length + 1, nullptr);
+    return true;
+  }
+
+  std::string FormatNanoseconds(double nanoseconds) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    if (nanoseconds >= 1e9) {
+      os << nanoseconds / 1e9 << " s";
+    } else if (nanoseconds >= 1e6) {
+      os << nanoseconds / 1e6 << " ms";
+    } else if (nanoseconds >= 1e3) {
+      os << nanoseconds / 1e3 << " us";
+    } else {
+      os << nanoseconds << " ns";
+    }
+    return os.str();
+  }
+
+} // namespace {
+
+int main(int argc, const char* argv[]) {
+  double threshold  = 5;
+  double confidence = 95;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(argv[i], "--threshold", threshold) &&
+        !ParseOption(argv[i], "--confidence", confidence)) {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.size() != 2 || threshold < 0 || confidence <= 0 || confidence >= 100) {
+    std::cerr << "usage: " << argv[0] << " [--threshold=PERCENT] [--confidence=PERCENT] BASELINE CURRENT" << std::endl;
+    return 2;
+  }
+
+  try {
+    JSContextGroup js_context_group;
+    JSContext      js_context = js_context_group.CreateContext();
+    const auto baseline = ReadResults(js_context, paths[0]);
+    const auto current  = ReadResults(js_context, paths[1]);
+
+    std::size_t slower_count = 0;
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right
+              << std::setw(12) << "baseline" << std::setw(12) << "current"
+              << std::setw(10) << "change" << std::setw(12) << "interval" << "  verdict\n";
+    for (const auto& entry : current) {
+      const auto position = baseline.find(entry.first);
+      if (position == baseline.end()) {
+        std::cout << std::left << std::setw(40) << entry.first << std::right << std::setw(12) << "-" << std::setw(12) << FormatNanoseconds(GetSample(entry.second).mean) << "  new\n";
+        continue;
+      }
+
+      const auto before = GetSample(position -> second);
+      const auto after  = GetSample(entry.second);
+      const auto change = 100 * (after.mean - before.mean) / before.mean;
+
+      // Welch's t-test, which doesn't assume that both sides have the
+      // same variance.
+      bool   has_interval  = before.count > 1 && after.count > 1;
+      double half_interval = 0;
+      if (has_interval) {
+        const auto before_term = before.variance / static_cast<double>(before.count);
+        const auto after_term  = after.variance / static_cast<double>(after.count);
+        const auto error       = std::sqrt(before_term + after_term);
+        if (error > 0) {
+          const auto degrees_of_freedom = (before_term + after_term) * (before_term + after_term) /
+              (before_term * before_term / static_cast<double>(before.count - 1) + after_term * after_term / static_cast<double>(after.count - 1));
+          half_interval = 100 * GetStudentTQuantile(1 - (1 - confidence / 100) / 2, degrees_of_freedom) * error / before.mean;
+        }
+      }
+
+      const char* verdict = "same";
+      if (change > threshold && (!has_interval || change - half_interval > 0)) {
+        verdict = "SLOWER";
+        ++slower_count;
+      } else if (change < -threshold && (!has_interval || change + half_interval < 0)) {
+        verdict = "faster";
+      } else if (std::fabs(change) > threshold) {
+        verdict = "noise";
+      }
+
+      std::ostringstream change_string;
+      change_string << std::showpos << std::fixed << std::setprecision(1) << change << "%";
+      std::ostringstream interval_string;
+      if (has_interval) {
+        interval_string << std::fixed << std::setprecision(1) << "+/-" << half_interval << "%";
+      } else {
+        interval_string << "-";
+      }
+      std::cout << std::left << std::setw(40) << entry.first << std::right
+                << std::setw(12) << FormatNanoseconds(before.mean) << std::setw(12) << FormatNanoseconds(after.mean)
+                << std::setw(10) << change_string.str() << std::setw(12) << interval_string.str() << "  " << verdict << "\n";
+    }
+    for (const auto& entry : baseline) {
+      if (current.find(entry.first) == current.end()) {
+        std::cout << std::left << std::setw(40) << entry.first << std::right << std::setw(12) << FormatNanoseconds(GetSample(entry.second).mean) << std::setw(12) << "-" << "  missing\n";
+      }
+    }
+
+    std::cout << "\n" << slower_count << " of " << current.size() << " benchmarks slower by more than " << threshold << "% at " << confidence << "% confidence" << std::endl;
+    return slower_count == 0 ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 2;
+  }
+}
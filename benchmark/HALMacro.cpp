@@ -0,0 +1,265 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+// Measure the export layer as an application uses it, rather than one
+// operation at a time: a script creates --widgets Widgets and
+// ChildWidgets with new, reads and writes their properties, calls
+// their functions, checks instanceof, catches exceptions thrown by
+// callbacks, reads the constants of OtherWidget, and finally drops
+// them all to be finalized.
+//
+// Each phase is timed on its own, and the best of --rounds rounds is
+// reported, since it is the least disturbed by the rest of the
+// machine. The total is the number to track from release to release.
+// --json writes every round of every phase, for HAL_Compare.
+//
+// usage: HAL_Macro [--widgets=N] [--rounds=N] [--json=FILE]
+
+#include "HAL/HAL.hpp"
+#include "HALBenchmarkResults.hpp"
+#include "Widget.hpp"
+#include "ChildWidget.hpp"
+#include "OtherWidget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace HAL;
+
+namespace {
+
+  struct Phase final {
+    const char* name;
+
+    // Run with n, the number of widgets, in scope. It returns the
+    // number it is expected to, so that a phase that silently did
+    // less work fails instead of looking fast.
+    const char* script;
+    double      (*expected)(double n);
+
+    // The operations per widget, to report the time of each.
+    double      operations;
+  };
+
+  double Zero(double) {
+    return 0;
+  }
+
+  double Widgets(double n) {
+    return n;
+  }
+
+  double TwiceWidgets(double n) {
+    return 2 * n;
+  }
+
+  double TenthOfWidgets(double n) {
+    return std::floor(n / 10);
+  }
+
+  const Phase kPhases[] = {
+    { "construct", R"JS(
+        widgets  = [];
+        children = [];
+        for (var i = 0; i < n; ++i) {
+          widgets.push(new Widget('widget' + i, i));
+          children.push(new ChildWidget('child' + i, i));
+        }
+        widgets.length + children.length;
+      )JS", &TwiceWidgets, 2 },
+
+    { "properties", R"JS(
+        var sum = 0;
+        for (var i = 0; i < n; ++i) {
+          var widget = widgets[i];
+          widget.number = widget.number + 1;
+          widget.name   = widget.name + '!';
+          sum += widget.number >= 1 && widget.pi > 3 ? 1 : 0;
+        }
+        sum;
+      )JS", &Widgets, 6 },
+
+    { "functions", R"JS(
+        var length = 0;
+        for (var i = 0; i < n; ++i) {
+          length += widgets[i].sayHello().length > 0 ? 1 : 0;
+          length += children[i].sayHello().length > 0 ? 1 : 0;
+        }
+        length;
+      )JS", &TwiceWidgets, 2 },
+
+    { "inheritance", R"JS(
+        var count = 0;
+        for (var i = 0; i < n; ++i) {
+          var child = children[i];
+          if (child instanceof Widget && child instanceof ChildWidget && !(widgets[i] instanceof ChildWidget) && child.my_name.length > 0) {
+            ++count;
+          }
+        }
+        count;
+      )JS", &Widgets, 4 },
+
+    { "constants", R"JS(
+        var count = 0;
+        for (var i = 0; i < n; ++i) {
+          if (OtherWidget.CONST1 + OtherWidget.CONST2 + OtherWidget.CONST3 === OtherWidget.CONST1 + OtherWidget.CONST2 + OtherWidget.CONST3) {
+            ++count;
+          }
+        }
+        count;
+      )JS", &Widgets, 6 },
+
+    // Exceptions are far slower than everything else, so only every
+    // tenth widget throws one, to keep them from dominating the total.
+    { "exceptions", R"JS(
+        var caught = 0;
+        for (var i = 0; i + 10 <= n; i += 10) {
+          try {
+            widgets[i].testException();
+          } catch (e) {
+            ++caught;
+          }
+        }
+        caught;
+      )JS", &TenthOfWidgets, 0.1 },
+
+    { "release", R"JS(
+        widgets  = null;
+        children = null;
+        0;
+      )JS", &Zero, 0 }
+  };
+
+  const std::size_t kPhaseCount = sizeof(kPhases) / sizeof(kPhases[0]);
+
+  bool ParseOption(const char* argument, const char* name, std::string& value) {
+    const auto length = std::strlen(name);
+    if (std::strncmp(argument, name, length) != 0 || argument[length] != '=') {
+      return false;
+    }
+    value = argument + length + 1;
+    return true;
+  }
+
+  bool ParseOption(const char* argument, const char* name, std::size_t& value) {
+    std::string string;
+    if (!ParseOption(argument, name, string)) {
+      return false;
+    }
+    value = static_cast<std::size_t>(std::strtoul(string.c_str(), nullptr, 10));
+    return true;
+  }
+
+  double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count();
+  }
+
+  // Run every phase once in a new context, and return the time of
+  // each, followed by the time the collector takes to finalize the
+  // released widgets.
+  std::vector<double> RunRound(std::size_t widget_count) {
+    JSContextGroup js_context_group;
+    JSContext      js_context    = js_context_group.CreateContext();
+    auto           global_object = js_context.get_global_object();
+    global_object.SetProperty("Widget", js_context.CreateObject(JSExport<Widget>::Class()));
+    global_object.SetProperty("ChildWidget", js_context.CreateObject(JSExport<ChildWidget>::Class()));
+    global_object.SetProperty("OtherWidget", js_context.CreateObject(JSExport<OtherWidget>::Class()));
+    global_object.SetProperty("n", js_context.CreateNumber(static_cast<double>(widget_count)));
+
+    std::vector<double> times;
+    for (const auto& phase : kPhases) {
+      const auto start  = std::chrono::steady_clock::now();
+      const auto result = static_cast<double>(js_context.JSEvaluateScript(phase.script));
+      times.push_back(ToMilliseconds(std::chrono::steady_clock::now() - start));
+
+      const auto expected = phase.expected(static_cast<double>(widget_count));
+      if (result != expected) {
+        throw std::runtime_error(std::string("The ") + phase.name + " phase returned " + std::to_string(result) + " instead of " + std::to_string(expected));
+      }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    js_context.GarbageCollect();
+    times.push_back(ToMilliseconds(std::chrono::steady_clock::now() - start));
+    return times;
+  }
+
+} // namespace {
+
+int main(int argc, const char* argv[]) {
+  std::size_t widget_count = 10000;
+  std::size_t round_count  = 5;
+  std::string json_path;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(argv[i], "--widgets", widget_count) &&
+        !ParseOption(argv[i], "--rounds", round_count) &&
+        !ParseOption(argv[i], "--json", json_path)) {
+      std::cerr << "usage: " << argv[0] << " [--widgets=N] [--rounds=N] [--json=FILE]" << std::endl;
+      return 2;
+    }
+  }
+  if (widget_count == 0 || round_count == 0) {
+    std::cerr << argv[0] << ": The widgets and rounds must be at least 1" << std::endl;
+    return 2;
+  }
+
+  try {
+    // Register the classes up front, so that the first round doesn't
+    // pay for it.
+    JSExport<Widget>::Class();
+    JSExport<ChildWidget>::Class();
+    JSExport<OtherWidget>::Class();
+
+    const auto get_phase_name = [](std::size_t i) {
+      return std::string(i < kPhaseCount ? kPhases[i].name : "finalize");
+    };
+
+    HALBenchmarkResults results(argv[0]);
+    std::vector<double> best(kPhaseCount + 1, std::numeric_limits<double>::max());
+    for (std::size_t round = 0; round < round_count; ++round) {
+      const auto times = RunRound(widget_count);
+      double total = 0;
+      for (std::size_t i = 0; i < times.size(); ++i) {
+        best[i] = std::min(best[i], times[i]);
+        results.Add("HAL_Macro/" + get_phase_name(i), round, round_count, times[i]);
+        total += times[i];
+      }
+      results.Add("HAL_Macro/total", round, round_count, total);
+    }
+    if (!json_path.empty()) {
+      results.Write(json_path);
+    }
+
+    std::cout << "widgets:                    " << widget_count << " (best of " << round_count << " rounds)\n"
+              << std::fixed << std::setprecision(3);
+    double total = 0;
+    for (std::size_t i = 0; i < best.size(); ++i) {
+      const auto operations = i < kPhaseCount ? kPhases[i].operations : 0.0;
+      std::cout << std::left << std::setw(28) << (get_phase_name(i) + ":") << best[i] << " ms";
+      if (operations > 0) {
+        std::cout << " (" << best[i] * 1000000 / (static_cast<double>(widget_count) * operations) << " ns/op)";
+      }
+      std::cout << "\n";
+      total += best[i];
+    }
+    std::cout << std::left << std::setw(28) << "total:" << total << " ms (" << total * 1000 / static_cast<double>(widget_count) << " us/widget)" << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+// Measure the memory of live HAL wrappers: the bytes of each JSValue,
+// JSObject, JSString and exported object, counting what HAL's
+// registries allocate for it, and the growth of the resident set size
+// while --count of them are held in a std::vector.
+//
+// The bytes are counted by replacing operator new, which covers HAL
+// but not JavaScriptCore's own heap, and doesn't reach into a DLL on
+// Windows. The resident set size covers both.
+//
+// Build with -DCMAKE_CXX_FLAGS=-DHAL_THREAD_SAFE to compare the
+// threading models, which HAL_Memory prints.
+//
+// usage: HAL_Memory [--count=N]
+
+#include "HAL/HAL.hpp"
+#include "Widget.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace HAL;
+
+namespace {
+  
+  std::atomic<std::int64_t> live_bytes { 0 };
+  
+  // Room for the size of an allocation ahead of it, keeping the
+  // alignment of operator new.
+  const std::size_t kHeaderSize = 16;
+  
+  void* Allocate(std::size_t size) {
+    auto header = static_cast<char*>(std::malloc(size + kHeaderSize));
+    if (!header) {
+      return nullptr;
+    }
+    std::memcpy(header, &size, sizeof(size));
+    live_bytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+    return header + kHeaderSize;
+  }
+  
+  void Deallocate(void* ptr) {
+    if (ptr) {
+      auto header = static_cast<char*>(ptr) - kHeaderSize;
+      std::size_t size = 0;
+      std::memcpy(&size, header, sizeof(size));
+      live_bytes.fetch_sub(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+      std::free(header);
+    }
+  }
+  
+  // Return the current resident set size in bytes.
+  std::int64_t GetResidentSetSize() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      return static_cast<std::int64_t>(counters.WorkingSetSize);
+    }
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+      return static_cast<std::int64_t>(info.resident_size);
+    }
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    std::int64_t size = 0;
+    std::int64_t resident = 0;
+    statm >> size >> resident;
+    return resident * static_cast<std::int64_t>(sysconf(_SC_PAGESIZE));
+#endif
+  }
+  
+  const char* GetThreadingModel() {
+#if defined(HAL_THREAD_SAFE)
+    return "HAL_THREAD_SAFE";
+#elif defined(HAL_THREAD_AFFINITY)
+    return "HAL_THREAD_AFFINITY";
+#else
+    return "none";
+#endif
+  }
+  
+  // Hold count values made by create, and report their bytes.
+  template<typename T>
+  void Measure(const char* name, JSContext& js_context, std::size_t count, const std::function<T(std::size_t)>& create) {
+    js_context.GarbageCollect();
+    const auto rss_before = GetResidentSetSize();
+    {
+      std::vector<T> values;
+      values.reserve(count);
+      const auto bytes_before = live_bytes.load(std::memory_order_relaxed);
+      for (std::size_t i = 0; i < count; ++i) {
+        values.push_back(create(i));
+      }
+      const auto bytes_after = live_bytes.load(std::memory_order_relaxed);
+      const auto rss_after   = GetResidentSetSize();
+      
+      std::cout << name << ":\n"
+                << "  sizeof:                   " << sizeof(T) << " bytes\n"
+                << "  heap each:                " << static_cast<double>(bytes_after - bytes_before) / count << " bytes\n"
+                << "  total each:               " << sizeof(T) + static_cast<double>(bytes_after - bytes_before) / count << " bytes\n"
+                << "  resident set size growth: " << static_cast<double>(rss_after - rss_before) / count << " bytes each, "
+                << (rss_after - rss_before) / (1024 * 1024) << " MiB in all\n";
+    }
+    js_context.GarbageCollect();
+  }
+  
+} // namespace {
+
+void* operator new(std::size_t size) {
+  if (auto ptr = Allocate(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) HAL_NOEXCEPT {
+  return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) HAL_NOEXCEPT {
+  return Allocate(size);
+}
+
+void operator delete(void* ptr) HAL_NOEXCEPT {
+  Deallocate(ptr);
+}
+
+void operator delete[](void* ptr) HAL_NOEXCEPT {
+  Deallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) HAL_NOEXCEPT {
+  Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) HAL_NOEXCEPT {
+  Deallocate(ptr);
+}
+
+int main(int argc, const char* argv[]) {
+  std::size_t count = 1000000;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--count=", 8) == 0) {
+      count = static_cast<std::size_t>(std::strtoul(argv[i] + 8, nullptr, 10));
+    } else {
+      std::cerr << "usage: " << argv[0] << " [--count=N]" << std::endl;
+      return 2;
+    }
+  }
+  if (count == 0) {
+    std::cerr << argv[0] << ": The count must be at least 1" << std::endl;
+    return 2;
+  }
+  
+  JSContextGroup js_context_group;
+  JSContext      js_context = js_context_group.CreateContext();
+  JSExport<Widget>::Class();
+  
+  std::cout << "threading model:            " << GetThreadingModel() << "\n"
+            << "count:                      " << count << "\n";
+  
+  Measure<JSValue>("JSValue", js_context, count, [&js_context](std::size_t i) {
+    return js_context.CreateNumber(static_cast<double>(i));
+  });
+  Measure<JSObject>("JSObject", js_context, count, [&js_context](std::size_t) {
+    return js_context.CreateObject();
+  });
+  Measure<JSString>("JSString", js_context, count, [](std::size_t i) {
+    return JSString(std::to_string(i));
+  });
+  Measure<JSObject>("exported object", js_context, count, [&js_context](std::size_t) {
+    return js_context.CreateObject(JSExport<Widget>::Class());
+  });
+  
+  return 0;
+}
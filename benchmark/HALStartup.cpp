@@ -0,0 +1,254 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+// Measure the cold start of an application built on HAL: registering
+// JSExport classes, creating a context, installing the classes in it
+// and evaluating a first script, and report the peak resident set
+// size afterwards.
+//
+// --json writes the times of the phases, for HAL_Compare.
+//
+// usage: HAL_Startup [--classes=N] [--properties=N] [--functions=N] [--bundle=FILE] [--json=FILE]
+
+#include "HAL/HAL.hpp"
+#include "HALBenchmarkResults.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace HAL;
+
+namespace {
+  
+  struct StartupOptions final {
+    std::size_t class_count    { 32 };
+    std::size_t property_count { 16 };
+    std::size_t function_count { 16 };
+    std::string bundle_path;
+  };
+  
+  StartupOptions& GetStartupOptions() {
+    static StartupOptions options;
+    return options;
+  }
+  
+  // A class with the numbers of properties and functions of the
+  // options. Each N is a distinct class to register.
+  template<int N>
+  class SyntheticClass final : public JSExportObject, public JSExport<SyntheticClass<N>> {
+    
+  public:
+    
+    SyntheticClass(const JSContext& js_context) HAL_NOEXCEPT
+    : JSExportObject(js_context) {
+    }
+    
+    static void JSExportInitialize() {
+      const auto& options = GetStartupOptions();
+      JSExport<SyntheticClass<N>>::SetClassVersion(1);
+      for (std::size_t i = 0; i < options.property_count; ++i) {
+        JSExport<SyntheticClass<N>>::template AddValueProperty<&SyntheticClass::js_get_value, &SyntheticClass::js_set_value>("p" + std::to_string(i));
+      }
+      for (std::size_t i = 0; i < options.function_count; ++i) {
+        JSExport<SyntheticClass<N>>::template AddFunctionProperty<&SyntheticClass::js_function>("f" + std::to_string(i));
+      }
+    }
+    
+    JSValue js_get_value() const {
+      return get_context().CreateNumber(value__);
+    }
+    
+    bool js_set_value(const JSValue& value) {
+      value__ = static_cast<double>(value);
+      return true;
+    }
+    
+    JSValue js_function(const std::vector<JSValue>& arguments, JSObject& this_object) {
+      return this_object.get_context().CreateNumber(static_cast<double>(arguments.size()));
+    }
+    
+  private:
+    
+    double value__ { 0 };
+  };
+  
+  static const std::size_t kMaxClassCount = 64;
+  
+  struct SyntheticClassEntry final {
+    const JSClass& (*get_class)();
+  };
+  
+  template<int N>
+  const JSClass& GetSyntheticClass() {
+    return JSExport<SyntheticClass<N>>::Class();
+  }
+  
+  template<int N>
+  struct SyntheticClassTable final {
+    static void Fill(std::vector<SyntheticClassEntry>& entries) {
+      SyntheticClassTable<N - 1>::Fill(entries);
+      entries.push_back({ &GetSyntheticClass<N - 1> });
+    }
+  };
+  
+  template<>
+  struct SyntheticClassTable<0> final {
+    static void Fill(std::vector<SyntheticClassEntry>&) {
+    }
+  };
+  
+  // Touch a property and a function of every class, unless a bundle
+  // was given.
+  std::string GetBundle(const StartupOptions& options) {
+    if (!options.bundle_path.empty()) {
+      std::ifstream ifstream(options.bundle_path, std::ios_base::binary | std::ios_base::in);
+      if (!ifstream.is_open()) {
+        throw std::runtime_error("Unable to open " + options.bundle_path);
+      }
+      std::ostringstream os;
+      os << ifstream.rdbuf();
+      return os.str();
+    }
+    
+    std::ostringstream os;
+    for (std::size_t i = 0; i < options.class_count; ++i) {
+      if (options.property_count > 0) {
+        os << "Synthetic" << i << ".p0 = Synthetic" << i << ".p0 + 1;\n";
+      }
+      if (options.function_count > 0) {
+        os << "Synthetic" << i << ".f0(1, 2);\n";
+      }
+    }
+    return os.str();
+  }
+  
+  // Return the peak resident set size in bytes.
+  std::uint64_t GetPeakResidentSetSize() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+  }
+  
+  bool ParseOption(const char* argument, const char* name, std::string& value) {
+    const auto length = std::strlen(name);
+    if (std::strncmp(argument, name, length) != 0 || argument[length] != '=') {
+      return false;
+    }
+    value = argument + length + 1;
+    return true;
+  }
+  
+  bool ParseOption(const char* argument, const char* name, std::size_t& value) {
+    std::string string;
+    if (!ParseOption(argument, name, string)) {
+      return false;
+    }
+    value = static_cast<std::size_t>(std::strtoul(string.c_str(), nullptr, 10));
+    return true;
+  }
+  
+  double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count();
+  }
+  
+} // namespace {
+
+int main(int argc, const char* argv[]) {
+  const auto start = std::chrono::steady_clock::now();
+  
+  auto& options = GetStartupOptions();
+  std::string json_path;
+  for (int i = 1; i < argc; ++i) {
+    if (!ParseOption(argv[i], "--classes", options.class_count) &&
+        !ParseOption(argv[i], "--properties", options.property_count) &&
+        !ParseOption(argv[i], "--functions", options.function_count) &&
+        !ParseOption(argv[i], "--bundle", options.bundle_path) &&
+        !ParseOption(argv[i], "--json", json_path)) {
+      std::cerr << "usage: " << argv[0] << " [--classes=N] [--properties=N] [--functions=N] [--bundle=FILE] [--json=FILE]" << std::endl;
+      return 2;
+    }
+  }
+  if (options.class_count > kMaxClassCount) {
+    std::cerr << argv[0] << ": At most " << kMaxClassCount << " classes are available" << std::endl;
+    return 2;
+  }
+  
+  try {
+    const auto bundle = GetBundle(options);
+    
+    std::vector<SyntheticClassEntry> entries;
+    SyntheticClassTable<kMaxClassCount>::Fill(entries);
+    entries.resize(options.class_count);
+    
+    for (const auto& entry : entries) {
+      entry.get_class();
+    }
+    const auto registered = std::chrono::steady_clock::now();
+    
+    JSContextGroup js_context_group;
+    JSContext      js_context = js_context_group.CreateContext();
+    const auto created = std::chrono::steady_clock::now();
+    
+    auto global_object = js_context.get_global_object();
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      global_object.SetProperty("Synthetic" + std::to_string(i), js_context.CreateObject(entries[i].get_class()));
+    }
+    const auto installed = std::chrono::steady_clock::now();
+    
+    js_context.JSEvaluateScript(bundle);
+    const auto evaluated = std::chrono::steady_clock::now();
+    
+    std::cout << "classes:                    " << options.class_count << " (" << options.property_count << " properties, " << options.function_count << " functions each)\n"
+              << "register classes:           " << ToMilliseconds(registered - start) << " ms\n"
+              << "create context:             " << ToMilliseconds(created - registered) << " ms\n"
+              << "install classes:            " << ToMilliseconds(installed - created) << " ms\n"
+              << "evaluate bundle:            " << ToMilliseconds(evaluated - installed) << " ms (" << bundle.size() << " bytes)\n"
+              << "time to first script:       " << ToMilliseconds(evaluated - start) << " ms\n"
+              << "peak resident set size:     " << GetPeakResidentSetSize() / 1024 << " KiB" << std::endl;
+    
+    if (!json_path.empty()) {
+      HALBenchmarkResults results(argv[0]);
+      results.Add("HAL_Startup/register_classes", 0, 1, ToMilliseconds(registered - start));
+      results.Add("HAL_Startup/create_context", 0, 1, ToMilliseconds(created - registered));
+      results.Add("HAL_Startup/install_classes", 0, 1, ToMilliseconds(installed - created));
+      results.Add("HAL_Startup/evaluate_bundle", 0, 1, ToMilliseconds(evaluated - installed));
+      results.Add("HAL_Startup/time_to_first_script", 0, 1, ToMilliseconds(evaluated - start));
+      results.Write(json_path);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+  
+  return 0;
+}
@@ -0,0 +1,229 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+// Each JSC_<operation> benchmark does through the JavaScriptCore C API
+// what HAL_<operation> does through HAL, so that JSCOverheadReporter
+// can report what the wrapper costs.
+
+#include "HAL/HAL.hpp"
+
+#include "benchmark/benchmark.h"
+
+#include <string>
+#include <vector>
+
+#include <JavaScriptCore/JavaScript.h>
+
+using namespace HAL;
+
+namespace {
+  
+  JSContext& GetJSContext() {
+    static JSContextGroup js_context_group;
+    static JSContext      js_context = js_context_group.CreateContext();
+    return js_context;
+  }
+  
+  JSGlobalContextRef GetJSGlobalContextRef() {
+    static JSGlobalContextRef js_global_context_ref = JSGlobalContextCreateInGroup(nullptr, nullptr);
+    return js_global_context_ref;
+  }
+  
+  // The source of the function that both call with N arguments.
+  const char* const kFunctionSource = "(function () { return arguments.length; })";
+  
+  class Counter final : public JSExportObject, public JSExport<Counter> {
+    
+  public:
+    
+    Counter(const JSContext& js_context) HAL_NOEXCEPT
+    : JSExportObject(js_context) {
+    }
+    
+    static void JSExportInitialize() {
+      JSExport<Counter>::SetClassVersion(1);
+      JSExport<Counter>::AddFunctionProperty("increment", std::mem_fn(&Counter::js_increment));
+    }
+    
+    JSValue js_increment(const std::vector<JSValue>& arguments, JSObject& this_object) {
+      return this_object.get_context().CreateNumber(++count__);
+    }
+    
+  private:
+    
+    double count__ { 0 };
+  };
+  
+  JSValueRef RawIncrement(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments[], JSValueRef* exception) {
+    auto count = static_cast<double*>(JSObjectGetPrivate(this_object_ref));
+    return JSValueMakeNumber(context_ref, ++*count);
+  }
+  
+  JSClassRef GetRawCounterClass() {
+    static const JSStaticFunction static_functions[] = {
+      { "increment", RawIncrement, kJSPropertyAttributeDontDelete },
+      { nullptr, nullptr, 0 }
+    };
+    static JSClassRef js_class_ref = [] {
+      auto js_class_definition = kJSClassDefinitionEmpty;
+      js_class_definition.className       = "RawCounter";
+      js_class_definition.staticFunctions = static_functions;
+      return JSClassCreate(&js_class_definition);
+    }();
+    return js_class_ref;
+  }
+  
+} // namespace {
+
+static void JSC_GetProperty(benchmark::State& state) {
+  const auto context_ref = GetJSGlobalContextRef();
+  const auto object_ref  = JSObjectMake(context_ref, nullptr, nullptr);
+  const auto name_ref    = JSStringCreateWithUTF8CString("name");
+  JSObjectSetProperty(context_ref, object_ref, name_ref, JSValueMakeNumber(context_ref, 42), kJSPropertyAttributeNone, nullptr);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(JSObjectGetProperty(context_ref, object_ref, name_ref, nullptr));
+  }
+  JSStringRelease(name_ref);
+}
+BENCHMARK(JSC_GetProperty);
+
+static void HAL_GetProperty(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  auto  js_object  = js_context.CreateObject();
+  const JSString name("name");
+  js_object.SetProperty(name, js_context.CreateNumber(42));
+  for (auto _ : state) {
+    auto js_value = js_object.GetProperty(name);
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(HAL_GetProperty);
+
+static void JSC_SetProperty(benchmark::State& state) {
+  const auto context_ref = GetJSGlobalContextRef();
+  const auto object_ref  = JSObjectMake(context_ref, nullptr, nullptr);
+  const auto name_ref    = JSStringCreateWithUTF8CString("name");
+  const auto value_ref   = JSValueMakeNumber(context_ref, 42);
+  for (auto _ : state) {
+    JSObjectSetProperty(context_ref, object_ref, name_ref, value_ref, kJSPropertyAttributeNone, nullptr);
+  }
+  JSStringRelease(name_ref);
+}
+BENCHMARK(JSC_SetProperty);
+
+static void HAL_SetProperty(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  auto  js_object  = js_context.CreateObject();
+  const JSString name("name");
+  const auto js_value = js_context.CreateNumber(42);
+  for (auto _ : state) {
+    js_object.SetProperty(name, js_value);
+  }
+}
+BENCHMARK(HAL_SetProperty);
+
+static void JSC_CallFunction(benchmark::State& state) {
+  const auto context_ref = GetJSGlobalContextRef();
+  const auto source_ref  = JSStringCreateWithUTF8CString(kFunctionSource);
+  const auto function_ref = JSValueToObject(context_ref, JSEvaluateScript(context_ref, source_ref, nullptr, nullptr, 1, nullptr), nullptr);
+  JSStringRelease(source_ref);
+  std::vector<JSValueRef> arguments;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    arguments.push_back(JSValueMakeNumber(context_ref, static_cast<double>(i)));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(JSObjectCallAsFunction(context_ref, function_ref, nullptr, arguments.size(), arguments.data(), nullptr));
+  }
+}
+BENCHMARK(JSC_CallFunction)->Arg(0)->Arg(4)->Arg(16);
+
+static void HAL_CallFunction(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  auto  js_function = static_cast<JSObject>(js_context.JSEvaluateScript(kFunctionSource));
+  const auto global_object = js_context.get_global_object();
+  std::vector<JSValue> arguments;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    arguments.push_back(js_context.CreateNumber(static_cast<double>(i)));
+  }
+  for (auto _ : state) {
+    auto js_value = js_function(arguments, global_object);
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(HAL_CallFunction)->Arg(0)->Arg(4)->Arg(16);
+
+static void JSC_CreateObject(benchmark::State& state) {
+  const auto context_ref = GetJSGlobalContextRef();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(JSObjectMake(context_ref, nullptr, nullptr));
+  }
+}
+BENCHMARK(JSC_CreateObject);
+
+static void HAL_CreateObject(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  for (auto _ : state) {
+    auto js_object = js_context.CreateObject();
+    benchmark::DoNotOptimize(js_object);
+  }
+}
+BENCHMARK(HAL_CreateObject);
+
+static void JSC_StringRoundTrip(benchmark::State& state) {
+  const auto context_ref = GetJSGlobalContextRef();
+  const std::string string(static_cast<std::size_t>(state.range(0)), 'x');
+  std::vector<char> buffer;
+  for (auto _ : state) {
+    const auto string_ref = JSStringCreateWithUTF8CString(string.c_str());
+    const auto value_ref  = JSValueMakeString(context_ref, string_ref);
+    JSStringRelease(string_ref);
+    const auto copy_ref = JSValueToStringCopy(context_ref, value_ref, nullptr);
+    buffer.resize(JSStringGetMaximumUTF8CStringSize(copy_ref));
+    const auto size = JSStringGetUTF8CString(copy_ref, buffer.data(), buffer.size());
+    JSStringRelease(copy_ref);
+    std::string result(buffer.data(), size > 0 ? size - 1 : 0);
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(JSC_StringRoundTrip)->Arg(8)->Arg(1024);
+
+static void HAL_StringRoundTrip(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  const std::string string(static_cast<std::size_t>(state.range(0)), 'x');
+  for (auto _ : state) {
+    const auto js_value = js_context.CreateString(string);
+    auto result = static_cast<std::string>(js_value);
+    benchmark::DoNotOptimize(result);
+  }
+}
+BENCHMARK(HAL_StringRoundTrip)->Arg(8)->Arg(1024);
+
+static void JSC_CallExportedMethod(benchmark::State& state) {
+  const auto context_ref = GetJSGlobalContextRef();
+  double count = 0;
+  const auto object_ref = JSObjectMake(context_ref, GetRawCounterClass(), &count);
+  const auto name_ref   = JSStringCreateWithUTF8CString("increment");
+  for (auto _ : state) {
+    const auto method_ref = JSValueToObject(context_ref, JSObjectGetProperty(context_ref, object_ref, name_ref, nullptr), nullptr);
+    benchmark::DoNotOptimize(JSObjectCallAsFunction(context_ref, method_ref, object_ref, 0, nullptr, nullptr));
+  }
+  JSStringRelease(name_ref);
+}
+BENCHMARK(JSC_CallExportedMethod);
+
+static void HAL_CallExportedMethod(benchmark::State& state) {
+  auto& js_context = GetJSContext();
+  auto  counter    = js_context.CreateObject(JSExport<Counter>::Class());
+  const JSString name("increment");
+  for (auto _ : state) {
+    auto method   = static_cast<JSObject>(counter.GetProperty(name));
+    auto js_value = method(counter);
+    benchmark::DoNotOptimize(js_value);
+  }
+}
+BENCHMARK(HAL_CallExportedMethod);
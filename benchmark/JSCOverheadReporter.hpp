@@ -0,0 +1,75 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_BENCHMARK_JSCOVERHEADREPORTER_HPP_
+#define _HAL_BENCHMARK_JSCOVERHEADREPORTER_HPP_
+
+#include "benchmark/benchmark.h"
+
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*!
+ @class
+ 
+ @discussion A JSCOverheadReporter writes the results of the
+ benchmarks to the console, followed by a table pairing each
+ benchmark named JSC_<operation> with the HAL_<operation> doing the
+ same through HAL, and the ratio of their times.
+ */
+class JSCOverheadReporter final : public benchmark::ConsoleReporter {
+  
+public:
+  
+  virtual void ReportRuns(const std::vector<Run>& runs) override {
+    benchmark::ConsoleReporter::ReportRuns(runs);
+    for (const auto& run : runs) {
+      if (run.iterations == 0) {
+        continue;
+      }
+      const auto name = run.benchmark_name();
+      if (name.compare(0, 4, "JSC_") == 0) {
+        times__[name.substr(4)].first = run.GetAdjustedCPUTime();
+      } else if (name.compare(0, 4, "HAL_") == 0) {
+        times__[name.substr(4)].second = run.GetAdjustedCPUTime();
+      }
+    }
+  }
+  
+  virtual void Finalize() override {
+    benchmark::ConsoleReporter::Finalize();
+    
+    auto& os = GetOutputStream();
+    bool first = true;
+    for (const auto& entry : times__) {
+      const auto jsc_time = entry.second.first;
+      const auto hal_time = entry.second.second;
+      if (jsc_time <= 0 || hal_time <= 0) {
+        continue;
+      }
+      if (first) {
+        os << "\n" << std::left << std::setw(32) << "HAL overhead" << std::right << std::setw(14) << "JSC" << std::setw(14) << "HAL" << std::setw(10) << "ratio" << "\n";
+        first = false;
+      }
+      os << std::left << std::setw(32) << entry.first << std::right << std::fixed << std::setprecision(1)
+         << std::setw(14) << jsc_time << std::setw(14) << hal_time
+         << std::setprecision(2) << std::setw(9) << hal_time / jsc_time << "x\n";
+    }
+  }
+  
+private:
+  
+  // The JSC and HAL times of each operation, in the time unit of its
+  // benchmarks.
+  std::map<std::string, std::pair<double, double>> times__;
+};
+
+#endif // _HAL_BENCHMARK_JSCOVERHEADREPORTER_HPP_
@@ -0,0 +1,81 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+// Each Scaling benchmark runs its loop on 1 to N threads at once, each
+// with a JSContextGroup of its own, so that its items per second show
+// how HAL's process wide state scales. run_scaling_benchmarks.sh runs
+// them in each threading model.
+
+#include "HAL/HAL.hpp"
+#include "Widget.hpp"
+
+#include "benchmark/benchmark.h"
+
+#include <thread>
+#include <vector>
+
+using namespace HAL;
+
+namespace {
+  
+  int GetMaxThreadCount() {
+    const auto thread_count = static_cast<int>(std::thread::hardware_concurrency());
+    return thread_count > 1 ? thread_count : 2;
+  }
+  
+  const int kOperationsPerIteration = 100;
+  
+} // namespace {
+
+static void ScalingJSObjectCopy(benchmark::State& state) {
+  JSContextGroup js_context_group;
+  auto js_context = js_context_group.CreateContext();
+  const auto js_object = js_context.CreateObject();
+  for (auto _ : state) {
+    for (int i = 0; i < kOperationsPerIteration; ++i) {
+      JSObject copy(js_object);
+      benchmark::DoNotOptimize(copy);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOperationsPerIteration);
+}
+BENCHMARK(ScalingJSObjectCopy)->ThreadRange(1, GetMaxThreadCount())->UseRealTime();
+
+static void ScalingJSExportGetProperty(benchmark::State& state) {
+  JSContextGroup js_context_group;
+  auto js_context = js_context_group.CreateContext();
+  auto widget = js_context.CreateObject(JSExport<Widget>::Class());
+  const JSString name("number");
+  for (auto _ : state) {
+    for (int i = 0; i < kOperationsPerIteration; ++i) {
+      auto js_value = widget.GetProperty(name);
+      benchmark::DoNotOptimize(js_value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOperationsPerIteration);
+}
+BENCHMARK(ScalingJSExportGetProperty)->ThreadRange(1, GetMaxThreadCount())->UseRealTime();
+
+static void ScalingJSFunctionCallback(benchmark::State& state) {
+  JSContextGroup js_context_group;
+  auto js_context = js_context_group.CreateContext();
+  JSFunctionCallback callback = [](const std::vector<JSValue>& arguments, JSObject& this_object) {
+    return this_object.get_context().CreateNumber(static_cast<double>(arguments.size()));
+  };
+  auto js_function = js_context.CreateFunction("native", callback);
+  const auto global_object = js_context.get_global_object();
+  std::vector<JSValue> arguments { js_context.CreateNumber(1) };
+  for (auto _ : state) {
+    for (int i = 0; i < kOperationsPerIteration; ++i) {
+      auto js_value = js_function(arguments, global_object);
+      benchmark::DoNotOptimize(js_value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kOperationsPerIteration);
+}
+BENCHMARK(ScalingJSFunctionCallback)->ThreadRange(1, GetMaxThreadCount())->UseRealTime();
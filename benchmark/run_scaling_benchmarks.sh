@@ -0,0 +1,60 @@
+#!/usr/bin/env bash
+
+# HAL
+#
+# Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+# Licensed under the terms of the Apache Public License.
+# Please see the LICENSE included with this distribution for details.
+
+# Build HAL_Benchmarks in each threading model, run the Scaling
+# benchmarks, and write scaling.csv with the items per second of each
+# benchmark and thread count in each model, ready to plot.
+#
+# HAL_THREAD_AFFINITY stands in for the unlocked build: without it or
+# HAL_THREAD_SAFE, HAL's process wide registries aren't locked, and
+# using HAL from several threads at once isn't safe.
+
+set -e
+
+declare -r SOURCE_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)
+declare -r MODELS="HAL_THREAD_SAFE HAL_THREAD_AFFINITY"
+
+function echo_and_eval {
+    local -r cmd="${1:?}"
+    echo "${cmd}" && eval "${cmd}"
+}
+
+for model in ${MODELS}; do
+    build_dir="build.scaling.$(echo ${model} | tr '[:upper:]' '[:lower:]')"
+    echo_and_eval "mkdir -p \"${build_dir}\""
+    echo_and_eval "pushd \"${build_dir}\""
+    echo_and_eval "cmake -DCMAKE_BUILD_TYPE=Release -DCMAKE_CXX_FLAGS=-D${model} \"${SOURCE_DIR}\" && make -j 4 HAL_Benchmarks"
+    echo_and_eval "./benchmark/HAL_Benchmarks --benchmark_filter=^Scaling --benchmark_out=../scaling.${model}.csv --benchmark_out_format=csv"
+    echo_and_eval "popd"
+done
+
+# Join the rows of each model, named like
+# "ScalingJSObjectCopy/real_time/threads:4", on benchmark and threads.
+awk -F, -v models="${MODELS}" '
+    BEGIN { model_count = split(models, model_names, " ") }
+    FNR == 1 { ++file }
+    $1 ~ /^"?Scaling/ {
+        name = $1; gsub(/"/, "", name)
+        split(name, parts, "/")
+        threads = name; sub(/.*threads:/, "", threads)
+        key = parts[1] "," threads
+        if (!(key in seen)) { seen[key] = 1; keys[++key_count] = key }
+        items_per_second[key, file] = $7
+    }
+    END {
+        printf "benchmark,threads"
+        for (i = 1; i <= model_count; ++i) printf ",%s", model_names[i]
+        printf "\n"
+        for (k = 1; k <= key_count; ++k) {
+            printf "%s", keys[k]
+            for (i = 1; i <= model_count; ++i) printf ",%s", items_per_second[keys[k], i]
+            printf "\n"
+        }
+    }' $(for model in ${MODELS}; do echo "scaling.${model}.csv"; done) > scaling.csv
+
+echo_and_eval "cat scaling.csv"
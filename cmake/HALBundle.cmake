@@ -0,0 +1,46 @@
+# HAL
+#
+# Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+# Licensed under the terms of the Apache Public License.
+# Please see the LICENSE included with this distribution for details.
+
+# hal_add_bundle(<target> OUTPUT <file> [BASE_DIR <dir>] MODULES <file>...)
+#
+# Adds a target that builds a HAL::JSBundle from UTF-8 module files
+# with the BuildBundle tool. A module's id is its path relative to
+# BASE_DIR, which defaults to the current source directory, without
+# its .js extension.
+include(CMakeParseArguments)
+
+function(hal_add_bundle target)
+  cmake_parse_arguments(HAL_BUNDLE "" "OUTPUT;BASE_DIR" "MODULES" ${ARGN})
+  if (NOT HAL_BUNDLE_OUTPUT)
+    message(FATAL_ERROR "hal_add_bundle(${target}) needs an OUTPUT")
+  endif()
+  if (NOT HAL_BUNDLE_BASE_DIR)
+    set(HAL_BUNDLE_BASE_DIR ${CMAKE_CURRENT_SOURCE_DIR})
+  endif()
+
+  set(arguments)
+  set(paths)
+  foreach(module ${HAL_BUNDLE_MODULES})
+    if (IS_ABSOLUTE ${module})
+      set(path ${module})
+    else()
+      set(path ${HAL_BUNDLE_BASE_DIR}/${module})
+    endif()
+    file(RELATIVE_PATH id ${HAL_BUNDLE_BASE_DIR} ${path})
+    string(REGEX REPLACE "\\.js$" "" id ${id})
+    list(APPEND arguments "${id}=${path}")
+    list(APPEND paths ${path})
+  endforeach()
+
+  add_custom_command(
+    OUTPUT  ${HAL_BUNDLE_OUTPUT}
+    COMMAND BuildBundle ${HAL_BUNDLE_OUTPUT} ${arguments}
+    DEPENDS BuildBundle ${paths}
+    COMMENT "Building HAL bundle ${HAL_BUNDLE_OUTPUT}"
+    VERBATIM
+    )
+  add_custom_target(${target} DEPENDS ${HAL_BUNDLE_OUTPUT})
+endfunction()
@@ -0,0 +1,44 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "ArgumentsWidget.hpp"
+
+#include <string>
+
+ArgumentsWidget::ArgumentsWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context) {
+  HAL_LOG_DEBUG("ArgumentsWidget:: ctor ", this);
+}
+
+ArgumentsWidget::~ArgumentsWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("ArgumentsWidget:: dtor ", this);
+}
+
+void ArgumentsWidget::JSExportInitialize() {
+  JSExport<ArgumentsWidget>::SetClassVersion(1);
+  JSExport<ArgumentsWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<ArgumentsWidget>::AddFunctionProperty("count", [](ArgumentsWidget& widget, const JSArguments& arguments, JSObject&) {
+    return widget.get_context().CreateNumber(static_cast<double>(arguments.size()));
+  });
+  JSExport<ArgumentsWidget>::AddFunctionProperty("sum", [](ArgumentsWidget& widget, const JSArguments& arguments, JSObject&) {
+    return widget.get_context().CreateNumber(arguments.ToNumber(0) + arguments.ToInt32(1));
+  });
+  JSExport<ArgumentsWidget>::AddFunctionProperty("describe", [](ArgumentsWidget& widget, const JSArguments& arguments, JSObject&) {
+    const std::string description = static_cast<std::string>(arguments.ToJSString(0))
+        + (arguments.ToBoolean(1) ? ":yes" : ":no")
+        + (arguments[2].IsUndefined() ? ":missing" : ":present");
+    return widget.get_context().CreateString(description);
+  });
+  JSExport<ArgumentsWidget>::AddFunctionProperty("first", [](ArgumentsWidget&, const JSArguments& arguments, JSObject&) {
+    return arguments.ToJSValue(0);
+  });
+  JSExport<ArgumentsWidget>::AddFunctionProperty("fail", [](ArgumentsWidget& widget, const JSArguments& arguments, JSObject&) {
+    arguments.SetError("fail called with " + std::to_string(arguments.size()) + " arguments");
+    return widget.get_context().CreateUndefined();
+  });
+}
@@ -0,0 +1,36 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_ARGUMENTSWIDGET_HPP_
+#define _HAL_EXAMPLES_ARGUMENTSWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object whose function
+ properties read their arguments through a JSArguments view. count
+ returns the number of arguments, sum adds the first as a number to
+ the second as an int32, describe joins the first as a string, the
+ second as a boolean and whether a third was passed, first returns
+ the first argument itself and fail reports an Error.
+ */
+class ArgumentsWidget : public JSExportObject, public JSExport<ArgumentsWidget> {
+  
+public:
+  
+  ArgumentsWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~ArgumentsWidget() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+};
+
+#endif // _HAL_EXAMPLES_ARGUMENTSWIDGET_HPP_
@@ -0,0 +1,51 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "BoundWidget.hpp"
+
+BoundWidget::BoundWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context)
+, name__("world")
+, ticks__(0) {
+  HAL_LOG_DEBUG("BoundWidget:: ctor ", this);
+}
+
+BoundWidget::~BoundWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("BoundWidget:: dtor ", this);
+}
+
+JSValue BoundWidget::js_get_name() const {
+  return get_context().CreateString(name__);
+}
+
+bool BoundWidget::js_set_name(const JSValue& value) {
+  name__ = static_cast<std::string>(value);
+  return true;
+}
+
+JSValue BoundWidget::js_get_ticks() {
+  return get_context().CreateNumber(++ticks__);
+}
+
+JSValue BoundWidget::js_greet(const std::vector<JSValue>& arguments, JSObject& this_object) {
+  const std::string greeting = arguments.empty() ? "hello" : static_cast<std::string>(arguments.at(0));
+  return get_context().CreateString(greeting + " " + name__);
+}
+
+JSValue BoundWidget::js_scale(const JSArguments& arguments, JSObject& this_object) {
+  return get_context().CreateNumber(arguments.ToNumber(0) * arguments.ToNumber(1));
+}
+
+void BoundWidget::JSExportInitialize() {
+  JSExport<BoundWidget>::SetClassVersion(1);
+  JSExport<BoundWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<BoundWidget>::AddValueProperty<&BoundWidget::js_get_name, &BoundWidget::js_set_name>("name");
+  JSExport<BoundWidget>::AddValueProperty<&BoundWidget::js_get_ticks>("ticks");
+  JSExport<BoundWidget>::AddFunctionProperty<&BoundWidget::js_greet>("greet");
+  JSExport<BoundWidget>::AddFunctionProperty<&BoundWidget::js_scale>("scale");
+}
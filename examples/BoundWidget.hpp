@@ -0,0 +1,47 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_BOUNDWIDGET_HPP_
+#define _HAL_EXAMPLES_BOUNDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <string>
+#include <vector>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object whose
+ properties are bound directly to member function pointers. name can
+ be read and written, ticks counts its own reads, greet takes a
+ vector of arguments and scale a JSArguments view.
+ */
+class BoundWidget : public JSExportObject, public JSExport<BoundWidget> {
+  
+public:
+  
+  BoundWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~BoundWidget() HAL_NOEXCEPT;
+  
+  JSValue js_get_name() const;
+  bool    js_set_name(const JSValue& value);
+  JSValue js_get_ticks();
+  JSValue js_greet(const std::vector<JSValue>& arguments, JSObject& this_object);
+  JSValue js_scale(const JSArguments& arguments, JSObject& this_object);
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  std::string name__;
+  double      ticks__;
+};
+
+#endif // _HAL_EXAMPLES_BOUNDWIDGET_HPP_
@@ -0,0 +1,54 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSBundle.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Write the UTF-8 module files named on the command line into one
+// bundle for HAL::JSBundle. Each module is an id=path pair, or a path
+// that is also its id.
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " bundle.halb [id=]module.js..." << std::endl;
+    return 2;
+  }
+  
+  std::vector<std::pair<std::string, std::string>> modules;
+  for (int i = 2; i < argc; ++i) {
+    const std::string argument(argv[i]);
+    const auto separator = argument.find('=');
+    const auto id        = separator == std::string::npos ? argument : argument.substr(0, separator);
+    const auto path      = separator == std::string::npos ? argument : argument.substr(separator + 1);
+    
+    std::ifstream input(path, std::ios_base::binary | std::ios_base::in);
+    if (!input.is_open()) {
+      std::cerr << argv[0] << ": Unable to open " << path << std::endl;
+      return 1;
+    }
+    
+    std::ostringstream source;
+    source << input.rdbuf();
+    modules.emplace_back(id, source.str());
+  }
+  
+  try {
+    HAL::JSBundle::Write(argv[1], modules);
+  } catch (const std::exception& e) {
+    std::cerr << argv[0] << ": " << argv[1] << ": " << e.what() << std::endl;
+    return 1;
+  }
+  
+  return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "CachedWidget.hpp"
+
+#include <algorithm>
+#include <functional>
+
+CachedWidget::CachedWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context)
+, width__(2)
+, height__(3)
+, area_count__(0)
+, batch_count__(0)
+, batch_limit__(static_cast<std::size_t>(-1)) {
+  HAL_LOG_DEBUG("CachedWidget:: ctor ", this);
+}
+
+CachedWidget::~CachedWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("CachedWidget:: dtor ", this);
+}
+
+void CachedWidget::JSExportInitialize() {
+  JSExport<CachedWidget>::SetClassVersion(1);
+  JSExport<CachedWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<CachedWidget>::SetTrackDirty(true);
+  JSExport<CachedWidget>::AddCachedValueProperty("area", std::mem_fn(&CachedWidget::js_get_area));
+  JSExport<CachedWidget>::AddCachedValueProperty("width", std::mem_fn(&CachedWidget::js_get_width), std::mem_fn(&CachedWidget::js_set_width));
+  JSExport<CachedWidget>::AddFunctionProperty("resize", std::mem_fn(&CachedWidget::js_resize));
+  JSExport<CachedWidget>::AddToJSONCallback(std::mem_fn(&CachedWidget::ToJSON));
+  JSExport<CachedWidget>::AddConvertToTypePrimitiveCallback(std::mem_fn(&CachedWidget::ConvertToType));
+  JSExport<CachedWidget>::AddIterator([](CachedWidget&) -> std::size_t { return 0; }, std::mem_fn(&CachedWidget::NextCells), 4);
+}
+
+JSValue CachedWidget::js_get_area() const {
+  ++area_count__;
+  return get_context().CreateNumber(width__ * height__);
+}
+
+JSValue CachedWidget::js_get_width() const {
+  return get_context().CreateNumber(width__);
+}
+
+// The area depends on the width, so it is invalidated here, while the
+// cached width is invalidated by HAL.
+bool CachedWidget::js_set_width(const JSValue& width) {
+  width__ = static_cast<double>(width);
+  JSExport<CachedWidget>::Invalidate("area");
+  return true;
+}
+
+// Serializes the fields directly, so JSON.stringify doesn't read the
+// properties and never calls the getter of "area".
+void CachedWidget::ToJSON(JSStringBuilder& json) const {
+  json.Append("{\"width\":").AppendJSONNumber(width__);
+  json.Append(",\"height\":").AppendJSONNumber(height__);
+  json.Append(",\"area\":").AppendJSONNumber(width__ * height__).Append("}");
+}
+
+// Converts to its area as a number, without calling the getter of
+// "area", and forwards the conversion to a string.
+detail::JSExportPrimitive CachedWidget::ConvertToType(JSValue::Type type, const JSObjectView& this_object) const {
+  if (type == JSValue::Type::Number) {
+    return detail::JSExportPrimitive::Number(width__ * height__);
+  }
+  return detail::JSExportPrimitive::Forward();
+}
+
+bool CachedWidget::NextCells(std::size_t& cell, std::vector<JSValue>& batch, std::size_t batch_size) {
+  ++batch_count__;
+  const auto cell_count = static_cast<std::size_t>(width__ * height__);
+  const auto limit = std::min(batch_size, batch_limit__);
+  for (; cell < cell_count && batch.size() < limit; ++cell) {
+    batch.push_back(get_context().CreateNumber(static_cast<double>(cell)));
+  }
+  return cell < cell_count;
+}
+
+JSValue CachedWidget::js_resize(const std::vector<JSValue>& arguments, JSObject& this_object) {
+  if (arguments.size() == 2) {
+    width__  = static_cast<double>(arguments[0]);
+    height__ = static_cast<double>(arguments[1]);
+    JSExport<CachedWidget>::InvalidateAll();
+  }
+  return get_context().CreateUndefined();
+}
@@ -0,0 +1,69 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_CACHEDWIDGET_HPP_
+#define _HAL_EXAMPLES_CACHEDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a value property that is expensive
+ to compute, and so is cached until the native object changes it. It
+ is also iterable, yielding the index of each of its cells a batch at
+ a time, and tracks JavaScript writes to its properties.
+ */
+class CachedWidget : public JSExportObject, public JSExport<CachedWidget> {
+  
+public:
+  
+  CachedWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~CachedWidget() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+  
+  // The number of times the getter of "area" was called.
+  std::uint32_t get_area_count() const HAL_NOEXCEPT {
+    return area_count__;
+  }
+  
+  // The number of batches the iterator asked for.
+  std::uint32_t get_batch_count() const HAL_NOEXCEPT {
+    return batch_count__;
+  }
+  
+  // The most cells NextCells appends to a batch, which may be fewer
+  // than the batch size the iterator asks for.
+  void set_batch_limit(std::size_t batch_limit) HAL_NOEXCEPT {
+    batch_limit__ = batch_limit;
+  }
+  
+  JSValue js_get_area() const;
+  bool    js_set_width(const JSValue& width);
+  JSValue js_get_width() const;
+  JSValue js_resize(const std::vector<JSValue>& arguments, JSObject& this_object);
+  void    ToJSON(JSStringBuilder& json) const;
+  detail::JSExportPrimitive ConvertToType(JSValue::Type type, const JSObjectView& this_object) const;
+  bool    NextCells(std::size_t& cell, std::vector<JSValue>& batch, std::size_t batch_size);
+  
+private:
+  
+  double                width__;
+  double                height__;
+  mutable std::uint32_t area_count__;
+  std::uint32_t         batch_count__;
+  std::size_t           batch_limit__;
+};
+
+#endif // _HAL_EXAMPLES_CACHEDWIDGET_HPP_
@@ -15,6 +15,9 @@
 
 using namespace HAL;
 
+class ChildWidget;
+HAL_JSEXPORT_CLASS_NAME(ChildWidget, "ChildWidget")
+
 /*!
  @class
  
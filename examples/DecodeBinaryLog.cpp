@@ -0,0 +1,41 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSBinaryLogger.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Write the binary logs named on the command line, such as the
+// HAL.binlog of a build with -DHAL_LOGGING_BINARY_ENABLE=1, as text.
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " HAL.binlog..." << std::endl;
+    return 2;
+  }
+  
+  int status = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::ifstream input(argv[i], std::ios_base::binary | std::ios_base::in);
+    if (!input.is_open()) {
+      std::cerr << argv[0] << ": Unable to open " << argv[i] << std::endl;
+      status = 1;
+      continue;
+    }
+    
+    try {
+      HAL::detail::DecodeJSBinaryLog(input, std::cout);
+    } catch (const std::runtime_error& e) {
+      std::cerr << argv[0] << ": " << argv[i] << ": " << e.what() << std::endl;
+      status = 1;
+    }
+  }
+  
+  return status;
+}
@@ -0,0 +1,31 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "DeferredWidget.hpp"
+
+std::size_t DeferredWidget::destroyed_count__ { 0 };
+
+DeferredWidget::DeferredWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context) {
+  HAL_LOG_DEBUG("DeferredWidget:: ctor ", this);
+}
+
+DeferredWidget::~DeferredWidget() HAL_NOEXCEPT {
+  ++destroyed_count__;
+  HAL_LOG_DEBUG("DeferredWidget:: dtor ", this);
+}
+
+std::size_t DeferredWidget::get_destroyed_count() HAL_NOEXCEPT {
+  return destroyed_count__;
+}
+
+void DeferredWidget::JSExportInitialize() {
+  JSExport<DeferredWidget>::SetClassVersion(1);
+  JSExport<DeferredWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<DeferredWidget>::SetDeferredFinalization(true);
+}
@@ -0,0 +1,42 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_DEFERREDWIDGET_HPP_
+#define _HAL_EXAMPLES_DEFERREDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <cstddef>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object with deferred
+ finalization, whose native objects are destroyed by
+ JSExportFinalizer::RunPending rather than by the garbage collection
+ that finalized them. get_destroyed_count tells how many have been
+ destroyed.
+ */
+class DeferredWidget : public JSExportObject, public JSExport<DeferredWidget> {
+  
+public:
+  
+  DeferredWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~DeferredWidget() HAL_NOEXCEPT;
+  
+  static std::size_t get_destroyed_count() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  static std::size_t destroyed_count__;
+};
+
+#endif // _HAL_EXAMPLES_DEFERREDWIDGET_HPP_
@@ -0,0 +1,23 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "FlatCachedWidget.hpp"
+
+FlatCachedWidget::FlatCachedWidget(const JSContext& js_context) HAL_NOEXCEPT
+: CachedWidget(js_context) {
+  HAL_LOG_DEBUG("FlatCachedWidget:: ctor ", this);
+}
+
+FlatCachedWidget::~FlatCachedWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("FlatCachedWidget:: dtor ", this);
+}
+
+void FlatCachedWidget::JSExportInitialize() {
+  JSExport<FlatCachedWidget>::SetClassVersion(1);
+  JSExport<FlatCachedWidget>::SetFlattenedParent(JSExport<CachedWidget>::Class());
+}
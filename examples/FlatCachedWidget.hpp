@@ -0,0 +1,34 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_FLATCACHEDWIDGET_HPP_
+#define _HAL_EXAMPLES_FLATCACHEDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include "CachedWidget.hpp"
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object whose JSClass
+ inherits the cached value properties of its parent's JSClass, which
+ the parent still invalidates itself.
+ */
+class FlatCachedWidget : public CachedWidget, public JSExport<FlatCachedWidget> {
+  
+public:
+  
+  FlatCachedWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~FlatCachedWidget() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+};
+
+#endif // _HAL_EXAMPLES_FLATCACHEDWIDGET_HPP_
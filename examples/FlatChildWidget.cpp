@@ -0,0 +1,51 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "FlatChildWidget.hpp"
+
+#include <functional>
+#include <vector>
+
+FlatChildWidget::FlatChildWidget(const JSContext& js_context) HAL_NOEXCEPT
+: Widget(js_context) {
+  HAL_LOG_DEBUG("FlatChildWidget:: ctor ", this);
+}
+
+FlatChildWidget::FlatChildWidget(const JSContext& js_context, const JSArguments& arguments)
+: Widget(js_context) {
+  HAL_LOG_DEBUG("FlatChildWidget:: ctor with arguments ", this);
+  if (arguments.size() >= 1) {
+    set_name(static_cast<std::string>(arguments.ToJSString(0)));
+  }
+  
+  if (arguments.size() >= 2) {
+    set_number(arguments.ToInt32(1));
+  }
+}
+
+FlatChildWidget::~FlatChildWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("FlatChildWidget:: dtor ", this);
+}
+
+void FlatChildWidget::postInitialize(JSObject& js_object) {
+  HAL_LOG_DEBUG("FlatChildWidget:: postInitialize ", this);
+}
+
+void FlatChildWidget::postCallAsConstructor(const JSContext& js_context, const std::vector<JSValue>& arguments) {
+  HAL_LOG_DEBUG("FlatChildWidget:: postCallAsConstructor ", this);
+}
+
+void FlatChildWidget::JSExportInitialize() {
+  JSExport<FlatChildWidget>::SetClassVersion(1);
+  JSExport<FlatChildWidget>::SetFlattenedParent(JSExport<Widget>::Class());
+  JSExport<FlatChildWidget>::AddValueProperty("my_name", std::mem_fn(&FlatChildWidget::js_get_my_name));
+}
+
+JSValue FlatChildWidget::js_get_my_name() const HAL_NOEXCEPT {
+  return get_context().CreateString("flat child widget");
+}
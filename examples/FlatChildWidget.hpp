@@ -0,0 +1,49 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_FLATCHILDWIDGET_HPP_
+#define _HAL_EXAMPLES_FLATCHILDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <string>
+#include "Widget.hpp"
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object whose JSClass
+ inherits the properties of its parent's JSClass instead of
+ delegating to it.
+ */
+class FlatChildWidget : public Widget, public JSExport<FlatChildWidget> {
+  
+public:
+  
+  FlatChildWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  
+  /*!
+   @method
+   
+   @abstract This is the constructor used for a JavaScript 'new'
+   expression, which receives the expression's arguments directly
+   instead of through postCallAsConstructor.
+   */
+  FlatChildWidget(const JSContext& js_context, const JSArguments& arguments);
+  virtual ~FlatChildWidget() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+  
+  virtual void postInitialize(JSObject& js_object) override;
+  virtual void postCallAsConstructor(const JSContext& js_context, const std::vector<JSValue>& arguments) override;
+  
+  JSValue js_get_my_name() const HAL_NOEXCEPT;
+};
+
+#endif // _HAL_EXAMPLES_FLATCHILDWIDGET_HPP_
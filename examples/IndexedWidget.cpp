@@ -0,0 +1,46 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "IndexedWidget.hpp"
+
+IndexedWidget::IndexedWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context)
+, items__({0, 10, 20, 30}) {
+  HAL_LOG_DEBUG("IndexedWidget:: ctor ", this);
+}
+
+IndexedWidget::~IndexedWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("IndexedWidget:: dtor ", this);
+}
+
+JSValue IndexedWidget::GetIndexedProperty(std::uint32_t index) const {
+  if (index >= items__.size()) {
+    return get_context().CreateNativeNull();
+  }
+  return get_context().CreateNumber(items__[index]);
+}
+
+bool IndexedWidget::SetIndexedProperty(std::uint32_t index, const JSValue& value) {
+  if (index >= items__.size()) {
+    return false;
+  }
+  items__[index] = static_cast<double>(value);
+  return true;
+}
+
+JSValue IndexedWidget::js_get_length() const {
+  return get_context().CreateNumber(static_cast<double>(items__.size()));
+}
+
+void IndexedWidget::JSExportInitialize() {
+  JSExport<IndexedWidget>::SetClassVersion(1);
+  JSExport<IndexedWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<IndexedWidget>::AddGetIndexedPropertyCallback(std::mem_fn(&IndexedWidget::GetIndexedProperty));
+  JSExport<IndexedWidget>::AddSetIndexedPropertyCallback(std::mem_fn(&IndexedWidget::SetIndexedProperty));
+  JSExport<IndexedWidget>::AddValueProperty("length", std::mem_fn(&IndexedWidget::js_get_length));
+}
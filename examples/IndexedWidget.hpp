@@ -0,0 +1,45 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_INDEXEDWIDGET_HPP_
+#define _HAL_EXAMPLES_INDEXEDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <cstdint>
+#include <vector>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of an array-like JavaScript object
+ whose elements are read and written through the indexed property
+ callbacks. It holds length numbers, initially 0, 10, 20 and 30.
+ Indexes past the end are declined, so they become ordinary
+ properties of the JavaScript object.
+ */
+class IndexedWidget : public JSExportObject, public JSExport<IndexedWidget> {
+  
+public:
+  
+  IndexedWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~IndexedWidget() HAL_NOEXCEPT;
+  
+  JSValue GetIndexedProperty(std::uint32_t index) const;
+  bool    SetIndexedProperty(std::uint32_t index, const JSValue& value);
+  JSValue js_get_length() const;
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  std::vector<double> items__;
+};
+
+#endif // _HAL_EXAMPLES_INDEXEDWIDGET_HPP_
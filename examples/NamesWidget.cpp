@@ -0,0 +1,59 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "NamesWidget.hpp"
+
+#include <vector>
+
+NamesWidget::NamesWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context)
+, values__({
+  {"alpha", 1}, {"beta", 2}, {"gamma", 3}, {"\xCE\xB4" "elta", 4}, {"epsilon", 5},
+  {"\xC3\xB1" "u", 6}, {"zeta", 7}, {"eta", 8}, {"theta", 9}, {"iota", 10}, {"kappa", 11}
+}) {
+  HAL_LOG_DEBUG("NamesWidget:: ctor ", this);
+}
+
+NamesWidget::~NamesWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("NamesWidget:: dtor ", this);
+}
+
+JSValue NamesWidget::GetProperty(const JSString& property_name) const {
+  const auto position = values__.find(static_cast<std::string>(property_name));
+  if (position == values__.end()) {
+    return get_context().CreateNativeNull();
+  }
+  return get_context().CreateNumber(position -> second);
+}
+
+void NamesWidget::GetPropertyNames(JSPropertyNameAccumulator& accumulator) const {
+  // The names with a length aren't NUL-terminated and are followed by
+  // a character that isn't part of them.
+  static const char     beta[]    = { 'b', 'e', 't', 'a', '_' };
+  static const char     enye[]    = { '\xC3', '\xB1', 'u', '_' };
+  static const char16_t epsilon[] = u"epsilon_";
+  static const char*    iota[]    = { "iota", "kappa" };
+  static const std::vector<std::string> zeta = { "zeta", "eta" };
+  
+  accumulator.AddName("alpha");
+  accumulator.AddName(beta, 4);
+  accumulator.AddName(std::string("gamma"));
+  accumulator.AddName(std::u16string(u"\u03B4elta"));
+  accumulator.AddName(epsilon, 7);
+  accumulator.AddName(enye, 3);
+  accumulator.AddNames(zeta);
+  accumulator.AddName(JSString("theta"));
+  accumulator.AddNames(std::begin(iota), std::end(iota));
+}
+
+void NamesWidget::JSExportInitialize() {
+  JSExport<NamesWidget>::SetClassVersion(1);
+  JSExport<NamesWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<NamesWidget>::AddGetPropertyCallback(std::mem_fn(&NamesWidget::GetProperty));
+  JSExport<NamesWidget>::AddGetPropertyNamesCallback(std::mem_fn(&NamesWidget::GetPropertyNames));
+}
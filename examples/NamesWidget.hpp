@@ -0,0 +1,45 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_NAMESWIDGET_HPP_
+#define _HAL_EXAMPLES_NAMESWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <string>
+#include <unordered_map>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object backed by a
+ native collection, whose keys are enumerated by a GetPropertyNames
+ callback that adds them with each of the JSPropertyNameAccumulator
+ overloads. Each key reads as its position in the collection,
+ counting from 1.
+ */
+class NamesWidget : public JSExportObject, public JSExport<NamesWidget> {
+  
+public:
+  
+  NamesWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~NamesWidget() HAL_NOEXCEPT;
+  
+  JSValue GetProperty(const JSString& property_name) const;
+  void    GetPropertyNames(JSPropertyNameAccumulator& accumulator) const;
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  // The value of each key, by its UTF-8 name.
+  std::unordered_map<std::string, double> values__;
+};
+
+#endif // _HAL_EXAMPLES_NAMESWIDGET_HPP_
@@ -8,6 +8,12 @@
 
 #include "OtherWidget.hpp"
 
+#include <atomic>
+
+namespace {
+  std::atomic<std::size_t> has_property_count { 0 };
+}
+
 OtherWidget::OtherWidget(const JSContext& js_context) HAL_NOEXCEPT
 : JSExportObject(js_context) {
   HAL_LOG_DEBUG("OtherWidget:: ctor ", this);
@@ -62,7 +68,17 @@ void OtherWidget::JSExportInitialize() {
   JSExport<OtherWidget>::AddConstantProperty("CONST4", std::mem_fn(&OtherWidget::js_get_CONST4));
   JSExport<OtherWidget>::AddConstantProperty("CONST5", std::mem_fn(&OtherWidget::js_get_CONST5));
   JSExport<OtherWidget>::AddConstantProperty("CONST6", std::mem_fn(&OtherWidget::js_get_CONST6));
+  JSExport<OtherWidget>::AddHasPropertyCallback(std::mem_fn(&OtherWidget::HasProperty));
+  JSExport<OtherWidget>::SetNegativePropertyCache(16);
+}
+
+bool OtherWidget::HasProperty(const JSString&) const HAL_NOEXCEPT {
+  has_property_count.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
 
+std::size_t OtherWidget::get_has_property_count() HAL_NOEXCEPT {
+  return has_property_count.load(std::memory_order_relaxed);
 }
 
 JSValue OtherWidget::js_get_CONST1() HAL_NOEXCEPT {
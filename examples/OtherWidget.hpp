@@ -10,10 +10,14 @@
 #define _HAL_EXAMPLES_OTHERWIDGET_HPP_
 
 #include "HAL/HAL.hpp"
+#include <cstddef>
 #include <string>
 
 using namespace HAL;
 
+class OtherWidget;
+HAL_JSEXPORT_CLASS_NAME(OtherWidget, "OtherWidget")
+
 /*!
  @class
  
@@ -67,6 +71,11 @@ public:
   JSValue js_get_CONST4() HAL_NOEXCEPT;
   JSValue js_get_CONST5() HAL_NOEXCEPT;
   JSValue js_get_CONST6() HAL_NOEXCEPT;
+  
+  // OtherWidget has no dynamic properties. The probes it answers are
+  // counted, to show those answered by the negative property cache.
+  bool HasProperty(const JSString& property_name) const HAL_NOEXCEPT;
+  static std::size_t get_has_property_count() HAL_NOEXCEPT;
 
 private:
   
@@ -0,0 +1,36 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "PinnedWidget.hpp"
+
+std::size_t PinnedWidget::answer_count__ { 0 };
+
+PinnedWidget::PinnedWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context) {
+  HAL_LOG_DEBUG("PinnedWidget:: ctor ", this);
+}
+
+PinnedWidget::~PinnedWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("PinnedWidget:: dtor ", this);
+}
+
+JSValue PinnedWidget::js_get_answer() const {
+  ++answer_count__;
+  return get_context().CreateNumber(42);
+}
+
+std::size_t PinnedWidget::get_answer_count() HAL_NOEXCEPT {
+  return answer_count__;
+}
+
+void PinnedWidget::JSExportInitialize() {
+  JSExport<PinnedWidget>::SetClassVersion(1);
+  JSExport<PinnedWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<PinnedWidget>::SetPinConstants(true);
+  JSExport<PinnedWidget>::AddConstantProperty("answer", std::mem_fn(&PinnedWidget::js_get_answer));
+}
@@ -0,0 +1,44 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_PINNEDWIDGET_HPP_
+#define _HAL_EXAMPLES_PINNEDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <cstddef>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object whose constant
+ properties are pinned, so that they are evaluated once per JSContext
+ and stored as read-only data properties of its prototype. The
+ constant answer is 42, and get_answer_count tells how many times it
+ was evaluated.
+ */
+class PinnedWidget : public JSExportObject, public JSExport<PinnedWidget> {
+  
+public:
+  
+  PinnedWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~PinnedWidget() HAL_NOEXCEPT;
+  
+  JSValue js_get_answer() const;
+  
+  static std::size_t get_answer_count() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  static std::size_t answer_count__;
+};
+
+#endif // _HAL_EXAMPLES_PINNEDWIDGET_HPP_
@@ -0,0 +1,58 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "RecycledWidget.hpp"
+
+std::size_t RecycledWidget::constructed_count__ { 0 };
+std::size_t RecycledWidget::recycled_count__    { 0 };
+std::size_t RecycledWidget::destroyed_count__   { 0 };
+
+RecycledWidget::RecycledWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context)
+, value__(0) {
+  ++constructed_count__;
+  HAL_LOG_DEBUG("RecycledWidget:: ctor ", this);
+}
+
+RecycledWidget::~RecycledWidget() HAL_NOEXCEPT {
+  ++destroyed_count__;
+  HAL_LOG_DEBUG("RecycledWidget:: dtor ", this);
+}
+
+void RecycledWidget::Recycle() {
+  value__ = 0;
+  ++recycled_count__;
+}
+
+JSValue RecycledWidget::js_get_value() const {
+  return get_context().CreateNumber(value__);
+}
+
+bool RecycledWidget::js_set_value(const JSValue& value) {
+  value__ = static_cast<double>(value);
+  return true;
+}
+
+std::size_t RecycledWidget::get_constructed_count() HAL_NOEXCEPT {
+  return constructed_count__;
+}
+
+std::size_t RecycledWidget::get_recycled_count() HAL_NOEXCEPT {
+  return recycled_count__;
+}
+
+std::size_t RecycledWidget::get_destroyed_count() HAL_NOEXCEPT {
+  return destroyed_count__;
+}
+
+void RecycledWidget::JSExportInitialize() {
+  JSExport<RecycledWidget>::SetClassVersion(1);
+  JSExport<RecycledWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<RecycledWidget>::SetRecycleCapacity(kRecycleCapacity);
+  JSExport<RecycledWidget>::AddValueProperty("value", std::mem_fn(&RecycledWidget::js_get_value), std::mem_fn(&RecycledWidget::js_set_value));
+}
@@ -0,0 +1,55 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_RECYCLEDWIDGET_HPP_
+#define _HAL_EXAMPLES_RECYCLEDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <cstddef>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object whose native
+ objects are recycled once finalized, and reused for new JavaScript
+ objects instead of being destroyed. Recycle resets value to 0. The
+ static counts tell how many native objects have been constructed,
+ recycled and destroyed.
+ */
+class RecycledWidget : public JSExportObject, public JSExport<RecycledWidget> {
+  
+public:
+  
+  static const std::size_t kRecycleCapacity = 4;
+  
+  RecycledWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~RecycledWidget() HAL_NOEXCEPT;
+  
+  void Recycle();
+  
+  JSValue js_get_value() const;
+  bool    js_set_value(const JSValue& value);
+  
+  static std::size_t get_constructed_count() HAL_NOEXCEPT;
+  static std::size_t get_recycled_count() HAL_NOEXCEPT;
+  static std::size_t get_destroyed_count() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  double value__;
+  
+  static std::size_t constructed_count__;
+  static std::size_t recycled_count__;
+  static std::size_t destroyed_count__;
+};
+
+#endif // _HAL_EXAMPLES_RECYCLEDWIDGET_HPP_
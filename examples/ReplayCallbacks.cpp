@@ -0,0 +1,101 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/HAL.hpp"
+#include "Widget.hpp"
+#include "ChildWidget.hpp"
+#include "OtherWidget.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+
+  const char* ToString(HAL::JSCallbackRecordKind kind) {
+    using HAL::JSCallbackRecordKind;
+    switch (kind) {
+      case JSCallbackRecordKind::GetNamedValueProperty: return "GetNamedValueProperty";
+      case JSCallbackRecordKind::SetNamedValueProperty: return "SetNamedValueProperty";
+      case JSCallbackRecordKind::CallNamedFunction:     return "CallNamedFunction";
+      case JSCallbackRecordKind::CallAsFunction:        return "CallAsFunction";
+      case JSCallbackRecordKind::CallAsConstructor:     return "CallAsConstructor";
+      case JSCallbackRecordKind::ConvertToType:         return "ConvertToType";
+    }
+    return "Unknown";
+  }
+
+} // namespace {
+
+// Replay the callback recording named on the command line, such as one
+// written by JSCallbackRecorder::WriteBinary in a build with
+// -DHAL_CALLBACK_RECORD_ENABLE=1, on new objects of the example
+// classes, and compare the recorded and replayed time of each callback.
+int main(int argc, const char* argv[]) {
+  using namespace HAL;
+  if (argc != 2) {
+    std::cerr << "usage: " << argv[0] << " HAL.cbrec" << std::endl;
+    return 2;
+  }
+
+  std::ifstream input(argv[1], std::ios_base::binary | std::ios_base::in);
+  if (!input.is_open()) {
+    std::cerr << argv[0] << ": Unable to open " << argv[1] << std::endl;
+    return 1;
+  }
+  const std::string recording((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+  try {
+    const auto records = JSCallbackRecorder::ParseBinary(recording);
+
+    // The recorded class names are the ones the classes were built
+    // with, which are their JSExportClassNames unless they set another.
+    JSExportRegistry::Register<Widget>(JSExportClassName<Widget>::get());
+    JSExportRegistry::Register<ChildWidget>(JSExportClassName<ChildWidget>::get());
+    JSExportRegistry::Register<OtherWidget>(JSExportClassName<OtherWidget>::get());
+
+    JSContextGroup js_context_group;
+    JSContext js_context = js_context_group.CreateContext();
+    JSExportRegistry::Install(js_context);
+    const auto durations = JSCallbackRecorder::Replay(js_context, records);
+
+    struct Total {
+      std::size_t   count;
+      std::size_t   skipped;
+      std::uint64_t recorded_nanoseconds;
+      std::uint64_t replayed_nanoseconds;
+    };
+    std::map<std::tuple<std::string, std::string, std::string>, Total> totals;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      const auto& record = records[i];
+      auto& total = totals[std::make_tuple(record.class_name, std::string(ToString(record.kind)), record.property_name)];
+      ++total.count;
+      if (durations[i] == 0) {
+        ++total.skipped;
+        continue;
+      }
+      total.recorded_nanoseconds += record.duration_nanoseconds;
+      total.replayed_nanoseconds += durations[i];
+    }
+
+    std::cout << "class\tcallback\tproperty\tcount\tskipped\trecorded_ns\treplayed_ns" << std::endl;
+    for (const auto& entry : totals) {
+      const auto& total = entry.second;
+      std::cout << std::get<0>(entry.first) << "\t" << std::get<1>(entry.first) << "\t" << std::get<2>(entry.first)
+                << "\t" << total.count << "\t" << total.skipped << "\t" << total.recorded_nanoseconds << "\t" << total.replayed_nanoseconds << std::endl;
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << argv[0] << ": " << argv[1] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,35 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "SharedWidget.hpp"
+
+#include <functional>
+
+SharedWidget::SharedWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportSharedObject<WidgetCatalog>(js_context) {
+  HAL_LOG_DEBUG("SharedWidget:: ctor ", this);
+}
+
+SharedWidget::~SharedWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("SharedWidget:: dtor ", this);
+}
+
+void SharedWidget::JSExportInitialize() {
+  JSExport<SharedWidget>::SetClassVersion(1);
+  JSExport<SharedWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<SharedWidget>::AddValueProperty("name", std::mem_fn(&SharedWidget::js_get_name));
+  JSExport<SharedWidget>::AddValueProperty("number", std::mem_fn(&SharedWidget::js_get_number));
+}
+
+JSValue SharedWidget::js_get_name() const {
+  return get_context().CreateString(get_shared().name);
+}
+
+JSValue SharedWidget::js_get_number() const {
+  return get_context().CreateNumber(get_shared().number);
+}
@@ -0,0 +1,47 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_SHAREDWIDGET_HPP_
+#define _HAL_EXAMPLES_SHAREDWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <cstdint>
+#include <string>
+
+using namespace HAL;
+
+/*!
+ @struct
+ 
+ @discussion The read-only data shared by every SharedWidget.
+ */
+struct WidgetCatalog {
+  std::string  name;
+  std::int32_t number;
+};
+
+/*!
+ @class
+ 
+ @discussion This is an example of JavaScript objects in any number
+ of contexts that read one shared native object.
+ */
+class SharedWidget : public JSExportSharedObject<WidgetCatalog>, public JSExport<SharedWidget> {
+  
+public:
+  
+  SharedWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~SharedWidget() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+  
+  JSValue js_get_name() const;
+  JSValue js_get_number() const;
+};
+
+#endif // _HAL_EXAMPLES_SHAREDWIDGET_HPP_
@@ -0,0 +1,66 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "StaticWidget.hpp"
+
+StaticWidget::StaticWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context)
+, label__("static") {
+  HAL_LOG_DEBUG("StaticWidget:: ctor ", this);
+}
+
+StaticWidget::~StaticWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("StaticWidget:: dtor ", this);
+}
+
+JSValue StaticWidget::js_get_label() const {
+  return get_context().CreateString(label__);
+}
+
+bool StaticWidget::js_set_label(const JSValue& value) {
+  label__ = static_cast<std::string>(value);
+  return true;
+}
+
+JSValue StaticWidget::js_get_version() const {
+  return get_context().CreateNumber(2);
+}
+
+JSValue StaticWidget::js_join(const std::vector<JSValue>& arguments, JSObject& this_object) {
+  std::string result = label__;
+  for (const auto& argument : arguments) {
+    result += "," + static_cast<std::string>(argument);
+  }
+  return get_context().CreateString(result);
+}
+
+JSValue StaticWidget::js_twice(const JSArguments& arguments, JSObject& this_object) {
+  return get_context().CreateNumber(arguments.ToNumber(0) * 2);
+}
+
+void StaticWidget::JSExportInitialize() {
+  static const ::JSStaticValue static_values[] = {
+    JSExport<StaticWidget>::StaticValue<&StaticWidget::js_get_label, &StaticWidget::js_set_label>("label"),
+    JSExport<StaticWidget>::StaticValue<&StaticWidget::js_get_version>("version", false),
+    JSExport<StaticWidget>::EndOfStaticValues()
+  };
+  
+  static const ::JSStaticFunction static_functions[] = {
+    JSExport<StaticWidget>::StaticFunction<&StaticWidget::js_join>("join"),
+    JSExport<StaticWidget>::StaticFunction<&StaticWidget::js_twice>("twice"),
+    JSExport<StaticWidget>::EndOfStaticFunctions()
+  };
+  
+  JSExport<StaticWidget>::SetClassVersion(1);
+  JSExport<StaticWidget>::SetParent(JSExport<JSExportObject>::Class());
+  JSExport<StaticWidget>::SetStaticValues(static_values);
+  JSExport<StaticWidget>::SetStaticFunctions(static_functions);
+  JSExport<StaticWidget>::AddValueProperty("size", [](const StaticWidget& widget) {
+    return widget.get_context().CreateNumber(static_cast<double>(widget.label__.size()));
+  });
+}
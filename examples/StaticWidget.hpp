@@ -0,0 +1,47 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_STATICWIDGET_HPP_
+#define _HAL_EXAMPLES_STATICWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <string>
+#include <vector>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object whose
+ properties come from static tables. label can be read and written,
+ version is read-only and not enumerable, join joins its arguments
+ after the label and twice doubles its first argument. size is added
+ one at a time alongside the tables.
+ */
+class StaticWidget : public JSExportObject, public JSExport<StaticWidget> {
+  
+public:
+  
+  StaticWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~StaticWidget() HAL_NOEXCEPT;
+  
+  JSValue js_get_label() const;
+  bool    js_set_label(const JSValue& value);
+  JSValue js_get_version() const;
+  JSValue js_join(const std::vector<JSValue>& arguments, JSObject& this_object);
+  JSValue js_twice(const JSArguments& arguments, JSObject& this_object);
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  std::string label__;
+};
+
+#endif // _HAL_EXAMPLES_STATICWIDGET_HPP_
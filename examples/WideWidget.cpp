@@ -0,0 +1,45 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "WideWidget.hpp"
+
+#include <string>
+
+WideWidget::WideWidget(const JSContext& js_context) HAL_NOEXCEPT
+: JSExportObject(js_context) {
+  values__.fill(0);
+  HAL_LOG_DEBUG("WideWidget:: ctor ", this);
+}
+
+WideWidget::~WideWidget() HAL_NOEXCEPT {
+  HAL_LOG_DEBUG("WideWidget:: dtor ", this);
+}
+
+void WideWidget::JSExportInitialize() {
+  JSExport<WideWidget>::SetClassVersion(1);
+  JSExport<WideWidget>::SetParent(JSExport<JSExportObject>::Class());
+  for (std::size_t i = 0; i < kFunctionCount; ++i) {
+    JSExport<WideWidget>::AddFunctionProperty("f" + std::to_string(i), [i](WideWidget& widget, const std::vector<JSValue>&, JSObject&) {
+      return widget.get_context().CreateNumber(static_cast<double>(i));
+    });
+  }
+  for (std::size_t i = 0; i < kValueCount; ++i) {
+    const auto suffix = std::to_string(i);
+    JSExport<WideWidget>::AddValueProperty("v" + suffix, [i](const WideWidget& widget) {
+      return widget.get_context().CreateNumber(widget.values__[i]);
+    }, [i](WideWidget& widget, const JSValue& value) {
+      widget.values__[i] = static_cast<double>(value);
+      return true;
+    });
+    if (i % 10 == 0) {
+      JSExport<WideWidget>::AddConstantProperty("c" + suffix, [i](const WideWidget& widget) {
+        return widget.get_context().CreateNumber(static_cast<double>(i));
+      });
+    }
+  }
+}
@@ -0,0 +1,44 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2015 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_EXAMPLES_WIDEWIDGET_HPP_
+#define _HAL_EXAMPLES_WIDEWIDGET_HPP_
+
+#include "HAL/HAL.hpp"
+#include <array>
+#include <cstddef>
+
+using namespace HAL;
+
+/*!
+ @class
+ 
+ @discussion This is an example of a JavaScript object with more
+ function and value properties than HAL has trampolines for, so that
+ the first ones are reached through their index and the rest through
+ their name. Function fN returns N, value property vN holds a number
+ of its own, and every tenth index also has a constant cN of N.
+ */
+class WideWidget : public JSExportObject, public JSExport<WideWidget> {
+  
+public:
+  
+  static const std::size_t kFunctionCount = 70;
+  static const std::size_t kValueCount    = 70;
+  
+  WideWidget(const JSContext& js_context) HAL_NOEXCEPT;
+  virtual ~WideWidget() HAL_NOEXCEPT;
+  
+  static void JSExportInitialize();
+  
+private:
+  
+  std::array<double, kValueCount> values__;
+};
+
+#endif // _HAL_EXAMPLES_WIDEWIDGET_HPP_
@@ -15,6 +15,9 @@
 
 using namespace HAL;
 
+class Widget;
+HAL_JSEXPORT_CLASS_NAME(Widget, "Widget")
+
 /*!
  @class
  
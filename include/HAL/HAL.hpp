@@ -9,23 +9,73 @@
 #ifndef _HAL_HPP_
 #define _HAL_HPP_
 
+#include "HAL/JSRuntime.hpp"
 #include "HAL/JSContextGroup.hpp"
+#include "HAL/JSTimeSlice.hpp"
 #include "HAL/JSContext.hpp"
+#include "HAL/JSScript.hpp"
+#include "HAL/JSScriptSyntaxCheck.hpp"
+#include "HAL/JSModuleLoader.hpp"
+#include "HAL/JSBundle.hpp"
+#include "HAL/JSContextPool.hpp"
+#include "HAL/JSMemoryPressure.hpp"
+#include "HAL/JSContextTemplate.hpp"
+#include "HAL/JSTaskPriority.hpp"
+#include "HAL/JSWorkerPool.hpp"
+#include "HAL/JSRunLoop.hpp"
+#include "HAL/JSMessageChannel.hpp"
+#include "HAL/JSPromiseResolver.hpp"
+#include "HAL/JSCoroutine.hpp"
+#include "HAL/JSTimers.hpp"
+#include "HAL/JSConsole.hpp"
+#include "HAL/JSIdleGarbageCollector.hpp"
+#include "HAL/JSStatistics.hpp"
+#include "HAL/JSTrace.hpp"
+#include "HAL/JSStackProfiler.hpp"
+#include "HAL/JSAllocationProfiler.hpp"
+#include "HAL/JSCallbackRecorder.hpp"
 
 #include "HAL/JSExport.hpp"
 #include "HAL/JSExportObject.hpp"
+#include "HAL/JSExportSharedObject.hpp"
+#include "HAL/JSExportAllocator.hpp"
+#include "HAL/JSExportHandle.hpp"
+#include "HAL/JSExportWeakHandle.hpp"
+#include "HAL/JSExportClassBudget.hpp"
+#include "HAL/JSExportClassName.hpp"
+#include "HAL/JSExportFinalizer.hpp"
+#include "HAL/JSExportRegistry.hpp"
 #include "HAL/JSClass.hpp"
 
 #include "HAL/JSString.hpp"
+#include "HAL/JSStringBuilder.hpp"
 
 #include "HAL/JSValue.hpp"
+#include "HAL/JSHandleScope.hpp"
+#include "HAL/JSArena.hpp"
+#include "HAL/JSValueView.hpp"
+#include "HAL/JSCompactValue.hpp"
+#include "HAL/JSValueWriter.hpp"
+#include "HAL/JSArguments.hpp"
+#include "HAL/JSResult.hpp"
 #include "HAL/JSUndefined.hpp"
 #include "HAL/JSNull.hpp"
 #include "HAL/JSBoolean.hpp"
 #include "HAL/JSNumber.hpp"
 
 #include "HAL/JSObject.hpp"
+#include "HAL/JSObjectView.hpp"
+#include "HAL/JSObjectTemplate.hpp"
+#include "HAL/JSPropertyPath.hpp"
+#include "HAL/JSPreparedCall.hpp"
+#include "HAL/JSConstantTable.hpp"
+#include "HAL/JSWeakObjectMap.hpp"
+#include "HAL/JSMarshal.hpp"
 #include "HAL/JSArray.hpp"
+#include "HAL/JSArrayBuffer.hpp"
+#include "HAL/JSTypedArray.hpp"
+#include "HAL/JSPreparedValue.hpp"
+#include "HAL/JSWebAssembly.hpp"
 #include "HAL/JSDate.hpp"
 #include "HAL/JSError.hpp"
 #include "HAL/JSFunction.hpp"
@@ -0,0 +1,154 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSALLOCATIONPROFILER_HPP_
+#define _HAL_JSALLOCATIONPROFILER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  /*!
+   @struct
+
+   @discussion The sampled wrappers of one kind created at one
+   allocation site, as returned by JSAllocationProfiler::GetTopSites.
+   */
+  struct JSAllocationSiteCount {
+    // "tag (file:line)", or "file:line" without a tag, or
+    // "(unattributed)" outside of any HAL_ALLOCATION_SITE.
+    std::string   site;
+
+    // JSValue, JSObject or JSString.
+    const char*   kind;
+
+    std::uint64_t sample_count;
+  };
+
+  /*!
+   @class
+
+   @discussion A JSAllocationSite names the native call site of the
+   JSValue, JSObject and JSString wrappers created on its thread while
+   it is in scope, for JSAllocationProfiler. Sites nest, and the
+   innermost one is counted. Create one with HAL_ALLOCATION_SITE:
+
+   HAL_ALLOCATION_SITE("LoadWidgets");
+   auto widgets = js_context.JSEvaluateScript("loadWidgets()");
+
+   The file and tag must outlive the profile, so they are string
+   literals.
+   */
+  class HAL_EXPORT JSAllocationSite final {
+
+  public:
+
+    JSAllocationSite(const char* file, int line, const char* tag = nullptr) HAL_NOEXCEPT;
+    ~JSAllocationSite() HAL_NOEXCEPT;
+
+    JSAllocationSite(const JSAllocationSite&)            = delete;
+    JSAllocationSite& operator=(const JSAllocationSite&) = delete;
+
+    const char*             file;
+    int                     line;
+    const char*             tag;
+    const JSAllocationSite* previous;
+  };
+
+  /*!
+   @class
+
+   @discussion JSAllocationProfiler shows which native call sites
+   create the most JSValue, JSObject and JSString wrappers, which drive
+   the traffic of HAL's retain registries. While it runs, every Nth
+   wrapper each thread creates from a JavaScriptCore reference or from
+   new string content is counted against the innermost
+   JSAllocationSite. Copies and moves aren't counted.
+
+   Wrappers are only counted when HAL is built with
+   -DHAL_ALLOCATION_PROFILE_ENABLE=1, and then only between Start and
+   Stop. Otherwise HAL_ALLOCATION_SITE expands to nothing.
+   */
+  class HAL_EXPORT JSAllocationProfiler final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Discard the counts so far, and count one in every
+     sample_interval wrappers created on each thread.
+
+     @throws std::invalid_argument if sample_interval is 0.
+     */
+    static void Start(std::uint32_t sample_interval = 100);
+
+    /*!
+     @method
+
+     @abstract Stop counting. The counts are kept until the next
+     Start.
+     */
+    static void Stop() HAL_NOEXCEPT;
+
+    static bool IsEnabled() HAL_NOEXCEPT {
+      return enabled__.load(std::memory_order_relaxed);
+    }
+
+    static std::uint32_t get_sample_interval() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the number of wrappers counted since Start.
+     */
+    static std::size_t get_sample_count() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the count sites with the most samples, at most
+     count of them, the most first.
+     */
+    static std::vector<JSAllocationSiteCount> GetTopSites(std::size_t count = 20);
+
+    /*!
+     @method
+
+     @abstract Return GetTopSites as a table with the estimated
+     number of wrappers created, samples times the sample interval.
+     */
+    static std::string ToReport(std::size_t count = 20);
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    static std::atomic<bool> enabled__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#ifdef HAL_ALLOCATION_PROFILE_ENABLE
+#define HAL_ALLOCATION_SITE_CONCATENATE_DETAIL(x, y) x ## y
+#define HAL_ALLOCATION_SITE_CONCATENATE(x, y) HAL_ALLOCATION_SITE_CONCATENATE_DETAIL(x, y)
+#define HAL_ALLOCATION_SITE(tag) ::HAL::JSAllocationSite HAL_ALLOCATION_SITE_CONCATENATE(hal_allocation_site_, __LINE__)(__FILE__, __LINE__, tag)
+#else
+#define HAL_ALLOCATION_SITE(tag)
+#endif // HAL_ALLOCATION_PROFILE_ENABLE
+
+#endif // _HAL_JSALLOCATIONPROFILER_HPP_
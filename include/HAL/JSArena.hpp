@@ -0,0 +1,214 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSARENA_HPP_
+#define _HAL_JSARENA_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace HAL { namespace detail {
+  class JSValueRetainRegistry;
+}}
+
+namespace HAL {
+
+  class JSContext;
+  class JSHandleScope;
+
+  /*!
+   @class
+
+   @discussion A JSArena is a request-scoped region for one JSContext,
+   e.g. for the duration of a server request handler. While it is the
+   innermost arena on its thread, the JSValues created for its context
+   are kept alive by the arena instead of the context's retain
+   registry.
+
+   Tracking a JSValue is a bump allocation of a slot and a single
+   JSValueProtect, and copying or destroying the JSValue only counts
+   in that slot, so no registry node is created or looked up per
+   value. When the arena is destroyed every slot is unprotected in one
+   pass. A JSValue that is still alive then has escaped the request,
+   for example by being stored in a long-lived object, and is promoted
+   to the context's retain registry, so escaping needs no special
+   handling.
+
+   Allocate hands out bump-allocated memory that is freed all at once
+   with the arena, and JSArenaAllocator makes it usable from standard
+   containers, e.g. for the argument vectors of one request.
+
+   Unlike a JSHandleScope an arena may live on the heap, and has no
+   limit on the number of values it tracks. Arenas and JSHandleScopes
+   nest, and the innermost one keeps a new JSValue alive. They must be
+   destroyed in the reverse order of their construction, on the thread
+   that constructed them, and a JSValue tracked by an arena must not be
+   handed to another thread before the arena is destroyed.
+
+   JSObjects are kept alive by their own registry, which an arena
+   doesn't replace.
+   */
+  class HAL_EXPORT JSArena final {
+
+  public:
+
+    explicit JSArena(const JSContext& js_context) HAL_NOEXCEPT;
+    ~JSArena() HAL_NOEXCEPT;
+
+    JSArena(const JSArena&)            = delete;
+    JSArena(JSArena&&)                 = delete;
+    JSArena& operator=(const JSArena&) = delete;
+    JSArena& operator=(JSArena&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Return the number of JSValueRefs this arena has
+     tracked.
+     */
+    std::size_t size() const HAL_NOEXCEPT {
+      return size__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return size bytes aligned to alignment, which must be a
+     power of two, that stay valid until the arena is destroyed.
+     */
+    void* Allocate(std::size_t size, std::size_t alignment);
+
+    /*!
+     @method
+
+     @abstract Return the number of bytes allocated by Allocate.
+     */
+    std::size_t get_allocated_size() const HAL_NOEXCEPT {
+      return allocated_size__;
+    }
+
+  private:
+
+    // Only JSHandleScope, on behalf of JSValue, uses the slot
+    // bookkeeping.
+    friend class JSHandleScope;
+
+    // Ids share the sequence of JSHandleScope ids, with the top bit
+    // set, so that a JSValue's scope id says which kind it is.
+    static const std::uint64_t kIdBit = 1ULL << 63;
+
+    static bool IsArenaId(std::uint64_t scope_id) HAL_NOEXCEPT {
+      return (scope_id & kIdBit) != 0;
+    }
+
+    // Return the id of the innermost arena on this thread without its
+    // top bit, or 0.
+    static std::uint64_t GetCurrentId() HAL_NOEXCEPT;
+
+    // Claim a slot in the innermost arena for js_value_ref. Return
+    // false if there is no arena or it is for another context.
+    static bool Track(detail::JSValueRetainRegistry* js_value_retain_registry, JSContextRef js_context_ref, JSValueRef js_value_ref, std::uint64_t& scope_id, std::uint32_t& slot) HAL_NOEXCEPT;
+
+    // Count in a slot of the arena identified by scope_id. Return
+    // false if that arena has already been destroyed.
+    static bool Retain(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT;
+    static bool Release(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT;
+    static JSArena* Find(std::uint64_t scope_id) HAL_NOEXCEPT;
+
+    struct Slot {
+      detail::JSValueRetainRegistry* js_value_retain_registry;
+      JSContextRef                   js_context_ref;
+      JSValueRef                     js_value_ref;
+      std::size_t                    count;
+    };
+
+    static const std::size_t kSlotChunkSize  = 1024;
+    static const std::size_t kMemoryBlockSize = 16 * 1024;
+
+    Slot& GetSlot(std::uint32_t slot) HAL_NOEXCEPT {
+      return slot_chunks__[slot / kSlotChunkSize][slot % kSlotChunkSize];
+    }
+
+    JSArena*           previous__;
+    std::uint64_t      id__;
+    JSGlobalContextRef js_global_context_ref__;
+    std::size_t        size__           { 0 };
+    std::size_t        allocated_size__ { 0 };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::vector<std::unique_ptr<Slot[]>> slot_chunks__;
+
+    // Allocate bumps memory_next__ through the last block.
+    std::vector<std::unique_ptr<char[]>> memory_blocks__;
+    char*                                memory_next__ { nullptr };
+    char*                                memory_end__  { nullptr };
+#pragma warning(pop)
+  };
+
+  /*!
+   @class
+
+   @discussion A standard allocator that allocates from a JSArena and
+   never frees, e.g.
+
+   std::vector<JSValue, JSArenaAllocator<JSValue>> arguments { JSArenaAllocator<JSValue>(arena) };
+
+   The container must not outlive the arena.
+   */
+  template<typename T>
+  class JSArenaAllocator {
+
+  public:
+
+    typedef T value_type;
+
+    explicit JSArenaAllocator(JSArena& js_arena) HAL_NOEXCEPT
+    : js_arena__(&js_arena) {
+    }
+
+    template<typename U>
+    JSArenaAllocator(const JSArenaAllocator<U>& rhs) HAL_NOEXCEPT
+    : js_arena__(rhs.js_arena__) {
+    }
+
+    T* allocate(std::size_t count) {
+      return static_cast<T*>(js_arena__ -> Allocate(count * sizeof(T), std::alignment_of<T>::value));
+    }
+
+    void deallocate(T*, std::size_t) HAL_NOEXCEPT {
+    }
+
+    template<typename U>
+    bool operator==(const JSArenaAllocator<U>& rhs) const HAL_NOEXCEPT {
+      return js_arena__ == rhs.js_arena__;
+    }
+
+    template<typename U>
+    bool operator!=(const JSArenaAllocator<U>& rhs) const HAL_NOEXCEPT {
+      return js_arena__ != rhs.js_arena__;
+    }
+
+  private:
+
+    template<typename U>
+    friend class JSArenaAllocator;
+
+    JSArena* js_arena__;
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSARENA_HPP_
@@ -0,0 +1,209 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSARGUMENTS_HPP_
+#define _HAL_JSARGUMENTS_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSValueView.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSArguments is a non-owning view of the arguments
+   JavaScriptCore passes to a function callback. Unlike the
+   std::vector<JSValue> given to a CallNamedFunctionCallback it
+   neither allocates nor protects each argument, so it is only valid
+   for the duration of the callback.
+
+   Reading an argument past the end yields undefined, the same as in
+   JavaScript. Use ToJSValue or ToVector to obtain owning JSValues
+   that outlive the callback.
+
+   A callback may report an error with SetException or SetError
+   instead of throwing a C++ exception. The error is thrown in
+   JavaScript when the callback returns.
+   */
+  class JSArguments final {
+
+  public:
+
+    // For interoperability with the JavaScriptCore C API.
+    JSArguments(JSContextRef js_context_ref, std::size_t count, const JSValueRef arguments_array[], JSValueRef* exception = nullptr) HAL_NOEXCEPT
+    : js_context_ref__(js_context_ref)
+    , count__(count)
+    , arguments_array__(arguments_array)
+    , exception__(exception) {
+      assert(js_context_ref__);
+      assert(count__ == 0 || arguments_array__);
+    }
+
+    JSArguments()                              = delete;
+    ~JSArguments()                             = default;
+    JSArguments(const JSArguments&)            = default;
+    JSArguments& operator=(const JSArguments&) = default;
+
+    std::size_t size() const HAL_NOEXCEPT {
+      return count__;
+    }
+
+    bool empty() const HAL_NOEXCEPT {
+      return count__ == 0;
+    }
+
+    /*!
+     @method
+
+     @abstract Return a view of the argument at index, or of undefined
+     if there is no such argument.
+     */
+    JSValueView operator[](std::size_t index) const HAL_NOEXCEPT {
+      return JSValueView(js_context_ref__, at(index));
+    }
+
+    bool ToBoolean(std::size_t index) const HAL_NOEXCEPT {
+      return operator[](index).ToBoolean();
+    }
+
+    /*!
+     @method
+
+     @abstract Convert the argument at index to a number.
+
+     @throws std::runtime_error if the conversion threw a JavaScript
+     exception.
+     */
+    double ToNumber(std::size_t index) const {
+      return operator[](index).ToNumber();
+    }
+
+    /*!
+     @method
+
+     @abstract Convert the argument at index to a number and then to
+     an int32_t using the ECMAScript ToInt32 rules.
+
+     @throws std::runtime_error if the conversion threw a JavaScript
+     exception.
+     */
+    std::int32_t ToInt32(std::size_t index) const {
+      return detail::to_int32_t(ToNumber(index));
+    }
+
+    /*!
+     @method
+
+     @abstract Convert the argument at index to a number and then to
+     a uint32_t using the ECMAScript ToUint32 rules.
+
+     @throws std::runtime_error if the conversion threw a JavaScript
+     exception.
+     */
+    std::uint32_t ToUInt32(std::size_t index) const {
+      return static_cast<std::uint32_t>(ToInt32(index));
+    }
+
+    /*!
+     @method
+
+     @abstract Convert the argument at index to a JSString.
+
+     @throws std::runtime_error if the conversion threw a JavaScript
+     exception.
+     */
+    JSString ToJSString(std::size_t index) const {
+      return operator[](index).ToJSString();
+    }
+
+    /*!
+     @method
+
+     @abstract Create an owning JSValue for the argument at index.
+     */
+    JSValue ToJSValue(std::size_t index) const {
+      return operator[](index).ToJSValue();
+    }
+
+    /*!
+     @method
+
+     @abstract Create owning JSValues for all arguments, as passed to
+     a CallNamedFunctionCallback.
+     */
+    std::vector<JSValue> ToVector() const {
+      return detail::to_vector(JSContext(js_context_ref__), count__, arguments_array__);
+    }
+
+    /*!
+     @method
+
+     @abstract Report a JavaScript exception from the callback without
+     throwing a C++ exception.
+
+     @discussion The callback's return value is ignored once an
+     exception is set. If this view wasn't created with an exception
+     slot the exception is thrown as a std::runtime_error instead.
+     */
+    void SetException(const JSValue& js_value) const {
+      if (!exception__) {
+        detail::ThrowRuntimeError("JSArguments", js_value);
+      }
+
+      *exception__ = static_cast<JSValueRef>(js_value);
+    }
+
+    /*!
+     @method
+
+     @abstract Report a JavaScript Error with the given message, see
+     SetException.
+     */
+    void SetError(const std::string& message) const {
+      const JSContext js_context(js_context_ref__);
+      const auto      js_message  = js_context.CreateString(message);
+      const auto      message_ref = static_cast<JSValueRef>(js_message);
+      SetException(JSValue(js_context, JSObjectMakeError(js_context_ref__, 1, &message_ref, nullptr)));
+    }
+
+    bool HasException() const HAL_NOEXCEPT {
+      return exception__ && *exception__;
+    }
+
+    JSContextRef get_context_ref() const HAL_NOEXCEPT {
+      return js_context_ref__;
+    }
+
+    // For interoperability with the JavaScriptCore C API.
+    const JSValueRef* data() const HAL_NOEXCEPT {
+      return arguments_array__;
+    }
+
+  private:
+
+    JSValueRef at(std::size_t index) const HAL_NOEXCEPT {
+      return index < count__ ? arguments_array__[index] : JSValueMakeUndefined(js_context_ref__);
+    }
+
+    JSContextRef      js_context_ref__;
+    std::size_t       count__;
+    const JSValueRef* arguments_array__;
+    JSValueRef*       exception__;
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSARGUMENTS_HPP_
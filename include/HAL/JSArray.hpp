@@ -12,10 +12,134 @@
 #include "HAL/JSObject.hpp"
 #include "HAL/JSValue.hpp"
 #include "HAL/JSString.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
 #include <vector>
 
+namespace HAL { namespace detail {
+
+	/*!
+	 @class
+	 
+	 @discussion A JSValueRefBuffer collects the elements of a new
+	 JSArray. The first kInlineCapacity elements live inside the buffer
+	 itself, so a small array is created without a heap allocation.
+	 */
+	class JSValueRefBuffer final {
+	public:
+		static const std::size_t kInlineCapacity = 32;
+
+		void push_back(JSValueRef js_value_ref) {
+			if (size__ < kInlineCapacity) {
+				inline__[size__++] = js_value_ref;
+				return;
+			}
+			if (overflow__.empty()) {
+				overflow__.reserve(2 * kInlineCapacity);
+				overflow__.assign(inline__, inline__ + kInlineCapacity);
+			}
+			overflow__.push_back(js_value_ref);
+			++size__;
+		}
+
+		const JSValueRef* data() const HAL_NOEXCEPT {
+			return size__ <= kInlineCapacity ? inline__ : overflow__.data();
+		}
+
+		std::size_t size() const HAL_NOEXCEPT {
+			return size__;
+		}
+
+	private:
+		JSValueRef              inline__[kInlineCapacity];
+		std::vector<JSValueRef> overflow__;
+		std::size_t             size__ { 0 };
+	};
+
+	// Convert a native element of a new JSArray to a JSValueRef. Only
+	// types that don't allocate on the JavaScript heap are supported,
+	// since the buffered JSValueRefs aren't protected from garbage
+	// collection.
+	inline JSValueRef ToArrayElement(JSContextRef, const JSValue& js_value) HAL_NOEXCEPT {
+		return static_cast<JSValueRef>(js_value);
+	}
+
+	inline JSValueRef ToArrayElement(JSContextRef js_context_ref, bool value) HAL_NOEXCEPT {
+		return JSValueMakeBoolean(js_context_ref, value);
+	}
+
+	template<typename U>
+	typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, bool>::value, JSValueRef>::type ToArrayElement(JSContextRef js_context_ref, U value) HAL_NOEXCEPT {
+		return JSValueMakeNumber(js_context_ref, static_cast<double>(value));
+	}
+
+}} // namespace HAL { namespace detail {
+
 namespace HAL {
 
+/*!
+  @class
+  
+  @discussion A JSArrayColumn names a property of the objects in a
+  JSArray, and the native buffer that JSArray::CopyColumns fills with
+  that property of each object, one element per row. The buffer must
+  hold at least as many elements as the rows copied.
+  
+  The name is best a JSString created once and reused, such as a
+  static, so that no JSString is built per copy.
+*/
+class HAL_EXPORT JSArrayColumn final {
+
+public:
+    enum class Type {
+        Double,
+        Int32,
+        Uint32,
+        Bool
+    };
+
+    JSArrayColumn(const JSString& name, double* buffer) HAL_NOEXCEPT
+    : name__(name), type__(Type::Double), buffer__(buffer) {
+    }
+
+    JSArrayColumn(const JSString& name, int32_t* buffer) HAL_NOEXCEPT
+    : name__(name), type__(Type::Int32), buffer__(buffer) {
+    }
+
+    JSArrayColumn(const JSString& name, uint32_t* buffer) HAL_NOEXCEPT
+    : name__(name), type__(Type::Uint32), buffer__(buffer) {
+    }
+
+    JSArrayColumn(const JSString& name, bool* buffer) HAL_NOEXCEPT
+    : name__(name), type__(Type::Bool), buffer__(buffer) {
+    }
+
+    const JSString& get_name() const HAL_NOEXCEPT {
+        return name__;
+    }
+
+    Type get_type() const HAL_NOEXCEPT {
+        return type__;
+    }
+
+    void* get_buffer() const HAL_NOEXCEPT {
+        return buffer__;
+    }
+
+private:
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSString name__;
+    Type     type__;
+    void*    buffer__;
+#pragma warning(pop)
+};
+
 /*!
   @class
   
@@ -92,6 +216,116 @@ public:
      */
     virtual uint32_t GetLength() const HAL_NOEXCEPT final;
 
+    /*!
+     @class
+     
+     @discussion An input iterator over the elements of a JSArray.
+     Each element is fetched from JavaScriptCore only when the
+     iterator is dereferenced, so walking an array never materializes
+     the elements that aren't visited. The length is read once, by
+     JSArray::begin.
+     */
+    class HAL_EXPORT const_iterator final {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef JSValue                 value_type;
+        typedef std::ptrdiff_t          difference_type;
+        typedef const JSValue*          pointer;
+        typedef JSValue                 reference;
+
+        JSValue operator*() const;
+
+        const_iterator& operator++() HAL_NOEXCEPT {
+            ++index__;
+            return *this;
+        }
+
+        const_iterator operator++(int) HAL_NOEXCEPT {
+            const auto result = *this;
+            ++index__;
+            return result;
+        }
+
+        bool operator==(const const_iterator& rhs) const HAL_NOEXCEPT {
+            return index__ == rhs.index__;
+        }
+
+        bool operator!=(const const_iterator& rhs) const HAL_NOEXCEPT {
+            return index__ != rhs.index__;
+        }
+
+        uint32_t index() const HAL_NOEXCEPT {
+            return index__;
+        }
+
+    private:
+        friend JSArray;
+
+        const_iterator(const JSArray* js_array, uint32_t index) HAL_NOEXCEPT
+        : js_array__(js_array)
+        , index__(index) {
+        }
+
+        const JSArray* js_array__;
+        uint32_t       index__;
+    };
+
+    /*!
+     @method
+     
+     @abstract Return an iterator to the first element of this JSArray.
+     The JSArray must outlive the iterator.
+     */
+    const_iterator begin() const HAL_NOEXCEPT {
+        return const_iterator(this, 0);
+    }
+
+    /*!
+     @method
+     
+     @abstract Return an iterator past the last element of this
+     JSArray. The length is read each time this is called, so call it
+     once per loop.
+     */
+    const_iterator end() const HAL_NOEXCEPT {
+        return const_iterator(this, GetLength());
+    }
+
+    /*!
+     @method
+     
+     @abstract Call a function with each element of this JSArray and
+     its index, in order, until the function returns false.
+     
+     @discussion Elements are fetched one at a time, so stopping early
+     skips fetching the rest of them.
+     
+     @result The index of the element for which the function returned
+     false, or the length of this JSArray if it never did.
+     */
+    uint32_t ForEach(const std::function<bool(const JSValue& element, uint32_t index)>& callback) const;
+
+    /*!
+     @method
+     
+     @abstract Copy properties of the objects in this JSArray into
+     native columns, in a single pass over the rows.
+     
+     @discussion Row i fills element i of each column's buffer with the
+     column's property, converted by ToNumber, ToInt32, ToUint32 or
+     ToBoolean. A row that isn't an object, or lacks the property,
+     converts undefined.
+     
+     @param columns The properties to copy and their buffers.
+     
+     @param max_rows The most rows to copy, which is typically the
+     capacity of the buffers.
+     
+     @result The number of rows copied, which is the smaller of
+     max_rows and the length of this JSArray.
+     */
+    uint32_t CopyColumns(const std::vector<JSArrayColumn>& columns, uint32_t max_rows) const;
+
     /*!
      @method
      
@@ -112,6 +346,7 @@ private:
 	JSArray(const JSContext& js_context, const std::vector<JSValue>& arguments = {});
 
 	static JSObjectRef MakeArray(const JSContext& js_context, const std::vector<JSValue>& arguments);
+	static JSObjectRef MakeArray(const JSContext& js_context, const JSValueRef elements[], std::size_t count);
 
 	// For interoperability with the JavaScriptCore C API.
 	JSArray(const JSContext& js_context, JSObjectRef js_object_ref);
@@ -119,7 +354,7 @@ private:
 
 template<typename T>
 std::vector<std::shared_ptr<T>> JSArray::GetPrivateItems() const HAL_NOEXCEPT {
-	const uint32_t length = static_cast<uint32_t>(GetProperty("length"));
+	const uint32_t length = static_cast<uint32_t>(GetProperty(detail::JSAtoms::length));
 	std::vector<std::shared_ptr<T>> items(length);
 	for (uint32_t i = 0; i < length; i++) {
 		const JSValue js_item_prop = GetProperty(i);
@@ -133,6 +368,16 @@ std::vector<std::shared_ptr<T>> JSArray::GetPrivateItems() const HAL_NOEXCEPT {
 	return items;
 }
 
+template<typename InputIt>
+JSArray JSContext::CreateArray(InputIt first, InputIt last) const {
+	const auto js_context_ref = static_cast<JSContextRef>(*this);
+	detail::JSValueRefBuffer elements;
+	for (; first != last; ++first) {
+		elements.push_back(detail::ToArrayElement(js_context_ref, *first));
+	}
+	return JSArray(*this, JSArray::MakeArray(*this, elements.data(), elements.size()));
+}
+
 } // namespace HAL {
 
 #endif // _HAL_JSARRAY_HPP_
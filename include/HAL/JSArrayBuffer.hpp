@@ -0,0 +1,75 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSARRAYBUFFER_HPP_
+#define _HAL_JSARRAYBUFFER_HPP_
+
+#include "HAL/JSObject.hpp"
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+
+#include <cstddef>
+#include <functional>
+
+namespace HAL {
+
+  /*!
+   @class
+   
+   @discussion A JavaScript object of the ArrayBuffer type.
+   
+   The only way to create a JSArrayBuffer is by using the
+   JSContext::CreateArrayBuffer member function, or by converting a
+   JSObject that is an ArrayBuffer.
+   */
+  class HAL_EXPORT JSArrayBuffer final : public JSObject HAL_PERFORMANCE_COUNTER2(JSArrayBuffer) {
+    
+  public:
+    
+    /*!
+     @method
+     
+     @abstract Return a pointer to the bytes of this ArrayBuffer. The
+     pointer stays valid for as long as this JSArrayBuffer is alive.
+     */
+    virtual void* GetBytesPtr() const final;
+    
+    /*!
+     @method
+     
+     @abstract Return the number of bytes of this ArrayBuffer.
+     */
+    virtual std::size_t GetByteLength() const final;
+    
+  private:
+    
+    // Only JSContext, JSObject and JSTypedArray can create a
+    // JSArrayBuffer.
+    friend JSContext;
+    friend JSObject;
+    
+    template<typename T>
+    friend class JSTypedArray;
+    
+    // For interoperability with the JavaScriptCore C API.
+    JSArrayBuffer(const JSContext& js_context, JSObjectRef js_object_ref);
+  };
+  
+} // namespace HAL {
+
+namespace HAL { namespace detail {
+  
+  // The JSTypedArrayBytesDeallocator for bytes whose deallocator_context
+  // is a heap allocated JSBytesDeallocator.
+  HAL_EXPORT void DeallocateBytes(void* bytes, void* deallocator_context);
+  
+}} // namespace HAL { namespace detail {
+
+#endif // HAL_TYPED_ARRAY_ENABLE
+
+#endif // _HAL_JSARRAYBUFFER_HPP_
@@ -35,7 +35,7 @@ class HAL_EXPORT JSBoolean final : public JSValue HAL_PERFORMANCE_COUNTER2(JSBoo
     @result The JSBoolean with the new value of the given boolean.
   */
 	JSBoolean& operator=(bool boolean) {
-		JSValue::operator=(JSBoolean(get_context(), boolean));
+		JSValue::operator=(get_context().CreateBoolean(boolean));
 		return *this;
 	}
 
@@ -44,8 +44,8 @@ class HAL_EXPORT JSBoolean final : public JSValue HAL_PERFORMANCE_COUNTER2(JSBoo
 	// Only JSContext can create a JSBoolean.
 	friend JSContext;
 	
-	JSBoolean(const JSContext& js_context, bool boolean)
-			: JSValue(js_context, JSValueMakeBoolean(static_cast<JSContextRef>(js_context), boolean)) {
+	JSBoolean(const JSContext& js_context, JSValueRef js_value_ref)
+			: JSValue(js_context, js_value_ref, kJSTypeBoolean, true) {
 	}
 };
 
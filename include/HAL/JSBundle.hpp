@@ -0,0 +1,132 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSBUNDLE_HPP_
+#define _HAL_JSBUNDLE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSString.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+
+  namespace detail {
+    class JSMappedFile;
+  }
+
+  /*!
+   @class
+
+   @discussion A JSBundle is a read-only archive of module sources in
+   one memory-mapped file, usually built at compile time by the
+   BuildBundle tool or the hal_add_bundle CMake function.
+
+   The file starts with an index of its modules, sorted by id, giving
+   each one's offset, length, encoding and hash. Each source is stored
+   as Latin-1 when every character fits, and as UTF-16 otherwise, so
+   GetSource hands it to JavaScriptCore straight from the mapping
+   without reading the file or transcoding UTF-8. The stored hash is
+   the JSString hash of the source, so the JSString returned by
+   GetSource is looked up in a JSScriptCache without hashing it.
+
+   The file is written in the byte order of the host that built it,
+   and opening it on a host of the other byte order fails.
+
+   Copies of a JSBundle share the same mapping.
+   */
+  class HAL_EXPORT JSBundle final HAL_PERFORMANCE_COUNTER1(JSBundle) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Map the bundle file at path and check its index.
+
+     @throws std::runtime_error if the file can't be mapped or isn't a
+     valid bundle.
+     */
+    explicit JSBundle(const std::string& path);
+
+    /*!
+     @method
+
+     @abstract Return the number of modules in the bundle.
+     */
+    std::size_t size() const HAL_NOEXCEPT {
+      return entry_count__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return whether the bundle has a module with this id.
+     */
+    bool Contains(const std::string& id) const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the source of a module, read from the mapping
+     and copied once into a JSStringRef.
+
+     @throws std::runtime_error if the bundle has no module with this
+     id.
+     */
+    JSString GetSource(const std::string& id) const;
+
+    /*!
+     @method
+
+     @abstract Return the ids of the bundle's modules, in sorted order.
+     */
+    std::vector<std::string> get_ids() const;
+
+    const std::string& get_path() const HAL_NOEXCEPT {
+      return path__;
+    }
+
+    /*!
+     @method
+
+     @abstract Write a bundle file of (id, UTF-8 source) pairs to path.
+
+     @throws std::invalid_argument if two modules have the same id or
+     the bundle would be larger than 4 GB.
+
+     @throws std::runtime_error if the file can't be written.
+     */
+    static void Write(const std::string& path, const std::vector<std::pair<std::string, std::string>>& modules);
+
+  private:
+
+    struct Header;
+    struct Entry;
+
+    const Entry* Find(const std::string& id) const HAL_NOEXCEPT;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<detail::JSMappedFile> file__;
+    std::string                           path__;
+#pragma warning(pop)
+    const Entry*                          entries__     { nullptr };
+    std::uint32_t                         entry_count__ { 0 };
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSBUNDLE_HPP_
@@ -0,0 +1,186 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSCALLBACKRECORDER_HPP_
+#define _HAL_JSCALLBACKRECORDER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  // The JavaScriptCore callback a JSCallbackRecord is of.
+  enum class JSCallbackRecordKind : std::uint8_t {
+    GetNamedValueProperty,
+    SetNamedValueProperty,
+    CallNamedFunction,
+    CallAsFunction,
+    CallAsConstructor,
+    ConvertToType
+  };
+
+  /*!
+   @struct
+
+   @discussion A JSCallbackRecord is one callback from JavaScriptCore
+   into HAL. class_name is the name of the JSExport class, or
+   "JSFunction" for the callback of a JSFunction, and property_name is
+   the name of the property or function, if the callback has one.
+
+   Only the types of the arguments are recorded, not their values, and
+   only the first kMaxArguments of them. The argument of ConvertToType
+   is the type converted to.
+   */
+  struct JSCallbackRecord {
+    std::string                 class_name;
+    JSCallbackRecordKind        kind;
+    std::string                 property_name;
+    std::vector<JSValue::Type>  argument_types;
+    std::uint64_t               begin_nanoseconds;
+    std::uint64_t               duration_nanoseconds;
+    std::uint32_t               thread_id;
+  };
+
+  // Return the object a replayed callback of class_name is made on, or
+  // a value that isn't an object to skip the callbacks of that class.
+  typedef std::function<JSValue(const JSContext& js_context, const std::string& class_name)> JSCallbackReplayObjectFactory;
+
+  /*!
+   @class
+
+   @discussion JSCallbackRecorder records the sequence of callbacks
+   from JavaScriptCore into the JSExport classes and JSFunctions of a
+   program, so that a performance problem seen in it can be reproduced
+   without the program. Each callback is recorded with its class, kind,
+   property name, argument types, thread and duration in a compact
+   binary format, which ToBinary returns and ParseBinary reads back.
+
+   Replay then makes the same sequence of callbacks on objects of a
+   JSContext, with arguments of the recorded types, and returns how
+   long each one took, to compare with the recorded durations before
+   and after a change.
+
+   Callbacks are only recorded when HAL is built with
+   -DHAL_CALLBACK_RECORD_ENABLE=1, and then only between Start and
+   Stop. Each thread appends to a buffer of its own without locking,
+   and drops callbacks once kBufferCapacity are recorded. Write the
+   recording after Stop, once the recorded threads have left HAL.
+   */
+  class HAL_EXPORT JSCallbackRecorder final {
+
+  public:
+
+    // The callbacks each thread records before it drops the rest.
+    static const std::size_t kBufferCapacity = 1 << 16;
+
+    // The arguments of a callback whose types are recorded.
+    static const std::size_t kMaxArguments = 8;
+
+    /*!
+     @method
+
+     @abstract Discard the callbacks recorded so far and start
+     recording.
+     */
+    static void Start() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Stop recording. The recorded callbacks are kept until
+     the next Start.
+     */
+    static void Stop() HAL_NOEXCEPT;
+
+    static bool IsEnabled() HAL_NOEXCEPT {
+      return enabled__.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of callbacks recorded since Start.
+     */
+    static std::size_t get_record_count() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the number of callbacks dropped since Start
+     because the buffer of their thread was full.
+     */
+    static std::size_t get_dropped_record_count() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the callbacks recorded since Start in the binary
+     format of ParseBinary, ordered by the time they began.
+     */
+    static std::string ToBinary();
+
+    /*!
+     @method
+
+     @abstract Write ToBinary to the file at path.
+
+     @throws std::runtime_error if the file can't be written.
+     */
+    static void WriteBinary(const std::string& path);
+
+    /*!
+     @method
+
+     @abstract Return the callbacks of a recording made by ToBinary.
+
+     @throws std::runtime_error if the recording is truncated or isn't
+     one.
+     */
+    static std::vector<JSCallbackRecord> ParseBinary(const std::string& recording);
+
+    /*!
+     @method
+
+     @abstract Make the recorded callbacks again, in order, on the
+     objects returned by get_object, which is called once for each
+     class name. By default the object of a class is the property of
+     the global object named after it, such as the ones
+     JSExportRegistry::Install defines.
+
+     @discussion The callbacks are made through the public JavaScript
+     operations that lead to them, so a getter is replayed by getting
+     the property and a ConvertToType by converting the object. An
+     exception thrown by a replayed callback is ignored.
+
+     @result The duration in nanoseconds of each replayed callback,
+     or 0 for those that were skipped.
+     */
+    static std::vector<std::uint64_t> Replay(const JSContext& js_context, const std::vector<JSCallbackRecord>& records);
+    static std::vector<std::uint64_t> Replay(const JSContext& js_context, const std::vector<JSCallbackRecord>& records, const JSCallbackReplayObjectFactory& get_object);
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    static std::atomic<bool> enabled__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSCALLBACKRECORDER_HPP_
@@ -102,8 +102,8 @@ namespace HAL {
     
 #undef  HAL_JSCLASSDEFINITION_LOCK_GUARD
 #ifdef  HAL_THREAD_SAFE
-    std::recursive_mutex mutex__;
-#define HAL_JSCLASSDEFINITION_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+    detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSClassDefinition, "JSClassDefinition");
+#define HAL_JSCLASSDEFINITION_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
 #else
 #define HAL_JSCLASSDEFINITION_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
@@ -0,0 +1,157 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSCOMPACTVALUE_HPP_
+#define _HAL_JSCOMPACTVALUE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSValueView.hpp"
+
+#include <cassert>
+#include <utility>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSCompactValue is an owning reference to a JavaScript
+   value that is only two pointers in size, for holding large numbers
+   of values in native containers.
+
+   A JSValue holds a full JSContext, its JSHandleScope bookkeeping
+   and, with HAL_THREAD_SAFE, a mutex. A JSCompactValue holds just its
+   JSGlobalContextRef and JSValueRef, retaining the context and
+   protecting the value with JavaScriptCore directly instead of
+   through the retain registry of the JSContext. Copying one therefore
+   costs a JSValueProtect, while moving one costs nothing, so fill
+   containers by moving.
+
+   Use get_view for cheap access to the value, or ToJSValue and
+   ToJSObject to work with it through the full API. A default
+   constructed or moved from JSCompactValue is empty.
+   */
+  class JSCompactValue final {
+
+  public:
+
+    JSCompactValue() HAL_NOEXCEPT {
+    }
+
+    explicit JSCompactValue(const JSValue& js_value) HAL_NOEXCEPT
+    : js_global_context_ref__(JSContextGetGlobalContext(static_cast<JSContextRef>(js_value.get_context())))
+    , js_value_ref__(static_cast<JSValueRef>(js_value)) {
+      Retain();
+    }
+
+    ~JSCompactValue() HAL_NOEXCEPT {
+      Release();
+    }
+
+    JSCompactValue(const JSCompactValue& rhs) HAL_NOEXCEPT
+    : js_global_context_ref__(rhs.js_global_context_ref__)
+    , js_value_ref__(rhs.js_value_ref__) {
+      Retain();
+    }
+
+    JSCompactValue(JSCompactValue&& rhs) HAL_NOEXCEPT
+    : js_global_context_ref__(rhs.js_global_context_ref__)
+    , js_value_ref__(rhs.js_value_ref__) {
+      rhs.js_global_context_ref__ = nullptr;
+      rhs.js_value_ref__          = nullptr;
+    }
+
+    JSCompactValue& operator=(JSCompactValue rhs) HAL_NOEXCEPT {
+      swap(rhs);
+      return *this;
+    }
+
+    void swap(JSCompactValue& other) HAL_NOEXCEPT {
+      using std::swap;
+      swap(js_global_context_ref__, other.js_global_context_ref__);
+      swap(js_value_ref__         , other.js_value_ref__);
+    }
+
+    bool empty() const HAL_NOEXCEPT {
+      return js_value_ref__ == nullptr;
+    }
+
+    /*!
+     @method
+
+     @abstract Return a non-owning view of the value, valid for as long
+     as this JSCompactValue holds it. This value must not be empty.
+     */
+    JSValueView get_view() const HAL_NOEXCEPT {
+      assert(!empty());
+      return JSValueView(js_global_context_ref__, js_value_ref__);
+    }
+
+    /*!
+     @method
+
+     @abstract Create an owning JSValue for the value. This value must
+     not be empty.
+     */
+    JSValue ToJSValue() const {
+      return get_view().ToJSValue();
+    }
+
+    /*!
+     @method
+
+     @abstract Create an owning JSObject for the value, which must be
+     an object.
+     */
+    JSObject ToJSObject() const {
+      return get_view().ToObjectView().ToJSObject();
+    }
+
+    JSContextRef get_context_ref() const HAL_NOEXCEPT {
+      return js_global_context_ref__;
+    }
+
+    // For interoperability with the JavaScriptCore C API.
+    explicit operator JSValueRef() const HAL_NOEXCEPT {
+      return js_value_ref__;
+    }
+
+  private:
+
+    void Retain() HAL_NOEXCEPT {
+      if (js_value_ref__) {
+        JSGlobalContextRetain(js_global_context_ref__);
+        detail::ProtectJSValue(js_global_context_ref__, js_value_ref__);
+      }
+    }
+
+    void Release() HAL_NOEXCEPT {
+      if (js_value_ref__) {
+        detail::UnprotectJSValue(js_global_context_ref__, js_value_ref__);
+        JSGlobalContextRelease(js_global_context_ref__);
+      }
+    }
+
+    JSGlobalContextRef js_global_context_ref__ { nullptr };
+    JSValueRef         js_value_ref__          { nullptr };
+  };
+
+  static_assert(sizeof(JSCompactValue) == 2 * sizeof(void*), "JSCompactValue must stay two pointers in size");
+
+  inline
+  void swap(JSCompactValue& first, JSCompactValue& second) HAL_NOEXCEPT {
+    first.swap(second);
+  }
+
+} // namespace HAL {
+
+#endif // _HAL_JSCOMPACTVALUE_HPP_
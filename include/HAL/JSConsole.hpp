@@ -0,0 +1,138 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSCONSOLE_HPP_
+#define _HAL_JSCONSOLE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace HAL {
+
+  /*!
+   @enum
+
+   @abstract The level of a console message, from the function that
+   wrote it. Off is only a threshold, which rejects every message.
+   */
+  enum class JSConsoleLevel : std::uint8_t {
+    Debug,
+    Log,
+    Info,
+    Warn,
+    Error,
+    Off
+  };
+
+  // The name of the console function of a level, e.g. "log".
+  HAL_EXPORT const char* to_string(JSConsoleLevel level) HAL_NOEXCEPT;
+
+  // The callback a JSConsole writes each message to, on a thread of
+  // its own, with its arguments formatted and joined by spaces.
+  typedef std::function<void(JSConsoleLevel level, const std::string& message)> JSConsoleSink;
+
+  /*!
+   @class
+
+   @discussion JSConsole implements console.debug, console.log,
+   console.info, console.warn and console.error for hosted scripts,
+   without making the JavaScript thread wait for formatting or I/O.
+
+   A call below the level of the JSConsole returns before looking at
+   its arguments. Otherwise strings, numbers, booleans, null and
+   undefined are captured as they are, and only objects are converted
+   to strings before the call returns, since they may change as soon
+   as it does: arrays and plain objects as JSON, and everything else,
+   e.g. functions and Errors, with toString. The captured record is
+   queued, and a thread of the JSConsole transcodes and joins the
+   arguments and writes the message to the sink.
+
+   The queue holds at most capacity messages. When the sink falls
+   behind, new messages are dropped rather than blocking the script,
+   and the number dropped is written after the messages that got
+   through, as a Warn message. Format specifiers such as %s are
+   written as they are.
+
+   Without a sink, messages are written to the HAL logger as the
+   severity of their level, with console.log and console.info both as
+   INFO, so they reach its sink and async pipeline when those are
+   compiled in.
+
+   Copies of a JSConsole share the same queue and thread, which stop
+   once every copy is destroyed, after writing what is left. The
+   installed functions may be called from the threads of any of the
+   JSContexts they were installed in, and do nothing once the JSConsole
+   is destroyed.
+   */
+  class HAL_EXPORT JSConsole final HAL_PERFORMANCE_COUNTER1(JSConsole) {
+
+  public:
+
+    static const std::size_t kDefaultCapacity = 4096;
+
+    explicit JSConsole(JSConsoleSink sink = nullptr, std::size_t capacity = kDefaultCapacity);
+
+    /*!
+     @method
+
+     @abstract Set a console object with the console functions as the
+     console property of the global object of js_context, and return
+     it.
+     */
+    JSObject Install(const JSContext& js_context) const;
+
+    /*!
+     @method
+
+     @abstract Write only the messages of level and above. The default
+     is Log, which rejects console.debug.
+     */
+    void set_level(JSConsoleLevel level) HAL_NOEXCEPT;
+    JSConsoleLevel get_level() const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Wait until every message queued before this call has
+     been written to the sink or dropped.
+     */
+    void Flush() const;
+
+    /*!
+     @method
+
+     @abstract Return the number of messages dropped because the queue
+     was full.
+     */
+    std::uint64_t get_dropped_count() const HAL_NOEXCEPT;
+
+  private:
+
+    struct State;
+    struct Binding;
+
+    static JSValueRef CallFunction(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
+    static void       FinalizeFunction(JSObjectRef function_ref);
+    static JSClassRef GetFunctionClass();
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSCONSOLE_HPP_
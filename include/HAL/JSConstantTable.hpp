@@ -0,0 +1,126 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSCONSTANTTABLE_HPP_
+#define _HAL_JSCONSTANTTABLE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSObject.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace HAL {
+
+  class JSContext;
+
+  /*!
+   @class
+
+   @discussion A JSConstantTable is an immutable table of named
+   constants that is built once per process and read by any number of
+   JSContexts, in any JSContextGroup, without being copied into their
+   heaps.
+
+   The table is parsed from text, either held in memory or mapped
+   read-only from a file, one constant per line:
+
+   # Comments and blank lines are ignored.
+   MAX_ITEMS  = 100
+   RATIO      = 0.5
+   ENABLED    = true
+   FALLBACK   = null
+   GREETING   = "Hello, world"
+
+   A string runs from the first to the last double quote of its line,
+   with no escapes, so it can't span lines. Names and strings stay in
+   the text; only the index over them is built.
+
+   CreateObject gives a JSContext an object whose properties are read
+   from the table on each access, so the memory a JSContext spends on
+   the table doesn't grow with its size. The constants are also read
+   by index, in the order of the text, e.g. table[0]. Writes to the
+   object are ignored.
+
+   Usage:
+
+   static const auto config = JSConstantTable::Load("config.constants");
+   js_context.get_global_object().SetProperty("Config", config.CreateObject(js_context));
+   */
+  class HAL_EXPORT JSConstantTable final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Map the file at path and parse its constants. The file
+     stays mapped for as long as the table or any object created from
+     it is alive, and must not be modified in the meantime.
+
+     @throws std::runtime_error if the file can't be mapped or a line
+     isn't a constant.
+     */
+    static JSConstantTable Load(const std::string& path);
+
+    /*!
+     @method
+
+     @abstract Parse the constants of source, which the table keeps.
+
+     @throws std::runtime_error if a line isn't a constant.
+     */
+    explicit JSConstantTable(std::string source);
+
+    /*!
+     @method
+
+     @abstract Return the number of constants.
+     */
+    std::size_t size() const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return whether the table has a constant with this name.
+     */
+    bool HasConstant(const std::string& name) const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Create an object of js_context that reads its properties
+     from this table.
+     */
+    JSObject CreateObject(const JSContext& js_context) const;
+
+  private:
+
+    struct Table;
+
+    explicit JSConstantTable(std::shared_ptr<const Table> table) HAL_NOEXCEPT;
+
+    static bool       HasProperty(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref);
+    static JSValueRef GetProperty(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception);
+    static bool       SetProperty(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception);
+    static void       GetPropertyNames(JSContextRef context_ref, JSObjectRef object_ref, JSPropertyNameAccumulatorRef property_names);
+    static void       Finalize(JSObjectRef object_ref);
+    static JSClassRef GetTableClass();
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<const Table> table__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSCONSTANTTABLE_HPP_
@@ -10,10 +10,17 @@
 #define _HAL_JSCONTEXT_HPP_
 
 #include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSExportSlotTable.hpp"
 #include "HAL/JSContextGroup.hpp"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <utility>
 
 namespace HAL {
   
@@ -30,12 +37,28 @@ namespace HAL {
   class JSError;
   class JSRegExp;
   class JSFunction;
+  class JSArguments;
   class JSExportObject;
+  class JSPreparedJSON;
+  class JSPreparedString;
   
   namespace detail {
     template<typename T>
     class JSExportClass;
     
+    class JSValueRetainRegistry;
+    class JSFunctionCache;
+    class JSRegExpCache;
+    class JSQuotaState;
+    class JSExportWrapperCache;
+    
+#ifdef HAL_API_STATISTICS_ENABLE
+    struct JSAPIStatistics;
+#endif
+#ifdef HAL_CPU_TIME_ENABLE
+    struct JSCPUTimeCounters;
+#endif
+    
     HAL_EXPORT std::vector<JSValue> to_vector(const JSContext&, size_t, const JSValueRef[]);
   }}
 
@@ -43,6 +66,111 @@ namespace HAL {
 
   typedef std::function<JSValue(const std::vector<JSValue>, JSObject&)> JSFunctionCallback;
   
+  // A JSFunctionArgumentsCallback reads its arguments through a
+  // JSArguments view, so calling it copies none of them.
+  typedef std::function<JSValue(const JSArguments&, JSObject&)> JSFunctionArgumentsCallback;
+  
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  class JSArrayBuffer;
+  class JSWebAssemblyModule;
+  
+  template<typename T>
+  class JSTypedArray;
+  
+  template<typename T>
+  class JSPreparedTypedArray;
+  
+  // The callback invoked with the bytes of a JSArrayBuffer or
+  // JSTypedArray created without a copy, once JavaScriptCore no longer
+  // needs them. It is where native ownership of the bytes ends.
+  typedef std::function<void(void*)> JSBytesDeallocator;
+#endif
+  
+#ifdef HAL_SCRIPT_REF_ENABLE
+  class JSScript;
+  class JSScriptCache;
+#endif
+  
+  // Whether a JSGarbageCollectionCallback is called before or after a
+  // collection.
+  enum class JSGarbageCollectionEvent {
+    Begin,
+    End
+  };
+  
+  // The callback of JSContext::set_garbage_collection_callback. The
+  // pause is zero for Begin.
+  typedef std::function<void(const JSContext& js_context, JSGarbageCollectionEvent event, std::chrono::nanoseconds pause)> JSGarbageCollectionCallback;
+  
+  /*!
+   @struct
+   
+   @discussion The garbage collections HAL requested in this process,
+   as returned by JSContext::GetGarbageCollectionStatistics. A pause
+   is the time the collection call blocked its thread, which is less
+   than the collection itself where JavaScriptCore finishes it
+   concurrently.
+   */
+  struct JSGarbageCollectionStatistics {
+    std::uint64_t collection_count;
+    std::uint64_t total_pause_nanoseconds;
+    std::uint64_t max_pause_nanoseconds;
+  };
+  
+  // The built-in objects of the global object that
+  // JSContext::GetIntrinsic caches.
+  enum class JSIntrinsic : std::uint8_t {
+    Array,
+    Date,
+    Error,
+    Function,
+    JSON,
+    Object,
+    RegExp
+  };
+  
+  static const std::size_t kJSIntrinsicCount = 7;
+  
+#ifdef HAL_CPU_TIME_ENABLE
+  /*!
+   @struct
+   
+   @discussion The thread CPU time spent for a JSContext, as returned
+   by JSContext::GetCPUTimeStatistics. js_time is spent inside the
+   scripts and functions native code evaluates and calls, less
+   native_time, which is spent inside the JSFunction and JSExport
+   callbacks JavaScript makes.
+   */
+  struct JSCPUTimeStatistics {
+    std::chrono::nanoseconds js_time     { 0 };
+    std::chrono::nanoseconds native_time { 0 };
+    
+    // The calls into JavaScript and the callbacks into native code.
+    std::uint64_t entry_count    { 0 };
+    std::uint64_t callback_count { 0 };
+  };
+#endif
+  
+#ifdef HAL_API_STATISTICS_ENABLE
+  /*!
+   @struct
+   
+   @discussion The JavaScriptCore calls of one category that HAL made
+   for a JSContext, as returned by JSContext::GetAPIStatistics. Every
+   call is counted and one in 64 is timed, so the average cost of a
+   call is sampled_nanoseconds / sampled_calls.
+   */
+  struct JSAPICallStatistics {
+    // EvaluateScript, CallAsFunction, CallAsConstructor, GetProperty,
+    // SetProperty, HasProperty, DeleteProperty, ValueConversion or
+    // ValueTypeCheck.
+    const char*   category;
+    std::uint64_t calls;
+    std::uint64_t sampled_calls;
+    std::uint64_t sampled_nanoseconds;
+  };
+#endif
+  
   /*!
    @class
    
@@ -74,6 +202,48 @@ namespace HAL {
      */
     JSObject get_global_object() const HAL_NOEXCEPT;
     
+    /*!
+     @method
+     
+     @abstract Return a built-in object of this JavaScript execution
+     context, such as the Array constructor or JSON.
+     
+     @discussion The object is looked up on the global object and then
+     kept, protected, by every copy of this JSContext, so calls create
+     no JSString and make no property lookup. A context HAL creates
+     looks them all up before any script runs, so a script that
+     replaces the global doesn't change the cached object. A context
+     HAL only wraps looks each up the first time it is used.
+     
+     @throws std::runtime_error if the global object has no such
+     object.
+     */
+    JSObject GetIntrinsic(JSIntrinsic intrinsic) const;
+    
+    /*!
+     @method
+     
+     @abstract Return a property of the global object, looking it up
+     only the first time for each name.
+     
+     @discussion Use this for globals of your own scripts that native
+     code reads often, such as an event dispatcher. The values are
+     kept, protected, until ClearCachedGlobals is called or the
+     context is destroyed, so call ClearCachedGlobals if a script
+     replaces one of them.
+     
+     @throws std::runtime_error if getting the property threw a
+     JavaScript exception.
+     */
+    JSValue GetCachedGlobal(const JSString& name) const;
+    
+    /*!
+     @method
+     
+     @abstract Forget the values GetCachedGlobal has kept.
+     */
+    void ClearCachedGlobals() const HAL_NOEXCEPT;
+    
     /*!
      @method
      
@@ -82,9 +252,21 @@ namespace HAL {
      
      @result The context group of this JavaScript execution context.
      */
-    JSContextGroup get_context_group() const HAL_NOEXCEPT {
-      return js_context_group__;
-    }
+    JSContextGroup get_context_group() const HAL_NOEXCEPT;
+    
+#ifdef HAL_THREAD_AFFINITY
+    /*!
+     @method
+     
+     @abstract Return true if the calling thread owns the context group
+     of this JavaScript execution context.
+     
+     @discussion Every JSContext, JSValue and JSObject operation
+     asserts this in debug builds. Use a context from another thread
+     only by handing work to its owning thread.
+     */
+    bool IsOwnerThread() const HAL_NOEXCEPT;
+#endif
     
     /*!
      @method
@@ -103,6 +285,167 @@ namespace HAL {
      */
     JSValue CreateValueFromJSON(const JSString& js_string) const;
     
+    /*!
+     @method
+     
+     @abstract Create a JavaScript value from parsing JSON data that
+     isn't in a JSString.
+     
+     @discussion UTF-8 data is transcoded to UTF-16 once, straight
+     from the given buffer, and UTF-16 data is handed to JavaScriptCore
+     as is. If the data isn't valid JSON the exception message gives
+     the offset, in code units, of the first invalid character.
+     
+     @param data The JSON data, which need not be null-terminated.
+     
+     @param length The number of code units of data.
+     
+     @throws std::runtime_error if the data isn't valid JSON.
+     */
+    JSValue CreateValueFromJSON(const char* data, std::size_t length) const;
+    JSValue CreateValueFromJSON(const JSChar* data, std::size_t length) const;
+    
+    /*!
+     @method
+     
+     @abstract Create a JavaScript value from JSON text prepared on
+     another thread.
+     
+     @discussion The text is already a JavaScriptCore string, so this
+     is a single pass of the JSON parser.
+     
+     @throws std::runtime_error if the text isn't valid JSON.
+     */
+    JSValue AdoptJSON(const JSPreparedJSON& prepared) const;
+    
+    /*!
+     @method
+     
+     @abstract Create a JavaScript value of the string type from a
+     string prepared on another thread, without converting it.
+     */
+    JSValue AdoptString(const JSPreparedString& prepared) const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Create a JavaScript value from parsing a UTF-8 JSON
+     file.
+     
+     @discussion The file is memory mapped rather than read into a
+     buffer, so its contents are never copied before being transcoded.
+     
+     @throws std::runtime_error if the file can't be read or isn't
+     valid JSON.
+     */
+    JSValue CreateValueFromJSONFile(const std::string& path) const;
+    
+    /*!
+     @method
+     
+     @abstract Parse JSON data in one pass and create JavaScript values
+     only for the parts of it picked by JSONPath-like selectors.
+     
+     @discussion Each selector starts with $, the whole document, and
+     continues with .name or ['name'] for a member of an object, [3]
+     for an element of an array, and .* or [*] for every member or
+     element, for example $.items[*].id. Only the selected values are
+     created, each with its own JSON parse. The rest of the document
+     is checked but never decoded, so extracting a few fields of a
+     large document doesn't fill the JavaScript heap with the rest.
+     
+     @param data The JSON data, which need not be null-terminated.
+     
+     @param length The number of code units in data.
+     
+     @param selectors The selectors. The descendants of a selected
+     value aren't matched again.
+     
+     @param handler Called in document order with the path of each
+     selected value, like $.items[3].id, and the value.
+     
+     @throws std::invalid_argument if a selector isn't valid.
+     
+     @throws std::runtime_error if the data isn't valid JSON, after
+     the values before the error have been passed to handler.
+     */
+    void ParseJSONStream(const char* data, std::size_t length, const std::vector<std::string>& selectors, const std::function<void(const std::string& path, const JSValue& js_value)>& handler) const;
+    void ParseJSONStream(const JSChar* data, std::size_t length, const std::vector<std::string>& selectors, const std::function<void(const std::string& path, const JSValue& js_value)>& handler) const;
+    
+    /*!
+     @method
+     
+     @abstract Create a copy of a JavaScript value in another context,
+     which may belong to a different JSContextGroup.
+     
+     @discussion The value is copied natively, without a round trip
+     through JSON. Cyclic and shared references are preserved, and
+     arrays, Dates, ArrayBuffers and typed arrays keep their types.
+     For other objects the enumerable properties are copied into a
+     plain object.
+     
+     @param js_value The value to copy.
+     
+     @param target The context to create the copy in.
+     
+     @param share_array_buffers If true, each cloned ArrayBuffer uses
+     the bytes of its source, which stays alive until the clone is
+     collected, instead of a copy of them. Writes through either are
+     then visible through both. The clone may be collected on the
+     thread of target, so the source is then released by a task posted
+     to the JSRunLoop of js_value's context.
+     
+     @throws std::runtime_error if the value is or contains a function,
+     or share_array_buffers is true, js_value contains an ArrayBuffer
+     and its context has no JSRunLoop.
+     */
+    static JSValue Clone(const JSValue& js_value, const JSContext& target, bool share_array_buffers = false);
+    
+    /*!
+     @method
+     
+     @abstract Save properties of the global object to a file, so that
+     a later process can restore them with RestoreState instead of
+     running the scripts that built them.
+     
+     @discussion The values are copied like by Clone, and are stored
+     in a compact binary form. Objects shared by several roots stay
+     shared once restored. The file is written beside path and then
+     renamed to it, so that it either holds the previous state or the
+     new one. It is only meant to be read by the same build on the
+     same machine.
+     
+     @param roots The names of the properties of the global object to
+     save.
+     
+     @param path The file to save them to, which is replaced.
+     
+     @throws std::invalid_argument if the global object has no
+     property of one of the names.
+     
+     @throws std::runtime_error if a value is or contains a function,
+     or if the file can't be written.
+     */
+    void SaveState(const std::vector<std::string>& roots, const std::string& path) const;
+    
+    /*!
+     @method
+     
+     @abstract Set the properties of the global object saved by
+     SaveState, replacing any of the same names.
+     
+     @discussion The file is mapped into memory while it is read. The
+     values are copied out of it, so it may be replaced or removed as
+     soon as RestoreState returns.
+     
+     @result false if there is no file at path, in which case nothing
+     is restored.
+     
+     @throws std::runtime_error if the file can't be read, or wasn't
+     written by SaveState of this build.
+     */
+    bool RestoreState(const std::string& path) const;
+    
     /*!
      @method
      
@@ -123,6 +466,10 @@ namespace HAL {
      
      @abstract Create a JavaScript value of the undefined type.
      
+     @discussion undefined, null, true and false are made once with
+     the context and kept alive by it, so returning them makes no
+     JavaScriptCore call and protects nothing.
+     
      @result The unique undefined value.
      */
     JSUndefined CreateUndefined() const HAL_NOEXCEPT;
@@ -234,6 +581,144 @@ namespace HAL {
     JSArray CreateArray() const HAL_NOEXCEPT;
     JSArray CreateArray(const std::vector<JSValue>& arguments) const;
     
+    /*!
+     @method
+     
+     @abstract Create a JavaScript Array object from a range of native
+     elements.
+     
+     @discussion The elements may be JSValues, bools or numbers. Each
+     is converted straight to a JSValueRef, without creating a JSValue,
+     and the Array is created with a single call to JavaScriptCore.
+     
+     @result A JavaScript object that is an Array, populated with the
+     given elements.
+     */
+    template<typename InputIt>
+    JSArray CreateArray(InputIt first, InputIt last) const;
+    JSArray CreateArray(const std::vector<double>& elements) const;
+    
+    /*!
+     @method
+     
+     @abstract Create count objects of the exported C++ class T and
+     return them in a JavaScript Array.
+     
+     @discussion This is what calling
+     CreateObject(JSExport<T>::Class()) count times does, but the
+     JSClass is looked up once, the native objects are initialized
+     with this JSContext instead of a new one for each, and no JSObject
+     is created to return each of them. init, if given, is called with
+     each native object and its index in the Array.
+     
+     It is defined in JSExport.hpp.
+     
+     @result A JavaScript object that is an Array of count new objects
+     of class T.
+     */
+    template<typename T>
+    JSArray CreateObjects(std::size_t count) const;
+    template<typename T, typename Init>
+    JSArray CreateObjects(std::size_t count, Init init) const;
+    
+    /*!
+     @method
+     
+     @abstract Create a JavaScript object of the exported C++ class T
+     that reads the immutable native object shared.
+     
+     @discussion T must derive from JSExportSharedObject<S>. Every
+     object created this way, in any JSContext, holds shared by
+     reference count instead of copying it.
+     
+     It is defined in JSExportSharedObject.hpp.
+     
+     @throws std::invalid_argument if shared is nullptr.
+     
+     @result A JavaScript object of class T.
+     */
+    template<typename T, typename S>
+    JSObject CreateSharedObject(std::shared_ptr<const S> shared) const;
+    
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    /*!
+     @method
+     
+     @abstract Create a JavaScript ArrayBuffer object that uses the
+     given bytes as its backing store, without copying them.
+     
+     @param bytes The bytes, which must stay valid until the
+     deallocator is called.
+     
+     @param byte_length The number of bytes.
+     
+     @param deallocator Called with bytes once JavaScriptCore no
+     longer needs them. It isn't called if creating the ArrayBuffer
+     throws, in which case the caller keeps ownership of the bytes.
+     
+     @result A JavaScript object that is an ArrayBuffer.
+     
+     @throws std::runtime_error if the ArrayBuffer couldn't be created.
+     */
+    JSArrayBuffer CreateArrayBuffer(void* bytes, std::size_t byte_length, JSBytesDeallocator deallocator) const;
+    
+    /*!
+     @method
+     
+     @abstract Create a JavaScript typed array object whose element
+     type matches T, e.g. a Float32Array for JSTypedArray<float>.
+     
+     @discussion The first overload creates a zero-filled typed array
+     of the given length. The second uses the given elements as its
+     backing store without copying them, and calls deallocator with
+     them once JavaScriptCore no longer needs them. The third takes
+     ownership of a std::vector, whose elements are freed with it.
+     
+     @result A JavaScript object that is a typed array.
+     
+     @throws std::runtime_error if the typed array couldn't be created.
+     */
+    template<typename T>
+    JSTypedArray<T> CreateTypedArray(std::size_t length) const;
+    
+    template<typename T>
+    JSTypedArray<T> CreateTypedArray(T* elements, std::size_t length, JSBytesDeallocator deallocator) const;
+    
+    template<typename T>
+    JSTypedArray<T> CreateTypedArray(std::vector<T>&& elements) const;
+    
+    /*!
+     @method
+     
+     @abstract Create a JavaScript typed array whose backing store is
+     the one prepared on another thread, without copying it.
+     
+     @throws std::runtime_error if the typed array couldn't be created.
+     */
+    template<typename T>
+    JSTypedArray<T> AdoptTypedArray(JSPreparedTypedArray<T>&& prepared) const;
+    
+    /*!
+     @method
+     
+     @abstract Compile a WebAssembly module, as new
+     WebAssembly.Module(bytes) would.
+     
+     @discussion The bytes are handed to WebAssembly.Module as an
+     ArrayBuffer without a copy, so the second overload compiles a
+     memory mapped file straight from the mapping, which it unmaps
+     once the ArrayBuffer is collected. Compile a module once, e.g.
+     with a JSWebAssemblyModuleCache, and instantiate it as often as
+     needed.
+     
+     @throws std::runtime_error if this JavaScriptCore has no
+     WebAssembly, the file can't be mapped, or the bytes aren't a
+     valid module.
+     */
+    JSWebAssemblyModule CompileWebAssemblyModule(const void* bytes, std::size_t byte_length) const;
+    JSWebAssemblyModule CompileWebAssemblyModuleFile(const std::string& path) const;
+#endif
+    
     /*!
      @method
      
@@ -248,6 +733,21 @@ namespace HAL {
     JSDate CreateDate() const HAL_NOEXCEPT;
     JSDate CreateDate(const std::vector<JSValue>& arguments) const;
     
+    /*!
+     @method
+     
+     @abstract Create a JavaScript Date object for a point in time,
+     without boxing it in a vector of JSValues.
+     
+     @discussion JavaScript dates count whole milliseconds, so the
+     time is rounded down to a millisecond.
+     
+     @param time_point The date's time.
+     
+     @result A JSObject that is a Date.
+     */
+    JSDate CreateDate(std::chrono::system_clock::time_point time_point) const;
+    
     /*!
      @method
      
@@ -276,6 +776,57 @@ namespace HAL {
     JSRegExp CreateRegExp() const HAL_NOEXCEPT;
     JSRegExp CreateRegExp(const std::vector<JSValue>& arguments) const;
     
+    /*!
+     @method
+     
+     @abstract Create a JavaScript RegExp object from a pattern and
+     flags, reusing the one created before for the same pattern and
+     flags.
+     
+     @discussion Compiling a pattern is expensive, so this context
+     remembers the RegExps it created this way, forgetting the least
+     recently used one when the cache is full. Callers with the same
+     pattern and flags share one RegExp object. Its lastIndex is set
+     to 0 each time it is returned if it is global or sticky, so
+     sharing it doesn't change what JSRegExp::Test and Exec match.
+     
+     @param pattern The regular expression's source.
+     
+     @param flags The regular expression's flags, such as "gi".
+     
+     @result A JSObject that is a RegExp.
+     
+     @throws std::runtime_error if the pattern or flags are invalid.
+     */
+    JSRegExp CreateRegExp(const JSString& pattern) const;
+    JSRegExp CreateRegExp(const JSString& pattern, const JSString& flags) const;
+    
+    /*!
+     @method
+     
+     @abstract Set the number of RegExps created from a pattern and
+     flags that this context remembers.
+     
+     @discussion The cache is shared by all copies of this JSContext.
+     Its capacity is 64 by default, and zero disables it.
+     */
+    void set_regexp_cache_capacity(std::size_t capacity) const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Return the number of RegExps created from a pattern and
+     flags that this context remembers.
+     */
+    std::size_t get_regexp_cache_capacity() const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Forget all RegExps remembered by CreateRegExp.
+     */
+    void ClearRegExpCache() const HAL_NOEXCEPT;
+    
     /*!
      @method
      
@@ -314,6 +865,40 @@ namespace HAL {
     JSFunction CreateFunction(const JSString& body, const std::vector<JSString>& parameter_names) const;
     JSFunction CreateFunction(const JSString& body, const std::vector<JSString>& parameter_names, const JSString& function_name) const;
     JSFunction CreateFunction(const JSString& body, const std::vector<JSString>& parameter_names, const JSString& function_name, const JSString& source_url, int starting_line_number = 1) const;
+    
+    /*!
+     @method
+     
+     @abstract Set the number of functions created from a body string
+     that this context remembers.
+     
+     @discussion When the capacity is not zero, CreateFunction with a
+     body, parameter names, function name, source URL and starting
+     line number that it has seen before returns the function it
+     created then instead of parsing the body again, so callers share
+     one function object. The least recently used function is
+     forgotten when the cache is full.
+     
+     The cache is shared by all copies of this JSContext. Its capacity
+     is zero by default, which disables it.
+     */
+    void set_function_cache_capacity(std::size_t capacity) const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Return the number of functions created from a body
+     string that this context remembers.
+     */
+    std::size_t get_function_cache_capacity() const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Forget all functions remembered by CreateFunction, so
+     that the next call for each body parses it again.
+     */
+    void ClearFunctionCache() const HAL_NOEXCEPT;
 
     /*!
      @method
@@ -332,6 +917,27 @@ namespace HAL {
      */
     JSFunction CreateFunction(JSFunctionCallback& callback) const;
     JSFunction CreateFunction(const JSString& function_name, JSFunctionCallback& callback) const;
+    
+    /*!
+     @method
+     
+     @abstract Create a JavaScript function with a given callback
+     that reads its arguments through a JSArguments view.
+     
+     @discussion Unlike a JSFunctionCallback, calling this callback
+     builds no std::vector of the arguments.
+     
+     @param function_name An optional JSString containing the
+     function's name. An empty string creates an anonymous function.
+     
+     @param callback A C++11 function to invoke when the function is
+     called.
+     
+     @result A JSObject that is a function. The object's prototype
+     will be the default function prototype.
+     */
+    JSFunction CreateFunction(const JSFunctionArgumentsCallback& callback) const;
+    JSFunction CreateFunction(const JSString& function_name, const JSFunctionArgumentsCallback& callback) const;
 
     /*!
      @method
@@ -351,6 +957,10 @@ namespace HAL {
      
      @abstract Evaluate a string of JavaScript code.
      
+     @discussion With HAL_SCRIPT_REF_ENABLE a script that
+     JSContextGroup::PrecompileAsync parsed with the same source URL
+     and starting line number is evaluated without parsing it again.
+     
      @param script A JSString containing the script to evaluate.
      
      @param this_object An optional JavaScript object to use as
@@ -377,6 +987,46 @@ namespace HAL {
     JSValue JSEvaluateScript(const JSString& script,                       const JSString& source_url, int starting_line_number = 1) const;
     JSValue JSEvaluateScript(const JSString& script, JSObject this_object, const JSString& source_url, int starting_line_number = 1) const;
     
+    /*!
+     @method
+     
+     @abstract Evaluate a string of JavaScript only for its side
+     effects, with the global object as "this".
+     
+     @discussion Unlike JSEvaluateScript, this neither wraps the global
+     object nor the result in a JSValue, so the JSContext's retain
+     registry is only touched if the script throws.
+     
+     @throws std::runtime_error exception if the evaluated script
+     threw an exception.
+     */
+    void ExecuteScript(const JSString& script                                                          ) const;
+    void ExecuteScript(const JSString& script, const JSString& source_url, int starting_line_number = 1) const;
+    
+#ifdef HAL_SCRIPT_REF_ENABLE
+    /*!
+     @method
+     
+     @abstract Evaluate a JSScript that was parsed for the
+     JSContextGroup of this context, without parsing it again.
+     
+     @param js_script The JSScript to evaluate.
+     
+     @param this_object An optional JavaScript object to use as
+     "this". The default is the global object.
+     
+     @result The JSValue that results from evaluating the script.
+     
+     @throws std::invalid_argument if the JSScript was parsed for a
+     different JSContextGroup.
+     
+     @throws std::runtime_error exception if the evaluated script
+     threw an exception.
+     */
+    JSValue JSEvaluateScript(const JSScript& js_script                      ) const;
+    JSValue JSEvaluateScript(const JSScript& js_script, JSObject this_object) const;
+#endif
+    
     /*!
      @method
      
@@ -420,6 +1070,237 @@ namespace HAL {
      */
     void GarbageCollect() const HAL_NOEXCEPT;
     
+    /*!
+     @method
+     
+     @abstract Return the number and pause times of the garbage
+     collections requested through GarbageCollect, by HAL itself or
+     the application, in any JSContext.
+     */
+    static JSGarbageCollectionStatistics GetGarbageCollectionStatistics() HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Set the function called before and after each garbage
+     collection requested through GarbageCollect, on the thread that
+     requested it, to correlate tail latency with collection.
+     
+     @discussion JavaScriptCore doesn't report the collections it
+     starts itself, so those aren't seen. Exceptions thrown by the
+     callback are logged and ignored. An empty callback removes it.
+     */
+    static void set_garbage_collection_callback(const JSGarbageCollectionCallback& callback);
+    
+    /*!
+     @method
+     
+     @abstract Enable or disable deferred handle release.
+     
+     @discussion When enabled, a JSValue whose last reference is
+     dropped is not unprotected right away. Its JSValueRef is queued
+     instead, and the queue is processed at the next safe point: an
+     explicit FlushHandles, a GarbageCollect, the return of an
+     exported function callback, or when the queue fills up. A
+     JSValueRef that is protected again before then is never
+     unprotected at all, which saves two JavaScriptCore calls for
+     values that are repeatedly wrapped and dropped.
+     
+     Protection itself is never deferred, since a JSValue stored on
+     the heap would otherwise be unprotected if a garbage collection
+     ran before the safe point.
+     
+     Disabling deferred handle release flushes the queue.
+     
+     @param defer_handle_release true to enable deferred handle
+     release.
+     */
+    static void set_defer_handle_release(bool defer_handle_release) HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Return whether deferred handle release is enabled.
+     */
+    static bool get_defer_handle_release() HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Unprotect all JSValueRefs queued by deferred handle
+     release that have not been protected again since.
+     */
+    static void FlushHandles() HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Account for memory allocated outside of the JavaScript
+     heap on behalf of this context's objects, such as the bitmaps or
+     buffers of JSExport objects.
+     
+     @discussion The garbage collector only sees the small JavaScript
+     objects wrapping such memory, so without this it collects too
+     rarely. An increase is reported to JavaScriptCore with
+     JSReportExtraMemoryCost, which paces the collector. Without
+     HAL_EXTRA_MEMORY_COST_ENABLE, HAL instead collects garbage each
+     time the external memory has grown by the threshold since the
+     last collection.
+     
+     JSExportObject::set_external_memory_cost calls this for you.
+     
+     @param byte_delta The number of bytes allocated, or if negative,
+     freed.
+     */
+    void AdjustExternalMemory(std::ptrdiff_t byte_delta) const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Return the number of external bytes accounted for by
+     AdjustExternalMemory.
+     */
+    std::size_t get_external_memory_size() const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Set the external memory growth, in bytes, that makes
+     HAL collect garbage when JavaScriptCore can't be told about
+     external memory. The default is 64 MiB.
+     */
+    void set_external_memory_gc_threshold(std::size_t threshold) const HAL_NOEXCEPT;
+    
+    std::size_t get_external_memory_gc_threshold() const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Return the number of distinct JavaScript values HAL has
+     protected in this context since it was created, a cheap measure
+     of its allocation rate.
+     */
+    std::uint64_t get_value_allocation_count() const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Allocate a context-local storage slot, and return its
+     index, which is valid in every JSContext of the process.
+     
+     @discussion Allocate a slot once, e.g. in a function-local
+     static, for each kind of native state kept per context, such as
+     a module registry or a run loop, instead of keeping it in a
+     global map keyed by JSContextRef:
+     
+     static const auto index = JSContext::AllocateSlot();
+     const auto registry = js_context.GetOrCreateSlot<ModuleRegistry>(index, [] {
+       return std::make_shared<ModuleRegistry>();
+     });
+     
+     Slots are never freed, so allocate one per kind of state rather
+     than per object.
+     */
+    static std::size_t AllocateSlot() HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Return the value of a slot in this context, or nullptr
+     if it hasn't been set.
+     
+     @discussion This indexes an array, without a lookup or lock
+     unless HAL_THREAD_SAFE is defined. The slots are shared by every
+     JSContext wrapping the same JSGlobalContextRef, including the
+     ones made in callbacks. T must be the type the slot was set with,
+     since it isn't checked.
+     
+     The result shares ownership of the value, so it stays valid when
+     the slot is set again, e.g. on another thread.
+     */
+    template<typename T>
+    std::shared_ptr<T> GetSlot(std::size_t index) const HAL_NOEXCEPT {
+      return std::static_pointer_cast<T>(get_slot(index));
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return the value of a slot in this context, setting it
+     to the result of create first if it hasn't been set.
+     
+     @discussion The slot is checked and set under one lock, so two
+     threads that ask at once get the same value, and create is called
+     once. create may use other slots of this context.
+     
+     @throws std::invalid_argument if index wasn't returned by
+     AllocateSlot.
+     */
+    template<typename T, typename Create>
+    std::shared_ptr<T> GetOrCreateSlot(std::size_t index, Create create) const {
+      return std::static_pointer_cast<T>(get_or_create_slot(index, [&create]() {
+        return std::shared_ptr<void>(create());
+      }));
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the value of a slot in this context, destroying the
+     value it replaces. Setting nullptr clears the slot.
+     
+     @discussion The values are destroyed when the last JSContext of
+     the JSGlobalContextRef is, just before it is released, so a
+     context that HAL only wraps in callbacks keeps its slots for one
+     callback unless the embedder holds a JSContext of it. The contexts
+     of an UnmanagedSingleContext group keep theirs until the process
+     exits. A value must not hold a JSContext, JSValue or JSObject of
+     this context, which would keep it alive forever.
+     
+     @throws std::invalid_argument if index wasn't returned by
+     AllocateSlot.
+     */
+    template<typename T>
+    void SetSlot(std::size_t index, std::shared_ptr<T> value) const {
+      set_slot(index, std::shared_ptr<void>(std::move(value)));
+    }
+    
+#ifdef HAL_API_STATISTICS_ENABLE
+    /*!
+     @method
+     
+     @abstract Return the JavaScriptCore calls HAL has made for this
+     context, one entry per category, to show where batching would pay
+     off and what the calls cost.
+     
+     @discussion Only calls made through JSContext, JSObject and
+     JSValue are counted, not those of JSExport callbacks or of
+     JavaScript itself. The counts are shared by every JSContext of
+     the same JSGlobalContextRef.
+     */
+    std::vector<JSAPICallStatistics> GetAPIStatistics() const;
+    
+    void ResetAPIStatistics() const HAL_NOEXCEPT;
+#endif
+    
+#ifdef HAL_CPU_TIME_ENABLE
+    /*!
+     @method
+     
+     @abstract Return the thread CPU time spent for this context, split
+     into JavaScript and native callback time, to bill tenants and find
+     hot contexts.
+     
+     @discussion The thread CPU clock is read when native code calls
+     into JavaScript through JSContext, JSObject or JSPreparedCall, and
+     when JavaScript calls a JSFunction or JSExport callback. The time
+     is shared by every JSContext of the same JSGlobalContextRef.
+     */
+    JSCPUTimeStatistics GetCPUTimeStatistics() const HAL_NOEXCEPT;
+    
+    void ResetCPUTimeStatistics() const HAL_NOEXCEPT;
+#endif
+    
     /*!
      @method
      
@@ -470,18 +1351,122 @@ namespace HAL {
     
     HAL_EXPORT friend bool operator==(const JSContext& lhs, const JSContext& rhs);
     
+    // A JSValue keeps its JSValueRef alive through the retain
+    // registry of its JSContext.
+    friend class JSValue;
+    
+    detail::JSValueRetainRegistry& get_js_value_retain_registry() const HAL_NOEXCEPT;
+    detail::JSFunctionCache&       get_js_function_cache() const HAL_NOEXCEPT;
+    detail::JSRegExpCache&         get_js_regexp_cache() const HAL_NOEXCEPT;
+    
+    // The undefined, null, true and false of this context, made once
+    // with it and protected until it is destroyed.
+    JSValueRef get_undefined_ref()            const HAL_NOEXCEPT;
+    JSValueRef get_null_ref()                 const HAL_NOEXCEPT;
+    JSValueRef get_boolean_ref(bool boolean)  const HAL_NOEXCEPT;
+    
+    // The intrinsic, and the Array.isArray function used by
+    // JSObject::IsArray, looked up the first time they are needed.
+    // nullptr if the script removed them first.
+    friend class JSObject;
+    JSObjectRef get_intrinsic(JSIntrinsic intrinsic) const HAL_NOEXCEPT;
+    JSObjectRef get_array_is_array_function()        const HAL_NOEXCEPT;
+    
+    // The JavaScript loops JSObject::CallBatched calls, compiled the
+    // first time they are needed.
+    JSObjectRef get_call_batched_function()         const;
+    JSObjectRef get_call_batched_numbers_function() const;
+    
+    // Function.prototype, which JSFunction gives the functions made
+    // for a callback.
+    friend class JSFunction;
+    JSObjectRef get_function_prototype()             const HAL_NOEXCEPT;
+    
+    // Date.prototype.getTime, which JSDate::ToTimePoint calls.
+    friend class JSDate;
+    JSObjectRef get_date_get_time_function()         const HAL_NOEXCEPT;
+    
+    // RegExp.prototype.test and exec, which JSRegExp::Test and Exec
+    // call.
+    friend class JSRegExp;
+    JSObjectRef get_regexp_test_function()           const HAL_NOEXCEPT;
+    JSObjectRef get_regexp_exec_function()           const HAL_NOEXCEPT;
+    
+    // The untyped accessors of GetSlot, GetOrCreateSlot and SetSlot.
+    std::shared_ptr<void> get_slot(std::size_t index) const HAL_NOEXCEPT;
+    std::shared_ptr<void> get_or_create_slot(std::size_t index, const std::function<std::shared_ptr<void>()>& create) const;
+    void                  set_slot(std::size_t index, std::shared_ptr<void> value) const;
+    
+    // The usage and quotas of the context group, which JSObject and
+    // JSPreparedCall charge their calls to.
+    friend class JSPreparedCall;
+    detail::JSQuotaState& get_quota_state() const HAL_NOEXCEPT;
+    
+#ifdef HAL_SCRIPT_REF_ENABLE
+    // The JSScriptCache of the context group.
+    JSScriptCache& get_script_cache() const HAL_NOEXCEPT;
+#endif
+    
+#ifdef HAL_API_STATISTICS_ENABLE
+    // JSObject and JSValue count their JavaScriptCore calls here.
+    detail::JSAPIStatistics& get_api_statistics() const HAL_NOEXCEPT;
+#endif
+    
+#ifdef HAL_CPU_TIME_ENABLE
+    // JSObject and JSPreparedCall charge the CPU time of their calls
+    // here.
+    detail::JSCPUTimeCounters& get_cpu_time_counters() const HAL_NOEXCEPT;
+#endif
+    
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+    // The JSWeakObjectMapRef shared by the JSWeakObjects of this
+    // context, created on first use.
+    friend class JSWeakObjectMap;
+    JSWeakObjectMapRef get_weak_object_map() const;
+#endif
+    
+    // Weak references to objects of this context, keyed by numbers
+    // from NewWeakObjectKey, which JSExportWrapperCache and the weak
+    // handle slots check their objects with. Unlike a raw JSObjectRef,
+    // get_weak_object never returns an object the garbage collector
+    // has found dead but not yet finalized. They use the
+    // JSWeakObjectMapRef with HAL_WEAK_OBJECT_MAP_ENABLE, and a Map of
+    // WeakRefs otherwise, and forget an object once it is collected.
+    friend class detail::JSExportWrapperCache;
+    HAL_EXPORT friend detail::JSExportSlotReference detail::AcquireJSExportSlot(const detail::JSExportSlotValue& value);
+    HAL_EXPORT friend bool detail::LockJSExportSlot(detail::JSExportSlotReference reference, detail::JSExportSlotValue& value);
+    static std::uint64_t NewWeakObjectKey() HAL_NOEXCEPT;
+    JSObjectRef get_weak_object(std::uint64_t key) const;
+    void        set_weak_object(std::uint64_t key, JSObjectRef js_object_ref) const;
+    
+    // All copies of a JSContext, and every JSContext wrapped around
+    // the same JSGlobalContextRef, share one ControlBlock, which holds
+    // the JSContextGroup, the single JSGlobalContextRef retain and the
+    // per-context caches, so copying a JSContext costs one atomic
+    // increment.
+    struct ControlBlock;
+    
+    explicit JSContext(const std::shared_ptr<ControlBlock>& control_block) HAL_NOEXCEPT;
+    
+    // JSMemoryPressure evicts the caches of every JSContext, and
+    // collects each context group through one of them.
+    friend class JSMemoryPressure;
+    static std::vector<JSContext> GetLiveContexts();
+    
     // Silence 4251 on Windows since private member variables do not
     // need to be exported from a DLL.
 #pragma warning(push)
 #pragma warning(disable: 4251)
-    JSContextGroup     js_context_group__;
-    JSGlobalContextRef js_global_context_ref__ { nullptr };
+    std::shared_ptr<ControlBlock> control_block__;
+    JSGlobalContextRef            js_global_context_ref__ { nullptr };
 #pragma warning(pop)
     
 #undef  HAL_JSCONTEXT_LOCK_GUARD
 #ifdef  HAL_THREAD_SAFE
-    std::recursive_mutex mutex__;
-#define HAL_JSCONTEXT_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+    detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSContext, "JSContext");
+#define HAL_JSCONTEXT_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
+#elif defined(HAL_THREAD_AFFINITY)
+#define HAL_JSCONTEXT_LOCK_GUARD assert(IsOwnerThread())
 #else
 #define HAL_JSCONTEXT_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
@@ -11,13 +11,216 @@
 
 #include "HAL/detail/JSBase.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <utility>
+#include <vector>
+
+#ifdef HAL_SCRIPT_REF_ENABLE
+#include <future>
+#endif
 
 namespace HAL {
   
   class JSContext;
   class JSClass;
   
+  namespace detail {
+    class JSContextGroupState;
+    class JSQuotaState;
+  } // namespace detail {
+#ifdef HAL_SCRIPT_REF_ENABLE
+  class JSScriptCache;
+  struct JSScriptSource;
+#endif
+  
+  /*!
+   @enum
+   
+   @abstract How JSContextGroups and the JSContexts created in them
+   manage the lifetime of their JavaScriptCore references.
+   
+   @constant Refcounted Every copy retains the JSContextGroupRef or
+   JSGlobalContextRef it wraps, and releases it when destroyed, so
+   groups and contexts are freed once no copy is left.
+   
+   @constant UnmanagedSingleContext Copies never retain or release, so
+   copying and destroying them costs nothing, but the group and its
+   contexts live until the process exits. This suits an application
+   that uses one long lived context.
+   */
+  enum class JSContextGroupPolicy : std::uint8_t {
+    Refcounted,
+    UnmanagedSingleContext
+  };
+  
+#ifdef HAL_USE_SINGLE_CONTEXT
+  // HAL_USE_SINGLE_CONTEXT now only selects the policy of
+  // JSContextGroups that don't ask for one.
+  HAL_CONSTEXPR const JSContextGroupPolicy kDefaultJSContextGroupPolicy = JSContextGroupPolicy::UnmanagedSingleContext;
+#else
+  HAL_CONSTEXPR const JSContextGroupPolicy kDefaultJSContextGroupPolicy = JSContextGroupPolicy::Refcounted;
+#endif
+  
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+  // The callback invoked in the JSContext whose script has run past
+  // the execution time limit of its JSContextGroup. Return true to
+  // terminate the script, or false to let it run for another period
+  // of the time limit.
+  typedef std::function<bool(const JSContext& js_context)> JSExecutionTimeLimitCallback;
+#endif
+  
+  /*!
+   @enum
+   
+   @abstract The resources a JSContextGroup's quotas limit.
+   
+   @constant CPUTime The seconds spent in scripts and functions called
+   from native code.
+   
+   @constant ProtectedHandles The JSValues and JSObjects HAL protects.
+   
+   @constant ExternalMemory The bytes reported with
+   JSContext::AdjustExternalMemory, e.g. by JSExport objects.
+   
+   @constant QueuedTasks The tasks queued on the JSRunLoops of the
+   group's JSContexts, delayed ones included.
+   */
+  enum class JSQuotaResource : std::uint8_t {
+    CPUTime,
+    ProtectedHandles,
+    ExternalMemory,
+    QueuedTasks
+  };
+  
+  HAL_EXPORT const char* to_string(JSQuotaResource resource) HAL_NOEXCEPT;
+  
+  // The callback invoked when a JSContextGroup's usage of a resource
+  // rises past its soft limit, on the thread that raised it.
+  typedef std::function<void(JSQuotaResource resource, double usage, double limit)> JSQuotaCallback;
+  
+  /*!
+   @struct
+   
+   @discussion The soft and hard limit of one resource. Zero means no
+   limit.
+   */
+  struct JSQuotaLimit {
+    double soft { 0 };
+    double hard { 0 };
+  };
+  
+  /*!
+   @struct
+   
+   @discussion The quotas of a JSContextGroup, as given to
+   JSContextGroup::SetQuotas.
+   */
+  struct JSContextGroupQuotas {
+    JSQuotaLimit cpu_time_seconds;
+    JSQuotaLimit protected_handles;
+    JSQuotaLimit external_memory_bytes;
+    JSQuotaLimit queued_tasks;
+    
+    // How often a running script is checked against the quotas, which
+    // bounds how far it can overrun a hard limit.
+    double check_interval_seconds { 0.01 };
+    
+    // Counting protected handles walks HAL's registries, so it is done
+    // at most this often.
+    double handle_check_interval_seconds { 1 };
+    
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSQuotaCallback soft_limit_callback;
+#pragma warning(pop)
+  };
+  
+  /*!
+   @struct
+   
+   @discussion A JSContextGroup's usage of the resources its quotas
+   limit, as returned by JSContextGroup::GetStatistics.
+   */
+  struct JSContextGroupQuotaUsage {
+    double      cpu_time_seconds      { 0 };
+    std::size_t external_memory_bytes { 0 };
+    std::size_t queued_tasks          { 0 };
+    
+    // The times a usage rose past a soft or a hard limit.
+    std::uint64_t soft_limit_exceeded_count { 0 };
+    std::uint64_t hard_limit_exceeded_count { 0 };
+    
+    // The scripts terminated, calls refused and tasks rejected because
+    // of a hard limit.
+    std::uint64_t terminated_count { 0 };
+  };
+  
+  /*!
+   @struct
+   
+   @discussion The handles HAL keeps protected in one JSContext, as
+   returned by JSContextGroup::GetStatistics.
+   */
+  struct JSContextStatistics {
+    // The global context.
+    JSContextRef js_context_ref { nullptr };
+    
+    // The JSValueRefs retained by JSValues.
+    std::size_t value_count  { 0 };
+    
+    // The JSObjectRefs retained by JSObjects.
+    std::size_t object_count { 0 };
+  };
+  
+  /*!
+   @struct
+   
+   @discussion A snapshot of what HAL keeps protected in the JSContexts
+   of a JSContextGroup, and of the heap they share, as returned by
+   JSContextGroup::GetStatistics.
+   */
+  struct JSContextGroupStatistics {
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    // One entry per JSContext of the group that HAL holds.
+    std::vector<JSContextStatistics> contexts;
+#pragma warning(pop)
+    
+    // The sums over contexts.
+    std::size_t value_count  { 0 };
+    std::size_t object_count { 0 };
+    
+    // Process wide, since these are not kept per JSContext: the
+    // callbacks of functions created with JSContext::CreateFunction,
+    // the entries of the private data map of JSObjects that aren't
+    // JSExport objects, and the cached constants of all JSExport
+    // classes.
+    std::size_t function_callback_count { 0 };
+    std::size_t private_data_count      { 0 };
+    std::size_t cached_constant_count   { 0 };
+    
+    // The heap as JavaScriptCore reports it with
+    // HAL_MEMORY_USAGE_STATISTICS_ENABLE. Otherwise, or when HAL holds
+    // no JSContext of the group, has_heap_statistics is false and the
+    // heap fields are zero.
+    bool        has_heap_statistics     { false };
+    std::size_t heap_size               { 0 };
+    std::size_t heap_capacity           { 0 };
+    std::size_t extra_memory_size       { 0 };
+    std::size_t heap_object_count       { 0 };
+    std::size_t protected_object_count  { 0 };
+    
+    // The usage of the resources limited by SetQuotas, counted since
+    // the group's first JSContext was created, except for CPU time,
+    // which is only counted while the group has quotas. value_count
+    // plus object_count are its protected handles.
+    bool                     has_quotas { false };
+    JSContextGroupQuotaUsage quota_usage;
+  };
+  
   /*!
    @class
    
@@ -32,6 +235,11 @@ namespace HAL {
    When JavaScript objects within the same context group are used in
    multiple threads, explicit synchronization is required.
    
+   When HAL_THREAD_AFFINITY is defined a JSContextGroup is owned by
+   the thread that created it, and copies share its owner. A
+   JSContextGroup wrapping an existing JSContextGroupRef is owned by
+   the thread that wraps it.
+   
    JSContextGroups are the only way to create a JSContext which
    represents a JavaScript execution context.
    
@@ -52,6 +260,23 @@ namespace HAL {
      */
     JSContextGroup() HAL_NOEXCEPT;
     
+    /*!
+     @method
+     
+     @abstract Create a JavaScript context group with the given
+     lifetime policy, which its copies and the JSContexts created in it
+     share.
+     */
+    explicit JSContextGroup(JSContextGroupPolicy policy) HAL_NOEXCEPT;
+    
+    JSContextGroupPolicy get_policy() const HAL_NOEXCEPT {
+      return policy__;
+    }
+    
+    bool is_refcounted() const HAL_NOEXCEPT {
+      return policy__ == JSContextGroupPolicy::Refcounted;
+    }
+    
     /*!
      @method
      
@@ -77,13 +302,160 @@ namespace HAL {
     JSContext CreateContext() const HAL_NOEXCEPT;
     JSContext CreateContext(const JSClass& global_object_class) const HAL_NOEXCEPT;
     
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+    /*!
+     @method
+     
+     @abstract Limit how long a script may run in any JSContext of this
+     context group.
+     
+     @discussion When a script has run for limit_in_seconds, callback
+     is invoked to decide whether to terminate it. A terminated script
+     makes JSEvaluateScript, or whichever call started it, throw a
+     std::runtime_error.
+     
+     The limit belongs to the JSContextGroupRef, so it is shared by
+     all JSContextGroups wrapping it, and the callback is kept until
+     the limit is cleared or set again.
+     
+     @param limit_in_seconds The allowed script execution time.
+     
+     @param callback An optional callback deciding whether to
+     terminate the script. Without one the script is always
+     terminated.
+     */
+    void SetExecutionTimeLimit(double limit_in_seconds, JSExecutionTimeLimitCallback callback = nullptr) const;
+    
+    /*!
+     @method
+     
+     @abstract Remove the execution time limit of this context group.
+     */
+    void ClearExecutionTimeLimit() const HAL_NOEXCEPT;
+#endif
+    
+    /*!
+     @method
+     
+     @abstract Limit the resources the JSContexts of this context group
+     may use, e.g. to keep one tenant of a shared process from starving
+     the others.
+     
+     @discussion Rising past a soft limit invokes
+     soft_limit_callback once, until the usage falls back below it.
+     While any usage is past its hard limit, evaluating a script or
+     calling a function or constructor from native code throws a
+     std::runtime_error, and so does posting a task to the JSRunLoop of
+     a JSContext of the group when queued tasks are limited. With
+     HAL_EXECUTION_TIME_LIMIT_ENABLE a running script is checked every
+     check_interval_seconds and terminated, which makes the call that
+     started it throw a std::runtime_error. The checks use the
+     execution time limit, so SetQuotas and SetExecutionTimeLimit
+     replace each other's.
+     
+     CPU time is the time spent in the outermost script or call of each
+     thread while the group has quotas, and keeps adding up until
+     ResetQuotaCPUTime. The other usages go up and down with the
+     resources held.
+     
+     The quotas belong to the JSContextGroupRef, so they are shared by
+     all JSContextGroups wrapping it, and are kept while any of them
+     is.
+     */
+    void SetQuotas(const JSContextGroupQuotas& quotas) const;
+    
+    /*!
+     @method
+     
+     @abstract Remove the quotas of this context group, and with
+     HAL_EXECUTION_TIME_LIMIT_ENABLE its execution time limit. Its usage
+     is still counted.
+     */
+    void ClearQuotas() const HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Start counting the CPU time of this context group from
+     zero, e.g. at the start of each billing period.
+     */
+    void ResetQuotaCPUTime() const HAL_NOEXCEPT;
+    
+#ifdef HAL_SCRIPT_REF_ENABLE
+    /*!
+     @method
+     
+     @abstract Return the JSScriptCache shared by the JSContexts of
+     this context group, which JSEvaluateScript looks a script up in
+     before parsing it.
+     
+     @discussion The cache belongs to the JSContextGroupRef, and lives
+     while any JSContext of the group or any copy of the result does.
+     */
+    std::shared_ptr<JSScriptCache> GetScriptCache() const;
+    
+    /*!
+     @method
+     
+     @abstract Parse scripts on a thread of their own into the shared
+     JSScriptCache of this context group, e.g. the modules of the next
+     screen, so that evaluating them later in any JSContext of the
+     group with the same source URL and starting line number skips
+     parsing.
+     
+     @discussion The JavaScriptCore C API parses a JSScript for a
+     context group without a JSContext, and only compiles its
+     bytecode the first time it is evaluated, so it is the parsing that
+     moves off the calling thread. JavaScriptCore parses while holding
+     the lock of the group, so a script evaluated meanwhile waits for
+     at most the script being parsed.
+     
+     A script with a syntax error is skipped, and throws when it is
+     evaluated. Precompiling more scripts than the cache holds evicts
+     the least recently used ones.
+     
+     @result A future of the number of scripts that parsed.
+     */
+    std::future<std::size_t> PrecompileAsync(std::vector<JSScriptSource> sources) const;
+#endif
+    
+    /*!
+     @method
+     
+     @abstract Return the handles HAL keeps protected in each JSContext
+     of this context group, and the size of their heap.
+     
+     @discussion This walks the JSValue registry of every JSContext
+     and the JSObject registry, taking each of their locks in turn, so
+     it costs time proportional to the number of distinct JSObjectRefs
+     HAL holds. It is meant to be called about once a second, e.g. to
+     export metrics. Counts read while other threads use HAL are only
+     approximate.
+     */
+    JSContextGroupStatistics GetStatistics() const;
+    
+#ifdef HAL_THREAD_AFFINITY
+    /*!
+     @method
+     
+     @abstract Return the id of the thread that owns this context
+     group, the only thread that may use its contexts, values and
+     objects.
+     */
+    std::thread::id get_owner_thread_id() const HAL_NOEXCEPT {
+      return owner_thread_id__;
+    }
+#endif
+    
     ~JSContextGroup()                         HAL_NOEXCEPT;
     JSContextGroup(const JSContextGroup&)     HAL_NOEXCEPT;
     JSContextGroup(JSContextGroup&&)          HAL_NOEXCEPT;
     JSContextGroup& operator=(JSContextGroup) HAL_NOEXCEPT;
     void swap(JSContextGroup&)                HAL_NOEXCEPT;
 
-    // For interoperability with the JavaScriptCore C API.
+    // For interoperability with the JavaScriptCore C API. The wrapper
+    // has the policy the group was created with, or the default policy
+    // for a group HAL didn't create.
     explicit JSContextGroup(JSContextGroupRef js_context_group_ref) HAL_NOEXCEPT;
     
     explicit operator JSContextGroupRef() const HAL_NOEXCEPT {
@@ -98,18 +470,31 @@ namespace HAL {
     
     HAL_EXPORT friend bool operator==(const JSContextGroup& lhs, const JSContextGroup& rhs);
     
+    // The usage and quotas of this context group, which every
+    // JSContext and JSRunLoop of it holds.
+    friend class JSContext;
+    friend class JSRunLoop;
+    std::shared_ptr<detail::JSQuotaState> get_quota_state() const HAL_NOEXCEPT;
+    
     // Silence 4251 on Windows since private member variables do not
     // need to be exported from a DLL.
 #pragma warning(push)
 #pragma warning(disable: 4251)
     bool managed__ { false };
+    JSContextGroupPolicy policy__ { kDefaultJSContextGroupPolicy };
     JSContextGroupRef js_context_group_ref__;
+    
+    // Shared by every JSContextGroup wrapping js_context_group_ref__.
+    std::shared_ptr<detail::JSContextGroupState> state__;
+#ifdef HAL_THREAD_AFFINITY
+    std::thread::id owner_thread_id__ { std::this_thread::get_id() };
+#endif
 #pragma warning(pop)
     
 #undef HAL_JSCONTEXTGROUP_LOCK_GUARD
 #ifdef HAL_THREAD_SAFE
-    std::recursive_mutex mutex__;
-#define HAL_JSCONTEXTGROUP_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+    detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSContextGroup, "JSContextGroup");
+#define HAL_JSCONTEXTGROUP_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
 #else
 #define HAL_JSCONTEXTGROUP_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
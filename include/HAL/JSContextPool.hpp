@@ -0,0 +1,138 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSCONTEXTPOOL_HPP_
+#define _HAL_JSCONTEXTPOOL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSClass.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSContextGroup.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace HAL {
+
+  // The function a JSContextPool calls once on each JSContext it
+  // creates, to install its globals and exported constructors.
+  typedef std::function<void(const JSContext& js_context)> JSContextPoolInitializer;
+
+  /*!
+   @class
+
+   @discussion A JSContextPool keeps initialized JSContexts of one
+   JSContextGroup ready for reuse, so that the cost of creating a
+   context and installing its globals is paid once per context rather
+   than once per use.
+
+   Acquire hands out a context through a JSContextPool::Lease. When
+   the lease is destroyed the context is reset and returned to the
+   pool: every enumerable global added since initialization is
+   deleted, and every global the initializer installed is set back to
+   its initial value. A context is discarded instead if a global can't
+   be deleted, such as one declared with var, if the lease was marked
+   dirty, or if the pool is already full. State inside the initial
+   globals, e.g. a property added to an installed object, isn't
+   tracked; mark such leases dirty.
+
+   Copies of a JSContextPool share the same contexts. Memory pressure,
+   see JSMemoryPressure, destroys idle contexts, and Acquire creates
+   new ones as needed afterwards.
+   */
+  class HAL_EXPORT JSContextPool final HAL_PERFORMANCE_COUNTER1(JSContextPool) {
+
+    struct State;
+    struct Entry;
+
+  public:
+
+    /*!
+     @class
+
+     @discussion A Lease gives exclusive use of a pooled JSContext for
+     as long as it is alive.
+     */
+    class HAL_EXPORT Lease final {
+
+    public:
+
+      ~Lease() HAL_NOEXCEPT;
+      Lease(Lease&&) HAL_NOEXCEPT;
+      Lease(const Lease&)            = delete;
+      Lease& operator=(const Lease&) = delete;
+      Lease& operator=(Lease&&)      = delete;
+
+      const JSContext& get_context() const HAL_NOEXCEPT {
+        return js_context__;
+      }
+
+      /*!
+       @method
+
+       @abstract Discard the context when this lease ends instead of
+       returning it to the pool.
+       */
+      void MarkDirty() HAL_NOEXCEPT {
+        dirty__ = true;
+      }
+
+    private:
+
+      friend class JSContextPool;
+
+      Lease(const std::shared_ptr<State>& state, std::unique_ptr<Entry> entry);
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+      std::shared_ptr<State> state__;
+      std::unique_ptr<Entry> entry__;
+      JSContext              js_context__;
+      bool                   dirty__ { false };
+#pragma warning(pop)
+    };
+
+    /*!
+     @method
+
+     @abstract Create a pool that keeps up to capacity initialized
+     contexts, all of which are created now.
+
+     @param global_object_class An optional JSClass used to create the
+     global object of each context.
+     */
+    JSContextPool(const JSContextGroup& js_context_group, std::size_t capacity, JSContextPoolInitializer initializer);
+    JSContextPool(const JSContextGroup& js_context_group, std::size_t capacity, JSContextPoolInitializer initializer, const JSClass& global_object_class);
+
+    /*!
+     @method
+
+     @abstract Lease an idle context, creating and initializing a new
+     one if there is none.
+     */
+    Lease Acquire();
+
+    /*!
+     @method
+
+     @abstract Return the number of idle contexts.
+     */
+    std::size_t get_idle_count() const;
+
+  private:
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSCONTEXTPOOL_HPP_
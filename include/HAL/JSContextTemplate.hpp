@@ -0,0 +1,130 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSCONTEXTTEMPLATE_HPP_
+#define _HAL_JSCONTEXTTEMPLATE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSClass.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSContextGroup.hpp"
+#include "HAL/JSPropertyAttribute.hpp"
+#include "HAL/JSScript.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace HAL {
+
+  // A setup step of a JSContextTemplate that can't be expressed as a
+  // script or a constant, e.g. registering JSExport classes.
+  typedef std::function<void(const JSContext& js_context)> JSContextTemplateInitializer;
+
+  /*!
+   @class
+
+   @discussion A JSContextTemplate records the steps that set up the
+   global environment of a JSContext once, and replays them, in the
+   order they were added, into every context it creates.
+
+   Scripts are parsed once, when they are added, and evaluated from
+   their JSScript in each new context. Constants are deep copied into
+   each new context with JSContext::Clone, so plain data that is
+   expensive to compute, e.g. configuration objects built by a script,
+   can be computed once in any context and then copied instead of
+   being computed again.
+
+   Copies of a JSContextTemplate share the parsed scripts and the
+   constants' source values.
+   */
+  class HAL_EXPORT JSContextTemplate final HAL_PERFORMANCE_COUNTER1(JSContextTemplate) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Create an empty template for contexts of a context
+     group.
+
+     @param global_object_class An optional JSClass used to create the
+     global object of each context.
+     */
+    explicit JSContextTemplate(const JSContextGroup& js_context_group);
+    JSContextTemplate(const JSContextGroup& js_context_group, const JSClass& global_object_class);
+
+    /*!
+     @method
+
+     @abstract Add a script to evaluate in each new context for its
+     side effects.
+
+     @throws std::runtime_error if the script has a syntax error and
+     JSScript is available; otherwise the error is thrown by
+     CreateContext.
+     */
+    void AddScript(const JSString& script, const JSString& source_url = JSString(), int starting_line_number = 1);
+
+#ifdef HAL_SCRIPT_REF_ENABLE
+    /*!
+     @method
+
+     @abstract Add an already parsed script, e.g. one from a
+     JSScriptCache.
+
+     @throws std::invalid_argument if the script was parsed for
+     another context group.
+     */
+    void AddScript(const JSScript& js_script);
+#endif
+
+    /*!
+     @method
+
+     @abstract Add a global whose value is deep copied from value into
+     each new context. The value may belong to any context, which it
+     keeps alive.
+
+     @throws std::runtime_error from CreateContext if the value can't
+     be cloned, e.g. because it contains a function.
+     */
+    void AddConstant(const JSString& name, const JSValue& value, JSPropertyAttributeSet attributes = JSPropertyAttributeSet());
+
+    /*!
+     @method
+
+     @abstract Add a native setup step.
+     */
+    void AddInitializer(JSContextTemplateInitializer initializer);
+
+    /*!
+     @method
+
+     @abstract Create a context and replay every setup step into it.
+     */
+    JSContext CreateContext() const;
+
+    JSContextGroup get_context_group() const HAL_NOEXCEPT {
+      return js_context_group__;
+    }
+
+  private:
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSContextGroup                            js_context_group__;
+    JSClass                                   global_object_class__;
+    std::vector<JSContextTemplateInitializer> steps__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSCONTEXTTEMPLATE_HPP_
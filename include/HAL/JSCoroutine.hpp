@@ -0,0 +1,306 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSCOROUTINE_HPP_
+#define _HAL_JSCOROUTINE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#ifdef HAL_COROUTINE_ENABLE
+
+#include "HAL/JSArguments.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSFunction.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSPromiseResolver.hpp"
+#include "HAL/JSRunLoop.hpp"
+#include "HAL/JSUndefined.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace HAL {
+
+  class JSAsync;
+
+  /*!
+   @class
+
+   @discussion Awaiting a JSDelay in a JSAsync coroutine resumes it
+   from its run loop once duration has elapsed, or on the run loop's
+   next turn for a zero duration, so a long native loop can give the
+   JavaScript thread back between steps.
+   */
+  struct JSDelay final {
+    explicit JSDelay(std::chrono::steady_clock::duration duration = std::chrono::steady_clock::duration::zero()) noexcept
+    : duration(duration) {
+    }
+
+    std::chrono::steady_clock::duration duration;
+  };
+
+  namespace detail {
+
+    // Return the run loop of the first coroutine parameter that is a
+    // JSRunLoop or has a JSContext.
+    inline JSRunLoop FindJSRunLoop() {
+      throw std::invalid_argument("JSAsync: A JSAsync coroutine needs a JSRunLoop, JSContext, JSObject or JSValue parameter.");
+    }
+
+    template<typename First, typename... Rest>
+    JSRunLoop FindJSRunLoop(const First& first, const Rest&... rest) {
+      if constexpr (std::is_same_v<JSRunLoop, First>) {
+        return first;
+      } else if constexpr (std::is_base_of_v<JSContext, First>) {
+        return JSRunLoop::Get(first);
+      } else if constexpr (std::is_base_of_v<JSObject, First> || std::is_base_of_v<JSValue, First>) {
+        return JSRunLoop::Get(first.get_context());
+      } else {
+        return FindJSRunLoop(rest...);
+      }
+    }
+
+    /*!
+     @class
+
+     @discussion The awaiter of a JavaScript promise, or of any other
+     thenable, in a JSAsync coroutine. The coroutine is resumed from
+     its run loop once the promise settles, rather than from inside
+     JavaScriptCore's microtask checkpoint. Awaiting a value that isn't
+     a thenable doesn't suspend, and results in the value itself.
+     */
+    class JSPromiseAwaiter final {
+
+    public:
+
+      JSPromiseAwaiter(const JSRunLoop& js_run_loop, const JSValue& js_value)
+      : js_run_loop__(js_run_loop)
+      , js_value__(js_value)
+      , result__(std::make_shared<Result>()) {
+      }
+
+      bool await_ready() const noexcept {
+        return false;
+      }
+
+      bool await_suspend(std::coroutine_handle<> handle) {
+        if (!js_value__.IsObject()) {
+          return false;
+        }
+
+        const auto js_object = static_cast<JSObject>(js_value__);
+        const auto then      = js_object.GetProperty("then");
+        if (!then.IsObject() || !static_cast<JSObject>(then).IsFunction()) {
+          return false;
+        }
+
+        const auto js_context = js_object.get_context();
+        const auto settle     = [this_result = result__, js_run_loop = js_run_loop__, handle](bool rejected) {
+          return [this_result, js_run_loop, handle, rejected](const JSArguments& arguments, JSObject& this_object) -> JSValue {
+            this_result -> rejected = rejected;
+            this_result -> value.emplace(arguments.ToJSValue(0));
+            js_run_loop.Post([handle](const JSContext&) {
+              handle.resume();
+            });
+            return this_object.get_context().CreateUndefined();
+          };
+        };
+
+        const std::vector<JSValue> reactions { js_context.CreateFunction(settle(false)), js_context.CreateFunction(settle(true)) };
+        static_cast<JSObject>(then)(reactions, js_object);
+        return true;
+      }
+
+      // Throws std::runtime_error with the reason of a rejected
+      // promise.
+      JSValue await_resume() {
+        if (!result__ -> value) {
+          return js_value__;
+        }
+        if (result__ -> rejected) {
+          throw std::runtime_error(static_cast<std::string>(*result__ -> value));
+        }
+        return *result__ -> value;
+      }
+
+    private:
+
+      // Shared with the reactions, which may outlive the awaiter.
+      struct Result {
+        bool                   rejected { false };
+        std::optional<JSValue> value;
+      };
+
+      JSRunLoop               js_run_loop__;
+      JSValue                 js_value__;
+      std::shared_ptr<Result> result__;
+    };
+
+    class JSDelayAwaiter final {
+
+    public:
+
+      JSDelayAwaiter(const JSRunLoop& js_run_loop, const JSDelay& js_delay) noexcept
+      : js_run_loop__(js_run_loop)
+      , duration__(js_delay.duration) {
+      }
+
+      bool await_ready() const noexcept {
+        return false;
+      }
+
+      void await_suspend(std::coroutine_handle<> handle) const {
+        const auto resume = [handle](const JSContext&) {
+          handle.resume();
+        };
+        if (duration__ > std::chrono::steady_clock::duration::zero()) {
+          js_run_loop__.PostDelayed(resume, duration__);
+        } else {
+          js_run_loop__.Post(resume);
+        }
+      }
+
+      void await_resume() const noexcept {
+      }
+
+    private:
+
+      JSRunLoop                           js_run_loop__;
+      std::chrono::steady_clock::duration duration__;
+    };
+
+  } // namespace detail {
+
+  /*!
+   @class
+
+   @discussion JSAsync is the return type of a C++20 coroutine that
+   JavaScript sees as a promise. Inside one, co_await a JSObject or
+   JSValue holding a promise, another JSAsync, or a JSDelay, and
+   co_return the JSValue the promise is fulfilled with. An exception
+   that escapes the coroutine, including one thrown by awaiting a
+   rejected promise, rejects the promise with its message.
+
+   The coroutine runs on the thread of its JSContext's JSRunLoop,
+   which must exist, and is found from the coroutine's first JSRunLoop,
+   JSContext, JSObject or JSValue parameter. It runs synchronously up
+   to its first co_await, and after each one it is resumed by a task
+   on that run loop, so the JavaScript thread isn't blocked while it
+   waits and the steps read in order instead of as nested callbacks.
+   The promise settles on a later turn of the run loop as well.
+
+   A JSAsync converts to the JSValue of its promise, so a JSExport
+   method written as a coroutine is registered with
+   AddFunctionProperty like any other, e.g.
+
+   JSAsync Widget::Fetch(const std::vector<JSValue>& arguments, JSObject& this_object) {
+     const auto response = co_await static_cast<JSObject>(arguments.at(0));
+     co_return response;
+   }
+
+   A coroutine whose run loop is destroyed, or whose awaited promise
+   never settles, is never resumed and its frame is never freed.
+
+   This header requires a compiler with C++20 coroutines, and is empty
+   otherwise.
+   */
+  class JSAsync final {
+
+  public:
+
+    struct promise_type {
+
+      template<typename... Args>
+      explicit promise_type(const Args&... args)
+      : js_run_loop(detail::FindJSRunLoop(args...))
+      , promise_and_resolver(js_run_loop.CreatePromise()) {
+      }
+
+      JSAsync get_return_object() const {
+        return JSAsync(promise_and_resolver.first);
+      }
+
+      std::suspend_never initial_suspend() const noexcept {
+        return {};
+      }
+
+      std::suspend_never final_suspend() const noexcept {
+        return {};
+      }
+
+      void return_value(const JSValue& js_value) const {
+        promise_and_resolver.second.Resolve([js_value](const JSContext&) -> JSValue {
+          return js_value;
+        });
+      }
+
+      void unhandled_exception() const {
+        try {
+          throw;
+        } catch (const std::exception& e) {
+          promise_and_resolver.second.Reject(e.what());
+        } catch (...) {
+          promise_and_resolver.second.Reject("JSAsync: The coroutine threw an unknown exception.");
+        }
+      }
+
+      detail::JSPromiseAwaiter await_transform(const JSValue& js_value) const {
+        return detail::JSPromiseAwaiter(js_run_loop, js_value);
+      }
+
+      detail::JSPromiseAwaiter await_transform(const JSObject& js_object) const {
+        return detail::JSPromiseAwaiter(js_run_loop, static_cast<JSValue>(js_object));
+      }
+
+      detail::JSPromiseAwaiter await_transform(const JSAsync& js_async) const {
+        return detail::JSPromiseAwaiter(js_run_loop, static_cast<JSValue>(js_async.js_promise__));
+      }
+
+      detail::JSDelayAwaiter await_transform(const JSDelay& js_delay) const noexcept {
+        return detail::JSDelayAwaiter(js_run_loop, js_delay);
+      }
+
+      const JSRunLoop                           js_run_loop;
+      const std::pair<JSObject, JSPromiseResolver> promise_and_resolver;
+    };
+
+    /*!
+     @method
+
+     @abstract Return the JavaScript promise of the coroutine.
+     */
+    JSObject get_promise() const {
+      return js_promise__;
+    }
+
+    operator JSValue() const {
+      return static_cast<JSValue>(js_promise__);
+    }
+
+  private:
+
+    explicit JSAsync(const JSObject& js_promise)
+    : js_promise__(js_promise) {
+    }
+
+    JSObject js_promise__;
+  };
+
+} // namespace HAL {
+
+#endif // HAL_COROUTINE_ENABLE
+
+#endif // _HAL_JSCOROUTINE_HPP_
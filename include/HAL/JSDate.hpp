@@ -11,6 +11,8 @@
 
 #include "HAL/JSObject.hpp"
 
+#include <chrono>
+
 namespace HAL {
 
 /*!
@@ -23,14 +25,32 @@ namespace HAL {
 */
 class HAL_EXPORT JSDate final : public JSObject HAL_PERFORMANCE_COUNTER2(JSDate) {
 	
+ public:
+	
+	/*!
+	  @method
+	  
+	  @abstract Return this date's time, as Date.prototype.getTime
+	  does.
+	  
+	  @discussion The getTime function is looked up once for each
+	  JSContext and called directly, with no property lookup.
+	  
+	  @throws std::runtime_error if this is an invalid date or getTime
+	  threw a JavaScript exception.
+	*/
+	std::chrono::system_clock::time_point ToTimePoint() const;
+	
  private:
 	
 	// Only a JSContext can create a JSDate.
 	friend JSContext;
 	
 	JSDate(const JSContext& js_context, const std::vector<JSValue>& arguments = {});
+	JSDate(const JSContext& js_context, double milliseconds);
 
 	static JSObjectRef MakeDate(const JSContext& js_context, const std::vector<JSValue>& arguments);
+	static JSObjectRef MakeDate(const JSContext& js_context, double milliseconds);
 };
 
 } // namespace HAL {
@@ -11,10 +11,19 @@
 
 #include "HAL/detail/JSBase.hpp"
 #include "HAL/detail/JSExportClassDefinitionBuilder.hpp"
+#include "HAL/detail/JSExportWrapperCache.hpp"
+#include "HAL/JSExportClassBudget.hpp"
+#include "HAL/JSExportClassName.hpp"
+#include "HAL/JSExportHandle.hpp"
+#include "HAL/JSExportWeakHandle.hpp"
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <mutex>
+#include <functional>
+#include <type_traits>
+#include <vector>
 
 namespace HAL {
   
@@ -104,6 +113,10 @@ namespace HAL {
    Setting any callback to nullptr specifies that the default object
    callback should substitute, except in the case of HasProperty,
    where it specifies that GetProperty should substitute.
+   
+   The C++ objects backing your JavaScript objects are allocated from
+   a per-class pool. Specialize JSExportAllocator<T> to change where
+   their memory comes from.
    */
   template<typename T>
   class JSExport HAL_PERFORMANCE_COUNTER1(JSExport<T>) {
@@ -113,17 +126,213 @@ namespace HAL {
     /*!
      @method
      
-     @abstract Return the JSClass for the C++ class T.
+     @abstract Return the JSClass for the C++ class T. The JSClass is
+     created on first use and lives for the rest of the program, so
+     the reference stays valid and creating objects with it takes no
+     copy of the JSClass.
+     */
+    static const detail::JSExportClass<T>& Class();
+    
+    /*!
+     @method
+     
+     @abstract Return the JavaScript object of T that wraps native_ptr
+     in js_context, creating it if there is none.
+     
+     @discussion Native code that returns the same C++ object to
+     JavaScript many times, such as a 'parent.child' getter, gets the
+     same JavaScript object each time, so scripts see one identity and
+     no wrapper is allocated again while the first is alive.
+     
+     The wrappers of a JSContext are cached by native pointer and
+     class without protecting them, and the cache entry of a wrapper
+     is removed when it is finalized, after which Wrap creates a new
+     one. init is called with the native object of each new wrapper
+     to connect it to native_ptr, for example:
+     
+     JSExport<Child>::Wrap(js_context, child_ptr, [child_ptr](Child& child) {
+       child.set_model(child_ptr);
+     });
+     
+     native_ptr must outlive its wrapper, or be unwrapped before it
+     dies, since the wrapper is found by its address alone.
+     
+     @throws std::invalid_argument if native_ptr is nullptr.
      */
-    static detail::JSExportClass<T> Class();
+    static JSObject Wrap(const JSContext& js_context, const void* native_ptr);
+    template<typename Init>
+    static JSObject Wrap(const JSContext& js_context, const void* native_ptr, Init&& init);
+    
+    /*!
+     @method
+     
+     @abstract Get or set a property of js_object from native code,
+     calling the getter or setter added with AddValueProperty directly
+     when js_object is an object of T.
+     
+     @discussion The property is the one JavaScript would see, but
+     found without going through JavaScriptCore: js_object is
+     recognized by its JSExport class, like JSObject::GetPrivateAs<T>,
+     and the callback is called on its native object, using the
+     constant and cached value caches as a JavaScript read would.
+     
+     Objects of other classes, including classes derived from T, which
+     may override the property, properties not added with
+     AddValueProperty, and classes with a GetProperty or SetProperty
+     callback, which JavaScriptCore calls first, go through
+     JSObject::GetProperty and SetProperty instead.
+     
+     @result SetNamed returns the result of the setter, which is false
+     for a property without one, or true if the property was set
+     through JSObject::SetProperty.
+     
+     @throws Whatever the getter or setter throws, or
+     std::runtime_error if JSObject::GetProperty or SetProperty threw
+     a JavaScript exception.
+     */
+    static JSValue GetNamed(const JSObject& js_object, const JSString& property_name);
+    static bool    SetNamed(JSObject& js_object, const JSString& property_name, const JSValue& js_value);
     
     /*
      @method
      @abstract Erase all constant cache
      */
     static void EvictAllCache();
+    
+    /*
+     @method
+     @abstract Set the number of constant values cached for T across
+     all JSContexts. This clears the cache.
+     */
+    static void ResizeCache(std::uint32_t capacity);
+    
+    /*
+     @method
+     @abstract Return the hit, miss and eviction counts of the
+     constant cache
+     */
+    static detail::JSExportConstantCache::Statistics GetCacheStatistics();
+    
+    /*
+     @method
+     @abstract Forget the property names your HasProperty and
+     GetProperty callbacks reported as absent. Call this when such a
+     property comes into existence.
+     */
+    static void InvalidateNegativePropertyCache();
+    
+    /*!
+     @method
+     
+     @abstract Discard this object's cached value of a property added
+     with AddCachedValueProperty, so that the next read calls its
+     getter again. Call this when the value changes other than through
+     the property's setter.
+     
+     @throws std::invalid_argument if T has no cached value property
+     named property_name.
+     */
+    void Invalidate(const std::string& property_name);
+    
+    /*!
+     @method
+     
+     @abstract Discard this object's cached values of all properties
+     added with AddCachedValueProperty.
+     */
+    void InvalidateAll() HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     
+     @abstract Call callback with each of your C++ objects whose value
+     properties JavaScript wrote since the last drain, and the names of
+     the properties written, e.g. once per frame.
+     
+     @discussion Only classes that call SetTrackDirty(true) are
+     tracked. Each object is visited once per drain however often it
+     was written, in the order of its first write. Writes made while
+     draining are kept for the next drain.
+     
+     The dirty bits of an object are written by the thread running its
+     JavaScript, so drain on that thread, or while it runs none.
+     
+     @result The number of objects visited.
+     */
+    static std::size_t DrainDirty(const std::function<void(T&, const std::vector<std::string>&)>& callback);
+    
+    /*!
+     @method
+     
+     @abstract Return the number of your C++ objects that DrainDirty
+     would visit.
+     */
+    static std::size_t GetDirtyCount();
+    
+    /*!
+     @method
+     @abstract Return the number of live instances of T across all
+     JSContexts, and the bytes they hold, including those reported
+     with JSExportObject::set_external_memory_cost. Counting is always
+     on and costs two relaxed atomic operations per instance.
+     */
+    static JSExportClassStatistics GetClassStatistics() HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     @abstract Set a soft budget for the live instances of T and the
+     bytes they hold, whose callback is called when T goes over it.
+     */
+    static void SetClassBudget(const JSExportClassBudget& budget);
+    
+    /*!
+     @method
+     @abstract Destroy the finalized native objects of T the calling
+     thread keeps for reuse, releasing their JSContexts. See
+     JSExportClassDefinitionBuilder::RecycleCapacity for details.
+     @result The number of native objects destroyed.
+     */
+    static std::size_t PurgeRecycled() HAL_NOEXCEPT;
+    
+    /*!
+     @method
+     @abstract Return the number of finalized native objects of T the
+     calling thread keeps for reuse.
+     */
+    static std::size_t GetRecycledCount() HAL_NOEXCEPT;
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+    /*!
+     @method
+     @abstract Return the latency histogram of one kind of JavaScript to
+     native callback of T, such as CallNamedFunction. Every call of
+     that kind, for every property, function and JSContext, records
+     its duration on a monotonic clock. Only available when HAL is
+     built with HAL_CALLBACK_LATENCY_ENABLE; detail::GetCallbackLatencies
+     returns the histograms of all classes.
+     */
+    static const detail::JSLatencyHistogram& GetCallbackLatency(detail::JSExportCallbackKind kind) HAL_NOEXCEPT;
+#endif
+
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+    /*!
+     @method
+     @abstract Return the number of gets and sets of each value
+     property of T and the number of calls of each function property,
+     with the time they took, the most total time first. Properties
+     that weren't used are left out. Only available when HAL is built
+     with HAL_PROPERTY_PROFILE_ENABLE, which also routes properties
+     bound to member function pointers through the trampolines so
+     they are counted.
+     */
+    static std::vector<detail::JSPropertyProfileEntry> GetPropertyProfile();
+    
+    // Zero the counters of GetPropertyProfile.
+    static void ResetPropertyProfile() HAL_NOEXCEPT;
+#endif
  
     virtual ~JSExport() HAL_NOEXCEPT {
+      detail::JSExportClass<T>::ForgetDirty(dirty_set__);
     }
     
   protected:
@@ -157,6 +366,77 @@ namespace HAL {
      */
     static void SetClassAttribute(JSClassAttribute class_attribute);
     
+    /*!
+     @method
+     
+     @abstract Set whether the constant properties of your JSClass are
+     pinned.
+     
+     @discussion A pinned constant is evaluated once per JSContext and
+     stored as a ReadOnly, DontDelete data property on the prototype of
+     your JSClass, so reading it doesn't call into C++. See
+     JSExportClassDefinitionBuilder::PinConstants for details.
+     */
+    static void SetPinConstants(bool pin_constants);
+    
+    /*!
+     @method
+     
+     @abstract Set whether JavaScript writes to the value properties of
+     your JSClass are tracked for DrainDirty.
+     
+     @discussion A tracked write costs a bit set in the native object,
+     so a setter can just store the value and leave expensive work to
+     the drain. See JSExportClassDefinitionBuilder::TrackDirty for
+     details.
+     */
+    static void SetTrackDirty(bool track_dirty);
+    
+    /*!
+     @method
+     
+     @abstract Set the number of absent property names remembered for
+     your HasProperty and GetProperty callbacks, so that repeated
+     probes for them don't call into C++. The default is 0, which
+     disables the cache. See
+     JSExportClassDefinitionBuilder::NegativePropertyCache for details.
+     */
+    static void SetNegativePropertyCache(std::size_t capacity);
+    
+    /*!
+     @method
+     
+     @abstract Set the number of times a property name must reach your
+     HasProperty, GetProperty or SetProperty callback before it is
+     interned and passed to them as the same, already converted,
+     JSString. The default is 0, which disables interning. See
+     JSExportClassDefinitionBuilder::HotPropertyNames for details.
+     */
+    static void SetHotPropertyNames(std::size_t threshold);
+    
+    /*!
+     @method
+     
+     @abstract Set whether the native objects of your JSClass are
+     queued when finalized and destroyed later in batches by
+     JSExportFinalizer::RunPending, so that their destructors don't run
+     inside a garbage collection. See
+     JSExportClassDefinitionBuilder::DeferredFinalization for details.
+     */
+    static void SetDeferredFinalization(bool deferred_finalization);
+    
+    /*!
+     @method
+     
+     @abstract Set the number of finalized native objects of your
+     JSClass each thread keeps to reuse for new JavaScript objects,
+     instead of destroying them. The default is 0, which disables
+     recycling. T must have a void Recycle() member function that
+     resets an object to its constructed state. See
+     JSExportClassDefinitionBuilder::RecycleCapacity for details.
+     */
+    static void SetRecycleCapacity(std::size_t capacity);
+    
     /*!
      @method
      
@@ -165,6 +445,17 @@ namespace HAL {
      */
     static void SetParent(const JSClass& parent);
     
+    /*!
+     @method
+     
+     @abstract Set the parent of your JSClass and copy the parent's
+     properties into your JSClass, so that JavaScriptCore doesn't walk
+     the JSClass chain to find them. U must be a base class of T. See
+     JSExportClassDefinitionBuilder::FlattenedParent for details.
+     */
+    template<typename U>
+    static void SetFlattenedParent(const detail::JSExportClass<U>& parent);
+    
     /*!
      @method
      
@@ -255,6 +546,37 @@ namespace HAL {
     static void AddConstantProperty(const JSString& property_name,
                                  detail::GetNamedValuePropertyCallback<T> get_callback,
                                  bool enumerable = true);
+    
+    /*!
+     @method
+     
+     @abstract Add a value property like AddValueProperty whose getter
+     result is cached per JavaScript object, for properties that are
+     expensive to compute but rarely change.
+     
+     @discussion The getter is called on the first read, and later
+     reads return the cached value without calling it. The setter
+     always invalidates the cached value, and Invalidate or
+     InvalidateAll do so when the native object changes the value
+     itself. For example:
+     
+     AddCachedValueProperty("layout", std::mem_fn(&Foo::GetLayout), std::mem_fn(&Foo::SetLayout));
+     
+     void Foo::Relayout() {
+       // ...
+       JSExport<Foo>::Invalidate("layout");
+     }
+     
+     See JSExportClassDefinitionBuilder::AddCachedValueProperty for
+     details.
+     
+     @throws std::invalid_argument under the same preconditions as
+     AddValueProperty.
+     */
+    static void AddCachedValueProperty(const JSString& property_name,
+                                       detail::GetNamedValuePropertyCallback<T> get_callback,
+                                       detail::SetNamedValuePropertyCallback<T> set_callback = nullptr,
+                                       bool enumerable = true);
      
     /*!
      @method
@@ -293,6 +615,97 @@ namespace HAL {
      */
     static void AddFunctionProperty(const JSString& function_name, detail::CallNamedFunctionCallback<T> function_callback, bool enumerable = true);
     
+    /*!
+     @method
+     
+     @abstract Add a function property whose callback receives its
+     arguments as a JSArguments view, for example:
+     
+     AddFunctionProperty("scale", [](Foo& foo, const JSArguments& arguments, JSObject&) {
+       return foo.Scale(arguments.ToNumber(0));
+     });
+     
+     @discussion The view reads the arguments without creating a
+     JSValue for each of them. Missing arguments read as undefined.
+     The preconditions are those of the overload above.
+     */
+    static void AddFunctionProperty(const JSString& function_name, detail::CallNamedFunctionArgumentsCallback<T> arguments_callback, bool enumerable = true);
+    
+    /*!
+     @method
+     
+     @abstract Add a value or function property bound directly to
+     member function pointers given as template arguments, for
+     example:
+     
+     AddValueProperty<&Foo::GetName, &Foo::SetName>("name");
+     AddFunctionProperty<&Foo::Hello>("hello");
+     
+     @discussion JavaScriptCore then calls callbacks specialized for
+     the member functions instead of going through std::function. See
+     JSExportClassDefinitionBuilder for details.
+     */
+    template<JSValue (T::*Getter)() const, bool (T::*Setter)(const JSValue&) = nullptr>
+    static void AddValueProperty(const JSString& property_name, bool enumerable = true);
+    template<JSValue (T::*Getter)(), bool (T::*Setter)(const JSValue&) = nullptr>
+    static void AddValueProperty(const JSString& property_name, bool enumerable = true);
+    template<JSValue (T::*Function)(const std::vector<JSValue>&, JSObject&)>
+    static void AddFunctionProperty(const JSString& function_name, bool enumerable = true);
+    template<JSValue (T::*Function)(const JSArguments&, JSObject&)>
+    static void AddFunctionProperty(const JSString& function_name, bool enumerable = true);
+    
+    /*!
+     @method
+     
+     @abstract Build entries of static property tables, for example
+     in Foo::JSExportInitialize:
+     
+     static const ::JSStaticValue foo_values[] = {
+       StaticValue<&Foo::GetName, &Foo::SetName>("name"),
+       EndOfStaticValues()
+     };
+     SetStaticValues(foo_values);
+     
+     @discussion A static table costs nothing to set up at runtime.
+     See JSExportClassDefinitionBuilder::StaticValue for details.
+     */
+    template<JSValue (T::*Getter)() const, bool (T::*Setter)(const JSValue&) = nullptr>
+    static HAL_CONSTEXPR ::JSStaticValue StaticValue(const char* property_name, bool enumerable = true) HAL_NOEXCEPT {
+      return detail::JSExportClassDefinitionBuilder<T>::template StaticValue<Getter, Setter>(property_name, enumerable);
+    }
+    
+    template<JSValue (T::*Getter)(), bool (T::*Setter)(const JSValue&) = nullptr>
+    static HAL_CONSTEXPR ::JSStaticValue StaticValue(const char* property_name, bool enumerable = true) HAL_NOEXCEPT {
+      return detail::JSExportClassDefinitionBuilder<T>::template StaticValue<Getter, Setter>(property_name, enumerable);
+    }
+    
+    static HAL_CONSTEXPR ::JSStaticValue EndOfStaticValues() HAL_NOEXCEPT {
+      return detail::JSExportClassDefinitionBuilder<T>::EndOfStaticValues();
+    }
+    
+    template<JSValue (T::*Function)(const std::vector<JSValue>&, JSObject&)>
+    static HAL_CONSTEXPR ::JSStaticFunction StaticFunction(const char* function_name, bool enumerable = true) HAL_NOEXCEPT {
+      return detail::JSExportClassDefinitionBuilder<T>::template StaticFunction<Function>(function_name, enumerable);
+    }
+    
+    template<JSValue (T::*Function)(const JSArguments&, JSObject&)>
+    static HAL_CONSTEXPR ::JSStaticFunction StaticFunction(const char* function_name, bool enumerable = true) HAL_NOEXCEPT {
+      return detail::JSExportClassDefinitionBuilder<T>::template StaticFunction<Function>(function_name, enumerable);
+    }
+    
+    static HAL_CONSTEXPR ::JSStaticFunction EndOfStaticFunctions() HAL_NOEXCEPT {
+      return detail::JSExportClassDefinitionBuilder<T>::EndOfStaticFunctions();
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the static tables of value and function properties
+     of your JSClass. The tables must outlive your JSClass.
+     */
+    static void SetStaticValues(const ::JSStaticValue* static_values);
+    static void SetStaticFunctions(const ::JSStaticFunction* static_functions);
+    
     /*!
      @method
      
@@ -404,6 +817,59 @@ namespace HAL {
      */
     static void AddSetPropertyCallback(const detail::SetPropertyCallback<T>& set_property_callback);
     
+    /*!
+     @method
+     
+     @abstract Set the callback to invoke when getting the value of an
+     array index property, such as foo[3], from your JavaScript object.
+     
+     @discussion The callback receives the index as an integer, parsed
+     directly from the property name, and is tried before the
+     GetPropertyCallback. Names that aren't canonical array indexes
+     never reach it.
+     
+     For example, given this class definition:
+     
+     class Foo {
+     JSValue GetIndexedProperty(std::uint32_t index) const;
+     };
+     
+     You would call AddGetIndexedPropertyCallback like this:
+     
+     AddGetIndexedPropertyCallback(&Foo::GetIndexedProperty);
+     
+     @result Your callback should return the value at the given index
+     if it exists. Otherwise return native null to forward the request
+     to the GetPropertyCallback (if any) and then to properties added by
+     the AddValueProperty and AddFunctionProperty methods.
+     */
+    static void AddGetIndexedPropertyCallback(const detail::GetIndexedPropertyCallback<T>& get_indexed_property_callback);
+    
+    /*!
+     @method
+     
+     @abstract Set the callback to invoke when setting the value of an
+     array index property, such as foo[3] = 42, on your JavaScript
+     object.
+     
+     @discussion The callback is tried before the SetPropertyCallback.
+     
+     For example, given this class definition:
+     
+     class Foo {
+     bool SetIndexedProperty(std::uint32_t index, const JSValue& value);
+     };
+     
+     You would call AddSetIndexedPropertyCallback like this:
+     
+     AddSetIndexedPropertyCallback(&Foo::SetIndexedProperty);
+     
+     @result Your callback should return true if the value was set.
+     Return false to forward the request to the SetPropertyCallback (if
+     any) and then to properties added by the AddValueProperty method.
+     */
+    static void AddSetIndexedPropertyCallback(const detail::SetIndexedPropertyCallback<T>& set_indexed_property_callback);
+    
     /*!
      @method
      
@@ -542,9 +1008,111 @@ namespace HAL {
      */
     static void AddConvertToTypeCallback(const detail::ConvertToTypeCallback<T>& convert_to_type_callback);
     
+    /*!
+     @method
+     
+     @abstract Set the callback to invoke when converting your
+     JavaScript object to a number or a string, which returns a
+     detail::JSExportPrimitive instead of a JSValue so that the
+     conversion creates no JSValue or JSObject. It is used in place of
+     the callback set by AddConvertToTypeCallback.
+     
+     @discussion For example, given this class definition:
+     
+     class Foo {
+     detail::JSExportPrimitive ConvertToType(JSValue::Type type, const JSObjectView& this_object) const;
+     };
+     
+     You would call AddConvertToTypePrimitiveCallback like this:
+     
+     AddConvertToTypePrimitiveCallback(&Foo::ConvertToType);
+     */
+    static void AddConvertToTypePrimitiveCallback(const detail::ConvertToTypePrimitiveCallback<T>& convert_to_type_primitive_callback);
+    
+    /*!
+     @method
+     
+     @abstract Set the callback that writes your JavaScript object as
+     JSON text for JSON.stringify, in one pass over your C++ object
+     instead of one callback per property.
+     
+     @discussion For example, given this class definition:
+     
+     class Foo {
+     void ToJSON(JSStringBuilder& json) const;
+     };
+     
+     You would call AddToJSONCallback like this:
+     
+     AddToJSONCallback(&Foo::ToJSON);
+     
+     This adds a non-enumerable toJSON function property, so it can't
+     be combined with a property of that name. See
+     JSExportClassDefinitionBuilder::ToJSON for details.
+     */
+    static void AddToJSONCallback(const detail::ToJSONCallback<T>& to_json_callback);
+    
+    /*!
+     @method
+     
+     @abstract Make your JavaScript objects iterable, so that for...of,
+     spread and Array.from walk your C++ object while crossing into
+     native code once per batch of values instead of once per value.
+     
+     @discussion begin is called with your C++ object each time it is
+     iterated and returns a cursor of any copyable type. next_batch is
+     then called with the object and the cursor to append up to
+     batch_size values, and returns false once there are no more. For
+     example, given this class definition:
+     
+     class Foo {
+     std::size_t Begin() const { return 0; }
+     bool NextBatch(std::size_t& position, std::vector<JSValue>& batch, std::size_t batch_size) const;
+     };
+     
+     You would call AddIterator like this:
+     
+     AddIterator([](Foo& foo) { return foo.Begin(); },
+                 [](Foo& foo, std::size_t& position, std::vector<JSValue>& batch, std::size_t batch_size) {
+                   return foo.NextBatch(position, batch, batch_size);
+                 });
+     
+     The cursor must not outlive what it walks, since JavaScript may
+     keep an iterator for as long as it likes. See
+     JSExportClassDefinitionBuilder::Iterator for details.
+     
+     @throws std::invalid_argument if batch_size is zero.
+     */
+    template<typename BeginCallback, typename NextBatchCallback>
+    static void AddIterator(BeginCallback begin, NextBatchCallback next_batch, std::size_t batch_size = 64);
+    
   private:
     
+    static void InitializeClass();
+    
+    // Only JSExportClass reads and fills the cached values, the dirty
+    // bits and the weak handle slot.
+    template<typename U>
+    friend class detail::JSExportClass;
+    
+    // Only JSExportHandle counts the handles.
+    template<typename U>
+    friend class JSExportHandle;
+    
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    detail::JSExportValueCache                       value_cache__;
+    detail::JSExportDirtySet                         dirty_set__;
+    detail::JSExportWeakSlot                         weak_slot__;
+    detail::JSExportHandleState                      handle_state__;
+    detail::JSExportWrapperEntry                     wrapper_entry__;
+#pragma warning(pop)
+    
     static detail::JSExportClassDefinitionBuilder<T> builder__;
+    static detail::JSExportClass<T>                  js_export_class__;
+    static std::atomic<bool>                         js_export_class_initialized__;
   };
   
   template<typename T>
@@ -557,11 +1125,59 @@ namespace HAL {
     builder__.ClassAttribute(class_attribute);
   }
   
+  template<typename T>
+  void JSExport<T>::SetPinConstants(bool pin_constants) {
+    builder__.PinConstants(pin_constants);
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetTrackDirty(bool track_dirty) {
+    builder__.TrackDirty(track_dirty);
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetNegativePropertyCache(std::size_t capacity) {
+    builder__.NegativePropertyCache(capacity);
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetHotPropertyNames(std::size_t threshold) {
+    builder__.HotPropertyNames(threshold);
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetDeferredFinalization(bool deferred_finalization) {
+    builder__.DeferredFinalization(deferred_finalization);
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetRecycleCapacity(std::size_t capacity) {
+    static_assert(detail::JSExportHasRecycle<T>::value, "JSExport<T>::SetRecycleCapacity requires a void Recycle() member function");
+    static_assert(!detail::JSExportHasArgumentsConstructor<T>::value, "JSExport<T>::SetRecycleCapacity does not support (const JSContext&, const JSArguments&) constructors");
+    builder__.RecycleCapacity(capacity);
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetStaticValues(const ::JSStaticValue* static_values) {
+    builder__.StaticValues(static_values);
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetStaticFunctions(const ::JSStaticFunction* static_functions) {
+    builder__.StaticFunctions(static_functions);
+  }
+  
   template<typename T>
   void JSExport<T>::SetParent(const JSClass& parent) {
     builder__.Parent(parent);
   }
   
+  template<typename T>
+  template<typename U>
+  void JSExport<T>::SetFlattenedParent(const detail::JSExportClass<U>& parent) {
+    builder__.FlattenedParent(parent);
+  }
+  
   template<typename T>
   void JSExport<T>::AddValueProperty(const JSString& property_name, detail::GetNamedValuePropertyCallback<T> get_callback, detail::SetNamedValuePropertyCallback<T> set_callback, bool enumerable) {
     builder__.AddValueProperty(property_name, get_callback, set_callback);
@@ -572,11 +1188,45 @@ namespace HAL {
     builder__.AddConstantProperty(property_name, get_callback, enumerable);
   }
   
+  template<typename T>
+  void JSExport<T>::AddCachedValueProperty(const JSString& property_name, detail::GetNamedValuePropertyCallback<T> get_callback, detail::SetNamedValuePropertyCallback<T> set_callback, bool enumerable) {
+    builder__.AddCachedValueProperty(property_name, get_callback, set_callback, enumerable);
+  }
+  
   template<typename T>
   void JSExport<T>::AddFunctionProperty(const JSString& function_name, detail::CallNamedFunctionCallback<T> function_callback, bool enumerable) {
     builder__.AddFunctionProperty(function_name, function_callback, enumerable);
   }
   
+  template<typename T>
+  void JSExport<T>::AddFunctionProperty(const JSString& function_name, detail::CallNamedFunctionArgumentsCallback<T> arguments_callback, bool enumerable) {
+    builder__.AddFunctionProperty(function_name, arguments_callback, enumerable);
+  }
+  
+  template<typename T>
+  template<JSValue (T::*Getter)() const, bool (T::*Setter)(const JSValue&)>
+  void JSExport<T>::AddValueProperty(const JSString& property_name, bool enumerable) {
+    builder__.template AddValueProperty<Getter, Setter>(property_name, enumerable);
+  }
+  
+  template<typename T>
+  template<JSValue (T::*Getter)(), bool (T::*Setter)(const JSValue&)>
+  void JSExport<T>::AddValueProperty(const JSString& property_name, bool enumerable) {
+    builder__.template AddValueProperty<Getter, Setter>(property_name, enumerable);
+  }
+  
+  template<typename T>
+  template<JSValue (T::*Function)(const std::vector<JSValue>&, JSObject&)>
+  void JSExport<T>::AddFunctionProperty(const JSString& function_name, bool enumerable) {
+    builder__.template AddFunctionProperty<Function>(function_name, enumerable);
+  }
+  
+  template<typename T>
+  template<JSValue (T::*Function)(const JSArguments&, JSObject&)>
+  void JSExport<T>::AddFunctionProperty(const JSString& function_name, bool enumerable) {
+    builder__.template AddFunctionProperty<Function>(function_name, enumerable);
+  }
+  
   template<typename T>
   void JSExport<T>::AddHasPropertyCallback(const detail::HasPropertyCallback<T>& has_property_callback) {
     builder__.HasProperty(has_property_callback);
@@ -592,6 +1242,16 @@ namespace HAL {
     builder__.SetProperty(set_property_callback);
   }
   
+  template<typename T>
+  void JSExport<T>::AddGetIndexedPropertyCallback(const detail::GetIndexedPropertyCallback<T>& get_indexed_property_callback) {
+    builder__.GetIndexedProperty(get_indexed_property_callback);
+  }
+  
+  template<typename T>
+  void JSExport<T>::AddSetIndexedPropertyCallback(const detail::SetIndexedPropertyCallback<T>& set_indexed_property_callback) {
+    builder__.SetIndexedProperty(set_indexed_property_callback);
+  }
+  
   template<typename T>
   void JSExport<T>::AddDeletePropertyCallback(const detail::DeletePropertyCallback<T>& delete_property_callback) {
     builder__.DeleteProperty(delete_property_callback);
@@ -613,26 +1273,193 @@ namespace HAL {
   }
   
   template<typename T>
-  detail::JSExportClassDefinitionBuilder<T> JSExport<T>::builder__ = detail::JSExportClassDefinitionBuilder<T>(typeid(T).name());
+  void JSExport<T>::AddConvertToTypePrimitiveCallback(const detail::ConvertToTypePrimitiveCallback<T>& convert_to_type_primitive_callback) {
+    builder__.ConvertToTypePrimitive(convert_to_type_primitive_callback);
+  }
+  
+  template<typename T>
+  void JSExport<T>::AddToJSONCallback(const detail::ToJSONCallback<T>& to_json_callback) {
+    builder__.ToJSON(to_json_callback);
+  }
+  
+  template<typename T>
+  template<typename BeginCallback, typename NextBatchCallback>
+  void JSExport<T>::AddIterator(BeginCallback begin, NextBatchCallback next_batch, std::size_t batch_size) {
+    using Cursor = typename std::decay<typename std::result_of<BeginCallback(T&)>::type>::type;
+    const std::function<Cursor(T&)> begin_callback(begin);
+    const std::function<bool(T&, Cursor&, std::vector<JSValue>&, std::size_t)> next_batch_callback(next_batch);
+    
+    builder__.Iterator([begin_callback, next_batch_callback](T& native_object) -> detail::JSExportNextBatch {
+      // The batch function keeps the cursor, and the JavaScript object
+      // alive through the JSObject it is called with.
+      const auto cursor = std::make_shared<Cursor>(begin_callback(native_object));
+      const auto native_object_ptr = &native_object;
+      return [next_batch_callback, cursor, native_object_ptr](std::vector<JSValue>& batch, std::size_t batch_size) {
+        return next_batch_callback(*native_object_ptr, *cursor, batch, batch_size);
+      };
+    }, batch_size);
+  }
+  
+  template<typename T>
+  detail::JSExportClassDefinitionBuilder<T> JSExport<T>::builder__ = detail::JSExportClassDefinitionBuilder<T>(JSExportClassName<T>::get());
+  
+  template<typename T>
+  detail::JSExportClass<T> JSExport<T>::js_export_class__;
+  
+  template<typename T>
+  std::atomic<bool> JSExport<T>::js_export_class_initialized__ { false };
+  
+  template<typename T>
+  const detail::JSExportClass<T>& JSExport<T>::Class() {
+    // After the first call this is a single acquire load.
+    if (!js_export_class_initialized__.load(std::memory_order_acquire)) {
+      InitializeClass();
+    }
+    
+    return js_export_class__;
+  }
+  
+  template<typename T>
+  JSObject JSExport<T>::Wrap(const JSContext& js_context, const void* native_ptr) {
+    return Wrap(js_context, native_ptr, [](T&) {
+    });
+  }
   
   template<typename T>
-  detail::JSExportClass<T> JSExport<T>::Class() {
-    static detail::JSExportClassDefinition<T> js_export_class_definition;
-    static detail::JSExportClass<T>           js_export_class;
-    static std::once_flag                     of;
+  template<typename Init>
+  JSObject JSExport<T>::Wrap(const JSContext& js_context, const void* native_ptr, Init&& init) {
+    if (native_ptr == nullptr) {
+      detail::ThrowInvalidArgument("JSExport", "Wrap needs a native pointer.");
+    }
+    
+    const auto& js_export_class = Class();
+    const auto  class_info      = &js_export_class.get_class_info();
+    auto&       cache           = detail::JSExportWrapperCache::Get(js_context);
+    if (const auto js_object_ref = cache.Find(js_context, class_info, native_ptr)) {
+      return JSObject(js_context, js_object_ref);
+    }
+    
+    auto js_object = js_context.CreateObject(js_export_class);
+    T& native_object = *js_object.template GetPrivateAs<T>();
+    init(native_object);
+    static_cast<JSExport<T>&>(native_object).wrapper_entry__.Set(js_context, cache.shared_from_this(), class_info, native_ptr, static_cast<JSObjectRef>(js_object));
+    return js_object;
+  }
+  
+  template<typename T>
+  JSValue JSExport<T>::GetNamed(const JSObject& js_object, const JSString& property_name) {
+    Class();
+    return detail::JSExportClass<T>::GetNamed(js_object, property_name);
+  }
+  
+  template<typename T>
+  bool JSExport<T>::SetNamed(JSObject& js_object, const JSString& property_name, const JSValue& js_value) {
+    Class();
+    return detail::JSExportClass<T>::SetNamed(js_object, property_name, js_value);
+  }
+  
+  template<typename T>
+  void JSExport<T>::InitializeClass() {
+    static std::once_flag of;
     std::call_once(of, []() {
       T::JSExportInitialize();
-      js_export_class_definition = builder__.build();
-      js_export_class            = detail::JSExportClass<T>(js_export_class_definition);
+      js_export_class__ = detail::JSExportClass<T>(builder__.build());
+      js_export_class_initialized__.store(true, std::memory_order_release);
     });
-    
-    return js_export_class;
+  }
+  
+  template<typename T>
+  void JSExport<T>::InvalidateNegativePropertyCache() {
+    detail::JSExportClass<T>::InvalidateNegativePropertyCache();
+  }
+  
+  template<typename T>
+  void JSExport<T>::Invalidate(const std::string& property_name) {
+    // The class definition, and with it the property indexes, is
+    // published by Class().
+    Class();
+    detail::JSExportClass<T>::InvalidateCachedValue(static_cast<T&>(*this), property_name);
+  }
+  
+  template<typename T>
+  void JSExport<T>::InvalidateAll() HAL_NOEXCEPT {
+    detail::JSExportClass<T>::InvalidateCachedValues(static_cast<T&>(*this));
+  }
+  
+  template<typename T>
+  std::size_t JSExport<T>::DrainDirty(const std::function<void(T&, const std::vector<std::string>&)>& callback) {
+    return detail::JSExportClass<T>::DrainDirty(callback);
+  }
+  
+  template<typename T>
+  std::size_t JSExport<T>::GetDirtyCount() {
+    return detail::JSExportClass<T>::GetDirtyCount();
   }
   
   template<typename T>
   void JSExport<T>::EvictAllCache() {
     detail::JSExportClass<T>::EvictAllCache();
   }
+  
+  template<typename T>
+  void JSExport<T>::ResizeCache(std::uint32_t capacity) {
+    detail::JSExportClass<T>::ResizeCache(capacity);
+  }
+  
+  template<typename T>
+  detail::JSExportConstantCache::Statistics JSExport<T>::GetCacheStatistics() {
+    return detail::JSExportClass<T>::GetCacheStatistics();
+  }
+  
+  template<typename T>
+  JSExportClassStatistics JSExport<T>::GetClassStatistics() HAL_NOEXCEPT {
+    return detail::JSExportClass<T>::GetClassStatistics();
+  }
+  
+  template<typename T>
+  void JSExport<T>::SetClassBudget(const JSExportClassBudget& budget) {
+    detail::JSExportClass<T>::SetClassBudget(budget);
+  }
+  
+  template<typename T>
+  std::size_t JSExport<T>::PurgeRecycled() HAL_NOEXCEPT {
+    return detail::JSExportClass<T>::PurgeRecycled();
+  }
+  
+  template<typename T>
+  std::size_t JSExport<T>::GetRecycledCount() HAL_NOEXCEPT {
+    return detail::JSExportClass<T>::GetRecycledCount();
+  }
+  
+  template<typename T>
+  JSArray JSContext::CreateObjects(std::size_t count) const {
+    return CreateObjects<T>(count, [](T&, std::size_t) {});
+  }
+  
+  template<typename T, typename Init>
+  JSArray JSContext::CreateObjects(std::size_t count, Init init) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    return detail::JSExportClass<T>::CreateObjects(*this, count, init);
+  }
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+  template<typename T>
+  const detail::JSLatencyHistogram& JSExport<T>::GetCallbackLatency(detail::JSExportCallbackKind kind) HAL_NOEXCEPT {
+    return detail::JSExportClass<T>::GetCallbackLatency(kind);
+  }
+#endif
+
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+  template<typename T>
+  std::vector<detail::JSPropertyProfileEntry> JSExport<T>::GetPropertyProfile() {
+    return detail::JSExportClass<T>::GetPropertyProfile();
+  }
+  
+  template<typename T>
+  void JSExport<T>::ResetPropertyProfile() HAL_NOEXCEPT {
+    detail::JSExportClass<T>::ResetPropertyProfile();
+  }
+#endif
 } // namespace HAL {
 
 #endif // _HAL_JSEXPORT_HPP_
@@ -0,0 +1,182 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTALLOCATOR_HPP_
+#define _HAL_JSEXPORTALLOCATOR_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSExportClassInfo.hpp"
+#include "HAL/detail/JSExportPool.hpp"
+#include "HAL/detail/JSRetainedHandles.hpp"
+#include "HAL/JSExportClassName.hpp"
+#include "HAL/JSContext.hpp"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace HAL {
+  
+  /*!
+   @class
+   
+   @discussion JSExportAllocator<T> provides the memory for the
+   native C++ objects that JSExportClass<T> creates each time
+   JavaScript instantiates the exported class T. The objects are
+   constructed and destroyed in place in that memory.
+   
+   By default memory comes from a per-class slab pool with
+   thread-local free lists (see detail::JSExportPool). To use a
+   different strategy for a class, specialize this template:
+   
+   template<>
+   struct JSExportAllocator<Widget> {
+     static void* Allocate(std::size_t size) {
+       return ::operator new(size);
+     }
+     static void Deallocate(void* ptr, std::size_t size) HAL_NOEXCEPT {
+       ::operator delete(ptr);
+     }
+   };
+   
+   Memory returned by Allocate must be aligned for
+   std::max_align_t.
+   */
+  template<typename T>
+  struct JSExportAllocator {
+    static void* Allocate(std::size_t size) {
+      return detail::JSExportPool<T>::Allocate(size);
+    }
+    
+    static void Deallocate(void* ptr, std::size_t size) HAL_NOEXCEPT {
+      detail::JSExportPool<T>::Deallocate(ptr, size);
+    }
+  };
+  
+} // namespace HAL {
+
+namespace HAL { namespace detail {
+  
+  // Precedes every native object created by CreateNativeObject. The
+  // object that replaces a parent class' native object during
+  // JSObjectInitializeCallback, and the finalizer, only have a void*,
+  // so the header remembers how to destroy it, and which class it
+  // belongs to for JSObjectHasInstanceCallback.
+  struct JSExportNativeObjectHeader {
+    void (*destroy)(void* native_object_ptr);
+    const JSExportClassInfo* class_info;
+  };
+  
+  static_assert(sizeof(JSExportNativeObjectHeader) <= kJSExportNativeObjectHeaderSize, "JSExportNativeObjectHeader does not fit its reserved space");
+  
+  template<typename T>
+  void DestroyNativeObjectOfClass(void* native_object_ptr) HAL_NOEXCEPT {
+#ifdef HAL_TRACK_RETAINED_HANDLES
+    UnRegisterNativeObject(native_object_ptr);
+#endif
+    static_cast<T*>(native_object_ptr) -> ~T();
+    JSExportAllocator<T>::Deallocate(static_cast<char*>(native_object_ptr) - kJSExportNativeObjectHeaderSize, kJSExportNativeObjectHeaderSize + sizeof(T));
+  }
+  
+  /*!
+   @function
+   
+   @abstract Create a T in memory obtained from
+   JSExportAllocator<T>, passing the JSContext and any further
+   arguments to T's constructor.
+   */
+  template<typename T, typename... Args>
+  T* CreateNativeObject(const JSContext& js_context, Args&&... args) {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned JSExport classes are not supported");
+    
+    const auto size   = kJSExportNativeObjectHeaderSize + sizeof(T);
+    const auto memory = static_cast<char*>(JSExportAllocator<T>::Allocate(size));
+    new (memory) JSExportNativeObjectHeader { &DestroyNativeObjectOfClass<T>, nullptr };
+    
+    try {
+      const auto native_object_ptr = new (memory + kJSExportNativeObjectHeaderSize) T(js_context, std::forward<Args>(args)...);
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      RegisterNativeObject(native_object_ptr, JSExportClassName<T>::get());
+#endif
+      return native_object_ptr;
+    } catch (...) {
+      JSExportAllocator<T>::Deallocate(memory, size);
+      throw;
+    }
+  }
+  
+  /*!
+   @function
+   
+   @abstract Destroy a native object created by CreateNativeObject
+   for any class.
+   */
+  inline
+  JSExportNativeObjectHeader* GetNativeObjectHeader(void* native_object_ptr) HAL_NOEXCEPT {
+    return reinterpret_cast<JSExportNativeObjectHeader*>(static_cast<char*>(native_object_ptr) - kJSExportNativeObjectHeaderSize);
+  }
+  
+  inline
+  void DestroyNativeObject(void* native_object_ptr) HAL_NOEXCEPT {
+    const auto header = GetNativeObjectHeader(native_object_ptr);
+    
+    // Only objects that went through JSObjectInitializeCallback have a
+    // class, and were counted as live instances of it.
+    if (header -> class_info) {
+      RemoveJSExportClassInstance(*header -> class_info);
+    }
+    header -> destroy(native_object_ptr);
+  }
+  
+  /*!
+   @function
+   
+   @abstract Queue a native object for JSExportFinalizer::RunPending
+   to destroy on this thread, or destroy it now where thread-local
+   queues aren't supported.
+   */
+  HAL_EXPORT void DeferNativeObjectDestruction(void* native_object_ptr) HAL_NOEXCEPT;
+  
+  /*!
+   @function
+   
+   @abstract Keep a finalized native object of a class on this
+   thread's free list of that class for ReuseNativeObject, unless the
+   free list already holds capacity objects.
+   
+   @result true if the free list took the object.
+   */
+  HAL_EXPORT bool RecycleNativeObject(const JSExportClassInfo& class_info, const JSContext& js_context, void* native_object_ptr, std::size_t capacity) HAL_NOEXCEPT;
+  
+  /*!
+   @function
+   
+   @abstract Take the most recently recycled native object of a class
+   created in js_context off this thread's free list.
+   
+   @result The native object, or nullptr if there is none.
+   */
+  HAL_EXPORT void* ReuseNativeObject(const JSExportClassInfo& class_info, const JSContext& js_context) HAL_NOEXCEPT;
+  
+  /*!
+   @function
+   
+   @abstract Destroy the native objects of a class on this thread's
+   free list.
+   
+   @result The number of native objects destroyed.
+   */
+  HAL_EXPORT std::size_t PurgeRecycledNativeObjects(const JSExportClassInfo& class_info) HAL_NOEXCEPT;
+  
+  // Returns the number of native objects of a class on this thread's
+  // free list.
+  HAL_EXPORT std::size_t GetRecycledNativeObjectCount(const JSExportClassInfo& class_info) HAL_NOEXCEPT;
+  
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_JSEXPORTALLOCATOR_HPP_
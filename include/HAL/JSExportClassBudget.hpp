@@ -0,0 +1,77 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTCLASSBUDGET_HPP_
+#define _HAL_JSEXPORTCLASSBUDGET_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace HAL {
+
+  /*!
+   @struct
+
+   @discussion The live instances of a JSExport class across all
+   JSContexts, and the memory they hold, as returned by
+   JSExport<T>::GetClassStatistics.
+   */
+  struct JSExportClassStatistics {
+    // Native objects created for JavaScript objects of the class that
+    // haven't been destroyed yet, including those whose destruction
+    // is deferred.
+    std::size_t live_count;
+
+    // The memory of those native objects themselves.
+    std::size_t instance_bytes;
+
+    // The bytes they reported with
+    // JSExportObject::set_external_memory_cost.
+    std::size_t external_memory_bytes;
+
+    // The native objects of the class that JavaScriptCore finalized,
+    // since the process started.
+    std::uint64_t finalized_count;
+
+    std::size_t get_total_bytes() const HAL_NOEXCEPT {
+      return instance_bytes + external_memory_bytes;
+    }
+  };
+
+  // The function a JSExport class calls when it goes over its budget.
+  // It runs on the thread that created the instance or reported the
+  // memory that went over, often inside a JavaScriptCore callback, so
+  // it should only record the event, e.g. to shed load, and must not
+  // throw.
+  typedef std::function<void(const JSExportClassStatistics& statistics)> JSExportClassBudgetCallback;
+
+  /*!
+   @struct
+
+   @discussion A soft budget for a JSExport class, set with
+   JSExport<T>::SetClassBudget. Nothing is refused when it is
+   exceeded; the callback is called once each time the class goes
+   from within its budget to over it.
+   */
+  struct JSExportClassBudget {
+    // The most live instances, or zero for no limit.
+    std::size_t live_count { 0 };
+
+    // The most instance and external memory bytes together, or zero
+    // for no limit.
+    std::size_t total_bytes { 0 };
+
+    JSExportClassBudgetCallback callback;
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSEXPORTCLASSBUDGET_HPP_
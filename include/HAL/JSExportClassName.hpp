@@ -0,0 +1,107 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTCLASSNAME_HPP_
+#define _HAL_JSEXPORTCLASSNAME_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <string>
+
+#ifndef HAL_NO_RTTI
+#include <typeinfo>
+#endif
+
+namespace HAL { namespace detail {
+
+  // The type name the compiler puts in the signature of this function,
+  // for a build without RTTI. GCC and clang write "[with T = Widget]"
+  // or "[T = Widget]", and Visual C++ writes
+  // "GetJSExportTypeName<class Widget>(void)".
+  template<typename T>
+  std::string GetJSExportTypeName() {
+#if defined(_MSC_VER)
+    const std::string signature(__FUNCSIG__);
+    const std::string prefix("GetJSExportTypeName<");
+    const auto begin = signature.find(prefix);
+    const auto end   = signature.rfind(">(");
+    if (begin == std::string::npos || end == std::string::npos || end < begin) {
+      return signature;
+    }
+    auto name = signature.substr(begin + prefix.size(), end - begin - prefix.size());
+    for (const auto keyword : { "class ", "struct " }) {
+      if (name.compare(0, std::char_traits<char>::length(keyword), keyword) == 0) {
+        name.erase(0, std::char_traits<char>::length(keyword));
+      }
+    }
+    return name;
+#else
+    const std::string signature(__PRETTY_FUNCTION__);
+    const std::string prefix("T = ");
+    const auto begin = signature.find(prefix);
+    if (begin == std::string::npos) {
+      return signature;
+    }
+    const auto end = signature.find_first_of(";]", begin);
+    return signature.substr(begin + prefix.size(), end == std::string::npos ? std::string::npos : end - begin - prefix.size());
+#endif
+  }
+
+}} // namespace HAL { namespace detail {
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion JSExportClassName gives the name of the C++ class T of
+   a JSExport class, as the name of its JSClass and in every log
+   message and error about it. Declare it with HAL_JSEXPORT_CLASS_NAME
+   at global scope, before the class is defined:
+
+   class Widget;
+   HAL_JSEXPORT_CLASS_NAME(Widget, "Widget")
+
+   class Widget : public JSExportObject, public JSExport<Widget> {
+
+   Undeclared, it is typeid(T).name(), or with HAL_NO_RTTI the name
+   the compiler puts in a function signature, so that a build with
+   -fno-rtti or /GR- works, only with less stable names. Either is
+   computed once per class.
+   */
+  template<typename T>
+  struct JSExportClassName {
+    static const char* get() {
+#ifdef HAL_NO_RTTI
+      static const std::string name = detail::GetJSExportTypeName<T>();
+      return name.c_str();
+#else
+      return typeid(T).name();
+#endif
+    }
+  };
+
+} // namespace HAL {
+
+/*!
+ @define
+
+ @abstract Declare NAME, a string literal, as the JSExportClassName of
+ the fully qualified class T. Use it at global scope, before anything
+ uses JSExport<T>.
+ */
+#define HAL_JSEXPORT_CLASS_NAME(T, NAME)                       \
+  namespace HAL {                                              \
+    template<>                                                 \
+    struct JSExportClassName<T> {                              \
+      static const char* get() { return NAME; }                \
+    };                                                         \
+  }
+
+#endif // _HAL_JSEXPORTCLASSNAME_HPP_
@@ -0,0 +1,61 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTFINALIZER_HPP_
+#define _HAL_JSEXPORTFINALIZER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <limits>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion JSExportFinalizer destroys the native objects of
+   JSExport classes with deferred finalization (see
+   JSExport<T>::SetDeferredFinalization) in batches, outside of the
+   garbage collection that finalized them.
+
+   Each thread has its own queue, filled by the finalizations that run
+   on it, so a thread that owns a JSContextGroup drains its queue
+   itself, e.g. from an idle handler or a delayed task of its
+   JSRunLoop. The objects still queued when a thread exits are
+   destroyed then. Visual C++ 2013 lacks thread_local, so there
+   deferred objects are destroyed right away.
+   */
+  class HAL_EXPORT JSExportFinalizer final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Destroy up to max_count of the native objects queued on
+     the calling thread, most recently finalized first.
+
+     @result The number of native objects destroyed.
+     */
+    static std::size_t RunPending(std::size_t max_count = std::numeric_limits<std::size_t>::max()) HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the number of native objects queued on the
+     calling thread.
+     */
+    static std::size_t get_pending_count() HAL_NOEXCEPT;
+
+    JSExportFinalizer() = delete;
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSEXPORTFINALIZER_HPP_
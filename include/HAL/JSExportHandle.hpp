@@ -0,0 +1,148 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTHANDLE_HPP_
+#define _HAL_JSEXPORTHANDLE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSExportHandleState.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace HAL {
+
+  template<typename T>
+  class JSExport;
+
+  template<typename T>
+  class JSExportWeakHandle;
+
+  class JSObject;
+
+  /*!
+   @class
+
+   @discussion A JSExportHandle<T> shares ownership of the native
+   object of a JSExport class, like the std::shared_ptr<T> returned by
+   JSObject::GetPrivate<T>, but without allocating anything. Its
+   reference count lives in the native object, and while it is
+   non-zero the object's JavaScript object is protected from garbage
+   collection.
+
+   A JSExportHandle is the size of a pointer. Copying or destroying
+   one is an atomic increment or decrement, except for the first and
+   the last handle of a native object, which protect and unprotect its
+   JavaScript object.
+
+   Create one with JSObject::GetPrivateHandle<T>.
+   */
+  template<typename T>
+  class JSExportHandle final {
+
+  public:
+
+    JSExportHandle() HAL_NOEXCEPT {
+    }
+
+    JSExportHandle(std::nullptr_t) HAL_NOEXCEPT {
+    }
+
+    ~JSExportHandle() HAL_NOEXCEPT {
+      if (native_object_ptr__) {
+        GetState(native_object_ptr__).Release();
+      }
+    }
+
+    JSExportHandle(const JSExportHandle& rhs) HAL_NOEXCEPT
+    : native_object_ptr__(rhs.native_object_ptr__) {
+      if (native_object_ptr__) {
+        GetState(native_object_ptr__).RetainCopy();
+      }
+    }
+
+    JSExportHandle(JSExportHandle&& rhs) HAL_NOEXCEPT
+    : native_object_ptr__(rhs.native_object_ptr__) {
+      rhs.native_object_ptr__ = nullptr;
+    }
+
+    JSExportHandle& operator=(JSExportHandle rhs) HAL_NOEXCEPT {
+      swap(rhs);
+      return *this;
+    }
+
+    void swap(JSExportHandle& other) HAL_NOEXCEPT {
+      std::swap(native_object_ptr__, other.native_object_ptr__);
+    }
+
+    T* get() const HAL_NOEXCEPT {
+      return native_object_ptr__;
+    }
+
+    T& operator*() const HAL_NOEXCEPT {
+      return *native_object_ptr__;
+    }
+
+    T* operator->() const HAL_NOEXCEPT {
+      return native_object_ptr__;
+    }
+
+    explicit operator bool() const HAL_NOEXCEPT {
+      return native_object_ptr__ != nullptr;
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of JSExportHandles sharing this
+     handle's native object, or 0 if this handle is empty.
+     */
+    std::uint32_t use_count() const HAL_NOEXCEPT {
+      return native_object_ptr__ ? GetState(native_object_ptr__).get_count() : 0;
+    }
+
+  private:
+
+    // Only JSObject::GetPrivateHandle and JSExportWeakHandle::Lock
+    // create non-empty handles.
+    friend class JSObject;
+    friend class JSExportWeakHandle<T>;
+
+    JSExportHandle(T* native_object_ptr, JSContextRef js_context_ref, JSObjectRef js_object_ref)
+    : native_object_ptr__(native_object_ptr) {
+      if (native_object_ptr__) {
+        GetState(native_object_ptr__).Retain(js_context_ref, js_object_ref);
+      }
+    }
+
+    static detail::JSExportHandleState& GetState(T* native_object_ptr) HAL_NOEXCEPT {
+      return static_cast<JSExport<T>&>(*native_object_ptr).handle_state__;
+    }
+
+    T* native_object_ptr__ { nullptr };
+  };
+
+  template<typename T>
+  void swap(JSExportHandle<T>& first, JSExportHandle<T>& second) HAL_NOEXCEPT {
+    first.swap(second);
+  }
+
+  template<typename T>
+  bool operator==(const JSExportHandle<T>& lhs, const JSExportHandle<T>& rhs) HAL_NOEXCEPT {
+    return lhs.get() == rhs.get();
+  }
+
+  template<typename T>
+  bool operator!=(const JSExportHandle<T>& lhs, const JSExportHandle<T>& rhs) HAL_NOEXCEPT {
+    return !(lhs == rhs);
+  }
+
+} // namespace HAL {
+
+#endif // _HAL_JSEXPORTHANDLE_HPP_
@@ -14,12 +14,15 @@
 #include "HAL/JSString.hpp"
 #include "HAL/JSValue.hpp"
 
+#include <cstddef>
 #include <vector>
 #include <unordered_set>
 
 namespace HAL { namespace detail {
   template<typename T>
   class JSExportClass;
+  
+  struct JSExportClassInfo;
 }}
 
 namespace HAL {
@@ -53,15 +56,29 @@ namespace HAL {
      */
     virtual JSObject get_object() HAL_NOEXCEPT final;
     
+    /*!
+     @method
+     
+     @abstract Set the number of bytes this object holds outside of
+     the JavaScript heap, such as a bitmap or a buffer, so that the
+     garbage collector is paced by the real memory it would free.
+     
+     @discussion Call this again whenever the native allocation grows
+     or shrinks. The cost is charged to the JSContext of this object
+     with JSContext::AdjustExternalMemory and counted in the
+     JSExport<T>::GetClassStatistics of its class, and released when
+     this object is destroyed. It belongs to this object, so it is neither
+     copied nor swapped.
+     */
+    void set_external_memory_cost(std::size_t external_memory_cost) HAL_NOEXCEPT;
+    
+    std::size_t get_external_memory_cost() const HAL_NOEXCEPT;
+    
     JSExportObject(const JSContext& js_context) HAL_NOEXCEPT;
     
     virtual ~JSExportObject() HAL_NOEXCEPT;
-    JSExportObject(const JSExportObject&)            = default;
-    JSExportObject& operator=(const JSExportObject&) = default;
-#ifdef HAL_MOVE_CTOR_AND_ASSIGN_DEFAULT_ENABLE
-    JSExportObject(JSExportObject&&)                 = default;
-    JSExportObject& operator=(JSExportObject&&)      = default;
-#endif
+    JSExportObject(const JSExportObject&)            HAL_NOEXCEPT;
+    JSExportObject& operator=(const JSExportObject&) HAL_NOEXCEPT;
 
     void swap(JSExportObject&) HAL_NOEXCEPT;
     
@@ -90,17 +107,39 @@ namespace HAL {
      @param arguments An optional list of JSValues to initialize your
      JavaScript object with as the result of being called in a
      JavaScript 'new' expression.
+
+     @discussion This isn't called if your class has a constructor
+     taking (const JSContext&, const JSArguments&), because that
+     constructor receives the arguments of the 'new' expression
+     instead.
     */
     virtual void postCallAsConstructor(const JSContext& js_context, const std::vector<JSValue>& arguments);
 		
   private:
     
-    JSContext js_context__;
+    // JSExportClass records the JSObjectRef this object is the
+    // private data of.
+    friend void detail::SetJSExportObjectRef(JSExportObject* js_export_object_ptr, JSObjectRef js_object_ref) HAL_NOEXCEPT;
+    friend void detail::SetJSExportObjectClassInfo(JSExportObject* js_export_object_ptr, const detail::JSExportClassInfo* class_info) HAL_NOEXCEPT;
+    
+    JSContext   js_context__;
+    
+    // The JSObjectRef whose private data is this object, or nullptr if
+    // this object was not created by JSExportClass or its JSObjectRef
+    // has been finalized. It belongs to this address, so it is neither
+    // copied nor swapped.
+    JSObjectRef js_object_ref__ { nullptr };
+    
+    // The bytes charged to js_context__, and to the class this object
+    // was created for by JSExportClass if any, by
+    // set_external_memory_cost.
+    std::size_t external_memory_cost__ { 0 };
+    const detail::JSExportClassInfo* class_info__ { nullptr };
     
 #undef  HAL_JSEXPORTOBJECT_LOCK_GUARD
 #ifdef  HAL_THREAD_SAFE
-    std::recursive_mutex mutex__;
-#define HAL_JSEXPORTOBJECT_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+    detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSExportObject, "JSExportObject");
+#define HAL_JSEXPORTOBJECT_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
 #else
 #define HAL_JSEXPORTOBJECT_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
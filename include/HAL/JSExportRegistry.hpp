@@ -0,0 +1,109 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTREGISTRY_HPP_
+#define _HAL_JSEXPORTREGISTRY_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSExport.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSPropertyAttribute.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion The JSExportRegistry defers the set up of JSExport
+   classes until a script first uses them.
+
+   Registering a class only records its name and a function that
+   creates its object. Install then gives a global object one lazy
+   getter per registered class. JSExport<T>::Class(), and with it
+   T::JSExportInitialize, the JSExportClassDefinitionBuilder and
+   JSClassCreate, runs the first time a script reads the property. The
+   getter then replaces itself with the created object as an ordinary
+   data property, so later reads cost nothing extra.
+
+   Usage:
+
+   JSExportRegistry::Register<Widget>("Widget");
+   JSExportRegistry::Register<Button>("Button");
+   ...
+   JSExportRegistry::Install(js_context);
+   */
+  class HAL_EXPORT JSExportRegistry final {
+
+  public:
+
+    using ObjectFactory = JSObject (*)(const JSContext& js_context);
+
+    /*!
+     @method
+
+     @abstract Register the JSExport class T under a global name. The
+     name's property is given these attributes when it is created.
+     */
+    template<typename T>
+    static void Register(const std::string& name, JSPropertyAttributeSet attributes = JSPropertyAttributeSet()) {
+      Register(name, &CreateObjectOfClass<T>, attributes);
+    }
+
+    /*!
+     @method
+
+     @abstract Register a function that creates the object of a global
+     name. Registering a name again replaces its function.
+
+     @throws std::invalid_argument if name is empty or factory is
+     nullptr.
+     */
+    static void Register(const std::string& name, ObjectFactory factory, JSPropertyAttributeSet attributes = JSPropertyAttributeSet());
+
+    /*!
+     @method
+
+     @abstract Return whether a name is registered.
+     */
+    static bool IsRegistered(const std::string& name);
+
+    /*!
+     @method
+
+     @abstract Return the number of registered names.
+     */
+    static std::size_t size();
+
+    /*!
+     @method
+
+     @abstract Define a lazy getter on the global object of js_context
+     for every registered name.
+
+     @throws std::runtime_error if defining a getter threw a JavaScript
+     exception.
+     */
+    static void Install(const JSContext& js_context);
+
+    JSExportRegistry() = delete;
+
+  private:
+
+    template<typename T>
+    static JSObject CreateObjectOfClass(const JSContext& js_context) {
+      return js_context.CreateObject(JSExport<T>::Class());
+    }
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSEXPORTREGISTRY_HPP_
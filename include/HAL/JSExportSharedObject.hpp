@@ -0,0 +1,128 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTSHAREDOBJECT_HPP_
+#define _HAL_JSEXPORTSHAREDOBJECT_HPP_
+
+#include "HAL/JSExportObject.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <memory>
+#include <type_traits>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSExportSharedObject is a base class for C++ classes
+   whose JavaScript objects, in any number of JSContexts, all read one
+   immutable native object S, such as a font catalog or a snapshot of
+   a configuration.
+
+   Each JavaScript object still gets its own small native object T,
+   since that records its JSContext and JSObjectRef, but T holds the S
+   by a std::shared_ptr<const S> instead of a copy, so S is built once
+   and its memory is shared by all of them. Create the objects with
+   JSContext::CreateSharedObject<T>, and implement the callbacks of T
+   in terms of get_shared().
+
+   JSExportSharedObject is not exported itself, so the parent of T is
+   JSExport<JSExportObject>::Class().
+   */
+  template<typename S>
+  class JSExportSharedObject : public JSExportObject {
+
+  public:
+
+    using shared_type = S;
+
+    /*!
+     @method
+
+     @abstract Return the shared native object.
+
+     @throws std::runtime_error if this object was not created by
+     JSContext::CreateSharedObject.
+     */
+    const S& get_shared() const {
+      if (!shared__) {
+        detail::ThrowRuntimeError("JSExportSharedObject", "This object was not created by JSContext::CreateSharedObject.");
+      }
+      return *shared__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return the shared native object, or nullptr if this
+     object was not created by JSContext::CreateSharedObject.
+     */
+    const std::shared_ptr<const S>& get_shared_ptr() const HAL_NOEXCEPT {
+      return shared__;
+    }
+
+    // The shared native object is already set when the constructor of
+    // T runs.
+    JSExportSharedObject(const JSContext& js_context) HAL_NOEXCEPT
+    : JSExportObject(js_context) {
+      if (pending_shared__) {
+        shared__ = *pending_shared__;
+        pending_shared__ = nullptr;
+      }
+    }
+
+    virtual ~JSExportSharedObject() HAL_NOEXCEPT {
+    }
+
+  private:
+
+    friend class JSContext;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<const S> shared__;
+#pragma warning(pop)
+
+    // The shared native object of the next JSExportSharedObject
+    // constructed on this thread, passed by CreateSharedObject the
+    // way JSExportClass passes constructor arguments.
+    static HAL_THREAD_LOCAL const std::shared_ptr<const S>* pending_shared__;
+  };
+
+  template<typename S>
+  HAL_THREAD_LOCAL const std::shared_ptr<const S>* JSExportSharedObject<S>::pending_shared__ = nullptr;
+
+  template<typename T, typename S>
+  JSObject JSContext::CreateSharedObject(std::shared_ptr<const S> shared) const {
+    static_assert(std::is_base_of<JSExportSharedObject<S>, T>::value, "T must derive from JSExportSharedObject<S>");
+    if (!shared) {
+      detail::ThrowInvalidArgument("JSContext", "CreateSharedObject needs a shared object.");
+    }
+
+    struct PendingSharedGuard {
+      ~PendingSharedGuard() {
+        JSExportSharedObject<S>::pending_shared__ = nullptr;
+      }
+    } guard;
+
+    JSExportSharedObject<S>::pending_shared__ = &shared;
+    auto js_object = CreateObject(JSExport<T>::Class());
+
+    // A native object reused from JSExportClassDefinitionBuilder's
+    // RecycleCapacity isn't constructed again, so set it here too.
+    JSExportSharedObject<S>& native_object = *static_cast<T*>(js_object.GetPrivate());
+    native_object.shared__ = std::move(shared);
+    return js_object;
+  }
+
+} // namespace HAL {
+
+#endif // _HAL_JSEXPORTSHAREDOBJECT_HPP_
@@ -0,0 +1,99 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSEXPORTWEAKHANDLE_HPP_
+#define _HAL_JSEXPORTWEAKHANDLE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSExportSlotTable.hpp"
+#include "HAL/JSExportHandle.hpp"
+
+namespace HAL {
+
+  class JSObject;
+
+  /*!
+   @class
+
+   @discussion A JSExportWeakHandle<T> names the native object of a
+   JSExport class without keeping it alive, for asynchronous native
+   code that must find out whether the object it started working for
+   is still there when it finishes.
+
+   A weak handle is an index into a process-wide slot table and the
+   generation of the slot. Finalizing the JavaScript object bumps the
+   generation, so once it is finalized Lock fails with a load and a
+   compare, without creating any JavaScript object, unlike the error
+   object JSObject::FindJSObjectFromPrivateData returns when it finds
+   nothing. Before that, Lock checks the slot's weak reference, which
+   the garbage collector clears as soon as it finds the object dead.
+
+   Copying a weak handle is copying two integers, and it may be
+   passed to any thread. Lock must be called on the thread that runs
+   the object's JSContext, e.g. in a task posted to its JSRunLoop, so
+   that the object isn't finalized while it is locked.
+
+   Create one with JSObject::GetWeakHandle<T>.
+   */
+  template<typename T>
+  class JSExportWeakHandle final {
+
+  public:
+
+    JSExportWeakHandle() HAL_NOEXCEPT {
+    }
+
+    /*!
+     @method
+
+     @abstract Return a JSExportHandle<T> sharing ownership of the
+     native object, or an empty one if its JavaScript object was
+     collected or this handle is empty.
+     
+     @discussion The object counts as collected as soon as the garbage
+     collector finds it dead, before it is finalized, so that Lock
+     never brings back an object JavaScript can no longer reach.
+     */
+    JSExportHandle<T> Lock() const {
+      detail::JSExportSlotValue value;
+      if (!detail::LockJSExportSlot(reference__, value)) {
+        return JSExportHandle<T>();
+      }
+      return JSExportHandle<T>(static_cast<T*>(value.native_object_ptr), value.js_global_context_ref, value.js_object_ref);
+    }
+
+    /*!
+     @method
+
+     @abstract Return whether the JavaScript object of this handle was
+     finalized, or this handle is empty.
+     
+     @discussion Unlike Lock, this may be called on any thread, and so
+     only sees the object go once it is finalized. An object that
+     isn't expired may still fail to lock.
+     */
+    bool expired() const HAL_NOEXCEPT {
+      detail::JSExportSlotValue value;
+      return !detail::FindJSExportSlot(reference__, value);
+    }
+
+  private:
+
+    // Only JSObject::GetWeakHandle creates non-empty weak handles.
+    friend class JSObject;
+
+    explicit JSExportWeakHandle(detail::JSExportSlotReference reference) HAL_NOEXCEPT
+    : reference__(reference) {
+    }
+
+    detail::JSExportSlotReference reference__;
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSEXPORTWEAKHANDLE_HPP_
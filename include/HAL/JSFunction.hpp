@@ -10,8 +10,9 @@
 #define _HAL_JSFUNCTION_HPP_
 
 #include "HAL/JSObject.hpp"
+#include <atomic>
+#include <cstddef>
 #include <functional>
-#include <unordered_map>
 
 namespace HAL {
 
@@ -24,39 +25,47 @@ namespace HAL {
   to execute a script repeatedly to avoid the cost of re-parsing the
   script before each execution.
 
+  A JSFunction may instead call a C++ callback, which the function
+  object keeps in its private data until it is garbage collected, so
+  that calling it looks nothing up.
+
   The only way to create a JSFunction is by using the
   JSContext::CreateFunction member function.
 */
 class HAL_EXPORT JSFunction final : public JSObject HAL_PERFORMANCE_COUNTER2(JSFunction) {
 
 public:
-    
-    static void RegisterJSFunctionCallback(JSObjectRef js_object_ref, JSFunctionCallback);
-    static void UnRegisterJSFunctionCallback(JSObjectRef js_object_ref);
-    static JSFunctionCallback FindJSFunctionCallback(JSObjectRef js_object_ref);
 
     virtual ~JSFunction() HAL_NOEXCEPT;
 
 private:
-    
+
     // Only a JSContext can create a JSFunction.
     friend JSContext;
-    
+
+    // Counts callback_count__.
+    friend JSContextGroup;
+
     JSFunction(const JSContext& js_context, const JSString& body, const std::vector<JSString>& parameter_names, const JSString& function_name, const JSString& source_url, int starting_line_number);
     JSFunction(const JSContext& js_context, const JSString& function_name, const JSFunctionCallback& callback);
+    JSFunction(const JSContext& js_context, const JSString& function_name, const JSFunctionArgumentsCallback& callback);
+
+    // For a function JSContext::CreateFunction already made.
+    JSFunction(const JSContext& js_context, JSObjectRef js_object_ref);
 
     static JSObjectRef MakeFunction(const JSContext& js_context, const JSString& body, const std::vector<JSString>& parameter_names, const JSString& function_name, const JSString& source_url, int starting_line_number);
 
-    static JSValueRef  JSObjectCallAsFunctionCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
-    static JSObjectRef MakeFunction(const JSContext& js_context, const JSString& function_name, const JSFunctionCallback& callback);
+    // The private data of a function made for a callback. Only one of
+    // the callbacks is set.
+    struct CallbackData;
 
-    // Silence 4251 on Windows since private member variables do not
-    // need to be exported from a DLL.
-#pragma warning(push)
-#pragma warning(disable: 4251)
-    static std::unordered_map<std::intptr_t, JSFunctionCallback> js_object_ref_to_js_function__;
-#pragma warning(pop)
+    static JSObjectRef MakeFunction(const JSContext& js_context, const JSString& function_name, CallbackData* callback_data);
+    static JSClassRef  GetCallbackClass();
+    static JSValueRef  JSObjectCallAsFunctionCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
+    static void        JSObjectFinalizeCallback(JSObjectRef function_ref);
 
+    // The number of callbacks not yet garbage collected.
+    static std::atomic<std::size_t> callback_count__;
 };
 
 } // namespace HAL {
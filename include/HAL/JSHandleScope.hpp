@@ -0,0 +1,136 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSHANDLESCOPE_HPP_
+#define _HAL_JSHANDLESCOPE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+  class JSValueRetainRegistry;
+}}
+
+namespace HAL {
+
+  class JSValue;
+
+  /*!
+   @class
+
+   @discussion A JSHandleScope is a stack-only RAII object that
+   changes how JSValues created while it is alive keep their
+   JSValueRef alive.
+
+   Normally every JSValue constructor, copy and destructor updates the
+   retain registry of its JSContext, which calls
+   JSValueProtect/JSValueUnprotect.
+   Inside a JSHandleScope a JSValue instead claims a slot in a fixed
+   size array stored inline in the JSHandleScope itself. Since the
+   JSHandleScope lives on the machine stack, JavaScriptCore's
+   conservative stack scan keeps those JSValueRefs alive without any
+   explicit protection.
+
+   When the JSHandleScope is destroyed, any JSValue created inside it
+   that is still alive (i.e. it escaped the scope, for example by
+   being returned or stored in a member variable) is promoted to the
+   retain registry of its JSContext and becomes an ordinary protected
+   JSValue.
+
+   JSHandleScopes nest, also with JSArenas. Once a scope's slots are
+   exhausted JSValues fall back to an enclosing JSArena, or to the
+   ordinary protected path.
+
+   A JSValue created inside a JSHandleScope must not be handed to
+   another thread before the scope is destroyed.
+
+   Usage:
+
+   JSHandleScope scope;
+   auto args = detail::to_vector(js_context, argument_count, arguments);
+   ...
+   */
+  class HAL_EXPORT JSHandleScope final {
+
+  public:
+
+    JSHandleScope() HAL_NOEXCEPT;
+    ~JSHandleScope() HAL_NOEXCEPT;
+
+    JSHandleScope(const JSHandleScope&)            = delete;
+    JSHandleScope(JSHandleScope&&)                 = delete;
+    JSHandleScope& operator=(const JSHandleScope&) = delete;
+    JSHandleScope& operator=(JSHandleScope&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Return the number of slots this scope has handed out.
+     */
+    std::size_t size() const HAL_NOEXCEPT {
+      return size__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return the maximum number of JSValues this scope can
+     track before falling back to JSValueProtect.
+     */
+    static std::size_t capacity() HAL_NOEXCEPT {
+      return kCapacity;
+    }
+
+  private:
+
+    // Only JSValue uses the slot bookkeeping.
+    friend class JSValue;
+
+    // Arena ids come from the same sequence.
+    friend class JSArena;
+
+    static std::uint64_t NextId() HAL_NOEXCEPT;
+
+    // Claim a slot for js_value_ref in the innermost active scope, or
+    // in the innermost JSArena if it is nested inside that scope or the
+    // scope is full. Return false if neither takes it.
+    static bool Track(detail::JSValueRetainRegistry* js_value_retain_registry, JSContextRef js_context_ref, JSValueRef js_value_ref, std::uint64_t& scope_id, std::uint32_t& slot) HAL_NOEXCEPT;
+
+    // Increment or decrement the count of a slot in the still active
+    // scope, or JSArena, identified by scope_id. Return false if it has
+    // already been destroyed.
+    static bool Retain(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT;
+    static bool Release(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT;
+
+    static JSHandleScope* Find(std::uint64_t scope_id) HAL_NOEXCEPT;
+
+    // Prevent heap based objects, otherwise the conservative stack scan
+    // would not see the slots.
+    static void * operator new(std::size_t);     // #1: To prevent allocation of scalar objects
+    static void * operator new [] (std::size_t); // #2: To prevent allocation of array of objects
+
+    struct Slot {
+      detail::JSValueRetainRegistry* js_value_retain_registry;
+      JSContextRef                   js_context_ref;
+      JSValueRef                     js_value_ref;
+      std::size_t                    count;
+    };
+
+    static const std::size_t kCapacity = 256;
+
+    JSHandleScope* previous__;
+    std::uint64_t  id__;
+    std::size_t    size__ { 0 };
+    Slot           slots__[kCapacity];
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSHANDLESCOPE_HPP_
@@ -0,0 +1,116 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSIDLEGARBAGECOLLECTOR_HPP_
+#define _HAL_JSIDLEGARBAGECOLLECTOR_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSRunLoop.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace HAL {
+
+  /*!
+   @struct
+
+   @discussion The budgets of a JSIdleGarbageCollector.
+   */
+  struct JSIdleGarbageCollectorOptions {
+    // The shortest idle gap a full collection is started in. It grows
+    // to the duration of the last full collection if that took longer.
+    std::chrono::steady_clock::duration full_collection_budget { std::chrono::milliseconds(10) };
+
+    // The shortest idle gap an eden collection is started in. Eden
+    // collections are only available in DEBUG builds.
+    std::chrono::steady_clock::duration eden_collection_budget { std::chrono::milliseconds(2) };
+
+    // The values created, as counted by
+    // JSContext::get_value_allocation_count, that make a full
+    // collection worthwhile.
+    std::uint64_t full_collection_allocation_threshold { 10000 };
+
+    // The values created that make an eden collection worthwhile.
+    std::uint64_t eden_collection_allocation_threshold { 1000 };
+
+    // The growth of JSContext::get_external_memory_size, in bytes, that
+    // makes a full collection worthwhile.
+    std::size_t full_collection_external_memory_threshold { 8 * 1024 * 1024 };
+
+    // The longest time without a full collection, while anything is
+    // allocated, before the next idle gap that fits one is used anyway.
+    std::chrono::steady_clock::duration maximum_interval { std::chrono::seconds(5) };
+  };
+
+  /*!
+   @class
+
+   @discussion A JSIdleGarbageCollector moves garbage collection of a
+   JSRunLoop's JSContext into the gaps between its tasks, so that the
+   collections an application would otherwise trigger on a timer
+   don't land in the middle of a frame or a request.
+
+   It installs itself as the idle handler of the run loop. Each time
+   RunFor runs out of tasks it compares how much has been allocated
+   since the last collection with its thresholds, and how long the
+   run loop would sleep with its budgets, and then collects in the gap
+   or waits for a better one. It never collects while DeferUntil is in
+   effect.
+
+   Copies of a JSIdleGarbageCollector share the same state, and the
+   idle handler does nothing once the last copy is destroyed. It must
+   only be used on the run loop's thread.
+   */
+  class HAL_EXPORT JSIdleGarbageCollector final HAL_PERFORMANCE_COUNTER1(JSIdleGarbageCollector) {
+
+  public:
+
+    explicit JSIdleGarbageCollector(const JSRunLoop& js_run_loop, const JSIdleGarbageCollectorOptions& options = JSIdleGarbageCollectorOptions());
+
+    /*!
+     @method
+
+     @abstract Don't collect before time_point, e.g. until the end of
+     a latency critical frame or request.
+     */
+    void DeferUntil(std::chrono::steady_clock::time_point time_point) const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the number of full collections done in idle
+     gaps.
+     */
+    std::size_t get_full_collection_count() const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the number of eden collections done in idle
+     gaps, always zero outside of DEBUG builds.
+     */
+    std::size_t get_eden_collection_count() const HAL_NOEXCEPT;
+
+    JSIdleGarbageCollectorOptions get_options() const HAL_NOEXCEPT;
+
+  private:
+
+    struct State;
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSIDLEGARBAGECOLLECTOR_HPP_
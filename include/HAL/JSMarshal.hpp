@@ -0,0 +1,301 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSMARSHAL_HPP_
+#define _HAL_JSMARSHAL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSUtil.hpp"
+#include "HAL/JSArray.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSObjectTemplate.hpp"
+#include "HAL/JSPropertyAttribute.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion Specialize JSMarshalTraits for a plain data type to
+   declare its fields once, by passing each field's name and member
+   pointer to a visitor:
+
+   struct Point {
+     double      x;
+     double      y;
+     std::string label;
+   };
+
+   namespace HAL {
+     template<>
+     struct JSMarshalTraits<Point> {
+       template<typename Visitor>
+       static void VisitFields(Visitor& visitor) {
+         visitor("x", &Point::x);
+         visitor("y", &Point::y);
+         visitor("label", &Point::label, JSPropertyAttribute::ReadOnly);
+       }
+     };
+   }
+
+   JSMarshal<Point> then converts between Point and JSObject. A field
+   may be a bool, an arithmetic type, std::string, JSValue, another
+   type with JSMarshalTraits, or a std::vector of any of these.
+   */
+  template<typename T>
+  struct JSMarshalTraits;
+
+  template<typename T>
+  class JSMarshal;
+
+} // namespace HAL {
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion JSMarshalValue<U> converts a field of type U to and
+   from a JSValue. The primary template handles nested types with
+   JSMarshalTraits.
+   */
+  template<typename U, typename Enable = void>
+  struct JSMarshalValue {
+    static JSValue ToJSValue(const JSContext& js_context, const U& value) {
+      return JSMarshal<U>::ToJSObject(js_context, value);
+    }
+
+    static U FromJSValue(const JSValue& js_value) {
+      return JSMarshal<U>::FromJSValue(js_value);
+    }
+  };
+
+  template<>
+  struct JSMarshalValue<bool> {
+    static JSValue ToJSValue(const JSContext& js_context, bool value) {
+      return js_context.CreateBoolean(value);
+    }
+
+    static bool FromJSValue(const JSValue& js_value) {
+      return static_cast<bool>(js_value);
+    }
+  };
+
+  // Integers of up to 32 bits follow the ECMAScript ToInt32 rules,
+  // like native method arguments. Wider integers truncate the number
+  // toward zero.
+  template<typename U>
+  struct JSMarshalValue<U, typename std::enable_if<std::is_arithmetic<U>::value && !std::is_same<U, bool>::value>::type> {
+    static JSValue ToJSValue(const JSContext& js_context, U value) {
+      return js_context.CreateNumber(static_cast<double>(value));
+    }
+
+    static U FromJSValue(const JSValue& js_value) {
+      return Convert(js_value, std::integral_constant<int, std::is_floating_point<U>::value ? 0 : (sizeof(U) <= sizeof(std::int32_t) ? 1 : 2)>());
+    }
+
+  private:
+
+    static U Convert(const JSValue& js_value, std::integral_constant<int, 0>) {
+      return static_cast<U>(static_cast<double>(js_value));
+    }
+
+    static U Convert(const JSValue& js_value, std::integral_constant<int, 1>) {
+      return static_cast<U>(static_cast<std::int32_t>(js_value));
+    }
+
+    static U Convert(const JSValue& js_value, std::integral_constant<int, 2>) {
+      const auto number = static_cast<double>(js_value);
+      return std::isfinite(number) ? static_cast<U>(number) : U(0);
+    }
+  };
+
+  template<>
+  struct JSMarshalValue<std::string> {
+    static JSValue ToJSValue(const JSContext& js_context, const std::string& value) {
+      return js_context.CreateString(value);
+    }
+
+    static std::string FromJSValue(const JSValue& js_value) {
+      return static_cast<std::string>(js_value);
+    }
+  };
+
+  template<>
+  struct JSMarshalValue<JSValue> {
+    static JSValue ToJSValue(const JSContext&, const JSValue& value) {
+      return value;
+    }
+
+    static JSValue FromJSValue(const JSValue& js_value) {
+      return js_value;
+    }
+  };
+
+  // A vector of numbers or bools becomes an Array in one
+  // JSObjectMakeArray call. Other elements are converted one by one.
+  template<typename U>
+  struct JSMarshalValue<std::vector<U>> {
+    static JSValue ToJSValue(const JSContext& js_context, const std::vector<U>& value) {
+      return ToJSArray(js_context, value, std::is_arithmetic<U>());
+    }
+
+    static std::vector<U> FromJSValue(const JSValue& js_value) {
+      std::vector<U> result;
+      if (!js_value.IsObject()) {
+        return result;
+      }
+
+      const auto js_array = static_cast<JSArray>(static_cast<JSObject>(js_value));
+      result.reserve(js_array.GetLength());
+      js_array.ForEach([&result](const JSValue& element, std::uint32_t) {
+        result.push_back(JSMarshalValue<U>::FromJSValue(element));
+        return true;
+      });
+      return result;
+    }
+
+  private:
+
+    static JSValue ToJSArray(const JSContext& js_context, const std::vector<U>& value, std::true_type) {
+      return js_context.CreateArray(value.begin(), value.end());
+    }
+
+    static JSValue ToJSArray(const JSContext& js_context, const std::vector<U>& value, std::false_type) {
+      std::vector<JSValue> elements;
+      elements.reserve(value.size());
+      for (const auto& element : value) {
+        elements.push_back(JSMarshalValue<U>::ToJSValue(js_context, element));
+      }
+      return js_context.CreateArray(elements);
+    }
+  };
+
+  // The visitors JSMarshal passes to JSMarshalTraits<T>::VisitFields.
+  struct JSMarshalPropertyCollector {
+    template<typename T, typename U>
+    void operator()(const char* name, U T::*, JSPropertyAttributeSet attributes = JSPropertyAttributeSet()) {
+      properties.emplace_back(name, attributes);
+    }
+
+    std::vector<JSObjectTemplate::Property> properties;
+  };
+
+  template<typename T>
+  struct JSMarshalValueCollector {
+    template<typename U>
+    void operator()(const char*, U T::* member, JSPropertyAttributeSet = JSPropertyAttributeSet()) {
+      values.push_back(JSMarshalValue<U>::ToJSValue(js_context, native_object.*member));
+    }
+
+    const JSContext&     js_context;
+    const T&             native_object;
+    std::vector<JSValue> values;
+  };
+
+  template<typename T>
+  struct JSMarshalValueAssigner {
+    template<typename U>
+    void operator()(const char*, U T::* member, JSPropertyAttributeSet = JSPropertyAttributeSet()) {
+      native_object.*member = JSMarshalValue<U>::FromJSValue(values[index++]);
+    }
+
+    const std::vector<JSValue>& values;
+    T&                          native_object;
+    std::size_t                 index;
+  };
+
+}} // namespace HAL { namespace detail {
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion JSMarshal<T> converts a plain data type with
+   JSMarshalTraits to and from a JSObject.
+
+   The field names are converted to JSStrings once per type, and
+   their attributes resolved at the same time, in a JSObjectTemplate
+   that gives every marshalled object the same shape. Reading an
+   object back gets all of its fields with one
+   JSObject::GetProperties call.
+   */
+  template<typename T>
+  class JSMarshal final {
+
+  public:
+
+    static JSObject ToJSObject(const JSContext& js_context, const T& native_object) {
+      detail::JSMarshalValueCollector<T> collector { js_context, native_object, std::vector<JSValue>() };
+      collector.values.reserve(GetShape().property_names.size());
+      JSMarshalTraits<T>::VisitFields(collector);
+      return GetShape().js_object_template.Instantiate(js_context, collector.values);
+    }
+
+    static T FromJSObject(const JSObject& js_object) {
+      const auto values = js_object.GetProperties(GetShape().property_names);
+      T native_object;
+      detail::JSMarshalValueAssigner<T> assigner { values, native_object, 0 };
+      JSMarshalTraits<T>::VisitFields(assigner);
+      return native_object;
+    }
+
+    /*!
+     @method
+
+     @abstract Convert a JSValue to T.
+
+     @throws std::runtime_error if the JSValue isn't an object.
+     */
+    static T FromJSValue(const JSValue& js_value) {
+      if (!js_value.IsObject()) {
+        detail::ThrowRuntimeError("JSMarshal", "JSValue is not an object.");
+      }
+
+      return FromJSObject(static_cast<JSObject>(js_value));
+    }
+
+  private:
+
+    struct Shape {
+      JSObjectTemplate      js_object_template;
+      std::vector<JSString> property_names;
+    };
+
+    static Shape MakeShape() {
+      detail::JSMarshalPropertyCollector collector;
+      JSMarshalTraits<T>::VisitFields(collector);
+
+      std::vector<JSString> property_names;
+      property_names.reserve(collector.properties.size());
+      for (const auto& property : collector.properties) {
+        property_names.emplace_back(property.name);
+      }
+      return Shape { JSObjectTemplate(collector.properties), std::move(property_names) };
+    }
+
+    static const Shape& GetShape() {
+      static const Shape shape = MakeShape();
+      return shape;
+    }
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSMARSHAL_HPP_
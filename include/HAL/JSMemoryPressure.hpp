@@ -0,0 +1,160 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSMEMORYPRESSURE_HPP_
+#define _HAL_JSMEMORYPRESSURE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace HAL {
+
+  /*!
+   @enum
+
+   @abstract How hard the system is asking the process to free memory,
+   e.g. from a low-memory warning.
+
+   @constant Low Evict a quarter of every cache.
+
+   @constant Moderate Evict half of every cache.
+
+   @constant Critical Evict every cache entirely.
+   */
+  enum class JSMemoryPressureLevel : std::uint8_t {
+    Low,
+    Moderate,
+    Critical
+  };
+
+  /*!
+   @struct
+
+   @discussion What JSMemoryPressure::Respond freed.
+   */
+  struct JSMemoryPressureResult {
+    // The approximate bytes the evicted cache entries used outside the
+    // JavaScript heap.
+    std::size_t cache_bytes_reclaimed { 0 };
+
+    // The native objects of JSExport classes with deferred
+    // finalization destroyed on the calling thread.
+    std::size_t finalized_count { 0 };
+
+    // The context groups collected.
+    std::size_t collected_context_group_count { 0 };
+
+    // With HAL_MEMORY_USAGE_STATISTICS_ENABLE, by how much the
+    // collections shrank the JavaScript heaps. Otherwise
+    // has_heap_statistics is false and heap_bytes_reclaimed is zero.
+    bool        has_heap_statistics  { false };
+    std::size_t heap_bytes_reclaimed { 0 };
+
+    std::size_t get_bytes_reclaimed() const HAL_NOEXCEPT {
+      return cache_bytes_reclaimed + heap_bytes_reclaimed;
+    }
+  };
+
+  // A cache's response to memory pressure: evict the given fraction of
+  // its entries, least recently used first, and return the approximate
+  // bytes they used outside the JavaScript heap.
+  typedef std::function<std::size_t(double fraction)> JSMemoryPressureHandler;
+
+  /*!
+   @class
+
+   @discussion JSMemoryPressure sheds HAL's caches together when the
+   system runs low on memory, so that an application can answer a
+   low-memory warning with one call instead of an OOM termination.
+
+   Respond evicts, in proportion to the level, the constants cached by
+   every JSExport class, the function and RegExp caches of every
+   JSContext, and every cache registered with AddHandler, which
+   includes each JSScriptCache and the idle contexts of each
+   JSContextPool. It then destroys the native objects whose deferred
+   finalization is queued on the calling thread, and collects each
+   context group once so that the evicted values are freed.
+
+   JSExport object wrappers aren't evicted, since their cache doesn't
+   keep them alive.
+
+   Respond must be called on the thread that uses the JSContexts,
+   unless HAL is built with HAL_THREAD_SAFE, e.g. by posting it to
+   their JSRunLoop from the warning's handler.
+   */
+  class HAL_EXPORT JSMemoryPressure final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Shed HAL's caches in proportion to level, drain the
+     deferred finalizers of the calling thread and collect garbage.
+     */
+    static JSMemoryPressureResult Respond(JSMemoryPressureLevel level);
+
+    /*!
+     @method
+
+     @abstract Register a cache to evict under memory pressure.
+
+     @result An id for RemoveHandler, never zero.
+     */
+    static std::uint64_t AddHandler(JSMemoryPressureHandler handler);
+
+    /*!
+     @method
+
+     @abstract Unregister a cache. May be called from inside a handler.
+     */
+    static void RemoveHandler(std::uint64_t id) HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the fraction of every cache that level evicts.
+     */
+    static double GetEvictionFraction(JSMemoryPressureLevel level) HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return how many of size entries to evict for fraction,
+     rounded up so that any pressure evicts something.
+     */
+    static std::size_t GetEvictionCount(std::size_t size, double fraction) HAL_NOEXCEPT {
+      if (fraction <= 0) {
+        return 0;
+      }
+      if (fraction >= 1) {
+        return size;
+      }
+      return static_cast<std::size_t>(std::ceil(static_cast<double>(size) * fraction));
+    }
+
+    JSMemoryPressure() = delete;
+  };
+
+  /*!
+   @function
+
+   @abstract The entry point for a low-memory warning, equivalent to
+   JSMemoryPressure::Respond.
+   */
+  inline JSMemoryPressureResult OnMemoryPressure(JSMemoryPressureLevel level) {
+    return JSMemoryPressure::Respond(level);
+  }
+
+} // namespace HAL {
+
+#endif // _HAL_JSMEMORYPRESSURE_HPP_
@@ -0,0 +1,152 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSMESSAGECHANNEL_HPP_
+#define _HAL_JSMESSAGECHANNEL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSRunLoop.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace HAL {
+
+  // The function a JSMessagePort calls on its run loop's thread with
+  // each message posted to it, recreated in its JSContext.
+  typedef std::function<void(const JSContext& js_context, const JSValue& message)> JSMessageHandler;
+
+  class JSMessageChannel;
+
+  /*!
+   @class
+
+   @discussion A JSMessagePort is one end of a JSMessageChannel. It
+   belongs to the JSContext of a JSRunLoop, and is used on that run
+   loop's thread.
+
+   PostMessage serializes a message right away, so changing it
+   afterwards doesn't change what the other end receives. The message
+   may be any value JSContext::Clone can copy. The bytes of its
+   ArrayBuffers are copied, except those of the ArrayBuffers in the
+   transfer list, which the other end's ArrayBuffers use directly.
+
+   Messages are delivered in the order they were posted by a task on
+   the other end's run loop, which delivers every message that arrived
+   before it ran, so a burst of messages costs one wakeup. Messages wait
+   until the other end has a message handler.
+
+   An exception thrown by the message handler propagates out of the
+   run loop, and the messages after it stay queued.
+
+   Copies of a JSMessagePort are the same end of the same channel.
+   */
+  class HAL_EXPORT JSMessagePort final HAL_PERFORMANCE_COUNTER1(JSMessagePort) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Post a message to the other end of the channel.
+
+     @param message The message, a value of this port's JSContext.
+
+     @param transfer The ArrayBuffers of the message whose bytes are
+     handed to the other end instead of being copied. Each stays alive
+     until the other end's ArrayBuffer is collected, and it must not be
+     changed in the meantime, because JavaScriptCore can't detach it.
+
+     @throws std::invalid_argument if transfer contains an object that
+     isn't an ArrayBuffer.
+
+     @throws std::runtime_error if the message is or contains a
+     function.
+     */
+    void PostMessage(const JSValue& message) const;
+    void PostMessage(const JSValue& message, const std::vector<JSObject>& transfer) const;
+
+    /*!
+     @method
+
+     @abstract Set the function called with each message posted to
+     this port, and deliver the messages that were waiting for it. Pass
+     nullptr to hold messages again. Must be called on the run loop's
+     thread.
+     */
+    void set_message_handler(JSMessageHandler message_handler) const;
+
+    /*!
+     @method
+
+     @abstract Close both ends of the channel, discarding the messages
+     not yet delivered. Messages posted afterwards are dropped.
+     */
+    void Close() const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the number of messages posted to this port that
+     haven't been delivered yet.
+     */
+    std::size_t get_pending_message_count() const HAL_NOEXCEPT;
+
+    JSContext get_context() const HAL_NOEXCEPT;
+
+  private:
+
+    friend class JSMessageChannel;
+
+    struct State;
+
+    JSMessagePort(const std::shared_ptr<State>& state, std::size_t index) HAL_NOEXCEPT;
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+    std::size_t            index__;
+#pragma warning(pop)
+  };
+
+  /*!
+   @class
+
+   @discussion A JSMessageChannel connects two JSContexts, which may
+   belong to different JSContextGroups and run on different threads,
+   through a pair of JSMessagePorts, one for each JSRunLoop.
+   */
+  class HAL_EXPORT JSMessageChannel final HAL_PERFORMANCE_COUNTER1(JSMessageChannel) {
+
+  public:
+
+    JSMessageChannel(const JSRunLoop& run_loop_1, const JSRunLoop& run_loop_2);
+
+    // The port of run_loop_1.
+    JSMessagePort get_port1() const HAL_NOEXCEPT;
+
+    // The port of run_loop_2.
+    JSMessagePort get_port2() const HAL_NOEXCEPT;
+
+  private:
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSMessagePort port1__;
+    JSMessagePort port2__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSMESSAGECHANNEL_HPP_
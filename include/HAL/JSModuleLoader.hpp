@@ -0,0 +1,126 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSMODULELOADER_HPP_
+#define _HAL_JSMODULELOADER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSBundle.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <memory>
+#include <string>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSModuleLoader is a registry of CommonJS-style
+   modules for one JSContext. Registering a module is cheap: a module
+   file is only memory mapped, and nothing is parsed. A module is
+   compiled and evaluated on its first require, and its module object
+   is cached for every require after that.
+
+   Each module body is compiled with JSContext::CreateFunction as a
+   function of exports, require and module, and its result is the
+   value of module.exports once the body returns. Module ids are
+   matched exactly, without path resolution. A module required again
+   while it is still being evaluated, through a cycle, returns its
+   exports so far, as in Node.js.
+
+   Set the function returned by get_require_function as a property of
+   the global object to let scripts require modules themselves.
+
+   Copies of a JSModuleLoader share the same registry.
+   */
+  class HAL_EXPORT JSModuleLoader final HAL_PERFORMANCE_COUNTER1(JSModuleLoader) {
+
+  public:
+
+    explicit JSModuleLoader(const JSContext& js_context);
+
+    /*!
+     @method
+
+     @abstract Register the source of a module.
+
+     @param source_url An optional URL for the module's source file,
+     used only when reporting exceptions.
+     */
+    void RegisterModule(const std::string& id, const JSString& source, const std::string& source_url = "");
+
+    /*!
+     @method
+
+     @abstract Register a UTF-8 module file, which is memory mapped now
+     and read on the module's first require.
+
+     @throws std::runtime_error if the file can't be mapped.
+     */
+    void RegisterModuleFile(const std::string& id, const std::string& path);
+
+    /*!
+     @method
+
+     @abstract Register every module of a bundle under its id in the
+     bundle. A module's source is read from the bundle's mapping on its
+     first require, and the mapping is kept until then.
+     */
+    void RegisterBundle(const JSBundle& bundle);
+
+    /*!
+     @method
+
+     @abstract Return the exports of a module, compiling and evaluating
+     it first if this is its first require.
+
+     @throws std::runtime_error if no module has this id, if it has a
+     syntax error, or if evaluating it throws.
+     */
+    JSValue Require(const std::string& id);
+
+    /*!
+     @method
+
+     @abstract Return whether a module has been evaluated and cached.
+     */
+    bool IsLoaded(const std::string& id) const;
+
+    /*!
+     @method
+
+     @abstract Return the JavaScript require function passed to every
+     module, which throws an Error when Require would throw.
+     */
+    JSObject get_require_function() const;
+
+  private:
+
+    struct State;
+
+    static JSValue Load(State& state, const std::string& id);
+
+    // The callbacks of the JSClass of the require function, whose
+    // private data is a std::weak_ptr<State>.
+    static JSValueRef CallRequire(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
+    static void       FinalizeRequire(JSObjectRef function_ref);
+    static JSClassRef GetRequireClass();
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSMODULELOADER_HPP_
@@ -28,8 +28,8 @@ private:
 	// Only a JSContext can create a JSNull.
 	friend JSContext;
 	
-	explicit JSNull(const JSContext& js_context)
-			: JSValue(js_context, JSValueMakeNull(static_cast<JSContextRef>(js_context))) {
+	JSNull(const JSContext& js_context, JSValueRef js_value_ref)
+			: JSValue(js_context, js_value_ref, kJSTypeNull, true) {
 	}
 };
 
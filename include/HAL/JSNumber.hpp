@@ -71,7 +71,7 @@ private:
 	friend JSContext;
 
 	explicit JSNumber(const JSContext& js_context, double number = 0)
-			: JSValue(js_context, JSValueMakeNumber(static_cast<JSContextRef>(js_context), number)) {
+			: JSValue(js_context, JSValueMakeNumber(static_cast<JSContextRef>(js_context), number), kJSTypeNumber, false) {
 	}
 	
 	JSNumber(const JSContext& js_context, int32_t number)
@@ -13,8 +13,15 @@
 #include "HAL/JSContext.hpp"
 #include "HAL/JSPropertyAttribute.hpp"
 #include "HAL/JSPropertyNameArray.hpp"
+#include "HAL/JSResult.hpp"
+#include "HAL/detail/JSObjectRefRegistry.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
@@ -27,12 +34,37 @@ namespace HAL {
   class JSPropertyNameArray;
   class JSArray;
   class JSError;
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  class JSArrayBuffer;
+  
+  template<typename T>
+  class JSTypedArray;
+#endif
   
   class JSExportObject;
+  class JSObjectView;
+  class JSValueView;
+  
+  template<typename T>
+  class JSExport;
+  
+  template<typename T>
+  class JSExportHandle;
+  
+  template<typename T>
+  class JSExportWeakHandle;
   
   namespace detail {
     template<typename T>
     class JSExportClass;
+    
+    struct JSExportClassInfo;
+    
+    struct JSRetainedHandles;
+    HAL_EXPORT JSRetainedHandles GetRetainedHandles();
+    
+    struct JSRetainedHandle;
+    HAL_EXPORT std::vector<JSRetainedHandle> GetRetainedHandleList();
   }
 }
 
@@ -104,6 +136,38 @@ namespace HAL {
      */
     virtual JSValue GetProperty(unsigned property_index) const final;
     
+    /*!
+     @method
+     
+     @abstract Return a property of this JavaScript object without
+     throwing a C++ exception.
+     
+     @discussion Use this instead of GetProperty where a JavaScript
+     exception is expected, such as when probing for a feature, since
+     the exception is kept as is rather than converted to a
+     std::runtime_error.
+     
+     @param property_name The name of the property to get.
+     
+     @result The property's value, or the JavaScript exception getting
+     the property threw.
+     */
+    virtual JSResult<JSValue> TryGetProperty(const JSString& property_name) const final;
+    
+    /*!
+     @method
+     
+     @abstract Return a property of this JavaScript object by numeric
+     index without throwing a C++ exception.
+     
+     @param property_index An integer value that is the property's
+     name.
+     
+     @result The property's value, or the JavaScript exception getting
+     the property threw.
+     */
+    virtual JSResult<JSValue> TryGetProperty(unsigned property_index) const final;
+    
     /*!
      @method
      
@@ -122,7 +186,7 @@ namespace HAL {
      @throws std::runtime_error if setting the property threw a
      JavaScript exception.
      */
-    virtual void SetProperty(const JSString& property_name, const JSValue& property_value, const std::unordered_set<JSPropertyAttribute>& attributes = {}) final;
+    virtual void SetProperty(const JSString& property_name, const JSValue& property_value, JSPropertyAttributeSet attributes = JSPropertyAttributeSet()) final;
     
     /*!
      @method
@@ -176,6 +240,61 @@ namespace HAL {
      */
     virtual std::unordered_map<std::string, JSValue> GetProperties() const HAL_NOEXCEPT final;
 
+    /*!
+     @method
+     
+     @abstract Get several properties of this JavaScript object at
+     once.
+     
+     @discussion This takes the lock once and shares one exception
+     slot across all of the reads, which makes it cheaper than calling
+     GetProperty for each name. Names are best JSStrings created once
+     and reused.
+     
+     @param property_names The names of the properties to get.
+     
+     @result The values of the properties, in the order of the names.
+     
+     @throws std::runtime_error if getting any of the properties threw
+     a JavaScript exception.
+     */
+    virtual std::vector<JSValue> GetProperties(const std::vector<JSString>& property_names) const final;
+
+    /*!
+     @method
+     
+     @abstract Set several properties of this JavaScript object at
+     once, all with the same attributes.
+     
+     @discussion This takes the lock once and shares one exception
+     slot across all of the writes. Properties are set in order and the
+     first JavaScript exception stops the rest from being set.
+     
+     @throws std::invalid_argument if there aren't as many values as
+     names.
+     
+     @throws std::runtime_error if setting any of the properties threw
+     a JavaScript exception.
+     */
+    virtual void SetProperties(const std::vector<JSString>& property_names, const std::vector<JSValue>& property_values, JSPropertyAttributeSet attributes = JSPropertyAttributeSet()) final;
+
+    /*!
+     @method
+     
+     @abstract Call a visitor with the name and value of each of this
+     JavaScript object's enumerable properties, until the visitor
+     returns false.
+     
+     @discussion Names are fetched one at a time and both the name and
+     the value are borrowed, so nothing is copied or protected unless
+     the visitor keeps it. Neither outlives the call to the visitor;
+     use JSString(name) and JSValueView::ToJSValue to keep them.
+     
+     @result true if the visitor was called for every property, false
+     if it stopped early.
+     */
+    virtual bool ForEachProperty(const std::function<bool(JSStringRef name, const JSValueView& value)>& visitor) const final;
+
 
     /*!
      @method
@@ -207,6 +326,28 @@ namespace HAL {
      */
     virtual bool IsError() const HAL_NOEXCEPT final;
     
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    /*!
+     @method
+     
+     @abstract Determine whether this JavaScript object is an
+     ArrayBuffer.
+     
+     @result true if this JavaScript object is an ArrayBuffer.
+     */
+    virtual bool IsArrayBuffer() const HAL_NOEXCEPT final;
+    
+    /*!
+     @method
+     
+     @abstract Determine whether this JavaScript object is a typed
+     array, such as a Float64Array.
+     
+     @result true if this JavaScript object is a typed array.
+     */
+    virtual bool IsTypedArray() const HAL_NOEXCEPT final;
+#endif
+    
     /*!
      @method
      
@@ -236,6 +377,76 @@ namespace HAL {
     virtual JSValue operator()(const JSString&              argument , JSObject this_object) final;
     virtual JSValue operator()(const std::vector<JSValue>&  arguments, JSObject this_object) final;
     virtual JSValue operator()(const std::vector<JSString>& arguments, JSObject this_object) final;
+
+    /*!
+     @method
+     
+     @abstract Call this JavaScript object as a function with any
+     number of arguments, without building a std::vector of them.
+     
+     @discussion Each argument is converted straight to a JSValueRef in
+     an array on the stack, where JavaScriptCore's conservative stack
+     scan keeps it alive for the call, so a call with numbers,
+     booleans, JSValues and JSObjects allocates nothing. An argument
+     may be a JSValue, JSObject, JSString, std::string, const char*,
+     bool, double or any integer type, including std::size_t. Integers
+     wider than 32 bits become the nearest double. Strings are created
+     in JavaScriptCore, but without a JSString of their own.
+     
+     @param this_object The JavaScript object to use as 'this'.
+     
+     @param arguments The arguments to pass to the function.
+     
+     @result Return the function's return value.
+     
+     @throws std::runtime_error if either this JavaScript object can't
+     be called as a function, or calling the function itself threw a
+     JavaScript exception.
+     */
+    template<typename... Args>
+    JSValue Call(const JSObject& this_object, const Args&... arguments);
+
+    /*!
+     @method
+     
+     @abstract Call this JavaScript object as a function without
+     throwing a C++ exception.
+     
+     @param arguments The JSValue arguments to pass to the function.
+     
+     @param this_object The JavaScript object to use as 'this'.
+     
+     @result The function's return value, or the JavaScript exception
+     calling it threw. If this JavaScript object can't be called as a
+     function the exception is an Error saying so.
+     */
+    virtual JSResult<JSValue> TryCall(const std::vector<JSValue>& arguments, JSObject this_object) final;
+    
+    /*!
+     @method
+     
+     @abstract Call this JavaScript object as a function once for each
+     input, in a loop that runs in JavaScript.
+     
+     @discussion The inputs are passed in one array to a small
+     JavaScript function that makes the calls, so the whole batch
+     crosses from C++ to JavaScript once. Numbers are passed in a
+     Float64Array, and their results come back in one, when
+     HAL_TYPED_ARRAY_ENABLE is defined.
+     
+     @param inputs The argument of each call.
+     
+     @param this_object The JavaScript object to use as 'this'.
+     
+     @result The return value of each call, in the order of inputs.
+     For numbers each return value is converted to a number.
+     
+     @throws std::runtime_error if either this JavaScript object can't
+     be called as a function, or any call threw a JavaScript
+     exception, in which case no results are returned.
+     */
+    virtual std::vector<JSValue> CallBatched(const std::vector<JSValue>& inputs, JSObject this_object) final;
+    virtual std::vector<double>  CallBatched(const std::vector<double>&  inputs, JSObject this_object) final;
     
     /*!
      @method
@@ -268,6 +479,23 @@ namespace HAL {
     virtual JSObject CallAsConstructor(const std::vector<JSString>& arguments) final;
     virtual JSObject CallAsConstructor(const std::vector<JSValue>&  arguments) final;
     
+    /*!
+     @method
+     
+     @abstract Call this JavaScript object as a constructor as if in a
+     'new' expression, with arguments converted like those of Call.
+     
+     @param arguments The arguments to pass to the constructor.
+     
+     @result The JavaScript object of the constructor's return value.
+     
+     @throws std::runtime_error if either this JavaScript object can't
+     be called as a constructor, or calling the constructor itself
+     threw a JavaScript exception.
+     */
+    template<typename... Args>
+    JSObject Construct(const Args&... arguments);
+    
     /*!
      @method
      
@@ -324,6 +552,20 @@ namespace HAL {
      @result A JSError with the result of conversion.
      */
     virtual operator JSError() const final;
+    
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    /*!
+     @method
+     
+     @abstract Convert this JSObject to a JSArrayBuffer.
+     
+     @result A JSArrayBuffer with the result of conversion.
+     
+     @throws std::runtime_error if this JSObject isn't an
+     ArrayBuffer.
+     */
+    virtual operator JSArrayBuffer() const final;
+#endif
   
     /*!
      @method
@@ -331,12 +573,69 @@ namespace HAL {
      @abstract Return a std::shared_ptr<T> to this object's private
      data.
      
+     @discussion With HAL_NO_RTTI there is no dynamic_cast: the
+     private data is checked like GetPrivateAs<T>, and is never of a
+     T that isn't a JSExport class.
+     
      @result A std::shared_ptr<T> to this object's private data if the
      object has private data of type T*, otherwise nullptr.
      */
     template<typename T>
     std::shared_ptr<T> GetPrivate() const HAL_NOEXCEPT;
     
+    /*!
+     @method
+     
+     @abstract Return a pointer to this object's private data if it is
+     the native object of the JSExport class T or of a class whose
+     parent chain, see JSExport<T>::SetParent, includes T.
+     
+     @discussion Unlike GetPrivate<T> this allocates nothing and
+     doesn't copy this JSObject. The class recorded in the native
+     object decides, instead of a dynamic_cast or the JSClass and
+     prototype chains, so a prototype changed from script can't make
+     an object pass for a T.
+     The pointer doesn't keep the native object alive, so it must not
+     outlive this JSObject; use GetPrivateHandle<T> for that.
+     
+     @result A pointer to this object's native object, or nullptr if
+     it isn't one of T.
+     */
+    template<typename T>
+    T* GetPrivateAs() const;
+    
+    /*!
+     @method
+     
+     @abstract Return a JSExportHandle<T> sharing ownership of this
+     object's private data, checked like GetPrivateAs<T>.
+     
+     @discussion The handle counts its owners in the native object, so
+     unlike GetPrivate<T> it allocates nothing, and only the first
+     handle of a native object protects its JavaScript object.
+     
+     @result A JSExportHandle<T> to this object's native object, or an
+     empty one if it isn't one of T.
+     */
+    template<typename T>
+    JSExportHandle<T> GetPrivateHandle() const;
+    
+    /*!
+     @method
+     
+     @abstract Return a JSExportWeakHandle<T> to this object's native
+     object, which doesn't keep it alive.
+     
+     @discussion T must be the class this object was created with
+     rather than one of its parents, whose finalizer JavaScriptCore
+     runs after the native object is gone.
+     
+     @result A JSExportWeakHandle<T> to this object's native object, or
+     an empty one if this object wasn't created as a T.
+     */
+    template<typename T>
+    JSExportWeakHandle<T> GetWeakHandle() const;
+    
     
     virtual ~JSObject()            HAL_NOEXCEPT;
     JSObject(const JSObject&)      HAL_NOEXCEPT;
@@ -383,6 +682,26 @@ namespace HAL {
      JavaScript exception.
      */
     virtual JSValue CallAsFunction(const std::vector<JSValue>&  arguments, JSObject this_object);
+    
+    // The calls every overload of operator(), CallAsFunction,
+    // CallAsConstructor, Call and Construct make.
+    JSValue  CallWithValueRefs(const JSValueRef arguments[], std::size_t argument_count, const JSObject& this_object);
+    JSObject ConstructWithValueRefs(const JSValueRef arguments[], std::size_t argument_count);
+    
+    // The arguments of Call and Construct.
+    JSValueRef ToJSValueRef(const JSValue&     argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(const JSObject&    argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(const JSString&    argument) const;
+    JSValueRef ToJSValueRef(const std::string& argument) const;
+    JSValueRef ToJSValueRef(const char*        argument) const;
+    JSValueRef ToJSValueRef(double             argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(std::int32_t       argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(std::uint32_t      argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(long               argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(unsigned long      argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(long long          argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(unsigned long long argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(bool               argument) const HAL_NOEXCEPT;
 
     /*!
      @method
@@ -394,6 +713,10 @@ namespace HAL {
      */
     virtual void* GetPrivate() const HAL_NOEXCEPT final;
     
+    // Returns this object's private data if its native object's header
+    // records a class derived from class_info, otherwise nullptr.
+    void* GetPrivateOfClass(const detail::JSExportClassInfo& class_info) const HAL_NOEXCEPT;
+    
     /*!
      @method
      
@@ -436,6 +759,27 @@ namespace HAL {
     // JSContext (and already friended JSExportClass) use the
     // following constructor.
     friend class JSContext;
+    
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    // A JSTypedArray is converted from any JSObject.
+    template<typename T>
+    friend class JSTypedArray;
+#endif
+    
+    // A JSObjectView promotes itself to a JSObject through
+    // FindJSObject.
+    friend class JSObjectView;
+    
+    // A JSWeakObjectMap wraps the JSObjectRefs it finds.
+    friend class JSWeakObjectMap;
+    
+    // Walks js_object_ref_registry__.
+    friend detail::JSRetainedHandles detail::GetRetainedHandles();
+    
+    // Counts js_object_ref_registry__ and
+    // js_private_data_to_js_object_ref_map__.
+    friend class JSContextGroup;
+    friend std::vector<detail::JSRetainedHandle> detail::GetRetainedHandleList();
 
     JSObject(const JSContext& js_context, const JSClass& js_class, void* private_data = nullptr);
     
@@ -446,21 +790,27 @@ namespace HAL {
 #pragma warning(push)
 #pragma warning(disable: 4251)
     JSObjectRef js_object_ref__;
-    static std::unordered_map<std::intptr_t, std::tuple<std::intptr_t, std::size_t>> js_object_ref_to_js_context_ref_map__;
+    static detail::JSObjectRefRegistry js_object_ref_registry__;
     static std::unordered_map<std::intptr_t, std::intptr_t> js_private_data_to_js_object_ref_map__;
 #pragma warning(pop)
 
 #undef  HAL_JSOBJECT_LOCK_GUARD
-#undef  HAL_JSOBJECT_LOCK_GUARD_STATIC
 #ifdef  HAL_THREAD_SAFE
-           std::recursive_mutex mutex__;
-    static std::recursive_mutex mutex_static__;
-#define HAL_JSOBJECT_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
-#define HAL_JSOBJECT_LOCK_GUARD_STATIC std::lock_guard<std::recursive_mutex> lock_static(JSObject::mutex_static__)
+    detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSObject, "JSObject");
+#define HAL_JSOBJECT_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
+#elif defined(HAL_THREAD_AFFINITY)
+#define HAL_JSOBJECT_LOCK_GUARD assert(js_context__.IsOwnerThread())
 #else
 #define HAL_JSOBJECT_LOCK_GUARD
-#define HAL_JSOBJECT_LOCK_GUARD_STATIC
 #endif  // HAL_THREAD_SAFE
+
+#undef  HAL_JSOBJECT_LOCK_GUARD_STATIC
+#ifdef  HAL_THREAD_SAFE_STATICS
+    static detail::JSRecursiveMutex mutex_static__;
+#define HAL_JSOBJECT_LOCK_GUARD_STATIC std::lock_guard<detail::JSRecursiveMutex> lock_static(JSObject::mutex_static__)
+#else
+#define HAL_JSOBJECT_LOCK_GUARD_STATIC
+#endif  // HAL_THREAD_SAFE_STATICS
   };
   
   inline
@@ -468,9 +818,66 @@ namespace HAL {
     first.swap(second);
   }
   
+#ifdef HAL_NO_RTTI
+  namespace detail {
+    
+    // Without dynamic_cast only the private data of a JSExport class
+    // can be checked, and no other type T can be it.
+    template<typename T>
+    T* GetJSExportPrivate(const JSObject& js_object, std::true_type) HAL_NOEXCEPT {
+      return js_object.GetPrivateAs<T>();
+    }
+    
+    template<typename T>
+    T* GetJSExportPrivate(const JSObject&, std::false_type) HAL_NOEXCEPT {
+      return nullptr;
+    }
+    
+  } // namespace detail {
+#endif
+  
   template<typename T>
   std::shared_ptr<T> JSObject::GetPrivate() const HAL_NOEXCEPT {
+#ifdef HAL_NO_RTTI
+    return std::shared_ptr<T>(std::make_shared<JSObject>(*this), detail::GetJSExportPrivate<T>(*this, std::is_base_of<JSExport<T>, T>()));
+#else
     return std::shared_ptr<T>(std::make_shared<JSObject>(*this), dynamic_cast<T*>(static_cast<JSExportObject*>(GetPrivate())));
+#endif
+  }
+  
+  // The array has a trailing nullptr, so that it isn't empty when
+  // there are no arguments.
+  template<typename... Args>
+  JSValue JSObject::Call(const JSObject& this_object, const Args&... arguments) {
+    const JSValueRef arguments_array[sizeof...(Args) + 1] = { ToJSValueRef(arguments)..., nullptr };
+    return CallWithValueRefs(arguments_array, sizeof...(Args), this_object);
+  }
+  
+  template<typename... Args>
+  JSObject JSObject::Construct(const Args&... arguments) {
+    const JSValueRef arguments_array[sizeof...(Args) + 1] = { ToJSValueRef(arguments)..., nullptr };
+    return ConstructWithValueRefs(arguments_array, sizeof...(Args));
+  }
+  
+  // T is complete wherever these are instantiated, and so is its
+  // JSExport<T> base.
+  template<typename T>
+  T* JSObject::GetPrivateAs() const {
+    return static_cast<T*>(GetPrivateOfClass(JSExport<T>::Class().get_class_info()));
+  }
+  
+  template<typename T>
+  JSExportHandle<T> JSObject::GetPrivateHandle() const {
+    return JSExportHandle<T>(GetPrivateAs<T>(), static_cast<JSContextRef>(js_context__), js_object_ref__);
+  }
+  
+  template<typename T>
+  JSExportWeakHandle<T> JSObject::GetWeakHandle() const {
+    const auto native_object_ptr = GetPrivateAs<T>();
+    if (!native_object_ptr) {
+      return JSExportWeakHandle<T>();
+    }
+    return JSExportWeakHandle<T>(JSExport<T>::Class().GetWeakSlot(*native_object_ptr, static_cast<JSContextRef>(js_context__), js_object_ref__));
   }
   
 } // namespace HAL {
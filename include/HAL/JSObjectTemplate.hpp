@@ -0,0 +1,130 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSOBJECTTEMPLATE_HPP_
+#define _HAL_JSOBJECTTEMPLATE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSClass.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSPropertyAttribute.hpp"
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+
+  class JSContext;
+
+  /*!
+   @class
+
+   @discussion A JSObjectTemplate creates many JavaScript objects with
+   the same properties, such as records returned to scripts.
+
+   The property names are converted to JSStrings once, when the
+   template is created, and every object gets its properties in the
+   same order. JavaScriptCore can then share one structure between
+   all of the objects.
+
+   Usage:
+
+   JSObjectTemplate point_template({"x", "y"});
+   for (const auto& point : points) {
+     auto js_point = point_template.Instantiate(js_context, js_context.CreateNumber(point.x), js_context.CreateNumber(point.y));
+     ...
+   }
+   */
+  class HAL_EXPORT JSObjectTemplate final HAL_PERFORMANCE_COUNTER1(JSObjectTemplate) {
+
+  public:
+
+    // A property name with its attributes. A plain name converts to a
+    // Property without attributes.
+    struct Property {
+      Property(const char* name, JSPropertyAttributeSet attributes = JSPropertyAttributeSet())
+      : name(name)
+      , attributes(attributes) {
+      }
+      
+      Property(std::string name, JSPropertyAttributeSet attributes = JSPropertyAttributeSet())
+      : name(std::move(name))
+      , attributes(attributes) {
+      }
+      
+      std::string            name;
+      JSPropertyAttributeSet attributes;
+    };
+
+    /*!
+     @method
+
+     @abstract Create a template for objects of the default object
+     class with these properties.
+     */
+    JSObjectTemplate(const std::vector<Property>& properties);
+
+    /*!
+     @method
+
+     @abstract Create a template for objects of a JSClass, such as
+     JSExport<T>::Class(), with these properties.
+     */
+    JSObjectTemplate(const JSClass& js_class, const std::vector<Property>& properties);
+
+    /*!
+     @method
+
+     @abstract Return the number of properties each object gets.
+     */
+    std::size_t size() const HAL_NOEXCEPT {
+      return property_names__.size();
+    }
+
+    /*!
+     @method
+
+     @abstract Create an object and set its properties, in template
+     order, to the given values.
+
+     @throws std::invalid_argument if the number of values is not the
+     number of properties.
+
+     @throws std::runtime_error if setting a property threw a
+     JavaScript exception.
+     */
+    JSObject Instantiate(const JSContext& js_context, const JSValue* values, std::size_t count) const;
+    JSObject Instantiate(const JSContext& js_context, const std::vector<JSValue>& values) const;
+
+    template<typename... Values>
+    JSObject Instantiate(const JSContext& js_context, const JSValue& value, const Values&... values) const {
+      const JSValue value_array[] = { value, static_cast<JSValue>(values)... };
+      return Instantiate(js_context, value_array, 1 + sizeof...(Values));
+    }
+
+  private:
+
+    void Initialize(const std::vector<Property>& properties);
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSClass                             js_class__;
+    std::vector<JSString>               property_names__;
+    std::vector<JSPropertyAttributeSet> property_attributes__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSOBJECTTEMPLATE_HPP_
@@ -0,0 +1,106 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSOBJECTVIEW_HPP_
+#define _HAL_JSOBJECTVIEW_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSValueView.hpp"
+#include "HAL/JSObject.hpp"
+
+#include <cassert>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSObjectView is a non-owning view of a JSObjectRef.
+   Creating one does not touch the JSObject registry or call
+   JSValueProtect, which makes it the cheapest way to reach an
+   object's private data from inside a JavaScriptCore callback.
+
+   Like a JSValueView it is only valid while the object is kept alive
+   by something else. Use ToJSObject to obtain an owning JSObject.
+   */
+  class JSObjectView final {
+
+  public:
+
+    // For interoperability with the JavaScriptCore C API.
+    JSObjectView(JSContextRef js_context_ref, JSObjectRef js_object_ref) HAL_NOEXCEPT
+    : js_context_ref__(js_context_ref)
+    , js_object_ref__(js_object_ref) {
+      assert(js_context_ref__);
+      assert(js_object_ref__);
+    }
+
+    JSObjectView()                               = delete;
+    ~JSObjectView()                              = default;
+    JSObjectView(const JSObjectView&)            = default;
+    JSObjectView& operator=(const JSObjectView&) = default;
+
+    bool IsFunction() const HAL_NOEXCEPT {
+      return JSObjectIsFunction(js_context_ref__, js_object_ref__);
+    }
+
+    bool IsConstructor() const HAL_NOEXCEPT {
+      return JSObjectIsConstructor(js_context_ref__, js_object_ref__);
+    }
+
+    /*!
+     @method
+
+     @abstract Gets this object's private data.
+
+     @result A void* that is this object's private data, if the object
+     has private data, otherwise nullptr.
+     */
+    void* GetPrivate() const HAL_NOEXCEPT {
+      return JSObjectGetPrivate(js_object_ref__);
+    }
+
+    /*!
+     @method
+
+     @abstract Create an owning JSObject for this object, using the
+     JSContext the object was first registered with if any.
+     */
+    JSObject ToJSObject() const {
+      return JSObject::FindJSObject(js_context_ref__, js_object_ref__);
+    }
+
+    JSContextRef get_context_ref() const HAL_NOEXCEPT {
+      return js_context_ref__;
+    }
+
+    operator JSValueView() const HAL_NOEXCEPT {
+      return JSValueView(js_context_ref__, js_object_ref__);
+    }
+
+    // For interoperability with the JavaScriptCore C API.
+    explicit operator JSObjectRef() const HAL_NOEXCEPT {
+      return js_object_ref__;
+    }
+
+  private:
+
+    JSContextRef js_context_ref__;
+    JSObjectRef  js_object_ref__;
+  };
+
+  inline
+  JSObjectView JSValueView::ToObjectView() const HAL_NOEXCEPT {
+    assert(IsObject());
+    JSObjectRef js_object_ref = JSValueToObject(js_context_ref__, js_value_ref__, nullptr);
+    return JSObjectView(js_context_ref__, js_object_ref);
+  }
+
+} // namespace HAL {
+
+#endif // _HAL_JSOBJECTVIEW_HPP_
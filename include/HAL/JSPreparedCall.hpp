@@ -0,0 +1,175 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSPREPAREDCALL_HPP_
+#define _HAL_JSPREPAREDCALL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSObject.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSPreparedCall calls the same JavaScript function with
+   the same 'this' object and number of arguments many times, such as
+   an event handler.
+
+   The function is checked once, when the JSPreparedCall is created,
+   and each Invoke writes the JSValueRefs of its arguments into a
+   buffer kept for the next call, so calling allocates nothing.
+   InvokeForNumber and InvokeForBoolean also return the result without
+   creating a JSValue.
+
+   Numbers and booleans may be passed as arguments directly. A JSValue
+   or JSObject argument must outlive the Invoke it is passed to.
+
+   A JSPreparedCall is not thread safe.
+
+   Usage:
+
+   JSPreparedCall on_event(handler, dispatcher, 2);
+   for (const auto& event : events) {
+     on_event.Invoke(event.id, event.payload);
+   }
+   */
+  class HAL_EXPORT JSPreparedCall final HAL_PERFORMANCE_COUNTER1(JSPreparedCall) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Prepare calls of function with this_object as 'this'
+     and arity arguments.
+
+     @throws std::invalid_argument if function can't be called as a
+     function.
+     */
+    JSPreparedCall(const JSObject& function, const JSObject& this_object, std::size_t arity);
+
+    /*!
+     @method
+
+     @abstract Prepare calls of function with the global object as
+     'this' and arity arguments.
+
+     @throws std::invalid_argument if function can't be called as a
+     function.
+     */
+    JSPreparedCall(const JSObject& function, std::size_t arity);
+
+    std::size_t get_arity() const HAL_NOEXCEPT {
+      return arguments__.size();
+    }
+
+    /*!
+     @method
+
+     @abstract Call the function with these arguments.
+
+     @result The function's return value.
+
+     @throws std::invalid_argument if the number of arguments is not
+     the arity.
+
+     @throws std::runtime_error if calling the function threw a
+     JavaScript exception.
+     */
+    template<typename... Args>
+    JSValue Invoke(const Args&... arguments) {
+      SetArguments(sizeof...(Args), arguments...);
+      return JSValue(js_context__, Call());
+    }
+
+    /*!
+     @method
+
+     @abstract Call the function with these arguments and convert its
+     return value to a number.
+
+     @throws std::runtime_error if calling the function or the
+     conversion threw a JavaScript exception.
+     */
+    template<typename... Args>
+    double InvokeForNumber(const Args&... arguments) {
+      SetArguments(sizeof...(Args), arguments...);
+      return ToNumber(Call());
+    }
+
+    /*!
+     @method
+
+     @abstract Call the function with these arguments and convert its
+     return value to a boolean.
+
+     @throws std::runtime_error if calling the function threw a
+     JavaScript exception.
+     */
+    template<typename... Args>
+    bool InvokeForBoolean(const Args&... arguments) {
+      SetArguments(sizeof...(Args), arguments...);
+      return ToBoolean(Call());
+    }
+
+  private:
+
+    template<typename... Args>
+    void SetArguments(std::size_t count, const Args&... arguments) {
+      CheckArity(count);
+      SetArgument(0, arguments...);
+    }
+
+    void SetArgument(std::size_t) HAL_NOEXCEPT {
+    }
+
+    template<typename Arg, typename... Args>
+    void SetArgument(std::size_t index, const Arg& argument, const Args&... arguments) {
+      arguments__[index] = ToJSValueRef(argument);
+      SetArgument(index + 1, arguments...);
+    }
+
+    // Numbers and booleans aren't allocated by JavaScriptCore, so
+    // their JSValueRefs need no protection while they wait in
+    // arguments__.
+    JSValueRef ToJSValueRef(const JSValue&  argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(const JSObject& argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(double          argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(std::int32_t    argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(std::uint32_t   argument) const HAL_NOEXCEPT;
+    JSValueRef ToJSValueRef(bool            argument) const HAL_NOEXCEPT;
+    
+    // A string would otherwise convert to bool. Pass a JSValue from
+    // JSContext::CreateString instead.
+    JSValueRef ToJSValueRef(const char*     argument) const = delete;
+
+    void       CheckArity(std::size_t count) const;
+    JSValueRef Call();
+    double     ToNumber(JSValueRef js_value_ref) const;
+    bool       ToBoolean(JSValueRef js_value_ref) const HAL_NOEXCEPT;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSContext               js_context__;
+    JSObject                function__;
+    JSObject                this_object__;
+    std::vector<JSValueRef> arguments__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSPREPAREDCALL_HPP_
@@ -0,0 +1,183 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSPREPAREDVALUE_HPP_
+#define _HAL_JSPREPAREDVALUE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSContext.hpp"
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+#include "HAL/JSTypedArray.hpp"
+#endif
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+
+  class JSStringBuilder;
+  class JSValueWriter;
+
+  /*!
+   @class
+
+   @discussion A JSPreparedJSON is JSON text made ready for
+   JSContext::AdoptJSON on a thread that has no JSContext, such as the
+   one a data feed arrives on.
+
+   The text is transcoded to UTF-16 and handed to JavaScriptCore as it
+   is prepared, and a JavaScriptCore string may be shared between
+   threads, so adopting it on the thread of the JSContext is a single
+   JSON parse with nothing left to convert. JSPreparedJSON may be
+   copied and moved to another thread freely, and adopted more than
+   once.
+   */
+  class HAL_EXPORT JSPreparedJSON final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Prepare the tree written with writer.
+
+     @throws std::runtime_error if an object or array is still open or
+     nothing was written.
+     */
+    explicit JSPreparedJSON(const JSValueWriter& writer);
+
+    /*!
+     @method
+
+     @abstract Prepare JSON text, which is checked when it is adopted.
+     */
+    explicit JSPreparedJSON(const JSStringBuilder& json_text);
+    explicit JSPreparedJSON(const std::string& json_text);
+    explicit JSPreparedJSON(JSString json_text) HAL_NOEXCEPT;
+
+    const JSString& get_text() const HAL_NOEXCEPT {
+      return json_text__;
+    }
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSString json_text__;
+#pragma warning(pop)
+  };
+
+  /*!
+   @class
+
+   @discussion A JSPreparedString is a string made ready for
+   JSContext::AdoptString on a thread that has no JSContext. Like a
+   JSPreparedJSON its UTF-8 is transcoded, and its UTF-16 copied into
+   JavaScriptCore, where it is prepared, so that adopting it creates
+   the JavaScript string without converting it again.
+   */
+  class HAL_EXPORT JSPreparedString final {
+
+  public:
+
+    explicit JSPreparedString(const JSStringBuilder& string);
+    explicit JSPreparedString(const std::string& string);
+    explicit JSPreparedString(const std::u16string& string);
+    JSPreparedString(const char16_t* string, std::size_t length);
+    explicit JSPreparedString(JSString string) HAL_NOEXCEPT;
+
+    const JSString& get_string() const HAL_NOEXCEPT {
+      return string__;
+    }
+
+  private:
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSString string__;
+#pragma warning(pop)
+  };
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  /*!
+   @class
+
+   @discussion A JSPreparedTypedArray<T> is the backing store of a
+   typed array, e.g. of a Float32Array for JSPreparedTypedArray<float>,
+   filled on a thread that has no JSContext and handed to
+   JSContext::AdoptTypedArray without a copy. It can only be moved,
+   and is empty once adopted, even if adopting it threw.
+
+   Usage:
+
+   JSPreparedTypedArray<float> samples(count);
+   std::copy(begin, end, samples.data());
+   ... move samples to the thread of js_context ...
+   auto js_samples = js_context.AdoptTypedArray(std::move(samples));
+   */
+  template<typename T>
+  class JSPreparedTypedArray final {
+
+  public:
+
+    // A zero-filled store of length elements.
+    explicit JSPreparedTypedArray(std::size_t length)
+    : elements__(length) {
+    }
+
+    explicit JSPreparedTypedArray(std::vector<T>&& elements) HAL_NOEXCEPT
+    : elements__(std::move(elements)) {
+    }
+
+    JSPreparedTypedArray(JSPreparedTypedArray&&)            = default;
+    JSPreparedTypedArray& operator=(JSPreparedTypedArray&&) = default;
+    JSPreparedTypedArray(const JSPreparedTypedArray&)            = delete;
+    JSPreparedTypedArray& operator=(const JSPreparedTypedArray&) = delete;
+
+    T* data() HAL_NOEXCEPT {
+      return elements__.data();
+    }
+
+    const T* data() const HAL_NOEXCEPT {
+      return elements__.data();
+    }
+
+    std::size_t size() const HAL_NOEXCEPT {
+      return elements__.size();
+    }
+
+    T& operator[](std::size_t index) HAL_NOEXCEPT {
+      return elements__[index];
+    }
+
+    const T& operator[](std::size_t index) const HAL_NOEXCEPT {
+      return elements__[index];
+    }
+
+  private:
+
+    friend class JSContext;
+
+    std::vector<T> elements__;
+  };
+
+  template<typename T>
+  JSTypedArray<T> JSContext::AdoptTypedArray(JSPreparedTypedArray<T>&& prepared) const {
+    return CreateTypedArray<T>(std::move(prepared.elements__));
+  }
+#endif
+
+} // namespace HAL {
+
+#endif // _HAL_JSPREPAREDVALUE_HPP_
@@ -0,0 +1,98 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSPROMISERESOLVER_HPP_
+#define _HAL_JSPROMISERESOLVER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace HAL {
+
+  class JSRunLoop;
+
+  // A function called on the run loop's thread to create the value a
+  // promise is fulfilled with, since JavaScript values can't be
+  // created on the background thread that completes the work.
+  typedef std::function<JSValue(const JSContext& js_context)> JSPromiseValueFactory;
+
+  /*!
+   @class
+
+   @discussion A JSPromiseResolver settles a JavaScript promise
+   created by JSRunLoop::CreatePromise, from any thread.
+
+   Resolve and Reject only post a task to the run loop; the promise is
+   settled, and its reactions are queued, when the run loop's thread
+   runs that task. Only the first call to Resolve or Reject has an
+   effect. If every copy of the resolver is destroyed before either is
+   called the promise is rejected, so that it never stays pending
+   forever.
+
+   Copies of a JSPromiseResolver settle the same promise, and may be
+   used and destroyed on any thread.
+   */
+  class HAL_EXPORT JSPromiseResolver final HAL_PERFORMANCE_COUNTER1(JSPromiseResolver) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Fulfill the promise with the value returned by
+     value_factory, or reject it with the message of the
+     std::exception value_factory throws.
+
+     @result false if the promise was already settled.
+     */
+    bool Resolve(JSPromiseValueFactory value_factory) const;
+
+    /*!
+     @method
+
+     @abstract Fulfill the promise with undefined.
+
+     @result false if the promise was already settled.
+     */
+    bool Resolve() const;
+
+    /*!
+     @method
+
+     @abstract Reject the promise with a JavaScript Error.
+
+     @result false if the promise was already settled.
+     */
+    bool Reject(const std::string& message) const;
+
+  private:
+
+    friend class JSRunLoop;
+
+    struct State;
+
+    explicit JSPromiseResolver(const std::shared_ptr<State>& state) HAL_NOEXCEPT;
+
+    static std::pair<JSObject, JSPromiseResolver> Create(const JSRunLoop& js_run_loop);
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSPROMISERESOLVER_HPP_
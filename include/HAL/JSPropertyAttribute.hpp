@@ -9,8 +9,13 @@
 #ifndef _HAL_JSPROPERTYATTRIBUTE_HPP_
 #define _HAL_JSPROPERTYATTRIBUTE_HPP_
 
+#include "HAL/detail/JSBase.hpp"
+
 #include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <initializer_list>
+#include <unordered_set>
 
 namespace HAL {
 
@@ -57,4 +62,122 @@ struct hash<JSPropertyAttribute> {
 
 }  // namespace std {
 
+namespace HAL {
+
+/*!
+  @class
+  
+  @discussion A JSPropertyAttributeSet is a set of JSPropertyAttribute
+  values held as a bitmask, so building, copying and converting one
+  never allocates. Its bits are the JavaScriptCore
+  kJSPropertyAttribute* constants.
+  
+  It converts implicitly from a JSPropertyAttribute, from a braced
+  list of them and from a std::unordered_set<JSPropertyAttribute>, so
+  existing callers keep compiling:
+  
+  js_object.SetProperty("foo", value, {JSPropertyAttribute::ReadOnly, JSPropertyAttribute::DontDelete});
+*/
+class HAL_EXPORT JSPropertyAttributeSet final {
+	
+public:
+	
+	HAL_CONSTEXPR JSPropertyAttributeSet() HAL_NOEXCEPT
+	: bits__(0) {
+	}
+	
+	HAL_CONSTEXPR JSPropertyAttributeSet(JSPropertyAttribute attribute) HAL_NOEXCEPT
+	: bits__(ToBit(attribute)) {
+	}
+	
+	JSPropertyAttributeSet(std::initializer_list<JSPropertyAttribute> attributes) HAL_NOEXCEPT
+	: bits__(0) {
+		for (auto attribute : attributes) {
+			bits__ |= ToBit(attribute);
+		}
+	}
+	
+	JSPropertyAttributeSet(const std::unordered_set<JSPropertyAttribute>& attributes) HAL_NOEXCEPT
+	: bits__(0) {
+		for (auto attribute : attributes) {
+			bits__ |= ToBit(attribute);
+		}
+	}
+	
+	static HAL_CONSTEXPR JSPropertyAttributeSet FromBits(std::uint32_t bits) HAL_NOEXCEPT {
+		return JSPropertyAttributeSet(bits & kAllBits, BitsTag());
+	}
+	
+	HAL_CONSTEXPR std::uint32_t get_bits() const HAL_NOEXCEPT {
+		return bits__;
+	}
+	
+	HAL_CONSTEXPR bool empty() const HAL_NOEXCEPT {
+		return bits__ == 0;
+	}
+	
+	/*!
+	  @method
+	  
+	  @abstract Return whether the set contains an attribute. Every set
+	  contains None.
+	*/
+	HAL_CONSTEXPR bool Contains(JSPropertyAttribute attribute) const HAL_NOEXCEPT {
+		return (bits__ & ToBit(attribute)) == ToBit(attribute);
+	}
+	
+	std::unordered_set<JSPropertyAttribute> ToUnorderedSet() const {
+		std::unordered_set<JSPropertyAttribute> attributes;
+		for (auto attribute : {JSPropertyAttribute::ReadOnly, JSPropertyAttribute::DontEnum, JSPropertyAttribute::DontDelete}) {
+			if (Contains(attribute)) {
+				attributes.insert(attribute);
+			}
+		}
+		return attributes;
+	}
+	
+	JSPropertyAttributeSet& operator|=(JSPropertyAttributeSet rhs) HAL_NOEXCEPT {
+		bits__ |= rhs.bits__;
+		return *this;
+	}
+	
+	friend HAL_CONSTEXPR JSPropertyAttributeSet operator|(JSPropertyAttributeSet lhs, JSPropertyAttributeSet rhs) HAL_NOEXCEPT {
+		return JSPropertyAttributeSet(lhs.bits__ | rhs.bits__, BitsTag());
+	}
+	
+	friend HAL_CONSTEXPR bool operator==(JSPropertyAttributeSet lhs, JSPropertyAttributeSet rhs) HAL_NOEXCEPT {
+		return lhs.bits__ == rhs.bits__;
+	}
+	
+	friend HAL_CONSTEXPR bool operator!=(JSPropertyAttributeSet lhs, JSPropertyAttributeSet rhs) HAL_NOEXCEPT {
+		return lhs.bits__ != rhs.bits__;
+	}
+	
+private:
+	
+	struct BitsTag {
+	};
+	
+	static const std::uint32_t kAllBits = (1u << 1) | (1u << 2) | (1u << 3);
+	
+	HAL_CONSTEXPR JSPropertyAttributeSet(std::uint32_t bits, BitsTag) HAL_NOEXCEPT
+	: bits__(bits) {
+	}
+	
+	// None is the empty set, and the others are bits 1 to 3 in
+	// declaration order, the same as kJSPropertyAttributeReadOnly,
+	// kJSPropertyAttributeDontEnum and kJSPropertyAttributeDontDelete.
+	static HAL_CONSTEXPR std::uint32_t ToBit(JSPropertyAttribute attribute) HAL_NOEXCEPT {
+		return attribute == JSPropertyAttribute::None ? 0u : 1u << static_cast<std::uint32_t>(attribute);
+	}
+	
+	std::uint32_t bits__;
+};
+
+inline HAL_CONSTEXPR JSPropertyAttributeSet operator|(JSPropertyAttribute lhs, JSPropertyAttribute rhs) HAL_NOEXCEPT {
+	return JSPropertyAttributeSet(lhs) | JSPropertyAttributeSet(rhs);
+}
+
+} // namespace HAL {
+
 #endif // _HAL_JSPROPERTYATTRIBUTE_HPP_
@@ -11,6 +11,8 @@
 
 #include "HAL/detail/JSBase.hpp"
 
+#include <cstddef>
+#include <iterator>
 #include <vector>
 
 namespace HAL {
@@ -52,6 +54,68 @@ namespace HAL {
      */
     JSString GetNameAtIndex(std::size_t index) const HAL_NOEXCEPT;
     
+    JSString operator[](std::size_t index) const HAL_NOEXCEPT;
+    
+    /*!
+     @class
+     
+     @discussion An input iterator over the names of a
+     JSPropertyNameArray. Each name becomes a JSString only when the
+     iterator is dereferenced.
+     */
+    class HAL_EXPORT const_iterator final {
+    public:
+      typedef std::input_iterator_tag iterator_category;
+      typedef JSString                value_type;
+      typedef std::ptrdiff_t          difference_type;
+      typedef const JSString*         pointer;
+      typedef JSString                reference;
+      
+      JSString operator*() const HAL_NOEXCEPT;
+      
+      const_iterator& operator++() HAL_NOEXCEPT {
+        ++index__;
+        return *this;
+      }
+      
+      const_iterator operator++(int) HAL_NOEXCEPT {
+        const auto result = *this;
+        ++index__;
+        return result;
+      }
+      
+      bool operator==(const const_iterator& rhs) const HAL_NOEXCEPT {
+        return index__ == rhs.index__;
+      }
+      
+      bool operator!=(const const_iterator& rhs) const HAL_NOEXCEPT {
+        return index__ != rhs.index__;
+      }
+      
+      std::size_t index() const HAL_NOEXCEPT {
+        return index__;
+      }
+      
+    private:
+      friend JSPropertyNameArray;
+      
+      const_iterator(const JSPropertyNameArray* js_property_name_array, std::size_t index) HAL_NOEXCEPT
+      : js_property_name_array__(js_property_name_array)
+      , index__(index) {
+      }
+      
+      const JSPropertyNameArray* js_property_name_array__;
+      std::size_t                index__;
+    };
+    
+    const_iterator begin() const HAL_NOEXCEPT {
+      return const_iterator(this, 0);
+    }
+    
+    const_iterator end() const HAL_NOEXCEPT {
+      return const_iterator(this, GetCount());
+    }
+    
     /*!
      @method
      
@@ -92,6 +156,12 @@ namespace HAL {
       return js_property_name_array_ref__;
     }
     
+    // Return the name at index without copying it. It is only valid
+    // while this JSPropertyNameArray is alive.
+    JSStringRef GetNameRefAtIndex(std::size_t index) const HAL_NOEXCEPT {
+      return JSPropertyNameArrayGetNameAtIndex(js_property_name_array_ref__, index);
+    }
+    
     // Prevent heap based objects.
     static void * operator new(std::size_t);       // #1: To prevent allocation of scalar objects
     static void * operator new [] (std::size_t);   // #2: To prevent allocation of array of objects
@@ -105,8 +175,8 @@ namespace HAL {
     
 #undef  HAL_JSPROPERTYNAMEARRAY_LOCK_GUARD
 #ifdef  HAL_THREAD_SAFE
-    std::recursive_mutex mutex__;
-#define HAL_JSPROPERTYNAMEARRAY_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+    detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSPropertyNameArray, "JSPropertyNameArray");
+#define HAL_JSPROPERTYNAMEARRAY_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
 #else
 #define HAL_JSPROPERTYNAMEARRAY_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
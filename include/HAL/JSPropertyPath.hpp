@@ -0,0 +1,102 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSPROPERTYPATH_HPP_
+#define _HAL_JSPROPERTYPATH_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSResult.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSPropertyPath reads a nested property, such as
+   "position.x", from native code.
+
+   Its property names are interned JSStrings, see JSString::Intern, so
+   creating a path once and reusing it creates no JSStringRef. The
+   objects along the path are reached through their JSObjectRefs, and
+   only the final value is wrapped in a JSValue.
+
+   Usage:
+
+   static const JSPropertyPath position_x("position.x");
+   const auto x = static_cast<double>(position_x.GetValue(js_sprite));
+   */
+  class HAL_EXPORT JSPropertyPath final HAL_PERFORMANCE_COUNTER1(JSPropertyPath) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Create a path from property names separated by '.'.
+
+     @throws std::invalid_argument if a property name is empty.
+     */
+    explicit JSPropertyPath(const std::string& path);
+
+    /*!
+     @method
+
+     @abstract Return the number of property names in the path.
+     */
+    std::size_t size() const HAL_NOEXCEPT {
+      return property_names__.size();
+    }
+
+    const std::string& get_path() const HAL_NOEXCEPT {
+      return path__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return the value at the end of this path, starting
+     from js_object.
+
+     @throws std::runtime_error if a value before the end of the path
+     is not an object, or getting a property threw a JavaScript
+     exception.
+     */
+    JSValue GetValue(const JSObject& js_object) const;
+
+    /*!
+     @method
+
+     @abstract Return the value at the end of this path, or why it
+     couldn't be read, without throwing a C++ exception.
+     */
+    JSResult<JSValue> TryGetValue(const JSObject& js_object) const;
+
+  private:
+
+    // Return the names of the first count properties of the path.
+    std::string GetPrefix(std::size_t count) const;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::string                  path__;
+    std::vector<const JSString*> property_names__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSPROPERTYPATH_HPP_
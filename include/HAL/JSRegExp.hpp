@@ -23,14 +23,49 @@ namespace HAL {
 */
 class HAL_EXPORT JSRegExp final : public JSObject HAL_PERFORMANCE_COUNTER2(JSRegExp) {
 	
+ public:
+	
+	/*!
+	  @method
+	  
+	  @abstract Return whether this RegExp matches a string, as
+	  RegExp.prototype.test does.
+	  
+	  @discussion RegExp.prototype.test is looked up once for each
+	  JSContext and called directly with the string, so a call makes
+	  no property lookup and creates no vector.
+	  
+	  @throws std::runtime_error if test threw a JavaScript exception.
+	*/
+	bool Test(const JSString& string) const;
+	
+	/*!
+	  @method
+	  
+	  @abstract Return the match of this RegExp in a string, as
+	  RegExp.prototype.exec does, through the same direct call as
+	  Test.
+	  
+	  @result An array of the match and its groups, or null if there
+	  is no match.
+	  
+	  @throws std::runtime_error if exec threw a JavaScript exception.
+	*/
+	JSValue Exec(const JSString& string) const;
+	
  private:
 	
 	// Only a JSContext can create a JSRegExp.
 	friend JSContext;
 
 	JSRegExp(const JSContext& js_context, const std::vector<JSValue>& arguments = {});
+	JSRegExp(const JSContext& js_context, const JSString& pattern, const JSString& flags);
+	JSRegExp(const JSContext& js_context, JSObjectRef js_object_ref);
+	
+	JSValueRef Call(JSObjectRef function_ref, const JSString& string) const;
 
 	static JSObjectRef MakeRegExp(const JSContext& js_context, const std::vector<JSValue>& arguments);
+	static JSObjectRef MakeRegExp(const JSContext& js_context, const JSString& pattern, const JSString& flags);
 };
 
 } // namespace HAL {
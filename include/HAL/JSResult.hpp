@@ -0,0 +1,327 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSRESULT_HPP_
+#define _HAL_JSRESULT_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <cassert>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace HAL {
+
+  namespace detail {
+
+    /*!
+     @class
+
+     @discussion The error of a failed JSResult, which is either a
+     message or the JavaScript exception that caused the failure. An
+     exception is kept as is and only converted to a message the first
+     time one is asked for, so that callers that just test the result
+     never pay for the conversion.
+     */
+    class JSResultError final {
+
+    public:
+
+      JSResultError() HAL_NOEXCEPT {
+      }
+
+      explicit JSResultError(std::string message) HAL_NOEXCEPT
+      : message__(std::move(message)) {
+      }
+
+      explicit JSResultError(const JSValue& exception) HAL_NOEXCEPT
+      : has_exception__(true) {
+        ::new (&exception__) JSValue(exception);
+      }
+
+      ~JSResultError() {
+        if (has_exception__) {
+          reinterpret_cast<JSValue*>(&exception__) -> ~JSValue();
+        }
+      }
+
+      JSResultError(const JSResultError& rhs)
+      : message__(rhs.message__)
+      , has_exception__(rhs.has_exception__) {
+        if (has_exception__) {
+          ::new (&exception__) JSValue(rhs.exception());
+        }
+      }
+
+      JSResultError(JSResultError&& rhs)
+      : message__(std::move(rhs.message__))
+      , has_exception__(rhs.has_exception__) {
+        if (has_exception__) {
+          ::new (&exception__) JSValue(std::move(*reinterpret_cast<JSValue*>(&rhs.exception__)));
+        }
+      }
+
+      // Create a copy of another JSResultError by assignment.
+      JSResultError& operator=(JSResultError rhs) {
+        if (has_exception__) {
+          reinterpret_cast<JSValue*>(&exception__) -> ~JSValue();
+        }
+
+        message__       = std::move(rhs.message__);
+        has_exception__ = rhs.has_exception__;
+        if (has_exception__) {
+          ::new (&exception__) JSValue(std::move(*reinterpret_cast<JSValue*>(&rhs.exception__)));
+        }
+
+        return *this;
+      }
+
+      bool has_exception() const HAL_NOEXCEPT {
+        return has_exception__;
+      }
+
+      const JSValue& exception() const HAL_NOEXCEPT {
+        assert(has_exception__);
+        return *reinterpret_cast<const JSValue*>(&exception__);
+      }
+
+      const std::string& message() const HAL_NOEXCEPT {
+        if (has_exception__ && message__.empty()) {
+          try {
+            message__ = static_cast<std::string>(exception());
+          } catch (...) {
+            message__ = "The JavaScript exception could not be converted to a string.";
+          }
+        }
+        return message__;
+      }
+
+      void Throw(const std::string& internal_component_name) const {
+        if (has_exception__) {
+          ThrowRuntimeError(internal_component_name, exception());
+        }
+        ThrowRuntimeError(internal_component_name, message__);
+      }
+
+    private:
+
+      // Silence 4251 on Windows since private member variables do not
+      // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+      mutable std::string                                                                     message__;
+      bool                                                                                    has_exception__ { false };
+      typename std::aligned_storage<sizeof(JSValue), std::alignment_of<JSValue>::value>::type exception__;
+#pragma warning(pop)
+    };
+
+  } // namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSResult is either the value a native method returns
+   or an error message. A native method bound with
+   JSExportClassDefinitionBuilder::AddFunctionProperty may return a
+   JSResult to report a failure, such as an invalid argument, as a
+   JavaScript Error without throwing a C++ exception.
+
+   A JSResult may instead hold the JavaScript exception a Try* method
+   such as JSObject::TryGetProperty caught, in which case it is
+   rethrown as is to JavaScript and only converted to an error message
+   when error_message is called.
+
+   For example:
+
+   JSResult<double> Foo::Scale(double factor) {
+     if (factor <= 0) {
+       return JSResult<double>::Error("factor must be positive");
+     }
+     return factor * size__;
+   }
+   */
+  template<typename R>
+  class JSResult final {
+
+  public:
+
+    JSResult(const R& value)
+    : ok__(true) {
+      ::new (&storage__) R(value);
+    }
+
+    JSResult(R&& value)
+    : ok__(true) {
+      ::new (&storage__) R(std::move(value));
+    }
+
+    static JSResult Error(std::string message) {
+      return JSResult(detail::JSResultError(std::move(message)));
+    }
+
+    static JSResult Exception(const JSValue& exception) {
+      return JSResult(detail::JSResultError(exception));
+    }
+
+    bool ok() const HAL_NOEXCEPT {
+      return ok__;
+    }
+
+    explicit operator bool() const HAL_NOEXCEPT {
+      return ok__;
+    }
+
+    const R& value() const HAL_NOEXCEPT {
+      assert(ok__);
+      return *reinterpret_cast<const R*>(&storage__);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the value, or throw the error as a
+     std::runtime_error if there isn't one.
+     */
+    const R& ValueOrThrow(const std::string& internal_component_name = "JSResult") const {
+      if (!ok__) {
+        error__.Throw(internal_component_name);
+      }
+      return value();
+    }
+
+    const std::string& error_message() const HAL_NOEXCEPT {
+      return error__.message();
+    }
+
+    bool has_exception() const HAL_NOEXCEPT {
+      return error__.has_exception();
+    }
+
+    // The JavaScript exception, which only a failed result created by
+    // Exception has.
+    const JSValue& exception() const HAL_NOEXCEPT {
+      return error__.exception();
+    }
+
+    ~JSResult() {
+      if (ok__) {
+        reinterpret_cast<R*>(&storage__) -> ~R();
+      }
+    }
+
+    JSResult(const JSResult& rhs)
+    : ok__(rhs.ok__)
+    , error__(rhs.error__) {
+      if (ok__) {
+        ::new (&storage__) R(rhs.value());
+      }
+    }
+
+    JSResult(JSResult&& rhs)
+    : ok__(rhs.ok__)
+    , error__(std::move(rhs.error__)) {
+      if (ok__) {
+        ::new (&storage__) R(std::move(*reinterpret_cast<R*>(&rhs.storage__)));
+      }
+    }
+
+    // Create a copy of another JSResult by assignment.
+    JSResult& operator=(JSResult rhs) {
+      if (ok__) {
+        reinterpret_cast<R*>(&storage__) -> ~R();
+      }
+
+      ok__    = rhs.ok__;
+      error__ = std::move(rhs.error__);
+      if (ok__) {
+        ::new (&storage__) R(std::move(*reinterpret_cast<R*>(&rhs.storage__)));
+      }
+
+      return *this;
+    }
+
+  private:
+
+    explicit JSResult(detail::JSResultError&& error)
+    : ok__(false)
+    , error__(std::move(error)) {
+    }
+
+    typename std::aligned_storage<sizeof(R), std::alignment_of<R>::value>::type storage__;
+    bool                                                                        ok__;
+    detail::JSResultError                                                       error__;
+  };
+
+  /*!
+   @class
+
+   @discussion A JSResult<void> is the result of a native method that
+   returns no value but may fail.
+   */
+  template<>
+  class JSResult<void> final {
+
+  public:
+
+    JSResult() HAL_NOEXCEPT {
+    }
+
+    static JSResult Error(std::string message) {
+      JSResult result;
+      result.ok__    = false;
+      result.error__ = detail::JSResultError(std::move(message));
+      return result;
+    }
+
+    static JSResult Exception(const JSValue& exception) {
+      JSResult result;
+      result.ok__    = false;
+      result.error__ = detail::JSResultError(exception);
+      return result;
+    }
+
+    bool ok() const HAL_NOEXCEPT {
+      return ok__;
+    }
+
+    explicit operator bool() const HAL_NOEXCEPT {
+      return ok__;
+    }
+
+    // Throw the error as a std::runtime_error if there is one.
+    void ThrowIfError(const std::string& internal_component_name = "JSResult") const {
+      if (!ok__) {
+        error__.Throw(internal_component_name);
+      }
+    }
+
+    const std::string& error_message() const HAL_NOEXCEPT {
+      return error__.message();
+    }
+
+    bool has_exception() const HAL_NOEXCEPT {
+      return error__.has_exception();
+    }
+
+    const JSValue& exception() const HAL_NOEXCEPT {
+      return error__.exception();
+    }
+
+  private:
+
+    bool                  ok__ { true };
+    detail::JSResultError error__;
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSRESULT_HPP_
@@ -0,0 +1,299 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSRUNLOOP_HPP_
+#define _HAL_JSRUNLOOP_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSPromiseResolver.hpp"
+#include "HAL/JSTaskPriority.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace HAL {
+
+  // A closure posted to a JSRunLoop, called on the run loop's thread
+  // with its JSContext.
+  typedef std::function<void(const JSContext& js_context)> JSRunLoopTask;
+
+  // A function RunFor calls on the run loop's thread when it runs out
+  // of tasks, with the time it would otherwise sleep until. A task
+  // posted meanwhile waits for it to return.
+  typedef std::function<void(const JSContext& js_context, std::chrono::steady_clock::time_point idle_deadline)> JSRunLoopIdleHandler;
+
+#ifdef _WIN32
+  // A HANDLE opened for overlapped I/O.
+  typedef void* JSIOHandle;
+#else
+  // A file descriptor.
+  typedef int   JSIOHandle;
+#endif
+
+  // The events of a handle watched by JSRunLoop::Watch.
+  enum : std::uint32_t {
+    kJSIOReadable = 1 << 0,
+    kJSIOWritable = 1 << 1,
+    kJSIOError    = 1 << 2
+  };
+
+  /*!
+   @struct
+
+   @discussion What a JSRunLoop reports about a watched handle. On
+   POSIX systems events has the kJSIO flags of what became ready. On
+   Windows each completed overlapped operation is reported on its own,
+   as kJSIOReadable, or kJSIOError if it failed, with its OVERLAPPED and
+   the number of bytes it transferred.
+   */
+  struct JSIOEvent {
+    std::uint32_t events;
+    std::uint32_t bytes_transferred;
+    void*         overlapped;
+  };
+
+  // A function called on the run loop's thread when a watched handle
+  // is ready.
+  typedef std::function<void(const JSContext& js_context, const JSIOEvent& io_event)> JSIOHandler;
+
+  /*!
+   @class
+
+   @discussion A JSRunLoop is the way back onto the thread that owns a
+   JSContext, e.g. to deliver the completion of an asynchronous native
+   operation to JavaScript.
+
+   Any thread may Post a task. Posting pushes onto a lock-free
+   multiple producer, single consumer queue, so producers neither
+   wait for each other nor for the task that is running. The owning
+   thread, the one that created the JSRunLoop, runs the queued tasks
+   in the order they were posted with RunUntilIdle or RunFor, so a
+   burst of completions is delivered in one batch without locking the
+   wrapper layer.
+
+   Each JSTaskPriority has its own queue, and a task is only run when
+   no task of a higher priority is queued, so input handling posted as
+   High isn't held back by a backlog of Background work. A queue may be
+   bounded with set_queue_options. Tasks discarded by the DropOldest
+   policy are destroyed on the owning thread, like tasks that run.
+
+   The owning thread sleeps in the operating system's I/O multiplexer,
+   epoll on Linux, kqueue on Apple platforms and an I/O completion port
+   on Windows, so native bindings can Watch their own descriptors and
+   handles and have the JavaScript thread woken for them directly. A
+   wakeup handles every ready handle, due delayed task and queued task
+   in one batch, and an idle run loop uses no CPU.
+
+   The owning thread may also post a task to run after a delay. Delayed
+   tasks are kept in a hierarchical timing wheel with a resolution of
+   one millisecond. Scheduling and cancelling one is O(1), and RunFor
+   sleeps until the next tick on which a delayed task may be due, so
+   many timers expiring close together cost one wakeup.
+
+   An exception thrown by a task propagates out of RunUntilIdle or
+   RunFor, and the tasks after it stay queued. Tasks still queued when
+   the last copy of the JSRunLoop is destroyed are discarded without
+   being run.
+
+   Copies of a JSRunLoop share the same queue, so give each producer
+   thread its own copy.
+   */
+  class HAL_EXPORT JSRunLoop final HAL_PERFORMANCE_COUNTER1(JSRunLoop) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Create a run loop owned by the calling thread.
+
+     @throws std::runtime_error if the I/O multiplexer can't be
+     created.
+     */
+    explicit JSRunLoop(const JSContext& js_context);
+
+    /*!
+     @method
+
+     @abstract Return the JSRunLoop most recently created for a
+     JSContext's global context, e.g. to post back to it from code that
+     was only handed the context.
+
+     @throws std::runtime_error if that JSRunLoop has been destroyed,
+     or the context never had one.
+     */
+    static JSRunLoop Get(const JSContext& js_context);
+
+    /*!
+     @method
+
+     @abstract Queue a task to run on the owning thread. May be called
+     from any thread, including from inside a task.
+
+     @discussion If the queue of priority is full, its policy decides
+     whether Post throws, waits for the owning thread to run a task of
+     that priority, or discards the oldest task of that priority.
+
+     @throws std::runtime_error if the context group has reached its
+     hard quota of queued tasks, or the queue of priority is full and
+     its policy is Reject, or Block when called on the owning thread.
+     */
+    void Post(JSRunLoopTask task, JSTaskPriority priority = JSTaskPriority::Normal) const;
+
+    /*!
+     @method
+
+     @abstract Bound the queue of a priority, or remove its bound with
+     a capacity of zero. May be called from any thread.
+
+     @discussion A smaller capacity doesn't discard tasks already
+     queued, it only applies to the tasks posted after it.
+     */
+    void set_queue_options(JSTaskPriority priority, const JSTaskQueueOptions& options) const;
+
+    JSTaskQueueOptions get_queue_options(JSTaskPriority priority) const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return what the queue of a priority has queued and run,
+     and how long its tasks waited to run. May be called from any
+     thread.
+     */
+    JSTaskLaneStatistics GetLaneStatistics(JSTaskPriority priority) const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Run the handlers of watched handles that are ready, the
+     delayed tasks that are due and the queued tasks until the queue is
+     empty, including the tasks they post. Must be called on the owning
+     thread.
+
+     @result The number of handlers and tasks run.
+     */
+    std::size_t RunUntilIdle() const;
+
+    /*!
+     @method
+
+     @abstract Queue a task to run on the owning thread once delay has
+     elapsed. Must be called on the owning thread.
+
+     @result An id for CancelDelayed, never zero.
+
+     @throws std::runtime_error if the context group has reached its
+     hard quota of queued tasks.
+     */
+    std::uint64_t PostDelayed(JSRunLoopTask task, std::chrono::steady_clock::duration delay) const;
+
+    /*!
+     @method
+
+     @abstract Cancel a delayed task that hasn't run yet. Must be
+     called on the owning thread.
+
+     @result false if the task already ran or was cancelled.
+     */
+    bool CancelDelayed(std::uint64_t id) const;
+
+    /*!
+     @method
+
+     @abstract Call handler on the owning thread whenever handle has
+     one of events ready. Must be called on the owning thread.
+
+     @discussion Descriptors are level-triggered, so handler is called
+     on every wakeup until it has read or written enough. On Windows
+     handle is associated with the run loop's I/O completion port, which
+     reports every overlapped operation on it that completes, and
+     events is ignored.
+
+     @result An id for Unwatch, never zero.
+
+     @throws std::runtime_error if handle can't be watched.
+     */
+    std::uint64_t Watch(JSIOHandle handle, std::uint32_t events, JSIOHandler handler) const;
+
+    /*!
+     @method
+
+     @abstract Stop calling the handler of a watched handle. Must be
+     called on the owning thread.
+
+     @discussion On Windows a handle can't be dissociated from the
+     completion port, so operations that complete later are dropped,
+     and the handle can't be watched again.
+
+     @result false if the id isn't being watched.
+     */
+    bool Unwatch(std::uint64_t id) const;
+
+    /*!
+     @method
+
+     @abstract Run tasks as they are posted, delayed tasks as they
+     come due and the handlers of watched handles as they become ready,
+     sleeping while there are none, until the duration has elapsed.
+     Must be called on the owning thread.
+
+     @discussion A task that is already running when the duration
+     elapses is finished, not interrupted.
+
+     @result The number of handlers and tasks run.
+     */
+    std::size_t RunFor(std::chrono::steady_clock::duration duration) const;
+
+    /*!
+     @method
+
+     @abstract Create a pending JavaScript promise, and a resolver that
+     settles it through this run loop. Must be called on the owning
+     thread.
+
+     @discussion Return the promise to JavaScript, e.g. from a JSExport
+     method, and hand the resolver to the background work that
+     completes it.
+
+     @result The promise and its resolver.
+     */
+    std::pair<JSObject, JSPromiseResolver> CreatePromise() const;
+
+    /*!
+     @method
+
+     @abstract Set the function RunFor calls once each time it runs
+     out of tasks before it sleeps, e.g. to do housekeeping such as
+     garbage collection in the gap. Pass nullptr to remove it. Must be
+     called on the owning thread.
+     */
+    void set_idle_handler(JSRunLoopIdleHandler idle_handler) const;
+
+    JSContext get_context() const HAL_NOEXCEPT;
+
+  private:
+
+    struct State;
+
+    explicit JSRunLoop(const std::shared_ptr<State>& state) HAL_NOEXCEPT;
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSRUNLOOP_HPP_
@@ -0,0 +1,165 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSRUNTIME_HPP_
+#define _HAL_JSRUNTIME_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  /*!
+   @enum
+
+   @abstract The highest tier JavaScriptCore may compile a function
+   to. Lower tiers start faster and use less memory, higher ones run
+   hot code faster.
+
+   @constant Default Leave JavaScriptCore's default.
+
+   @constant Interpreter Don't JIT compile at all.
+
+   @constant Baseline Use the baseline JIT only.
+
+   @constant DFG Use the baseline and DFG JITs, but not the FTL.
+
+   @constant FTL Use every tier.
+   */
+  enum class JSJITTier : std::uint8_t {
+    Default,
+    Interpreter,
+    Baseline,
+    DFG,
+    FTL
+  };
+
+  /*!
+   @enum
+
+   @abstract An option that is either left at JavaScriptCore's default,
+   or turned on or off.
+   */
+  enum class JSRuntimeSwitch : std::uint8_t {
+    Default,
+    On,
+    Off
+  };
+
+  /*!
+   @struct
+
+   @discussion JavaScriptCore's process-wide tunables, as given to
+   JSRuntime::ApplyOptions. Zero, or Default, leaves an option at
+   JavaScriptCore's default.
+   */
+  struct JSRuntimeOptions {
+    JSJITTier max_jit_tier { JSJITTier::Default };
+
+    // The heap size above which the collector runs as often as it
+    // must to stay below it, and the heap size it treats as small.
+    std::size_t max_heap_bytes   { 0 };
+    std::size_t small_heap_bytes { 0 };
+
+    unsigned gc_marker_thread_count    { 0 };
+    unsigned dfg_compiler_thread_count { 0 };
+    unsigned ftl_compiler_thread_count { 0 };
+
+    JSRuntimeSwitch concurrent_gc  { JSRuntimeSwitch::Default };
+    JSRuntimeSwitch concurrent_jit { JSRuntimeSwitch::Default };
+
+    // Any other option by its JavaScriptCore name, e.g.
+    // { "maximumInliningDepth", "3" }.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::map<std::string, std::string> extra_options;
+#pragma warning(pop)
+  };
+
+  /*!
+   @struct
+
+   @discussion One option as JavaScriptCore read it, or will read it.
+   */
+  struct JSRuntimeOptionValue {
+    // The JavaScriptCore name of the option.
+    std::string name;
+
+    // The value, if is_set. Otherwise JavaScriptCore uses its default.
+    std::string value;
+    bool        is_set { false };
+  };
+
+  /*!
+   @class
+
+   @discussion JSRuntime applies JavaScriptCore's process-wide options,
+   so that each deployment can trade startup time, throughput and
+   memory.
+
+   The public JavaScriptCore API has no way to set options, so they are
+   passed the way every JavaScriptCore build accepts them: as JSC_
+   environment variables, which it reads once when the first context
+   group, class or string of the process is created. ApplyOptions must
+   therefore be called at process start, before anything creates a
+   JSContextGroup, JSClass or JSString.
+
+   A JavaScriptCore that ignores an option, e.g. one built without the
+   FTL JIT, or the system framework on Apple platforms, which only
+   honors a few options outside of development, keeps its default.
+   GetEffectiveOptions reports what was handed to JavaScriptCore, from
+   ApplyOptions or from the environment the process was started with.
+   */
+  class HAL_EXPORT JSRuntime final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Hand options to JavaScriptCore. May be called more than
+     once before it starts, and options set by a later call replace
+     those of an earlier one. Options left at their defaults don't
+     change what the environment already sets.
+
+     @throws std::invalid_argument if an extra option has an empty or
+     malformed name, or an empty value.
+
+     @throws std::runtime_error if JavaScriptCore has already started,
+     see has_started.
+     */
+    static void ApplyOptions(const JSRuntimeOptions& options);
+
+    /*!
+     @method
+
+     @abstract Return the options of JSRuntimeOptions and the extra
+     options applied so far, as JavaScriptCore read them when it
+     started, or will read them if it hasn't yet.
+     */
+    static std::vector<JSRuntimeOptionValue> GetEffectiveOptions();
+
+    /*!
+     @method
+
+     @abstract Return whether a JSContextGroup, JSClass or JSString has
+     been created, after which options can no longer be applied.
+     */
+    static bool has_started() HAL_NOEXCEPT;
+
+    JSRuntime() = delete;
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSRUNTIME_HPP_
@@ -0,0 +1,256 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSSCRIPT_HPP_
+#define _HAL_JSSCRIPT_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContextGroup.hpp"
+#include "HAL/JSString.hpp"
+
+#ifdef HAL_SCRIPT_REF_ENABLE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSScript is a script that has been parsed once for a
+   JSContextGroup, and can then be evaluated any number of times in
+   any JSContext of that group by JSContext::JSEvaluateScript without
+   being parsed again.
+
+   Copying a JSScript is cheap, as all copies share the same
+   JSScriptRef.
+
+   A JSScript lives only as long as the process. The JavaScriptCore C
+   API has no way to serialize the bytecode of a JSScriptRef, so it
+   can't be cached on disk between runs; only the Objective-C JSScript
+   class of newer Apple releases offers that.
+   */
+  class HAL_EXPORT JSScript final HAL_PERFORMANCE_COUNTER1(JSScript) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Parse a script for a JSContextGroup.
+
+     @param js_context_group The JSContextGroup whose JSContexts may
+     evaluate the script.
+
+     @param script The script source.
+
+     @param source_url An optional URL for the script's source file,
+     used only when reporting exceptions.
+
+     @param starting_line_number An optional integer value specifying
+     the script's starting line number in the file located at
+     source_url.
+
+     @throws std::runtime_error if the script has a syntax error.
+     */
+    JSScript(const JSContextGroup& js_context_group, const JSString& script, const JSString& source_url = JSString(), int starting_line_number = 1);
+
+    JSContextGroup get_context_group() const HAL_NOEXCEPT {
+      return js_context_group__;
+    }
+
+    JSString get_source_url() const HAL_NOEXCEPT {
+      return source_url__;
+    }
+
+    int get_starting_line_number() const HAL_NOEXCEPT {
+      return starting_line_number__;
+    }
+
+    // For interoperability with the JavaScriptCore C API.
+    explicit operator JSScriptRef() const HAL_NOEXCEPT {
+      return js_script_ref__.get();
+    }
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSContextGroup                                          js_context_group__;
+    JSString                                                source_url__;
+    int                                                     starting_line_number__;
+    std::shared_ptr<std::remove_pointer<JSScriptRef>::type> js_script_ref__;
+#pragma warning(pop)
+  };
+
+  /*!
+   @class
+
+   @discussion A JSScriptSource is a script for
+   JSContextGroup::PrecompileAsync, with the source URL and starting
+   line number it will later be evaluated with.
+   */
+  struct JSScriptSource final {
+    JSScriptSource(const JSString& script, const JSString& source_url = JSString(), int starting_line_number = 1)
+    : script(script)
+    , source_url(source_url)
+    , starting_line_number(starting_line_number) {
+    }
+    
+    JSString script;
+    JSString source_url;
+    int      starting_line_number;
+  };
+
+  /*!
+   @class
+
+   @discussion A JSScriptCache holds the most recently used JSScripts
+   of a JSContextGroup, keyed by their source, source URL and starting
+   line number, so that evaluating the same script again in any
+   JSContext of the group skips parsing.
+
+   Looking a script up costs one hash of its source, which JSString
+   computes once and keeps, and a comparison with the cached source on
+   a hit.
+
+   A JSScriptCache registers itself with JSMemoryPressure while it
+   lives, so memory pressure evicts its least recently used JSScripts.
+
+   A JSScriptCache may be used from several threads at once, and
+   parses outside of its lock, so one thread parsing a long script
+   doesn't keep another from finding a cached one. Two threads parsing
+   the same script at once both succeed, and the first to finish is
+   kept.
+   */
+  class HAL_EXPORT JSScriptCache final HAL_PERFORMANCE_COUNTER1(JSScriptCache) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Create an empty cache of at most capacity JSScripts.
+     */
+    explicit JSScriptCache(const JSContextGroup& js_context_group, std::size_t capacity = 64);
+    ~JSScriptCache() HAL_NOEXCEPT;
+
+    JSScriptCache(const JSScriptCache&)            = delete;
+    JSScriptCache(JSScriptCache&&)                 = delete;
+    JSScriptCache& operator=(const JSScriptCache&) = delete;
+    JSScriptCache& operator=(JSScriptCache&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Return the cached JSScript for this source, source URL
+     and starting line number, parsing it first if it isn't cached. The
+     least recently used JSScript is evicted if the cache is full.
+
+     @throws std::runtime_error if the script has a syntax error.
+     */
+    JSScript GetScript(const JSString& script, const JSString& source_url = JSString(), int starting_line_number = 1);
+
+    /*!
+     @method
+
+     @abstract Return the cached JSScript for this source, source URL
+     and starting line number, or nullptr if it isn't cached, without
+     parsing it.
+
+     @discussion An empty cache returns without taking its lock, and
+     a hit shares the cached JSScript rather than copying it.
+     */
+    std::shared_ptr<const JSScript> Find(const JSString& script, const JSString& source_url = JSString(), int starting_line_number = 1);
+
+    /*!
+     @method
+
+     @abstract Return the number of cached JSScripts.
+     */
+    std::size_t size() const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Remove all cached JSScripts.
+     */
+    void clear() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Remove fraction of the cached JSScripts, least recently
+     used first, and return the approximate bytes their sources used.
+     */
+    std::size_t Evict(double fraction) HAL_NOEXCEPT;
+
+    JSContextGroup get_context_group() const HAL_NOEXCEPT {
+      return js_context_group__;
+    }
+
+  private:
+
+    struct Key {
+      JSString script;
+      JSString source_url;
+      int      starting_line_number;
+
+      bool operator==(const Key& rhs) const {
+        return starting_line_number == rhs.starting_line_number && source_url == rhs.source_url && script == rhs.script;
+      }
+    };
+
+    struct KeyHash {
+      std::size_t operator()(const Key& key) const {
+        return std::hash<JSString>()(key.script) ^ (std::hash<JSString>()(key.source_url) << 1) ^ static_cast<std::size_t>(key.starting_line_number);
+      }
+    };
+
+    // The most recently used entry is at the front.
+    typedef std::list<std::pair<Key, std::shared_ptr<const JSScript>>> EntryList;
+
+    // Update size__ after entries__ changes. The lock must be held.
+    void UpdateSize() HAL_NOEXCEPT {
+      size__.store(entries__.size(), std::memory_order_relaxed);
+    }
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSContextGroup                                        js_context_group__;
+    std::size_t                                           capacity__;
+    EntryList                                             entries__;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> index__;
+    std::uint64_t                                         js_memory_pressure_handler_id__ { 0 };
+#pragma warning(pop)
+
+    // The size of entries__, read without the lock.
+    std::atomic<std::size_t> size__ { 0 };
+
+    // Always locked, since JSContextGroup::PrecompileAsync fills the
+    // cache of a group from a thread of its own.
+    mutable detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSScriptCache, "JSScriptCache");
+#undef  HAL_JSSCRIPTCACHE_LOCK_GUARD
+#define HAL_JSSCRIPTCACHE_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
+  };
+
+} // namespace HAL {
+
+#endif // HAL_SCRIPT_REF_ENABLE
+
+#endif // _HAL_JSSCRIPT_HPP_
@@ -0,0 +1,56 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSSCRIPTSYNTAXCHECK_HPP_
+#define _HAL_JSSCRIPTSYNTAXCHECK_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  /*!
+   @struct
+
+   @discussion The result of checking the syntax of one script file.
+   When valid is false, message and line_number describe the first
+   syntax error, or why the file couldn't be read, in which case
+   line_number is 0.
+   */
+  struct JSScriptSyntaxDiagnostic {
+    std::string path;
+    bool        valid;
+    std::string message;
+    int         line_number;
+  };
+
+  /*!
+   @function
+
+   @abstract Check the syntax of many UTF-8 script files at once.
+
+   @discussion Each worker thread has its own JSContextGroup, since
+   the contexts of one group can't run concurrently, and takes the
+   next unchecked file whenever it finishes one, so a few large files
+   don't hold back the rest. Files are memory mapped rather than read
+   into a buffer.
+
+   @param paths The paths of the files to check.
+
+   @param thread_count The number of worker threads. Zero, the
+   default, uses one per hardware thread.
+
+   @result One diagnostic per path, in the same order as paths.
+   */
+  HAL_EXPORT std::vector<JSScriptSyntaxDiagnostic> CheckScriptSyntaxParallel(const std::vector<std::string>& paths, unsigned thread_count = 0);
+
+} // namespace HAL {
+
+#endif // _HAL_JSSCRIPTSYNTAXCHECK_HPP_
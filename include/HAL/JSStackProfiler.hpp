@@ -0,0 +1,99 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSSTACKPROFILER_HPP_
+#define _HAL_JSSTACKPROFILER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion JSStackProfiler shows which JavaScript call sites drive
+   the native code behind HAL. While it runs, every Nth call of each
+   thread into a JSExport class callback or a JSFunctionCallback
+   captures the JavaScript stack, the way JSError does, and counts it
+   with the native callback as its leaf.
+
+   The result is written in the folded stack format of flamegraph.pl
+   and speedscope, one "outer;inner;leaf count" line per stack.
+
+   Stacks are only sampled when HAL is built with
+   -DHAL_STACK_PROFILE_ENABLE=1, and then only between Start and Stop.
+   Otherwise each crossing costs one relaxed atomic load.
+   */
+  class HAL_EXPORT JSStackProfiler final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Discard the stacks sampled so far, and sample one in
+     every sample_interval calls into native code on each thread.
+
+     @throws std::invalid_argument if sample_interval is 0.
+     */
+    static void Start(std::uint32_t sample_interval = 1000);
+
+    /*!
+     @method
+
+     @abstract Stop sampling. The sampled stacks are kept until the
+     next Start.
+     */
+    static void Stop() HAL_NOEXCEPT;
+
+    static bool IsEnabled() HAL_NOEXCEPT {
+      return enabled__.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of stacks sampled since Start.
+     */
+    static std::size_t get_sample_count() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the stacks sampled since Start in the folded
+     stack format, sorted by stack.
+     */
+    static std::string ToFoldedStacks();
+
+    /*!
+     @method
+
+     @abstract Write ToFoldedStacks to the file at path.
+
+     @throws std::runtime_error if the file can't be written.
+     */
+    static void WriteFoldedStacks(const std::string& path);
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    static std::atomic<bool> enabled__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSSTACKPROFILER_HPP_
@@ -0,0 +1,126 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSSTATISTICS_HPP_
+#define _HAL_JSSTATISTICS_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+
+  class JSContext;
+  class JSContextGroup;
+
+  /*!
+   @struct
+
+   @discussion One value of a JSStatistics snapshot, such as
+   hal_export_live_objects{class="Widget"}.
+   */
+  struct JSStatisticsSample {
+    std::string                                      name;
+    std::string                                      help;
+    std::vector<std::pair<std::string, std::string>> labels;
+    double                                           value;
+  };
+
+  /*!
+   @class
+
+   @discussion A JSStatistics is a snapshot of the counters HAL keeps,
+   for monitoring to scrape from a live process:
+
+   1. The live and finalized instances and memory of every JSExport
+   class, the constants they cache, and the garbage collections HAL
+   requested, which are always counted.
+
+   2. With a JSContextGroup, what HAL protects in its JSContexts and
+   the heap they share (see JSContextGroup::GetStatistics), and with
+   HAL_API_STATISTICS_ENABLE the JavaScriptCore calls HAL made in
+   them.
+
+   3. The per-class object counters of HAL_PERFORMANCE_COUNTER_ENABLE,
+   the callback latencies of HAL_CALLBACK_LATENCY_ENABLE and the lock
+   counters of HAL_LOCK_STATISTICS_ENABLE, when HAL is built with
+   them.
+
+   The snapshot is written as JSON or in the Prometheus text
+   exposition format, and Install gives scripts a function that
+   returns it.
+   */
+  class HAL_EXPORT JSStatistics final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Capture the process wide counters.
+     */
+    static JSStatistics Capture();
+
+    /*!
+     @method
+
+     @abstract Capture the process wide counters and those of
+     js_context_group.
+     */
+    static JSStatistics Capture(const JSContextGroup& js_context_group);
+
+    /*!
+     @method
+
+     @abstract Define a function on the global object of js_context
+     that returns a JSStatistics of its JSContextGroup, parsed from
+     ToJSON.
+
+     @throws std::runtime_error if defining the function threw a
+     JavaScript exception.
+     */
+    static void Install(const JSContext& js_context, const std::string& function_name = "__hal_stats");
+
+    const std::vector<JSStatisticsSample>& get_samples() const HAL_NOEXCEPT {
+      return samples__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return the samples as a JSON object with a samples array
+     of { "name", "labels", "value" } objects.
+     */
+    std::string ToJSON() const;
+
+    /*!
+     @method
+
+     @abstract Return the samples in the Prometheus text exposition
+     format, as untyped metrics with their help text.
+     */
+    std::string ToPrometheus() const;
+
+  private:
+
+    void CaptureProcess();
+    void Add(const std::string& name, const std::string& help, std::vector<std::pair<std::string, std::string>> labels, double value);
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::vector<JSStatisticsSample> samples__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSSTATISTICS_HPP_
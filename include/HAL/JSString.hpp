@@ -18,6 +18,8 @@
 #include <vector>
 #include <utility>
 #include <mutex>
+#include <atomic>
+#include <functional>
 
 namespace HAL {
   class JSString;
@@ -45,6 +47,10 @@ namespace HAL {
    Specifically, a JSString is comparable with an equivalence relation,
    provides a strict weak ordering, and provides a custom hash
    function.
+   
+   A JSString created from a JSStringRef only converts it to UTF-8,
+   and computes its hash, the first time either is needed. This is
+   safe to trigger from several threads at once.
    */
     class HAL_EXPORT JSString final HAL_PERFORMANCE_COUNTER1(JSString) {
       
@@ -85,6 +91,60 @@ namespace HAL {
        */
       JSString(const std::string& string) HAL_NOEXCEPT;
       
+      /*!
+       @method
+       
+       @abstract Create a JavaScript string from a UTF8 string, taking
+       ownership of its buffer instead of copying it.
+       
+       @param string The UTF8 string to move into the new JSString.
+       
+       @result A JSString containing string.
+       */
+      JSString(std::string&& string) HAL_NOEXCEPT;
+      
+      /*!
+       @method
+       
+       @abstract Create a JavaScript string from a UTF8 string that need
+       not be null-terminated, such as a slice of a larger buffer.
+       
+       @param string The UTF8 code units to copy into the new JSString.
+       
+       @param length The number of bytes in string. The string must not
+       contain embedded null characters.
+       
+       @result A JSString containing string.
+       */
+      JSString(const char* string, std::size_t length) HAL_NOEXCEPT;
+      
+      /*!
+       @method
+       
+       @abstract Create a JavaScript string from UTF-16 code units
+       without converting them to UTF-8.
+       
+       @param string The UTF-16 code units to copy into the new
+       JSString.
+       
+       @param length The number of UTF-16 code units in string.
+       
+       @result A JSString containing string.
+       */
+      JSString(const char16_t* string, std::size_t length) HAL_NOEXCEPT;
+      
+      /*!
+       @method
+       
+       @abstract Create a JavaScript string from a UTF-16 string without
+       converting it to UTF-8.
+       
+       @param string The UTF-16 string to copy into the new JSString.
+       
+       @result A JSString containing string.
+       */
+      JSString(const std::u16string& string) HAL_NOEXCEPT;
+      
       /*!
        @method
        
@@ -128,6 +188,139 @@ namespace HAL {
        */
       operator std::string() const HAL_NOEXCEPT;
       
+      /*!
+       @class
+       
+       @discussion A U16View is a non-owning view of the UTF-16 code
+       units of a JSString. They are owned by JavaScriptCore and remain
+       valid for as long as the JSString, or any copy of it, is alive.
+       */
+      class U16View final {
+        
+      public:
+        
+        U16View(const char16_t* data, std::size_t size) HAL_NOEXCEPT
+        : data__(data)
+        , size__(size) {
+        }
+        
+        const char16_t* data() const HAL_NOEXCEPT {
+          return data__;
+        }
+        
+        std::size_t size() const HAL_NOEXCEPT {
+          return size__;
+        }
+        
+        bool empty() const HAL_NOEXCEPT {
+          return size__ == 0;
+        }
+        
+        const char16_t* begin() const HAL_NOEXCEPT {
+          return data__;
+        }
+        
+        const char16_t* end() const HAL_NOEXCEPT {
+          return data__ + size__;
+        }
+        
+        char16_t operator[](std::size_t index) const HAL_NOEXCEPT {
+          return data__[index];
+        }
+        
+        operator std::u16string() const {
+          return std::u16string(data__, size__);
+        }
+        
+      private:
+        
+        const char16_t* data__;
+        std::size_t     size__;
+      };
+      
+      /*!
+       @method
+       
+       @abstract Return a view of this JavaScript string's UTF-16 code
+       units without copying or transcoding them.
+       
+       @result A U16View over the buffer owned by JavaScriptCore.
+       */
+      U16View u16view() const HAL_NOEXCEPT;
+      
+      /*!
+       @method
+       
+       @abstract Convert this JavaScript string to a UTF-16 encoded
+       std::u16string.
+       
+       @result A copy of this JavaScript string's UTF-16 code units.
+       */
+      operator std::u16string() const;
+      
+      /*!
+       @method
+       
+       @abstract Return the interned JSString for a UTF-8 string.
+       
+       @discussion The first call for a given string creates a JSString
+       that lives for the rest of the process, and every later call
+       returns a reference to that same JSString. Use this for property
+       names that are looked up repeatedly to avoid creating a new
+       JSStringRef each time. Interning is thread-safe.
+       
+       @param string The null-terminated UTF8 string to intern.
+       
+       @result A reference to the interned JSString containing string.
+       */
+      static const JSString& Intern(const std::string& string);
+      
+      /*!
+       @method
+       
+       @abstract Create a JavaScript string from caller-owned UTF-16
+       memory, such as a memory-mapped script file.
+       
+       @discussion The code units are copied straight into the new
+       JSStringRef, with no intermediate std::string and no UTF-8
+       transcoding, and the new JSString stays lazy. release is called
+       as soon as JavaScriptCore has its copy, so the caller can unmap
+       the buffer before the script is evaluated and only one copy of
+       the source stays resident.
+       
+       @param buffer The UTF-16 code units.
+       
+       @param length The number of UTF-16 code units in buffer.
+       
+       @param release Called once buffer is no longer needed. May be
+       empty.
+       
+       @result A JSString containing the contents of buffer.
+       */
+      static JSString FromExternalBuffer(const char16_t* buffer, std::size_t length, const std::function<void()>& release = nullptr);
+      
+      /*!
+       @method
+       
+       @abstract Create a JavaScript string from caller-owned Latin-1
+       memory.
+       
+       @discussion Behaves like the UTF-16 FromExternalBuffer, except
+       that buffer is first widened to UTF-16 in vector blocks. If
+       buffer is ASCII it isn't widened, so that JavaScriptCore keeps
+       it in 8-bit characters.
+       
+       @param buffer The Latin-1 characters.
+       
+       @param length The number of bytes in buffer.
+       
+       @param release Called once buffer is no longer needed. May be
+       empty.
+       
+       @result A JSString containing the contents of buffer.
+       */
+      static JSString FromExternalLatin1Buffer(const char* buffer, std::size_t length, const std::function<void()>& release = nullptr);
+      
       std::size_t hash_value() const;
       
       ~JSString()                   HAL_NOEXCEPT;
@@ -162,10 +355,17 @@ namespace HAL {
       template<typename T>
       friend class detail::JSExportClass; // static functions
       
+      // Seeds hash_value__ with the hash stored in the bundle.
+      friend class JSBundle;
+      
       // Prevent heap based objects.
       static void * operator new(std::size_t);     // #1: To prevent allocation of scalar objects
       static void * operator new [] (std::size_t); // #2: To prevent allocation of array of objects
       
+      // Return the UTF-8 form of this string, converting it from
+      // js_string_ref__ on first use.
+      const std::string& get_string() const;
+      
       friend void swap(JSString& first, JSString& second) HAL_NOEXCEPT;
       HAL_EXPORT friend bool operator==(const JSString& lhs, const JSString& rhs);
       
@@ -174,14 +374,19 @@ namespace HAL {
 #pragma warning(push)
 #pragma warning(disable: 4251)
       JSStringRef    js_string_ref__ { nullptr };
-      std::string    string__;
-      std::size_t    hash_value__;
+      
+      // Valid only once string_valid__ is true.
+      mutable std::string              string__;
+      mutable std::atomic<bool>        string_valid__ { false };
+      
+      // Zero until hash_value is first called.
+      mutable std::atomic<std::size_t> hash_value__ { 0 };
 #pragma warning(pop)
       
 #undef HAL_JSSTRING_LOCK_GUARD
 #ifdef  HAL_THREAD_SAFE
-      std::recursive_mutex mutex__;
-#define HAL_JSSTRING_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+      detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSString, "JSString");
+#define HAL_JSSTRING_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
 #else
 #define HAL_JSSTRING_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
@@ -201,11 +406,9 @@ namespace HAL {
       return ! (lhs == rhs);
     }
     
-    // Define a strict weak ordering for two JSStrings.
-    inline
-    bool operator<(const JSString& lhs, const JSString& rhs) {
-      return to_string(lhs) < to_string(rhs);
-    }
+    // Define a strict weak ordering for two JSStrings by comparing
+    // their UTF-16 code units.
+    HAL_EXPORT bool operator<(const JSString& lhs, const JSString& rhs);
     
     inline
     bool operator>(const JSString& lhs, const JSString& rhs) {
@@ -0,0 +1,207 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSSTRINGBUILDER_HPP_
+#define _HAL_JSSTRINGBUILDER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  class JSString;
+  class JSValue;
+  class JSContext;
+
+  /*!
+   @class
+
+   @discussion A JSStringBuilder incrementally builds a large
+   JavaScript string, such as a generated script or JSON document.
+
+   Appended text is transcoded once into a growable UTF-16 buffer,
+   which is handed to JavaScriptCore when the string is finished. This
+   avoids both the repeated reallocation of growing a std::string and
+   the UTF-8 conversion of the finished result.
+
+   Usage:
+
+   JSStringBuilder builder;
+   builder.reserve(1024);
+   builder.Append("var x = ").Append(value).Append(";");
+   auto js_value = builder.ToJSValue(js_context);
+   */
+  class HAL_EXPORT JSStringBuilder final HAL_PERFORMANCE_COUNTER1(JSStringBuilder) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Create an empty JSStringBuilder.
+     */
+    JSStringBuilder() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Create an empty JSStringBuilder with room for capacity
+     UTF-16 code units.
+     */
+    explicit JSStringBuilder(std::size_t capacity);
+
+    /*!
+     @method
+
+     @abstract Make room for at least capacity UTF-16 code units in
+     total.
+     */
+    void reserve(std::size_t capacity);
+
+    /*!
+     @method
+
+     @abstract Return the number of UTF-16 code units appended so far.
+     */
+    std::size_t size() const HAL_NOEXCEPT {
+      return buffer__.size();
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of UTF-16 code units this builder can
+     hold without reallocating.
+     */
+    std::size_t capacity() const HAL_NOEXCEPT {
+      return buffer__.capacity();
+    }
+
+    /*!
+     @method
+
+     @abstract Return true if nothing has been appended.
+     */
+    bool empty() const HAL_NOEXCEPT {
+      return buffer__.empty();
+    }
+
+    /*!
+     @method
+
+     @abstract Remove everything appended so far, keeping the
+     capacity.
+     */
+    void clear() HAL_NOEXCEPT {
+      buffer__.clear();
+    }
+
+    /*!
+     @method
+
+     @abstract Append UTF-8 text. Malformed sequences are replaced
+     with U+FFFD.
+
+     @param string The UTF-8 text, which need not be null-terminated.
+
+     @param length The number of bytes in string.
+
+     @result This JSStringBuilder.
+     */
+    JSStringBuilder& Append(const char* string, std::size_t length);
+    JSStringBuilder& Append(const char* string);
+    JSStringBuilder& Append(const std::string& string);
+
+    /*!
+     @method
+
+     @abstract Append UTF-16 code units without conversion.
+
+     @result This JSStringBuilder.
+     */
+    JSStringBuilder& Append(const char16_t* string, std::size_t length);
+    JSStringBuilder& Append(const std::u16string& string);
+    JSStringBuilder& Append(char16_t character);
+
+    /*!
+     @method
+
+     @abstract Append the UTF-16 code units of a JSString without
+     converting them to UTF-8.
+
+     @result This JSStringBuilder.
+     */
+    JSStringBuilder& Append(const JSString& js_string);
+
+    /*!
+     @method
+
+     @abstract Append a JSON string literal: the text in double quotes,
+     with quotes, backslashes and control characters escaped.
+
+     @result This JSStringBuilder.
+     */
+    JSStringBuilder& AppendJSONString(const char* string, std::size_t length);
+    JSStringBuilder& AppendJSONString(const char* string);
+    JSStringBuilder& AppendJSONString(const std::string& string);
+    JSStringBuilder& AppendJSONString(const JSString& js_string);
+
+    /*!
+     @method
+
+     @abstract Append a JSON number. Integers are written without a
+     fraction, other numbers with enough digits to read back exactly,
+     and NaN and the infinities as null, as JSON.stringify does.
+
+     @result This JSStringBuilder.
+     */
+    JSStringBuilder& AppendJSONNumber(double number);
+
+    /*!
+     @method
+
+     @abstract Create a JSString from everything appended so far.
+     */
+    JSString ToJSString() const;
+
+    /*!
+     @method
+
+     @abstract Create a JavaScript value of the string type from
+     everything appended so far.
+     */
+    JSValue ToJSValue(const JSContext& js_context) const;
+
+    /*!
+     @method
+
+     @abstract Parse everything appended so far as JSON, without
+     first making a JSString of it.
+
+     @throws std::runtime_error if the text isn't valid JSON.
+     */
+    JSValue ToJSONValue(const JSContext& js_context) const;
+
+  private:
+
+    void AppendJSONEscaped(const JSChar* characters, std::size_t length);
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::vector<JSChar> buffer__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSSTRINGBUILDER_HPP_
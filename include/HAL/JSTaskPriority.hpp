@@ -0,0 +1,101 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSTASKPRIORITY_HPP_
+#define _HAL_JSTASKPRIORITY_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace HAL {
+
+  /*!
+   @enum
+
+   @abstract The lane of a JSRunLoop or JSWorkerPool a task is queued
+   in.
+
+   @discussion Lanes are served in strict priority order: a task is
+   only taken from a lane when every higher lane is empty, so a High
+   task waits at most for the task that is already running. Within a
+   lane tasks keep the order they were queued in.
+
+   @constant High Latency critical work, e.g. handling user input or
+   answering a health check.
+
+   @constant Normal Everything else. The default.
+
+   @constant Background Bulk work that can wait while there is anything
+   else to do.
+   */
+  enum class JSTaskPriority : std::uint8_t {
+    High,
+    Normal,
+    Background
+  };
+
+  static const std::size_t kJSTaskPriorityCount = 3;
+
+  HAL_EXPORT const char* to_string(JSTaskPriority priority) HAL_NOEXCEPT;
+
+  /*!
+   @enum
+
+   @abstract What queuing a task does when its lane is full.
+
+   @constant Reject Throw std::runtime_error, and queue nothing.
+
+   @constant Block Wait until a task leaves the lane. A thread that
+   runs the lane's tasks can't wait for itself, so for it Block acts as
+   Reject.
+
+   @constant DropOldest Queue the task, and discard the oldest task of
+   the lane without running it.
+   */
+  enum class JSBackpressurePolicy : std::uint8_t {
+    Reject,
+    Block,
+    DropOldest
+  };
+
+  /*!
+   @struct
+
+   @discussion The bound of one lane. A capacity of zero, the default,
+   leaves the lane unbounded.
+   */
+  struct JSTaskQueueOptions {
+    std::size_t          capacity { 0 };
+    JSBackpressurePolicy policy   { JSBackpressurePolicy::Reject };
+  };
+
+  /*!
+   @struct
+
+   @discussion What a lane has queued and run. The queueing delay of a
+   task is the time from it being queued to it starting to run, and
+   its percentiles are known to within 1/16th.
+   */
+  struct JSTaskLaneStatistics {
+    std::size_t              queued_count   { 0 };
+    std::uint64_t            enqueued_count { 0 };
+    std::uint64_t            run_count      { 0 };
+    std::uint64_t            rejected_count { 0 };
+    std::uint64_t            dropped_count  { 0 };
+    std::chrono::nanoseconds total_queueing_delay { 0 };
+    std::chrono::nanoseconds max_queueing_delay   { 0 };
+    std::chrono::nanoseconds p50_queueing_delay   { 0 };
+    std::chrono::nanoseconds p99_queueing_delay   { 0 };
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSTASKPRIORITY_HPP_
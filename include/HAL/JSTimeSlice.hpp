@@ -0,0 +1,47 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSTIMESLICE_HPP_
+#define _HAL_JSTIMESLICE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <chrono>
+#include <functional>
+
+namespace HAL {
+
+  /*!
+   @function
+
+   @abstract Run chunked work until it is done or a time budget is
+   spent.
+
+   @discussion step does one small chunk of the work, such as
+   evaluating one script or calling one JavaScript function, and
+   returns true while more work remains. At least one step always
+   runs, and no step is started once the budget has elapsed, so the
+   overrun is at most the length of one step.
+
+   This cooperates with, rather than replaces,
+   JSContextGroup::SetExecutionTimeLimit, which stops a single step
+   that never returns.
+
+   @param step The function doing one chunk of work.
+
+   @param budget The time after which no more steps are started.
+
+   @result true if the work finished, or false if the budget ran out
+   first, in which case calling RunTimeSliced again with the same step
+   resumes it.
+   */
+  HAL_EXPORT bool RunTimeSliced(const std::function<bool()>& step, std::chrono::steady_clock::duration budget);
+
+} // namespace HAL {
+
+#endif // _HAL_JSTIMESLICE_HPP_
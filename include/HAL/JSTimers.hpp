@@ -0,0 +1,81 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSTIMERS_HPP_
+#define _HAL_JSTIMERS_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSRunLoop.hpp"
+
+#include <cstddef>
+#include <memory>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion JSTimers implements the setTimeout, setInterval,
+   clearTimeout and clearInterval functions of web browsers and
+   Node.js on top of the delayed tasks of a JSRunLoop, so timers fire
+   while the owning thread runs the run loop.
+
+   Timers have a resolution of one millisecond, and a negative or NaN
+   delay is taken as zero. A timer callback is called with the global
+   object as this and with the extra arguments given to setTimeout or
+   setInterval. Passing a string of code instead of a function throws
+   an Error. An exception thrown by a callback propagates out of the
+   run loop, and an interval keeps running after it.
+
+   The installed functions throw once every copy of the JSTimers that
+   installed them is destroyed, and pending timers are cancelled then.
+   JSTimers and its functions must only be used on the run loop's
+   thread.
+   */
+  class HAL_EXPORT JSTimers final HAL_PERFORMANCE_COUNTER1(JSTimers) {
+
+  public:
+
+    explicit JSTimers(const JSRunLoop& js_run_loop);
+
+    /*!
+     @method
+
+     @abstract Set setTimeout, setInterval, clearTimeout and
+     clearInterval as properties of an object, usually the global
+     object of the run loop's JSContext.
+     */
+    void Install(JSObject object) const;
+
+    /*!
+     @method
+
+     @abstract Return the number of timers that haven't fired or been
+     cleared, counting each interval until it is cleared.
+     */
+    std::size_t get_timer_count() const HAL_NOEXCEPT;
+
+  private:
+
+    struct State;
+    struct Binding;
+
+    static JSValueRef CallFunction(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
+    static void       FinalizeFunction(JSObjectRef function_ref);
+    static JSClassRef GetFunctionClass();
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSTIMERS_HPP_
@@ -0,0 +1,107 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSTRACE_HPP_
+#define _HAL_JSTRACE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion JSTrace records a timeline of what HAL does in the
+   Chrome trace event format, which opens in chrome://tracing or
+   Perfetto. Script evaluation, JSObject::CallAsFunction, the
+   JavaScriptCore callbacks of JSExport classes, their finalizers and
+   garbage collection are each an event with its thread and duration,
+   so events that nest on a thread nest in the timeline.
+
+   Events are only recorded when HAL is built with
+   -DHAL_TRACE_ENABLE=1, and then only between Start and Stop. Each
+   thread appends to a buffer of its own without locking, and drops
+   events once kBufferCapacity are recorded. Write the trace after
+   Stop, once the traced threads have left HAL.
+   */
+  class HAL_EXPORT JSTrace final {
+
+  public:
+
+    // The events each thread records before it drops the rest.
+    static const std::size_t kBufferCapacity = 1 << 15;
+
+    /*!
+     @method
+
+     @abstract Discard the events recorded so far and start recording.
+     */
+    static void Start() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Stop recording. The recorded events are kept until the
+     next Start.
+     */
+    static void Stop() HAL_NOEXCEPT;
+
+    static bool IsEnabled() HAL_NOEXCEPT {
+      return enabled__.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of events recorded since Start.
+     */
+    static std::size_t get_event_count() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the number of events dropped since Start because
+     the buffer of their thread was full.
+     */
+    static std::size_t get_dropped_event_count() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return the events recorded since Start as a Chrome trace
+     event JSON object.
+     */
+    static std::string ToJSON();
+
+    /*!
+     @method
+
+     @abstract Write ToJSON to the file at path.
+
+     @throws std::runtime_error if the file can't be written.
+     */
+    static void WriteJSON(const std::string& path);
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    static std::atomic<bool> enabled__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSTRACE_HPP_
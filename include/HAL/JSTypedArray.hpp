@@ -0,0 +1,184 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSTYPEDARRAY_HPP_
+#define _HAL_JSTYPEDARRAY_HPP_
+
+#include "HAL/JSObject.hpp"
+#include "HAL/JSArrayBuffer.hpp"
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion JSTypedArrayTraits<T>::type is the JSTypedArrayType
+   whose elements are of the C++ type T. Uint8ClampedArray has the
+   same element type as Uint8Array, so it can't be created through a
+   JSTypedArray.
+   */
+  template<typename T>
+  struct JSTypedArrayTraits;
+
+  template<> struct JSTypedArrayTraits<std::int8_t>   { static const JSTypedArrayType type = kJSTypedArrayTypeInt8Array;    };
+  template<> struct JSTypedArrayTraits<std::uint8_t>  { static const JSTypedArrayType type = kJSTypedArrayTypeUint8Array;   };
+  template<> struct JSTypedArrayTraits<std::int16_t>  { static const JSTypedArrayType type = kJSTypedArrayTypeInt16Array;   };
+  template<> struct JSTypedArrayTraits<std::uint16_t> { static const JSTypedArrayType type = kJSTypedArrayTypeUint16Array;  };
+  template<> struct JSTypedArrayTraits<std::int32_t>  { static const JSTypedArrayType type = kJSTypedArrayTypeInt32Array;   };
+  template<> struct JSTypedArrayTraits<std::uint32_t> { static const JSTypedArrayType type = kJSTypedArrayTypeUint32Array;  };
+  template<> struct JSTypedArrayTraits<float>         { static const JSTypedArrayType type = kJSTypedArrayTypeFloat32Array; };
+  template<> struct JSTypedArrayTraits<double>        { static const JSTypedArrayType type = kJSTypedArrayTypeFloat64Array; };
+
+  // The non-template part of JSTypedArray and
+  // JSContext::CreateTypedArray. Each throws a std::runtime_error if
+  // JavaScriptCore reports an exception.
+  HAL_EXPORT JSObjectRef MakeTypedArray(const JSContext& js_context, JSTypedArrayType type, std::size_t length);
+  HAL_EXPORT JSObjectRef MakeTypedArrayWithBytesNoCopy(const JSContext& js_context, JSTypedArrayType type, void* bytes, std::size_t byte_length, JSBytesDeallocator deallocator);
+  HAL_EXPORT void        CheckTypedArrayType(const JSContext& js_context, JSObjectRef js_object_ref, JSTypedArrayType type);
+  HAL_EXPORT void*       GetTypedArrayBytesPtr(const JSContext& js_context, JSObjectRef js_object_ref);
+  HAL_EXPORT std::size_t GetTypedArrayLength(const JSContext& js_context, JSObjectRef js_object_ref);
+  HAL_EXPORT std::size_t GetTypedArrayByteLength(const JSContext& js_context, JSObjectRef js_object_ref);
+  HAL_EXPORT std::size_t GetTypedArrayByteOffset(const JSContext& js_context, JSObjectRef js_object_ref);
+  HAL_EXPORT JSObjectRef GetTypedArrayBuffer(const JSContext& js_context, JSObjectRef js_object_ref);
+
+}} // namespace HAL { namespace detail {
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JavaScript typed array whose elements are of the C++
+   type T, e.g. a Float64Array for JSTypedArray<double>.
+
+   Its elements are read and written in place through GetBytesPtr, so
+   moving data between C++ and JavaScript costs no copy and no
+   JSValue per element.
+
+   A JSTypedArray is created by using one of the
+   JSContext::CreateTypedArray member functions, or by converting a
+   JSObject that is a typed array of the matching type.
+   */
+  template<typename T>
+  class JSTypedArray final : public JSObject HAL_PERFORMANCE_COUNTER2(JSTypedArray<T>) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Convert a JSObject to a JSTypedArray.
+
+     @throws std::runtime_error if the JSObject isn't a typed array
+     whose elements are of type T.
+     */
+    explicit JSTypedArray(const JSObject& js_object)
+    : JSTypedArray(js_object.js_context__, js_object.js_object_ref__) {
+    }
+
+    /*!
+     @method
+
+     @abstract Return a pointer to the first element of this typed
+     array. The pointer stays valid for as long as this JSTypedArray is
+     alive.
+     */
+    T* GetBytesPtr() const {
+      return static_cast<T*>(detail::GetTypedArrayBytesPtr(js_context__, js_object_ref__));
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of elements of this typed array.
+     */
+    std::size_t GetLength() const {
+      return detail::GetTypedArrayLength(js_context__, js_object_ref__);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of bytes of this typed array.
+     */
+    std::size_t GetByteLength() const {
+      return detail::GetTypedArrayByteLength(js_context__, js_object_ref__);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the offset in bytes of this typed array into its
+     ArrayBuffer.
+     */
+    std::size_t GetByteOffset() const {
+      return detail::GetTypedArrayByteOffset(js_context__, js_object_ref__);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the ArrayBuffer this typed array is a view of.
+     */
+    JSArrayBuffer GetBuffer() const {
+      return JSArrayBuffer(js_context__, detail::GetTypedArrayBuffer(js_context__, js_object_ref__));
+    }
+
+  private:
+
+    // Only JSContext can create a JSTypedArray from a JSObjectRef.
+    friend JSContext;
+
+    // For interoperability with the JavaScriptCore C API.
+    JSTypedArray(const JSContext& js_context, JSObjectRef js_object_ref)
+    : JSObject(js_context, js_object_ref) {
+      detail::CheckTypedArrayType(js_context, js_object_ref, detail::JSTypedArrayTraits<T>::type);
+    }
+  };
+
+  template<typename T>
+  JSTypedArray<T> JSContext::CreateTypedArray(std::size_t length) const {
+    return JSTypedArray<T>(*this, detail::MakeTypedArray(*this, detail::JSTypedArrayTraits<T>::type, length));
+  }
+
+  template<typename T>
+  JSTypedArray<T> JSContext::CreateTypedArray(T* elements, std::size_t length, JSBytesDeallocator deallocator) const {
+    return JSTypedArray<T>(*this, detail::MakeTypedArrayWithBytesNoCopy(*this, detail::JSTypedArrayTraits<T>::type, elements, length * sizeof(T), std::move(deallocator)));
+  }
+
+  template<typename T>
+  JSTypedArray<T> JSContext::CreateTypedArray(std::vector<T>&& elements) const {
+    if (elements.empty()) {
+      return CreateTypedArray<T>(0);
+    }
+
+    // The vector moves to the heap and is freed along with the
+    // ArrayBuffer, so its elements are never copied.
+    auto vector_ptr = new std::vector<T>(std::move(elements));
+    try {
+      return CreateTypedArray<T>(vector_ptr -> data(), vector_ptr -> size(), [vector_ptr](void*) {
+        delete vector_ptr;
+      });
+    } catch (...) {
+      delete vector_ptr;
+      throw;
+    }
+  }
+
+} // namespace HAL {
+
+#endif // HAL_TYPED_ARRAY_ENABLE
+
+#endif // _HAL_JSTYPEDARRAY_HPP_
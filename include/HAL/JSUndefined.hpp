@@ -28,8 +28,8 @@ private:
 	// Only a JSContext can create a JSUndefined.
 	friend JSContext;
 	
-	explicit JSUndefined(const JSContext& js_context)
-			: JSValue(js_context, JSValueMakeUndefined(static_cast<JSContextRef>(js_context))) {
+	JSUndefined(const JSContext& js_context, JSValueRef js_value_ref)
+			: JSValue(js_context, js_value_ref, kJSTypeUndefined, true) {
 	}
 };
 
@@ -12,8 +12,11 @@
 #include "HAL/detail/JSBase.hpp"
 #include "HAL/JSContext.hpp"
 
+#include <cstddef>
+#include <functional>
 #include <vector>
 #include <ostream>
+#include <cstdint>
 
 namespace HAL {
   class JSString;
@@ -27,6 +30,9 @@ namespace HAL {
   class JSError;
   class JSRegExp;
   
+  template<typename R>
+  class JSResult;
+  
   namespace detail {
     template<typename T>
     class JSExportClass;
@@ -91,6 +97,31 @@ namespace HAL {
      */
     virtual JSString ToJSONString(unsigned indent = 0) final;
     
+    /*!
+     @method
+     
+     @abstract Write the JSON serialized representation of this
+     JavaScript value as UTF-8, without building a JSString or a
+     std::string.
+     
+     @discussion The serialized UTF-16 string is transcoded in
+     fixed-size chunks, each passed to output as soon as it is ready,
+     so no buffer ever holds the whole UTF-8 string.
+     
+     @param output Called with each chunk of UTF-8, in order.
+     
+     @param indent The number of spaces to indent when nesting, as for
+     ToJSONString.
+     
+     @result false if this value has no JSON representation, such as
+     undefined, in which case nothing is written.
+     
+     @throws std::runtime_error if serializing threw a JavaScript
+     exception, such as for a cyclic object.
+     */
+    virtual bool WriteJSON(const std::function<void(const char* data, std::size_t length)>& output, unsigned indent = 0) final;
+    virtual bool WriteJSON(std::ostream& ostream, unsigned indent = 0) final;
+    
     /*!
      @method
      
@@ -109,6 +140,23 @@ namespace HAL {
      */
     explicit operator std::string() const;
     
+    /*!
+     @method
+     
+     @abstract Convert this JSValue to a string and append its UTF-8
+     form to buffer.
+     
+     @discussion Unlike operator std::string this reuses the capacity
+     of buffer, so a caller reading many string properties in a loop
+     can avoid allocating for each one.
+     
+     @param buffer The std::string to append to.
+     
+     @throws std::runtime_error if the conversion threw a JavaScript
+     exception.
+     */
+    void AppendTo(std::string& buffer) const;
+    
     /*!
      @method
      
@@ -123,10 +171,25 @@ namespace HAL {
      
      @abstract Convert a JSValue to a double.
      
+     @discussion A JSValue known to be a number, because it came from
+     JSContext::CreateNumber or IsNumber returned true, converts
+     without setting up a check for a JavaScript exception.
+     
      @result The double result of conversion.
      */
     explicit operator double() const;
     
+    /*!
+     @method
+     
+     @abstract Convert a JSValue to a double without throwing a C++
+     exception.
+     
+     @result The double result of conversion, or the JavaScript
+     exception the conversion threw, such as from a valueOf method.
+     */
+    JSResult<double> TryToNumber() const;
+    
     /*!
      @method
      
@@ -156,6 +219,19 @@ namespace HAL {
       return operator int32_t();
     }
     
+    /*!
+     @method
+     
+     @abstract Convert a JSValue to an int64_t by rounding its number
+     towards zero.
+     
+     @discussion NaN converts to 0, and numbers beyond the int64_t
+     range to its nearest end.
+     
+     @result The int64_t result of the conversion.
+     */
+    explicit operator int64_t() const;
+    
     /*!
      @method
      
@@ -173,6 +249,12 @@ namespace HAL {
      
      @abstract Return this JavaScript value's type.
      
+     @discussion The type of a JavaScript value never changes, so it
+     is asked of JavaScriptCore only the first time and kept, and IsUndefined,
+     IsNull, IsBoolean, IsNumber, IsString and IsObject answer from it.
+     Code that tests a value for several types costs one JavaScriptCore
+     call rather than one for each test.
+     
      @result A value of type JSValue::Type that identifies this
      JavaScript value's type.
      */
@@ -334,6 +416,11 @@ namespace HAL {
     friend class JSContext;
     
     JSValue(const JSContext& js_context, const JSString& js_string, bool parse_as_json = false);
+    
+    // For values whose JSType the caller knows, so that it isn't asked
+    // for. An immortal value, such as the undefined the JSContext
+    // keeps alive, is never protected.
+    JSValue(const JSContext& js_context, JSValueRef js_value_ref, std::uint8_t js_type, bool is_immortal) HAL_NOEXCEPT;
   
     // These classes and functions need access to operator
     // JSValueRef().
@@ -347,6 +434,20 @@ namespace HAL {
     
   private:
     
+    // Support for JSContext::FlushHandles and
+    // JSContext::set_defer_handle_release.
+    static void FlushDeferredUnprotect();
+    static void SetDeferUnprotect(bool defer_unprotect);
+    static bool GetDeferUnprotect();
+    
+    // Return the result of JSValueToStringCopy, which the caller must
+    // release, or throw the JavaScript exception it raised.
+    JSStringRef ToJSStringRefCopy() const;
+    
+    // Return the JSType of js_value_ref__, asking JavaScriptCore only
+    // the first time.
+    std::uint8_t GetJSType() const HAL_NOEXCEPT;
+    
     // Prevent heap based objects.
     static void * operator new(std::size_t);     // #1: To prevent allocation of scalar objects
     static void * operator new [] (std::size_t); // #2: To prevent allocation of array of objects
@@ -354,19 +455,38 @@ namespace HAL {
     JSContext  js_context__;
 		
     bool is_native_nullptr__{false};
+    
+    // The JSType of js_value_ref__ once it has been asked for,
+    // otherwise kUnknownType. Kept next to is_native_nullptr__ so
+    // that it fits in the padding.
+    static const std::uint8_t kUnknownType = 0xFF;
+    mutable std::uint8_t js_type__ { kUnknownType };
+    
+    // True if js_value_ref__ is kept alive by the JSContext, so that
+    // Protect and Unprotect leave it alone. Also fits in the padding.
+    bool is_immortal__ { false };
+    
+    // Index into the JSHandleScope identified by handle_scope_id__.
+    // Kept next to is_native_nullptr__ so that it fits in the padding.
+    std::uint32_t handle_scope_slot__ { 0 };
 
     // Silence 4251 on Windows since private member variables do not
     // need to be exported from a DLL.
 #pragma warning(push)
 #pragma warning(disable: 4251)
     JSValueRef js_value_ref__ { nullptr };
-    static std::unordered_map<std::intptr_t, std::size_t> js_value_retain_count_map__;
+    
+    // Non-zero if js_value_ref__ is kept alive by a JSHandleScope or a
+    // JSArena rather than the JSContext's retain registry.
+    std::uint64_t handle_scope_id__ { 0 };
 #pragma warning(pop)
     
 #undef  HAL_JSVALUE_LOCK_GUARD
 #ifdef  HAL_THREAD_SAFE
-    std::recursive_mutex mutex__;
-#define HAL_JSVALUE_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+    detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSValue, "JSValue");
+#define HAL_JSVALUE_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
+#elif defined(HAL_THREAD_AFFINITY)
+#define HAL_JSVALUE_LOCK_GUARD assert(js_context__.IsOwnerThread())
 #else
 #define HAL_JSVALUE_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
@@ -0,0 +1,167 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSVALUEVIEW_HPP_
+#define _HAL_JSVALUEVIEW_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <cassert>
+
+namespace HAL {
+
+  class JSObjectView;
+
+  /*!
+   @class
+
+   @discussion A JSValueView is a non-owning view of a JSValueRef. It
+   neither protects the JSValueRef nor retains its JSContextRef, so
+   it is only valid while something else keeps the value alive, for
+   example for the duration of a JavaScriptCore callback where JSC
+   itself keeps the arguments alive.
+
+   Use ToJSValue to obtain an owning JSValue when the value needs to
+   outlive the view.
+   */
+  class JSValueView final {
+
+  public:
+
+    // For interoperability with the JavaScriptCore C API.
+    JSValueView(JSContextRef js_context_ref, JSValueRef js_value_ref) HAL_NOEXCEPT
+    : js_context_ref__(js_context_ref)
+    , js_value_ref__(js_value_ref) {
+      assert(js_context_ref__);
+      assert(js_value_ref__);
+    }
+
+    JSValueView()                              = delete;
+    ~JSValueView()                             = default;
+    JSValueView(const JSValueView&)            = default;
+    JSValueView& operator=(const JSValueView&) = default;
+
+    bool IsUndefined() const HAL_NOEXCEPT {
+      return JSValueIsUndefined(js_context_ref__, js_value_ref__);
+    }
+
+    bool IsNull() const HAL_NOEXCEPT {
+      return JSValueIsNull(js_context_ref__, js_value_ref__);
+    }
+
+    bool IsBoolean() const HAL_NOEXCEPT {
+      return JSValueIsBoolean(js_context_ref__, js_value_ref__);
+    }
+
+    bool IsNumber() const HAL_NOEXCEPT {
+      return JSValueIsNumber(js_context_ref__, js_value_ref__);
+    }
+
+    bool IsString() const HAL_NOEXCEPT {
+      return JSValueIsString(js_context_ref__, js_value_ref__);
+    }
+
+    bool IsObject() const HAL_NOEXCEPT {
+      return JSValueIsObject(js_context_ref__, js_value_ref__);
+    }
+
+    bool ToBoolean() const HAL_NOEXCEPT {
+      return JSValueToBoolean(js_context_ref__, js_value_ref__);
+    }
+
+    /*!
+     @method
+
+     @abstract Convert this value to a number without creating an
+     intermediate JSValue.
+
+     @throws std::runtime_error if the conversion threw a JavaScript
+     exception.
+     */
+    double ToNumber() const {
+      JSValueRef exception { nullptr };
+      const double result = JSValueToNumber(js_context_ref__, js_value_ref__, &exception);
+      if (exception) {
+        detail::ThrowRuntimeError("JSValueView", ToJSValue(exception));
+      }
+
+      return result;
+    }
+
+    /*!
+     @method
+
+     @abstract Convert this value to a JSString without creating an
+     intermediate JSValue.
+
+     @throws std::runtime_error if the conversion threw a JavaScript
+     exception.
+     */
+    JSString ToJSString() const {
+      JSValueRef exception { nullptr };
+      JSStringRef js_string_ref = JSValueToStringCopy(js_context_ref__, js_value_ref__, &exception);
+      if (exception) {
+        // If this assert fails then we need to JSStringRelease
+        // js_string_ref.
+        assert(!js_string_ref);
+        detail::ThrowRuntimeError("JSValueView", ToJSValue(exception));
+      }
+
+      assert(js_string_ref);
+      JSString js_string(js_string_ref);
+      JSStringRelease(js_string_ref);
+      return js_string;
+    }
+
+    /*!
+     @method
+
+     @abstract Return a view of this value as an object.
+
+     @discussion This value must be an object, see IsObject.
+     */
+    JSObjectView ToObjectView() const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Create an owning JSValue for this value.
+     */
+    JSValue ToJSValue() const {
+      return ToJSValue(js_value_ref__);
+    }
+
+    JSContextRef get_context_ref() const HAL_NOEXCEPT {
+      return js_context_ref__;
+    }
+
+    // For interoperability with the JavaScriptCore C API.
+    explicit operator JSValueRef() const HAL_NOEXCEPT {
+      return js_value_ref__;
+    }
+
+  private:
+
+    JSValue ToJSValue(JSValueRef js_value_ref) const {
+      return JSValue(JSContext(js_context_ref__), js_value_ref);
+    }
+
+    JSContextRef js_context_ref__;
+    JSValueRef   js_value_ref__;
+  };
+
+} // namespace HAL {
+
+// JSValueView::ToObjectView is defined alongside JSObjectView.
+#include "HAL/JSObjectView.hpp"
+
+#endif // _HAL_JSVALUEVIEW_HPP_
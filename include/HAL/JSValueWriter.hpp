@@ -0,0 +1,198 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSVALUEWRITER_HPP_
+#define _HAL_JSVALUEWRITER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSStringBuilder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HAL {
+
+  class JSString;
+  class JSValue;
+  class JSContext;
+
+  /*!
+   @class
+
+   @discussion A JSValueWriter builds a tree of JavaScript objects,
+   arrays and primitives from a stream of calls, without a JSContext
+   until the tree is finished.
+
+   Large trees are written as compact JSON text and created with a
+   single JSON parse, which is much faster than one CreateObject,
+   CreateArray or SetProperty call per node. Small trees, of at most
+   kDirectConstructionLimit values, are created node by node instead,
+   since for them parsing costs more than it saves. The writer
+   switches from one to the other by itself once the limit is passed.
+
+   As in JSON, numbers that are NaN or infinite are written as null.
+
+   Usage:
+
+   JSValueWriter writer;
+   writer.BeginObject();
+   writer.Key("name").Value("foo");
+   writer.Key("sizes").BeginArray().Value(1).Value(2).EndArray();
+   writer.EndObject();
+   auto js_value = writer.ToJSValue(js_context);
+
+   @throws std::runtime_error if a call doesn't fit the tree written
+   so far, such as a Value in an object without a Key, or if
+   ToJSValue is called before the tree is complete.
+   */
+  class HAL_EXPORT JSValueWriter final {
+
+  public:
+
+    // The most values created node by node.
+    static const std::size_t kDirectConstructionLimit = 64;
+
+    JSValueWriter() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Create a JSValueWriter with room for capacity UTF-16
+     code units of JSON text.
+     */
+    explicit JSValueWriter(std::size_t capacity);
+
+    JSValueWriter& BeginObject();
+    JSValueWriter& EndObject();
+    JSValueWriter& BeginArray();
+    JSValueWriter& EndArray();
+
+    /*!
+     @method
+
+     @abstract Write the name of the next member of the current
+     object.
+     */
+    JSValueWriter& Key(const char* key);
+    JSValueWriter& Key(const std::string& key);
+    JSValueWriter& Key(const JSString& key);
+
+    JSValueWriter& Value(const char* value);
+    JSValueWriter& Value(const std::string& value);
+    JSValueWriter& Value(const JSString& value);
+    JSValueWriter& Value(double value);
+    JSValueWriter& Value(std::int32_t value);
+    JSValueWriter& Value(std::uint32_t value);
+    JSValueWriter& Value(bool value);
+    JSValueWriter& Null();
+
+    /*!
+     @method
+
+     @abstract Return the number of objects, arrays and primitives
+     written so far.
+     */
+    std::size_t size() const HAL_NOEXCEPT {
+      return value_count__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return true once the tree is written as JSON text,
+     rather than kept for direct construction.
+     */
+    bool is_json() const HAL_NOEXCEPT {
+      return is_json__;
+    }
+
+    /*!
+     @method
+
+     @abstract Create the tree in a JSContext.
+
+     @throws std::runtime_error if an object or array is still open or
+     nothing was written.
+     */
+    JSValue ToJSValue(const JSContext& js_context) const;
+
+    /*!
+     @method
+
+     @abstract Return the tree as JSON text. Unlike ToJSValue this needs
+     no JSContext, so a tree written on another thread may be turned
+     into text there, and then adopted with JSContext::AdoptJSON.
+
+     @throws std::runtime_error if an object or array is still open or
+     nothing was written.
+     */
+    JSString ToJSONString() const;
+
+  private:
+
+    enum class Kind : std::uint8_t {
+      BeginObject,
+      EndObject,
+      BeginArray,
+      EndArray,
+      Key,
+      String,
+      Number,
+      Boolean,
+      Null
+    };
+
+    // A call recorded for direct construction. Booleans are stored in
+    // number.
+    struct Event {
+      Kind        kind;
+      double      number;
+      std::string string;
+    };
+
+    struct Container {
+      bool is_object;
+      bool expecting_value;
+    };
+
+    // Check that a call of kind fits the tree, and count it.
+    void Validate(Kind kind);
+
+    void Write(Kind kind, double number = 0);
+    void Write(Kind kind, const char* string, std::size_t length);
+    void Write(Kind kind, const JSString& string);
+    void WriteJSON(const Event& event);
+    void WriteSeparator(Kind kind);
+
+    // Convert the recorded events to JSON text once there are too
+    // many of them.
+    void SwitchToJSON();
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::vector<Event>     events__;
+    std::vector<Container> containers__;
+    JSStringBuilder        json__;
+
+    // Whether each open container of the JSON text has a member yet.
+    std::vector<bool>      json_separators__;
+
+    std::size_t            value_count__ { 0 };
+    bool                   is_json__     { false };
+    bool                   after_key__   { false };
+    bool                   root_written__ { false };
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSVALUEWRITER_HPP_
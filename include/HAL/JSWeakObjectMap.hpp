@@ -0,0 +1,132 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSWEAKOBJECTMAP_HPP_
+#define _HAL_JSWEAKOBJECTMAP_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <memory>
+
+namespace HAL {
+
+  /*!
+   @class
+
+   @discussion A JSWeakObjectMap maps native keys to JavaScript objects
+   without protecting them, so a native cache built on it doesn't keep
+   its objects alive. Once nothing else references an object the
+   garbage collector may collect it, and Get no longer finds it.
+
+   With HAL_WEAK_OBJECT_MAP_ENABLE the map is a JavaScriptCore
+   JSWeakObjectMapRef, which is meant for objects created from a
+   JSClass, such as JSExport objects, and lasts as long as its
+   JSContext. Create one per cache rather than one per entry.
+   Otherwise the map holds a JavaScript WeakRef per entry.
+
+   Copies of a JSWeakObjectMap share the same entries.
+   */
+  class HAL_EXPORT JSWeakObjectMap final HAL_PERFORMANCE_COUNTER1(JSWeakObjectMap) {
+
+  public:
+
+    explicit JSWeakObjectMap(const JSContext& js_context);
+
+    /*!
+     @method
+
+     @abstract Map key to an object of this map's JSContext, replacing
+     the object it mapped to before.
+     */
+    void Set(const void* key, const JSObject& js_object) const;
+
+    /*!
+     @method
+
+     @abstract Return the object key maps to, or undefined if it maps
+     to none or its object has been collected.
+     */
+    JSValue Get(const void* key) const;
+
+    /*!
+     @method
+
+     @abstract Remove the entry of key, if any.
+     */
+    void Remove(const void* key) const;
+
+    JSContext get_context() const HAL_NOEXCEPT;
+
+  private:
+
+    friend class JSWeakObject;
+
+    struct State;
+
+    // Return a map shared by the JSWeakObjects of a JSContext.
+    static JSWeakObjectMap GetSharedMap(const JSContext& js_context);
+
+    explicit JSWeakObjectMap(const std::shared_ptr<State>& state) HAL_NOEXCEPT;
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::shared_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+  /*!
+   @class
+
+   @discussion A JSWeakObject references a JavaScript object without
+   protecting it, unlike a JSObject, so it doesn't keep the object
+   alive. It is built on JSWeakObjectMap.
+
+   Copies of a JSWeakObject refer to the same object.
+   */
+  class HAL_EXPORT JSWeakObject final HAL_PERFORMANCE_COUNTER1(JSWeakObject) {
+
+  public:
+
+    explicit JSWeakObject(const JSObject& js_object);
+
+    /*!
+     @method
+
+     @abstract Return the object, or undefined if it has been
+     collected. Keep the result for as long as the object must stay
+     alive.
+     */
+    JSValue Lock() const;
+
+    /*!
+     @method
+
+     @abstract Return whether the object hasn't been collected yet.
+     */
+    bool IsAlive() const;
+
+    JSContext get_context() const HAL_NOEXCEPT;
+
+  private:
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSWeakObjectMap       js_weak_object_map__;
+
+    // The key of the object in js_weak_object_map__, whose deleter
+    // removes the entry when the last copy is destroyed.
+    std::shared_ptr<char> key__;
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSWEAKOBJECTMAP_HPP_
@@ -0,0 +1,248 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSWEBASSEMBLY_HPP_
+#define _HAL_JSWEBASSEMBLY_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSArrayBuffer.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSContextGroup.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSString.hpp"
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace HAL {
+
+  class JSWebAssemblyInstance;
+
+  /*!
+   @class
+
+   @discussion A JSWebAssemblyModule is a compiled WebAssembly.Module.
+   It may be instantiated any number of times in any JSContext of the
+   JSContextGroup it was compiled in, without being compiled again.
+
+   The only way to create a JSWebAssemblyModule is by using the
+   JSContext::CompileWebAssemblyModule member functions, or a
+   JSWebAssemblyModuleCache.
+
+   WebAssembly is a feature of JavaScriptCore rather than of its C
+   API, so it is reached through the WebAssembly global object, and a
+   JavaScriptCore built without it, or with its JIT disabled, throws a
+   std::runtime_error wherever a module would be compiled.
+   */
+  class HAL_EXPORT JSWebAssemblyModule final : public JSObject HAL_PERFORMANCE_COUNTER2(JSWebAssemblyModule) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Instantiate the module in a JSContext of its
+     JSContextGroup, as new WebAssembly.Instance(module, imports) would.
+
+     @param imports An optional import object, whose properties are
+     the modules and fields the module imports.
+
+     @throws std::invalid_argument if js_context is in another
+     JSContextGroup.
+
+     @throws std::runtime_error if an import is missing or has the
+     wrong type, or the start function throws.
+     */
+    JSWebAssemblyInstance Instantiate(const JSContext& js_context) const;
+    JSWebAssemblyInstance Instantiate(const JSContext& js_context, const JSObject& imports) const;
+
+  private:
+
+    // Only JSContext can create a JSWebAssemblyModule.
+    friend JSContext;
+
+    JSWebAssemblyModule(const JSContext& js_context, JSObjectRef js_object_ref);
+  };
+
+  /*!
+   @class
+
+   @discussion A JSWebAssemblyInstance is an instantiated
+   WebAssembly.Instance, whose exported functions run in the
+   WebAssembly JIT.
+
+   Its exported linear memory is an ArrayBuffer that native code reads
+   and writes directly, without a copy, while the module's functions
+   use the same bytes:
+
+   auto memory = instance.GetMemory();
+   auto pixels = static_cast<std::uint8_t*>(memory.GetBytesPtr());
+   ... fill pixels ...
+   filter.Call(exports, 0, static_cast<int32_t>(memory.GetByteLength()));
+
+   Growing the memory, by memory.grow or a memory.grow instruction,
+   detaches the ArrayBuffer, after which its bytes pointer is nullptr
+   and its byte length zero, so call GetMemory again after calling a
+   function that may grow it.
+   */
+  class HAL_EXPORT JSWebAssemblyInstance final : public JSObject HAL_PERFORMANCE_COUNTER2(JSWebAssemblyInstance) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Return the exports object of the instance, whose
+     properties are its exported functions, memories, tables and
+     globals.
+     */
+    JSObject GetExports() const;
+
+    /*!
+     @method
+
+     @abstract Return the current ArrayBuffer of an exported memory.
+
+     @param name The export name of the memory, by convention
+     "memory".
+
+     @throws std::runtime_error if no memory is exported under name.
+     */
+    JSArrayBuffer GetMemory(const JSString& name = "memory") const;
+
+  private:
+
+    // Only JSWebAssemblyModule can create a JSWebAssemblyInstance.
+    friend JSWebAssemblyModule;
+
+    JSWebAssemblyInstance(const JSContext& js_context, JSObjectRef js_object_ref);
+  };
+
+  /*!
+   @class
+
+   @discussion A JSWebAssemblyModuleCache holds the most recently used
+   JSWebAssemblyModules of a JSContextGroup by name, e.g. the path of
+   the module file, so that every JSContext of the group instantiates
+   a module without compiling it again.
+
+   The modules are compiled in a JSContext the cache creates in the
+   group for itself, so the cache keeps none of the JSContexts that
+   use it alive.
+
+   A JSWebAssemblyModuleCache registers itself with JSMemoryPressure
+   while it lives, so memory pressure evicts its least recently used
+   modules. It may be used from several threads at once, and compiles
+   outside of its lock.
+   */
+  class HAL_EXPORT JSWebAssemblyModuleCache final HAL_PERFORMANCE_COUNTER1(JSWebAssemblyModuleCache) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Create an empty cache of at most capacity modules.
+     */
+    explicit JSWebAssemblyModuleCache(const JSContextGroup& js_context_group, std::size_t capacity = 16);
+    ~JSWebAssemblyModuleCache() HAL_NOEXCEPT;
+
+    JSWebAssemblyModuleCache(const JSWebAssemblyModuleCache&)            = delete;
+    JSWebAssemblyModuleCache(JSWebAssemblyModuleCache&&)                 = delete;
+    JSWebAssemblyModuleCache& operator=(const JSWebAssemblyModuleCache&) = delete;
+    JSWebAssemblyModuleCache& operator=(JSWebAssemblyModuleCache&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Return the cached module of this name, compiling bytes
+     first if it isn't cached. The least recently used module is
+     evicted if the cache is full.
+
+     @throws std::runtime_error if the bytes aren't a valid module.
+     */
+    JSWebAssemblyModule GetModule(const std::string& name, const void* bytes, std::size_t byte_length);
+
+    /*!
+     @method
+
+     @abstract Return the cached module of the file at path, memory
+     mapping and compiling it first if it isn't cached.
+
+     @throws std::runtime_error if the file can't be mapped or isn't a
+     valid module.
+     */
+    JSWebAssemblyModule GetModuleFile(const std::string& path);
+
+    /*!
+     @method
+
+     @abstract Return the number of cached modules.
+     */
+    std::size_t size() const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Remove all cached modules.
+     */
+    void clear() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Remove fraction of the cached modules, least recently
+     used first, and return the approximate bytes their code used.
+     */
+    std::size_t Evict(double fraction) HAL_NOEXCEPT;
+
+    JSContextGroup get_context_group() const HAL_NOEXCEPT {
+      return js_context__.get_context_group();
+    }
+
+  private:
+
+    template<typename Compile>
+    JSWebAssemblyModule GetOrCompileModule(const std::string& name, Compile compile);
+
+    struct Entry {
+      std::string         name;
+      JSWebAssemblyModule js_module;
+      std::size_t         byte_length;
+    };
+
+    // The most recently used entry is at the front.
+    typedef std::list<Entry> EntryList;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSContext                                            js_context__;
+    std::size_t                                          capacity__;
+    EntryList                                            entries__;
+    std::unordered_map<std::string, EntryList::iterator> index__;
+    std::uint64_t                                        js_memory_pressure_handler_id__ { 0 };
+#pragma warning(pop)
+
+    mutable detail::JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSWebAssemblyModuleCache, "JSWebAssemblyModuleCache");
+#undef  HAL_JSWEBASSEMBLYMODULECACHE_LOCK_GUARD
+#define HAL_JSWEBASSEMBLYMODULECACHE_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(mutex__)
+  };
+
+} // namespace HAL {
+
+#endif // HAL_TYPED_ARRAY_ENABLE
+
+#endif // _HAL_JSWEBASSEMBLY_HPP_
@@ -0,0 +1,194 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_JSWORKERPOOL_HPP_
+#define _HAL_JSWORKERPOOL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSTaskPriority.hpp"
+#include "HAL/detail/JSTaskLane.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+
+  // The function a JSWorkerPool calls once on each worker thread's
+  // JSContext before it runs any task, e.g. to register JSExport
+  // classes and install globals. It must not throw.
+  typedef std::function<void(const JSContext& js_context)> JSWorkerInitializer;
+
+  /*!
+   @enum
+   
+   @abstract Where a JSWorkerPool pins its worker threads.
+
+   @discussion A worker is pinned before it creates its JSContextGroup,
+   so with the first-touch memory policy of Linux and Windows its
+   JavaScript heap is allocated on the memory node it runs on, and it
+   stays local because the thread no longer migrates.
+
+   Pinning is done on Linux and Windows, among the processors the
+   process may run on. Elsewhere, or if pinning fails, the workers are
+   scheduled freely.
+
+   @constant None Don't pin the workers.
+
+   @constant Core Pin each worker to its own processor, wrapping around
+   when there are more workers than processors.
+
+   @constant NumaNode Spread the workers round robin across the NUMA
+   nodes, and let each run on any processor of its node. Falls back to
+   a single node where the topology isn't known.
+   */
+  enum class JSWorkerPlacement : std::uint8_t {
+    None,
+    Core,
+    NumaNode
+  };
+
+  /*!
+   @class
+
+   @discussion A JSWorkerPool runs tasks on a fixed set of threads,
+   each of which owns its own JSContextGroup and JSContext, so tasks
+   on different threads never share JavaScript state or contend for
+   it.
+
+   A task is any callable taking the const JSContext& of the thread
+   that runs it. Submit returns a std::future for its result, or for
+   the exception it threw.
+
+   Each worker has its own task queue. Submitted tasks are spread
+   across the queues, and a worker whose queue is empty steals from
+   the others, so one long task doesn't hold back the tasks queued
+   behind it.
+
+   A worker's queue has a lane for each JSTaskPriority, and a worker
+   only takes a task when no worker has a task of a higher priority
+   queued. The lanes are bounded pool-wide with set_queue_options. The
+   future of a task discarded by the DropOldest policy reports
+   std::future_errc::broken_promise.
+
+   Destroying the pool runs all tasks already submitted, then joins
+   the threads.
+   */
+  class HAL_EXPORT JSWorkerPool final HAL_PERFORMANCE_COUNTER1(JSWorkerPool) {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Start the worker threads.
+
+     @param thread_count The number of worker threads. Zero, the
+     default, uses one per hardware thread.
+
+     @param initializer An optional function to call on each worker's
+     JSContext.
+
+     @param placement Where to pin the worker threads.
+     */
+    explicit JSWorkerPool(unsigned thread_count = 0, JSWorkerInitializer initializer = nullptr, JSWorkerPlacement placement = JSWorkerPlacement::None);
+    ~JSWorkerPool() HAL_NOEXCEPT;
+
+    JSWorkerPool(const JSWorkerPool&)            = delete;
+    JSWorkerPool& operator=(const JSWorkerPool&) = delete;
+
+    /*!
+     @method
+
+     @abstract Queue a task to run on one of the worker threads.
+
+     @discussion If the lane of priority is full, its policy decides
+     whether Submit throws, waits for a worker to take a task of that
+     priority, or discards the oldest task of that priority.
+
+     @result A std::future for the value returned by the task.
+
+     @throws std::runtime_error if the lane of priority is full and its
+     policy is Reject, or Block when called from a worker of this pool.
+     */
+    template<typename F>
+    std::future<typename std::result_of<F(const JSContext&)>::type> Submit(F&& task, JSTaskPriority priority = JSTaskPriority::Normal) {
+      typedef typename std::result_of<F(const JSContext&)>::type Result;
+      const auto packaged_task = std::make_shared<std::packaged_task<Result(const JSContext&)>>(std::forward<F>(task));
+      auto future = packaged_task -> get_future();
+      Enqueue([packaged_task](const JSContext& js_context) {
+        (*packaged_task)(js_context);
+      }, priority);
+      return future;
+    }
+
+    /*!
+     @method
+
+     @abstract Bound the lane of a priority, or remove its bound with a
+     capacity of zero. May be called from any thread.
+     */
+    void set_queue_options(JSTaskPriority priority, const JSTaskQueueOptions& options);
+
+    JSTaskQueueOptions get_queue_options(JSTaskPriority priority) const HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Return what the lane of a priority has queued and run,
+     and how long its tasks waited for a worker. May be called from any
+     thread.
+     */
+    JSTaskLaneStatistics GetLaneStatistics(JSTaskPriority priority) const HAL_NOEXCEPT;
+
+    unsigned get_thread_count() const HAL_NOEXCEPT;
+
+    JSWorkerPlacement get_placement() const HAL_NOEXCEPT;
+
+  private:
+
+    typedef std::function<void(const JSContext&)> Task;
+
+    struct Worker;
+
+    void Enqueue(Task task, JSTaskPriority priority);
+    void DropOldest(std::size_t lane_index, std::size_t queued_worker_index);
+    void Run(std::size_t worker_index);
+    bool TryTakeTask(std::size_t worker_index, Task& task);
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSWorkerInitializer                  initializer__;
+    JSWorkerPlacement                    placement__;
+    std::vector<std::unique_ptr<Worker>> workers__;
+    std::atomic<std::size_t>             next_worker_index__ { 0 };
+    detail::JSTaskLane                   lanes__[kJSTaskPriorityCount];
+
+    // Workers with nothing to do sleep on sleep_condition__ until
+    // pending_task_count__ is no longer zero. Producers blocked on a
+    // full lane sleep on capacity_condition__.
+    std::mutex                           sleep_mutex__;
+    std::condition_variable              sleep_condition__;
+    std::condition_variable              capacity_condition__;
+    std::size_t                          pending_task_count__ { 0 };
+    std::size_t                          blocked_producer_count__ { 0 };
+    bool                                 stopping__ { false };
+#pragma warning(pop)
+  };
+
+} // namespace HAL {
+
+#endif // _HAL_JSWORKERPOOL_HPP_
@@ -0,0 +1,123 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSAPISTATISTICS_HPP_
+#define _HAL_DETAIL_JSAPISTATISTICS_HPP_
+
+#ifdef HAL_API_STATISTICS_ENABLE
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_API_STATISTICS_ENABLE=1 to count the JavaScriptCore C API
+  // calls HAL makes for each JSContext.
+
+  // The kinds of JavaScriptCore calls that are counted.
+  enum class JSAPICategory : std::uint8_t {
+    EvaluateScript,
+    CallAsFunction,
+    CallAsConstructor,
+    GetProperty,
+    SetProperty,
+    HasProperty,
+    DeleteProperty,
+    ValueConversion,
+    ValueTypeCheck
+  };
+
+  static const std::size_t kJSAPICategoryCount = 9;
+
+  HAL_EXPORT const char* to_string(JSAPICategory category) HAL_NOEXCEPT;
+
+  /*!
+   @struct
+
+   @discussion The JavaScriptCore calls made for one
+   JSGlobalContextRef, shared by every JSContext that wraps it. Every
+   call is counted, and one in kSampleInterval is timed, so the cost
+   of a category is about its sampled time divided by its sampled
+   calls.
+   */
+  struct JSAPIStatistics {
+    static const std::uint64_t kSampleInterval = 64;
+
+    JSAPIStatistics() HAL_NOEXCEPT {
+      Reset();
+    }
+
+    JSAPIStatistics(const JSAPIStatistics&)            = delete;
+    JSAPIStatistics& operator=(const JSAPIStatistics&) = delete;
+
+    void Reset() HAL_NOEXCEPT {
+      for (std::size_t i = 0; i < kJSAPICategoryCount; ++i) {
+        calls[i].store(0, std::memory_order_relaxed);
+        sampled_calls[i].store(0, std::memory_order_relaxed);
+        sampled_nanoseconds[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    std::atomic<std::uint64_t> calls[kJSAPICategoryCount];
+    std::atomic<std::uint64_t> sampled_calls[kJSAPICategoryCount];
+    std::atomic<std::uint64_t> sampled_nanoseconds[kJSAPICategoryCount];
+  };
+
+  // Return the statistics of js_global_context_ref, creating them the
+  // first time. They live while any JSContext of it does.
+  HAL_EXPORT std::shared_ptr<JSAPIStatistics> GetJSAPIStatistics(JSGlobalContextRef js_global_context_ref);
+
+  // Counts a JavaScriptCore call, and times it if it is a sampled one.
+  class JSAPICallScope final {
+
+  public:
+
+    JSAPICallScope(JSAPIStatistics& statistics, JSAPICategory category) HAL_NOEXCEPT
+    : statistics__(statistics)
+    , index__(static_cast<std::size_t>(category))
+    , sampled__(statistics.calls[index__].fetch_add(1, std::memory_order_relaxed) % JSAPIStatistics::kSampleInterval == 0) {
+      if (sampled__) {
+        start__ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~JSAPICallScope() HAL_NOEXCEPT {
+      if (sampled__) {
+        const auto elapsed = std::chrono::steady_clock::now() - start__;
+        statistics__.sampled_calls[index__].fetch_add(1, std::memory_order_relaxed);
+        statistics__.sampled_nanoseconds[index__].fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), std::memory_order_relaxed);
+      }
+    }
+
+    JSAPICallScope(const JSAPICallScope&)            = delete;
+    JSAPICallScope& operator=(const JSAPICallScope&) = delete;
+
+  private:
+
+    JSAPIStatistics&                      statistics__;
+    std::size_t                           index__;
+    bool                                  sampled__;
+    std::chrono::steady_clock::time_point start__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+// Evaluate the expression, a JavaScriptCore call made for js_context,
+// as a call of category, e.g.
+//
+// const auto js_value_ref = HAL_API_CALL(js_context__, GetProperty, JSObjectGetProperty(...));
+#define HAL_API_CALL(js_context, category, ...) [&] { detail::JSAPICallScope hal_api_call_scope((js_context).get_api_statistics(), detail::JSAPICategory::category); return __VA_ARGS__; }()
+#else
+#define HAL_API_CALL(js_context, category, ...) (__VA_ARGS__)
+#endif // HAL_API_STATISTICS_ENABLE
+
+#endif // _HAL_DETAIL_JSAPISTATISTICS_HPP_
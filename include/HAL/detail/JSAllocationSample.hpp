@@ -0,0 +1,32 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSALLOCATIONSAMPLE_HPP_
+#define _HAL_DETAIL_JSALLOCATIONSAMPLE_HPP_
+
+#ifdef HAL_ALLOCATION_PROFILE_ENABLE
+#include "HAL/JSAllocationProfiler.hpp"
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_ALLOCATION_PROFILE_ENABLE=1 to count the wrappers of
+  // JSAllocationProfiler.
+
+  // Count the creation of a wrapper of kind, a string literal, on the
+  // calling thread, against its innermost JSAllocationSite if it is
+  // the Nth.
+  HAL_EXPORT void CountJSAllocation(const char* kind) HAL_NOEXCEPT;
+
+}} // namespace HAL { namespace detail {
+
+#define HAL_ALLOCATION_SAMPLE(kind) do { if (JSAllocationProfiler::IsEnabled()) { detail::CountJSAllocation(kind); } } while (false)
+#else
+#define HAL_ALLOCATION_SAMPLE(kind)
+#endif // HAL_ALLOCATION_PROFILE_ENABLE
+
+#endif // _HAL_DETAIL_JSALLOCATIONSAMPLE_HPP_
@@ -0,0 +1,63 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSATOMS_HPP_
+#define _HAL_DETAIL_JSATOMS_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSString.hpp"
+
+namespace HAL { namespace detail {
+  
+  /*!
+   @class
+   
+   @discussion JSAtoms holds one retained JSString for each property
+   name HAL itself looks up, so that hot paths like JSArray::GetLength
+   and the JSError accessors don't create a new JSStringRef for every
+   call.
+   
+   These are ordinary static objects, so they must not be used during
+   static initialization.
+   */
+  class HAL_EXPORT JSAtoms final {
+    
+  public:
+    
+    static const JSString Array;
+    static const JSString isArray;
+    static const JSString JSON;
+    static const JSString Object;
+    static const JSString RegExp;
+    static const JSString Date;
+    static const JSString Error;
+    static const JSString length;
+    static const JSString message;
+    static const JSString name;
+    static const JSString fileName;
+    static const JSString lineNumber;
+    static const JSString native_stack;
+    static const JSString from;
+    static const JSString Function;
+    static const JSString getTime;
+    static const JSString test;
+    static const JSString exec;
+    static const JSString lastIndex;
+    static const JSString prototype;
+    static const JSString Float64Array;
+    static const JSString Int32Array;
+    static const JSString Uint32Array;
+    static const JSString values;
+    static const JSString done;
+    
+    JSAtoms() = delete;
+  };
+  
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSATOMS_HPP_
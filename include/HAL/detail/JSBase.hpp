@@ -16,9 +16,58 @@
 #define HAL_LOGGING_ENABLE_ERROR
 // #define HAL_THREAD_SAFE
 
+// A cheaper alternative to HAL_THREAD_SAFE: each JSContextGroup is
+// owned by the thread that created it, and using one of its contexts,
+// values or objects from any other thread fails a debug assertion
+// instead of taking a per-object lock. Only state shared by the whole
+// process, such as the JSObject and JSExport registries, keeps its
+// mutex.
+// #define HAL_THREAD_AFFINITY
+
 #define HAL_NOEXCEPT_ENABLE
+#define HAL_CONSTEXPR_ENABLE
 #define HAL_MOVE_CTOR_AND_ASSIGN_DEFAULT_ENABLE
 
+// The JavaScriptCore typed array C API first shipped with macOS 10.12
+// and iOS 10. Undefine this for an older JavaScriptCore.
+#define HAL_TYPED_ARRAY_ENABLE
+
+// JSScriptRef, which lets a script be parsed once and evaluated many
+// times, is declared in the private header JSScriptRefPrivate.h that
+// JavaScriptCore doesn't install, so HAL declares it below. Undefine
+// this for a JavaScriptCore that doesn't export it.
+#define HAL_SCRIPT_REF_ENABLE
+
+// JSContextGroupSetExecutionTimeLimit is declared in the private
+// header JSContextRefPrivate.h, so HAL declares it below too. Undefine
+// this for a JavaScriptCore that doesn't export it.
+#define HAL_EXECUTION_TIME_LIMIT_ENABLE
+
+// JSReportExtraMemoryCost is declared in the private header
+// JSBasePrivate.h, so HAL declares it below too. Undefine this for a
+// JavaScriptCore that doesn't export it, and HAL collects garbage
+// itself when the external memory of a context grows by its threshold.
+#define HAL_EXTRA_MEMORY_COST_ENABLE
+
+// JSWeakObjectMapRef, which references objects without protecting
+// them, is declared in the private header JSWeakObjectMapRefPrivate.h,
+// so HAL declares it below too. Undefine this for a JavaScriptCore
+// that doesn't export it, and JSWeakObject and JSWeakObjectMap use the
+// JavaScript WeakRef class instead.
+#define HAL_WEAK_OBJECT_MAP_ENABLE
+
+// JSGetMemoryUsageStatistics, which reports the heap of a context
+// group, is declared in the private header JSBasePrivate.h, so HAL
+// declares it below too. Undefine this for a JavaScriptCore that
+// doesn't export it, and JSContextGroup::GetStatistics reports no heap.
+#define HAL_MEMORY_USAGE_STATISTICS_ENABLE
+
+// HAL itself is C++11, but the header-only HAL/JSCoroutine.hpp adds
+// C++20 coroutine awaitables to code compiled with coroutine support.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define HAL_COROUTINE_ENABLE
+#endif
+
 // See http://msdn.microsoft.com/en-us/library/b0084kay.aspx for the
 // list of Visual C++ "Predefined Macros". Visual Studio 2013 Update 3
 // RTM ships with MSVC 18.0.30723.0
@@ -40,6 +89,7 @@
 // http://blogs.msdn.com/b/vcblog/archive/2013/12/02/c-11-14-core-language-features-in-vs-2013-and-the-nov-2013-ctp.aspx
 
 #undef HAL_NOEXCEPT_ENABLE
+#undef HAL_CONSTEXPR_ENABLE
 #undef HAL_MOVE_CTOR_AND_ASSIGN_DEFAULT_ENABLE
 
 #endif  // #defined(_MSC_VER) && _MSC_VER <= 1800
@@ -50,14 +100,72 @@
 #define HAL_NOEXCEPT
 #endif
 
-#ifdef HAL_THREAD_SAFE
+// VS 2013 does not support constexpr.
+#ifdef HAL_CONSTEXPR_ENABLE
+#define HAL_CONSTEXPR constexpr
+#else
+#define HAL_CONSTEXPR
+#endif
+
+#if defined(HAL_THREAD_SAFE) && defined(HAL_THREAD_AFFINITY)
+#error "Define at most one of HAL_THREAD_SAFE and HAL_THREAD_AFFINITY"
+#endif
+
+// Process wide state is locked in both threading models.
+#if defined(HAL_THREAD_SAFE) || defined(HAL_THREAD_AFFINITY)
+#define HAL_THREAD_SAFE_STATICS
 #include <mutex>
 #endif
 
+#ifdef HAL_THREAD_AFFINITY
+#include <cassert>
+#include <thread>
+#endif
+
+// VS 2013 does not support the C++11 thread_local keyword, but its
+// __declspec(thread) extension is sufficient for POD data.
+#if defined(_MSC_VER) && _MSC_VER <= 1800
+#define HAL_THREAD_LOCAL __declspec(thread)
+#else
+#define HAL_THREAD_LOCAL thread_local
+#endif
+
+// VS 2013 does not support the C++11 alignas specifier either, but
+// __declspec(align) places a class the same way.
+#if defined(_MSC_VER) && _MSC_VER <= 1800
+#define HAL_ALIGNAS(alignment) __declspec(align(alignment))
+#else
+#define HAL_ALIGNAS(alignment) alignas(alignment)
+#endif
+
+// Build without RTTI, e.g. with -fno-rtti or /GR-, and so without
+// typeid and dynamic_cast: the names of JSExport classes come from
+// HAL_JSEXPORT_CLASS_NAME, and JSObject::GetPrivate<T> checks the
+// class of the private data by its JSExportClassInfo. It is defined
+// for you when the compiler says that RTTI is off.
+// #define HAL_NO_RTTI
+
+#if !defined(HAL_NO_RTTI)
+#if defined(__clang__)
+#if !__has_feature(cxx_rtti)
+#define HAL_NO_RTTI
+#endif
+#elif defined(__GNUC__)
+#ifndef __GXX_RTTI
+#define HAL_NO_RTTI
+#endif
+#elif defined(_MSC_VER)
+#ifndef _CPPRTTI
+#define HAL_NO_RTTI
+#endif
+#endif
+#endif  // !defined(HAL_NO_RTTI)
+
 #include "HAL_EXPORT.h"
 
 #include "HAL/detail/JSLogger.hpp"
 #include "HAL/detail/JSPerformanceCounter.hpp"
+#include "HAL/detail/JSLockStatistics.hpp"
 #include <JavaScriptCore/JavaScript.h>
 
 #ifdef __APPLE__
@@ -74,4 +182,169 @@
 extern "C" JSGlobalContextRef JSContextGetGlobalContext(JSContextRef ctx);
 #endif
 
+#ifdef HAL_SCRIPT_REF_ENABLE
+extern "C" {
+  
+  /*! @typedef JSScriptRef A JavaScript script reference. */
+  typedef struct OpaqueJSScript* JSScriptRef;
+  
+  /*!
+   @function
+   @abstract Creates a script reference from a string.
+   @param contextGroup The context group the script is to be used in.
+   @param url The source url to be reported in errors and exceptions.
+   @param startingLineNumber An integer value specifying the script's starting line number in the file located at sourceURL. This is only used when reporting exceptions. The value is one-based, so the first line is line 1 and invalid values are clamped to 1.
+   @param source The source string.
+   @param errorMessage A pointer to a JSStringRef in which to store the parse error message if the source is not valid. Pass NULL if you do not care to store an error message.
+   @param errorLine A pointer to an int in which to store the line number of a parser error. Pass NULL if you do not care to store an error line.
+   @result A JSScriptRef for the provided source, or NULL is any non-ASCII character is found in source or if the source is not a valid JavaScript program. Ownership follows the Create Rule.
+   */
+  JSScriptRef JSScriptCreateFromString(JSContextGroupRef contextGroup, JSStringRef url, int startingLineNumber, JSStringRef source, JSStringRef* errorMessage, int* errorLine);
+  
+  /*!
+   @function
+   @abstract Retains a JavaScript script.
+   @param script The script to retain.
+   */
+  void JSScriptRetain(JSScriptRef script);
+  
+  /*!
+   @function
+   @abstract Releases a JavaScript script.
+   @param script The script to release.
+   */
+  void JSScriptRelease(JSScriptRef script);
+  
+  /*!
+   @function
+   @abstract Evaluates a JavaScript script.
+   @param ctx The execution context to use.
+   @param script The JSScript to evaluate.
+   @param thisValue The value to use as "this" when evaluating the script.
+   @param exception A pointer to a JSValueRef in which to store an exception, if any. Pass NULL if you do not care to store an exception.
+   @result The JSValue that results from evaluating script, or NULL if an exception is thrown.
+   */
+  JSValueRef JSScriptEvaluate(JSContextRef ctx, JSScriptRef script, JSValueRef thisValue, JSValueRef* exception);
+  
+} // extern "C" {
+#endif // HAL_SCRIPT_REF_ENABLE
+
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+extern "C" {
+  
+  /*!
+   @typedef JSShouldTerminateCallback
+   @abstract The callback invoked when script execution has exceeded the allowed time limit previously specified via JSContextGroupSetExecutionTimeLimit.
+   @param ctx The execution context to use.
+   @param context User specified context data previously passed to JSContextGroupSetExecutionTimeLimit.
+   @result true if the script should be terminated.
+   */
+  typedef bool (*JSShouldTerminateCallback)(JSContextRef ctx, void* context);
+  
+  /*!
+   @function
+   @abstract Sets the script execution time limit.
+   @param group The JavaScript context group that this time limit applies to.
+   @param limit The time limit of allowed script execution time in seconds.
+   @param callback The callback function that will be invoked when the time limit has been reached, or NULL to always terminate the script.
+   @param context User data that you can provide to be passed back to you in your callback.
+   */
+  void JSContextGroupSetExecutionTimeLimit(JSContextGroupRef group, double limit, JSShouldTerminateCallback callback, void* context);
+  
+  /*!
+   @function
+   @abstract Clears the script execution time limit.
+   @param group The JavaScript context group that the time limit is cleared on.
+   */
+  void JSContextGroupClearExecutionTimeLimit(JSContextGroupRef group);
+  
+} // extern "C" {
+#endif // HAL_EXECUTION_TIME_LIMIT_ENABLE
+
+#ifdef HAL_EXTRA_MEMORY_COST_ENABLE
+extern "C" {
+  
+  /*!
+   @function
+   @abstract Reports an object's non-GC memory payload to the garbage collector.
+   @param ctx The execution context to use.
+   @param size The payload's size, in bytes.
+   @discussion Use this function to notify the garbage collector that a GC object owns a large non-GC memory region. Calling this function will encourage the garbage collector to collect soon, hoping to reclaim that large non-GC memory region.
+   */
+  void JSReportExtraMemoryCost(JSContextRef ctx, size_t size);
+  
+} // extern "C" {
+#endif // HAL_EXTRA_MEMORY_COST_ENABLE
+
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+extern "C" {
+  
+  /*! @typedef JSWeakObjectMapRef A weak map for storing JSObjectRefs */
+  typedef struct OpaqueJSWeakObjectMap* JSWeakObjectMapRef;
+  
+  /*!
+   @typedef JSWeakMapDestroyedCallback
+   @abstract The callback invoked when a JSWeakObjectMapRef is being destroyed.
+   @param map The map that is being destroyed.
+   @param data The private data (if any) that was associated with the map instance.
+   */
+  typedef void (*JSWeakMapDestroyedCallback)(JSWeakObjectMapRef map, void* data);
+  
+  /*!
+   @function
+   @abstract Creates a weak value map that can be used to reference user defined objects without preventing them from being collected.
+   @param ctx The execution context to use.
+   @param data A void* to set as the map's private data. Pass NULL to specify no private data.
+   @param destructor A function to call when the weak map is destroyed.
+   @result A JSWeakObjectMapRef bound to the given context, data and destructor.
+   @discussion The JSWeakObjectMapRef can be used as a storage mechanism to hold custom JS objects without forcing those objects to remain live as JSValueProtect would.
+   */
+  JSWeakObjectMapRef JSWeakObjectMapCreate(JSContextRef ctx, void* data, JSWeakMapDestroyedCallback destructor);
+  
+  /*!
+   @function
+   @abstract Associates a JSObjectRef with the given key in a JSWeakObjectMap.
+   @param ctx The execution context to use.
+   @param map The map to operate on.
+   @param key The key to associate a weak reference with.
+   @param object The user defined object to associate with the key.
+   */
+  void JSWeakObjectMapSet(JSContextRef ctx, JSWeakObjectMapRef map, void* key, JSObjectRef object);
+  
+  /*!
+   @function
+   @abstract Retrieves the JSObjectRef associated with a key.
+   @param ctx The execution context to use.
+   @param map The map to query.
+   @param key The key to search for.
+   @result Either the live object associated with the provided key, or NULL.
+   */
+  JSObjectRef JSWeakObjectMapGet(JSContextRef ctx, JSWeakObjectMapRef map, void* key);
+  
+  /*!
+   @function
+   @abstract Removes the entry for the given key if the key is present, otherwise it has no effect.
+   @param ctx The execution context to use.
+   @param map The map to use.
+   @param key The key to remove.
+   */
+  void JSWeakObjectMapRemove(JSContextRef ctx, JSWeakObjectMapRef map, void* key);
+  
+} // extern "C" {
+#endif // HAL_WEAK_OBJECT_MAP_ENABLE
+
+#ifdef HAL_MEMORY_USAGE_STATISTICS_ENABLE
+extern "C" {
+  
+  /*!
+   @function
+   @abstract Gets a set of statistics about the memory usage of the JavaScript heap.
+   @param ctx The execution context to use.
+   @result An object whose heapSize, heapCapacity, extraMemorySize, objectCount, protectedObjectCount, globalObjectCount and protectedGlobalObjectCount properties are numbers.
+   */
+  JSObjectRef JSGetMemoryUsageStatistics(JSContextRef ctx);
+  
+} // extern "C" {
+#endif // HAL_MEMORY_USAGE_STATISTICS_ENABLE
+
 #endif  // _HAL_DETAIL_JSBASE_HPP_
@@ -0,0 +1,274 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSBINARYLOGGER_HPP_
+#define _HAL_DETAIL_JSBINARYLOGGER_HPP_
+
+#include "HAL_EXPORT.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace HAL { namespace detail {
+  
+  // The types of the arguments of a binary log record.
+  enum class JSBinaryLogArgumentType : std::uint8_t {
+    Signed,
+    Unsigned,
+    Double,
+    Pointer,
+    String
+  };
+  
+  // The kinds of binary log records.
+  enum class JSBinaryLogRecordKind : std::uint8_t {
+    Format  = 1,
+    Message = 2
+  };
+  
+  /*!
+   @class
+   
+   @discussion A JSBinaryLogRecord encodes the arguments of one log
+   message as raw bytes in a buffer on the stack. Integers, floating
+   point numbers and pointers cost a copy of 8 bytes. Strings are
+   copied up to 255 bytes, and other types are formatted with
+   operator<< as a string. Arguments that don't fit in the record are
+   dropped.
+   */
+  class JSBinaryLogRecord final {
+  public:
+    
+    static const std::size_t kCapacity = 1024;
+    
+    JSBinaryLogRecord(std::uint32_t format_id, std::uint64_t timestamp_nanoseconds, std::uint32_t thread_id) {
+      Put(format_id);
+      Put(timestamp_nanoseconds);
+      Put(thread_id);
+      argument_count_offset__ = size__;
+      Put(std::uint8_t(0));
+    }
+    
+    JSBinaryLogRecord(const JSBinaryLogRecord&)            = delete;
+    JSBinaryLogRecord& operator=(const JSBinaryLogRecord&) = delete;
+    
+    template<typename T>
+    void Append(const T& value) {
+      AppendValue(value, ArgumentCategoryOf<typename std::decay<T>::type>());
+    }
+    
+    const char* data() const {
+      return data__;
+    }
+    
+    std::size_t size() const {
+      return size__;
+    }
+    
+  private:
+    
+    enum class ArgumentCategory {
+      Character,
+      CString,
+      StdString,
+      Double,
+      Signed,
+      Unsigned,
+      Pointer,
+      Other
+    };
+    
+    // VS 2013 does not support constexpr, so the category is computed
+    // by a trait.
+    template<typename T>
+    struct ArgumentCategoryOf : std::integral_constant<ArgumentCategory,
+             std::is_same<T, char>::value                                          ? ArgumentCategory::Character :
+             std::is_same<T, const char*>::value || std::is_same<T, char*>::value ? ArgumentCategory::CString   :
+             std::is_same<T, std::string>::value                                   ? ArgumentCategory::StdString :
+             std::is_floating_point<T>::value                                      ? ArgumentCategory::Double    :
+             std::is_integral<T>::value && std::is_signed<T>::value                ? ArgumentCategory::Signed    :
+             std::is_integral<T>::value                                            ? ArgumentCategory::Unsigned  :
+             // Unscoped enumerations, which operator<< writes as numbers.
+             std::is_enum<T>::value && std::is_convertible<T, long long>::value   ? ArgumentCategory::Signed    :
+             std::is_pointer<T>::value && std::is_object<typename std::remove_pointer<T>::type>::value ? ArgumentCategory::Pointer :
+             ArgumentCategory::Other> {
+    };
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::Character>) {
+      AppendString(&value, 1);
+    }
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::CString>) {
+      const char* string = value;
+      AppendString(string, string ? std::strlen(string) : 0);
+    }
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::StdString>) {
+      AppendString(value.data(), value.size());
+    }
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::Double>) {
+      AppendNumber(JSBinaryLogArgumentType::Double, static_cast<double>(value));
+    }
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::Signed>) {
+      AppendNumber(JSBinaryLogArgumentType::Signed, static_cast<std::int64_t>(value));
+    }
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::Unsigned>) {
+      AppendNumber(JSBinaryLogArgumentType::Unsigned, static_cast<std::uint64_t>(value));
+    }
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::Pointer>) {
+      AppendNumber(JSBinaryLogArgumentType::Pointer, static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value)));
+    }
+    
+    template<typename T>
+    void AppendValue(const T& value, std::integral_constant<ArgumentCategory, ArgumentCategory::Other>) {
+      std::ostringstream os;
+      os << value;
+      const auto string = os.str();
+      AppendString(string.data(), string.size());
+    }
+    
+    template<typename T>
+    void AppendNumber(JSBinaryLogArgumentType type, T value) {
+      if (size__ + 1 + sizeof(value) > kCapacity) {
+        return;
+      }
+      Put(static_cast<std::uint8_t>(type));
+      Put(value);
+      ++data__[argument_count_offset__];
+    }
+    
+    void AppendString(const char* value, std::size_t length) {
+      if (length > 255) {
+        length = 255;
+      }
+      if (size__ + 2 + length > kCapacity) {
+        return;
+      }
+      Put(static_cast<std::uint8_t>(JSBinaryLogArgumentType::String));
+      Put(static_cast<std::uint8_t>(length));
+      if (length > 0) {
+        std::memcpy(data__ + size__, value, length);
+        size__ += length;
+      }
+      ++data__[argument_count_offset__];
+    }
+    
+    template<typename T>
+    void Put(T value) {
+      std::memcpy(data__ + size__, &value, sizeof(value));
+      size__ += sizeof(value);
+    }
+    
+    char        data__[kCapacity];
+    std::size_t size__ { 0 };
+    std::size_t argument_count_offset__ { 0 };
+  };
+  
+  /*!
+   @class
+   
+   @discussion A JSBinaryLogger writes log messages as binary records
+   instead of formatting them, for DecodeJSBinaryLog or the
+   DecodeBinaryLog tool to render later.
+   
+   Each call site registers a format, its file, line and severity,
+   once, and the logger writes it to the log so that the log decodes
+   on its own. Each message is then written as the id of its format,
+   a timestamp, a thread id and the raw bytes of its arguments. The
+   log is written in the byte order of the machine that wrote it.
+   
+   Add -DHAL_LOGGING_BINARY_ENABLE=1 to send the HAL_LOG_* macros to
+   JSBinaryLogger::Instance, which writes HAL.binlog.
+   */
+  class HAL_EXPORT JSBinaryLogger final {
+  public:
+    
+    static std::shared_ptr<JSBinaryLogger> Instance();
+    
+    JSBinaryLogger(const std::string& name);
+    ~JSBinaryLogger();
+    
+    JSBinaryLogger()                                 = delete;
+    JSBinaryLogger(const JSBinaryLogger&)            = delete;
+    JSBinaryLogger& operator=(const JSBinaryLogger&) = delete;
+    
+    // Return the id of a new format, where severity is a
+    // JSLoggerSeverityType as an int.
+    std::uint32_t RegisterFormat(const char* file, int line, int severity);
+    
+    template<typename...Args>
+    void Print(std::uint32_t format_id, const Args&...args) {
+      JSBinaryLogRecord record(format_id, GetTimestampNanoseconds(), GetThreadId());
+      AppendImpl(record, args...);
+      Write(JSBinaryLogRecordKind::Message, record.data(), record.size());
+    }
+    
+    // Write the records buffered so far to the file.
+    void Flush();
+    
+  private:
+    
+    static std::uint64_t GetTimestampNanoseconds();
+    static std::uint32_t GetThreadId();
+    
+    static void AppendImpl(JSBinaryLogRecord&) {
+    }
+    
+    template<typename First, typename...Rest>
+    static void AppendImpl(JSBinaryLogRecord& record, const First& first_parameter, const Rest&...rest) {
+      record.Append(first_parameter);
+      AppendImpl(record, rest...);
+    }
+    
+    void Write(JSBinaryLogRecordKind kind, const char* data, std::size_t size);
+    
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::ofstream ofstream__;
+    std::uint32_t next_format_id__ { 1 };
+    std::mutex    mutex__;
+#pragma warning(pop)
+  };
+  
+  /*!
+   @function
+   
+   @abstract Write the messages of a binary log as lines of text, one
+   "seconds.nanoseconds [thread] SEVERITY: message (file:line)" for
+   each.
+   
+   @throws std::runtime_error if input isn't a binary log written on a
+   machine of the same byte order.
+   */
+  HAL_EXPORT void DecodeJSBinaryLog(std::istream& input, std::ostream& output);
+  
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSBINARYLOGGER_HPP_
@@ -0,0 +1,79 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSBUDGETCOUNTERS_HPP_
+#define _HAL_DETAIL_JSBUDGETCOUNTERS_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @struct
+
+   @discussion The costly operations HAL has performed on one thread,
+   so that a test can check that a hot path stays within a budget of
+   them. They only ever grow; a test compares two snapshots.
+
+   The counters are plain thread locals rather than being enabled by a
+   build flag, since each one accompanies an operation that already
+   takes a lock and touches a hash table or JavaScriptCore's heap, and
+   a budget that is only checked in some builds doesn't guard the
+   others.
+   */
+  struct JSBudgetCounts {
+    // Calls of JSValueProtect and JSValueUnprotect.
+    std::uint64_t protect_count;
+    std::uint64_t unprotect_count;
+
+    // New entries in the retain registries.
+    std::uint64_t registry_insert_count;
+
+    // JSStringRefs created from native strings.
+    std::uint64_t string_create_count;
+  };
+
+  // Return the counts of the calling thread.
+  HAL_EXPORT JSBudgetCounts& GetJSBudgetCounts() HAL_NOEXCEPT;
+
+  // Record that JavaScriptCore has started, and read the options
+  // JSRuntime reports, if it hadn't already. JavaScriptCore reads its
+  // options the first time a context group, class or string is
+  // created, whichever comes first.
+  HAL_EXPORT void StartJSRuntime() HAL_NOEXCEPT;
+
+  // HAL calls JavaScriptCore through these rather than directly, so
+  // that every protect, unprotect and string it creates is counted.
+  inline void ProtectJSValue(JSContextRef js_context_ref, JSValueRef js_value_ref) HAL_NOEXCEPT {
+    ++GetJSBudgetCounts().protect_count;
+    JSValueProtect(js_context_ref, js_value_ref);
+  }
+
+  inline void UnprotectJSValue(JSContextRef js_context_ref, JSValueRef js_value_ref) HAL_NOEXCEPT {
+    ++GetJSBudgetCounts().unprotect_count;
+    JSValueUnprotect(js_context_ref, js_value_ref);
+  }
+
+  inline JSStringRef CreateJSStringWithCharacters(const JSChar* characters, std::size_t length) HAL_NOEXCEPT {
+    ++GetJSBudgetCounts().string_create_count;
+    StartJSRuntime();
+    return JSStringCreateWithCharacters(characters, length);
+  }
+
+  inline JSStringRef CreateJSStringWithUTF8CString(const char* string) HAL_NOEXCEPT {
+    ++GetJSBudgetCounts().string_create_count;
+    StartJSRuntime();
+    return JSStringCreateWithUTF8CString(string);
+  }
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSBUDGETCOUNTERS_HPP_
@@ -0,0 +1,119 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSCPUTIMESCOPE_HPP_
+#define _HAL_DETAIL_JSCPUTIMESCOPE_HPP_
+
+#ifdef HAL_CPU_TIME_ENABLE
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_CPU_TIME_ENABLE=1 to account the CPU time of each
+  // JSContext, as returned by JSContext::GetCPUTimeStatistics.
+
+  /*!
+   @struct
+
+   @discussion The thread CPU time spent for one JSGlobalContextRef,
+   shared by every JSContext that wraps it.
+   */
+  struct JSCPUTimeCounters {
+    explicit JSCPUTimeCounters(JSGlobalContextRef js_global_context_ref) HAL_NOEXCEPT
+    : js_global_context_ref(js_global_context_ref) {
+    }
+
+    JSCPUTimeCounters(const JSCPUTimeCounters&)            = delete;
+    JSCPUTimeCounters& operator=(const JSCPUTimeCounters&) = delete;
+
+    void Reset() HAL_NOEXCEPT {
+      js_nanoseconds.store(0, std::memory_order_relaxed);
+      native_nanoseconds.store(0, std::memory_order_relaxed);
+      entry_count.store(0, std::memory_order_relaxed);
+      callback_count.store(0, std::memory_order_relaxed);
+    }
+
+    const JSGlobalContextRef   js_global_context_ref;
+    std::atomic<std::uint64_t> js_nanoseconds     { 0 };
+    std::atomic<std::uint64_t> native_nanoseconds { 0 };
+    std::atomic<std::uint64_t> entry_count        { 0 };
+    std::atomic<std::uint64_t> callback_count     { 0 };
+  };
+
+  // Return the counters of js_global_context_ref, creating them the
+  // first time. They live while any JSContext of it does.
+  HAL_EXPORT std::shared_ptr<JSCPUTimeCounters> GetJSCPUTimeCounters(JSGlobalContextRef js_global_context_ref);
+
+  // Return the CPU time the calling thread has used.
+  HAL_EXPORT std::uint64_t GetThreadCPUNanoseconds() HAL_NOEXCEPT;
+
+  /*!
+   @class
+
+   @discussion A JSCPUTimeScope surrounds each script or function call
+   that native code makes, and each callback from JavaScript into a
+   JSFunction or JSExport class. The scopes of a thread form a stack,
+   and the thread CPU clock is read once at each transition, so the
+   time between two transitions is charged to the innermost scope: to
+   JavaScript for a call, and to native code for a callback. What a
+   call spends in callbacks is therefore not counted as JavaScript,
+   and what a callback spends in calls back into JavaScript is not
+   counted as native.
+   */
+  class HAL_EXPORT JSCPUTimeScope final {
+
+  public:
+
+    // A call into JavaScript for the context of counters.
+    explicit JSCPUTimeScope(JSCPUTimeCounters& counters) HAL_NOEXCEPT;
+
+    // A callback into native code from context_ref.
+    explicit JSCPUTimeScope(JSContextRef context_ref) HAL_NOEXCEPT;
+
+    ~JSCPUTimeScope() HAL_NOEXCEPT;
+
+    JSCPUTimeScope(const JSCPUTimeScope&)            = delete;
+    JSCPUTimeScope& operator=(const JSCPUTimeScope&) = delete;
+
+  private:
+
+    // Make this the innermost scope of the thread.
+    void Enter() HAL_NOEXCEPT;
+
+    // Charge the time since the last transition of the thread to its
+    // innermost scope.
+    static void ChargeCurrent() HAL_NOEXCEPT;
+
+    JSCPUTimeCounters* counters__ { nullptr };
+    JSCPUTimeScope*    previous__ { nullptr };
+    bool               native__;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    // Only set when a callback isn't nested in a call for the same
+    // context, and had to look its counters up.
+    std::shared_ptr<JSCPUTimeCounters> shared_counters__;
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#define HAL_JS_CPU_TIME_SCOPE(counters) const detail::JSCPUTimeScope hal_cpu_time_scope(counters)
+#define HAL_NATIVE_CPU_TIME_SCOPE(context_ref) const detail::JSCPUTimeScope hal_cpu_time_scope(context_ref)
+#else
+#define HAL_JS_CPU_TIME_SCOPE(counters)
+#define HAL_NATIVE_CPU_TIME_SCOPE(context_ref)
+#endif // HAL_CPU_TIME_ENABLE
+
+#endif // _HAL_DETAIL_JSCPUTIMESCOPE_HPP_
@@ -0,0 +1,132 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSCALLBACKRECORDSCOPE_HPP_
+#define _HAL_DETAIL_JSCALLBACKRECORDSCOPE_HPP_
+
+#ifdef HAL_CALLBACK_RECORD_ENABLE
+#include "HAL/JSCallbackRecorder.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_CALLBACK_RECORD_ENABLE=1 to record the callbacks of
+  // JSCallbackRecorder.
+
+  // class_name and property_name must outlive the recording, so they
+  // are string literals or the names of JSExport classes and their
+  // properties. A property name only known as a JSStringRef is kept in
+  // property_name_ref instead, which the buffer retains.
+  struct JSCallbackRecordEvent {
+    const char*   class_name;
+    const char*   property_name;
+    JSStringRef   property_name_ref;
+    std::uint8_t  kind;
+    std::uint8_t  argument_count;
+    std::uint8_t  argument_types[JSCallbackRecorder::kMaxArguments];
+    std::uint64_t begin_nanoseconds;
+    std::uint64_t duration_nanoseconds;
+  };
+
+  // Append an event to the buffer of the calling thread.
+  HAL_EXPORT void AppendCallbackRecordEvent(const JSCallbackRecordEvent& event) HAL_NOEXCEPT;
+
+  inline
+  std::uint64_t GetCallbackRecordNanoseconds() HAL_NOEXCEPT {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  // Records the lifetime of the scope as a callback, if
+  // JSCallbackRecorder was started when it began.
+  class JSCallbackRecordScope final {
+
+  public:
+
+    JSCallbackRecordScope(JSCallbackRecordKind kind, const char* class_name, const char* property_name, JSStringRef property_name_ref, JSContextRef context_ref, std::size_t argument_count, const JSValueRef arguments_array[]) HAL_NOEXCEPT
+    : enabled__(JSCallbackRecorder::IsEnabled())
+    , owns_property_name_ref__(false) {
+      if (enabled__) {
+        event__.class_name        = class_name;
+        event__.property_name     = property_name;
+        event__.property_name_ref = property_name_ref;
+        event__.kind              = static_cast<std::uint8_t>(kind);
+        event__.argument_count    = static_cast<std::uint8_t>(argument_count < JSCallbackRecorder::kMaxArguments ? argument_count : JSCallbackRecorder::kMaxArguments);
+        for (std::uint8_t i = 0; i < event__.argument_count; ++i) {
+          event__.argument_types[i] = static_cast<std::uint8_t>(JSValueGetType(context_ref, arguments_array[i]));
+        }
+        event__.begin_nanoseconds = GetCallbackRecordNanoseconds();
+      }
+    }
+
+    // A function bound directly to a member function doesn't know its
+    // name, so it is read from the function's name property, and only
+    // while recording.
+    JSCallbackRecordScope(const char* class_name, JSContextRef context_ref, JSObjectRef function_ref, std::size_t argument_count, const JSValueRef arguments_array[]) HAL_NOEXCEPT
+    : JSCallbackRecordScope(JSCallbackRecordKind::CallNamedFunction, class_name, nullptr, nullptr, context_ref, argument_count, arguments_array) {
+      if (enabled__) {
+        JSValueRef exception { nullptr };
+        const auto name_ref = JSObjectGetProperty(context_ref, function_ref, static_cast<JSStringRef>(JSAtoms::name), &exception);
+        if (!exception && JSValueIsString(context_ref, name_ref)) {
+          event__.property_name_ref = JSValueToStringCopy(context_ref, name_ref, nullptr);
+          owns_property_name_ref__  = event__.property_name_ref != nullptr;
+        }
+        event__.begin_nanoseconds = GetCallbackRecordNanoseconds();
+      }
+    }
+
+    // ConvertToType records the type converted to as its argument.
+    JSCallbackRecordScope(const char* class_name, JSType type) HAL_NOEXCEPT
+    : enabled__(JSCallbackRecorder::IsEnabled())
+    , owns_property_name_ref__(false) {
+      if (enabled__) {
+        event__.class_name        = class_name;
+        event__.property_name     = nullptr;
+        event__.property_name_ref = nullptr;
+        event__.kind              = static_cast<std::uint8_t>(JSCallbackRecordKind::ConvertToType);
+        event__.argument_count    = 1;
+        event__.argument_types[0] = static_cast<std::uint8_t>(type);
+        event__.begin_nanoseconds = GetCallbackRecordNanoseconds();
+      }
+    }
+
+    ~JSCallbackRecordScope() HAL_NOEXCEPT {
+      if (enabled__) {
+        event__.duration_nanoseconds = GetCallbackRecordNanoseconds() - event__.begin_nanoseconds;
+        AppendCallbackRecordEvent(event__);
+        if (owns_property_name_ref__) {
+          JSStringRelease(event__.property_name_ref);
+        }
+      }
+    }
+
+    JSCallbackRecordScope(const JSCallbackRecordScope&)            = delete;
+    JSCallbackRecordScope& operator=(const JSCallbackRecordScope&) = delete;
+
+  private:
+
+    const bool            enabled__;
+    bool                  owns_property_name_ref__;
+    JSCallbackRecordEvent event__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#define HAL_CALLBACK_RECORD(kind, class_name, property_name, property_name_ref, context_ref, argument_count, arguments_array) detail::JSCallbackRecordScope hal_callback_record_scope(JSCallbackRecordKind::kind, class_name, property_name, property_name_ref, context_ref, argument_count, arguments_array)
+#define HAL_CALLBACK_RECORD_FUNCTION(class_name, context_ref, function_ref, argument_count, arguments_array) detail::JSCallbackRecordScope hal_callback_record_scope(class_name, context_ref, function_ref, argument_count, arguments_array)
+#define HAL_CALLBACK_RECORD_CONVERSION(class_name, type) detail::JSCallbackRecordScope hal_callback_record_scope(class_name, type)
+#else
+#define HAL_CALLBACK_RECORD(kind, class_name, property_name, property_name_ref, context_ref, argument_count, arguments_array)
+#define HAL_CALLBACK_RECORD_FUNCTION(class_name, context_ref, function_ref, argument_count, arguments_array)
+#define HAL_CALLBACK_RECORD_CONVERSION(class_name, type)
+#endif // HAL_CALLBACK_RECORD_ENABLE
+
+#endif // _HAL_DETAIL_JSCALLBACKRECORDSCOPE_HPP_
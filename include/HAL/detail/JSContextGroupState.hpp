@@ -0,0 +1,75 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSCONTEXTGROUPSTATE_HPP_
+#define _HAL_DETAIL_JSCONTEXTGROUPSTATE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContextGroup.hpp"
+#include "HAL/detail/JSQuotaState.hpp"
+
+#include <memory>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion The state of one JSContextGroupRef that every
+   JSContextGroup wrapping it shares, so that a JSContextGroup wrapped
+   around its JSContextGroupRef, e.g. in a callback, has the policy it
+   was created with, and so that each JSContext of the group gets its
+   usage and quotas without a lookup.
+
+   A Refcounted group's state lives while any JSContextGroup of it
+   does, and since each of them retains the JSContextGroupRef, a state
+   can't be mistaken for a later group at the same address. An
+   UnmanagedSingleContext group is never released, so its state is
+   kept until the process exits.
+   */
+  class HAL_EXPORT JSContextGroupState final {
+
+  public:
+
+    JSContextGroupState(JSContextGroupRef js_context_group_ref, JSContextGroupPolicy policy) HAL_NOEXCEPT;
+    ~JSContextGroupState() HAL_NOEXCEPT;
+
+    JSContextGroupState(const JSContextGroupState&)            = delete;
+    JSContextGroupState& operator=(const JSContextGroupState&) = delete;
+
+    // Return the state of a group HAL just created.
+    static std::shared_ptr<JSContextGroupState> Create(JSContextGroupRef js_context_group_ref, JSContextGroupPolicy policy) HAL_NOEXCEPT;
+
+    // Return the state of js_context_group_ref, or a new one with the
+    // default policy for a group HAL holds no JSContextGroup of.
+    static std::shared_ptr<JSContextGroupState> Get(JSContextGroupRef js_context_group_ref) HAL_NOEXCEPT;
+
+    JSContextGroupPolicy get_policy() const HAL_NOEXCEPT {
+      return policy__;
+    }
+
+    JSQuotaState quota_state;
+
+#ifdef HAL_SCRIPT_REF_ENABLE
+    // Made by JSContextGroup::GetScriptCache, and held by the JSContexts
+    // that have evaluated a script, since it holds a copy of the group.
+    JSMutex                      script_cache_mutex HAL_LOCK_NAME("JSContextGroupState script cache");
+    std::weak_ptr<JSScriptCache> script_cache;
+#endif
+
+  private:
+
+    static void Register(const std::shared_ptr<JSContextGroupState>& state) HAL_NOEXCEPT;
+
+    const JSContextGroupRef    js_context_group_ref__;
+    const JSContextGroupPolicy policy__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSCONTEXTGROUPSTATE_HPP_
@@ -10,13 +10,19 @@
 #define _HAL_DETAIL_JSEXPORTCALLBACKS_HPP_
 
 #include "HAL/JSValue.hpp"
+#include "HAL/JSString.hpp"
 
+#include <cstdint>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace HAL {
-  class JSString;
   class JSObject;
+  class JSObjectView;
+  class JSArguments;
   class JSPropertyNameAccumulator;
+  class JSStringBuilder;
 }
 
 
@@ -106,6 +112,37 @@ namespace HAL { namespace detail {
   template<typename T>
   using CallNamedFunctionCallback = std::function<JSValue(T&, const std::vector<JSValue>&, JSObject&)>;
   
+  /*!
+   @typedef CallNamedFunctionArgumentsCallback
+   
+   @abstract An alternative to CallNamedFunctionCallback that receives
+   its arguments as a JSArguments view instead of a vector of JSValues.
+   
+   @discussion Calling it does no per-call heap allocation, which
+   matters for small functions that are called often. For example,
+   given this class definition:
+   
+   class Foo {
+   JSValue Scale(const JSArguments& arguments, JSObject& this_object);
+   };
+   
+   You would define the callback like this:
+   
+   CallNamedFunctionArgumentsCallback callback(&Foo::Scale);
+   
+   @param 1 A non-const reference to the C++ object that implements
+   your JavaScript object.
+   
+   @param 2 A view of the arguments, valid only during the call.
+   
+   @param 3 An non-const rvalue reference to the 'this' JavaScript
+   object.
+   
+   @result Return the function's value.
+   */
+  template<typename T>
+  using CallNamedFunctionArgumentsCallback = std::function<JSValue(T&, const JSArguments&, JSObject&)>;
+  
   /*!
    @typedef HasPropertyCallback
    
@@ -229,6 +266,75 @@ namespace HAL { namespace detail {
   template<typename T>
   using SetPropertyCallback = std::function<bool(T&, const JSString&, const JSValue&)>;
   
+  /*!
+   @typedef GetIndexedPropertyCallback
+   
+   @abstract The callback to invoke when getting the value of an
+   array index property, such as foo[3], from your JavaScript object.
+   
+   @discussion The callback is only invoked for property names that
+   are canonical array indexes, i.e. the decimal representation of an
+   integer in the range [0, 2^32 - 2] without leading zeros. The index
+   is parsed directly from the property name's UTF-16 characters.
+   
+   For example, given this class definition:
+   
+   class Foo {
+   JSValue GetIndexedProperty(std::uint32_t index) const;
+   };
+   
+   You would define the callback like this:
+   
+   GetIndexedPropertyCallback callback(&Foo::GetIndexedProperty);
+   
+   @param 1 A reference to the C++ object that implements your
+   JavaScript object.
+   
+   @param 2 The property's array index.
+   
+   @result The property's value if it exists. Return native null value
+   (context.CreateNativeNull()) to forward the request to the
+   GetPropertyCallback (if any) and then to your JavaScript object's
+   named properties and prototype chain.
+   */
+  template<typename T>
+  using GetIndexedPropertyCallback = std::function<JSValue(T&, std::uint32_t)>;
+  
+  /*!
+   @typedef SetIndexedPropertyCallback
+   
+   @abstract The callback to invoke when setting the value of an
+   array index property, such as foo[3] = 42, on your JavaScript
+   object.
+   
+   @discussion The callback is only invoked for property names that
+   are canonical array indexes.
+   
+   For example, given this class definition:
+   
+   class Foo {
+   bool SetIndexedProperty(std::uint32_t index, const JSValue& value);
+   };
+   
+   You would define the callback like this:
+   
+   SetIndexedPropertyCallback callback(&Foo::SetIndexedProperty);
+   
+   @param 1 A non-const reference to the C++ object that implements
+   your JavaScript object.
+   
+   @param 2 The property's array index.
+   
+   @param 3 A const reference to the property's value.
+   
+   @result Return true if the property was set on your JavaScript
+   object. Return false to forward the request to the
+   SetPropertyCallback (if any) and then to your JavaScript object's
+   named properties and prototype chain.
+   */
+  template<typename T>
+  using SetIndexedPropertyCallback = std::function<bool(T&, std::uint32_t, const JSValue&)>;
+  
   /*!
    @typedef DeletePropertyCallback
    
@@ -378,6 +484,162 @@ namespace HAL { namespace detail {
   template<typename T>
   using ConvertToTypeCallback = std::function<JSValue(const T&, ::HAL::JSValue::Type&)>;
   
+  /*!
+   @class
+   
+   @discussion A JSExportPrimitive is the number or string a
+   ConvertToTypePrimitiveCallback converts your JavaScript object to,
+   or nothing to forward the conversion to your class' parent class
+   chain, then your JavaScript object's prototype chain.
+   
+   Unlike a JSValue it holds no JSContext and protects nothing, so
+   returning a number makes no JavaScriptCore call until the value is
+   handed back.
+   */
+  class JSExportPrimitive final {
+    
+  public:
+    
+    static JSExportPrimitive Forward() HAL_NOEXCEPT {
+      return JSExportPrimitive(Kind::Forward, 0, std::string());
+    }
+    
+    static JSExportPrimitive Number(double number) HAL_NOEXCEPT {
+      return JSExportPrimitive(Kind::Number, number, std::string());
+    }
+    
+    static JSExportPrimitive String(std::string string) HAL_NOEXCEPT {
+      return JSExportPrimitive(Kind::String, 0, std::move(string));
+    }
+    
+    bool IsForward() const HAL_NOEXCEPT {
+      return kind__ == Kind::Forward;
+    }
+    
+    // Return the JSValueRef of this primitive in context_ref, or
+    // nullptr to forward the conversion.
+    JSValueRef ToJSValueRef(JSContextRef context_ref) const HAL_NOEXCEPT {
+      switch (kind__) {
+        case Kind::Forward: return nullptr;
+        case Kind::Number:  return JSValueMakeNumber(context_ref, number__);
+        case Kind::String:  return JSValueMakeString(context_ref, static_cast<JSStringRef>(JSString(string__)));
+      }
+      return nullptr;
+    }
+    
+  private:
+    
+    enum class Kind : std::uint8_t {
+      Forward,
+      Number,
+      String
+    };
+    
+    JSExportPrimitive(Kind kind, double number, std::string string) HAL_NOEXCEPT
+    : kind__(kind)
+    , number__(number)
+    , string__(std::move(string)) {
+    }
+    
+    Kind        kind__;
+    double      number__;
+    std::string string__;
+  };
+  
+  /*!
+   @typedef ConvertToTypePrimitiveCallback
+   
+   @abstract A cheaper ConvertToTypeCallback, for objects converted
+   often, as by '"" + object' or '+object'.
+   
+   @discussion The callback is given the type to convert to and a
+   borrowed view of your JavaScript object, and returns the primitive
+   directly, so a conversion creates no JSValue and no JSObject.
+   
+   For example, given this class definition:
+   
+   class Foo {
+   JSExportPrimitive ConvertToType(JSValue::Type type, const JSObjectView& this_object) const;
+   };
+   
+   You would define the callback like this:
+   
+   ConvertToTypePrimitiveCallback callback(&Foo::ConvertToType);
+   
+   @param 1 A const reference to the C++ object that implements your
+   JavaScript object.
+   
+   @param 2 The JSValue::Type to convert to, either Number or String.
+   
+   @param 3 A view of your JavaScript object, valid for the duration
+   of the callback.
+   
+   @result Return the object's converted value, or
+   JSExportPrimitive::Forward() to forward the request as
+   ConvertToTypeCallback does for native null.
+   */
+  template<typename T>
+  using ConvertToTypePrimitiveCallback = std::function<JSExportPrimitive(const T&, ::HAL::JSValue::Type, const JSObjectView&)>;
+  
+  /*!
+   @typedef ToJSONCallback
+   
+   @abstract The callback to invoke when JSON.stringify serializes your
+   JavaScript object, which writes the object's JSON text in one pass
+   instead of having each property read through a callback.
+   
+   @discussion For example, given this class definition:
+   
+   class Foo {
+   void ToJSON(JSStringBuilder& json) const;
+   };
+   
+   You would define the callback like this:
+   
+   ToJSONCallback callback(&Foo::ToJSON);
+   
+   where Foo::ToJSON writes, for example:
+   
+   json.Append("{\"name\":").AppendJSONString(name__).Append(",\"size\":").AppendJSONNumber(size__).Append("}");
+   
+   @param 1 A const reference to the C++ object that implements your
+   JavaScript object.
+   
+   @param 2 The JSStringBuilder to append the object's JSON text to.
+   Its contents must be valid JSON when the callback returns.
+   */
+  template<typename T>
+  using ToJSONCallback = std::function<void(const T&, JSStringBuilder&)>;
+  
+  /*!
+   @typedef JSExportNextBatch
+   
+   @abstract The native cursor of one JavaScript iteration, which
+   appends up to its second argument's count of values to the vector
+   per call.
+   
+   @result Return false once the cursor is exhausted, including from
+   the call that appends its last values.
+   */
+  using JSExportNextBatch = std::function<bool(std::vector<JSValue>&, std::size_t)>;
+  
+  /*!
+   @typedef IteratorCallback
+   
+   @abstract The callback to invoke when a for...of loop, spread or
+   other consumer of Symbol.iterator starts iterating your JavaScript
+   object, which returns a native cursor positioned at its first
+   value.
+   
+   @discussion JSExport<T>::AddIterator builds it from a begin and a
+   next batch callback.
+   
+   @param 1 A non-const reference to the C++ object that implements
+   your JavaScript object. It outlives the cursor.
+   */
+  template<typename T>
+  using IteratorCallback = std::function<JSExportNextBatch(T&)>;
+  
 }} // namespace HAL { namespace detail {
 
 #endif // _HAL_DETAIL_JSEXPORTCALLBACKS_HPP_
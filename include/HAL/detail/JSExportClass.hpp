@@ -16,32 +16,75 @@
 #include "HAL/JSString.hpp"
 #include "HAL/JSValue.hpp"
 #include "HAL/JSObject.hpp"
+#include "HAL/JSObjectView.hpp"
+#include "HAL/JSArguments.hpp"
+#include "HAL/JSHandleScope.hpp"
+#include "HAL/JSExportAllocator.hpp"
+#include "HAL/JSExportClassName.hpp"
 #include "HAL/JSNumber.hpp"
 #include "HAL/JSError.hpp"
 #include "HAL/JSArray.hpp"
+#include "HAL/JSFunction.hpp"
 
 #include "HAL/detail/JSPropertyNameAccumulator.hpp"
 #include "HAL/detail/JSUtil.hpp"
 #include "HAL/detail/JSValueUtil.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include "HAL/detail/JSCallbackRecordScope.hpp"
+#include "HAL/detail/JSCPUTimeScope.hpp"
+#include "HAL/detail/JSExportConstantCache.hpp"
+#include "HAL/detail/JSExportValueCache.hpp"
+#include "HAL/detail/JSExportDirtyList.hpp"
+#include "HAL/detail/JSExportSlotTable.hpp"
+#include "HAL/detail/JSExportWrapperCache.hpp"
+#include "HAL/detail/JSExportNegativePropertyCache.hpp"
+#include "HAL/detail/JSExportHotPropertyNameCache.hpp"
+#include "HAL/detail/JSExportClassInfo.hpp"
+#include "HAL/detail/JSPropertyProfile.hpp"
+#include "HAL/detail/JSStackSample.hpp"
+#include "HAL/detail/JSTraceScope.hpp"
 
+#include <algorithm>
+#include <functional>
 #include <string>
-#include <regex>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <memory>
 #include <utility>
-#include <typeinfo>
-#include <typeindex>
+#include <type_traits>
 #include <unordered_map>
 #include <list>
+#include <atomic>
+#include <mutex>
 
 namespace HAL {
   template<typename T>
   class JSExport;
+  
+  class JSExportObject;
 }
 
 namespace HAL { namespace detail {
   
+  // Record the JSObjectRef whose private data is js_export_object_ptr
+  // so that JSExportObject::get_object doesn't need the global private
+  // data map. Objects not derived from JSExportObject select the
+  // overload that does nothing.
+  HAL_EXPORT void SetJSExportObjectRef(JSExportObject* js_export_object_ptr, JSObjectRef js_object_ref) HAL_NOEXCEPT;
+  
+  inline
+  void SetJSExportObjectRef(void*, JSObjectRef) HAL_NOEXCEPT {
+  }
+  
+  // Record the class js_export_object_ptr is an instance of, so that
+  // the external memory cost it reports is counted for that class.
+  HAL_EXPORT void SetJSExportObjectClassInfo(JSExportObject* js_export_object_ptr, const JSExportClassInfo* class_info) HAL_NOEXCEPT;
+  
+  inline
+  void SetJSExportObjectClassInfo(void*, const JSExportClassInfo*) HAL_NOEXCEPT {
+  }
+  
   
   template<typename T>
   class JSExportClassDefinitionBuilder;
@@ -49,6 +92,32 @@ namespace HAL { namespace detail {
   template<typename T>
   class JSExportClassDefinition;
   
+  // True if T has a constructor taking (const JSContext&, const
+  // JSArguments&) for single-phase construction.
+  template<typename T>
+  struct JSExportHasArgumentsConstructor : std::integral_constant<bool, std::is_constructible<T, const JSContext&, const JSArguments&>::value> {
+  };
+  
+  // True if T has a void Recycle() member function that resets a
+  // finalized native object for reuse.
+  template<typename T>
+  struct JSExportHasRecycle {
+  private:
+    template<typename U>
+    static auto Test(int) -> decltype(std::declval<U&>().Recycle(), std::true_type());
+    template<typename U>
+    static std::false_type Test(...);
+  public:
+    static const bool value = decltype(Test<T>(0))::value;
+  };
+  
+  // True if the native objects of T can be recycled. Objects created
+  // by single-phase construction depend on their arguments, so they
+  // can't be reused for another 'new' expression.
+  template<typename T>
+  struct JSExportCanRecycle : std::integral_constant<bool, JSExportHasRecycle<T>::value && !JSExportHasArgumentsConstructor<T>::value> {
+  };
+  
   /*!
    @class
    
@@ -57,7 +126,9 @@ namespace HAL { namespace detail {
    JSExportClass defines JavaScript objects implemented by a C++
    class.
    
-   This class is thread-safe and lock-free by design.
+   This class is thread-safe and lock-free by design. The class
+   definition is published once, when the first JSExportClass is
+   constructed from it, and never changes afterwards.
    */
   template<typename T>
   class JSExportClass final : public JSClass HAL_PERFORMANCE_COUNTER2(JSExportClass<T>) {
@@ -89,6 +160,84 @@ namespace HAL { namespace detail {
     // Returns cached constant names, sorted by Most-Recently-Used order.
     // Making this public only for testing porpose.
     static std::vector<std::string> GetCachedKeys();
+    
+    // Erase the constant cache entries of one JSContext.
+    static void EvictCache(const JSContext& js_context);
+    
+    // Discard an object's cached value of a property added with
+    // AddCachedValueProperty, or throw std::invalid_argument.
+    static void InvalidateCachedValue(T& native_object, const std::string& property_name);
+    
+    // Discard all of an object's cached values, including those of
+    // properties inherited from a flattened parent.
+    static void InvalidateCachedValues(T& native_object) HAL_NOEXCEPT;
+    
+    // Get or set a named value property of an object of T by calling
+    // its callback directly, see JSExport<T>::GetNamed.
+    static JSValue GetNamed(const JSObject& js_object, const JSString& property_name);
+    static bool    SetNamed(JSObject& js_object, const JSString& property_name, const JSValue& js_value);
+    
+    // Returns the hit, miss and eviction counts of the constant cache,
+    // for sizing it with ResizeCache.
+    static JSExportConstantCache::Statistics GetCacheStatistics();
+    
+    // Returns the live instances of T and the memory they hold.
+    static JSExportClassStatistics GetClassStatistics() HAL_NOEXCEPT;
+    
+    // Returns the JSExportClassInfo that the native objects of T and
+    // of its derived classes record in their header.
+    static const JSExportClassInfo& get_class_info() HAL_NOEXCEPT {
+      return class_info__;
+    }
+    
+    // Sets the soft budget of T, see JSExportClassBudget.
+    static void SetClassBudget(const JSExportClassBudget& budget);
+    
+    // Destroys the native objects of T this thread keeps for reuse,
+    // see JSExportClassDefinitionBuilder::RecycleCapacity, and returns
+    // their number.
+    static std::size_t PurgeRecycled() HAL_NOEXCEPT;
+    
+    // Returns the number of native objects of T this thread keeps for
+    // reuse.
+    static std::size_t GetRecycledCount() HAL_NOEXCEPT;
+    
+    // Creates count objects of T in js_context, calling init with each
+    // native object and its index, see JSContext::CreateObjects.
+    template<typename Init>
+    static JSArray CreateObjects(const JSContext& js_context, std::size_t count, Init&& init);
+    
+    // Forget the property names the HasProperty and GetProperty
+    // callbacks reported as absent.
+    static void InvalidateNegativePropertyCache();
+    
+    // Calls callback with each native object of T written since the
+    // last drain and the names of the properties written, see
+    // JSExportClassDefinitionBuilder::TrackDirty, and returns the
+    // number of objects.
+    static std::size_t DrainDirty(const std::function<void(T&, const std::vector<std::string>&)>& callback);
+    
+    // Returns the number of native objects of T waiting to be drained.
+    static std::size_t GetDirtyCount();
+    
+    // Takes a native object that is going away off the dirty list.
+    static void ForgetDirty(JSExportDirtySet& dirty_set) HAL_NOEXCEPT;
+    
+    // Returns the weak handle slot of a native object, see
+    // JSObject::GetWeakHandle, or an empty reference if T isn't the
+    // class of its JSObject.
+    static JSExportSlotReference GetWeakSlot(T& native_object, JSContextRef context_ref, JSObjectRef object_ref);
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+    // The latency histogram of one kind of callback of the class.
+    static const JSLatencyHistogram& GetCallbackLatency(JSExportCallbackKind kind) HAL_NOEXCEPT;
+#endif
+
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+    // The calls of each named property, the most total time first.
+    static std::vector<JSPropertyProfileEntry> GetPropertyProfile();
+    static void ResetPropertyProfile() HAL_NOEXCEPT;
+#endif
 
   private:
     
@@ -106,12 +255,94 @@ namespace HAL { namespace detail {
     template<typename U>
     friend class JSExportClassDefinitionBuilder;
     
-    // Support for JSStaticValue
+    // Support for JSStaticValue. Like function properties, each value
+    // property is bound to the getter and setter trampolines for its
+    // index in the class definition's value list, and properties past
+    // kNamedValueTrampolineCount fall back to a lookup by name.
+    static const std::size_t kNamedValueTrampolineCount = 64;
+    
+    template<std::size_t I>
+    static JSValueRef  GetNamedValuePropertyCallbackAt(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception);
+    template<std::size_t I>
+    static bool        SetNamedValuePropertyCallbackAt(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception);
     static JSValueRef  GetNamedValuePropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception);
     static bool        SetNamedValuePropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception);
+    static JSValueRef  GetNamedValueProperty(const JSExportNamedValuePropertyEntry<T>& entry, JSContextRef context_ref, JSObjectRef object_ref, JSValueRef* exception);
+    static bool        SetNamedValueProperty(const JSExportNamedValuePropertyEntry<T>& entry, JSContextRef context_ref, JSObjectRef object_ref, JSValueRef value_ref, JSValueRef* exception);
+    
+    // The work of a named value property's getter and setter, shared
+    // by its JavaScriptCore callbacks and by GetNamed and SetNamed. A
+    // null native_object_ptr is looked up only if the value isn't a
+    // cached constant.
+    static JSValue     GetNamedValue(const JSExportNamedValuePropertyEntry<T>& entry, JSContextRef context_ref, JSObjectRef object_ref, T* native_object_ptr);
+    static bool        SetNamedValue(const JSExportNamedValuePropertyEntry<T>& entry, T& native_object, const JSValue& js_value);
     
-    // Support for JSStaticFunction
+    static ::JSObjectGetPropertyCallback GetNamedValueGetPropertyCallback(std::size_t index) HAL_NOEXCEPT;
+    static ::JSObjectSetPropertyCallback GetNamedValueSetPropertyCallback(std::size_t index) HAL_NOEXCEPT;
+    
+    template<typename U, std::size_t N>
+    friend struct JSExportNamedValueTrampolines;
+    
+    template<typename U>
+    friend struct JSExportNamedValueTrampolineTable;
+    
+    // Support for value and function properties bound directly to
+    // member function pointers. The pointer is a template argument,
+    // so the call is resolved at compile time and can be inlined into
+    // the callback.
+    template<typename G, G Getter>
+    static JSValueRef  GetNamedValuePropertyDirectCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception);
+    template<bool (T::*Setter)(const JSValue&)>
+    static bool        SetNamedValuePropertyDirectCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception);
+    template<typename F, F Function>
+    static JSValueRef  CallNamedFunctionDirectCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
+    static JSValue     InvokeNamedFunction(T& native_object, JSValue (T::*function)(const std::vector<JSValue>&, JSObject&), JSContextRef context_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception, JSObject& this_object);
+    static JSValue     InvokeNamedFunction(T& native_object, JSValue (T::*function)(const JSArguments&, JSObject&), JSContextRef context_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception, JSObject& this_object);
+    
+    // Support for JSStaticFunction. Each function property is bound
+    // to the trampoline for its index in the class definition's
+    // function list, so a call needs no name lookup. Classes with more
+    // than kNamedFunctionTrampolineCount functions bind the rest to
+    // CallNamedFunctionCallback, which looks the function up by its
+    // name property.
+    static const std::size_t kNamedFunctionTrampolineCount = 64;
+    
+    template<std::size_t I>
+    static JSValueRef  CallNamedFunctionCallbackAt(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
     static JSValueRef  CallNamedFunctionCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
+    static JSValueRef  CallNamedFunction(const std::string& function_name, const JSExportNamedFunctionPropertyCallback<T>& function_property_callback, JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception);
+    static ::JSObjectCallAsFunctionCallback GetNamedFunctionCallback(std::size_t index) HAL_NOEXCEPT;
+    
+    template<typename U, std::size_t N>
+    friend struct JSExportNamedFunctionTrampolines;
+    
+    // Support for JSExportClassDefinitionBuilder::PinConstants.
+    static void        PinConstants(JSContextRef context_ref, JSObjectRef object_ref, T& native_object);
+    
+    // Support for JSExportClassDefinitionBuilder::Iterator.
+    static void        InstallIterator(const JSContext& js_context, JSObjectRef object_ref);
+    
+    // Support for single-phase construction. If T has a constructor
+    // taking (const JSContext&, const JSArguments&), a JavaScript 'new'
+    // expression passes its arguments to it through
+    // constructor_arguments__ instead of creating T(js_context) and
+    // then calling postCallAsConstructor.
+    static T*          CreateNativeObject(const JSContext& js_context, std::true_type);
+    static T*          CreateNativeObject(const JSContext& js_context, std::false_type);
+    static JSObjectRef CallAsConstructor(JSContext& js_context, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception, std::true_type);
+    static JSObjectRef CallAsConstructor(JSContext& js_context, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception, std::false_type);
+    
+    // Support for JSExportClassDefinitionBuilder::RecycleCapacity.
+    static T*          ReuseNativeObject(const JSContext& js_context, std::true_type) HAL_NOEXCEPT;
+    static T*          ReuseNativeObject(const JSContext& js_context, std::false_type) HAL_NOEXCEPT;
+    static bool        RecycleNativeObject(T* native_object_ptr, std::true_type) HAL_NOEXCEPT;
+    static bool        RecycleNativeObject(T* native_object_ptr, std::false_type) HAL_NOEXCEPT;
+    
+    static HAL_THREAD_LOCAL const JSArguments* constructor_arguments__;
+    
+    // The JSContext of CreateObjects, which Initialize uses instead of
+    // wrapping its JSContextRef in a new JSContext for every object.
+    static HAL_THREAD_LOCAL const JSContext*   initializing_context__;
     
     // JavaScriptCore C API callback interface.
     static void        JSObjectInitializeCallback(JSContextRef context_ref, JSObjectRef object_ref);
@@ -127,63 +358,95 @@ namespace HAL { namespace detail {
     static JSValueRef  JSObjectConvertToTypeCallback(JSContextRef context_ref, JSObjectRef object_ref, JSType type, JSValueRef* exception);
     
     // Helper functions.
+    static JSExportValueCache& GetValueCache(T& native_object) HAL_NOEXCEPT;
+    static JSExportValueCache& GetValueCache(T& native_object, const JSExportNamedValuePropertyEntry<T>& entry) HAL_NOEXCEPT;
+    static JSExportWrapperEntry& GetWrapperEntry(T& native_object) HAL_NOEXCEPT;
+    static void        MarkDirty(T& native_object, std::size_t index);
+    static T*          RequireNativeObject(JSContextRef context_ref, JSObjectRef object_ref, const char* function_name);
+    static std::size_t FindDirectNamedValueProperty(T* native_object_ptr, bool has_property_callback, const JSString& property_name) HAL_NOEXCEPT;
     static JSValue CreateJSError(const std::string& function_name, const std::string& location, JSObject js_object, const js_runtime_error& e);
     static JSValue CreateJSError(const std::string& function_name, JSObject js_object, const std::exception& e);
     static JSValue CreateJSError(const std::string& function_name, JSObject js_object, const std::string& what);
     static std::string GetJSExportComponentName(const std::string& function_name, const std::string& location = "");
+    static JSObjectRef MakeJSError(const JSContext& js_context, const std::string& message);
+    static void        SetJSErrorProperty(const JSContext& js_context, JSObjectRef error_ref, const JSString& property_name, const JSValue& property_value) HAL_NOEXCEPT;
     
     static JSExportClassDefinition<T> js_export_class_definition__;
-    static std::unordered_map<std::string, JSValue> constants_cache__;
-    static std::list<std::string>                   constants_cache_history__;
-    static std::uint32_t                            constants_cache_capacity__;
-    
-#undef HAL_DETAIL_JSEXPORTCLASS_LOCK_GUARD_STATIC
-#ifdef HAL_THREAD_SAFE
-    static std::recursive_mutex mutex_static__;
-#define HAL_DETAIL_JSEXPORTCLASS_LOCK_GUARD_STATIC std::lock_guard<std::recursive_mutex> lock_static(JSExportClass::mutex_static__)
-#else
-#define HAL_DETAIL_JSEXPORTCLASS_LOCK_GUARD_STATIC
-#endif  // HAL_THREAD_SAFE
+    static JSExportConstantCache      constants_cache__;
+    static JSExportNegativePropertyCache negative_property_cache__;
+    static JSExportHotPropertyNameCache  hot_property_name_cache__;
+    static JSExportDirtyList             dirty_list__;
+    static JSExportClassInfo          class_info__;
+    
+    // The class definition is copied into js_export_class_definition__
+    // exactly once, by the first JSExportClass constructed from a
+    // definition, and is immutable afterwards. The callbacks only read
+    // it, so neither they nor finalization take a class-wide lock.
+    static std::once_flag             js_export_class_definition_once__;
+    static std::atomic<bool>          js_export_class_definition_published__;
   };
 
-#ifdef HAL_THREAD_SAFE
   template<typename T>
-  std::recursive_mutex JSExportClass<T>::mutex_static__;
-#endif
+  std::once_flag JSExportClass<T>::js_export_class_definition_once__;
+  
+  template<typename T>
+  std::atomic<bool> JSExportClass<T>::js_export_class_definition_published__ { false };
   
   template<typename T>
   JSExportClassDefinition<T> JSExportClass<T>::js_export_class_definition__;
 
   template<typename T>
-  std::unordered_map<std::string, JSValue> JSExportClass<T>::constants_cache__;
+  JSExportConstantCache JSExportClass<T>::constants_cache__;
+
+  template<typename T>
+  JSExportNegativePropertyCache JSExportClass<T>::negative_property_cache__;
+
+  template<typename T>
+  JSExportHotPropertyNameCache JSExportClass<T>::hot_property_name_cache__;
 
   template<typename T>
-  std::list<std::string> JSExportClass<T>::constants_cache_history__;
+  JSExportDirtyList JSExportClass<T>::dirty_list__;
 
-  //
-  // Constants cache capacity
-  // Consider optimizing this based on memory consumption
-  //
   template<typename T>
-  std::uint32_t JSExportClass<T>::constants_cache_capacity__ = 16;
+  JSExportClassInfo JSExportClass<T>::class_info__;
+
+  template<typename T>
+  HAL_THREAD_LOCAL const JSArguments* JSExportClass<T>::constructor_arguments__ = nullptr;
+
+  template<typename T>
+  HAL_THREAD_LOCAL const JSContext* JSExportClass<T>::initializing_context__ = nullptr;
 
   template<typename T>
   JSExportClass<T>::JSExportClass() HAL_NOEXCEPT {
-    HAL_LOG_TRACE("JSExportClass<", typeid(T).name(), ">:: ctor 1 ", this);
+    HAL_LOG_TRACE("JSExportClass<", JSExportClassName<T>::get(), ">:: ctor 1 ", this);
   }
 
   template<typename T>
   JSExportClass<T>::JSExportClass(const JSExportClassDefinition<T>& js_export_class_definition) HAL_NOEXCEPT
   : JSClass(js_export_class_definition) {
-    HAL_DETAIL_JSEXPORTCLASS_LOCK_GUARD_STATIC;
-    HAL_LOG_TRACE("JSExportClass<", typeid(T).name(), ">:: ctor 2 ", this);
-    js_export_class_definition__ = js_export_class_definition;
+    HAL_LOG_TRACE("JSExportClass<", JSExportClassName<T>::get(), ">:: ctor 2 ", this);
+    bool published = false;
+    std::call_once(js_export_class_definition_once__, [this, &js_export_class_definition, &published]() {
+      js_export_class_definition__ = js_export_class_definition;
+      negative_property_cache__.set_capacity(js_export_class_definition.negative_property_cache_capacity__);
+      hot_property_name_cache__.set_threshold(js_export_class_definition.hot_property_name_threshold__);
+      class_info__.name = js_export_class_definition.get_name();
+      RegisterJSExportClassInfo(static_cast<JSClassRef>(*this), js_export_class_definition.js_class_definition__.parentClass, class_info__);
+      class_info__.instance_size = kJSExportNativeObjectHeaderSize + sizeof(T);
+      js_export_class_definition_published__.store(true, std::memory_order_release);
+      published = true;
+    });
+    
+    if (!published) {
+      HAL_LOG_WARN("JSExportClass<", JSExportClassName<T>::get(), ">:: ctor 2: class definition already published, ignoring the new one for ", this);
+    }
+    
     //js_export_class_definition__.Print();
   }
   
   template<typename T>
   JSExportClass<T>::~JSExportClass() HAL_NOEXCEPT {
-    HAL_LOG_TRACE("JSExportClass<", typeid(T).name(), ">:: dtor ", this);
+    HAL_LOG_TRACE("JSExportClass<", JSExportClassName<T>::get(), ">:: dtor ", this);
   }
   
   template<typename T>
@@ -208,142 +471,681 @@ namespace HAL { namespace detail {
   template<typename T>
   void JSExportClass<T>::JSObjectInitializeCallback(JSContextRef context_ref, JSObjectRef object_ref) {
     
-    JSObject js_object(JSContext(context_ref), object_ref);
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::Initialize: JSContextRef = ", context_ref, ", JSObjectRef = ", object_ref);
+    assert(js_export_class_definition_published__.load(std::memory_order_acquire));
+    
+    const auto initializing_context = initializing_context__;
+    const bool is_initializing_context = initializing_context && static_cast<JSContextRef>(*initializing_context) == context_ref;
+    JSObject js_object(is_initializing_context ? *initializing_context : JSContext(context_ref), object_ref);
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::Initialize: JSContextRef = ", context_ref, ", JSObjectRef = ", object_ref);
 
-    const auto previous_native_object_ptr = static_cast<JSExport<T>*>(js_object.GetPrivate());
-    const auto native_object_ptr          = new T(js_object.get_context());
+    // The previous native object, if any, was created by the
+    // initializer of a parent class.
+    const auto previous_native_object_ptr = js_object.GetPrivate();
+    const auto native_object_ptr          = CreateNativeObject(js_object.get_context(), JSExportHasArgumentsConstructor<T>());
     
     if (previous_native_object_ptr != nullptr) {
-      HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::Initialize: replace ", previous_native_object_ptr, " with ", native_object_ptr, " for ", object_ref);
-      delete previous_native_object_ptr;
+      HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::Initialize: replace ", previous_native_object_ptr, " with ", native_object_ptr, " for ", object_ref);
+      DestroyNativeObject(previous_native_object_ptr);
     }
     
-    const bool result = js_object.SetPrivate(native_object_ptr);
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::Initialize: private data set to ", js_object.GetPrivate(), " for ", object_ref);
+    // Exported objects keep an intrusive back-pointer to their
+    // JSObjectRef instead of being recorded in the private data map.
+    const bool result = JSObjectSetPrivate(object_ref, native_object_ptr);
+    SetJSExportObjectRef(native_object_ptr, object_ref);
+    GetNativeObjectHeader(native_object_ptr) -> class_info = &class_info__;
+    SetJSExportObjectClassInfo(native_object_ptr, &class_info__);
+    AddJSExportClassInstance(class_info__);
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::Initialize: private data set to ", js_object.GetPrivate(), " for ", object_ref);
     
     native_object_ptr->postInitialize(js_object);
     
+    if (js_export_class_definition__.pin_constants__) {
+      PinConstants(context_ref, object_ref, *native_object_ptr);
+    }
+    
+    if (js_export_class_definition__.iterator_callback__) {
+      InstallIterator(js_object.get_context(), object_ref);
+    }
+    
     assert(result);
   }
   
   template<typename T>
-  void JSExportClass<T>::JSObjectFinalizeCallback(JSObjectRef object_ref) {
-    HAL_DETAIL_JSEXPORTCLASS_LOCK_GUARD_STATIC;
+  void JSExportClass<T>::PinConstants(JSContextRef context_ref, JSObjectRef object_ref, T& native_object) {
+    const auto& entries = js_export_class_definition__.named_value_property_callback_list__;
+    const auto  first   = std::find_if(entries.begin(), entries.end(), [](const JSExportNamedValuePropertyEntry<T>& entry) {
+      return entry.constant;
+    });
+    
+    if (first == entries.end()) {
+      return;
+    }
+    
+    // Constants go on the shared prototype so they are evaluated once
+    // per JSContext. Without an automatic prototype every object gets
+    // its own copy.
+    auto target_ref = object_ref;
+    if (!(js_export_class_definition__.js_class_definition__.attributes & kJSClassAttributeNoAutomaticPrototype)) {
+      const auto prototype_ref = JSObjectGetPrototype(context_ref, object_ref);
+      if (JSValueIsObject(context_ref, prototype_ref)) {
+        target_ref = JSValueToObject(context_ref, prototype_ref, nullptr);
+      }
+    }
+    
+    // The constants are all installed together, so the first one
+    // tells whether the prototype was already pinned in this JSContext.
+    if (JSObjectHasProperty(context_ref, target_ref, static_cast<JSStringRef>(JSString(first -> name)))) {
+      return;
+    }
+    
+    for (auto position = first; position != entries.end(); ++position) {
+      const auto& entry = *position;
+      if (!entry.constant) {
+        continue;
+      }
+      
+      try {
+        const auto js_value   = entry.callback.get_callback()(native_object);
+        const auto attributes = ToJSPropertyAttributes(entry.callback.get_attribute_set()) | kJSPropertyAttributeReadOnly | kJSPropertyAttributeDontDelete;
+        
+        JSValueRef exception { nullptr };
+        JSObjectSetProperty(context_ref, target_ref, static_cast<JSStringRef>(JSString(entry.name)), static_cast<JSValueRef>(js_value), attributes, &exception);
+        if (exception) {
+          HAL_LOG_ERROR("JSExportClass<", JSExportClassName<T>::get(), ">::PinConstants: failed to pin ", entry.name);
+        }
+      } catch (const std::exception& e) {
+        HAL_LOG_ERROR("JSExportClass<", JSExportClassName<T>::get(), ">::PinConstants: failed to pin ", entry.name, ": ", e.what());
+      }
+    }
+  }
+  
+  template<typename T>
+  void JSExportClass<T>::InstallIterator(const JSContext& js_context, JSObjectRef object_ref) {
+    const auto context_ref = static_cast<JSContextRef>(js_context);
+    
+    // Like constants, Symbol.iterator goes on the shared prototype, so
+    // it is installed once per JSContext.
+    auto target_ref = object_ref;
+    if (!(js_export_class_definition__.js_class_definition__.attributes & kJSClassAttributeNoAutomaticPrototype)) {
+      const auto prototype_ref = JSObjectGetPrototype(context_ref, object_ref);
+      if (JSValueIsObject(context_ref, prototype_ref)) {
+        target_ref = JSValueToObject(context_ref, prototype_ref, nullptr);
+      }
+    }
     
-    auto native_object_ptr = static_cast<JSExport<T>*>(JSObjectGetPrivate(object_ref));
+    // The marker records which class installed the iterator. The
+    // initializers of a derived object run from the root class down,
+    // so a class replaces only an iterator installed by one of its
+    // ancestors, and leaves a derived class's iterator alone.
+    static const JSString marker_name("@@HAL.iterator");
+    const auto get_class_id = [](const JSExportClassInfo* class_info) {
+      return static_cast<double>(reinterpret_cast<std::uintptr_t>(class_info));
+    };
+    const auto class_id   = get_class_id(&class_info__);
+    const auto marker_ref = JSObjectGetProperty(context_ref, target_ref, static_cast<JSStringRef>(marker_name), nullptr);
+    if (marker_ref && JSValueIsNumber(context_ref, marker_ref)) {
+      const auto marker_id = JSValueToNumber(context_ref, marker_ref, nullptr);
+      const auto ancestors_end = class_info__.display.begin() + class_info__.depth;
+      if (std::none_of(class_info__.display.begin(), ancestors_end, [&](const JSExportClassInfo* ancestor) { return get_class_id(ancestor) == marker_id; })) {
+        return;
+      }
+    }
+    
+    const auto iterator_callback = js_export_class_definition__.iterator_callback__;
+    const auto batch_size        = js_export_class_definition__.iterator_batch_size__;
+    
+    // begin is called with the iterated object as this, and returns the
+    // function that fills the next batch. That returns the batch and
+    // whether the native cursor is exhausted, since a batch may be
+    // short without being the last. The iterator holds on to the
+    // object for as long as it may ask for a batch. Once the native
+    // cursor is exhausted it is released, and every later batch is
+    // empty.
+    const auto begin = js_context.CreateFunction(JSFunctionArgumentsCallback([iterator_callback, batch_size](const JSArguments&, JSObject& this_object) -> JSValue {
+      const auto native_object_ptr = this_object.template GetPrivateAs<T>();
+      if (!native_object_ptr) {
+        ThrowRuntimeError(GetJSExportComponentName("Iterator"), "Symbol.iterator was called on an object that isn't a " + class_info__.name);
+      }
+      
+      const auto next_batch = std::make_shared<JSExportNextBatch>(iterator_callback(*native_object_ptr));
+      return static_cast<JSValue>(this_object.get_context().CreateFunction(JSFunctionArgumentsCallback([next_batch, batch_size](const JSArguments&, JSObject& this_object) -> JSValue {
+        std::vector<JSValue> batch;
+        if (*next_batch) {
+          batch.reserve(batch_size);
+          if (!(*next_batch)(batch, batch_size)) {
+            *next_batch = nullptr;
+          }
+        }
+        const auto js_context = this_object.get_context();
+        auto result = js_context.CreateObject();
+        result.SetProperty(JSAtoms::values, js_context.CreateArray(batch));
+        result.SetProperty(JSAtoms::done, js_context.CreateBoolean(!*next_batch));
+        return static_cast<JSValue>(result);
+      })));
+    }));
+    
+    // The C API can't key a property by a symbol, so the iterator
+    // protocol is implemented in JavaScript around the native batches.
+    static const JSString install_body(
+      "Object.defineProperty(prototype, Symbol.iterator, { configurable: true, writable: true, value: function() {"
+      "  var self = this, next_batch = begin.call(self), batch = [], index = 0, done = false;"
+      "  var iterator = {"
+      "    next: function() {"
+      "      while (index === batch.length) {"
+      "        if (done) { return { value: undefined, done: true }; }"
+      "        var result = next_batch.call(self);"
+      "        batch = result.values; index = 0; done = result.done;"
+      "      }"
+      "      return { value: batch[index++], done: false };"
+      "    },"
+      "    return: function(value) { done = true; batch = []; index = 0; next_batch = self = null; return { value: value, done: true }; }"
+      "  };"
+      "  iterator[Symbol.iterator] = function() { return this; };"
+      "  return iterator;"
+      "} });"
+      "Object.defineProperty(prototype, marker, { configurable: true, value: id });");
+    
+    try {
+      auto install = js_context.CreateFunction(install_body, {"prototype", "begin", "marker", "id"});
+      const std::vector<JSValue> arguments {
+        static_cast<JSValue>(JSObject::FindJSObject(context_ref, target_ref)),
+        static_cast<JSValue>(begin),
+        js_context.CreateString(marker_name),
+        js_context.CreateNumber(class_id)
+      };
+      install(arguments, js_context.get_global_object());
+    } catch (const std::exception& e) {
+      HAL_LOG_ERROR("JSExportClass<", JSExportClassName<T>::get(), ">::InstallIterator: failed to install Symbol.iterator: ", e.what());
+    }
+  }
+  
+  template<typename T>
+  void JSExportClass<T>::JSObjectFinalizeCallback(JSObjectRef object_ref) {
+    // The native object belongs to this JSObject alone, so
+    // finalization needs no lock.
+    HAL_TRACE_SCOPE("JSExport", "JSObjectFinalize", class_info__.name.c_str());
+    auto native_object_ptr = JSObjectGetPrivate(object_ref);
     
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::Finalize: delete native object ", native_object_ptr, " for ", object_ref);
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::Finalize: delete native object ", native_object_ptr, " for ", object_ref);
     if (native_object_ptr) {
-      //delete reinterpret_cast<T*>(native_object_ptr);
-      delete native_object_ptr;
+      // JavaScriptCore finalizes the object for each class of its
+      // chain, and only the first finds the native object.
+      HAL_CALLBACK_LATENCY_TIMER(class_info__, Finalize);
+      class_info__.finalized_count.fetch_add(1, std::memory_order_relaxed);
+      SetJSExportObjectRef(static_cast<T*>(native_object_ptr), nullptr);
       JSObjectSetPrivate(object_ref, nullptr);
+      
+      // The cached values belong to this JSObject, and a recycled
+      // native object would otherwise return them for the next one.
+      InvalidateCachedValues(*static_cast<T*>(native_object_ptr));
+      
+      // Wrap must not find this JSObject once it is gone.
+      GetWrapperEntry(*static_cast<T*>(native_object_ptr)).Clear();
+      
+      // Nor DrainDirty, which would otherwise reconcile a recycled or
+      // deferred native object with writes to this JSObject, nor a weak
+      // handle.
+      auto& js_export = static_cast<JSExport<T>&>(*static_cast<T*>(native_object_ptr));
+      ForgetDirty(js_export.dirty_set__);
+      js_export.weak_slot__.Release();
+      if (js_export_class_definition__.recycle_capacity__ > 0 && RecycleNativeObject(static_cast<T*>(native_object_ptr), JSExportCanRecycle<T>())) {
+        HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::Finalize: recycled native object ", native_object_ptr);
+      } else if (js_export_class_definition__.deferred_finalization__) {
+        DeferNativeObjectDestruction(native_object_ptr);
+      } else {
+        DestroyNativeObject(native_object_ptr);
+      }
     }
   }
   
   template<typename T>
   void JSExportClass<T>::EvictCache() {
-    assert(!constants_cache_history__.empty());
-    const auto least_cache_key = constants_cache_history__.front();
-    constants_cache_history__.pop_front();
-    constants_cache__.erase(least_cache_key);
+    assert(constants_cache__.size() > 0);
+    constants_cache__.EvictLeastRecentlyUsed();
+  }
+
+  template<typename T>
+  void JSExportClass<T>::EvictCache(const JSContext& js_context) {
+    constants_cache__.Clear(static_cast<JSContextRef>(js_context));
+  }
+
+  template<typename T>
+  void JSExportClass<T>::InvalidateCachedValue(T& native_object, const std::string& property_name) {
+    for (const auto& entry : js_export_class_definition__.named_value_property_callback_list__) {
+      if (entry.cached && entry.name == property_name) {
+        GetValueCache(native_object, entry).Erase(entry.cache_index);
+        return;
+      }
+    }
+    ThrowInvalidArgument(GetJSExportComponentName("Invalidate"), "There is no cached value property " + property_name);
+  }
+  
+  template<typename T>
+  void JSExportClass<T>::InvalidateCachedValues(T& native_object) HAL_NOEXCEPT {
+    GetValueCache(native_object).Clear();
+    for (const auto& entry : js_export_class_definition__.named_value_property_callback_list__) {
+      if (entry.value_cache) {
+        entry.value_cache(native_object).Clear();
+      }
+    }
+  }
+
+  template<typename T>
+  std::size_t JSExportClass<T>::FindDirectNamedValueProperty(T* native_object_ptr, bool has_property_callback, const JSString& property_name) HAL_NOEXCEPT {
+    // An object of a derived class may override the property, and a
+    // GetProperty or SetProperty callback is called before it.
+    if (native_object_ptr == nullptr || has_property_callback || GetNativeObjectHeader(native_object_ptr) -> class_info != &class_info__) {
+      return JSExportNameTable::npos;
+    }
+    return js_export_class_definition__.named_value_property_name_table__.Find(static_cast<JSStringRef>(property_name));
+  }
+  
+  template<typename T>
+  JSValue JSExportClass<T>::GetNamed(const JSObject& js_object, const JSString& property_name) {
+    const auto& definition        = js_export_class_definition__;
+    const auto  native_object_ptr = js_object.template GetPrivateAs<T>();
+    const auto  index             = FindDirectNamedValueProperty(native_object_ptr, definition.has_property_callback__ || definition.get_property_callback__, property_name);
+    if (index == JSExportNameTable::npos) {
+      return js_object.GetProperty(property_name);
+    }
+    
+    const auto& entry = definition.named_value_property_callback_list__[index];
+    if (!entry.callback.get_callback()) {
+      return js_object.GetProperty(property_name);
+    }
+    return GetNamedValue(entry, static_cast<JSContextRef>(js_object.get_context()), static_cast<JSObjectRef>(js_object), native_object_ptr);
+  }
+  
+  template<typename T>
+  bool JSExportClass<T>::SetNamed(JSObject& js_object, const JSString& property_name, const JSValue& js_value) {
+    const auto& definition        = js_export_class_definition__;
+    const auto  native_object_ptr = js_object.template GetPrivateAs<T>();
+    const auto  index             = FindDirectNamedValueProperty(native_object_ptr, definition.has_property_callback__ || definition.set_property_callback__, property_name);
+    if (index == JSExportNameTable::npos) {
+      js_object.SetProperty(property_name, js_value);
+      return true;
+    }
+    
+    const auto& entry = definition.named_value_property_callback_list__[index];
+    if (!entry.callback.set_callback()) {
+      return false;
+    }
+    return SetNamedValue(entry, *native_object_ptr, js_value);
+  }
+  
+  template<typename T>
+  JSValue JSExportClass<T>::GetNamedValue(const JSExportNamedValuePropertyEntry<T>& entry, JSContextRef context_ref, JSObjectRef object_ref, T* native_object_ptr) {
+    // check if it's a constant, and if it's cached for this JSContext
+    // we just use it
+    if (entry.constant) {
+      const auto cached_value = constants_cache__.Find(context_ref, entry.index);
+      if (cached_value) {
+        HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::GetNamedProperty: constant cache found for ", object_ref, ".", entry.name);
+        return *cached_value;
+      }
+    }
+    
+    if (!native_object_ptr) {
+      native_object_ptr = RequireNativeObject(context_ref, object_ref, "GetNamedProperty");
+    }
+    
+    // A cached value belongs to this object alone.
+    if (entry.cached) {
+      const auto cached_value = GetValueCache(*native_object_ptr, entry).Find(entry.cache_index);
+      if (cached_value) {
+        return *cached_value;
+      }
+    }
+    
+    const auto& callback = entry.callback.get_callback();
+    const auto  result   = callback(*native_object_ptr);
+    
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::GetNamedProperty: result = ", to_string(result), " for ", object_ref, ".", entry.name);
+    
+    // make sure to cache the result if it's a constant
+    if (entry.constant) {
+      constants_cache__.Insert(context_ref, entry.index, result);
+    } else if (entry.cached) {
+      GetValueCache(*native_object_ptr, entry).Insert(entry.cache_index, result);
+    }
+    return result;
+  }
+  
+  template<typename T>
+  bool JSExportClass<T>::SetNamedValue(const JSExportNamedValuePropertyEntry<T>& entry, T& native_object, const JSValue& js_value) {
+    // Invalidate after the setter, even if it throws, so that a value
+    // read by the setter itself isn't left cached.
+    struct InvalidateOnReturn {
+      ~InvalidateOnReturn() {
+        if (value_cache) {
+          value_cache -> Erase(index);
+        }
+      }
+      JSExportValueCache* value_cache;
+      std::size_t         index;
+    } invalidate_on_return { entry.cached ? &GetValueCache(native_object, entry) : nullptr, entry.cache_index };
+    
+    const auto& callback = entry.callback.set_callback();
+    const auto  result   = callback(native_object, js_value);
+    if (result && js_export_class_definition__.track_dirty__) {
+      MarkDirty(native_object, entry.index);
+    }
+    return result;
+  }
+  
+  template<typename T>
+  JSExportValueCache& JSExportClass<T>::GetValueCache(T& native_object) HAL_NOEXCEPT {
+    return static_cast<JSExport<T>&>(native_object).value_cache__;
+  }
+  
+  template<typename T>
+  JSExportValueCache& JSExportClass<T>::GetValueCache(T& native_object, const JSExportNamedValuePropertyEntry<T>& entry) HAL_NOEXCEPT {
+    return entry.value_cache ? entry.value_cache(native_object) : GetValueCache(native_object);
+  }
+
+  template<typename T>
+  void JSExportClass<T>::MarkDirty(T& native_object, std::size_t index) {
+    auto& js_export = static_cast<JSExport<T>&>(native_object);
+    dirty_list__.Mark(js_export.dirty_set__, &js_export, index);
+  }
+  
+  template<typename T>
+  void JSExportClass<T>::ForgetDirty(JSExportDirtySet& dirty_set) HAL_NOEXCEPT {
+    if (dirty_set.is_dirty()) {
+      dirty_list__.Remove(dirty_set);
+    }
+  }
+  
+  template<typename T>
+  std::size_t JSExportClass<T>::DrainDirty(const std::function<void(T&, const std::vector<std::string>&)>& callback) {
+    const auto& entries = js_export_class_definition__.named_value_property_callback_list__;
+    
+    // An object is popped before its callback, so one that is written
+    // by a callback is queued again for the next drain rather than
+    // visited twice, and one destroyed by a callback is already gone.
+    std::vector<std::size_t> indexes;
+    std::vector<std::string> property_names;
+    std::size_t              count = 0;
+    for (auto remaining = dirty_list__.size(); remaining > 0; --remaining) {
+      const auto js_export_ptr = static_cast<JSExport<T>*>(dirty_list__.Pop(indexes));
+      if (!js_export_ptr) {
+        break;
+      }
+      property_names.clear();
+      for (const auto index : indexes) {
+        property_names.push_back(entries[index].name);
+      }
+      indexes.clear();
+      ++count;
+      callback(static_cast<T&>(*js_export_ptr), property_names);
+    }
+    return count;
+  }
+  
+  template<typename T>
+  JSExportSlotReference JSExportClass<T>::GetWeakSlot(T& native_object, JSContextRef context_ref, JSObjectRef object_ref) {
+    // The finalizer that releases the slot is that of the class the
+    // header records.
+    if (GetNativeObjectHeader(JSObjectGetPrivate(object_ref)) -> class_info != &class_info__) {
+      return JSExportSlotReference();
+    }
+    
+    JSExportSlotValue value;
+    value.native_object_ptr     = &native_object;
+    value.js_global_context_ref = JSContextGetGlobalContext(context_ref);
+    value.js_object_ref         = object_ref;
+    return static_cast<JSExport<T>&>(native_object).weak_slot__.Get(value);
+  }
+  
+  template<typename T>
+  T* JSExportClass<T>::RequireNativeObject(JSContextRef context_ref, JSObjectRef object_ref, const char* function_name) {
+    // As in JSObject::GetPrivateAs, objects of other JSClasses, such
+    // as the this of f.call({}), may have private data without a
+    // native object header, so the JSClass is checked first. The
+    // private data is null for an object that was finalized, or that
+    // is of T's prototype chain without being a T, such as the
+    // prototype itself, and its header has no class once it is
+    // recycled.
+    void* native_object_ptr = nullptr;
+    if (JSValueIsObjectOfClass(context_ref, object_ref, static_cast<JSClassRef>(JSExport<T>::Class()))) {
+      native_object_ptr = JSObjectGetPrivate(object_ref);
+    }
+    const auto native_class_info = native_object_ptr ? GetNativeObjectHeader(native_object_ptr) -> class_info : nullptr;
+    if (!native_class_info || !native_class_info -> IsSubclassOf(class_info__)) {
+      ThrowRuntimeError(GetJSExportComponentName(function_name), "The object is not a live " + class_info__.name + ".");
+      return nullptr;
+    }
+    return static_cast<T*>(native_object_ptr);
+  }
+  
+  template<typename T>
+  std::size_t JSExportClass<T>::GetDirtyCount() {
+    return dirty_list__.size();
+  }
+  
+  template<typename T>
+  JSExportWrapperEntry& JSExportClass<T>::GetWrapperEntry(T& native_object) HAL_NOEXCEPT {
+    return static_cast<JSExport<T>&>(native_object).wrapper_entry__;
   }
 
   template<typename T>
   void JSExportClass<T>::EvictAllCache() {
-    constants_cache_history__.clear();
-    constants_cache__.clear();    
+    constants_cache__.Clear();
   }
 
   template<typename T>
   void JSExportClass<T>::ResizeCache(const std::uint32_t& maxSize) {
-    constants_cache_history__.clear();
-    constants_cache__.clear();    
-    constants_cache_capacity__ = maxSize;
+    constants_cache__.set_capacity(maxSize);
   }
 
   template<typename T>
   std::vector<std::string> JSExportClass<T>::GetCachedKeys() {
     std::vector<std::string> keys;
-    for (auto it = constants_cache_history__.rbegin(); it != constants_cache_history__.rend(); ++it) {
-      keys.push_back(*it);
+    for (const auto index : constants_cache__.GetIndexes()) {
+      keys.push_back(js_export_class_definition__.named_value_property_callback_list__[index].name);
     }
     return keys;
   }
 
+  template<typename T>
+  JSExportConstantCache::Statistics JSExportClass<T>::GetCacheStatistics() {
+    return constants_cache__.get_statistics();
+  }
+
+  template<typename T>
+  JSExportClassStatistics JSExportClass<T>::GetClassStatistics() HAL_NOEXCEPT {
+    return GetJSExportClassStatistics(class_info__);
+  }
+
+  template<typename T>
+  void JSExportClass<T>::SetClassBudget(const JSExportClassBudget& budget) {
+    SetJSExportClassBudget(class_info__, budget);
+  }
+
+  template<typename T>
+  std::size_t JSExportClass<T>::PurgeRecycled() HAL_NOEXCEPT {
+    return PurgeRecycledNativeObjects(class_info__);
+  }
+
+  template<typename T>
+  template<typename Init>
+  JSArray JSExportClass<T>::CreateObjects(const JSContext& js_context, std::size_t count, Init&& init) {
+    const auto context_ref = static_cast<JSContextRef>(js_context);
+    const auto class_ref   = static_cast<JSClassRef>(JSExport<T>::Class());
+    auto       js_array    = js_context.CreateArray();
+    const auto array_ref   = static_cast<JSObjectRef>(js_array);
+    
+    struct InitializingContextGuard {
+      const JSContext* previous_context;
+      ~InitializingContextGuard() {
+        initializing_context__ = previous_context;
+      }
+    } guard { initializing_context__ };
+    
+    initializing_context__ = &js_context;
+    
+    // Each object goes into the Array before init runs so that it is
+    // reachable if init triggers a garbage collection.
+    for (std::size_t index = 0; index < count; ++index) {
+      const auto object_ref = JSObjectMake(context_ref, class_ref, nullptr);
+      JSObjectSetPropertyAtIndex(context_ref, array_ref, static_cast<unsigned>(index), object_ref, nullptr);
+      init(*static_cast<T*>(JSObjectGetPrivate(object_ref)), index);
+    }
+    
+    return js_array;
+  }
+
+  template<typename T>
+  std::size_t JSExportClass<T>::GetRecycledCount() HAL_NOEXCEPT {
+    return GetRecycledNativeObjectCount(class_info__);
+  }
+
+  template<typename T>
+  void JSExportClass<T>::InvalidateNegativePropertyCache() {
+    negative_property_cache__.Clear();
+  }
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+  template<typename T>
+  const JSLatencyHistogram& JSExportClass<T>::GetCallbackLatency(JSExportCallbackKind kind) HAL_NOEXCEPT {
+    return class_info__.callback_latency[static_cast<std::size_t>(kind)];
+  }
+#endif
+
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+  template<typename T>
+  std::vector<JSPropertyProfileEntry> JSExportClass<T>::GetPropertyProfile() {
+    std::vector<JSPropertyProfileEntry> entries;
+    if (js_export_class_definition_published__.load(std::memory_order_acquire)) {
+      for (const auto& entry : js_export_class_definition__.named_value_property_callback_list__) {
+        entry.callback.get_profile().AppendTo(entry.name, entries);
+      }
+      for (const auto& entry : js_export_class_definition__.named_function_property_callback_list__) {
+        entry.callback.get_profile().AppendTo(entry.name, entries);
+      }
+    }
+    SortPropertyProfile(entries);
+    return entries;
+  }
+
+  template<typename T>
+  void JSExportClass<T>::ResetPropertyProfile() HAL_NOEXCEPT {
+    if (js_export_class_definition_published__.load(std::memory_order_acquire)) {
+      for (const auto& entry : js_export_class_definition__.named_value_property_callback_list__) {
+        entry.callback.get_profile().Reset();
+      }
+      for (const auto& entry : js_export_class_definition__.named_function_property_callback_list__) {
+        entry.callback.get_profile().Reset();
+      }
+    }
+  }
+#endif
+
+  // Fill tables with the addresses of JSExportClass<T>'s first N
+  // named value getter and setter trampolines.
+  template<typename T, std::size_t N>
+  struct JSExportNamedValueTrampolines {
+    static void Fill(::JSObjectGetPropertyCallback* getters, ::JSObjectSetPropertyCallback* setters) HAL_NOEXCEPT {
+      JSExportNamedValueTrampolines<T, N - 1>::Fill(getters, setters);
+      getters[N - 1] = &JSExportClass<T>::template GetNamedValuePropertyCallbackAt<N - 1>;
+      setters[N - 1] = &JSExportClass<T>::template SetNamedValuePropertyCallbackAt<N - 1>;
+    }
+  };
+  
+  template<typename T>
+  struct JSExportNamedValueTrampolines<T, 0> {
+    static void Fill(::JSObjectGetPropertyCallback*, ::JSObjectSetPropertyCallback*) HAL_NOEXCEPT {
+    }
+  };
+  
+  template<typename T>
+  struct JSExportNamedValueTrampolineTable {
+    JSExportNamedValueTrampolineTable() HAL_NOEXCEPT {
+      JSExportNamedValueTrampolines<T, JSExportClass<T>::kNamedValueTrampolineCount>::Fill(getters, setters);
+    }
+    ::JSObjectGetPropertyCallback getters[JSExportClass<T>::kNamedValueTrampolineCount];
+    ::JSObjectSetPropertyCallback setters[JSExportClass<T>::kNamedValueTrampolineCount];
+  };
+  
+  template<typename T>
+  ::JSObjectGetPropertyCallback JSExportClass<T>::GetNamedValueGetPropertyCallback(std::size_t index) HAL_NOEXCEPT {
+    static const JSExportNamedValueTrampolineTable<T> table;
+    return index < kNamedValueTrampolineCount ? table.getters[index] : GetNamedValuePropertyCallback;
+  }
+  
+  template<typename T>
+  ::JSObjectSetPropertyCallback JSExportClass<T>::GetNamedValueSetPropertyCallback(std::size_t index) HAL_NOEXCEPT {
+    static const JSExportNamedValueTrampolineTable<T> table;
+    return index < kNamedValueTrampolineCount ? table.setters[index] : SetNamedValuePropertyCallback;
+  }
+  
+  template<typename T>
+  template<std::size_t I>
+  JSValueRef JSExportClass<T>::GetNamedValuePropertyCallbackAt(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef, JSValueRef* exception) {
+    return GetNamedValueProperty(js_export_class_definition__.named_value_property_callback_list__[I], context_ref, object_ref, exception);
+  }
+  
+  template<typename T>
+  template<std::size_t I>
+  bool JSExportClass<T>::SetNamedValuePropertyCallbackAt(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef, JSValueRef value_ref, JSValueRef* exception) {
+    return SetNamedValueProperty(js_export_class_definition__.named_value_property_callback_list__[I], context_ref, object_ref, value_ref, exception);
+  }
+  
   template<typename T>
   JSValueRef JSExportClass<T>::GetNamedValuePropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception) try {
+    // Only reached for properties beyond the trampoline table.
+    const auto index = js_export_class_definition__.named_value_property_name_table__.Find(property_name_ref);
+    
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::GetNamedProperty: callback found = ", index != JSExportNameTable::npos, " for ", object_ref, ".", static_cast<std::string>(JSString(property_name_ref)));
+    
+    // precondition
+    assert(index != JSExportNameTable::npos);
     
+    return GetNamedValueProperty(js_export_class_definition__.named_value_property_callback_list__[index], context_ref, object_ref, exception);
+  } catch (const std::exception& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("GetNamedProperty", js_object, e));
+    return nullptr;
+  } catch (...) {
     JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("GetNamedProperty", js_object, "unknown exception"));
+    return nullptr;
+  }
+  
+  template<typename T>
+  bool JSExportClass<T>::SetNamedValuePropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception) try {
+    // Only reached for properties beyond the trampoline table.
+    const auto index = js_export_class_definition__.named_value_property_name_table__.Find(property_name_ref);
     
-    const std::string property_name = JSString(property_name_ref);
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::SetNamedProperty: callback found = ", index != JSExportNameTable::npos, " for ", object_ref, ".", static_cast<std::string>(JSString(property_name_ref)));
     
-    const auto callback_position = js_export_class_definition__.named_value_property_callback_map__.find(property_name);
-    const bool callback_found    = callback_position != js_export_class_definition__.named_value_property_callback_map__.end();
+    // precondition
+    assert(index != JSExportNameTable::npos);
     
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::GetNamedProperty: callback found = ", callback_found, " for ", to_string(js_object), ".", property_name);
+    return SetNamedValueProperty(js_export_class_definition__.named_value_property_callback_list__[index], context_ref, object_ref, value_ref, exception);
+  } catch (const std::exception& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("SetNamedProperty", js_object, e));
+    return false;
+  } catch (...) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("SetNamedProperty", js_object, "unknown exception"));
+    return false;
+  }
+  
+  template<typename T>
+  JSValueRef JSExportClass<T>::GetNamedValueProperty(const JSExportNamedValuePropertyEntry<T>& entry, JSContextRef context_ref, JSObjectRef object_ref, JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, GetNamedValueProperty);
+    HAL_TRACE_SCOPE("JSExport", "GetNamedValueProperty", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "GetNamedValueProperty");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(GetNamedValueProperty, class_info__.name.c_str(), entry.name.c_str(), nullptr, context_ref, 0, nullptr);
+    HAL_PROPERTY_PROFILE_TIMER(entry.callback, Get);
     
-    // precondition
-    assert(callback_found);
+    const auto& property_name = entry.name;
     
     try {
-
-      // check if it's a constant
-      const auto constant_position = js_export_class_definition__.named_constants__.find(property_name);
-      const bool constant_found    = constant_position != js_export_class_definition__.named_constants__.end();
-      if (constant_found) {
-
-        HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::GetNamedProperty: constant found = ", constant_found, " for ", to_string(js_object), ".", property_name);
-
-        // check if it's cached
-        const auto cache_position = constants_cache__.find(property_name);
-        const bool cache_found    = cache_position != constants_cache__.end();
-
-        // if it's cached, we just use it
-        if (cache_found) {
-          HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::GetNamedProperty: constant cache found = ", constant_found, " for ", to_string(js_object), ".", property_name);
-
-          //
-          // update LRU cache access history
-          //
-          const auto cache_history_position = std::find(constants_cache_history__.begin(), constants_cache_history__.end(), property_name);
-          assert(cache_history_position != constants_cache_history__.end());
-          constants_cache_history__.splice(constants_cache_history__.end(), constants_cache_history__, cache_history_position);
-
-          return static_cast<JSValueRef>(constants_cache__.at(property_name));
-        } 
-      }
-
-      auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-      const auto callback          = (callback_position -> second).get_callback();
-      const auto result            = callback(*native_object_ptr);
-      
-      HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::GetNamedProperty: result = ", to_string(result), " for ", to_string(js_object), ".", property_name);
-
-      // make sure to cache the result if it's a constant
-      if (constant_found) {
-        constants_cache__.emplace(property_name, result);
-
-        //
-        // create LRU cache access history
-        //
-        const auto cache_history_position = std::find(constants_cache_history__.begin(), constants_cache_history__.end(), property_name);
-        // make sure it's called only when cache misses
-        assert(cache_history_position == constants_cache_history__.end());
-        //
-        // check the capacity and evict when necessary
-        // this only caches up to constants_cache_capacity__ entries
-        // consider optimizing this based on memory consumption
-        //
-        if (constants_cache_history__.size() >= constants_cache_capacity__) {
-          EvictCache();
-        }
-
-        constants_cache_history__.insert(constants_cache_history__.end(), property_name);
-      }
-      
-      return static_cast<JSValueRef>(result);
-
+      return static_cast<JSValueRef>(GetNamedValue(entry, context_ref, object_ref, nullptr));
     } catch (const js_runtime_error& e) {
       JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
       *exception = static_cast<JSValueRef>(CreateJSError("GetNamedProperty", property_name, js_object, e));
@@ -361,27 +1163,24 @@ namespace HAL { namespace detail {
   }
   
   template<typename T>
-  bool JSExportClass<T>::SetNamedValuePropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception) try {
-    
-    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
-    JSValue  js_value(js_object.get_context(), value_ref);
+  bool JSExportClass<T>::SetNamedValueProperty(const JSExportNamedValuePropertyEntry<T>& entry, JSContextRef context_ref, JSObjectRef object_ref, JSValueRef value_ref, JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, SetNamedValueProperty);
+    HAL_TRACE_SCOPE("JSExport", "SetNamedValueProperty", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "SetNamedValueProperty");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(SetNamedValueProperty, class_info__.name.c_str(), entry.name.c_str(), nullptr, context_ref, 1, &value_ref);
+    HAL_PROPERTY_PROFILE_TIMER(entry.callback, Set);
     
-    const std::string property_name = JSString(property_name_ref);
+    JSObjectView js_object(context_ref, object_ref);
+    JSValue      js_value(JSContext(context_ref), value_ref);
     
-    const auto callback_position = js_export_class_definition__.named_value_property_callback_map__.find(property_name);
-    const bool callback_found    = callback_position != js_export_class_definition__.named_value_property_callback_map__.end();
-    
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::SetNamedProperty: callback found = ", callback_found, " for ", to_string(js_object), ".", property_name);
-    
-    // precondition
-    assert(callback_found);
+    const auto& property_name = entry.name;
     
     try {
-      auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-      const auto callback    = (callback_position -> second).set_callback();
-      const auto result      = callback(*native_object_ptr, js_value);
+      const auto native_object_ptr = RequireNativeObject(context_ref, object_ref, "SetNamedProperty");
+      const auto result            = SetNamedValue(entry, *native_object_ptr, js_value);
       
-      HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::SetNamedProperty: result = ", result, " for ", to_string(js_object), ".", property_name);
+      HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::SetNamedProperty: result = ", result, " for ", object_ref, ".", property_name);
       
       return result;
 
@@ -402,51 +1201,202 @@ namespace HAL { namespace detail {
   }
   
   template<typename T>
-  JSValueRef JSExportClass<T>::CallNamedFunctionCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) try {
-    // to_string(js_object) produces this text:
-    //
-    // function sayHello() {
-    //     [native code]
-    // }
-    //
-    // So this is the regular expression we use to determing the
-    // function's name for lookup.
-    static std::regex regex("^function\\s+([^(]+)\\(\\)(.|\\n)*$");
-    
-    JSObject          js_object(JSObject::FindJSObject(context_ref, function_ref));
-    JSObject          this_object(JSObject::FindJSObject(context_ref, this_object_ref));
-    const std::string js_object_string = to_string(js_object);
-    std::smatch       match_results;
-    const bool        found = std::regex_match(js_object_string, match_results, regex);
-
-    static_cast<void>(found);
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::CallNamedFunction: function name found = ", found, ", match_results.size() = ", match_results.size(), ", input = ", js_object_string);
+  template<typename G, G Getter>
+  JSValueRef JSExportClass<T>::GetNamedValuePropertyDirectCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, GetNamedValueProperty);
+    HAL_TRACE_SCOPE("JSExport", "GetNamedValueProperty", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "GetNamedValueProperty");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(GetNamedValueProperty, class_info__.name.c_str(), nullptr, property_name_ref, context_ref, 0, nullptr);
+    const auto native_object_ptr = RequireNativeObject(context_ref, object_ref, "GetNamedProperty");
+    return static_cast<JSValueRef>((native_object_ptr ->* Getter)());
+  } catch (const js_runtime_error& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("GetNamedProperty", static_cast<std::string>(JSString(property_name_ref)), js_object, e));
+    return nullptr;
+  } catch (const std::exception& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("GetNamedProperty", js_object, e));
+    return nullptr;
+  } catch (...) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("GetNamedProperty", js_object, "unknown exception"));
+    return nullptr;
+  }
+  
+  template<typename T>
+  template<bool (T::*Setter)(const JSValue&)>
+  bool JSExportClass<T>::SetNamedValuePropertyDirectCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, SetNamedValueProperty);
+    HAL_TRACE_SCOPE("JSExport", "SetNamedValueProperty", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "SetNamedValueProperty");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(SetNamedValueProperty, class_info__.name.c_str(), nullptr, property_name_ref, context_ref, 1, &value_ref);
+    const auto native_object_ptr = RequireNativeObject(context_ref, object_ref, "SetNamedProperty");
+    return (native_object_ptr ->* Setter)(JSValue(JSContext(context_ref), value_ref));
+  } catch (const js_runtime_error& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("SetNamedProperty", static_cast<std::string>(JSString(property_name_ref)), js_object, e));
+    return false;
+  } catch (const std::exception& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("SetNamedProperty", js_object, e));
+    return false;
+  } catch (...) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("SetNamedProperty", js_object, "unknown exception"));
+    return false;
+  }
+  
+  template<typename T>
+  template<typename F, F Function>
+  JSValueRef JSExportClass<T>::CallNamedFunctionDirectCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, CallNamedFunction);
+    HAL_TRACE_SCOPE("JSExport", "CallNamedFunction", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "CallNamedFunction");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD_FUNCTION(class_info__.name.c_str(), context_ref, function_ref, argument_count, arguments_array);
+    JSObject   this_object(JSObject::FindJSObject(context_ref, this_object_ref));
+    const auto native_this_ptr = RequireNativeObject(context_ref, this_object_ref, "CallNamedFunction");
     
-    // precondition
-    // The size of the match results should be 3:
-    // match_results[0] == the whole string.
-    // match_results[1] == The function's name
-    // match_results[2] == Everything after the function's name.
-    assert(match_results.size() == 3);
-    const std::string function_name = match_results[1];
+    try {
+      // The same handle discipline as CallNamedFunction.
+      JSHandleScope handle_scope;
+      struct FlushHandlesOnReturn {
+        ~FlushHandlesOnReturn() {
+          JSContext::FlushHandles();
+        }
+      } flush_handles_on_return;
+      
+      const auto result = InvokeNamedFunction(*native_this_ptr, Function, context_ref, argument_count, arguments_array, exception, this_object);
+      return *exception ? nullptr : static_cast<JSValueRef>(result);
+    } catch (const js_runtime_error& e) {
+      // Only an error needs the function's name, so recover it from
+      // the name property here rather than on every call.
+      JSValueRef name_exception { nullptr };
+      const auto name_ref      = JSObjectGetProperty(context_ref, function_ref, static_cast<JSStringRef>(JSAtoms::name), &name_exception);
+      const auto function_name = name_exception ? std::string() : static_cast<std::string>(JSValueView(context_ref, name_ref).ToJSString());
+      JSObject js_object(JSObject::FindJSObject(context_ref, function_ref));
+      *exception = static_cast<JSValueRef>(CreateJSError("CallNamedFunction", function_name, js_object, e));
+      return nullptr;
+    }
     
-    // precondition
-    assert(js_object.IsFunction());
+  } catch (const std::exception& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, function_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("CallNamedFunction", js_object, e));
+    return nullptr;
+  } catch (...) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, function_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("CallNamedFunction", js_object, "unknown exception"));
+    return nullptr;
+  }
+  
+  template<typename T>
+  inline JSValue JSExportClass<T>::InvokeNamedFunction(T& native_object, JSValue (T::*function)(const std::vector<JSValue>&, JSObject&), JSContextRef context_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef*, JSObject& this_object) {
+    return (native_object.*function)(to_vector(JSContext(context_ref), argument_count, arguments_array), this_object);
+  }
+  
+  template<typename T>
+  inline JSValue JSExportClass<T>::InvokeNamedFunction(T& native_object, JSValue (T::*function)(const JSArguments&, JSObject&), JSContextRef context_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception, JSObject& this_object) {
+    return (native_object.*function)(JSArguments(context_ref, argument_count, arguments_array, exception), this_object);
+  }
+  
+  // Fill a table with the addresses of JSExportClass<T>'s first N
+  // named function trampolines.
+  template<typename T, std::size_t N>
+  struct JSExportNamedFunctionTrampolines {
+    static void Fill(::JSObjectCallAsFunctionCallback* table) HAL_NOEXCEPT {
+      JSExportNamedFunctionTrampolines<T, N - 1>::Fill(table);
+      table[N - 1] = &JSExportClass<T>::template CallNamedFunctionCallbackAt<N - 1>;
+    }
+  };
+  
+  template<typename T>
+  struct JSExportNamedFunctionTrampolines<T, 0> {
+    static void Fill(::JSObjectCallAsFunctionCallback*) HAL_NOEXCEPT {
+    }
+  };
+  
+  template<typename T>
+  ::JSObjectCallAsFunctionCallback JSExportClass<T>::GetNamedFunctionCallback(std::size_t index) HAL_NOEXCEPT {
+    struct Table {
+      Table() HAL_NOEXCEPT {
+        JSExportNamedFunctionTrampolines<T, kNamedFunctionTrampolineCount>::Fill(callbacks);
+      }
+      ::JSObjectCallAsFunctionCallback callbacks[kNamedFunctionTrampolineCount];
+    };
+    static const Table table;
+    return index < kNamedFunctionTrampolineCount ? table.callbacks[index] : CallNamedFunctionCallback;
+  }
+  
+  template<typename T>
+  template<std::size_t I>
+  JSValueRef JSExportClass<T>::CallNamedFunctionCallbackAt(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) {
+    const auto& entry = js_export_class_definition__.named_function_property_callback_list__[I];
+    return CallNamedFunction(entry.name, entry.callback, context_ref, function_ref, this_object_ref, argument_count, arguments_array, exception);
+  }
+  
+  template<typename T>
+  JSValueRef JSExportClass<T>::CallNamedFunctionCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) try {
+    // Only reached for functions beyond the trampoline table, so
+    // recover the function's name from its name property.
+    JSValueRef name_exception { nullptr };
+    const auto name_ref  = JSObjectGetProperty(context_ref, function_ref, static_cast<JSStringRef>(JSAtoms::name), &name_exception);
+    const auto js_string = name_exception ? JSString() : JSValueView(context_ref, name_ref).ToJSString();
+    const auto index     = js_export_class_definition__.named_function_property_name_table__.Find(static_cast<JSStringRef>(js_string));
     
-    const auto callback_position = js_export_class_definition__.named_function_property_callback_map__.find(function_name);
-    const bool callback_found    = callback_position != js_export_class_definition__.named_function_property_callback_map__.end();
-    const auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-    const auto native_this_ptr   = static_cast<T*>(this_object.GetPrivate());
-
-    static_cast<void>(native_object_ptr);
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::CallNamedFunction: callback found = ", callback_found, " for this[", native_this_ptr, "].", function_name, "(...)");
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::CallNamedFunction: callback found = ", index != JSExportNameTable::npos, " for ", static_cast<std::string>(js_string));
     
     // precondition
-    assert(callback_found);
+    assert(index != JSExportNameTable::npos);
+    
+    const auto& entry = js_export_class_definition__.named_function_property_callback_list__[index];
+    return CallNamedFunction(entry.name, entry.callback, context_ref, function_ref, this_object_ref, argument_count, arguments_array, exception);
+  } catch (const std::exception& e) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, function_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("CallNamedFunction", js_object, e));
+    return nullptr;
+  } catch (...) {
+    JSObject js_object(JSObject::FindJSObject(context_ref, function_ref));
+    *exception = static_cast<JSValueRef>(CreateJSError("CallNamedFunction", js_object, "unknown exception"));
+    return nullptr;
+  }
+  
+  template<typename T>
+  JSValueRef JSExportClass<T>::CallNamedFunction(const std::string& function_name, const JSExportNamedFunctionPropertyCallback<T>& function_property_callback, JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, CallNamedFunction);
+    HAL_TRACE_SCOPE("JSExport", "CallNamedFunction", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "CallNamedFunction");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(CallNamedFunction, class_info__.name.c_str(), function_name.c_str(), nullptr, context_ref, argument_count, arguments_array);
+    HAL_PROPERTY_PROFILE_TIMER(function_property_callback, Call);
+    JSObject   this_object(JSObject::FindJSObject(context_ref, this_object_ref));
+    const auto native_this_ptr = RequireNativeObject(context_ref, this_object_ref, "CallNamedFunction");
+    
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::CallNamedFunction: this[", native_this_ptr, "].", function_name, "(...)");
 
     try {
-      const auto callback = (callback_position -> second).function_callback();
-      const auto result   = callback(*native_this_ptr, to_vector(this_object.get_context(), argument_count, arguments_array), this_object);
+      // The argument vector and most temporaries created by the
+      // callback never outlive this call, so keep them on the stack
+      // instead of in the JSContext retain registry.
+      JSHandleScope handle_scope;
+      
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      JSRetainSite retain_site(std::string(JSExportClassName<T>::get()) + "." + function_name);
+#endif
+      
+      // Declared after handle_scope so that it runs after every
+      // JSValue created by the callback has been destroyed.
+      struct FlushHandlesOnReturn {
+        ~FlushHandlesOnReturn() {
+          JSContext::FlushHandles();
+        }
+      } flush_handles_on_return;
+      
+      const auto& arguments_callback = function_property_callback.arguments_callback();
+      const auto  result             = arguments_callback
+          ? arguments_callback(*native_this_ptr, JSArguments(context_ref, argument_count, arguments_array, exception), this_object)
+          : function_property_callback.function_callback()(*native_this_ptr, to_vector(this_object.get_context(), argument_count, arguments_array), this_object);
       
 #ifdef HAL_LOGGING_ENABLE
       std::string js_value_str;
@@ -459,9 +1409,15 @@ namespace HAL { namespace detail {
         js_value_str = to_string(result);
       }
       
-      HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::CallNamedFunction: result = ", js_value_str, " for this[", native_this_ptr, "].", function_name, "(...)");
+      HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::CallNamedFunction: result = ", js_value_str, " for this[", native_this_ptr, "].", function_name, "(...)");
 #endif
       
+      // A JSArguments callback may have set an exception instead of
+      // throwing.
+      if (*exception) {
+        return nullptr;
+      }
+      
       return static_cast<JSValueRef>(result);
 
     } catch (const js_runtime_error& e) {
@@ -485,18 +1441,17 @@ namespace HAL { namespace detail {
     const auto js_context = js_source.get_context();
     const auto name = GetJSExportComponentName(function_name, location);
 
-    HAL_LOG_ERROR(name, ": ", e.what());
+    HAL_LOG_ERROR_RATE(HAL_LOG_SCRIPT_ERROR_RATE, name, ": ", e.what());
 
     std::vector<JSValue> js_stack = e.js_stack();
     js_stack.push_back(js_context.CreateString(name));
 
-    auto js_error = js_context.CreateError();
-    js_error.SetProperty("message",    js_context.CreateString(e.js_message()));
-    js_error.SetProperty("name",       js_context.CreateString(e.js_name()));
-    js_error.SetProperty("fileName",   js_context.CreateString(e.js_filename()));
-    js_error.SetProperty("native_stack",      js_context.CreateArray(js_stack));
-    js_error.SetProperty("lineNumber", js_context.CreateNumber(e.js_linenumber()));
-    return js_error;
+    const auto error_ref = MakeJSError(js_context, e.js_message());
+    SetJSErrorProperty(js_context, error_ref, JSAtoms::name,         js_context.CreateString(e.js_name()));
+    SetJSErrorProperty(js_context, error_ref, JSAtoms::fileName,     js_context.CreateString(e.js_filename()));
+    SetJSErrorProperty(js_context, error_ref, JSAtoms::native_stack, js_context.CreateArray(js_stack));
+    SetJSErrorProperty(js_context, error_ref, JSAtoms::lineNumber,   js_context.CreateNumber(e.js_linenumber()));
+    return JSValue(js_context, error_ref);
   }
 
   template<typename T>
@@ -509,32 +1464,57 @@ namespace HAL { namespace detail {
     const auto js_context = js_source.get_context();
     const auto name = GetJSExportComponentName(function_name);
 
-    HAL_LOG_ERROR(name, ": ", what);
+    HAL_LOG_ERROR_RATE(HAL_LOG_SCRIPT_ERROR_RATE, name, ": ", what);
 
-    auto js_error = js_context.CreateError();
-    js_error.SetProperty("message",    js_context.CreateString(what));
-    js_error.SetProperty("native_stack",      js_context.CreateArray({ js_context.CreateString(name) }));
-    return js_error;
+    const auto error_ref = MakeJSError(js_context, what);
+    SetJSErrorProperty(js_context, error_ref, JSAtoms::native_stack, js_context.CreateArray({ js_context.CreateString(name) }));
+    return JSValue(js_context, error_ref);
+  }
+  
+  template<typename T>
+  JSObjectRef JSExportClass<T>::MakeJSError(const JSContext& js_context, const std::string& message) {
+    // Passing the message to the Error constructor sets it without a
+    // separate property store.
+    const auto js_message  = js_context.CreateString(message);
+    const auto message_ref = static_cast<JSValueRef>(js_message);
+    return JSObjectMakeError(static_cast<JSContextRef>(js_context), 1, &message_ref, nullptr);
+  }
+  
+  template<typename T>
+  void JSExportClass<T>::SetJSErrorProperty(const JSContext& js_context, JSObjectRef error_ref, const JSString& property_name, const JSValue& property_value) HAL_NOEXCEPT {
+    JSObjectSetProperty(static_cast<JSContextRef>(js_context), error_ref, static_cast<JSStringRef>(property_name), static_cast<JSValueRef>(property_value), kJSPropertyAttributeNone, nullptr);
   }
   
   template<typename T>
   bool JSExportClass<T>::JSObjectHasPropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref) try {
     
-    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
-    JSString property_name(property_name_ref);
+    if (negative_property_cache__.Contains(property_name_ref)) {
+      return false;
+    }
+    
+    JSObjectView js_object(context_ref, object_ref);
+    // A hot name is passed as its interned JSString, which has already
+    // been converted to UTF-8 and hashed.
+    const JSString  fresh_property_name(property_name_ref);
+    const auto      hot_property_name = hot_property_name_cache__.Find(property_name_ref);
+    const JSString& property_name     = hot_property_name ? *hot_property_name : fresh_property_name;
     
     auto       callback       = js_export_class_definition__.has_property_callback__;
     const bool callback_found = callback != nullptr;
 
     const auto native_object_ptr = static_cast<const T*>(js_object.GetPrivate());
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::HasProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::HasProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
     
     // precondition
     assert(callback_found);
     
     const bool result = callback(*native_object_ptr, property_name);
     
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::HasProperty: result = ", result, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::HasProperty: result = ", result, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+    
+    if (!result) {
+      negative_property_cache__.Insert(property_name_ref);
+    }
     
     return result;
     
@@ -549,17 +1529,45 @@ namespace HAL { namespace detail {
   template<typename T>
   JSValueRef JSExportClass<T>::JSObjectGetPropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception) try {
     
-    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
-    JSString property_name(property_name_ref);
+    JSObjectView js_object(context_ref, object_ref);
+    
+    // Array index names go to the indexed callback before a JSString
+    // is made for the generic one.
+    const auto&   indexed_callback = js_export_class_definition__.get_indexed_property_callback__;
+    std::uint32_t index            = 0;
+    if (indexed_callback && ToArrayIndex(property_name_ref, index)) {
+      auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
+      try {
+        const auto result = indexed_callback(*native_object_ptr, index);
+        if (!result.IsNativeNull()) {
+          return static_cast<JSValueRef>(result);
+        }
+      } catch (const js_runtime_error& e) {
+        JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+        *exception = static_cast<JSValueRef>(CreateJSError("GetIndexedProperty", std::to_string(index), js_object, e));
+        return nullptr;
+      }
+    }
     
     auto       callback       = js_export_class_definition__.get_property_callback__;
     const bool callback_found = callback != nullptr;
+    if (!callback_found) {
+      return nullptr;
+    }
     
-    auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::GetProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+    // With a HasProperty callback JavaScriptCore never asks for an
+    // absent property, so only cache misses here without one.
+    const bool cache_misses = !js_export_class_definition__.has_property_callback__;
+    if (cache_misses && negative_property_cache__.Contains(property_name_ref)) {
+      return nullptr;
+    }
     
-    // precondition
-    assert(callback_found);
+    const JSString  fresh_property_name(property_name_ref);
+    const auto      hot_property_name = hot_property_name_cache__.Find(property_name_ref);
+    const JSString& property_name     = hot_property_name ? *hot_property_name : fresh_property_name;
+    
+    auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::GetProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
     
     try {
       const auto result = callback(*native_object_ptr, property_name);
@@ -574,9 +1582,13 @@ namespace HAL { namespace detail {
       else {
         js_value_str = to_string(result);
       }
-      HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::GetProperty: result = ", js_value_str, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+      HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::GetProperty: result = ", js_value_str, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
 #endif
       
+      if (cache_misses && result.IsNativeNull()) {
+        negative_property_cache__.Insert(property_name_ref);
+      }
+      
       return static_cast<JSValueRef>(result);
     } catch (const js_runtime_error& e) {
       JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
@@ -597,21 +1609,39 @@ namespace HAL { namespace detail {
   template<typename T>
   bool JSExportClass<T>::JSObjectSetPropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef value_ref, JSValueRef* exception) try {
     
-    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
-    JSString property_name(property_name_ref);
+    JSObjectView js_object(context_ref, object_ref);
+    
+    const auto&   indexed_callback = js_export_class_definition__.set_indexed_property_callback__;
+    std::uint32_t index            = 0;
+    if (indexed_callback && ToArrayIndex(property_name_ref, index)) {
+      auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
+      try {
+        if (indexed_callback(*native_object_ptr, index, JSValue(JSContext(context_ref), value_ref))) {
+          return true;
+        }
+      } catch (const js_runtime_error& e) {
+        JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+        *exception = static_cast<JSValueRef>(CreateJSError("SetIndexedProperty", std::to_string(index), js_object, e));
+        return false;
+      }
+    }
     
     auto       callback       = js_export_class_definition__.set_property_callback__;
     const bool callback_found = callback != nullptr;
+    if (!callback_found) {
+      return false;
+    }
     
-    auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::SetProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+    const JSString  fresh_property_name(property_name_ref);
+    const auto      hot_property_name = hot_property_name_cache__.Find(property_name_ref);
+    const JSString& property_name     = hot_property_name ? *hot_property_name : fresh_property_name;
     
-    // precondition
-    assert(callback_found);
+    auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::SetProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
     
     try {
-      const auto result = callback(*native_object_ptr, property_name, JSValue(js_object.get_context(), value_ref));
-      HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::SetProperty: result = ", result, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+      const auto result = callback(*native_object_ptr, property_name, JSValue(JSContext(context_ref), value_ref));
+      HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::SetProperty: result = ", result, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
       return result;
     } catch (const js_runtime_error& e) {
       JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
@@ -632,21 +1662,21 @@ namespace HAL { namespace detail {
   template<typename T>
   bool JSExportClass<T>::JSObjectDeletePropertyCallback(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef* exception) try {
     
-    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    JSObjectView js_object(context_ref, object_ref);
     JSString property_name(property_name_ref);
     
     auto       callback       = js_export_class_definition__.delete_property_callback__;
     const bool callback_found = callback != nullptr;
     
     auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::DeleteProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::DeleteProperty: callback found = ", callback_found, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
     
     // precondition
     assert(callback_found);
     
     try {
       const auto result = callback(*native_object_ptr, property_name);
-      HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::DeleteProperty: result = ", result, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
+      HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::DeleteProperty: result = ", result, " for this[", native_object_ptr, "].", static_cast<std::string>(property_name));
       return result;
     } catch (const js_runtime_error& e) {
       JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
@@ -667,14 +1697,14 @@ namespace HAL { namespace detail {
   template<typename T>
   void JSExportClass<T>::JSObjectGetPropertyNamesCallback(JSContextRef context_ref, JSObjectRef object_ref, JSPropertyNameAccumulatorRef property_names) try {
     
-    JSObject                  js_object(JSObject::FindJSObject(context_ref, object_ref));
+    JSObjectView              js_object(context_ref, object_ref);
     JSPropertyNameAccumulator js_property_name_accumulator(property_names);
     
     auto       callback       = js_export_class_definition__.get_property_names_callback__;
     const bool callback_found = callback != nullptr;
     
     auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::GetPropertyNames: callback found = ", callback_found, " for this[", native_object_ptr, "]");
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::GetPropertyNames: callback found = ", callback_found, " for this[", native_object_ptr, "]");
     
     // precondition
     assert(callback_found);
@@ -689,9 +1719,14 @@ namespace HAL { namespace detail {
   
   template<typename T>
   JSValueRef JSExportClass<T>::JSObjectCallAsFunctionCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, CallAsFunction);
+    HAL_TRACE_SCOPE("JSExport", "CallAsFunction", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "CallAsFunction");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(CallAsFunction, class_info__.name.c_str(), nullptr, nullptr, context_ref, argument_count, arguments_array);
     
-    JSObject js_object(JSObject::FindJSObject(context_ref, function_ref));
-    JSObject this_object(JSObject::FindJSObject(context_ref, this_object_ref));
+    JSObjectView js_object(context_ref, function_ref);
+    JSObject     this_object(JSObject::FindJSObject(context_ref, this_object_ref));
     
     // precondition
     assert(js_object.IsFunction());
@@ -702,13 +1737,13 @@ namespace HAL { namespace detail {
     auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
     auto native_this_ptr   = static_cast<T*>(this_object.GetPrivate());
     static_cast<void>(native_this_ptr);
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::CallAsFunction: callback found = ", callback_found, " for this[", native_this_ptr, "].this[", native_object_ptr, "](...)");
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::CallAsFunction: callback found = ", callback_found, " for this[", native_this_ptr, "].this[", native_object_ptr, "](...)");
     
     // precondition
     assert(callback_found);
     
     const auto result = callback(*native_object_ptr, to_vector(this_object.get_context(), argument_count, arguments_array), this_object);
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::CallAsFunction: result = ", to_string(result), " for this[", native_this_ptr, "].this[", native_object_ptr, "](...)");
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::CallAsFunction: result = ", to_string(result), " for this[", native_this_ptr, "].this[", native_object_ptr, "](...)");
     return static_cast<JSValueRef>(result);
 
   } catch (const js_runtime_error& e) {
@@ -727,17 +1762,14 @@ namespace HAL { namespace detail {
   
   template<typename T>
   JSObjectRef JSExportClass<T>::JSObjectCallAsConstructorCallback(JSContextRef context_ref, JSObjectRef constructor_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) try {
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, CallAsConstructor);
+    HAL_TRACE_SCOPE("JSExport", "CallAsConstructor", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "CallAsConstructor");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(CallAsConstructor, class_info__.name.c_str(), nullptr, nullptr, context_ref, argument_count, arguments_array);
     
-    JSObject  js_object(JSObject::FindJSObject(context_ref, constructor_ref));
-    JSContext js_context = js_object.get_context();
-
-    auto new_object = js_context.CreateObject(JSExport<T>::Class());
-    const auto native_object_ptr = static_cast<T*>(new_object.GetPrivate());
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::CallAsConstructor: for this[", native_object_ptr, "]");
-
-    native_object_ptr->postCallAsConstructor(js_context, to_vector(js_context, argument_count, arguments_array));
-
-    return static_cast<JSObjectRef>(new_object);
+    JSContext js_context(context_ref);
+    return CallAsConstructor(js_context, argument_count, arguments_array, exception, JSExportHasArgumentsConstructor<T>());
     
   } catch (const js_runtime_error& e) {
     JSObject js_object(JSObject::FindJSObject(context_ref, constructor_ref));
@@ -753,26 +1785,128 @@ namespace HAL { namespace detail {
     return nullptr;
   }
   
+  template<typename T>
+  JSObjectRef JSExportClass<T>::CallAsConstructor(JSContext& js_context, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception, std::true_type) {
+    const JSArguments arguments(static_cast<JSContextRef>(js_context), argument_count, arguments_array, exception);
+    
+    // Initialize consumes the arguments; the guard only matters if
+    // creating the object fails before it runs.
+    struct ConstructorArgumentsGuard {
+      ~ConstructorArgumentsGuard() {
+        constructor_arguments__ = nullptr;
+      }
+    } guard;
+    
+    constructor_arguments__ = &arguments;
+    auto new_object = js_context.CreateObject(JSExport<T>::Class());
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::CallAsConstructor: for this[", new_object.GetPrivate(), "]");
+    
+    if (arguments.HasException()) {
+      return nullptr;
+    }
+    
+    return static_cast<JSObjectRef>(new_object);
+  }
+  
+  template<typename T>
+  JSObjectRef JSExportClass<T>::CallAsConstructor(JSContext& js_context, size_t argument_count, const JSValueRef arguments_array[], JSValueRef*, std::false_type) {
+    auto new_object = js_context.CreateObject(JSExport<T>::Class());
+    const auto native_object_ptr = static_cast<T*>(new_object.GetPrivate());
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::CallAsConstructor: for this[", native_object_ptr, "]");
+    
+    native_object_ptr->postCallAsConstructor(js_context, to_vector(js_context, argument_count, arguments_array));
+    
+    return static_cast<JSObjectRef>(new_object);
+  }
+  
+  template<typename T>
+  T* JSExportClass<T>::CreateNativeObject(const JSContext& js_context, std::true_type) {
+    const auto constructor_arguments = constructor_arguments__;
+    if (constructor_arguments == nullptr) {
+      return detail::CreateNativeObject<T>(js_context);
+    }
+    
+    // Consume the arguments so that objects T's constructor creates
+    // get none.
+    constructor_arguments__ = nullptr;
+    return detail::CreateNativeObject<T>(js_context, *constructor_arguments);
+  }
+  
+  template<typename T>
+  T* JSExportClass<T>::CreateNativeObject(const JSContext& js_context, std::false_type) {
+    if (js_export_class_definition__.recycle_capacity__ > 0) {
+      const auto native_object_ptr = ReuseNativeObject(js_context, JSExportCanRecycle<T>());
+      if (native_object_ptr) {
+        return native_object_ptr;
+      }
+    }
+    return detail::CreateNativeObject<T>(js_context);
+  }
+  
+  template<typename T>
+  T* JSExportClass<T>::ReuseNativeObject(const JSContext& js_context, std::true_type) HAL_NOEXCEPT {
+    return static_cast<T*>(detail::ReuseNativeObject(class_info__, js_context));
+  }
+  
+  template<typename T>
+  T* JSExportClass<T>::ReuseNativeObject(const JSContext&, std::false_type) HAL_NOEXCEPT {
+    return nullptr;
+  }
+  
+  template<typename T>
+  bool JSExportClass<T>::RecycleNativeObject(T* native_object_ptr, std::true_type) HAL_NOEXCEPT {
+    const auto header = GetNativeObjectHeader(native_object_ptr);
+    
+    // An object created by a parent class' initializer and replaced
+    // has no class, and is simply destroyed.
+    if (header -> class_info != &class_info__) {
+      return false;
+    }
+    
+    try {
+      native_object_ptr -> Recycle();
+    } catch (const std::exception& e) {
+      HAL_LOG_ERROR("JSExportClass<", JSExportClassName<T>::get(), ">::Finalize: Recycle threw ", e.what());
+      return false;
+    } catch (...) {
+      HAL_LOG_ERROR("JSExportClass<", JSExportClassName<T>::get(), ">::Finalize: Recycle threw an unknown exception");
+      return false;
+    }
+    
+    if (!detail::RecycleNativeObject(class_info__, native_object_ptr -> get_context(), native_object_ptr, js_export_class_definition__.recycle_capacity__)) {
+      return false;
+    }
+    
+    // A recycled object isn't a live instance until it is reused, and
+    // the cost Recycle left on it leaves its class until then.
+    RemoveJSExportClassInstance(class_info__);
+    SetJSExportObjectClassInfo(native_object_ptr, nullptr);
+    header -> class_info = nullptr;
+    return true;
+  }
+  
+  template<typename T>
+  bool JSExportClass<T>::RecycleNativeObject(T*, std::false_type) HAL_NOEXCEPT {
+    return false;
+  }
+  
   template<typename T>
   bool JSExportClass<T>::JSObjectHasInstanceCallback(JSContextRef context_ref, JSObjectRef constructor_ref, JSValueRef possible_instance_ref, JSValueRef* exception) try {
-    JSObject js_object(JSObject::FindJSObject(context_ref, constructor_ref));
-    JSValue  possible_instance(js_object.get_context(), possible_instance_ref);
+    JSValueView possible_instance(context_ref, possible_instance_ref);
 
+    // Objects of other JSClasses may have private data without a
+    // native object header, so the JSClass is checked first.
     bool result = false;
-    if (possible_instance.IsObject()) {
-      JSObject possible_object = static_cast<JSObject>(possible_instance);
-      if (possible_object.GetPrivate() != nullptr) {
-        auto possible_js_export_ptr     = static_cast<JSExport<T>*>(possible_object.GetPrivate());
-        auto possible_native_object_ptr = dynamic_cast<T*>(possible_js_export_ptr);
-        if (possible_native_object_ptr != nullptr) {
-          result = true;
-        }
+    if (JSValueIsObjectOfClass(context_ref, possible_instance_ref, static_cast<JSClassRef>(JSExport<T>::Class()))) {
+      const auto possible_object = possible_instance.ToObjectView();
+      const auto possible_native_object_ptr = possible_object.GetPrivate();
+      if (possible_native_object_ptr != nullptr) {
+        const auto class_info = GetNativeObjectHeader(possible_native_object_ptr) -> class_info;
+        result = class_info != nullptr && class_info -> IsSubclassOf(class_info__);
       }
     }
     
-    auto native_object_ptr = static_cast<T*>(js_object.GetPrivate());
-    static_cast<void>(native_object_ptr);
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::HasInstance: result = ", result, " for ", to_string(possible_instance), " instanceof this[", native_object_ptr, "]");
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::HasInstance: result = ", result, " for ", possible_instance_ref, " instanceof ", constructor_ref);
     return result;
     
   } catch (const js_runtime_error& e) {
@@ -780,32 +1914,48 @@ namespace HAL { namespace detail {
     *exception = static_cast<JSValueRef>(CreateJSError("JSObjectHasInstanceCallback", "", js_object, e));
     return false;
   } catch (const std::exception& e) {
+    // Only the standard exceptions of Class() and the logger can reach
+    // here, so there is no catch-all to hide anything else.
     JSObject js_object(JSObject::FindJSObject(context_ref, constructor_ref));
     *exception = static_cast<JSValueRef>(CreateJSError("JSObjectHasInstanceCallback", js_object, e));
     return false;
-  } catch (...) {
-    JSObject js_object(JSObject::FindJSObject(context_ref, constructor_ref));
-    *exception = static_cast<JSValueRef>(CreateJSError("JSObjectHasInstanceCallback", js_object, "unknown exception"));
-    return false;
   }
   
   template<typename T>
   JSValueRef JSExportClass<T>::JSObjectConvertToTypeCallback(JSContextRef context_ref, JSObjectRef object_ref, JSType type, JSValueRef* exception) try {
-    JSObject js_object(JSObject::FindJSObject(context_ref, object_ref));
+    HAL_CALLBACK_LATENCY_TIMER(class_info__, ConvertToType);
+    HAL_TRACE_SCOPE("JSExport", "ConvertToType", class_info__.name.c_str());
+    HAL_STACK_SAMPLE(context_ref, class_info__.name.c_str(), "ConvertToType");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD_CONVERSION(class_info__.name.c_str(), type);
+    JSObjectView  js_object(context_ref, object_ref);
     JSValue::Type js_value_type = ToJSValueType(type);
     
+    // Taken by reference, so that the std::function isn't copied.
+    const auto& primitive_callback = js_export_class_definition__.convert_to_type_primitive_callback__;
+    if (primitive_callback) {
+      const auto native_object_ptr = RequireNativeObject(context_ref, object_ref, "ConvertToType");
+      if (!native_object_ptr) {
+        return JSValueMakeUndefined(context_ref);
+      }
+      return primitive_callback(*native_object_ptr, js_value_type, js_object).ToJSValueRef(context_ref);
+    }
+    
     auto       callback       = js_export_class_definition__.convert_to_type_callback__;
     const bool callback_found = callback != nullptr;
     
-    const auto native_object_ptr = static_cast<const T*>(js_object.GetPrivate());
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::ConvertToType: callback found = ", callback_found, " for this[", native_object_ptr, "]");
+    const auto native_object_ptr = RequireNativeObject(context_ref, object_ref, "ConvertToType");
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::ConvertToType: callback found = ", callback_found, " for this[", native_object_ptr, "]");
     
     // precondition
     assert(callback_found);
+    if (!native_object_ptr) {
+      return JSValueMakeUndefined(context_ref);
+    }
     
     const auto result = callback(*native_object_ptr, js_value_type);
     
-    HAL_LOG_DEBUG("JSExportClass<", typeid(T).name(), ">::ConvertToType: result = ", to_string(result), " for converting this[", native_object_ptr, "] to ", to_string(js_value_type));
+    HAL_LOG_DEBUG("JSExportClass<", JSExportClassName<T>::get(), ">::ConvertToType: result = ", to_string(result), " for converting this[", native_object_ptr, "] to ", to_string(js_value_type));
     
     return static_cast<JSValueRef>(result);
     
@@ -825,12 +1975,19 @@ namespace HAL { namespace detail {
   
   template<typename T>
   std::string JSExportClass<T>::GetJSExportComponentName(const std::string& function_name, const std::string& location) {
-    std::ostringstream os;
-    os << "JSExportClass<" << typeid(T).name() << ">::" << function_name;
+    // The class part of the name never changes.
+    static const std::string prefix = std::string("JSExportClass<") + JSExportClassName<T>::get() + ">::";
+    
+    std::string name;
+    name.reserve(prefix.size() + function_name.size() + location.size() + 3);
+    name += prefix;
+    name += function_name;
     if (location.size() > 0) {
-      os << " (" << location << ")";
+      name += " (";
+      name += location;
+      name += ")";
     }
-    return os.str();
+    return name;
   }
 
 }} // namespace HAL { namespace detail {
@@ -16,18 +16,63 @@
 #include "HAL/detail/JSExportNamedValuePropertyCallback.hpp"
 #include "HAL/detail/JSExportNamedFunctionPropertyCallback.hpp"
 #include "HAL/detail/JSExportCallbacks.hpp"
+#include "HAL/detail/JSExportNameTable.hpp"
 
+#include <functional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace HAL { namespace detail {
   
+  class JSExportValueCache;
+  
   template<typename T>
   using JSExportNamedValuePropertyCallbackMap_t    = std::unordered_map<std::string, JSExportNamedValuePropertyCallback<T>>;
   
   template<typename T>
   using JSExportNamedFunctionPropertyCallbackMap_t = std::unordered_map<std::string, JSExportNamedFunctionPropertyCallback<T>>;
   
+  // A value property together with what the getter trampoline for
+  // its index needs to know, so that a property access needs no name
+  // lookup. The property callbacks are non-null only for properties
+  // bound directly to member function pointers, and replace the
+  // trampolines when they are.
+  template<typename T>
+  struct JSExportNamedValuePropertyEntry {
+    std::string                           name;
+    JSExportNamedValuePropertyCallback<T> callback;
+    bool                                  constant;
+    bool                                  cached;
+    std::size_t                           index;
+    ::JSObjectGetPropertyCallback         get_property_callback;
+    ::JSObjectSetPropertyCallback         set_property_callback;
+    
+    // A cached value is kept under cache_index of value_cache, or of
+    // T's own cache if it is null. A property inherited from a
+    // flattened parent is kept in the parent's cache, under its index
+    // there, so that invalidating it through the parent finds it.
+    std::size_t                            cache_index;
+    std::function<JSExportValueCache&(T&)> value_cache;
+  };
+  
+  // A function property. As for value properties, the
+  // call_as_function_callback is non-null only for functions bound
+  // directly to a member function pointer.
+  template<typename T>
+  struct JSExportNamedFunctionPropertyEntry {
+    std::string                              name;
+    JSExportNamedFunctionPropertyCallback<T> callback;
+    ::JSObjectCallAsFunctionCallback         call_as_function_callback;
+  };
+  
+  template<typename T>
+  using JSExportNamedValuePropertyCallbackList_t    = std::vector<JSExportNamedValuePropertyEntry<T>>;
+  
+  template<typename T>
+  using JSExportNamedFunctionPropertyCallbackList_t = std::vector<JSExportNamedFunctionPropertyEntry<T>>;
+  
   template<typename T>
   class JSExportClassDefinitionBuilder;
   
@@ -63,35 +108,83 @@ namespace HAL { namespace detail {
     
     void InitializeNamedPropertyCallbacks() HAL_NOEXCEPT;
 
-    // Only JSExportClass can access our private member variables.
+    // Only JSExportClass can access our private member variables, and
+    // JSExportClassDefinitionBuilder to flatten a parent class.
     template<typename U>
     friend class JSExportClass;
     
+    template<typename U>
+    friend class JSExportClassDefinitionBuilder;
+    
     std::unordered_set<std::string>               named_constants__;
+    std::unordered_set<std::string>               named_cached_values__;
     JSExportNamedValuePropertyCallbackMap_t<T>    named_value_property_callback_map__;
     JSExportNamedFunctionPropertyCallbackMap_t<T> named_function_property_callback_map__;
+
     HasPropertyCallback<T>                        has_property_callback__        { nullptr };
     GetPropertyCallback<T>                        get_property_callback__        { nullptr };
     SetPropertyCallback<T>                        set_property_callback__        { nullptr };
+    GetIndexedPropertyCallback<T>                 get_indexed_property_callback__ { nullptr };
+    SetIndexedPropertyCallback<T>                 set_indexed_property_callback__ { nullptr };
     DeletePropertyCallback<T>                     delete_property_callback__     { nullptr };
     GetPropertyNamesCallback<T>                   get_property_names_callback__  { nullptr };
     CallAsFunctionCallback<T>                     call_as_function_callback__    { nullptr };
     ConvertToTypeCallback<T>                      convert_to_type_callback__     { nullptr };
+    ConvertToTypePrimitiveCallback<T>             convert_to_type_primitive_callback__ { nullptr };
+    bool                                          pin_constants__                { false };
+    bool                                          track_dirty__                  { false };
+    std::size_t                                   negative_property_cache_capacity__ { 0 };
+    std::size_t                                   hot_property_name_threshold__ { 0 };
+    bool                                          deferred_finalization__        { false };
+    std::size_t                                   recycle_capacity__             { 0 };
+    IteratorCallback<T>                           iterator_callback__            { nullptr };
+    std::size_t                                   iterator_batch_size__          { 0 };
+    const ::JSStaticValue*                        static_value_table__           { nullptr };
+    const ::JSStaticFunction*                     static_function_table__        { nullptr };
+    
+    // The value and function properties in the order of the
+    // JSStaticValue and JSStaticFunction arrays, so that a property's
+    // index selects its callback. Copies keep this order, unlike the
+    // maps.
+    JSExportNamedValuePropertyCallbackList_t<T>    named_value_property_callback_list__;
+    JSExportNamedFunctionPropertyCallbackList_t<T> named_function_property_callback_list__;
+    
+    // Map names to indexes in the lists above, for properties that are
+    // not bound to a trampoline. Rebuilt with the JSStaticValue and
+    // JSStaticFunction arrays.
+    JSExportNameTable                              named_value_property_name_table__;
+    JSExportNameTable                              named_function_property_name_table__;
   };
   
   template<typename T>
   JSExportClassDefinition<T>::JSExportClassDefinition(const JSExportClassDefinition<T>& rhs) HAL_NOEXCEPT
   : JSClassDefinition(rhs)
   , named_constants__(rhs.named_constants__)
+  , named_cached_values__(rhs.named_cached_values__)
   , named_value_property_callback_map__(rhs.named_value_property_callback_map__)
   , named_function_property_callback_map__(rhs.named_function_property_callback_map__)
   , has_property_callback__(rhs.has_property_callback__)
   , get_property_callback__(rhs.get_property_callback__)
   , set_property_callback__(rhs.set_property_callback__)
+  , get_indexed_property_callback__(rhs.get_indexed_property_callback__)
+  , set_indexed_property_callback__(rhs.set_indexed_property_callback__)
   , delete_property_callback__(rhs.delete_property_callback__)
   , get_property_names_callback__(rhs.get_property_names_callback__)
   , call_as_function_callback__(rhs.call_as_function_callback__)
-  , convert_to_type_callback__(rhs.convert_to_type_callback__) {
+  , convert_to_type_callback__(rhs.convert_to_type_callback__)
+  , convert_to_type_primitive_callback__(rhs.convert_to_type_primitive_callback__)
+  , pin_constants__(rhs.pin_constants__)
+  , track_dirty__(rhs.track_dirty__)
+  , negative_property_cache_capacity__(rhs.negative_property_cache_capacity__)
+  , hot_property_name_threshold__(rhs.hot_property_name_threshold__)
+  , deferred_finalization__(rhs.deferred_finalization__)
+  , recycle_capacity__(rhs.recycle_capacity__)
+  , iterator_callback__(rhs.iterator_callback__)
+  , iterator_batch_size__(rhs.iterator_batch_size__)
+  , static_value_table__(rhs.static_value_table__)
+  , static_function_table__(rhs.static_function_table__)
+  , named_value_property_callback_list__(rhs.named_value_property_callback_list__)
+  , named_function_property_callback_list__(rhs.named_function_property_callback_list__) {
     InitializeNamedPropertyCallbacks();
     
 //    std::clog << "MDL: copy ctor" << std::endl;
@@ -102,15 +195,31 @@ namespace HAL { namespace detail {
   JSExportClassDefinition<T>::JSExportClassDefinition(JSExportClassDefinition<T>&& rhs) HAL_NOEXCEPT
   : JSClassDefinition(rhs)
   , named_constants__(std::move(rhs.named_constants__))
+  , named_cached_values__(std::move(rhs.named_cached_values__))
   , named_value_property_callback_map__(std::move(rhs.named_value_property_callback_map__))
   , named_function_property_callback_map__(std::move(rhs.named_function_property_callback_map__))
   , has_property_callback__(std::move(rhs.has_property_callback__))
   , get_property_callback__(std::move(rhs.get_property_callback__))
   , set_property_callback__(std::move(rhs.set_property_callback__))
+  , get_indexed_property_callback__(std::move(rhs.get_indexed_property_callback__))
+  , set_indexed_property_callback__(std::move(rhs.set_indexed_property_callback__))
   , delete_property_callback__(std::move(rhs.delete_property_callback__))
   , get_property_names_callback__(std::move(rhs.get_property_names_callback__))
   , call_as_function_callback__(std::move(rhs.call_as_function_callback__))
-  , convert_to_type_callback__(std::move(rhs.convert_to_type_callback__)) {
+  , convert_to_type_callback__(std::move(rhs.convert_to_type_callback__))
+  , convert_to_type_primitive_callback__(std::move(rhs.convert_to_type_primitive_callback__))
+  , pin_constants__(rhs.pin_constants__)
+  , track_dirty__(rhs.track_dirty__)
+  , negative_property_cache_capacity__(rhs.negative_property_cache_capacity__)
+  , hot_property_name_threshold__(rhs.hot_property_name_threshold__)
+  , deferred_finalization__(rhs.deferred_finalization__)
+  , recycle_capacity__(rhs.recycle_capacity__)
+  , iterator_callback__(std::move(rhs.iterator_callback__))
+  , iterator_batch_size__(rhs.iterator_batch_size__)
+  , static_value_table__(rhs.static_value_table__)
+  , static_function_table__(rhs.static_function_table__)
+  , named_value_property_callback_list__(std::move(rhs.named_value_property_callback_list__))
+  , named_function_property_callback_list__(std::move(rhs.named_function_property_callback_list__)) {
     InitializeNamedPropertyCallbacks();
     
 //    std::clog << "MDL: move ctor" << std::endl;
@@ -122,15 +231,31 @@ namespace HAL { namespace detail {
     HAL_JSCLASSDEFINITION_LOCK_GUARD;
     JSClassDefinition::operator=(rhs);
     named_constants__                      = rhs.named_constants__;
+    named_cached_values__                  = rhs.named_cached_values__;
     named_value_property_callback_map__    = rhs.named_value_property_callback_map__;
     named_function_property_callback_map__ = rhs.named_function_property_callback_map__;
+    named_value_property_callback_list__    = rhs.named_value_property_callback_list__;
+    named_function_property_callback_list__ = rhs.named_function_property_callback_list__;
     has_property_callback__                = rhs.has_property_callback__;
     get_property_callback__                = rhs.get_property_callback__;
     set_property_callback__                = rhs.set_property_callback__;
+    get_indexed_property_callback__        = rhs.get_indexed_property_callback__;
+    set_indexed_property_callback__        = rhs.set_indexed_property_callback__;
     delete_property_callback__             = rhs.delete_property_callback__;
     get_property_names_callback__          = rhs.get_property_names_callback__;
     call_as_function_callback__            = rhs.call_as_function_callback__;
     convert_to_type_callback__             = rhs.convert_to_type_callback__;
+    convert_to_type_primitive_callback__   = rhs.convert_to_type_primitive_callback__;
+    pin_constants__                        = rhs.pin_constants__;
+    track_dirty__                          = rhs.track_dirty__;
+    negative_property_cache_capacity__     = rhs.negative_property_cache_capacity__;
+    hot_property_name_threshold__          = rhs.hot_property_name_threshold__;
+    deferred_finalization__                = rhs.deferred_finalization__;
+    recycle_capacity__                     = rhs.recycle_capacity__;
+    iterator_callback__                    = rhs.iterator_callback__;
+    iterator_batch_size__                  = rhs.iterator_batch_size__;
+    static_value_table__                   = rhs.static_value_table__;
+    static_function_table__                = rhs.static_function_table__;
     InitializeNamedPropertyCallbacks();
     
 //    std::clog << "MDL: copy assignment" << std::endl;
@@ -160,15 +285,31 @@ namespace HAL { namespace detail {
       // By swapping the members of two classes, the two classes are
       // effectively swapped.
       swap(named_constants__                     , other.named_constants__);
+      swap(named_cached_values__                 , other.named_cached_values__);
       swap(named_value_property_callback_map__   , other.named_value_property_callback_map__);
       swap(named_function_property_callback_map__, other.named_function_property_callback_map__);
+      swap(named_value_property_callback_list__   , other.named_value_property_callback_list__);
+      swap(named_function_property_callback_list__, other.named_function_property_callback_list__);
       swap(has_property_callback__               , other.has_property_callback__);
       swap(get_property_callback__               , other.get_property_callback__);
       swap(set_property_callback__               , other.set_property_callback__);
+      swap(get_indexed_property_callback__       , other.get_indexed_property_callback__);
+      swap(set_indexed_property_callback__       , other.set_indexed_property_callback__);
       swap(delete_property_callback__            , other.delete_property_callback__);
       swap(get_property_names_callback__         , other.get_property_names_callback__);
       swap(call_as_function_callback__           , other.call_as_function_callback__);
       swap(convert_to_type_callback__            , other.convert_to_type_callback__);
+      swap(convert_to_type_primitive_callback__  , other.convert_to_type_primitive_callback__);
+      swap(pin_constants__                       , other.pin_constants__);
+      swap(track_dirty__                         , other.track_dirty__);
+      swap(negative_property_cache_capacity__    , other.negative_property_cache_capacity__);
+      swap(hot_property_name_threshold__         , other.hot_property_name_threshold__);
+      swap(deferred_finalization__               , other.deferred_finalization__);
+      swap(recycle_capacity__                    , other.recycle_capacity__);
+      swap(iterator_callback__                   , other.iterator_callback__);
+      swap(iterator_batch_size__                 , other.iterator_batch_size__);
+      swap(static_value_table__                  , other.static_value_table__);
+      swap(static_function_table__               , other.static_function_table__);
     }
     
     template<typename T>
@@ -179,39 +320,65 @@ namespace HAL { namespace detail {
     template<typename T>
     void JSExportClassDefinition<T>::InitializeNamedPropertyCallbacks() HAL_NOEXCEPT {
       
-      // Initialize staticValues.
+      std::vector<std::string> names;
+      names.reserve(named_value_property_callback_list__.size());
+      for (const auto& entry : named_value_property_callback_list__) {
+        names.push_back(entry.name);
+      }
+      named_value_property_name_table__ = JSExportNameTable(names);
+      
+      names.clear();
+      for (const auto& entry : named_function_property_callback_list__) {
+        names.push_back(entry.name);
+      }
+      named_function_property_name_table__ = JSExportNameTable(names);
+      
+      // Initialize staticValues. Without properties added one at a
+      // time JavaScriptCore reads the static table, if any, directly.
       static_values__.clear();
-      js_class_definition__.staticValues = nullptr;
-      if (!named_value_property_callback_map__.empty()) {
-        for (const auto& entry : named_value_property_callback_map__) {
-          const auto& property_name       = entry.first;
-          const auto& property_attributes = entry.second.get_attributes();
+      js_class_definition__.staticValues = static_value_table__;
+      if (!named_value_property_callback_list__.empty()) {
+        for (const auto& entry : named_value_property_callback_list__) {
+          // Pinned constants are installed as plain data properties by
+          // JSExportClass::Initialize instead.
+          if (pin_constants__ && entry.constant) {
+            continue;
+          }
+          
+          const auto& property_name       = entry.name;
+          const auto& property_attributes = entry.callback.get_attribute_set();
           ::JSStaticValue static_value;
           static_value.name        = property_name.c_str();
-          static_value.getProperty = JSExportClass<T>::GetNamedValuePropertyCallback;
-          static_value.setProperty = JSExportClass<T>::SetNamedValuePropertyCallback;
+          static_value.getProperty = entry.get_property_callback ? entry.get_property_callback : JSExportClass<T>::GetNamedValueGetPropertyCallback(entry.index);
+          static_value.setProperty = entry.set_property_callback ? entry.set_property_callback : JSExportClass<T>::GetNamedValueSetPropertyCallback(entry.index);
           static_value.attributes  = ToJSPropertyAttributes(property_attributes);
           static_values__.push_back(static_value);
           // HAL_LOG_DEBUG("JSExportClassDefinition<", name__, "> added value property ", static_values__.back().name);
         }
+        for (auto static_value = static_value_table__; static_value && static_value -> name; ++static_value) {
+          static_values__.push_back(*static_value);
+        }
         static_values__.push_back({nullptr, nullptr, nullptr, kJSPropertyAttributeNone});
         js_class_definition__.staticValues = &static_values__[0];
       }
       
       // Initialize staticFunctions.
       static_functions__.clear();
-      js_class_definition__.staticFunctions = nullptr;
-      if (!named_function_property_callback_map__.empty()) {
-        for (const auto& entry : named_function_property_callback_map__) {
-          const auto& function_name = entry.first;
-          const auto& property_attributes = entry.second.get_attributes();
+      js_class_definition__.staticFunctions = static_function_table__;
+      if (!named_function_property_callback_list__.empty()) {
+        for (const auto& entry : named_function_property_callback_list__) {
+          const auto& function_name = entry.name;
+          const auto& property_attributes = entry.callback.get_attribute_set();
           ::JSStaticFunction static_function;
           static_function.name           = function_name.c_str();
-          static_function.callAsFunction = JSExportClass<T>::CallNamedFunctionCallback;
+          static_function.callAsFunction = entry.call_as_function_callback ? entry.call_as_function_callback : JSExportClass<T>::GetNamedFunctionCallback(static_functions__.size());
           static_function.attributes     = ToJSPropertyAttributes(property_attributes);
           static_functions__.push_back(static_function);
           // HAL_LOG_DEBUG("JSExportClassDefinition<", name__, "> added function property ", static_functions__.back().name);
         }
+        for (auto static_function = static_function_table__; static_function && static_function -> name; ++static_function) {
+          static_functions__.push_back(*static_function);
+        }
         static_functions__.push_back({nullptr, nullptr, kJSPropertyAttributeNone});
         js_class_definition__.staticFunctions = &static_functions__[0];
       }
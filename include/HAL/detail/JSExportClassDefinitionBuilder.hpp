@@ -12,16 +12,22 @@
 #include "HAL/detail/JSBase.hpp"
 #include "HAL/detail/JSExportClassDefinition.hpp"
 #include "HAL/detail/JSExportClass.hpp"
+#include "HAL/detail/JSExportNativeMethod.hpp"
 #include "HAL/detail/JSUtil.hpp"
+#include "HAL/JSStringBuilder.hpp"
 
 #include <string>
 #include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 #undef HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_MUTEX
 #undef HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD
 #ifdef HAL_THREAD_SAFE
-#define HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_MUTEX                      std::recursive_mutex       mutex__
-#define HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock(mutex__)
+#define HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_MUTEX                      JSRecursiveMutex           mutex__ HAL_LOCK_CLASS_NAME(JSExportClassDefinitionBuilder<T>, "JSExportClassDefinitionBuilder")
+#define HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD std::lock_guard<JSRecursiveMutex> lock(mutex__)
 #else
 #define HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_MUTEX
 #define HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD
@@ -174,6 +180,223 @@ namespace HAL { namespace detail {
       return *this;
     }
     
+    /*!
+     @method
+     
+     @abstract Return whether constant properties are pinned.
+     
+     @result true if constant properties are pinned.
+     */
+    bool PinConstants() const HAL_NOEXCEPT {
+      return pin_constants__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set whether constant properties are pinned. The default
+     value is false.
+     
+     @discussion A pinned constant is not a JSStaticValue. Instead its
+     getter is called once per JSContext when the first object of the
+     class is created there, and the result is stored as a ReadOnly,
+     DontDelete data property on the class prototype (or on each object
+     if the class has no automatic prototype). Later reads are served
+     by JavaScriptCore without calling into C++.
+     
+     Only pin constants whose value doesn't depend on the object they
+     are read from.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& PinConstants(bool pin_constants) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      pin_constants__ = pin_constants;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return whether writes to value properties are tracked.
+     
+     @result true if writes to value properties are tracked.
+     */
+    bool TrackDirty() const HAL_NOEXCEPT {
+      return track_dirty__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set whether writes to value properties are tracked. The
+     default value is false.
+     
+     @discussion Each native object keeps one bit per value property,
+     which is set when a setter returns true, and the first write puts
+     the object on a list for its class. JSExportClass<T>::DrainDirty
+     then visits each written object once with the names of the
+     properties written since the last drain, so that the native side
+     can reconcile them in one pass instead of in every setter.
+     
+     Properties bound to member function pointers are routed through
+     the trampolines, which know their index, so that they are tracked
+     too.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& TrackDirty(bool track_dirty) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      track_dirty__ = track_dirty;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return the number of absent property names remembered
+     for the HasProperty and GetProperty callbacks.
+     
+     @result The capacity of the negative property cache, or 0 if it
+     is disabled.
+     */
+    std::size_t NegativePropertyCache() const HAL_NOEXCEPT {
+      return negative_property_cache_capacity__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the number of absent property names remembered for
+     the HasProperty and GetProperty callbacks. The default value is 0,
+     which disables the cache.
+     
+     @discussion When the HasProperty callback returns false, or the
+     GetProperty callback returns native null when there is no
+     HasProperty callback, the property name is remembered and later
+     probes for it are answered without calling the callback. Call
+     JSExportClass<T>::InvalidateNegativePropertyCache when a property
+     your callbacks reported as absent comes into existence.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& NegativePropertyCache(std::size_t capacity) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      negative_property_cache_capacity__ = capacity;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return the number of times a property name must reach
+     the HasProperty, GetProperty or SetProperty callback before it is
+     interned.
+     
+     @result The threshold, or 0 if names are never interned.
+     */
+    std::size_t HotPropertyNames() const HAL_NOEXCEPT {
+      return hot_property_name_threshold__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the number of times a property name must reach the
+     HasProperty, GetProperty or SetProperty callback before it is
+     interned. The default value is 0, which disables interning.
+     
+     @discussion Once interned, up to 8 names per class are passed to
+     the callbacks as the same JSString every time, with its UTF-8 form
+     and hash already computed, so converting it to a std::string or
+     looking it up in a hash map costs nothing more. A callback may also
+     remember the JSString it was given and recognize the name by
+     comparing JSStringRefs.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& HotPropertyNames(std::size_t threshold) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      hot_property_name_threshold__ = threshold;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return whether native objects are destroyed in batches
+     after finalization rather than during it.
+     
+     @result true if finalization is deferred.
+     */
+    bool DeferredFinalization() const HAL_NOEXCEPT {
+      return deferred_finalization__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set whether native objects are destroyed in batches
+     after finalization rather than during it. The default value is
+     false.
+     
+     @discussion When the garbage collector finalizes an object of a
+     class with deferred finalization, its native object is only
+     queued, so an expensive destructor doesn't lengthen the
+     collector's pause. The queue belongs to the finalizing thread,
+     which destroys the queued objects with
+     JSExportFinalizer::RunPending, e.g. from an idle handler or a
+     delayed task of its JSRunLoop.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& DeferredFinalization(bool deferred_finalization) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      deferred_finalization__ = deferred_finalization;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return the number of finalized native objects each
+     thread keeps for reuse.
+     
+     @result The recycle capacity, or 0 if recycling is disabled.
+     */
+    std::size_t RecycleCapacity() const HAL_NOEXCEPT {
+      return recycle_capacity__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the number of finalized native objects each thread
+     keeps for reuse. The default value is 0, which disables
+     recycling.
+     
+     @discussion Instead of being destroyed, a finalized native object
+     is reset by calling its Recycle() member function and kept on a
+     free list of the finalizing thread, up to capacity objects, and a
+     later JavaScript instantiation of the class in the same JSContext
+     on that thread reuses it without allocating or constructing a new
+     one. postInitialize and postCallAsConstructor are still called.
+     
+     Only classes with a void Recycle() member function and without a
+     (const JSContext&, const JSArguments&) constructor are recycled.
+     Recycle must return the object to the state its constructor leaves
+     it in. A recycled object keeps its JSContext alive until it is
+     reused or destroyed by JSExportClass<T>::PurgeRecycled or the exit
+     of its thread.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& RecycleCapacity(std::size_t capacity) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      recycle_capacity__ = capacity;
+      return *this;
+    }
+    
     /*!
      @method
      
@@ -197,6 +420,35 @@ namespace HAL { namespace detail {
     JSExportClassDefinitionBuilder<T>& Parent(const JSClass& parent) HAL_NOEXCEPT {
       HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
       parent__ = parent;
+      inherit_properties__ = nullptr;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the parent of your JSClass and copy the parent's
+     value and function properties into your JSClass when it is built.
+     
+     @discussion With Parent, JavaScriptCore looks up a property
+     inherited from U in each JSClass of the chain in turn, and each
+     one runs its own callbacks. A flattened parent's properties,
+     including those it inherited the same way, become properties of
+     your JSClass, so one lookup and one callback serve the whole
+     hierarchy. Properties your class defines itself take precedence.
+     
+     The parent stays in the JSClass chain, so 'instanceof' and
+     properties that a getter delegates to the parent by returning
+     native null still work.
+     
+     @result A reference to the builder for chaining.
+     */
+    template<typename U>
+    JSExportClassDefinitionBuilder<T>& FlattenedParent(const JSExportClass<U>& parent) HAL_NOEXCEPT {
+      static_assert(std::is_base_of<U, T>::value, "A flattened parent must be a base class of T");
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      parent__ = parent;
+      inherit_properties__ = &JSExportClassDefinitionBuilder<T>::template InheritProperties<U>;
       return *this;
     }
     
@@ -251,13 +503,40 @@ namespace HAL { namespace detail {
      @result A reference to the builder for chaining.
      */
     JSExportClassDefinitionBuilder<T>& AddValueProperty(const JSString& property_name, GetNamedValuePropertyCallback<T> get_callback, SetNamedValuePropertyCallback<T> set_callback = nullptr, bool enumerable = true) {
-      std::unordered_set<JSPropertyAttribute> attributes { JSPropertyAttribute::DontDelete };
-      static_cast<void>(!enumerable   && attributes.insert(JSPropertyAttribute::DontEnum).second);
-      static_cast<void>(!set_callback && attributes.insert(JSPropertyAttribute::ReadOnly).second);
+      JSPropertyAttributeSet attributes { JSPropertyAttribute::DontDelete };
+      if (!enumerable)   { attributes |= JSPropertyAttribute::DontEnum; }
+      if (!set_callback) { attributes |= JSPropertyAttribute::ReadOnly; }
       HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
       AddValuePropertyCallback(JSExportNamedValuePropertyCallback<T>(property_name, get_callback, set_callback, attributes));
       return *this;
     }
+    
+    /*!
+     @method
+     
+     @abstract Add a value property bound directly to member function
+     pointers given as template arguments.
+     
+     @discussion This behaves like the AddValueProperty above, but
+     JavaScriptCore calls a getter and setter specialized for the
+     member functions, so a property access makes no std::function
+     call and needs no lookup in the class definition. For example:
+     
+     builder.AddValueProperty<&Foo::GetName, &Foo::SetName>("name");
+     
+     Omit the setter for a ReadOnly property.
+     
+     @result A reference to the builder for chaining.
+     */
+    template<JSValue (T::*Getter)() const, bool (T::*Setter)(const JSValue&) = nullptr>
+    JSExportClassDefinitionBuilder<T>& AddValueProperty(const JSString& property_name, bool enumerable = true) {
+      return AddDirectValueProperty<JSValue (T::*)() const, Getter, Setter>(property_name, enumerable);
+    }
+    
+    template<JSValue (T::*Getter)(), bool (T::*Setter)(const JSValue&) = nullptr>
+    JSExportClassDefinitionBuilder<T>& AddValueProperty(const JSString& property_name, bool enumerable = true) {
+      return AddDirectValueProperty<JSValue (T::*)(), Getter, Setter>(property_name, enumerable);
+    }
 
     /*!
      @method
@@ -305,13 +584,45 @@ namespace HAL { namespace detail {
      @result A reference to the builder for chaining.
      */
     JSExportClassDefinitionBuilder<T>& AddConstantProperty(const JSString& property_name, GetNamedValuePropertyCallback<T> get_callback, bool enumerable = true) {
-      std::unordered_set<JSPropertyAttribute> attributes { JSPropertyAttribute::DontDelete, JSPropertyAttribute::ReadOnly };
-      static_cast<void>(!enumerable   && attributes.insert(JSPropertyAttribute::DontEnum).second);
+      JSPropertyAttributeSet attributes { JSPropertyAttribute::DontDelete, JSPropertyAttribute::ReadOnly };
+      if (!enumerable)   { attributes |= JSPropertyAttribute::DontEnum; }
       HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
       AddConstantPropertyCallback(JSExportNamedValuePropertyCallback<T>(property_name, get_callback, nullptr, attributes));
       return *this;
     }   
     
+    /*!
+     @method
+     
+     @abstract Add callbacks to invoke when getting and/or setting a
+     value property whose value is cached per JavaScript object, with
+     the same attributes as AddValueProperty.
+     
+     @discussion The getter is called on the first read, and later
+     reads return the cached value until it is invalidated, either by
+     the setter, which always invalidates it, or by
+     JSExport<T>::Invalidate when the native object changes the value
+     itself. Unlike a constant the value is cached for each object, so
+     it may depend on the object's state.
+     
+     A cached object is kept alive until it is invalidated or its
+     JavaScript object is finalized, so don't cache a value that
+     refers back to the JavaScript object.
+     
+     @throws std::invalid_argument under the same preconditions as
+     AddValueProperty.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& AddCachedValueProperty(const JSString& property_name, GetNamedValuePropertyCallback<T> get_callback, SetNamedValuePropertyCallback<T> set_callback = nullptr, bool enumerable = true) {
+      JSPropertyAttributeSet attributes { JSPropertyAttribute::DontDelete };
+      if (!enumerable)   { attributes |= JSPropertyAttribute::DontEnum; }
+      if (!set_callback) { attributes |= JSPropertyAttribute::ReadOnly; }
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      AddCachedValuePropertyCallback(JSExportNamedValuePropertyCallback<T>(property_name, get_callback, set_callback, attributes));
+      return *this;
+    }
+    
     /*!
      @method
      
@@ -345,13 +656,247 @@ namespace HAL { namespace detail {
      @result A reference to the builder for chaining.
      */
     JSExportClassDefinitionBuilder<T>& AddFunctionProperty(const JSString& function_name, CallNamedFunctionCallback<T> function_callback, bool enumerable = true) {
-      std::unordered_set<JSPropertyAttribute> attributes { JSPropertyAttribute::DontDelete, JSPropertyAttribute::ReadOnly };
-      static_cast<void>(!enumerable && attributes.insert(JSPropertyAttribute::DontEnum).second);
+      JSPropertyAttributeSet attributes { JSPropertyAttribute::DontDelete, JSPropertyAttribute::ReadOnly };
+      if (!enumerable) { attributes |= JSPropertyAttribute::DontEnum; }
       HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
       AddFunctionPropertyCallback(JSExportNamedFunctionPropertyCallback<T>(function_name, function_callback, attributes));
       return *this;
     }
     
+    /*!
+     @method
+     
+     @abstract Add a function property to your JavaScript object whose
+     callback receives its arguments as a JSArguments view.
+     
+     @discussion This avoids building a std::vector<JSValue> on every
+     call. For example, given this class definition:
+     
+     class Foo {
+     JSValue Scale(const JSArguments& arguments, JSObject& this_object);
+     };
+     
+     You would call the builer like this:
+     
+     JSClassBuilder<Foo> builder("Foo");
+     builder.AddFunctionProperty("scale", &Foo::Scale);
+     
+     @throws std::invalid_argument exception under these preconditions:
+     
+     1. If function_name is empty.
+     
+     2. If arguments_callback is not provided.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& AddFunctionProperty(const JSString& function_name, CallNamedFunctionArgumentsCallback<T> arguments_callback, bool enumerable = true) {
+      JSPropertyAttributeSet attributes { JSPropertyAttribute::DontDelete, JSPropertyAttribute::ReadOnly };
+      if (!enumerable) { attributes |= JSPropertyAttribute::DontEnum; }
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      AddFunctionPropertyCallback(JSExportNamedFunctionPropertyCallback<T>(function_name, arguments_callback, attributes));
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Add a function property to your JavaScript object that
+     calls an ordinary member function.
+     
+     @discussion The arguments are converted straight from the
+     JavaScriptCore values to the member function's parameter types,
+     and its result is converted back to a JSValue. Parameters and
+     results may be bool, any arithmetic type, std::string, JSString or
+     JSValue, and a void result becomes undefined. Missing arguments
+     are converted from undefined. For example, given this class
+     definition:
+     
+     class Foo {
+     double Scale(double factor, std::int32_t count);
+     };
+     
+     You would call the builer like this:
+     
+     JSClassBuilder<Foo> builder("Foo");
+     builder.AddFunctionProperty("scale", &Foo::Scale);
+     
+     @throws std::invalid_argument exception if function_name is
+     empty.
+     
+     @result A reference to the builder for chaining.
+     */
+    /*!
+     @method
+     
+     @abstract Add a function property bound directly to a member
+     function pointer given as a template argument.
+     
+     @discussion The member function takes either a
+     std::vector<JSValue> or a JSArguments and the 'this' object.
+     JavaScriptCore calls a callback specialized for it, so a call
+     makes no std::function call. For example:
+     
+     builder.AddFunctionProperty<&Foo::Hello>("hello");
+     
+     @result A reference to the builder for chaining.
+     */
+    template<JSValue (T::*Function)(const std::vector<JSValue>&, JSObject&)>
+    JSExportClassDefinitionBuilder<T>& AddFunctionProperty(const JSString& function_name, bool enumerable = true) {
+      AddFunctionProperty(function_name, CallNamedFunctionCallback<T>(std::mem_fn(Function)), enumerable);
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      named_function_property_direct_callback_map__[static_cast<std::string>(function_name)] = JSExportClass<T>::template CallNamedFunctionDirectCallback<JSValue (T::*)(const std::vector<JSValue>&, JSObject&), Function>;
+      return *this;
+    }
+    
+    template<JSValue (T::*Function)(const JSArguments&, JSObject&)>
+    JSExportClassDefinitionBuilder<T>& AddFunctionProperty(const JSString& function_name, bool enumerable = true) {
+      AddFunctionProperty(function_name, CallNamedFunctionArgumentsCallback<T>(std::mem_fn(Function)), enumerable);
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      named_function_property_direct_callback_map__[static_cast<std::string>(function_name)] = JSExportClass<T>::template CallNamedFunctionDirectCallback<JSValue (T::*)(const JSArguments&, JSObject&), Function>;
+      return *this;
+    }
+    
+    template<typename R, typename... Args>
+    typename std::enable_if<!JSNativeMethodIsCallback<Args...>::value, JSExportClassDefinitionBuilder<T>&>::type
+    AddFunctionProperty(const JSString& function_name, R (T::*method)(Args...), bool enumerable = true) {
+      return AddFunctionProperty(function_name, MakeNativeMethodCallback(method), enumerable);
+    }
+    
+    template<typename R, typename... Args>
+    typename std::enable_if<!JSNativeMethodIsCallback<Args...>::value, JSExportClassDefinitionBuilder<T>&>::type
+    AddFunctionProperty(const JSString& function_name, R (T::*method)(Args...) const, bool enumerable = true) {
+      return AddFunctionProperty(function_name, MakeNativeMethodCallback(method), enumerable);
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return an entry of a static table of value properties,
+     bound directly to member function pointers as with the
+     AddValueProperty template above.
+     
+     @discussion A static table describes a class' properties without
+     any work at runtime: no name validation, no std::function and no
+     map insertion. Terminate the table with EndOfStaticValues and
+     pass it to StaticValues. For example:
+     
+     static const ::JSStaticValue foo_values[] = {
+       JSExportClassDefinitionBuilder<Foo>::StaticValue<&Foo::GetName, &Foo::SetName>("name"),
+       JSExportClassDefinitionBuilder<Foo>::StaticValue<&Foo::GetPi>("pi"),
+       JSExportClassDefinitionBuilder<Foo>::EndOfStaticValues()
+     };
+     
+     Properties get the same attributes as with AddValueProperty.
+     */
+    template<JSValue (T::*Getter)() const, bool (T::*Setter)(const JSValue&) = nullptr>
+    static HAL_CONSTEXPR ::JSStaticValue StaticValue(const char* property_name, bool enumerable = true) HAL_NOEXCEPT {
+      return ::JSStaticValue {
+        property_name,
+        &JSExportClass<T>::template GetNamedValuePropertyDirectCallback<JSValue (T::*)() const, Getter>,
+        DirectSetPropertyCallback<Setter>(std::integral_constant<bool, Setter != nullptr>()),
+        StaticValueAttributes(Setter != nullptr, enumerable)
+      };
+    }
+    
+    template<JSValue (T::*Getter)(), bool (T::*Setter)(const JSValue&) = nullptr>
+    static HAL_CONSTEXPR ::JSStaticValue StaticValue(const char* property_name, bool enumerable = true) HAL_NOEXCEPT {
+      return ::JSStaticValue {
+        property_name,
+        &JSExportClass<T>::template GetNamedValuePropertyDirectCallback<JSValue (T::*)(), Getter>,
+        DirectSetPropertyCallback<Setter>(std::integral_constant<bool, Setter != nullptr>()),
+        StaticValueAttributes(Setter != nullptr, enumerable)
+      };
+    }
+    
+    static HAL_CONSTEXPR ::JSStaticValue EndOfStaticValues() HAL_NOEXCEPT {
+      return ::JSStaticValue { nullptr, nullptr, nullptr, kJSPropertyAttributeNone };
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return an entry of a static table of function
+     properties, bound directly to a member function pointer as with
+     the AddFunctionProperty template above. Terminate the table with
+     EndOfStaticFunctions and pass it to StaticFunctions.
+     */
+    template<JSValue (T::*Function)(const std::vector<JSValue>&, JSObject&)>
+    static HAL_CONSTEXPR ::JSStaticFunction StaticFunction(const char* function_name, bool enumerable = true) HAL_NOEXCEPT {
+      return ::JSStaticFunction {
+        function_name,
+        &JSExportClass<T>::template CallNamedFunctionDirectCallback<JSValue (T::*)(const std::vector<JSValue>&, JSObject&), Function>,
+        StaticFunctionAttributes(enumerable)
+      };
+    }
+    
+    template<JSValue (T::*Function)(const JSArguments&, JSObject&)>
+    static HAL_CONSTEXPR ::JSStaticFunction StaticFunction(const char* function_name, bool enumerable = true) HAL_NOEXCEPT {
+      return ::JSStaticFunction {
+        function_name,
+        &JSExportClass<T>::template CallNamedFunctionDirectCallback<JSValue (T::*)(const JSArguments&, JSObject&), Function>,
+        StaticFunctionAttributes(enumerable)
+      };
+    }
+    
+    static HAL_CONSTEXPR ::JSStaticFunction EndOfStaticFunctions() HAL_NOEXCEPT {
+      return ::JSStaticFunction { nullptr, nullptr, kJSPropertyAttributeNone };
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return the static table of value properties, or nullptr.
+     */
+    const ::JSStaticValue* StaticValues() const HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      return static_value_table__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set a static table of value properties built with
+     StaticValue and terminated with EndOfStaticValues.
+     
+     @discussion The table is used as is, so it must outlive the
+     class. Its properties come in addition to those added one at a
+     time, and must not have the same names. If the class has no other
+     value properties, JavaScriptCore reads the table directly.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& StaticValues(const ::JSStaticValue* static_values) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      static_value_table__ = static_values;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return the static table of function properties, or
+     nullptr.
+     */
+    const ::JSStaticFunction* StaticFunctions() const HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      return static_function_table__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set a static table of function properties built with
+     StaticFunction and terminated with EndOfStaticFunctions. The same
+     rules as for StaticValues apply.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& StaticFunctions(const ::JSStaticFunction* static_functions) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      static_function_table__ = static_functions;
+      return *this;
+    }
+    
     /*!
      @method
      
@@ -493,6 +1038,93 @@ namespace HAL { namespace detail {
       return *this;
     }
     
+    /*!
+     @method
+     
+     @abstract Return the callback to invoke when getting an array
+     index property's value from your JavaScript object.
+     
+     @result The callback to invoke when getting an array index
+     property's value from your JavaScript object.
+     */
+    GetIndexedPropertyCallback<T> GetIndexedProperty() const HAL_NOEXCEPT {
+      return get_indexed_property_callback__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the callback to invoke when getting an array index
+     property's value, such as foo[3], from your JavaScript object.
+     
+     @discussion The callback is tried before the GetProperty callback
+     for property names that are canonical array indexes. If it returns
+     native null the request forwards to the GetProperty callback (if
+     any), then to the properties added by the AddValueProperty and
+     AddFunctionProperty methods.
+     
+     For example, given this class definition:
+     
+     class Foo {
+     JSValue GetIndexedProperty(std::uint32_t index) const;
+     };
+     
+     You would call the builer like this:
+     
+     JSClassBuilder<Foo> builder("Foo");
+     builder.GetIndexedProperty(&Foo::GetIndexedProperty);
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& GetIndexedProperty(const GetIndexedPropertyCallback<T>& get_indexed_property_callback) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      get_indexed_property_callback__ = get_indexed_property_callback;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Return the callback to invoke when setting an array
+     index property's value on your JavaScript object.
+     
+     @result The callback to invoke when setting an array index
+     property's value on your JavaScript object.
+     */
+    SetIndexedPropertyCallback<T> SetIndexedProperty() const HAL_NOEXCEPT {
+      return set_indexed_property_callback__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the callback to invoke when setting an array index
+     property's value, such as foo[3] = 42, on your JavaScript object.
+     
+     @discussion The callback is tried before the SetProperty callback
+     for property names that are canonical array indexes. If it returns
+     false the request forwards to the SetProperty callback (if any),
+     then to the properties added by the AddValueProperty method.
+     
+     For example, given this class definition:
+     
+     class Foo {
+     bool SetIndexedProperty(std::uint32_t index, const JSValue& value);
+     };
+     
+     You would call the builer like this:
+     
+     JSClassBuilder<Foo> builder("Foo");
+     builder.SetIndexedProperty(&Foo::SetIndexedProperty);
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& SetIndexedProperty(const SetIndexedPropertyCallback<T>& set_indexed_property_callback) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      set_indexed_property_callback__ = set_indexed_property_callback;
+      return *this;
+    }
+    
     /*!
      @method
      
@@ -678,6 +1310,124 @@ namespace HAL { namespace detail {
       return *this;
     }
     
+    /*!
+     @method
+     
+     @abstract Return the callback to invoke when converting your
+     JavaScript object to a primitive without creating a JSValue.
+     */
+    ConvertToTypePrimitiveCallback<T> ConvertToTypePrimitive() const HAL_NOEXCEPT {
+      return convert_to_type_primitive_callback__;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Set the callback to invoke when converting your
+     JavaScript object to a number or a string, in place of the one
+     set by ConvertToType.
+     
+     @discussion The callback returns a JSExportPrimitive rather than
+     a JSValue, for objects that scripts convert often. For example,
+     given this class definition:
+     
+     class Foo {
+     JSExportPrimitive ConvertToType(JSValue::Type type, const JSObjectView& this_object) const;
+     };
+     
+     You would call the builer like this:
+     
+     JSExportClassDefinitionBuilder<Foo> builder("Foo");
+     builder.ConvertToTypePrimitive(&Foo::ConvertToType);
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& ConvertToTypePrimitive(const ConvertToTypePrimitiveCallback<T>& convert_to_type_primitive_callback) HAL_NOEXCEPT {
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      convert_to_type_primitive_callback__ = convert_to_type_primitive_callback;
+      return *this;
+    }
+    
+    /*!
+     @method
+     
+     @abstract Add a non-enumerable toJSON function property that
+     serializes your JavaScript object with a ToJSONCallback.
+     
+     @discussion JSON.stringify calls toJSON and serializes the plain
+     value it returns, which is parsed from the text the callback
+     wrote, so a whole object costs one call into C++ rather than one
+     per property. For example, given this class definition:
+     
+     class Foo {
+     void ToJSON(JSStringBuilder& json) const;
+     };
+     
+     You would call the builer like this:
+     
+     JSExportClassDefinitionBuilder<Foo> builder("Foo");
+     builder.ToJSON(&Foo::ToJSON);
+     
+     @throws std::invalid_argument exception under these preconditions:
+     
+     1. If to_json_callback is not provided.
+     
+     2. You have already added a property named toJSON.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& ToJSON(const ToJSONCallback<T>& to_json_callback) {
+      if (!to_json_callback) {
+        ThrowInvalidArgument("JSExportClassDefinitionBuilder::ToJSON", "The toJSON callback was not provided.");
+      }
+      
+      return AddFunctionProperty("toJSON", CallNamedFunctionCallback<T>([to_json_callback](T& native_object, const std::vector<JSValue>&, JSObject& this_object) {
+        JSStringBuilder json;
+        to_json_callback(native_object, json);
+        return json.ToJSONValue(this_object.get_context());
+      }), false);
+    }
+    
+    /*!
+     @method
+     
+     @abstract Make your JavaScript objects iterable, by for...of
+     loops, spread and Array.from, through a native cursor that hands
+     JavaScript batch_size values per call into C++.
+     
+     @discussion The first object of your class created in a
+     JSContext defines Symbol.iterator on the class's automatic
+     prototype, or on each object if the class has
+     JSClassAttribute::NoAutomaticPrototype, together with a
+     non-enumerable "@@HAL.iterator" property that marks it as done.
+     Starting an iteration calls iterator_callback for a cursor, and
+     the iterator buffers what the cursor returns so that JavaScript
+     consumes the values one at a time with one crossing per batch.
+     An iteration keeps its object alive, and a loop that exits early
+     stops asking for batches.
+     
+     @throws std::invalid_argument exception under these preconditions:
+     
+     1. If iterator_callback is not provided.
+     
+     2. If batch_size is zero.
+     
+     @result A reference to the builder for chaining.
+     */
+    JSExportClassDefinitionBuilder<T>& Iterator(const IteratorCallback<T>& iterator_callback, std::size_t batch_size) {
+      if (!iterator_callback) {
+        ThrowInvalidArgument("JSExportClassDefinitionBuilder::Iterator", "The iterator callback was not provided.");
+      }
+      if (batch_size == 0) {
+        ThrowInvalidArgument("JSExportClassDefinitionBuilder::Iterator", "The batch size must not be zero.");
+      }
+      
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      iterator_callback__   = iterator_callback;
+      iterator_batch_size__ = batch_size;
+      return *this;
+    }
+    
     /*!
      @method
      
@@ -692,9 +1442,112 @@ namespace HAL { namespace detail {
   private:
     
     void AddConstantPropertyCallback(const JSExportNamedValuePropertyCallback<T>& value_property_callback);
+    void AddCachedValuePropertyCallback(const JSExportNamedValuePropertyCallback<T>& value_property_callback);
     void AddValuePropertyCallback(const JSExportNamedValuePropertyCallback<T>& value_property_callback);
     void AddFunctionPropertyCallback(const JSExportNamedFunctionPropertyCallback<T>& function_property_callback);
     
+    // Add the properties of U's JSExportClassDefinition that T does not
+    // define itself, adapted to take a T.
+    template<typename U>
+    void InheritProperties() {
+      const auto& parent_definition = JSExportClass<U>::js_export_class_definition__;
+      for (const auto& entry : parent_definition.named_value_property_callback_map__) {
+        if (HasNamedProperty(entry.first)) {
+          continue;
+        }
+        
+        const auto get_callback = entry.second.get_callback();
+        const auto set_callback = entry.second.set_callback();
+        named_value_property_callback_map__.emplace(entry.first, JSExportNamedValuePropertyCallback<T>(
+            entry.first,
+            get_callback ? GetNamedValuePropertyCallback<T>([get_callback](T& native_object) { return get_callback(native_object); }) : nullptr,
+            set_callback ? SetNamedValuePropertyCallback<T>([set_callback](T& native_object, const JSValue& value) { return set_callback(native_object, value); }) : nullptr,
+            entry.second.get_attribute_set()));
+        if (parent_definition.named_constants__.find(entry.first) != parent_definition.named_constants__.end()) {
+          named_constants__.insert(entry.first);
+        }
+        if (parent_definition.named_cached_values__.find(entry.first) != parent_definition.named_cached_values__.end()) {
+          named_cached_values__.insert(entry.first);
+          for (const auto& parent_entry : parent_definition.named_value_property_callback_list__) {
+            if (parent_entry.name == entry.first) {
+              const auto parent_value_cache = parent_entry.value_cache;
+              inherited_value_caches__[entry.first] = std::make_pair(parent_entry.cache_index, std::function<JSExportValueCache&(T&)>([parent_value_cache](T& native_object) -> JSExportValueCache& {
+                U& parent_object = native_object;
+                return parent_value_cache ? parent_value_cache(parent_object) : JSExportClass<U>::GetValueCache(parent_object);
+              }));
+              break;
+            }
+          }
+        }
+      }
+      
+      for (const auto& entry : parent_definition.named_function_property_callback_map__) {
+        if (HasNamedProperty(entry.first)) {
+          continue;
+        }
+        
+        const auto function_callback  = entry.second.function_callback();
+        const auto arguments_callback = entry.second.arguments_callback();
+        if (arguments_callback) {
+          named_function_property_callback_map__.emplace(entry.first, JSExportNamedFunctionPropertyCallback<T>(
+              entry.first,
+              CallNamedFunctionArgumentsCallback<T>([arguments_callback](T& native_object, const JSArguments& arguments, JSObject& this_object) { return arguments_callback(native_object, arguments, this_object); }),
+              entry.second.get_attribute_set()));
+        } else {
+          named_function_property_callback_map__.emplace(entry.first, JSExportNamedFunctionPropertyCallback<T>(
+              entry.first,
+              CallNamedFunctionCallback<T>([function_callback](T& native_object, const std::vector<JSValue>& arguments, JSObject& this_object) { return function_callback(native_object, arguments, this_object); }),
+              entry.second.get_attribute_set()));
+        }
+      }
+    }
+    
+    bool HasNamedProperty(const std::string& name) const HAL_NOEXCEPT {
+      return named_value_property_callback_map__.find(name) != named_value_property_callback_map__.end() ||
+             named_function_property_callback_map__.find(name) != named_function_property_callback_map__.end();
+    }
+    
+    static HAL_CONSTEXPR unsigned StaticValueAttributes(bool has_setter, bool enumerable) HAL_NOEXCEPT {
+      return kJSPropertyAttributeDontDelete | (has_setter ? 0 : kJSPropertyAttributeReadOnly) | (enumerable ? 0 : kJSPropertyAttributeDontEnum);
+    }
+    
+    static HAL_CONSTEXPR unsigned StaticFunctionAttributes(bool enumerable) HAL_NOEXCEPT {
+      return kJSPropertyAttributeDontDelete | kJSPropertyAttributeReadOnly | (enumerable ? 0 : kJSPropertyAttributeDontEnum);
+    }
+    
+    template<typename G, G Getter, bool (T::*Setter)(const JSValue&)>
+    JSExportClassDefinitionBuilder<T>& AddDirectValueProperty(const JSString& property_name, bool enumerable) {
+      using has_setter = std::integral_constant<bool, Setter != nullptr>;
+      AddValueProperty(property_name, std::mem_fn(Getter), DirectSetCallback<Setter>(has_setter()), enumerable);
+      HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
+      named_value_property_direct_callback_map__[static_cast<std::string>(property_name)] = std::make_pair(
+          &JSExportClass<T>::template GetNamedValuePropertyDirectCallback<G, Getter>,
+          DirectSetPropertyCallback<Setter>(has_setter()));
+      return *this;
+    }
+    
+    // The setter of AddDirectValueProperty and StaticValue is chosen at
+    // compile time, since a read-only property has none to wrap.
+    template<bool (T::*Setter)(const JSValue&)>
+    static SetNamedValuePropertyCallback<T> DirectSetCallback(std::true_type) {
+      return SetNamedValuePropertyCallback<T>(std::mem_fn(Setter));
+    }
+    
+    template<bool (T::*Setter)(const JSValue&)>
+    static SetNamedValuePropertyCallback<T> DirectSetCallback(std::false_type) {
+      return SetNamedValuePropertyCallback<T>();
+    }
+    
+    template<bool (T::*Setter)(const JSValue&)>
+    static HAL_CONSTEXPR ::JSObjectSetPropertyCallback DirectSetPropertyCallback(std::true_type) HAL_NOEXCEPT {
+      return &JSExportClass<T>::template SetNamedValuePropertyDirectCallback<Setter>;
+    }
+    
+    template<bool (T::*Setter)(const JSValue&)>
+    static HAL_CONSTEXPR ::JSObjectSetPropertyCallback DirectSetPropertyCallback(std::false_type) HAL_NOEXCEPT {
+      return nullptr;
+    }
+    
     // JSExportClassDefinition needs access to js_class_definition__ in
     // accordance with the Builder Pattern.
     template<typename U>
@@ -704,15 +1557,36 @@ namespace HAL { namespace detail {
     std::string                                   name__;
     JSClass                                       parent__;
     std::unordered_set<std::string>               named_constants__;
+    std::unordered_set<std::string>               named_cached_values__;
+    
+    // The cache index and cache of each cached value property inherited
+    // from a flattened parent, see JSExportNamedValuePropertyEntry.
+    std::unordered_map<std::string, std::pair<std::size_t, std::function<JSExportValueCache&(T&)>>> inherited_value_caches__;
     JSExportNamedValuePropertyCallbackMap_t<T>    named_value_property_callback_map__;
     JSExportNamedFunctionPropertyCallbackMap_t<T> named_function_property_callback_map__;
+    std::unordered_map<std::string, std::pair<::JSObjectGetPropertyCallback, ::JSObjectSetPropertyCallback>> named_value_property_direct_callback_map__;
+    std::unordered_map<std::string, ::JSObjectCallAsFunctionCallback> named_function_property_direct_callback_map__;
+    const ::JSStaticValue*                        static_value_table__           { nullptr };
+    const ::JSStaticFunction*                     static_function_table__        { nullptr };
+    void (JSExportClassDefinitionBuilder<T>::*inherit_properties__)()              { nullptr };
     HasPropertyCallback<T>                        has_property_callback__        { nullptr };
     GetPropertyCallback<T>                        get_property_callback__        { nullptr };
     SetPropertyCallback<T>                        set_property_callback__        { nullptr };
+    GetIndexedPropertyCallback<T>                 get_indexed_property_callback__ { nullptr };
+    SetIndexedPropertyCallback<T>                 set_indexed_property_callback__ { nullptr };
     DeletePropertyCallback<T>                     delete_property_callback__     { nullptr };
     GetPropertyNamesCallback<T>                   get_property_names_callback__  { nullptr };
     CallAsFunctionCallback<T>                     call_as_function_callback__    { nullptr };
     ConvertToTypeCallback<T>                      convert_to_type_callback__     { nullptr };
+    ConvertToTypePrimitiveCallback<T>             convert_to_type_primitive_callback__ { nullptr };
+    bool                                          pin_constants__                { false };
+    bool                                          track_dirty__                  { false };
+    std::size_t                                   negative_property_cache_capacity__ { 0 };
+    std::size_t                                   hot_property_name_threshold__ { 0 };
+    bool                                          deferred_finalization__        { false };
+    std::size_t                                   recycle_capacity__             { 0 };
+    IteratorCallback<T>                           iterator_callback__            { nullptr };
+    std::size_t                                   iterator_batch_size__          { 0 };
 
     HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_MUTEX;
   };
@@ -737,6 +1611,12 @@ namespace HAL { namespace detail {
     AddValuePropertyCallback(value_property_callback);
   } 
 
+  template<typename T>
+  void JSExportClassDefinitionBuilder<T>::AddCachedValuePropertyCallback(const JSExportNamedValuePropertyCallback<T>& value_property_callback) {
+    AddValuePropertyCallback(value_property_callback);
+    named_cached_values__.emplace(value_property_callback.get_name());
+  }
+
   template<typename T>
   void JSExportClassDefinitionBuilder<T>::AddValuePropertyCallback(const JSExportNamedValuePropertyCallback<T>& value_property_callback) {
     const std::string internal_component_name = "JSExportClassDefinitionBuilder<" + name__ + ">::AddValuePropertyCallback";
@@ -780,6 +1660,10 @@ namespace HAL { namespace detail {
     HAL_DETAIL_JSEXPORTCLASSDEFINITIONBUILDER_LOCK_GUARD;
     const std::string internal_component_name = "JSExportClassDefinitionBuilder<" + name__ + ">::build()";
     
+    if (inherit_properties__) {
+      (this ->* inherit_properties__)();
+    }
+    
     js_class_definition__.className         = name__.c_str();
     js_class_definition__.parentClass       = static_cast<JSClassRef>(parent__);
     js_class_definition__.initialize        = JSExportClass<T>::JSObjectInitializeCallback;
@@ -791,11 +1675,11 @@ namespace HAL { namespace detail {
       js_class_definition__.hasProperty = JSExportClass<T>::JSObjectHasPropertyCallback;
     }
     
-    if (get_property_callback__) {
+    if (get_property_callback__ || get_indexed_property_callback__) {
       js_class_definition__.getProperty = JSExportClass<T>::JSObjectGetPropertyCallback;
     }
     
-    if (set_property_callback__) {
+    if (set_property_callback__ || set_indexed_property_callback__) {
       js_class_definition__.setProperty = JSExportClass<T>::JSObjectSetPropertyCallback;
     }
     
@@ -811,7 +1695,7 @@ namespace HAL { namespace detail {
       js_class_definition__.callAsFunction = JSExportClass<T>::JSObjectCallAsFunctionCallback;
     }
     
-    if (convert_to_type_callback__) {
+    if (convert_to_type_callback__ || convert_to_type_primitive_callback__) {
       js_class_definition__.convertToType = JSExportClass<T>::JSObjectConvertToTypeCallback;
     }
     
@@ -822,15 +1706,62 @@ namespace HAL { namespace detail {
   JSExportClassDefinition<T>::JSExportClassDefinition(const JSExportClassDefinitionBuilder<T>& builder)
   : JSClassDefinition(builder.js_class_definition__)
   , named_constants__(builder.named_constants__)
+  , named_cached_values__(builder.named_cached_values__)
   , named_value_property_callback_map__(builder.named_value_property_callback_map__)
   , named_function_property_callback_map__(builder.named_function_property_callback_map__)
   , has_property_callback__(builder.has_property_callback__)
   , get_property_callback__(builder.get_property_callback__)
   , set_property_callback__(builder.set_property_callback__)
+  , get_indexed_property_callback__(builder.get_indexed_property_callback__)
+  , set_indexed_property_callback__(builder.set_indexed_property_callback__)
   , delete_property_callback__(builder.delete_property_callback__)
   , get_property_names_callback__(builder.get_property_names_callback__)
   , call_as_function_callback__(builder.call_as_function_callback__)
-  , convert_to_type_callback__(builder.convert_to_type_callback__) {
+  , convert_to_type_callback__(builder.convert_to_type_callback__)
+  , convert_to_type_primitive_callback__(builder.convert_to_type_primitive_callback__)
+  , pin_constants__(builder.pin_constants__)
+  , track_dirty__(builder.track_dirty__)
+  , negative_property_cache_capacity__(builder.negative_property_cache_capacity__)
+  , hot_property_name_threshold__(builder.hot_property_name_threshold__)
+  , deferred_finalization__(builder.deferred_finalization__)
+  , recycle_capacity__(builder.recycle_capacity__)
+  , iterator_callback__(builder.iterator_callback__)
+  , iterator_batch_size__(builder.iterator_batch_size__)
+  , static_value_table__(builder.static_value_table__)
+  , static_function_table__(builder.static_function_table__) {
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+    // Direct callbacks don't know their entry, so profiled properties
+    // all go through the trampolines, which count them.
+    const decltype(builder.named_value_property_direct_callback_map__)    named_value_property_direct_callback_map;
+    const decltype(builder.named_function_property_direct_callback_map__) named_function_property_direct_callback_map;
+#else
+    // Direct setters don't know their entry either, so the value
+    // properties of a class that tracks writes go through the
+    // trampolines, which mark them.
+    const decltype(builder.named_value_property_direct_callback_map__) no_named_value_property_direct_callbacks;
+    const auto& named_value_property_direct_callback_map    = builder.track_dirty__ ? no_named_value_property_direct_callbacks : builder.named_value_property_direct_callback_map__;
+    const auto& named_function_property_direct_callback_map = builder.named_function_property_direct_callback_map__;
+#endif
+    
+    for (const auto& entry : named_value_property_callback_map__) {
+      const bool constant  = named_constants__.find(entry.first) != named_constants__.end();
+      const bool cached    = named_cached_values__.find(entry.first) != named_cached_values__.end();
+      const auto direct    = named_value_property_direct_callback_map.find(entry.first);
+      const auto callbacks = direct != named_value_property_direct_callback_map.end() ? direct -> second : std::make_pair<::JSObjectGetPropertyCallback, ::JSObjectSetPropertyCallback>(nullptr, nullptr);
+      const auto index     = named_value_property_callback_list__.size();
+      const auto inherited = builder.inherited_value_caches__.find(entry.first);
+      if (cached && inherited != builder.inherited_value_caches__.end()) {
+        named_value_property_callback_list__.push_back(JSExportNamedValuePropertyEntry<T> { entry.first, entry.second, constant, cached, index, callbacks.first, callbacks.second, inherited -> second.first, inherited -> second.second });
+      } else {
+        named_value_property_callback_list__.push_back(JSExportNamedValuePropertyEntry<T> { entry.first, entry.second, constant, cached, index, callbacks.first, callbacks.second, index, nullptr });
+      }
+    }
+    
+    for (const auto& entry : named_function_property_callback_map__) {
+      const auto direct   = named_function_property_direct_callback_map.find(entry.first);
+      const auto callback = direct != named_function_property_direct_callback_map.end() ? direct -> second : nullptr;
+      named_function_property_callback_list__.push_back(JSExportNamedFunctionPropertyEntry<T> { entry.first, entry.second, callback });
+    }
     InitializeNamedPropertyCallbacks();
   }
   
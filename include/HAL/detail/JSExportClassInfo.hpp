@@ -0,0 +1,146 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTCLASSINFO_HPP_
+#define _HAL_DETAIL_JSEXPORTCLASSINFO_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSExportClassBudget.hpp"
+#include "HAL/detail/JSLatencyHistogram.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportClassInfo identifies a JSExport class and its
+   chain of parent classes as a Cohen display: display[i] is the
+   ancestor at depth i and display[depth] is the class itself. Every
+   native object records the JSExportClassInfo of its class, so
+   'instanceof' is two loads and a compare instead of a dynamic_cast.
+
+   The parent chain is the one given with
+   JSExportClassDefinitionBuilder::Parent (JSExport<T>::SetParent).
+
+   It also counts the live and finalized instances of the class and
+   the external memory they reported, with relaxed atomics so that counting costs
+   no lock, and holds the class' soft budget. With
+   HAL_CALLBACK_LATENCY_ENABLE it also holds a latency histogram for
+   each JSExportCallbackKind.
+   */
+  struct JSExportClassInfo {
+    std::size_t                           depth { 0 };
+    std::vector<const JSExportClassInfo*> display;
+
+    // The JSClass the class was registered with. Every native object
+    // of a class or of its subclasses is of the JSClass of display[0],
+    // so that JSClass tells whether private data has a native object
+    // header.
+    JSClassRef                            js_class_ref { nullptr };
+
+    // The size of a native object and its header.
+    std::size_t                           instance_size { 0 };
+
+    mutable std::atomic<std::size_t>      live_count { 0 };
+    mutable std::atomic<std::size_t>      external_memory_bytes { 0 };
+    mutable std::atomic<std::uint64_t>    finalized_count { 0 };
+
+    // The budget is only loaded when has_budget is set, and
+    // over_budget makes its callback fire once per excursion.
+    std::shared_ptr<const JSExportClassBudget> budget;
+    std::atomic<bool>                     has_budget { false };
+    mutable std::atomic<bool>             over_budget { false };
+
+    // The name given with JSExportClassDefinitionBuilder::ClassName.
+    std::string                           name;
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+    mutable JSLatencyHistogram            callback_latency[kJSExportCallbackKindCount];
+#endif
+
+    bool IsSubclassOf(const JSExportClassInfo& ancestor) const HAL_NOEXCEPT {
+      return depth >= ancestor.depth && display[ancestor.depth] == &ancestor;
+    }
+  };
+
+  /*!
+   @function
+
+   @abstract Make class_info the JSExportClassInfo of the JSClassRef
+   and extend the display of its parent, if the parent is a
+   registered JSExport class.
+   */
+  HAL_EXPORT void RegisterJSExportClassInfo(JSClassRef js_class_ref, JSClassRef parent_js_class_ref, JSExportClassInfo& class_info);
+
+  /*!
+   @function
+
+   @abstract Return the JSExportClassInfo registered for a JSClassRef,
+   or nullptr.
+   */
+  HAL_EXPORT const JSExportClassInfo* FindJSExportClassInfo(JSClassRef js_class_ref);
+
+  /*!
+   @function
+
+   @abstract Count a new live instance of a class, calling its budget
+   callback if that takes it over budget.
+   */
+  HAL_EXPORT void AddJSExportClassInstance(const JSExportClassInfo& class_info) HAL_NOEXCEPT;
+
+  // Count the finalization of an instance of a class.
+  HAL_EXPORT void RemoveJSExportClassInstance(const JSExportClassInfo& class_info) HAL_NOEXCEPT;
+
+  /*!
+   @function
+
+   @abstract Add byte_delta, which may be negative, to the external
+   memory of a class, calling its budget callback if that takes it
+   over budget.
+   */
+  HAL_EXPORT void AdjustJSExportClassExternalMemory(const JSExportClassInfo& class_info, std::ptrdiff_t byte_delta) HAL_NOEXCEPT;
+
+  HAL_EXPORT JSExportClassStatistics GetJSExportClassStatistics(const JSExportClassInfo& class_info) HAL_NOEXCEPT;
+
+  // Return the JSExportClassInfo of every registered class.
+  HAL_EXPORT std::vector<const JSExportClassInfo*> GetJSExportClassInfos();
+
+  // Replace the budget of a class. Budgets are set at startup, so
+  // this may race with the callback of the budget it replaces.
+  HAL_EXPORT void SetJSExportClassBudget(JSExportClassInfo& class_info, const JSExportClassBudget& budget);
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+  // A callback kind of a class that has been called.
+  struct JSCallbackLatency {
+    std::string               class_name;
+    JSExportCallbackKind      kind;
+    const JSLatencyHistogram* histogram;
+  };
+
+  /*!
+   @function
+
+   @abstract Return the latency histograms of every registered class
+   and callback kind that recorded a call, the one with the most total
+   time first.
+   */
+  HAL_EXPORT std::vector<JSCallbackLatency> GetCallbackLatencies();
+
+  // Reset the latency histograms of every registered class.
+  HAL_EXPORT void ResetCallbackLatencies();
+#endif
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTCLASSINFO_HPP_
@@ -0,0 +1,189 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTCONSTANTCACHE_HPP_
+#define _HAL_DETAIL_JSEXPORTCONSTANTCACHE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportConstantCache is the least-recently-used
+   cache of constant property values of one JSExport class.
+
+   Entries are keyed by the global JSContext and the index of the
+   property in the class definition, so a value computed in one
+   JSContext is never returned in another. A hit, an insert and an
+   eviction are all O(1): the entries live in a list ordered from least
+   to most recently used, and a hash map from key to list position
+   finds them.
+
+   A cached JSValue keeps its JSContext alive until it is evicted.
+
+   All live caches are linked together so that
+   JSContextGroup::GetStatistics can count their entries and
+   JSMemoryPressure can evict them.
+   */
+  class HAL_EXPORT JSExportConstantCache final {
+
+  public:
+
+    struct Statistics {
+      std::uint64_t hits      { 0 };
+      std::uint64_t misses    { 0 };
+      std::uint64_t evictions { 0 };
+    };
+
+    explicit JSExportConstantCache(std::size_t capacity = 16);
+    ~JSExportConstantCache() HAL_NOEXCEPT;
+
+    JSExportConstantCache(const JSExportConstantCache&)            = delete;
+    JSExportConstantCache& operator=(const JSExportConstantCache&) = delete;
+
+    /*!
+     @method
+
+     @abstract Return the cached value of a property and mark it most
+     recently used, or nullptr if it isn't cached. Counts a hit or a
+     miss.
+     */
+    const JSValue* Find(JSContextRef js_context_ref, std::size_t index);
+
+    /*!
+     @method
+
+     @abstract Cache the value of a property, evicting the least
+     recently used entry if the cache is full.
+     */
+    void Insert(JSContextRef js_context_ref, std::size_t index, const JSValue& js_value);
+
+    /*!
+     @method
+
+     @abstract Evict the least recently used entry, if any.
+     */
+    void EvictLeastRecentlyUsed();
+
+    /*!
+     @method
+
+     @abstract Evict fraction of the entries, least recently used
+     first, and return the approximate bytes they used.
+     */
+    std::size_t Evict(double fraction);
+
+    /*!
+     @method
+
+     @abstract Evict every entry, or only those of one JSContext.
+     */
+    void Clear();
+    void Clear(JSContextRef js_context_ref);
+
+    /*!
+     @method
+
+     @abstract Set the maximum number of entries. This clears the
+     cache.
+     */
+    void set_capacity(std::size_t capacity);
+
+    std::size_t capacity() const HAL_NOEXCEPT {
+      return capacity__;
+    }
+
+    std::size_t size() const HAL_NOEXCEPT {
+      return map__.size();
+    }
+
+    /*!
+     @method
+
+     @abstract Return the property indexes of all entries, most
+     recently used first.
+     */
+    std::vector<std::size_t> GetIndexes() const;
+
+    Statistics get_statistics() const HAL_NOEXCEPT {
+      return statistics__;
+    }
+
+    void ResetStatistics() HAL_NOEXCEPT {
+      statistics__ = Statistics();
+    }
+
+    /*!
+     @method
+
+     @abstract Return the number of entries of all live caches.
+     */
+    static std::size_t GetTotalSize();
+
+    /*!
+     @method
+
+     @abstract Evict fraction of the entries of every live cache and
+     return the approximate bytes they used.
+     */
+    static std::size_t EvictAll(double fraction);
+
+  private:
+
+    struct Key {
+      JSGlobalContextRef js_context_ref;
+      std::size_t        index;
+
+      bool operator==(const Key& rhs) const HAL_NOEXCEPT {
+        return js_context_ref == rhs.js_context_ref && index == rhs.index;
+      }
+    };
+
+    struct KeyHash {
+      std::size_t operator()(const Key& key) const HAL_NOEXCEPT {
+        return std::hash<const void*>()(key.js_context_ref) ^ (key.index * 0x9E3779B9u);
+      }
+    };
+
+    struct Node {
+      Key     key;
+      JSValue js_value;
+    };
+
+    static Key MakeKey(JSContextRef js_context_ref, std::size_t index) HAL_NOEXCEPT {
+      return Key { JSContextGetGlobalContext(js_context_ref), index };
+    }
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::size_t                                                capacity__;
+    std::list<Node>                                            list__;
+    std::unordered_map<Key, std::list<Node>::iterator, KeyHash> map__;
+    Statistics                                                 statistics__;
+
+    // Links in the list of all live caches.
+    JSExportConstantCache*                                     previous__ { nullptr };
+    JSExportConstantCache*                                     next__     { nullptr };
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTCONSTANTCACHE_HPP_
@@ -0,0 +1,85 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTDIRTYLIST_HPP_
+#define _HAL_DETAIL_JSEXPORTDIRTYLIST_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSExportDirtySet.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportDirtyList holds the native objects of one
+   JSExport class whose JSExportDirtySet has a bit set, in the order
+   they were first written, so that draining them visits only the
+   objects JavaScript changed.
+
+   An object is pushed when its set goes from clean to dirty, and
+   removed when it is popped or destroyed, so it is on the list at most
+   once.
+
+   When HAL_THREAD_SAFE_STATICS is defined the list has its own mutex,
+   which also guards taking an object's bits as it is popped.
+   */
+  class HAL_EXPORT JSExportDirtyList final {
+
+  public:
+
+    JSExportDirtyList() HAL_NOEXCEPT {
+    }
+
+    JSExportDirtyList(const JSExportDirtyList&)            = delete;
+    JSExportDirtyList& operator=(const JSExportDirtyList&) = delete;
+
+    // Set the bit of a property of native_object, and push it if its
+    // set was clean.
+    void Mark(JSExportDirtySet& dirty_set, void* native_object, std::size_t index);
+
+    // Remove an object whose JSObject or native object goes away while
+    // it is dirty, clearing its bits.
+    void Remove(JSExportDirtySet& dirty_set) HAL_NOEXCEPT;
+
+    // Pop the oldest dirty object, moving the indexes of its set bits
+    // to indexes, or return nullptr if there is none.
+    void* Pop(std::vector<std::size_t>& indexes);
+
+    std::size_t size() const;
+
+  private:
+
+    struct Entry {
+      JSExportDirtySet* dirty_set;
+      void*             native_object;
+    };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::deque<Entry> entries__;
+
+#undef HAL_DETAIL_JSEXPORTDIRTYLIST_LOCK_GUARD
+#ifdef HAL_THREAD_SAFE_STATICS
+    mutable JSMutex   mutex__ HAL_LOCK_CLASS_NAME(JSExportDirtyList, "JSExportDirtyList");
+#define HAL_DETAIL_JSEXPORTDIRTYLIST_LOCK_GUARD std::lock_guard<JSMutex> lock(mutex__)
+#else
+#define HAL_DETAIL_JSEXPORTDIRTYLIST_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTDIRTYLIST_HPP_
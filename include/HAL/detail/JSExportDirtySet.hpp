@@ -0,0 +1,106 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTDIRTYSET_HPP_
+#define _HAL_DETAIL_JSEXPORTDIRTYSET_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportDirtySet holds one bit per value property of
+   one native object, see JSExport<T>::SetTrackDirty, keyed by the
+   index of the property in the class definition. A bit is set when
+   JavaScript writes the property, and cleared when the native object
+   is drained.
+
+   The words are only allocated by the first write, so native objects
+   that are never written pay for an empty vector.
+
+   Copying a native object doesn't copy its dirty bits, since they
+   belong to the JavaScript object of the original.
+   */
+  class JSExportDirtySet final {
+
+  public:
+
+    JSExportDirtySet() HAL_NOEXCEPT {
+    }
+
+    JSExportDirtySet(const JSExportDirtySet&) HAL_NOEXCEPT {
+    }
+
+    JSExportDirtySet& operator=(const JSExportDirtySet&) HAL_NOEXCEPT {
+      return *this;
+    }
+
+    // Set the bit of a property, and return whether the set was clean,
+    // i.e. whether the object must be put on its class' dirty list.
+    bool Mark(std::size_t index) {
+      const auto word = index / 64;
+      if (word >= words__.size()) {
+        words__.resize(word + 1, 0);
+      }
+      words__[word] |= std::uint64_t(1) << (index % 64);
+
+      const bool was_clean = !is_dirty__;
+      is_dirty__ = true;
+      return was_clean;
+    }
+
+    bool IsMarked(std::size_t index) const HAL_NOEXCEPT {
+      const auto word = index / 64;
+      return word < words__.size() && (words__[word] & (std::uint64_t(1) << (index % 64))) != 0;
+    }
+
+    bool is_dirty() const HAL_NOEXCEPT {
+      return is_dirty__;
+    }
+
+    void Clear() HAL_NOEXCEPT {
+      words__.clear();
+      is_dirty__ = false;
+    }
+
+    // Append the indexes of the set bits in increasing order, and clear
+    // them.
+    void Take(std::vector<std::size_t>& indexes) {
+      for (std::size_t word = 0; word < words__.size(); ++word) {
+        for (auto bits = words__[word]; bits != 0; bits &= bits - 1) {
+          std::size_t bit = 0;
+          while (!(bits & (std::uint64_t(1) << bit))) {
+            ++bit;
+          }
+          indexes.push_back(word * 64 + bit);
+        }
+        words__[word] = 0;
+      }
+      is_dirty__ = false;
+    }
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::vector<std::uint64_t> words__;
+    bool                       is_dirty__ { false };
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTDIRTYSET_HPP_
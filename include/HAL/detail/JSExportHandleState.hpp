@@ -0,0 +1,88 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTHANDLESTATE_HPP_
+#define _HAL_DETAIL_JSEXPORTHANDLESTATE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportHandleState is the intrusive reference count
+   of the JSExportHandles of one native object, see
+   JSObject::GetPrivateHandle.
+
+   The first handle protects the native object's JSObjectRef and
+   retains its global context, and the last one unprotects and
+   releases them, so copying or destroying any other handle is a
+   single atomic increment or decrement. The count is a null pointer
+   until the first handle is created.
+
+   Copying a native object doesn't copy its handles, since they keep
+   the JavaScript object of the original alive.
+   */
+  class HAL_EXPORT JSExportHandleState final {
+
+  public:
+
+    JSExportHandleState() HAL_NOEXCEPT {
+    }
+
+    JSExportHandleState(const JSExportHandleState&) HAL_NOEXCEPT {
+    }
+
+    JSExportHandleState& operator=(const JSExportHandleState&) HAL_NOEXCEPT {
+      return *this;
+    }
+
+    ~JSExportHandleState() HAL_NOEXCEPT;
+
+    // Count a handle created from a JSObject of js_context_ref, and
+    // protect js_object_ref if it is the only one.
+    void Retain(JSContextRef js_context_ref, JSObjectRef js_object_ref);
+
+    // Count a copy of a handle, which means the count isn't zero.
+    void RetainCopy() HAL_NOEXCEPT {
+      counts__ -> count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Uncount a handle, and unprotect the JSObjectRef if it was the
+    // last one.
+    void Release() HAL_NOEXCEPT;
+
+    std::uint32_t get_count() const HAL_NOEXCEPT {
+      return counts__ ? counts__ -> count.load(std::memory_order_relaxed) : 0;
+    }
+
+  private:
+
+    struct Counts {
+      std::atomic<std::uint32_t> count { 0 };
+
+      // Set while the JSObjectRef is protected.
+      JSGlobalContextRef         js_global_context_ref { nullptr };
+      JSObjectRef                js_object_ref         { nullptr };
+    };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    Counts* counts__ { nullptr };
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTHANDLESTATE_HPP_
@@ -0,0 +1,119 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_HPP_
+#define _HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSString.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportHotPropertyNameCache counts the property
+   names passed to the HasProperty, GetProperty and SetProperty
+   callbacks of one JSExport class, and once a name has been seen
+   threshold times interns it in a small inline cache.
+
+   Later lookups of an interned name hand the callbacks the interned
+   JSString, whose UTF-8 form and hash are already computed, instead of
+   a fresh one that converts the name again on every access. Since the
+   same JSString is passed each time, the callbacks may also recognize
+   it by comparing JSStringRefs.
+
+   JavaScriptCore passes a new JSStringRef for most accesses, so an
+   incoming name is first compared by pointer with the interned one and
+   then by its UTF-16 characters. At most kCapacity names are interned,
+   first come first served, and they stay interned until
+   set_threshold is called.
+
+   A threshold of 0, the default, disables the cache. The threshold is
+   read before the lock is taken, so a class with the cache disabled
+   doesn't lock at all.
+   */
+  class HAL_EXPORT JSExportHotPropertyNameCache final {
+
+  public:
+
+    static const std::size_t kCapacity = 8;
+
+    explicit JSExportHotPropertyNameCache(std::size_t threshold = 0);
+
+    JSExportHotPropertyNameCache(const JSExportHotPropertyNameCache&)            = delete;
+    JSExportHotPropertyNameCache& operator=(const JSExportHotPropertyNameCache&) = delete;
+
+    /*!
+     @method
+
+     @abstract Return the interned JSString for the property name, or
+     nullptr if it isn't hot yet, in which case the name is counted.
+     */
+    const JSString* Find(JSStringRef property_name_ref);
+
+    /*!
+     @method
+
+     @abstract Set the number of lookups after which a name is
+     interned. 0 disables the cache. This forgets every name, so it
+     must not be called while a callback may be using an interned
+     JSString.
+     */
+    void set_threshold(std::size_t threshold);
+
+    std::size_t threshold() const HAL_NOEXCEPT {
+      return threshold__.load(std::memory_order_relaxed);
+    }
+
+    // The number of interned names.
+    std::size_t size() const;
+
+  private:
+
+    // The most names counted at once. When more are seen the counts
+    // start over.
+    static const std::size_t kMaxCandidates = 256;
+
+    static std::uint64_t Hash(const JSChar* characters, std::size_t length) HAL_NOEXCEPT;
+
+    struct Entry {
+      JSStringRef   js_string_ref { nullptr };
+      const JSChar* characters    { nullptr };
+      std::size_t   length        { 0 };
+    };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::atomic<std::size_t>                     threshold__;
+    std::size_t                                  size__ { 0 };
+    std::array<Entry, kCapacity>                 entries__;
+    std::array<JSString, kCapacity>              names__;
+    std::unordered_map<std::uint64_t, std::size_t> counts__;
+
+#undef HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_LOCK_GUARD
+#ifdef HAL_THREAD_SAFE_STATICS
+    mutable JSMutex                              mutex__ HAL_LOCK_CLASS_NAME(JSExportHotPropertyNameCache, "JSExportHotPropertyNameCache");
+#define HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_LOCK_GUARD std::lock_guard<JSMutex> lock(mutex__)
+#else
+#define HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_HPP_
@@ -0,0 +1,86 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTNAMETABLE_HPP_
+#define _HAL_DETAIL_JSEXPORTNAMETABLE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportNameTable maps the property names of a
+   JSExport class to their index in the class definition.
+
+   The names are fixed once the JSExportClassDefinition is built, so
+   they are stored as UTF-16 code units in one contiguous buffer with
+   a table of entries sorted by length and then by code units. Looking
+   up a JSStringRef is a binary search that compares the code units
+   JavaScriptCore already has, so it neither allocates nor converts
+   the name to UTF-8.
+   */
+  class HAL_EXPORT JSExportNameTable final {
+
+  public:
+
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    JSExportNameTable() HAL_NOEXCEPT {
+    }
+
+    /*!
+     @method
+
+     @abstract Create a table mapping names[i] to i.
+     */
+    explicit JSExportNameTable(const std::vector<std::string>& names);
+
+    /*!
+     @method
+
+     @abstract Return the index of a name, or npos if the table doesn't
+     contain it.
+     */
+    std::size_t Find(JSStringRef name_ref) const HAL_NOEXCEPT;
+    std::size_t Find(const JSChar* name, std::size_t length) const HAL_NOEXCEPT;
+
+    std::size_t size() const HAL_NOEXCEPT {
+      return entries__.size();
+    }
+
+  private:
+
+    struct Entry {
+      std::uint32_t offset;
+      std::uint32_t length;
+      std::uint32_t index;
+    };
+
+    // Return < 0, 0 or > 0 as entry sorts before, equal to or after
+    // name.
+    int Compare(const Entry& entry, const JSChar* name, std::size_t length) const HAL_NOEXCEPT;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::vector<JSChar> characters__;
+    std::vector<Entry>  entries__;
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTNAMETABLE_HPP_
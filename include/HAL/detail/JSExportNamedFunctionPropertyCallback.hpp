@@ -71,12 +71,46 @@ namespace HAL { namespace detail {
      */
     JSExportNamedFunctionPropertyCallback(const std::string& function_name,
                                           CallNamedFunctionCallback<T> function_callback,
-                                          const std::unordered_set<JSPropertyAttribute>& attributes);
+                                          JSPropertyAttributeSet attributes);
     
-    CallNamedFunctionCallback<T> function_callback() const {
+    /*!
+     @method
+     
+     @abstract Create a callback that receives its arguments as a
+     JSArguments view.
+     
+     @throws std::invalid_argument exception under these
+     preconditions:
+     
+     1. If function_name is empty.
+     
+     2. If the arguments_callback is not provided.
+     */
+    JSExportNamedFunctionPropertyCallback(const std::string& function_name,
+                                          CallNamedFunctionArgumentsCallback<T> arguments_callback,
+                                          JSPropertyAttributeSet attributes);
+    
+    /*!
+     @method
+     
+     @abstract Return the vector-of-JSValue callback, which is empty
+     if this callback was created with a
+     CallNamedFunctionArgumentsCallback.
+     */
+    const CallNamedFunctionCallback<T>& function_callback() const HAL_NOEXCEPT {
       return function_callback__;
     }
     
+    /*!
+     @method
+     
+     @abstract Return the JSArguments callback, which is empty if this
+     callback was created with a CallNamedFunctionCallback.
+     */
+    const CallNamedFunctionArgumentsCallback<T>& arguments_callback() const HAL_NOEXCEPT {
+      return arguments_callback__;
+    }
+    
     ~JSExportNamedFunctionPropertyCallback()                                                       = default;
     JSExportNamedFunctionPropertyCallback(const JSExportNamedFunctionPropertyCallback&)            HAL_NOEXCEPT;
     JSExportNamedFunctionPropertyCallback(JSExportNamedFunctionPropertyCallback&&)                 HAL_NOEXCEPT;
@@ -89,14 +123,15 @@ namespace HAL { namespace detail {
     template<typename U>
     friend bool operator==(const JSExportNamedFunctionPropertyCallback<U>& lhs, const JSExportNamedFunctionPropertyCallback<U>& rhs) HAL_NOEXCEPT;
     
-    CallNamedFunctionCallback<T> function_callback__ { nullptr };
+    CallNamedFunctionCallback<T>          function_callback__  { nullptr };
+    CallNamedFunctionArgumentsCallback<T> arguments_callback__ { nullptr };
   };
   
   template<typename T>
   JSExportNamedFunctionPropertyCallback<T>::JSExportNamedFunctionPropertyCallback(
                                                                                   const std::string& function_name,
                                                                                   CallNamedFunctionCallback<T> function_callback,
-                                                                                  const std::unordered_set<JSPropertyAttribute>& attributes)
+                                                                                  JSPropertyAttributeSet attributes)
   : JSPropertyCallback(function_name, attributes)
   , function_callback__(function_callback) {
     
@@ -105,23 +140,38 @@ namespace HAL { namespace detail {
     }
   }
   
+  template<typename T>
+  JSExportNamedFunctionPropertyCallback<T>::JSExportNamedFunctionPropertyCallback(
+                                                                                  const std::string& function_name,
+                                                                                  CallNamedFunctionArgumentsCallback<T> arguments_callback,
+                                                                                  JSPropertyAttributeSet attributes)
+  : JSPropertyCallback(function_name, attributes)
+  , arguments_callback__(arguments_callback) {
+    if (!arguments_callback) {
+      ThrowInvalidArgument("JSExportNamedFunctionPropertyCallback", "arguments_callback is missing");
+    }
+  }
+  
   template<typename T>
   JSExportNamedFunctionPropertyCallback<T>::JSExportNamedFunctionPropertyCallback(const JSExportNamedFunctionPropertyCallback& rhs) HAL_NOEXCEPT
   : JSPropertyCallback(rhs)
-  , function_callback__(rhs.function_callback__) {
+  , function_callback__(rhs.function_callback__)
+  , arguments_callback__(rhs.arguments_callback__) {
   }
   
   template<typename T>
   JSExportNamedFunctionPropertyCallback<T>::JSExportNamedFunctionPropertyCallback(JSExportNamedFunctionPropertyCallback&& rhs) HAL_NOEXCEPT
   : JSPropertyCallback(rhs)
-  , function_callback__(std::move(rhs.function_callback__)) {
+  , function_callback__(std::move(rhs.function_callback__))
+  , arguments_callback__(std::move(rhs.arguments_callback__)) {
   }
   
   template<typename T>
   JSExportNamedFunctionPropertyCallback<T>& JSExportNamedFunctionPropertyCallback<T>::operator=(const JSExportNamedFunctionPropertyCallback<T>& rhs) HAL_NOEXCEPT {
     HAL_DETAIL_JSPROPERTYCALLBACK_LOCK_GUARD;
     JSPropertyCallback::operator=(rhs);
-    function_callback__ = rhs.function_callback__;
+    function_callback__  = rhs.function_callback__;
+    arguments_callback__ = rhs.arguments_callback__;
     return *this;
   }
   
@@ -140,7 +190,8 @@ namespace HAL { namespace detail {
     
     // By swapping the members of two classes, the two classes are
     // effectively swapped.
-    swap(function_callback__, other.function_callback__);
+    swap(function_callback__ , other.function_callback__);
+    swap(arguments_callback__, other.arguments_callback__);
   }
   
   template<typename T>
@@ -160,6 +211,10 @@ namespace HAL { namespace detail {
       return false;
     }
     
+    if (!lhs.arguments_callback__ != !rhs.arguments_callback__) {
+      return false;
+    }
+    
     return static_cast<JSPropertyCallback>(lhs) == static_cast<JSPropertyCallback>(rhs);
   }
   
@@ -64,13 +64,13 @@ namespace HAL { namespace detail {
     JSExportNamedValuePropertyCallback(const std::string& property_name,
                                        GetNamedValuePropertyCallback<T> get_callback,
                                        SetNamedValuePropertyCallback<T> set_callback,
-                                       const std::unordered_set<JSPropertyAttribute>& attributes);
+                                       JSPropertyAttributeSet attributes);
     
-    GetNamedValuePropertyCallback<T> get_callback() const HAL_NOEXCEPT {
+    const GetNamedValuePropertyCallback<T>& get_callback() const HAL_NOEXCEPT {
       return get_callback__;
     }
     
-    SetNamedValuePropertyCallback<T> set_callback() const HAL_NOEXCEPT {
+    const SetNamedValuePropertyCallback<T>& set_callback() const HAL_NOEXCEPT {
       return set_callback__;
     }
     
@@ -95,7 +95,7 @@ namespace HAL { namespace detail {
                                                                             const std::string& property_name,
                                                                             GetNamedValuePropertyCallback<T> get_callback,
                                                                             SetNamedValuePropertyCallback<T> set_callback,
-                                                                            const std::unordered_set<JSPropertyAttribute>& attributes)
+                                                                            JSPropertyAttributeSet attributes)
   : JSPropertyCallback(property_name, attributes)
   , get_callback__(get_callback)
   , set_callback__(set_callback) {
@@ -104,7 +104,7 @@ namespace HAL { namespace detail {
       ThrowInvalidArgument("JSExportNamedValuePropertyCallback", "Both get_callback and set_callback are missing. At least one callback must be provided");
     }
     
-    if (attributes.find(JSPropertyAttribute::ReadOnly) != attributes.end()) {
+    if (attributes.Contains(JSPropertyAttribute::ReadOnly)) {
       if (!get_callback) {
         ThrowInvalidArgument("JSExportNamedValuePropertyCallback", "ReadOnly attribute is set but get_callback is missing");
       }
@@ -117,7 +117,7 @@ namespace HAL { namespace detail {
     // Force the ReadOnly attribute if only the get_callback is
     // provided.
     if (get_callback && !set_callback) {
-      attributes__.insert(JSPropertyAttribute::ReadOnly);
+      attributes__ |= JSPropertyAttribute::ReadOnly;
     }
   }
   
@@ -0,0 +1,253 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTNATIVEMETHOD_HPP_
+#define _HAL_DETAIL_JSEXPORTNATIVEMETHOD_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSExportCallbacks.hpp"
+#include "HAL/detail/JSUtil.hpp"
+#include "HAL/JSArguments.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSUndefined.hpp"
+#include "HAL/JSBoolean.hpp"
+#include "HAL/JSNumber.hpp"
+#include "HAL/JSResult.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  // C++11 has no std::index_sequence.
+  template<std::size_t... I>
+  struct JSIndexSequence {
+  };
+
+  template<std::size_t N, std::size_t... I>
+  struct JSMakeIndexSequence : JSMakeIndexSequence<N - 1, N - 1, I...> {
+  };
+
+  template<std::size_t... I>
+  struct JSMakeIndexSequence<0, I...> {
+    using type = JSIndexSequence<I...>;
+  };
+
+  /*!
+   @class
+
+   @discussion JSNativeArgument<U>::From converts one argument of a
+   JavaScriptCore callback to the C++ type U of a native method
+   parameter. Supported types are bool, the arithmetic types,
+   std::string, JSString and JSValue. Using a native method with any
+   other parameter type is a compile-time error.
+   */
+  template<typename U, typename Enable = void>
+  struct JSNativeArgument;
+
+  template<>
+  struct JSNativeArgument<bool> {
+    static bool From(const JSArguments& arguments, std::size_t index) HAL_NOEXCEPT {
+      return arguments.ToBoolean(index);
+    }
+  };
+
+  template<typename U>
+  struct JSNativeArgument<U, typename std::enable_if<std::is_floating_point<U>::value>::type> {
+    static U From(const JSArguments& arguments, std::size_t index) {
+      return static_cast<U>(arguments.ToNumber(index));
+    }
+  };
+
+  // Integers of up to 32 bits follow the ECMAScript ToInt32 and
+  // ToUint32 rules, so they wrap exactly like JavaScript's bitwise
+  // operators. Wider integers truncate the number toward zero.
+  template<typename U>
+  struct JSNativeArgument<U, typename std::enable_if<std::is_integral<U>::value && !std::is_same<U, bool>::value>::type> {
+    static U From(const JSArguments& arguments, std::size_t index) {
+      return Convert(arguments.ToNumber(index), std::integral_constant<bool, (sizeof(U) <= sizeof(std::int32_t))>());
+    }
+
+  private:
+
+    static U Convert(double number, std::true_type) HAL_NOEXCEPT {
+      return static_cast<U>(to_int32_t(number));
+    }
+
+    static U Convert(double number, std::false_type) HAL_NOEXCEPT {
+      return std::isfinite(number) ? static_cast<U>(number) : U(0);
+    }
+  };
+
+  template<>
+  struct JSNativeArgument<std::string> {
+    static std::string From(const JSArguments& arguments, std::size_t index) {
+      return static_cast<std::string>(arguments.ToJSString(index));
+    }
+  };
+
+  template<>
+  struct JSNativeArgument<JSString> {
+    static JSString From(const JSArguments& arguments, std::size_t index) {
+      return arguments.ToJSString(index);
+    }
+  };
+
+  template<>
+  struct JSNativeArgument<JSValue> {
+    static JSValue From(const JSArguments& arguments, std::size_t index) {
+      return arguments.ToJSValue(index);
+    }
+  };
+
+  /*!
+   @class
+
+   @discussion JSNativeResult<R>::ToJSValue boxes the value returned
+   by a native method. It supports the same types as
+   JSNativeArgument.
+   */
+  template<typename R, typename Enable = void>
+  struct JSNativeResult;
+
+  template<>
+  struct JSNativeResult<bool> {
+    static JSValue ToJSValue(const JSContext& js_context, bool result) {
+      return js_context.CreateBoolean(result);
+    }
+  };
+
+  template<typename R>
+  struct JSNativeResult<R, typename std::enable_if<std::is_arithmetic<R>::value && !std::is_same<R, bool>::value>::type> {
+    static JSValue ToJSValue(const JSContext& js_context, R result) {
+      return js_context.CreateNumber(static_cast<double>(result));
+    }
+  };
+
+  template<>
+  struct JSNativeResult<std::string> {
+    static JSValue ToJSValue(const JSContext& js_context, const std::string& result) {
+      return js_context.CreateString(result);
+    }
+  };
+
+  template<>
+  struct JSNativeResult<JSString> {
+    static JSValue ToJSValue(const JSContext& js_context, const JSString& result) {
+      return js_context.CreateString(result);
+    }
+  };
+
+  template<>
+  struct JSNativeResult<JSValue> {
+    static JSValue ToJSValue(const JSContext&, const JSValue& result) {
+      return result;
+    }
+  };
+
+  /*!
+   @class
+
+   @discussion JSNativeMethod invokes a pointer to a member function of
+   T, converting each argument with JSNativeArgument and the result
+   with JSNativeResult.
+   */
+  template<typename T, typename R, typename... Args>
+  struct JSNativeMethod {
+    template<typename M, std::size_t... I>
+    static JSValue Call(M method, T& native_object, const JSArguments& arguments, JSIndexSequence<I...>) {
+      return JSNativeResult<typename std::decay<R>::type>::ToJSValue(JSContext(arguments.get_context_ref()), (native_object.*method)(JSNativeArgument<typename std::decay<Args>::type>::From(arguments, I)...));
+    }
+  };
+
+  template<typename T, typename... Args>
+  struct JSNativeMethod<T, void, Args...> {
+    template<typename M, std::size_t... I>
+    static JSValue Call(M method, T& native_object, const JSArguments& arguments, JSIndexSequence<I...>) {
+      (native_object.*method)(JSNativeArgument<typename std::decay<Args>::type>::From(arguments, I)...);
+      return JSContext(arguments.get_context_ref()).CreateUndefined();
+    }
+  };
+
+  // A native method returning a JSResult reports its error through
+  // the JSArguments exception slot, so no C++ exception is thrown. A
+  // JavaScript exception the JSResult holds is rethrown as is.
+  template<typename T, typename R, typename... Args>
+  struct JSNativeMethod<T, JSResult<R>, Args...> {
+    template<typename M, std::size_t... I>
+    static JSValue Call(M method, T& native_object, const JSArguments& arguments, JSIndexSequence<I...>) {
+      const JSContext js_context(arguments.get_context_ref());
+      const auto      result = (native_object.*method)(JSNativeArgument<typename std::decay<Args>::type>::From(arguments, I)...);
+      if (!result) {
+        if (result.has_exception()) {
+          arguments.SetException(result.exception());
+        } else {
+          arguments.SetError(result.error_message());
+        }
+        return js_context.CreateUndefined();
+      }
+      
+      return JSNativeResult<typename std::decay<R>::type>::ToJSValue(js_context, result.value());
+    }
+  };
+
+  template<typename T, typename... Args>
+  struct JSNativeMethod<T, JSResult<void>, Args...> {
+    template<typename M, std::size_t... I>
+    static JSValue Call(M method, T& native_object, const JSArguments& arguments, JSIndexSequence<I...>) {
+      const auto result = (native_object.*method)(JSNativeArgument<typename std::decay<Args>::type>::From(arguments, I)...);
+      if (!result) {
+        if (result.has_exception()) {
+          arguments.SetException(result.exception());
+        } else {
+          arguments.SetError(result.error_message());
+        }
+      }
+      
+      return JSContext(arguments.get_context_ref()).CreateUndefined();
+    }
+  };
+
+  /*!
+   @class
+
+   @discussion True if a member function with these parameters already
+   has the signature of a CallNamedFunctionCallback or
+   CallNamedFunctionArgumentsCallback, in which case it is bound as is
+   instead of through JSNativeMethod.
+   */
+  template<typename... Args>
+  struct JSNativeMethodIsCallback : std::integral_constant<bool,
+      std::is_same<std::tuple<typename std::decay<Args>::type...>, std::tuple<std::vector<JSValue>, JSObject>>::value ||
+      std::is_same<std::tuple<typename std::decay<Args>::type...>, std::tuple<JSArguments, JSObject>>::value> {
+  };
+
+  template<typename T, typename R, typename... Args>
+  CallNamedFunctionArgumentsCallback<T> MakeNativeMethodCallback(R (T::*method)(Args...)) {
+    return [method](T& native_object, const JSArguments& arguments, JSObject&) {
+      return JSNativeMethod<T, R, Args...>::Call(method, native_object, arguments, typename JSMakeIndexSequence<sizeof...(Args)>::type());
+    };
+  }
+
+  template<typename T, typename R, typename... Args>
+  CallNamedFunctionArgumentsCallback<T> MakeNativeMethodCallback(R (T::*method)(Args...) const) {
+    return [method](T& native_object, const JSArguments& arguments, JSObject&) {
+      return JSNativeMethod<T, R, Args...>::Call(method, native_object, arguments, typename JSMakeIndexSequence<sizeof...(Args)>::type());
+    };
+  }
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTNATIVEMETHOD_HPP_
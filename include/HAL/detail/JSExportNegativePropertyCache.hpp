@@ -0,0 +1,121 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_HPP_
+#define _HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportNegativePropertyCache remembers the property
+   names that the HasProperty or GetProperty callback of one JSExport
+   class reported as absent, so that repeated probes for them, such as
+   the lookups of toString and hasOwnProperty on the prototype chain,
+   are answered without calling into native code.
+
+   A 1024 bit bloom filter rejects most names that were never cached
+   without a hash map lookup. Names are compared by their UTF-16
+   characters, so no JSString or std::string is made for a probe. When
+   the cache holds capacity names it is cleared and starts over.
+
+   A capacity of 0, the default, disables the cache. The native side
+   must call Clear when a property it reported as absent comes into
+   existence.
+
+   The capacity and the bloom filter are atomics, so that Contains
+   rejects a disabled cache or a name that was never cached without
+   taking the lock.
+   */
+  class HAL_EXPORT JSExportNegativePropertyCache final {
+
+  public:
+
+    explicit JSExportNegativePropertyCache(std::size_t capacity = 0);
+
+    JSExportNegativePropertyCache(const JSExportNegativePropertyCache&)            = delete;
+    JSExportNegativePropertyCache& operator=(const JSExportNegativePropertyCache&) = delete;
+
+    /*!
+     @method
+
+     @abstract Return true if the property name is known to be absent.
+     */
+    bool Contains(JSStringRef property_name_ref) const;
+
+    /*!
+     @method
+
+     @abstract Remember that the property name is absent. Does nothing
+     if the cache is disabled.
+     */
+    void Insert(JSStringRef property_name_ref);
+
+    /*!
+     @method
+
+     @abstract Forget every absent property name.
+     */
+    void Clear();
+
+    /*!
+     @method
+
+     @abstract Set the maximum number of names. 0 disables the cache.
+     This clears the cache.
+     */
+    void set_capacity(std::size_t capacity);
+
+    std::size_t capacity() const HAL_NOEXCEPT {
+      return capacity__.load(std::memory_order_relaxed);
+    }
+
+    std::size_t size() const;
+
+  private:
+
+    static std::uint64_t Hash(const JSChar* characters, std::size_t length) HAL_NOEXCEPT;
+
+    bool MayContain(std::uint64_t hash) const HAL_NOEXCEPT {
+      return (bloom_filter__[(hash >> 6) & 15].load(std::memory_order_relaxed) & (std::uint64_t(1) << (hash & 63))) != 0
+          && (bloom_filter__[(hash >> 38) & 15].load(std::memory_order_relaxed) & (std::uint64_t(1) << ((hash >> 32) & 63))) != 0;
+    }
+
+    void ClearBloomFilter() HAL_NOEXCEPT;
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::atomic<std::size_t>                             capacity__;
+    std::array<std::atomic<std::uint64_t>, 16>           bloom_filter__;
+    std::unordered_multimap<std::uint64_t, std::u16string> names__;
+
+#undef HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD
+#ifdef HAL_THREAD_SAFE_STATICS
+    mutable JSMutex                                      mutex__ HAL_LOCK_CLASS_NAME(JSExportNegativePropertyCache, "JSExportNegativePropertyCache");
+#define HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD std::lock_guard<JSMutex> lock(mutex__)
+#else
+#define HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_HPP_
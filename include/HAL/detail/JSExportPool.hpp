@@ -0,0 +1,223 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTPOOL_HPP_
+#define _HAL_DETAIL_JSEXPORTPOOL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSExportClassName.hpp"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace HAL { namespace detail {
+  
+  // Every native object created by JSExportClass is preceded by a
+  // header of this size so that it can be destroyed without knowing
+  // its dynamic type, see JSExportAllocator.hpp.
+  static const std::size_t kJSExportNativeObjectHeaderSize = alignof(std::max_align_t);
+  
+// VS 2013 only supports thread local POD data, which can't give its
+// blocks back when its thread exits, so there the blocks cached by a
+// thread are abandoned when it exits.
+#if !defined(_MSC_VER) || _MSC_VER > 1800
+#define HAL_DETAIL_JSEXPORTPOOL_RELEASE_ENABLE
+#define HAL_DETAIL_JSEXPORTPOOL_THREAD_LOCAL thread_local
+#else
+#define HAL_DETAIL_JSEXPORTPOOL_THREAD_LOCAL HAL_THREAD_LOCAL
+#endif
+  
+  /*!
+   @class
+   
+   @discussion A JSExportPool is the default allocator of the native
+   objects of the C++ class T exported by JSExportClass<T>.
+   
+   Memory is carved from slabs of fixed size blocks, each large enough
+   for one T and its header. Freed blocks go onto a thread-local free
+   list, so allocation and deallocation never take a lock and objects
+   allocated together end up next to each other. A block freed on a
+   thread other than the one that allocated it is simply reused by the
+   freeing thread.
+   
+   When a thread exits its free list gives its blocks back to their
+   slabs, and a slab whose blocks have all been given back is returned
+   to the heap. Only this, which is rare, takes a lock. Blocks still in
+   use, or cached by a thread that is still running, keep their slab
+   alive.
+   
+   Requests larger than a block, which only happen if another
+   allocator trait delegates here, are forwarded to ::operator new.
+   */
+  template<typename T>
+  class JSExportPool final {
+    
+  public:
+    
+    static void* Allocate(std::size_t size);
+    static void  Deallocate(void* ptr, std::size_t size) HAL_NOEXCEPT;
+    
+    // Return the number of slabs that haven't been returned to the
+    // heap.
+    static std::size_t get_slab_count();
+    
+    JSExportPool()                               = delete;
+    ~JSExportPool()                              = delete;
+    JSExportPool(const JSExportPool&)            = delete;
+    JSExportPool(JSExportPool&&)                 = delete;
+    JSExportPool& operator=(const JSExportPool&) = delete;
+    JSExportPool& operator=(JSExportPool&&)      = delete;
+    
+  private:
+    
+    static const std::size_t kBlockSize     = kJSExportNativeObjectHeaderSize + sizeof(T);
+    static const std::size_t kBlocksPerSlab = 64;
+    
+    union Block {
+      Block* next;
+      typename std::aligned_storage<kBlockSize, alignof(std::max_align_t)>::type storage;
+    };
+    
+    struct Slab {
+      Block       blocks[kBlocksPerSlab];
+      std::size_t returned_count;
+    };
+    
+    struct FreeList final {
+#ifdef HAL_DETAIL_JSEXPORTPOOL_RELEASE_ENABLE
+      ~FreeList() HAL_NOEXCEPT;
+#endif
+      Block* head;
+    };
+    
+    // Give a block back to its slab, returning the slab to the heap
+    // once all of its blocks are back. A block that isn't in any slab
+    // was allocated after its thread's free list was destroyed, and is
+    // deleted.
+    static void Return(Block* block) HAL_NOEXCEPT;
+    
+    // Every slab by address, and the lock for them and their
+    // returned_count. They are never destroyed, since native objects
+    // may be finalized during static destruction.
+    static std::map<const Block*, Slab*>& GetSlabs();
+    static JSMutex&                       GetSlabsMutex();
+    
+    static HAL_DETAIL_JSEXPORTPOOL_THREAD_LOCAL FreeList free_list__;
+    
+    // Set once the calling thread's free list is destroyed.
+    static HAL_THREAD_LOCAL bool free_list_destroyed__;
+  };
+  
+  template<typename T>
+  HAL_DETAIL_JSEXPORTPOOL_THREAD_LOCAL typename JSExportPool<T>::FreeList JSExportPool<T>::free_list__ = { nullptr };
+  
+  template<typename T>
+  HAL_THREAD_LOCAL bool JSExportPool<T>::free_list_destroyed__ = false;
+  
+  template<typename T>
+  void* JSExportPool<T>::Allocate(std::size_t size) {
+    if (size > sizeof(Block)) {
+      return ::operator new(size);
+    }
+    
+    if (free_list_destroyed__) {
+      return ::operator new(sizeof(Block));
+    }
+    
+    if (!free_list__.head) {
+      std::unique_ptr<Slab> slab(new Slab);
+      for (std::size_t i = 0; i < kBlocksPerSlab - 1; ++i) {
+        slab -> blocks[i].next = &slab -> blocks[i + 1];
+      }
+      slab -> blocks[kBlocksPerSlab - 1].next = nullptr;
+      slab -> returned_count = 0;
+      {
+        std::lock_guard<JSMutex> lock(GetSlabsMutex());
+        GetSlabs().emplace(slab -> blocks, slab.get());
+      }
+      free_list__.head = slab -> blocks;
+      slab.release();
+      HAL_LOG_DEBUG("JSExportPool<", JSExportClassName<T>::get(), ">::Allocate: new slab ", free_list__.head);
+    }
+    
+    Block* block     = free_list__.head;
+    free_list__.head = block -> next;
+    return block;
+  }
+  
+  template<typename T>
+  void JSExportPool<T>::Deallocate(void* ptr, std::size_t size) HAL_NOEXCEPT {
+    if (size > sizeof(Block)) {
+      ::operator delete(ptr);
+      return;
+    }
+    
+    Block* block = static_cast<Block*>(ptr);
+    if (free_list_destroyed__) {
+      Return(block);
+      return;
+    }
+    block -> next    = free_list__.head;
+    free_list__.head = block;
+  }
+  
+  template<typename T>
+  std::size_t JSExportPool<T>::get_slab_count() {
+    std::lock_guard<JSMutex> lock(GetSlabsMutex());
+    return GetSlabs().size();
+  }
+  
+#ifdef HAL_DETAIL_JSEXPORTPOOL_RELEASE_ENABLE
+  template<typename T>
+  JSExportPool<T>::FreeList::~FreeList() HAL_NOEXCEPT {
+    free_list_destroyed__ = true;
+    while (head) {
+      const auto next = head -> next;
+      Return(head);
+      head = next;
+    }
+  }
+#endif
+  
+  template<typename T>
+  void JSExportPool<T>::Return(Block* block) HAL_NOEXCEPT {
+    std::lock_guard<JSMutex> lock(GetSlabsMutex());
+    auto& slabs    = GetSlabs();
+    auto  position = slabs.upper_bound(block);
+    if (position == slabs.begin() || block >= (--position) -> first + kBlocksPerSlab) {
+      ::operator delete(block);
+      return;
+    }
+    
+    Slab* slab = position -> second;
+    if (++slab -> returned_count == kBlocksPerSlab) {
+      HAL_LOG_DEBUG("JSExportPool<", JSExportClassName<T>::get(), ">::Return: delete slab ", slab);
+      slabs.erase(position);
+      delete slab;
+    }
+  }
+  
+  template<typename T>
+  std::map<const typename JSExportPool<T>::Block*, typename JSExportPool<T>::Slab*>& JSExportPool<T>::GetSlabs() {
+    static auto slabs = new std::map<const Block*, Slab*>();
+    return *slabs;
+  }
+  
+  template<typename T>
+  JSMutex& JSExportPool<T>::GetSlabsMutex() {
+    static auto mutex = new JSMutex HAL_LOCK_NAME("JSExportPool slabs");
+    return *mutex;
+  }
+  
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTPOOL_HPP_
@@ -0,0 +1,119 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTSLOTTABLE_HPP_
+#define _HAL_DETAIL_JSEXPORTSLOTTABLE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @struct
+
+   @discussion A JSExportSlotReference names one use of a slot of the
+   process-wide slot table, see JSExportWeakHandle. Releasing a slot
+   bumps its generation, so a reference to an earlier use no longer
+   matches it even after the slot is reused. A generation of 0 is
+   never used, and marks an empty reference.
+   */
+  struct JSExportSlotReference {
+    std::uint32_t index      { 0 };
+    std::uint32_t generation { 0 };
+  };
+
+  // The native object, and its JSObjectRef and global context, that a
+  // slot holds, and the key of the context's weak reference to the
+  // JSObjectRef.
+  struct JSExportSlotValue {
+    void*              native_object_ptr     { nullptr };
+    JSGlobalContextRef js_global_context_ref { nullptr };
+    JSObjectRef        js_object_ref         { nullptr };
+    std::uint64_t      weak_object_key       { 0 };
+  };
+
+  /*
+   @function
+
+   @abstract Take a free slot for a native object and its JSObjectRef,
+   and give it a weak reference to the JSObjectRef if it has a global
+   context. The weak_object_key of value is ignored.
+
+   @throws std::runtime_error if every slot is taken.
+   */
+  HAL_EXPORT JSExportSlotReference AcquireJSExportSlot(const JSExportSlotValue& value);
+
+  // Free a slot, so that no reference to it matches any more.
+  HAL_EXPORT void ReleaseJSExportSlot(JSExportSlotReference reference) HAL_NOEXCEPT;
+
+  // Copy the value of the slot of a reference to value and return true
+  // if the reference still matches it. This takes no lock, and
+  // allocates nothing.
+  HAL_EXPORT bool FindJSExportSlot(JSExportSlotReference reference, JSExportSlotValue& value) HAL_NOEXCEPT;
+
+  // Like FindJSExportSlot, but also return false once the garbage
+  // collector has found the JSObjectRef dead, which may be well before
+  // its finalizer releases the slot. Must be called on the thread that
+  // runs the slot's context.
+  HAL_EXPORT bool LockJSExportSlot(JSExportSlotReference reference, JSExportSlotValue& value);
+
+  /*!
+   @class
+
+   @discussion A JSExportWeakSlot is the slot of one native object, see
+   JSObject::GetWeakHandle. It takes a slot for the first weak handle,
+   and frees it when the JavaScript object is finalized or the native
+   object destroyed.
+
+   Copying a native object doesn't copy its slot, since the slot names
+   the JavaScript object of the original.
+   */
+  class JSExportWeakSlot final {
+
+  public:
+
+    JSExportWeakSlot() HAL_NOEXCEPT {
+    }
+
+    JSExportWeakSlot(const JSExportWeakSlot&) HAL_NOEXCEPT {
+    }
+
+    JSExportWeakSlot& operator=(const JSExportWeakSlot&) HAL_NOEXCEPT {
+      return *this;
+    }
+
+    ~JSExportWeakSlot() HAL_NOEXCEPT {
+      Release();
+    }
+
+    // Return the reference to this object's slot, taking one if it has
+    // none.
+    JSExportSlotReference Get(const JSExportSlotValue& value) {
+      if (reference__.generation == 0) {
+        reference__ = AcquireJSExportSlot(value);
+      }
+      return reference__;
+    }
+
+    void Release() HAL_NOEXCEPT {
+      if (reference__.generation != 0) {
+        ReleaseJSExportSlot(reference__);
+        reference__ = JSExportSlotReference();
+      }
+    }
+
+  private:
+
+    JSExportSlotReference reference__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTSLOTTABLE_HPP_
@@ -0,0 +1,112 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTVALUECACHE_HPP_
+#define _HAL_DETAIL_JSEXPORTVALUECACHE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSExportValueCache holds the values of the cached
+   value properties of one native object, see
+   JSExport<T>::AddCachedValueProperty, keyed by the index of the
+   property in the class definition.
+
+   It is a single null pointer until a cached property is first read,
+   so native objects of classes without cached properties pay for no
+   more than that. A class has few cached properties, so the values
+   are searched linearly.
+
+   Copying a native object doesn't copy its cached values, since they
+   belong to the JavaScript object of the original.
+   */
+  class JSExportValueCache final {
+
+  public:
+
+    JSExportValueCache() HAL_NOEXCEPT {
+    }
+
+    JSExportValueCache(const JSExportValueCache&) HAL_NOEXCEPT {
+    }
+
+    JSExportValueCache& operator=(const JSExportValueCache&) HAL_NOEXCEPT {
+      Clear();
+      return *this;
+    }
+
+    const JSValue* Find(std::size_t index) const HAL_NOEXCEPT {
+      if (entries__) {
+        for (const auto& entry : *entries__) {
+          if (entry.index == index) {
+            return &entry.js_value;
+          }
+        }
+      }
+      return nullptr;
+    }
+
+    void Insert(std::size_t index, const JSValue& js_value) {
+      if (!entries__) {
+        entries__.reset(new std::vector<Entry>());
+      }
+      entries__ -> push_back(Entry { index, js_value });
+    }
+
+    void Erase(std::size_t index) HAL_NOEXCEPT {
+      if (!entries__) {
+        return;
+      }
+      auto& entries = *entries__;
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].index == index) {
+          if (i + 1 != entries.size()) {
+            std::swap(entries[i], entries.back());
+          }
+          entries.pop_back();
+          return;
+        }
+      }
+    }
+
+    void Clear() HAL_NOEXCEPT {
+      entries__.reset();
+    }
+
+    std::size_t size() const HAL_NOEXCEPT {
+      return entries__ ? entries__ -> size() : 0;
+    }
+
+  private:
+
+    struct Entry {
+      std::size_t index;
+      JSValue     js_value;
+    };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::unique_ptr<std::vector<Entry>> entries__;
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTVALUECACHE_HPP_
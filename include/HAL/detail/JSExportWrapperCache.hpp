@@ -0,0 +1,167 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSEXPORTWRAPPERCACHE_HPP_
+#define _HAL_DETAIL_JSEXPORTWRAPPERCACHE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/HashUtilities.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace HAL {
+  class JSContext;
+}
+
+namespace HAL { namespace detail {
+
+  struct JSExportClassInfo;
+
+  /*!
+   @class
+
+   @discussion A JSExportWrapperCache maps the native pointers passed
+   to JSExport<T>::Wrap in one JSGlobalContextRef to the JavaScript
+   objects wrapping them, so that a native pointer returned to
+   JavaScript many times gets the same object each time.
+
+   The objects aren't protected, so the cache doesn't keep them alive.
+   It only keeps a number for each wrapper, which the context maps to
+   the object through a weak reference, so Find never returns an
+   object the garbage collector has found dead but not yet finalized.
+   Each wrapper's native object holds a JSExportWrapperEntry, which
+   removes it from the cache when the wrapper is finalized, and keeps
+   the cache alive until then.
+
+   When HAL_THREAD_SAFE is defined the cache has its own mutex.
+   */
+  class HAL_EXPORT JSExportWrapperCache final : public std::enable_shared_from_this<JSExportWrapperCache> {
+
+  public:
+
+    JSExportWrapperCache() HAL_NOEXCEPT {
+    }
+
+    JSExportWrapperCache(const JSExportWrapperCache&)            = delete;
+    JSExportWrapperCache& operator=(const JSExportWrapperCache&) = delete;
+
+    /*!
+     @method
+
+     @abstract Return the cache of a JSGlobalContextRef, creating it if
+     no wrapper of that context is alive.
+     */
+    static std::shared_ptr<JSExportWrapperCache> Get(JSGlobalContextRef js_global_context_ref);
+    
+    /*!
+     @method
+     
+     @abstract Return the cache of the JSGlobalContextRef of
+     js_context, which is kept in a context-local slot, so that only
+     the first Wrap of each context looks it up.
+     */
+    static JSExportWrapperCache& Get(const JSContext& js_context);
+
+    // Returns the live wrapper of native_ptr for a class in
+    // js_context, or nullptr.
+    JSObjectRef Find(const JSContext& js_context, const JSExportClassInfo* class_info, const void* native_ptr);
+
+    // Returns the number identifying the new entry.
+    std::uint64_t Insert(const JSContext& js_context, const JSExportClassInfo* class_info, const void* native_ptr, JSObjectRef js_object_ref);
+
+    // Removes the entry of native_ptr if it is still token, rather
+    // than a wrapper made since. The context forgets the weak
+    // reference by itself once the object is collected.
+    void Erase(const JSExportClassInfo* class_info, const void* native_ptr, std::uint64_t token) HAL_NOEXCEPT;
+
+    std::size_t size() const;
+
+  private:
+
+    typedef std::pair<const JSExportClassInfo*, const void*> Key;
+
+    struct KeyHash {
+      std::size_t operator()(const Key& key) const HAL_NOEXCEPT {
+        return hash_val(key.first, key.second);
+      }
+    };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::unordered_map<Key, std::uint64_t, KeyHash> wrappers__;
+#pragma warning(pop)
+
+#undef  HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE
+    mutable JSMutex mutex__ HAL_LOCK_CLASS_NAME(JSExportWrapperCache, "JSExportWrapperCache");
+#define HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD std::lock_guard<JSMutex> lock(mutex__)
+#else
+#define HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE
+  };
+
+  /*!
+   @class
+
+   @discussion A JSExportWrapperEntry records, in the native object of
+   a wrapper made by JSExport<T>::Wrap, the cache entry to remove when
+   the wrapper is finalized. It is a single null pointer for native
+   objects that aren't wrappers.
+
+   Copying a native object doesn't copy its entry, since the entry
+   belongs to the JavaScript object of the original.
+   */
+  class HAL_EXPORT JSExportWrapperEntry final {
+
+  public:
+
+    JSExportWrapperEntry() HAL_NOEXCEPT {
+    }
+
+    JSExportWrapperEntry(const JSExportWrapperEntry&) HAL_NOEXCEPT {
+    }
+
+    JSExportWrapperEntry& operator=(const JSExportWrapperEntry&) HAL_NOEXCEPT {
+      return *this;
+    }
+
+    ~JSExportWrapperEntry() HAL_NOEXCEPT {
+      Clear();
+    }
+
+    void Set(const JSContext& js_context, const std::shared_ptr<JSExportWrapperCache>& cache, const JSExportClassInfo* class_info, const void* native_ptr, JSObjectRef js_object_ref);
+
+    // Remove the entry from its cache, if it is in one.
+    void Clear() HAL_NOEXCEPT;
+
+  private:
+
+    struct State {
+      std::shared_ptr<JSExportWrapperCache> cache;
+      const JSExportClassInfo*              class_info;
+      const void*                           native_ptr;
+      std::uint64_t                         token;
+    };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::unique_ptr<State> state__;
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSEXPORTWRAPPERCACHE_HPP_
@@ -0,0 +1,148 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSFUNCTIONCACHE_HPP_
+#define _HAL_DETAIL_JSFUNCTIONCACHE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSString.hpp"
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSFunctionCache holds the most recently created
+   functions of a JSContext whose body is given as a string, keyed by
+   everything JSObjectMakeFunction parses, so that
+   JSContext::CreateFunction can return an existing function instead
+   of parsing its body again.
+
+   Each JSContext owns one cache, shared by all of its copies. It is
+   empty, and does nothing, until it is given a capacity.
+
+   The cache holds JSObjectRefs protected with JSValueProtect rather
+   than JSFunctions, because a JSFunction holds a copy of its JSContext
+   and would keep the JSContext that owns the cache alive.
+   */
+  class HAL_EXPORT JSFunctionCache final {
+
+  public:
+
+    struct Key {
+      JSString              body;
+      std::vector<JSString> parameter_names;
+      JSString              function_name;
+      JSString              source_url;
+      int                   starting_line_number;
+
+      bool operator==(const Key& rhs) const;
+    };
+
+    explicit JSFunctionCache(JSContextRef js_context_ref) HAL_NOEXCEPT;
+    ~JSFunctionCache() HAL_NOEXCEPT;
+    JSFunctionCache(const JSFunctionCache&)            = delete;
+    JSFunctionCache(JSFunctionCache&&)                 = delete;
+    JSFunctionCache& operator=(const JSFunctionCache&) = delete;
+    JSFunctionCache& operator=(JSFunctionCache&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Return the cached function for key, or nullptr if there
+     is none. A returned function becomes the most recently used.
+     */
+    JSObjectRef Find(const Key& key);
+
+    /*!
+     @method
+
+     @abstract Cache a function, evicting the least recently used one
+     if the cache is full. Does nothing if the capacity is zero.
+     */
+    void Insert(Key key, JSObjectRef js_object_ref);
+
+    /*!
+     @method
+
+     @abstract Remove all cached functions.
+     */
+    void Clear() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Remove fraction of the cached functions, least recently
+     used first, and return the approximate bytes their keys used.
+     */
+    std::size_t Evict(double fraction) HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Set the maximum number of cached functions, evicting
+     the least recently used ones if there are more.
+     */
+    void set_capacity(std::size_t capacity) HAL_NOEXCEPT;
+
+    std::size_t get_capacity() const HAL_NOEXCEPT;
+    std::size_t size() const HAL_NOEXCEPT;
+
+#ifdef HAL_THREAD_SAFE
+    // Held by the JSContext from Find until it has protected the
+    // function found, so that JSMemoryPressure::Respond, which may evict
+    // from another thread, can't unprotect it meanwhile.
+    JSRecursiveMutex& get_mutex() const HAL_NOEXCEPT {
+      return mutex__;
+    }
+#endif
+
+  private:
+
+    struct KeyHash {
+      std::size_t operator()(const Key& key) const;
+    };
+
+    // The most recently used entry is at the front.
+    typedef std::list<std::pair<Key, JSObjectRef>> EntryList;
+
+    void EvictTo(std::size_t size) HAL_NOEXCEPT;
+
+    // The approximate bytes key and its entry use outside the
+    // JavaScript heap.
+    static std::size_t GetSize(const Key& key) HAL_NOEXCEPT;
+
+    JSContextRef js_context_ref__;
+    std::size_t  capacity__ { 0 };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    EntryList                                             entries__;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> index__;
+#pragma warning(pop)
+
+#undef HAL_JSFUNCTIONCACHE_LOCK_GUARD
+#ifdef HAL_THREAD_SAFE
+    mutable JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSFunctionCache, "JSFunctionCache");
+#define HAL_JSFUNCTIONCACHE_LOCK_GUARD std::lock_guard<JSRecursiveMutex> lock(mutex__)
+#else
+#define HAL_JSFUNCTIONCACHE_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSFUNCTIONCACHE_HPP_
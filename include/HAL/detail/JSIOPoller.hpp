@@ -0,0 +1,87 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSIOPOLLER_HPP_
+#define _HAL_DETAIL_JSIOPOLLER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSRunLoop.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSIOPoller is the operating system's I/O multiplexer
+   that a JSRunLoop sleeps in: epoll on Linux, kqueue on Apple
+   platforms and FreeBSD, and an I/O completion port on Windows. One
+   wait returns every handle that became ready, or every operation
+   that completed, together with any wakeup from another thread, so a
+   JSRunLoop handles them all in one batch.
+
+   Watched descriptors are level-triggered. A handle associated with a
+   completion port reports each completed overlapped operation, and
+   stays associated until it is closed.
+
+   Only Wake may be called from a thread other than the owner's.
+   */
+  class HAL_EXPORT JSIOPoller final {
+
+  public:
+
+    struct Event {
+      std::uint64_t key;
+      JSIOEvent     io_event;
+    };
+
+    /*!
+     @method
+
+     @throws std::runtime_error if the multiplexer can't be created.
+     */
+    JSIOPoller();
+    ~JSIOPoller() HAL_NOEXCEPT;
+
+    JSIOPoller(const JSIOPoller&)            = delete;
+    JSIOPoller& operator=(const JSIOPoller&) = delete;
+
+    // Report the events of handle as key, which must not be zero.
+    // Throws std::runtime_error if the handle can't be watched.
+    void Add(JSIOHandle handle, std::uint32_t events, std::uint64_t key);
+
+    // Stop reporting the events Add was given for handle. Does nothing
+    // on Windows.
+    void Remove(JSIOHandle handle, std::uint32_t events) HAL_NOEXCEPT;
+
+    // Wait up to timeout milliseconds, or forever if it is negative,
+    // until a handle is ready or Wake is called, and append the ready
+    // handles to events.
+    void Wait(int timeout, std::vector<Event>& events);
+
+    // Make the current or next Wait return. May be called from any
+    // thread.
+    void Wake() HAL_NOEXCEPT;
+
+  private:
+
+#ifdef _WIN32
+    void* completion_port__ { nullptr };
+#else
+    int   poller_descriptor__ { -1 };
+#endif
+#ifdef __linux__
+    int   wake_descriptor__   { -1 };
+#endif
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSIOPOLLER_HPP_
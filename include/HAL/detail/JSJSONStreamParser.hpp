@@ -0,0 +1,90 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSJSONSTREAMPARSER_HPP_
+#define _HAL_DETAIL_JSJSONSTREAMPARSER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSJSONStreamParser finds the values of a JSON document
+   selected by a set of JSONPath-like selectors in one pass, without
+   building anything for the rest of the document. See
+   JSContext::ParseJSONStream.
+
+   A selector starts with $, the whole document, followed by steps:
+
+   .name or ['name'] selects a member of an object,
+   [3] selects an element of an array,
+   .* or [*] selects every member or element.
+
+   Only the containers on the way to a selected value are parsed
+   member by member. Everything else is skipped by a scanner that
+   checks the syntax without decoding anything. The descendants of a
+   selected value aren't matched again.
+   */
+  class HAL_EXPORT JSJSONStreamParser final {
+
+  public:
+
+    // Called with the path of each selected value and the offsets of
+    // its first code unit and just past its last one.
+    typedef std::function<void(const std::string& path, std::size_t begin, std::size_t end)> Callback;
+
+    /*!
+     @method
+
+     @abstract Compile the selectors.
+
+     @throws std::invalid_argument if a selector isn't valid.
+     */
+    explicit JSJSONStreamParser(const std::vector<std::string>& selectors);
+
+    /*!
+     @method
+
+     @abstract Call callback for each selected value of the input, in
+     document order.
+
+     @result std::string::npos if the input is valid JSON, or else the
+     offset of the first code unit that makes it invalid, as
+     FindJSONErrorOffset reports it. Values before that offset may
+     already have been reported.
+     */
+    std::size_t Parse(const char*   input, std::size_t length, const Callback& callback) const;
+    std::size_t Parse(const JSChar* input, std::size_t length, const Callback& callback) const;
+
+    struct Step {
+      enum class Kind { Name, Index, Wildcard };
+      Kind        kind;
+      std::string name;
+      std::size_t index;
+    };
+
+  private:
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::vector<std::vector<Step>> selectors__;
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSJSONSTREAMPARSER_HPP_
@@ -0,0 +1,208 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSLATENCYHISTOGRAM_HPP_
+#define _HAL_DETAIL_JSLATENCYHISTOGRAM_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+  // Add -DHAL_CALLBACK_LATENCY_ENABLE=1 to time the JSExport callbacks.
+
+  // The JavaScriptCore callbacks of a JSExport class that are timed.
+  enum class JSExportCallbackKind : std::uint8_t {
+    GetNamedValueProperty,
+    SetNamedValueProperty,
+    CallNamedFunction,
+    CallAsFunction,
+    CallAsConstructor,
+    ConvertToType,
+    Finalize
+  };
+
+  static const std::size_t kJSExportCallbackKindCount = 7;
+
+  HAL_EXPORT const char* to_string(JSExportCallbackKind kind) HAL_NOEXCEPT;
+#endif // HAL_CALLBACK_LATENCY_ENABLE
+
+  /*!
+   @class
+
+   @discussion A JSLatencyHistogram counts durations in nanoseconds in
+   the style of an HDR histogram: each power of two is split into 16
+   buckets, so every recorded value is known to within 1/16th, from
+   one nanosecond up to about 18 minutes. Longer durations count in
+   the last bucket.
+
+   Recording is a few relaxed atomic adds, so any thread may record
+   while another reads. The JSExport callbacks are timed into one per
+   callback, and the task queues of JSRunLoop and JSWorkerPool record
+   their queueing delays into one per priority.
+   */
+  class JSLatencyHistogram final {
+
+  public:
+
+    static const std::size_t kSubBucketBits  = 4;
+    static const std::size_t kSubBucketCount = 1 << kSubBucketBits;
+    static const std::size_t kMaxMagnitude   = 39;
+    static const std::size_t kBucketCount    = kSubBucketCount * (kMaxMagnitude - kSubBucketBits + 2);
+
+    JSLatencyHistogram() HAL_NOEXCEPT {
+      Reset();
+    }
+
+    JSLatencyHistogram(const JSLatencyHistogram&)            = delete;
+    JSLatencyHistogram& operator=(const JSLatencyHistogram&) = delete;
+
+    void Record(std::uint64_t nanoseconds) HAL_NOEXCEPT {
+      counts__[GetBucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+      count__.fetch_add(1, std::memory_order_relaxed);
+      total_nanoseconds__.fetch_add(nanoseconds, std::memory_order_relaxed);
+      auto max_nanoseconds = max_nanoseconds__.load(std::memory_order_relaxed);
+      while (nanoseconds > max_nanoseconds && !max_nanoseconds__.compare_exchange_weak(max_nanoseconds, nanoseconds, std::memory_order_relaxed)) {
+      }
+    }
+
+    std::uint64_t get_count() const HAL_NOEXCEPT {
+      return count__.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t get_total_nanoseconds() const HAL_NOEXCEPT {
+      return total_nanoseconds__.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t get_max_nanoseconds() const HAL_NOEXCEPT {
+      return max_nanoseconds__.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     @method
+
+     @abstract Return the duration that percentile percent of the
+     recorded durations don't exceed, rounded up to the end of its
+     bucket, or 0 if nothing was recorded.
+     */
+    std::uint64_t GetPercentile(double percentile) const HAL_NOEXCEPT {
+      const auto count = get_count();
+      if (count == 0) {
+        return 0;
+      }
+
+      auto target = static_cast<std::uint64_t>(percentile / 100 * static_cast<double>(count) + 0.5);
+      target = target < 1 ? 1 : (target > count ? count : target);
+      std::uint64_t seen = 0;
+      for (std::size_t i = 0; i < kBucketCount; ++i) {
+        seen += counts__[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+          const auto bucket_end = GetBucketEnd(i);
+          const auto max        = get_max_nanoseconds();
+          return bucket_end < max ? bucket_end : max;
+        }
+      }
+      return get_max_nanoseconds();
+    }
+
+    void Reset() HAL_NOEXCEPT {
+      for (auto& count : counts__) {
+        count.store(0, std::memory_order_relaxed);
+      }
+      count__.store(0, std::memory_order_relaxed);
+      total_nanoseconds__.store(0, std::memory_order_relaxed);
+      max_nanoseconds__.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+
+    static std::size_t GetMagnitude(std::uint64_t value) HAL_NOEXCEPT {
+#if defined(__GNUC__) || defined(__clang__)
+      return 63 - static_cast<std::size_t>(__builtin_clzll(value));
+#else
+      std::size_t magnitude = 0;
+      while (value >>= 1) {
+        ++magnitude;
+      }
+      return magnitude;
+#endif
+    }
+
+    // Values below kSubBucketCount have a bucket each. Above that the
+    // bucket is the magnitude and the next kSubBucketBits bits.
+    static std::size_t GetBucketIndex(std::uint64_t value) HAL_NOEXCEPT {
+      if (value < kSubBucketCount) {
+        return static_cast<std::size_t>(value);
+      }
+
+      const auto magnitude = GetMagnitude(value);
+      if (magnitude > kMaxMagnitude) {
+        return kBucketCount - 1;
+      }
+
+      const auto shift = magnitude - kSubBucketBits;
+      return kSubBucketCount * (shift + 1) + static_cast<std::size_t>((value >> shift) - kSubBucketCount);
+    }
+
+    // The largest value counted in a bucket.
+    static std::uint64_t GetBucketEnd(std::size_t index) HAL_NOEXCEPT {
+      if (index < kSubBucketCount) {
+        return index;
+      }
+
+      const auto shift = index / kSubBucketCount - 1;
+      const auto first = static_cast<std::uint64_t>(kSubBucketCount + index % kSubBucketCount) << shift;
+      return first + (static_cast<std::uint64_t>(1) << shift) - 1;
+    }
+
+    std::atomic<std::uint64_t> counts__[kBucketCount];
+    std::atomic<std::uint64_t> count__;
+    std::atomic<std::uint64_t> total_nanoseconds__;
+    std::atomic<std::uint64_t> max_nanoseconds__;
+  };
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+  // Records the lifetime of the timer into a histogram.
+  class JSLatencyTimer final {
+
+  public:
+
+    explicit JSLatencyTimer(JSLatencyHistogram& histogram) HAL_NOEXCEPT
+    : histogram__(histogram)
+    , start__(std::chrono::steady_clock::now()) {
+    }
+
+    ~JSLatencyTimer() HAL_NOEXCEPT {
+      const auto elapsed = std::chrono::steady_clock::now() - start__;
+      histogram__.Record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    JSLatencyTimer(const JSLatencyTimer&)            = delete;
+    JSLatencyTimer& operator=(const JSLatencyTimer&) = delete;
+
+  private:
+
+    JSLatencyHistogram&                   histogram__;
+    std::chrono::steady_clock::time_point start__;
+  };
+#endif // HAL_CALLBACK_LATENCY_ENABLE
+
+}} // namespace HAL { namespace detail {
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+#define HAL_CALLBACK_LATENCY_TIMER(class_info, kind) detail::JSLatencyTimer hal_callback_latency_timer((class_info).callback_latency[static_cast<std::size_t>(detail::JSExportCallbackKind::kind)])
+#else
+#define HAL_CALLBACK_LATENCY_TIMER(class_info, kind)
+#endif // HAL_CALLBACK_LATENCY_ENABLE
+
+#endif // _HAL_DETAIL_JSLATENCYHISTOGRAM_HPP_
@@ -0,0 +1,136 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSLOCKSTATISTICS_HPP_
+#define _HAL_DETAIL_JSLOCKSTATISTICS_HPP_
+
+#ifdef HAL_LOCK_STATISTICS_ENABLE
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_LOCK_STATISTICS_ENABLE=1 to count the acquisitions of
+  // HAL's internal locks.
+
+  /*!
+   @struct
+
+   @discussion The counters of one named lock, shared by every mutex
+   of that name. A lock is contended when it was held by another
+   thread, and its wait time is the time spent waiting for it then.
+   */
+  struct JSLockStatistics {
+    explicit JSLockStatistics(const char* name) HAL_NOEXCEPT
+    : name(name) {
+    }
+
+    JSLockStatistics(const JSLockStatistics&)            = delete;
+    JSLockStatistics& operator=(const JSLockStatistics&) = delete;
+
+    const char*                name;
+    std::atomic<std::uint64_t> acquisitions          { 0 };
+    std::atomic<std::uint64_t> contended_acquisitions { 0 };
+    std::atomic<std::uint64_t> wait_nanoseconds      { 0 };
+  };
+
+  // Return the counters of the lock named name, a string literal,
+  // creating them the first time.
+  HAL_EXPORT JSLockStatistics& RegisterJSLockStatistics(const char* name);
+
+  // Return the counters of every lock, in the order they were first
+  // registered.
+  HAL_EXPORT std::vector<const JSLockStatistics*> GetJSLockStatistics();
+
+  HAL_EXPORT void ResetJSLockStatistics() HAL_NOEXCEPT;
+
+  // Return the counters of the lock named name, looking them up only
+  // once for each Tag, so that locks held by every instance of a class
+  // cost a guard check to construct.
+  template<typename Tag>
+  JSLockStatistics& GetJSClassLockStatistics(const char* name) {
+    static JSLockStatistics& statistics = RegisterJSLockStatistics(name);
+    return statistics;
+  }
+
+  /*!
+   @class
+
+   @discussion A JSInstrumentedMutex is a Mutex that counts its
+   acquisitions in a JSLockStatistics. An uncontended lock costs a
+   try_lock and a relaxed atomic add more than Mutex does.
+   */
+  template<typename Mutex>
+  class JSInstrumentedMutex final {
+
+  public:
+
+    explicit JSInstrumentedMutex(JSLockStatistics& statistics) HAL_NOEXCEPT
+    : statistics__(statistics) {
+    }
+
+    JSInstrumentedMutex(const JSInstrumentedMutex&)            = delete;
+    JSInstrumentedMutex& operator=(const JSInstrumentedMutex&) = delete;
+
+    void lock() {
+      if (!mutex__.try_lock()) {
+        const auto start = std::chrono::steady_clock::now();
+        mutex__.lock();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        statistics__.contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+        statistics__.wait_nanoseconds.fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), std::memory_order_relaxed);
+      }
+      statistics__.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool try_lock() {
+      if (mutex__.try_lock()) {
+        statistics__.acquisitions.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      return false;
+    }
+
+    void unlock() {
+      mutex__.unlock();
+    }
+
+  private:
+
+    Mutex             mutex__;
+    JSLockStatistics& statistics__;
+  };
+
+  using JSMutex          = JSInstrumentedMutex<std::mutex>;
+  using JSRecursiveMutex = JSInstrumentedMutex<std::recursive_mutex>;
+
+}} // namespace HAL { namespace detail {
+
+// The initializer of a JSMutex or JSRecursiveMutex, which names its
+// lock. The names of the locks of every instance of a class are
+// looked up once for each Tag.
+#define HAL_LOCK_NAME(name)            { HAL::detail::RegisterJSLockStatistics(name) }
+#define HAL_LOCK_CLASS_NAME(Tag, name) { HAL::detail::GetJSClassLockStatistics<Tag>(name) }
+#else
+#include <mutex>
+
+namespace HAL { namespace detail {
+
+  using JSMutex          = std::mutex;
+  using JSRecursiveMutex = std::recursive_mutex;
+
+}} // namespace HAL { namespace detail {
+
+#define HAL_LOCK_NAME(name)
+#define HAL_LOCK_CLASS_NAME(Tag, name)
+#endif // HAL_LOCK_STATISTICS_ENABLE
+
+#endif // _HAL_DETAIL_JSLOCKSTATISTICS_HPP_
@@ -0,0 +1,110 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSLOGRATELIMITER_HPP_
+#define _HAL_DETAIL_JSLOGRATELIMITER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace HAL { namespace detail {
+  
+  /*!
+   @class
+   
+   @discussion A JSLogRateLimiter is the token bucket of one call site
+   of HAL_LOG_<SEVERITY>_RATE, letting through messages_per_second
+   messages a second after a burst of as many. It is lock free, and
+   its constructor is constexpr, so a function local static is
+   constant initialized and needs no guarded initialization.
+   */
+  class JSLogRateLimiter final {
+  public:
+    
+    // Return true if a message may be written now, setting
+    // suppressed_count to the number of messages dropped since the
+    // last one that was.
+    bool Allow(std::uint32_t messages_per_second, std::uint64_t& suppressed_count) {
+      if (messages_per_second == 0) {
+        return Suppress();
+      }
+      
+      // The bucket is kept as the theoretical time it is next empty,
+      // which each message moves on by one interval.
+      const std::int64_t interval = 1000000000 / messages_per_second;
+      const std::int64_t burst    = interval * messages_per_second;
+      const std::int64_t now      = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+      auto empty_time = empty_nanoseconds__.load(std::memory_order_relaxed);
+      for (;;) {
+        const auto start = empty_time > now ? empty_time : now;
+        if (start - now + interval > burst) {
+          return Suppress();
+        }
+        if (empty_nanoseconds__.compare_exchange_weak(empty_time, start + interval, std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      
+      suppressed_count = suppressed_count__.exchange(0, std::memory_order_relaxed);
+      return true;
+    }
+    
+  private:
+    
+    bool Suppress() {
+      suppressed_count__.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    
+    std::atomic<std::int64_t>  empty_nanoseconds__ { 0 };
+    std::atomic<std::uint64_t> suppressed_count__  { 0 };
+  };
+  
+  /*!
+   @class
+   
+   @discussion A JSLogSampler is the counter of one call site of
+   HAL_LOG_<SEVERITY>_EVERY_N, letting through the first message and
+   every n-th after it. Like JSLogRateLimiter, it starts as all zeros.
+   */
+  class JSLogSampler final {
+  public:
+    
+    bool Allow(std::uint64_t n, std::uint64_t& suppressed_count) {
+      const auto count = count__.fetch_add(1, std::memory_order_relaxed);
+      if (n > 1 && count % n != 0) {
+        return false;
+      }
+      suppressed_count = count == 0 || n <= 1 ? 0 : n - 1;
+      return true;
+    }
+    
+  private:
+    
+    std::atomic<std::uint64_t> count__ { 0 };
+  };
+  
+  // Written after a rate limited or sampled message to say how many
+  // like it were dropped, if any.
+  struct JSLogSuppressedCount {
+    std::uint64_t count;
+  };
+  
+  inline
+  std::ostream& operator<<(std::ostream& ostream, const JSLogSuppressedCount& suppressed_count) {
+    if (suppressed_count.count > 0) {
+      ostream << " (" << suppressed_count.count << " similar messages suppressed)";
+    }
+    return ostream;
+  }
+  
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSLOGRATELIMITER_HPP_
@@ -12,11 +12,17 @@
 #include "HAL/detail/JSLoggerPimpl.hpp"
 #include "HAL/detail/JSLoggerPolicyConsole.hpp"
 #include "HAL/detail/JSLoggerPolicyFile.hpp"
+#include "HAL/detail/JSLoggerPolicyBufferedFile.hpp"
+#include "HAL/detail/JSLoggerPolicyAsync.hpp"
+#include "HAL/detail/JSBinaryLogger.hpp"
+#include "HAL/detail/JSLogRateLimiter.hpp"
 #include <sstream>
 #include <iomanip>
+#include <atomic>
 #include <cstdint>
 #include <mutex>
 #include <memory>
+#include <type_traits>
 
 namespace HAL { namespace detail {
   
@@ -41,6 +47,16 @@ namespace HAL { namespace detail {
    }
    HAL_LOG_WARN("After loop.");
    HAL_LOG_ERROR("All good things come to an end.");
+   
+   A severity is compiled in with HAL_LOGGING_ENABLE_<SEVERITY>, or
+   with every severity from HAL_LOGGING_MIN_SEVERITY up, where TRACE
+   is 0 and ERROR is 4. Those compiled in can be turned off at run
+   time with SetJSLoggerSeverityThreshold. The arguments of a message
+   that is off are not evaluated, so it costs one branch.
+   
+   A call site that can be hit in a loop can bound its cost with
+   HAL_LOG_<SEVERITY>_EVERY_N(n, ...) or
+   HAL_LOG_<SEVERITY>_RATE(messages_per_second, ...).
    */
   
   enum class HAL_EXPORT JSLoggerSeverityType {
@@ -51,6 +67,19 @@ namespace HAL { namespace detail {
     JS_ERROR
   };
   
+  // Return true if messages of severity are written at run time.
+  inline
+  bool IsJSLoggerSeverityEnabled(JSLoggerSeverityType severity) {
+    return static_cast<int>(severity) >= JSLoggerPimpl::get_severity_threshold();
+  }
+  
+  // Write only the messages of severity threshold and above, of those
+  // compiled in.
+  inline
+  void SetJSLoggerSeverityThreshold(JSLoggerSeverityType threshold) {
+    JSLoggerPimpl::set_severity_threshold(static_cast<int>(threshold));
+  }
+  
   template<typename JSLoggerPolicy>
   class JSLogger final {
     
@@ -68,18 +97,22 @@ namespace HAL { namespace detail {
 #endif
     
     template<JSLoggerSeverityType severity, typename...Args>
-    void Print(Args...args);
+    void Print(const Args&...args);
     
   private:
     
     JSLogger(const std::string& name);
     ~JSLogger() = default;
     
-    // Core printing functionality.
-    void PrintImpl();
+    // Core printing functionality. Each message is formatted into its
+    // own stream, so threads only contend in Write.
+    void PrintImpl(std::ostringstream& log_stream);
     
     template<typename First, typename...Rest>
-    void PrintImpl(First first_parameter, Rest...rest);
+    void PrintImpl(std::ostringstream& log_stream, const First& first_parameter, const Rest&...rest);
+    
+    void Write(const std::string& log_message, std::true_type  is_thread_safe);
+    void Write(const std::string& log_message, std::false_type is_thread_safe);
     
     // This struct only exists so that a custom deleter can be passed to
     // std::shared_ptr<JSLogger<T>> while keeping the JSLogger<T> destructor
@@ -90,10 +123,9 @@ namespace HAL { namespace detail {
       }
     };
 
-    JSLoggerPolicy       js_log_policy__;
-    uint32_t             log_line_number__ { 0 };
-    std::ostringstream   log_stream__;
-    std::mutex           js_logger_mutex__;
+    JSLoggerPolicy        js_log_policy__;
+    std::atomic<uint32_t> log_line_number__ { 0 };
+    std::mutex            js_logger_mutex__;
     //std::recursive_mutex js_logger_mutex__;
   };
   
@@ -115,81 +147,167 @@ namespace HAL { namespace detail {
 
   template<typename JSLoggerPolicy>
   template<JSLoggerSeverityType severity, typename...Args>
-  void JSLogger<JSLoggerPolicy>::Print(Args...args)  {
-    std::lock_guard<std::mutex> lock(js_logger_mutex__);
+  void JSLogger<JSLoggerPolicy>::Print(const Args&...args)  {
+    std::ostringstream log_stream;
     
     // The Debug and Error severity strings (i.e. "DEBUG" and "ERROR")
     // are the longest of the three severity strings, and each is 5
     // characters long. Since we want all of the severity types to have
     // the same width on output, we set it to 5.
-    log_stream__ << std::setw(5) << std::left;
+    log_stream << std::setw(5) << std::left;
     
     switch(severity) {
       case JSLoggerSeverityType::JS_TRACE:
-        log_stream__ << "TRACE: ";
+        log_stream << "TRACE: ";
         break;
       case JSLoggerSeverityType::JS_DEBUG:
-        log_stream__ << "DEBUG: ";
+        log_stream << "DEBUG: ";
         break;
       case JSLoggerSeverityType::JS_INFO:
-        log_stream__ << "INFO: ";
+        log_stream << "INFO: ";
         break;
       case JSLoggerSeverityType::JS_WARN:
-        log_stream__ << "WARN: ";
+        log_stream << "WARN: ";
         break;
       case JSLoggerSeverityType::JS_ERROR:
-        log_stream__ << "ERROR: ";
+        log_stream << "ERROR: ";
         break;
     };
     
-    PrintImpl(args...);
+    PrintImpl(log_stream, args...);
   }
   
   template<typename JSLoggerPolicy>
-  void JSLogger<JSLoggerPolicy>::PrintImpl() {
-    js_log_policy__.Write(JSLoggerPimpl::GetLoglineHeader(log_line_number__++) + log_stream__.str() + ".");
-    log_stream__.str("");
+  void JSLogger<JSLoggerPolicy>::PrintImpl(std::ostringstream& log_stream) {
+    Write(log_stream.str(), std::integral_constant<bool, JSLoggerPolicyTraits<JSLoggerPolicy>::is_thread_safe>());
   }
   
   template<typename JSLoggerPolicy>
   template<typename First, typename...Rest >
-  void JSLogger<JSLoggerPolicy>::PrintImpl(First first_parameter, Rest...rest) {
-    log_stream__ << first_parameter;
-    PrintImpl(rest...);
+  void JSLogger<JSLoggerPolicy>::PrintImpl(std::ostringstream& log_stream, const First& first_parameter, const Rest&...rest) {
+    log_stream << first_parameter;
+    PrintImpl(log_stream, rest...);
+  }
+  
+  template<typename JSLoggerPolicy>
+  void JSLogger<JSLoggerPolicy>::Write(const std::string& log_message, std::true_type) {
+    js_log_policy__.Write(JSLoggerPimpl::GetLoglineHeader(log_line_number__.fetch_add(1, std::memory_order_relaxed)) + log_message + ".");
+  }
+  
+  template<typename JSLoggerPolicy>
+  void JSLogger<JSLoggerPolicy>::Write(const std::string& log_message, std::false_type) {
+    // The line numbers are taken under the lock so that they are
+    // written in order.
+    std::lock_guard<std::mutex> lock(js_logger_mutex__);
+    js_log_policy__.Write(JSLoggerPimpl::GetLoglineHeader(log_line_number__.fetch_add(1, std::memory_order_relaxed)) + log_message + ".");
   }
   
 // TODO: Add a more flexible way to specify the logging policy.
 //using JSLogger_t = JSLogger<JSLoggerPolicyFile>;
-using JSLogger_t = JSLogger<JSLoggerPolicyConsole>;
+#ifdef HAL_LOGGING_FILE_ENABLE
+// Add -DHAL_LOGGING_FILE_ENABLE=1 to write log messages to HAL.log, or
+// the path of JSLoggerPolicyBufferedFile::SetDefaultOptions, instead
+// of the console.
+using JSLoggerSink_t = JSLoggerPolicyBufferedFile;
+#else
+using JSLoggerSink_t = JSLoggerPolicyConsole;
+#endif
+
+#ifdef HAL_LOGGING_ASYNC_ENABLE
+// Add -DHAL_LOGGING_ASYNC_ENABLE=1 to write log messages from a
+// background thread, dropping them when it falls behind.
+using JSLogger_t = JSLogger<JSLoggerPolicyAsync<JSLoggerSink_t>>;
+#else
+using JSLogger_t = JSLogger<JSLoggerSink_t>;
+#endif
+
+#ifdef HAL_LOGGING_MIN_SEVERITY
+#if HAL_LOGGING_MIN_SEVERITY <= 0 && !defined(HAL_LOGGING_ENABLE_TRACE)
+#define HAL_LOGGING_ENABLE_TRACE
+#endif
+#if HAL_LOGGING_MIN_SEVERITY <= 1 && !defined(HAL_LOGGING_ENABLE_DEBUG)
+#define HAL_LOGGING_ENABLE_DEBUG
+#endif
+#if HAL_LOGGING_MIN_SEVERITY <= 2 && !defined(HAL_LOGGING_ENABLE_INFO)
+#define HAL_LOGGING_ENABLE_INFO
+#endif
+#if HAL_LOGGING_MIN_SEVERITY <= 3 && !defined(HAL_LOGGING_ENABLE_WARN)
+#define HAL_LOGGING_ENABLE_WARN
+#endif
+#if HAL_LOGGING_MIN_SEVERITY <= 4 && !defined(HAL_LOGGING_ENABLE_ERROR)
+#define HAL_LOGGING_ENABLE_ERROR
+#endif
+#endif
+
+// The severity is checked before the arguments are evaluated.
+#ifdef HAL_LOGGING_BINARY_ENABLE
+// Add -DHAL_LOGGING_BINARY_ENABLE=1 to write log messages as binary
+// records, registering the format of each call site the first time.
+#define HAL_LOG_PRINT(severity, ...) do { if (HAL::detail::IsJSLoggerSeverityEnabled(HAL::detail::JSLoggerSeverityType::severity)) { static const std::uint32_t hal_log_format_id = HAL::detail::JSBinaryLogger::Instance() -> RegisterFormat(__FILE__, __LINE__, static_cast<int>(HAL::detail::JSLoggerSeverityType::severity)); HAL::detail::JSBinaryLogger::Instance() -> Print(hal_log_format_id, __VA_ARGS__); } } while (false)
+#else
+#define HAL_LOG_PRINT(severity, ...) do { if (HAL::detail::IsJSLoggerSeverityEnabled(HAL::detail::JSLoggerSeverityType::severity)) { HAL::detail::JSLogger_t::Instance() -> Print<HAL::detail::JSLoggerSeverityType::severity>(__VA_ARGS__); } } while (false)
+#endif
+
+// Write the first message of a call site and every n-th after it, or
+// at most messages_per_second of them a second, followed by the number
+// of messages of the call site dropped since the last one written.
+#define HAL_LOG_PRINT_EVERY_N(severity, n, ...) do { static HAL::detail::JSLogSampler hal_log_sampler; std::uint64_t hal_log_suppressed_count = 0; if (HAL::detail::IsJSLoggerSeverityEnabled(HAL::detail::JSLoggerSeverityType::severity) && hal_log_sampler.Allow(n, hal_log_suppressed_count)) { HAL_LOG_PRINT(severity, __VA_ARGS__, HAL::detail::JSLogSuppressedCount { hal_log_suppressed_count }); } } while (false)
+#define HAL_LOG_PRINT_RATE(severity, messages_per_second, ...) do { static HAL::detail::JSLogRateLimiter hal_log_rate_limiter; std::uint64_t hal_log_suppressed_count = 0; if (HAL::detail::IsJSLoggerSeverityEnabled(HAL::detail::JSLoggerSeverityType::severity) && hal_log_rate_limiter.Allow(messages_per_second, hal_log_suppressed_count)) { HAL_LOG_PRINT(severity, __VA_ARGS__, HAL::detail::JSLogSuppressedCount { hal_log_suppressed_count }); } } while (false)
+
+// The rate at which errors a script can cause, such as those thrown
+// back to it from a callback, are logged.
+#ifndef HAL_LOG_SCRIPT_ERROR_RATE
+#define HAL_LOG_SCRIPT_ERROR_RATE 10
+#endif
 
 #ifdef HAL_LOGGING_ENABLE_TRACE
-#define HAL_LOG_TRACE HAL::detail::JSLogger_t::Instance() -> Print<HAL::detail::JSLoggerSeverityType::JS_TRACE>
+#define HAL_LOG_TRACE(...) HAL_LOG_PRINT(JS_TRACE, __VA_ARGS__)
+#define HAL_LOG_TRACE_EVERY_N(n, ...) HAL_LOG_PRINT_EVERY_N(JS_TRACE, n, __VA_ARGS__)
+#define HAL_LOG_TRACE_RATE(messages_per_second, ...) HAL_LOG_PRINT_RATE(JS_TRACE, messages_per_second, __VA_ARGS__)
 #else
 #define HAL_LOG_TRACE(...)
+#define HAL_LOG_TRACE_EVERY_N(n, ...)
+#define HAL_LOG_TRACE_RATE(messages_per_second, ...)
 #endif
 
 #ifdef HAL_LOGGING_ENABLE_DEBUG
-#define HAL_LOG_DEBUG HAL::detail::JSLogger_t::Instance() -> Print<HAL::detail::JSLoggerSeverityType::JS_DEBUG>
+#define HAL_LOG_DEBUG(...) HAL_LOG_PRINT(JS_DEBUG, __VA_ARGS__)
+#define HAL_LOG_DEBUG_EVERY_N(n, ...) HAL_LOG_PRINT_EVERY_N(JS_DEBUG, n, __VA_ARGS__)
+#define HAL_LOG_DEBUG_RATE(messages_per_second, ...) HAL_LOG_PRINT_RATE(JS_DEBUG, messages_per_second, __VA_ARGS__)
 #else
 #define HAL_LOG_DEBUG(...)
+#define HAL_LOG_DEBUG_EVERY_N(n, ...)
+#define HAL_LOG_DEBUG_RATE(messages_per_second, ...)
 #endif
 
 #ifdef HAL_LOGGING_ENABLE_INFO
-#define HAL_LOG_INFO  HAL::detail::JSLogger_t::Instance() -> Print<HAL::detail::JSLoggerSeverityType::JS_INFO>
+#define HAL_LOG_INFO(...)  HAL_LOG_PRINT(JS_INFO, __VA_ARGS__)
+#define HAL_LOG_INFO_EVERY_N(n, ...)  HAL_LOG_PRINT_EVERY_N(JS_INFO, n, __VA_ARGS__)
+#define HAL_LOG_INFO_RATE(messages_per_second, ...)  HAL_LOG_PRINT_RATE(JS_INFO, messages_per_second, __VA_ARGS__)
 #else
 #define HAL_LOG_INFO(...)
+#define HAL_LOG_INFO_EVERY_N(n, ...)
+#define HAL_LOG_INFO_RATE(messages_per_second, ...)
 #endif
 
 #ifdef HAL_LOGGING_ENABLE_WARN
-#define HAL_LOG_WARN  HAL::detail::JSLogger_t::Instance() -> Print<HAL::detail::JSLoggerSeverityType::JS_WARN>
+#define HAL_LOG_WARN(...)  HAL_LOG_PRINT(JS_WARN, __VA_ARGS__)
+#define HAL_LOG_WARN_EVERY_N(n, ...)  HAL_LOG_PRINT_EVERY_N(JS_WARN, n, __VA_ARGS__)
+#define HAL_LOG_WARN_RATE(messages_per_second, ...)  HAL_LOG_PRINT_RATE(JS_WARN, messages_per_second, __VA_ARGS__)
 #else
 #define HAL_LOG_WARN(...)
+#define HAL_LOG_WARN_EVERY_N(n, ...)
+#define HAL_LOG_WARN_RATE(messages_per_second, ...)
 #endif
 
 #ifdef HAL_LOGGING_ENABLE_ERROR
-#define HAL_LOG_ERROR HAL::detail::JSLogger_t::Instance() -> Print<HAL::detail::JSLoggerSeverityType::JS_ERROR>
+#define HAL_LOG_ERROR(...) HAL_LOG_PRINT(JS_ERROR, __VA_ARGS__)
+#define HAL_LOG_ERROR_EVERY_N(n, ...) HAL_LOG_PRINT_EVERY_N(JS_ERROR, n, __VA_ARGS__)
+#define HAL_LOG_ERROR_RATE(messages_per_second, ...) HAL_LOG_PRINT_RATE(JS_ERROR, messages_per_second, __VA_ARGS__)
 #else
 #define HAL_LOG_ERROR(...)
+#define HAL_LOG_ERROR_EVERY_N(n, ...)
+#define HAL_LOG_ERROR_RATE(messages_per_second, ...)
 #endif
 
 }} // namespace HAL { namespace detail {
@@ -10,6 +10,7 @@
 #define _HAL_DETAIL_JSLOGGERPIMPL_HPP_
 
 #include "HAL_EXPORT.h"
+#include <atomic>
 #include <string>
 #include <cstdint>
 
@@ -32,6 +33,25 @@ namespace HAL { namespace detail {
     JSLoggerPimpl& operator=(JSLoggerPimpl&&)      = delete;
     
     static std::string GetLoglineHeader(uint32_t log_line_number);
+    
+    // The least JSLoggerSeverityType, as an int, that is written at
+    // run time. Every severity compiled in is written by default.
+    static int get_severity_threshold() {
+      return severity_threshold__.load(std::memory_order_relaxed);
+    }
+    
+    static void set_severity_threshold(int severity_threshold) {
+      severity_threshold__.store(severity_threshold, std::memory_order_relaxed);
+    }
+    
+  private:
+    
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    static std::atomic<int> severity_threshold__;
+#pragma warning(pop)
   };
   
 }} // namespace HAL { namespace detail
@@ -0,0 +1,192 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSLOGGERPOLICYASYNC_HPP_
+#define _HAL_DETAIL_JSLOGGERPOLICYASYNC_HPP_
+
+#include "HAL/detail/JSLoggerPolicyInterface.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSLoggerPolicyAsync hands log messages to a background
+   thread that writes them to a Sink policy, such as
+   JSLoggerPolicyConsole, so that logging never waits for I/O.
+
+   Messages go through a bounded multiple producer, single consumer
+   ring of kCapacity slots, which Write claims with a compare and swap
+   and no lock. When the ring is full the new message is dropped
+   rather than blocking its thread, and the writer thread reports how
+   many were dropped after the messages that got through. Messages
+   are written in the order their slots were claimed.
+
+   Flush waits until everything written so far has reached the sink,
+   and destroying the policy writes what is left in the ring.
+   */
+  template<typename Sink>
+  class JSLoggerPolicyAsync final : public JSLoggerPolicyInterface {
+  public:
+
+    static const std::size_t kCapacity = 4096;
+
+    JSLoggerPolicyAsync(const std::string& name)
+    : sink__(name)
+    , slots__(new Slot[kCapacity]) {
+      for (std::size_t i = 0; i < kCapacity; ++i) {
+        slots__[i].sequence.store(i, std::memory_order_relaxed);
+      }
+      thread__ = std::thread(&JSLoggerPolicyAsync::Run, this);
+    }
+
+    ~JSLoggerPolicyAsync() {
+      {
+        std::lock_guard<std::mutex> lock(mutex__);
+        stopped__ = true;
+      }
+      condition__.notify_one();
+      thread__.join();
+    }
+
+    JSLoggerPolicyAsync()                                      = delete;
+    JSLoggerPolicyAsync(const JSLoggerPolicyAsync&)            = delete;
+    JSLoggerPolicyAsync& operator=(const JSLoggerPolicyAsync&) = delete;
+
+    virtual void Write(const std::string& log_message) override final {
+      auto position = enqueue_position__.load(std::memory_order_relaxed);
+      Slot* slot = nullptr;
+      for (;;) {
+        slot = &slots__[position % kCapacity];
+        const auto sequence   = slot -> sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0) {
+          if (enqueue_position__.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        } else if (difference < 0) {
+          // The writer thread hasn't freed this slot yet.
+          dropped_count__.fetch_add(1, std::memory_order_relaxed);
+          return;
+        } else {
+          position = enqueue_position__.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot -> message = log_message;
+      slot -> sequence.store(position + 1, std::memory_order_release);
+      condition__.notify_one();
+    }
+
+    /*!
+     @method
+
+     @abstract Wait until every message written before this call has
+     been written to the sink or dropped.
+     */
+    void Flush() {
+      const auto position = enqueue_position__.load(std::memory_order_relaxed);
+      std::unique_lock<std::mutex> lock(mutex__);
+      condition__.notify_one();
+      flushed__.wait(lock, [this, position] { return dequeue_position__.load(std::memory_order_relaxed) >= position; });
+    }
+
+    // The number of messages dropped because the ring was full.
+    std::uint64_t get_dropped_count() const {
+      return dropped_count__.load(std::memory_order_relaxed);
+    }
+
+  private:
+
+    struct Slot {
+      std::atomic<std::size_t> sequence;
+      std::string              message;
+    };
+
+    void Run() {
+      std::uint64_t reported_dropped_count = 0;
+      std::unique_lock<std::mutex> lock(mutex__);
+      for (;;) {
+        const bool stopped = stopped__;
+        lock.unlock();
+
+        std::string message;
+        while (Pop(message)) {
+          sink__.Write(message);
+        }
+
+        const auto dropped_count = dropped_count__.load(std::memory_order_relaxed);
+        if (dropped_count != reported_dropped_count) {
+          sink__.Write("HAL JSLoggerPolicyAsync: dropped " + std::to_string(dropped_count - reported_dropped_count) + " messages.");
+          reported_dropped_count = dropped_count;
+        }
+
+        lock.lock();
+        flushed__.notify_all();
+        if (stopped) {
+          return;
+        }
+
+        // Producers notify without the lock, so a wakeup can be
+        // missed. The timeout bounds the delay that causes.
+        condition__.wait_for(lock, std::chrono::milliseconds(10));
+      }
+    }
+
+    // Only the writer thread pops.
+    bool Pop(std::string& message) {
+      const auto position = dequeue_position__.load(std::memory_order_relaxed);
+      auto& slot = slots__[position % kCapacity];
+      if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+        return false;
+      }
+
+      // Swapping leaves the slot the capacity of the last message.
+      message.swap(slot.message);
+      slot.message.clear();
+      slot.sequence.store(position + kCapacity, std::memory_order_release);
+      dequeue_position__.store(position + 1, std::memory_order_relaxed);
+      return true;
+    }
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    Sink                       sink__;
+    std::unique_ptr<Slot[]>    slots__;
+    std::atomic<std::size_t>   enqueue_position__ { 0 };
+    std::atomic<std::size_t>   dequeue_position__ { 0 };
+    std::atomic<std::uint64_t> dropped_count__    { 0 };
+
+    std::mutex                 mutex__;
+    std::condition_variable    condition__;
+    std::condition_variable    flushed__;
+    bool                       stopped__ { false };
+    std::thread                thread__;
+#pragma warning(pop)
+  };
+
+  template<typename Sink>
+  struct JSLoggerPolicyTraits<JSLoggerPolicyAsync<Sink>> {
+    static const bool is_thread_safe = true;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSLOGGERPOLICYASYNC_HPP_
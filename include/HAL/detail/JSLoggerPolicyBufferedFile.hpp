@@ -0,0 +1,99 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSLOGGERPOLICYBUFFEREDFILE_HPP_
+#define _HAL_DETAIL_JSLOGGERPOLICYBUFFEREDFILE_HPP_
+
+#include "HAL/detail/JSLoggerPolicyInterface.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace HAL { namespace detail {
+  
+  /*!
+   @struct
+   
+   @discussion The options of a JSLoggerPolicyBufferedFile.
+   
+   Messages are held in memory until flush_bytes of them are buffered,
+   or a message is written flush_interval after the last flush, so
+   about that much of the log is lost if the process dies.
+   
+   When writing a message would make the file larger than
+   max_file_bytes, the file is renamed to path.1, path.1 to path.2 and
+   so on, the oldest of max_backup_count is removed, and a new file is
+   started. A max_file_bytes of 0 never rotates.
+   */
+  struct JSLoggerFileOptions {
+    std::string               path;
+    std::size_t               flush_bytes      { 64 * 1024 };
+    std::chrono::milliseconds flush_interval   { 1000 };
+    std::uint64_t             max_file_bytes   { 10 * 1024 * 1024 };
+    std::uint32_t             max_backup_count { 3 };
+  };
+  
+  /*!
+   @class
+   
+   @discussion A JSLoggerPolicyBufferedFile writes log messages to a
+   file without flushing on every line, rotating the file when it
+   grows past a size. Write isn't thread safe, which JSLogger and
+   JSLoggerPolicyAsync take care of.
+   */
+  class HAL_EXPORT JSLoggerPolicyBufferedFile final : public JSLoggerPolicyInterface {
+  public:
+    
+    // Use the default options, writing to name unless they name a
+    // path.
+    JSLoggerPolicyBufferedFile(const std::string& name);
+    JSLoggerPolicyBufferedFile(const std::string& name, const JSLoggerFileOptions& options);
+    
+    ~JSLoggerPolicyBufferedFile();
+    
+    JSLoggerPolicyBufferedFile()                                             = delete;
+    JSLoggerPolicyBufferedFile(const JSLoggerPolicyBufferedFile&)            = delete;
+    JSLoggerPolicyBufferedFile& operator=(const JSLoggerPolicyBufferedFile&) = delete;
+    
+    virtual void Write(const std::string& log_message) override final;
+    
+    // Write the buffered messages to the file.
+    void Flush();
+    
+    /*!
+     @method
+     
+     @abstract Set the options used by the policies created after this
+     call, such as the one of JSLogger_t when it is first used.
+     */
+    static void SetDefaultOptions(const JSLoggerFileOptions& options);
+    static JSLoggerFileOptions GetDefaultOptions();
+    
+  private:
+    
+    void Open();
+    void Rotate();
+    
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSLoggerFileOptions                   options__;
+    std::ofstream                         ofstream__;
+    std::string                           buffer__;
+    std::uint64_t                         file_bytes__ { 0 };
+    std::chrono::steady_clock::time_point last_flush__;
+#pragma warning(pop)
+  };
+  
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSLOGGERPOLICYBUFFEREDFILE_HPP_
@@ -10,6 +10,7 @@
 #define _HAL_DETAIL_JSLOGGERPOLICYINTERFACE_HPP_
 
 #include "HAL_EXPORT.h"
+#include <string>
 
 namespace HAL { namespace detail {
   
@@ -29,6 +30,14 @@ namespace HAL { namespace detail {
     virtual void Write(const std::string& log_message) = 0;
   };
   
+  // A JSLogger serializes the calls to Write of a policy with a mutex,
+  // unless the policy specializes this to say Write may be called from
+  // several threads at once.
+  template<typename JSLoggerPolicy>
+  struct JSLoggerPolicyTraits {
+    static const bool is_thread_safe = false;
+  };
+  
 }} // namespace HAL { namespace detail {
 
 #endif // _HAL_DETAIL_JSLOGGERPOLICYINTERFACE_HPP_
@@ -0,0 +1,63 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSMAPPEDFILE_HPP_
+#define _HAL_DETAIL_JSMAPPEDFILE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSMappedFile maps a whole file read-only into memory
+   for as long as it is alive, so its contents are paged in by the
+   operating system instead of being copied into a buffer.
+   */
+  class HAL_EXPORT JSMappedFile final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Map the file at path.
+
+     @throws std::runtime_error if the file can't be opened or mapped.
+     */
+    explicit JSMappedFile(const std::string& path);
+    ~JSMappedFile() HAL_NOEXCEPT;
+
+    JSMappedFile(const JSMappedFile&)            = delete;
+    JSMappedFile& operator=(const JSMappedFile&) = delete;
+
+    const char* data() const HAL_NOEXCEPT {
+      return data__;
+    }
+
+    std::size_t size() const HAL_NOEXCEPT {
+      return size__;
+    }
+
+  private:
+
+    const char* data__ { nullptr };
+    std::size_t size__ { 0 };
+#ifdef _WIN32
+    void*       file_handle__    { nullptr };
+    void*       mapping_handle__ { nullptr };
+#endif
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSMAPPEDFILE_HPP_
@@ -0,0 +1,122 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSNODEPOOL_HPP_
+#define _HAL_DETAIL_JSNODEPOOL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <unordered_map>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @struct
+
+   @discussion Counters of the node pool since the process started,
+   summed over all threads.
+   */
+  struct JSNodePoolStatistics {
+    // Nodes handed out by AllocateNode.
+    std::uint64_t allocation_count;
+
+    // Nodes handed out from a thread's free list rather than the heap.
+    std::uint64_t reuse_count;
+
+    // Nodes returned to the heap because their thread's free list was
+    // full or the thread exited.
+    std::uint64_t heap_free_count;
+  };
+
+  /*!
+   @function
+
+   @abstract Allocate a node of size bytes from the calling thread's
+   free list, falling back to the heap.
+
+   @discussion Nodes are kept in per-thread free lists of 16 byte size
+   classes up to kJSNodePoolMaxNodeSize bytes, so allocating and
+   freeing them takes no lock. A node may be freed on any thread, and
+   goes to that thread's free list. Each free list keeps at most
+   kJSNodePoolMaxCachedNodes nodes, and returns them to the heap when
+   its thread exits.
+   */
+  HAL_EXPORT void* AllocateNode(std::size_t size);
+
+  // Free a node returned by AllocateNode for the same size.
+  HAL_EXPORT void DeallocateNode(void* node, std::size_t size) HAL_NOEXCEPT;
+
+  HAL_EXPORT JSNodePoolStatistics GetNodePoolStatistics() HAL_NOEXCEPT;
+
+  HAL_CONSTEXPR const std::size_t kJSNodePoolMaxNodeSize    = 256;
+  HAL_CONSTEXPR const std::size_t kJSNodePoolMaxCachedNodes = 4096;
+
+  /*!
+   @class
+
+   @discussion A JSNodePoolAllocator is a standard allocator that takes
+   single objects, such as the nodes of a node based container, from
+   the node pool, and larger arrays, such as hash table buckets, from
+   the heap.
+   */
+  template<typename T>
+  class JSNodePoolAllocator final {
+
+  public:
+
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+      typedef JSNodePoolAllocator<U> other;
+    };
+
+    JSNodePoolAllocator() HAL_NOEXCEPT {
+    }
+
+    template<typename U>
+    JSNodePoolAllocator(const JSNodePoolAllocator<U>&) HAL_NOEXCEPT {
+    }
+
+    T* allocate(std::size_t n) {
+      if (n == 1) {
+        return static_cast<T*>(AllocateNode(sizeof(T)));
+      }
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) HAL_NOEXCEPT {
+      if (n == 1) {
+        DeallocateNode(p, sizeof(T));
+      } else {
+        ::operator delete(p);
+      }
+    }
+  };
+
+  template<typename T, typename U>
+  bool operator==(const JSNodePoolAllocator<T>&, const JSNodePoolAllocator<U>&) HAL_NOEXCEPT {
+    return true;
+  }
+
+  template<typename T, typename U>
+  bool operator!=(const JSNodePoolAllocator<T>&, const JSNodePoolAllocator<U>&) HAL_NOEXCEPT {
+    return false;
+  }
+
+  // An std::unordered_map whose nodes come from the node pool.
+  template<typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+  using JSNodePoolUnorderedMap = std::unordered_map<Key, T, Hash, KeyEqual, JSNodePoolAllocator<std::pair<const Key, T>>>;
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSNODEPOOL_HPP_
@@ -0,0 +1,142 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSOBJECTREFREGISTRY_HPP_
+#define _HAL_DETAIL_JSOBJECTREFREGISTRY_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSNodePool.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSObjectRefRegistry tracks, for every JSObjectRef
+   wrapped by a live JSObject, the JSContextRef it was registered with
+   and the number of JSObjects currently wrapping it.
+
+   The first registration of a JSObjectRef calls JSValueProtect and
+   the last unregistration calls JSValueUnprotect, so JavaScriptCore
+   sees exactly one protect per JSObjectRef regardless of how many
+   JSObject copies exist.
+
+   The table is split into shards selected by a hash of the
+   JSObjectRef. When HAL_THREAD_SAFE or HAL_THREAD_AFFINITY is defined
+   each shard has its own mutex, so threads working on unrelated
+   objects rarely contend with each other.
+   */
+  class HAL_EXPORT JSObjectRefRegistry final {
+
+  public:
+
+    JSObjectRefRegistry()                                      = default;
+    ~JSObjectRefRegistry()                                     = default;
+    JSObjectRefRegistry(const JSObjectRefRegistry&)            = delete;
+    JSObjectRefRegistry(JSObjectRefRegistry&&)                 = delete;
+    JSObjectRefRegistry& operator=(const JSObjectRefRegistry&) = delete;
+    JSObjectRefRegistry& operator=(JSObjectRefRegistry&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Increment the registration count of a JSObjectRef,
+     calling JSValueProtect if this is its first registration.
+
+     @result The registration count after incrementing.
+     */
+    std::size_t Register(JSContextRef js_context_ref, JSObjectRef js_object_ref);
+
+    /*!
+     @method
+
+     @abstract Decrement the registration count of a JSObjectRef,
+     calling JSValueUnprotect if this was its last registration.
+
+     @result The registration count after decrementing, or 0 if the
+     JSObjectRef was not registered.
+     */
+    std::size_t UnRegister(JSObjectRef js_object_ref);
+
+    /*!
+     @method
+
+     @abstract Return the JSContextRef a JSObjectRef was registered
+     with.
+
+     @result The registered JSContextRef, or nullptr if the JSObjectRef
+     is not registered.
+     */
+    JSContextRef Find(JSObjectRef js_object_ref) const;
+
+    /*!
+     @method
+
+     @abstract Return the total number of registered JSObjectRefs.
+     */
+    std::size_t size() const;
+
+    /*!
+     @method
+
+     @abstract Call callback for every registered JSObjectRef with the
+     JSContextRef it was registered with, its registration count and,
+     when HAL_TRACK_RETAINED_HANDLES is defined, the call site and
+     stack that first registered it (otherwise empty strings).
+
+     @discussion Each shard is locked while callback runs on its
+     entries, so callback must not create or destroy JSObjects.
+     */
+    void ForEach(const std::function<void(JSContextRef js_context_ref, JSObjectRef js_object_ref, std::size_t count, const std::string& site, const std::string& backtrace)>& callback) const;
+
+  private:
+
+    struct Entry {
+      JSContextRef js_context_ref;
+      std::size_t  count;
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      std::string  site;
+      std::string  backtrace;
+#endif
+    };
+
+    // Must be a power of two.
+    static const std::size_t kShardCount = 64;
+
+    struct Shard {
+      JSNodePoolUnorderedMap<std::intptr_t, Entry> map;
+#ifdef HAL_THREAD_SAFE_STATICS
+      mutable JSMutex mutex HAL_LOCK_CLASS_NAME(JSObjectRefRegistry, "JSObjectRefRegistry");
+#endif
+    };
+
+    static std::size_t ShardIndex(std::intptr_t key) HAL_NOEXCEPT {
+      // The low bits of a heap pointer are mostly alignment, so mix in
+      // the higher bits before masking.
+      const auto bits = static_cast<std::uintptr_t>(key);
+      return static_cast<std::size_t>((bits >> 4) ^ (bits >> 12)) & (kShardCount - 1);
+    }
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::array<Shard, kShardCount> shards__;
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSOBJECTREFREGISTRY_HPP_
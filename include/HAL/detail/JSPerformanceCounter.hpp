@@ -11,72 +11,101 @@
 
 #ifdef HAL_PERFORMANCE_COUNTER_ENABLE
 #include <atomic>
+#include <cstddef>
 
 namespace HAL { namespace detail {
   
   // Add -DHAL_PERFORMANCE_COUNTER_ENABLE=1 to enable the performance counters.
   
+  static const std::size_t kJSPerformanceCounterShardCount = 16;
+  
+  // Return the shard of the calling thread. Threads are given shards
+  // in turn, so until there are more threads than shards no two
+  // threads share one.
+  inline
+  std::size_t GetPerformanceCounterShard() HAL_NOEXCEPT {
+    static std::atomic<std::size_t> next_shard { 0 };
+    static HAL_THREAD_LOCAL std::size_t shard_plus_one = 0;
+    if (shard_plus_one == 0) {
+      shard_plus_one = next_shard.fetch_add(1, std::memory_order_relaxed) % kJSPerformanceCounterShardCount + 1;
+    }
+    return shard_plus_one - 1;
+  }
+  
+  /*!
+   @class
+   
+   @discussion The counters of a JSPerformanceCounter<T> are sharded
+   by thread, and each shard fills its own cache line, so threads
+   creating and destroying objects of the same type don't contend.
+   The getters add the shards up, so a count read while other threads
+   are counting is a snapshot of each shard rather than of all of them
+   at once.
+   */
   template <typename T>
   class JSPerformanceCounter {
     
   public:
     
     static long get_objects_alive() {
-      return objects_alive_;
+      return Sum(&Shard::objects_alive);
     }
     
     static long get_objects_created() {
-      return objects_created_;
+      return Sum(&Shard::objects_created);
     }
     
     static long get_objects_destroyed() {
-      return objects_destroyed_;
+      return Sum(&Shard::objects_destroyed);
     }
     
     static long get_objects_copy_constructed() {
-      return objects_copy_constructed_;
+      return Sum(&Shard::objects_copy_constructed);
     }
     
     static long get_objects_move_constructed() {
-      return objects_move_constructed_;
+      return Sum(&Shard::objects_move_constructed);
     }
     
     static long get_objects_copy_assigned() {
-      return objects_copy_assigned_;
+      return Sum(&Shard::objects_copy_assigned);
     }
     
     static long get_objects_move_assigned() {
-      return objects_move_assigned_;
+      return Sum(&Shard::objects_move_assigned);
     }
     
     JSPerformanceCounter() {
-      ++objects_alive_;
-      ++objects_created_;
+      auto& shard = GetShard();
+      Increment(shard.objects_alive);
+      Increment(shard.objects_created);
     }
     
     // Copy constructor.
     JSPerformanceCounter(const JSPerformanceCounter& rhs) {
-      ++objects_alive_;
-      ++objects_created_;
-      ++objects_copy_constructed_;
+      auto& shard = GetShard();
+      Increment(shard.objects_alive);
+      Increment(shard.objects_created);
+      Increment(shard.objects_copy_constructed);
     }
     
     // Move constructor.
     JSPerformanceCounter(JSPerformanceCounter&& rhs) {
-      ++objects_alive_;
-      ++objects_created_;
-      ++objects_move_constructed_;
+      auto& shard = GetShard();
+      Increment(shard.objects_alive);
+      Increment(shard.objects_created);
+      Increment(shard.objects_move_constructed);
     }
     
     // copy assignment operator
-    JSPerformanceCounter& operator=(const JSPerformanceCounter&& rhs) {
-      ++objects_copy_assigned_;
+    JSPerformanceCounter& operator=(const JSPerformanceCounter& rhs) {
+      Increment(GetShard().objects_copy_assigned);
       return *this;
     }
     
     // move assignment operator
     JSPerformanceCounter& operator=(JSPerformanceCounter&& rhs) {
-      ++objects_move_assigned_;
+      Increment(GetShard().objects_move_assigned);
       return *this;
     }
     
@@ -84,43 +113,58 @@ namespace HAL { namespace detail {
     
     // Objects should never be removed through pointers of this type.
     ~JSPerformanceCounter() {
-      --objects_alive_;
-      ++objects_destroyed_;
+      auto& shard = GetShard();
+      Decrement(shard.objects_alive);
+      Increment(shard.objects_destroyed);
     }
     
     
   private:
     
-    static std::atomic<long> objects_alive_;
-    static std::atomic<long> objects_created_;
-    static std::atomic<long> objects_destroyed_;
-    static std::atomic<long> objects_copy_constructed_;
-    static std::atomic<long> objects_move_constructed_;
-    static std::atomic<long> objects_copy_assigned_;
-    static std::atomic<long> objects_move_assigned_;
+    // An object destroyed on another thread than the one that created
+    // it decrements objects_alive on a different shard, so a shard's
+    // count can be negative while the sum is right. Aligning the shard
+    // to a 64 byte cache line starts each one on a line of its own and
+    // pads it to the next.
+    struct HAL_ALIGNAS(64) Shard {
+      std::atomic<long> objects_alive;
+      std::atomic<long> objects_created;
+      std::atomic<long> objects_destroyed;
+      std::atomic<long> objects_copy_constructed;
+      std::atomic<long> objects_move_constructed;
+      std::atomic<long> objects_copy_assigned;
+      std::atomic<long> objects_move_assigned;
+    };
+    
+    static_assert(sizeof(Shard) % 64 == 0, "A shard must fill whole cache lines");
+    
+    static Shard& GetShard() HAL_NOEXCEPT {
+      return shards_[GetPerformanceCounterShard()];
+    }
+    
+    // Only the calling thread normally writes its shard, so relaxed
+    // read-modify-writes never wait for another core.
+    static void Increment(std::atomic<long>& counter) HAL_NOEXCEPT {
+      counter.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    static void Decrement(std::atomic<long>& counter) HAL_NOEXCEPT {
+      counter.fetch_sub(1, std::memory_order_relaxed);
+    }
+    
+    static long Sum(std::atomic<long> Shard::* counter) HAL_NOEXCEPT {
+      long sum = 0;
+      for (const auto& shard : shards_) {
+        sum += (shard.*counter).load(std::memory_order_relaxed);
+      }
+      return sum;
+    }
+    
+    static Shard shards_[kJSPerformanceCounterShardCount];
   };
   
   template<typename T>
-  std::atomic<long> JSPerformanceCounter<T>::objects_alive_;
-  
-  template<typename T>
-  std::atomic<long> JSPerformanceCounter<T>::objects_created_;
-  
-  template<typename T>
-  std::atomic<long> JSPerformanceCounter<T>::objects_destroyed_;
-  
-  template<typename T>
-  std::atomic<long> JSPerformanceCounter<T>::objects_copy_constructed_;
-  
-  template<typename T>
-  std::atomic<long> JSPerformanceCounter<T>::objects_move_constructed_;
-  
-  template<typename T>
-  std::atomic<long> JSPerformanceCounter<T>::objects_copy_assigned_;
-  
-  template<typename T>
-  std::atomic<long> JSPerformanceCounter<T>::objects_move_assigned_;
-  
+  typename JSPerformanceCounter<T>::Shard JSPerformanceCounter<T>::shards_[kJSPerformanceCounterShardCount];
   
 }} // namespace HAL { namespace detail {
 
@@ -11,7 +11,9 @@
 
 #include "HAL/detail/JSBase.hpp"
 #include "HAL/JSPropertyAttribute.hpp"
+#include "HAL/detail/JSPropertyProfile.hpp"
 
+#include <memory>
 #include <string>
 #include <unordered_set>
 
@@ -43,16 +45,28 @@ namespace HAL { namespace detail {
      
      @throws std::invalid_argument if property_name is empty.
      */
-    JSPropertyCallback(const std::string& name, const std::unordered_set<JSPropertyAttribute, std::hash<JSPropertyAttribute>>& attributes);
+    JSPropertyCallback(const std::string& name, JSPropertyAttributeSet attributes);
     
     virtual std::string get_name() const HAL_NOEXCEPT final {
       return name__;
     }
     
     virtual std::unordered_set<JSPropertyAttribute> get_attributes() const HAL_NOEXCEPT final {
+      return attributes__.ToUnorderedSet();
+    }
+    
+    JSPropertyAttributeSet get_attribute_set() const HAL_NOEXCEPT {
       return attributes__;
     }
     
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+    // The call counters of the property, shared by all copies of this
+    // callback.
+    JSPropertyProfile& get_profile() const HAL_NOEXCEPT {
+      return *profile__;
+    }
+#endif
+    
     virtual ~JSPropertyCallback()                            = default;
     JSPropertyCallback(const JSPropertyCallback&)            HAL_NOEXCEPT;
     JSPropertyCallback(JSPropertyCallback&&)                 HAL_NOEXCEPT;
@@ -69,6 +83,9 @@ namespace HAL { namespace detail {
 #pragma warning(push)
 #pragma warning(disable: 4251)
     std::string name__;
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+    std::shared_ptr<JSPropertyProfile> profile__;
+#endif
 #pragma warning(pop)
     
   protected:
@@ -77,13 +94,13 @@ namespace HAL { namespace detail {
     // need to be exported from a DLL.
 #pragma warning(push)
 #pragma warning(disable: 4251)
-    std::unordered_set<JSPropertyAttribute> attributes__;
+    JSPropertyAttributeSet attributes__;
 #pragma warning(pop)
     
 #undef HAL_DETAIL_JSPROPERTYCALLBACK_LOCK_GUARD
 #ifdef HAL_THREAD_SAFE
-    std::recursive_mutex             mutex__;
-#define HAL_DETAIL_JSPROPERTYCALLBACK_LOCK_GUARD std::lock_guard<std::recursive_mutex> lock_guard(mutex__)
+    JSRecursiveMutex                 mutex__ HAL_LOCK_CLASS_NAME(JSPropertyCallback, "JSPropertyCallback");
+#define HAL_DETAIL_JSPROPERTYCALLBACK_LOCK_GUARD std::lock_guard<JSRecursiveMutex> lock_guard(mutex__)
 #else
 #define HAL_DETAIL_JSPROPERTYCALLBACK_LOCK_GUARD
 #endif  // HAL_THREAD_SAFE
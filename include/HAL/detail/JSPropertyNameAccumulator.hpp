@@ -11,7 +11,12 @@
 
 #include "HAL/detail/JSBase.hpp"
 #include "HAL/JSString.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
 #include <iostream>
+#include <iterator>
+#include <string>
+#include <cstring>
 #include <cassert>
 
 namespace HAL {
@@ -34,7 +39,7 @@ namespace HAL {
    an ordered set used to collect the names of a JavaScript object's
    properties
    */
-  class JSPropertyNameAccumulator HAL_PERFORMANCE_COUNTER2(JSPropertyNameAccumulator) {
+  class JSPropertyNameAccumulator HAL_PERFORMANCE_COUNTER1(JSPropertyNameAccumulator) {
       
     public:
       
@@ -58,6 +63,70 @@ namespace HAL {
         JSPropertyNameAccumulatorAddName(js_property_name_accumulator_ref__, static_cast<JSStringRef>(property_name));
       }
       
+      // For interoperability with the JavaScriptCore C API, without
+      // creating a JSString.
+      void AddName(JSStringRef property_name_ref) const {
+        JSPropertyNameAccumulatorAddName(js_property_name_accumulator_ref__, property_name_ref);
+      }
+      
+      /*!
+       @method
+       
+       @abstract Adds a UTF-8 or UTF-16 property name to a JavaScript
+       property name accumulator.
+       
+       @discussion Unlike a JSString, which also keeps a UTF-8 copy of
+       its characters, these create only the JSStringRef the
+       accumulator retains, and release it right away, so they are the
+       cheapest way to enumerate the keys of a large native
+       collection.
+       */
+      void AddName(const char* property_name, std::size_t length) const {
+        const auto property_name_ref = detail::CreateJSStringRefWithUTF8(property_name, length);
+        JSPropertyNameAccumulatorAddName(js_property_name_accumulator_ref__, property_name_ref);
+        JSStringRelease(property_name_ref);
+      }
+      
+      void AddName(const char16_t* property_name, std::size_t length) const {
+        const auto property_name_ref = detail::CreateJSStringWithCharacters(reinterpret_cast<const JSChar*>(property_name), length);
+        JSPropertyNameAccumulatorAddName(js_property_name_accumulator_ref__, property_name_ref);
+        JSStringRelease(property_name_ref);
+      }
+      
+      void AddName(const char* property_name) const {
+        AddName(property_name, std::strlen(property_name));
+      }
+      
+      void AddName(const std::string& property_name) const {
+        AddName(property_name.data(), property_name.size());
+      }
+      
+      void AddName(const std::u16string& property_name) const {
+        AddName(property_name.data(), property_name.size());
+      }
+      
+      /*!
+       @method
+       
+       @abstract Adds each property name of a range, such as the keys
+       of a native collection, to a JavaScript property name
+       accumulator.
+       
+       @discussion The names may be of any type AddName takes, such as
+       std::string, const char*, JSString or JSStringRef.
+       */
+      template<typename InputIterator>
+      void AddNames(InputIterator first, InputIterator last) const {
+        for (; first != last; ++first) {
+          AddName(*first);
+        }
+      }
+      
+      template<typename Range>
+      void AddNames(const Range& property_names) const {
+        AddNames(std::begin(property_names), std::end(property_names));
+      }
+      
     private:
       
       // Only a JSObject and a JSExportClass can create a
@@ -0,0 +1,133 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSPROPERTYPROFILE_HPP_
+#define _HAL_DETAIL_JSPROPERTYPROFILE_HPP_
+
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+#include "HAL/detail/JSBase.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_PROPERTY_PROFILE_ENABLE=1 to count the calls of every
+  // JSExport value and function property.
+
+  enum class JSPropertyProfileKind : std::uint8_t {
+    Get,
+    Set,
+    Call
+  };
+
+  /*!
+   @struct
+
+   @discussion The calls of one named property of a JSExport class
+   and the time they took, as returned by
+   JSExport<T>::GetPropertyProfile.
+   */
+  struct JSPropertyProfileEntry {
+    std::string           name;
+    JSPropertyProfileKind kind;
+    std::uint64_t         count;
+    std::uint64_t         total_nanoseconds;
+  };
+
+  /*!
+   @struct
+
+   @discussion The counters of one JSExportNamedValuePropertyCallback
+   or JSExportNamedFunctionPropertyCallback, shared by its copies, so
+   that the class definition and the builder it came from count
+   together. Value properties count Get and Set, and function
+   properties count Call, with relaxed atomics.
+   */
+  struct JSPropertyProfile {
+    std::atomic<std::uint64_t> count[3];
+    std::atomic<std::uint64_t> total_nanoseconds[3];
+
+    JSPropertyProfile() HAL_NOEXCEPT {
+      Reset();
+    }
+
+    JSPropertyProfile(const JSPropertyProfile&)            = delete;
+    JSPropertyProfile& operator=(const JSPropertyProfile&) = delete;
+
+    void Record(JSPropertyProfileKind kind, std::uint64_t nanoseconds) HAL_NOEXCEPT {
+      const auto index = static_cast<std::size_t>(kind);
+      count[index].fetch_add(1, std::memory_order_relaxed);
+      total_nanoseconds[index].fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    void Reset() HAL_NOEXCEPT {
+      for (std::size_t i = 0; i < 3; ++i) {
+        count[i].store(0, std::memory_order_relaxed);
+        total_nanoseconds[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    // Append an entry for each kind that was called.
+    void AppendTo(const std::string& name, std::vector<JSPropertyProfileEntry>& entries) const {
+      for (std::size_t i = 0; i < 3; ++i) {
+        const auto call_count = count[i].load(std::memory_order_relaxed);
+        if (call_count > 0) {
+          entries.push_back({ name, static_cast<JSPropertyProfileKind>(i), call_count, total_nanoseconds[i].load(std::memory_order_relaxed) });
+        }
+      }
+    }
+  };
+
+  // Sort profile entries by their total time, the most first.
+  inline
+  void SortPropertyProfile(std::vector<JSPropertyProfileEntry>& entries) {
+    std::sort(entries.begin(), entries.end(), [](const JSPropertyProfileEntry& lhs, const JSPropertyProfileEntry& rhs) {
+      return lhs.total_nanoseconds > rhs.total_nanoseconds;
+    });
+  }
+
+  // Records the lifetime of the timer as a call of a property.
+  class JSPropertyProfileTimer final {
+
+  public:
+
+    JSPropertyProfileTimer(JSPropertyProfile& profile, JSPropertyProfileKind kind) HAL_NOEXCEPT
+    : profile__(profile)
+    , kind__(kind)
+    , start__(std::chrono::steady_clock::now()) {
+    }
+
+    ~JSPropertyProfileTimer() HAL_NOEXCEPT {
+      const auto elapsed = std::chrono::steady_clock::now() - start__;
+      profile__.Record(kind__, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    JSPropertyProfileTimer(const JSPropertyProfileTimer&)            = delete;
+    JSPropertyProfileTimer& operator=(const JSPropertyProfileTimer&) = delete;
+
+  private:
+
+    JSPropertyProfile&                    profile__;
+    JSPropertyProfileKind                 kind__;
+    std::chrono::steady_clock::time_point start__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#define HAL_PROPERTY_PROFILE_TIMER(callback, kind) detail::JSPropertyProfileTimer hal_property_profile_timer((callback).get_profile(), detail::JSPropertyProfileKind::kind)
+#else
+#define HAL_PROPERTY_PROFILE_TIMER(callback, kind)
+#endif // HAL_PROPERTY_PROFILE_ENABLE
+
+#endif // _HAL_DETAIL_JSPROPERTYPROFILE_HPP_
@@ -0,0 +1,141 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSQUOTASTATE_HPP_
+#define _HAL_DETAIL_JSQUOTASTATE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSContextGroup.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion The usage and quotas of one JSContextGroupRef, part of
+   the JSContextGroupState that every JSContextGroup wrapping it
+   shares. Every JSContext's ControlBlock and every JSRunLoop holds the
+   state of its group, so usage is counted from the group's creation,
+   and a state is never inherited by a later group at the same
+   address.
+
+   Usage is kept in atomics, since a task may be posted from any
+   thread, and the limits are read with relaxed loads on every change.
+   */
+  class HAL_EXPORT JSQuotaState final {
+
+  public:
+
+    static const std::size_t kResourceCount = 4;
+
+    explicit JSQuotaState(JSContextGroupRef js_context_group_ref) HAL_NOEXCEPT;
+
+    JSQuotaState(const JSQuotaState&)            = delete;
+    JSQuotaState& operator=(const JSQuotaState&) = delete;
+
+    void SetQuotas(const JSContextGroupQuotas& quotas);
+    void ClearQuotas() HAL_NOEXCEPT;
+    void ResetCPUTime() HAL_NOEXCEPT;
+
+    bool has_quotas() const HAL_NOEXCEPT {
+      return has_quotas__.load(std::memory_order_relaxed);
+    }
+
+    JSContextGroupQuotaUsage GetUsage() const HAL_NOEXCEPT;
+
+    void AdjustExternalMemory(std::ptrdiff_t byte_delta) HAL_NOEXCEPT;
+
+    // Throws std::runtime_error, and queues nothing, when queued tasks
+    // are past their hard limit.
+    void AddQueuedTask();
+    void RemoveQueuedTasks(std::size_t count) HAL_NOEXCEPT;
+
+    // Check every resource, as a running script of the group is checked
+    // by the execution time limit. Return whether one is past its hard
+    // limit.
+    bool CheckRunning() HAL_NOEXCEPT;
+
+  private:
+
+    friend class JSQuotaScope;
+
+    // Update the soft and hard limit state of a resource. Return
+    // whether it is past its hard limit.
+    bool Update(JSQuotaResource resource, double usage) HAL_NOEXCEPT;
+
+    bool IsPastHardLimit() const HAL_NOEXCEPT;
+    double GetCPUTimeSeconds() const HAL_NOEXCEPT;
+    void CheckProtectedHandles(bool force) HAL_NOEXCEPT;
+
+    const JSContextGroupRef js_context_group_ref__;
+
+    std::atomic<bool>          has_quotas__ { false };
+    std::atomic<double>        soft_limits__[kResourceCount];
+    std::atomic<double>        hard_limits__[kResourceCount];
+    std::atomic<bool>          past_soft_limit__[kResourceCount];
+    std::atomic<bool>          past_hard_limit__[kResourceCount];
+    std::atomic<std::uint64_t> handle_check_interval_nanoseconds__ { 0 };
+
+    std::atomic<std::uint64_t> cpu_nanoseconds__           { 0 };
+    std::atomic<std::int64_t>  external_memory_bytes__     { 0 };
+    std::atomic<std::int64_t>  queued_tasks__              { 0 };
+    std::atomic<std::uint64_t> soft_limit_exceeded_count__ { 0 };
+    std::atomic<std::uint64_t> hard_limit_exceeded_count__ { 0 };
+    std::atomic<std::uint64_t> terminated_count__          { 0 };
+
+    // Nanoseconds since the epoch of steady_clock.
+    std::atomic<std::int64_t>  last_handle_check__ { 0 };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSMutex                                mutex__ HAL_LOCK_CLASS_NAME(JSQuotaState, "JSQuotaState");
+    std::shared_ptr<const JSQuotaCallback> soft_limit_callback__;
+#pragma warning(pop)
+  };
+
+  /*!
+   @class
+
+   @discussion A JSQuotaScope surrounds each script and function call
+   that native code makes. It refuses the call while the group is past
+   a hard limit, and the outermost one on a thread adds the time the
+   call took to the group's CPU time.
+   */
+  class HAL_EXPORT JSQuotaScope final {
+
+  public:
+
+    // Throws std::runtime_error if the group of js_quota_state is past
+    // a hard limit.
+    explicit JSQuotaScope(JSQuotaState& js_quota_state);
+    ~JSQuotaScope() HAL_NOEXCEPT;
+
+    JSQuotaScope(const JSQuotaScope&)            = delete;
+    JSQuotaScope& operator=(const JSQuotaScope&) = delete;
+
+    // Return the time the outermost call of this thread has run for, if
+    // it was made for js_quota_state.
+    static std::chrono::steady_clock::duration GetRunningTime(const JSQuotaState& js_quota_state) HAL_NOEXCEPT;
+
+  private:
+
+    JSQuotaState*                         js_quota_state__ { nullptr };
+    std::chrono::steady_clock::time_point start__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSQUOTASTATE_HPP_
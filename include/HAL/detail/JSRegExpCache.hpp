@@ -0,0 +1,142 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSREGEXPCACHE_HPP_
+#define _HAL_DETAIL_JSREGEXPCACHE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/JSString.hpp"
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSRegExpCache holds the most recently created RegExp
+   objects of a JSContext, keyed by their pattern and flags, so that
+   JSContext::CreateRegExp can return an existing RegExp instead of
+   compiling its pattern again.
+
+   Each JSContext owns one cache, shared by all of its copies. Like
+   JSFunctionCache it holds JSObjectRefs protected with JSValueProtect,
+   so that it doesn't keep the JSContext that owns it alive.
+   */
+  class HAL_EXPORT JSRegExpCache final {
+
+  public:
+
+    static const std::size_t kDefaultCapacity = 64;
+
+    struct Key {
+      JSString pattern;
+      JSString flags;
+
+      bool operator==(const Key& rhs) const;
+    };
+
+    explicit JSRegExpCache(JSContextRef js_context_ref) HAL_NOEXCEPT;
+    ~JSRegExpCache() HAL_NOEXCEPT;
+    JSRegExpCache(const JSRegExpCache&)            = delete;
+    JSRegExpCache(JSRegExpCache&&)                 = delete;
+    JSRegExpCache& operator=(const JSRegExpCache&) = delete;
+    JSRegExpCache& operator=(JSRegExpCache&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Return the cached RegExp for key, or nullptr if there
+     is none. A returned RegExp becomes the most recently used.
+     */
+    JSObjectRef Find(const Key& key);
+
+    /*!
+     @method
+
+     @abstract Cache a RegExp, evicting the least recently used one if
+     the cache is full. Does nothing if the capacity is zero.
+     */
+    void Insert(Key key, JSObjectRef js_object_ref);
+
+    /*!
+     @method
+
+     @abstract Remove all cached RegExps.
+     */
+    void Clear() HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Remove fraction of the cached RegExps, least recently
+     used first, and return the approximate bytes their keys used.
+     */
+    std::size_t Evict(double fraction) HAL_NOEXCEPT;
+
+    /*!
+     @method
+
+     @abstract Set the maximum number of cached RegExps, evicting the
+     least recently used ones if there are more.
+     */
+    void set_capacity(std::size_t capacity) HAL_NOEXCEPT;
+
+    std::size_t get_capacity() const HAL_NOEXCEPT;
+    std::size_t size() const HAL_NOEXCEPT;
+
+#ifdef HAL_THREAD_SAFE
+    // Held by the JSContext from Find until it has protected the
+    // RegExp found, so that JSMemoryPressure::Respond, which may evict
+    // from another thread, can't unprotect it meanwhile.
+    JSRecursiveMutex& get_mutex() const HAL_NOEXCEPT {
+      return mutex__;
+    }
+#endif
+
+  private:
+
+    struct KeyHash {
+      std::size_t operator()(const Key& key) const;
+    };
+
+    // The most recently used entry is at the front.
+    typedef std::list<std::pair<Key, JSObjectRef>> EntryList;
+
+    void EvictTo(std::size_t size) HAL_NOEXCEPT;
+
+    // The approximate bytes key and its entry use outside the
+    // JavaScript heap.
+    static std::size_t GetSize(const Key& key) HAL_NOEXCEPT;
+
+    JSContextRef js_context_ref__;
+    std::size_t  capacity__ { kDefaultCapacity };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    EntryList                                             entries__;
+    std::unordered_map<Key, EntryList::iterator, KeyHash> index__;
+#pragma warning(pop)
+
+#undef HAL_JSREGEXPCACHE_LOCK_GUARD
+#ifdef HAL_THREAD_SAFE
+    mutable JSRecursiveMutex mutex__ HAL_LOCK_CLASS_NAME(JSRegExpCache, "JSRegExpCache");
+#define HAL_JSREGEXPCACHE_LOCK_GUARD std::lock_guard<JSRecursiveMutex> lock(mutex__)
+#else
+#define HAL_JSREGEXPCACHE_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSREGEXPCACHE_HPP_
@@ -0,0 +1,243 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSRETAINEDHANDLES_HPP_
+#define _HAL_DETAIL_JSRETAINEDHANDLES_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace HAL { namespace detail {
+  
+  /*!
+   @struct
+   
+   @discussion A JSRetainedHandles is a snapshot of every JSValueRef
+   and JSObjectRef HAL currently keeps protected, for tracking down
+   handles that are still alive but no longer used.
+   
+   Counts are of distinct JSValueRefs and JSObjectRefs, not of the
+   JSValue and JSObject copies referring to them.
+   
+   Defining HAL_TRACK_RETAINED_HANDLES additionally records the JSExport
+   class of every native object and the call site that first retained
+   each JSValueRef. Without it by_class only distinguishes plain
+   objects from objects with private data, and by_site is empty.
+   */
+  struct HAL_EXPORT JSRetainedHandles {
+    
+    struct Counts {
+      std::size_t values  { 0 };
+      std::size_t objects { 0 };
+    };
+    
+    // Silence 4251 on Windows since member variables of a diagnostic
+    // struct don't need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    
+    // Retained JSValueRefs and JSObjectRefs by their JSContextRef.
+    std::map<JSContextRef, Counts> by_context;
+    
+    // Retained JSValueRefs by JSValue::Type.
+    std::map<std::string, std::size_t> by_value_type;
+    
+    // Retained JSObjectRefs by the JSExport class of their private
+    // data.
+    std::map<std::string, std::size_t> by_class;
+    
+    // Retained JSValueRefs by the call site that first retained them.
+    std::map<std::string, std::size_t> by_site;
+    
+#pragma warning(pop)
+  };
+  
+  /*!
+   @function
+   
+   @abstract Walk the JSValue and JSObject registries and return the
+   handles they keep protected.
+   
+   @discussion The registries are locked while they are walked, so
+   this must not be called from inside a JavaScriptCore callback that
+   could run concurrently on another thread when HAL_THREAD_SAFE is
+   not defined.
+   */
+  HAL_EXPORT JSRetainedHandles GetRetainedHandles();
+  
+  /*!
+   @function
+   
+   @abstract Return a human readable report of GetRetainedHandles.
+   */
+  HAL_EXPORT std::string DumpRetainedHandles();
+  
+  /*!
+   @struct
+   
+   @discussion A JSRetainedHandle is one JSValueRef or JSObjectRef HAL
+   keeps protected, as listed by GetRetainedHandleList.
+   
+   With HAL_TRACK_RETAINED_HANDLES site is the call site that first
+   retained it, and backtrace the stack that did so if
+   SetRetainBacktraces was enabled at the time. Otherwise both are
+   empty.
+   */
+  struct HAL_EXPORT JSRetainedHandle {
+    JSContextRef js_context_ref { nullptr };
+    JSValueRef   js_value_ref   { nullptr };
+    
+    // true for the JSObjectRef of a JSObject, false for the JSValueRef
+    // of a JSValue.
+    bool         is_object      { false };
+    
+    // The number of JSValue or JSObject copies referring to it.
+    std::size_t  count          { 0 };
+    
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::string  site;
+    std::string  backtrace;
+#pragma warning(pop)
+  };
+  
+  /*!
+   @function
+   
+   @abstract Walk the JSValue and JSObject registries and return
+   every handle they keep protected, under the same locking rules as
+   GetRetainedHandles.
+   */
+  HAL_EXPORT std::vector<JSRetainedHandle> GetRetainedHandleList();
+  
+  /*!
+   @function
+   
+   @abstract Return the number of unprotects of a JSValueRef or
+   JSObjectRef that HAL didn't hold, which are always bugs. They are
+   only counted when HAL_TRACK_RETAINED_HANDLES is defined, and are
+   also logged as errors.
+   */
+  HAL_EXPORT std::size_t GetRetainImbalanceCount() HAL_NOEXCEPT;
+  
+  /*!
+   @class
+   
+   @discussion A JSRetainLeakChecker remembers the handles protected
+   when it is created, or last reset, and reports the ones protected
+   since that are still protected, e.g. at the end of a unit test
+   once everything it created is out of scope.
+   
+   Handles a process caches for its whole life show up as leaks of
+   the first check that creates them. Build with
+   HAL_TRACK_RETAINED_HANDLES to see where leaked handles came from.
+   */
+  class HAL_EXPORT JSRetainLeakChecker final {
+    
+  public:
+    
+    JSRetainLeakChecker();
+    
+    /*!
+     @method
+     
+     @abstract Forget the remembered handles and remember the ones
+     protected now.
+     */
+    void Reset();
+    
+    /*!
+     @method
+     
+     @abstract Return the handles protected now that weren't when this
+     checker was created or last reset.
+     */
+    std::vector<JSRetainedHandle> GetLeaks() const;
+    
+    /*!
+     @method
+     
+     @abstract Return a human readable report of GetLeaks, or an empty
+     string if there are none.
+     */
+    std::string DumpLeaks() const;
+    
+  private:
+    
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::set<std::pair<bool, JSValueRef>> baseline__;
+#pragma warning(pop)
+  };
+  
+#ifdef HAL_TRACK_RETAINED_HANDLES
+  
+  /*!
+   @class
+   
+   @discussion A JSRetainSite is a stack-only RAII object naming the
+   call site for JSValueRefs first retained on this thread while it is
+   alive. JSExportClass opens one around every exported function
+   callback.
+   */
+  class HAL_EXPORT JSRetainSite final {
+    
+  public:
+    
+    explicit JSRetainSite(const std::string& site);
+    ~JSRetainSite() HAL_NOEXCEPT;
+    
+    JSRetainSite(const JSRetainSite&)            = delete;
+    JSRetainSite(JSRetainSite&&)                 = delete;
+    JSRetainSite& operator=(const JSRetainSite&) = delete;
+    JSRetainSite& operator=(JSRetainSite&&)      = delete;
+    
+    // Return the innermost site on this thread, or an empty string.
+    static const std::string& current() HAL_NOEXCEPT;
+    
+  private:
+    
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    const JSRetainSite* previous__;
+    std::string         site__;
+#pragma warning(pop)
+  };
+  
+  /*!
+   @function
+   
+   @abstract Set whether the registries capture the stack of every
+   JSValueRef and JSObjectRef they protect. The default is false,
+   since capturing a stack is slow.
+   */
+  HAL_EXPORT void SetRetainBacktraces(bool enabled) HAL_NOEXCEPT;
+  
+  // Return the calling stack, one frame per line, or an empty string
+  // if backtraces are disabled or unsupported on this platform.
+  HAL_EXPORT std::string CaptureRetainBacktrace();
+  
+  // Log and count an unprotect of a handle HAL didn't hold.
+  HAL_EXPORT void ReportRetainImbalance(const char* function_name, const void* js_value_ref) HAL_NOEXCEPT;
+  
+  // Record the JSExport class of a native object created by
+  // CreateNativeObject.
+  HAL_EXPORT void RegisterNativeObject(const void* native_object_ptr, const char* class_name);
+  HAL_EXPORT void UnRegisterNativeObject(const void* native_object_ptr);
+  
+#endif  // HAL_TRACK_RETAINED_HANDLES
+  
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSRETAINEDHANDLES_HPP_
@@ -0,0 +1,152 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSSERIALIZEDVALUE_HPP_
+#define _HAL_DETAIL_JSSERIALIZEDVALUE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSValueCloner.hpp"
+#include "HAL/JSString.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSSerializedValue is a copy of a JavaScript value that
+   belongs to no JSContext, so that it can be handed to another thread
+   and recreated there in a context of any JSContextGroup. It is the
+   implementation of JSMessagePort.
+
+   Like JSContext::Clone, the object graph is walked by a
+   JSValueCloner, so shared and cyclic references are preserved, and
+   arrays, Dates, ArrayBuffers and typed arrays keep their types.
+   Strings are kept as JSStrings, which aren't tied to a context
+   group, so they are shared rather than copied.
+
+   The bytes of an ArrayBuffer are copied, unless the ArrayBuffer is
+   in the transfer list. Then the recreated ArrayBuffer uses its bytes,
+   and keeps it alive until the recreated one is collected, after
+   which it is released on the JSRunLoop of its own context.
+
+   WriteTo and the constructor taking bytes store it in a compact
+   binary form, for JSContext::SaveState. The form uses the byte order
+   of the machine that wrote it, and is only meant to be read back by
+   the same build.
+   */
+  class JSSerializedValue final {
+
+  public:
+
+    /*!
+     @method
+
+     @abstract Serialize a value of a context.
+
+     @throws std::invalid_argument if transfer contains an object that
+     isn't an ArrayBuffer.
+
+     @throws std::runtime_error if the value is or contains a function,
+     if transfer isn't empty and the context has no JSRunLoop, or if
+     JavaScriptCore reports an exception.
+     */
+    JSSerializedValue(JSContextRef context_ref, JSValueRef js_value_ref, const std::vector<JSObjectRef>& transfer);
+
+    /*!
+     @method
+
+     @abstract Read a value stored by WriteTo. The bytes are copied, so
+     they needn't outlive the JSSerializedValue.
+
+     @throws std::runtime_error if the bytes are truncated, weren't
+     written by WriteTo, or refer to strings, objects or buffers they
+     don't contain.
+     */
+    JSSerializedValue(const char* data, std::size_t size);
+
+    /*!
+     @method
+
+     @abstract Append the binary form of the value to bytes.
+     */
+    void WriteTo(std::string& bytes) const;
+
+    /*!
+     @method
+
+     @abstract Recreate the value in a context, which may be called
+     more than once and on any thread.
+
+     @throws std::runtime_error if JavaScriptCore reports an exception.
+     */
+    JSValueRef Deserialize(JSContextRef context_ref) const;
+
+  private:
+
+    class Writer;
+    class Reader;
+
+    using Type = JSValueCloner::ValueType;
+
+    // number holds a boolean or a number, and index a string or an
+    // object.
+    struct Value {
+      Type        type;
+      double      number;
+      std::size_t index;
+    };
+
+    using ObjectType = JSValueCloner::ObjectType;
+
+    struct Object {
+      ObjectType    type;
+      double        time;
+      std::size_t   first_property;
+      std::size_t   property_count;
+
+      // The buffer of an ArrayBuffer, or the object of the ArrayBuffer
+      // of a typed array.
+      std::size_t   buffer;
+      std::size_t   byte_offset;
+      std::size_t   length;
+      std::uint32_t typed_array_type;
+    };
+
+    // name is a string for an object, and the index of an element for
+    // an array.
+    struct Property {
+      std::size_t name;
+      Value       value;
+    };
+
+    // owner holds either a copy of the bytes or the transferred
+    // ArrayBuffer they belong to.
+    struct Buffer {
+      std::shared_ptr<void> owner;
+      void*                 bytes;
+      std::size_t           byte_length;
+    };
+
+    JSValueRef ToJSValueRef(JSContextRef context_ref, const Value& value, const std::vector<JSObjectRef>& object_refs) const;
+
+    Value                 root__;
+    std::vector<Object>   objects__;
+    std::vector<Property> properties__;
+    std::vector<JSString> strings__;
+    std::vector<Buffer>   buffers__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSSERIALIZEDVALUE_HPP_
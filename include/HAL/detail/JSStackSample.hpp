@@ -0,0 +1,34 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSSTACKSAMPLE_HPP_
+#define _HAL_DETAIL_JSSTACKSAMPLE_HPP_
+
+#ifdef HAL_STACK_PROFILE_ENABLE
+#include "HAL/JSStackProfiler.hpp"
+
+#include <JavaScriptCore/JavaScript.h>
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_STACK_PROFILE_ENABLE=1 to sample the JavaScript stacks
+  // of JSStackProfiler.
+
+  // Count a call into native code on the calling thread, and sample
+  // the JavaScript stack of context_ref if it is the Nth. The leaf of
+  // the stack is "native_name:callback_name".
+  HAL_EXPORT void CountJSStackSample(JSContextRef context_ref, const char* native_name, const char* callback_name) HAL_NOEXCEPT;
+
+}} // namespace HAL { namespace detail {
+
+#define HAL_STACK_SAMPLE(context_ref, native_name, callback_name) do { if (JSStackProfiler::IsEnabled()) { detail::CountJSStackSample(context_ref, native_name, callback_name); } } while (false)
+#else
+#define HAL_STACK_SAMPLE(context_ref, native_name, callback_name)
+#endif // HAL_STACK_PROFILE_ENABLE
+
+#endif // _HAL_DETAIL_JSSTACKSAMPLE_HPP_
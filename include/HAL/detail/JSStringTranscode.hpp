@@ -0,0 +1,130 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSSTRINGTRANSCODE_HPP_
+#define _HAL_DETAIL_JSSTRINGTRANSCODE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @function
+
+   @abstract Copy the leading ASCII code units of a UTF-16 string to
+   a UTF-8 buffer, using SSE2 or NEON where available.
+
+   @param output A buffer of at least length bytes.
+
+   @result The number of code units copied. Copying stops at the first
+   non-ASCII code unit.
+   */
+  HAL_EXPORT std::size_t NarrowASCII(const JSChar* input, std::size_t length, char* output) HAL_NOEXCEPT;
+
+  /*!
+   @function
+
+   @abstract Copy the leading ASCII bytes of a UTF-8 string to a
+   UTF-16 buffer, using SSE2 or NEON where available.
+
+   @param output A buffer of at least length code units.
+
+   @result The number of bytes copied. Copying stops at the first
+   non-ASCII byte.
+   */
+  HAL_EXPORT std::size_t WidenASCII(const char* input, std::size_t length, JSChar* output) HAL_NOEXCEPT;
+
+  /*!
+   @function
+
+   @abstract Return the number of leading ASCII bytes of a UTF-8 or
+   Latin-1 string, using SSE2 or NEON where available.
+   */
+  HAL_EXPORT std::size_t CountASCII(const char* input, std::size_t length) HAL_NOEXCEPT;
+
+  /*!
+   @function
+
+   @abstract Convert Latin-1 to UTF-16, using SSE2 or NEON where
+   available.
+
+   @param output A buffer of at least length code units.
+   */
+  HAL_EXPORT void WidenLatin1(const char* input, std::size_t length, JSChar* output) HAL_NOEXCEPT;
+
+  /*!
+   @function
+
+   @abstract Convert UTF-16 to UTF-8. Runs of ASCII go through
+   NarrowASCII and only the remaining code units are encoded one at a
+   time. Unpaired surrogates are replaced with U+FFFD.
+
+   @param output A buffer of at least 3 * length bytes.
+
+   @result The number of bytes written. No null terminator is written.
+   */
+  HAL_EXPORT std::size_t TranscodeUTF16ToUTF8(const JSChar* input, std::size_t length, char* output) HAL_NOEXCEPT;
+
+  /*!
+   @function
+
+   @abstract Convert UTF-8 to UTF-16. Runs of ASCII go through
+   WidenASCII and only the remaining bytes are decoded one character
+   at a time. Malformed sequences are replaced with U+FFFD.
+
+   @param output A buffer of at least length code units.
+
+   @result The number of code units written.
+   */
+  HAL_EXPORT std::size_t TranscodeUTF8ToUTF16(const char* input, std::size_t length, JSChar* output) HAL_NOEXCEPT;
+
+  /*!
+   @function
+
+   @abstract Return the UTF-8 form of a JSStringRef.
+   */
+  HAL_EXPORT std::string ToUTF8String(JSStringRef js_string_ref);
+
+  /*!
+   @function
+
+   @abstract Append the UTF-8 form of a JSStringRef to buffer, reusing
+   its capacity.
+   */
+  HAL_EXPORT void AppendUTF8String(JSStringRef js_string_ref, std::string& buffer);
+
+  /*!
+   @function
+
+   @abstract Create a JSStringRef from UTF-8. Pure ASCII input goes
+   to JSStringCreateWithUTF8CString, which keeps it in 8-bit
+   characters, while JSStringCreateWithCharacters would store it in
+   16-bit ones. Anything else is decoded with TranscodeUTF8ToUTF16,
+   which JavaScriptCore stores in 16-bit characters either way.
+
+   @param string The UTF-8 string, which needn't be null-terminated.
+
+   @result A JSStringRef the caller must release.
+   */
+  HAL_EXPORT JSStringRef CreateJSStringRefWithUTF8(const char* string, std::size_t length);
+
+  /*!
+   @function
+
+   @abstract Return the 64-bit FNV-1a hash of UTF-16 code units.
+   JSString::hash_value is this hash, truncated to std::size_t.
+   */
+  HAL_EXPORT std::uint64_t HashUTF16(const JSChar* characters, std::size_t length) HAL_NOEXCEPT;
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSSTRINGTRANSCODE_HPP_
@@ -0,0 +1,90 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSTASKLANE_HPP_
+#define _HAL_DETAIL_JSTASKLANE_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSLatencyHistogram.hpp"
+#include "HAL/JSTaskPriority.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion The bound and the counters of one priority lane of a
+   JSRunLoop or JSWorkerPool. The queue holding the lane's tasks is the
+   owner's; a JSTaskLane only decides whether a task may join it, and
+   counts what happens to the tasks that do.
+
+   Everything is kept in atomics, since tasks are queued from any
+   thread and the options may change while they are.
+   */
+  class HAL_EXPORT JSTaskLane final {
+
+  public:
+
+    enum class Admission : std::uint8_t {
+      // The task is counted as queued and must be queued.
+      Accept,
+      // The task is counted as rejected and must not be queued.
+      Reject,
+      // The lane is full and its policy is Block. Wait for
+      // has_capacity and admit the task again.
+      Full
+    };
+
+    JSTaskLane() HAL_NOEXCEPT;
+
+    JSTaskLane(const JSTaskLane&)            = delete;
+    JSTaskLane& operator=(const JSTaskLane&) = delete;
+
+    JSTaskQueueOptions get_options() const HAL_NOEXCEPT;
+    void set_options(const JSTaskQueueOptions& options) HAL_NOEXCEPT;
+
+    // Decide whether a task may be queued. A caller that may_not_block
+    // is rejected rather than told to wait. Under DropOldest every task
+    // is accepted, and the owner discards the oldest while
+    // is_overflowing.
+    Admission Admit(bool may_block) HAL_NOEXCEPT;
+
+    bool has_capacity() const HAL_NOEXCEPT;
+    bool is_overflowing() const HAL_NOEXCEPT;
+
+    std::size_t get_queued_count() const HAL_NOEXCEPT {
+      return queued_count__.load();
+    }
+
+    // A queued task was discarded without running.
+    void Drop() HAL_NOEXCEPT;
+
+    // A queued task is about to run after waiting for queueing_delay.
+    void Complete(std::chrono::steady_clock::duration queueing_delay) HAL_NOEXCEPT;
+
+    JSTaskLaneStatistics GetStatistics() const HAL_NOEXCEPT;
+
+  private:
+
+    std::atomic<std::size_t>   capacity__      { 0 };
+    std::atomic<std::uint8_t>  policy__        { 0 };
+    std::atomic<std::size_t>   queued_count__  { 0 };
+    std::atomic<std::uint64_t> enqueued_count__ { 0 };
+    std::atomic<std::uint64_t> rejected_count__ { 0 };
+    std::atomic<std::uint64_t> dropped_count__  { 0 };
+    JSLatencyHistogram         queueing_delay__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSTASKLANE_HPP_
@@ -0,0 +1,124 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSTIMERWHEEL_HPP_
+#define _HAL_DETAIL_JSTIMERWHEEL_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSTimerWheel is a hierarchical timing wheel of timer
+   ids, measured in ticks of a caller-defined length.
+
+   Each of its kLevelCount levels has kSlotCount slots, and a slot of
+   level n spans kSlotCount^n ticks. A timer goes into the lowest
+   level whose span covers its expiry, so scheduling and cancelling
+   are O(1). When the wheel advances past the start of a slot in a
+   higher level, that slot's timers are cascaded into the levels
+   below. Timers further out than the top level are parked in it and
+   cascaded again until they fit.
+
+   GetNextEventTick returns the next tick at which a timer may expire
+   or a slot must be cascaded, so a caller sleeping until then wakes
+   at most once per tick, and only a few times for a far timer.
+   */
+  class HAL_EXPORT JSTimerWheel final {
+
+  public:
+
+    static const std::size_t kLevelCount = 4;
+    static const std::size_t kSlotBits   = 6;
+    static const std::size_t kSlotCount  = 1 << kSlotBits;
+
+    JSTimerWheel() = default;
+
+    JSTimerWheel(const JSTimerWheel&)            = delete;
+    JSTimerWheel& operator=(const JSTimerWheel&) = delete;
+
+    /*!
+     @method
+
+     @abstract Schedule a timer to expire at expiry_tick, or at the
+     next tick if expiry_tick has already passed. The id must not be
+     scheduled already.
+     */
+    void Schedule(std::uint64_t id, std::uint64_t expiry_tick);
+
+    /*!
+     @method
+
+     @abstract Cancel a timer.
+
+     @result false if no timer with this id is scheduled.
+     */
+    bool Cancel(std::uint64_t id);
+
+    /*!
+     @method
+
+     @abstract Advance the wheel to tick, appending the ids of every
+     timer that expired on the way to expired_ids in expiry order.
+     */
+    void Advance(std::uint64_t tick, std::vector<std::uint64_t>& expired_ids);
+
+    /*!
+     @method
+
+     @abstract Return the tick Advance must reach before any timer can
+     expire, or zero if no timer is scheduled.
+     */
+    std::uint64_t GetNextEventTick() const HAL_NOEXCEPT;
+
+    std::uint64_t get_current_tick() const HAL_NOEXCEPT {
+      return current_tick__;
+    }
+
+    std::size_t size() const HAL_NOEXCEPT {
+      return positions__.size();
+    }
+
+  private:
+
+    struct Timer {
+      std::uint64_t id;
+      std::uint64_t expiry_tick;
+    };
+
+    typedef std::list<Timer> Slot;
+
+    struct Position {
+      Slot*          slot;
+      Slot::iterator iterator;
+    };
+
+    // Put a timer with expiry_tick >= current_tick__ into its slot.
+    void Place(const Timer& timer);
+
+    void Cascade(std::size_t level);
+
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    std::array<std::array<Slot, kSlotCount>, kLevelCount> levels__;
+    std::unordered_map<std::uint64_t, Position>            positions__;
+    std::uint64_t                                          current_tick__ { 0 };
+#pragma warning(pop)
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSTIMERWHEEL_HPP_
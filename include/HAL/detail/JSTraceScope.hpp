@@ -0,0 +1,77 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSTRACESCOPE_HPP_
+#define _HAL_DETAIL_JSTRACESCOPE_HPP_
+
+#ifdef HAL_TRACE_ENABLE
+#include "HAL/JSTrace.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+  // Add -DHAL_TRACE_ENABLE=1 to record the events of JSTrace.
+
+  // The strings must outlive the trace, so they are string literals or
+  // the names of JSExport classes.
+  struct JSTraceEvent {
+    const char*   category;
+    const char*   name;
+    const char*   argument;
+    std::uint64_t begin_nanoseconds;
+    std::uint64_t duration_nanoseconds;
+  };
+
+  // Append an event to the buffer of the calling thread.
+  HAL_EXPORT void AppendTraceEvent(const JSTraceEvent& event) HAL_NOEXCEPT;
+
+  inline
+  std::uint64_t GetTraceNanoseconds() HAL_NOEXCEPT {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  // Records the lifetime of the scope as an event, if JSTrace was
+  // started when it began.
+  class JSTraceScope final {
+
+  public:
+
+    JSTraceScope(const char* category, const char* name, const char* argument = nullptr) HAL_NOEXCEPT
+    : category__(category)
+    , name__(name)
+    , argument__(argument)
+    , begin_nanoseconds__(JSTrace::IsEnabled() ? GetTraceNanoseconds() : 0) {
+    }
+
+    ~JSTraceScope() HAL_NOEXCEPT {
+      if (begin_nanoseconds__ != 0) {
+        AppendTraceEvent({ category__, name__, argument__, begin_nanoseconds__, GetTraceNanoseconds() - begin_nanoseconds__ });
+      }
+    }
+
+    JSTraceScope(const JSTraceScope&)            = delete;
+    JSTraceScope& operator=(const JSTraceScope&) = delete;
+
+  private:
+
+    const char*   category__;
+    const char*   name__;
+    const char*   argument__;
+    std::uint64_t begin_nanoseconds__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#define HAL_TRACE_SCOPE(category, name, argument) detail::JSTraceScope hal_trace_scope(category, name, argument)
+#else
+#define HAL_TRACE_SCOPE(category, name, argument)
+#endif // HAL_TRACE_ENABLE
+
+#endif // _HAL_DETAIL_JSTRACESCOPE_HPP_
@@ -16,6 +16,7 @@
 
 #include <string>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <unordered_set>
@@ -35,39 +36,65 @@ namespace HAL { namespace detail {
     return std::unique_ptr<T>(new T(std::forward<Ts>(params)...));
   }
 
+  /*!
+   @class
+
+   @discussion A js_runtime_error is the std::runtime_error thrown for
+   a JavaScript Error. It keeps the Error itself and only reads its
+   name, message, filename, line number and stack the first time one
+   of them, or what, is asked for, so that an exception that is caught
+   and dropped costs no more than the throw.
+   */
   class js_runtime_error : public std::runtime_error {
   public:
-    js_runtime_error() HAL_NOEXCEPT = default;
     js_runtime_error(const JSError& js_error);
     virtual ~js_runtime_error() = default;
 
+    virtual const char* what() const HAL_NOEXCEPT override;
+
     std::string js_name() const {
+      Materialize();
       return js_name__;
     }
     std::string js_message() const {
+      Materialize();
       return js_message__;
     }
     std::string js_filename() const {
+      Materialize();
       return js_filename__;
     }
     std::uint32_t js_linenumber() const {
+      Materialize();
       return js_linenumber__;
     }
     std::vector<JSValue> js_stack() const {
+      Materialize();
       return js_stack__;
     }
   private:
-    std::string js_name__;
-    std::string js_message__;
-    std::string js_filename__;
-    std::uint32_t js_linenumber__;
-    std::vector<JSValue> js_stack__;
+    // Read the properties of the Error if they haven't been yet.
+    void Materialize() const HAL_NOEXCEPT;
+
+    JSValue                      js_error__;
+    mutable bool                 materialized__ { false };
+    mutable std::string          js_name__;
+    mutable std::string          js_message__;
+    mutable std::string          js_filename__;
+    mutable std::uint32_t        js_linenumber__ { 0 };
+    mutable std::vector<JSValue> js_stack__;
   };
 
   HAL_EXPORT void    ThrowRuntimeError(const std::string& internal_component_name, const std::string& message);
   HAL_EXPORT void    ThrowRuntimeError(const std::string& internal_component_name, const JSValue&     exception, const std::string& source_url = "", int line_number = 0);
   HAL_EXPORT void ThrowInvalidArgument(const std::string& internal_component_name, const std::string& message  );
   
+  // Every context group and class HAL creates goes through these, so
+  // that JSRuntime knows when JavaScriptCore has read its options.
+  // Creating a string starts it as well, see StartJSRuntime.
+  HAL_EXPORT JSContextGroupRef CreateJSContextGroup();
+  HAL_EXPORT JSClassRef        CreateJSClass(const ::JSClassDefinition* js_class_definition) HAL_NOEXCEPT;
+  
   // For interoperability with the JavaScriptCore C API.
   HAL_EXPORT std::vector<JSValue>     to_vector(const JSContext&, size_t count, const JSValueRef[]);
   HAL_EXPORT std::vector<JSValue>     to_vector(const JSContext&, const std::vector<JSString>&);
@@ -77,6 +104,10 @@ namespace HAL { namespace detail {
   // For interoperability with the JavaScriptCore C API.
   
   // typedef unsigned JSPropertyAttributes
+  inline HAL_CONSTEXPR unsigned ToJSPropertyAttributes(JSPropertyAttributeSet attributes)                         HAL_NOEXCEPT {
+    return attributes.get_bits();
+  }
+  
   HAL_EXPORT unsigned ToJSPropertyAttributes(const std::unordered_set<JSPropertyAttribute>& attributes)          HAL_NOEXCEPT;
   HAL_EXPORT std::unordered_set<JSPropertyAttribute> FromJSPropertyAttributes(::JSPropertyAttributes attributes) HAL_NOEXCEPT;
   HAL_EXPORT std::string to_string(JSPropertyAttribute)                                                          HAL_NOEXCEPT;
@@ -97,7 +128,60 @@ namespace HAL { namespace detail {
   // The operation can be descibed as round towards zero, then select
   // the 32 least bits of the resulting value in 2s-complement
   // representation.
-  HAL_EXPORT int32_t to_int32_t(double number);
+  //
+  // Numbers already in the int32_t range, as indices and counters
+  // are, convert with a plain cast that the compiler can inline and
+  // vectorise. Only the others take the bitwise path.
+  HAL_EXPORT int32_t to_int32_t_out_of_range(double number);
+  
+  inline int32_t to_int32_t(double number) {
+    if (number > -2147483649.0 && number < 2147483648.0) {
+      return static_cast<int32_t>(number);
+    }
+    return to_int32_t_out_of_range(number);
+  }
+  
+  // Round towards zero, mapping NaN to 0 and saturating at the ends of
+  // the int64_t range. JavaScript has no ToInt64, and numbers beyond
+  // 2^53 aren't exact anyway.
+  inline int64_t to_int64_t(double number) {
+    if (!(number == number)) {
+      return 0;
+    }
+    if (number <= -9223372036854775808.0) {
+      return std::numeric_limits<int64_t>::min();
+    }
+    if (number >= 9223372036854775808.0) {
+      return std::numeric_limits<int64_t>::max();
+    }
+    return static_cast<int64_t>(number);
+  }
+  
+  // Return true if the string is a canonical array index as defined in
+  // section 15.4 of the ECMA-262 spec, i.e. the decimal representation
+  // of an integer in the range [0, 2^32 - 2] without leading zeros,
+  // and store the integer in index. This reads the UTF-16 characters
+  // directly, so nothing is transcoded or allocated.
+  HAL_EXPORT bool ToArrayIndex(JSStringRef string_ref, std::uint32_t& index) HAL_NOEXCEPT;
+  
+  // Return the offset, in code units, of the first character that
+  // makes the input invalid JSON as defined in ECMA-404, or npos if
+  // the input is valid. An input that ends too early reports its
+  // length. JavaScriptCore only says that parsing failed, so this is
+  // run after a failure to say where.
+  HAL_EXPORT std::size_t FindJSONErrorOffset(const char*   input, std::size_t length);
+  HAL_EXPORT std::size_t FindJSONErrorOffset(const JSChar* input, std::size_t length);
+  
+  // Scan the JSON value starting at offset, which must not be
+  // whitespace. On success leave offset just past the value, and on
+  // failure at the offending code unit, or at length if the input ends
+  // too early.
+  HAL_EXPORT bool ScanJSONValue(const char*   input, std::size_t length, std::size_t& offset);
+  HAL_EXPORT bool ScanJSONValue(const JSChar* input, std::size_t length, std::size_t& offset);
+  
+  // Escape a string for a JSON string or a Prometheus label value,
+  // which share these escapes.
+  HAL_EXPORT std::string EscapeJSONString(const std::string& string);
   
 }} // namespace HAL { namespace detail {
 
@@ -0,0 +1,212 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSVALUECLONER_HPP_
+#define _HAL_DETAIL_JSVALUECLONER_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSValueCloner walks the graph of a JavaScript value of
+   one JSContext, and describes each value and object it reaches to a
+   JSValueCloner::Target, which recreates them. It is the
+   implementation of JSContext::Clone, whose target is a
+   JSValueCloneTarget, and of JSSerializedValue, whose target stores
+   them outside of any context.
+
+   The object graph is walked with an explicit work list rather than
+   by recursion, and every object is given an id the first time it is
+   found, so deep graphs can't overflow the native stack and shared or
+   cyclic references are preserved. Arrays, Dates, ArrayBuffers and
+   typed arrays keep their types. For other objects the enumerable
+   properties are copied into a plain object.
+   */
+  class JSValueCloner final {
+
+  public:
+
+    enum class ValueType : std::uint8_t {
+      Undefined,
+      Null,
+      Boolean,
+      Number,
+      String,
+      Object
+    };
+
+    // number holds a boolean or a number, string a string of the
+    // source context group, and object the id of an object. Ids count
+    // up from 0 in the order the objects are found.
+    struct Value {
+      ValueType   type;
+      double      number;
+      JSStringRef string;
+      std::size_t object;
+    };
+
+    enum class ObjectType : std::uint8_t {
+      Object,
+      Array,
+      Date,
+      ArrayBuffer,
+      TypedArray
+    };
+
+    // time is set for a Date, bytes and byte_length for an
+    // ArrayBuffer, and buffer, the id of the ArrayBuffer, byte_offset
+    // and length for a typed array.
+    struct Object {
+      ObjectType    type;
+      JSObjectRef   source_ref;
+      double        time;
+      void*         bytes;
+      std::size_t   byte_length;
+      std::size_t   buffer;
+      std::size_t   byte_offset;
+      std::size_t   length;
+      std::uint32_t typed_array_type;
+    };
+
+    /*!
+     @class
+
+     @discussion A Target is told of each object once, in the order of
+     their ids, so the ArrayBuffer of a typed array is added before
+     it. The properties of each object are set one after the other,
+     after every object they refer to has been added.
+     */
+    class Target {
+
+    public:
+
+      virtual ~Target() HAL_NOEXCEPT {
+      }
+
+      virtual void AddObject(const Object& object) = 0;
+
+      // name is null for the elements of an array.
+      virtual void SetProperty(std::size_t id, JSStringRef name, unsigned index, const Value& value) = 0;
+    };
+
+    /*!
+     @method
+
+     @abstract Create a JSValueCloner reading from a context. Errors
+     are reported under component_name.
+     */
+    JSValueCloner(JSContextRef source_context_ref, Target& target, const std::string& component_name);
+
+    JSValueCloner(const JSValueCloner&)            = delete;
+    JSValueCloner& operator=(const JSValueCloner&) = delete;
+
+    /*!
+     @method
+
+     @abstract Describe a value of the source context, and every
+     object reachable from it, to the target, and return the value. A
+     string it returns is valid until the JSValueCloner is destroyed.
+
+     @throws std::runtime_error if the value is or contains a function,
+     or if JavaScriptCore reports an exception.
+     */
+    Value Clone(JSValueRef js_value_ref);
+
+    /*!
+     @method
+
+     @abstract Keep a value alive until the returned owner is
+     destroyed, which may happen on any thread. The value is then
+     released by a task posted to the JSRunLoop of its context, since
+     only the thread of that run loop may use it.
+
+     @throws std::runtime_error if the context has no JSRunLoop.
+     */
+    static std::shared_ptr<void> RetainOnRunLoop(JSContextRef context_ref, JSValueRef js_value_ref);
+
+  private:
+
+    Value       CloneValue(JSValueRef js_value_ref);
+    std::size_t CloneObject(JSObjectRef js_object_ref);
+    std::size_t AddObject(const Object& object);
+    void        CopyProperties(std::size_t id, JSObjectRef js_object_ref);
+    void        CopyElements(std::size_t id, JSObjectRef js_object_ref);
+    bool        IsArray(JSObjectRef js_object_ref);
+    bool        IsDate(JSObjectRef js_object_ref);
+    void        ThrowIfException(JSValueRef exception) const;
+
+    JSContextRef source_context_ref__;
+    Target&      target__;
+    std::string  component_name__;
+    JSObjectRef  is_array_function_ref__ { nullptr };
+    JSObjectRef  date_constructor_ref__  { nullptr };
+
+    // Each object's id is its index in objects__. The properties of
+    // those from next_object__ on are still to be set.
+    std::vector<Object>                          objects__;
+    std::unordered_map<JSObjectRef, std::size_t> ids__;
+    std::size_t                                  next_object__ { 0 };
+
+    // A string value is only valid until the next one is read.
+    std::unique_ptr<std::remove_pointer<JSStringRef>::type, void(*)(JSStringRef)> string_ref__;
+  };
+
+  /*!
+   @class
+
+   @discussion A JSValueCloneTarget recreates the values a
+   JSValueCloner describes in another JSContext, which may belong to
+   a different JSContextGroup. The objects are protected in that
+   context until the JSValueCloneTarget is destroyed.
+   */
+  class JSValueCloneTarget final : public JSValueCloner::Target {
+
+  public:
+
+    // If share_array_buffers is true, each ArrayBuffer uses the bytes
+    // of its source, which stays alive until the clone is collected,
+    // and is then released on the JSRunLoop of the source context.
+    JSValueCloneTarget(JSContextRef source_context_ref, JSContextRef context_ref, bool share_array_buffers) HAL_NOEXCEPT;
+    virtual ~JSValueCloneTarget() HAL_NOEXCEPT;
+
+    JSValueCloneTarget(const JSValueCloneTarget&)            = delete;
+    JSValueCloneTarget& operator=(const JSValueCloneTarget&) = delete;
+
+    virtual void AddObject(const JSValueCloner::Object& object) override;
+    virtual void SetProperty(std::size_t id, JSStringRef name, unsigned index, const JSValueCloner::Value& value) override;
+
+    // Return a value described by the JSValueCloner in this context.
+    JSValueRef ToJSValueRef(const JSValueCloner::Value& value) const HAL_NOEXCEPT;
+
+  private:
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    JSObjectRef CreateArrayBuffer(const JSValueCloner::Object& object, JSValueRef* exception);
+#endif
+    void ThrowIfException(JSValueRef exception) const;
+
+    JSContextRef             source_context_ref__;
+    JSContextRef             context_ref__;
+    bool                     share_array_buffers__;
+    std::vector<JSObjectRef> object_refs__;
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSVALUECLONER_HPP_
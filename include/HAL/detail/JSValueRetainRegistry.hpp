@@ -0,0 +1,171 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_DETAIL_JSVALUERETAINREGISTRY_HPP_
+#define _HAL_DETAIL_JSVALUERETAINREGISTRY_HPP_
+
+#include "HAL/detail/JSBase.hpp"
+#include "HAL/detail/JSNodePool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace HAL { namespace detail {
+
+  /*!
+   @class
+
+   @discussion A JSValueRetainRegistry counts, for every JSValueRef
+   wrapped by a live JSValue, the number of JSValues currently
+   wrapping it. The first retain of a JSValueRef calls JSValueProtect
+   and the last release calls JSValueUnprotect.
+
+   Each JSContext owns one registry, shared by all of its copies, so
+   threads working on different contexts never contend and the
+   registry is dropped as a whole with the context. A JSValueRef may
+   be counted by more than one registry, each of which holds its own
+   JavaScriptCore protect.
+
+   When HAL_THREAD_SAFE is defined the registry has its own mutex.
+
+   All live registries are linked together so that diagnostics such
+   as DumpRetainedHandles can walk them.
+   */
+  class HAL_EXPORT JSValueRetainRegistry final {
+
+  public:
+
+    explicit JSValueRetainRegistry(JSContextRef js_context_ref) HAL_NOEXCEPT;
+    ~JSValueRetainRegistry() HAL_NOEXCEPT;
+    JSValueRetainRegistry(const JSValueRetainRegistry&)            = delete;
+    JSValueRetainRegistry(JSValueRetainRegistry&&)                 = delete;
+    JSValueRetainRegistry& operator=(const JSValueRetainRegistry&) = delete;
+    JSValueRetainRegistry& operator=(JSValueRetainRegistry&&)      = delete;
+
+    /*!
+     @method
+
+     @abstract Add count to the retain count of a JSValueRef, calling
+     JSValueProtect if it was not already in the registry.
+
+     @result The retain count after incrementing.
+     */
+    std::size_t Retain(JSContextRef js_context_ref, JSValueRef js_value_ref, std::size_t count = 1);
+
+    /*!
+     @method
+
+     @abstract Decrement the retain count of a JSValueRef. When it
+     reaches zero the JSValueRef is unprotected and removed, unless
+     defer is true, in which case it stays in the registry with a
+     count of zero until Flush.
+
+     @result The retain count after decrementing.
+     */
+    std::size_t Release(JSContextRef js_context_ref, JSValueRef js_value_ref, bool defer = false);
+
+    /*!
+     @method
+
+     @abstract Unprotect and remove a JSValueRef whose release was
+     deferred, unless it has been retained again since.
+
+     @result true if the JSValueRef was unprotected.
+     */
+    bool Flush(JSContextRef js_context_ref, JSValueRef js_value_ref);
+
+    /*!
+     @method
+
+     @abstract Return the number of JSValueRefs in the registry.
+     */
+    std::size_t size() const;
+
+    /*!
+     @method
+
+     @abstract Return the number of JSValueRefs ever added to the
+     registry, a cheap measure of how many values HAL has created in
+     its JSContext.
+     */
+    std::uint64_t get_protect_count() const HAL_NOEXCEPT {
+      return protect_count__;
+    }
+
+    /*!
+     @method
+
+     @abstract Return the JSContextRef this registry was created for.
+     */
+    JSContextRef get_context_ref() const HAL_NOEXCEPT {
+      return js_context_ref__;
+    }
+
+    /*!
+     @method
+
+     @abstract Call callback for every JSValueRef in the registry with
+     its retain count and, when HAL_TRACK_RETAINED_HANDLES is defined,
+     the call site and stack that first retained it (otherwise empty
+     strings).
+
+     @discussion The registry is locked while callback runs, so it must
+     not create or destroy JSValues of this registry's JSContext.
+     */
+    void ForEach(const std::function<void(JSValueRef js_value_ref, std::size_t count, const std::string& site, const std::string& backtrace)>& callback) const;
+
+    /*!
+     @method
+
+     @abstract Call callback for every live registry.
+
+     @discussion The list of registries is locked while callback runs,
+     so it must not create or destroy a JSContext.
+     */
+    static void ForEachRegistry(const std::function<void(const JSValueRetainRegistry& js_value_retain_registry)>& callback);
+
+  private:
+
+    struct Entry {
+      std::size_t count;
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      std::string site;
+      std::string backtrace;
+#endif
+    };
+
+    JSContextRef js_context_ref__;
+
+    // Links in the list of all live registries.
+    JSValueRetainRegistry* previous__ { nullptr };
+    JSValueRetainRegistry* next__     { nullptr };
+
+    std::uint64_t protect_count__ { 0 };
+
+    // Silence 4251 on Windows since private member variables do not
+    // need to be exported from a DLL.
+#pragma warning(push)
+#pragma warning(disable: 4251)
+    JSNodePoolUnorderedMap<std::intptr_t, Entry> map__;
+#pragma warning(pop)
+
+#undef  HAL_JSVALUERETAINREGISTRY_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE
+    mutable JSMutex mutex__ HAL_LOCK_CLASS_NAME(JSValueRetainRegistry, "JSValueRetainRegistry");
+#define HAL_JSVALUERETAINREGISTRY_LOCK_GUARD std::lock_guard<JSMutex> lock(mutex__)
+#else
+#define HAL_JSVALUERETAINREGISTRY_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE
+  };
+
+}} // namespace HAL { namespace detail {
+
+#endif // _HAL_DETAIL_JSVALUERETAINREGISTRY_HPP_
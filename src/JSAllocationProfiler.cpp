@@ -0,0 +1,167 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSAllocationProfiler.hpp"
+
+#include "HAL/detail/JSAllocationSample.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+
+namespace HAL {
+
+  std::atomic<bool> JSAllocationProfiler::enabled__ { false };
+
+  namespace {
+
+    // A site is identified by the addresses of its string literals,
+    // so counting a sample builds no string.
+    typedef std::tuple<const char*, int, const char*, const char*> AllocationKey;
+
+    struct AllocationProfile final {
+      std::mutex                             mutex;
+      std::map<AllocationKey, std::uint64_t> counts;
+      std::size_t                            sample_count { 0 };
+      std::atomic<std::uint32_t>             sample_interval { 100 };
+    };
+
+    AllocationProfile& GetAllocationProfile() {
+      static AllocationProfile profile;
+      return profile;
+    }
+
+    HAL_THREAD_LOCAL const JSAllocationSite* allocation_site = nullptr;
+
+#ifdef HAL_ALLOCATION_PROFILE_ENABLE
+    HAL_THREAD_LOCAL std::uint32_t sample_countdown = 0;
+#endif
+
+    std::string ToSiteName(const AllocationKey& key) {
+      const auto file = std::get<0>(key);
+      const auto line = std::get<1>(key);
+      const auto tag  = std::get<2>(key);
+      if (!file) {
+        return "(unattributed)";
+      }
+
+      std::ostringstream os;
+      if (tag) {
+        os << tag << " (" << file << ":" << line << ")";
+      } else {
+        os << file << ":" << line;
+      }
+      return os.str();
+    }
+
+  } // namespace {
+
+  JSAllocationSite::JSAllocationSite(const char* file, int line, const char* tag) HAL_NOEXCEPT
+  : file(file)
+  , line(line)
+  , tag(tag)
+  , previous(allocation_site) {
+    allocation_site = this;
+  }
+
+  JSAllocationSite::~JSAllocationSite() HAL_NOEXCEPT {
+    allocation_site = previous;
+  }
+
+#ifdef HAL_ALLOCATION_PROFILE_ENABLE
+  namespace detail {
+
+    void CountJSAllocation(const char* kind) HAL_NOEXCEPT {
+      auto& profile = GetAllocationProfile();
+      const auto sample_interval = profile.sample_interval.load(std::memory_order_relaxed);
+      if (sample_countdown == 0 || sample_countdown > sample_interval) {
+        sample_countdown = sample_interval;
+      }
+      if (--sample_countdown > 0) {
+        return;
+      }
+
+      const auto site = allocation_site;
+      const AllocationKey key(site ? site -> file : nullptr, site ? site -> line : 0, site ? site -> tag : nullptr, kind);
+      try {
+        std::lock_guard<std::mutex> lock(profile.mutex);
+        ++profile.counts[key];
+        ++profile.sample_count;
+      } catch (...) {
+        // Drop the sample rather than fail the allocation.
+      }
+    }
+
+  } // namespace detail {
+#endif
+
+  void JSAllocationProfiler::Start(std::uint32_t sample_interval) {
+    if (sample_interval == 0) {
+      detail::ThrowInvalidArgument("JSAllocationProfiler", "The sample interval must be at least 1.");
+    }
+
+    auto& profile = GetAllocationProfile();
+    {
+      std::lock_guard<std::mutex> lock(profile.mutex);
+      profile.counts.clear();
+      profile.sample_count = 0;
+    }
+    profile.sample_interval.store(sample_interval, std::memory_order_relaxed);
+    enabled__.store(true, std::memory_order_relaxed);
+  }
+
+  void JSAllocationProfiler::Stop() HAL_NOEXCEPT {
+    enabled__.store(false, std::memory_order_relaxed);
+  }
+
+  std::uint32_t JSAllocationProfiler::get_sample_interval() HAL_NOEXCEPT {
+    return GetAllocationProfile().sample_interval.load(std::memory_order_relaxed);
+  }
+
+  std::size_t JSAllocationProfiler::get_sample_count() HAL_NOEXCEPT {
+    auto& profile = GetAllocationProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    return profile.sample_count;
+  }
+
+  std::vector<JSAllocationSiteCount> JSAllocationProfiler::GetTopSites(std::size_t count) {
+    std::vector<std::pair<AllocationKey, std::uint64_t>> counts;
+    {
+      auto& profile = GetAllocationProfile();
+      std::lock_guard<std::mutex> lock(profile.mutex);
+      counts.assign(profile.counts.begin(), profile.counts.end());
+    }
+
+    // Ties keep the order of the map, so the result is deterministic.
+    std::stable_sort(counts.begin(), counts.end(), [](const std::pair<AllocationKey, std::uint64_t>& lhs, const std::pair<AllocationKey, std::uint64_t>& rhs) {
+      return lhs.second > rhs.second;
+    });
+
+    std::vector<JSAllocationSiteCount> result;
+    for (std::size_t i = 0; i < counts.size() && i < count; ++i) {
+      result.push_back({ ToSiteName(counts[i].first), std::get<3>(counts[i].first), counts[i].second });
+    }
+    return result;
+  }
+
+  std::string JSAllocationProfiler::ToReport(std::size_t count) {
+    const auto sample_interval = get_sample_interval();
+    std::ostringstream os;
+    os << "HAL wrapper allocations, 1 in " << sample_interval << " sampled\n";
+    os << std::setw(12) << "estimated" << std::setw(10) << "samples" << "  " << std::left << std::setw(10) << "kind" << std::right << "site\n";
+    for (const auto& site : GetTopSites(count)) {
+      os << std::setw(12) << site.sample_count * sample_interval << std::setw(10) << site.sample_count << "  " << std::left << std::setw(10) << site.kind << std::right << site.site << "\n";
+    }
+    return os.str();
+  }
+
+} // namespace HAL {
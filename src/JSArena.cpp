@@ -0,0 +1,149 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSArena.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSHandleScope.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSValueRetainRegistry.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <new>
+
+namespace {
+  // The innermost JSArena on this thread.
+  HAL_THREAD_LOCAL HAL::JSArena* current_js_arena__ = nullptr;
+}
+
+namespace HAL {
+
+  JSArena::JSArena(const JSContext& js_context) HAL_NOEXCEPT
+  : previous__(current_js_arena__)
+  , id__(JSHandleScope::NextId() | kIdBit)
+  , js_global_context_ref__(JSContextGetGlobalContext(static_cast<JSContextRef>(js_context))) {
+    HAL_LOG_TRACE("JSArena:: ctor ", this, " id = ", id__ & ~kIdBit);
+
+    // The context must outlive the unprotects of the destructor.
+    JSGlobalContextRetain(js_global_context_ref__);
+    current_js_arena__ = this;
+  }
+
+  JSArena::~JSArena() HAL_NOEXCEPT {
+    HAL_LOG_TRACE("JSArena:: dtor ", this, " id = ", id__ & ~kIdBit, " size = ", size__);
+
+    assert(current_js_arena__ == this);
+    current_js_arena__ = previous__;
+
+    // One pass drops the arena's protects. A JSValue still counted in a
+    // slot has escaped the arena, so its references move to the retain
+    // registry first, which keeps the JSValueRef protected throughout.
+    for (std::size_t i = 0; i < size__; ++i) {
+      const auto& slot = GetSlot(static_cast<std::uint32_t>(i));
+      if (slot.count > 0) {
+        HAL_LOG_DEBUG("JSArena:: promote ", slot.js_value_ref, " count = ", slot.count);
+        slot.js_value_retain_registry -> Retain(slot.js_context_ref, slot.js_value_ref, slot.count);
+      }
+      detail::UnprotectJSValue(slot.js_context_ref, slot.js_value_ref);
+    }
+
+    JSGlobalContextRelease(js_global_context_ref__);
+  }
+
+  void* JSArena::Allocate(std::size_t size, std::size_t alignment) {
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    const auto aligned = [alignment](char* pointer) {
+      return reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(pointer) + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1));
+    };
+
+    auto next = memory_next__ ? aligned(memory_next__) : nullptr;
+    if (!next || next > memory_end__ || static_cast<std::size_t>(memory_end__ - next) < size) {
+      // A request too large for a block gets a block of its own, so a
+      // block is never wasted by more than one large request.
+      const auto block_size = std::max(kMemoryBlockSize, size + alignment);
+      memory_blocks__.emplace_back(new char[block_size]);
+      memory_next__ = memory_blocks__.back().get();
+      memory_end__  = memory_next__ + block_size;
+      next          = aligned(memory_next__);
+    }
+
+    memory_next__     = next + size;
+    allocated_size__ += size;
+    return next;
+  }
+
+  std::uint64_t JSArena::GetCurrentId() HAL_NOEXCEPT {
+    return current_js_arena__ ? current_js_arena__ -> id__ & ~kIdBit : 0;
+  }
+
+  bool JSArena::Track(detail::JSValueRetainRegistry* js_value_retain_registry, JSContextRef js_context_ref, JSValueRef js_value_ref, std::uint64_t& scope_id, std::uint32_t& slot) HAL_NOEXCEPT {
+    const auto arena = current_js_arena__;
+    if (!arena || arena -> size__ == std::numeric_limits<std::uint32_t>::max() || JSContextGetGlobalContext(js_context_ref) != arena -> js_global_context_ref__) {
+      return false;
+    }
+
+    const auto index = arena -> size__;
+    if (index % kSlotChunkSize == 0) {
+      Slot* slot_chunk = new (std::nothrow) Slot[kSlotChunkSize];
+      if (!slot_chunk) {
+        return false;
+      }
+      try {
+        arena -> slot_chunks__.emplace_back(slot_chunk);
+      } catch (...) {
+        delete [] slot_chunk;
+        return false;
+      }
+    }
+
+    // The arena's slots are on the heap, out of reach of the
+    // conservative stack scan, so the arena protects what it tracks.
+    detail::ProtectJSValue(js_context_ref, js_value_ref);
+    ++arena -> size__;
+    arena -> GetSlot(static_cast<std::uint32_t>(index)) = Slot { js_value_retain_registry, js_context_ref, js_value_ref, 1 };
+    scope_id = arena -> id__;
+    slot     = static_cast<std::uint32_t>(index);
+    return true;
+  }
+
+  bool JSArena::Retain(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT {
+    const auto arena = Find(scope_id);
+    if (!arena) {
+      return false;
+    }
+
+    assert(slot < arena -> size__);
+    ++arena -> GetSlot(slot).count;
+    return true;
+  }
+
+  bool JSArena::Release(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT {
+    const auto arena = Find(scope_id);
+    if (!arena) {
+      return false;
+    }
+
+    assert(slot < arena -> size__);
+    assert(arena -> GetSlot(slot).count > 0);
+    --arena -> GetSlot(slot).count;
+    return true;
+  }
+
+  JSArena* JSArena::Find(std::uint64_t scope_id) HAL_NOEXCEPT {
+    // As for JSHandleScope, ids increase with nesting depth.
+    for (auto arena = current_js_arena__; arena && arena -> id__ >= scope_id; arena = arena -> previous__) {
+      if (arena -> id__ == scope_id) {
+        return arena;
+      }
+    }
+    return nullptr;
+  }
+
+} // namespace HAL {
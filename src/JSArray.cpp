@@ -9,11 +9,16 @@
 #include "HAL/JSArray.hpp"
 #include "HAL/JSValue.hpp"
 #include "HAL/JSString.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
 #include "HAL/detail/JSUtil.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
 #include <vector>
 #include <algorithm>
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
+#include <type_traits>
 
 namespace HAL {
 
@@ -26,14 +31,17 @@ JSArray::JSArray(const JSContext& js_context, JSObjectRef js_object_ref)
 }
 
 JSObjectRef JSArray::MakeArray(const JSContext& js_context, const std::vector<JSValue>& arguments) {
-	JSValueRef exception { nullptr };
-	JSObjectRef js_object_ref = nullptr;
-	if (!arguments.empty()) {
-		std::vector<JSValueRef> arguments_array = detail::to_vector(arguments);
-		js_object_ref = JSObjectMakeArray(static_cast<JSContextRef>(js_context), arguments_array.size(), &arguments_array[0], &exception);
-	} else {
-		js_object_ref = JSObjectMakeArray(static_cast<JSContextRef>(js_context), 0, nullptr, &exception);
+	const auto js_context_ref = static_cast<JSContextRef>(js_context);
+	detail::JSValueRefBuffer elements;
+	for (const auto& argument : arguments) {
+		elements.push_back(detail::ToArrayElement(js_context_ref, argument));
 	}
+	return MakeArray(js_context, elements.data(), elements.size());
+}
+
+JSObjectRef JSArray::MakeArray(const JSContext& js_context, const JSValueRef elements[], std::size_t count) {
+	JSValueRef exception { nullptr };
+	JSObjectRef js_object_ref = JSObjectMakeArray(static_cast<JSContextRef>(js_context), count, count > 0 ? elements : nullptr, &exception);
 	
 	if (exception) {
 		// If this assert fails then we need to JSValueUnprotect
@@ -45,75 +53,332 @@ JSObjectRef JSArray::MakeArray(const JSContext& js_context, const std::vector<JS
 	return js_object_ref;
 }
 
+namespace {
+
+	// Below this many elements reading each element directly is
+	// cheaper than building a typed array.
+	const uint32_t kBulkConversionThreshold = 32;
+
+	JSValueRef GetElement(JSContextRef js_context_ref, JSObjectRef js_object_ref, uint32_t index) {
+		JSValueRef exception { nullptr };
+		const auto js_value_ref = JSObjectGetPropertyAtIndex(js_context_ref, js_object_ref, index, &exception);
+		if (exception) {
+			detail::ThrowRuntimeError("JSArray", JSValue(JSContext(js_context_ref), exception));
+		}
+		return js_value_ref;
+	}
+
+	double ToNumber(JSContextRef js_context_ref, JSValueRef js_value_ref) {
+		JSValueRef exception { nullptr };
+		const double result = JSValueToNumber(js_context_ref, js_value_ref, &exception);
+		if (exception) {
+			detail::ThrowRuntimeError("JSArray", JSValue(JSContext(js_context_ref), exception));
+		}
+		return result;
+	}
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+	// Return a typed array of the given type holding the elements of
+	// js_object_ref, converted by ToNumber, ToInt32 or ToUint32
+	// exactly like the per-element path. The source itself is returned
+	// if it already is one. Return nullptr if the conversion fails, so
+	// that the caller falls back to reading each element.
+	JSObjectRef ToTypedArray(JSContextRef js_context_ref, JSObjectRef js_object_ref, JSTypedArrayType type, const JSString& constructor_name) HAL_NOEXCEPT {
+		JSValueRef exception { nullptr };
+		if (JSValueGetTypedArrayType(js_context_ref, js_object_ref, &exception) == type) {
+			return js_object_ref;
+		}
+
+		const auto global_object_ref = JSContextGetGlobalObject(js_context_ref);
+		const auto constructor_ref   = JSObjectGetProperty(js_context_ref, global_object_ref, static_cast<JSStringRef>(constructor_name), &exception);
+		if (exception || !JSValueIsObject(js_context_ref, constructor_ref)) {
+			return nullptr;
+		}
+
+		const auto constructor_object_ref = JSValueToObject(js_context_ref, constructor_ref, &exception);
+		const auto from_ref               = JSObjectGetProperty(js_context_ref, constructor_object_ref, static_cast<JSStringRef>(detail::JSAtoms::from), &exception);
+		if (exception || !JSValueIsObject(js_context_ref, from_ref)) {
+			return nullptr;
+		}
+
+		const auto from_object_ref = JSValueToObject(js_context_ref, from_ref, &exception);
+		const JSValueRef arguments[] = { js_object_ref };
+		const auto result_ref = JSObjectCallAsFunction(js_context_ref, from_object_ref, constructor_object_ref, 1, arguments, &exception);
+		if (exception || JSValueGetTypedArrayType(js_context_ref, result_ref, &exception) != type) {
+			return nullptr;
+		}
+
+		return JSValueToObject(js_context_ref, result_ref, &exception);
+	}
+#endif
+
+	// How to decode one number into an element of std::vector<U>, and
+	// the typed array that holds elements of type U.
+	template<typename U>
+	struct JSNumericElement;
+
+	template<>
+	struct JSNumericElement<double> {
+		static double Decode(double number) HAL_NOEXCEPT {
+			return number;
+		}
+#ifdef HAL_TYPED_ARRAY_ENABLE
+		static const JSTypedArrayType type = kJSTypedArrayTypeFloat64Array;
+		static const JSString& constructor_name() HAL_NOEXCEPT {
+			return detail::JSAtoms::Float64Array;
+		}
+#endif
+	};
+
+	template<>
+	struct JSNumericElement<int32_t> {
+		static int32_t Decode(double number) HAL_NOEXCEPT {
+			return detail::to_int32_t(number);
+		}
+#ifdef HAL_TYPED_ARRAY_ENABLE
+		static const JSTypedArrayType type = kJSTypedArrayTypeInt32Array;
+		static const JSString& constructor_name() HAL_NOEXCEPT {
+			return detail::JSAtoms::Int32Array;
+		}
+#endif
+	};
+
+	template<>
+	struct JSNumericElement<uint32_t> {
+		static uint32_t Decode(double number) HAL_NOEXCEPT {
+			return static_cast<uint32_t>(detail::to_int32_t(number));
+		}
+#ifdef HAL_TYPED_ARRAY_ENABLE
+		static const JSTypedArrayType type = kJSTypedArrayTypeUint32Array;
+		static const JSString& constructor_name() HAL_NOEXCEPT {
+			return detail::JSAtoms::Uint32Array;
+		}
+#endif
+	};
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+	// Convert one typed array element exactly like ToNumber followed by
+	// Decode. Between integer types that is a plain conversion, which
+	// wraps like ToInt32 and ToUint32, so the loops below vectorize.
+	template<typename U, typename Source>
+	typename std::enable_if<std::is_floating_point<U>::value || std::is_floating_point<Source>::value, U>::type ConvertElement(Source element) HAL_NOEXCEPT {
+		return JSNumericElement<U>::Decode(static_cast<double>(element));
+	}
+
+	template<typename U, typename Source>
+	typename std::enable_if<!std::is_floating_point<U>::value && !std::is_floating_point<Source>::value, U>::type ConvertElement(Source element) HAL_NOEXCEPT {
+		return static_cast<U>(element);
+	}
+
+	template<typename U, typename Source>
+	void CopyElements(const void* bytes, std::size_t count, std::vector<U>& items) {
+		const auto source = static_cast<const Source*>(bytes);
+		if (std::is_same<U, Source>::value) {
+			items.resize(count);
+			std::memcpy(items.data(), source, count * sizeof(U));
+			return;
+		}
+
+		items.resize(count);
+		U* destination = items.data();
+		for (std::size_t i = 0; i < count; ++i) {
+			destination[i] = ConvertElement<U>(source[i]);
+		}
+	}
+
+	// Copy the elements of js_object_ref straight out of its backing
+	// store, widening or narrowing them to U, if it is a typed array of
+	// any element type. Return false if it isn't one.
+	template<typename U>
+	bool CopyTypedArray(JSContextRef js_context_ref, JSObjectRef js_object_ref, std::vector<U>& items) {
+		JSValueRef exception { nullptr };
+		const auto type = JSValueGetTypedArrayType(js_context_ref, js_object_ref, &exception);
+		if (exception || type == kJSTypedArrayTypeNone || type == kJSTypedArrayTypeArrayBuffer) {
+			return false;
+		}
+
+		const auto bytes_ptr   = static_cast<const char*>(JSObjectGetTypedArrayBytesPtr(js_context_ref, js_object_ref, &exception));
+		const auto byte_offset = JSObjectGetTypedArrayByteOffset(js_context_ref, js_object_ref, &exception);
+		const auto count       = JSObjectGetTypedArrayLength(js_context_ref, js_object_ref, &exception);
+		if (exception || (!bytes_ptr && count > 0)) {
+			return false;
+		}
+
+		const auto bytes = bytes_ptr + byte_offset;
+		switch (type) {
+			case kJSTypedArrayTypeInt8Array:         CopyElements<U, int8_t>  (bytes, count, items); return true;
+			case kJSTypedArrayTypeUint8Array:        CopyElements<U, uint8_t> (bytes, count, items); return true;
+			case kJSTypedArrayTypeUint8ClampedArray: CopyElements<U, uint8_t> (bytes, count, items); return true;
+			case kJSTypedArrayTypeInt16Array:        CopyElements<U, int16_t> (bytes, count, items); return true;
+			case kJSTypedArrayTypeUint16Array:       CopyElements<U, uint16_t>(bytes, count, items); return true;
+			case kJSTypedArrayTypeInt32Array:        CopyElements<U, int32_t> (bytes, count, items); return true;
+			case kJSTypedArrayTypeUint32Array:       CopyElements<U, uint32_t>(bytes, count, items); return true;
+			case kJSTypedArrayTypeFloat32Array:      CopyElements<U, float>   (bytes, count, items); return true;
+			case kJSTypedArrayTypeFloat64Array:      CopyElements<U, double>  (bytes, count, items); return true;
+			default:                                 return false;
+		}
+	}
+#endif
+
+	// Convert the elements of an array to numbers. A typed array is
+	// copied out of its backing store whatever its length, and a plain
+	// array goes through a typed array when it has many elements.
+	template<typename U>
+	std::vector<U> ToNumericVector(JSContextRef js_context_ref, JSObjectRef js_object_ref, uint32_t length) {
+		std::vector<U> items;
+#ifdef HAL_TYPED_ARRAY_ENABLE
+		if (CopyTypedArray(js_context_ref, js_object_ref, items)) {
+			return items;
+		}
+
+		if (length >= kBulkConversionThreshold) {
+			const auto typed_array_ref = ToTypedArray(js_context_ref, js_object_ref, JSNumericElement<U>::type, JSNumericElement<U>::constructor_name());
+			if (typed_array_ref) {
+				// The typed array must stay alive while its bytes are read.
+				// Its bytes start byte_offset into those of its buffer,
+				// which is not 0 for a subarray.
+				detail::ProtectJSValue(js_context_ref, typed_array_ref);
+				JSValueRef exception { nullptr };
+				const auto bytes_ptr   = static_cast<const char*>(JSObjectGetTypedArrayBytesPtr(js_context_ref, typed_array_ref, &exception));
+				const auto byte_offset = JSObjectGetTypedArrayByteOffset(js_context_ref, typed_array_ref, &exception);
+				const auto count       = JSObjectGetTypedArrayLength(js_context_ref, typed_array_ref, &exception);
+				if (bytes_ptr && !exception) {
+					const auto elements = reinterpret_cast<const U*>(bytes_ptr + byte_offset);
+					items.assign(elements, elements + count);
+				}
+				detail::UnprotectJSValue(js_context_ref, typed_array_ref);
+				if (!exception) {
+					return items;
+				}
+				items.clear();
+			}
+		}
+#endif
+
+		items.reserve(length);
+		for (uint32_t i = 0; i < length; i++) {
+			items.push_back(JSNumericElement<U>::Decode(ToNumber(js_context_ref, GetElement(js_context_ref, js_object_ref, i))));
+		}
+		return items;
+	}
+
+} // namespace {
+
 uint32_t JSArray::GetLength() const HAL_NOEXCEPT {
-	if (!HasProperty("length")) {
+	if (!HasProperty(detail::JSAtoms::length)) {
 		return 0;
 	}
-	const auto length = GetProperty("length");
+	const auto length = GetProperty(detail::JSAtoms::length);
 	if (!length.IsNumber()) {
 		return 0;
 	}
 	return static_cast<uint32_t>(length);
 }
 
+JSValue JSArray::const_iterator::operator*() const {
+	return JSValue(js_array__ -> js_context__, GetElement(static_cast<JSContextRef>(js_array__ -> js_context__), js_array__ -> js_object_ref__, index__));
+}
+
+uint32_t JSArray::ForEach(const std::function<bool(const JSValue& element, uint32_t index)>& callback) const {
+	const auto length         = GetLength();
+	const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+	for (uint32_t i = 0; i < length; i++) {
+		if (!callback(JSValue(js_context__, GetElement(js_context_ref, js_object_ref__, i)), i)) {
+			return i;
+		}
+	}
+	return length;
+}
+
 JSArray::operator std::vector<JSValue>() const {
-	const auto length = GetLength();
+	const auto length         = GetLength();
+	const auto js_context_ref = static_cast<JSContextRef>(js_context__);
 	std::vector<JSValue> items;
 	items.reserve(length);
 	for (uint32_t i = 0; i < length; i++) {
-		items.push_back(GetProperty(i));
+		items.push_back(JSValue(js_context__, GetElement(js_context_ref, js_object_ref__, i)));
 	}
 	return items;
 }
 
 JSArray::operator std::vector<bool>() const {
-	const auto length = GetLength();
+	const auto length         = GetLength();
+	const auto js_context_ref = static_cast<JSContextRef>(js_context__);
 	std::vector<bool> items;
 	items.reserve(length);
 	for (uint32_t i = 0; i < length; i++) {
-		items.push_back(static_cast<bool>(GetProperty(i)));
+		items.push_back(JSValueToBoolean(js_context_ref, GetElement(js_context_ref, js_object_ref__, i)));
 	}
 	return items;
 }
 
 JSArray::operator std::vector<std::string>() const {
-	const auto length = GetLength();
+	const auto length         = GetLength();
+	const auto js_context_ref = static_cast<JSContextRef>(js_context__);
 	std::vector<std::string> items;
 	items.reserve(length);
 	for (uint32_t i = 0; i < length; i++) {
-		items.push_back(static_cast<std::string>(GetProperty(i)));
+		JSValueRef exception { nullptr };
+		const auto js_string_ref = JSValueToStringCopy(js_context_ref, GetElement(js_context_ref, js_object_ref__, i), &exception);
+		if (exception) {
+			detail::ThrowRuntimeError("JSArray", JSValue(js_context__, exception));
+		}
+		items.push_back(detail::ToUTF8String(js_string_ref));
+		JSStringRelease(js_string_ref);
 	}
 	return items;
 }
 
-JSArray::operator std::vector<double>() const {
-	const auto length = GetLength();
-	std::vector<double> items;
-	items.reserve(length);
-	for (uint32_t i = 0; i < length; i++) {
-		items.push_back(static_cast<double>(GetProperty(i)));
+uint32_t JSArray::CopyColumns(const std::vector<JSArrayColumn>& columns, uint32_t max_rows) const {
+	const auto rows           = std::min(GetLength(), max_rows);
+	const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+	const auto undefined_ref  = JSValueMakeUndefined(js_context_ref);
+	for (uint32_t i = 0; i < rows; i++) {
+		const auto row_ref = GetElement(js_context_ref, js_object_ref__, i);
+		JSObjectRef row_object_ref = nullptr;
+		if (JSValueIsObject(js_context_ref, row_ref)) {
+			row_object_ref = JSValueToObject(js_context_ref, row_ref, nullptr);
+		}
+
+		for (const auto& column : columns) {
+			JSValueRef value_ref = undefined_ref;
+			if (row_object_ref) {
+				JSValueRef exception { nullptr };
+				value_ref = JSObjectGetProperty(js_context_ref, row_object_ref, static_cast<JSStringRef>(column.get_name()), &exception);
+				if (exception) {
+					detail::ThrowRuntimeError("JSArray", JSValue(js_context__, exception));
+				}
+			}
+
+			switch (column.get_type()) {
+				case JSArrayColumn::Type::Double:
+					static_cast<double*>(column.get_buffer())[i] = JSNumericElement<double>::Decode(ToNumber(js_context_ref, value_ref));
+					break;
+				case JSArrayColumn::Type::Int32:
+					static_cast<int32_t*>(column.get_buffer())[i] = JSNumericElement<int32_t>::Decode(ToNumber(js_context_ref, value_ref));
+					break;
+				case JSArrayColumn::Type::Uint32:
+					static_cast<uint32_t*>(column.get_buffer())[i] = JSNumericElement<uint32_t>::Decode(ToNumber(js_context_ref, value_ref));
+					break;
+				case JSArrayColumn::Type::Bool:
+					static_cast<bool*>(column.get_buffer())[i] = JSValueToBoolean(js_context_ref, value_ref);
+					break;
+			}
+		}
 	}
-	return items;
+	return rows;
+}
+
+JSArray::operator std::vector<double>() const {
+	return ToNumericVector<double>(static_cast<JSContextRef>(js_context__), js_object_ref__, GetLength());
 }
 
 JSArray::operator std::vector<int32_t>() const {
-	const auto length = GetLength();
-	std::vector<int32_t> items;
-	items.reserve(length);
-	for (uint32_t i = 0; i < length; i++) {
-		items.push_back(static_cast<int32_t>(GetProperty(i)));
-	}
-	return items;
+	return ToNumericVector<int32_t>(static_cast<JSContextRef>(js_context__), js_object_ref__, GetLength());
 }
 
 JSArray::operator std::vector<uint32_t>() const {
-	const auto length = GetLength();
-	std::vector<uint32_t> items;
-	items.reserve(length);
-	for (uint32_t i = 0; i < length; i++) {
-		items.push_back(static_cast<uint32_t>(GetProperty(i)));
-	}
-	return items;
+	return ToNumericVector<uint32_t>(static_cast<JSContextRef>(js_context__), js_object_ref__, GetLength());
 }
 
 
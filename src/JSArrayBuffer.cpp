@@ -0,0 +1,61 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSArrayBuffer.hpp"
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+
+#include "HAL/JSValue.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <memory>
+
+namespace HAL {
+  
+  JSArrayBuffer::JSArrayBuffer(const JSContext& js_context, JSObjectRef js_object_ref)
+  : JSObject(js_context, js_object_ref) {
+    JSValueRef exception { nullptr };
+    if (JSValueGetTypedArrayType(static_cast<JSContextRef>(js_context), js_object_ref, &exception) != kJSTypedArrayTypeArrayBuffer) {
+      detail::ThrowRuntimeError("JSArrayBuffer", "This JavaScript object is not an ArrayBuffer.");
+    }
+  }
+  
+  void* JSArrayBuffer::GetBytesPtr() const {
+    JSValueRef exception { nullptr };
+    const auto bytes = JSObjectGetArrayBufferBytesPtr(static_cast<JSContextRef>(js_context__), js_object_ref__, &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSArrayBuffer", JSValue(js_context__, exception));
+    }
+    
+    return bytes;
+  }
+  
+  std::size_t JSArrayBuffer::GetByteLength() const {
+    JSValueRef exception { nullptr };
+    const auto byte_length = JSObjectGetArrayBufferByteLength(static_cast<JSContextRef>(js_context__), js_object_ref__, &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSArrayBuffer", JSValue(js_context__, exception));
+    }
+    
+    return byte_length;
+  }
+  
+} // namespace HAL {
+
+namespace HAL { namespace detail {
+  
+  void DeallocateBytes(void* bytes, void* deallocator_context) {
+    std::unique_ptr<JSBytesDeallocator> deallocator(static_cast<JSBytesDeallocator*>(deallocator_context));
+    if (deallocator && *deallocator) {
+      (*deallocator)(bytes);
+    }
+  }
+  
+}} // namespace HAL { namespace detail {
+
+#endif // HAL_TYPED_ARRAY_ENABLE
@@ -0,0 +1,234 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSBundle.hpp"
+
+#include "HAL/detail/JSMappedFile.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+
+namespace HAL {
+
+  // The file is a Header, then header.entry_count Entries sorted by
+  // id, then the UTF-8 ids, then the sources, each starting on an
+  // 8-byte boundary. Offsets are from the start of the file, and a
+  // source's length is in characters.
+  struct JSBundle::Header {
+    char          magic[4];
+    std::uint32_t version;
+    std::uint32_t entry_count;
+    std::uint32_t reserved;
+  };
+
+  struct JSBundle::Entry {
+    std::uint64_t hash;
+    std::uint32_t id_offset;
+    std::uint32_t id_length;
+    std::uint32_t source_offset;
+    std::uint32_t source_length;
+    std::uint32_t encoding;
+    std::uint32_t reserved;
+  };
+
+  namespace {
+
+    const char          kMagic[4] = { 'H', 'A', 'L', 'B' };
+    const std::uint32_t kVersion  = 1;
+
+    enum : std::uint32_t {
+      kEncodingLatin1 = 0,
+      kEncodingUTF16  = 1
+    };
+
+    int CompareId(const char* data, std::uint32_t id_offset, std::uint32_t id_length, const std::string& id) HAL_NOEXCEPT {
+      const auto result = std::memcmp(data + id_offset, id.data(), std::min<std::size_t>(id_length, id.size()));
+      if (result != 0) {
+        return result;
+      }
+      return id_length < id.size() ? -1 : (id_length > id.size() ? 1 : 0);
+    }
+
+    std::uint64_t Align(std::uint64_t offset) HAL_NOEXCEPT {
+      return (offset + 7) & ~static_cast<std::uint64_t>(7);
+    }
+
+  } // namespace {
+
+  JSBundle::JSBundle(const std::string& path)
+  : file__(std::make_shared<detail::JSMappedFile>(path))
+  , path__(path) {
+    static_assert(sizeof(Header) == 16, "JSBundle::Header must be 16 bytes");
+    static_assert(sizeof(Entry)  == 32, "JSBundle::Entry must be 32 bytes");
+
+    const auto data = file__ -> data();
+    const auto size = static_cast<std::uint64_t>(file__ -> size());
+    if (size < sizeof(Header) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+      detail::ThrowRuntimeError("JSBundle", path + " is not a bundle.");
+    }
+
+    // The mapping is page aligned, so the Header and Entries are
+    // aligned as well.
+    const auto header = reinterpret_cast<const Header*>(data);
+    if (header -> version != kVersion) {
+      detail::ThrowRuntimeError("JSBundle", path + " has an unsupported bundle version.");
+    }
+
+    if (sizeof(Header) + static_cast<std::uint64_t>(header -> entry_count) * sizeof(Entry) > size) {
+      detail::ThrowRuntimeError("JSBundle", path + " has a truncated index.");
+    }
+
+    const auto entries = reinterpret_cast<const Entry*>(data + sizeof(Header));
+    for (std::uint32_t i = 0; i < header -> entry_count; ++i) {
+      const auto& entry = entries[i];
+      const auto source_size = static_cast<std::uint64_t>(entry.source_length) * (entry.encoding == kEncodingUTF16 ? sizeof(JSChar) : 1);
+      if (static_cast<std::uint64_t>(entry.id_offset) + entry.id_length > size ||
+          static_cast<std::uint64_t>(entry.source_offset) + source_size > size ||
+          (entry.encoding != kEncodingLatin1 && entry.encoding != kEncodingUTF16) ||
+          (entry.encoding == kEncodingUTF16 && entry.source_offset % sizeof(JSChar) != 0)) {
+        detail::ThrowRuntimeError("JSBundle", path + " has an invalid index entry.");
+      }
+    }
+
+    entries__     = entries;
+    entry_count__ = header -> entry_count;
+  }
+
+  bool JSBundle::Contains(const std::string& id) const HAL_NOEXCEPT {
+    return Find(id) != nullptr;
+  }
+
+  JSString JSBundle::GetSource(const std::string& id) const {
+    const auto entry = Find(id);
+    if (!entry) {
+      detail::ThrowRuntimeError("JSBundle", "Cannot find module '" + id + "' in " + path__ + ".");
+    }
+
+    const auto source = file__ -> data() + entry -> source_offset;
+    auto js_string = entry -> encoding == kEncodingUTF16
+        ? JSString::FromExternalBuffer(reinterpret_cast<const char16_t*>(source), entry -> source_length)
+        : JSString::FromExternalLatin1Buffer(source, entry -> source_length);
+
+    // Seed the hash of the new string, as JSString::hash_value would
+    // compute it.
+    auto hash_value = static_cast<std::size_t>(entry -> hash);
+    if (hash_value == 0) {
+      hash_value = 1;
+    }
+    js_string.hash_value__.store(hash_value, std::memory_order_relaxed);
+    return js_string;
+  }
+
+  std::vector<std::string> JSBundle::get_ids() const {
+    std::vector<std::string> ids;
+    ids.reserve(entry_count__);
+    for (std::uint32_t i = 0; i < entry_count__; ++i) {
+      ids.emplace_back(file__ -> data() + entries__[i].id_offset, entries__[i].id_length);
+    }
+    return ids;
+  }
+
+  const JSBundle::Entry* JSBundle::Find(const std::string& id) const HAL_NOEXCEPT {
+    const auto data     = file__ -> data();
+    const auto end      = entries__ + entry_count__;
+    const auto position = std::lower_bound(entries__, end, id, [data](const Entry& entry, const std::string& id) {
+      return CompareId(data, entry.id_offset, entry.id_length, id) < 0;
+    });
+    if (position == end || CompareId(data, position -> id_offset, position -> id_length, id) != 0) {
+      return nullptr;
+    }
+    return position;
+  }
+
+  void JSBundle::Write(const std::string& path, const std::vector<std::pair<std::string, std::string>>& modules) {
+    // The map sorts the modules by id, as Find expects.
+    std::map<std::string, std::vector<JSChar>> sources;
+    for (const auto& module : modules) {
+      // UTF-8 never takes more UTF-16 code units than it has bytes.
+      std::vector<JSChar> characters(module.second.size());
+      characters.resize(detail::TranscodeUTF8ToUTF16(module.second.data(), module.second.size(), characters.data()));
+      if (!sources.emplace(module.first, std::move(characters)).second) {
+        detail::ThrowInvalidArgument("JSBundle", "The module '" + module.first + "' is in the bundle twice.");
+      }
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(sources.size());
+    std::uint64_t offset = sizeof(Header) + sources.size() * sizeof(Entry);
+    for (const auto& source : sources) {
+      Entry entry;
+      // The same hash as JSString::hash_value, before truncation.
+      entry.hash          = detail::HashUTF16(source.second.data(), source.second.size());
+      entry.id_offset     = static_cast<std::uint32_t>(offset);
+      entry.id_length     = static_cast<std::uint32_t>(source.first.size());
+      entry.source_length = static_cast<std::uint32_t>(source.second.size());
+      entry.encoding      = std::all_of(source.second.begin(), source.second.end(), [](JSChar character) { return character < 0x100; }) ? kEncodingLatin1 : kEncodingUTF16;
+      entry.reserved      = 0;
+      entries.push_back(entry);
+      offset += source.first.size();
+    }
+
+    for (auto& entry : entries) {
+      offset = Align(offset);
+      entry.source_offset = static_cast<std::uint32_t>(offset);
+      offset += static_cast<std::uint64_t>(entry.source_length) * (entry.encoding == kEncodingUTF16 ? sizeof(JSChar) : 1);
+    }
+
+    if (offset > std::numeric_limits<std::uint32_t>::max()) {
+      detail::ThrowInvalidArgument("JSBundle", "The bundle " + path + " would be larger than 4 GB.");
+    }
+
+    std::ofstream output(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!output.is_open()) {
+      detail::ThrowRuntimeError("JSBundle", "Unable to open " + path);
+    }
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version     = kVersion;
+    header.entry_count = static_cast<std::uint32_t>(entries.size());
+    header.reserved    = 0;
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!entries.empty()) {
+      output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    }
+
+    for (const auto& source : sources) {
+      output.write(source.first.data(), source.first.size());
+    }
+
+    std::uint64_t written = sizeof(Header) + entries.size() * sizeof(Entry);
+    for (const auto& source : sources) {
+      written += source.first.size();
+    }
+
+    const char padding[8] = { 0 };
+    auto entry = entries.begin();
+    for (const auto& source : sources) {
+      output.write(padding, static_cast<std::streamsize>(entry -> source_offset - written));
+      if (entry -> encoding == kEncodingUTF16) {
+        output.write(reinterpret_cast<const char*>(source.second.data()), source.second.size() * sizeof(JSChar));
+      } else {
+        std::vector<char> latin1(source.second.begin(), source.second.end());
+        output.write(latin1.data(), latin1.size());
+      }
+      written = static_cast<std::uint64_t>(entry -> source_offset) + (entry -> encoding == kEncodingUTF16 ? source.second.size() * sizeof(JSChar) : source.second.size());
+      ++entry;
+    }
+
+    if (!output) {
+      detail::ThrowRuntimeError("JSBundle", "Unable to write " + path);
+    }
+  }
+
+} // namespace HAL {
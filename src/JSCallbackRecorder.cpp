@@ -0,0 +1,420 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSCallbackRecorder.hpp"
+
+#include "HAL/JSBoolean.hpp"
+#include "HAL/JSNull.hpp"
+#include "HAL/JSNumber.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSUndefined.hpp"
+#include "HAL/detail/JSCallbackRecordScope.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace HAL {
+
+  std::atomic<bool> JSCallbackRecorder::enabled__ { false };
+
+  namespace {
+
+    // The binary format is the magic and version, the table of the
+    // class and property names, then the records in the order they
+    // began, all little-endian:
+    //
+    //   "HALCBREC" u32:version
+    //   u32:string_count { u16:length bytes }...
+    //   u32:record_count { u32:class u32:property u8:kind u8:argument_count u8:argument_type... u64:begin u64:duration u32:thread_id }...
+    const char          kMagic[]   = "HALCBREC";
+    const std::size_t   kMagicSize = sizeof(kMagic) - 1;
+    const std::uint32_t kVersion   = 1;
+
+    template<typename U>
+    void Write(std::string& output, U value) {
+      for (std::size_t i = 0; i < sizeof(U); ++i) {
+        output.push_back(static_cast<char>(static_cast<std::uint64_t>(value) >> (8 * i) & 0xff));
+      }
+    }
+
+    template<typename U>
+    U Read(const std::string& input, std::size_t& position) {
+      if (input.size() - position < sizeof(U)) {
+        detail::ThrowRuntimeError("JSCallbackRecorder", "The recording is truncated.");
+      }
+      std::uint64_t value = 0;
+      for (std::size_t i = 0; i < sizeof(U); ++i) {
+        value |= static_cast<std::uint64_t>(static_cast<unsigned char>(input[position++])) << (8 * i);
+      }
+      return static_cast<U>(value);
+    }
+
+    JSValue CreateReplayArgument(const JSContext& js_context, JSValue::Type type) {
+      switch (type) {
+        case JSValue::Type::Undefined:
+          return js_context.CreateUndefined();
+        case JSValue::Type::Null:
+          return js_context.CreateNull();
+        case JSValue::Type::Boolean:
+          return js_context.CreateBoolean(false);
+        case JSValue::Type::Number:
+          return js_context.CreateNumber(0.0);
+        case JSValue::Type::String:
+          return js_context.CreateString();
+        case JSValue::Type::Object:
+          return js_context.CreateObject();
+      }
+      return js_context.CreateUndefined();
+    }
+
+  } // namespace {
+
+#ifdef HAL_CALLBACK_RECORD_ENABLE
+  namespace {
+
+    // Like the buffers of JSTrace, only its own thread appends to a
+    // buffer, and it discards the events of an earlier Start itself, so
+    // appending takes no lock. Readers see the events before the
+    // published size.
+    struct RecordBuffer final {
+      explicit RecordBuffer(std::uint32_t thread_id)
+      : thread_id(thread_id)
+      , generation(0)
+      , size(0)
+      , dropped(0)
+      , events(new detail::JSCallbackRecordEvent[JSCallbackRecorder::kBufferCapacity]) {
+      }
+
+      const std::uint32_t                              thread_id;
+      std::atomic<std::uint32_t>                       generation;
+      std::atomic<std::size_t>                         size;
+      std::atomic<std::size_t>                         dropped;
+      std::unique_ptr<detail::JSCallbackRecordEvent[]> events;
+    };
+
+    // Buffers outlive their threads, so that the events of a thread
+    // that has exited are still written.
+    struct RecordRegistry final {
+      std::mutex                                 mutex;
+      std::vector<std::unique_ptr<RecordBuffer>> buffers;
+      std::atomic<std::uint32_t>                 generation { 1 };
+      std::atomic<std::uint64_t>                 start_nanoseconds { 0 };
+    };
+
+    RecordRegistry& GetRecordRegistry() {
+      static RecordRegistry registry;
+      return registry;
+    }
+
+    HAL_THREAD_LOCAL RecordBuffer* record_buffer = nullptr;
+
+    // Call f with each buffer holding events of the current Start.
+    template<typename F>
+    void ForEachRecordBuffer(F&& f) {
+      auto& registry = GetRecordRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      const auto generation = registry.generation.load(std::memory_order_relaxed);
+      for (const auto& buffer : registry.buffers) {
+        if (buffer -> generation.load(std::memory_order_acquire) == generation) {
+          f(*buffer);
+        }
+      }
+    }
+
+  } // namespace {
+
+  namespace detail {
+
+    void AppendCallbackRecordEvent(const JSCallbackRecordEvent& event) HAL_NOEXCEPT {
+      auto& registry = GetRecordRegistry();
+      if (!record_buffer) {
+        try {
+          std::lock_guard<std::mutex> lock(registry.mutex);
+          registry.buffers.emplace_back(new RecordBuffer(static_cast<std::uint32_t>(registry.buffers.size() + 1)));
+          record_buffer = registry.buffers.back().get();
+        } catch (...) {
+          return;
+        }
+      }
+
+      auto& buffer = *record_buffer;
+      const auto generation = registry.generation.load(std::memory_order_relaxed);
+      if (buffer.generation.load(std::memory_order_relaxed) != generation) {
+        const auto old_size = buffer.size.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < old_size; ++i) {
+          if (buffer.events[i].property_name_ref) {
+            JSStringRelease(buffer.events[i].property_name_ref);
+          }
+        }
+        buffer.size.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation.store(generation, std::memory_order_release);
+      }
+
+      const auto size = buffer.size.load(std::memory_order_relaxed);
+      if (size == JSCallbackRecorder::kBufferCapacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      buffer.events[size] = event;
+      if (event.property_name_ref) {
+        JSStringRetain(event.property_name_ref);
+      }
+      buffer.size.store(size + 1, std::memory_order_release);
+    }
+
+  } // namespace detail {
+#endif
+
+  void JSCallbackRecorder::Start() HAL_NOEXCEPT {
+#ifdef HAL_CALLBACK_RECORD_ENABLE
+    auto& registry = GetRecordRegistry();
+    registry.start_nanoseconds.store(detail::GetCallbackRecordNanoseconds(), std::memory_order_relaxed);
+    registry.generation.fetch_add(1, std::memory_order_relaxed);
+#endif
+    enabled__.store(true, std::memory_order_relaxed);
+  }
+
+  void JSCallbackRecorder::Stop() HAL_NOEXCEPT {
+    enabled__.store(false, std::memory_order_relaxed);
+  }
+
+  std::size_t JSCallbackRecorder::get_record_count() HAL_NOEXCEPT {
+    std::size_t count = 0;
+#ifdef HAL_CALLBACK_RECORD_ENABLE
+    ForEachRecordBuffer([&count](const RecordBuffer& buffer) {
+      count += buffer.size.load(std::memory_order_acquire);
+    });
+#endif
+    return count;
+  }
+
+  std::size_t JSCallbackRecorder::get_dropped_record_count() HAL_NOEXCEPT {
+    std::size_t count = 0;
+#ifdef HAL_CALLBACK_RECORD_ENABLE
+    ForEachRecordBuffer([&count](const RecordBuffer& buffer) {
+      count += buffer.dropped.load(std::memory_order_relaxed);
+    });
+#endif
+    return count;
+  }
+
+  std::string JSCallbackRecorder::ToBinary() {
+    std::vector<std::string> strings;
+    std::string              records;
+    std::uint32_t            record_count = 0;
+#ifdef HAL_CALLBACK_RECORD_ENABLE
+    struct Entry {
+      const detail::JSCallbackRecordEvent* event;
+      std::uint32_t                        thread_id;
+    };
+    std::vector<Entry> entries;
+    ForEachRecordBuffer([&entries](const RecordBuffer& buffer) {
+      const auto size = buffer.size.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < size; ++i) {
+        entries.push_back({ &buffer.events[i], buffer.thread_id });
+      }
+    });
+
+    // Events are appended as their callbacks return, so the ones that
+    // nest come before the ones they nest in.
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+      return lhs.event -> begin_nanoseconds < rhs.event -> begin_nanoseconds;
+    });
+
+    std::unordered_map<std::string, std::uint32_t> string_indexes;
+    const auto intern = [&](const std::string& string) {
+      const auto position = string_indexes.emplace(string, static_cast<std::uint32_t>(strings.size()));
+      if (position.second) {
+        strings.push_back(string.substr(0, 0xffff));
+      }
+      return position.first -> second;
+    };
+
+    const auto start_nanoseconds = GetRecordRegistry().start_nanoseconds.load(std::memory_order_relaxed);
+    for (const auto& entry : entries) {
+      const auto& event = *entry.event;
+      std::string property_name;
+      if (event.property_name) {
+        property_name = event.property_name;
+      } else if (event.property_name_ref) {
+        property_name = static_cast<std::string>(JSString(event.property_name_ref));
+      }
+
+      Write<std::uint32_t>(records, intern(event.class_name ? event.class_name : ""));
+      Write<std::uint32_t>(records, intern(property_name));
+      Write<std::uint8_t>(records, event.kind);
+      Write<std::uint8_t>(records, event.argument_count);
+      for (std::uint8_t i = 0; i < event.argument_count; ++i) {
+        Write<std::uint8_t>(records, event.argument_types[i]);
+      }
+      Write<std::uint64_t>(records, event.begin_nanoseconds > start_nanoseconds ? event.begin_nanoseconds - start_nanoseconds : 0);
+      Write<std::uint64_t>(records, event.duration_nanoseconds);
+      Write<std::uint32_t>(records, entry.thread_id);
+      ++record_count;
+    }
+#endif
+
+    std::string output(kMagic, kMagicSize);
+    Write<std::uint32_t>(output, kVersion);
+    Write<std::uint32_t>(output, static_cast<std::uint32_t>(strings.size()));
+    for (const auto& string : strings) {
+      Write<std::uint16_t>(output, static_cast<std::uint16_t>(string.size()));
+      output += string;
+    }
+    Write<std::uint32_t>(output, record_count);
+    output += records;
+    return output;
+  }
+
+  void JSCallbackRecorder::WriteBinary(const std::string& path) {
+    std::ofstream ofstream(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    ofstream << ToBinary();
+    ofstream.close();
+    if (!ofstream) {
+      detail::ThrowRuntimeError("JSCallbackRecorder", "Unable to write the recording to " + path);
+    }
+  }
+
+  std::vector<JSCallbackRecord> JSCallbackRecorder::ParseBinary(const std::string& recording) {
+    if (recording.compare(0, kMagicSize, kMagic) != 0) {
+      detail::ThrowRuntimeError("JSCallbackRecorder", "This is not a callback recording.");
+    }
+    std::size_t position = kMagicSize;
+    const auto version = Read<std::uint32_t>(recording, position);
+    if (version != kVersion) {
+      detail::ThrowRuntimeError("JSCallbackRecorder", "Unsupported callback recording version " + std::to_string(version));
+    }
+
+    std::vector<std::string> strings(Read<std::uint32_t>(recording, position));
+    for (auto& string : strings) {
+      const auto length = Read<std::uint16_t>(recording, position);
+      if (recording.size() - position < length) {
+        detail::ThrowRuntimeError("JSCallbackRecorder", "The recording is truncated.");
+      }
+      string.assign(recording, position, length);
+      position += length;
+    }
+
+    const auto get_string = [&strings](std::uint32_t index) -> const std::string& {
+      if (index >= strings.size()) {
+        detail::ThrowRuntimeError("JSCallbackRecorder", "The recording has a bad string index.");
+      }
+      return strings[index];
+    };
+
+    const auto record_count = Read<std::uint32_t>(recording, position);
+    std::vector<JSCallbackRecord> records;
+    for (std::uint32_t i = 0; i < record_count; ++i) {
+      JSCallbackRecord record;
+      record.class_name    = get_string(Read<std::uint32_t>(recording, position));
+      record.property_name = get_string(Read<std::uint32_t>(recording, position));
+      const auto kind      = Read<std::uint8_t>(recording, position);
+      if (kind > static_cast<std::uint8_t>(JSCallbackRecordKind::ConvertToType)) {
+        detail::ThrowRuntimeError("JSCallbackRecorder", "The recording has a bad callback kind.");
+      }
+      record.kind = static_cast<JSCallbackRecordKind>(kind);
+
+      const auto argument_count = Read<std::uint8_t>(recording, position);
+      for (std::uint8_t j = 0; j < argument_count; ++j) {
+        // Types JSValue::Type doesn't have, like symbols, are replayed
+        // as undefined.
+        const auto type = Read<std::uint8_t>(recording, position);
+        record.argument_types.push_back(type <= static_cast<std::uint8_t>(JSValue::Type::Object) ? static_cast<JSValue::Type>(type) : JSValue::Type::Undefined);
+      }
+      record.begin_nanoseconds    = Read<std::uint64_t>(recording, position);
+      record.duration_nanoseconds = Read<std::uint64_t>(recording, position);
+      record.thread_id            = Read<std::uint32_t>(recording, position);
+      records.push_back(std::move(record));
+    }
+    return records;
+  }
+
+  std::vector<std::uint64_t> JSCallbackRecorder::Replay(const JSContext& js_context, const std::vector<JSCallbackRecord>& records) {
+    return Replay(js_context, records, [](const JSContext& js_context, const std::string& class_name) -> JSValue {
+      return js_context.get_global_object().GetProperty(class_name);
+    });
+  }
+
+  std::vector<std::uint64_t> JSCallbackRecorder::Replay(const JSContext& js_context, const std::vector<JSCallbackRecord>& records, const JSCallbackReplayObjectFactory& get_object) {
+    std::vector<std::uint64_t> durations;
+    durations.reserve(records.size());
+
+    std::unordered_map<std::string, JSValue> objects;
+    for (const auto& record : records) {
+      auto position = objects.find(record.class_name);
+      if (position == objects.end()) {
+        position = objects.emplace(record.class_name, get_object(js_context, record.class_name)).first;
+      }
+      if (!position -> second.IsObject()) {
+        durations.push_back(0);
+        continue;
+      }
+      auto js_object = static_cast<JSObject>(position -> second);
+
+      std::vector<JSValue> arguments;
+      arguments.reserve(record.argument_types.size());
+      for (const auto type : record.argument_types) {
+        arguments.push_back(CreateReplayArgument(js_context, type));
+      }
+
+      // The function of CallNamedFunction is looked up before the
+      // clock starts, so that only its call is timed.
+      JSValue function = js_context.CreateUndefined();
+      if (record.kind == JSCallbackRecordKind::CallNamedFunction) {
+        try {
+          function = js_object.GetProperty(record.property_name);
+        } catch (...) {
+        }
+        if (!function.IsObject()) {
+          durations.push_back(0);
+          continue;
+        }
+      }
+
+      const auto begin = std::chrono::steady_clock::now();
+      try {
+        switch (record.kind) {
+          case JSCallbackRecordKind::GetNamedValueProperty:
+            js_object.GetProperty(record.property_name);
+            break;
+          case JSCallbackRecordKind::SetNamedValueProperty:
+            js_object.SetProperty(record.property_name, arguments.empty() ? js_context.CreateUndefined() : arguments[0]);
+            break;
+          case JSCallbackRecordKind::CallNamedFunction:
+            static_cast<JSObject>(function)(arguments, js_object);
+            break;
+          case JSCallbackRecordKind::CallAsFunction:
+            js_object(arguments, js_context.get_global_object());
+            break;
+          case JSCallbackRecordKind::CallAsConstructor:
+            js_object.CallAsConstructor(arguments);
+            break;
+          case JSCallbackRecordKind::ConvertToType:
+            if (!record.argument_types.empty() && record.argument_types[0] == JSValue::Type::String) {
+              static_cast<std::string>(position -> second);
+            } else {
+              static_cast<double>(position -> second);
+            }
+            break;
+        }
+      } catch (...) {
+      }
+      durations.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()));
+    }
+    return durations;
+  }
+
+} // namespace HAL {
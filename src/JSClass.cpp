@@ -9,6 +9,7 @@
 #include "HAL/JSClass.hpp"
 #include "HAL/detail/JSStaticValue.hpp"
 #include "HAL/detail/JSStaticFunction.hpp"
+#include "HAL/detail/JSUtil.hpp"
 
 #include <string>
 #include <algorithm>
@@ -17,14 +18,14 @@ namespace HAL {
   
   JSClass::JSClass() HAL_NOEXCEPT
   : name__("Empty")
-  , js_class_ref__(JSClassCreate(&kJSClassDefinitionEmpty)) {
+  , js_class_ref__(detail::CreateJSClass(&kJSClassDefinitionEmpty)) {
     HAL_LOG_TRACE("JSClass:: ctor ", this);
     HAL_LOG_TRACE("JSClass:: retain ", js_class_ref__, " (implicit) for ", this);
   }
   
   JSClass::JSClass(const JSClassDefinition& js_class_definition) HAL_NOEXCEPT
   : name__(js_class_definition.name__)
-  , js_class_ref__(JSClassCreate(&js_class_definition.js_class_definition__)) {
+  , js_class_ref__(detail::CreateJSClass(&js_class_definition.js_class_definition__)) {
     HAL_LOG_TRACE("JSClass:: ctor ", this);
     HAL_LOG_TRACE("JSClass:: retain ", js_class_ref__, " for ", this);
   }
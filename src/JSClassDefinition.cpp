@@ -126,7 +126,7 @@ namespace HAL {
                        static_value.name        = js_value_property.get_name().c_str();
                        static_value.getProperty = js_value_property.get_callback();
                        static_value.setProperty = js_value_property.set_callback();
-                       static_value.attributes  = detail::ToJSPropertyAttributes(js_value_property.get_attributes());
+                       static_value.attributes  = detail::ToJSPropertyAttributes(js_value_property.get_attribute_set());
                        return static_value;
                      });
       
@@ -145,7 +145,7 @@ namespace HAL {
                        ::JSStaticFunction static_function;
                        static_function.name           = js_function_property.get_name().c_str();
                        static_function.callAsFunction = js_function_property.function_callback();
-                       static_function.attributes     = detail::ToJSPropertyAttributes(js_function_property.get_attributes());
+                       static_function.attributes     = detail::ToJSPropertyAttributes(js_function_property.get_attribute_set());
                        return static_function;
                      });
       
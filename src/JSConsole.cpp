@@ -0,0 +1,401 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSConsole.hpp"
+
+#include "HAL/JSString.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+
+  const char* to_string(JSConsoleLevel level) HAL_NOEXCEPT {
+    switch (level) {
+      case JSConsoleLevel::Debug: return "debug";
+      case JSConsoleLevel::Log:   return "log";
+      case JSConsoleLevel::Info:  return "info";
+      case JSConsoleLevel::Warn:  return "warn";
+      case JSConsoleLevel::Error: return "error";
+      case JSConsoleLevel::Off:   return "off";
+    }
+    return "unknown";
+  }
+
+  struct JSConsole::State final {
+
+    // An argument as it was captured on the JavaScript thread. Objects
+    // are already strings.
+    struct Argument {
+      enum class Kind : std::uint8_t {
+        Undefined,
+        Null,
+        Boolean,
+        Number,
+        String
+      };
+
+      Kind     kind;
+      double   number;
+      JSString string;
+    };
+
+    struct Record {
+      JSConsoleLevel        level;
+      std::vector<Argument> arguments;
+    };
+
+    State(JSConsoleSink sink, std::size_t capacity)
+    : sink(std::move(sink))
+    , capacity(capacity)
+    , threshold(std::make_shared<std::atomic<std::uint8_t>>(static_cast<std::uint8_t>(JSConsoleLevel::Log))) {
+      thread = std::thread(&State::Run, this);
+    }
+
+    ~State() HAL_NOEXCEPT {
+      // The installed functions reject everything from now on.
+      threshold -> store(static_cast<std::uint8_t>(JSConsoleLevel::Off), std::memory_order_relaxed);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+      }
+      condition.notify_one();
+      thread.join();
+    }
+
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+
+    void Push(Record&& record) {
+      bool was_empty = false;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.size() >= capacity) {
+          dropped_count.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+        was_empty = pending.empty();
+        pending.push_back(std::move(record));
+        ++queued_count;
+      }
+
+      // The thread is only waiting when nothing was pending.
+      if (was_empty) {
+        condition.notify_one();
+      }
+    }
+
+    void Flush() {
+      std::unique_lock<std::mutex> lock(mutex);
+      const auto target = queued_count;
+      flushed.wait(lock, [this, target] { return written_count >= target; });
+    }
+
+    void Run() {
+      std::vector<Record> records;
+      std::uint64_t reported_dropped_count = 0;
+      std::unique_lock<std::mutex> lock(mutex);
+      for (;;) {
+        condition.wait(lock, [this] { return stopped || !pending.empty(); });
+        records.swap(pending);
+        lock.unlock();
+
+        for (const auto& record : records) {
+          Write(record.level, Format(record));
+        }
+
+        const auto dropped = dropped_count.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped_count) {
+          Write(JSConsoleLevel::Warn, "JSConsole: dropped " + std::to_string(dropped - reported_dropped_count) + " messages");
+          reported_dropped_count = dropped;
+        }
+
+        const auto count = records.size();
+        records.clear();
+
+        lock.lock();
+        written_count += count;
+        flushed.notify_all();
+        if (stopped && pending.empty()) {
+          return;
+        }
+      }
+    }
+
+    // Format a number as String(number) would, following the
+    // Number::toString steps of ECMAScript: the shortest digits that
+    // read back as the number, written out in full up to 21 integer
+    // digits or 6 leading zeros, and in exponential notation beyond.
+    static std::string FormatNumber(double number) {
+      if (std::isnan(number)) {
+        return "NaN";
+      }
+      if (number == 0) {
+        return "0";
+      }
+      if (number < 0) {
+        return "-" + FormatNumber(-number);
+      }
+      if (std::isinf(number)) {
+        return "Infinity";
+      }
+
+      // The shortest precision that reads back as the same number, as
+      // d.ddde[+-]x.
+      char buffer[32];
+      for (int precision = 0; precision <= 16; ++precision) {
+        std::snprintf(buffer, sizeof(buffer), "%.*e", precision, number);
+        if (std::strtod(buffer, nullptr) == number) {
+          break;
+        }
+      }
+
+      // Split it into the digits and n, the position of the decimal
+      // point relative to them.
+      const char* const exponent = std::strchr(buffer, 'e');
+      std::string digits(static_cast<const char*>(buffer), exponent);
+      if (digits.size() > 1) {
+        digits.erase(1, 1);
+      }
+      while (digits.size() > 1 && digits.back() == '0') {
+        digits.pop_back();
+      }
+      const int k = static_cast<int>(digits.size());
+      const int n = std::atoi(exponent + 1) + 1;
+
+      if (k <= n && n <= 21) {
+        return digits + std::string(n - k, '0');
+      }
+      if (0 < n && n <= 21) {
+        return digits.substr(0, n) + '.' + digits.substr(n);
+      }
+      if (-6 < n && n <= 0) {
+        return "0." + std::string(-n, '0') + digits;
+      }
+
+      std::string result = digits.substr(0, 1);
+      if (k > 1) {
+        result += '.' + digits.substr(1);
+      }
+      return result + (n - 1 < 0 ? "e-" : "e+") + std::to_string(std::abs(n - 1));
+    }
+
+    static std::string Format(const Record& record) {
+      std::string message;
+      for (const auto& argument : record.arguments) {
+        if (!message.empty()) {
+          message += ' ';
+        }
+        switch (argument.kind) {
+          case Argument::Kind::Undefined: message += "undefined";                               break;
+          case Argument::Kind::Null:      message += "null";                                    break;
+          case Argument::Kind::Boolean:   message += argument.number != 0 ? "true" : "false";   break;
+          case Argument::Kind::Number:    message += FormatNumber(argument.number);             break;
+          case Argument::Kind::String:    message += static_cast<std::string>(argument.string); break;
+        }
+      }
+      return message;
+    }
+
+    void Write(JSConsoleLevel level, const std::string& message) HAL_NOEXCEPT {
+      if (!sink) {
+        switch (level) {
+          case JSConsoleLevel::Debug:
+            HAL_LOG_DEBUG("console.debug: ", message);
+            break;
+          case JSConsoleLevel::Log:
+          case JSConsoleLevel::Info:
+            HAL_LOG_INFO("console.", to_string(level), ": ", message);
+            break;
+          case JSConsoleLevel::Warn:
+            HAL_LOG_WARN("console.warn: ", message);
+            break;
+          case JSConsoleLevel::Error:
+          case JSConsoleLevel::Off:
+            HAL_LOG_ERROR("console.error: ", message);
+            break;
+        }
+        return;
+      }
+
+      try {
+        sink(level, message);
+      } catch (const std::exception& e) {
+        HAL_LOG_ERROR("JSConsole: sink threw ", e.what());
+      } catch (...) {
+        HAL_LOG_ERROR("JSConsole: sink threw an unknown exception");
+      }
+    }
+
+    const JSConsoleSink sink;
+    const std::size_t   capacity;
+
+    // Shared with every installed function, so that rejecting a message
+    // costs one load.
+    const std::shared_ptr<std::atomic<std::uint8_t>> threshold;
+
+    std::atomic<std::uint64_t> dropped_count { 0 };
+
+    std::mutex              mutex;
+    std::condition_variable condition;
+    std::condition_variable flushed;
+    std::vector<Record>     pending;
+    std::uint64_t           queued_count  { 0 };
+    std::uint64_t           written_count { 0 };
+    bool                    stopped       { false };
+    std::thread             thread;
+  };
+
+  // The private data of each installed function.
+  struct JSConsole::Binding final {
+    std::weak_ptr<State>                             state;
+    std::shared_ptr<const std::atomic<std::uint8_t>> threshold;
+    JSConsoleLevel                                   level;
+  };
+
+  namespace {
+
+    JSString ToJSString(JSStringRef js_string_ref) {
+      JSString js_string(js_string_ref);
+      JSStringRelease(js_string_ref);
+      return js_string;
+    }
+
+    // Convert an object to a string before the call returns: arrays and
+    // plain objects as JSON, and everything else with toString.
+    JSString Stringify(JSContextRef context_ref, JSValueRef js_value_ref) {
+      JSValueRef exception { nullptr };
+      JSStringRef js_string_ref { nullptr };
+      if (!JSValueIsArray(context_ref, js_value_ref)) {
+        js_string_ref = JSValueToStringCopy(context_ref, js_value_ref, &exception);
+        if (exception || !js_string_ref) {
+          return JSString("[object]");
+        }
+        if (!JSStringIsEqualToUTF8CString(js_string_ref, "[object Object]")) {
+          return ToJSString(js_string_ref);
+        }
+      }
+
+      // JSON fails for cycles, in which case the toString is kept.
+      exception = nullptr;
+      const auto json_ref = JSValueCreateJSONString(context_ref, js_value_ref, 0, &exception);
+      if (exception || !json_ref) {
+        return js_string_ref ? ToJSString(js_string_ref) : JSString("[object Array]");
+      }
+      if (js_string_ref) {
+        JSStringRelease(js_string_ref);
+      }
+      return ToJSString(json_ref);
+    }
+
+  } // namespace {
+
+  JSConsole::JSConsole(JSConsoleSink sink, std::size_t capacity)
+  : state__(std::make_shared<State>(std::move(sink), capacity)) {
+  }
+
+  JSObject JSConsole::Install(const JSContext& js_context) const {
+    auto console = js_context.CreateObject();
+    for (const auto level : { JSConsoleLevel::Debug, JSConsoleLevel::Log, JSConsoleLevel::Info, JSConsoleLevel::Warn, JSConsoleLevel::Error }) {
+      const auto function_ref = JSObjectMake(static_cast<JSContextRef>(js_context), GetFunctionClass(), new Binding { state__, state__ -> threshold, level });
+      console.SetProperty(JSString(to_string(level)), JSObject(js_context, function_ref));
+    }
+
+    js_context.get_global_object().SetProperty("console", console);
+    return console;
+  }
+
+  void JSConsole::set_level(JSConsoleLevel level) HAL_NOEXCEPT {
+    state__ -> threshold -> store(static_cast<std::uint8_t>(level), std::memory_order_relaxed);
+  }
+
+  JSConsoleLevel JSConsole::get_level() const HAL_NOEXCEPT {
+    return static_cast<JSConsoleLevel>(state__ -> threshold -> load(std::memory_order_relaxed));
+  }
+
+  void JSConsole::Flush() const {
+    state__ -> Flush();
+  }
+
+  std::uint64_t JSConsole::get_dropped_count() const HAL_NOEXCEPT {
+    return state__ -> dropped_count.load(std::memory_order_relaxed);
+  }
+
+  JSValueRef JSConsole::CallFunction(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef, size_t argument_count, const JSValueRef arguments_array[], JSValueRef*) {
+    const auto binding = static_cast<Binding*>(JSObjectGetPrivate(function_ref));
+    if (static_cast<std::uint8_t>(binding -> level) < binding -> threshold -> load(std::memory_order_relaxed)) {
+      return JSValueMakeUndefined(context_ref);
+    }
+
+    try {
+      const auto state = binding -> state.lock();
+      if (!state) {
+        return JSValueMakeUndefined(context_ref);
+      }
+
+      State::Record record { binding -> level, std::vector<State::Argument>() };
+      record.arguments.reserve(argument_count);
+      for (size_t i = 0; i < argument_count; ++i) {
+        const auto js_value_ref = arguments_array[i];
+        switch (JSValueGetType(context_ref, js_value_ref)) {
+          case kJSTypeUndefined:
+            record.arguments.push_back({ State::Argument::Kind::Undefined, 0, JSString() });
+            break;
+          case kJSTypeNull:
+            record.arguments.push_back({ State::Argument::Kind::Null, 0, JSString() });
+            break;
+          case kJSTypeBoolean:
+            record.arguments.push_back({ State::Argument::Kind::Boolean, JSValueToBoolean(context_ref, js_value_ref) ? 1.0 : 0.0, JSString() });
+            break;
+          case kJSTypeNumber:
+            record.arguments.push_back({ State::Argument::Kind::Number, JSValueToNumber(context_ref, js_value_ref, nullptr), JSString() });
+            break;
+          case kJSTypeString:
+            record.arguments.push_back({ State::Argument::Kind::String, 0, ToJSString(JSValueToStringCopy(context_ref, js_value_ref, nullptr)) });
+            break;
+          default:
+            record.arguments.push_back({ State::Argument::Kind::String, 0, Stringify(context_ref, js_value_ref) });
+            break;
+        }
+      }
+
+      state -> Push(std::move(record));
+    } catch (const std::exception& e) {
+      // Logging must never make a script throw.
+      HAL_LOG_ERROR("JSConsole: ", e.what());
+    }
+
+    return JSValueMakeUndefined(context_ref);
+  }
+
+  void JSConsole::FinalizeFunction(JSObjectRef function_ref) {
+    delete static_cast<Binding*>(JSObjectGetPrivate(function_ref));
+  }
+
+  JSClassRef JSConsole::GetFunctionClass() {
+    static const JSClassRef js_class_ref = [] {
+      auto js_class_definition           = kJSClassDefinitionEmpty;
+      js_class_definition.className      = "JSConsole";
+      js_class_definition.callAsFunction = CallFunction;
+      js_class_definition.finalize       = FinalizeFunction;
+      return detail::CreateJSClass(&js_class_definition);
+    }();
+    return js_class_ref;
+  }
+
+} // namespace HAL {
@@ -0,0 +1,307 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSConstantTable.hpp"
+#include "HAL/JSContext.hpp"
+
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSMappedFile.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+namespace HAL {
+
+  struct JSConstantTable::Table final {
+
+    enum class Type {
+      Null,
+      Boolean,
+      Number,
+      String
+    };
+
+    // A name or string in the text, which isn't null terminated.
+    struct Text {
+      const char* data;
+      std::size_t length;
+
+      bool operator<(const Text& rhs) const HAL_NOEXCEPT {
+        const auto result = std::memcmp(data, rhs.data, std::min(length, rhs.length));
+        return result < 0 || (result == 0 && length < rhs.length);
+      }
+
+      bool operator==(const Text& rhs) const HAL_NOEXCEPT {
+        return length == rhs.length && std::memcmp(data, rhs.data, length) == 0;
+      }
+    };
+
+    struct Constant {
+      Text   name;
+      Type   type;
+      double number;
+      Text   string;
+    };
+
+    void Parse(const char* data, std::size_t size);
+    const Constant* FindName(const Text& name) const HAL_NOEXCEPT;
+    const Constant* Find(JSStringRef property_name_ref) const;
+    JSValueRef ToJSValueRef(JSContextRef context_ref, const Constant& constant) const;
+
+    // Exactly one of these holds the text.
+    std::string                           source;
+    std::shared_ptr<detail::JSMappedFile> file;
+
+    // The constants in text order, and their indexes sorted by name.
+    std::vector<Constant>    constants;
+    std::vector<std::size_t> sorted_indexes;
+  };
+
+  namespace {
+
+    bool IsSpace(char c) HAL_NOEXCEPT {
+      return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    void ThrowParseError(std::size_t line_number, const std::string& message) {
+      std::ostringstream os;
+      os << "line " << line_number << ": " << message;
+      detail::ThrowRuntimeError("JSConstantTable", os.str());
+    }
+
+  } // namespace {
+
+  void JSConstantTable::Table::Parse(const char* data, std::size_t size) {
+    const auto end = data + size;
+    std::size_t line_number = 0;
+    for (auto line = data; line < end;) {
+      ++line_number;
+      auto line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+      if (!line_end) {
+        line_end = end;
+      }
+
+      auto first = line;
+      auto last  = line_end;
+      line = line_end + 1;
+      while (first < last && IsSpace(*first)) {
+        ++first;
+      }
+      while (last > first && IsSpace(*(last - 1))) {
+        --last;
+      }
+      if (first == last || *first == '#') {
+        continue;
+      }
+
+      const auto equals = static_cast<const char*>(std::memchr(first, '=', last - first));
+      if (!equals) {
+        ThrowParseError(line_number, "expected name = value");
+      }
+
+      auto name_last = equals;
+      while (name_last > first && IsSpace(*(name_last - 1))) {
+        --name_last;
+      }
+      auto value_first = equals + 1;
+      while (value_first < last && IsSpace(*value_first)) {
+        ++value_first;
+      }
+      if (name_last == first) {
+        ThrowParseError(line_number, "name is missing");
+      }
+
+      Constant constant { { first, static_cast<std::size_t>(name_last - first) }, Type::Null, 0, { nullptr, 0 } };
+      const std::string value(value_first, last);
+      if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        constant.type   = Type::String;
+        constant.string = { value_first + 1, value.size() - 2 };
+      } else if (value == "true" || value == "false") {
+        constant.type   = Type::Boolean;
+        constant.number = value == "true" ? 1 : 0;
+      } else if (value != "null") {
+        char* number_end = nullptr;
+        constant.type    = Type::Number;
+        constant.number  = std::strtod(value.c_str(), &number_end);
+        if (value.empty() || number_end != value.c_str() + value.size()) {
+          ThrowParseError(line_number, "value of " + std::string(constant.name.data, constant.name.length) + " is not null, a boolean, a number or a string");
+        }
+      }
+
+      constants.push_back(constant);
+    }
+
+    sorted_indexes.resize(constants.size());
+    for (std::size_t i = 0; i < constants.size(); ++i) {
+      sorted_indexes[i] = i;
+    }
+    std::stable_sort(sorted_indexes.begin(), sorted_indexes.end(), [this](std::size_t lhs, std::size_t rhs) {
+      return constants[lhs].name < constants[rhs].name;
+    });
+
+    const auto duplicate = std::adjacent_find(sorted_indexes.begin(), sorted_indexes.end(), [this](std::size_t lhs, std::size_t rhs) {
+      return constants[lhs].name == constants[rhs].name;
+    });
+    if (duplicate != sorted_indexes.end()) {
+      const auto& name = constants[*duplicate].name;
+      detail::ThrowRuntimeError("JSConstantTable", "duplicate constant " + std::string(name.data, name.length));
+    }
+  }
+
+  const JSConstantTable::Table::Constant* JSConstantTable::Table::FindName(const Text& name) const HAL_NOEXCEPT {
+    const auto position = std::lower_bound(sorted_indexes.begin(), sorted_indexes.end(), name, [this](std::size_t index, const Text& name) {
+      return constants[index].name < name;
+    });
+    return position != sorted_indexes.end() && constants[*position].name == name ? &constants[*position] : nullptr;
+  }
+
+  const JSConstantTable::Table::Constant* JSConstantTable::Table::Find(JSStringRef property_name_ref) const {
+    // Property names are almost always short and ASCII, so narrow them
+    // on the stack and only fall back to UTF-8 for the rest.
+    char buffer[64];
+    std::vector<char> long_buffer;
+    const auto length = JSStringGetLength(property_name_ref);
+    Text name { buffer, 0 };
+    if (length <= sizeof(buffer) && detail::NarrowASCII(JSStringGetCharactersPtr(property_name_ref), length, buffer) == length) {
+      name.length = length;
+    } else {
+      long_buffer.resize(JSStringGetMaximumUTF8CStringSize(property_name_ref));
+      name.data   = long_buffer.data();
+      name.length = JSStringGetUTF8CString(property_name_ref, long_buffer.data(), long_buffer.size()) - 1;
+    }
+
+    if (const auto constant = FindName(name)) {
+      return constant;
+    }
+
+    // Otherwise read an array index as the position of a constant.
+    if (name.length == 0 || name.length > 10 || (name.length > 1 && name.data[0] == '0')) {
+      return nullptr;
+    }
+    std::size_t index = 0;
+    for (std::size_t i = 0; i < name.length; ++i) {
+      if (name.data[i] < '0' || name.data[i] > '9') {
+        return nullptr;
+      }
+      index = index * 10 + static_cast<std::size_t>(name.data[i] - '0');
+    }
+    return index < constants.size() ? &constants[index] : nullptr;
+  }
+
+  JSValueRef JSConstantTable::Table::ToJSValueRef(JSContextRef context_ref, const Constant& constant) const {
+    switch (constant.type) {
+      case Type::Null:
+        return JSValueMakeNull(context_ref);
+      case Type::Boolean:
+        return JSValueMakeBoolean(context_ref, constant.number != 0);
+      case Type::Number:
+        return JSValueMakeNumber(context_ref, constant.number);
+      case Type::String:
+        break;
+    }
+
+    // UTF-8 never takes more UTF-16 code units than it has bytes.
+    std::vector<JSChar> characters(constant.string.length > 0 ? constant.string.length : 1);
+    const auto characters_length = detail::TranscodeUTF8ToUTF16(constant.string.data, constant.string.length, characters.data());
+    const auto js_string_ref     = detail::CreateJSStringWithCharacters(characters.data(), characters_length);
+    const auto js_value_ref      = JSValueMakeString(context_ref, js_string_ref);
+    JSStringRelease(js_string_ref);
+    return js_value_ref;
+  }
+
+  JSConstantTable JSConstantTable::Load(const std::string& path) {
+    const auto table = std::make_shared<Table>();
+    table -> file = std::make_shared<detail::JSMappedFile>(path);
+    table -> Parse(table -> file -> data(), table -> file -> size());
+    return JSConstantTable(table);
+  }
+
+  JSConstantTable::JSConstantTable(std::string source) {
+    const auto table = std::make_shared<Table>();
+    table -> source = std::move(source);
+    table -> Parse(table -> source.data(), table -> source.size());
+    table__ = table;
+  }
+
+  JSConstantTable::JSConstantTable(std::shared_ptr<const Table> table) HAL_NOEXCEPT
+  : table__(std::move(table)) {
+  }
+
+  std::size_t JSConstantTable::size() const HAL_NOEXCEPT {
+    return table__ -> constants.size();
+  }
+
+  bool JSConstantTable::HasConstant(const std::string& name) const HAL_NOEXCEPT {
+    return table__ -> FindName({ name.data(), name.size() }) != nullptr;
+  }
+
+  JSObject JSConstantTable::CreateObject(const JSContext& js_context) const {
+    const auto object_ref = JSObjectMake(static_cast<JSContextRef>(js_context), GetTableClass(), new std::shared_ptr<const Table>(table__));
+    return JSObject(js_context, object_ref);
+  }
+
+  bool JSConstantTable::HasProperty(JSContextRef, JSObjectRef object_ref, JSStringRef property_name_ref) {
+    try {
+      const auto& table = *static_cast<std::shared_ptr<const Table>*>(JSObjectGetPrivate(object_ref));
+      return table -> Find(property_name_ref) != nullptr;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  JSValueRef JSConstantTable::GetProperty(JSContextRef context_ref, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef*) {
+    try {
+      const auto& table    = *static_cast<std::shared_ptr<const Table>*>(JSObjectGetPrivate(object_ref));
+      const auto  constant = table -> Find(property_name_ref);
+      return constant ? table -> ToJSValueRef(context_ref, *constant) : nullptr;
+    } catch (...) {
+      return nullptr;
+    }
+  }
+
+  bool JSConstantTable::SetProperty(JSContextRef, JSObjectRef object_ref, JSStringRef property_name_ref, JSValueRef, JSValueRef*) {
+    // Claim writes to constants so they are dropped, like writes to
+    // read-only properties.
+    return HasProperty(nullptr, object_ref, property_name_ref);
+  }
+
+  void JSConstantTable::GetPropertyNames(JSContextRef, JSObjectRef object_ref, JSPropertyNameAccumulatorRef property_names) {
+    const auto& table = *static_cast<std::shared_ptr<const Table>*>(JSObjectGetPrivate(object_ref));
+    for (const auto& constant : table -> constants) {
+      std::vector<JSChar> characters(constant.name.length);
+      const auto characters_length = detail::TranscodeUTF8ToUTF16(constant.name.data, constant.name.length, characters.data());
+      const auto js_string_ref     = detail::CreateJSStringWithCharacters(characters.data(), characters_length);
+      JSPropertyNameAccumulatorAddName(property_names, js_string_ref);
+      JSStringRelease(js_string_ref);
+    }
+  }
+
+  void JSConstantTable::Finalize(JSObjectRef object_ref) {
+    delete static_cast<std::shared_ptr<const Table>*>(JSObjectGetPrivate(object_ref));
+  }
+
+  JSClassRef JSConstantTable::GetTableClass() {
+    static const JSClassRef js_class_ref = [] {
+      auto js_class_definition             = kJSClassDefinitionEmpty;
+      js_class_definition.className        = "JSConstantTable";
+      js_class_definition.hasProperty      = HasProperty;
+      js_class_definition.getProperty      = GetProperty;
+      js_class_definition.setProperty      = SetProperty;
+      js_class_definition.getPropertyNames = GetPropertyNames;
+      js_class_definition.finalize         = Finalize;
+      return detail::CreateJSClass(&js_class_definition);
+    }();
+    return js_class_ref;
+  }
+
+} // namespace HAL {
@@ -19,35 +19,204 @@
 
 #include "HAL/JSObject.hpp"
 #include "HAL/JSArray.hpp"
+#include "HAL/JSArrayBuffer.hpp"
+#include "HAL/JSPreparedValue.hpp"
 #include "HAL/JSDate.hpp"
 #include "HAL/JSError.hpp"
 #include "HAL/JSFunction.hpp"
 #include "HAL/JSRegExp.hpp"
+#include "HAL/JSScript.hpp"
 
 #include "HAL/detail/JSUtil.hpp"
+#include "HAL/detail/JSAPIStatistics.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSCPUTimeScope.hpp"
+#include "HAL/detail/JSFunctionCache.hpp"
+#include "HAL/detail/JSJSONStreamParser.hpp"
+#include "HAL/detail/JSRegExpCache.hpp"
+#include "HAL/detail/JSMappedFile.hpp"
+#include "HAL/detail/JSQuotaState.hpp"
+#include "HAL/detail/JSSerializedValue.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+#include "HAL/detail/JSTraceScope.hpp"
+#include "HAL/detail/JSValueCloner.hpp"
+#include "HAL/detail/JSValueRetainRegistry.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
 
 namespace HAL {
   
   JSObject JSContext::get_global_object() const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSObject(JSContext(js_global_context_ref__), JSContextGetGlobalObject(js_global_context_ref__));
+    return JSObject(*this, JSContextGetGlobalObject(js_global_context_ref__));
   }
   
   JSValue JSContext::CreateValueFromJSON(const JSString& js_string) const {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSValue(JSContext(js_global_context_ref__), js_string, true);
+    return JSValue(*this, js_string, true);
+  }
+  
+  JSValue JSContext::AdoptJSON(const JSPreparedJSON& prepared) const {
+    return CreateValueFromJSON(prepared.get_text());
+  }
+  
+  namespace {
+    
+    void ThrowJSONError(std::size_t offset) {
+      std::ostringstream message;
+      message << "Input is not valid JSON";
+      if (offset != std::string::npos) {
+        message << " at offset " << offset;
+      }
+      detail::ThrowRuntimeError("JSContext", message.str());
+    }
+    
+  } // namespace {
+  
+  JSValue JSContext::CreateValueFromJSON(const char* data, std::size_t length) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    
+    // UTF-8 never takes more UTF-16 code units than it has bytes, and
+    // the buffer is released as soon as JavaScriptCore has copied it.
+    JSStringRef js_string_ref = nullptr;
+    {
+      std::unique_ptr<JSChar[]> characters(new JSChar[length > 0 ? length : 1]);
+      const auto characters_length = detail::TranscodeUTF8ToUTF16(data, length, characters.get());
+      js_string_ref = detail::CreateJSStringWithCharacters(characters.get(), characters_length);
+    }
+    
+    const auto js_value_ref = JSValueMakeFromJSONString(static_cast<JSContextRef>(*this), js_string_ref);
+    JSStringRelease(js_string_ref);
+    if (!js_value_ref) {
+      ThrowJSONError(detail::FindJSONErrorOffset(data, length));
+    }
+    
+    return JSValue(*this, js_value_ref);
+  }
+  
+  JSValue JSContext::CreateValueFromJSON(const JSChar* data, std::size_t length) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    const auto js_string_ref = detail::CreateJSStringWithCharacters(data, length);
+    const auto js_value_ref  = JSValueMakeFromJSONString(static_cast<JSContextRef>(*this), js_string_ref);
+    JSStringRelease(js_string_ref);
+    if (!js_value_ref) {
+      ThrowJSONError(detail::FindJSONErrorOffset(data, length));
+    }
+    
+    return JSValue(*this, js_value_ref);
+  }
+  
+  JSValue JSContext::CreateValueFromJSONFile(const std::string& path) const {
+    const detail::JSMappedFile file(path);
+    return CreateValueFromJSON(file.data(), file.size());
+  }
+  
+  void JSContext::ParseJSONStream(const char* data, std::size_t length, const std::vector<std::string>& selectors, const std::function<void(const std::string& path, const JSValue& js_value)>& handler) const {
+    const detail::JSJSONStreamParser parser(selectors);
+    const auto error_offset = parser.Parse(data, length, [this, data, &handler](const std::string& path, std::size_t begin, std::size_t end) {
+      handler(path, CreateValueFromJSON(data + begin, end - begin));
+    });
+    if (error_offset != std::string::npos) {
+      ThrowJSONError(error_offset);
+    }
+  }
+  
+  void JSContext::ParseJSONStream(const JSChar* data, std::size_t length, const std::vector<std::string>& selectors, const std::function<void(const std::string& path, const JSValue& js_value)>& handler) const {
+    const detail::JSJSONStreamParser parser(selectors);
+    const auto error_offset = parser.Parse(data, length, [this, data, &handler](const std::string& path, std::size_t begin, std::size_t end) {
+      handler(path, CreateValueFromJSON(data + begin, end - begin));
+    });
+    if (error_offset != std::string::npos) {
+      ThrowJSONError(error_offset);
+    }
+  }
+  
+  JSValue JSContext::Clone(const JSValue& js_value, const JSContext& target, bool share_array_buffers) {
+    const auto source = js_value.get_context();
+    detail::JSValueCloneTarget clone_target(static_cast<JSContextRef>(source), static_cast<JSContextRef>(target), share_array_buffers);
+    detail::JSValueCloner      cloner(static_cast<JSContextRef>(source), clone_target, "JSContext");
+    return JSValue(target, clone_target.ToJSValueRef(cloner.Clone(static_cast<JSValueRef>(js_value))));
+  }
+  
+  void JSContext::SaveState(const std::vector<std::string>& roots, const std::string& path) const {
+    // The roots are serialized as the properties of one object, so
+    // that objects they share stay shared once restored.
+    const auto global_object = get_global_object();
+    auto state = CreateObject();
+    for (const auto& root : roots) {
+      if (!global_object.HasProperty(root)) {
+        detail::ThrowInvalidArgument("JSContext", "The global object has no property " + root + ".");
+      }
+      state.SetProperty(root, global_object.GetProperty(root));
+    }
+    
+    const detail::JSSerializedValue serialized_state(static_cast<JSContextRef>(*this), static_cast<JSObjectRef>(state), std::vector<JSObjectRef>());
+    std::string bytes;
+    serialized_state.WriteTo(bytes);
+    
+    // Written beside the file and renamed over it, so that a process
+    // killed while saving leaves the previous state intact.
+    const auto temporary_path = path + ".tmp";
+    {
+      std::ofstream output(temporary_path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+      output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+      output.close();
+      if (output.fail()) {
+        std::remove(temporary_path.c_str());
+        detail::ThrowRuntimeError("JSContext", "Unable to write " + temporary_path);
+      }
+    }
+#ifdef _WIN32
+    // rename doesn't replace an existing file on Windows.
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+      std::remove(temporary_path.c_str());
+      detail::ThrowRuntimeError("JSContext", "Unable to replace " + path);
+    }
+  }
+  
+  bool JSContext::RestoreState(const std::string& path) const {
+    if (!std::ifstream(path)) {
+      return false;
+    }
+    
+    const detail::JSMappedFile file(path);
+    const detail::JSSerializedValue serialized_state(file.data(), file.size());
+    const auto state = JSValue(*this, serialized_state.Deserialize(static_cast<JSContextRef>(*this)));
+    if (!state.IsObject()) {
+      detail::ThrowRuntimeError("JSContext", path + " isn't a saved state.");
+    }
+    
+    const auto state_object = static_cast<JSObject>(state);
+    auto global_object = get_global_object();
+    for (const auto& property_name : static_cast<std::vector<JSString>>(state_object.GetPropertyNames())) {
+      global_object.SetProperty(property_name, state_object.GetProperty(property_name));
+    }
+    return true;
   }
   
   JSValue JSContext::CreateString() const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSValue(JSContext(js_global_context_ref__), JSString(), false);
+    return JSValue(*this, JSString(), false);
   }
   
   JSValue JSContext::CreateString(const JSString& js_string) const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSValue(JSContext(js_global_context_ref__), js_string, false);
+    return JSValue(*this, js_string, false);
+  }
+  
+  JSValue JSContext::AdoptString(const JSPreparedString& prepared) const HAL_NOEXCEPT {
+    return CreateString(prepared.get_string());
   }
   
   JSValue JSContext::CreateString(const char* string) const HAL_NOEXCEPT {
@@ -58,42 +227,40 @@ namespace HAL {
     return CreateString(JSString(string));
   }
   
+  // The immediate values are made once for each context and never
+  // change.
   JSUndefined JSContext::CreateUndefined() const HAL_NOEXCEPT {
-    HAL_JSCONTEXT_LOCK_GUARD;
-    return JSUndefined(JSContext(js_global_context_ref__));
+    return JSUndefined(*this, get_undefined_ref());
   }
   
   JSNull JSContext::CreateNull() const HAL_NOEXCEPT {
-    HAL_JSCONTEXT_LOCK_GUARD;
-    return JSNull(JSContext(js_global_context_ref__));
+    return JSNull(*this, get_null_ref());
   }
 	
   JSValue JSContext::CreateNativeNull() const HAL_NOEXCEPT {
-    HAL_JSCONTEXT_LOCK_GUARD;
     // Use JSNull to represent native nullptr
-    auto value = JSNull(JSContext(js_global_context_ref__));
+    auto value = CreateNull();
     value.MarkAsNativeNull();
     return value;
   }
 	
   JSBoolean JSContext::CreateBoolean(bool boolean) const HAL_NOEXCEPT {
-    HAL_JSCONTEXT_LOCK_GUARD;
-    return JSBoolean(JSContext(js_global_context_ref__), boolean);
+    return JSBoolean(*this, get_boolean_ref(boolean));
   }
   
   JSNumber JSContext::CreateNumber(double number) const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSNumber(JSContext(js_global_context_ref__), number);
+    return JSNumber(*this, number);
   }
   
   JSNumber JSContext::CreateNumber(int32_t number) const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSNumber(JSContext(js_global_context_ref__), number);
+    return JSNumber(*this, number);
   }
   
   JSNumber JSContext::CreateNumber(uint32_t number) const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSNumber(JSContext(js_global_context_ref__), number);
+    return JSNumber(*this, number);
   }
   
   JSObject JSContext::CreateObject() const HAL_NOEXCEPT {
@@ -102,7 +269,7 @@ namespace HAL {
   
   JSObject JSContext::CreateObject(const JSClass& js_class) const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSObject(JSContext(js_global_context_ref__), js_class);
+    return JSObject(*this, js_class);
   }
 
   JSObject JSContext::CreateObject(const std::unordered_map<std::string, JSValue>& properties) const HAL_NOEXCEPT {
@@ -111,8 +278,8 @@ namespace HAL {
 
   JSObject JSContext::CreateObject(const JSClass& js_class, const std::unordered_map<std::string, JSValue>& properties) const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    auto object = CreateObject();
-    for (const auto kv : properties) {
+    auto object = CreateObject(js_class);
+    for (const auto& kv : properties) {
       object.SetProperty(kv.first, kv.second);
     }
     return object;
@@ -121,42 +288,116 @@ namespace HAL {
   
   JSArray JSContext::CreateArray() const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSArray(JSContext(js_global_context_ref__));
+    return JSArray(*this);
   }
   
   JSArray JSContext::CreateArray(const std::vector<JSValue>& arguments) const {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSArray(JSContext(js_global_context_ref__), arguments);
+    return JSArray(*this, arguments);
   }
   
+  JSArray JSContext::CreateArray(const std::vector<double>& elements) const {
+    return CreateArray(elements.begin(), elements.end());
+  }
+  
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  JSArrayBuffer JSContext::CreateArrayBuffer(void* bytes, std::size_t byte_length, JSBytesDeallocator deallocator) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    std::unique_ptr<JSBytesDeallocator> deallocator_ptr(new JSBytesDeallocator(std::move(deallocator)));
+    JSValueRef exception { nullptr };
+    const auto js_object_ref = JSObjectMakeArrayBufferWithBytesNoCopy(static_cast<JSContextRef>(*this), bytes, byte_length, detail::DeallocateBytes, deallocator_ptr.get(), &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSContext", JSValue(*this, exception));
+    }
+    
+    if (!js_object_ref) {
+      detail::ThrowRuntimeError("JSContext", "Unable to create an ArrayBuffer.");
+    }
+    
+    // JavaScriptCore now owns the deallocator.
+    deallocator_ptr.release();
+    return JSArrayBuffer(*this, js_object_ref);
+  }
+#endif
+  
   JSDate JSContext::CreateDate() const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSDate(JSContext(js_global_context_ref__));
+    return JSDate(*this);
   }
   
   JSDate JSContext::CreateDate(const std::vector<JSValue>& arguments) const {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSDate(JSContext(js_global_context_ref__), arguments);
+    return JSDate(*this, arguments);
+  }
+  
+  JSDate JSContext::CreateDate(std::chrono::system_clock::time_point time_point) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch());
+    return JSDate(*this, static_cast<double>(milliseconds.count()));
   }
   
   JSError JSContext::CreateError() const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSError(JSContext(js_global_context_ref__));
+    return JSError(*this);
   }
   
   JSError JSContext::CreateError(const std::vector<JSValue>& arguments) const {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSError(JSContext(js_global_context_ref__), arguments);
+    return JSError(*this, arguments);
   }
   
   JSRegExp JSContext::CreateRegExp() const HAL_NOEXCEPT {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSRegExp(JSContext(js_global_context_ref__));
+    return JSRegExp(*this);
   }
   
   JSRegExp JSContext::CreateRegExp(const std::vector<JSValue>& arguments) const {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSRegExp(JSContext(js_global_context_ref__), arguments);
+    return JSRegExp(*this, arguments);
+  }
+  
+  JSRegExp JSContext::CreateRegExp(const JSString& pattern) const {
+    return CreateRegExp(pattern, JSString());
+  }
+  
+  JSRegExp JSContext::CreateRegExp(const JSString& pattern, const JSString& flags) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    auto& js_regexp_cache = get_js_regexp_cache();
+#ifdef HAL_THREAD_SAFE
+    std::lock_guard<detail::JSRecursiveMutex> lock_cache(js_regexp_cache.get_mutex());
+#endif
+    if (js_regexp_cache.get_capacity() == 0) {
+      return JSRegExp(*this, pattern, flags);
+    }
+    
+    detail::JSRegExpCache::Key key { pattern, flags };
+    if (const auto js_object_ref = js_regexp_cache.Find(key)) {
+      JSRegExp js_regexp(*this, js_object_ref);
+      const auto flags_string = static_cast<std::string>(flags);
+      if (flags_string.find_first_of("gy") != std::string::npos) {
+        js_regexp.SetProperty(detail::JSAtoms::lastIndex, CreateNumber(0));
+      }
+      return js_regexp;
+    }
+    
+    JSRegExp js_regexp(*this, pattern, flags);
+    js_regexp_cache.Insert(std::move(key), static_cast<JSObjectRef>(js_regexp));
+    return js_regexp;
+  }
+  
+  void JSContext::set_regexp_cache_capacity(std::size_t capacity) const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    get_js_regexp_cache().set_capacity(capacity);
+  }
+  
+  std::size_t JSContext::get_regexp_cache_capacity() const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    return get_js_regexp_cache().get_capacity();
+  }
+  
+  void JSContext::ClearRegExpCache() const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    get_js_regexp_cache().Clear();
   }
   
   JSFunction JSContext::CreateFunction(const JSString& body) const {
@@ -173,12 +414,41 @@ namespace HAL {
   
   JSFunction JSContext::CreateFunction(const JSString& body, const std::vector<JSString>& parameter_names, const JSString& function_name, const JSString& source_url, int starting_line_number) const {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSFunction(JSContext(js_global_context_ref__), body, parameter_names, function_name, source_url, starting_line_number);
+    auto& js_function_cache = get_js_function_cache();
+#ifdef HAL_THREAD_SAFE
+    std::lock_guard<detail::JSRecursiveMutex> lock_cache(js_function_cache.get_mutex());
+#endif
+    if (js_function_cache.get_capacity() == 0) {
+      return JSFunction(*this, body, parameter_names, function_name, source_url, starting_line_number);
+    }
+    
+    detail::JSFunctionCache::Key key { body, parameter_names, function_name, source_url, starting_line_number };
+    if (const auto js_object_ref = js_function_cache.Find(key)) {
+      return JSFunction(*this, js_object_ref);
+    }
+    
+    JSFunction js_function(*this, body, parameter_names, function_name, source_url, starting_line_number);
+    js_function_cache.Insert(std::move(key), static_cast<JSObjectRef>(js_function));
+    return js_function;
+  }
+  
+  void JSContext::set_function_cache_capacity(std::size_t capacity) const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    get_js_function_cache().set_capacity(capacity);
+  }
+  
+  std::size_t JSContext::get_function_cache_capacity() const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    return get_js_function_cache().get_capacity();
+  }
+  
+  void JSContext::ClearFunctionCache() const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    get_js_function_cache().Clear();
   }
 
   JSFunction JSContext::CreateFunction() const {
-    JSFunctionCallback noop = [](const std::vector<JSValue>, JSObject& this_object){ return this_object.get_context().CreateUndefined(); };
-    return CreateFunction(noop);
+    return CreateFunction(JSFunctionArgumentsCallback([](const JSArguments&, JSObject& this_object) { return this_object.get_context().CreateUndefined(); }));
   }
 
   JSFunction JSContext::CreateFunction(JSFunctionCallback& callback) const {
@@ -187,7 +457,16 @@ namespace HAL {
 
   JSFunction JSContext::CreateFunction(const JSString& function_name, JSFunctionCallback& callback) const {
     HAL_JSCONTEXT_LOCK_GUARD;
-    return JSFunction(JSContext(js_global_context_ref__), function_name, callback);
+    return JSFunction(*this, function_name, callback);
+  }
+  
+  JSFunction JSContext::CreateFunction(const JSFunctionArgumentsCallback& callback) const {
+    return CreateFunction(JSString(), callback);
+  }
+  
+  JSFunction JSContext::CreateFunction(const JSString& function_name, const JSFunctionArgumentsCallback& callback) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    return JSFunction(*this, function_name, callback);
   }
   
   JSValue JSContext::JSEvaluateScript(const JSString& script) const {
@@ -205,21 +484,76 @@ namespace HAL {
   
   JSValue JSContext::JSEvaluateScript(const JSString& script, JSObject this_object, const JSString& source_url, int starting_line_number) const {
     HAL_JSCONTEXT_LOCK_GUARD;
+#ifdef HAL_SCRIPT_REF_ENABLE
+    if (const auto js_script = get_script_cache().Find(script, source_url, starting_line_number)) {
+      return JSEvaluateScript(*js_script, this_object);
+    }
+#endif
+    HAL_TRACE_SCOPE("script", "JSEvaluateScript", nullptr);
     JSValueRef js_value_ref { nullptr };
     const JSStringRef source_url_ref = (source_url.length() > 0) ? static_cast<JSStringRef>(source_url) : nullptr;
     JSValueRef exception { nullptr };
-    js_value_ref = ::JSEvaluateScript(js_global_context_ref__, static_cast<JSStringRef>(script), static_cast<JSObjectRef>(this_object), source_url_ref, starting_line_number, &exception);
+    const detail::JSQuotaScope js_quota_scope(get_quota_state());
+    HAL_JS_CPU_TIME_SCOPE(get_cpu_time_counters());
+    js_value_ref = HAL_API_CALL(*this, EvaluateScript, ::JSEvaluateScript(js_global_context_ref__, static_cast<JSStringRef>(script), static_cast<JSObjectRef>(this_object), source_url_ref, starting_line_number, &exception));
     
     if (exception) {
       // If this assert fails then we need to JSValueUnprotect
       // js_value_ref.
       assert(!js_value_ref);
-      detail::ThrowRuntimeError("JSContext", JSValue(JSContext(js_global_context_ref__), exception), source_url, starting_line_number);
+      detail::ThrowRuntimeError("JSContext", JSValue(*this, exception), source_url, starting_line_number);
     }
     
-    return JSValue(JSContext(js_global_context_ref__), js_value_ref);
+    return JSValue(*this, js_value_ref);
+  }
+  
+  void JSContext::ExecuteScript(const JSString& script) const {
+    ExecuteScript(script, JSString());
+  }
+  
+  void JSContext::ExecuteScript(const JSString& script, const JSString& source_url, int starting_line_number) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+#ifdef HAL_SCRIPT_REF_ENABLE
+    if (const auto js_script = get_script_cache().Find(script, source_url, starting_line_number)) {
+      JSEvaluateScript(*js_script);
+      return;
+    }
+#endif
+    HAL_TRACE_SCOPE("script", "ExecuteScript", nullptr);
+    const JSStringRef source_url_ref = (source_url.length() > 0) ? static_cast<JSStringRef>(source_url) : nullptr;
+    JSValueRef exception { nullptr };
+    const detail::JSQuotaScope js_quota_scope(get_quota_state());
+    HAL_JS_CPU_TIME_SCOPE(get_cpu_time_counters());
+    HAL_API_CALL(*this, EvaluateScript, ::JSEvaluateScript(js_global_context_ref__, static_cast<JSStringRef>(script), nullptr, source_url_ref, starting_line_number, &exception));
+    if (exception) {
+      detail::ThrowRuntimeError("JSContext", JSValue(*this, exception), source_url, starting_line_number);
+    }
   }
   
+#ifdef HAL_SCRIPT_REF_ENABLE
+  JSValue JSContext::JSEvaluateScript(const JSScript& js_script) const {
+    return JSEvaluateScript(js_script, get_global_object());
+  }
+  
+  JSValue JSContext::JSEvaluateScript(const JSScript& js_script, JSObject this_object) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    HAL_TRACE_SCOPE("script", "JSScriptEvaluate", nullptr);
+    if (js_script.get_context_group() != get_context_group()) {
+      detail::ThrowInvalidArgument("JSContext", "The JSScript was parsed for a different JSContextGroup.");
+    }
+    
+    JSValueRef exception { nullptr };
+    const detail::JSQuotaScope js_quota_scope(get_quota_state());
+    HAL_JS_CPU_TIME_SCOPE(get_cpu_time_counters());
+    const auto js_value_ref = HAL_API_CALL(*this, EvaluateScript, JSScriptEvaluate(js_global_context_ref__, static_cast<JSScriptRef>(js_script), static_cast<JSValueRef>(this_object), &exception));
+    if (exception) {
+      detail::ThrowRuntimeError("JSContext", JSValue(*this, exception), js_script.get_source_url(), js_script.get_starting_line_number());
+    }
+    
+    return JSValue(*this, js_value_ref);
+  }
+#endif
+  
   bool JSContext::JSCheckScriptSyntax(const JSString& script) const HAL_NOEXCEPT {
     return JSCheckScriptSyntax(script, JSString());
   }
@@ -231,15 +565,22 @@ namespace HAL {
     bool result = ::JSCheckScriptSyntax(js_global_context_ref__, static_cast<JSStringRef>(script), source_url_ref, starting_line_number, &exception);
     
     if (exception) {
-      detail::ThrowRuntimeError("JSContext", JSValue(JSContext(js_global_context_ref__), exception));
+      detail::ThrowRuntimeError("JSContext", JSValue(*this, exception));
     }
     
     return result;
   }
   
-  void JSContext::GarbageCollect() const HAL_NOEXCEPT {
-    HAL_JSCONTEXT_LOCK_GUARD;
-    JSGarbageCollect(js_global_context_ref__);
+  void JSContext::set_defer_handle_release(bool defer_handle_release) HAL_NOEXCEPT {
+    JSValue::SetDeferUnprotect(defer_handle_release);
+  }
+  
+  bool JSContext::get_defer_handle_release() HAL_NOEXCEPT {
+    return JSValue::GetDeferUnprotect();
+  }
+  
+  void JSContext::FlushHandles() HAL_NOEXCEPT {
+    JSValue::FlushDeferredUnprotect();
   }
   
 #ifdef DEBUG
@@ -248,6 +589,7 @@ namespace HAL {
   
   void JSContext::SynchronousGarbageCollectForDebugging() const {
     HAL_JSCONTEXT_LOCK_GUARD;
+    HAL_TRACE_SCOPE("gc", "SynchronousGarbageCollectForDebugging", nullptr);
     JSSynchronousGarbageCollectForDebugging(js_global_context_ref__);
   }
 
@@ -257,32 +599,854 @@ namespace HAL {
   }
 #endif
   
+  namespace {
+    
+#ifdef HAL_THREAD_SAFE_STATICS
+    detail::JSMutex js_context_control_block_registry_mutex__ HAL_LOCK_NAME("JSContext registry");
+#endif
+    
+    // The number of slots JSContext::AllocateSlot has handed out.
+    std::atomic<std::size_t> js_context_slot_count__ { 0 };
+    
+    // Publish js_value_ref, which the caller has protected, as the
+    // value of a lazily filled cache shared by every JSContext of a
+    // ControlBlock, and return the cached value. If another thread
+    // filled the cache first, js_value_ref is unprotected again.
+    template<typename T>
+    T PublishProtected(JSContextRef js_context_ref, std::atomic<T>& cache, T js_value_ref) HAL_NOEXCEPT {
+      T cached { nullptr };
+      if (cache.compare_exchange_strong(cached, js_value_ref, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return js_value_ref;
+      }
+      detail::UnprotectJSValue(js_context_ref, js_value_ref);
+      return cached;
+    }
+    
+  } // namespace {
+  
+#undef  HAL_JSCONTEXT_SLOTS_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE
+#define HAL_JSCONTEXT_SLOTS_LOCK_GUARD(control_block) std::lock_guard<detail::JSRecursiveMutex> lock_slots((control_block).slots_mutex)
+#else
+#define HAL_JSCONTEXT_SLOTS_LOCK_GUARD(control_block)
+#endif  // HAL_THREAD_SAFE
+  
+#undef  HAL_JSCONTEXT_CACHED_GLOBALS_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE
+#define HAL_JSCONTEXT_CACHED_GLOBALS_LOCK_GUARD(control_block) std::lock_guard<detail::JSMutex> lock_cached_globals((control_block).cached_globals_mutex)
+#else
+#define HAL_JSCONTEXT_CACHED_GLOBALS_LOCK_GUARD(control_block)
+#endif  // HAL_THREAD_SAFE
+  
+#undef  HAL_JSCONTEXT_REGISTRY_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE_STATICS
+#define HAL_JSCONTEXT_REGISTRY_LOCK_GUARD std::lock_guard<detail::JSMutex> lock_registry(js_context_control_block_registry_mutex__)
+#else
+#define HAL_JSCONTEXT_REGISTRY_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+  
+  struct JSContext::ControlBlock final {
+    
+    ControlBlock(const JSContextGroup& js_context_group, JSGlobalContextRef js_global_context_ref) HAL_NOEXCEPT
+    : js_context_group(js_context_group)
+    , js_global_context_ref(js_global_context_ref)
+    , js_value_retain_registry(js_global_context_ref)
+    , js_function_cache(js_global_context_ref)
+    , js_regexp_cache(js_global_context_ref)
+    , js_quota_state(js_context_group.get_quota_state())
+#ifdef HAL_API_STATISTICS_ENABLE
+    , api_statistics(detail::GetJSAPIStatistics(js_global_context_ref))
+#endif
+#ifdef HAL_CPU_TIME_ENABLE
+    , cpu_time_counters(detail::GetJSCPUTimeCounters(js_global_context_ref))
+#endif
+    {
+      for (auto& intrinsic : intrinsics) {
+        intrinsic.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    
+    ~ControlBlock() HAL_NOEXCEPT {
+      {
+        // A ControlBlock made for the same JSGlobalContextRef while
+        // this one was being destroyed keeps its entry.
+        HAL_JSCONTEXT_REGISTRY_LOCK_GUARD;
+        auto& registry = GetRegistry();
+        const auto position = registry.find(js_global_context_ref);
+        if (position != registry.end() && position -> second.expired()) {
+          registry.erase(position);
+        }
+      }
+      
+      // The slot values of the last JSContext are destroyed while the
+      // context is still alive.
+      // Swapped out first, since a destructor may look at the others.
+      std::vector<std::shared_ptr<void>> slot_values;
+      slot_values.swap(slots);
+      slot_values.clear();
+      
+      // The cached functions must be unprotected while the context is
+      // still alive.
+      js_function_cache.Clear();
+      js_regexp_cache.Clear();
+      for (const auto js_value_ref : { undefined_ref.load(), null_ref.load(), true_ref.load(), false_ref.load() }) {
+        if (js_value_ref) {
+          detail::UnprotectJSValue(js_global_context_ref, js_value_ref);
+        }
+      }
+      for (const auto& intrinsic : intrinsics) {
+        if (const auto intrinsic_ref = intrinsic.load()) {
+          detail::UnprotectJSValue(js_global_context_ref, intrinsic_ref);
+        }
+      }
+      ClearCachedGlobals();
+      for (const auto js_object_ref : { array_is_array_function.load(), function_prototype.load(), date_get_time_function.load(), regexp_test_function.load(), regexp_exec_function.load(), call_batched_function.load(), call_batched_numbers_function.load() }) {
+        if (js_object_ref) {
+          detail::UnprotectJSValue(js_global_context_ref, js_object_ref);
+        }
+      }
+#ifndef HAL_WEAK_OBJECT_MAP_ENABLE
+      for (const auto js_object_ref : { weak_objects, weak_object_function }) {
+        if (js_object_ref) {
+          detail::UnprotectJSValue(js_global_context_ref, js_object_ref);
+        }
+      }
+#endif
+      if (js_context_group.is_refcounted()) {
+        HAL_LOG_TRACE("JSContext:: release ", js_global_context_ref);
+        JSGlobalContextRelease(js_global_context_ref);
+      }
+    }
+    
+    ControlBlock(const ControlBlock&)            = delete;
+    ControlBlock(ControlBlock&&)                 = delete;
+    ControlBlock& operator=(const ControlBlock&) = delete;
+    ControlBlock& operator=(ControlBlock&&)      = delete;
+    
+    const JSContextGroup     js_context_group;
+    const JSGlobalContextRef js_global_context_ref;
+    
+    // Every JSValue holds a copy of its JSContext, so this is empty by
+    // the time the ControlBlock is destroyed.
+    detail::JSValueRetainRegistry js_value_retain_registry;
+    
+    detail::JSFunctionCache js_function_cache;
+    detail::JSRegExpCache   js_regexp_cache;
+    
+    // Made the first time they are asked for, since many contexts
+    // never need all of them. Protected
+    // while the context lives, because 32-bit JavaScriptCore wraps
+    // even these in collectable cells.
+    //
+    // These and the other lazily filled object caches below are
+    // shared by every JSContext of the ControlBlock, each with its own
+    // lock, so they are atomics filled by PublishProtected.
+    std::atomic<JSValueRef> undefined_ref { nullptr };
+    std::atomic<JSValueRef> null_ref      { nullptr };
+    std::atomic<JSValueRef> true_ref      { nullptr };
+    std::atomic<JSValueRef> false_ref     { nullptr };
+    
+    JSValueRef GetImmediate(std::atomic<JSValueRef>& slot, JSValueRef js_value_ref) HAL_NOEXCEPT {
+      detail::ProtectJSValue(js_global_context_ref, js_value_ref);
+      return PublishProtected(js_global_context_ref, slot, js_value_ref);
+    }
+    
+    void ClearCachedGlobals() HAL_NOEXCEPT {
+      HAL_JSCONTEXT_CACHED_GLOBALS_LOCK_GUARD(*this);
+      for (const auto& entry : cached_globals) {
+        detail::UnprotectJSValue(js_global_context_ref, entry.second);
+      }
+      cached_globals.clear();
+    }
+    
+    // Protected while cached.
+    std::atomic<JSObjectRef> intrinsics[kJSIntrinsicCount];
+    std::atomic<JSObjectRef> array_is_array_function { nullptr };
+    std::atomic<JSObjectRef> function_prototype      { nullptr };
+    std::atomic<JSObjectRef> date_get_time_function  { nullptr };
+    std::atomic<JSObjectRef> regexp_test_function    { nullptr };
+    std::atomic<JSObjectRef> regexp_exec_function    { nullptr };
+    
+    std::unordered_map<JSString, JSValueRef> cached_globals;
+#ifdef HAL_THREAD_SAFE
+    detail::JSMutex cached_globals_mutex HAL_LOCK_NAME("JSContext cached globals");
+#endif
+    
+    std::atomic<JSObjectRef> call_batched_function         { nullptr };
+    std::atomic<JSObjectRef> call_batched_numbers_function { nullptr };
+    
+    // The external memory accounted for by AdjustExternalMemory, and
+    // its size at the last garbage collection.
+    std::size_t external_memory_size { 0 };
+    std::size_t external_memory_size_at_gc { 0 };
+    std::size_t external_memory_gc_threshold { 64 * 1024 * 1024 };
+    
+    // Shared with the other JSContexts of the group.
+    const std::shared_ptr<detail::JSQuotaState> js_quota_state;
+    
+    // The slot values, indexed by the result of
+    // JSContext::AllocateSlot.
+    std::vector<std::shared_ptr<void>> slots;
+#ifdef HAL_THREAD_SAFE
+    // Recursive, since GetOrCreateSlot creates a value under it.
+    detail::JSRecursiveMutex slots_mutex HAL_LOCK_NAME("JSContext slots");
+#endif
+    
+#ifdef HAL_SCRIPT_REF_ENABLE
+    // Shared with the other JSContexts of the group, and filled by
+    // JSContextGroup::PrecompileAsync. Fetched the first time a script
+    // is evaluated, since many contexts never evaluate one.
+    std::once_flag                 js_script_cache_once;
+    std::shared_ptr<JSScriptCache> js_script_cache;
+#endif
+    
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+    // JavaScriptCore destroys it with the global object.
+    JSWeakObjectMapRef weak_object_map { nullptr };
+#else
+    // The Map of WeakRefs and the FinalizationRegistry behind
+    // JSContext::get_weak_object, and the function that uses them.
+    // Protected while cached.
+    JSObjectRef weak_objects         { nullptr };
+    JSObjectRef weak_object_function { nullptr };
+#endif
+    
+#ifdef HAL_API_STATISTICS_ENABLE
+    // Shared with the ControlBlocks of other JSContexts wrapping the
+    // same JSGlobalContextRef.
+    const std::shared_ptr<detail::JSAPIStatistics> api_statistics;
+#endif
+    
+#ifdef HAL_CPU_TIME_ENABLE
+    // Shared like api_statistics.
+    const std::shared_ptr<detail::JSCPUTimeCounters> cpu_time_counters;
+#endif
+    
+    // The ControlBlock of every JSGlobalContextRef HAL has a JSContext
+    // for, so that a JSContext wrapped around it, e.g. in a callback,
+    // shares the caches of the others, and so that JSMemoryPressure can
+    // evict them. An entry can't be mistaken for a later context at the
+    // same address, since its ControlBlock retains the JSGlobalContextRef
+    // until the entry has expired.
+    typedef std::unordered_map<JSGlobalContextRef, std::weak_ptr<ControlBlock>> Registry;
+    
+    static Registry& GetRegistry() HAL_NOEXCEPT {
+      static Registry registry;
+      return registry;
+    }
+    
+    // Add control_block to the registry, replacing the expired entry of
+    // an earlier context at the same address, if there is one. The
+    // registry lock must be held.
+    static void Register(const std::shared_ptr<ControlBlock>& control_block) HAL_NOEXCEPT {
+      GetRegistry()[control_block -> js_global_context_ref] = control_block;
+      
+      // The contexts of an UnmanagedSingleContext group live until the
+      // process exits, and so do their ControlBlocks, so that the
+      // caches and slots of a context wrapped only in callbacks outlive
+      // each callback. They are never destroyed, since the contexts
+      // they would unprotect their values in may be gone by then.
+      if (!control_block -> js_context_group.is_refcounted()) {
+        static auto unmanaged_control_blocks = new std::vector<std::shared_ptr<ControlBlock>>();
+        unmanaged_control_blocks -> push_back(control_block);
+      }
+    }
+    
+    // Return the ControlBlock of js_global_context_ref, making one for
+    // it the first time.
+    static std::shared_ptr<ControlBlock> Get(JSGlobalContextRef js_global_context_ref) HAL_NOEXCEPT;
+    
+  private:
+    
+    // The last ControlBlock wrapped on this thread, which is nearly
+    // always the next one, so that a callback only takes the registry
+    // lock when it is called in another context.
+    struct LastControlBlock final {
+      ~LastControlBlock() HAL_NOEXCEPT {
+        destroyed = true;
+      }
+      
+      JSGlobalContextRef          js_global_context_ref { nullptr };
+      std::weak_ptr<ControlBlock> control_block;
+      static HAL_THREAD_LOCAL bool destroyed;
+    };
+    
+    static thread_local LastControlBlock last_control_block;
+  };
+  
+  HAL_THREAD_LOCAL bool JSContext::ControlBlock::LastControlBlock::destroyed { false };
+  thread_local JSContext::ControlBlock::LastControlBlock JSContext::ControlBlock::last_control_block;
+  
+  std::shared_ptr<JSContext::ControlBlock> JSContext::ControlBlock::Get(JSGlobalContextRef js_global_context_ref) HAL_NOEXCEPT {
+    if (!LastControlBlock::destroyed && last_control_block.js_global_context_ref == js_global_context_ref) {
+      if (auto control_block = last_control_block.control_block.lock()) {
+        return control_block;
+      }
+    }
+    
+    std::shared_ptr<ControlBlock> control_block;
+    {
+      HAL_JSCONTEXT_REGISTRY_LOCK_GUARD;
+      control_block = GetRegistry()[js_global_context_ref].lock();
+      if (!control_block) {
+        const JSContextGroup js_context_group(JSContextGetGroup(js_global_context_ref));
+        if (js_context_group.is_refcounted()) {
+          HAL_LOG_TRACE("JSContext:: retain ", js_global_context_ref);
+          JSGlobalContextRetain(js_global_context_ref);
+        }
+        control_block = std::make_shared<ControlBlock>(js_context_group, js_global_context_ref);
+        Register(control_block);
+      }
+    }
+    
+    if (!LastControlBlock::destroyed) {
+      last_control_block.js_global_context_ref = js_global_context_ref;
+      last_control_block.control_block         = control_block;
+    }
+    return control_block;
+  }
+  
+  std::vector<JSContext> JSContext::GetLiveContexts() {
+    std::vector<std::shared_ptr<ControlBlock>> control_blocks;
+    {
+      HAL_JSCONTEXT_REGISTRY_LOCK_GUARD;
+      for (const auto& entry : ControlBlock::GetRegistry()) {
+        if (auto control_block = entry.second.lock()) {
+          control_blocks.push_back(std::move(control_block));
+        }
+      }
+    }
+    
+    // The last JSContext of a ControlBlock may be destroyed meanwhile,
+    // so the list lock must not be held when these are.
+    std::vector<JSContext> js_contexts;
+    js_contexts.reserve(control_blocks.size());
+    for (const auto& control_block : control_blocks) {
+      js_contexts.push_back(JSContext(control_block));
+    }
+    return js_contexts;
+  }
+  
+  namespace {
+    
+    // Every JSContext shares these, since JavaScriptCore collects the
+    // heap of a whole group and HAL may collect from any thread.
+    struct GarbageCollectionState final {
+      std::atomic<std::uint64_t>                         collection_count        { 0 };
+      std::atomic<std::uint64_t>                         total_pause_nanoseconds { 0 };
+      std::atomic<std::uint64_t>                         max_pause_nanoseconds   { 0 };
+      detail::JSMutex                                    mutex HAL_LOCK_NAME("JSGarbageCollection");
+      std::shared_ptr<const JSGarbageCollectionCallback> callback;
+    };
+    
+    GarbageCollectionState& GetGarbageCollectionState() {
+      static GarbageCollectionState state;
+      return state;
+    }
+    
+    void NotifyGarbageCollection(const std::shared_ptr<const JSGarbageCollectionCallback>& callback, const JSContext& js_context, JSGarbageCollectionEvent event, std::chrono::nanoseconds pause) HAL_NOEXCEPT {
+      if (!callback) {
+        return;
+      }
+      
+      try {
+        (*callback)(js_context, event, pause);
+      } catch (const std::exception& e) {
+        HAL_LOG_ERROR("JSContext: garbage collection callback threw ", e.what());
+      } catch (...) {
+        HAL_LOG_ERROR("JSContext: garbage collection callback threw an unknown exception");
+      }
+    }
+    
+  } // namespace {
+  
+  void JSContext::GarbageCollect() const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    HAL_TRACE_SCOPE("gc", "GarbageCollect", nullptr);
+    // Let the collector reclaim values whose release was deferred.
+    JSValue::FlushDeferredUnprotect();
+    control_block__ -> external_memory_size_at_gc = control_block__ -> external_memory_size;
+    
+    auto& state = GetGarbageCollectionState();
+    std::shared_ptr<const JSGarbageCollectionCallback> callback;
+    {
+      std::lock_guard<detail::JSMutex> lock(state.mutex);
+      callback = state.callback;
+    }
+    
+    NotifyGarbageCollection(callback, *this, JSGarbageCollectionEvent::Begin, std::chrono::nanoseconds(0));
+    const auto start = std::chrono::steady_clock::now();
+    JSGarbageCollect(js_global_context_ref__);
+    const auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    
+    const auto pause_nanoseconds = static_cast<std::uint64_t>(pause.count());
+    state.collection_count.fetch_add(1, std::memory_order_relaxed);
+    state.total_pause_nanoseconds.fetch_add(pause_nanoseconds, std::memory_order_relaxed);
+    auto max_pause_nanoseconds = state.max_pause_nanoseconds.load(std::memory_order_relaxed);
+    while (pause_nanoseconds > max_pause_nanoseconds && !state.max_pause_nanoseconds.compare_exchange_weak(max_pause_nanoseconds, pause_nanoseconds, std::memory_order_relaxed)) {
+    }
+    NotifyGarbageCollection(callback, *this, JSGarbageCollectionEvent::End, pause);
+  }
+  
+  JSGarbageCollectionStatistics JSContext::GetGarbageCollectionStatistics() HAL_NOEXCEPT {
+    const auto& state = GetGarbageCollectionState();
+    return JSGarbageCollectionStatistics {
+      state.collection_count.load(std::memory_order_relaxed),
+      state.total_pause_nanoseconds.load(std::memory_order_relaxed),
+      state.max_pause_nanoseconds.load(std::memory_order_relaxed)
+    };
+  }
+  
+  void JSContext::set_garbage_collection_callback(const JSGarbageCollectionCallback& callback) {
+    auto& state = GetGarbageCollectionState();
+    auto shared_callback = callback ? std::make_shared<const JSGarbageCollectionCallback>(callback) : nullptr;
+    std::lock_guard<detail::JSMutex> lock(state.mutex);
+    state.callback = std::move(shared_callback);
+  }
+  
+  void JSContext::AdjustExternalMemory(std::ptrdiff_t byte_delta) const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    auto& control_block = *control_block__;
+    if (byte_delta < 0) {
+      const auto freed = std::min(control_block.external_memory_size, static_cast<std::size_t>(-byte_delta));
+      control_block.js_quota_state -> AdjustExternalMemory(-static_cast<std::ptrdiff_t>(freed));
+      control_block.external_memory_size      -= freed;
+      control_block.external_memory_size_at_gc = std::min(control_block.external_memory_size_at_gc, control_block.external_memory_size);
+      return;
+    }
+    
+    control_block.external_memory_size += static_cast<std::size_t>(byte_delta);
+    control_block.js_quota_state -> AdjustExternalMemory(byte_delta);
+#ifdef HAL_EXTRA_MEMORY_COST_ENABLE
+    JSReportExtraMemoryCost(js_global_context_ref__, static_cast<std::size_t>(byte_delta));
+#else
+    // The accounting is updated before collecting, since finalizing
+    // JSExport objects calls back in to free their external memory.
+    if (control_block.external_memory_size - control_block.external_memory_size_at_gc >= control_block.external_memory_gc_threshold) {
+      GarbageCollect();
+    }
+#endif
+  }
+  
+  std::size_t JSContext::get_external_memory_size() const HAL_NOEXCEPT {
+    return control_block__ -> external_memory_size;
+  }
+  
+  void JSContext::set_external_memory_gc_threshold(std::size_t threshold) const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    control_block__ -> external_memory_gc_threshold = threshold;
+  }
+  
+  std::size_t JSContext::get_external_memory_gc_threshold() const HAL_NOEXCEPT {
+    return control_block__ -> external_memory_gc_threshold;
+  }
+  
+  std::uint64_t JSContext::get_value_allocation_count() const HAL_NOEXCEPT {
+    return control_block__ -> js_value_retain_registry.get_protect_count();
+  }
+  
+  std::size_t JSContext::AllocateSlot() HAL_NOEXCEPT {
+    return js_context_slot_count__.fetch_add(1, std::memory_order_relaxed);
+  }
+  
+  std::shared_ptr<void> JSContext::get_slot(std::size_t index) const HAL_NOEXCEPT {
+    auto& control_block = *control_block__;
+    HAL_JSCONTEXT_SLOTS_LOCK_GUARD(control_block);
+    const auto& slots = control_block.slots;
+    return index < slots.size() ? slots[index] : nullptr;
+  }
+  
+  std::shared_ptr<void> JSContext::get_or_create_slot(std::size_t index, const std::function<std::shared_ptr<void>()>& create) const {
+    if (index >= js_context_slot_count__.load(std::memory_order_relaxed)) {
+      detail::ThrowInvalidArgument("JSContext", "The slot index wasn't returned by AllocateSlot.");
+      return nullptr;
+    }
+    
+    auto& control_block = *control_block__;
+    HAL_JSCONTEXT_SLOTS_LOCK_GUARD(control_block);
+    if (index < control_block.slots.size() && control_block.slots[index]) {
+      return control_block.slots[index];
+    }
+    
+    // create may set other slots, which may grow the vector.
+    auto value = create();
+    auto& slots = control_block.slots;
+    if (index >= slots.size()) {
+      slots.resize(js_context_slot_count__.load(std::memory_order_relaxed));
+    }
+    slots[index] = value;
+    return value;
+  }
+  
+  void JSContext::set_slot(std::size_t index, std::shared_ptr<void> value) const {
+    if (index >= js_context_slot_count__.load(std::memory_order_relaxed)) {
+      detail::ThrowInvalidArgument("JSContext", "The slot index wasn't returned by AllocateSlot.");
+      return;
+    }
+    
+    auto& control_block = *control_block__;
+    {
+      HAL_JSCONTEXT_SLOTS_LOCK_GUARD(control_block);
+      auto& slots = control_block.slots;
+      if (index >= slots.size()) {
+        slots.resize(js_context_slot_count__.load(std::memory_order_relaxed));
+      }
+      slots[index].swap(value);
+    }
+    
+    // The value replaced is destroyed outside of the lock, since its
+    // destructor may use other slots.
+  }
+  
+  JSContextGroup JSContext::get_context_group() const HAL_NOEXCEPT {
+    return control_block__ -> js_context_group;
+  }
+  
+#ifdef HAL_THREAD_AFFINITY
+  bool JSContext::IsOwnerThread() const HAL_NOEXCEPT {
+    // A moved from JSContext has no control block and is never used.
+    return ! control_block__ || control_block__ -> js_context_group.get_owner_thread_id() == std::this_thread::get_id();
+  }
+#endif
+  
+  detail::JSValueRetainRegistry& JSContext::get_js_value_retain_registry() const HAL_NOEXCEPT {
+    return control_block__ -> js_value_retain_registry;
+  }
+  
+  detail::JSFunctionCache& JSContext::get_js_function_cache() const HAL_NOEXCEPT {
+    return control_block__ -> js_function_cache;
+  }
+  
+  detail::JSRegExpCache& JSContext::get_js_regexp_cache() const HAL_NOEXCEPT {
+    return control_block__ -> js_regexp_cache;
+  }
+  
+  JSValueRef JSContext::get_undefined_ref() const HAL_NOEXCEPT {
+    auto& slot = control_block__ -> undefined_ref;
+    const auto js_value_ref = slot.load(std::memory_order_acquire);
+    return js_value_ref ? js_value_ref : control_block__ -> GetImmediate(slot, JSValueMakeUndefined(js_global_context_ref__));
+  }
+  
+  JSValueRef JSContext::get_null_ref() const HAL_NOEXCEPT {
+    auto& slot = control_block__ -> null_ref;
+    const auto js_value_ref = slot.load(std::memory_order_acquire);
+    return js_value_ref ? js_value_ref : control_block__ -> GetImmediate(slot, JSValueMakeNull(js_global_context_ref__));
+  }
+  
+  JSValueRef JSContext::get_boolean_ref(bool boolean) const HAL_NOEXCEPT {
+    auto& slot = boolean ? control_block__ -> true_ref : control_block__ -> false_ref;
+    const auto js_value_ref = slot.load(std::memory_order_acquire);
+    return js_value_ref ? js_value_ref : control_block__ -> GetImmediate(slot, JSValueMakeBoolean(js_global_context_ref__, boolean));
+  }
+  
+  namespace {
+    
+    // Return the object property_name of js_object_ref, or nullptr if
+    // it isn't one.
+    JSObjectRef GetObjectProperty(JSContextRef js_context_ref, JSObjectRef js_object_ref, const JSString& property_name) HAL_NOEXCEPT {
+      JSValueRef exception { nullptr };
+      const auto js_value_ref = JSObjectGetProperty(js_context_ref, js_object_ref, static_cast<JSStringRef>(property_name), &exception);
+      if (exception || !JSValueIsObject(js_context_ref, js_value_ref)) {
+        return nullptr;
+      }
+      return JSValueToObject(js_context_ref, js_value_ref, nullptr);
+    }
+    
+    const JSString& GetIntrinsicName(JSIntrinsic intrinsic) HAL_NOEXCEPT {
+      switch (intrinsic) {
+        case JSIntrinsic::Array:    return detail::JSAtoms::Array;
+        case JSIntrinsic::Date:     return detail::JSAtoms::Date;
+        case JSIntrinsic::Error:    return detail::JSAtoms::Error;
+        case JSIntrinsic::Function: return detail::JSAtoms::Function;
+        case JSIntrinsic::JSON:     return detail::JSAtoms::JSON;
+        case JSIntrinsic::Object:   return detail::JSAtoms::Object;
+        case JSIntrinsic::RegExp:   return detail::JSAtoms::RegExp;
+      }
+      assert(false);
+      return detail::JSAtoms::Object;
+    }
+    
+    // Fill cache, if it is still nullptr, with the protected object
+    // property_name of js_object_ref, and return it.
+    JSObjectRef GetCachedObjectProperty(JSContextRef js_context_ref, JSObjectRef js_object_ref, const JSString& property_name, std::atomic<JSObjectRef>& cache) HAL_NOEXCEPT {
+      const auto cached = cache.load(std::memory_order_acquire);
+      if (cached || !js_object_ref) {
+        return cached;
+      }
+      const auto property = GetObjectProperty(js_context_ref, js_object_ref, property_name);
+      if (!property) {
+        return nullptr;
+      }
+      detail::ProtectJSValue(js_context_ref, property);
+      return PublishProtected(js_context_ref, cache, property);
+    }
+    
+    // Fill function, if it is still nullptr, with the protected
+    // function name of the prototype of constructor, and return it.
+    JSObjectRef GetPrototypeFunction(JSContextRef js_context_ref, JSObjectRef constructor, const JSString& name, std::atomic<JSObjectRef>& function) HAL_NOEXCEPT {
+      const auto cached = function.load(std::memory_order_acquire);
+      if (cached || !constructor) {
+        return cached;
+      }
+      return GetCachedObjectProperty(js_context_ref, GetObjectProperty(js_context_ref, constructor, detail::JSAtoms::prototype), name, function);
+    }
+    
+    // Return a new protected function.
+    JSObjectRef MakeProtectedFunction(const JSContext& js_context, const std::vector<JSString>& parameter_names, const char* body) {
+      JSValueRef exception { nullptr };
+      const auto parameter_name_array = detail::to_vector(parameter_names);
+      const auto js_object_ref = JSObjectMakeFunction(static_cast<JSContextRef>(js_context), nullptr, static_cast<unsigned>(parameter_name_array.size()), &parameter_name_array[0], static_cast<JSStringRef>(JSString(body)), nullptr, 1, &exception);
+      if (exception) {
+        detail::ThrowRuntimeError("JSContext", JSValue(js_context, exception));
+      }
+      
+      detail::ProtectJSValue(static_cast<JSContextRef>(js_context), js_object_ref);
+      return js_object_ref;
+    }
+    
+  } // namespace {
+  
+  JSObjectRef JSContext::get_call_batched_function() const {
+    auto& call_batched_function = control_block__ -> call_batched_function;
+    const auto cached = call_batched_function.load(std::memory_order_acquire);
+    if (cached) {
+      return cached;
+    }
+    return PublishProtected(js_global_context_ref__, call_batched_function, MakeProtectedFunction(*this, {"handler", "self", "inputs"},
+      "var length = inputs.length, results = new Array(length);"
+      "for (var i = 0; i < length; ++i) { results[i] = handler.call(self, inputs[i]); }"
+      "return results;"));
+  }
+  
+  JSObjectRef JSContext::get_call_batched_numbers_function() const {
+    auto& call_batched_numbers_function = control_block__ -> call_batched_numbers_function;
+    const auto cached = call_batched_numbers_function.load(std::memory_order_acquire);
+    if (cached) {
+      return cached;
+    }
+    return PublishProtected(js_global_context_ref__, call_batched_numbers_function, MakeProtectedFunction(*this, {"handler", "self", "inputs", "results"},
+      "for (var i = 0, length = inputs.length; i < length; ++i) { results[i] = handler.call(self, inputs[i]); }"));
+  }
+  
+  JSObjectRef JSContext::get_intrinsic(JSIntrinsic intrinsic) const HAL_NOEXCEPT {
+    return GetCachedObjectProperty(js_global_context_ref__, JSContextGetGlobalObject(js_global_context_ref__), GetIntrinsicName(intrinsic), control_block__ -> intrinsics[static_cast<std::size_t>(intrinsic)]);
+  }
+  
+  JSObject JSContext::GetIntrinsic(JSIntrinsic intrinsic) const {
+    const auto intrinsic_ref = get_intrinsic(intrinsic);
+    if (!intrinsic_ref) {
+      detail::ThrowRuntimeError("JSContext", "The global object has no " + static_cast<std::string>(GetIntrinsicName(intrinsic)) + ".");
+    }
+    return JSObject(*this, intrinsic_ref);
+  }
+  
+  JSValue JSContext::GetCachedGlobal(const JSString& name) const {
+    HAL_JSCONTEXT_CACHED_GLOBALS_LOCK_GUARD(*control_block__);
+    auto& cached_globals = control_block__ -> cached_globals;
+    const auto position  = cached_globals.find(name);
+    if (position != cached_globals.end()) {
+      return JSValue(*this, position -> second);
+    }
+    
+    JSValueRef exception { nullptr };
+    const auto js_value_ref = JSObjectGetProperty(js_global_context_ref__, JSContextGetGlobalObject(js_global_context_ref__), static_cast<JSStringRef>(name), &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSContext", JSValue(*this, exception));
+    }
+    
+    detail::ProtectJSValue(js_global_context_ref__, js_value_ref);
+    cached_globals.emplace(name, js_value_ref);
+    return JSValue(*this, js_value_ref);
+  }
+  
+  void JSContext::ClearCachedGlobals() const HAL_NOEXCEPT {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    control_block__ -> ClearCachedGlobals();
+  }
+  
+  JSObjectRef JSContext::get_array_is_array_function() const HAL_NOEXCEPT {
+    auto& array_is_array_function = control_block__ -> array_is_array_function;
+    const auto cached = array_is_array_function.load(std::memory_order_acquire);
+    return cached ? cached : GetCachedObjectProperty(js_global_context_ref__, get_intrinsic(JSIntrinsic::Array), detail::JSAtoms::isArray, array_is_array_function);
+  }
+  
+  JSObjectRef JSContext::get_function_prototype() const HAL_NOEXCEPT {
+    auto& function_prototype = control_block__ -> function_prototype;
+    const auto cached = function_prototype.load(std::memory_order_acquire);
+    return cached ? cached : GetCachedObjectProperty(js_global_context_ref__, get_intrinsic(JSIntrinsic::Function), detail::JSAtoms::prototype, function_prototype);
+  }
+  
+  JSObjectRef JSContext::get_date_get_time_function() const HAL_NOEXCEPT {
+    return GetPrototypeFunction(js_global_context_ref__, get_intrinsic(JSIntrinsic::Date), detail::JSAtoms::getTime, control_block__ -> date_get_time_function);
+  }
+  
+  JSObjectRef JSContext::get_regexp_test_function() const HAL_NOEXCEPT {
+    return GetPrototypeFunction(js_global_context_ref__, get_intrinsic(JSIntrinsic::RegExp), detail::JSAtoms::test, control_block__ -> regexp_test_function);
+  }
+  
+  JSObjectRef JSContext::get_regexp_exec_function() const HAL_NOEXCEPT {
+    return GetPrototypeFunction(js_global_context_ref__, get_intrinsic(JSIntrinsic::RegExp), detail::JSAtoms::exec, control_block__ -> regexp_exec_function);
+  }
+  
+  detail::JSQuotaState& JSContext::get_quota_state() const HAL_NOEXCEPT {
+    return *control_block__ -> js_quota_state;
+  }
+  
+#ifdef HAL_SCRIPT_REF_ENABLE
+  JSScriptCache& JSContext::get_script_cache() const HAL_NOEXCEPT {
+    auto& control_block = *control_block__;
+    std::call_once(control_block.js_script_cache_once, [&control_block] {
+      control_block.js_script_cache = control_block.js_context_group.GetScriptCache();
+    });
+    return *control_block.js_script_cache;
+  }
+#endif
+  
+#ifdef HAL_API_STATISTICS_ENABLE
+  detail::JSAPIStatistics& JSContext::get_api_statistics() const HAL_NOEXCEPT {
+    return *control_block__ -> api_statistics;
+  }
+  
+  std::vector<JSAPICallStatistics> JSContext::GetAPIStatistics() const {
+    const auto& api_statistics = get_api_statistics();
+    std::vector<JSAPICallStatistics> result;
+    result.reserve(detail::kJSAPICategoryCount);
+    for (std::size_t i = 0; i < detail::kJSAPICategoryCount; ++i) {
+      result.push_back({
+        detail::to_string(static_cast<detail::JSAPICategory>(i)),
+        api_statistics.calls[i].load(std::memory_order_relaxed),
+        api_statistics.sampled_calls[i].load(std::memory_order_relaxed),
+        api_statistics.sampled_nanoseconds[i].load(std::memory_order_relaxed)
+      });
+    }
+    return result;
+  }
+  
+  void JSContext::ResetAPIStatistics() const HAL_NOEXCEPT {
+    get_api_statistics().Reset();
+  }
+#endif
+  
+#ifdef HAL_CPU_TIME_ENABLE
+  detail::JSCPUTimeCounters& JSContext::get_cpu_time_counters() const HAL_NOEXCEPT {
+    return *control_block__ -> cpu_time_counters;
+  }
+  
+  JSCPUTimeStatistics JSContext::GetCPUTimeStatistics() const HAL_NOEXCEPT {
+    const auto& counters = get_cpu_time_counters();
+    JSCPUTimeStatistics result;
+    result.js_time        = std::chrono::nanoseconds(counters.js_nanoseconds.load(std::memory_order_relaxed));
+    result.native_time    = std::chrono::nanoseconds(counters.native_nanoseconds.load(std::memory_order_relaxed));
+    result.entry_count    = counters.entry_count.load(std::memory_order_relaxed);
+    result.callback_count = counters.callback_count.load(std::memory_order_relaxed);
+    return result;
+  }
+  
+  void JSContext::ResetCPUTimeStatistics() const HAL_NOEXCEPT {
+    get_cpu_time_counters().Reset();
+  }
+#endif
+  
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+  JSWeakObjectMapRef JSContext::get_weak_object_map() const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    auto& weak_object_map = control_block__ -> weak_object_map;
+    if (! weak_object_map) {
+      weak_object_map = JSWeakObjectMapCreate(js_global_context_ref__, nullptr, [](JSWeakObjectMapRef, void*) {
+      });
+    }
+    return weak_object_map;
+  }
+#endif
+  
+std::uint64_t JSContext::NewWeakObjectKey() HAL_NOEXCEPT {
+    // Keys are never reused, so a key whose object was collected never
+    // finds a later one. Numbers stay exact in JavaScript up to 2^53.
+    static std::atomic<std::uint64_t> next_key { 0 };
+    return next_key.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+  JSObjectRef JSContext::get_weak_object(std::uint64_t key) const {
+    return JSWeakObjectMapGet(js_global_context_ref__, get_weak_object_map(), reinterpret_cast<void*>(static_cast<std::uintptr_t>(key)));
+  }
+  
+  void JSContext::set_weak_object(std::uint64_t key, JSObjectRef js_object_ref) const {
+    JSWeakObjectMapSet(js_global_context_ref__, get_weak_object_map(), reinterpret_cast<void*>(static_cast<std::uintptr_t>(key)), js_object_ref);
+  }
+#else
+  namespace {
+    
+    // Call the weak object function of a context with its state, a
+    // key, and the target to set, if any. Returns the target of key,
+    // or nullptr.
+    JSObjectRef CallWeakObjectFunction(JSContextRef js_context_ref, JSObjectRef weak_object_function, JSObjectRef weak_objects, std::uint64_t key, JSObjectRef target) {
+      const JSValueRef arguments[] = {
+        weak_objects,
+        JSValueMakeNumber(js_context_ref, static_cast<double>(key)),
+        target ? static_cast<JSValueRef>(target) : JSValueMakeUndefined(js_context_ref)
+      };
+      JSValueRef exception { nullptr };
+      const auto result = JSObjectCallAsFunction(js_context_ref, weak_object_function, nullptr, 3, arguments, &exception);
+      if (exception || !result || !JSValueIsObject(js_context_ref, result)) {
+        return nullptr;
+      }
+      return JSValueToObject(js_context_ref, result, nullptr);
+    }
+    
+  } // namespace {
+  
+  JSObjectRef JSContext::get_weak_object(std::uint64_t key) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    auto& control_block = *control_block__;
+    if (!control_block.weak_object_function) {
+      return nullptr;
+    }
+    return CallWeakObjectFunction(js_global_context_ref__, control_block.weak_object_function, control_block.weak_objects, key, nullptr);
+  }
+  
+  void JSContext::set_weak_object(std::uint64_t key, JSObjectRef js_object_ref) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    auto& control_block = *control_block__;
+    if (!control_block.weak_object_function) {
+      // The FinalizationRegistry drops the entry of each collected
+      // object.
+      JSValueRef exception { nullptr };
+      const auto weak_objects = ::JSEvaluateScript(js_global_context_ref__, static_cast<JSStringRef>(JSString(
+        "(function () {"
+        "  var refs = new Map();"
+        "  return { refs: refs, registry: new FinalizationRegistry(function (key) { refs.delete(key); }) };"
+        "})();")), nullptr, nullptr, 1, &exception);
+      if (exception) {
+        detail::ThrowRuntimeError("JSContext", JSValue(*this, exception));
+        return;
+      }
+      control_block.weak_objects = JSValueToObject(js_global_context_ref__, weak_objects, nullptr);
+      detail::ProtectJSValue(js_global_context_ref__, control_block.weak_objects);
+      control_block.weak_object_function = MakeProtectedFunction(*this, {"state", "key", "target"},
+        "if (target) { state.refs.set(key, new WeakRef(target)); state.registry.register(target, key); return target; }"
+        "var ref = state.refs.get(key);"
+        "return ref && ref.deref();");
+    }
+    CallWeakObjectFunction(js_global_context_ref__, control_block.weak_object_function, control_block.weak_objects, key, js_object_ref);
+  }
+#endif
+  
   JSContext::~JSContext() HAL_NOEXCEPT {
     HAL_LOG_TRACE("JSContext:: dtor ", this);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContext:: release ", js_global_context_ref__, " for ", this);
-    JSGlobalContextRelease(js_global_context_ref__);
-#endif
   }
   
   JSContext::JSContext(const JSContext& rhs) HAL_NOEXCEPT
-  : js_context_group__(rhs.js_context_group__)
+  : control_block__(rhs.control_block__)
   , js_global_context_ref__(rhs.js_global_context_ref__) {
     HAL_LOG_TRACE("JSContext:: copy ctor ", this);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContext:: retain ", js_global_context_ref__, " for ", this);
-    JSGlobalContextRetain(js_global_context_ref__);
-#endif
   }
   
   JSContext::JSContext(JSContext&& rhs) HAL_NOEXCEPT
-  : js_context_group__(std::move(rhs.js_context_group__))
+  : control_block__(std::move(rhs.control_block__))
   , js_global_context_ref__(rhs.js_global_context_ref__) {
     HAL_LOG_TRACE("JSContext:: move ctor ", this);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContext:: retain ", js_global_context_ref__, " for ", this);
-    JSGlobalContextRetain(js_global_context_ref__);
-#endif
+    rhs.js_global_context_ref__ = nullptr;
   }
   
   JSContext& JSContext::operator=(JSContext rhs) HAL_NOEXCEPT {
@@ -299,15 +1463,32 @@ namespace HAL {
     
     // By swapping the members of two classes, the two classes are
     // effectively swapped.
-    swap(js_context_group__     , other.js_context_group__);
+    swap(control_block__        , other.control_block__);
     swap(js_global_context_ref__, other.js_global_context_ref__);
   }
   
   JSContext::JSContext(const JSContextGroup& js_context_group, const JSClass& global_object_class) HAL_NOEXCEPT
-  : js_context_group__(js_context_group)
-  , js_global_context_ref__(JSGlobalContextCreateInGroup(static_cast<JSContextGroupRef>(js_context_group), static_cast<JSClassRef>(global_object_class))) {
+  : js_global_context_ref__(JSGlobalContextCreateInGroup(static_cast<JSContextGroupRef>(js_context_group), static_cast<JSClassRef>(global_object_class))) {
     HAL_LOG_TRACE("JSContext:: ctor 1 ", this);
     HAL_LOG_TRACE("JSContext:: retain ", js_global_context_ref__, " (implicit) for ", this);
+    control_block__ = std::make_shared<ControlBlock>(js_context_group, js_global_context_ref__);
+    
+    {
+      HAL_JSCONTEXT_REGISTRY_LOCK_GUARD;
+      ControlBlock::Register(control_block__);
+    }
+    
+    // No script has run yet, so the intrinsics are the built-in ones
+    // even if a script replaces them later.
+    for (std::size_t i = 0; i < kJSIntrinsicCount; ++i) {
+      get_intrinsic(static_cast<JSIntrinsic>(i));
+    }
+  }
+  
+  JSContext::JSContext(const std::shared_ptr<ControlBlock>& control_block) HAL_NOEXCEPT
+  : control_block__(control_block)
+  , js_global_context_ref__(control_block -> js_global_context_ref) {
+    HAL_LOG_TRACE("JSContext:: ctor 3 ", this);
   }
   
   JSContext::JSContext(JSContextRef js_context_ref) HAL_NOEXCEPT
@@ -316,14 +1497,10 @@ namespace HAL {
   
   // For interoperability with the JavaScriptCore C API.
   JSContext::JSContext(JSGlobalContextRef js_global_context_ref) HAL_NOEXCEPT
-  : js_context_group__(JSContextGetGroup(js_global_context_ref))
-  , js_global_context_ref__(js_global_context_ref) {
+  : js_global_context_ref__(js_global_context_ref) {
     HAL_LOG_TRACE("JSContext:: ctor 2 ", this);
     assert(js_global_context_ref__);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContext:: retain ", js_global_context_ref__, " for ", this);
-    JSGlobalContextRetain(js_global_context_ref__);
-#endif
+    control_block__ = ControlBlock::Get(js_global_context_ref__);
   }
   
 } // namespace HAL {
@@ -9,17 +9,45 @@
 #include "HAL/JSContextGroup.hpp"
 #include "HAL/JSContext.hpp"
 #include "HAL/JSClass.hpp"
+#include "HAL/JSFunction.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSContextGroupState.hpp"
+#include "HAL/detail/JSExportConstantCache.hpp"
+#include "HAL/detail/JSValueRetainRegistry.hpp"
 
 #include <cassert>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace HAL {
   
+  const char* to_string(JSQuotaResource resource) HAL_NOEXCEPT {
+    switch (resource) {
+      case JSQuotaResource::CPUTime:          return "cpu_time";
+      case JSQuotaResource::ProtectedHandles: return "protected_handles";
+      case JSQuotaResource::ExternalMemory:   return "external_memory";
+      case JSQuotaResource::QueuedTasks:      return "queued_tasks";
+    }
+    return "unknown";
+  }
+  
   JSContextGroup::JSContextGroup() HAL_NOEXCEPT
-  : js_context_group_ref__(JSContextGroupCreate()) {
+  : js_context_group_ref__(detail::CreateJSContextGroup())
+  , state__(detail::JSContextGroupState::Create(js_context_group_ref__, policy__)) {
     HAL_LOG_TRACE("JSContextGroup:: ctor 1 ", this);
     HAL_LOG_TRACE("JSContextGroup:: retain ", js_context_group_ref__, " (implicit) for ", this);
   }
   
+  JSContextGroup::JSContextGroup(JSContextGroupPolicy policy) HAL_NOEXCEPT
+  : policy__(policy)
+  , js_context_group_ref__(detail::CreateJSContextGroup())
+  , state__(detail::JSContextGroupState::Create(js_context_group_ref__, policy__)) {
+    HAL_LOG_TRACE("JSContextGroup:: ctor 3 ", this);
+    HAL_LOG_TRACE("JSContextGroup:: retain ", js_context_group_ref__, " (implicit) for ", this);
+  }
+  
   JSContext JSContextGroup::CreateContext() const HAL_NOEXCEPT {
     return JSContext(*this, JSClass());
   }
@@ -28,45 +56,217 @@ namespace HAL {
     return JSContext(*this, global_object_class);
   }
   
+#ifdef HAL_MEMORY_USAGE_STATISTICS_ENABLE
+  namespace {
+    
+    // The C API is used directly so that reading the statistics
+    // doesn't change the counts being reported.
+    std::size_t GetMemoryUsageStatistic(JSContextRef js_context_ref, JSObjectRef statistics_ref, const char* name) {
+      const auto name_ref  = detail::CreateJSStringWithUTF8CString(name);
+      const auto value_ref = JSObjectGetProperty(js_context_ref, statistics_ref, name_ref, nullptr);
+      JSStringRelease(name_ref);
+      const auto value = JSValueToNumber(js_context_ref, value_ref, nullptr);
+      return value > 0 ? static_cast<std::size_t>(value) : 0;
+    }
+    
+  } // namespace {
+#endif
+  
+  JSContextGroupStatistics JSContextGroup::GetStatistics() const {
+    JSContextGroupStatistics result;
+    
+    std::map<JSContextRef, JSContextStatistics> contexts;
+    detail::JSValueRetainRegistry::ForEachRegistry([this, &contexts](const detail::JSValueRetainRegistry& js_value_retain_registry) {
+      const auto js_context_ref = js_value_retain_registry.get_context_ref();
+      if (JSContextGetGroup(js_context_ref) != js_context_group_ref__) {
+        return;
+      }
+      
+      // Every JSContext wrapping the same JSGlobalContextRef shares one
+      // registry, but a context destroyed and made again at the same
+      // address may briefly have two.
+      auto& context = contexts[js_context_ref];
+      context.js_context_ref = js_context_ref;
+      context.value_count   += js_value_retain_registry.size();
+    });
+    
+    if (!contexts.empty()) {
+      JSObject::js_object_ref_registry__.ForEach([&contexts](JSContextRef js_context_ref, JSObjectRef, std::size_t, const std::string&, const std::string&) {
+        const auto position = contexts.find(js_context_ref);
+        if (position != contexts.end()) {
+          ++position -> second.object_count;
+        }
+      });
+    }
+    
+    result.contexts.reserve(contexts.size());
+    for (const auto& entry : contexts) {
+      result.value_count  += entry.second.value_count;
+      result.object_count += entry.second.object_count;
+      result.contexts.push_back(entry.second);
+    }
+    
+    result.function_callback_count = JSFunction::callback_count__.load(std::memory_order_relaxed);
+    {
+      HAL_JSOBJECT_LOCK_GUARD_STATIC;
+      result.private_data_count = JSObject::js_private_data_to_js_object_ref_map__.size();
+    }
+    result.cached_constant_count = detail::JSExportConstantCache::GetTotalSize();
+    
+#ifdef HAL_MEMORY_USAGE_STATISTICS_ENABLE
+    if (!contexts.empty()) {
+      const auto js_context_ref = contexts.begin() -> first;
+      const auto statistics_ref = JSGetMemoryUsageStatistics(js_context_ref);
+      if (statistics_ref) {
+        result.has_heap_statistics    = true;
+        result.heap_size              = GetMemoryUsageStatistic(js_context_ref, statistics_ref, "heapSize");
+        result.heap_capacity          = GetMemoryUsageStatistic(js_context_ref, statistics_ref, "heapCapacity");
+        result.extra_memory_size      = GetMemoryUsageStatistic(js_context_ref, statistics_ref, "extraMemorySize");
+        result.heap_object_count      = GetMemoryUsageStatistic(js_context_ref, statistics_ref, "objectCount");
+        result.protected_object_count = GetMemoryUsageStatistic(js_context_ref, statistics_ref, "protectedObjectCount");
+      }
+    }
+#endif
+    
+    const auto js_quota_state = get_quota_state();
+    result.has_quotas  = js_quota_state -> has_quotas();
+    result.quota_usage = js_quota_state -> GetUsage();
+    
+    return result;
+  }
+  
+  std::shared_ptr<detail::JSQuotaState> JSContextGroup::get_quota_state() const HAL_NOEXCEPT {
+    // Shares the ownership of the state it is part of.
+    return std::shared_ptr<detail::JSQuotaState>(state__, &state__ -> quota_state);
+  }
+  
+  void JSContextGroup::SetQuotas(const JSContextGroupQuotas& quotas) const {
+    const auto js_quota_state = get_quota_state();
+    js_quota_state -> SetQuotas(quotas);
+    
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+    const std::weak_ptr<detail::JSQuotaState> weak_js_quota_state = js_quota_state;
+    SetExecutionTimeLimit(quotas.check_interval_seconds, [weak_js_quota_state](const JSContext&) {
+      const auto js_quota_state = weak_js_quota_state.lock();
+      return js_quota_state && js_quota_state -> CheckRunning();
+    });
+#endif
+  }
+  
+  void JSContextGroup::ClearQuotas() const HAL_NOEXCEPT {
+    state__ -> quota_state.ClearQuotas();
+    
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+    ClearExecutionTimeLimit();
+#endif
+  }
+  
+  void JSContextGroup::ResetQuotaCPUTime() const HAL_NOEXCEPT {
+    state__ -> quota_state.ResetCPUTime();
+  }
+  
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+  namespace {
+    
+    // The callbacks of all context groups with an execution time limit,
+    // which JavaScriptCore holds only as raw pointers.
+    std::mutex& GetExecutionTimeLimitMutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+    
+    std::unordered_map<JSContextGroupRef, std::unique_ptr<JSExecutionTimeLimitCallback>>& GetExecutionTimeLimitCallbacks() {
+      static std::unordered_map<JSContextGroupRef, std::unique_ptr<JSExecutionTimeLimitCallback>> callbacks;
+      return callbacks;
+    }
+    
+    bool ShouldTerminate(JSContextRef js_context_ref, void* context) {
+      try {
+        return (*static_cast<JSExecutionTimeLimitCallback*>(context))(JSContext(js_context_ref));
+      } catch (...) {
+        // An exception can't unwind through JavaScriptCore, and a
+        // callback that failed can't vouch for the script.
+        return true;
+      }
+    }
+    
+  } // namespace {
+  
+  void JSContextGroup::SetExecutionTimeLimit(double limit_in_seconds, JSExecutionTimeLimitCallback callback) const {
+    std::unique_ptr<JSExecutionTimeLimitCallback> callback_ptr(callback ? new JSExecutionTimeLimitCallback(std::move(callback)) : nullptr);
+    
+    std::lock_guard<std::mutex> lock(GetExecutionTimeLimitMutex());
+    JSContextGroupSetExecutionTimeLimit(js_context_group_ref__, limit_in_seconds, callback_ptr ? ShouldTerminate : nullptr, callback_ptr.get());
+    
+    // The previous callback, if any, is destroyed only once
+    // JavaScriptCore no longer refers to it.
+    auto& callbacks = GetExecutionTimeLimitCallbacks();
+    if (callback_ptr) {
+      callbacks[js_context_group_ref__] = std::move(callback_ptr);
+    } else {
+      callbacks.erase(js_context_group_ref__);
+    }
+  }
+  
+  void JSContextGroup::ClearExecutionTimeLimit() const HAL_NOEXCEPT {
+    std::lock_guard<std::mutex> lock(GetExecutionTimeLimitMutex());
+    JSContextGroupClearExecutionTimeLimit(js_context_group_ref__);
+    GetExecutionTimeLimitCallbacks().erase(js_context_group_ref__);
+  }
+#endif
+  
   JSContextGroup::JSContextGroup(JSContextGroupRef js_context_group_ref) HAL_NOEXCEPT
   : js_context_group_ref__(js_context_group_ref) {
     HAL_LOG_TRACE("JSContextGroup:: ctor 2 ", this);
     assert(js_context_group_ref__);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContextGroup:: retain ", js_context_group_ref__, " for ", this);
-    JSContextGroupRetain(js_context_group_ref__);
-    managed__ = true;
-#endif
+    state__  = detail::JSContextGroupState::Get(js_context_group_ref__);
+    policy__ = state__ -> get_policy();
+    if (is_refcounted()) {
+      HAL_LOG_TRACE("JSContextGroup:: retain ", js_context_group_ref__, " for ", this);
+      JSContextGroupRetain(js_context_group_ref__);
+      managed__ = true;
+    }
   }
   
   JSContextGroup::~JSContextGroup() HAL_NOEXCEPT {
     HAL_LOG_TRACE("JSContextGroup:: dtor ", this);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContextGroup:: release ", js_context_group_ref__, " for ", this);
-    if (managed__) {
+    // managed__ is only ever set for the Refcounted policy.
+    if (managed__ && js_context_group_ref__) {
+      HAL_LOG_TRACE("JSContextGroup:: release ", js_context_group_ref__, " for ", this);
       JSContextGroupRelease(js_context_group_ref__);
     }
-#endif
   }
   
   JSContextGroup::JSContextGroup(const JSContextGroup& rhs) HAL_NOEXCEPT
-  : js_context_group_ref__(rhs.js_context_group_ref__) {
-    HAL_LOG_TRACE("JSContextGroup:: copy ctor ", this);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContextGroup:: retain ", js_context_group_ref__, " for ", this);
-    JSContextGroupRetain(js_context_group_ref__);
-    managed__ = true;
+  : policy__(rhs.policy__)
+  , js_context_group_ref__(rhs.js_context_group_ref__)
+  , state__(rhs.state__)
+#ifdef HAL_THREAD_AFFINITY
+  , owner_thread_id__(rhs.owner_thread_id__)
 #endif
+  {
+    HAL_LOG_TRACE("JSContextGroup:: copy ctor ", this);
+    if (is_refcounted()) {
+      HAL_LOG_TRACE("JSContextGroup:: retain ", js_context_group_ref__, " for ", this);
+      JSContextGroupRetain(js_context_group_ref__);
+      managed__ = true;
+    }
   }
   
   JSContextGroup::JSContextGroup(JSContextGroup&& rhs) HAL_NOEXCEPT
-  : js_context_group_ref__(rhs.js_context_group_ref__) {
-    HAL_LOG_TRACE("JSContextGroup:: move ctor ", this);
-#ifndef HAL_USE_SINGLE_CONTEXT
-    HAL_LOG_TRACE("JSContextGroup:: retain ", js_context_group_ref__, " for ", this);
-    JSContextGroupRetain(js_context_group_ref__);
-    managed__ = true;
+  : managed__(rhs.managed__)
+  , policy__(rhs.policy__)
+  , js_context_group_ref__(rhs.js_context_group_ref__)
+  , state__(std::move(rhs.state__))
+#ifdef HAL_THREAD_AFFINITY
+  , owner_thread_id__(rhs.owner_thread_id__)
 #endif
+  {
+    HAL_LOG_TRACE("JSContextGroup:: move ctor ", this);
+    // Take ownership of rhs's reference, leaving rhs empty so that its
+    // destructor does nothing.
+    rhs.managed__              = false;
+    rhs.js_context_group_ref__ = nullptr;
   }
   
   JSContextGroup& JSContextGroup::operator=(JSContextGroup rhs) HAL_NOEXCEPT {
@@ -83,7 +283,13 @@ namespace HAL {
     
     // By swapping the members of two classes, the two classes are
     // effectively swapped.
+    swap(managed__             , other.managed__);
+    swap(policy__              , other.policy__);
     swap(js_context_group_ref__, other.js_context_group_ref__);
+    swap(state__               , other.state__);
+#ifdef HAL_THREAD_AFFINITY
+    swap(owner_thread_id__     , other.owner_thread_id__);
+#endif
   }
   
 } // namespace HAL {
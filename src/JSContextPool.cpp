@@ -0,0 +1,190 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSContextPool.hpp"
+
+#include "HAL/JSMemoryPressure.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSPropertyNameArray.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+  
+  // A pooled context and the values of its globals right after
+  // initialization.
+  struct JSContextPool::Entry final {
+    
+    explicit Entry(const JSContext& js_context)
+    : js_context(js_context) {
+      const auto global_object = js_context.get_global_object();
+      for (const auto& property_name : global_object.GetPropertyNames()) {
+        initial_globals.emplace(property_name, global_object.GetProperty(property_name));
+      }
+    }
+    
+    // Return false if the context can't be returned to its initial
+    // state.
+    bool Reset() {
+      auto global_object = js_context.get_global_object();
+      for (const auto& property_name : global_object.GetPropertyNames()) {
+        if (initial_globals.find(property_name) == initial_globals.end() && !global_object.DeleteProperty(property_name)) {
+          return false;
+        }
+      }
+      
+      for (const auto& initial_global : initial_globals) {
+        if (!(global_object.GetProperty(initial_global.first) == initial_global.second)) {
+          global_object.SetProperty(initial_global.first, initial_global.second);
+        }
+      }
+      
+      return true;
+    }
+    
+    const JSContext                       js_context;
+    std::unordered_map<JSString, JSValue> initial_globals;
+  };
+  
+  struct JSContextPool::State final {
+    
+    State(const JSContextGroup& js_context_group, std::size_t capacity, JSContextPoolInitializer initializer, const JSClass& global_object_class)
+    : js_context_group(js_context_group)
+    , capacity(capacity)
+    , initializer(std::move(initializer))
+    , global_object_class(global_object_class) {
+      js_memory_pressure_handler_id = JSMemoryPressure::AddHandler([this](double fraction) {
+        return Evict(fraction);
+      });
+    }
+    
+    ~State() HAL_NOEXCEPT {
+      JSMemoryPressure::RemoveHandler(js_memory_pressure_handler_id);
+    }
+    
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+    
+    std::unique_ptr<Entry> CreateEntry() const {
+      const auto js_context = js_context_group.CreateContext(global_object_class);
+      if (initializer) {
+        initializer(js_context);
+      }
+      return std::unique_ptr<Entry>(new Entry(js_context));
+    }
+    
+    // Destroy fraction of the idle contexts, those returned to the pool
+    // longest ago first. Their heaps are freed by the next collection,
+    // so only the entries themselves are counted.
+    std::size_t Evict(double fraction) HAL_NOEXCEPT {
+      std::vector<std::unique_ptr<Entry>> evicted_entries;
+      {
+#ifdef HAL_THREAD_SAFE
+        std::lock_guard<detail::JSRecursiveMutex> lock(mutex);
+#endif
+        const auto count = JSMemoryPressure::GetEvictionCount(idle_entries.size(), fraction);
+        evicted_entries.reserve(count);
+        std::move(idle_entries.begin(), idle_entries.begin() + count, std::back_inserter(evicted_entries));
+        idle_entries.erase(idle_entries.begin(), idle_entries.begin() + count);
+      }
+      
+      std::size_t result = 0;
+      for (const auto& entry : evicted_entries) {
+        result += sizeof(Entry) + entry -> initial_globals.size() * (sizeof(std::pair<JSString, JSValue>) + 2 * sizeof(void*));
+      }
+      return result;
+    }
+    
+    const JSContextGroup                js_context_group;
+    const std::size_t                   capacity;
+    const JSContextPoolInitializer      initializer;
+    const JSClass                       global_object_class;
+    std::vector<std::unique_ptr<Entry>> idle_entries;
+    std::uint64_t                       js_memory_pressure_handler_id { 0 };
+    
+#undef  HAL_JSCONTEXTPOOL_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE
+    detail::JSRecursiveMutex mutex HAL_LOCK_CLASS_NAME(State, "JSContextPool");
+#define HAL_JSCONTEXTPOOL_LOCK_GUARD std::lock_guard<detail::JSRecursiveMutex> lock(state__ -> mutex)
+#else
+#define HAL_JSCONTEXTPOOL_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE
+  };
+  
+  JSContextPool::JSContextPool(const JSContextGroup& js_context_group, std::size_t capacity, JSContextPoolInitializer initializer)
+  : JSContextPool(js_context_group, capacity, std::move(initializer), JSClass()) {
+  }
+  
+  JSContextPool::JSContextPool(const JSContextGroup& js_context_group, std::size_t capacity, JSContextPoolInitializer initializer, const JSClass& global_object_class)
+  : state__(std::make_shared<State>(js_context_group, capacity, std::move(initializer), global_object_class)) {
+    state__ -> idle_entries.reserve(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      state__ -> idle_entries.push_back(state__ -> CreateEntry());
+    }
+  }
+  
+  JSContextPool::Lease JSContextPool::Acquire() {
+    {
+      HAL_JSCONTEXTPOOL_LOCK_GUARD;
+      if (!state__ -> idle_entries.empty()) {
+        auto entry = std::move(state__ -> idle_entries.back());
+        state__ -> idle_entries.pop_back();
+        return Lease(state__, std::move(entry));
+      }
+    }
+    
+    return Lease(state__, state__ -> CreateEntry());
+  }
+  
+  std::size_t JSContextPool::get_idle_count() const {
+    HAL_JSCONTEXTPOOL_LOCK_GUARD;
+    return state__ -> idle_entries.size();
+  }
+  
+  JSContextPool::Lease::Lease(const std::shared_ptr<State>& state, std::unique_ptr<Entry> entry)
+  : state__(state)
+  , entry__(std::move(entry))
+  , js_context__(entry__ -> js_context) {
+  }
+  
+  JSContextPool::Lease::Lease(Lease&& rhs) HAL_NOEXCEPT
+  : state__(std::move(rhs.state__))
+  , entry__(std::move(rhs.entry__))
+  , js_context__(rhs.js_context__)
+  , dirty__(rhs.dirty__) {
+  }
+  
+  JSContextPool::Lease::~Lease() HAL_NOEXCEPT {
+    if (!entry__ || dirty__) {
+      return;
+    }
+    
+    try {
+      if (!entry__ -> Reset()) {
+        return;
+      }
+    } catch (const std::exception&) {
+      // A global whose deletion throws leaves the context dirty.
+      return;
+    }
+    
+    HAL_JSCONTEXTPOOL_LOCK_GUARD;
+    if (state__ -> idle_entries.size() < state__ -> capacity) {
+      state__ -> idle_entries.push_back(std::move(entry__));
+    }
+  }
+  
+} // namespace HAL {
@@ -0,0 +1,67 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSContextTemplate.hpp"
+
+#include "HAL/JSObject.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <utility>
+
+namespace HAL {
+
+  JSContextTemplate::JSContextTemplate(const JSContextGroup& js_context_group)
+  : JSContextTemplate(js_context_group, JSClass()) {
+  }
+
+  JSContextTemplate::JSContextTemplate(const JSContextGroup& js_context_group, const JSClass& global_object_class)
+  : js_context_group__(js_context_group)
+  , global_object_class__(global_object_class) {
+  }
+
+  void JSContextTemplate::AddScript(const JSString& script, const JSString& source_url, int starting_line_number) {
+#ifdef HAL_SCRIPT_REF_ENABLE
+    AddScript(JSScript(js_context_group__, script, source_url, starting_line_number));
+#else
+    steps__.push_back([script, source_url, starting_line_number](const JSContext& js_context) {
+      js_context.ExecuteScript(script, source_url, starting_line_number);
+    });
+#endif
+  }
+
+#ifdef HAL_SCRIPT_REF_ENABLE
+  void JSContextTemplate::AddScript(const JSScript& js_script) {
+    if (js_script.get_context_group() != js_context_group__) {
+      detail::ThrowInvalidArgument("JSContextTemplate", "The script was parsed for another JSContextGroup.");
+    }
+
+    steps__.push_back([js_script](const JSContext& js_context) {
+      js_context.JSEvaluateScript(js_script);
+    });
+  }
+#endif
+
+  void JSContextTemplate::AddConstant(const JSString& name, const JSValue& value, JSPropertyAttributeSet attributes) {
+    steps__.push_back([name, value, attributes](const JSContext& js_context) {
+      js_context.get_global_object().SetProperty(name, JSContext::Clone(value, js_context), attributes);
+    });
+  }
+
+  void JSContextTemplate::AddInitializer(JSContextTemplateInitializer initializer) {
+    steps__.push_back(std::move(initializer));
+  }
+
+  JSContext JSContextTemplate::CreateContext() const {
+    const auto js_context = js_context_group__.CreateContext(global_object_class__);
+    for (const auto& step : steps__) {
+      step(js_context);
+    }
+    return js_context;
+  }
+
+} // namespace HAL {
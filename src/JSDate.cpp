@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <stdexcept>
 #include <cassert>
+#include <cmath>
 
 namespace HAL {
 
@@ -20,6 +21,44 @@ JSDate::JSDate(const JSContext& js_context, const std::vector<JSValue>& argument
 		: JSObject(js_context, MakeDate(js_context, arguments)) {
 }
 
+JSDate::JSDate(const JSContext& js_context, double milliseconds)
+		: JSObject(js_context, MakeDate(js_context, milliseconds)) {
+}
+
+std::chrono::system_clock::time_point JSDate::ToTimePoint() const {
+	const auto js_context_ref        = static_cast<JSContextRef>(js_context__);
+	const auto get_time_function_ref = js_context__.get_date_get_time_function();
+	if (!get_time_function_ref) {
+		detail::ThrowRuntimeError("JSDate", "Date.prototype.getTime is missing.");
+	}
+	
+	JSValueRef exception { nullptr };
+	const auto js_value_ref = JSObjectCallAsFunction(js_context_ref, get_time_function_ref, static_cast<JSObjectRef>(*this), 0, nullptr, &exception);
+	double milliseconds = exception ? 0 : JSValueToNumber(js_context_ref, js_value_ref, &exception);
+	if (exception) {
+		detail::ThrowRuntimeError("JSDate", JSValue(js_context__, exception));
+	}
+	
+	if (std::isnan(milliseconds)) {
+		detail::ThrowRuntimeError("JSDate", "The date is invalid.");
+	}
+	
+	return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(static_cast<std::int64_t>(milliseconds))));
+}
+
+JSObjectRef JSDate::MakeDate(const JSContext& js_context, double milliseconds) {
+	const auto js_context_ref = static_cast<JSContextRef>(js_context);
+	const JSValueRef arguments[] = { JSValueMakeNumber(js_context_ref, milliseconds) };
+	JSValueRef exception { nullptr };
+	const auto js_object_ref = JSObjectMakeDate(js_context_ref, 1, arguments, &exception);
+	if (exception) {
+		assert(!js_object_ref);
+		detail::ThrowRuntimeError("JSDate", JSValue(js_context, exception));
+	}
+	
+	return js_object_ref;
+}
+
 JSObjectRef JSDate::MakeDate(const JSContext& js_context, const std::vector<JSValue>& arguments) {
 	JSValueRef exception { nullptr };
 	JSObjectRef js_object_ref = nullptr;
@@ -12,6 +12,7 @@
 #include "HAL/JSString.hpp"
 #include "HAL/JSArray.hpp"
 #include "HAL/detail/JSUtil.hpp"
+#include "HAL/detail/JSAtoms.hpp"
 #include <vector>
 #include <algorithm>
 #include <stdexcept>
@@ -28,36 +29,36 @@ JSError::JSError(const JSContext& js_context, JSObjectRef js_object_ref)
 }
 
 std::string JSError::message() const {
-	if (HasProperty("message")) {
-		return static_cast<std::string>(GetProperty("message"));
+	if (HasProperty(detail::JSAtoms::message)) {
+		return static_cast<std::string>(GetProperty(detail::JSAtoms::message));
 	}
 	return "";
 }
 
 std::string JSError::name() const {
-	if (HasProperty("name")) {
-		return static_cast<std::string>(GetProperty("name"));
+	if (HasProperty(detail::JSAtoms::name)) {
+		return static_cast<std::string>(GetProperty(detail::JSAtoms::name));
 	}
 	return "";
 }
 
 std::string JSError::filename() const {
-	if (HasProperty("fileName")) {
-		return static_cast<std::string>(GetProperty("fileName"));
+	if (HasProperty(detail::JSAtoms::fileName)) {
+		return static_cast<std::string>(GetProperty(detail::JSAtoms::fileName));
 	}
 	return "";
 }
 
 std::uint32_t JSError::linenumber() const {
-	if (HasProperty("lineNumber")) {
-		return static_cast<std::uint32_t>(GetProperty("lineNumber"));
+	if (HasProperty(detail::JSAtoms::lineNumber)) {
+		return static_cast<std::uint32_t>(GetProperty(detail::JSAtoms::lineNumber));
 	}
 	return 0;
 }
 
 std::vector<JSValue> JSError::stack() const {
-	if (HasProperty("native_stack") && GetProperty("native_stack").IsObject()) {
-		const auto js_stack = static_cast<JSObject>(GetProperty("native_stack"));
+	if (HasProperty(detail::JSAtoms::native_stack) && GetProperty(detail::JSAtoms::native_stack).IsObject()) {
+		const auto js_stack = static_cast<JSObject>(GetProperty(detail::JSAtoms::native_stack));
 		if (js_stack.IsArray()) {
 			return static_cast<std::vector<JSValue>>(static_cast<JSArray>(js_stack));
 		}
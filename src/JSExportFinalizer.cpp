@@ -0,0 +1,94 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSExportFinalizer.hpp"
+#include "HAL/JSExportAllocator.hpp"
+
+#include <vector>
+
+// VS 2013's __declspec(thread) can't hold the queue.
+#if !defined(_MSC_VER) || _MSC_VER > 1800
+#define HAL_DETAIL_JSEXPORTFINALIZER_ENABLE
+#endif
+
+namespace HAL {
+
+#ifdef HAL_DETAIL_JSEXPORTFINALIZER_ENABLE
+  namespace {
+
+    // Set once the thread's queue is destroyed, after which objects
+    // finalized on the thread are destroyed right away.
+    HAL_THREAD_LOCAL bool pending_native_objects_destroyed = false;
+
+    struct PendingNativeObjects final {
+      ~PendingNativeObjects() HAL_NOEXCEPT {
+        pending_native_objects_destroyed = true;
+        while (! native_object_ptrs.empty()) {
+          const auto native_object_ptr = native_object_ptrs.back();
+          native_object_ptrs.pop_back();
+          detail::DestroyNativeObject(native_object_ptr);
+        }
+      }
+
+      std::vector<void*> native_object_ptrs;
+    };
+
+    thread_local PendingNativeObjects pending_native_objects;
+
+  } // namespace {
+#endif
+
+  std::size_t JSExportFinalizer::RunPending(std::size_t max_count) HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSEXPORTFINALIZER_ENABLE
+    if (pending_native_objects_destroyed) {
+      return 0;
+    }
+
+    // A destructor may drop the last reference to other deferred
+    // objects, which are then queued for the next batch.
+    auto& native_object_ptrs = pending_native_objects.native_object_ptrs;
+    std::size_t count = 0;
+    while (count < max_count && ! native_object_ptrs.empty()) {
+      const auto native_object_ptr = native_object_ptrs.back();
+      native_object_ptrs.pop_back();
+      detail::DestroyNativeObject(native_object_ptr);
+      ++count;
+    }
+    return count;
+#else
+    return 0;
+#endif
+  }
+
+  std::size_t JSExportFinalizer::get_pending_count() HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSEXPORTFINALIZER_ENABLE
+    return pending_native_objects_destroyed ? 0 : pending_native_objects.native_object_ptrs.size();
+#else
+    return 0;
+#endif
+  }
+
+  namespace detail {
+
+    void DeferNativeObjectDestruction(void* native_object_ptr) HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSEXPORTFINALIZER_ENABLE
+      if (! pending_native_objects_destroyed) {
+        try {
+          pending_native_objects.native_object_ptrs.push_back(native_object_ptr);
+          return;
+        } catch (...) {
+          // Without memory to queue it, destroy it now.
+        }
+      }
+#endif
+      DestroyNativeObject(native_object_ptr);
+    }
+
+  } // namespace detail {
+
+} // namespace HAL {
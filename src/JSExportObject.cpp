@@ -8,6 +8,7 @@
 
 #include "HAL/JSExportObject.hpp"
 #include "HAL/JSUndefined.hpp"
+#include "HAL/detail/JSExportClassInfo.hpp"
 #include <utility>
 
 namespace HAL {
@@ -30,9 +31,31 @@ namespace HAL {
   }
   
   JSObject JSExportObject::get_object() HAL_NOEXCEPT {
+    if (js_object_ref__) {
+      return JSObject(js_context__, js_object_ref__);
+    }
+    
+    // Fall back to the private data map for objects attached to a
+    // JSObject through JSObject::SetPrivate.
     return JSObject::FindJSObjectFromPrivateData(get_context(), this);
   }
   
+  void JSExportObject::set_external_memory_cost(std::size_t external_memory_cost) HAL_NOEXCEPT {
+    HAL_JSEXPORTOBJECT_LOCK_GUARD;
+    const auto byte_delta = static_cast<std::ptrdiff_t>(external_memory_cost) - static_cast<std::ptrdiff_t>(external_memory_cost__);
+    external_memory_cost__ = external_memory_cost;
+    if (byte_delta != 0) {
+      js_context__.AdjustExternalMemory(byte_delta);
+      if (class_info__) {
+        detail::AdjustJSExportClassExternalMemory(*class_info__, byte_delta);
+      }
+    }
+  }
+  
+  std::size_t JSExportObject::get_external_memory_cost() const HAL_NOEXCEPT {
+    return external_memory_cost__;
+  }
+  
   JSExportObject::JSExportObject(const JSContext& js_context) HAL_NOEXCEPT
   : js_context__(js_context) {
     HAL_LOG_DEBUG("JSExportObject:: ctor ", this);
@@ -40,15 +63,61 @@ namespace HAL {
   
   JSExportObject::~JSExportObject() HAL_NOEXCEPT {
     HAL_LOG_DEBUG("JSExportObject:: dtor ", this);
+    set_external_memory_cost(0);
     JSObject::UnRegisterPrivateData(this);
   }
   
+  JSExportObject::JSExportObject(const JSExportObject& rhs) HAL_NOEXCEPT
+  : js_context__(rhs.js_context__) {
+    HAL_LOG_DEBUG("JSExportObject:: copy ctor ", this);
+  }
+  
+  JSExportObject& JSExportObject::operator=(const JSExportObject& rhs) HAL_NOEXCEPT {
+    HAL_LOG_DEBUG("JSExportObject:: copy assignment ", this);
+    
+    // The external memory cost stays with this object, so it moves to
+    // the new context.
+    const auto external_memory_cost = external_memory_cost__;
+    set_external_memory_cost(0);
+    js_context__ = rhs.js_context__;
+    set_external_memory_cost(external_memory_cost);
+    return *this;
+  }
+  
   void JSExportObject::swap(JSExportObject& other) HAL_NOEXCEPT {
     using std::swap;
     
+    // The external memory costs stay with their objects, so they move
+    // to the swapped contexts.
+    const auto external_memory_cost       = external_memory_cost__;
+    const auto other_external_memory_cost = other.external_memory_cost__;
+    set_external_memory_cost(0);
+    other.set_external_memory_cost(0);
+    
     // By swapping the members of two classes, the two classes are
     // effectively swapped.
     swap(js_context__  , other.js_context__);
+    
+    set_external_memory_cost(external_memory_cost);
+    other.set_external_memory_cost(other_external_memory_cost);
   }
   
+  namespace detail {
+    void SetJSExportObjectRef(JSExportObject* js_export_object_ptr, JSObjectRef js_object_ref) HAL_NOEXCEPT {
+      js_export_object_ptr -> js_object_ref__ = js_object_ref;
+    }
+    
+    void SetJSExportObjectClassInfo(JSExportObject* js_export_object_ptr, const JSExportClassInfo* class_info) HAL_NOEXCEPT {
+      // A cost reported before the object got its class moves to it.
+      const auto external_memory_cost = js_export_object_ptr -> external_memory_cost__;
+      if (js_export_object_ptr -> class_info__ && external_memory_cost) {
+        AdjustJSExportClassExternalMemory(*js_export_object_ptr -> class_info__, -static_cast<std::ptrdiff_t>(external_memory_cost));
+      }
+      js_export_object_ptr -> class_info__ = class_info;
+      if (class_info && external_memory_cost) {
+        AdjustJSExportClassExternalMemory(*class_info, static_cast<std::ptrdiff_t>(external_memory_cost));
+      }
+    }
+  } // namespace detail {
+  
 } // namespace HAL {
@@ -0,0 +1,158 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSExportRegistry.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL {
+
+  namespace {
+
+    struct Entry {
+      JSString                          name;
+      JSExportRegistry::ObjectFactory   factory;
+      JSPropertyAttributeSet            attributes;
+    };
+
+    // Entries are never removed, so the lazy getters of every
+    // JSContext can point at them.
+    std::unordered_map<std::string, std::unique_ptr<Entry>>& GetEntries() {
+      static std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+      return entries;
+    }
+
+#ifdef HAL_THREAD_SAFE_STATICS
+    detail::JSMutex& GetMutex() {
+      static detail::JSMutex mutex HAL_LOCK_NAME("JSExportRegistry");
+      return mutex;
+    }
+#define HAL_JSEXPORTREGISTRY_LOCK_GUARD std::lock_guard<detail::JSMutex> lock(GetMutex())
+#else
+#define HAL_JSEXPORTREGISTRY_LOCK_GUARD
+#endif
+
+    // Called as the getter of a registered name. Creates the object,
+    // then replaces the accessor with a data property holding it.
+    JSValueRef LazyGetterCallback(JSContextRef js_context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t, const JSValueRef[], JSValueRef* exception) {
+      const auto entry = static_cast<const Entry*>(JSObjectGetPrivate(function_ref));
+      try {
+        JSExportRegistry::ObjectFactory factory { nullptr };
+        JSPropertyAttributeSet          attributes;
+        {
+          HAL_JSEXPORTREGISTRY_LOCK_GUARD;
+          factory    = entry -> factory;
+          attributes = entry -> attributes;
+        }
+
+        const JSContext js_context(js_context_ref);
+        const auto      js_value     = static_cast<JSValue>(factory(js_context));
+        const auto      js_value_ref = static_cast<JSValueRef>(js_value);
+        const auto      name_ref     = static_cast<JSStringRef>(entry -> name);
+        if (this_object_ref) {
+          JSObjectDeleteProperty(js_context_ref, this_object_ref, name_ref, exception);
+          JSObjectSetProperty(js_context_ref, this_object_ref, name_ref, js_value_ref, detail::ToJSPropertyAttributes(attributes), exception);
+        }
+
+        return js_value_ref;
+      } catch (const std::exception& e) {
+        const JSString message(e.what());
+        const JSValueRef arguments[] = { JSValueMakeString(js_context_ref, static_cast<JSStringRef>(message)) };
+        *exception = JSObjectMakeError(js_context_ref, 1, arguments, nullptr);
+      } catch (...) {
+        const JSString message("unknown exception");
+        const JSValueRef arguments[] = { JSValueMakeString(js_context_ref, static_cast<JSStringRef>(message)) };
+        *exception = JSObjectMakeError(js_context_ref, 1, arguments, nullptr);
+      }
+
+      return JSValueMakeUndefined(js_context_ref);
+    }
+
+    JSClassRef GetLazyGetterClass() {
+      static JSClassRef     js_class_ref { nullptr };
+      static std::once_flag of;
+      std::call_once(of, []() {
+        ::JSClassDefinition js_class_definition = kJSClassDefinitionEmpty;
+        js_class_definition.className           = "JSExportRegistryLazyGetter";
+        js_class_definition.callAsFunction      = LazyGetterCallback;
+        js_class_ref                            = detail::CreateJSClass(&js_class_definition);
+      });
+
+      return js_class_ref;
+    }
+
+  } // namespace {
+
+  void JSExportRegistry::Register(const std::string& name, ObjectFactory factory, JSPropertyAttributeSet attributes) {
+    if (name.empty()) {
+      detail::ThrowInvalidArgument("JSExportRegistry", "name is missing");
+    }
+
+    if (!factory) {
+      detail::ThrowInvalidArgument("JSExportRegistry", "factory is missing");
+    }
+
+    HAL_JSEXPORTREGISTRY_LOCK_GUARD;
+    auto& entry = GetEntries()[name];
+    if (entry) {
+      entry -> factory    = factory;
+      entry -> attributes = attributes;
+    } else {
+      entry.reset(new Entry { JSString(name), factory, attributes });
+    }
+  }
+
+  bool JSExportRegistry::IsRegistered(const std::string& name) {
+    HAL_JSEXPORTREGISTRY_LOCK_GUARD;
+    return GetEntries().count(name) > 0;
+  }
+
+  std::size_t JSExportRegistry::size() {
+    HAL_JSEXPORTREGISTRY_LOCK_GUARD;
+    return GetEntries().size();
+  }
+
+  void JSExportRegistry::Install(const JSContext& js_context) {
+    const auto js_context_ref  = static_cast<JSContextRef>(js_context);
+    auto       global_object   = js_context.get_global_object();
+    auto       object          = js_context.GetIntrinsic(JSIntrinsic::Object);
+    auto       define_property = static_cast<JSObject>(object.GetProperty("defineProperty"));
+
+    std::vector<Entry*> entries;
+    {
+      HAL_JSEXPORTREGISTRY_LOCK_GUARD;
+      entries.reserve(GetEntries().size());
+      for (const auto& name_entry : GetEntries()) {
+        entries.push_back(name_entry.second.get());
+      }
+    }
+
+    const JSString get_name("get");
+    const JSString configurable_name("configurable");
+    const JSString enumerable_name("enumerable");
+    for (const auto entry : entries) {
+      const JSValue getter(js_context, JSObjectMake(js_context_ref, GetLazyGetterClass(), entry));
+
+      // The accessor must be configurable so that the getter can
+      // replace it.
+      auto descriptor = js_context.CreateObject();
+      descriptor.SetProperty(get_name, getter);
+      descriptor.SetProperty(configurable_name, js_context.CreateBoolean(true));
+      descriptor.SetProperty(enumerable_name, js_context.CreateBoolean(!entry -> attributes.Contains(JSPropertyAttribute::DontEnum)));
+
+      define_property({global_object, js_context.CreateString(entry -> name), descriptor}, object);
+    }
+  }
+
+} // namespace HAL {
@@ -10,6 +10,11 @@
 #include "HAL/JSString.hpp"
 #include "HAL/JSValue.hpp"
 #include "HAL/JSUndefined.hpp"
+#include "HAL/JSArguments.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include "HAL/detail/JSCPUTimeScope.hpp"
+#include "HAL/detail/JSCallbackRecordScope.hpp"
+#include "HAL/detail/JSStackSample.hpp"
 #include "HAL/detail/JSUtil.hpp"
 #include <vector>
 #include <algorithm>
@@ -22,8 +27,21 @@ JSFunction::JSFunction(const JSContext& js_context, const JSString& body, const
         : JSObject(js_context, MakeFunction(js_context, body, parameter_names, function_name, source_url, starting_line_number)) {
 }
 
+struct JSFunction::CallbackData final {
+    JSFunctionCallback          callback;
+    JSFunctionArgumentsCallback arguments_callback;
+};
+
 JSFunction::JSFunction(const JSContext& js_context, const JSString& function_name, const JSFunctionCallback& callback)
-        : JSObject(js_context, MakeFunction(js_context, function_name, callback)) {
+        : JSObject(js_context, MakeFunction(js_context, function_name, new CallbackData { callback, nullptr })) {
+}
+
+JSFunction::JSFunction(const JSContext& js_context, const JSString& function_name, const JSFunctionArgumentsCallback& callback)
+        : JSObject(js_context, MakeFunction(js_context, function_name, new CallbackData { nullptr, callback })) {
+}
+
+JSFunction::JSFunction(const JSContext& js_context, JSObjectRef js_object_ref)
+        : JSObject(js_context, js_object_ref) {
 }
 
 JSObjectRef JSFunction::MakeFunction(const JSContext& js_context, const JSString& body, const std::vector<JSString>& parameter_names, const JSString& func_name, const JSString& source_url, int starting_line_number) {
@@ -53,67 +71,68 @@ JSObjectRef JSFunction::MakeFunction(const JSContext& js_context, const JSString
     return js_object_ref;
 }
 
-std::unordered_map<std::intptr_t, JSFunctionCallback> JSFunction::js_object_ref_to_js_function__;
+std::atomic<std::size_t> JSFunction::callback_count__ { 0 };
 
-void JSFunction::RegisterJSFunctionCallback(JSObjectRef js_object_ref, JSFunctionCallback callback) {
-    HAL_JSOBJECT_LOCK_GUARD_STATIC;
-    const auto key   = reinterpret_cast<std::intptr_t>(js_object_ref);
-    const auto value = callback;
-    const auto position = js_object_ref_to_js_function__.find(key);
-    const bool found    = position != js_object_ref_to_js_function__.end();
-    
-    if (found) {
-      HAL_LOG_DEBUG("JSFunction::RegisterJSFunctionCallback: JSObjectRef ", js_object_ref, " already registered");
-    } else {
-      const auto insert_result = js_object_ref_to_js_function__.emplace(key, value);
-      const bool inserted      = insert_result.second;
-      
-      assert(inserted);
-    }
-}
-
-void JSFunction::UnRegisterJSFunctionCallback(JSObjectRef js_object_ref) {
-    HAL_JSOBJECT_LOCK_GUARD_STATIC;
-    const auto key = reinterpret_cast<std::intptr_t>(js_object_ref);
-    js_object_ref_to_js_function__.erase(key);
-}
-
-JSFunctionCallback JSFunction::FindJSFunctionCallback(JSObjectRef js_object_ref) {
-    HAL_JSOBJECT_LOCK_GUARD_STATIC;
-    const auto key      = reinterpret_cast<std::intptr_t>(js_object_ref);
-    const auto position = js_object_ref_to_js_function__.find(key);
-    const bool found    = position != js_object_ref_to_js_function__.end();
-    
-    if (found) {
-      return position->second;
-    } else {
-        return nullptr;
-    }
+JSClassRef JSFunction::GetCallbackClass() {
+    // Like the JSClasses of JSExport classes this lives as long as the
+    // process.
+    static const JSClassRef js_class_ref = [] {
+        ::JSClassDefinition definition = kJSClassDefinitionEmpty;
+        definition.className      = "Function";
+        definition.callAsFunction = JSFunction::JSObjectCallAsFunctionCallback;
+        definition.finalize       = JSFunction::JSObjectFinalizeCallback;
+        return detail::CreateJSClass(&definition);
+    }();
+    return js_class_ref;
 }
 
 JSValueRef JSFunction::JSObjectCallAsFunctionCallback(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef this_object_ref, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) {
-    const auto callback = FindJSFunctionCallback(function_ref);
-    if (callback == nullptr) {
+    const auto callback_data = static_cast<const CallbackData*>(JSObjectGetPrivate(function_ref));
+    if (callback_data == nullptr) {
         return JSValueMakeUndefined(context_ref);
     }
-    const auto ctx = JSContext(context_ref);
-    std::vector<JSValue> arguments;
-    arguments.reserve(argument_count);
-    for (size_t i = 0; i < argument_count; i++) {
-        arguments.push_back(JSValue(ctx, arguments_array[i]));
+    HAL_STACK_SAMPLE(context_ref, "JSFunction", "JSFunctionCallback");
+    HAL_NATIVE_CPU_TIME_SCOPE(context_ref);
+    HAL_CALLBACK_RECORD(CallAsFunction, "JSFunction", nullptr, nullptr, context_ref, argument_count, arguments_array);
+    const JSArguments arguments(context_ref, argument_count, arguments_array, exception);
+    try {
+        const auto ctx = JSContext(context_ref);
+        auto this_object = JSObject(ctx, this_object_ref);
+        if (callback_data->arguments_callback) {
+            return static_cast<JSValueRef>(callback_data->arguments_callback(arguments, this_object));
+        }
+        return static_cast<JSValueRef>(callback_data->callback(detail::to_vector(ctx, argument_count, arguments_array), this_object));
+    } catch (const std::exception& e) {
+        // A C++ exception must not unwind through JavaScriptCore.
+        arguments.SetError(e.what());
     }
-    auto this_object = JSObject(ctx, this_object_ref);
-    return static_cast<JSValueRef>(callback(arguments, this_object));
+    return JSValueMakeUndefined(context_ref);
+}
+
+void JSFunction::JSObjectFinalizeCallback(JSObjectRef function_ref) {
+    delete static_cast<CallbackData*>(JSObjectGetPrivate(function_ref));
+    callback_count__.fetch_sub(1, std::memory_order_relaxed);
 }
 
-JSObjectRef JSFunction::MakeFunction(const JSContext& js_context, const JSString& function_name, const JSFunctionCallback& callback) {
-    JSObjectRef js_object_ref = JSObjectMakeFunctionWithCallback(static_cast<JSContextRef>(js_context), static_cast<JSStringRef>(function_name), JSFunction::JSObjectCallAsFunctionCallback);
-    JSFunction::RegisterJSFunctionCallback(js_object_ref, callback);
+JSObjectRef JSFunction::MakeFunction(const JSContext& js_context, const JSString& function_name, CallbackData* callback_data) {
+    const auto js_context_ref = static_cast<JSContextRef>(js_context);
+    JSObjectRef js_object_ref = JSObjectMake(js_context_ref, GetCallbackClass(), callback_data);
+    callback_count__.fetch_add(1, std::memory_order_relaxed);
+
+    // Define name before the prototype is set, since it can't be
+    // defined over the read only name of Function.prototype.
+    if (function_name.length() > 0) {
+        JSObjectSetProperty(js_context_ref, js_object_ref, static_cast<JSStringRef>(detail::JSAtoms::name), JSValueMakeString(js_context_ref, static_cast<JSStringRef>(function_name)), kJSPropertyAttributeReadOnly | kJSPropertyAttributeDontEnum, nullptr);
+    }
+
+    // So that call, apply and bind work as for any function.
+    if (const auto function_prototype = js_context.get_function_prototype()) {
+        JSObjectSetPrototype(js_context_ref, js_object_ref, function_prototype);
+    }
     return js_object_ref;
 }
 
 JSFunction::~JSFunction() HAL_NOEXCEPT {
-    JSFunction::UnRegisterJSFunctionCallback(js_object_ref__);
 }
     
 } // namespace HAL {
@@ -0,0 +1,120 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSHandleScope.hpp"
+#include "HAL/JSArena.hpp"
+#include "HAL/detail/JSValueRetainRegistry.hpp"
+
+#include <atomic>
+#include <cassert>
+
+namespace {
+  // The innermost active JSHandleScope on this thread.
+  HAL_THREAD_LOCAL HAL::JSHandleScope* current_js_handle_scope__ = nullptr;
+  
+  // The last id handed out. Ids are unique across threads and never
+  // reused, so that a JSValue can tell whether the scope it was
+  // tracked by is still alive, wherever that scope was opened.
+  std::atomic<std::uint64_t> last_js_handle_scope_id__ { 0 };
+}
+
+namespace HAL {
+
+  JSHandleScope::JSHandleScope() HAL_NOEXCEPT
+  : previous__(current_js_handle_scope__)
+  , id__(NextId()) {
+    HAL_LOG_TRACE("JSHandleScope:: ctor ", this, " id = ", id__);
+    current_js_handle_scope__ = this;
+  }
+
+  JSHandleScope::~JSHandleScope() HAL_NOEXCEPT {
+    HAL_LOG_TRACE("JSHandleScope:: dtor ", this, " id = ", id__, " size = ", size__);
+
+    // Scopes must be destroyed in the reverse order of construction,
+    // which is guaranteed for stack objects.
+    assert(current_js_handle_scope__ == this);
+    current_js_handle_scope__ = previous__;
+
+    // Any JSValue still referencing a slot has escaped this scope, so
+    // hand its remaining references to the ordinary protected path. The
+    // escaped JSValue keeps its JSContext, and so the registry, alive.
+    for (std::size_t i = 0; i < size__; ++i) {
+      const auto& slot = slots__[i];
+      if (slot.count > 0) {
+        HAL_LOG_DEBUG("JSHandleScope:: promote ", slot.js_value_ref, " count = ", slot.count);
+        slot.js_value_retain_registry -> Retain(slot.js_context_ref, slot.js_value_ref, slot.count);
+      }
+    }
+  }
+
+  std::uint64_t JSHandleScope::NextId() HAL_NOEXCEPT {
+    return last_js_handle_scope_id__.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  bool JSHandleScope::Track(detail::JSValueRetainRegistry* js_value_retain_registry, JSContextRef js_context_ref, JSValueRef js_value_ref, std::uint64_t& scope_id, std::uint32_t& slot) HAL_NOEXCEPT {
+    const auto scope          = current_js_handle_scope__;
+    const bool scope_has_room = scope && scope -> size__ < kCapacity;
+    if (!(scope_has_room && scope -> id__ > JSArena::GetCurrentId()) && JSArena::Track(js_value_retain_registry, js_context_ref, js_value_ref, scope_id, slot)) {
+      return true;
+    }
+
+    if (!scope_has_room) {
+      return false;
+    }
+
+    const auto index = scope -> size__++;
+    scope -> slots__[index] = Slot { js_value_retain_registry, js_context_ref, js_value_ref, 1 };
+    scope_id = scope -> id__;
+    slot     = static_cast<std::uint32_t>(index);
+    return true;
+  }
+
+  bool JSHandleScope::Retain(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT {
+    if (JSArena::IsArenaId(scope_id)) {
+      return JSArena::Retain(scope_id, slot);
+    }
+
+    const auto scope = Find(scope_id);
+    if (!scope) {
+      return false;
+    }
+
+    assert(slot < scope -> size__);
+    ++scope -> slots__[slot].count;
+    return true;
+  }
+
+  bool JSHandleScope::Release(std::uint64_t scope_id, std::uint32_t slot) HAL_NOEXCEPT {
+    if (JSArena::IsArenaId(scope_id)) {
+      return JSArena::Release(scope_id, slot);
+    }
+
+    const auto scope = Find(scope_id);
+    if (!scope) {
+      return false;
+    }
+
+    assert(slot < scope -> size__);
+    assert(scope -> slots__[slot].count > 0);
+    --scope -> slots__[slot].count;
+    return true;
+  }
+
+  JSHandleScope* JSHandleScope::Find(std::uint64_t scope_id) HAL_NOEXCEPT {
+    // Ids increase with nesting depth, so stop as soon as we pass the
+    // one we are looking for. Scopes are rarely nested more than a few
+    // levels deep.
+    for (auto scope = current_js_handle_scope__; scope && scope -> id__ >= scope_id; scope = scope -> previous__) {
+      if (scope -> id__ == scope_id) {
+        return scope;
+      }
+    }
+    return nullptr;
+  }
+
+} // namespace HAL {
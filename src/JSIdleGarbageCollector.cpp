@@ -0,0 +1,117 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSIdleGarbageCollector.hpp"
+
+#include "HAL/JSContext.hpp"
+
+#include <algorithm>
+
+namespace HAL {
+
+  struct JSIdleGarbageCollector::State final {
+
+    typedef std::chrono::steady_clock Clock;
+
+    State(const JSContext& js_context, const JSIdleGarbageCollectorOptions& options)
+    : options(options)
+    , full_collection_allocation_count(js_context.get_value_allocation_count())
+    , eden_collection_allocation_count(full_collection_allocation_count)
+    , full_collection_external_memory_size(js_context.get_external_memory_size()) {
+    }
+
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+
+    void OnIdle(const JSContext& js_context, Clock::time_point idle_deadline) {
+      const auto now = Clock::now();
+      if (now < defer_until) {
+        return;
+      }
+
+      const auto idle_time             = idle_deadline - now;
+      const auto allocation_count      = js_context.get_value_allocation_count();
+      const auto external_memory_size  = js_context.get_external_memory_size();
+      const auto full_allocations      = allocation_count - full_collection_allocation_count;
+      const auto eden_allocations      = allocation_count - eden_collection_allocation_count;
+      const auto external_memory_delta = external_memory_size > full_collection_external_memory_size ? external_memory_size - full_collection_external_memory_size : 0;
+
+      // A collection that took longer than its budget last time won't
+      // fit in a gap of the budget this time either.
+      const auto full_collection_budget = std::max(options.full_collection_budget, last_full_collection_duration);
+      const bool full_collection_due    = full_allocations      >= options.full_collection_allocation_threshold
+                                       || external_memory_delta >= options.full_collection_external_memory_threshold
+                                       || ((full_allocations > 0 || external_memory_delta > 0) && now - last_full_collection_time >= options.maximum_interval);
+
+      if (full_collection_due && idle_time >= full_collection_budget) {
+        js_context.GarbageCollect();
+        const auto end = Clock::now();
+        last_full_collection_duration        = end - now;
+        last_full_collection_time            = end;
+        full_collection_allocation_count     = allocation_count;
+        eden_collection_allocation_count     = allocation_count;
+        full_collection_external_memory_size = external_memory_size;
+        ++full_collection_count;
+        return;
+      }
+
+#ifdef DEBUG
+      if (eden_allocations >= options.eden_collection_allocation_threshold && idle_time >= options.eden_collection_budget) {
+        js_context.SynchronousEdenCollectForDebugging();
+        eden_collection_allocation_count = allocation_count;
+        ++eden_collection_count;
+      }
+#else
+      static_cast<void>(eden_allocations);
+#endif
+    }
+
+    const JSIdleGarbageCollectorOptions options;
+
+    Clock::time_point defer_until;
+    Clock::time_point last_full_collection_time { Clock::now() };
+    Clock::duration   last_full_collection_duration { Clock::duration::zero() };
+
+    // The JSContext counters at the last collections.
+    std::uint64_t full_collection_allocation_count;
+    std::uint64_t eden_collection_allocation_count;
+    std::size_t   full_collection_external_memory_size;
+
+    std::size_t full_collection_count { 0 };
+    std::size_t eden_collection_count { 0 };
+  };
+
+  JSIdleGarbageCollector::JSIdleGarbageCollector(const JSRunLoop& js_run_loop, const JSIdleGarbageCollectorOptions& options)
+  : state__(std::make_shared<State>(js_run_loop.get_context(), options)) {
+    // The run loop keeps the handler, so it must not keep the state
+    // alive.
+    const std::weak_ptr<State> weak_state = state__;
+    js_run_loop.set_idle_handler([weak_state](const JSContext& js_context, std::chrono::steady_clock::time_point idle_deadline) {
+      if (const auto state = weak_state.lock()) {
+        state -> OnIdle(js_context, idle_deadline);
+      }
+    });
+  }
+
+  void JSIdleGarbageCollector::DeferUntil(std::chrono::steady_clock::time_point time_point) const HAL_NOEXCEPT {
+    state__ -> defer_until = time_point;
+  }
+
+  std::size_t JSIdleGarbageCollector::get_full_collection_count() const HAL_NOEXCEPT {
+    return state__ -> full_collection_count;
+  }
+
+  std::size_t JSIdleGarbageCollector::get_eden_collection_count() const HAL_NOEXCEPT {
+    return state__ -> eden_collection_count;
+  }
+
+  JSIdleGarbageCollectorOptions JSIdleGarbageCollector::get_options() const HAL_NOEXCEPT {
+    return state__ -> options;
+  }
+
+} // namespace HAL {
@@ -0,0 +1,166 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSMemoryPressure.hpp"
+
+#include "HAL/JSContext.hpp"
+#include "HAL/JSContextGroup.hpp"
+#include "HAL/JSExportFinalizer.hpp"
+
+#include "HAL/detail/JSExportConstantCache.hpp"
+#include "HAL/detail/JSFunctionCache.hpp"
+#include "HAL/detail/JSRegExpCache.hpp"
+#include "HAL/detail/JSTraceScope.hpp"
+
+#include <exception>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace HAL {
+
+  namespace {
+
+    // The handlers are called with the lock held, so that RemoveHandler
+    // on another thread waits until a handler being called returns, and
+    // a handler may remove itself.
+    struct HandlerRegistry final {
+      detail::JSRecursiveMutex                          mutex HAL_LOCK_NAME("JSMemoryPressure");
+      std::uint64_t                                     next_id { 1 };
+      std::map<std::uint64_t, JSMemoryPressureHandler> handlers;
+    };
+
+    // A function local static, since a JSScriptCache or JSContextPool
+    // may itself be a static.
+    HandlerRegistry& GetHandlerRegistry() {
+      static HandlerRegistry registry;
+      return registry;
+    }
+
+    std::size_t CallHandlers(double fraction) HAL_NOEXCEPT {
+      auto& registry = GetHandlerRegistry();
+      std::lock_guard<detail::JSRecursiveMutex> lock(registry.mutex);
+
+      std::vector<std::uint64_t> ids;
+      ids.reserve(registry.handlers.size());
+      for (const auto& entry : registry.handlers) {
+        ids.push_back(entry.first);
+      }
+
+      std::size_t result = 0;
+      for (const auto id : ids) {
+        // An earlier handler may have removed this one.
+        const auto position = registry.handlers.find(id);
+        if (position == registry.handlers.end()) {
+          continue;
+        }
+
+        const auto handler = position -> second;
+        try {
+          result += handler(fraction);
+        } catch (const std::exception& e) {
+          HAL_LOG_ERROR("JSMemoryPressure: handler threw ", e.what());
+        } catch (...) {
+          HAL_LOG_ERROR("JSMemoryPressure: handler threw an unknown exception");
+        }
+      }
+
+      return result;
+    }
+
+  } // namespace {
+
+  JSMemoryPressureResult JSMemoryPressure::Respond(JSMemoryPressureLevel level) {
+    HAL_TRACE_SCOPE("gc", "JSMemoryPressure", nullptr);
+    const auto fraction = GetEvictionFraction(level);
+    JSMemoryPressureResult result;
+
+    // One JSContext per context group, to collect the group through.
+    std::vector<JSContext> js_contexts;
+    {
+      auto live_contexts = JSContext::GetLiveContexts();
+      std::set<JSContextGroupRef> seen_groups;
+      for (auto& js_context : live_contexts) {
+        const auto js_context_group_ref = static_cast<JSContextGroupRef>(js_context.get_context_group());
+        if (seen_groups.insert(js_context_group_ref).second) {
+          js_contexts.push_back(js_context);
+        }
+
+        // With HAL_THREAD_SAFE each cache takes its own lock, since
+        // its context may be in use on another thread.
+        result.cache_bytes_reclaimed += js_context.get_js_function_cache().Evict(fraction);
+        result.cache_bytes_reclaimed += js_context.get_js_regexp_cache().Evict(fraction);
+      }
+    }
+
+#ifdef HAL_MEMORY_USAGE_STATISTICS_ENABLE
+    std::vector<std::size_t> heap_sizes_before;
+    heap_sizes_before.reserve(js_contexts.size());
+    for (const auto& js_context : js_contexts) {
+      heap_sizes_before.push_back(js_context.get_context_group().GetStatistics().heap_size);
+    }
+#endif
+
+    result.cache_bytes_reclaimed += detail::JSExportConstantCache::EvictAll(fraction);
+    result.cache_bytes_reclaimed += CallHandlers(fraction);
+
+    // Destroy queued native objects before collecting, so that the
+    // wrappers they held may be collected too.
+    result.finalized_count = JSExportFinalizer::RunPending();
+
+    for (const auto& js_context : js_contexts) {
+      js_context.GarbageCollect();
+    }
+    result.collected_context_group_count = js_contexts.size();
+
+#ifdef HAL_MEMORY_USAGE_STATISTICS_ENABLE
+    for (std::size_t i = 0; i < js_contexts.size(); ++i) {
+      const auto statistics = js_contexts[i].get_context_group().GetStatistics();
+      if (!statistics.has_heap_statistics) {
+        continue;
+      }
+      result.has_heap_statistics = true;
+      if (heap_sizes_before[i] > statistics.heap_size) {
+        result.heap_bytes_reclaimed += heap_sizes_before[i] - statistics.heap_size;
+      }
+    }
+#endif
+
+    HAL_LOG_DEBUG("JSMemoryPressure: reclaimed ", result.cache_bytes_reclaimed, " cache bytes and ", result.heap_bytes_reclaimed, " heap bytes, finalized ", result.finalized_count, " objects");
+    return result;
+  }
+
+  std::uint64_t JSMemoryPressure::AddHandler(JSMemoryPressureHandler handler) {
+    auto& registry = GetHandlerRegistry();
+    std::lock_guard<detail::JSRecursiveMutex> lock(registry.mutex);
+    const auto id = registry.next_id++;
+    registry.handlers.emplace(id, std::move(handler));
+    return id;
+  }
+
+  void JSMemoryPressure::RemoveHandler(std::uint64_t id) HAL_NOEXCEPT {
+    auto& registry = GetHandlerRegistry();
+    std::lock_guard<detail::JSRecursiveMutex> lock(registry.mutex);
+    registry.handlers.erase(id);
+  }
+
+  double JSMemoryPressure::GetEvictionFraction(JSMemoryPressureLevel level) HAL_NOEXCEPT {
+    switch (level) {
+      case JSMemoryPressureLevel::Low:
+        return 0.25;
+      case JSMemoryPressureLevel::Moderate:
+        return 0.5;
+      case JSMemoryPressureLevel::Critical:
+        return 1.0;
+    }
+    return 1.0;
+  }
+
+} // namespace HAL {
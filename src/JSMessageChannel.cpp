@@ -0,0 +1,198 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSMessageChannel.hpp"
+
+#include "HAL/detail/JSSerializedValue.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace HAL {
+
+  // Each port has an inbox of the messages posted to it. The first
+  // message posted to an empty inbox posts a delivery task to the
+  // port's run loop, and that task delivers messages until the inbox
+  // is empty again.
+  struct JSMessagePort::State final : public std::enable_shared_from_this<JSMessagePort::State> {
+
+    struct Port final {
+      explicit Port(const JSRunLoop& run_loop)
+      : run_loop(run_loop) {
+      }
+
+      JSRunLoop run_loop;
+
+      // Only used on the run loop's thread.
+      JSMessageHandler message_handler;
+
+      std::mutex                                              mutex;
+      std::deque<std::unique_ptr<detail::JSSerializedValue>> inbox;
+      bool                                                    delivery_posted { false };
+    };
+
+    State(const JSRunLoop& run_loop_1, const JSRunLoop& run_loop_2)
+    : port1(run_loop_1)
+    , port2(run_loop_2) {
+    }
+
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+
+    Port& get_port(std::size_t index) HAL_NOEXCEPT {
+      return index == 0 ? port1 : port2;
+    }
+
+    void Enqueue(std::size_t index, std::unique_ptr<detail::JSSerializedValue> message) {
+      if (closed.load(std::memory_order_acquire)) {
+        return;
+      }
+
+      auto& port = get_port(index);
+      {
+        std::lock_guard<std::mutex> lock(port.mutex);
+        port.inbox.push_back(std::move(message));
+        if (port.delivery_posted) {
+          return;
+        }
+        port.delivery_posted = true;
+      }
+      PostDelivery(index);
+    }
+
+    // The task holds the state weakly, since the state holds the run
+    // loop whose queue holds the task.
+    void PostDelivery(std::size_t index) {
+      const std::weak_ptr<State> weak_state = shared_from_this();
+      get_port(index).run_loop.Post([weak_state, index](const JSContext& js_context) {
+        const auto state = weak_state.lock();
+        if (state) {
+          state -> Deliver(index, js_context);
+        }
+      });
+    }
+
+    // Post a delivery unless one is posted already or there is nothing
+    // to deliver.
+    void PostDeliveryIfPending(std::size_t index) {
+      auto& port = get_port(index);
+      {
+        std::lock_guard<std::mutex> lock(port.mutex);
+        if (port.delivery_posted || port.inbox.empty()) {
+          return;
+        }
+        port.delivery_posted = true;
+      }
+      PostDelivery(index);
+    }
+
+    void Deliver(std::size_t index, const JSContext& js_context) {
+      auto& port = get_port(index);
+      for (;;) {
+        std::unique_ptr<detail::JSSerializedValue> message;
+        {
+          std::lock_guard<std::mutex> lock(port.mutex);
+          if (port.inbox.empty() || !port.message_handler || closed.load(std::memory_order_acquire)) {
+            port.delivery_posted = false;
+            return;
+          }
+          message = std::move(port.inbox.front());
+          port.inbox.pop_front();
+        }
+
+        try {
+          const JSValue js_message(js_context, message -> Deserialize(static_cast<JSContextRef>(js_context)));
+
+          // The handler may replace itself.
+          const auto message_handler = port.message_handler;
+          message_handler(js_context, js_message);
+        } catch (...) {
+          {
+            std::lock_guard<std::mutex> lock(port.mutex);
+            port.delivery_posted = false;
+          }
+          PostDeliveryIfPending(index);
+          throw;
+        }
+      }
+    }
+
+    void Close() HAL_NOEXCEPT {
+      closed.store(true, std::memory_order_release);
+      for (std::size_t index = 0; index < 2; ++index) {
+        auto& port = get_port(index);
+        std::lock_guard<std::mutex> lock(port.mutex);
+        port.inbox.clear();
+      }
+    }
+
+    Port              port1;
+    Port              port2;
+    std::atomic<bool> closed { false };
+  };
+
+  JSMessagePort::JSMessagePort(const std::shared_ptr<State>& state, std::size_t index) HAL_NOEXCEPT
+  : state__(state)
+  , index__(index) {
+  }
+
+  void JSMessagePort::PostMessage(const JSValue& message) const {
+    PostMessage(message, std::vector<JSObject>());
+  }
+
+  void JSMessagePort::PostMessage(const JSValue& message, const std::vector<JSObject>& transfer) const {
+    if (state__ -> closed.load(std::memory_order_acquire)) {
+      return;
+    }
+
+    std::vector<JSObjectRef> transfer_refs;
+    transfer_refs.reserve(transfer.size());
+    for (const auto& js_object : transfer) {
+      transfer_refs.push_back(static_cast<JSObjectRef>(js_object));
+    }
+
+    const auto context_ref = static_cast<JSContextRef>(message.get_context());
+    std::unique_ptr<detail::JSSerializedValue> serialized_message(new detail::JSSerializedValue(context_ref, static_cast<JSValueRef>(message), transfer_refs));
+    state__ -> Enqueue(1 - index__, std::move(serialized_message));
+  }
+
+  void JSMessagePort::set_message_handler(JSMessageHandler message_handler) const {
+    state__ -> get_port(index__).message_handler = std::move(message_handler);
+    state__ -> PostDeliveryIfPending(index__);
+  }
+
+  void JSMessagePort::Close() const HAL_NOEXCEPT {
+    state__ -> Close();
+  }
+
+  std::size_t JSMessagePort::get_pending_message_count() const HAL_NOEXCEPT {
+    auto& port = state__ -> get_port(index__);
+    std::lock_guard<std::mutex> lock(port.mutex);
+    return port.inbox.size();
+  }
+
+  JSContext JSMessagePort::get_context() const HAL_NOEXCEPT {
+    return state__ -> get_port(index__).run_loop.get_context();
+  }
+
+  JSMessageChannel::JSMessageChannel(const JSRunLoop& run_loop_1, const JSRunLoop& run_loop_2)
+  : port1__(std::make_shared<JSMessagePort::State>(run_loop_1, run_loop_2), 0)
+  , port2__(port1__.state__, 1) {
+  }
+
+  JSMessagePort JSMessageChannel::get_port1() const HAL_NOEXCEPT {
+    return port1__;
+  }
+
+  JSMessagePort JSMessageChannel::get_port2() const HAL_NOEXCEPT {
+    return port2__;
+  }
+
+} // namespace HAL {
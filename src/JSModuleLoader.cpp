@@ -0,0 +1,169 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSModuleLoader.hpp"
+
+#include "HAL/JSFunction.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSMappedFile.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <exception>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL {
+  
+  struct JSModuleLoader::State final {
+    
+    // A registered module that hasn't been required yet. Exactly one
+    // of file, source and bundle is set.
+    struct Source {
+      std::shared_ptr<detail::JSMappedFile> file;
+      JSString                              source;
+      std::string                           source_url;
+      std::shared_ptr<const JSBundle>       bundle;
+    };
+    
+    State(const JSContext& js_context, JSObjectRef require_function_ref)
+    : js_context(js_context)
+    , require_function(js_context, require_function_ref) {
+    }
+    
+    const JSContext                           js_context;
+    const JSObject                            require_function;
+    std::unordered_map<std::string, Source>   sources;
+    std::unordered_map<std::string, JSObject> modules;
+  };
+  
+  namespace {
+    
+    JSString ToJSString(const detail::JSMappedFile& file) {
+      // UTF-8 never takes more UTF-16 code units than it has bytes.
+      std::unique_ptr<JSChar[]> characters(new JSChar[file.size() > 0 ? file.size() : 1]);
+      const auto characters_length = detail::TranscodeUTF8ToUTF16(file.data(), file.size(), characters.get());
+      const auto js_string_ref     = detail::CreateJSStringWithCharacters(characters.get(), characters_length);
+      const JSString js_string(js_string_ref);
+      JSStringRelease(js_string_ref);
+      return js_string;
+    }
+    
+  } // namespace {
+  
+  JSModuleLoader::JSModuleLoader(const JSContext& js_context) {
+    auto state_ptr = new std::weak_ptr<State>();
+    const auto require_function_ref = JSObjectMake(static_cast<JSContextRef>(js_context), GetRequireClass(), state_ptr);
+    state__ = std::make_shared<State>(js_context, require_function_ref);
+    *state_ptr = state__;
+  }
+  
+  void JSModuleLoader::RegisterModule(const std::string& id, const JSString& source, const std::string& source_url) {
+    state__ -> sources[id] = State::Source { nullptr, source, source_url, nullptr };
+  }
+  
+  void JSModuleLoader::RegisterModuleFile(const std::string& id, const std::string& path) {
+    state__ -> sources[id] = State::Source { std::make_shared<detail::JSMappedFile>(path), JSString(), path, nullptr };
+  }
+  
+  void JSModuleLoader::RegisterBundle(const JSBundle& bundle) {
+    const auto bundle_ptr = std::make_shared<const JSBundle>(bundle);
+    for (const auto& id : bundle.get_ids()) {
+      state__ -> sources[id] = State::Source { nullptr, JSString(), id, bundle_ptr };
+    }
+  }
+  
+  JSValue JSModuleLoader::Require(const std::string& id) {
+    return Load(*state__, id);
+  }
+  
+  bool JSModuleLoader::IsLoaded(const std::string& id) const {
+    return state__ -> modules.find(id) != state__ -> modules.end();
+  }
+  
+  JSObject JSModuleLoader::get_require_function() const {
+    return state__ -> require_function;
+  }
+  
+  JSValue JSModuleLoader::Load(State& state, const std::string& id) {
+    const auto module_position = state.modules.find(id);
+    if (module_position != state.modules.end()) {
+      return module_position -> second.GetProperty("exports");
+    }
+    
+    const auto source_position = state.sources.find(id);
+    if (source_position == state.sources.end()) {
+      detail::ThrowRuntimeError("JSModuleLoader", "Cannot find module '" + id + "'.");
+    }
+    
+    const auto& source  = source_position -> second;
+    const auto  body    = source.file ? ToJSString(*source.file) : (source.bundle ? source.bundle -> GetSource(id) : source.source);
+    auto        factory = state.js_context.CreateFunction(body, {"exports", "require", "module"}, JSString(), source.source_url);
+    
+    // The module is cached before its body runs so that a cyclic
+    // require gets its partial exports.
+    auto module  = state.js_context.CreateObject();
+    auto exports = state.js_context.CreateObject();
+    module.SetProperty("id", state.js_context.CreateString(id));
+    module.SetProperty("exports", exports);
+    state.modules.emplace(id, module);
+    
+    try {
+      const std::vector<JSValue> arguments { exports, state.require_function, module };
+      factory(arguments, exports);
+    } catch (...) {
+      state.modules.erase(id);
+      throw;
+    }
+    
+    // The source, and the mapping of its file, are no longer needed.
+    state.sources.erase(id);
+    return module.GetProperty("exports");
+  }
+  
+  JSValueRef JSModuleLoader::CallRequire(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) {
+    std::string message;
+    try {
+      const auto state = static_cast<std::weak_ptr<State>*>(JSObjectGetPrivate(function_ref)) -> lock();
+      if (!state) {
+        detail::ThrowRuntimeError("JSModuleLoader", "The JSModuleLoader of this require function has been destroyed.");
+      }
+      
+      if (argument_count == 0) {
+        detail::ThrowRuntimeError("JSModuleLoader", "require expects a module id.");
+      }
+      
+      const auto id = static_cast<std::string>(JSValue(state -> js_context, arguments_array[0]));
+      return static_cast<JSValueRef>(Load(*state, id));
+    } catch (const std::exception& e) {
+      message = e.what();
+    }
+    
+    const auto message_ref = detail::CreateJSStringWithUTF8CString(message.c_str());
+    const JSValueRef error_arguments[] = { JSValueMakeString(context_ref, message_ref) };
+    JSStringRelease(message_ref);
+    *exception = JSObjectMakeError(context_ref, 1, error_arguments, nullptr);
+    return nullptr;
+  }
+  
+  void JSModuleLoader::FinalizeRequire(JSObjectRef function_ref) {
+    delete static_cast<std::weak_ptr<State>*>(JSObjectGetPrivate(function_ref));
+  }
+  
+  JSClassRef JSModuleLoader::GetRequireClass() {
+    static const JSClassRef js_class_ref = [] {
+      auto js_class_definition           = kJSClassDefinitionEmpty;
+      js_class_definition.className      = "require";
+      js_class_definition.callAsFunction = CallRequire;
+      js_class_definition.finalize       = FinalizeRequire;
+      return detail::CreateJSClass(&js_class_definition);
+    }();
+    return js_class_ref;
+  }
+  
+} // namespace HAL {
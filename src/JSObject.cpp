@@ -17,11 +17,24 @@
 #include "HAL/JSNumber.hpp"
 #include "HAL/JSError.hpp"
 #include "HAL/JSArray.hpp"
+#include "HAL/JSArrayBuffer.hpp"
+#include "HAL/JSValueView.hpp"
+#include "HAL/JSExportAllocator.hpp"
 
 #include "HAL/detail/JSPropertyNameAccumulator.hpp"
+#include "HAL/detail/JSAllocationSample.hpp"
+#include "HAL/detail/JSAPIStatistics.hpp"
+#include "HAL/detail/JSCPUTimeScope.hpp"
 #include "HAL/detail/JSUtil.hpp"
+#include "HAL/detail/JSObjectRefRegistry.hpp"
+#include "HAL/detail/JSQuotaState.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include "HAL/detail/JSTraceScope.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <memory>
 #include <type_traits>
 #include <sstream>
 #include <limits>
@@ -29,13 +42,13 @@
 namespace HAL {
   
   bool JSObject::HasProperty(const JSString& property_name) const HAL_NOEXCEPT {
-    return JSObjectHasProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name));
+    return HAL_API_CALL(js_context__, HasProperty, JSObjectHasProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name)));
   }
   
   JSValue JSObject::GetProperty(const JSString& property_name) const {
     HAL_JSOBJECT_LOCK_GUARD;
     JSValueRef exception { nullptr };
-    JSValueRef js_value_ref = JSObjectGetProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name), &exception);
+    JSValueRef js_value_ref = HAL_API_CALL(js_context__, GetProperty, JSObjectGetProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name), &exception));
     if (exception) {
       // If this assert fails then we need to JSValueUnprotect
       // js_value_ref.
@@ -50,7 +63,7 @@ namespace HAL {
   JSValue JSObject::GetProperty(unsigned property_index) const {
     HAL_JSOBJECT_LOCK_GUARD;
     JSValueRef exception { nullptr };
-    JSValueRef js_value_ref = JSObjectGetPropertyAtIndex(static_cast<JSContextRef>(js_context__), js_object_ref__, property_index, &exception);
+    JSValueRef js_value_ref = HAL_API_CALL(js_context__, GetProperty, JSObjectGetPropertyAtIndex(static_cast<JSContextRef>(js_context__), js_object_ref__, property_index, &exception));
     if (exception) {
       // If this assert fails then we need to JSValueUnprotect
       // js_value_ref.
@@ -62,11 +75,37 @@ namespace HAL {
     return JSValue(js_context__, js_value_ref);
   }
   
-  void JSObject::SetProperty(const JSString& property_name, const JSValue& property_value, const std::unordered_set<JSPropertyAttribute>& attributes) {
+  JSResult<JSValue> JSObject::TryGetProperty(const JSString& property_name) const {
+    HAL_JSOBJECT_LOCK_GUARD;
+    JSValueRef exception { nullptr };
+    JSValueRef js_value_ref = HAL_API_CALL(js_context__, GetProperty, JSObjectGetProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name), &exception));
+    if (exception) {
+      assert(!js_value_ref);
+      return JSResult<JSValue>::Exception(JSValue(js_context__, exception));
+    }
+    
+    assert(js_value_ref);
+    return JSValue(js_context__, js_value_ref);
+  }
+  
+  JSResult<JSValue> JSObject::TryGetProperty(unsigned property_index) const {
+    HAL_JSOBJECT_LOCK_GUARD;
+    JSValueRef exception { nullptr };
+    JSValueRef js_value_ref = HAL_API_CALL(js_context__, GetProperty, JSObjectGetPropertyAtIndex(static_cast<JSContextRef>(js_context__), js_object_ref__, property_index, &exception));
+    if (exception) {
+      assert(!js_value_ref);
+      return JSResult<JSValue>::Exception(JSValue(js_context__, exception));
+    }
+    
+    assert(js_value_ref);
+    return JSValue(js_context__, js_value_ref);
+  }
+  
+  void JSObject::SetProperty(const JSString& property_name, const JSValue& property_value, JSPropertyAttributeSet attributes) {
     HAL_JSOBJECT_LOCK_GUARD;
     
     JSValueRef exception { nullptr };
-    JSObjectSetProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name), static_cast<JSValueRef>(property_value), detail::ToJSPropertyAttributes(attributes), &exception);
+    HAL_API_CALL(js_context__, SetProperty, JSObjectSetProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name), static_cast<JSValueRef>(property_value), detail::ToJSPropertyAttributes(attributes), &exception));
     if (exception) {
       detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
     }
@@ -76,7 +115,7 @@ namespace HAL {
     HAL_JSOBJECT_LOCK_GUARD;
     
     JSValueRef exception { nullptr };
-    JSObjectSetPropertyAtIndex(static_cast<JSContextRef>(js_context__), js_object_ref__, property_index, static_cast<JSValueRef>(property_value), &exception);
+    HAL_API_CALL(js_context__, SetProperty, JSObjectSetPropertyAtIndex(static_cast<JSContextRef>(js_context__), js_object_ref__, property_index, static_cast<JSValueRef>(property_value), &exception));
     if (exception) {
       detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
     }
@@ -86,7 +125,7 @@ namespace HAL {
     HAL_JSOBJECT_LOCK_GUARD;
     
     JSValueRef exception { nullptr };
-    const bool result = JSObjectDeleteProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name), &exception);
+    const bool result = HAL_API_CALL(js_context__, DeleteProperty, JSObjectDeleteProperty(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSStringRef>(property_name), &exception));
     if (exception) {
       detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
     }
@@ -108,53 +147,114 @@ namespace HAL {
     return properties;
   }
   
-  bool JSObject::IsFunction() const HAL_NOEXCEPT {
-    return JSObjectIsFunction(static_cast<JSContextRef>(js_context__), js_object_ref__);
+  std::vector<JSValue> JSObject::GetProperties(const std::vector<JSString>& property_names) const {
+    HAL_JSOBJECT_LOCK_GUARD;
+    const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+    std::vector<JSValue> property_values;
+    property_values.reserve(property_names.size());
+    JSValueRef exception { nullptr };
+    for (const auto& property_name : property_names) {
+      const auto js_value_ref = HAL_API_CALL(js_context__, GetProperty, JSObjectGetProperty(js_context_ref, js_object_ref__, static_cast<JSStringRef>(property_name), &exception));
+      if (exception) {
+        detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+      }
+      property_values.emplace_back(JSValue(js_context__, js_value_ref));
+    }
+    
+    return property_values;
   }
-
-  bool JSObject::IsArray() const HAL_NOEXCEPT {
+  
+  void JSObject::SetProperties(const std::vector<JSString>& property_names, const std::vector<JSValue>& property_values, JSPropertyAttributeSet attributes) {
     HAL_JSOBJECT_LOCK_GUARD;
-
-    JSObject global_object = js_context__.get_global_object();
-    JSValue array_value = global_object.GetProperty("Array");
-    if (!array_value.IsObject()) {
-      return false;
+    if (property_names.size() != property_values.size()) {
+      detail::ThrowInvalidArgument("JSObject", "SetProperties needs as many values as names.");
     }
     
-    JSObject array = static_cast<JSObject>(array_value);
-    JSValue isArray_value = array.GetProperty("isArray");
-    if (!isArray_value.IsObject()) {
-      return false;
+    const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+    const auto js_attributes  = detail::ToJSPropertyAttributes(attributes);
+    JSValueRef exception { nullptr };
+    for (std::size_t i = 0; i < property_names.size(); ++i) {
+      HAL_API_CALL(js_context__, SetProperty, JSObjectSetProperty(js_context_ref, js_object_ref__, static_cast<JSStringRef>(property_names[i]), static_cast<JSValueRef>(property_values[i]), js_attributes, &exception));
+      if (exception) {
+        detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+      }
     }
-    JSObject isArray = static_cast<JSObject>(isArray_value);
-    if (!isArray.IsFunction()) {
-      return false;
+  }
+  
+  bool JSObject::ForEachProperty(const std::function<bool(JSStringRef name, const JSValueView& value)>& visitor) const {
+    HAL_JSOBJECT_LOCK_GUARD;
+    const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+    const std::unique_ptr<std::remove_pointer<JSPropertyNameArrayRef>::type, void(*)(JSPropertyNameArrayRef)> names(JSObjectCopyPropertyNames(js_context_ref, js_object_ref__), JSPropertyNameArrayRelease);
+    const auto count = JSPropertyNameArrayGetCount(names.get());
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto name_ref = JSPropertyNameArrayGetNameAtIndex(names.get(), i);
+      JSValueRef exception { nullptr };
+      const auto value_ref = HAL_API_CALL(js_context__, GetProperty, JSObjectGetProperty(js_context_ref, js_object_ref__, name_ref, &exception));
+      if (exception) {
+        detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+      }
+      
+      if (!visitor(name_ref, JSValueView(js_context_ref, value_ref))) {
+        return false;
+      }
     }
+    
+    return true;
+  }
+  
+  bool JSObject::IsFunction() const HAL_NOEXCEPT {
+    return JSObjectIsFunction(static_cast<JSContextRef>(js_context__), js_object_ref__);
+  }
 
-    JSValue self = static_cast<JSValue>(*this);
-    JSValue result = isArray(self, global_object);
-    if (result.IsBoolean()) {
-        return static_cast<bool>(result);
+  bool JSObject::IsArray() const HAL_NOEXCEPT {
+    HAL_JSOBJECT_LOCK_GUARD;
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    // JavaScriptCore versions with typed arrays also have
+    // JSValueIsArray.
+    return HAL_API_CALL(js_context__, ValueTypeCheck, JSValueIsArray(static_cast<JSContextRef>(js_context__), js_object_ref__));
+#else
+    const auto is_array_function = js_context__.get_array_is_array_function();
+    if (!is_array_function || !JSObjectIsFunction(static_cast<JSContextRef>(js_context__), is_array_function)) {
+      return false;
     }
     
-    return false;
+    JSValueRef exception { nullptr };
+    JSValueRef arguments[] = { js_object_ref__ };
+    const auto result = HAL_API_CALL(js_context__, CallAsFunction, JSObjectCallAsFunction(static_cast<JSContextRef>(js_context__), is_array_function, nullptr, 1, arguments, &exception));
+    return !exception && JSValueIsBoolean(static_cast<JSContextRef>(js_context__), result) && JSValueToBoolean(static_cast<JSContextRef>(js_context__), result);
+#endif
   }
   
   bool JSObject::IsError() const HAL_NOEXCEPT {
     HAL_JSOBJECT_LOCK_GUARD;
-    const auto global_object = js_context__.get_global_object();
-    const auto error_value = global_object.GetProperty("Error");
-    if (!error_value.IsObject()) {
+    const auto error_constructor = js_context__.get_intrinsic(JSIntrinsic::Error);
+    if (!error_constructor) {
       return false;
     }
-    const auto error = static_cast<JSObject>(error_value);
-    const auto self  = static_cast<JSValue>(*this);
-    return static_cast<std::string>(self) == "[object Error]" || self.IsInstanceOfConstructor(error);
+    
+    JSValueRef exception { nullptr };
+    const bool result = HAL_API_CALL(js_context__, ValueTypeCheck, JSValueIsInstanceOfConstructor(static_cast<JSContextRef>(js_context__), js_object_ref__, error_constructor, &exception));
+    return !exception && result;
+  }
+  
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  bool JSObject::IsArrayBuffer() const HAL_NOEXCEPT {
+    HAL_JSOBJECT_LOCK_GUARD;
+    JSValueRef exception { nullptr };
+    return JSValueGetTypedArrayType(static_cast<JSContextRef>(js_context__), js_object_ref__, &exception) == kJSTypedArrayTypeArrayBuffer;
+  }
+  
+  bool JSObject::IsTypedArray() const HAL_NOEXCEPT {
+    HAL_JSOBJECT_LOCK_GUARD;
+    JSValueRef exception { nullptr };
+    const auto type = JSValueGetTypedArrayType(static_cast<JSContextRef>(js_context__), js_object_ref__, &exception);
+    return type != kJSTypedArrayTypeNone && type != kJSTypedArrayTypeArrayBuffer;
   }
+#endif
   
-  JSValue JSObject::operator()(                                        JSObject this_object) { return CallAsFunction(std::vector<JSValue>()                      , this_object); }
-  JSValue JSObject::operator()(JSValue&                     argument , JSObject this_object) { return CallAsFunction({argument}                                  , this_object); }
-  JSValue JSObject::operator()(const JSString&              argument , JSObject this_object) { return CallAsFunction(detail::to_vector(js_context__, {argument}) , this_object); }
+  JSValue JSObject::operator()(                                        JSObject this_object) { return Call(this_object                                             ); }
+  JSValue JSObject::operator()(JSValue&                     argument , JSObject this_object) { return Call(this_object, argument                                   ); }
+  JSValue JSObject::operator()(const JSString&              argument , JSObject this_object) { return Call(this_object, argument                                   ); }
   JSValue JSObject::operator()(const std::vector<JSValue>&  arguments, JSObject this_object) { return CallAsFunction(arguments                                   , this_object); }
   JSValue JSObject::operator()(const std::vector<JSString>& arguments, JSObject this_object) { return CallAsFunction(detail::to_vector(js_context__, arguments)  , this_object); }
   
@@ -162,11 +262,19 @@ namespace HAL {
     return JSObjectIsConstructor(static_cast<JSContextRef>(js_context__), js_object_ref__);
   }
   
-  JSObject JSObject::CallAsConstructor(                                      ) { return CallAsConstructor(std::vector<JSValue>  {}        ); }
-  JSObject JSObject::CallAsConstructor(const JSValue&               argument ) { return CallAsConstructor(std::vector<JSValue>  {argument}); }
-  JSObject JSObject::CallAsConstructor(const JSString&              argument ) { return CallAsConstructor(std::vector<JSString> {argument}); }
+  JSObject JSObject::CallAsConstructor(                                      ) { return Construct(        ); }
+  JSObject JSObject::CallAsConstructor(const JSValue&               argument ) { return Construct(argument); }
+  JSObject JSObject::CallAsConstructor(const JSString&              argument ) { return Construct(argument); }
   JSObject JSObject::CallAsConstructor(const std::vector<JSString>& arguments) { return CallAsConstructor(detail::to_vector(js_context__, arguments)); }
   JSObject JSObject::CallAsConstructor(const std::vector<JSValue>&  arguments) {
+    if (arguments.empty()) {
+      return ConstructWithValueRefs(nullptr, 0);
+    }
+    const auto arguments_array = detail::to_vector(arguments);
+    return ConstructWithValueRefs(&arguments_array[0], arguments_array.size());
+  }
+  
+  JSObject JSObject::ConstructWithValueRefs(const JSValueRef arguments[], std::size_t argument_count) {
     HAL_JSOBJECT_LOCK_GUARD;
     
     if (!IsConstructor()) {
@@ -174,13 +282,9 @@ namespace HAL {
     }
     
     JSValueRef exception { nullptr };
-    JSObjectRef js_object_ref = nullptr;
-    if (!arguments.empty()) {
-      const auto arguments_array = detail::to_vector(arguments);
-      js_object_ref = JSObjectCallAsConstructor(static_cast<JSContextRef>(js_context__), js_object_ref__, arguments_array.size(), &arguments_array[0], &exception);
-    } else {
-      js_object_ref = JSObjectCallAsConstructor(static_cast<JSContextRef>(js_context__), js_object_ref__, 0, nullptr, &exception);
-    }
+    const detail::JSQuotaScope js_quota_scope(js_context__.get_quota_state());
+    HAL_JS_CPU_TIME_SCOPE(js_context__.get_cpu_time_counters());
+    JSObjectRef js_object_ref = HAL_API_CALL(js_context__, CallAsConstructor, JSObjectCallAsConstructor(static_cast<JSContextRef>(js_context__), js_object_ref__, argument_count, argument_count == 0 ? nullptr : arguments, &exception));
     
     if (exception) {
       // If this assert fails then we need to JSValueUnprotect
@@ -206,6 +310,25 @@ namespace HAL {
     return JSObjectGetPrivate(js_object_ref__);
   }
   
+  void* JSObject::GetPrivateOfClass(const detail::JSExportClassInfo& class_info) const HAL_NOEXCEPT {
+    // Objects of other JSClasses may have private data without a
+    // native object header. The JSClass of the root of class_info's
+    // hierarchy only tells that the header is there; the class it
+    // records decides.
+    if (!JSValueIsObjectOfClass(static_cast<JSContextRef>(js_context__), js_object_ref__, class_info.display.front() -> js_class_ref)) {
+      return nullptr;
+    }
+    
+    // The header has no class until JSObjectInitializeCallback is
+    // done, and none once the native object is recycled.
+    const auto native_object_ptr = JSObjectGetPrivate(js_object_ref__);
+    if (native_object_ptr == nullptr) {
+      return nullptr;
+    }
+    const auto native_class_info = detail::GetNativeObjectHeader(native_object_ptr) -> class_info;
+    return native_class_info != nullptr && native_class_info -> IsSubclassOf(class_info) ? native_object_ptr : nullptr;
+  }
+  
   bool JSObject::SetPrivate(void* data) const HAL_NOEXCEPT {
     UnRegisterPrivateData(GetPrivate());
     RegisterPrivateData(js_object_ref__, data);
@@ -215,7 +338,10 @@ namespace HAL {
   JSObject::~JSObject() HAL_NOEXCEPT {
     HAL_LOG_TRACE("JSObject:: dtor ", this);
     HAL_LOG_TRACE("JSObject:: release ", js_object_ref__, " for ", this);
-    UnRegisterJSContext(js_object_ref__);
+    // A moved-from JSObject doesn't own a reference.
+    if (js_object_ref__) {
+      UnRegisterJSContext(js_object_ref__);
+    }
   }
   
   JSObject::JSObject(const JSObject& rhs) HAL_NOEXCEPT
@@ -230,16 +356,17 @@ namespace HAL {
   : js_context__(std::move(rhs.js_context__))
   , js_object_ref__(rhs.js_object_ref__) {
     HAL_LOG_TRACE("JSObject:: move ctor ", this);
-    HAL_LOG_TRACE("JSObject:: retain ", js_object_ref__, " for ", this);
-    RegisterJSContext(static_cast<JSContextRef>(js_context__), js_object_ref__);
+    // Take ownership of rhs's registration, leaving rhs empty so that
+    // its destructor does nothing.
+    rhs.js_object_ref__ = nullptr;
   }
   
   JSObject& JSObject::operator=(JSObject rhs) {
     HAL_JSOBJECT_LOCK_GUARD;
     HAL_LOG_TRACE("JSObject:: assignment ", this);
     // JSValues can only be copied between contexts within the same
-    // context group.
-    if (js_context__.get_context_group() != rhs.js_context__.get_context_group()) {
+    // context group. A moved-from JSObject may be assigned anything.
+    if (js_object_ref__ && rhs.js_object_ref__ && js_context__ != rhs.js_context__ && js_context__.get_context_group() != rhs.js_context__.get_context_group()) {
       detail::ThrowRuntimeError("JSObject", "JSObjects must belong to JSContexts within the same JSContextGroup to be shared and exchanged.");
     }
     
@@ -262,6 +389,7 @@ namespace HAL {
   : js_context__(js_context)
   , js_object_ref__(JSObjectMake(static_cast<JSContextRef>(js_context), static_cast<JSClassRef>(js_class), private_data)) {
     HAL_LOG_TRACE("JSObject:: ctor 1 ", this);
+    HAL_ALLOCATION_SAMPLE("JSObject");
     HAL_LOG_TRACE("JSObject:: retain ", js_object_ref__, " (implicit) for ", this);
     RegisterJSContext(static_cast<JSContextRef>(js_context__), js_object_ref__);
   }
@@ -271,6 +399,7 @@ namespace HAL {
   : js_context__(js_context)
   , js_object_ref__(js_object_ref) {
     HAL_LOG_TRACE("JSObject:: ctor 2 ", this);
+    HAL_ALLOCATION_SAMPLE("JSObject");
     HAL_LOG_TRACE("JSObject:: retain ", js_object_ref__, " for ", this);
     RegisterJSContext(static_cast<JSContextRef>(js_context__), js_object_ref__);
   }
@@ -286,101 +415,242 @@ namespace HAL {
   JSObject::operator JSError() const {
     return JSError(js_context__, js_object_ref__);
   }
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  JSObject::operator JSArrayBuffer() const {
+    return JSArrayBuffer(js_context__, js_object_ref__);
+  }
+#endif
   
   JSValue JSObject::CallAsFunction(const std::vector<JSValue>&  arguments, JSObject this_object) {
+    if (arguments.empty()) {
+      return CallWithValueRefs(nullptr, 0, this_object);
+    }
+    const auto arguments_array = detail::to_vector(arguments);
+    return CallWithValueRefs(&arguments_array[0], arguments_array.size(), this_object);
+  }
+  
+  JSValue JSObject::CallWithValueRefs(const JSValueRef arguments[], std::size_t argument_count, const JSObject& this_object) {
     HAL_JSOBJECT_LOCK_GUARD;
+    HAL_TRACE_SCOPE("script", "CallAsFunction", nullptr);
     
     if (!IsFunction()) {
       detail::ThrowRuntimeError("JSObject", "This JavaScript object is not a function.");
     }
     
+    JSValueRef exception { nullptr };
+    const detail::JSQuotaScope js_quota_scope(js_context__.get_quota_state());
+    HAL_JS_CPU_TIME_SCOPE(js_context__.get_cpu_time_counters());
+    JSValueRef js_value_ref = HAL_API_CALL(js_context__, CallAsFunction, JSObjectCallAsFunction(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSObjectRef>(this_object), argument_count, argument_count == 0 ? nullptr : arguments, &exception));
+    
+    if (exception) {
+      // If this assert fails then we need to JSValueUnprotect
+      // js_value_ref.
+      assert(!js_value_ref);
+      detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+    }
+    
+    assert(js_value_ref);
+    return JSValue(js_context__, js_value_ref);
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(const JSValue& argument) const HAL_NOEXCEPT {
+    return static_cast<JSValueRef>(argument);
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(const JSObject& argument) const HAL_NOEXCEPT {
+    return argument.js_object_ref__;
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(const JSString& argument) const {
+    return JSValueMakeString(static_cast<JSContextRef>(js_context__), static_cast<JSStringRef>(argument));
+  }
+  
+  // The string value holds its own reference to the JSStringRef.
+  JSValueRef JSObject::ToJSValueRef(const std::string& argument) const {
+    const auto js_string_ref = detail::CreateJSStringRefWithUTF8(argument.data(), argument.size());
+    const auto js_value_ref  = JSValueMakeString(static_cast<JSContextRef>(js_context__), js_string_ref);
+    JSStringRelease(js_string_ref);
+    return js_value_ref;
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(const char* argument) const {
+    const auto js_string_ref = detail::CreateJSStringRefWithUTF8(argument, std::strlen(argument));
+    const auto js_value_ref  = JSValueMakeString(static_cast<JSContextRef>(js_context__), js_string_ref);
+    JSStringRelease(js_string_ref);
+    return js_value_ref;
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(double argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), argument);
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(std::int32_t argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), argument);
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(std::uint32_t argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), argument);
+  }
+  
+  // Without these, a long or std::size_t argument would be as close
+  // to double as to both 32-bit integers, and the call ambiguous.
+  JSValueRef JSObject::ToJSValueRef(long argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), static_cast<double>(argument));
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(unsigned long argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), static_cast<double>(argument));
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(long long argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), static_cast<double>(argument));
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(unsigned long long argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), static_cast<double>(argument));
+  }
+  
+  JSValueRef JSObject::ToJSValueRef(bool argument) const HAL_NOEXCEPT {
+    return JSValueMakeBoolean(static_cast<JSContextRef>(js_context__), argument);
+  }
+  
+  JSResult<JSValue> JSObject::TryCall(const std::vector<JSValue>& arguments, JSObject this_object) {
+    HAL_JSOBJECT_LOCK_GUARD;
+    HAL_TRACE_SCOPE("script", "CallAsFunction", nullptr);
+    
+    if (!IsFunction()) {
+      return JSResult<JSValue>::Exception(js_context__.CreateError({js_context__.CreateString("This JavaScript object is not a function.")}));
+    }
+    
     JSValueRef exception { nullptr };
     JSValueRef js_value_ref { nullptr };
+    const detail::JSQuotaScope js_quota_scope(js_context__.get_quota_state());
+    HAL_JS_CPU_TIME_SCOPE(js_context__.get_cpu_time_counters());
     if (!arguments.empty()) {
       const auto arguments_array = detail::to_vector(arguments);
-      js_value_ref = JSObjectCallAsFunction(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSObjectRef>(this_object), arguments_array.size(), &arguments_array[0], &exception);
+      js_value_ref = HAL_API_CALL(js_context__, CallAsFunction, JSObjectCallAsFunction(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSObjectRef>(this_object), arguments_array.size(), &arguments_array[0], &exception));
     } else {
-      js_value_ref = JSObjectCallAsFunction(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSObjectRef>(this_object), 0, nullptr, &exception);
+      js_value_ref = HAL_API_CALL(js_context__, CallAsFunction, JSObjectCallAsFunction(static_cast<JSContextRef>(js_context__), js_object_ref__, static_cast<JSObjectRef>(this_object), 0, nullptr, &exception));
     }
     
     if (exception) {
-      // If this assert fails then we need to JSValueUnprotect
-      // js_value_ref.
       assert(!js_value_ref);
-      detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+      return JSResult<JSValue>::Exception(JSValue(js_context__, exception));
     }
     
     assert(js_value_ref);
     return JSValue(js_context__, js_value_ref);
   }
   
-  void JSObject::GetPropertyNames(const JSPropertyNameAccumulator& accumulator) const HAL_NOEXCEPT {
+  std::vector<JSValue> JSObject::CallBatched(const std::vector<JSValue>& inputs, JSObject this_object) {
     HAL_JSOBJECT_LOCK_GUARD;
-    for (const auto& property_name : static_cast<std::vector<JSString>>(GetPropertyNames())) {
-      accumulator.AddName(property_name);
+    HAL_TRACE_SCOPE("script", "CallBatched", nullptr);
+    
+    if (!IsFunction()) {
+      detail::ThrowRuntimeError("JSObject", "This JavaScript object is not a function.");
+    }
+    
+    const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+    JSValueRef exception { nullptr };
+    const auto input_refs = detail::to_vector(inputs);
+    const auto inputs_ref = JSObjectMakeArray(js_context_ref, input_refs.size(), input_refs.empty() ? nullptr : &input_refs[0], &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+    }
+    
+    const JSValueRef arguments_array[] = { js_object_ref__, static_cast<JSObjectRef>(this_object), inputs_ref };
+    const auto results_ref = HAL_API_CALL(js_context__, CallAsFunction, JSObjectCallAsFunction(js_context_ref, js_context__.get_call_batched_function(), nullptr, 3, arguments_array, &exception));
+    if (exception) {
+      detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+    }
+    
+    const auto results_object_ref = JSValueToObject(js_context_ref, results_ref, nullptr);
+    std::vector<JSValue> results;
+    results.reserve(inputs.size());
+    for (unsigned i = 0; i < inputs.size(); ++i) {
+      results.push_back(JSValue(js_context__, JSObjectGetPropertyAtIndex(js_context_ref, results_object_ref, i, nullptr)));
     }
+    return results;
   }
   
-  std::unordered_map<std::intptr_t, std::tuple<std::intptr_t, std::size_t>> JSObject::js_object_ref_to_js_context_ref_map__;
-  
-  void JSObject::RegisterJSContext(JSContextRef js_context_ref, JSObjectRef js_object_ref) {
-    HAL_JSOBJECT_LOCK_GUARD_STATIC;
-    const auto key   = reinterpret_cast<std::intptr_t>(js_object_ref);
-    const auto value = reinterpret_cast<std::intptr_t>(js_context_ref);
+  std::vector<double> JSObject::CallBatched(const std::vector<double>& inputs, JSObject this_object) {
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    HAL_JSOBJECT_LOCK_GUARD;
+    HAL_TRACE_SCOPE("script", "CallBatched", nullptr);
     
-    const auto position = js_object_ref_to_js_context_ref_map__.find(key);
-    const bool found    = position != js_object_ref_to_js_context_ref_map__.end();
+    if (!IsFunction()) {
+      detail::ThrowRuntimeError("JSObject", "This JavaScript object is not a function.");
+    }
     
-    if (found) {
-      auto tuple = position -> second;
-      ++std::get<1>(tuple);
-      js_object_ref_to_js_context_ref_map__[key] = tuple;
-      
-      HAL_LOG_DEBUG("JSObject::RegisterJSContext: JSObjectRef = ", js_object_ref, ", JSContextRef = ", js_context_ref, " count = ", std::get<1>(tuple));
-    } else {
-      JSValueProtect(static_cast<JSContextRef>(js_context_ref), js_object_ref);
-      const auto insert_result = js_object_ref_to_js_context_ref_map__.emplace(key, std::make_tuple(value, 1));
-      const bool inserted      = insert_result.second;
-      
-      // postcondition
-      assert(inserted);
-      HAL_LOG_DEBUG("JSObject::RegisterJSContext: JSObjectRef = ", js_object_ref, ", JSContextRef = ", js_context_ref, " count = 1");
+    const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+    JSValueRef exception { nullptr };
+    const auto inputs_ref  = JSObjectMakeTypedArray(js_context_ref, kJSTypedArrayTypeFloat64Array, inputs.size(), &exception);
+    const auto results_ref = exception ? nullptr : JSObjectMakeTypedArray(js_context_ref, kJSTypedArrayTypeFloat64Array, inputs.size(), &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+    }
+    if (!inputs.empty()) {
+      std::copy(inputs.begin(), inputs.end(), static_cast<double*>(JSObjectGetTypedArrayBytesPtr(js_context_ref, inputs_ref, nullptr)));
     }
+    
+    const JSValueRef arguments_array[] = { js_object_ref__, static_cast<JSObjectRef>(this_object), inputs_ref, results_ref };
+    HAL_API_CALL(js_context__, CallAsFunction, JSObjectCallAsFunction(js_context_ref, js_context__.get_call_batched_numbers_function(), nullptr, 4, arguments_array, &exception));
+    if (exception) {
+      detail::ThrowRuntimeError("JSObject", JSValue(js_context__, exception));
+    }
+    
+    std::vector<double> results(inputs.size());
+    if (!inputs.empty()) {
+      const auto results_ptr = static_cast<const double*>(JSObjectGetTypedArrayBytesPtr(js_context_ref, results_ref, nullptr));
+      std::copy(results_ptr, results_ptr + inputs.size(), results.begin());
+    }
+    return results;
+#else
+    std::vector<JSValue> js_inputs;
+    js_inputs.reserve(inputs.size());
+    for (const auto input : inputs) {
+      js_inputs.push_back(js_context__.CreateNumber(input));
+    }
+    
+    const auto js_results = CallBatched(js_inputs, this_object);
+    std::vector<double> results;
+    results.reserve(js_results.size());
+    for (const auto& js_result : js_results) {
+      results.push_back(static_cast<double>(js_result));
+    }
+    return results;
+#endif
   }
   
-  void JSObject::UnRegisterJSContext(JSObjectRef js_object_ref) {
-    HAL_JSOBJECT_LOCK_GUARD_STATIC;
-    const auto key      = reinterpret_cast<std::intptr_t>(js_object_ref);
-    const auto position = js_object_ref_to_js_context_ref_map__.find(key);
-    const bool found    = position != js_object_ref_to_js_context_ref_map__.end();
-    
-    // precondition
-    if (found) {
-      auto tuple = position -> second;
-      JSContextRef js_context_ref = reinterpret_cast<JSContextRef>(std::get<0>(tuple));
-      static_cast<void>(js_context_ref); // just meant to suppress "unused" compiler warning
-      --std::get<1>(tuple);
-      if (std::get<1>(tuple) == 0) {
-        JSValueUnprotect(static_cast<JSContextRef>(js_context_ref), js_object_ref);
-        js_object_ref_to_js_context_ref_map__.erase(key);
-      } else {
-        js_object_ref_to_js_context_ref_map__[key] = tuple;
-      }
-      HAL_LOG_DEBUG("JSObject::UnRegisterJSContext: JSObjectRef = ", js_object_ref, ", JSContextRef = ", js_context_ref, " count = ", std::get<1>(tuple));
-    } else {
-      HAL_LOG_DEBUG("JSObject::UnRegisterJSContext: JSObjectRef = ", js_object_ref, " not registered");
+  void JSObject::GetPropertyNames(const JSPropertyNameAccumulator& accumulator) const HAL_NOEXCEPT {
+    HAL_JSOBJECT_LOCK_GUARD;
+    const auto property_names = GetPropertyNames();
+    for (std::size_t i = 0, count = property_names.GetCount(); i < count; ++i) {
+      accumulator.AddName(property_names.GetNameRefAtIndex(i));
     }
   }
+  
+  detail::JSObjectRefRegistry JSObject::js_object_ref_registry__;
+  
+  void JSObject::RegisterJSContext(JSContextRef js_context_ref, JSObjectRef js_object_ref) {
+    const auto count = js_object_ref_registry__.Register(js_context_ref, js_object_ref);
+    static_cast<void>(count); // just meant to suppress "unused" compiler warning
+    HAL_LOG_DEBUG("JSObject::RegisterJSContext: JSObjectRef = ", js_object_ref, ", JSContextRef = ", js_context_ref, " count = ", count);
+  }
+  
+  void JSObject::UnRegisterJSContext(JSObjectRef js_object_ref) {
+    const auto count = js_object_ref_registry__.UnRegister(js_object_ref);
+    static_cast<void>(count); // just meant to suppress "unused" compiler warning
+    HAL_LOG_DEBUG("JSObject::UnRegisterJSContext: JSObjectRef = ", js_object_ref, " count = ", count);
+  }
 
   JSObject JSObject::FindJSObject(JSContextRef js_context_ref, JSObjectRef js_object_ref) {
-    HAL_JSOBJECT_LOCK_GUARD_STATIC;
-    const auto key      = reinterpret_cast<std::intptr_t>(js_object_ref);
-    const auto position = js_object_ref_to_js_context_ref_map__.find(key);
-    const bool found    = position != js_object_ref_to_js_context_ref_map__.end();
+    const auto registered_js_context_ref = js_object_ref_registry__.Find(js_object_ref);
+    const bool found                     = registered_js_context_ref != nullptr;
     
-    // precondition
     if (found) {
-      js_context_ref = reinterpret_cast<JSContextRef>(std::get<0>(position -> second));
+      js_context_ref = registered_js_context_ref;
     }
     
     HAL_LOG_TRACE("JSObject::FindJSObject: found = ", found, " for JSObjectRef ", js_object_ref, ", JSContextRef = ", js_context_ref);
@@ -390,6 +660,10 @@ namespace HAL {
 
   std::unordered_map<std::intptr_t, std::intptr_t> JSObject::js_private_data_to_js_object_ref_map__;
   
+#ifdef HAL_THREAD_SAFE_STATICS
+  detail::JSRecursiveMutex JSObject::mutex_static__ HAL_LOCK_NAME("JSObject::mutex_static__");
+#endif
+  
   void JSObject::RegisterPrivateData(JSObjectRef js_object_ref, void* private_data) {
     HAL_JSOBJECT_LOCK_GUARD_STATIC;
     // we won't store nullptr
@@ -0,0 +1,58 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSObjectTemplate.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <sstream>
+
+namespace HAL {
+
+  JSObjectTemplate::JSObjectTemplate(const std::vector<Property>& properties) {
+    Initialize(properties);
+  }
+
+  JSObjectTemplate::JSObjectTemplate(const JSClass& js_class, const std::vector<Property>& properties)
+  : js_class__(js_class) {
+    Initialize(properties);
+  }
+
+  void JSObjectTemplate::Initialize(const std::vector<Property>& properties) {
+    property_names__.reserve(properties.size());
+    property_attributes__.reserve(properties.size());
+    for (const auto& property : properties) {
+      if (property.name.empty()) {
+        detail::ThrowInvalidArgument("JSObjectTemplate", "property name is missing");
+      }
+
+      property_names__.emplace_back(property.name);
+      property_attributes__.push_back(property.attributes);
+    }
+  }
+
+  JSObject JSObjectTemplate::Instantiate(const JSContext& js_context, const JSValue* values, std::size_t count) const {
+    if (count != property_names__.size()) {
+      std::ostringstream os;
+      os << "expected " << property_names__.size() << " values but got " << count;
+      detail::ThrowInvalidArgument("JSObjectTemplate", os.str());
+    }
+
+    auto js_object = js_context.CreateObject(js_class__);
+    for (std::size_t i = 0; i < count; ++i) {
+      js_object.SetProperty(property_names__[i], values[i], property_attributes__[i]);
+    }
+
+    return js_object;
+  }
+
+  JSObject JSObjectTemplate::Instantiate(const JSContext& js_context, const std::vector<JSValue>& values) const {
+    return Instantiate(js_context, values.data(), values.size());
+  }
+
+} // namespace HAL {
@@ -0,0 +1,95 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSPreparedCall.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/detail/JSCPUTimeScope.hpp"
+#include "HAL/detail/JSQuotaState.hpp"
+#include "HAL/detail/JSTraceScope.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <sstream>
+
+#include <JavaScriptCore/JavaScript.h>
+
+namespace HAL {
+
+  JSPreparedCall::JSPreparedCall(const JSObject& function, const JSObject& this_object, std::size_t arity)
+  : js_context__(function.get_context())
+  , function__(function)
+  , this_object__(this_object)
+  , arguments__(arity, nullptr) {
+    if (!function__.IsFunction()) {
+      detail::ThrowInvalidArgument("JSPreparedCall", "This JavaScript object is not a function.");
+    }
+  }
+
+  JSPreparedCall::JSPreparedCall(const JSObject& function, std::size_t arity)
+  : JSPreparedCall(function, function.get_context().get_global_object(), arity) {
+  }
+
+  JSValueRef JSPreparedCall::ToJSValueRef(const JSValue& argument) const HAL_NOEXCEPT {
+    return static_cast<JSValueRef>(argument);
+  }
+
+  JSValueRef JSPreparedCall::ToJSValueRef(const JSObject& argument) const HAL_NOEXCEPT {
+    return static_cast<JSObjectRef>(argument);
+  }
+
+  JSValueRef JSPreparedCall::ToJSValueRef(double argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), argument);
+  }
+
+  JSValueRef JSPreparedCall::ToJSValueRef(std::int32_t argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), argument);
+  }
+
+  JSValueRef JSPreparedCall::ToJSValueRef(std::uint32_t argument) const HAL_NOEXCEPT {
+    return JSValueMakeNumber(static_cast<JSContextRef>(js_context__), argument);
+  }
+
+  JSValueRef JSPreparedCall::ToJSValueRef(bool argument) const HAL_NOEXCEPT {
+    return JSValueMakeBoolean(static_cast<JSContextRef>(js_context__), argument);
+  }
+
+  void JSPreparedCall::CheckArity(std::size_t count) const {
+    if (count != arguments__.size()) {
+      std::ostringstream os;
+      os << "Expected " << arguments__.size() << " arguments but got " << count << ".";
+      detail::ThrowInvalidArgument("JSPreparedCall", os.str());
+    }
+  }
+
+  JSValueRef JSPreparedCall::Call() {
+    HAL_TRACE_SCOPE("script", "CallAsFunction", nullptr);
+    JSValueRef exception { nullptr };
+    const detail::JSQuotaScope js_quota_scope(js_context__.get_quota_state());
+    HAL_JS_CPU_TIME_SCOPE(js_context__.get_cpu_time_counters());
+    const auto js_value_ref = JSObjectCallAsFunction(static_cast<JSContextRef>(js_context__), static_cast<JSObjectRef>(function__), static_cast<JSObjectRef>(this_object__), arguments__.size(), arguments__.empty() ? nullptr : &arguments__[0], &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSPreparedCall", JSValue(js_context__, exception));
+    }
+
+    return js_value_ref;
+  }
+
+  double JSPreparedCall::ToNumber(JSValueRef js_value_ref) const {
+    JSValueRef exception { nullptr };
+    const double result = JSValueToNumber(static_cast<JSContextRef>(js_context__), js_value_ref, &exception);
+    if (exception) {
+      detail::ThrowRuntimeError("JSPreparedCall", JSValue(js_context__, exception));
+    }
+
+    return result;
+  }
+
+  bool JSPreparedCall::ToBoolean(JSValueRef js_value_ref) const HAL_NOEXCEPT {
+    return JSValueToBoolean(static_cast<JSContextRef>(js_context__), js_value_ref);
+  }
+
+} // namespace HAL {
@@ -0,0 +1,54 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSPreparedValue.hpp"
+#include "HAL/JSStringBuilder.hpp"
+#include "HAL/JSValueWriter.hpp"
+
+namespace HAL {
+
+  // Every JSString below creates its JSStringRef, which is where the
+  // text is converted, on the calling thread.
+  
+  JSPreparedJSON::JSPreparedJSON(const JSValueWriter& writer)
+  : json_text__(writer.ToJSONString()) {
+  }
+  
+  JSPreparedJSON::JSPreparedJSON(const JSStringBuilder& json_text)
+  : json_text__(json_text.ToJSString()) {
+  }
+  
+  JSPreparedJSON::JSPreparedJSON(const std::string& json_text)
+  : json_text__(json_text) {
+  }
+  
+  JSPreparedJSON::JSPreparedJSON(JSString json_text) HAL_NOEXCEPT
+  : json_text__(std::move(json_text)) {
+  }
+  
+  JSPreparedString::JSPreparedString(const JSStringBuilder& string)
+  : string__(string.ToJSString()) {
+  }
+  
+  JSPreparedString::JSPreparedString(const std::string& string)
+  : string__(string) {
+  }
+  
+  JSPreparedString::JSPreparedString(const std::u16string& string)
+  : string__(string) {
+  }
+  
+  JSPreparedString::JSPreparedString(const char16_t* string, std::size_t length)
+  : string__(string, length) {
+  }
+  
+  JSPreparedString::JSPreparedString(JSString string) HAL_NOEXCEPT
+  : string__(std::move(string)) {
+  }
+  
+} // namespace HAL {
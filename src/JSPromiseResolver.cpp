@@ -0,0 +1,130 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSPromiseResolver.hpp"
+
+#include "HAL/JSError.hpp"
+#include "HAL/JSFunction.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSRunLoop.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSUndefined.hpp"
+
+#include <atomic>
+#include <exception>
+#include <vector>
+
+namespace HAL {
+
+  namespace {
+
+    // The resolving functions of a promise. They are only used, and
+    // only destroyed, by tasks running on the run loop's thread.
+    struct ResolvingFunctions final {
+      JSObject resolve;
+      JSObject reject;
+    };
+
+    void RejectWithError(const JSContext& js_context, ResolvingFunctions& resolving_functions, const std::string& message) {
+      JSValue error = js_context.CreateError({ js_context.CreateString(message) });
+      resolving_functions.reject(error, js_context.get_global_object());
+    }
+
+  } // namespace {
+
+  struct JSPromiseResolver::State final {
+
+    typedef std::function<void(const JSContext& js_context, ResolvingFunctions& resolving_functions)> Settler;
+
+    State(const JSRunLoop& js_run_loop, const std::shared_ptr<ResolvingFunctions>& resolving_functions)
+    : js_run_loop(js_run_loop)
+    , resolving_functions(resolving_functions) {
+    }
+
+    ~State() HAL_NOEXCEPT {
+      try {
+        Settle([](const JSContext& js_context, ResolvingFunctions& resolving_functions) {
+          RejectWithError(js_context, resolving_functions, "The promise was abandoned by its JSPromiseResolver");
+        });
+      } catch (...) {
+        // Without memory for the task the promise stays pending, and its
+        // resolving functions are released on this thread.
+      }
+    }
+
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+
+    bool Settle(Settler settler) {
+      if (settled.exchange(true)) {
+        return false;
+      }
+
+      // Only the first caller gets here, so nothing else touches
+      // resolving_functions once it is moved into the task.
+      const auto resolving_functions = std::move(this -> resolving_functions);
+      js_run_loop.Post([resolving_functions, settler](const JSContext& js_context) {
+        settler(js_context, *resolving_functions);
+      });
+      return true;
+    }
+
+    const JSRunLoop                     js_run_loop;
+    std::shared_ptr<ResolvingFunctions> resolving_functions;
+    std::atomic<bool>                   settled { false };
+  };
+
+  JSPromiseResolver::JSPromiseResolver(const std::shared_ptr<State>& state) HAL_NOEXCEPT
+  : state__(state) {
+  }
+
+  std::pair<JSObject, JSPromiseResolver> JSPromiseResolver::Create(const JSRunLoop& js_run_loop) {
+    static const JSString body = "var deferred = { };"
+                                 "deferred.promise = new Promise(function(resolve, reject) {"
+                                 "  deferred.resolve = resolve;"
+                                 "  deferred.reject  = reject;"
+                                 "});"
+                                 "return deferred;";
+
+    const auto js_context = js_run_loop.get_context();
+    const auto deferred   = static_cast<JSObject>(js_context.CreateFunction(body)(js_context.get_global_object()));
+    const auto resolving_functions = std::make_shared<ResolvingFunctions>(ResolvingFunctions {
+      static_cast<JSObject>(deferred.GetProperty("resolve")),
+      static_cast<JSObject>(deferred.GetProperty("reject"))
+    });
+
+    return std::make_pair(static_cast<JSObject>(deferred.GetProperty("promise")),
+                          JSPromiseResolver(std::make_shared<State>(js_run_loop, resolving_functions)));
+  }
+
+  bool JSPromiseResolver::Resolve(JSPromiseValueFactory value_factory) const {
+    return state__ -> Settle([value_factory](const JSContext& js_context, ResolvingFunctions& resolving_functions) {
+      JSValue value = js_context.CreateUndefined();
+      try {
+        value = value_factory(js_context);
+      } catch (const std::exception& e) {
+        RejectWithError(js_context, resolving_functions, e.what());
+        return;
+      }
+      resolving_functions.resolve(value, js_context.get_global_object());
+    });
+  }
+
+  bool JSPromiseResolver::Resolve() const {
+    return Resolve([](const JSContext& js_context) -> JSValue {
+      return js_context.CreateUndefined();
+    });
+  }
+
+  bool JSPromiseResolver::Reject(const std::string& message) const {
+    return state__ -> Settle([message](const JSContext& js_context, ResolvingFunctions& resolving_functions) {
+      RejectWithError(js_context, resolving_functions, message);
+    });
+  }
+
+} // namespace HAL {
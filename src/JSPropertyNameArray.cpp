@@ -26,11 +26,21 @@ namespace HAL {
     return JSString(JSPropertyNameArrayGetNameAtIndex(js_property_name_array_ref__, index));
   }
   
+  JSString JSPropertyNameArray::operator[](std::size_t index) const HAL_NOEXCEPT {
+    return GetNameAtIndex(index);
+  }
+  
+  JSString JSPropertyNameArray::const_iterator::operator*() const HAL_NOEXCEPT {
+    return js_property_name_array__ -> GetNameAtIndex(index__);
+  }
+  
   JSPropertyNameArray::operator std::vector<JSString>() const HAL_NOEXCEPT {
     HAL_JSPROPERTYNAMEARRAY_LOCK_GUARD;
+    const auto count = JSPropertyNameArrayGetCount(js_property_name_array_ref__);
     std::vector<JSString> property_names;
-    for (std::size_t i = 0, count = GetCount(); i < count; ++i) {
-      property_names.emplace_back(GetNameAtIndex(i));
+    property_names.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      property_names.emplace_back(JSString(GetNameRefAtIndex(i)));
     }
     
     return property_names;
@@ -0,0 +1,73 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSPropertyPath.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <JavaScriptCore/JavaScript.h>
+
+namespace HAL {
+
+  JSPropertyPath::JSPropertyPath(const std::string& path)
+  : path__(path) {
+    std::string::size_type begin = 0;
+    for (;;) {
+      const auto end = path__.find('.', begin);
+      const auto property_name = path__.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+      if (property_name.empty()) {
+        detail::ThrowInvalidArgument("JSPropertyPath", "'" + path__ + "' has an empty property name");
+      }
+
+      property_names__.push_back(&JSString::Intern(property_name));
+      if (end == std::string::npos) {
+        break;
+      }
+      begin = end + 1;
+    }
+  }
+
+  JSValue JSPropertyPath::GetValue(const JSObject& js_object) const {
+    return TryGetValue(js_object).ValueOrThrow("JSPropertyPath");
+  }
+
+  JSResult<JSValue> JSPropertyPath::TryGetValue(const JSObject& js_object) const {
+    const auto js_context     = js_object.get_context();
+    const auto js_context_ref = static_cast<JSContextRef>(js_context);
+    auto js_object_ref        = static_cast<JSObjectRef>(js_object);
+    JSValueRef js_value_ref   = js_object_ref;
+    for (std::size_t i = 0; i < property_names__.size(); ++i) {
+      if (i > 0) {
+        if (!JSValueIsObject(js_context_ref, js_value_ref)) {
+          return JSResult<JSValue>::Error(GetPrefix(i) + " is not an object");
+        }
+        js_object_ref = JSValueToObject(js_context_ref, js_value_ref, nullptr);
+      }
+
+      JSValueRef exception { nullptr };
+      js_value_ref = JSObjectGetProperty(js_context_ref, js_object_ref, static_cast<JSStringRef>(*property_names__[i]), &exception);
+      if (exception) {
+        return JSResult<JSValue>::Exception(JSValue(js_context, exception));
+      }
+    }
+
+    return JSValue(js_context, js_value_ref);
+  }
+
+  std::string JSPropertyPath::GetPrefix(std::size_t count) const {
+    std::string prefix;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (i > 0) {
+        prefix += '.';
+      }
+      prefix += static_cast<std::string>(*property_names__[i]);
+    }
+    return prefix;
+  }
+
+} // namespace HAL {
@@ -7,6 +7,7 @@
  */
 
 #include "HAL/JSRegExp.hpp"
+#include "HAL/JSString.hpp"
 #include "HAL/JSValue.hpp"
 #include "HAL/detail/JSUtil.hpp"
 #include <vector>
@@ -20,6 +21,51 @@ JSRegExp::JSRegExp(const JSContext& js_context, const std::vector<JSValue>& argu
 		: JSObject(js_context, MakeRegExp(js_context, arguments)) {
 }
 
+JSRegExp::JSRegExp(const JSContext& js_context, const JSString& pattern, const JSString& flags)
+		: JSObject(js_context, MakeRegExp(js_context, pattern, flags)) {
+}
+
+JSRegExp::JSRegExp(const JSContext& js_context, JSObjectRef js_object_ref)
+		: JSObject(js_context, js_object_ref) {
+}
+
+bool JSRegExp::Test(const JSString& string) const {
+	return JSValueToBoolean(static_cast<JSContextRef>(js_context__), Call(js_context__.get_regexp_test_function(), string));
+}
+
+JSValue JSRegExp::Exec(const JSString& string) const {
+	return JSValue(js_context__, Call(js_context__.get_regexp_exec_function(), string));
+}
+
+JSValueRef JSRegExp::Call(JSObjectRef function_ref, const JSString& string) const {
+	if (!function_ref) {
+		detail::ThrowRuntimeError("JSRegExp", "RegExp.prototype.test or exec is missing.");
+	}
+	
+	const auto js_context_ref = static_cast<JSContextRef>(js_context__);
+	const JSValueRef arguments[] = { JSValueMakeString(js_context_ref, static_cast<JSStringRef>(string)) };
+	JSValueRef exception { nullptr };
+	const auto js_value_ref = JSObjectCallAsFunction(js_context_ref, function_ref, static_cast<JSObjectRef>(*this), 1, arguments, &exception);
+	if (exception) {
+		detail::ThrowRuntimeError("JSRegExp", JSValue(js_context__, exception));
+	}
+	
+	return js_value_ref;
+}
+
+JSObjectRef JSRegExp::MakeRegExp(const JSContext& js_context, const JSString& pattern, const JSString& flags) {
+	const auto js_context_ref = static_cast<JSContextRef>(js_context);
+	const JSValueRef arguments[] = { JSValueMakeString(js_context_ref, static_cast<JSStringRef>(pattern)), JSValueMakeString(js_context_ref, static_cast<JSStringRef>(flags)) };
+	JSValueRef exception { nullptr };
+	const auto js_object_ref = JSObjectMakeRegExp(js_context_ref, 2, arguments, &exception);
+	if (exception) {
+		assert(!js_object_ref);
+		detail::ThrowRuntimeError("JSRegExp", JSValue(js_context, exception));
+	}
+	
+	return js_object_ref;
+}
+
 JSObjectRef JSRegExp::MakeRegExp(const JSContext& js_context, const std::vector<JSValue>& arguments) {
 	JSValueRef exception { nullptr };
 	JSObjectRef js_object_ref = nullptr;
@@ -0,0 +1,528 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSRunLoop.hpp"
+
+#include "HAL/detail/JSIOPoller.hpp"
+#include "HAL/detail/JSQuotaState.hpp"
+#include "HAL/detail/JSTaskLane.hpp"
+#include "HAL/detail/JSTimerWheel.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL {
+
+  struct JSRunLoop::State final {
+
+    struct Node final {
+      std::atomic<Node*>                    next { nullptr };
+      JSRunLoopTask                         task;
+      std::chrono::steady_clock::time_point enqueue_time;
+    };
+
+    // The queue of each priority is Dmitry Vyukov's intrusive MPSC
+    // queue. Producers exchange head and then link the previous node
+    // to theirs; the consumer follows next pointers from tail, whose
+    // node has already been run and serves as the stub.
+    struct Queue final {
+      Queue()
+      : head(new Node())
+      , tail(head.load()) {
+      }
+
+      ~Queue() HAL_NOEXCEPT {
+        while (tail) {
+          const auto next = tail -> next.load();
+          delete tail;
+          tail = next;
+        }
+      }
+
+      Queue(const Queue&)            = delete;
+      Queue& operator=(const Queue&) = delete;
+
+      void Push(JSRunLoopTask task) {
+        const auto node = new Node();
+        node -> task         = std::move(task);
+        node -> enqueue_time = std::chrono::steady_clock::now();
+        const auto previous  = head.exchange(node, std::memory_order_acq_rel);
+
+        // Until this store the consumer sees the queue as ending at
+        // previous. It is sequentially consistent so that, together
+        // with the load of sleeping in Post, either the consumer sees
+        // the task before it sleeps or the producer sees that it must
+        // wake it.
+        previous -> next.store(node);
+      }
+
+      bool TryPop(JSRunLoopTask& task, std::chrono::steady_clock::time_point& enqueue_time) {
+        const auto next = tail -> next.load(std::memory_order_acquire);
+        if (! next) {
+          return false;
+        }
+
+        task         = std::move(next -> task);
+        enqueue_time = next -> enqueue_time;
+        delete tail;
+        tail = next;
+        return true;
+      }
+
+      bool HasTask() const HAL_NOEXCEPT {
+        return tail -> next.load() != nullptr;
+      }
+
+      // Every node after the first holds a task that never ran.
+      std::size_t GetTaskCount() const HAL_NOEXCEPT {
+        std::size_t task_count = 0;
+        for (auto node = tail -> next.load(); node; node = node -> next.load()) {
+          ++task_count;
+        }
+        return task_count;
+      }
+
+      std::atomic<Node*> head;
+      Node*              tail;
+    };
+
+    explicit State(const JSContext& js_context)
+    : js_context(js_context)
+    , js_quota_state(js_context.get_context_group().get_quota_state()) {
+    }
+
+    ~State() HAL_NOEXCEPT {
+      std::size_t task_count = delayed_tasks.size();
+      for (const auto& queue : queues) {
+        task_count += queue.GetTaskCount();
+      }
+      js_quota_state -> RemoveQueuedTasks(task_count);
+    }
+
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+
+    // Take the oldest task of the highest priority that has one.
+    bool TryPop(JSRunLoopTask& task) {
+      for (std::size_t i = 0; i < kJSTaskPriorityCount; ++i) {
+        auto& queue = queues[i];
+        auto& lane  = lanes[i];
+        std::chrono::steady_clock::time_point enqueue_time;
+
+        // Only the consumer may pop, so the tasks a DropOldest lane is
+        // over its capacity by are discarded here rather than in Post.
+        while (lane.is_overflowing()) {
+          JSRunLoopTask dropped_task;
+          if (! queue.TryPop(dropped_task, enqueue_time)) {
+            break;
+          }
+          lane.Drop();
+          js_quota_state -> RemoveQueuedTasks(1);
+        }
+
+        if (queue.TryPop(task, enqueue_time)) {
+          lane.Complete(std::chrono::steady_clock::now() - enqueue_time);
+          js_quota_state -> RemoveQueuedTasks(1);
+          NotifyBlockedProducers();
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    bool HasTask() const HAL_NOEXCEPT {
+      for (const auto& queue : queues) {
+        if (queue.HasTask()) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // The load is sequentially consistent, like the decrement of the
+    // lane's count before it and the increment in Post, so either a
+    // blocked producer sees the freed slot or it is notified.
+    void NotifyBlockedProducers() {
+      if (blocked_producer_count.load() > 0) {
+        std::lock_guard<std::mutex> lock(capacity_mutex);
+        capacity_condition.notify_all();
+      }
+    }
+
+    // Delayed tasks are measured in milliseconds since the run loop was
+    // created, rounded up when scheduled and down when advancing.
+    std::uint64_t GetCurrentTick() const {
+      return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    std::chrono::steady_clock::time_point GetTickTime(std::uint64_t tick) const {
+      return epoch + std::chrono::milliseconds(tick);
+    }
+
+    // Wait for ready handles, or for a wakeup, queuing the handlers to
+    // run. A non-blocking wait is skipped when nothing is watched.
+    void PollIO(int timeout) {
+      if (timeout == 0 && io_watches.empty()) {
+        return;
+      }
+
+      io_events.clear();
+      poller.Wait(timeout, io_events);
+      ready_io_events.insert(ready_io_events.end(), io_events.begin(), io_events.end());
+    }
+
+    // Events leave the queue before their handler runs, as delayed
+    // tasks do, and the events of handles unwatched meanwhile are
+    // dropped.
+    std::size_t RunReadyIOHandlers() {
+      std::size_t handler_count = 0;
+      while (! ready_io_events.empty()) {
+        const auto event = ready_io_events.front();
+        ready_io_events.pop_front();
+        const auto position = io_watches.find(event.key);
+        if (position == io_watches.end()) {
+          continue;
+        }
+
+        // Take a copy, since the handler may unwatch its handle.
+        const auto handler = position -> second.handler;
+        ++handler_count;
+        handler(js_context, event.io_event);
+      }
+
+      return handler_count;
+    }
+
+    std::size_t RunDueDelayedTasks() {
+      std::vector<std::uint64_t> expired_ids;
+      timer_wheel.Advance(GetCurrentTick(), expired_ids);
+      due_delayed_task_ids.insert(due_delayed_task_ids.end(), expired_ids.begin(), expired_ids.end());
+
+      // Ids leave the queue before their task runs, so that a task that
+      // throws leaves the remaining due tasks for the next run.
+      std::size_t task_count = 0;
+      while (! due_delayed_task_ids.empty()) {
+        const auto position = delayed_tasks.find(due_delayed_task_ids.front());
+        due_delayed_task_ids.pop_front();
+        if (position == delayed_tasks.end()) {
+          continue;
+        }
+
+        const auto task = std::move(position -> second);
+        delayed_tasks.erase(position);
+        js_quota_state -> RemoveQueuedTasks(1);
+        ++task_count;
+        task(js_context);
+      }
+
+      return task_count;
+    }
+
+    const JSContext       js_context;
+    const std::thread::id owner_thread_id { std::this_thread::get_id() };
+
+    // Counts the queued and delayed tasks against the quotas of the
+    // context group.
+    const std::shared_ptr<detail::JSQuotaState> js_quota_state;
+
+    Queue              queues[kJSTaskPriorityCount];
+    detail::JSTaskLane lanes[kJSTaskPriorityCount];
+
+    // Producers blocked on a full lane wait on capacity_condition.
+    std::mutex                capacity_mutex;
+    std::condition_variable   capacity_condition;
+    std::atomic<std::size_t>  blocked_producer_count { 0 };
+
+    // Delayed tasks are only touched by the owning thread.
+    const std::chrono::steady_clock::time_point       epoch { std::chrono::steady_clock::now() };
+    detail::JSTimerWheel                              timer_wheel;
+    std::unordered_map<std::uint64_t, JSRunLoopTask>  delayed_tasks;
+    std::deque<std::uint64_t>                         due_delayed_task_ids;
+    std::uint64_t                                     next_delayed_task_id { 1 };
+    JSRunLoopIdleHandler                              idle_handler;
+
+    // Watched handles are only touched by the owning thread.
+    struct IOWatch {
+      JSIOHandle    handle;
+      std::uint32_t events;
+      JSIOHandler   handler;
+    };
+
+    std::unordered_map<std::uint64_t, IOWatch>  io_watches;
+    std::deque<detail::JSIOPoller::Event>       ready_io_events;
+    std::vector<detail::JSIOPoller::Event>      io_events;
+    std::uint64_t                               next_io_watch_id { 1 };
+
+    // The owning thread sleeps in poller while RunFor waits for a
+    // task, and only then do producers wake it.
+    detail::JSIOPoller poller;
+    std::atomic<bool>  sleeping { false };
+  };
+
+  namespace {
+
+    // The run loops of each JSGlobalContextRef, for JSRunLoop::Get. A
+    // run loop's state keeps its context alive, so an entry can't be
+    // mistaken for a later context at the same address before it
+    // expires.
+    std::unordered_map<JSGlobalContextRef, std::weak_ptr<void>>& GetRegistry() {
+      static std::unordered_map<JSGlobalContextRef, std::weak_ptr<void>> registry;
+      return registry;
+    }
+
+    std::mutex& GetRegistryMutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+
+  } // namespace {
+
+  JSRunLoop::JSRunLoop(const JSContext& js_context)
+  : state__(std::make_shared<State>(js_context)) {
+    const auto js_global_context_ref = JSContextGetGlobalContext(static_cast<JSContextRef>(js_context));
+    std::lock_guard<std::mutex> lock(GetRegistryMutex());
+    auto& registry = GetRegistry();
+    for (auto position = registry.begin(); position != registry.end();) {
+      if (position -> second.expired()) {
+        position = registry.erase(position);
+      } else {
+        ++position;
+      }
+    }
+    registry[js_global_context_ref] = state__;
+  }
+
+  JSRunLoop::JSRunLoop(const std::shared_ptr<State>& state) HAL_NOEXCEPT
+  : state__(state) {
+  }
+
+  JSRunLoop JSRunLoop::Get(const JSContext& js_context) {
+    const auto js_global_context_ref = JSContextGetGlobalContext(static_cast<JSContextRef>(js_context));
+    std::shared_ptr<State> state;
+    {
+      std::lock_guard<std::mutex> lock(GetRegistryMutex());
+      const auto& registry = GetRegistry();
+      const auto  position = registry.find(js_global_context_ref);
+      if (position != registry.end()) {
+        state = std::static_pointer_cast<State>(position -> second.lock());
+      }
+    }
+    if (!state) {
+      detail::ThrowRuntimeError("JSRunLoop", "The JSContext has no JSRunLoop.");
+    }
+    return JSRunLoop(state);
+  }
+
+  void JSRunLoop::Post(JSRunLoopTask task, JSTaskPriority priority) const {
+    const auto index = static_cast<std::size_t>(priority);
+    auto& lane = state__ -> lanes[index];
+    state__ -> js_quota_state -> AddQueuedTask();
+
+    // The owning thread would wait for itself.
+    auto admission = lane.Admit(std::this_thread::get_id() != state__ -> owner_thread_id);
+    if (admission == detail::JSTaskLane::Admission::Full) {
+      std::unique_lock<std::mutex> lock(state__ -> capacity_mutex);
+      ++state__ -> blocked_producer_count;
+      do {
+        state__ -> capacity_condition.wait(lock, [&lane] { return lane.has_capacity() || lane.get_options().policy != JSBackpressurePolicy::Block; });
+        admission = lane.Admit(true);
+      } while (admission == detail::JSTaskLane::Admission::Full);
+      --state__ -> blocked_producer_count;
+    }
+
+    if (admission == detail::JSTaskLane::Admission::Reject) {
+      state__ -> js_quota_state -> RemoveQueuedTasks(1);
+      detail::ThrowRuntimeError("JSRunLoop", std::string("The ") + to_string(priority) + " task queue is full.");
+    }
+
+    state__ -> queues[index].Push(std::move(task));
+    if (state__ -> sleeping.load()) {
+      // A wakeup before the owning thread waits makes the wait return
+      // at once, so it can't be lost.
+      state__ -> poller.Wake();
+    }
+  }
+
+  std::size_t JSRunLoop::RunUntilIdle() const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+
+    state__ -> PollIO(0);
+    std::size_t task_count = state__ -> RunReadyIOHandlers();
+    task_count += state__ -> RunDueDelayedTasks();
+    JSRunLoopTask task;
+    while (state__ -> TryPop(task)) {
+      ++task_count;
+      task(state__ -> js_context);
+    }
+
+    return task_count;
+  }
+
+  std::size_t JSRunLoop::RunFor(std::chrono::steady_clock::duration duration) const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+
+    const auto deadline = std::chrono::steady_clock::now() + duration;
+    std::size_t task_count = 0;
+
+    // The idle handler runs once per gap between tasks, not again
+    // after each wakeup that finds nothing to do.
+    bool idle = false;
+    while (true) {
+      // One batch: the ready handlers, the due delayed tasks and the
+      // queued tasks.
+      std::size_t batch_count = state__ -> RunReadyIOHandlers();
+      batch_count += state__ -> RunDueDelayedTasks();
+
+      JSRunLoopTask task;
+      bool expired = false;
+      while (state__ -> TryPop(task)) {
+        ++batch_count;
+        task(state__ -> js_context);
+        if (std::chrono::steady_clock::now() >= deadline) {
+          expired = true;
+          break;
+        }
+      }
+
+      task_count += batch_count;
+      if (expired || std::chrono::steady_clock::now() >= deadline) {
+        break;
+      }
+
+      if (batch_count > 0) {
+        // Pick up the handles that became ready meanwhile without
+        // sleeping.
+        idle = false;
+        state__ -> PollIO(0);
+        continue;
+      }
+
+      auto wake_time = deadline;
+      const auto next_event_tick = state__ -> timer_wheel.GetNextEventTick();
+      if (next_event_tick != 0) {
+        wake_time = std::min(wake_time, state__ -> GetTickTime(next_event_tick));
+      }
+
+      if (! idle) {
+        idle = true;
+        if (state__ -> idle_handler) {
+          // Take a copy, since the handler may replace itself.
+          const auto idle_handler = state__ -> idle_handler;
+          idle_handler(state__ -> js_context, wake_time);
+          continue;
+        }
+      }
+
+      // Sleep whole milliseconds, rounded up so that a delayed task is
+      // due when the wait returns.
+      const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(wake_time - std::chrono::steady_clock::now() + std::chrono::milliseconds(1) - std::chrono::steady_clock::duration(1)).count();
+      state__ -> sleeping.store(true);
+      if (! state__ -> HasTask()) {
+        state__ -> PollIO(static_cast<int>(std::min<decltype(timeout)>(std::max<decltype(timeout)>(timeout, 0), std::numeric_limits<int>::max())));
+      }
+      state__ -> sleeping.store(false);
+    }
+
+    return task_count;
+  }
+
+  std::uint64_t JSRunLoop::PostDelayed(JSRunLoopTask task, std::chrono::steady_clock::duration delay) const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+
+    // Round the expiry up to a whole tick so that it never runs early.
+    const auto expiry      = std::chrono::steady_clock::now() - state__ -> epoch + std::max(delay, std::chrono::steady_clock::duration::zero());
+    const auto expiry_tick = std::chrono::duration_cast<std::chrono::milliseconds>(expiry + std::chrono::milliseconds(1) - std::chrono::steady_clock::duration(1)).count();
+
+    state__ -> js_quota_state -> AddQueuedTask();
+    const auto id = state__ -> next_delayed_task_id++;
+    state__ -> delayed_tasks.emplace(id, std::move(task));
+    state__ -> timer_wheel.Schedule(id, static_cast<std::uint64_t>(expiry_tick));
+    return id;
+  }
+
+  bool JSRunLoop::CancelDelayed(std::uint64_t id) const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+
+    // A task that is due but hasn't run yet is no longer in the wheel.
+    state__ -> timer_wheel.Cancel(id);
+    if (state__ -> delayed_tasks.erase(id) == 0) {
+      return false;
+    }
+
+    state__ -> js_quota_state -> RemoveQueuedTasks(1);
+    return true;
+  }
+
+  std::uint64_t JSRunLoop::Watch(JSIOHandle handle, std::uint32_t events, JSIOHandler handler) const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+
+    const auto id = state__ -> next_io_watch_id++;
+    state__ -> poller.Add(handle, events, id);
+    State::IOWatch io_watch;
+    io_watch.handle  = handle;
+    io_watch.events  = events;
+    io_watch.handler = std::move(handler);
+    state__ -> io_watches.emplace(id, std::move(io_watch));
+    return id;
+  }
+
+  bool JSRunLoop::Unwatch(std::uint64_t id) const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+
+    const auto position = state__ -> io_watches.find(id);
+    if (position == state__ -> io_watches.end()) {
+      return false;
+    }
+
+    state__ -> poller.Remove(position -> second.handle, position -> second.events);
+    state__ -> io_watches.erase(position);
+    return true;
+  }
+
+  std::pair<JSObject, JSPromiseResolver> JSRunLoop::CreatePromise() const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+    return JSPromiseResolver::Create(*this);
+  }
+
+  void JSRunLoop::set_idle_handler(JSRunLoopIdleHandler idle_handler) const {
+    assert(std::this_thread::get_id() == state__ -> owner_thread_id);
+    state__ -> idle_handler = std::move(idle_handler);
+  }
+
+  void JSRunLoop::set_queue_options(JSTaskPriority priority, const JSTaskQueueOptions& options) const {
+    state__ -> lanes[static_cast<std::size_t>(priority)].set_options(options);
+
+    // A larger capacity, or a policy other than Block, frees the
+    // producers waiting for the old one.
+    std::lock_guard<std::mutex> lock(state__ -> capacity_mutex);
+    state__ -> capacity_condition.notify_all();
+  }
+
+  JSTaskQueueOptions JSRunLoop::get_queue_options(JSTaskPriority priority) const HAL_NOEXCEPT {
+    return state__ -> lanes[static_cast<std::size_t>(priority)].get_options();
+  }
+
+  JSTaskLaneStatistics JSRunLoop::GetLaneStatistics(JSTaskPriority priority) const HAL_NOEXCEPT {
+    return state__ -> lanes[static_cast<std::size_t>(priority)].GetStatistics();
+  }
+
+  JSContext JSRunLoop::get_context() const HAL_NOEXCEPT {
+    return state__ -> js_context;
+  }
+
+} // namespace HAL {
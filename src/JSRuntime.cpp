@@ -0,0 +1,223 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSRuntime.hpp"
+
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSLockStatistics.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <utility>
+
+namespace HAL {
+
+  namespace {
+
+    // The JavaScriptCore names of the options of JSRuntimeOptions.
+    const char* const kOptionNames[] = {
+      "useJIT",
+      "useBaselineJIT",
+      "useDFGJIT",
+      "useFTLJIT",
+      "gcMaxHeapSize",
+      "smallHeapSize",
+      "numberOfGCMarkers",
+      "numberOfDFGCompilerThreads",
+      "numberOfFTLCompilerThreads",
+      "useConcurrentGC",
+      "useConcurrentJIT"
+    };
+
+    struct RuntimeState final {
+      detail::JSMutex                   mutex HAL_LOCK_NAME("JSRuntime");
+      std::atomic<bool>                 started { false };
+      std::set<std::string>             extra_option_names;
+      std::vector<JSRuntimeOptionValue> started_options;
+    };
+
+    RuntimeState& GetRuntimeState() {
+      static RuntimeState state;
+      return state;
+    }
+
+    std::string GetVariableName(const std::string& name) {
+      return "JSC_" + name;
+    }
+
+    void SetOption(const std::string& name, const std::string& value) {
+      const auto variable_name = GetVariableName(name);
+#ifdef _WIN32
+      const auto failed = _putenv_s(variable_name.c_str(), value.c_str()) != 0;
+#else
+      const auto failed = setenv(variable_name.c_str(), value.c_str(), 1) != 0;
+#endif
+      if (failed) {
+        detail::ThrowRuntimeError("JSRuntime", "Unable to set " + variable_name + ".");
+      }
+    }
+
+    JSRuntimeOptionValue ReadOption(const std::string& name) {
+      JSRuntimeOptionValue option;
+      option.name = name;
+      const auto value = std::getenv(GetVariableName(name).c_str());
+      if (value) {
+        option.value  = value;
+        option.is_set = true;
+      }
+      return option;
+    }
+
+    std::vector<JSRuntimeOptionValue> ReadOptions(const RuntimeState& state) {
+      std::vector<JSRuntimeOptionValue> options;
+      for (const auto name : kOptionNames) {
+        options.push_back(ReadOption(name));
+      }
+      for (const auto& name : state.extra_option_names) {
+        options.push_back(ReadOption(name));
+      }
+      return options;
+    }
+
+    // JavaScriptCore option names are identifiers.
+    bool IsOptionName(const std::string& name) HAL_NOEXCEPT {
+      if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+        return false;
+      }
+      for (const auto c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    const char* to_option_string(bool value) HAL_NOEXCEPT {
+      return value ? "true" : "false";
+    }
+
+    void AddJITTierOptions(JSJITTier tier, std::vector<std::pair<std::string, std::string>>& options) {
+      switch (tier) {
+        case JSJITTier::Default:
+          return;
+        case JSJITTier::Interpreter:
+          options.emplace_back("useJIT", to_option_string(false));
+          return;
+        case JSJITTier::Baseline:
+        case JSJITTier::DFG:
+        case JSJITTier::FTL:
+          options.emplace_back("useJIT", to_option_string(true));
+          options.emplace_back("useBaselineJIT", to_option_string(true));
+          options.emplace_back("useDFGJIT", to_option_string(tier != JSJITTier::Baseline));
+          options.emplace_back("useFTLJIT", to_option_string(tier == JSJITTier::FTL));
+          return;
+      }
+    }
+
+    void AddSwitchOption(const char* name, JSRuntimeSwitch value, std::vector<std::pair<std::string, std::string>>& options) {
+      if (value != JSRuntimeSwitch::Default) {
+        options.emplace_back(name, to_option_string(value == JSRuntimeSwitch::On));
+      }
+    }
+
+    template<typename T>
+    void AddCountOption(const char* name, T value, std::vector<std::pair<std::string, std::string>>& options) {
+      if (value != 0) {
+        options.emplace_back(name, std::to_string(value));
+      }
+    }
+
+  } // namespace {
+
+  void JSRuntime::ApplyOptions(const JSRuntimeOptions& options) {
+    std::vector<std::pair<std::string, std::string>> option_values;
+    AddJITTierOptions(options.max_jit_tier, option_values);
+    AddCountOption("gcMaxHeapSize", options.max_heap_bytes, option_values);
+    AddCountOption("smallHeapSize", options.small_heap_bytes, option_values);
+    AddCountOption("numberOfGCMarkers", options.gc_marker_thread_count, option_values);
+    AddCountOption("numberOfDFGCompilerThreads", options.dfg_compiler_thread_count, option_values);
+    AddCountOption("numberOfFTLCompilerThreads", options.ftl_compiler_thread_count, option_values);
+    AddSwitchOption("useConcurrentGC", options.concurrent_gc, option_values);
+    AddSwitchOption("useConcurrentJIT", options.concurrent_jit, option_values);
+
+    for (const auto& extra_option : options.extra_options) {
+      if (!IsOptionName(extra_option.first)) {
+        detail::ThrowInvalidArgument("JSRuntime", "'" + extra_option.first + "' isn't a JavaScriptCore option name.");
+      }
+      if (extra_option.second.empty()) {
+        detail::ThrowInvalidArgument("JSRuntime", "The option " + extra_option.first + " has no value.");
+      }
+      option_values.emplace_back(extra_option.first, extra_option.second);
+    }
+
+    auto& state = GetRuntimeState();
+    std::lock_guard<detail::JSMutex> lock(state.mutex);
+    if (state.started.load(std::memory_order_relaxed)) {
+      detail::ThrowRuntimeError("JSRuntime", "Options must be applied before the first JSContextGroup, JSClass or JSString is created.");
+    }
+
+    for (const auto& option_value : option_values) {
+      HAL_LOG_DEBUG("JSRuntime: ", option_value.first, " = ", option_value.second);
+      SetOption(option_value.first, option_value.second);
+    }
+    for (const auto& extra_option : options.extra_options) {
+      state.extra_option_names.insert(extra_option.first);
+    }
+  }
+
+  std::vector<JSRuntimeOptionValue> JSRuntime::GetEffectiveOptions() {
+    auto& state = GetRuntimeState();
+    std::lock_guard<detail::JSMutex> lock(state.mutex);
+    if (state.started.load(std::memory_order_relaxed)) {
+      return state.started_options;
+    }
+    return ReadOptions(state);
+  }
+
+  bool JSRuntime::has_started() HAL_NOEXCEPT {
+    return GetRuntimeState().started.load(std::memory_order_acquire);
+  }
+
+} // namespace HAL {
+
+namespace HAL { namespace detail {
+
+  void StartJSRuntime() HAL_NOEXCEPT {
+    // Only the first call takes the lock, to record the options
+    // JavaScriptCore reads as it starts.
+    auto& state = GetRuntimeState();
+    if (state.started.load(std::memory_order_acquire)) {
+      return;
+    }
+    
+    std::lock_guard<JSMutex> lock(state.mutex);
+    if (!state.started.load(std::memory_order_relaxed)) {
+      try {
+        state.started_options = ReadOptions(state);
+      } catch (const std::exception& e) {
+        HAL_LOG_ERROR("JSRuntime: failed to read the options: ", e.what());
+      }
+      state.started.store(true, std::memory_order_release);
+    }
+  }
+
+  JSContextGroupRef CreateJSContextGroup() {
+    StartJSRuntime();
+    return JSContextGroupCreate();
+  }
+
+  JSClassRef CreateJSClass(const ::JSClassDefinition* js_class_definition) HAL_NOEXCEPT {
+    StartJSRuntime();
+    return JSClassCreate(js_class_definition);
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,175 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSScript.hpp"
+
+#ifdef HAL_SCRIPT_REF_ENABLE
+
+#include "HAL/JSMemoryPressure.hpp"
+#include "HAL/detail/JSContextGroupState.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <future>
+#include <sstream>
+#include <string>
+
+namespace HAL {
+  
+  JSScript::JSScript(const JSContextGroup& js_context_group, const JSString& script, const JSString& source_url, int starting_line_number)
+  : js_context_group__(js_context_group)
+  , source_url__(source_url)
+  , starting_line_number__(starting_line_number) {
+    const JSStringRef source_url_ref = (source_url.length() > 0) ? static_cast<JSStringRef>(source_url) : nullptr;
+    JSStringRef error_message_ref { nullptr };
+    int         error_line        { 0 };
+    const auto js_script_ref = JSScriptCreateFromString(static_cast<JSContextGroupRef>(js_context_group), source_url_ref, starting_line_number, static_cast<JSStringRef>(script), &error_message_ref, &error_line);
+    
+    if (!js_script_ref) {
+      std::ostringstream message;
+      message << "Unable to parse script";
+      if (source_url_ref) {
+        message << " " << static_cast<std::string>(source_url);
+      }
+      message << " at line " << error_line;
+      if (error_message_ref) {
+        message << ": " << static_cast<std::string>(JSString(error_message_ref));
+        JSStringRelease(error_message_ref);
+      }
+      detail::ThrowRuntimeError("JSScript", message.str());
+    }
+    
+    js_script_ref__.reset(js_script_ref, JSScriptRelease);
+  }
+  
+  JSScriptCache::JSScriptCache(const JSContextGroup& js_context_group, std::size_t capacity)
+  : js_context_group__(js_context_group)
+  , capacity__(capacity) {
+    js_memory_pressure_handler_id__ = JSMemoryPressure::AddHandler([this](double fraction) {
+      return Evict(fraction);
+    });
+  }
+  
+  JSScriptCache::~JSScriptCache() HAL_NOEXCEPT {
+    JSMemoryPressure::RemoveHandler(js_memory_pressure_handler_id__);
+  }
+  
+  JSScript JSScriptCache::GetScript(const JSString& script, const JSString& source_url, int starting_line_number) {
+    if (const auto js_script = Find(script, source_url, starting_line_number)) {
+      return *js_script;
+    }
+    
+    Key key { script, source_url, starting_line_number };
+    
+    // Parse outside of the lock, and before evicting, so a syntax
+    // error leaves the cache as it was.
+    JSScript js_script(js_context_group__, script, source_url, starting_line_number);
+    if (capacity__ == 0) {
+      return js_script;
+    }
+    
+    auto shared_js_script = std::make_shared<const JSScript>(js_script);
+    
+    HAL_JSSCRIPTCACHE_LOCK_GUARD;
+    const auto position = index__.find(key);
+    if (position != index__.end()) {
+      // Another thread parsed it first.
+      entries__.splice(entries__.begin(), entries__, position -> second);
+      return *position -> second -> second;
+    }
+    
+    if (entries__.size() >= capacity__) {
+      index__.erase(entries__.back().first);
+      entries__.pop_back();
+    }
+    
+    entries__.emplace_front(key, std::move(shared_js_script));
+    index__.emplace(std::move(key), entries__.begin());
+    UpdateSize();
+    return js_script;
+  }
+  
+  std::shared_ptr<const JSScript> JSScriptCache::Find(const JSString& script, const JSString& source_url, int starting_line_number) {
+    // Every JSEvaluateScript looks here first, and most groups never
+    // cache a script.
+    if (size__.load(std::memory_order_relaxed) == 0) {
+      return nullptr;
+    }
+    
+    // JSString keeps its hash once computed, so hashing the key here
+    // leaves only the cheap part of the lookup for under the lock.
+    const Key key { script, source_url, starting_line_number };
+    static_cast<void>(KeyHash()(key));
+    
+    HAL_JSSCRIPTCACHE_LOCK_GUARD;
+    const auto position = index__.find(key);
+    if (position == index__.end()) {
+      return nullptr;
+    }
+    
+    entries__.splice(entries__.begin(), entries__, position -> second);
+    return position -> second -> second;
+  }
+  
+  std::size_t JSScriptCache::size() const HAL_NOEXCEPT {
+    HAL_JSSCRIPTCACHE_LOCK_GUARD;
+    return entries__.size();
+  }
+  
+  void JSScriptCache::clear() HAL_NOEXCEPT {
+    HAL_JSSCRIPTCACHE_LOCK_GUARD;
+    index__.clear();
+    entries__.clear();
+    UpdateSize();
+  }
+  
+  std::size_t JSScriptCache::Evict(double fraction) HAL_NOEXCEPT {
+    HAL_JSSCRIPTCACHE_LOCK_GUARD;
+    const auto count = JSMemoryPressure::GetEvictionCount(entries__.size(), fraction);
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      // The UTF-16 source and URL, a list node and a hash map node.
+      const auto& key = entries__.back().first;
+      result += (key.script.length() + key.source_url.length()) * sizeof(char16_t) + sizeof(EntryList::value_type) + sizeof(std::pair<Key, EntryList::iterator>) + 4 * sizeof(void*);
+      index__.erase(key);
+      entries__.pop_back();
+    }
+    UpdateSize();
+    return result;
+  }
+  
+  std::shared_ptr<JSScriptCache> JSContextGroup::GetScriptCache() const {
+    std::lock_guard<detail::JSMutex> lock(state__ -> script_cache_mutex);
+    auto js_script_cache = state__ -> script_cache.lock();
+    if (!js_script_cache) {
+      js_script_cache = std::make_shared<JSScriptCache>(*this);
+      state__ -> script_cache = js_script_cache;
+    }
+    return js_script_cache;
+  }
+  
+  std::future<std::size_t> JSContextGroup::PrecompileAsync(std::vector<JSScriptSource> sources) const {
+    // The cache holds a copy of this group, so neither goes away
+    // before the thread is done with them.
+    const auto js_script_cache = GetScriptCache();
+    return std::async(std::launch::async, [js_script_cache](const std::vector<JSScriptSource>& sources) {
+      std::size_t count = 0;
+      for (const auto& source : sources) {
+        try {
+          js_script_cache -> GetScript(source.script, source.source_url, source.starting_line_number);
+          ++count;
+        } catch (const std::runtime_error&) {
+          // Left for JSEvaluateScript to report where it is evaluated.
+        }
+      }
+      return count;
+    }, std::move(sources));
+  }
+  
+} // namespace HAL {
+
+#endif // HAL_SCRIPT_REF_ENABLE
@@ -0,0 +1,109 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSScriptSyntaxCheck.hpp"
+
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSMappedFile.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+namespace HAL {
+
+  namespace {
+
+    typedef std::unique_ptr<std::remove_pointer<JSStringRef>::type, void(*)(JSStringRef)> JSStringPtr;
+
+    JSStringPtr CreateJSString(const char* data, std::size_t length) {
+      std::unique_ptr<JSChar[]> characters(new JSChar[length > 0 ? length : 1]);
+      const auto characters_length = detail::TranscodeUTF8ToUTF16(data, length, characters.get());
+      return JSStringPtr(detail::CreateJSStringWithCharacters(characters.get(), characters_length), JSStringRelease);
+    }
+
+    std::string ToString(JSContextRef js_context_ref, JSValueRef js_value_ref) {
+      JSStringPtr js_string(JSValueToStringCopy(js_context_ref, js_value_ref, nullptr), JSStringRelease);
+      return js_string ? detail::ToUTF8String(js_string.get()) : std::string();
+    }
+
+    void CheckFile(JSGlobalContextRef js_context_ref, JSScriptSyntaxDiagnostic& diagnostic) {
+      diagnostic.valid       = false;
+      diagnostic.line_number = 0;
+      try {
+        const detail::JSMappedFile file(diagnostic.path);
+        const auto script     = CreateJSString(file.data(), file.size());
+        const auto source_url = CreateJSString(diagnostic.path.data(), diagnostic.path.size());
+
+        JSValueRef exception { nullptr };
+        diagnostic.valid = JSCheckScriptSyntax(js_context_ref, script.get(), source_url.get(), 1, &exception);
+        if (!diagnostic.valid && exception) {
+          diagnostic.message = ToString(js_context_ref, exception);
+          const auto exception_object_ref = JSValueToObject(js_context_ref, exception, nullptr);
+          if (exception_object_ref) {
+            const auto line_name = CreateJSString("line", 4);
+            const auto line_ref  = JSObjectGetProperty(js_context_ref, exception_object_ref, line_name.get(), nullptr);
+            diagnostic.line_number = static_cast<int>(JSValueToNumber(js_context_ref, line_ref, nullptr));
+          }
+        }
+      } catch (const std::exception& e) {
+        diagnostic.message = e.what();
+      }
+    }
+
+  } // namespace {
+
+  std::vector<JSScriptSyntaxDiagnostic> CheckScriptSyntaxParallel(const std::vector<std::string>& paths, unsigned thread_count) {
+    std::vector<JSScriptSyntaxDiagnostic> diagnostics(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+      diagnostics[i].path = paths[i];
+    }
+
+    if (thread_count == 0) {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = static_cast<unsigned>(std::min<std::size_t>(thread_count, paths.size()));
+
+    // The workers share one cursor into paths instead of fixed ranges,
+    // so the load stays balanced however file sizes vary.
+    std::atomic<std::size_t> next_index { 0 };
+    const auto worker = [&diagnostics, &next_index]() {
+      const auto js_context_group_ref = detail::CreateJSContextGroup();
+      const auto js_context_ref       = JSGlobalContextCreateInGroup(js_context_group_ref, nullptr);
+      for (auto index = next_index++; index < diagnostics.size(); index = next_index++) {
+        CheckFile(js_context_ref, diagnostics[index]);
+      }
+      JSGlobalContextRelease(js_context_ref);
+      JSContextGroupRelease(js_context_group_ref);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (unsigned i = 1; i < thread_count; ++i) {
+      threads.emplace_back(worker);
+    }
+
+    // The calling thread is one of the workers.
+    if (thread_count > 0) {
+      worker();
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    return diagnostics;
+  }
+
+} // namespace HAL {
@@ -0,0 +1,176 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSStackProfiler.hpp"
+
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSStackSample.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include <JavaScriptCore/JavaScript.h>
+
+namespace HAL {
+
+  std::atomic<bool> JSStackProfiler::enabled__ { false };
+
+  namespace {
+
+    struct StackProfile final {
+      std::mutex                           mutex;
+      std::map<std::string, std::uint64_t> counts;
+      std::size_t                          sample_count { 0 };
+      std::atomic<std::uint32_t>           sample_interval { 1000 };
+    };
+
+    StackProfile& GetStackProfile() {
+      static StackProfile profile;
+      return profile;
+    }
+
+#ifdef HAL_STACK_PROFILE_ENABLE
+    HAL_THREAD_LOCAL std::uint32_t sample_countdown = 0;
+
+    std::string ToUTF8String(JSStringRef string_ref) {
+      std::vector<char> buffer(JSStringGetMaximumUTF8CStringSize(string_ref));
+      const auto size = JSStringGetUTF8CString(string_ref, buffer.data(), buffer.size());
+      return std::string(buffer.data(), size > 0 ? size - 1 : 0);
+    }
+
+    // Return the stack of a new Error, which JavaScriptCore writes as
+    // one "function@url:line:column" frame per line, innermost first.
+    std::string GetJSStack(JSContextRef context_ref) {
+      JSValueRef exception { nullptr };
+      const auto error_ref = JSObjectMakeError(context_ref, 0, nullptr, &exception);
+      if (!error_ref || exception) {
+        return std::string();
+      }
+
+      const auto stack_name_ref = detail::CreateJSStringWithUTF8CString("stack");
+      const auto stack_ref      = JSObjectGetProperty(context_ref, error_ref, stack_name_ref, &exception);
+      JSStringRelease(stack_name_ref);
+      if (exception || !JSValueIsString(context_ref, stack_ref)) {
+        return std::string();
+      }
+
+      const auto stack_string_ref = JSValueToStringCopy(context_ref, stack_ref, nullptr);
+      const auto stack            = ToUTF8String(stack_string_ref);
+      JSStringRelease(stack_string_ref);
+      return stack;
+    }
+
+    // Turn the stack into the outermost first, ';' separated frames of
+    // the folded format. ';' can't appear within a frame.
+    std::string FoldJSStack(const std::string& stack, const char* native_name, const char* callback_name) {
+      std::vector<std::string> frames;
+      std::istringstream is(stack);
+      for (std::string frame; std::getline(is, frame);) {
+        if (frame.empty()) {
+          continue;
+        }
+        for (auto& c : frame) {
+          if (c == ';') {
+            c = ',';
+          }
+        }
+        if (frame[0] == '@') {
+          frame.insert(0, "(anonymous)");
+        }
+        frames.push_back(frame);
+      }
+
+      std::string folded;
+      for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame) {
+        folded += *frame;
+        folded += ';';
+      }
+      folded += native_name;
+      folded += ':';
+      folded += callback_name;
+      return folded;
+    }
+#endif
+
+  } // namespace {
+
+#ifdef HAL_STACK_PROFILE_ENABLE
+  namespace detail {
+
+    void CountJSStackSample(JSContextRef context_ref, const char* native_name, const char* callback_name) HAL_NOEXCEPT {
+      auto& profile = GetStackProfile();
+      const auto sample_interval = profile.sample_interval.load(std::memory_order_relaxed);
+      if (sample_countdown == 0 || sample_countdown > sample_interval) {
+        sample_countdown = sample_interval;
+      }
+      if (--sample_countdown > 0) {
+        return;
+      }
+
+      try {
+        const auto folded = FoldJSStack(GetJSStack(context_ref), native_name, callback_name);
+        std::lock_guard<std::mutex> lock(profile.mutex);
+        ++profile.counts[folded];
+        ++profile.sample_count;
+      } catch (...) {
+        // Drop the sample rather than disturb the callback.
+      }
+    }
+
+  } // namespace detail {
+#endif
+
+  void JSStackProfiler::Start(std::uint32_t sample_interval) {
+    if (sample_interval == 0) {
+      detail::ThrowInvalidArgument("JSStackProfiler", "The sample interval must be at least 1.");
+    }
+
+    auto& profile = GetStackProfile();
+    {
+      std::lock_guard<std::mutex> lock(profile.mutex);
+      profile.counts.clear();
+      profile.sample_count = 0;
+    }
+    profile.sample_interval.store(sample_interval, std::memory_order_relaxed);
+    enabled__.store(true, std::memory_order_relaxed);
+  }
+
+  void JSStackProfiler::Stop() HAL_NOEXCEPT {
+    enabled__.store(false, std::memory_order_relaxed);
+  }
+
+  std::size_t JSStackProfiler::get_sample_count() HAL_NOEXCEPT {
+    auto& profile = GetStackProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    return profile.sample_count;
+  }
+
+  std::string JSStackProfiler::ToFoldedStacks() {
+    auto& profile = GetStackProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    std::ostringstream os;
+    for (const auto& entry : profile.counts) {
+      os << entry.first << " " << entry.second << "\n";
+    }
+    return os.str();
+  }
+
+  void JSStackProfiler::WriteFoldedStacks(const std::string& path) {
+    std::ofstream ofstream(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    ofstream << ToFoldedStacks();
+    ofstream.close();
+    if (!ofstream) {
+      detail::ThrowRuntimeError("JSStackProfiler", "Unable to write the stacks to " + path);
+    }
+  }
+
+} // namespace HAL {
@@ -0,0 +1,233 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSStatistics.hpp"
+#include "HAL/HAL.hpp"
+
+#include "HAL/detail/JSAPIStatistics.hpp"
+#include "HAL/detail/JSExportClassInfo.hpp"
+#include "HAL/detail/JSExportConstantCache.hpp"
+#include "HAL/detail/JSPropertyNameAccumulator.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <set>
+#include <sstream>
+
+namespace HAL {
+
+  namespace {
+
+    void WriteValue(std::ostream& os, double value) {
+      // Counts stay exact up to 2^53.
+      const auto precision = os.precision(17);
+      os << value;
+      os.precision(precision);
+    }
+
+#ifdef HAL_PERFORMANCE_COUNTER_ENABLE
+    template<typename T>
+    void AddPerformanceCounters(std::vector<JSStatisticsSample>& samples, const char* type) {
+      using counter = detail::JSPerformanceCounter<T>;
+      const std::vector<std::pair<std::string, std::string>> labels { { "type", type } };
+      samples.push_back({ "hal_objects_alive"                  , "HAL objects alive by type"         , labels, static_cast<double>(counter::get_objects_alive()) });
+      samples.push_back({ "hal_objects_created_total"          , "HAL objects created by type"       , labels, static_cast<double>(counter::get_objects_created()) });
+      samples.push_back({ "hal_objects_destroyed_total"        , "HAL objects destroyed by type"     , labels, static_cast<double>(counter::get_objects_destroyed()) });
+      samples.push_back({ "hal_objects_copy_constructed_total" , "HAL objects copy constructed"      , labels, static_cast<double>(counter::get_objects_copy_constructed()) });
+      samples.push_back({ "hal_objects_move_constructed_total" , "HAL objects move constructed"      , labels, static_cast<double>(counter::get_objects_move_constructed()) });
+      samples.push_back({ "hal_objects_copy_assigned_total"    , "HAL objects copy assigned"         , labels, static_cast<double>(counter::get_objects_copy_assigned()) });
+      samples.push_back({ "hal_objects_move_assigned_total"    , "HAL objects move assigned"         , labels, static_cast<double>(counter::get_objects_move_assigned()) });
+    }
+#endif
+
+  } // namespace {
+
+  JSStatistics JSStatistics::Capture() {
+    JSStatistics statistics;
+    statistics.CaptureProcess();
+    return statistics;
+  }
+
+  JSStatistics JSStatistics::Capture(const JSContextGroup& js_context_group) {
+    JSStatistics statistics;
+    statistics.CaptureProcess();
+
+    const auto group = js_context_group.GetStatistics();
+    statistics.Add("hal_context_group_contexts"         , "JSContexts HAL holds in the group"             , {}, static_cast<double>(group.contexts.size()));
+    statistics.Add("hal_context_group_values"           , "JSValues HAL protects in the group"            , {}, static_cast<double>(group.value_count));
+    statistics.Add("hal_context_group_objects"          , "JSObjects HAL protects in the group"           , {}, static_cast<double>(group.object_count));
+    statistics.Add("hal_function_callbacks"             , "Callbacks of JSContext::CreateFunction"        , {}, static_cast<double>(group.function_callback_count));
+    statistics.Add("hal_private_data"                   , "Private data entries of non-JSExport JSObjects", {}, static_cast<double>(group.private_data_count));
+    if (group.has_heap_statistics) {
+      statistics.Add("hal_heap_size_bytes"              , "JavaScriptCore heap size"                      , {}, static_cast<double>(group.heap_size));
+      statistics.Add("hal_heap_capacity_bytes"          , "JavaScriptCore heap capacity"                  , {}, static_cast<double>(group.heap_capacity));
+      statistics.Add("hal_heap_extra_memory_bytes"      , "Extra memory reported to JavaScriptCore"       , {}, static_cast<double>(group.extra_memory_size));
+      statistics.Add("hal_heap_objects"                 , "Objects in the JavaScriptCore heap"            , {}, static_cast<double>(group.heap_object_count));
+      statistics.Add("hal_heap_protected_objects"       , "Protected objects in the JavaScriptCore heap"  , {}, static_cast<double>(group.protected_object_count));
+    }
+    if (group.has_quotas) {
+      const auto& quota_usage = group.quota_usage;
+      statistics.Add("hal_quota_usage"                  , "Usage of a resource the group's quotas limit"  , { { "resource", to_string(JSQuotaResource::CPUTime) } }         , quota_usage.cpu_time_seconds);
+      statistics.Add("hal_quota_usage"                  , "Usage of a resource the group's quotas limit"  , { { "resource", to_string(JSQuotaResource::ProtectedHandles) } }, static_cast<double>(group.value_count + group.object_count));
+      statistics.Add("hal_quota_usage"                  , "Usage of a resource the group's quotas limit"  , { { "resource", to_string(JSQuotaResource::ExternalMemory) } }  , static_cast<double>(quota_usage.external_memory_bytes));
+      statistics.Add("hal_quota_usage"                  , "Usage of a resource the group's quotas limit"  , { { "resource", to_string(JSQuotaResource::QueuedTasks) } }     , static_cast<double>(quota_usage.queued_tasks));
+      statistics.Add("hal_quota_soft_exceeded_total"    , "Times a usage rose past its soft limit"        , {}, static_cast<double>(quota_usage.soft_limit_exceeded_count));
+      statistics.Add("hal_quota_hard_exceeded_total"    , "Times a usage rose past its hard limit"        , {}, static_cast<double>(quota_usage.hard_limit_exceeded_count));
+      statistics.Add("hal_quota_terminated_total"       , "Scripts, calls and tasks stopped by a hard limit", {}, static_cast<double>(quota_usage.terminated_count));
+    }
+    
+#ifdef HAL_API_STATISTICS_ENABLE
+    // Summed over the contexts of the group; JSContext::GetAPIStatistics
+    // has them per context.
+    std::uint64_t calls[detail::kJSAPICategoryCount]               = {};
+    std::uint64_t sampled_calls[detail::kJSAPICategoryCount]       = {};
+    std::uint64_t sampled_nanoseconds[detail::kJSAPICategoryCount] = {};
+    for (const auto& context : group.contexts) {
+      const auto api_statistics = detail::GetJSAPIStatistics(JSContextGetGlobalContext(context.js_context_ref));
+      for (std::size_t i = 0; i < detail::kJSAPICategoryCount; ++i) {
+        calls[i]               += api_statistics -> calls[i].load(std::memory_order_relaxed);
+        sampled_calls[i]       += api_statistics -> sampled_calls[i].load(std::memory_order_relaxed);
+        sampled_nanoseconds[i] += api_statistics -> sampled_nanoseconds[i].load(std::memory_order_relaxed);
+      }
+    }
+    for (std::size_t i = 0; i < detail::kJSAPICategoryCount; ++i) {
+      const std::vector<std::pair<std::string, std::string>> labels { { "category", detail::to_string(static_cast<detail::JSAPICategory>(i)) } };
+      statistics.Add("hal_api_calls_total"              , "JavaScriptCore calls HAL made in the group"    , labels, static_cast<double>(calls[i]));
+      statistics.Add("hal_api_sampled_calls_total"      , "JavaScriptCore calls that were timed"          , labels, static_cast<double>(sampled_calls[i]));
+      statistics.Add("hal_api_sampled_nanoseconds_total", "Time spent in the timed JavaScriptCore calls"  , labels, static_cast<double>(sampled_nanoseconds[i]));
+    }
+#endif
+    return statistics;
+  }
+
+  void JSStatistics::CaptureProcess() {
+    for (const auto class_info : detail::GetJSExportClassInfos()) {
+      const auto class_statistics = detail::GetJSExportClassStatistics(*class_info);
+      Add("hal_export_live_objects"          , "Live native objects of a JSExport class"         , { { "class", class_info -> name } }, static_cast<double>(class_statistics.live_count));
+      Add("hal_export_instance_bytes"        , "Memory of the live native objects of a class"    , { { "class", class_info -> name } }, static_cast<double>(class_statistics.instance_bytes));
+      Add("hal_export_external_memory_bytes" , "External memory reported by objects of a class"  , { { "class", class_info -> name } }, static_cast<double>(class_statistics.external_memory_bytes));
+      Add("hal_export_finalized_total"       , "Native objects of a class finalized"             , { { "class", class_info -> name } }, static_cast<double>(class_statistics.finalized_count));
+    }
+    Add("hal_export_cached_constants", "Constants cached by all JSExport classes", {}, static_cast<double>(detail::JSExportConstantCache::GetTotalSize()));
+    
+    const auto garbage_collection = JSContext::GetGarbageCollectionStatistics();
+    Add("hal_gc_collections_total"      , "Garbage collections requested by HAL"          , {}, static_cast<double>(garbage_collection.collection_count));
+    Add("hal_gc_pause_nanoseconds_total", "Time spent in garbage collections HAL requested", {}, static_cast<double>(garbage_collection.total_pause_nanoseconds));
+    Add("hal_gc_max_pause_nanoseconds"  , "Longest garbage collection HAL requested"      , {}, static_cast<double>(garbage_collection.max_pause_nanoseconds));
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+    for (const auto& latency : detail::GetCallbackLatencies()) {
+      const std::vector<std::pair<std::string, std::string>> labels { { "class", latency.class_name }, { "callback", detail::to_string(latency.kind) } };
+      Add("hal_export_callback_calls_total"      , "Calls of a JSExport callback kind"          , labels, static_cast<double>(latency.histogram -> get_count()));
+      Add("hal_export_callback_nanoseconds_total", "Time spent in a JSExport callback kind"     , labels, static_cast<double>(latency.histogram -> get_total_nanoseconds()));
+      Add("hal_export_callback_p99_nanoseconds"  , "99th percentile of a JSExport callback kind", labels, static_cast<double>(latency.histogram -> GetPercentile(99)));
+    }
+#endif
+
+#ifdef HAL_LOCK_STATISTICS_ENABLE
+    for (const auto lock_statistics : detail::GetJSLockStatistics()) {
+      const std::vector<std::pair<std::string, std::string>> labels { { "lock", lock_statistics -> name } };
+      Add("hal_lock_acquisitions_total"          , "Acquisitions of a HAL lock"                    , labels, static_cast<double>(lock_statistics -> acquisitions.load(std::memory_order_relaxed)));
+      Add("hal_lock_contended_acquisitions_total", "Acquisitions of a HAL lock that had to wait"   , labels, static_cast<double>(lock_statistics -> contended_acquisitions.load(std::memory_order_relaxed)));
+      Add("hal_lock_wait_nanoseconds_total"      , "Time spent waiting for a HAL lock"             , labels, static_cast<double>(lock_statistics -> wait_nanoseconds.load(std::memory_order_relaxed)));
+    }
+#endif
+
+#ifdef HAL_PERFORMANCE_COUNTER_ENABLE
+    AddPerformanceCounters<JSContextGroup>(samples__, "JSContextGroup");
+    AddPerformanceCounters<JSContext>(samples__, "JSContext");
+    AddPerformanceCounters<JSString>(samples__, "JSString");
+    AddPerformanceCounters<JSValue>(samples__, "JSValue");
+    AddPerformanceCounters<JSUndefined>(samples__, "JSUndefined");
+    AddPerformanceCounters<JSNull>(samples__, "JSNull");
+    AddPerformanceCounters<JSBoolean>(samples__, "JSBoolean");
+    AddPerformanceCounters<JSNumber>(samples__, "JSNumber");
+    AddPerformanceCounters<JSObject>(samples__, "JSObject");
+    AddPerformanceCounters<JSArray>(samples__, "JSArray");
+    AddPerformanceCounters<JSDate>(samples__, "JSDate");
+    AddPerformanceCounters<JSError>(samples__, "JSError");
+    AddPerformanceCounters<JSFunction>(samples__, "JSFunction");
+    AddPerformanceCounters<JSRegExp>(samples__, "JSRegExp");
+    AddPerformanceCounters<JSClass>(samples__, "JSClass");
+    AddPerformanceCounters<JSPropertyNameAccumulator>(samples__, "JSPropertyNameAccumulator");
+#endif
+  }
+
+  void JSStatistics::Add(const std::string& name, const std::string& help, std::vector<std::pair<std::string, std::string>> labels, double value) {
+    samples__.push_back({ name, help, std::move(labels), value });
+  }
+
+  std::string JSStatistics::ToJSON() const {
+    std::ostringstream os;
+    os << "{\"samples\":[";
+    for (std::size_t i = 0; i < samples__.size(); ++i) {
+      const auto& sample = samples__[i];
+      os << (i > 0 ? "," : "") << "{\"name\":\"" << detail::EscapeJSONString(sample.name) << "\",\"labels\":{";
+      for (std::size_t j = 0; j < sample.labels.size(); ++j) {
+        os << (j > 0 ? "," : "") << "\"" << detail::EscapeJSONString(sample.labels[j].first) << "\":\"" << detail::EscapeJSONString(sample.labels[j].second) << "\"";
+      }
+      os << "},\"value\":";
+      WriteValue(os, sample.value);
+      os << "}";
+    }
+    os << "]}";
+    return os.str();
+  }
+
+  std::string JSStatistics::ToPrometheus() const {
+    // The samples of a metric must be written together, in the order
+    // the metrics were first added.
+    std::vector<std::string> names;
+    std::set<std::string>    seen;
+    for (const auto& sample : samples__) {
+      if (seen.insert(sample.name).second) {
+        names.push_back(sample.name);
+      }
+    }
+
+    std::ostringstream os;
+    for (const auto& name : names) {
+      bool described = false;
+      for (const auto& sample : samples__) {
+        if (sample.name != name) {
+          continue;
+        }
+
+        if (!described) {
+          os << "# HELP " << sample.name << " " << sample.help << "\n";
+          described = true;
+        }
+
+        os << sample.name;
+        if (!sample.labels.empty()) {
+          os << "{";
+          for (std::size_t i = 0; i < sample.labels.size(); ++i) {
+            os << (i > 0 ? "," : "") << sample.labels[i].first << "=\"" << detail::EscapeJSONString(sample.labels[i].second) << "\"";
+          }
+          os << "}";
+        }
+        os << " ";
+        WriteValue(os, sample.value);
+        os << "\n";
+      }
+    }
+    return os.str();
+  }
+
+  void JSStatistics::Install(const JSContext& js_context, const std::string& function_name) {
+    // The function finds its JSContext through this_object, so it
+    // doesn't keep the JSContext alive itself.
+    JSFunctionCallback callback = [](const std::vector<JSValue>&, JSObject& this_object) {
+      const auto js_context = this_object.get_context();
+      return js_context.CreateValueFromJSON(Capture(js_context.get_context_group()).ToJSON());
+    };
+
+    auto global_object = js_context.get_global_object();
+    global_object.SetProperty(function_name, js_context.CreateFunction(function_name, callback), { JSPropertyAttribute::DontEnum });
+  }
+
+} // namespace HAL {
@@ -7,8 +7,36 @@
  */
 
 #include "HAL/JSString.hpp"
+#include "HAL/detail/JSAllocationSample.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace {
+  // Guards the one-time UTF-8 conversion of lazily materialized
+  // JSStrings. A small pool of mutexes selected by address avoids both
+  // a mutex per JSString and a single global lock.
+  const std::size_t kStringMutexCount = 16;
+  std::array<std::mutex, kStringMutexCount> js_string_mutexes__;
+  
+  std::mutex& GetStringMutex(const void* js_string_ptr) {
+    const auto bits = reinterpret_cast<std::uintptr_t>(js_string_ptr);
+    return js_string_mutexes__[(bits >> 4) % kStringMutexCount];
+  }
+  
+  // The atom table behind JSString::Intern. Entries are never removed
+  // and unordered_map never moves its elements, so references handed
+  // out stay valid.
+  std::unordered_map<std::string, HAL::JSString> js_string_atom_table__;
+  HAL::detail::JSMutex                           js_string_atom_table_mutex__ HAL_LOCK_NAME("JSString atom table");
+}
 
 namespace HAL {
   
@@ -18,27 +46,69 @@ namespace HAL {
   }
   
   JSString::JSString(const char* string) HAL_NOEXCEPT
-  : js_string_ref__(JSStringCreateWithUTF8CString(string))
+  : js_string_ref__(detail::CreateJSStringRefWithUTF8(string, std::strlen(string)))
   , string__(string) {
     HAL_LOG_TRACE("JSString:: ctor 1 ", this);
+    HAL_ALLOCATION_SAMPLE("JSString");
     HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " (implicit) for ", this);
-    
-    std::hash<std::string> hash_function = std::hash<std::string>();
-    hash_value__ = hash_function(static_cast<std::string>(string__));
+    string_valid__.store(true, std::memory_order_relaxed);
     //HAL_LOG_TRACE("JSString::JSString(const char*)");
   }
   
   JSString::JSString(const std::string& string) HAL_NOEXCEPT
-  : js_string_ref__(JSStringCreateWithUTF8CString(string.c_str()))
+  : js_string_ref__(detail::CreateJSStringRefWithUTF8(string.c_str(), string.size()))
   , string__(string) {
     HAL_LOG_TRACE("JSString:: ctor 2 ", this);
+    HAL_ALLOCATION_SAMPLE("JSString");
     HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " (implicit) for ", this);
-
-    std::hash<std::string> hash_function = std::hash<std::string>();
-    hash_value__ = hash_function(static_cast<std::string>(string__));
+    string_valid__.store(true, std::memory_order_relaxed);
     //HAL_LOG_TRACE("JSString::JSString(const std::string&)");
   }
   
+  JSString::JSString(std::string&& string) HAL_NOEXCEPT
+  : string__(std::move(string)) {
+    // string__ is null-terminated, so JavaScriptCore can read it in
+    // place.
+    js_string_ref__ = detail::CreateJSStringRefWithUTF8(string__.c_str(), string__.size());
+    HAL_LOG_TRACE("JSString:: ctor 5 ", this);
+    HAL_ALLOCATION_SAMPLE("JSString");
+    HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " (implicit) for ", this);
+    string_valid__.store(true, std::memory_order_relaxed);
+  }
+  
+  JSString::JSString(const char* string, std::size_t length) HAL_NOEXCEPT
+  : string__(string, length) {
+    js_string_ref__ = detail::CreateJSStringRefWithUTF8(string__.data(), string__.size());
+    HAL_LOG_TRACE("JSString:: ctor 6 ", this);
+    HAL_ALLOCATION_SAMPLE("JSString");
+    HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " (implicit) for ", this);
+    string_valid__.store(true, std::memory_order_relaxed);
+  }
+  
+  static_assert(sizeof(char16_t) == sizeof(JSChar), "JSChar must be a UTF-16 code unit");
+  
+  JSString::JSString(const char16_t* string, std::size_t length) HAL_NOEXCEPT
+  : js_string_ref__(detail::CreateJSStringWithCharacters(reinterpret_cast<const JSChar*>(string), length)) {
+    HAL_LOG_TRACE("JSString:: ctor 4 ", this);
+    HAL_ALLOCATION_SAMPLE("JSString");
+    HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " (implicit) for ", this);
+    
+    // The UTF-8 copy and hash are computed by get_string on first use.
+  }
+  
+  JSString::JSString(const std::u16string& string) HAL_NOEXCEPT
+  : JSString(string.data(), string.size()) {
+  }
+  
+  JSString::U16View JSString::u16view() const HAL_NOEXCEPT {
+    HAL_JSSTRING_LOCK_GUARD;
+    return U16View(reinterpret_cast<const char16_t*>(JSStringGetCharactersPtr(js_string_ref__)), JSStringGetLength(js_string_ref__));
+  }
+  
+  JSString::operator std::u16string() const {
+    return u16view();
+  }
+  
   const std::size_t JSString::length() const  HAL_NOEXCEPT{
     HAL_JSSTRING_LOCK_GUARD;
     return JSStringGetLength(js_string_ref__);
@@ -53,11 +123,75 @@ namespace HAL {
   }
   
   JSString::operator std::string() const HAL_NOEXCEPT {
-    return string__;
+    return get_string();
   }
   
   std::size_t JSString::hash_value() const {
-    return hash_value__;
+    // Hashes are computed from the UTF-16 code units, so they don't
+    // need the UTF-8 copy. Zero means not yet computed; racing threads
+    // compute the same value, so no lock is needed.
+    auto hash_value = hash_value__.load(std::memory_order_relaxed);
+    if (hash_value == 0) {
+      // Truncated on 32-bit platforms.
+      hash_value = static_cast<std::size_t>(detail::HashUTF16(JSStringGetCharactersPtr(js_string_ref__), JSStringGetLength(js_string_ref__)));
+      if (hash_value == 0) {
+        hash_value = 1;
+      }
+      hash_value__.store(hash_value, std::memory_order_relaxed);
+    }
+    return hash_value;
+  }
+  
+  const JSString& JSString::Intern(const std::string& string) {
+    std::lock_guard<detail::JSMutex> lock(js_string_atom_table_mutex__);
+    auto position = js_string_atom_table__.find(string);
+    if (position == js_string_atom_table__.end()) {
+      position = js_string_atom_table__.emplace(string, JSString(string)).first;
+      HAL_LOG_DEBUG("JSString::Intern: ", string);
+    }
+    return position -> second;
+  }
+  
+  JSString JSString::FromExternalBuffer(const char16_t* buffer, std::size_t length, const std::function<void()>& release) {
+    // The JavaScriptCore C API has no way to adopt external memory, so
+    // copy exactly once and hand the buffer back right away.
+    JSString js_string(buffer, length);
+    if (release) {
+      release();
+    }
+    return js_string;
+  }
+  
+  JSString JSString::FromExternalLatin1Buffer(const char* buffer, std::size_t length, const std::function<void()>& release) {
+    // ASCII is also UTF-8, from which JavaScriptCore keeps it in 8-bit
+    // characters.
+    if (detail::CountASCII(buffer, length) == length) {
+      const auto js_string_ref = detail::CreateJSStringRefWithUTF8(buffer, length);
+      if (release) {
+        release();
+      }
+      const JSString js_string(js_string_ref);
+      JSStringRelease(js_string_ref);
+      return js_string;
+    }
+    
+    std::unique_ptr<char16_t[]> characters(new char16_t[length > 0 ? length : 1]);
+    detail::WidenLatin1(buffer, length, reinterpret_cast<JSChar*>(characters.get()));
+    if (release) {
+      release();
+    }
+    return JSString(characters.get(), length);
+  }
+  
+  const std::string& JSString::get_string() const {
+    if (!string_valid__.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(GetStringMutex(this));
+      if (!string_valid__.load(std::memory_order_relaxed)) {
+        string__ = detail::ToUTF8String(js_string_ref__);
+        string_valid__.store(true, std::memory_order_release);
+      }
+    }
+    return string__;
   }
   
   JSString::~JSString() HAL_NOEXCEPT {
@@ -68,20 +202,33 @@ namespace HAL {
   
   JSString::JSString(const JSString& rhs) HAL_NOEXCEPT
   : js_string_ref__(rhs.js_string_ref__)
-  , string__(rhs.string__)
-  , hash_value__(rhs.hash_value__) {
+  , hash_value__(rhs.hash_value__.load(std::memory_order_relaxed)) {
     HAL_LOG_TRACE("JSString:: copy ctor ", this);
     HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " for ", this);
     JSStringRetain(js_string_ref__);
+    
+    // Share the conversion if rhs has already done it, otherwise stay
+    // lazy.
+    if (rhs.string_valid__.load(std::memory_order_acquire)) {
+      string__ = rhs.string__;
+      string_valid__.store(true, std::memory_order_relaxed);
+    }
   }
   
   JSString::JSString(JSString&& rhs) HAL_NOEXCEPT
   : js_string_ref__(rhs.js_string_ref__)
-  , string__(std::move(rhs.string__))
-  , hash_value__(std::move(rhs.hash_value__)) {
+  , hash_value__(rhs.hash_value__.load(std::memory_order_relaxed)) {
     HAL_LOG_TRACE("JSString:: move ctor ", this);
     HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " for ", this);
     JSStringRetain(js_string_ref__);
+    
+    // rhs keeps its JSStringRef, so it must stay valid after losing
+    // its UTF-8 copy.
+    if (rhs.string_valid__.load(std::memory_order_acquire)) {
+      string__ = std::move(rhs.string__);
+      string_valid__.store(true, std::memory_order_relaxed);
+      rhs.string_valid__.store(false, std::memory_order_relaxed);
+    }
   }
   
   JSString& JSString::operator=(JSString rhs) HAL_NOEXCEPT {
@@ -100,7 +247,14 @@ namespace HAL {
     // effectively swapped.
     swap(js_string_ref__, other.js_string_ref__);
     swap(string__       , other.string__);
-    swap(hash_value__   , other.hash_value__);
+    
+    const auto hash_value = hash_value__.load(std::memory_order_relaxed);
+    hash_value__.store(other.hash_value__.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    other.hash_value__.store(hash_value, std::memory_order_relaxed);
+    
+    const bool string_valid = string_valid__.load(std::memory_order_relaxed);
+    string_valid__.store(other.string_valid__.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    other.string_valid__.store(string_valid, std::memory_order_relaxed);
   }
   
   // For interoperability with the JavaScriptCore C API.
@@ -109,20 +263,47 @@ namespace HAL {
     assert(js_string_ref__);
     JSStringRetain(js_string_ref__);
     HAL_LOG_TRACE("JSString:: ctor 3 ", this);
+    HAL_ALLOCATION_SAMPLE("JSString");
     HAL_LOG_TRACE("JSString:: retain ", js_string_ref__, " for ", this);
-
-    const auto size = JSStringGetMaximumUTF8CStringSize(js_string_ref__);
-    auto buffer = new char[size];
-    JSStringGetUTF8CString(js_string_ref__, buffer, size);
-    string__ = std::string(buffer);
-    delete[] buffer;
     
-    std::hash<std::string> hash_function = std::hash<std::string>();
-    hash_value__ = hash_function(static_cast<std::string>(string__));
+    // The UTF-8 copy and hash are computed by get_string on first use.
   }
   
   bool operator==(const JSString& lhs, const JSString& rhs) {
-    return JSStringIsEqual(static_cast<JSStringRef>(lhs), static_cast<JSStringRef>(rhs));
+    const auto lhs_ref = static_cast<JSStringRef>(lhs);
+    const auto rhs_ref = static_cast<JSStringRef>(rhs);
+    if (lhs_ref == rhs_ref) {
+      return true;
+    }
+    
+    const auto length = JSStringGetLength(lhs_ref);
+    if (length != JSStringGetLength(rhs_ref)) {
+      return false;
+    }
+    
+    return length == 0 || std::memcmp(JSStringGetCharactersPtr(lhs_ref), JSStringGetCharactersPtr(rhs_ref), length * sizeof(JSChar)) == 0;
+  }
+  
+  bool operator<(const JSString& lhs, const JSString& rhs) {
+    const auto lhs_ref = static_cast<JSStringRef>(lhs);
+    const auto rhs_ref = static_cast<JSStringRef>(rhs);
+    if (lhs_ref == rhs_ref) {
+      return false;
+    }
+    
+    // Compare UTF-16 code units in place rather than converting both
+    // strings to std::string.
+    const auto lhs_length = JSStringGetLength(lhs_ref);
+    const auto rhs_length = JSStringGetLength(rhs_ref);
+    const auto lhs_ptr    = JSStringGetCharactersPtr(lhs_ref);
+    const auto rhs_ptr    = JSStringGetCharactersPtr(rhs_ref);
+    const auto length     = std::min(lhs_length, rhs_length);
+    for (std::size_t i = 0; i < length; ++i) {
+      if (lhs_ptr[i] != rhs_ptr[i]) {
+        return lhs_ptr[i] < rhs_ptr[i];
+      }
+    }
+    return lhs_length < rhs_length;
   }
   
 } // namespace HAL {
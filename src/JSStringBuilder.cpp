@@ -0,0 +1,162 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSStringBuilder.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <locale>
+#include <sstream>
+
+namespace HAL {
+
+  JSStringBuilder::JSStringBuilder() HAL_NOEXCEPT {
+  }
+
+  JSStringBuilder::JSStringBuilder(std::size_t capacity) {
+    buffer__.reserve(capacity);
+  }
+
+  void JSStringBuilder::reserve(std::size_t capacity) {
+    buffer__.reserve(capacity);
+  }
+
+  JSStringBuilder& JSStringBuilder::Append(const char* string, std::size_t length) {
+    // UTF-8 never takes more UTF-16 code units than it has bytes, so
+    // transcode into the tail and trim the excess.
+    const auto size = buffer__.size();
+    buffer__.resize(size + length);
+    const auto written = detail::TranscodeUTF8ToUTF16(string, length, buffer__.data() + size);
+    buffer__.resize(size + written);
+    return *this;
+  }
+
+  JSStringBuilder& JSStringBuilder::Append(const char* string) {
+    return Append(string, std::strlen(string));
+  }
+
+  JSStringBuilder& JSStringBuilder::Append(const std::string& string) {
+    return Append(string.data(), string.size());
+  }
+
+  JSStringBuilder& JSStringBuilder::Append(const char16_t* string, std::size_t length) {
+    const auto characters = reinterpret_cast<const JSChar*>(string);
+    buffer__.insert(buffer__.end(), characters, characters + length);
+    return *this;
+  }
+
+  JSStringBuilder& JSStringBuilder::Append(const std::u16string& string) {
+    return Append(string.data(), string.size());
+  }
+
+  JSStringBuilder& JSStringBuilder::Append(char16_t character) {
+    buffer__.push_back(static_cast<JSChar>(character));
+    return *this;
+  }
+
+  JSStringBuilder& JSStringBuilder::Append(const JSString& js_string) {
+    const auto view = js_string.u16view();
+    return Append(view.data(), view.size());
+  }
+
+  JSStringBuilder& JSStringBuilder::AppendJSONString(const char* string, std::size_t length) {
+    std::vector<JSChar> characters(length);
+    characters.resize(detail::TranscodeUTF8ToUTF16(string, length, characters.data()));
+    AppendJSONEscaped(characters.data(), characters.size());
+    return *this;
+  }
+
+  JSStringBuilder& JSStringBuilder::AppendJSONString(const char* string) {
+    return AppendJSONString(string, std::strlen(string));
+  }
+
+  JSStringBuilder& JSStringBuilder::AppendJSONString(const std::string& string) {
+    return AppendJSONString(string.data(), string.size());
+  }
+
+  JSStringBuilder& JSStringBuilder::AppendJSONString(const JSString& js_string) {
+    const auto view = js_string.u16view();
+    AppendJSONEscaped(reinterpret_cast<const JSChar*>(view.data()), view.size());
+    return *this;
+  }
+
+  JSStringBuilder& JSStringBuilder::AppendJSONNumber(double number) {
+    if (!std::isfinite(number)) {
+      return Append("null", 4);
+    }
+
+    // Integers up to 2^53 are exact, and are by far the most common
+    // numbers, so they are written digit by digit instead of through
+    // a stream.
+    if (number == std::floor(number) && std::fabs(number) < 9007199254740992.0) {
+      char  buffer[24];
+      char* end      = buffer + sizeof(buffer);
+      char* begin    = end;
+      auto  integer  = static_cast<std::uint64_t>(std::fabs(number));
+      do {
+        *--begin = static_cast<char>('0' + integer % 10);
+        integer /= 10;
+      } while (integer != 0);
+      if (number < 0) {
+        *--begin = '-';
+      }
+      return Append(begin, static_cast<std::size_t>(end - begin));
+    }
+
+    std::ostringstream os;
+    os.imbue(std::locale::classic());
+    os.precision(17);
+    os << number;
+    return Append(os.str());
+  }
+
+  void JSStringBuilder::AppendJSONEscaped(const JSChar* characters, std::size_t length) {
+    static const char hex_digits[] = "0123456789abcdef";
+
+    buffer__.reserve(buffer__.size() + length + 2);
+    buffer__.push_back('"');
+    for (std::size_t i = 0; i < length; ++i) {
+      const auto character = characters[i];
+      switch (character) {
+        case '"' : buffer__.push_back('\\'); buffer__.push_back('"');  break;
+        case '\\': buffer__.push_back('\\'); buffer__.push_back('\\'); break;
+        case '\b': buffer__.push_back('\\'); buffer__.push_back('b');  break;
+        case '\f': buffer__.push_back('\\'); buffer__.push_back('f');  break;
+        case '\n': buffer__.push_back('\\'); buffer__.push_back('n');  break;
+        case '\r': buffer__.push_back('\\'); buffer__.push_back('r');  break;
+        case '\t': buffer__.push_back('\\'); buffer__.push_back('t');  break;
+        default:
+          if (character < 0x20) {
+            const JSChar escape[] = { '\\', 'u', '0', '0', static_cast<JSChar>(hex_digits[character >> 4]), static_cast<JSChar>(hex_digits[character & 15]) };
+            buffer__.insert(buffer__.end(), escape, escape + 6);
+          } else {
+            buffer__.push_back(character);
+          }
+      }
+    }
+    buffer__.push_back('"');
+  }
+
+  JSString JSStringBuilder::ToJSString() const {
+    return JSString(reinterpret_cast<const char16_t*>(buffer__.data()), buffer__.size());
+  }
+
+  JSValue JSStringBuilder::ToJSValue(const JSContext& js_context) const {
+    return js_context.CreateString(ToJSString());
+  }
+
+  JSValue JSStringBuilder::ToJSONValue(const JSContext& js_context) const {
+    return js_context.CreateValueFromJSON(buffer__.data(), buffer__.size());
+  }
+
+} // namespace HAL {
@@ -0,0 +1,24 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSTimeSlice.hpp"
+
+namespace HAL {
+  
+  bool RunTimeSliced(const std::function<bool()>& step, std::chrono::steady_clock::duration budget) {
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    do {
+      if (!step()) {
+        return true;
+      }
+    } while (std::chrono::steady_clock::now() < deadline);
+    
+    return false;
+  }
+  
+} // namespace HAL {
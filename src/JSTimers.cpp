@@ -0,0 +1,196 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSTimers.hpp"
+
+#include "HAL/JSString.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL {
+
+  struct JSTimers::State final : public std::enable_shared_from_this<State> {
+
+    struct Timer {
+      JSObject                  callback;
+      std::vector<JSValue>      arguments;
+      std::chrono::milliseconds interval;
+      bool                      repeats;
+      std::uint64_t             delayed_task_id;
+    };
+
+    explicit State(const JSRunLoop& js_run_loop)
+    : js_run_loop(js_run_loop) {
+    }
+
+    ~State() HAL_NOEXCEPT {
+      for (const auto& timer : timers) {
+        js_run_loop.CancelDelayed(timer.second.delayed_task_id);
+      }
+    }
+
+    State(const State&)            = delete;
+    State& operator=(const State&) = delete;
+
+    std::uint64_t PostFire(std::uint32_t timer_id, std::chrono::milliseconds delay) {
+      const std::weak_ptr<State> weak_state = shared_from_this();
+      return js_run_loop.PostDelayed([weak_state, timer_id](const JSContext&) {
+        if (const auto state = weak_state.lock()) {
+          state -> Fire(timer_id);
+        }
+      }, delay);
+    }
+
+    void Fire(std::uint32_t timer_id) {
+      const auto position = timers.find(timer_id);
+      if (position == timers.end()) {
+        return;
+      }
+
+      // The callback may clear its own timer, so copy what it needs and
+      // reschedule an interval before calling it.
+      auto callback        = position -> second.callback;
+      const auto arguments = position -> second.arguments;
+      if (position -> second.repeats) {
+        position -> second.delayed_task_id = PostFire(timer_id, position -> second.interval);
+      } else {
+        timers.erase(position);
+      }
+
+      callback(arguments, js_run_loop.get_context().get_global_object());
+    }
+
+    const JSRunLoop                          js_run_loop;
+    std::unordered_map<std::uint32_t, Timer> timers;
+    std::uint32_t                            next_timer_id { 1 };
+  };
+
+  // The private data of each installed function.
+  struct JSTimers::Binding final {
+
+    enum class Function {
+      SetTimeout,
+      SetInterval,
+      ClearTimer
+    };
+
+    std::weak_ptr<State> state;
+    Function             function;
+  };
+
+  namespace {
+
+    std::chrono::milliseconds ToDelay(const JSValue& js_value) {
+      // Browsers clamp delays to a signed 32 bit number of milliseconds.
+      const auto delay = static_cast<double>(js_value);
+      if (std::isnan(delay) || delay < 0) {
+        return std::chrono::milliseconds(0);
+      }
+      return std::chrono::milliseconds(static_cast<std::int64_t>(std::min(delay, static_cast<double>(std::numeric_limits<std::int32_t>::max()))));
+    }
+
+  } // namespace {
+
+  JSTimers::JSTimers(const JSRunLoop& js_run_loop)
+  : state__(std::make_shared<State>(js_run_loop)) {
+  }
+
+  void JSTimers::Install(JSObject object) const {
+    const auto js_context = state__ -> js_run_loop.get_context();
+    const auto install = [this, &js_context, &object](const char* name, Binding::Function function) {
+      const auto function_ref = JSObjectMake(static_cast<JSContextRef>(js_context), GetFunctionClass(), new Binding { state__, function });
+      object.SetProperty(JSString(name), JSObject(js_context, function_ref));
+    };
+
+    install("setTimeout"   , Binding::Function::SetTimeout);
+    install("setInterval"  , Binding::Function::SetInterval);
+    install("clearTimeout" , Binding::Function::ClearTimer);
+    install("clearInterval", Binding::Function::ClearTimer);
+  }
+
+  std::size_t JSTimers::get_timer_count() const HAL_NOEXCEPT {
+    return state__ -> timers.size();
+  }
+
+  JSValueRef JSTimers::CallFunction(JSContextRef context_ref, JSObjectRef function_ref, JSObjectRef, size_t argument_count, const JSValueRef arguments_array[], JSValueRef* exception) {
+    std::string message;
+    try {
+      const auto binding = static_cast<Binding*>(JSObjectGetPrivate(function_ref));
+      const auto state   = binding -> state.lock();
+      if (!state) {
+        detail::ThrowRuntimeError("JSTimers", "The JSTimers of this function has been destroyed.");
+      }
+
+      const auto js_context = state -> js_run_loop.get_context();
+      if (binding -> function == Binding::Function::ClearTimer) {
+        if (argument_count > 0) {
+          const auto timer_id = static_cast<double>(JSValue(js_context, arguments_array[0]));
+          const auto position = timer_id >= 1 && timer_id <= std::numeric_limits<std::uint32_t>::max() ? state -> timers.find(static_cast<std::uint32_t>(timer_id)) : state -> timers.end();
+          if (position != state -> timers.end()) {
+            state -> js_run_loop.CancelDelayed(position -> second.delayed_task_id);
+            state -> timers.erase(position);
+          }
+        }
+        return JSValueMakeUndefined(context_ref);
+      }
+
+      if (argument_count == 0 || !JSValueIsObject(context_ref, arguments_array[0]) || !JSObjectIsFunction(context_ref, JSValueToObject(context_ref, arguments_array[0], nullptr))) {
+        detail::ThrowRuntimeError("JSTimers", "The timer callback must be a function.");
+      }
+
+      State::Timer timer {
+        JSObject(js_context, JSValueToObject(context_ref, arguments_array[0], nullptr)),
+        std::vector<JSValue>(),
+        argument_count > 1 ? ToDelay(JSValue(js_context, arguments_array[1])) : std::chrono::milliseconds(0),
+        binding -> function == Binding::Function::SetInterval,
+        0
+      };
+      for (size_t i = 2; i < argument_count; ++i) {
+        timer.arguments.push_back(JSValue(js_context, arguments_array[i]));
+      }
+
+      const auto timer_id = state -> next_timer_id++;
+      timer.delayed_task_id = state -> PostFire(timer_id, timer.interval);
+      state -> timers.emplace(timer_id, std::move(timer));
+      return JSValueMakeNumber(context_ref, timer_id);
+    } catch (const std::exception& e) {
+      message = e.what();
+    }
+
+    const auto message_ref = detail::CreateJSStringWithUTF8CString(message.c_str());
+    const JSValueRef error_arguments[] = { JSValueMakeString(context_ref, message_ref) };
+    JSStringRelease(message_ref);
+    *exception = JSObjectMakeError(context_ref, 1, error_arguments, nullptr);
+    return nullptr;
+  }
+
+  void JSTimers::FinalizeFunction(JSObjectRef function_ref) {
+    delete static_cast<Binding*>(JSObjectGetPrivate(function_ref));
+  }
+
+  JSClassRef JSTimers::GetFunctionClass() {
+    static const JSClassRef js_class_ref = [] {
+      auto js_class_definition           = kJSClassDefinitionEmpty;
+      js_class_definition.className      = "JSTimers";
+      js_class_definition.callAsFunction = CallFunction;
+      js_class_definition.finalize       = FinalizeFunction;
+      return detail::CreateJSClass(&js_class_definition);
+    }();
+    return js_class_ref;
+  }
+
+} // namespace HAL {
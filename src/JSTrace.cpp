@@ -0,0 +1,182 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSTrace.hpp"
+
+#include "HAL/detail/JSTraceScope.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace HAL {
+
+  std::atomic<bool> JSTrace::enabled__ { false };
+
+#ifdef HAL_TRACE_ENABLE
+  namespace {
+
+    // Only its own thread appends to a buffer, and it discards the
+    // events of an earlier Start itself, so appending takes no lock.
+    // Readers see the events before the published size.
+    struct TraceBuffer final {
+      explicit TraceBuffer(std::uint32_t thread_id)
+      : thread_id(thread_id)
+      , generation(0)
+      , size(0)
+      , dropped(0)
+      , events(new detail::JSTraceEvent[JSTrace::kBufferCapacity]) {
+      }
+
+      const std::uint32_t                     thread_id;
+      std::atomic<std::uint32_t>              generation;
+      std::atomic<std::size_t>                size;
+      std::atomic<std::size_t>                dropped;
+      std::unique_ptr<detail::JSTraceEvent[]> events;
+    };
+
+    // Buffers outlive their threads, so that the events of a thread
+    // that has exited are still written.
+    struct TraceRegistry final {
+      std::mutex                                mutex;
+      std::vector<std::unique_ptr<TraceBuffer>> buffers;
+      std::atomic<std::uint32_t>                generation { 1 };
+      std::atomic<std::uint64_t>                start_nanoseconds { 0 };
+    };
+
+    TraceRegistry& GetTraceRegistry() {
+      static TraceRegistry registry;
+      return registry;
+    }
+
+    HAL_THREAD_LOCAL TraceBuffer* trace_buffer = nullptr;
+
+    // Call f with each buffer holding events of the current Start.
+    template<typename F>
+    void ForEachTraceBuffer(F&& f) {
+      auto& registry = GetTraceRegistry();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      const auto generation = registry.generation.load(std::memory_order_relaxed);
+      for (const auto& buffer : registry.buffers) {
+        if (buffer -> generation.load(std::memory_order_acquire) == generation) {
+          f(*buffer);
+        }
+      }
+    }
+
+  } // namespace {
+
+  namespace detail {
+
+    void AppendTraceEvent(const JSTraceEvent& event) HAL_NOEXCEPT {
+      auto& registry = GetTraceRegistry();
+      if (!trace_buffer) {
+        try {
+          std::lock_guard<std::mutex> lock(registry.mutex);
+          registry.buffers.emplace_back(new TraceBuffer(static_cast<std::uint32_t>(registry.buffers.size() + 1)));
+          trace_buffer = registry.buffers.back().get();
+        } catch (...) {
+          return;
+        }
+      }
+
+      auto& buffer = *trace_buffer;
+      const auto generation = registry.generation.load(std::memory_order_relaxed);
+      if (buffer.generation.load(std::memory_order_relaxed) != generation) {
+        buffer.size.store(0, std::memory_order_relaxed);
+        buffer.dropped.store(0, std::memory_order_relaxed);
+        buffer.generation.store(generation, std::memory_order_release);
+      }
+
+      const auto size = buffer.size.load(std::memory_order_relaxed);
+      if (size == JSTrace::kBufferCapacity) {
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      buffer.events[size] = event;
+      buffer.size.store(size + 1, std::memory_order_release);
+    }
+
+  } // namespace detail {
+#endif
+
+  void JSTrace::Start() HAL_NOEXCEPT {
+#ifdef HAL_TRACE_ENABLE
+    auto& registry = GetTraceRegistry();
+    registry.start_nanoseconds.store(detail::GetTraceNanoseconds(), std::memory_order_relaxed);
+    registry.generation.fetch_add(1, std::memory_order_relaxed);
+#endif
+    enabled__.store(true, std::memory_order_relaxed);
+  }
+
+  void JSTrace::Stop() HAL_NOEXCEPT {
+    enabled__.store(false, std::memory_order_relaxed);
+  }
+
+  std::size_t JSTrace::get_event_count() HAL_NOEXCEPT {
+    std::size_t count = 0;
+#ifdef HAL_TRACE_ENABLE
+    ForEachTraceBuffer([&count](const TraceBuffer& buffer) {
+      count += buffer.size.load(std::memory_order_acquire);
+    });
+#endif
+    return count;
+  }
+
+  std::size_t JSTrace::get_dropped_event_count() HAL_NOEXCEPT {
+    std::size_t count = 0;
+#ifdef HAL_TRACE_ENABLE
+    ForEachTraceBuffer([&count](const TraceBuffer& buffer) {
+      count += buffer.dropped.load(std::memory_order_relaxed);
+    });
+#endif
+    return count;
+  }
+
+  std::string JSTrace::ToJSON() {
+    std::ostringstream os;
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+#ifdef HAL_TRACE_ENABLE
+    // Chrome reads timestamps in microseconds, counted here from Start.
+    const auto start_nanoseconds = GetTraceRegistry().start_nanoseconds.load(std::memory_order_relaxed);
+    bool first = true;
+    ForEachTraceBuffer([&](const TraceBuffer& buffer) {
+      const auto size = buffer.size.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < size; ++i) {
+        const auto& event = buffer.events[i];
+        const auto  begin = event.begin_nanoseconds > start_nanoseconds ? event.begin_nanoseconds - start_nanoseconds : 0;
+        os << (first ? "" : ",") << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\""
+           << ",\"ts\":" << begin / 1000 << "." << begin % 1000 / 100 << begin % 100 / 10 << begin % 10
+           << ",\"dur\":" << event.duration_nanoseconds / 1000 << "." << event.duration_nanoseconds % 1000 / 100 << event.duration_nanoseconds % 100 / 10 << event.duration_nanoseconds % 10
+           << ",\"pid\":1,\"tid\":" << buffer.thread_id;
+        if (event.argument) {
+          os << ",\"args\":{\"name\":\"" << detail::EscapeJSONString(event.argument) << "\"}";
+        }
+        os << "}";
+        first = false;
+      }
+    });
+#endif
+    os << "]}";
+    return os.str();
+  }
+
+  void JSTrace::WriteJSON(const std::string& path) {
+    std::ofstream ofstream(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    ofstream << ToJSON();
+    ofstream.close();
+    if (!ofstream) {
+      detail::ThrowRuntimeError("JSTrace", "Unable to write the trace to " + path);
+    }
+  }
+
+} // namespace HAL {
@@ -0,0 +1,100 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSTypedArray.hpp"
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+
+#include "HAL/JSValue.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <memory>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    void ThrowIfException(const JSContext& js_context, JSValueRef exception) {
+      if (exception) {
+        ThrowRuntimeError("JSTypedArray", JSValue(js_context, exception));
+      }
+    }
+
+  } // namespace
+
+  JSObjectRef MakeTypedArray(const JSContext& js_context, JSTypedArrayType type, std::size_t length) {
+    JSValueRef exception { nullptr };
+    const auto js_object_ref = JSObjectMakeTypedArray(static_cast<JSContextRef>(js_context), type, length, &exception);
+    ThrowIfException(js_context, exception);
+    return js_object_ref;
+  }
+
+  JSObjectRef MakeTypedArrayWithBytesNoCopy(const JSContext& js_context, JSTypedArrayType type, void* bytes, std::size_t byte_length, JSBytesDeallocator deallocator) {
+    std::unique_ptr<JSBytesDeallocator> deallocator_ptr(new JSBytesDeallocator(std::move(deallocator)));
+    JSValueRef exception { nullptr };
+    const auto js_object_ref = JSObjectMakeTypedArrayWithBytesNoCopy(static_cast<JSContextRef>(js_context), type, bytes, byte_length, DeallocateBytes, deallocator_ptr.get(), &exception);
+
+    // The caller keeps ownership of the bytes unless the typed array
+    // was created.
+    ThrowIfException(js_context, exception);
+    if (!js_object_ref) {
+      ThrowRuntimeError("JSTypedArray", "Unable to create a typed array.");
+    }
+
+    deallocator_ptr.release();
+    return js_object_ref;
+  }
+
+  void CheckTypedArrayType(const JSContext& js_context, JSObjectRef js_object_ref, JSTypedArrayType type) {
+    JSValueRef exception { nullptr };
+    if (JSValueGetTypedArrayType(static_cast<JSContextRef>(js_context), js_object_ref, &exception) != type) {
+      ThrowRuntimeError("JSTypedArray", "This JavaScript object is not a typed array of the expected type.");
+    }
+  }
+
+  void* GetTypedArrayBytesPtr(const JSContext& js_context, JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    const auto bytes = JSObjectGetTypedArrayBytesPtr(static_cast<JSContextRef>(js_context), js_object_ref, &exception);
+    ThrowIfException(js_context, exception);
+
+    // JavaScriptCore returns the start of the ArrayBuffer, not of this
+    // view of it.
+    return static_cast<char*>(bytes) + GetTypedArrayByteOffset(js_context, js_object_ref);
+  }
+
+  std::size_t GetTypedArrayLength(const JSContext& js_context, JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    const auto length = JSObjectGetTypedArrayLength(static_cast<JSContextRef>(js_context), js_object_ref, &exception);
+    ThrowIfException(js_context, exception);
+    return length;
+  }
+
+  std::size_t GetTypedArrayByteLength(const JSContext& js_context, JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    const auto byte_length = JSObjectGetTypedArrayByteLength(static_cast<JSContextRef>(js_context), js_object_ref, &exception);
+    ThrowIfException(js_context, exception);
+    return byte_length;
+  }
+
+  std::size_t GetTypedArrayByteOffset(const JSContext& js_context, JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    const auto byte_offset = JSObjectGetTypedArrayByteOffset(static_cast<JSContextRef>(js_context), js_object_ref, &exception);
+    ThrowIfException(js_context, exception);
+    return byte_offset;
+  }
+
+  JSObjectRef GetTypedArrayBuffer(const JSContext& js_context, JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    const auto buffer_ref = JSObjectGetTypedArrayBuffer(static_cast<JSContextRef>(js_context), js_object_ref, &exception);
+    ThrowIfException(js_context, exception);
+    return buffer_ref;
+  }
+
+}} // namespace HAL { namespace detail {
+
+#endif // HAL_TYPED_ARRAY_ENABLE
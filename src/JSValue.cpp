@@ -24,40 +24,126 @@
 #include "HAL/JSRegExp.hpp"
 
 #include "HAL/JSClass.hpp"
+#include "HAL/JSHandleScope.hpp"
 
+#include "HAL/detail/JSAllocationSample.hpp"
+#include "HAL/detail/JSAPIStatistics.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
 #include "HAL/detail/JSUtil.hpp"
+#include "HAL/detail/JSValueRetainRegistry.hpp"
 
 #include <sstream>
+#include <memory>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-namespace HAL {
+namespace {
+  // JSValueRefs whose retain count dropped to zero while deferred
+  // unprotect was enabled. Each keeps its JSContext, and therefore its
+  // retain registry, alive until the next flush.
+  std::vector<std::pair<HAL::JSContext, JSValueRef>> js_value_pending_unprotect__;
+  std::atomic<bool> js_value_defer_unprotect__ { false };
+  std::size_t       js_value_pending_unprotect_capacity__ { 1024 };
   
-  std::unordered_map<std::intptr_t, std::size_t> JSValue::js_value_retain_count_map__;
+#ifdef HAL_THREAD_SAFE_STATICS
+  HAL::detail::JSMutex js_value_pending_unprotect_mutex__ HAL_LOCK_NAME("JSValue pending unprotect");
+#endif
+}
+
+#undef  HAL_JSVALUE_PENDING_UNPROTECT_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE_STATICS
+#define HAL_JSVALUE_PENDING_UNPROTECT_LOCK_GUARD std::lock_guard<detail::JSMutex> lock_pending(js_value_pending_unprotect_mutex__)
+#else
+#define HAL_JSVALUE_PENDING_UNPROTECT_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+
+namespace HAL {
   
   void JSValue::Protect()
   {
-    const auto ptr = reinterpret_cast<std::intptr_t>(js_value_ref__);
-    const auto iter = js_value_retain_count_map__.find(ptr);
-    if (iter == js_value_retain_count_map__.end()) {
-      JSValueProtect(static_cast<JSContextRef>(js_context__), js_value_ref__);
-      js_value_retain_count_map__.emplace(ptr, 1);
-    } else {
-      js_value_retain_count_map__[ptr] = ++iter->second;
+    if (is_immortal__) {
+      return;
     }
+    
+    auto& js_value_retain_registry = js_context__.get_js_value_retain_registry();
+    
+    if (handle_scope_id__ != 0) {
+      if (JSHandleScope::Retain(handle_scope_id__, handle_scope_slot__)) {
+        return;
+      }
+      // The scope we were tracked by has been destroyed, which promoted
+      // our JSValueRef to the retain registry.
+      handle_scope_id__ = 0;
+    } else if (JSHandleScope::Track(&js_value_retain_registry, static_cast<JSContextRef>(js_context__), js_value_ref__, handle_scope_id__, handle_scope_slot__)) {
+      return;
+    }
+    
+    js_value_retain_registry.Retain(static_cast<JSContextRef>(js_context__), js_value_ref__);
   }
 
   void JSValue::Unprotect()
   {
-    const auto ptr = reinterpret_cast<std::intptr_t>(js_value_ref__);
-    const auto iter = js_value_retain_count_map__.find(ptr);
-    assert(iter != js_value_retain_count_map__.end());
-    const auto count = --iter->second;
-    if (count == 0) {
-      JSValueUnprotect(static_cast<JSContextRef>(js_context__), js_value_ref__);
-      js_value_retain_count_map__.erase(ptr);
-    } else {
-      js_value_retain_count_map__[ptr] = count;
+    if (is_immortal__) {
+      return;
     }
+    
+    if (handle_scope_id__ != 0) {
+      if (JSHandleScope::Release(handle_scope_id__, handle_scope_slot__)) {
+        return;
+      }
+      handle_scope_id__ = 0;
+    }
+    
+    // With deferred unprotect a zero count is left in the registry. If
+    // the same JSValueRef is protected again before the next flush the
+    // two operations cancel and JavaScriptCore never sees either.
+    const bool defer = js_value_defer_unprotect__.load(std::memory_order_relaxed);
+    const auto count = js_context__.get_js_value_retain_registry().Release(static_cast<JSContextRef>(js_context__), js_value_ref__, defer);
+    if (count == 0 && defer) {
+      bool flush = false;
+      {
+        HAL_JSVALUE_PENDING_UNPROTECT_LOCK_GUARD;
+        js_value_pending_unprotect__.emplace_back(js_context__, js_value_ref__);
+        flush = js_value_pending_unprotect__.size() >= js_value_pending_unprotect_capacity__;
+      }
+      if (flush) {
+        FlushDeferredUnprotect();
+      }
+    }
+  }
+  
+  void JSValue::FlushDeferredUnprotect()
+  {
+    // Swap first so that destroying the pending JSContexts can't
+    // re-enter this function with a half processed list.
+    std::vector<std::pair<JSContext, JSValueRef>> pending;
+    {
+      HAL_JSVALUE_PENDING_UNPROTECT_LOCK_GUARD;
+      pending.swap(js_value_pending_unprotect__);
+    }
+    
+    for (const auto& entry : pending) {
+      entry.first.get_js_value_retain_registry().Flush(static_cast<JSContextRef>(entry.first), entry.second);
+    }
+    
+    HAL_LOG_DEBUG("JSValue::FlushDeferredUnprotect: processed ", pending.size(), " pending JSValueRefs");
+  }
+  
+  void JSValue::SetDeferUnprotect(bool defer_unprotect)
+  {
+    js_value_defer_unprotect__.store(defer_unprotect, std::memory_order_relaxed);
+    if (!defer_unprotect) {
+      FlushDeferredUnprotect();
+    }
+  }
+  
+  bool JSValue::GetDeferUnprotect()
+  {
+    return js_value_defer_unprotect__.load(std::memory_order_relaxed);
   }
 
   JSString JSValue::ToJSONString(unsigned indent) {
@@ -80,10 +166,51 @@ namespace HAL {
     return JSString();
   }
   
-  JSValue::operator JSString() const {
+  bool JSValue::WriteJSON(const std::function<void(const char* data, std::size_t length)>& output, unsigned indent) {
     HAL_JSVALUE_LOCK_GUARD;
     JSValueRef exception { nullptr };
-    JSStringRef js_string_ref = JSValueToStringCopy(static_cast<JSContextRef>(js_context__), js_value_ref__, &exception);
+    JSStringRef js_string_ref = JSValueCreateJSONString(static_cast<JSContextRef>(js_context__), js_value_ref__, indent, &exception);
+    if (exception) {
+      assert(!js_string_ref);
+      detail::ThrowRuntimeError("JSValue", JSValue(js_context__, exception));
+    }
+    
+    if (!js_string_ref) {
+      return false;
+    }
+    
+    // The string is released even if output throws.
+    const std::unique_ptr<std::remove_pointer<JSStringRef>::type, void(*)(JSStringRef)> js_string(js_string_ref, JSStringRelease);
+    const auto characters = JSStringGetCharactersPtr(js_string_ref);
+    const auto length     = JSStringGetLength(js_string_ref);
+    
+    const std::size_t kChunkSize = 4096;
+    char buffer[3 * kChunkSize];
+    for (std::size_t offset = 0; offset < length;) {
+      auto count = std::min(kChunkSize, length - offset);
+      
+      // Never split a surrogate pair across two chunks.
+      const auto last = characters[offset + count - 1];
+      if (offset + count < length && last >= 0xD800 && last <= 0xDBFF) {
+        --count;
+      }
+      
+      output(buffer, detail::TranscodeUTF16ToUTF8(characters + offset, count, buffer));
+      offset += count;
+    }
+    
+    return true;
+  }
+  
+  bool JSValue::WriteJSON(std::ostream& ostream, unsigned indent) {
+    return WriteJSON([&ostream](const char* data, std::size_t length) {
+      ostream.write(data, static_cast<std::streamsize>(length));
+    }, indent);
+  }
+  
+  JSStringRef JSValue::ToJSStringRefCopy() const {
+    JSValueRef exception { nullptr };
+    JSStringRef js_string_ref = HAL_API_CALL(js_context__, ValueConversion, JSValueToStringCopy(static_cast<JSContextRef>(js_context__), js_value_ref__, &exception));
     if (exception) {
       // If this assert fails then we need to JSStringRelease
       // js_string_ref.
@@ -92,6 +219,12 @@ namespace HAL {
     }
     
     assert(js_string_ref);
+    return js_string_ref;
+  }
+  
+  JSValue::operator JSString() const {
+    HAL_JSVALUE_LOCK_GUARD;
+    JSStringRef js_string_ref = ToJSStringRefCopy();
     JSString js_string(js_string_ref);
     JSStringRelease(js_string_ref);
     
@@ -99,18 +232,37 @@ namespace HAL {
   }
   
   JSValue::operator std::string() const {
-    return operator JSString();
+    // Transcode straight from the JSStringRef rather than through a
+    // JSString, which would cache a UTF-8 copy only to copy it again.
+    HAL_JSVALUE_LOCK_GUARD;
+    JSStringRef js_string_ref = ToJSStringRefCopy();
+    auto string = detail::ToUTF8String(js_string_ref);
+    JSStringRelease(js_string_ref);
+    
+    return string;
+  }
+  
+  void JSValue::AppendTo(std::string& buffer) const {
+    HAL_JSVALUE_LOCK_GUARD;
+    JSStringRef js_string_ref = ToJSStringRefCopy();
+    detail::AppendUTF8String(js_string_ref, buffer);
+    JSStringRelease(js_string_ref);
   }
   
   JSValue::operator bool() const HAL_NOEXCEPT {
     HAL_JSVALUE_LOCK_GUARD;
-    return JSValueToBoolean(static_cast<JSContextRef>(js_context__), js_value_ref__);
+    return HAL_API_CALL(js_context__, ValueConversion, JSValueToBoolean(static_cast<JSContextRef>(js_context__), js_value_ref__));
   }
   
   JSValue::operator double() const {
     HAL_JSVALUE_LOCK_GUARD;
+    if (js_type__ == kJSTypeNumber) {
+      // A number converts to itself, so there is no valueOf to throw.
+      return HAL_API_CALL(js_context__, ValueConversion, JSValueToNumber(static_cast<JSContextRef>(js_context__), js_value_ref__, nullptr));
+    }
+    
     JSValueRef exception { nullptr };
-    const double result = JSValueToNumber(static_cast<JSContextRef>(js_context__), js_value_ref__, &exception);
+    const double result = HAL_API_CALL(js_context__, ValueConversion, JSValueToNumber(static_cast<JSContextRef>(js_context__), js_value_ref__, &exception));
     
     if (exception) {
       detail::ThrowRuntimeError("JSValue", JSValue(js_context__, exception));
@@ -119,14 +271,30 @@ namespace HAL {
     return result;
   }
   
+  JSResult<double> JSValue::TryToNumber() const {
+    HAL_JSVALUE_LOCK_GUARD;
+    JSValueRef exception { nullptr };
+    const double result = HAL_API_CALL(js_context__, ValueConversion, JSValueToNumber(static_cast<JSContextRef>(js_context__), js_value_ref__, &exception));
+    
+    if (exception) {
+      return JSResult<double>::Exception(JSValue(js_context__, exception));
+    }
+    
+    return result;
+  }
+  
   JSValue::operator int32_t() const {
     return detail::to_int32_t(operator double());
   }
   
+  JSValue::operator int64_t() const {
+    return detail::to_int64_t(operator double());
+  }
+  
   JSValue::operator JSObject() const {
     HAL_JSVALUE_LOCK_GUARD;
     JSValueRef exception { nullptr };
-    JSObjectRef js_object_ref = JSValueToObject(static_cast<JSContextRef>(js_context__), js_value_ref__, &exception);
+    JSObjectRef js_object_ref = HAL_API_CALL(js_context__, ValueConversion, JSValueToObject(static_cast<JSContextRef>(js_context__), js_value_ref__, &exception));
     
     if (exception) {
       // If this assert fails then we need to JSValueUnprotect
@@ -139,11 +307,17 @@ namespace HAL {
     return JSObject(js_context__, js_object_ref);
   }
   
-  JSValue::Type JSValue::GetType() const HAL_NOEXCEPT {
+  std::uint8_t JSValue::GetJSType() const HAL_NOEXCEPT {
     HAL_JSVALUE_LOCK_GUARD;
+    if (js_type__ == kUnknownType) {
+      js_type__ = static_cast<std::uint8_t>(HAL_API_CALL(js_context__, ValueTypeCheck, JSValueGetType(static_cast<JSContextRef>(js_context__), js_value_ref__)));
+    }
+    return js_type__;
+  }
+  
+  JSValue::Type JSValue::GetType() const HAL_NOEXCEPT {
     auto type = Type::Undefined;
-    const JSType js_type = JSValueGetType(static_cast<JSContextRef>(js_context__), js_value_ref__);
-    switch (js_type) {
+    switch (static_cast<JSType>(GetJSType())) {
       case kJSTypeUndefined:
         type = Type::Undefined;
         break;
@@ -167,19 +341,20 @@ namespace HAL {
       case kJSTypeObject:
         type = Type::Object;
         break;
+        
+      default:
+        break;
     }
 
     return type;
   }
   
   bool JSValue::IsUndefined() const HAL_NOEXCEPT {
-    HAL_JSVALUE_LOCK_GUARD;
-    return JSValueIsUndefined(static_cast<JSContextRef>(js_context__), js_value_ref__);
+    return GetJSType() == kJSTypeUndefined;
   }
   
   bool JSValue::IsNull() const HAL_NOEXCEPT {
-    HAL_JSVALUE_LOCK_GUARD;
-    return JSValueIsNull(static_cast<JSContextRef>(js_context__), js_value_ref__);
+    return GetJSType() == kJSTypeNull;
   }
 	
   bool JSValue::IsNativeNull() const HAL_NOEXCEPT {
@@ -188,34 +363,30 @@ namespace HAL {
   }
 	
   bool JSValue::IsBoolean() const HAL_NOEXCEPT {
-    HAL_JSVALUE_LOCK_GUARD;
-    return JSValueIsBoolean(static_cast<JSContextRef>(js_context__), js_value_ref__);
+    return GetJSType() == kJSTypeBoolean;
   }
 
   bool JSValue::IsNumber() const HAL_NOEXCEPT {
-    HAL_JSVALUE_LOCK_GUARD;
-    return JSValueIsNumber(static_cast<JSContextRef>(js_context__), js_value_ref__);
+    return GetJSType() == kJSTypeNumber;
   }
   
   bool JSValue::IsString() const HAL_NOEXCEPT {
-    HAL_JSVALUE_LOCK_GUARD;
-    return JSValueIsString(static_cast<JSContextRef>(js_context__), js_value_ref__);
+    return GetJSType() == kJSTypeString;
   }
   
   bool JSValue::IsObject() const HAL_NOEXCEPT {
-    HAL_JSVALUE_LOCK_GUARD;
-    return JSValueIsObject(static_cast<JSContextRef>(js_context__), js_value_ref__);
+    return GetJSType() == kJSTypeObject;
   }
   
   bool JSValue::IsObjectOfClass(const JSClass& js_class) const HAL_NOEXCEPT {
     HAL_JSVALUE_LOCK_GUARD;
-    return JSValueIsObjectOfClass(static_cast<JSContextRef>(js_context__), js_value_ref__, static_cast<JSClassRef>(js_class));
+    return HAL_API_CALL(js_context__, ValueTypeCheck, JSValueIsObjectOfClass(static_cast<JSContextRef>(js_context__), js_value_ref__, static_cast<JSClassRef>(js_class)));
   }
   
   bool JSValue::IsInstanceOfConstructor(const JSObject& constructor) const {
     HAL_JSVALUE_LOCK_GUARD;
     JSValueRef exception { nullptr };
-    const bool result = JSValueIsInstanceOfConstructor(static_cast<JSContextRef>(js_context__), js_value_ref__, static_cast<JSObjectRef>(constructor), &exception);
+    const bool result = HAL_API_CALL(js_context__, ValueTypeCheck, JSValueIsInstanceOfConstructor(static_cast<JSContextRef>(js_context__), js_value_ref__, static_cast<JSObjectRef>(constructor), &exception));
     if (exception) {
       detail::ThrowRuntimeError("JSValue", JSValue(js_context__, exception));
     }
@@ -226,7 +397,7 @@ namespace HAL {
   bool JSValue::IsEqualWithTypeCoercion(const JSValue& rhs) const {
     HAL_JSVALUE_LOCK_GUARD;
     JSValueRef exception { nullptr };
-    const bool result = JSValueIsEqual(static_cast<JSContextRef>(js_context__), js_value_ref__, rhs.js_value_ref__, &exception);
+    const bool result = HAL_API_CALL(js_context__, ValueTypeCheck, JSValueIsEqual(static_cast<JSContextRef>(js_context__), js_value_ref__, rhs.js_value_ref__, &exception));
     if (exception) {
       detail::ThrowRuntimeError("JSValue", JSValue(js_context__, exception));
     }
@@ -241,13 +412,18 @@ namespace HAL {
   JSValue::~JSValue() HAL_NOEXCEPT {
     HAL_LOG_TRACE("JSValue:: dtor ", this);
     HAL_LOG_TRACE("JSValue:: release ", js_value_ref__, " for ", this);
-    Unprotect();
+    // A moved-from JSValue doesn't own a reference.
+    if (js_value_ref__) {
+      Unprotect();
+    }
   }
   
   JSValue::JSValue(const JSValue& rhs) HAL_NOEXCEPT
   : js_context__(rhs.js_context__)
-  , js_value_ref__(rhs.js_value_ref__)
-  , is_native_nullptr__(rhs.is_native_nullptr__) {
+  , is_native_nullptr__(rhs.is_native_nullptr__)
+  , js_type__(rhs.js_type__)
+  , is_immortal__(rhs.is_immortal__)
+  , js_value_ref__(rhs.js_value_ref__) {
     HAL_LOG_TRACE("JSValue:: copy ctor ", this);
     HAL_LOG_TRACE("JSValue:: retain ", js_value_ref__, " for ", this);
     Protect();
@@ -255,19 +431,25 @@ namespace HAL {
   
   JSValue::JSValue(JSValue&& rhs) HAL_NOEXCEPT
   : js_context__(std::move(rhs.js_context__))
+  , is_native_nullptr__(rhs.is_native_nullptr__)
+  , js_type__(rhs.js_type__)
+  , is_immortal__(rhs.is_immortal__)
+  , handle_scope_slot__(rhs.handle_scope_slot__)
   , js_value_ref__(rhs.js_value_ref__)
-  , is_native_nullptr__(rhs.is_native_nullptr__){
+  , handle_scope_id__(rhs.handle_scope_id__) {
     HAL_LOG_TRACE("JSValue:: move ctor ", this);
-    HAL_LOG_TRACE("JSValue:: retain ", js_value_ref__, " for ", this);
-    Protect();
+    // Take ownership of rhs's reference, leaving rhs empty so that its
+    // destructor does nothing.
+    rhs.js_value_ref__    = nullptr;
+    rhs.handle_scope_id__ = 0;
   }
   
   JSValue& JSValue::operator=(JSValue rhs) {
     HAL_JSVALUE_LOCK_GUARD;
     HAL_LOG_TRACE("JSValue:: copy assignment ", this);
     // JSValues can only be copied between contexts within the same
-    // context group.
-    if (js_context__.get_context_group() != rhs.js_context__.get_context_group()) {
+    // context group. A moved-from JSValue may be assigned anything.
+    if (js_value_ref__ && rhs.js_value_ref__ && js_context__ != rhs.js_context__ && js_context__.get_context_group() != rhs.js_context__.get_context_group()) {
       detail::ThrowRuntimeError("JSValue", "JSValues must belong to JSContexts within the same JSContextGroup to be shared and exchanged.");
     }
     
@@ -285,11 +467,16 @@ namespace HAL {
     swap(js_context__  , other.js_context__);
     swap(js_value_ref__, other.js_value_ref__);
     swap(is_native_nullptr__, other.is_native_nullptr__);
+    swap(js_type__, other.js_type__);
+    swap(is_immortal__, other.is_immortal__);
+    swap(handle_scope_id__, other.handle_scope_id__);
+    swap(handle_scope_slot__, other.handle_scope_slot__);
   }
   
   JSValue::JSValue(const JSContext& js_context, const JSString& js_string, bool parse_as_json)
   : js_context__(js_context) {
     HAL_LOG_TRACE("JSValue:: ctor 1 ", this);
+    HAL_ALLOCATION_SAMPLE("JSValue");
     if (parse_as_json) {
       js_value_ref__ = JSValueMakeFromJSONString(static_cast<JSContextRef>(js_context), static_cast<JSStringRef>(js_string));
       if (!js_value_ref__) {
@@ -298,6 +485,7 @@ namespace HAL {
       }
     } else {
       js_value_ref__ = JSValueMakeString(static_cast<JSContextRef>(js_context__), static_cast<JSStringRef>(js_string));
+      js_type__      = kJSTypeString;
     }
     HAL_LOG_TRACE("JSValue:: retain ", js_value_ref__, " for ", this);
     Protect();
@@ -308,11 +496,23 @@ namespace HAL {
   : js_context__(js_context)
   , js_value_ref__(js_value_ref)  {
     HAL_LOG_TRACE("JSValue:: ctor 2 ", this);
+    HAL_ALLOCATION_SAMPLE("JSValue");
     assert(js_value_ref__);
     HAL_LOG_TRACE("JSValue:: retain ", js_value_ref__, " for ", this);
     Protect();
   }
   
+  JSValue::JSValue(const JSContext& js_context, JSValueRef js_value_ref, std::uint8_t js_type, bool is_immortal) HAL_NOEXCEPT
+  : js_context__(js_context)
+  , js_type__(js_type)
+  , is_immortal__(is_immortal)
+  , js_value_ref__(js_value_ref) {
+    HAL_LOG_TRACE("JSValue:: ctor 3 ", this);
+    HAL_ALLOCATION_SAMPLE("JSValue");
+    assert(js_value_ref__);
+    Protect();
+  }
+  
   std::string to_string(const JSValue::Type& js_value_type) HAL_NOEXCEPT {
     std::string string = "Unknown";
     switch (js_value_type) {
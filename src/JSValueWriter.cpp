@@ -0,0 +1,366 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSValueWriter.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSContext.hpp"
+#include "HAL/JSObject.hpp"
+#include "HAL/JSArray.hpp"
+#include "HAL/JSNull.hpp"
+#include "HAL/JSBoolean.hpp"
+#include "HAL/JSNumber.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace HAL {
+
+  const std::size_t JSValueWriter::kDirectConstructionLimit;
+
+  JSValueWriter::JSValueWriter() HAL_NOEXCEPT {
+  }
+
+  JSValueWriter::JSValueWriter(std::size_t capacity)
+  : json__(capacity) {
+  }
+
+  JSValueWriter& JSValueWriter::BeginObject() {
+    Write(Kind::BeginObject);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::EndObject() {
+    Write(Kind::EndObject);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::BeginArray() {
+    Write(Kind::BeginArray);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::EndArray() {
+    Write(Kind::EndArray);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Key(const char* key) {
+    Write(Kind::Key, key, std::strlen(key));
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Key(const std::string& key) {
+    Write(Kind::Key, key.data(), key.size());
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Key(const JSString& key) {
+    Write(Kind::Key, key);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Value(const char* value) {
+    Write(Kind::String, value, std::strlen(value));
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Value(const std::string& value) {
+    Write(Kind::String, value.data(), value.size());
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Value(const JSString& value) {
+    Write(Kind::String, value);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Value(double value) {
+    Write(Kind::Number, value);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Value(std::int32_t value) {
+    Write(Kind::Number, value);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Value(std::uint32_t value) {
+    Write(Kind::Number, value);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Value(bool value) {
+    Write(Kind::Boolean, value ? 1 : 0);
+    return *this;
+  }
+
+  JSValueWriter& JSValueWriter::Null() {
+    Write(Kind::Null);
+    return *this;
+  }
+
+  JSValue JSValueWriter::ToJSValue(const JSContext& js_context) const {
+    if (!root_written__ || !containers__.empty()) {
+      detail::ThrowRuntimeError("JSValueWriter", "The value isn't complete.");
+    }
+
+    if (is_json__) {
+      return json__.ToJSONValue(js_context);
+    }
+
+    struct Frame {
+      std::vector<std::string> keys;
+      std::vector<JSValue>     values;
+    };
+
+    std::vector<Frame>   frames;
+    std::vector<JSValue> root;
+    const auto add = [&frames, &root](const JSValue& js_value) {
+      (frames.empty() ? root : frames.back().values).push_back(js_value);
+    };
+
+    for (const auto& event : events__) {
+      switch (event.kind) {
+        case Kind::BeginObject:
+        case Kind::BeginArray:
+          frames.push_back(Frame());
+          break;
+
+        case Kind::Key:
+          frames.back().keys.push_back(event.string);
+          break;
+
+        case Kind::EndObject: {
+          auto js_object = js_context.CreateObject();
+          const auto& frame = frames.back();
+          for (std::size_t i = 0; i < frame.keys.size(); ++i) {
+            js_object.SetProperty(frame.keys[i], frame.values[i]);
+          }
+          frames.pop_back();
+          add(js_object);
+          break;
+        }
+
+        case Kind::EndArray: {
+          const auto js_array = js_context.CreateArray(frames.back().values);
+          frames.pop_back();
+          add(js_array);
+          break;
+        }
+
+        case Kind::String:
+          add(js_context.CreateString(event.string));
+          break;
+
+        case Kind::Number:
+          if (std::isfinite(event.number)) {
+            add(js_context.CreateNumber(event.number));
+          } else {
+            add(js_context.CreateNull());
+          }
+          break;
+
+        case Kind::Boolean:
+          add(js_context.CreateBoolean(event.number != 0));
+          break;
+
+        case Kind::Null:
+          add(js_context.CreateNull());
+          break;
+      }
+    }
+
+    return root.front();
+  }
+
+  void JSValueWriter::Validate(Kind kind) {
+    switch (kind) {
+      case Kind::Key:
+        if (containers__.empty() || !containers__.back().is_object || containers__.back().expecting_value) {
+          detail::ThrowRuntimeError("JSValueWriter", "A key must be written in an object, once before each value.");
+        }
+        containers__.back().expecting_value = true;
+        return;
+
+      case Kind::EndObject:
+        if (containers__.empty() || !containers__.back().is_object || containers__.back().expecting_value) {
+          detail::ThrowRuntimeError("JSValueWriter", "EndObject must close an object after a value.");
+        }
+        containers__.pop_back();
+        return;
+
+      case Kind::EndArray:
+        if (containers__.empty() || containers__.back().is_object) {
+          detail::ThrowRuntimeError("JSValueWriter", "EndArray must close an array.");
+        }
+        containers__.pop_back();
+        return;
+
+      default:
+        break;
+    }
+
+    if (containers__.empty()) {
+      if (root_written__) {
+        detail::ThrowRuntimeError("JSValueWriter", "Only one value can be written outside of an object or array.");
+      }
+      root_written__ = true;
+    } else if (containers__.back().is_object) {
+      if (!containers__.back().expecting_value) {
+        detail::ThrowRuntimeError("JSValueWriter", "A value in an object must follow a key.");
+      }
+      containers__.back().expecting_value = false;
+    }
+
+    ++value_count__;
+    if (kind == Kind::BeginObject || kind == Kind::BeginArray) {
+      const Container container = { kind == Kind::BeginObject, false };
+      containers__.push_back(container);
+    }
+  }
+
+  void JSValueWriter::Write(Kind kind, double number) {
+    Validate(kind);
+    const Event event = { kind, number, std::string() };
+    if (is_json__) {
+      WriteJSON(event);
+    } else {
+      events__.push_back(event);
+      if (value_count__ > kDirectConstructionLimit) {
+        SwitchToJSON();
+      }
+    }
+  }
+
+  void JSValueWriter::Write(Kind kind, const char* string, std::size_t length) {
+    Validate(kind);
+    if (is_json__) {
+      WriteSeparator(kind);
+      json__.AppendJSONString(string, length);
+      if (kind == Kind::Key) {
+        json__.Append(":", 1);
+      }
+    } else {
+      const Event event = { kind, 0, std::string(string, length) };
+      events__.push_back(event);
+      if (value_count__ > kDirectConstructionLimit) {
+        SwitchToJSON();
+      }
+    }
+  }
+
+  void JSValueWriter::Write(Kind kind, const JSString& string) {
+    Validate(kind);
+    if (is_json__) {
+      // The UTF-16 code units are escaped without a UTF-8 round trip.
+      WriteSeparator(kind);
+      json__.AppendJSONString(string);
+      if (kind == Kind::Key) {
+        json__.Append(":", 1);
+      }
+    } else {
+      const Event event = { kind, 0, static_cast<std::string>(string) };
+      events__.push_back(event);
+      if (value_count__ > kDirectConstructionLimit) {
+        SwitchToJSON();
+      }
+    }
+  }
+
+  void JSValueWriter::WriteSeparator(Kind kind) {
+    if (kind == Kind::EndObject || kind == Kind::EndArray) {
+      json_separators__.pop_back();
+      return;
+    }
+
+    // A value after a key follows its colon, anything else in a
+    // container after its first member follows a comma.
+    if (after_key__) {
+      after_key__ = false;
+    } else if (!json_separators__.empty()) {
+      if (json_separators__.back()) {
+        json__.Append(",", 1);
+      }
+      json_separators__.back() = true;
+    }
+
+    if (kind == Kind::BeginObject || kind == Kind::BeginArray) {
+      json_separators__.push_back(false);
+    } else if (kind == Kind::Key) {
+      after_key__ = true;
+    }
+  }
+
+  void JSValueWriter::WriteJSON(const Event& event) {
+    WriteSeparator(event.kind);
+    switch (event.kind) {
+      case Kind::BeginObject:
+        json__.Append("{", 1);
+        break;
+
+      case Kind::EndObject:
+        json__.Append("}", 1);
+        break;
+
+      case Kind::BeginArray:
+        json__.Append("[", 1);
+        break;
+
+      case Kind::EndArray:
+        json__.Append("]", 1);
+        break;
+
+      case Kind::Key:
+        json__.AppendJSONString(event.string).Append(":", 1);
+        break;
+
+      case Kind::String:
+        json__.AppendJSONString(event.string);
+        break;
+
+      case Kind::Number:
+        json__.AppendJSONNumber(event.number);
+        break;
+
+      case Kind::Boolean:
+        json__.Append(event.number != 0 ? "true" : "false");
+        break;
+
+      case Kind::Null:
+        json__.Append("null", 4);
+        break;
+    }
+  }
+
+  JSString JSValueWriter::ToJSONString() const {
+    if (!root_written__ || !containers__.empty()) {
+      detail::ThrowRuntimeError("JSValueWriter", "The value isn't complete.");
+    }
+
+    if (is_json__) {
+      return json__.ToJSString();
+    }
+
+    // A tree kept for direct construction is small, so converting a
+    // copy costs little.
+    JSValueWriter json_writer(*this);
+    json_writer.SwitchToJSON();
+    return json_writer.json__.ToJSString();
+  }
+
+  void JSValueWriter::SwitchToJSON() {
+    is_json__ = true;
+    for (const auto& event : events__) {
+      WriteJSON(event);
+    }
+    std::vector<Event>().swap(events__);
+  }
+
+} // namespace HAL {
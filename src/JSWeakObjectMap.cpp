@@ -0,0 +1,147 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSWeakObjectMap.hpp"
+
+#include "HAL/JSFunction.hpp"
+#include "HAL/JSString.hpp"
+#include "HAL/JSUndefined.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#ifndef HAL_WEAK_OBJECT_MAP_ENABLE
+#include <unordered_map>
+#endif
+
+namespace HAL {
+
+  struct JSWeakObjectMap::State final {
+
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+    State(const JSContext& js_context, JSWeakObjectMapRef js_weak_object_map_ref) HAL_NOEXCEPT
+    : js_context(js_context)
+    , js_weak_object_map_ref(js_weak_object_map_ref) {
+    }
+
+    const JSContext          js_context;
+    const JSWeakObjectMapRef js_weak_object_map_ref;
+#else
+    explicit State(const JSContext& js_context) HAL_NOEXCEPT
+    : js_context(js_context) {
+    }
+
+    // Returns the target of a WeakRef, or undefined.
+    JSValue Deref(JSObject weak_ref) const {
+      auto deref = static_cast<JSObject>(weak_ref.GetProperty("deref"));
+      return deref(weak_ref);
+    }
+
+    const JSContext js_context;
+
+    // The WeakRef of each key's object.
+    std::unordered_map<const void*, JSObject> weak_refs;
+#endif
+  };
+
+  JSWeakObjectMap::JSWeakObjectMap(const JSContext& js_context)
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+  : state__(std::make_shared<State>(js_context, JSWeakObjectMapCreate(static_cast<JSContextRef>(js_context), nullptr, [](JSWeakObjectMapRef, void*) {
+  })))
+#else
+  : state__(std::make_shared<State>(js_context))
+#endif
+  {
+  }
+
+  JSWeakObjectMap::JSWeakObjectMap(const std::shared_ptr<State>& state) HAL_NOEXCEPT
+  : state__(state) {
+  }
+
+  JSWeakObjectMap JSWeakObjectMap::GetSharedMap(const JSContext& js_context) {
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+    return JSWeakObjectMap(std::make_shared<State>(js_context, js_context.get_weak_object_map()));
+#else
+    // WeakRefs are per entry anyway, so there is nothing to share.
+    return JSWeakObjectMap(js_context);
+#endif
+  }
+
+  void JSWeakObjectMap::Set(const void* key, const JSObject& js_object) const {
+    const auto& js_context = state__ -> js_context;
+    if (static_cast<JSContextRef>(js_object.get_context()) != static_cast<JSContextRef>(js_context)) {
+      detail::ThrowInvalidArgument("JSWeakObjectMap", "The object belongs to another JSContext");
+    }
+
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+    JSWeakObjectMapSet(static_cast<JSContextRef>(js_context), state__ -> js_weak_object_map_ref, const_cast<void*>(key), static_cast<JSObjectRef>(js_object));
+#else
+    static const JSString body = "return new WeakRef(target);";
+    auto make_weak_ref = js_context.CreateFunction(body, { JSString("target") });
+    JSValue target = js_object;
+    state__ -> weak_refs.erase(key);
+    state__ -> weak_refs.emplace(key, static_cast<JSObject>(make_weak_ref(target, js_context.get_global_object())));
+#endif
+  }
+
+  JSValue JSWeakObjectMap::Get(const void* key) const {
+    const auto& js_context = state__ -> js_context;
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+    const auto js_object_ref = JSWeakObjectMapGet(static_cast<JSContextRef>(js_context), state__ -> js_weak_object_map_ref, const_cast<void*>(key));
+    if (js_object_ref) {
+      return JSObject(js_context, js_object_ref);
+    }
+    return js_context.CreateUndefined();
+#else
+    const auto position = state__ -> weak_refs.find(key);
+    if (position == state__ -> weak_refs.end()) {
+      return js_context.CreateUndefined();
+    }
+
+    // Drop the WeakRef of a collected object.
+    const auto js_value = state__ -> Deref(position -> second);
+    if (js_value.IsUndefined()) {
+      state__ -> weak_refs.erase(position);
+    }
+    return js_value;
+#endif
+  }
+
+  void JSWeakObjectMap::Remove(const void* key) const {
+#ifdef HAL_WEAK_OBJECT_MAP_ENABLE
+    JSWeakObjectMapRemove(static_cast<JSContextRef>(state__ -> js_context), state__ -> js_weak_object_map_ref, const_cast<void*>(key));
+#else
+    state__ -> weak_refs.erase(key);
+#endif
+  }
+
+  JSContext JSWeakObjectMap::get_context() const HAL_NOEXCEPT {
+    return state__ -> js_context;
+  }
+
+  JSWeakObject::JSWeakObject(const JSObject& js_object)
+  : js_weak_object_map__(JSWeakObjectMap::GetSharedMap(js_object.get_context())) {
+    const auto js_weak_object_map = js_weak_object_map__;
+    key__ = std::shared_ptr<char>(new char(), [js_weak_object_map](char* key) {
+      js_weak_object_map.Remove(key);
+      delete key;
+    });
+    js_weak_object_map__.Set(key__.get(), js_object);
+  }
+
+  JSValue JSWeakObject::Lock() const {
+    return js_weak_object_map__.Get(key__.get());
+  }
+
+  bool JSWeakObject::IsAlive() const {
+    return Lock().IsObject();
+  }
+
+  JSContext JSWeakObject::get_context() const HAL_NOEXCEPT {
+    return js_weak_object_map__.get_context();
+  }
+
+} // namespace HAL {
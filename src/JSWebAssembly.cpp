@@ -0,0 +1,196 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSWebAssembly.hpp"
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+
+#include "HAL/JSMemoryPressure.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/detail/JSMappedFile.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <memory>
+#include <utility>
+
+namespace HAL {
+
+  namespace {
+
+    // WebAssembly[name] in the global object of js_context.
+    JSObject GetWebAssemblyConstructor(const JSContext& js_context, const char* name) {
+      const auto webassembly = js_context.get_global_object().GetProperty("WebAssembly");
+      const auto constructor = webassembly.IsObject() ? static_cast<JSObject>(webassembly).GetProperty(name) : webassembly;
+      if (!constructor.IsObject() || !static_cast<JSObject>(constructor).IsConstructor()) {
+        detail::ThrowRuntimeError("JSWebAssembly", "This JavaScriptCore has no WebAssembly.");
+      }
+
+      return static_cast<JSObject>(constructor);
+    }
+
+    // new WebAssembly.Module(buffer), where buffer is an ArrayBuffer
+    // wrapping bytes, which are passed to deallocator once it is
+    // collected. Nothing else can reach the ArrayBuffer, which is why
+    // it may wrap bytes that are const.
+    JSObject ConstructWebAssemblyModule(const JSContext& js_context, const void* bytes, std::size_t byte_length, JSBytesDeallocator deallocator) {
+      auto constructor           = GetWebAssemblyConstructor(js_context, "Module");
+      const auto js_array_buffer = js_context.CreateArrayBuffer(const_cast<void*>(bytes), byte_length, deallocator);
+      return static_cast<JSObject>(constructor.Construct(js_array_buffer));
+    }
+
+  } // namespace {
+
+  JSWebAssemblyModule JSContext::CompileWebAssemblyModule(const void* bytes, std::size_t byte_length) const {
+    HAL_JSCONTEXT_LOCK_GUARD;
+    // WebAssembly.Module only reads the bytes, and copies what it
+    // keeps of them, so they needn't outlive the call.
+    const auto js_module = ConstructWebAssemblyModule(*this, bytes, byte_length, nullptr);
+    return JSWebAssemblyModule(*this, static_cast<JSObjectRef>(js_module));
+  }
+
+  JSWebAssemblyModule JSContext::CompileWebAssemblyModuleFile(const std::string& path) const {
+    // The deallocator owns the mapping, so the file stays mapped for
+    // as long as the ArrayBuffer wrapping it is alive.
+    const std::shared_ptr<detail::JSMappedFile> file_ptr = std::make_shared<detail::JSMappedFile>(path);
+    HAL_JSCONTEXT_LOCK_GUARD;
+    const auto js_module = ConstructWebAssemblyModule(*this, file_ptr -> data(), file_ptr -> size(), [file_ptr](void*) {
+    });
+    return JSWebAssemblyModule(*this, static_cast<JSObjectRef>(js_module));
+  }
+
+  JSWebAssemblyModule::JSWebAssemblyModule(const JSContext& js_context, JSObjectRef js_object_ref)
+  : JSObject(js_context, js_object_ref) {
+  }
+
+  JSWebAssemblyInstance JSWebAssemblyModule::Instantiate(const JSContext& js_context) const {
+    return Instantiate(js_context, js_context.CreateObject());
+  }
+
+  JSWebAssemblyInstance JSWebAssemblyModule::Instantiate(const JSContext& js_context, const JSObject& imports) const {
+    if (js_context.get_context_group() != js_context__.get_context_group()) {
+      detail::ThrowInvalidArgument("JSWebAssemblyModule", "The module was compiled for a different JSContextGroup.");
+    }
+
+    auto constructor       = GetWebAssemblyConstructor(js_context, "Instance");
+    const auto js_instance = constructor.Construct(static_cast<const JSObject&>(*this), imports);
+    return JSWebAssemblyInstance(js_context, static_cast<JSObjectRef>(js_instance));
+  }
+
+  JSWebAssemblyInstance::JSWebAssemblyInstance(const JSContext& js_context, JSObjectRef js_object_ref)
+  : JSObject(js_context, js_object_ref) {
+  }
+
+  JSObject JSWebAssemblyInstance::GetExports() const {
+    return static_cast<JSObject>(GetProperty("exports"));
+  }
+
+  JSArrayBuffer JSWebAssemblyInstance::GetMemory(const JSString& name) const {
+    const auto memory = GetExports().GetProperty(name);
+    const auto buffer = memory.IsObject() ? static_cast<JSObject>(memory).GetProperty("buffer") : memory;
+    if (!buffer.IsObject() || !static_cast<JSObject>(buffer).IsArrayBuffer()) {
+      detail::ThrowRuntimeError("JSWebAssemblyInstance", "No memory is exported as " + static_cast<std::string>(name) + ".");
+    }
+
+    return static_cast<JSArrayBuffer>(static_cast<JSObject>(buffer));
+  }
+
+  JSWebAssemblyModuleCache::JSWebAssemblyModuleCache(const JSContextGroup& js_context_group, std::size_t capacity)
+  : js_context__(js_context_group.CreateContext())
+  , capacity__(capacity) {
+    js_memory_pressure_handler_id__ = JSMemoryPressure::AddHandler([this](double fraction) {
+      return Evict(fraction);
+    });
+  }
+
+  JSWebAssemblyModuleCache::~JSWebAssemblyModuleCache() HAL_NOEXCEPT {
+    JSMemoryPressure::RemoveHandler(js_memory_pressure_handler_id__);
+  }
+
+  template<typename Compile>
+  JSWebAssemblyModule JSWebAssemblyModuleCache::GetOrCompileModule(const std::string& name, Compile compile) {
+    {
+      HAL_JSWEBASSEMBLYMODULECACHE_LOCK_GUARD;
+      const auto position = index__.find(name);
+      if (position != index__.end()) {
+        entries__.splice(entries__.begin(), entries__, position -> second);
+        return position -> second -> js_module;
+      }
+    }
+
+    // Compile outside of the lock, and before evicting, so an invalid
+    // module leaves the cache as it was.
+    std::size_t byte_length = 0;
+    const auto js_module = compile(byte_length);
+    if (capacity__ == 0) {
+      return js_module;
+    }
+
+    HAL_JSWEBASSEMBLYMODULECACHE_LOCK_GUARD;
+    const auto position = index__.find(name);
+    if (position != index__.end()) {
+      // Another thread compiled it first.
+      entries__.splice(entries__.begin(), entries__, position -> second);
+      return position -> second -> js_module;
+    }
+
+    if (entries__.size() >= capacity__) {
+      index__.erase(entries__.back().name);
+      entries__.pop_back();
+    }
+
+    entries__.push_front(Entry { name, js_module, byte_length });
+    index__.emplace(name, entries__.begin());
+    return js_module;
+  }
+
+  JSWebAssemblyModule JSWebAssemblyModuleCache::GetModule(const std::string& name, const void* bytes, std::size_t byte_length) {
+    return GetOrCompileModule(name, [this, bytes, byte_length](std::size_t& length) {
+      length = byte_length;
+      return js_context__.CompileWebAssemblyModule(bytes, byte_length);
+    });
+  }
+
+  JSWebAssemblyModule JSWebAssemblyModuleCache::GetModuleFile(const std::string& path) {
+    return GetOrCompileModule(path, [this, &path](std::size_t& length) {
+      // CompileWebAssemblyModule doesn't need the bytes once it
+      // returns, so the file is unmapped straight away.
+      const detail::JSMappedFile file(path);
+      length = file.size();
+      return js_context__.CompileWebAssemblyModule(file.data(), file.size());
+    });
+  }
+
+  std::size_t JSWebAssemblyModuleCache::size() const HAL_NOEXCEPT {
+    HAL_JSWEBASSEMBLYMODULECACHE_LOCK_GUARD;
+    return entries__.size();
+  }
+
+  void JSWebAssemblyModuleCache::clear() HAL_NOEXCEPT {
+    HAL_JSWEBASSEMBLYMODULECACHE_LOCK_GUARD;
+    index__.clear();
+    entries__.clear();
+  }
+
+  std::size_t JSWebAssemblyModuleCache::Evict(double fraction) HAL_NOEXCEPT {
+    HAL_JSWEBASSEMBLYMODULECACHE_LOCK_GUARD;
+    const auto count = JSMemoryPressure::GetEvictionCount(entries__.size(), fraction);
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      // The compiled code is at least about as large as the module's
+      // bytes, plus a list node and a hash map node.
+      const auto& entry = entries__.back();
+      result += entry.byte_length + entry.name.size() + sizeof(EntryList::value_type) + sizeof(std::pair<std::string, EntryList::iterator>) + 4 * sizeof(void*);
+      index__.erase(entry.name);
+      entries__.pop_back();
+    }
+    return result;
+  }
+
+} // namespace HAL {
+
+#endif // HAL_TYPED_ARRAY_ENABLE
@@ -0,0 +1,422 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSWorkerPool.hpp"
+
+#include "HAL/JSContextGroup.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace HAL {
+
+  namespace {
+
+    // The pool whose worker is the calling thread, so that a worker
+    // submitting to a full Block lane of its own pool is rejected
+    // instead of waiting for itself.
+    HAL_THREAD_LOCAL const JSWorkerPool* current_js_worker_pool__ = nullptr;
+
+    // The processors a worker may run on. Empty means anywhere.
+    typedef std::vector<unsigned> ProcessorSet;
+
+#if defined(_WIN32)
+    // Only the processors of the process's processor group can be
+    // named in an affinity mask.
+    ProcessorSet GetProcessorsInMask(ULONG_PTR mask) {
+      ProcessorSet processors;
+      for (unsigned i = 0; i < sizeof(mask) * 8; ++i) {
+        if (mask & (static_cast<ULONG_PTR>(1) << i)) {
+          processors.push_back(i);
+        }
+      }
+      return processors;
+    }
+
+    ULONG_PTR GetAllowedProcessorMask() {
+      DWORD_PTR process_mask = 0;
+      DWORD_PTR system_mask  = 0;
+      if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        return 0;
+      }
+      return process_mask;
+    }
+
+    ProcessorSet GetAllowedProcessors() {
+      return GetProcessorsInMask(GetAllowedProcessorMask());
+    }
+
+    std::vector<ProcessorSet> GetNumaNodeProcessors() {
+      std::vector<ProcessorSet> nodes;
+      const auto allowed_mask = GetAllowedProcessorMask();
+      ULONG highest_node = 0;
+      if (GetNumaHighestNodeNumber(&highest_node)) {
+        for (ULONG node = 0; node <= highest_node; ++node) {
+          ULONGLONG node_mask = 0;
+          if (GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &node_mask)) {
+            auto processors = GetProcessorsInMask(static_cast<ULONG_PTR>(node_mask) & allowed_mask);
+            if (!processors.empty()) {
+              nodes.push_back(std::move(processors));
+            }
+          }
+        }
+      }
+      return nodes;
+    }
+
+    void PinCurrentThread(const ProcessorSet& processors) HAL_NOEXCEPT {
+      ULONG_PTR mask = 0;
+      for (const auto processor : processors) {
+        mask |= static_cast<ULONG_PTR>(1) << processor;
+      }
+      SetThreadAffinityMask(GetCurrentThread(), mask);
+    }
+#elif defined(__linux__)
+    ProcessorSet GetAllowedProcessors() {
+      ProcessorSet processors;
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for (unsigned i = 0; i < CPU_SETSIZE; ++i) {
+          if (CPU_ISSET(i, &cpu_set)) {
+            processors.push_back(i);
+          }
+        }
+      }
+      return processors;
+    }
+
+    // Parse a sysfs list such as "0-3,8-11".
+    ProcessorSet ReadSysfsList(const std::string& path) {
+      ProcessorSet list;
+      std::ifstream file(path);
+      std::string range;
+      while (std::getline(file, range, ',')) {
+        unsigned first = 0;
+        unsigned last  = 0;
+        char dash      = 0;
+        std::istringstream range_stream(range);
+        if (!(range_stream >> first)) {
+          continue;
+        }
+        if (!(range_stream >> dash >> last) || dash != '-') {
+          last = first;
+        }
+        for (unsigned i = first; i <= last; ++i) {
+          list.push_back(i);
+        }
+      }
+      return list;
+    }
+
+    std::vector<ProcessorSet> GetNumaNodeProcessors() {
+      std::vector<ProcessorSet> nodes;
+      const auto allowed = GetAllowedProcessors();
+      for (const auto node : ReadSysfsList("/sys/devices/system/node/online")) {
+        ProcessorSet processors;
+        for (const auto processor : ReadSysfsList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")) {
+          if (std::binary_search(allowed.begin(), allowed.end(), processor)) {
+            processors.push_back(processor);
+          }
+        }
+        if (!processors.empty()) {
+          nodes.push_back(std::move(processors));
+        }
+      }
+      return nodes;
+    }
+
+    void PinCurrentThread(const ProcessorSet& processors) HAL_NOEXCEPT {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      for (const auto processor : processors) {
+        CPU_SET(processor, &cpu_set);
+      }
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+#else
+    ProcessorSet GetAllowedProcessors() {
+      return ProcessorSet();
+    }
+
+    std::vector<ProcessorSet> GetNumaNodeProcessors() {
+      return std::vector<ProcessorSet>();
+    }
+
+    void PinCurrentThread(const ProcessorSet&) HAL_NOEXCEPT {
+    }
+#endif
+
+    // The sets of processors the workers are spread across, round
+    // robin. Empty if the workers aren't pinned.
+    std::vector<ProcessorSet> GetPlacementProcessorSets(JSWorkerPlacement placement) {
+      std::vector<ProcessorSet> processor_sets;
+      switch (placement) {
+        case JSWorkerPlacement::None:
+          break;
+
+        case JSWorkerPlacement::Core:
+          for (const auto processor : GetAllowedProcessors()) {
+            processor_sets.push_back(ProcessorSet { processor });
+          }
+          break;
+
+        case JSWorkerPlacement::NumaNode:
+          processor_sets = GetNumaNodeProcessors();
+          if (processor_sets.empty()) {
+            const auto allowed = GetAllowedProcessors();
+            if (!allowed.empty()) {
+              processor_sets.push_back(allowed);
+            }
+          }
+          break;
+      }
+      return processor_sets;
+    }
+
+  } // namespace {
+
+  struct JSWorkerPool::Worker final {
+    struct QueuedTask final {
+      Task                                  task;
+      std::chrono::steady_clock::time_point enqueue_time;
+    };
+
+    std::mutex             mutex;
+    std::deque<QueuedTask> tasks[kJSTaskPriorityCount];
+    std::thread            thread;
+    ProcessorSet           processors;
+  };
+
+  JSWorkerPool::JSWorkerPool(unsigned thread_count, JSWorkerInitializer initializer, JSWorkerPlacement placement)
+  : initializer__(std::move(initializer))
+  , placement__(placement) {
+    if (thread_count == 0) {
+      thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Every queue must exist before any worker tries to steal from it.
+    const auto processor_sets = GetPlacementProcessorSets(placement);
+    workers__.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i) {
+      workers__.emplace_back(new Worker());
+      if (!processor_sets.empty()) {
+        workers__.back() -> processors = processor_sets[i % processor_sets.size()];
+      }
+    }
+
+    for (std::size_t i = 0; i < workers__.size(); ++i) {
+      workers__[i] -> thread = std::thread(&JSWorkerPool::Run, this, i);
+    }
+  }
+
+  JSWorkerPool::~JSWorkerPool() HAL_NOEXCEPT {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex__);
+      stopping__ = true;
+    }
+    sleep_condition__.notify_all();
+
+    for (const auto& worker : workers__) {
+      worker -> thread.join();
+    }
+  }
+
+  unsigned JSWorkerPool::get_thread_count() const HAL_NOEXCEPT {
+    return static_cast<unsigned>(workers__.size());
+  }
+
+  JSWorkerPlacement JSWorkerPool::get_placement() const HAL_NOEXCEPT {
+    return placement__;
+  }
+
+  void JSWorkerPool::set_queue_options(JSTaskPriority priority, const JSTaskQueueOptions& options) {
+    lanes__[static_cast<std::size_t>(priority)].set_options(options);
+
+    // A larger capacity, or a policy other than Block, frees the
+    // producers waiting for the old one.
+    std::lock_guard<std::mutex> lock(sleep_mutex__);
+    capacity_condition__.notify_all();
+  }
+
+  JSTaskQueueOptions JSWorkerPool::get_queue_options(JSTaskPriority priority) const HAL_NOEXCEPT {
+    return lanes__[static_cast<std::size_t>(priority)].get_options();
+  }
+
+  JSTaskLaneStatistics JSWorkerPool::GetLaneStatistics(JSTaskPriority priority) const HAL_NOEXCEPT {
+    return lanes__[static_cast<std::size_t>(priority)].GetStatistics();
+  }
+
+  void JSWorkerPool::Enqueue(Task task, JSTaskPriority priority) {
+    const auto lane_index = static_cast<std::size_t>(priority);
+    auto& lane = lanes__[lane_index];
+
+    // Slots are freed under sleep_mutex__, so a producer that finds the
+    // lane full there can't miss the notification.
+    auto admission = lane.Admit(current_js_worker_pool__ != this);
+    if (admission == detail::JSTaskLane::Admission::Full) {
+      std::unique_lock<std::mutex> lock(sleep_mutex__);
+      ++blocked_producer_count__;
+      do {
+        capacity_condition__.wait(lock, [&lane] { return lane.has_capacity() || lane.get_options().policy != JSBackpressurePolicy::Block; });
+        admission = lane.Admit(true);
+      } while (admission == detail::JSTaskLane::Admission::Full);
+      --blocked_producer_count__;
+    }
+
+    if (admission == detail::JSTaskLane::Admission::Reject) {
+      detail::ThrowRuntimeError("JSWorkerPool", std::string("The ") + to_string(priority) + " task queue is full.");
+    }
+
+    // The count goes up first so that it never drops below zero when
+    // a worker takes the task straight away.
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex__);
+      ++pending_task_count__;
+    }
+
+    const auto worker_index = next_worker_index__++ % workers__.size();
+    auto& worker = *workers__[worker_index];
+    {
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      Worker::QueuedTask queued_task;
+      queued_task.task         = std::move(task);
+      queued_task.enqueue_time = std::chrono::steady_clock::now();
+      worker.tasks[lane_index].push_back(std::move(queued_task));
+    }
+    sleep_condition__.notify_one();
+
+    if (lane.is_overflowing()) {
+      DropOldest(lane_index, worker_index);
+    }
+  }
+
+  void JSWorkerPool::DropOldest(std::size_t lane_index, std::size_t queued_worker_index) {
+    // Tasks are queued to the workers round robin, so the worker after
+    // the one just queued to was queued to the longest ago, and the
+    // front of its lane is the oldest task, or close to it.
+    auto& lane = lanes__[lane_index];
+    std::size_t i = 1;
+    while (i <= workers__.size() && lane.is_overflowing()) {
+      auto& worker = *workers__[(queued_worker_index + i) % workers__.size()];
+
+      // Destroyed outside the locks, since destroying the last copy of
+      // a task breaks its promise.
+      Task dropped_task;
+      {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto& tasks = worker.tasks[lane_index];
+        if (tasks.empty()) {
+          ++i;
+          continue;
+        }
+        dropped_task = std::move(tasks.front().task);
+        tasks.pop_front();
+      }
+
+      std::lock_guard<std::mutex> sleep_lock(sleep_mutex__);
+      --pending_task_count__;
+      lane.Drop();
+    }
+  }
+
+  bool JSWorkerPool::TryTakeTask(std::size_t worker_index, Task& task) {
+    // Every worker's lanes are searched before a lower priority is
+    // tried, and lanes with nothing queued are skipped without
+    // locking.
+    for (std::size_t lane_index = 0; lane_index < kJSTaskPriorityCount; ++lane_index) {
+      auto& lane = lanes__[lane_index];
+      if (lane.get_queued_count() == 0) {
+        continue;
+      }
+
+      // A worker takes the oldest task of its own queue, and steals
+      // the newest task of another's, so the two rarely contend for
+      // the same end.
+      for (std::size_t i = 0; i < workers__.size(); ++i) {
+        auto& worker = *workers__[(worker_index + i) % workers__.size()];
+        std::chrono::steady_clock::time_point enqueue_time;
+        {
+          std::lock_guard<std::mutex> lock(worker.mutex);
+          auto& tasks = worker.tasks[lane_index];
+          if (tasks.empty()) {
+            continue;
+          }
+
+          if (i == 0) {
+            task         = std::move(tasks.front().task);
+            enqueue_time = tasks.front().enqueue_time;
+            tasks.pop_front();
+          } else {
+            task         = std::move(tasks.back().task);
+            enqueue_time = tasks.back().enqueue_time;
+            tasks.pop_back();
+          }
+        }
+
+        std::lock_guard<std::mutex> sleep_lock(sleep_mutex__);
+        --pending_task_count__;
+        lane.Complete(std::chrono::steady_clock::now() - enqueue_time);
+        if (blocked_producer_count__ > 0) {
+          capacity_condition__.notify_all();
+        }
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void JSWorkerPool::Run(std::size_t worker_index) {
+    current_js_worker_pool__ = this;
+
+    // Pin first, so that the JavaScript heap is allocated on this
+    // worker's memory node.
+    const auto& processors = workers__[worker_index] -> processors;
+    if (!processors.empty()) {
+      PinCurrentThread(processors);
+    }
+
+    JSContextGroup js_context_group;
+    const auto js_context = js_context_group.CreateContext();
+    if (initializer__) {
+      initializer__(js_context);
+    }
+
+    while (true) {
+      Task task;
+      if (TryTakeTask(worker_index, task)) {
+        task(js_context);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleep_mutex__);
+      sleep_condition__.wait(lock, [this] { return pending_task_count__ > 0 || stopping__; });
+      if (stopping__ && pending_task_count__ == 0) {
+        return;
+      }
+    }
+  }
+
+} // namespace HAL {
@@ -0,0 +1,69 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSAPIStatistics.hpp"
+
+#ifdef HAL_API_STATISTICS_ENABLE
+#include <mutex>
+#include <unordered_map>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // A JSGlobalContextRef may be reused once its last JSContext is
+    // gone, by which time its entry has expired.
+    struct APIStatisticsRegistry final {
+      JSMutex                                                              mutex HAL_LOCK_NAME("JSAPIStatistics");
+      std::unordered_map<JSGlobalContextRef, std::weak_ptr<JSAPIStatistics>> statistics;
+    };
+
+    APIStatisticsRegistry& GetAPIStatisticsRegistry() {
+      static APIStatisticsRegistry registry;
+      return registry;
+    }
+
+  } // namespace {
+
+  const char* to_string(JSAPICategory category) HAL_NOEXCEPT {
+    switch (category) {
+      case JSAPICategory::EvaluateScript:    return "EvaluateScript";
+      case JSAPICategory::CallAsFunction:    return "CallAsFunction";
+      case JSAPICategory::CallAsConstructor: return "CallAsConstructor";
+      case JSAPICategory::GetProperty:       return "GetProperty";
+      case JSAPICategory::SetProperty:       return "SetProperty";
+      case JSAPICategory::HasProperty:       return "HasProperty";
+      case JSAPICategory::DeleteProperty:    return "DeleteProperty";
+      case JSAPICategory::ValueConversion:   return "ValueConversion";
+      case JSAPICategory::ValueTypeCheck:    return "ValueTypeCheck";
+    }
+    return "Unknown";
+  }
+
+  std::shared_ptr<JSAPIStatistics> GetJSAPIStatistics(JSGlobalContextRef js_global_context_ref) {
+    auto& registry = GetAPIStatisticsRegistry();
+    std::lock_guard<JSMutex> lock(registry.mutex);
+    auto& entry = registry.statistics[js_global_context_ref];
+    auto statistics = entry.lock();
+    if (!statistics) {
+      // Drop the entries of contexts that are gone before adding one.
+      for (auto position = registry.statistics.begin(); position != registry.statistics.end();) {
+        if (position -> second.expired() && position -> first != js_global_context_ref) {
+          position = registry.statistics.erase(position);
+        } else {
+          ++position;
+        }
+      }
+      statistics = std::make_shared<JSAPIStatistics>();
+      registry.statistics[js_global_context_ref] = statistics;
+    }
+    return statistics;
+  }
+
+}} // namespace HAL { namespace detail {
+#endif // HAL_API_STATISTICS_ENABLE
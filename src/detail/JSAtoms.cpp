@@ -0,0 +1,39 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSAtoms.hpp"
+
+namespace HAL { namespace detail {
+  
+  const JSString JSAtoms::Array        { "Array" };
+  const JSString JSAtoms::isArray      { "isArray" };
+  const JSString JSAtoms::JSON         { "JSON" };
+  const JSString JSAtoms::Object       { "Object" };
+  const JSString JSAtoms::RegExp       { "RegExp" };
+  const JSString JSAtoms::Date         { "Date" };
+  const JSString JSAtoms::Error        { "Error" };
+  const JSString JSAtoms::length       { "length" };
+  const JSString JSAtoms::message      { "message" };
+  const JSString JSAtoms::name         { "name" };
+  const JSString JSAtoms::fileName     { "fileName" };
+  const JSString JSAtoms::lineNumber   { "lineNumber" };
+  const JSString JSAtoms::native_stack { "native_stack" };
+  const JSString JSAtoms::from         { "from" };
+  const JSString JSAtoms::Function     { "Function" };
+  const JSString JSAtoms::getTime      { "getTime" };
+  const JSString JSAtoms::test         { "test" };
+  const JSString JSAtoms::exec         { "exec" };
+  const JSString JSAtoms::lastIndex    { "lastIndex" };
+  const JSString JSAtoms::prototype    { "prototype" };
+  const JSString JSAtoms::Float64Array { "Float64Array" };
+  const JSString JSAtoms::Int32Array   { "Int32Array" };
+  const JSString JSAtoms::Uint32Array  { "Uint32Array" };
+  const JSString JSAtoms::values       { "values" };
+  const JSString JSAtoms::done         { "done" };
+  
+}} // namespace HAL { namespace detail {
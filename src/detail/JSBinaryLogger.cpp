@@ -0,0 +1,228 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSBinaryLogger.hpp"
+#include "HAL/detail/JSBase.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace HAL { namespace detail {
+  
+  namespace {
+    
+    const char kMagic[] = { 'H', 'A', 'L', 'B', 'L', 'O', 'G', '1' };
+    
+    HAL_THREAD_LOCAL std::uint32_t thread_id = 0;
+    
+    template<typename T>
+    void Put(std::string& data, T value) {
+      data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    
+    // Reads the fields of one record, throwing if it is too short.
+    class RecordReader final {
+    public:
+      
+      RecordReader(const std::vector<char>& data)
+      : data__(data) {
+      }
+      
+      template<typename T>
+      T Get() {
+        T value;
+        Read(&value, sizeof(value));
+        return value;
+      }
+      
+      std::string GetString(std::size_t length) {
+        std::string value(length, '\0');
+        Read(&value[0], length);
+        return value;
+      }
+      
+    private:
+      
+      void Read(void* value, std::size_t size) {
+        if (offset__ + size > data__.size()) {
+          throw std::runtime_error("DecodeJSBinaryLog: The log has a truncated record");
+        }
+        if (size > 0) {
+          std::memcpy(value, data__.data() + offset__, size);
+        }
+        offset__ += size;
+      }
+      
+      const std::vector<char>& data__;
+      std::size_t              offset__ { 0 };
+    };
+    
+    struct Format final {
+      std::string file;
+      std::uint32_t line;
+      std::uint8_t severity;
+    };
+    
+    const char* GetSeverityString(std::uint8_t severity) {
+      static const char* const severities[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+      return severity < 5 ? severities[severity] : "?";
+    }
+    
+  } // namespace {
+  
+  std::shared_ptr<JSBinaryLogger> JSBinaryLogger::Instance() {
+    static std::shared_ptr<JSBinaryLogger> instance;
+    static std::once_flag of;
+    std::call_once(of, [] {
+      instance = std::make_shared<JSBinaryLogger>("HAL.binlog");
+    });
+    
+    return instance;
+  }
+  
+  JSBinaryLogger::JSBinaryLogger(const std::string& name) {
+    ofstream__.open(name, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!ofstream__.is_open()) {
+      throw(std::runtime_error("JSBinaryLogger: Unable to open " + name));
+    }
+    ofstream__.write(kMagic, sizeof(kMagic));
+  }
+  
+  JSBinaryLogger::~JSBinaryLogger() {
+    ofstream__.close();
+  }
+  
+  std::uint32_t JSBinaryLogger::RegisterFormat(const char* file, int line, int severity) {
+    const std::string file_name(file ? file : "");
+    std::string data;
+    std::uint32_t format_id = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex__);
+      format_id = next_format_id__++;
+    }
+    Put(data, format_id);
+    Put(data, static_cast<std::uint8_t>(severity));
+    Put(data, static_cast<std::uint32_t>(line));
+    Put(data, static_cast<std::uint16_t>(file_name.size()));
+    data += file_name;
+    Write(JSBinaryLogRecordKind::Format, data.data(), data.size());
+    return format_id;
+  }
+  
+  void JSBinaryLogger::Flush() {
+    std::lock_guard<std::mutex> lock(mutex__);
+    ofstream__.flush();
+  }
+  
+  std::uint64_t JSBinaryLogger::GetTimestampNanoseconds() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+  }
+  
+  std::uint32_t JSBinaryLogger::GetThreadId() {
+    static std::atomic<std::uint32_t> next_thread_id { 1 };
+    if (thread_id == 0) {
+      thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    }
+    return thread_id;
+  }
+  
+  void JSBinaryLogger::Write(JSBinaryLogRecordKind kind, const char* data, std::size_t size) {
+    const auto record_kind = static_cast<std::uint8_t>(kind);
+    const auto record_size = static_cast<std::uint32_t>(size);
+    std::lock_guard<std::mutex> lock(mutex__);
+    ofstream__.write(reinterpret_cast<const char*>(&record_kind), sizeof(record_kind));
+    ofstream__.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+    ofstream__.write(data, static_cast<std::streamsize>(size));
+  }
+  
+  void DecodeJSBinaryLog(std::istream& input, std::ostream& output) {
+    char magic[sizeof(kMagic)];
+    if (!input.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+      throw std::runtime_error("DecodeJSBinaryLog: The input isn't a binary log");
+    }
+    
+    std::map<std::uint32_t, Format> formats;
+    std::vector<char> data;
+    for (;;) {
+      std::uint8_t  record_kind = 0;
+      std::uint32_t record_size = 0;
+      if (!input.read(reinterpret_cast<char*>(&record_kind), sizeof(record_kind))) {
+        return;
+      }
+      
+      // The writer may have stopped part way through a record.
+      if (!input.read(reinterpret_cast<char*>(&record_size), sizeof(record_size))) {
+        throw std::runtime_error("DecodeJSBinaryLog: The log has a truncated record");
+      }
+      data.resize(record_size);
+      if (record_size > 0 && !input.read(data.data(), static_cast<std::streamsize>(record_size))) {
+        throw std::runtime_error("DecodeJSBinaryLog: The log has a truncated record");
+      }
+      
+      RecordReader reader(data);
+      switch (static_cast<JSBinaryLogRecordKind>(record_kind)) {
+        case JSBinaryLogRecordKind::Format: {
+          Format format;
+          const auto format_id = reader.Get<std::uint32_t>();
+          format.severity      = reader.Get<std::uint8_t>();
+          format.line          = reader.Get<std::uint32_t>();
+          format.file          = reader.GetString(reader.Get<std::uint16_t>());
+          formats[format_id]   = format;
+          break;
+        }
+          
+        case JSBinaryLogRecordKind::Message: {
+          const auto format_id      = reader.Get<std::uint32_t>();
+          const auto timestamp      = reader.Get<std::uint64_t>();
+          const auto thread         = reader.Get<std::uint32_t>();
+          const auto argument_count = reader.Get<std::uint8_t>();
+          const auto format         = formats.find(format_id);
+          
+          output << timestamp / 1000000000 << "." << std::setfill('0') << std::setw(9) << timestamp % 1000000000 << std::setfill(' ')
+                 << " [" << thread << "] "
+                 << (format != formats.end() ? GetSeverityString(format -> second.severity) : "?") << ": ";
+          for (std::uint8_t i = 0; i < argument_count; ++i) {
+            switch (static_cast<JSBinaryLogArgumentType>(reader.Get<std::uint8_t>())) {
+              case JSBinaryLogArgumentType::Signed:
+                output << reader.Get<std::int64_t>();
+                break;
+              case JSBinaryLogArgumentType::Unsigned:
+                output << reader.Get<std::uint64_t>();
+                break;
+              case JSBinaryLogArgumentType::Double:
+                output << reader.Get<double>();
+                break;
+              case JSBinaryLogArgumentType::Pointer:
+                output << "0x" << std::hex << reader.Get<std::uint64_t>() << std::dec;
+                break;
+              case JSBinaryLogArgumentType::String:
+                output << reader.GetString(reader.Get<std::uint8_t>());
+                break;
+              default:
+                throw std::runtime_error("DecodeJSBinaryLog: The log has an argument of an unknown type");
+            }
+          }
+          if (format != formats.end()) {
+            output << " (" << format -> second.file << ":" << format -> second.line << ")";
+          }
+          output << "\n";
+          break;
+        }
+          
+        default:
+          // Skip the records of later versions.
+          break;
+      }
+    }
+  }
+  
+}} // namespace HAL { namespace detail {
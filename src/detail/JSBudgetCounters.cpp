@@ -0,0 +1,24 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSBudgetCounters.hpp"
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // Zero initialized, which __declspec(thread) requires.
+    HAL_THREAD_LOCAL JSBudgetCounts js_budget_counts;
+
+  } // namespace {
+
+  JSBudgetCounts& GetJSBudgetCounts() HAL_NOEXCEPT {
+    return js_budget_counts;
+  }
+
+}} // namespace HAL { namespace detail {
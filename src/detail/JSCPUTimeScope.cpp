@@ -0,0 +1,137 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSCPUTimeScope.hpp"
+
+#ifdef HAL_CPU_TIME_ENABLE
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // A JSGlobalContextRef may be reused once its last JSContext is
+    // gone, by which time its entry has expired.
+    struct CPUTimeCountersRegistry final {
+      JSMutex                                                                  mutex HAL_LOCK_NAME("JSCPUTimeCounters");
+      std::unordered_map<JSGlobalContextRef, std::weak_ptr<JSCPUTimeCounters>> counters;
+    };
+
+    CPUTimeCountersRegistry& GetCPUTimeCountersRegistry() {
+      static CPUTimeCountersRegistry registry;
+      return registry;
+    }
+
+    // The innermost scope of the thread, and the thread CPU time when
+    // it last changed.
+    HAL_THREAD_LOCAL JSCPUTimeScope* current_scope__    = nullptr;
+    HAL_THREAD_LOCAL std::uint64_t   last_nanoseconds__ = 0;
+
+  } // namespace {
+
+  std::shared_ptr<JSCPUTimeCounters> GetJSCPUTimeCounters(JSGlobalContextRef js_global_context_ref) {
+    auto& registry = GetCPUTimeCountersRegistry();
+    std::lock_guard<JSMutex> lock(registry.mutex);
+    auto counters = registry.counters[js_global_context_ref].lock();
+    if (!counters) {
+      // Drop the entries of contexts that are gone before adding one.
+      for (auto position = registry.counters.begin(); position != registry.counters.end();) {
+        if (position -> second.expired() && position -> first != js_global_context_ref) {
+          position = registry.counters.erase(position);
+        } else {
+          ++position;
+        }
+      }
+      counters = std::make_shared<JSCPUTimeCounters>(js_global_context_ref);
+      registry.counters[js_global_context_ref] = counters;
+    }
+    return counters;
+  }
+
+  std::uint64_t GetThreadCPUNanoseconds() HAL_NOEXCEPT {
+#if defined(_WIN32)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+      const auto kernel = (static_cast<std::uint64_t>(kernel_time.dwHighDateTime) << 32) | kernel_time.dwLowDateTime;
+      const auto user   = (static_cast<std::uint64_t>(user_time.dwHighDateTime)   << 32) | user_time.dwLowDateTime;
+      return (kernel + user) * 100;
+    }
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) {
+      return static_cast<std::uint64_t>(time.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(time.tv_nsec);
+    }
+#endif
+    // Without a thread CPU clock, wall time is the closest measure.
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  JSCPUTimeScope::JSCPUTimeScope(JSCPUTimeCounters& counters) HAL_NOEXCEPT
+  : counters__(&counters)
+  , native__(false) {
+    counters__ -> entry_count.fetch_add(1, std::memory_order_relaxed);
+    Enter();
+  }
+
+  JSCPUTimeScope::JSCPUTimeScope(JSContextRef context_ref) HAL_NOEXCEPT
+  : native__(true) {
+    // A callback is almost always nested in a call for the same
+    // context, whose counters it shares without a lookup.
+    const auto js_global_context_ref = JSContextGetGlobalContext(context_ref);
+    if (current_scope__ && current_scope__ -> counters__ && current_scope__ -> counters__ -> js_global_context_ref == js_global_context_ref) {
+      counters__ = current_scope__ -> counters__;
+    } else {
+      try {
+        shared_counters__ = GetJSCPUTimeCounters(js_global_context_ref);
+        counters__        = shared_counters__.get();
+      } catch (const std::exception&) {
+        // The time of this callback goes uncounted.
+      }
+    }
+
+    if (counters__) {
+      counters__ -> callback_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    Enter();
+  }
+
+  JSCPUTimeScope::~JSCPUTimeScope() HAL_NOEXCEPT {
+    ChargeCurrent();
+    current_scope__ = previous__;
+  }
+
+  void JSCPUTimeScope::Enter() HAL_NOEXCEPT {
+    ChargeCurrent();
+    previous__      = current_scope__;
+    current_scope__ = this;
+  }
+
+  void JSCPUTimeScope::ChargeCurrent() HAL_NOEXCEPT {
+    const auto now = GetThreadCPUNanoseconds();
+    const auto current_scope = current_scope__;
+    if (current_scope && current_scope -> counters__ && now > last_nanoseconds__) {
+      auto& nanoseconds = current_scope -> native__ ? current_scope -> counters__ -> native_nanoseconds : current_scope -> counters__ -> js_nanoseconds;
+      nanoseconds.fetch_add(now - last_nanoseconds__, std::memory_order_relaxed);
+    }
+    last_nanoseconds__ = now;
+  }
+
+}} // namespace HAL { namespace detail {
+#endif // HAL_CPU_TIME_ENABLE
@@ -0,0 +1,76 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSContextGroupState.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    struct JSContextGroupStateRegistry final {
+      JSMutex                                                                  mutex HAL_LOCK_NAME("JSContextGroupState registry");
+      std::unordered_map<JSContextGroupRef, std::weak_ptr<JSContextGroupState>> states;
+
+      // The states of UnmanagedSingleContext groups, which live as long.
+      std::vector<std::shared_ptr<JSContextGroupState>> unmanaged_states;
+    };
+
+    JSContextGroupStateRegistry& GetRegistry() HAL_NOEXCEPT {
+      static JSContextGroupStateRegistry registry;
+      return registry;
+    }
+
+  } // namespace {
+
+  JSContextGroupState::JSContextGroupState(JSContextGroupRef js_context_group_ref, JSContextGroupPolicy policy) HAL_NOEXCEPT
+  : quota_state(js_context_group_ref)
+  , js_context_group_ref__(js_context_group_ref)
+  , policy__(policy) {
+  }
+
+  JSContextGroupState::~JSContextGroupState() HAL_NOEXCEPT {
+    // The state of a group made later at the same address keeps its
+    // entry.
+    auto& registry = GetRegistry();
+    std::lock_guard<JSMutex> lock(registry.mutex);
+    const auto position = registry.states.find(js_context_group_ref__);
+    if (position != registry.states.end() && position -> second.expired()) {
+      registry.states.erase(position);
+    }
+  }
+
+  void JSContextGroupState::Register(const std::shared_ptr<JSContextGroupState>& state) HAL_NOEXCEPT {
+    auto& registry = GetRegistry();
+    registry.states[state -> js_context_group_ref__] = state;
+    if (state -> policy__ == JSContextGroupPolicy::UnmanagedSingleContext) {
+      registry.unmanaged_states.push_back(state);
+    }
+  }
+
+  std::shared_ptr<JSContextGroupState> JSContextGroupState::Create(JSContextGroupRef js_context_group_ref, JSContextGroupPolicy policy) HAL_NOEXCEPT {
+    const auto state = std::make_shared<JSContextGroupState>(js_context_group_ref, policy);
+    std::lock_guard<JSMutex> lock(GetRegistry().mutex);
+    Register(state);
+    return state;
+  }
+
+  std::shared_ptr<JSContextGroupState> JSContextGroupState::Get(JSContextGroupRef js_context_group_ref) HAL_NOEXCEPT {
+    std::lock_guard<JSMutex> lock(GetRegistry().mutex);
+    auto state = GetRegistry().states[js_context_group_ref].lock();
+    if (!state) {
+      state = std::make_shared<JSContextGroupState>(js_context_group_ref, kDefaultJSContextGroupPolicy);
+      Register(state);
+    }
+    return state;
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,186 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportClassInfo.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <unordered_map>
+
+#ifdef HAL_THREAD_SAFE_STATICS
+#include <mutex>
+#endif
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // Classes are registered once, when JSExport<T>::Class is first
+    // called, so a single map is enough.
+    std::unordered_map<JSClassRef, const JSExportClassInfo*>& GetRegistry() {
+      static std::unordered_map<JSClassRef, const JSExportClassInfo*> registry;
+      return registry;
+    }
+
+#ifdef HAL_THREAD_SAFE_STATICS
+    JSMutex& GetRegistryMutex() {
+      static JSMutex mutex HAL_LOCK_NAME("JSExportClassInfo registry");
+      return mutex;
+    }
+#define HAL_DETAIL_JSEXPORTCLASSINFO_LOCK_GUARD std::lock_guard<JSMutex> lock(GetRegistryMutex())
+#else
+#define HAL_DETAIL_JSEXPORTCLASSINFO_LOCK_GUARD
+#endif
+
+    bool IsOverBudget(const JSExportClassBudget& budget, const JSExportClassStatistics& statistics) HAL_NOEXCEPT {
+      return (budget.live_count  != 0 && statistics.live_count        > budget.live_count)
+          || (budget.total_bytes != 0 && statistics.get_total_bytes() > budget.total_bytes);
+    }
+
+    // Called after every count that can go up or down, so over_budget
+    // is cleared once the class is back within its budget.
+    void CheckBudget(const JSExportClassInfo& class_info) HAL_NOEXCEPT {
+      if (!class_info.has_budget.load(std::memory_order_acquire)) {
+        return;
+      }
+
+      const auto budget     = std::atomic_load(&class_info.budget);
+      const auto statistics = GetJSExportClassStatistics(class_info);
+      if (!IsOverBudget(*budget, statistics)) {
+        if (class_info.over_budget.load(std::memory_order_relaxed)) {
+          class_info.over_budget.store(false, std::memory_order_relaxed);
+        }
+        return;
+      }
+
+      if (class_info.over_budget.exchange(true, std::memory_order_relaxed) || !budget -> callback) {
+        return;
+      }
+
+      try {
+        budget -> callback(statistics);
+      } catch (const std::exception& e) {
+        HAL_LOG_ERROR("JSExportClassInfo: budget callback threw ", e.what());
+      } catch (...) {
+        HAL_LOG_ERROR("JSExportClassInfo: budget callback threw an unknown exception");
+      }
+    }
+
+  } // namespace {
+
+  void RegisterJSExportClassInfo(JSClassRef js_class_ref, JSClassRef parent_js_class_ref, JSExportClassInfo& class_info) {
+    HAL_DETAIL_JSEXPORTCLASSINFO_LOCK_GUARD;
+    auto& registry = GetRegistry();
+
+    class_info.display.clear();
+    const auto parent = parent_js_class_ref ? registry.find(parent_js_class_ref) : registry.end();
+    if (parent != registry.end()) {
+      class_info.display = parent -> second -> display;
+    }
+
+    class_info.display.push_back(&class_info);
+    class_info.depth = class_info.display.size() - 1;
+    class_info.js_class_ref = js_class_ref;
+    registry[js_class_ref] = &class_info;
+  }
+
+  const JSExportClassInfo* FindJSExportClassInfo(JSClassRef js_class_ref) {
+    HAL_DETAIL_JSEXPORTCLASSINFO_LOCK_GUARD;
+    const auto& registry = GetRegistry();
+    const auto  position = registry.find(js_class_ref);
+    return position != registry.end() ? position -> second : nullptr;
+  }
+
+  std::vector<const JSExportClassInfo*> GetJSExportClassInfos() {
+    HAL_DETAIL_JSEXPORTCLASSINFO_LOCK_GUARD;
+    std::vector<const JSExportClassInfo*> class_infos;
+    for (const auto& entry : GetRegistry()) {
+      class_infos.push_back(entry.second);
+    }
+    return class_infos;
+  }
+
+  void AddJSExportClassInstance(const JSExportClassInfo& class_info) HAL_NOEXCEPT {
+    class_info.live_count.fetch_add(1, std::memory_order_relaxed);
+    CheckBudget(class_info);
+  }
+
+  void RemoveJSExportClassInstance(const JSExportClassInfo& class_info) HAL_NOEXCEPT {
+    class_info.live_count.fetch_sub(1, std::memory_order_relaxed);
+    CheckBudget(class_info);
+  }
+
+  void AdjustJSExportClassExternalMemory(const JSExportClassInfo& class_info, std::ptrdiff_t byte_delta) HAL_NOEXCEPT {
+    // Unsigned wrap around makes adding a negative delta a subtraction.
+    class_info.external_memory_bytes.fetch_add(static_cast<std::size_t>(byte_delta), std::memory_order_relaxed);
+    CheckBudget(class_info);
+  }
+
+  JSExportClassStatistics GetJSExportClassStatistics(const JSExportClassInfo& class_info) HAL_NOEXCEPT {
+    const auto live_count = class_info.live_count.load(std::memory_order_relaxed);
+    return JSExportClassStatistics {
+      live_count,
+      live_count * class_info.instance_size,
+      class_info.external_memory_bytes.load(std::memory_order_relaxed),
+      class_info.finalized_count.load(std::memory_order_relaxed)
+    };
+  }
+
+  void SetJSExportClassBudget(JSExportClassInfo& class_info, const JSExportClassBudget& budget) {
+    std::atomic_store(&class_info.budget, std::shared_ptr<const JSExportClassBudget>(std::make_shared<JSExportClassBudget>(budget)));
+    class_info.over_budget.store(false, std::memory_order_relaxed);
+    class_info.has_budget.store(true, std::memory_order_release);
+    CheckBudget(class_info);
+  }
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+  const char* to_string(JSExportCallbackKind kind) HAL_NOEXCEPT {
+    switch (kind) {
+      case JSExportCallbackKind::GetNamedValueProperty: return "GetNamedValueProperty";
+      case JSExportCallbackKind::SetNamedValueProperty: return "SetNamedValueProperty";
+      case JSExportCallbackKind::CallNamedFunction:     return "CallNamedFunction";
+      case JSExportCallbackKind::CallAsFunction:        return "CallAsFunction";
+      case JSExportCallbackKind::CallAsConstructor:     return "CallAsConstructor";
+      case JSExportCallbackKind::ConvertToType:         return "ConvertToType";
+      case JSExportCallbackKind::Finalize:              return "Finalize";
+    }
+    return "Unknown";
+  }
+
+  std::vector<JSCallbackLatency> GetCallbackLatencies() {
+    std::vector<JSCallbackLatency> latencies;
+    {
+      HAL_DETAIL_JSEXPORTCLASSINFO_LOCK_GUARD;
+      for (const auto& entry : GetRegistry()) {
+        const auto class_info = entry.second;
+        for (std::size_t i = 0; i < kJSExportCallbackKindCount; ++i) {
+          if (class_info -> callback_latency[i].get_count() > 0) {
+            latencies.push_back({ class_info -> name, static_cast<JSExportCallbackKind>(i), &class_info -> callback_latency[i] });
+          }
+        }
+      }
+    }
+
+    std::sort(latencies.begin(), latencies.end(), [](const JSCallbackLatency& lhs, const JSCallbackLatency& rhs) {
+      return lhs.histogram -> get_total_nanoseconds() > rhs.histogram -> get_total_nanoseconds();
+    });
+    return latencies;
+  }
+
+  void ResetCallbackLatencies() {
+    HAL_DETAIL_JSEXPORTCLASSINFO_LOCK_GUARD;
+    for (const auto& entry : GetRegistry()) {
+      for (auto& histogram : entry.second -> callback_latency) {
+        histogram.Reset();
+      }
+    }
+  }
+#endif
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,159 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportConstantCache.hpp"
+#include "HAL/JSMemoryPressure.hpp"
+
+#include <iterator>
+
+namespace {
+  // The head of the list of all live caches. JSExportClass keeps its
+  // cache in a static member, so the list must not need construction.
+  HAL::detail::JSExportConstantCache* js_export_constant_cache_list__ = nullptr;
+
+#ifdef HAL_THREAD_SAFE_STATICS
+  HAL::detail::JSMutex js_export_constant_cache_list_mutex__ HAL_LOCK_NAME("JSExportConstantCache list");
+#endif
+}
+
+#undef  HAL_JSEXPORTCONSTANTCACHE_LIST_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE_STATICS
+#define HAL_JSEXPORTCONSTANTCACHE_LIST_LOCK_GUARD std::lock_guard<JSMutex> lock_list(js_export_constant_cache_list_mutex__)
+#else
+#define HAL_JSEXPORTCONSTANTCACHE_LIST_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+
+namespace HAL { namespace detail {
+
+  JSExportConstantCache::JSExportConstantCache(std::size_t capacity)
+  : capacity__(capacity) {
+    HAL_JSEXPORTCONSTANTCACHE_LIST_LOCK_GUARD;
+    next__ = js_export_constant_cache_list__;
+    if (next__) {
+      next__ -> previous__ = this;
+    }
+    js_export_constant_cache_list__ = this;
+  }
+
+  JSExportConstantCache::~JSExportConstantCache() HAL_NOEXCEPT {
+    HAL_JSEXPORTCONSTANTCACHE_LIST_LOCK_GUARD;
+    if (previous__) {
+      previous__ -> next__ = next__;
+    } else {
+      js_export_constant_cache_list__ = next__;
+    }
+    if (next__) {
+      next__ -> previous__ = previous__;
+    }
+  }
+
+  std::size_t JSExportConstantCache::GetTotalSize() {
+    HAL_JSEXPORTCONSTANTCACHE_LIST_LOCK_GUARD;
+    std::size_t result = 0;
+    for (auto cache = js_export_constant_cache_list__; cache; cache = cache -> next__) {
+      result += cache -> size();
+    }
+    return result;
+  }
+
+  std::size_t JSExportConstantCache::EvictAll(double fraction) {
+    HAL_JSEXPORTCONSTANTCACHE_LIST_LOCK_GUARD;
+    std::size_t result = 0;
+    for (auto cache = js_export_constant_cache_list__; cache; cache = cache -> next__) {
+      result += cache -> Evict(fraction);
+    }
+    return result;
+  }
+
+  const JSValue* JSExportConstantCache::Find(JSContextRef js_context_ref, std::size_t index) {
+    const auto position = map__.find(MakeKey(js_context_ref, index));
+    if (position == map__.end()) {
+      ++statistics__.misses;
+      return nullptr;
+    }
+
+    ++statistics__.hits;
+
+    // Move the node to the most recently used end without copying it.
+    list__.splice(list__.end(), list__, position -> second);
+    return &position -> second -> js_value;
+  }
+
+  void JSExportConstantCache::Insert(JSContextRef js_context_ref, std::size_t index, const JSValue& js_value) {
+    if (capacity__ == 0) {
+      return;
+    }
+
+    const auto key      = MakeKey(js_context_ref, index);
+    const auto position = map__.find(key);
+    if (position != map__.end()) {
+      position -> second -> js_value = js_value;
+      list__.splice(list__.end(), list__, position -> second);
+      return;
+    }
+
+    if (map__.size() >= capacity__) {
+      EvictLeastRecentlyUsed();
+    }
+
+    list__.push_back(Node { key, js_value });
+    map__.emplace(key, std::prev(list__.end()));
+  }
+
+  void JSExportConstantCache::EvictLeastRecentlyUsed() {
+    if (list__.empty()) {
+      return;
+    }
+
+    ++statistics__.evictions;
+    map__.erase(list__.front().key);
+    list__.pop_front();
+  }
+
+  std::size_t JSExportConstantCache::Evict(double fraction) {
+    // A list node and a hash map node per entry.
+    static const std::size_t kEntrySize = sizeof(Node) + sizeof(std::pair<Key, std::list<Node>::iterator>) + 4 * sizeof(void*);
+    const auto count = JSMemoryPressure::GetEvictionCount(list__.size(), fraction);
+    for (std::size_t i = 0; i < count; ++i) {
+      EvictLeastRecentlyUsed();
+    }
+    return count * kEntrySize;
+  }
+
+  void JSExportConstantCache::Clear() {
+    map__.clear();
+    list__.clear();
+  }
+
+  void JSExportConstantCache::Clear(JSContextRef js_context_ref) {
+    const auto js_global_context_ref = JSContextGetGlobalContext(js_context_ref);
+    for (auto position = list__.begin(); position != list__.end();) {
+      if (position -> key.js_context_ref == js_global_context_ref) {
+        map__.erase(position -> key);
+        position = list__.erase(position);
+      } else {
+        ++position;
+      }
+    }
+  }
+
+  void JSExportConstantCache::set_capacity(std::size_t capacity) {
+    Clear();
+    capacity__ = capacity;
+  }
+
+  std::vector<std::size_t> JSExportConstantCache::GetIndexes() const {
+    std::vector<std::size_t> indexes;
+    indexes.reserve(list__.size());
+    for (auto position = list__.rbegin(); position != list__.rend(); ++position) {
+      indexes.push_back(position -> key.index);
+    }
+    return indexes;
+  }
+
+}} // namespace HAL { namespace detail {
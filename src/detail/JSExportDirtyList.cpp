@@ -0,0 +1,49 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportDirtyList.hpp"
+
+#include <algorithm>
+
+namespace HAL { namespace detail {
+
+  void JSExportDirtyList::Mark(JSExportDirtySet& dirty_set, void* native_object, std::size_t index) {
+    HAL_DETAIL_JSEXPORTDIRTYLIST_LOCK_GUARD;
+    if (dirty_set.Mark(index)) {
+      entries__.push_back(Entry { &dirty_set, native_object });
+    }
+  }
+
+  void JSExportDirtyList::Remove(JSExportDirtySet& dirty_set) HAL_NOEXCEPT {
+    HAL_DETAIL_JSEXPORTDIRTYLIST_LOCK_GUARD;
+    dirty_set.Clear();
+    const auto position = std::find_if(entries__.begin(), entries__.end(), [&dirty_set](const Entry& entry) {
+      return entry.dirty_set == &dirty_set;
+    });
+    if (position != entries__.end()) {
+      entries__.erase(position);
+    }
+  }
+
+  void* JSExportDirtyList::Pop(std::vector<std::size_t>& indexes) {
+    HAL_DETAIL_JSEXPORTDIRTYLIST_LOCK_GUARD;
+    if (entries__.empty()) {
+      return nullptr;
+    }
+    const auto entry = entries__.front();
+    entries__.pop_front();
+    entry.dirty_set -> Take(indexes);
+    return entry.native_object;
+  }
+
+  std::size_t JSExportDirtyList::size() const {
+    HAL_DETAIL_JSEXPORTDIRTYLIST_LOCK_GUARD;
+    return entries__.size();
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,83 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportHandleState.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+
+#include <utility>
+
+#ifdef HAL_THREAD_SAFE_STATICS
+#include <mutex>
+#endif
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // Only the first and the last handle of a native object take the
+    // lock, so one lock for all of them is enough.
+#ifdef HAL_THREAD_SAFE_STATICS
+    JSMutex& GetHandleMutex() {
+      static JSMutex mutex HAL_LOCK_NAME("JSExportHandleState");
+      return mutex;
+    }
+#define HAL_DETAIL_JSEXPORTHANDLESTATE_LOCK_GUARD std::lock_guard<JSMutex> lock(GetHandleMutex())
+#else
+#define HAL_DETAIL_JSEXPORTHANDLESTATE_LOCK_GUARD
+#endif
+
+  } // namespace {
+
+  JSExportHandleState::~JSExportHandleState() HAL_NOEXCEPT {
+    delete counts__;
+  }
+
+  void JSExportHandleState::Retain(JSContextRef js_context_ref, JSObjectRef js_object_ref) {
+    HAL_DETAIL_JSEXPORTHANDLESTATE_LOCK_GUARD;
+    if (!counts__) {
+      counts__ = new Counts();
+    }
+    counts__ -> count.fetch_add(1, std::memory_order_relaxed);
+
+    // A handle released to zero while this one was created leaves the
+    // JSObjectRef protected, in which case there is nothing to do.
+    if (!counts__ -> js_global_context_ref) {
+      const auto js_global_context_ref = JSContextGetGlobalContext(js_context_ref);
+      JSGlobalContextRetain(js_global_context_ref);
+      detail::ProtectJSValue(js_global_context_ref, js_object_ref);
+      counts__ -> js_global_context_ref = js_global_context_ref;
+      counts__ -> js_object_ref         = js_object_ref;
+    }
+  }
+
+  void JSExportHandleState::Release() HAL_NOEXCEPT {
+    if (counts__ -> count.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+
+    JSGlobalContextRef js_global_context_ref { nullptr };
+    JSObjectRef        js_object_ref         { nullptr };
+    {
+      HAL_DETAIL_JSEXPORTHANDLESTATE_LOCK_GUARD;
+      if (counts__ -> count.load(std::memory_order_relaxed) != 0) {
+        return;
+      }
+      std::swap(js_global_context_ref, counts__ -> js_global_context_ref);
+      std::swap(js_object_ref        , counts__ -> js_object_ref);
+    }
+
+    // Releasing the context may collect the JavaScript object and
+    // destroy this native object, so this must be the last thing
+    // done.
+    if (js_global_context_ref) {
+      detail::UnprotectJSValue(js_global_context_ref, js_object_ref);
+      JSGlobalContextRelease(js_global_context_ref);
+    }
+  }
+
+}} // namespace HAL { namespace detail {
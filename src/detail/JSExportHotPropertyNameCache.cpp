@@ -0,0 +1,98 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportHotPropertyNameCache.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace HAL { namespace detail {
+
+  const std::size_t JSExportHotPropertyNameCache::kCapacity;
+  const std::size_t JSExportHotPropertyNameCache::kMaxCandidates;
+
+  JSExportHotPropertyNameCache::JSExportHotPropertyNameCache(std::size_t threshold)
+  : threshold__(threshold) {
+  }
+
+  const JSString* JSExportHotPropertyNameCache::Find(JSStringRef property_name_ref) {
+    if (threshold__.load(std::memory_order_relaxed) == 0) {
+      return nullptr;
+    }
+
+    // set_threshold may have disabled the cache since.
+    HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_LOCK_GUARD;
+    const auto threshold = threshold__.load(std::memory_order_relaxed);
+    if (threshold == 0) {
+      return nullptr;
+    }
+
+    const auto characters = JSStringGetCharactersPtr(property_name_ref);
+    const auto length     = JSStringGetLength(property_name_ref);
+    for (std::size_t i = 0; i < size__; ++i) {
+      const auto& entry = entries__[i];
+      if (entry.js_string_ref == property_name_ref || (entry.length == length && std::equal(characters, characters + length, entry.characters))) {
+        return &names__[i];
+      }
+    }
+
+    if (size__ == kCapacity) {
+      return nullptr;
+    }
+
+    const auto hash = Hash(characters, length);
+    if (counts__.size() >= kMaxCandidates && counts__.find(hash) == counts__.end()) {
+      counts__.clear();
+    }
+
+    if (++counts__[hash] < threshold) {
+      return nullptr;
+    }
+    counts__.erase(hash);
+
+    // Intern the name with its UTF-8 form and hash computed, so the
+    // callbacks never convert it again.
+    auto& name = names__[size__];
+    name = JSString(property_name_ref);
+    static_cast<void>(static_cast<std::string>(name));
+    static_cast<void>(name.hash_value());
+
+    auto& entry = entries__[size__];
+    entry.js_string_ref = static_cast<JSStringRef>(name);
+    entry.characters    = JSStringGetCharactersPtr(entry.js_string_ref);
+    entry.length        = length;
+    return &names__[size__++];
+  }
+
+  void JSExportHotPropertyNameCache::set_threshold(std::size_t threshold) {
+    HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_LOCK_GUARD;
+    for (std::size_t i = 0; i < size__; ++i) {
+      entries__[i] = Entry();
+      names__[i]   = JSString();
+    }
+    size__ = 0;
+    counts__.clear();
+    threshold__.store(threshold, std::memory_order_relaxed);
+  }
+
+  std::size_t JSExportHotPropertyNameCache::size() const {
+    HAL_DETAIL_JSEXPORTHOTPROPERTYNAMECACHE_LOCK_GUARD;
+    return size__;
+  }
+
+  std::uint64_t JSExportHotPropertyNameCache::Hash(const JSChar* characters, std::size_t length) HAL_NOEXCEPT {
+    // 64 bit FNV-1a over the UTF-16 code units.
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < length; ++i) {
+      hash ^= static_cast<std::uint64_t>(characters[i]);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,80 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportNameTable.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace HAL { namespace detail {
+
+  const std::size_t JSExportNameTable::npos;
+
+  JSExportNameTable::JSExportNameTable(const std::vector<std::string>& names) {
+    std::size_t total_size = 0;
+    for (const auto& name : names) {
+      total_size += name.size();
+    }
+
+    // UTF-8 never takes more UTF-16 code units than it has bytes.
+    characters__.resize(total_size);
+    entries__.reserve(names.size());
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+      const auto length = TranscodeUTF8ToUTF16(names[i].data(), names[i].size(), characters__.data() + offset);
+      entries__.push_back(Entry { static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(length), static_cast<std::uint32_t>(i) });
+      offset += length;
+    }
+    characters__.resize(offset);
+
+    std::sort(entries__.begin(), entries__.end(), [this](const Entry& lhs, const Entry& rhs) {
+      return Compare(lhs, characters__.data() + rhs.offset, rhs.length) < 0;
+    });
+  }
+
+  std::size_t JSExportNameTable::Find(JSStringRef name_ref) const HAL_NOEXCEPT {
+    return Find(JSStringGetCharactersPtr(name_ref), JSStringGetLength(name_ref));
+  }
+
+  std::size_t JSExportNameTable::Find(const JSChar* name, std::size_t length) const HAL_NOEXCEPT {
+    std::size_t first = 0;
+    std::size_t last  = entries__.size();
+    while (first < last) {
+      const auto middle = first + (last - first) / 2;
+      const auto result = Compare(entries__[middle], name, length);
+      if (result == 0) {
+        return entries__[middle].index;
+      }
+
+      if (result < 0) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+
+    return npos;
+  }
+
+  int JSExportNameTable::Compare(const Entry& entry, const JSChar* name, std::size_t length) const HAL_NOEXCEPT {
+    // Ordering by length first settles most comparisons without
+    // touching the characters.
+    if (entry.length != length) {
+      return entry.length < length ? -1 : 1;
+    }
+
+    if (length == 0) {
+      return 0;
+    }
+
+    // Any consistent order works, so compare the code units as bytes.
+    return std::memcmp(characters__.data() + entry.offset, name, length * sizeof(JSChar));
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,96 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportNegativePropertyCache.hpp"
+
+#include <algorithm>
+
+namespace HAL { namespace detail {
+
+  JSExportNegativePropertyCache::JSExportNegativePropertyCache(std::size_t capacity)
+  : capacity__(capacity) {
+    ClearBloomFilter();
+  }
+
+  bool JSExportNegativePropertyCache::Contains(JSStringRef property_name_ref) const {
+    // Most probes are of a disabled cache or of a name that was never
+    // cached, and are answered before the lock. When a name is cached
+    // concurrently either answer is correct.
+    if (capacity__.load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+
+    const auto characters = JSStringGetCharactersPtr(property_name_ref);
+    const auto length     = JSStringGetLength(property_name_ref);
+    const auto hash       = Hash(characters, length);
+    if (!MayContain(hash)) {
+      return false;
+    }
+
+    HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD;
+    const auto range = names__.equal_range(hash);
+    return std::any_of(range.first, range.second, [characters, length](const std::pair<const std::uint64_t, std::u16string>& entry) {
+      return entry.second.size() == length && std::equal(entry.second.begin(), entry.second.end(), characters);
+    });
+  }
+
+  void JSExportNegativePropertyCache::Insert(JSStringRef property_name_ref) {
+    HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD;
+    const auto capacity = capacity__.load(std::memory_order_relaxed);
+    if (capacity == 0) {
+      return;
+    }
+
+    if (names__.size() >= capacity) {
+      ClearBloomFilter();
+      names__.clear();
+    }
+
+    const auto characters = JSStringGetCharactersPtr(property_name_ref);
+    const auto length     = JSStringGetLength(property_name_ref);
+    const auto hash       = Hash(characters, length);
+    bloom_filter__[(hash >> 6) & 15].fetch_or(std::uint64_t(1) << (hash & 63), std::memory_order_relaxed);
+    bloom_filter__[(hash >> 38) & 15].fetch_or(std::uint64_t(1) << ((hash >> 32) & 63), std::memory_order_relaxed);
+    names__.emplace(hash, std::u16string(characters, characters + length));
+  }
+
+  void JSExportNegativePropertyCache::Clear() {
+    HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD;
+    ClearBloomFilter();
+    names__.clear();
+  }
+
+  void JSExportNegativePropertyCache::set_capacity(std::size_t capacity) {
+    HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD;
+    ClearBloomFilter();
+    names__.clear();
+    capacity__.store(capacity, std::memory_order_relaxed);
+  }
+
+  std::size_t JSExportNegativePropertyCache::size() const {
+    HAL_DETAIL_JSEXPORTNEGATIVEPROPERTYCACHE_LOCK_GUARD;
+    return names__.size();
+  }
+
+  void JSExportNegativePropertyCache::ClearBloomFilter() HAL_NOEXCEPT {
+    for (auto& word : bloom_filter__) {
+      word.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  std::uint64_t JSExportNegativePropertyCache::Hash(const JSChar* characters, std::size_t length) HAL_NOEXCEPT {
+    // 64 bit FNV-1a over the UTF-16 code units.
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < length; ++i) {
+      hash ^= static_cast<std::uint64_t>(characters[i]);
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,139 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/JSExportAllocator.hpp"
+
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+// VS 2013's __declspec(thread) can't hold the free lists.
+#if !defined(_MSC_VER) || _MSC_VER > 1800
+#define HAL_DETAIL_JSEXPORTRECYCLER_ENABLE
+#endif
+
+namespace HAL { namespace detail {
+
+#ifdef HAL_DETAIL_JSEXPORTRECYCLER_ENABLE
+  namespace {
+
+    struct RecycledNativeObject final {
+      // The JSContext the native object was created in, which it keeps
+      // alive, so the address can't be reused by another JSContext.
+      JSContextRef js_context_ref;
+      void*        native_object_ptr;
+    };
+
+    typedef std::vector<RecycledNativeObject> RecycledNativeObjectList;
+
+    // Set once the thread's free lists are destroyed, after which
+    // nothing is recycled on the thread.
+    HAL_THREAD_LOCAL bool recycled_native_objects_destroyed = false;
+
+    struct RecycledNativeObjects final {
+      ~RecycledNativeObjects() HAL_NOEXCEPT {
+        recycled_native_objects_destroyed = true;
+        for (auto& entry : free_lists) {
+          for (const auto& recycled_native_object : entry.second) {
+            DestroyNativeObject(recycled_native_object.native_object_ptr);
+          }
+        }
+      }
+
+      std::unordered_map<const JSExportClassInfo*, RecycledNativeObjectList> free_lists;
+    };
+
+    thread_local RecycledNativeObjects recycled_native_objects;
+
+    RecycledNativeObjectList* FindFreeList(const JSExportClassInfo& class_info) HAL_NOEXCEPT {
+      if (recycled_native_objects_destroyed) {
+        return nullptr;
+      }
+
+      auto& free_lists = recycled_native_objects.free_lists;
+      const auto position = free_lists.find(&class_info);
+      return position == free_lists.end() ? nullptr : &position -> second;
+    }
+
+  } // namespace {
+#endif
+
+  bool RecycleNativeObject(const JSExportClassInfo& class_info, const JSContext& js_context, void* native_object_ptr, std::size_t capacity) HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSEXPORTRECYCLER_ENABLE
+    if (recycled_native_objects_destroyed || capacity == 0) {
+      return false;
+    }
+
+    try {
+      auto& free_list = recycled_native_objects.free_lists[&class_info];
+      if (free_list.size() >= capacity) {
+        return false;
+      }
+
+      if (free_list.capacity() < capacity) {
+        free_list.reserve(capacity);
+      }
+      free_list.push_back({ static_cast<JSContextRef>(js_context), native_object_ptr });
+      return true;
+    } catch (...) {
+      // Without memory for the free list, destroy the object instead.
+    }
+#endif
+    return false;
+  }
+
+  void* ReuseNativeObject(const JSExportClassInfo& class_info, const JSContext& js_context) HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSEXPORTRECYCLER_ENABLE
+    const auto free_list = FindFreeList(class_info);
+    if (!free_list) {
+      return nullptr;
+    }
+
+    // Free lists are short, and usually hold objects of one JSContext.
+    const auto js_context_ref = static_cast<JSContextRef>(js_context);
+    for (auto position = free_list -> rbegin(); position != free_list -> rend(); ++position) {
+      if (position -> js_context_ref == js_context_ref) {
+        const auto native_object_ptr = position -> native_object_ptr;
+        free_list -> erase(std::next(position).base());
+        return native_object_ptr;
+      }
+    }
+#endif
+    return nullptr;
+  }
+
+  std::size_t PurgeRecycledNativeObjects(const JSExportClassInfo& class_info) HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSEXPORTRECYCLER_ENABLE
+    const auto free_list = FindFreeList(class_info);
+    if (!free_list) {
+      return 0;
+    }
+
+    // A destructor may finalize other objects of the class, which are
+    // recycled onto the same free list, so take the list first.
+    RecycledNativeObjectList native_objects;
+    native_objects.swap(*free_list);
+    for (const auto& recycled_native_object : native_objects) {
+      DestroyNativeObject(recycled_native_object.native_object_ptr);
+    }
+    return native_objects.size();
+#else
+    return 0;
+#endif
+  }
+
+  std::size_t GetRecycledNativeObjectCount(const JSExportClassInfo& class_info) HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSEXPORTRECYCLER_ENABLE
+    const auto free_list = FindFreeList(class_info);
+    return free_list ? free_list -> size() : 0;
+#else
+    return 0;
+#endif
+  }
+
+}} // namespace HAL { namespace detail {
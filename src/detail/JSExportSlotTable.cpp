@@ -0,0 +1,162 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportSlotTable.hpp"
+#include "HAL/detail/JSUtil.hpp"
+#include "HAL/JSContext.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // The slots are allocated a chunk at a time and never move or go
+    // away, so that a lookup needs no lock.
+    const std::size_t kChunkSize  = 1024;
+    const std::size_t kChunkCount = 4096;
+
+    struct Slot {
+      std::atomic<std::uint32_t>      generation        { 1 };
+      std::atomic<void*>              native_object_ptr { nullptr };
+      std::atomic<JSGlobalContextRef> js_global_context_ref { nullptr };
+      std::atomic<JSObjectRef>        js_object_ref     { nullptr };
+      std::atomic<std::uint64_t>      weak_object_key   { 0 };
+      std::uint32_t                   next_free         { 0 };
+    };
+
+    struct SlotTable {
+      std::atomic<Slot*> chunks[kChunkCount];
+      JSMutex            mutex HAL_LOCK_NAME("JSExportSlotTable");
+      std::uint32_t      slot_count { 0 };
+
+      // One more than the index of the first free slot, or 0.
+      std::uint32_t      free_list  { 0 };
+
+      SlotTable() HAL_NOEXCEPT {
+        for (auto& chunk : chunks) {
+          chunk.store(nullptr, std::memory_order_relaxed);
+        }
+      }
+    };
+
+    SlotTable& GetSlotTable() {
+      static SlotTable slot_table;
+      return slot_table;
+    }
+
+    Slot* GetSlot(const SlotTable& slot_table, std::uint32_t index) HAL_NOEXCEPT {
+      const auto chunk = index / kChunkSize;
+      if (chunk >= kChunkCount) {
+        return nullptr;
+      }
+      const auto slots = slot_table.chunks[chunk].load(std::memory_order_acquire);
+      return slots ? &slots[index % kChunkSize] : nullptr;
+    }
+
+  } // namespace {
+
+  JSExportSlotReference AcquireJSExportSlot(const JSExportSlotValue& value) {
+    // Setting the weak reference runs JavaScript, which may finalize
+    // objects and so release slots, so it is done before locking.
+    std::uint64_t weak_object_key = 0;
+    if (value.js_global_context_ref && value.js_object_ref) {
+      weak_object_key = JSContext::NewWeakObjectKey();
+      JSContext(value.js_global_context_ref).set_weak_object(weak_object_key, value.js_object_ref);
+    }
+    
+    auto& slot_table = GetSlotTable();
+    std::lock_guard<JSMutex> lock(slot_table.mutex);
+
+    std::uint32_t index = 0;
+    if (slot_table.free_list != 0) {
+      index = slot_table.free_list - 1;
+      slot_table.free_list = GetSlot(slot_table, index) -> next_free;
+    } else {
+      if (slot_table.slot_count == kChunkSize * kChunkCount) {
+        ThrowRuntimeError("JSExportSlotTable", "Every weak handle slot is taken.");
+      }
+      index = slot_table.slot_count;
+      const auto chunk = index / kChunkSize;
+      if (index % kChunkSize == 0) {
+        slot_table.chunks[chunk].store(new Slot[kChunkSize], std::memory_order_release);
+      }
+      ++slot_table.slot_count;
+    }
+
+    // Release already bumped the generation, so no earlier reference
+    // matches the value stored here.
+    const auto slot = GetSlot(slot_table, index);
+    slot -> native_object_ptr.store(value.native_object_ptr, std::memory_order_relaxed);
+    slot -> js_global_context_ref.store(value.js_global_context_ref, std::memory_order_relaxed);
+    slot -> js_object_ref.store(value.js_object_ref, std::memory_order_relaxed);
+    slot -> weak_object_key.store(weak_object_key, std::memory_order_relaxed);
+
+    JSExportSlotReference reference;
+    reference.index      = index;
+    reference.generation = slot -> generation.load(std::memory_order_relaxed);
+    return reference;
+  }
+
+  void ReleaseJSExportSlot(JSExportSlotReference reference) HAL_NOEXCEPT {
+    auto& slot_table = GetSlotTable();
+    std::lock_guard<JSMutex> lock(slot_table.mutex);
+
+    const auto slot = GetSlot(slot_table, reference.index);
+    if (!slot || slot -> generation.load(std::memory_order_relaxed) != reference.generation) {
+      return;
+    }
+
+    // Every reference to this use of the slot stops matching here.
+    auto generation = reference.generation + 1;
+    if (generation == 0) {
+      generation = 1;
+    }
+    slot -> generation.store(generation, std::memory_order_release);
+    slot -> native_object_ptr.store(nullptr, std::memory_order_relaxed);
+    slot -> next_free    = slot_table.free_list;
+    slot_table.free_list = reference.index + 1;
+  }
+
+  bool FindJSExportSlot(JSExportSlotReference reference, JSExportSlotValue& value) HAL_NOEXCEPT {
+    if (reference.generation == 0) {
+      return false;
+    }
+
+    const auto slot = GetSlot(GetSlotTable(), reference.index);
+    if (!slot || slot -> generation.load(std::memory_order_acquire) != reference.generation) {
+      return false;
+    }
+
+    value.native_object_ptr     = slot -> native_object_ptr.load(std::memory_order_relaxed);
+    value.js_global_context_ref = slot -> js_global_context_ref.load(std::memory_order_relaxed);
+    value.js_object_ref         = slot -> js_object_ref.load(std::memory_order_relaxed);
+    value.weak_object_key       = slot -> weak_object_key.load(std::memory_order_relaxed);
+
+    // Released and reused while reading, in which case the value may
+    // be of the next use.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot -> generation.load(std::memory_order_relaxed) == reference.generation && value.native_object_ptr;
+  }
+
+  bool LockJSExportSlot(JSExportSlotReference reference, JSExportSlotValue& value) {
+    if (!FindJSExportSlot(reference, value)) {
+      return false;
+    }
+    
+    // The finalizer releasing the slot runs when the object is swept,
+    // while the weak reference is cleared as soon as it is collected.
+    if (value.weak_object_key != 0 && !JSContext(value.js_global_context_ref).get_weak_object(value.weak_object_key)) {
+      return false;
+    }
+    return true;
+  }
+
+}} // namespace HAL { namespace detail {
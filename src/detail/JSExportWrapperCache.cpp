@@ -0,0 +1,134 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSExportWrapperCache.hpp"
+
+#include "HAL/JSContext.hpp"
+
+#include <mutex>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // A JSGlobalContextRef may be reused once its last wrapper is
+    // finalized, by which time its entry has expired.
+    std::unordered_map<JSGlobalContextRef, std::weak_ptr<JSExportWrapperCache>>& GetRegistry() {
+      static std::unordered_map<JSGlobalContextRef, std::weak_ptr<JSExportWrapperCache>> registry;
+      return registry;
+    }
+
+#ifdef HAL_THREAD_SAFE_STATICS
+    JSMutex& GetRegistryMutex() {
+      static JSMutex mutex HAL_LOCK_NAME("JSExportWrapperCache registry");
+      return mutex;
+    }
+#define HAL_DETAIL_JSEXPORTWRAPPERCACHE_REGISTRY_LOCK_GUARD std::lock_guard<JSMutex> lock(GetRegistryMutex())
+#else
+#define HAL_DETAIL_JSEXPORTWRAPPERCACHE_REGISTRY_LOCK_GUARD
+#endif
+
+  } // namespace {
+
+  std::shared_ptr<JSExportWrapperCache> JSExportWrapperCache::Get(JSGlobalContextRef js_global_context_ref) {
+    HAL_DETAIL_JSEXPORTWRAPPERCACHE_REGISTRY_LOCK_GUARD;
+    auto& registry = GetRegistry();
+    auto cache = registry[js_global_context_ref].lock();
+    if (!cache) {
+      // Drop the entries of contexts without wrappers before adding
+      // one.
+      for (auto position = registry.begin(); position != registry.end();) {
+        if (position -> second.expired() && position -> first != js_global_context_ref) {
+          position = registry.erase(position);
+        } else {
+          ++position;
+        }
+      }
+      cache = std::make_shared<JSExportWrapperCache>();
+      registry[js_global_context_ref] = cache;
+    }
+    return cache;
+  }
+
+  JSExportWrapperCache& JSExportWrapperCache::Get(const JSContext& js_context) {
+    // The slot only holds the cache while a JSContext of it lives, and
+    // its wrappers may outlive them, so the registry still decides
+    // which cache a context gets. Nothing else sets the slot, so the
+    // cache lives as long as js_context.
+    static const auto index = JSContext::AllocateSlot();
+    return *js_context.GetOrCreateSlot<JSExportWrapperCache>(index, [&js_context] {
+      return Get(JSContextGetGlobalContext(static_cast<JSContextRef>(js_context)));
+    });
+  }
+
+  JSObjectRef JSExportWrapperCache::Find(const JSContext& js_context, const JSExportClassInfo* class_info, const void* native_ptr) {
+    const Key key(class_info, native_ptr);
+    std::uint64_t token { 0 };
+    {
+      HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD;
+      const auto position = wrappers__.find(key);
+      if (position == wrappers__.end()) {
+        return nullptr;
+      }
+      token = position -> second;
+    }
+
+    // The weak reference is called without the lock, since it runs
+    // JavaScript, which may finalize wrappers.
+    if (const auto js_object_ref = js_context.get_weak_object(token)) {
+      return js_object_ref;
+    }
+
+    // The wrapper is dead but not yet finalized, so its entry is
+    // dropped here and its finalizer's Erase finds nothing.
+    HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD;
+    const auto position = wrappers__.find(key);
+    if (position != wrappers__.end() && position -> second == token) {
+      wrappers__.erase(position);
+    }
+    return nullptr;
+  }
+
+  std::uint64_t JSExportWrapperCache::Insert(const JSContext& js_context, const JSExportClassInfo* class_info, const void* native_ptr, JSObjectRef js_object_ref) {
+    // The weak reference is set before the entry, and without the
+    // lock, so that Find never sees a token without one.
+    const auto token = JSContext::NewWeakObjectKey();
+    js_context.set_weak_object(token, js_object_ref);
+    
+    HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD;
+    wrappers__[Key(class_info, native_ptr)] = token;
+    return token;
+  }
+
+  void JSExportWrapperCache::Erase(const JSExportClassInfo* class_info, const void* native_ptr, std::uint64_t token) HAL_NOEXCEPT {
+    HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD;
+    const auto position = wrappers__.find(Key(class_info, native_ptr));
+    if (position != wrappers__.end() && position -> second == token) {
+      wrappers__.erase(position);
+    }
+  }
+
+  std::size_t JSExportWrapperCache::size() const {
+    HAL_DETAIL_JSEXPORTWRAPPERCACHE_LOCK_GUARD;
+    return wrappers__.size();
+  }
+
+  void JSExportWrapperEntry::Set(const JSContext& js_context, const std::shared_ptr<JSExportWrapperCache>& cache, const JSExportClassInfo* class_info, const void* native_ptr, JSObjectRef js_object_ref) {
+    Clear();
+    const auto token = cache -> Insert(js_context, class_info, native_ptr, js_object_ref);
+    state__.reset(new State { cache, class_info, native_ptr, token });
+  }
+
+  void JSExportWrapperEntry::Clear() HAL_NOEXCEPT {
+    if (state__) {
+      state__ -> cache -> Erase(state__ -> class_info, state__ -> native_ptr, state__ -> token);
+      state__.reset();
+    }
+  }
+
+}} // namespace HAL { namespace detail {
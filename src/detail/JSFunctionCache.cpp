@@ -0,0 +1,118 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSFunctionCache.hpp"
+#include "HAL/JSMemoryPressure.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+
+#include <functional>
+#include <mutex>
+
+namespace HAL { namespace detail {
+
+  bool JSFunctionCache::Key::operator==(const Key& rhs) const {
+    return starting_line_number == rhs.starting_line_number
+        && function_name        == rhs.function_name
+        && source_url           == rhs.source_url
+        && parameter_names      == rhs.parameter_names
+        && body                 == rhs.body;
+  }
+
+  std::size_t JSFunctionCache::KeyHash::operator()(const Key& key) const {
+    const std::hash<JSString> hash;
+    auto result = hash(key.body);
+    for (const auto& parameter_name : key.parameter_names) {
+      result = result * 31 + hash(parameter_name);
+    }
+    result = result * 31 + hash(key.function_name);
+    result = result * 31 + hash(key.source_url);
+    return result * 31 + static_cast<std::size_t>(key.starting_line_number);
+  }
+
+  JSFunctionCache::JSFunctionCache(JSContextRef js_context_ref) HAL_NOEXCEPT
+  : js_context_ref__(js_context_ref) {
+  }
+
+  JSFunctionCache::~JSFunctionCache() HAL_NOEXCEPT {
+    Clear();
+  }
+
+  JSObjectRef JSFunctionCache::Find(const Key& key) {
+    HAL_JSFUNCTIONCACHE_LOCK_GUARD;
+    const auto position = index__.find(key);
+    if (position == index__.end()) {
+      return nullptr;
+    }
+
+    entries__.splice(entries__.begin(), entries__, position -> second);
+    return position -> second -> second;
+  }
+
+  void JSFunctionCache::Insert(Key key, JSObjectRef js_object_ref) {
+    HAL_JSFUNCTIONCACHE_LOCK_GUARD;
+    if (capacity__ == 0 || index__.find(key) != index__.end()) {
+      return;
+    }
+
+    EvictTo(capacity__ - 1);
+    detail::ProtectJSValue(js_context_ref__, js_object_ref);
+    entries__.emplace_front(key, js_object_ref);
+    index__.emplace(std::move(key), entries__.begin());
+  }
+
+  void JSFunctionCache::Clear() HAL_NOEXCEPT {
+    HAL_JSFUNCTIONCACHE_LOCK_GUARD;
+    EvictTo(0);
+  }
+
+  std::size_t JSFunctionCache::GetSize(const Key& key) HAL_NOEXCEPT {
+    // The UTF-16 strings, a list node and a hash map node.
+    auto result = (key.body.length() + key.function_name.length() + key.source_url.length()) * sizeof(char16_t);
+    for (const auto& parameter_name : key.parameter_names) {
+      result += parameter_name.length() * sizeof(char16_t);
+    }
+    return result + key.parameter_names.size() * sizeof(JSString) + sizeof(std::pair<Key, JSObjectRef>) + sizeof(std::pair<Key, EntryList::iterator>) + 4 * sizeof(void*);
+  }
+
+  std::size_t JSFunctionCache::Evict(double fraction) HAL_NOEXCEPT {
+    HAL_JSFUNCTIONCACHE_LOCK_GUARD;
+    const auto count = JSMemoryPressure::GetEvictionCount(entries__.size(), fraction);
+    std::size_t result = 0;
+    auto position = entries__.end();
+    for (std::size_t i = 0; i < count; ++i) {
+      result += GetSize((--position) -> first);
+    }
+    EvictTo(entries__.size() - count);
+    return result;
+  }
+
+  void JSFunctionCache::set_capacity(std::size_t capacity) HAL_NOEXCEPT {
+    HAL_JSFUNCTIONCACHE_LOCK_GUARD;
+    capacity__ = capacity;
+    EvictTo(capacity);
+  }
+
+  std::size_t JSFunctionCache::get_capacity() const HAL_NOEXCEPT {
+    HAL_JSFUNCTIONCACHE_LOCK_GUARD;
+    return capacity__;
+  }
+
+  std::size_t JSFunctionCache::size() const HAL_NOEXCEPT {
+    HAL_JSFUNCTIONCACHE_LOCK_GUARD;
+    return entries__.size();
+  }
+
+  void JSFunctionCache::EvictTo(std::size_t size) HAL_NOEXCEPT {
+    while (entries__.size() > size) {
+      detail::UnprotectJSValue(js_context_ref__, entries__.back().second);
+      index__.erase(entries__.back().first);
+      entries__.pop_back();
+    }
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,243 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSIOPoller.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#else
+#error "JSIOPoller has no backend for this platform"
+#endif
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // The most events one Wait takes from the kernel. More ready
+    // handles are returned by the next Wait.
+    const int kMaxEventCount = 64;
+
+  } // namespace {
+
+#if defined(_WIN32)
+  JSIOPoller::JSIOPoller()
+  : completion_port__(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1)) {
+    if (!completion_port__) {
+      ThrowRuntimeError("JSIOPoller", "Unable to create an I/O completion port");
+    }
+  }
+
+  JSIOPoller::~JSIOPoller() HAL_NOEXCEPT {
+    CloseHandle(completion_port__);
+  }
+
+  void JSIOPoller::Add(JSIOHandle handle, std::uint32_t, std::uint64_t key) {
+    if (!CreateIoCompletionPort(handle, completion_port__, static_cast<ULONG_PTR>(key), 0)) {
+      ThrowRuntimeError("JSIOPoller", "Unable to associate the handle with the I/O completion port");
+    }
+  }
+
+  void JSIOPoller::Remove(JSIOHandle, std::uint32_t) HAL_NOEXCEPT {
+  }
+
+  void JSIOPoller::Wait(int timeout, std::vector<Event>& events) {
+    OVERLAPPED_ENTRY entries[kMaxEventCount];
+    ULONG entry_count = 0;
+    if (!GetQueuedCompletionStatusEx(completion_port__, entries, kMaxEventCount, &entry_count, timeout < 0 ? INFINITE : static_cast<DWORD>(timeout), FALSE)) {
+      // WAIT_TIMEOUT, or a wakeup by an alertable wait.
+      return;
+    }
+
+    for (ULONG i = 0; i < entry_count; ++i) {
+      // Wake posts key zero.
+      if (entries[i].lpCompletionKey == 0) {
+        continue;
+      }
+
+      Event event;
+      event.key                          = static_cast<std::uint64_t>(entries[i].lpCompletionKey);
+      event.io_event.events              = entries[i].Internal == 0 ? kJSIOReadable : kJSIOError;
+      event.io_event.bytes_transferred   = entries[i].dwNumberOfBytesTransferred;
+      event.io_event.overlapped          = entries[i].lpOverlapped;
+      events.push_back(event);
+    }
+  }
+
+  void JSIOPoller::Wake() HAL_NOEXCEPT {
+    PostQueuedCompletionStatus(completion_port__, 0, 0, nullptr);
+  }
+#elif defined(__linux__)
+  JSIOPoller::JSIOPoller()
+  : poller_descriptor__(epoll_create1(EPOLL_CLOEXEC))
+  , wake_descriptor__(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    epoll_event wake_event {};
+    wake_event.events   = EPOLLIN;
+    wake_event.data.u64 = 0;
+    if (poller_descriptor__ < 0 || wake_descriptor__ < 0 || epoll_ctl(poller_descriptor__, EPOLL_CTL_ADD, wake_descriptor__, &wake_event) != 0) {
+      if (wake_descriptor__ >= 0) {
+        close(wake_descriptor__);
+      }
+      if (poller_descriptor__ >= 0) {
+        close(poller_descriptor__);
+      }
+      ThrowRuntimeError("JSIOPoller", "Unable to create an epoll instance");
+    }
+  }
+
+  JSIOPoller::~JSIOPoller() HAL_NOEXCEPT {
+    close(wake_descriptor__);
+    close(poller_descriptor__);
+  }
+
+  void JSIOPoller::Add(JSIOHandle handle, std::uint32_t events, std::uint64_t key) {
+    epoll_event event {};
+    if (events & kJSIOReadable) {
+      event.events |= EPOLLIN;
+    }
+    if (events & kJSIOWritable) {
+      event.events |= EPOLLOUT;
+    }
+    event.data.u64 = key;
+    if (epoll_ctl(poller_descriptor__, EPOLL_CTL_ADD, handle, &event) != 0) {
+      ThrowRuntimeError("JSIOPoller", "Unable to watch descriptor " + std::to_string(handle));
+    }
+  }
+
+  void JSIOPoller::Remove(JSIOHandle handle, std::uint32_t) HAL_NOEXCEPT {
+    epoll_event event {};
+    epoll_ctl(poller_descriptor__, EPOLL_CTL_DEL, handle, &event);
+  }
+
+  void JSIOPoller::Wait(int timeout, std::vector<Event>& events) {
+    epoll_event ready_events[kMaxEventCount];
+    const auto ready_count = epoll_wait(poller_descriptor__, ready_events, kMaxEventCount, timeout);
+    for (int i = 0; i < ready_count; ++i) {
+      if (ready_events[i].data.u64 == 0) {
+        std::uint64_t wake_count;
+        while (read(wake_descriptor__, &wake_count, sizeof(wake_count)) > 0) {
+        }
+        continue;
+      }
+
+      const auto flags = ready_events[i].events;
+      Event event;
+      event.key                        = ready_events[i].data.u64;
+      event.io_event.events            = 0;
+      if (flags & (EPOLLIN | EPOLLHUP)) {
+        event.io_event.events |= kJSIOReadable;
+      }
+      if (flags & EPOLLOUT) {
+        event.io_event.events |= kJSIOWritable;
+      }
+      if (flags & (EPOLLERR | EPOLLHUP)) {
+        event.io_event.events |= kJSIOError;
+      }
+      event.io_event.bytes_transferred = 0;
+      event.io_event.overlapped        = nullptr;
+      events.push_back(event);
+    }
+  }
+
+  void JSIOPoller::Wake() HAL_NOEXCEPT {
+    const std::uint64_t wake_count = 1;
+    const auto result = write(wake_descriptor__, &wake_count, sizeof(wake_count));
+    static_cast<void>(result);
+  }
+#else
+  JSIOPoller::JSIOPoller()
+  : poller_descriptor__(kqueue()) {
+    struct kevent wake_event;
+    EV_SET(&wake_event, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+    if (poller_descriptor__ < 0 || kevent(poller_descriptor__, &wake_event, 1, nullptr, 0, nullptr) != 0) {
+      if (poller_descriptor__ >= 0) {
+        close(poller_descriptor__);
+      }
+      ThrowRuntimeError("JSIOPoller", "Unable to create a kqueue");
+    }
+  }
+
+  JSIOPoller::~JSIOPoller() HAL_NOEXCEPT {
+    close(poller_descriptor__);
+  }
+
+  void JSIOPoller::Add(JSIOHandle handle, std::uint32_t events, std::uint64_t key) {
+    struct kevent changes[2];
+    int change_count = 0;
+    const auto udata = reinterpret_cast<void*>(static_cast<std::uintptr_t>(key));
+    if (events & kJSIOReadable) {
+      EV_SET(&changes[change_count++], handle, EVFILT_READ, EV_ADD, 0, 0, udata);
+    }
+    if (events & kJSIOWritable) {
+      EV_SET(&changes[change_count++], handle, EVFILT_WRITE, EV_ADD, 0, 0, udata);
+    }
+    if (kevent(poller_descriptor__, changes, change_count, nullptr, 0, nullptr) != 0) {
+      ThrowRuntimeError("JSIOPoller", "Unable to watch descriptor " + std::to_string(handle));
+    }
+  }
+
+  void JSIOPoller::Remove(JSIOHandle handle, std::uint32_t events) HAL_NOEXCEPT {
+    struct kevent changes[2];
+    int change_count = 0;
+    if (events & kJSIOReadable) {
+      EV_SET(&changes[change_count++], handle, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    }
+    if (events & kJSIOWritable) {
+      EV_SET(&changes[change_count++], handle, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    }
+    kevent(poller_descriptor__, changes, change_count, nullptr, 0, nullptr);
+  }
+
+  void JSIOPoller::Wait(int timeout, std::vector<Event>& events) {
+    struct kevent ready_events[kMaxEventCount];
+    struct timespec timeout_spec;
+    timeout_spec.tv_sec  = timeout / 1000;
+    timeout_spec.tv_nsec = (timeout % 1000) * 1000000L;
+    const auto ready_count = kevent(poller_descriptor__, nullptr, 0, ready_events, kMaxEventCount, timeout < 0 ? nullptr : &timeout_spec);
+    for (int i = 0; i < ready_count; ++i) {
+      if (ready_events[i].filter == EVFILT_USER) {
+        continue;
+      }
+
+      Event event;
+      event.key                        = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(ready_events[i].udata));
+      event.io_event.events            = 0;
+      if (ready_events[i].filter == EVFILT_READ) {
+        event.io_event.events |= kJSIOReadable;
+      }
+      if (ready_events[i].filter == EVFILT_WRITE) {
+        event.io_event.events |= kJSIOWritable;
+      }
+      if (ready_events[i].flags & (EV_EOF | EV_ERROR)) {
+        event.io_event.events |= kJSIOError;
+      }
+      event.io_event.bytes_transferred = 0;
+      event.io_event.overlapped        = nullptr;
+      events.push_back(event);
+    }
+  }
+
+  void JSIOPoller::Wake() HAL_NOEXCEPT {
+    struct kevent wake_event;
+    EV_SET(&wake_event, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+    kevent(poller_descriptor__, &wake_event, 1, nullptr, 0, nullptr);
+  }
+#endif
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,434 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSJSONStreamParser.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    typedef JSJSONStreamParser::Step Step;
+
+    bool IsIdentifierCharacter(char character) HAL_NOEXCEPT {
+      return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9') || character == '_' || character == '$';
+    }
+
+    template<typename C>
+    int HexValue(C character) HAL_NOEXCEPT {
+      if (character >= '0' && character <= '9') {
+        return static_cast<int>(character - '0');
+      }
+      if (character >= 'a' && character <= 'f') {
+        return static_cast<int>(character - 'a' + 10);
+      }
+      if (character >= 'A' && character <= 'F') {
+        return static_cast<int>(character - 'A' + 10);
+      }
+      return -1;
+    }
+
+    void AppendUTF8(std::string& string, std::uint32_t code_point) {
+      if (code_point < 0x80) {
+        string.push_back(static_cast<char>(code_point));
+      } else if (code_point < 0x800) {
+        string.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        string.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+      } else if (code_point < 0x10000) {
+        string.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        string.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        string.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+      } else {
+        string.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        string.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        string.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        string.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+      }
+    }
+
+    bool IsHighSurrogate(std::uint32_t code_unit) HAL_NOEXCEPT {
+      return code_unit >= 0xD800 && code_unit <= 0xDBFF;
+    }
+
+    bool IsLowSurrogate(std::uint32_t code_unit) HAL_NOEXCEPT {
+      return code_unit >= 0xDC00 && code_unit <= 0xDFFF;
+    }
+
+    // Append an unescaped code unit of a JSON string. UTF-8 is copied
+    // byte for byte, and UTF-16 transcoded, with lone surrogates
+    // replaced by U+FFFD.
+    void AppendRaw(const char* input, std::size_t, std::size_t& offset, std::string& string) {
+      string.push_back(input[offset++]);
+    }
+
+    void AppendRaw(const JSChar* input, std::size_t length, std::size_t& offset, std::string& string) {
+      std::uint32_t code_point = input[offset++];
+      if (IsHighSurrogate(code_point) && offset < length && IsLowSurrogate(input[offset])) {
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (input[offset++] - 0xDC00);
+      } else if (IsHighSurrogate(code_point) || IsLowSurrogate(code_point)) {
+        code_point = 0xFFFD;
+      }
+      AppendUTF8(string, code_point);
+    }
+
+    std::vector<Step> CompileSelector(const std::string& selector) {
+      const std::string message = "Invalid JSON selector " + selector;
+      if (selector.empty() || selector[0] != '$') {
+        ThrowInvalidArgument("JSJSONStreamParser", message);
+      }
+
+      std::vector<Step> steps;
+      const auto  length = selector.size();
+      std::size_t offset = 1;
+      while (offset < length) {
+        Step step = { Step::Kind::Name, std::string(), 0 };
+        if (selector[offset] == '.') {
+          ++offset;
+          if (offset < length && selector[offset] == '*') {
+            step.kind = Step::Kind::Wildcard;
+            ++offset;
+          } else {
+            const auto begin = offset;
+            while (offset < length && selector[offset] != '.' && selector[offset] != '[') {
+              ++offset;
+            }
+            if (offset == begin) {
+              ThrowInvalidArgument("JSJSONStreamParser", message);
+            }
+            step.name = selector.substr(begin, offset - begin);
+          }
+        } else if (selector[offset] == '[') {
+          ++offset;
+          if (offset < length && selector[offset] == '*') {
+            step.kind = Step::Kind::Wildcard;
+            ++offset;
+          } else if (offset < length && (selector[offset] == '\'' || selector[offset] == '"')) {
+            const auto quote = selector[offset++];
+            while (offset < length && selector[offset] != quote) {
+              if (selector[offset] == '\\' && offset + 1 < length) {
+                ++offset;
+              }
+              step.name.push_back(selector[offset++]);
+            }
+            if (offset++ >= length) {
+              ThrowInvalidArgument("JSJSONStreamParser", message);
+            }
+          } else {
+            // Indexes past 2^32 can't be array indexes, so longer
+            // numbers are rejected rather than overflowing.
+            const auto begin = offset;
+            while (offset < length && selector[offset] >= '0' && selector[offset] <= '9' && offset - begin < 10) {
+              step.index = step.index * 10 + static_cast<std::size_t>(selector[offset++] - '0');
+            }
+            if (offset == begin) {
+              ThrowInvalidArgument("JSJSONStreamParser", message);
+            }
+            step.kind = Step::Kind::Index;
+          }
+          if (offset >= length || selector[offset] != ']') {
+            ThrowInvalidArgument("JSJSONStreamParser", message);
+          }
+          ++offset;
+        } else {
+          ThrowInvalidArgument("JSJSONStreamParser", message);
+        }
+        steps.push_back(step);
+      }
+
+      return steps;
+    }
+
+    // Values are parsed recursively only along the selectors, so the
+    // depth of the recursion is bounded by the longest selector.
+    // Everything else is skipped by ScanJSONValue, which keeps its own
+    // stack.
+    template<typename C>
+    class StreamParser final {
+
+    public:
+
+      StreamParser(const std::vector<std::vector<Step>>& selectors, const C* input, std::size_t length, const JSJSONStreamParser::Callback& callback)
+      : selectors__(selectors)
+      , input__(input)
+      , length__(length)
+      , callback__(callback)
+      , path__("$") {
+        std::size_t max_depth = 0;
+        for (const auto& selector : selectors__) {
+          max_depth = std::max(max_depth, selector.size());
+        }
+        selected__.resize(max_depth + 1);
+        keys__.resize(max_depth + 1);
+      }
+
+      std::size_t Parse() {
+        std::vector<std::size_t> selected(selectors__.size());
+        for (std::size_t i = 0; i < selected.size(); ++i) {
+          selected[i] = i;
+        }
+
+        SkipWhitespace();
+        if (!ParseValue(0, selected)) {
+          return std::min(offset__, length__);
+        }
+
+        SkipWhitespace();
+        return offset__ == length__ ? std::string::npos : offset__;
+      }
+
+    private:
+
+      void SkipWhitespace() HAL_NOEXCEPT {
+        while (offset__ < length__ && (input__[offset__] == ' ' || input__[offset__] == '\t' || input__[offset__] == '\n' || input__[offset__] == '\r')) {
+          ++offset__;
+        }
+      }
+
+      bool Expect(char character) HAL_NOEXCEPT {
+        SkipWhitespace();
+        if (offset__ >= length__ || input__[offset__] != character) {
+          return false;
+        }
+        ++offset__;
+        SkipWhitespace();
+        return true;
+      }
+
+      // selected holds the selectors whose first depth steps match
+      // path__.
+      bool ParseValue(std::size_t depth, const std::vector<std::size_t>& selected) {
+        if (std::any_of(selected.begin(), selected.end(), [this, depth](std::size_t selector) { return selectors__[selector].size() == depth; })) {
+          const auto begin = offset__;
+          if (!ScanJSONValue(input__, length__, offset__)) {
+            return false;
+          }
+          callback__(path__, begin, offset__);
+          return true;
+        }
+
+        if (offset__ < length__ && input__[offset__] == '{') {
+          return ParseObject(depth, selected);
+        }
+        if (offset__ < length__ && input__[offset__] == '[') {
+          return ParseArray(depth, selected);
+        }
+        return ScanJSONValue(input__, length__, offset__);
+      }
+
+      bool ParseChild(std::size_t depth, const std::vector<std::size_t>& child_selected, std::size_t path_length) {
+        const bool result = child_selected.empty() ? ScanJSONValue(input__, length__, offset__) : ParseValue(depth + 1, child_selected);
+        path__.resize(path_length);
+        return result;
+      }
+
+      bool ParseObject(std::size_t depth, const std::vector<std::size_t>& selected) {
+        if (!Expect('{')) {
+          return false;
+        }
+        if (offset__ < length__ && input__[offset__] == '}') {
+          ++offset__;
+          return true;
+        }
+
+        auto& child_selected = selected__[depth];
+        auto& key            = keys__[depth];
+        while (true) {
+          if (offset__ >= length__ || input__[offset__] != '"' || !DecodeString(key) || !Expect(':')) {
+            return false;
+          }
+
+          child_selected.clear();
+          for (const auto selector : selected) {
+            const auto& step = selectors__[selector][depth];
+            if (step.kind == Step::Kind::Wildcard || (step.kind == Step::Kind::Name && step.name == key)) {
+              child_selected.push_back(selector);
+            }
+          }
+
+          const auto path_length = path__.size();
+          if (!child_selected.empty()) {
+            AppendName(key);
+          }
+          if (!ParseChild(depth, child_selected, path_length)) {
+            return false;
+          }
+
+          SkipWhitespace();
+          if (offset__ < length__ && input__[offset__] == '}') {
+            ++offset__;
+            return true;
+          }
+          if (!Expect(',')) {
+            return false;
+          }
+        }
+      }
+
+      bool ParseArray(std::size_t depth, const std::vector<std::size_t>& selected) {
+        if (!Expect('[')) {
+          return false;
+        }
+        if (offset__ < length__ && input__[offset__] == ']') {
+          ++offset__;
+          return true;
+        }
+
+        auto& child_selected = selected__[depth];
+        for (std::size_t index = 0; ; ++index) {
+          child_selected.clear();
+          for (const auto selector : selected) {
+            const auto& step = selectors__[selector][depth];
+            if (step.kind == Step::Kind::Wildcard || (step.kind == Step::Kind::Index && step.index == index)) {
+              child_selected.push_back(selector);
+            }
+          }
+
+          const auto path_length = path__.size();
+          if (!child_selected.empty()) {
+            path__ += "[" + std::to_string(index) + "]";
+          }
+          if (!ParseChild(depth, child_selected, path_length)) {
+            return false;
+          }
+
+          SkipWhitespace();
+          if (offset__ < length__ && input__[offset__] == ']') {
+            ++offset__;
+            return true;
+          }
+          if (!Expect(',')) {
+            return false;
+          }
+        }
+      }
+
+      void AppendName(const std::string& name) {
+        if (!name.empty() && !(name[0] >= '0' && name[0] <= '9') && std::all_of(name.begin(), name.end(), IsIdentifierCharacter)) {
+          path__ += "." + name;
+          return;
+        }
+
+        path__ += "['";
+        for (const auto character : name) {
+          if (character == '\'' || character == '\\') {
+            path__.push_back('\\');
+          }
+          path__.push_back(character);
+        }
+        path__ += "']";
+      }
+
+      // Decode the JSON string at offset__ into UTF-8.
+      bool DecodeString(std::string& string) {
+        string.clear();
+        ++offset__;
+        while (offset__ < length__) {
+          const auto character = input__[offset__];
+          if (character == '"') {
+            ++offset__;
+            return true;
+          }
+
+          if (static_cast<std::uint32_t>(character) < 0x20) {
+            return false;
+          }
+
+          if (character != '\\') {
+            AppendRaw(input__, length__, offset__, string);
+            continue;
+          }
+
+          if (++offset__ >= length__) {
+            return false;
+          }
+
+          switch (input__[offset__++]) {
+            case '"':  string.push_back('"');  break;
+            case '\\': string.push_back('\\'); break;
+            case '/':  string.push_back('/');  break;
+            case 'b':  string.push_back('\b'); break;
+            case 'f':  string.push_back('\f'); break;
+            case 'n':  string.push_back('\n'); break;
+            case 'r':  string.push_back('\r'); break;
+            case 't':  string.push_back('\t'); break;
+            case 'u': {
+              std::uint32_t code_point = 0;
+              if (!DecodeHex(code_point)) {
+                return false;
+              }
+
+              // A surrogate pair is written as two escapes.
+              std::uint32_t low_surrogate = 0;
+              const auto    saved_offset  = offset__;
+              if (IsHighSurrogate(code_point) && offset__ + 1 < length__ && input__[offset__] == '\\' && input__[offset__ + 1] == 'u') {
+                offset__ += 2;
+                if (DecodeHex(low_surrogate) && IsLowSurrogate(low_surrogate)) {
+                  code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low_surrogate - 0xDC00);
+                } else {
+                  offset__ = saved_offset;
+                }
+              }
+
+              AppendUTF8(string, IsHighSurrogate(code_point) || IsLowSurrogate(code_point) ? 0xFFFD : code_point);
+              break;
+            }
+            default:
+              --offset__;
+              return false;
+          }
+        }
+
+        return false;
+      }
+
+      bool DecodeHex(std::uint32_t& code_unit) {
+        code_unit = 0;
+        for (int i = 0; i < 4; ++i, ++offset__) {
+          const auto value = offset__ < length__ ? HexValue(input__[offset__]) : -1;
+          if (value < 0) {
+            return false;
+          }
+          code_unit = (code_unit << 4) | static_cast<std::uint32_t>(value);
+        }
+        return true;
+      }
+
+      const std::vector<std::vector<Step>>& selectors__;
+      const C*                              input__;
+      const std::size_t                     length__;
+      const JSJSONStreamParser::Callback&   callback__;
+      std::size_t                           offset__ { 0 };
+      std::string                           path__;
+
+      // Scratch space for each depth, so that parsing a container
+      // doesn't allocate once per member.
+      std::vector<std::vector<std::size_t>> selected__;
+      std::vector<std::string>              keys__;
+    };
+
+  } // namespace {
+
+  JSJSONStreamParser::JSJSONStreamParser(const std::vector<std::string>& selectors) {
+    selectors__.reserve(selectors.size());
+    for (const auto& selector : selectors) {
+      selectors__.push_back(CompileSelector(selector));
+    }
+  }
+
+  std::size_t JSJSONStreamParser::Parse(const char* input, std::size_t length, const Callback& callback) const {
+    return StreamParser<char>(selectors__, input, length, callback).Parse();
+  }
+
+  std::size_t JSJSONStreamParser::Parse(const JSChar* input, std::size_t length, const Callback& callback) const {
+    return StreamParser<JSChar>(selectors__, input, length, callback).Parse();
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,66 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSBase.hpp"
+
+#ifdef HAL_LOCK_STATISTICS_ENABLE
+#include <cstring>
+#include <list>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // The registry's own lock isn't counted, and std::list never
+    // moves its elements, so references handed out stay valid.
+    struct LockStatisticsRegistry final {
+      std::mutex                  mutex;
+      std::list<JSLockStatistics> statistics;
+    };
+
+    LockStatisticsRegistry& GetLockStatisticsRegistry() {
+      static LockStatisticsRegistry registry;
+      return registry;
+    }
+
+  } // namespace {
+
+  JSLockStatistics& RegisterJSLockStatistics(const char* name) {
+    auto& registry = GetLockStatisticsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto& statistics : registry.statistics) {
+      if (std::strcmp(statistics.name, name) == 0) {
+        return statistics;
+      }
+    }
+    registry.statistics.emplace_back(name);
+    return registry.statistics.back();
+  }
+
+  std::vector<const JSLockStatistics*> GetJSLockStatistics() {
+    auto& registry = GetLockStatisticsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::vector<const JSLockStatistics*> result;
+    for (const auto& statistics : registry.statistics) {
+      result.push_back(&statistics);
+    }
+    return result;
+  }
+
+  void ResetJSLockStatistics() HAL_NOEXCEPT {
+    auto& registry = GetLockStatisticsRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto& statistics : registry.statistics) {
+      statistics.acquisitions.store(0, std::memory_order_relaxed);
+      statistics.contended_acquisitions.store(0, std::memory_order_relaxed);
+      statistics.wait_nanoseconds.store(0, std::memory_order_relaxed);
+    }
+  }
+
+}} // namespace HAL { namespace detail {
+#endif // HAL_LOCK_STATISTICS_ENABLE
@@ -22,20 +22,24 @@ namespace HAL { namespace detail {
     // Convert to system time.
     std::time_t t = std::chrono::system_clock::to_time_t(tp);
     
-#pragma warning(push)
-#pragma warning(disable: 4996) // 4996 for _CRT_SECURE_NO_WARNINGS equivalent
-    // Convert to calendar time.
-    //std::string ts = std::ctime(&t);
-    std::string ts = std::asctime(std::localtime(&t));
-    //std::string ts = std::asctime(std::gmtime(&t));
-#pragma warning(pop)
+    // Convert to calendar time in a buffer of our own, since the
+    // async logger writes headers from several threads at once and
+    // std::localtime and std::asctime share theirs.
+    std::tm tm {};
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
     
-    // Strip trailing newline.
-    ts.resize(ts.size() - 1);
-    
-    return ts;
+    // The format of std::asctime, without its trailing newline.
+    char ts[32];
+    const auto size = std::strftime(ts, sizeof(ts), "%a %b %d %H:%M:%S %Y", &tm);
+    return std::string(ts, size);
   }
   
+  std::atomic<int> JSLoggerPimpl::severity_threshold__ { 0 };
+  
   std::string JSLoggerPimpl::GetLoglineHeader(uint32_t log_line_number) {
     std::ostringstream os;
     
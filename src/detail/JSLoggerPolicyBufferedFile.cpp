@@ -0,0 +1,112 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSLoggerPolicyBufferedFile.hpp"
+
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+
+namespace HAL { namespace detail {
+  
+  namespace {
+    
+    struct DefaultFileOptions final {
+      std::mutex          mutex;
+      JSLoggerFileOptions options;
+    };
+    
+    DefaultFileOptions& GetDefaultFileOptions() {
+      static DefaultFileOptions default_options;
+      return default_options;
+    }
+    
+    std::string GetBackupPath(const std::string& path, std::uint32_t index) {
+      return index == 0 ? path : path + "." + std::to_string(index);
+    }
+    
+  } // namespace {
+  
+  JSLoggerPolicyBufferedFile::JSLoggerPolicyBufferedFile(const std::string& name)
+  : JSLoggerPolicyBufferedFile(name, GetDefaultOptions()) {
+  }
+  
+  JSLoggerPolicyBufferedFile::JSLoggerPolicyBufferedFile(const std::string& name, const JSLoggerFileOptions& options)
+  : options__(options)
+  , last_flush__(std::chrono::steady_clock::now()) {
+    if (options__.path.empty()) {
+      options__.path = name;
+    }
+    buffer__.reserve(options__.flush_bytes);
+    Open();
+  }
+  
+  JSLoggerPolicyBufferedFile::~JSLoggerPolicyBufferedFile() {
+    Flush();
+    ofstream__.close();
+  }
+  
+  void JSLoggerPolicyBufferedFile::Write(const std::string& log_message) {
+    const auto message_bytes = log_message.size() + 1;
+    if (options__.max_file_bytes > 0 && file_bytes__ > 0 && file_bytes__ + message_bytes > options__.max_file_bytes) {
+      Rotate();
+    }
+    
+    buffer__ += log_message;
+    buffer__ += '\n';
+    file_bytes__ += message_bytes;
+    
+    if (buffer__.size() >= options__.flush_bytes || std::chrono::steady_clock::now() - last_flush__ >= options__.flush_interval) {
+      Flush();
+    }
+  }
+  
+  void JSLoggerPolicyBufferedFile::Flush() {
+    if (!buffer__.empty()) {
+      ofstream__.write(buffer__.data(), static_cast<std::streamsize>(buffer__.size()));
+      buffer__.clear();
+    }
+    ofstream__.flush();
+    last_flush__ = std::chrono::steady_clock::now();
+  }
+  
+  void JSLoggerPolicyBufferedFile::SetDefaultOptions(const JSLoggerFileOptions& options) {
+    auto& default_options = GetDefaultFileOptions();
+    std::lock_guard<std::mutex> lock(default_options.mutex);
+    default_options.options = options;
+  }
+  
+  JSLoggerFileOptions JSLoggerPolicyBufferedFile::GetDefaultOptions() {
+    auto& default_options = GetDefaultFileOptions();
+    std::lock_guard<std::mutex> lock(default_options.mutex);
+    return default_options.options;
+  }
+  
+  void JSLoggerPolicyBufferedFile::Open() {
+    ofstream__.open(options__.path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    if (!ofstream__.is_open()) {
+      throw(std::runtime_error("JSLoggerPolicyBufferedFile: Unable to open " + options__.path));
+    }
+    file_bytes__ = 0;
+  }
+  
+  void JSLoggerPolicyBufferedFile::Rotate() {
+    Flush();
+    ofstream__.close();
+    
+    if (options__.max_backup_count > 0) {
+      std::remove(GetBackupPath(options__.path, options__.max_backup_count).c_str());
+      for (auto index = options__.max_backup_count; index > 0; --index) {
+        std::rename(GetBackupPath(options__.path, index - 1).c_str(), GetBackupPath(options__.path, index).c_str());
+      }
+    }
+    
+    Open();
+  }
+  
+}} // namespace HAL { namespace detail {
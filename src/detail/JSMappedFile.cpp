@@ -0,0 +1,101 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSMappedFile.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace HAL { namespace detail {
+
+#ifdef _WIN32
+  JSMappedFile::JSMappedFile(const std::string& path) {
+    file_handle__ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle__ == INVALID_HANDLE_VALUE) {
+      file_handle__ = nullptr;
+      ThrowRuntimeError("JSMappedFile", "Unable to open " + path);
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle__, &file_size)) {
+      CloseHandle(file_handle__);
+      ThrowRuntimeError("JSMappedFile", "Unable to get the size of " + path);
+    }
+
+    size__ = static_cast<std::size_t>(file_size.QuadPart);
+    if (size__ == 0) {
+      return;
+    }
+
+    mapping_handle__ = CreateFileMappingA(file_handle__, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    data__           = mapping_handle__ ? static_cast<const char*>(MapViewOfFile(mapping_handle__, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (!data__) {
+      if (mapping_handle__) {
+        CloseHandle(mapping_handle__);
+      }
+      CloseHandle(file_handle__);
+      ThrowRuntimeError("JSMappedFile", "Unable to map " + path);
+    }
+  }
+
+  JSMappedFile::~JSMappedFile() HAL_NOEXCEPT {
+    if (data__) {
+      UnmapViewOfFile(data__);
+    }
+    if (mapping_handle__) {
+      CloseHandle(mapping_handle__);
+    }
+    if (file_handle__) {
+      CloseHandle(file_handle__);
+    }
+  }
+#else
+  JSMappedFile::JSMappedFile(const std::string& path) {
+    const int file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+      ThrowRuntimeError("JSMappedFile", "Unable to open " + path);
+    }
+
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0) {
+      close(file_descriptor);
+      ThrowRuntimeError("JSMappedFile", "Unable to get the size of " + path);
+    }
+
+    size__ = static_cast<std::size_t>(file_status.st_size);
+    if (size__ > 0) {
+      void* data = mmap(nullptr, size__, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+      if (data == MAP_FAILED) {
+        close(file_descriptor);
+        ThrowRuntimeError("JSMappedFile", "Unable to map " + path);
+      }
+
+      // The input is read once from start to end.
+      madvise(data, size__, MADV_SEQUENTIAL);
+      data__ = static_cast<const char*>(data);
+    }
+
+    // The mapping stays valid after the file is closed.
+    close(file_descriptor);
+  }
+
+  JSMappedFile::~JSMappedFile() HAL_NOEXCEPT {
+    if (data__) {
+      munmap(const_cast<char*>(data__), size__);
+    }
+  }
+#endif
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,120 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSNodePool.hpp"
+
+#include <array>
+#include <atomic>
+
+// VS 2013 only supports thread local POD data, which can't return its
+// nodes to the heap when its thread exits, so it doesn't pool.
+#if !defined(_MSC_VER) || _MSC_VER > 1800
+#define HAL_DETAIL_JSNODEPOOL_ENABLE
+#endif
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    const std::size_t kSizeClassBytes = 16;
+    const std::size_t kSizeClassCount = kJSNodePoolMaxNodeSize / kSizeClassBytes;
+
+    std::atomic<std::uint64_t> allocation_count { 0 };
+    std::atomic<std::uint64_t> reuse_count      { 0 };
+    std::atomic<std::uint64_t> heap_free_count  { 0 };
+
+#ifdef HAL_DETAIL_JSNODEPOOL_ENABLE
+    struct FreeNode {
+      FreeNode* next;
+    };
+
+    // Set once the calling thread's free lists are destroyed, e.g. for
+    // the nodes of static containers destroyed after them at exit.
+    HAL_THREAD_LOCAL bool free_lists_destroyed { false };
+
+    struct FreeLists final {
+
+      FreeLists() HAL_NOEXCEPT {
+        heads.fill(nullptr);
+        sizes.fill(0);
+      }
+
+      ~FreeLists() HAL_NOEXCEPT {
+        for (auto head : heads) {
+          while (head) {
+            const auto next = head -> next;
+            ::operator delete(head);
+            heap_free_count.fetch_add(1, std::memory_order_relaxed);
+            head = next;
+          }
+        }
+        free_lists_destroyed = true;
+      }
+
+      std::array<FreeNode*  , kSizeClassCount> heads;
+      std::array<std::size_t, kSizeClassCount> sizes;
+    };
+
+    thread_local FreeLists free_lists;
+
+    std::size_t GetSizeClass(std::size_t size) HAL_NOEXCEPT {
+      return (size - 1) / kSizeClassBytes;
+    }
+#endif
+
+  } // namespace {
+
+  void* AllocateNode(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+#ifdef HAL_DETAIL_JSNODEPOOL_ENABLE
+    if (size > 0 && size <= kJSNodePoolMaxNodeSize) {
+      const auto size_class = GetSizeClass(size);
+      if (! free_lists_destroyed) {
+        if (const auto node = free_lists.heads[size_class]) {
+          free_lists.heads[size_class] = node -> next;
+          --free_lists.sizes[size_class];
+          reuse_count.fetch_add(1, std::memory_order_relaxed);
+          return node;
+        }
+      }
+
+      // Every node of a size class has the size of its largest member,
+      // so that any of them can be reused for any size in the class,
+      // including by another thread it is freed on.
+      return ::operator new((size_class + 1) * kSizeClassBytes);
+    }
+#endif
+    return ::operator new(size);
+  }
+
+  void DeallocateNode(void* node, std::size_t size) HAL_NOEXCEPT {
+#ifdef HAL_DETAIL_JSNODEPOOL_ENABLE
+    if (size > 0 && size <= kJSNodePoolMaxNodeSize && ! free_lists_destroyed) {
+      const auto size_class = GetSizeClass(size);
+      if (free_lists.sizes[size_class] < kJSNodePoolMaxCachedNodes) {
+        const auto free_node = static_cast<FreeNode*>(node);
+        free_node -> next = free_lists.heads[size_class];
+        free_lists.heads[size_class] = free_node;
+        ++free_lists.sizes[size_class];
+        return;
+      }
+    }
+#endif
+    heap_free_count.fetch_add(1, std::memory_order_relaxed);
+    ::operator delete(node);
+  }
+
+  JSNodePoolStatistics GetNodePoolStatistics() HAL_NOEXCEPT {
+    return JSNodePoolStatistics {
+      allocation_count.load(std::memory_order_relaxed),
+      reuse_count.load(std::memory_order_relaxed),
+      heap_free_count.load(std::memory_order_relaxed)
+    };
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,104 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSObjectRefRegistry.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSRetainedHandles.hpp"
+
+#include <cassert>
+
+#undef  HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE_STATICS
+#define HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD(SHARD) std::lock_guard<JSMutex> lock(SHARD.mutex)
+#else
+#define HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD(SHARD)
+#endif  // HAL_THREAD_SAFE_STATICS
+
+namespace HAL { namespace detail {
+
+  std::size_t JSObjectRefRegistry::Register(JSContextRef js_context_ref, JSObjectRef js_object_ref) {
+    const auto key = reinterpret_cast<std::intptr_t>(js_object_ref);
+    auto& shard    = shards__[ShardIndex(key)];
+    HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD(shard);
+
+    // A single lookup both finds an existing entry and inserts a new
+    // one.
+    const auto insert_result = shard.map.emplace(key, Entry { js_context_ref, 0 });
+    auto& entry = insert_result.first -> second;
+    if (insert_result.second) {
+      ++GetJSBudgetCounts().registry_insert_count;
+      detail::ProtectJSValue(js_context_ref, js_object_ref);
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      entry.site      = JSRetainSite::current();
+      entry.backtrace = CaptureRetainBacktrace();
+#endif
+    }
+
+    return ++entry.count;
+  }
+
+  std::size_t JSObjectRefRegistry::UnRegister(JSObjectRef js_object_ref) {
+    const auto key = reinterpret_cast<std::intptr_t>(js_object_ref);
+    auto& shard    = shards__[ShardIndex(key)];
+    HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD(shard);
+
+    const auto position = shard.map.find(key);
+    if (position == shard.map.end()) {
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      ReportRetainImbalance("JSObjectRefRegistry::UnRegister", js_object_ref);
+#endif
+      return 0;
+    }
+
+    auto& entry = position -> second;
+    assert(entry.count > 0);
+    const auto count = --entry.count;
+    if (count == 0) {
+      detail::UnprotectJSValue(entry.js_context_ref, js_object_ref);
+      shard.map.erase(position);
+    }
+
+    return count;
+  }
+
+  JSContextRef JSObjectRefRegistry::Find(JSObjectRef js_object_ref) const {
+    const auto  key   = reinterpret_cast<std::intptr_t>(js_object_ref);
+    const auto& shard = shards__[ShardIndex(key)];
+    HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD(shard);
+
+    const auto position = shard.map.find(key);
+    return position != shard.map.end() ? position -> second.js_context_ref : nullptr;
+  }
+
+  std::size_t JSObjectRefRegistry::size() const {
+    std::size_t result = 0;
+    for (const auto& shard : shards__) {
+      HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD(shard);
+      result += shard.map.size();
+    }
+    return result;
+  }
+
+  void JSObjectRefRegistry::ForEach(const std::function<void(JSContextRef js_context_ref, JSObjectRef js_object_ref, std::size_t count, const std::string& site, const std::string& backtrace)>& callback) const {
+#ifndef HAL_TRACK_RETAINED_HANDLES
+    static const std::string site;
+    static const std::string backtrace;
+#endif
+    for (const auto& shard : shards__) {
+      HAL_JSOBJECTREFREGISTRY_SHARD_LOCK_GUARD(shard);
+      for (const auto& entry : shard.map) {
+#ifdef HAL_TRACK_RETAINED_HANDLES
+        const auto& site      = entry.second.site;
+        const auto& backtrace = entry.second.backtrace;
+#endif
+        callback(entry.second.js_context_ref, reinterpret_cast<JSObjectRef>(entry.first), entry.second.count, site, backtrace);
+      }
+    }
+  }
+
+}} // namespace HAL { namespace detail {
@@ -11,8 +11,11 @@
 
 namespace HAL { namespace detail {
   
-  JSPropertyCallback::JSPropertyCallback(const std::string& name, const std::unordered_set<JSPropertyAttribute>& attributes)
+  JSPropertyCallback::JSPropertyCallback(const std::string& name, JSPropertyAttributeSet attributes)
   : name__(name)
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+  , profile__(std::make_shared<JSPropertyProfile>())
+#endif
   , attributes__(attributes) {
     
     if (name__.empty()) {
@@ -22,17 +25,26 @@ namespace HAL { namespace detail {
   
   JSPropertyCallback::JSPropertyCallback(const JSPropertyCallback& rhs) HAL_NOEXCEPT
   : name__(rhs.name__)
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+  , profile__(rhs.profile__)
+#endif
   , attributes__(rhs.attributes__) {
   }
   
   JSPropertyCallback::JSPropertyCallback(JSPropertyCallback&& rhs) HAL_NOEXCEPT
   : name__(std::move(rhs.name__))
-  , attributes__(std::move(rhs.attributes__)) {
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+  , profile__(std::move(rhs.profile__))
+#endif
+  , attributes__(rhs.attributes__) {
   }
   
   JSPropertyCallback& JSPropertyCallback::operator=(const JSPropertyCallback& rhs) HAL_NOEXCEPT {
     HAL_DETAIL_JSPROPERTYCALLBACK_LOCK_GUARD;
     name__       = rhs.name__;
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+    profile__    = rhs.profile__;
+#endif
     attributes__ = rhs.attributes__;
     return *this;
   }
@@ -50,6 +62,9 @@ namespace HAL { namespace detail {
     // By swapping the members of two classes, the two classes are
     // effectively swapped.
     swap(name__      , other.name__);
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+    swap(profile__   , other.profile__);
+#endif
     swap(attributes__, other.attributes__);
   }
   
@@ -0,0 +1,258 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSQuotaState.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <string>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // The outermost JSQuotaScope of this thread, whose call is charged
+    // with the time of the scopes inside it.
+    HAL_THREAD_LOCAL JSQuotaScope* outermost_js_quota_scope = nullptr;
+
+    std::int64_t GetNanosecondsSinceEpoch() HAL_NOEXCEPT {
+      return static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    std::uint64_t ToNanoseconds(double seconds) HAL_NOEXCEPT {
+      return seconds > 0 ? static_cast<std::uint64_t>(seconds * 1e9) : 0;
+    }
+
+  } // namespace {
+
+  JSQuotaState::JSQuotaState(JSContextGroupRef js_context_group_ref) HAL_NOEXCEPT
+  : js_context_group_ref__(js_context_group_ref) {
+    for (std::size_t i = 0; i < kResourceCount; ++i) {
+      soft_limits__[i].store(0, std::memory_order_relaxed);
+      hard_limits__[i].store(0, std::memory_order_relaxed);
+      past_soft_limit__[i].store(false, std::memory_order_relaxed);
+      past_hard_limit__[i].store(false, std::memory_order_relaxed);
+    }
+  }
+
+  void JSQuotaState::SetQuotas(const JSContextGroupQuotas& quotas) {
+    auto callback = quotas.soft_limit_callback ? std::make_shared<const JSQuotaCallback>(quotas.soft_limit_callback) : nullptr;
+    {
+      std::lock_guard<JSMutex> lock(mutex__);
+      soft_limit_callback__ = std::move(callback);
+    }
+
+    const JSQuotaLimit* limits[kResourceCount] = { &quotas.cpu_time_seconds, &quotas.protected_handles, &quotas.external_memory_bytes, &quotas.queued_tasks };
+    for (std::size_t i = 0; i < kResourceCount; ++i) {
+      soft_limits__[i].store(std::max(limits[i] -> soft, 0.0), std::memory_order_relaxed);
+      hard_limits__[i].store(std::max(limits[i] -> hard, 0.0), std::memory_order_relaxed);
+    }
+    handle_check_interval_nanoseconds__.store(ToNanoseconds(quotas.handle_check_interval_seconds), std::memory_order_relaxed);
+    has_quotas__.store(true);
+
+    // Judge the usage so far against the new limits.
+    Update(JSQuotaResource::CPUTime, GetCPUTimeSeconds());
+    Update(JSQuotaResource::ExternalMemory, static_cast<double>(std::max<std::int64_t>(external_memory_bytes__.load(), 0)));
+    Update(JSQuotaResource::QueuedTasks, static_cast<double>(std::max<std::int64_t>(queued_tasks__.load(), 0)));
+    CheckProtectedHandles(true);
+  }
+
+  void JSQuotaState::ClearQuotas() HAL_NOEXCEPT {
+    has_quotas__.store(false);
+    for (std::size_t i = 0; i < kResourceCount; ++i) {
+      soft_limits__[i].store(0, std::memory_order_relaxed);
+      hard_limits__[i].store(0, std::memory_order_relaxed);
+      past_soft_limit__[i].store(false, std::memory_order_relaxed);
+      past_hard_limit__[i].store(false, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<JSMutex> lock(mutex__);
+    soft_limit_callback__.reset();
+  }
+
+  void JSQuotaState::ResetCPUTime() HAL_NOEXCEPT {
+    cpu_nanoseconds__.store(0);
+    Update(JSQuotaResource::CPUTime, 0);
+  }
+
+  JSContextGroupQuotaUsage JSQuotaState::GetUsage() const HAL_NOEXCEPT {
+    JSContextGroupQuotaUsage usage;
+    usage.cpu_time_seconds          = GetCPUTimeSeconds();
+    usage.external_memory_bytes     = static_cast<std::size_t>(std::max<std::int64_t>(external_memory_bytes__.load(std::memory_order_relaxed), 0));
+    usage.queued_tasks              = static_cast<std::size_t>(std::max<std::int64_t>(queued_tasks__.load(std::memory_order_relaxed), 0));
+    usage.soft_limit_exceeded_count = soft_limit_exceeded_count__.load(std::memory_order_relaxed);
+    usage.hard_limit_exceeded_count = hard_limit_exceeded_count__.load(std::memory_order_relaxed);
+    usage.terminated_count          = terminated_count__.load(std::memory_order_relaxed);
+    return usage;
+  }
+
+  void JSQuotaState::AdjustExternalMemory(std::ptrdiff_t byte_delta) HAL_NOEXCEPT {
+    const auto bytes = external_memory_bytes__.fetch_add(byte_delta) + byte_delta;
+    if (has_quotas()) {
+      Update(JSQuotaResource::ExternalMemory, static_cast<double>(std::max<std::int64_t>(bytes, 0)));
+    }
+  }
+
+  void JSQuotaState::AddQueuedTask() {
+    const auto queued_tasks = queued_tasks__.fetch_add(1) + 1;
+    if (!has_quotas()) {
+      return;
+    }
+
+    // A task past the hard limit is rejected rather than counted, so
+    // queued tasks never stay past it.
+    const auto index = static_cast<std::size_t>(JSQuotaResource::QueuedTasks);
+    const auto hard  = hard_limits__[index].load(std::memory_order_relaxed);
+    if (hard > 0 && queued_tasks > hard) {
+      queued_tasks__.fetch_sub(1);
+      hard_limit_exceeded_count__.fetch_add(1, std::memory_order_relaxed);
+      terminated_count__.fetch_add(1, std::memory_order_relaxed);
+      ThrowRuntimeError("JSRunLoop", "The JSContextGroup has reached its hard quota of queued tasks.");
+    }
+
+    Update(JSQuotaResource::QueuedTasks, static_cast<double>(queued_tasks));
+  }
+
+  void JSQuotaState::RemoveQueuedTasks(std::size_t count) HAL_NOEXCEPT {
+    const auto queued_tasks = queued_tasks__.fetch_sub(static_cast<std::int64_t>(count)) - static_cast<std::int64_t>(count);
+    if (has_quotas()) {
+      Update(JSQuotaResource::QueuedTasks, static_cast<double>(std::max<std::int64_t>(queued_tasks, 0)));
+    }
+  }
+
+  bool JSQuotaState::CheckRunning() HAL_NOEXCEPT {
+    if (!has_quotas()) {
+      return false;
+    }
+
+    Update(JSQuotaResource::CPUTime, GetCPUTimeSeconds());
+    CheckProtectedHandles(false);
+    if (!IsPastHardLimit()) {
+      return false;
+    }
+
+    terminated_count__.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool JSQuotaState::Update(JSQuotaResource resource, double usage) HAL_NOEXCEPT {
+    const auto index = static_cast<std::size_t>(resource);
+
+    const auto hard      = hard_limits__[index].load(std::memory_order_relaxed);
+    const auto past_hard = hard > 0 && usage > hard;
+    if (past_hard_limit__[index].exchange(past_hard) != past_hard && past_hard) {
+      hard_limit_exceeded_count__.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const auto soft      = soft_limits__[index].load(std::memory_order_relaxed);
+    const auto past_soft = soft > 0 && usage > soft;
+    if (past_soft_limit__[index].exchange(past_soft) != past_soft && past_soft) {
+      soft_limit_exceeded_count__.fetch_add(1, std::memory_order_relaxed);
+
+      std::shared_ptr<const JSQuotaCallback> callback;
+      {
+        std::lock_guard<JSMutex> lock(mutex__);
+        callback = soft_limit_callback__;
+      }
+
+      if (callback) {
+        try {
+          (*callback)(resource, usage, soft);
+        } catch (const std::exception& e) {
+          HAL_LOG_ERROR("JSContextGroup: quota callback threw ", e.what());
+        } catch (...) {
+          HAL_LOG_ERROR("JSContextGroup: quota callback threw an unknown exception");
+        }
+      }
+    }
+
+    return past_hard;
+  }
+
+  bool JSQuotaState::IsPastHardLimit() const HAL_NOEXCEPT {
+    for (std::size_t i = 0; i < kResourceCount; ++i) {
+      if (past_hard_limit__[i].load(std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  double JSQuotaState::GetCPUTimeSeconds() const HAL_NOEXCEPT {
+    const auto running = std::chrono::duration_cast<std::chrono::nanoseconds>(JSQuotaScope::GetRunningTime(*this)).count();
+    return static_cast<double>(cpu_nanoseconds__.load(std::memory_order_relaxed) + static_cast<std::uint64_t>(running)) / 1e9;
+  }
+
+  void JSQuotaState::CheckProtectedHandles(bool force) HAL_NOEXCEPT {
+    const auto index = static_cast<std::size_t>(JSQuotaResource::ProtectedHandles);
+    if (soft_limits__[index].load(std::memory_order_relaxed) == 0 && hard_limits__[index].load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+
+    // One thread counts at a time, and the others keep the last count.
+    const auto now = GetNanosecondsSinceEpoch();
+    auto last_handle_check = last_handle_check__.load();
+    if (!force && now - last_handle_check < static_cast<std::int64_t>(handle_check_interval_nanoseconds__.load(std::memory_order_relaxed))) {
+      return;
+    }
+    if (!last_handle_check__.compare_exchange_strong(last_handle_check, now)) {
+      return;
+    }
+
+    try {
+      const auto statistics = JSContextGroup(js_context_group_ref__).GetStatistics();
+      Update(JSQuotaResource::ProtectedHandles, static_cast<double>(statistics.value_count + statistics.object_count));
+    } catch (...) {
+      // Keep the last count.
+    }
+  }
+
+  JSQuotaScope::JSQuotaScope(JSQuotaState& js_quota_state) {
+    if (!js_quota_state.has_quotas()) {
+      return;
+    }
+
+    if (js_quota_state.IsPastHardLimit()) {
+      js_quota_state.terminated_count__.fetch_add(1, std::memory_order_relaxed);
+      for (std::size_t i = 0; i < JSQuotaState::kResourceCount; ++i) {
+        if (js_quota_state.past_hard_limit__[i].load(std::memory_order_relaxed)) {
+          ThrowRuntimeError("JSContextGroup", std::string("The JSContextGroup is past its hard quota of ") + to_string(static_cast<JSQuotaResource>(i)) + ".");
+        }
+      }
+    }
+
+    if (!outermost_js_quota_scope) {
+      js_quota_state__         = &js_quota_state;
+      start__                  = std::chrono::steady_clock::now();
+      outermost_js_quota_scope = this;
+    }
+  }
+
+  JSQuotaScope::~JSQuotaScope() HAL_NOEXCEPT {
+    if (!js_quota_state__) {
+      return;
+    }
+
+    outermost_js_quota_scope = nullptr;
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start__).count();
+    js_quota_state__ -> cpu_nanoseconds__.fetch_add(static_cast<std::uint64_t>(elapsed), std::memory_order_relaxed);
+    js_quota_state__ -> Update(JSQuotaResource::CPUTime, js_quota_state__ -> GetCPUTimeSeconds());
+    js_quota_state__ -> CheckProtectedHandles(false);
+  }
+
+  std::chrono::steady_clock::duration JSQuotaScope::GetRunningTime(const JSQuotaState& js_quota_state) HAL_NOEXCEPT {
+    const auto js_quota_scope = outermost_js_quota_scope;
+    if (!js_quota_scope || js_quota_scope -> js_quota_state__ != &js_quota_state) {
+      return std::chrono::steady_clock::duration::zero();
+    }
+    return std::chrono::steady_clock::now() - js_quota_scope -> start__;
+  }
+
+}} // namespace HAL { namespace detail {
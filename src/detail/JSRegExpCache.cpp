@@ -0,0 +1,105 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSRegExpCache.hpp"
+#include "HAL/JSMemoryPressure.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+
+#include <functional>
+#include <mutex>
+
+namespace HAL { namespace detail {
+
+  bool JSRegExpCache::Key::operator==(const Key& rhs) const {
+    return flags == rhs.flags && pattern == rhs.pattern;
+  }
+
+  std::size_t JSRegExpCache::KeyHash::operator()(const Key& key) const {
+    const std::hash<JSString> hash;
+    return hash(key.pattern) * 31 + hash(key.flags);
+  }
+
+  JSRegExpCache::JSRegExpCache(JSContextRef js_context_ref) HAL_NOEXCEPT
+  : js_context_ref__(js_context_ref) {
+  }
+
+  JSRegExpCache::~JSRegExpCache() HAL_NOEXCEPT {
+    Clear();
+  }
+
+  JSObjectRef JSRegExpCache::Find(const Key& key) {
+    HAL_JSREGEXPCACHE_LOCK_GUARD;
+    const auto position = index__.find(key);
+    if (position == index__.end()) {
+      return nullptr;
+    }
+
+    entries__.splice(entries__.begin(), entries__, position -> second);
+    return position -> second -> second;
+  }
+
+  void JSRegExpCache::Insert(Key key, JSObjectRef js_object_ref) {
+    HAL_JSREGEXPCACHE_LOCK_GUARD;
+    if (capacity__ == 0 || index__.find(key) != index__.end()) {
+      return;
+    }
+
+    EvictTo(capacity__ - 1);
+    detail::ProtectJSValue(js_context_ref__, js_object_ref);
+    entries__.emplace_front(key, js_object_ref);
+    index__.emplace(std::move(key), entries__.begin());
+  }
+
+  void JSRegExpCache::Clear() HAL_NOEXCEPT {
+    HAL_JSREGEXPCACHE_LOCK_GUARD;
+    EvictTo(0);
+  }
+
+  std::size_t JSRegExpCache::GetSize(const Key& key) HAL_NOEXCEPT {
+    // The UTF-16 strings, a list node and a hash map node.
+    const auto result = (key.pattern.length() + key.flags.length()) * sizeof(char16_t);
+    return result + sizeof(std::pair<Key, JSObjectRef>) + sizeof(std::pair<Key, EntryList::iterator>) + 4 * sizeof(void*);
+  }
+
+  std::size_t JSRegExpCache::Evict(double fraction) HAL_NOEXCEPT {
+    HAL_JSREGEXPCACHE_LOCK_GUARD;
+    const auto count = JSMemoryPressure::GetEvictionCount(entries__.size(), fraction);
+    std::size_t result = 0;
+    auto position = entries__.end();
+    for (std::size_t i = 0; i < count; ++i) {
+      result += GetSize((--position) -> first);
+    }
+    EvictTo(entries__.size() - count);
+    return result;
+  }
+
+  void JSRegExpCache::set_capacity(std::size_t capacity) HAL_NOEXCEPT {
+    HAL_JSREGEXPCACHE_LOCK_GUARD;
+    capacity__ = capacity;
+    EvictTo(capacity);
+  }
+
+  std::size_t JSRegExpCache::get_capacity() const HAL_NOEXCEPT {
+    HAL_JSREGEXPCACHE_LOCK_GUARD;
+    return capacity__;
+  }
+
+  std::size_t JSRegExpCache::size() const HAL_NOEXCEPT {
+    HAL_JSREGEXPCACHE_LOCK_GUARD;
+    return entries__.size();
+  }
+
+  void JSRegExpCache::EvictTo(std::size_t size) HAL_NOEXCEPT {
+    while (entries__.size() > size) {
+      detail::UnprotectJSValue(js_context_ref__, entries__.back().second);
+      index__.erase(entries__.back().first);
+      entries__.pop_back();
+    }
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,273 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSRetainedHandles.hpp"
+#include "HAL/detail/JSValueRetainRegistry.hpp"
+#include "HAL/detail/JSObjectRefRegistry.hpp"
+#include "HAL/JSObject.hpp"
+
+#include <atomic>
+#include <sstream>
+#include <unordered_map>
+
+#if defined(HAL_TRACK_RETAINED_HANDLES) && (defined(__APPLE__) || defined(__GLIBC__))
+#include <cstdlib>
+#include <execinfo.h>
+#define HAL_DETAIL_JSRETAINEDHANDLES_BACKTRACE_ENABLE
+#endif
+
+namespace {
+  
+  std::string ToTypeName(JSType js_type) {
+    switch (js_type) {
+      case kJSTypeUndefined: return "Undefined";
+      case kJSTypeNull:      return "Null";
+      case kJSTypeBoolean:   return "Boolean";
+      case kJSTypeNumber:    return "Number";
+      case kJSTypeString:    return "String";
+      case kJSTypeObject:    return "Object";
+    }
+    return "Unknown";
+  }
+  
+  std::atomic<std::size_t> retain_imbalance_count__ { 0 };
+  
+#ifdef HAL_TRACK_RETAINED_HANDLES
+  std::atomic<bool> retain_backtraces_enabled__ { false };
+  
+  // The innermost JSRetainSite on this thread.
+  HAL_THREAD_LOCAL const HAL::detail::JSRetainSite* current_js_retain_site__ = nullptr;
+  
+  // The JSExport class name of every native object alive.
+  std::unordered_map<const void*, const char*> native_object_class_names__;
+  
+#ifdef HAL_THREAD_SAFE_STATICS
+  HAL::detail::JSMutex native_object_class_names_mutex__ HAL_LOCK_NAME("JSRetainedHandles");
+#endif
+#endif  // HAL_TRACK_RETAINED_HANDLES
+}
+
+#undef  HAL_JSRETAINEDHANDLES_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE_STATICS
+#define HAL_JSRETAINEDHANDLES_LOCK_GUARD std::lock_guard<JSMutex> lock(native_object_class_names_mutex__)
+#else
+#define HAL_JSRETAINEDHANDLES_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+
+namespace HAL { namespace detail {
+  
+  JSRetainedHandles GetRetainedHandles() {
+    JSRetainedHandles result;
+    
+    JSValueRetainRegistry::ForEachRegistry([&result](const JSValueRetainRegistry& js_value_retain_registry) {
+      const auto js_context_ref = js_value_retain_registry.get_context_ref();
+      js_value_retain_registry.ForEach([&result, js_context_ref](JSValueRef js_value_ref, std::size_t, const std::string& site, const std::string&) {
+        ++result.by_context[js_context_ref].values;
+        ++result.by_value_type[ToTypeName(JSValueGetType(js_context_ref, js_value_ref))];
+        if (!site.empty()) {
+          ++result.by_site[site];
+        }
+      });
+    });
+    
+#ifdef HAL_TRACK_RETAINED_HANDLES
+    HAL_JSRETAINEDHANDLES_LOCK_GUARD;
+#endif
+    JSObject::js_object_ref_registry__.ForEach([&result](JSContextRef js_context_ref, JSObjectRef js_object_ref, std::size_t, const std::string&, const std::string&) {
+      ++result.by_context[js_context_ref].objects;
+      
+      const auto private_data = JSObjectGetPrivate(js_object_ref);
+      std::string class_name  = private_data ? "<private data>" : "Object";
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      const auto position = native_object_class_names__.find(private_data);
+      if (position != native_object_class_names__.end()) {
+        class_name = position -> second;
+      }
+#endif
+      ++result.by_class[class_name];
+    });
+    
+    return result;
+  }
+  
+  std::string DumpRetainedHandles() {
+    const auto retained_handles = GetRetainedHandles();
+    std::ostringstream os;
+    
+    os << "Retained handles by context:" << std::endl;
+    for (const auto& entry : retained_handles.by_context) {
+      os << "  " << entry.first << ": values = " << entry.second.values << ", objects = " << entry.second.objects << std::endl;
+    }
+    
+    os << "Retained values by type:" << std::endl;
+    for (const auto& entry : retained_handles.by_value_type) {
+      os << "  " << entry.first << ": " << entry.second << std::endl;
+    }
+    
+    os << "Retained objects by class:" << std::endl;
+    for (const auto& entry : retained_handles.by_class) {
+      os << "  " << entry.first << ": " << entry.second << std::endl;
+    }
+    
+    if (!retained_handles.by_site.empty()) {
+      os << "Retained values by call site:" << std::endl;
+      for (const auto& entry : retained_handles.by_site) {
+        os << "  " << entry.first << ": " << entry.second << std::endl;
+      }
+    }
+    
+    return os.str();
+  }
+  
+  std::vector<JSRetainedHandle> GetRetainedHandleList() {
+    std::vector<JSRetainedHandle> result;
+    
+    JSValueRetainRegistry::ForEachRegistry([&result](const JSValueRetainRegistry& js_value_retain_registry) {
+      const auto js_context_ref = js_value_retain_registry.get_context_ref();
+      js_value_retain_registry.ForEach([&result, js_context_ref](JSValueRef js_value_ref, std::size_t count, const std::string& site, const std::string& backtrace) {
+        // A value whose release was deferred is no longer held.
+        if (count == 0) {
+          return;
+        }
+        JSRetainedHandle handle;
+        handle.js_context_ref = js_context_ref;
+        handle.js_value_ref   = js_value_ref;
+        handle.count          = count;
+        handle.site           = site;
+        handle.backtrace      = backtrace;
+        result.push_back(std::move(handle));
+      });
+    });
+    
+    JSObject::js_object_ref_registry__.ForEach([&result](JSContextRef js_context_ref, JSObjectRef js_object_ref, std::size_t count, const std::string& site, const std::string& backtrace) {
+      JSRetainedHandle handle;
+      handle.js_context_ref = js_context_ref;
+      handle.js_value_ref   = js_object_ref;
+      handle.is_object      = true;
+      handle.count          = count;
+      handle.site           = site;
+      handle.backtrace      = backtrace;
+      result.push_back(std::move(handle));
+    });
+    
+    return result;
+  }
+  
+  std::size_t GetRetainImbalanceCount() HAL_NOEXCEPT {
+    return retain_imbalance_count__.load(std::memory_order_relaxed);
+  }
+  
+  JSRetainLeakChecker::JSRetainLeakChecker() {
+    Reset();
+  }
+  
+  void JSRetainLeakChecker::Reset() {
+    baseline__.clear();
+    for (const auto& handle : GetRetainedHandleList()) {
+      baseline__.emplace(handle.is_object, handle.js_value_ref);
+    }
+  }
+  
+  std::vector<JSRetainedHandle> JSRetainLeakChecker::GetLeaks() const {
+    std::vector<JSRetainedHandle> result;
+    for (auto& handle : GetRetainedHandleList()) {
+      if (baseline__.find(std::make_pair(handle.is_object, handle.js_value_ref)) == baseline__.end()) {
+        result.push_back(std::move(handle));
+      }
+    }
+    return result;
+  }
+  
+  std::string JSRetainLeakChecker::DumpLeaks() const {
+    const auto leaks = GetLeaks();
+    if (leaks.empty()) {
+      return "";
+    }
+    
+    std::ostringstream os;
+    os << leaks.size() << " handles still retained:" << std::endl;
+    for (const auto& leak : leaks) {
+      os << "  " << (leak.is_object ? "JSObjectRef " : "JSValueRef ") << leak.js_value_ref << " in " << leak.js_context_ref << ", count = " << leak.count;
+      if (!leak.site.empty()) {
+        os << ", first retained at " << leak.site;
+      }
+      os << std::endl;
+      if (!leak.backtrace.empty()) {
+        os << leak.backtrace;
+      }
+    }
+    return os.str();
+  }
+  
+#ifdef HAL_TRACK_RETAINED_HANDLES
+  
+  void SetRetainBacktraces(bool enabled) HAL_NOEXCEPT {
+    retain_backtraces_enabled__.store(enabled, std::memory_order_relaxed);
+  }
+  
+  std::string CaptureRetainBacktrace() {
+    std::string result;
+#ifdef HAL_DETAIL_JSRETAINEDHANDLES_BACKTRACE_ENABLE
+    if (!retain_backtraces_enabled__.load(std::memory_order_relaxed)) {
+      return result;
+    }
+    
+    void* frames[32];
+    const auto frame_count = backtrace(frames, 32);
+    const auto symbols     = backtrace_symbols(frames, frame_count);
+    if (!symbols) {
+      return result;
+    }
+    
+    // Skip this function and the registry that called it.
+    for (int i = 2; i < frame_count; ++i) {
+      result += "    ";
+      result += symbols[i];
+      result += "\n";
+    }
+    std::free(symbols);
+#endif
+    return result;
+  }
+  
+  void ReportRetainImbalance(const char* function_name, const void* js_value_ref) HAL_NOEXCEPT {
+    retain_imbalance_count__.fetch_add(1, std::memory_order_relaxed);
+    try {
+      HAL_LOG_ERROR(function_name, ": ", js_value_ref, " is not retained\n", CaptureRetainBacktrace());
+    } catch (...) {
+    }
+  }
+  
+  JSRetainSite::JSRetainSite(const std::string& site)
+  : previous__(current_js_retain_site__)
+  , site__(site) {
+    current_js_retain_site__ = this;
+  }
+  
+  JSRetainSite::~JSRetainSite() HAL_NOEXCEPT {
+    current_js_retain_site__ = previous__;
+  }
+  
+  const std::string& JSRetainSite::current() HAL_NOEXCEPT {
+    static const std::string empty;
+    return current_js_retain_site__ ? current_js_retain_site__ -> site__ : empty;
+  }
+  
+  void RegisterNativeObject(const void* native_object_ptr, const char* class_name) {
+    HAL_JSRETAINEDHANDLES_LOCK_GUARD;
+    native_object_class_names__[native_object_ptr] = class_name;
+  }
+  
+  void UnRegisterNativeObject(const void* native_object_ptr) {
+    HAL_JSRETAINEDHANDLES_LOCK_GUARD;
+    native_object_class_names__.erase(native_object_ptr);
+  }
+  
+#endif  // HAL_TRACK_RETAINED_HANDLES
+  
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,561 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSSerializedValue.hpp"
+
+#include "HAL/JSContext.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSArrayBuffer.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    void ThrowIfException(JSContextRef context_ref, JSValueRef exception) {
+      if (exception) {
+        ThrowRuntimeError("JSMessagePort", JSValue(JSContext(context_ref), exception));
+      }
+    }
+
+    // The binary form starts with kMagic, kVersion and kByteOrder, so
+    // that a file of another format, version or byte order is rejected
+    // rather than misread.
+    const char          kMagic[4]  = { 'H', 'A', 'L', 'S' };
+    const std::uint32_t kVersion   = 1;
+    const std::uint32_t kByteOrder = 0x01020304;
+
+    // Sizes and indexes are stored as 64 bit, whatever std::size_t is.
+    template<typename T>
+    void Append(std::string& bytes, T value) {
+      static_assert(std::is_arithmetic<T>::value, "Only numbers are appended.");
+      bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void AppendSize(std::string& bytes, std::size_t size) {
+      Append(bytes, static_cast<std::uint64_t>(size));
+    }
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    // Return the size of an element of a typed array of type, or 0 if
+    // type isn't one.
+    std::size_t GetTypedArrayElementSize(std::uint32_t type) HAL_NOEXCEPT {
+      switch (type) {
+        case kJSTypedArrayTypeInt8Array:
+        case kJSTypedArrayTypeUint8Array:
+        case kJSTypedArrayTypeUint8ClampedArray:
+          return 1;
+        case kJSTypedArrayTypeInt16Array:
+        case kJSTypedArrayTypeUint16Array:
+          return 2;
+        case kJSTypedArrayTypeInt32Array:
+        case kJSTypedArrayTypeUint32Array:
+        case kJSTypedArrayTypeFloat32Array:
+          return 4;
+        case kJSTypedArrayTypeFloat64Array:
+          return 8;
+        default:
+          return 0;
+      }
+    }
+#endif
+
+  } // namespace {
+
+  class JSSerializedValue::Reader final {
+
+  public:
+
+    Reader(JSSerializedValue& serialized_value, const char* data, std::size_t size) HAL_NOEXCEPT
+    : serialized_value__(serialized_value)
+    , data__(data)
+    , size__(size) {
+    }
+
+    Reader(const Reader&)            = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    void Read() {
+      char magic[sizeof(kMagic)];
+      ReadBytes(magic, sizeof(magic));
+      if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || ReadNumber<std::uint32_t>() != kVersion || ReadNumber<std::uint32_t>() != kByteOrder) {
+        ThrowRuntimeError("JSSerializedValue", "The bytes aren't a serialized value of this version.");
+      }
+
+      // Each count is checked against the bytes left before anything
+      // is allocated for it.
+      const auto object_count   = ReadCount(kObjectSize);
+      const auto property_count = ReadCount(kPropertySize);
+      const auto string_count   = ReadCount(sizeof(std::uint64_t));
+      const auto buffer_count   = ReadCount(sizeof(std::uint64_t));
+
+      auto& serialized_value = serialized_value__;
+      serialized_value.root__ = ReadValue();
+
+      serialized_value.objects__.reserve(object_count);
+      for (std::size_t i = 0; i < object_count; ++i) {
+        Object object;
+        object.type             = static_cast<ObjectType>(ReadNumber<std::uint8_t>());
+        object.time             = ReadNumber<double>();
+        object.first_property   = ReadSize();
+        object.property_count   = ReadSize();
+        object.buffer           = ReadSize();
+        object.byte_offset      = ReadSize();
+        object.length           = ReadSize();
+        object.typed_array_type = ReadNumber<std::uint32_t>();
+        serialized_value.objects__.push_back(object);
+      }
+
+      serialized_value.properties__.reserve(property_count);
+      for (std::size_t i = 0; i < property_count; ++i) {
+        const auto name = ReadSize();
+        serialized_value.properties__.push_back({ name, ReadValue() });
+      }
+
+      serialized_value.strings__.reserve(string_count);
+      for (std::size_t i = 0; i < string_count; ++i) {
+        const auto length = ReadCount(sizeof(char16_t));
+        std::u16string string(length, u'\0');
+        ReadBytes(&string[0], length * sizeof(char16_t));
+        serialized_value.strings__.push_back(JSString(string));
+      }
+
+      serialized_value.buffers__.reserve(buffer_count);
+      for (std::size_t i = 0; i < buffer_count; ++i) {
+        const auto byte_length = ReadCount(1);
+        const std::shared_ptr<char> copy(new char[byte_length], std::default_delete<char[]>());
+        ReadBytes(copy.get(), byte_length);
+        serialized_value.buffers__.push_back({ copy, copy.get(), byte_length });
+      }
+
+      if (offset__ != size__) {
+        ThrowRuntimeError("JSSerializedValue", "The serialized value is followed by other bytes.");
+      }
+      Validate();
+    }
+
+  private:
+
+    static const std::size_t kValueSize    = sizeof(std::uint8_t) + sizeof(double) + sizeof(std::uint64_t);
+    static const std::size_t kPropertySize = sizeof(std::uint64_t) + kValueSize;
+    static const std::size_t kObjectSize   = sizeof(std::uint8_t) + sizeof(double) + 5 * sizeof(std::uint64_t) + sizeof(std::uint32_t);
+
+    void ReadBytes(void* bytes, std::size_t count) {
+      if (count > size__ - offset__) {
+        ThrowRuntimeError("JSSerializedValue", "The serialized value is truncated.");
+      }
+      std::memcpy(bytes, data__ + offset__, count);
+      offset__ += count;
+    }
+
+    // The bytes may be mapped at any alignment, so numbers are copied
+    // out rather than read in place.
+    template<typename T>
+    T ReadNumber() {
+      T value;
+      ReadBytes(&value, sizeof(value));
+      return value;
+    }
+
+    std::size_t ReadSize() {
+      const auto size = ReadNumber<std::uint64_t>();
+      if (size > std::numeric_limits<std::size_t>::max()) {
+        ThrowRuntimeError("JSSerializedValue", "The serialized value is too large.");
+      }
+      return static_cast<std::size_t>(size);
+    }
+
+    std::size_t ReadCount(std::size_t item_size) {
+      const auto count = ReadSize();
+      if (count > (size__ - offset__) / item_size) {
+        ThrowRuntimeError("JSSerializedValue", "The serialized value is truncated.");
+      }
+      return count;
+    }
+
+    Value ReadValue() {
+      Value value;
+      value.type   = static_cast<Type>(ReadNumber<std::uint8_t>());
+      value.number = ReadNumber<double>();
+      value.index  = ReadSize();
+      return value;
+    }
+
+    // Deserialize trusts every index, so each one is checked here.
+    void Validate() const {
+      const auto& serialized_value = serialized_value__;
+      ValidateValue(serialized_value.root__);
+
+      for (const auto& object : serialized_value.objects__) {
+        if (object.first_property > serialized_value.properties__.size() || object.property_count > serialized_value.properties__.size() - object.first_property) {
+          ThrowInvalidIndex();
+        }
+        const auto name_limit = object.type == ObjectType::Array ? std::numeric_limits<unsigned>::max() : serialized_value.strings__.size();
+        for (std::size_t i = object.first_property; i < object.first_property + object.property_count; ++i) {
+          const auto& property = serialized_value.properties__[i];
+          if (property.name >= name_limit) {
+            ThrowInvalidIndex();
+          }
+          ValidateValue(property.value);
+        }
+
+        switch (object.type) {
+          case ObjectType::Object:
+          case ObjectType::Array:
+          case ObjectType::Date:
+            break;
+
+          case ObjectType::ArrayBuffer:
+            if (object.buffer >= serialized_value.buffers__.size()) {
+              ThrowInvalidIndex();
+            }
+            break;
+
+          case ObjectType::TypedArray: {
+            if (object.buffer >= serialized_value.objects__.size() || serialized_value.objects__[object.buffer].type != ObjectType::ArrayBuffer) {
+              ThrowInvalidIndex();
+            }
+            // The ArrayBuffer may come after the typed array, so its
+            // buffer hasn't necessarily been checked yet.
+            const auto buffer = serialized_value.objects__[object.buffer].buffer;
+            if (buffer >= serialized_value.buffers__.size()) {
+              ThrowInvalidIndex();
+            }
+#ifdef HAL_TYPED_ARRAY_ENABLE
+            const auto element_size = GetTypedArrayElementSize(object.typed_array_type);
+            if (element_size == 0) {
+              ThrowRuntimeError("JSSerializedValue", "The serialized value contains a typed array of an unknown type.");
+            }
+            const auto byte_length = serialized_value.buffers__[buffer].byte_length;
+            if (object.byte_offset > byte_length || object.byte_offset % element_size != 0 || object.length > (byte_length - object.byte_offset) / element_size) {
+              ThrowRuntimeError("JSSerializedValue", "The serialized value contains a typed array outside of its ArrayBuffer.");
+            }
+#endif
+            break;
+          }
+
+          default:
+            ThrowRuntimeError("JSSerializedValue", "The serialized value contains an object of an unknown type.");
+        }
+      }
+    }
+
+    void ValidateValue(const Value& value) const {
+      switch (value.type) {
+        case Type::Undefined:
+        case Type::Null:
+        case Type::Boolean:
+        case Type::Number:
+          return;
+
+        case Type::String:
+          if (value.index >= serialized_value__.strings__.size()) {
+            ThrowInvalidIndex();
+          }
+          return;
+
+        case Type::Object:
+          if (value.index >= serialized_value__.objects__.size()) {
+            ThrowInvalidIndex();
+          }
+          return;
+      }
+      ThrowRuntimeError("JSSerializedValue", "The serialized value contains a value of an unknown type.");
+    }
+
+    static void ThrowInvalidIndex() {
+      ThrowRuntimeError("JSSerializedValue", "The serialized value refers to something it doesn't contain.");
+    }
+
+    JSSerializedValue& serialized_value__;
+    const char*        data__;
+    std::size_t        size__;
+    std::size_t        offset__ { 0 };
+  };
+
+  class JSSerializedValue::Writer final : public JSValueCloner::Target {
+
+  public:
+
+    Writer(JSSerializedValue& serialized_value, JSContextRef context_ref, const std::vector<JSObjectRef>& transfer)
+    : serialized_value__(serialized_value)
+    , context_ref__(context_ref)
+    , transfer__(transfer) {
+#ifdef HAL_TYPED_ARRAY_ENABLE
+      for (const auto js_object_ref : transfer__) {
+        JSValueRef exception { nullptr };
+        const auto type = JSValueGetTypedArrayType(context_ref__, js_object_ref, &exception);
+        ThrowIfException(context_ref__, exception);
+        if (type != kJSTypedArrayTypeArrayBuffer) {
+          ThrowInvalidArgument("JSMessagePort", "Only ArrayBuffers can be transferred.");
+        }
+      }
+#else
+      if (!transfer__.empty()) {
+        ThrowInvalidArgument("JSMessagePort", "Transferring ArrayBuffers needs HAL_TYPED_ARRAY_ENABLE.");
+      }
+#endif
+    }
+
+    Writer(const Writer&)            = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    void Write(JSValueRef js_value_ref) {
+      JSValueCloner cloner(context_ref__, *this, "JSMessagePort");
+      serialized_value__.root__ = ToValue(cloner.Clone(js_value_ref));
+    }
+
+    virtual void AddObject(const JSValueCloner::Object& object) override {
+      Object serialized_object { object.type, object.time, 0, 0, object.buffer, object.byte_offset, object.length, object.typed_array_type };
+      if (object.type == ObjectType::ArrayBuffer) {
+        serialized_object.buffer = WriteBuffer(object);
+      }
+      serialized_value__.objects__.push_back(serialized_object);
+    }
+
+    // The JSValueCloner sets the properties of each object one after
+    // the other, so they end up next to each other.
+    virtual void SetProperty(std::size_t id, JSStringRef name, unsigned index, const JSValueCloner::Value& value) override {
+      auto& serialized_value = serialized_value__;
+      std::size_t property_name = index;
+      if (name) {
+        property_name = serialized_value.strings__.size();
+        serialized_value.strings__.push_back(JSString(name));
+      }
+      const auto serialized_property_value = ToValue(value);
+
+      auto& object = serialized_value.objects__[id];
+      if (object.property_count == 0) {
+        object.first_property = serialized_value.properties__.size();
+      }
+      ++object.property_count;
+      serialized_value.properties__.push_back({ property_name, serialized_property_value });
+    }
+
+  private:
+
+    Value ToValue(const JSValueCloner::Value& value) {
+      Value serialized_value { value.type, value.number, value.object };
+      if (value.type == Type::String) {
+        serialized_value.index = serialized_value__.strings__.size();
+        serialized_value__.strings__.push_back(JSString(value.string));
+      }
+      return serialized_value;
+    }
+
+    // The bytes of a transferred ArrayBuffer aren't copied. It is kept
+    // alive until the last ArrayBuffer recreated from it is collected,
+    // which happens on the receiving thread, so it is then released on
+    // the JSRunLoop of its own context.
+    std::size_t WriteBuffer(const JSValueCloner::Object& object) {
+      Buffer buffer { nullptr, object.bytes, object.byte_length };
+      if (std::find(transfer__.begin(), transfer__.end(), object.source_ref) != transfer__.end()) {
+        buffer.owner = JSValueCloner::RetainOnRunLoop(context_ref__, object.source_ref);
+      } else {
+        const std::shared_ptr<char> copy(new char[object.byte_length], std::default_delete<char[]>());
+        std::memcpy(copy.get(), object.bytes, object.byte_length);
+        buffer.owner = copy;
+        buffer.bytes = copy.get();
+      }
+
+      const auto index = serialized_value__.buffers__.size();
+      serialized_value__.buffers__.push_back(buffer);
+      return index;
+    }
+
+    JSSerializedValue&              serialized_value__;
+    JSContextRef                    context_ref__;
+    const std::vector<JSObjectRef>& transfer__;
+  };
+
+  JSSerializedValue::JSSerializedValue(JSContextRef context_ref, JSValueRef js_value_ref, const std::vector<JSObjectRef>& transfer) {
+    Writer writer(*this, context_ref, transfer);
+    writer.Write(js_value_ref);
+  }
+
+  JSSerializedValue::JSSerializedValue(const char* data, std::size_t size) {
+    Reader reader(*this, data, size);
+    reader.Read();
+  }
+
+  void JSSerializedValue::WriteTo(std::string& bytes) const {
+    const auto append_value = [&bytes](const Value& value) {
+      Append(bytes, static_cast<std::uint8_t>(value.type));
+      Append(bytes, value.number);
+      AppendSize(bytes, value.index);
+    };
+
+    bytes.append(kMagic, sizeof(kMagic));
+    Append(bytes, kVersion);
+    Append(bytes, kByteOrder);
+    AppendSize(bytes, objects__.size());
+    AppendSize(bytes, properties__.size());
+    AppendSize(bytes, strings__.size());
+    AppendSize(bytes, buffers__.size());
+    append_value(root__);
+
+    for (const auto& object : objects__) {
+      Append(bytes, static_cast<std::uint8_t>(object.type));
+      Append(bytes, object.time);
+      AppendSize(bytes, object.first_property);
+      AppendSize(bytes, object.property_count);
+      AppendSize(bytes, object.buffer);
+      AppendSize(bytes, object.byte_offset);
+      AppendSize(bytes, object.length);
+      Append(bytes, object.typed_array_type);
+    }
+
+    for (const auto& property : properties__) {
+      AppendSize(bytes, property.name);
+      append_value(property.value);
+    }
+
+    for (const auto& string : strings__) {
+      const auto js_string_ref = static_cast<JSStringRef>(string);
+      const auto length        = JSStringGetLength(js_string_ref);
+      AppendSize(bytes, length);
+      bytes.append(reinterpret_cast<const char*>(JSStringGetCharactersPtr(js_string_ref)), length * sizeof(JSChar));
+    }
+
+    for (const auto& buffer : buffers__) {
+      AppendSize(bytes, buffer.byte_length);
+      bytes.append(static_cast<const char*>(buffer.bytes), buffer.byte_length);
+    }
+  }
+
+  JSValueRef JSSerializedValue::Deserialize(JSContextRef context_ref) const {
+    // The objects are protected until they are all reachable from the
+    // root.
+    struct ObjectRefs {
+      ObjectRefs(JSContextRef context_ref, std::size_t count)
+      : context_ref(context_ref)
+      , refs(count, nullptr) {
+      }
+
+      ~ObjectRefs() {
+        for (const auto js_object_ref : refs) {
+          if (js_object_ref) {
+            detail::UnprotectJSValue(context_ref, js_object_ref);
+          }
+        }
+      }
+
+      JSContextRef             context_ref;
+      std::vector<JSObjectRef> refs;
+    } object_refs(context_ref, objects__.size());
+
+    // ArrayBuffers first, since typed arrays are views of them.
+    for (const bool buffers : { true, false }) {
+      for (std::size_t id = 0; id < objects__.size(); ++id) {
+        const auto& object = objects__[id];
+        if ((object.type == ObjectType::ArrayBuffer) != buffers) {
+          continue;
+        }
+
+        JSValueRef  exception { nullptr };
+        JSObjectRef js_object_ref { nullptr };
+        switch (object.type) {
+          case ObjectType::Object:
+            js_object_ref = JSObjectMake(context_ref, nullptr, nullptr);
+            break;
+
+          case ObjectType::Array:
+            js_object_ref = JSObjectMakeArray(context_ref, 0, nullptr, &exception);
+            break;
+
+          case ObjectType::Date: {
+            const JSValueRef arguments[] = { JSValueMakeNumber(context_ref, object.time) };
+            js_object_ref = JSObjectMakeDate(context_ref, 1, arguments, &exception);
+            break;
+          }
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+          case ObjectType::ArrayBuffer: {
+            // Every recreated ArrayBuffer shares the owner of the bytes.
+            const auto& buffer = buffers__[object.buffer];
+            const auto  owner  = buffer.owner;
+            std::unique_ptr<JSBytesDeallocator> deallocator_ptr(new JSBytesDeallocator([owner](void*) {
+            }));
+            js_object_ref = JSObjectMakeArrayBufferWithBytesNoCopy(context_ref, buffer.bytes, buffer.byte_length, DeallocateBytes, deallocator_ptr.get(), &exception);
+            if (js_object_ref && !exception) {
+              // JavaScriptCore now owns the deallocator.
+              deallocator_ptr.release();
+            }
+            break;
+          }
+
+          case ObjectType::TypedArray:
+            js_object_ref = JSObjectMakeTypedArrayWithArrayBufferAndOffset(context_ref, static_cast<JSTypedArrayType>(object.typed_array_type), object_refs.refs[object.buffer], object.byte_offset, object.length, &exception);
+            break;
+#endif
+
+          default:
+            ThrowRuntimeError("JSMessagePort", "Unable to deserialize an object of this type.");
+        }
+
+        ThrowIfException(context_ref, exception);
+        if (!js_object_ref) {
+          ThrowRuntimeError("JSMessagePort", "Unable to deserialize an object.");
+        }
+        detail::ProtectJSValue(context_ref, js_object_ref);
+        object_refs.refs[id] = js_object_ref;
+      }
+    }
+
+    for (std::size_t id = 0; id < objects__.size(); ++id) {
+      const auto& object        = objects__[id];
+      const auto  js_object_ref = object_refs.refs[id];
+      for (std::size_t i = object.first_property; i < object.first_property + object.property_count; ++i) {
+        const auto& property  = properties__[i];
+        const auto  value_ref = ToJSValueRef(context_ref, property.value, object_refs.refs);
+        JSValueRef exception { nullptr };
+        if (object.type == ObjectType::Array) {
+          JSObjectSetPropertyAtIndex(context_ref, js_object_ref, static_cast<unsigned>(property.name), value_ref, &exception);
+        } else {
+          JSObjectSetProperty(context_ref, js_object_ref, static_cast<JSStringRef>(strings__[property.name]), value_ref, kJSPropertyAttributeNone, &exception);
+        }
+        ThrowIfException(context_ref, exception);
+      }
+    }
+
+    return ToJSValueRef(context_ref, root__, object_refs.refs);
+  }
+
+  JSValueRef JSSerializedValue::ToJSValueRef(JSContextRef context_ref, const Value& value, const std::vector<JSObjectRef>& object_refs) const {
+    switch (value.type) {
+      case Type::Undefined:
+        return JSValueMakeUndefined(context_ref);
+
+      case Type::Null:
+        return JSValueMakeNull(context_ref);
+
+      case Type::Boolean:
+        return JSValueMakeBoolean(context_ref, value.number != 0);
+
+      case Type::Number:
+        return JSValueMakeNumber(context_ref, value.number);
+
+      case Type::String:
+        return JSValueMakeString(context_ref, static_cast<JSStringRef>(strings__[value.index]));
+
+      case Type::Object:
+        return object_refs[value.index];
+    }
+
+    return JSValueMakeUndefined(context_ref);
+  }
+
+}} // namespace HAL { namespace detail {
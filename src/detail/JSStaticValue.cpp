@@ -14,7 +14,7 @@
 namespace HAL { namespace detail {
   
   JSStaticValue::JSStaticValue(const ::JSStaticValue& js_static_value)
-  : JSPropertyCallback(js_static_value.name, FromJSPropertyAttributes(js_static_value.attributes))
+  : JSPropertyCallback(js_static_value.name, JSPropertyAttributeSet::FromBits(js_static_value.attributes))
   , get_callback__(js_static_value.getProperty)
   , set_callback__(js_static_value.setProperty) {
     
@@ -22,7 +22,7 @@ namespace HAL { namespace detail {
       ThrowInvalidArgument("JSStaticValue", "Both get_callback and set_callback are missing. At least one callback must be provided");
     }
     
-    if (attributes__.find(JSPropertyAttribute::ReadOnly) != attributes__.end()) {
+    if (attributes__.Contains(JSPropertyAttribute::ReadOnly)) {
       if (!get_callback__) {
         ThrowInvalidArgument("JSStaticValue", "ReadOnly attribute is set but get_callback is missing");
       }
@@ -35,7 +35,7 @@ namespace HAL { namespace detail {
     // Force the ReadOnly attribute if only the get_callback is
     // provided.
     if (get_callback__ && !set_callback__) {
-      attributes__.insert(JSPropertyAttribute::ReadOnly);
+      attributes__ |= JSPropertyAttribute::ReadOnly;
     }
   }
   
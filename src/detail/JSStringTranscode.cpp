@@ -0,0 +1,342 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSStringTranscode.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#undef  HAL_JSSTRINGTRANSCODE_SSE2
+#undef  HAL_JSSTRINGTRANSCODE_NEON
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAL_JSSTRINGTRANSCODE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+// The horizontal max used to test for ASCII is only available on
+// AArch64, so 32-bit ARM takes the scalar path.
+#define HAL_JSSTRINGTRANSCODE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+  // Strings up to this many code units are transcoded through a stack
+  // buffer.
+  const std::size_t kStackBufferSize = 256;
+
+  // Both vector paths handle 16 code units per iteration.
+  const std::size_t kBlockSize = 16;
+
+}
+
+namespace HAL { namespace detail {
+
+  std::size_t NarrowASCII(const JSChar* input, std::size_t length, char* output) HAL_NOEXCEPT {
+    const auto source = reinterpret_cast<const std::uint16_t*>(input);
+    std::size_t i = 0;
+
+#if defined(HAL_JSSTRINGTRANSCODE_SSE2)
+    const __m128i non_ascii_mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero           = _mm_setzero_si128();
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      const __m128i low  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+      const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 8));
+      const __m128i bits = _mm_and_si128(_mm_or_si128(low, high), non_ascii_mask);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(bits, zero)) != 0xFFFF) {
+        break;
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(low, high));
+    }
+#elif defined(HAL_JSSTRINGTRANSCODE_NEON)
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      const uint16x8_t low  = vld1q_u16(source + i);
+      const uint16x8_t high = vld1q_u16(source + i + 8);
+      if (vmaxvq_u16(vorrq_u16(low, high)) >= 0x80) {
+        break;
+      }
+      vst1q_u8(reinterpret_cast<std::uint8_t*>(output + i), vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+    }
+#endif
+
+    // The tail, and the block that contained a non-ASCII code unit.
+    for (; i < length && source[i] < 0x80; ++i) {
+      output[i] = static_cast<char>(source[i]);
+    }
+
+    return i;
+  }
+
+  std::size_t WidenASCII(const char* input, std::size_t length, JSChar* output) HAL_NOEXCEPT {
+    const auto source      = reinterpret_cast<const std::uint8_t*>(input);
+    const auto destination = reinterpret_cast<std::uint16_t*>(output);
+    std::size_t i = 0;
+
+#if defined(HAL_JSSTRINGTRANSCODE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+      if (_mm_movemask_epi8(bytes) != 0) {
+        break;
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i)    , _mm_unpacklo_epi8(bytes, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 8), _mm_unpackhi_epi8(bytes, zero));
+    }
+#elif defined(HAL_JSSTRINGTRANSCODE_NEON)
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      const uint8x16_t bytes = vld1q_u8(source + i);
+      if (vmaxvq_u8(bytes) >= 0x80) {
+        break;
+      }
+      vst1q_u16(destination + i    , vmovl_u8(vget_low_u8(bytes)));
+      vst1q_u16(destination + i + 8, vmovl_u8(vget_high_u8(bytes)));
+    }
+#endif
+
+    for (; i < length && source[i] < 0x80; ++i) {
+      destination[i] = source[i];
+    }
+
+    return i;
+  }
+
+  std::size_t CountASCII(const char* input, std::size_t length) HAL_NOEXCEPT {
+    const auto source = reinterpret_cast<const std::uint8_t*>(input);
+    std::size_t i = 0;
+
+#if defined(HAL_JSSTRINGTRANSCODE_SSE2)
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      if (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i))) != 0) {
+        break;
+      }
+    }
+#elif defined(HAL_JSSTRINGTRANSCODE_NEON)
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      if (vmaxvq_u8(vld1q_u8(source + i)) >= 0x80) {
+        break;
+      }
+    }
+#endif
+
+    for (; i < length && source[i] < 0x80; ++i) {
+    }
+
+    return i;
+  }
+
+  void WidenLatin1(const char* input, std::size_t length, JSChar* output) HAL_NOEXCEPT {
+    const auto source      = reinterpret_cast<const std::uint8_t*>(input);
+    const auto destination = reinterpret_cast<std::uint16_t*>(output);
+    std::size_t i = 0;
+
+    // Every Latin-1 character is the UTF-16 code unit of the same
+    // value, so this is a plain zero extension.
+#if defined(HAL_JSSTRINGTRANSCODE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i)    , _mm_unpacklo_epi8(bytes, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 8), _mm_unpackhi_epi8(bytes, zero));
+    }
+#elif defined(HAL_JSSTRINGTRANSCODE_NEON)
+    for (; i + kBlockSize <= length; i += kBlockSize) {
+      const uint8x16_t bytes = vld1q_u8(source + i);
+      vst1q_u16(destination + i    , vmovl_u8(vget_low_u8(bytes)));
+      vst1q_u16(destination + i + 8, vmovl_u8(vget_high_u8(bytes)));
+    }
+#endif
+
+    for (; i < length; ++i) {
+      destination[i] = source[i];
+    }
+  }
+
+  std::size_t TranscodeUTF16ToUTF8(const JSChar* input, std::size_t length, char* output) HAL_NOEXCEPT {
+    const auto source = reinterpret_cast<const std::uint16_t*>(input);
+    auto destination  = reinterpret_cast<std::uint8_t*>(output);
+    std::size_t i = 0;
+
+    while (i < length) {
+      const auto ascii_length = NarrowASCII(input + i, length - i, reinterpret_cast<char*>(destination));
+      i           += ascii_length;
+      destination += ascii_length;
+
+      // Encode code units one at a time until the next ASCII one, then
+      // go back to the block path.
+      while (i < length && source[i] >= 0x80) {
+        std::uint32_t code_point = source[i++];
+        if (code_point >= 0xD800 && code_point <= 0xDBFF && i < length && source[i] >= 0xDC00 && source[i] <= 0xDFFF) {
+          code_point = 0x10000 + ((code_point - 0xD800) << 10) + (source[i++] - 0xDC00);
+        } else if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+          code_point = 0xFFFD;
+        }
+
+        if (code_point < 0x800) {
+          *destination++ = static_cast<std::uint8_t>(0xC0 | (code_point >> 6));
+          *destination++ = static_cast<std::uint8_t>(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+          *destination++ = static_cast<std::uint8_t>(0xE0 | (code_point >> 12));
+          *destination++ = static_cast<std::uint8_t>(0x80 | ((code_point >> 6) & 0x3F));
+          *destination++ = static_cast<std::uint8_t>(0x80 | (code_point & 0x3F));
+        } else {
+          *destination++ = static_cast<std::uint8_t>(0xF0 | (code_point >> 18));
+          *destination++ = static_cast<std::uint8_t>(0x80 | ((code_point >> 12) & 0x3F));
+          *destination++ = static_cast<std::uint8_t>(0x80 | ((code_point >> 6) & 0x3F));
+          *destination++ = static_cast<std::uint8_t>(0x80 | (code_point & 0x3F));
+        }
+      }
+    }
+
+    return static_cast<std::size_t>(destination - reinterpret_cast<std::uint8_t*>(output));
+  }
+
+  std::size_t TranscodeUTF8ToUTF16(const char* input, std::size_t length, JSChar* output) HAL_NOEXCEPT {
+    const auto source = reinterpret_cast<const std::uint8_t*>(input);
+    auto destination  = reinterpret_cast<std::uint16_t*>(output);
+    std::size_t i = 0;
+
+    while (i < length) {
+      const auto ascii_length = WidenASCII(input + i, length - i, reinterpret_cast<JSChar*>(destination));
+      i           += ascii_length;
+      destination += ascii_length;
+
+      while (i < length && source[i] >= 0x80) {
+        const std::uint8_t lead = source[i];
+        std::size_t   trail_count = 0;
+        std::uint32_t code_point  = 0;
+        std::uint8_t  minimum     = 0x80;
+        std::uint8_t  maximum     = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+          trail_count = 1;
+          code_point  = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+          trail_count = 2;
+          code_point  = lead & 0x0F;
+          // Reject overlong forms and encoded surrogates.
+          if (lead == 0xE0) { minimum = 0xA0; }
+          if (lead == 0xED) { maximum = 0x9F; }
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+          trail_count = 3;
+          code_point  = lead & 0x07;
+          // Reject overlong forms and code points above U+10FFFF.
+          if (lead == 0xF0) { minimum = 0x90; }
+          if (lead == 0xF4) { maximum = 0x8F; }
+        }
+
+        // Consume the longest valid prefix of the sequence, and emit a
+        // single U+FFFD if it is incomplete.
+        std::size_t consumed = 1;
+        bool valid = trail_count > 0;
+        for (std::size_t j = 0; valid && j < trail_count; ++j) {
+          if (i + consumed >= length) {
+            valid = false;
+            break;
+          }
+          const std::uint8_t trail = source[i + consumed];
+          if (trail < (j == 0 ? minimum : 0x80) || trail > (j == 0 ? maximum : 0xBF)) {
+            valid = false;
+            break;
+          }
+          code_point = (code_point << 6) | (trail & 0x3F);
+          ++consumed;
+        }
+        i += consumed;
+
+        if (!valid) {
+          *destination++ = 0xFFFD;
+        } else if (code_point >= 0x10000) {
+          *destination++ = static_cast<std::uint16_t>(0xD800 + ((code_point - 0x10000) >> 10));
+          *destination++ = static_cast<std::uint16_t>(0xDC00 + ((code_point - 0x10000) & 0x3FF));
+        } else {
+          *destination++ = static_cast<std::uint16_t>(code_point);
+        }
+      }
+    }
+
+    return static_cast<std::size_t>(destination - reinterpret_cast<std::uint16_t*>(output));
+  }
+
+  std::string ToUTF8String(JSStringRef js_string_ref) {
+    const auto length = JSStringGetLength(js_string_ref);
+    if (length == 0) {
+      return std::string();
+    }
+
+    // Short strings, which are mostly property names, are transcoded
+    // into a stack buffer. Together with std::string's own small
+    // string optimization they need no heap allocation.
+    char stack_buffer[3 * kStackBufferSize];
+    std::unique_ptr<char[]> heap_buffer;
+    char* buffer = stack_buffer;
+    if (length > kStackBufferSize) {
+      heap_buffer.reset(new char[3 * length]);
+      buffer = heap_buffer.get();
+    }
+
+    const auto size = TranscodeUTF16ToUTF8(JSStringGetCharactersPtr(js_string_ref), length, buffer);
+    return std::string(buffer, size);
+  }
+
+  void AppendUTF8String(JSStringRef js_string_ref, std::string& buffer) {
+    // Transcode into the tail and trim the excess of the worst case of
+    // three bytes per code unit.
+    const auto length = JSStringGetLength(js_string_ref);
+    const auto size   = buffer.size();
+    buffer.resize(size + 3 * length);
+    const auto written = TranscodeUTF16ToUTF8(JSStringGetCharactersPtr(js_string_ref), length, &buffer[size]);
+    buffer.resize(size + written);
+  }
+
+  JSStringRef CreateJSStringRefWithUTF8(const char* string, std::size_t length) {
+    ++GetJSBudgetCounts().string_create_count;
+    StartJSRuntime();
+    const auto ascii_length = CountASCII(string, length);
+
+    // JSStringCreateWithUTF8CString stops at the first null character,
+    // so ASCII containing one is widened like any other string.
+    if (ascii_length == length && (length == 0 || !std::memchr(string, '\0', length))) {
+      // string needn't be null-terminated, so it is copied with a
+      // terminator first.
+      char stack_buffer[kStackBufferSize];
+      std::unique_ptr<char[]> heap_buffer;
+      char* buffer = stack_buffer;
+      if (length >= kStackBufferSize) {
+        heap_buffer.reset(new char[length + 1]);
+        buffer = heap_buffer.get();
+      }
+      if (length > 0) {
+        std::memcpy(buffer, string, length);
+      }
+      buffer[length] = '\0';
+      return JSStringCreateWithUTF8CString(buffer);
+    }
+
+    JSChar stack_buffer[kStackBufferSize];
+    std::unique_ptr<JSChar[]> heap_buffer;
+    JSChar* buffer = stack_buffer;
+    if (length > kStackBufferSize) {
+      heap_buffer.reset(new JSChar[length]);
+      buffer = heap_buffer.get();
+    }
+
+    WidenASCII(string, ascii_length, buffer);
+    const auto size = ascii_length + TranscodeUTF8ToUTF16(string + ascii_length, length - ascii_length, buffer + ascii_length);
+    return JSStringCreateWithCharacters(buffer, size);
+  }
+
+  std::uint64_t HashUTF16(const JSChar* characters, std::size_t length) HAL_NOEXCEPT {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < length; ++i) {
+      hash ^= static_cast<std::uint16_t>(characters[i]);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,106 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSTaskLane.hpp"
+
+namespace HAL {
+
+  const char* to_string(JSTaskPriority priority) HAL_NOEXCEPT {
+    switch (priority) {
+      case JSTaskPriority::High:
+        return "High";
+      case JSTaskPriority::Normal:
+        return "Normal";
+      case JSTaskPriority::Background:
+        return "Background";
+    }
+    return "Unknown";
+  }
+
+} // namespace HAL {
+
+namespace HAL { namespace detail {
+
+  JSTaskLane::JSTaskLane() HAL_NOEXCEPT {
+  }
+
+  JSTaskQueueOptions JSTaskLane::get_options() const HAL_NOEXCEPT {
+    JSTaskQueueOptions options;
+    options.capacity = capacity__.load(std::memory_order_relaxed);
+    options.policy   = static_cast<JSBackpressurePolicy>(policy__.load(std::memory_order_relaxed));
+    return options;
+  }
+
+  void JSTaskLane::set_options(const JSTaskQueueOptions& options) HAL_NOEXCEPT {
+    policy__.store(static_cast<std::uint8_t>(options.policy), std::memory_order_relaxed);
+    capacity__.store(options.capacity, std::memory_order_relaxed);
+  }
+
+  JSTaskLane::Admission JSTaskLane::Admit(bool may_block) HAL_NOEXCEPT {
+    const auto capacity = capacity__.load(std::memory_order_relaxed);
+    const auto policy   = static_cast<JSBackpressurePolicy>(policy__.load(std::memory_order_relaxed));
+    if (capacity == 0 || policy == JSBackpressurePolicy::DropOldest) {
+      ++queued_count__;
+      ++enqueued_count__;
+      return Admission::Accept;
+    }
+
+    // Claim a slot, so that concurrent producers can't overfill the
+    // lane between checking it and queuing.
+    auto queued_count = queued_count__.load();
+    while (queued_count < capacity) {
+      if (queued_count__.compare_exchange_weak(queued_count, queued_count + 1)) {
+        ++enqueued_count__;
+        return Admission::Accept;
+      }
+    }
+
+    if (policy == JSBackpressurePolicy::Block && may_block) {
+      return Admission::Full;
+    }
+
+    ++rejected_count__;
+    return Admission::Reject;
+  }
+
+  bool JSTaskLane::has_capacity() const HAL_NOEXCEPT {
+    const auto capacity = capacity__.load(std::memory_order_relaxed);
+    return capacity == 0 || queued_count__.load() < capacity;
+  }
+
+  bool JSTaskLane::is_overflowing() const HAL_NOEXCEPT {
+    const auto capacity = capacity__.load(std::memory_order_relaxed);
+    return capacity != 0 && queued_count__.load() > capacity;
+  }
+
+  void JSTaskLane::Drop() HAL_NOEXCEPT {
+    --queued_count__;
+    dropped_count__.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void JSTaskLane::Complete(std::chrono::steady_clock::duration queueing_delay) HAL_NOEXCEPT {
+    --queued_count__;
+    const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(queueing_delay).count();
+    queueing_delay__.Record(nanoseconds > 0 ? static_cast<std::uint64_t>(nanoseconds) : 0);
+  }
+
+  JSTaskLaneStatistics JSTaskLane::GetStatistics() const HAL_NOEXCEPT {
+    JSTaskLaneStatistics statistics;
+    statistics.queued_count         = queued_count__.load(std::memory_order_relaxed);
+    statistics.enqueued_count       = enqueued_count__.load(std::memory_order_relaxed);
+    statistics.run_count            = queueing_delay__.get_count();
+    statistics.rejected_count       = rejected_count__.load(std::memory_order_relaxed);
+    statistics.dropped_count        = dropped_count__.load(std::memory_order_relaxed);
+    statistics.total_queueing_delay = std::chrono::nanoseconds(queueing_delay__.get_total_nanoseconds());
+    statistics.max_queueing_delay   = std::chrono::nanoseconds(queueing_delay__.get_max_nanoseconds());
+    statistics.p50_queueing_delay   = std::chrono::nanoseconds(queueing_delay__.GetPercentile(50));
+    statistics.p99_queueing_delay   = std::chrono::nanoseconds(queueing_delay__.GetPercentile(99));
+    return statistics;
+  }
+
+}} // namespace HAL { namespace detail {
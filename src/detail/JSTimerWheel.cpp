@@ -0,0 +1,124 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSTimerWheel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <limits>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    const std::uint64_t kSlotMask = JSTimerWheel::kSlotCount - 1;
+
+    std::uint64_t GetLevelShift(std::size_t level) HAL_NOEXCEPT {
+      return JSTimerWheel::kSlotBits * level;
+    }
+
+  } // namespace {
+
+  void JSTimerWheel::Schedule(std::uint64_t id, std::uint64_t expiry_tick) {
+    assert(positions__.find(id) == positions__.end());
+    Place(Timer { id, std::max(expiry_tick, current_tick__ + 1) });
+  }
+
+  bool JSTimerWheel::Cancel(std::uint64_t id) {
+    const auto position = positions__.find(id);
+    if (position == positions__.end()) {
+      return false;
+    }
+
+    position -> second.slot -> erase(position -> second.iterator);
+    positions__.erase(position);
+    return true;
+  }
+
+  void JSTimerWheel::Advance(std::uint64_t tick, std::vector<std::uint64_t>& expired_ids) {
+    while (current_tick__ < tick) {
+      // Nothing happens on the ticks before the next event, so skip
+      // straight to it.
+      const auto next_event_tick = GetNextEventTick();
+      if (next_event_tick == 0 || next_event_tick > tick) {
+        current_tick__ = tick;
+        return;
+      }
+      current_tick__ = next_event_tick;
+
+      // Cascade the highest level first, so that its timers can land
+      // in the lower level slots cascaded right after it.
+      std::size_t level = 1;
+      while (level < kLevelCount && (current_tick__ & ((std::uint64_t(1) << GetLevelShift(level)) - 1)) == 0) {
+        ++level;
+      }
+      for (auto cascade_level = level - 1; cascade_level >= 1; --cascade_level) {
+        Cascade(cascade_level);
+      }
+
+      auto& slot = levels__[0][current_tick__ & kSlotMask];
+      for (const auto& timer : slot) {
+        expired_ids.push_back(timer.id);
+        positions__.erase(timer.id);
+      }
+      slot.clear();
+    }
+  }
+
+  std::uint64_t JSTimerWheel::GetNextEventTick() const HAL_NOEXCEPT {
+    if (positions__.empty()) {
+      return 0;
+    }
+
+    // The next event of a level is the start of its first non-empty
+    // slot after the current one.
+    auto next_event_tick = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t level = 0; level < kLevelCount; ++level) {
+      const auto shift = GetLevelShift(level);
+      const auto base  = current_tick__ >> shift;
+      for (std::uint64_t offset = 1; offset <= kSlotCount; ++offset) {
+        if (! levels__[level][(base + offset) & kSlotMask].empty()) {
+          next_event_tick = std::min(next_event_tick, (base + offset) << shift);
+          break;
+        }
+      }
+    }
+
+    return next_event_tick;
+  }
+
+  void JSTimerWheel::Place(const Timer& timer) {
+    const auto delta = timer.expiry_tick - current_tick__;
+    std::size_t level = 0;
+    while (level + 1 < kLevelCount && delta >= (std::uint64_t(1) << GetLevelShift(level + 1))) {
+      ++level;
+    }
+
+    // A timer beyond the top level is parked in the top level slot
+    // furthest out, and placed again when that slot is cascaded.
+    auto slot_tick = timer.expiry_tick;
+    const auto top_level_span = std::uint64_t(1) << GetLevelShift(kLevelCount);
+    if (delta >= top_level_span) {
+      slot_tick = current_tick__ + top_level_span - 1;
+    }
+
+    auto& slot = levels__[level][(slot_tick >> GetLevelShift(level)) & kSlotMask];
+    slot.push_back(timer);
+    positions__[timer.id] = Position { &slot, std::prev(slot.end()) };
+  }
+
+  void JSTimerWheel::Cascade(std::size_t level) {
+    Slot timers;
+    timers.swap(levels__[level][(current_tick__ >> GetLevelShift(level)) & kSlotMask]);
+    for (const auto& timer : timers) {
+      Place(timer);
+    }
+  }
+
+}} // namespace HAL { namespace detail {
@@ -7,6 +7,7 @@
  */
 
 #include "HAL/detail/JSUtil.hpp"
+#include "HAL/detail/JSAtoms.hpp"
 #include "HAL/JSString.hpp"
 #include "HAL/JSValue.hpp"
 #include "HAL/JSObject.hpp"
@@ -23,16 +24,36 @@
 
 namespace HAL { namespace detail {
 
-  js_runtime_error::js_runtime_error(const JSError& js_error) : std::runtime_error(js_error.message()) {
-    js_name__       = js_error.name();
-    js_filename__   = js_error.filename();
-    js_linenumber__ = js_error.linenumber();
-    js_stack__      = js_error.stack();
-    js_message__    = js_error.message();
+  js_runtime_error::js_runtime_error(const JSError& js_error)
+  : std::runtime_error("")
+  , js_error__(js_error) {
+  }
+
+  const char* js_runtime_error::what() const HAL_NOEXCEPT {
+    Materialize();
+    return js_message__.c_str();
+  }
+
+  void js_runtime_error::Materialize() const HAL_NOEXCEPT {
+    if (materialized__) {
+      return;
+    }
+    materialized__ = true;
+
+    try {
+      const auto js_error = static_cast<JSError>(static_cast<JSObject>(js_error__));
+      js_name__       = js_error.name();
+      js_filename__   = js_error.filename();
+      js_linenumber__ = js_error.linenumber();
+      js_stack__      = js_error.stack();
+      js_message__    = js_error.message();
+    } catch (...) {
+      // A getter of the Error threw, so keep what was read.
+    }
   }
 
   void ThrowRuntimeError(const std::string& internal_component_name, const std::string& message) {
-    HAL_LOG_ERROR(internal_component_name, ": ", message);
+    HAL_LOG_ERROR_RATE(HAL_LOG_SCRIPT_ERROR_RATE, internal_component_name, ": ", message);
     throw std::runtime_error(message);
   }
   
@@ -45,11 +66,11 @@ namespace HAL { namespace detail {
         auto js_error = static_cast<JSError>(js_exception);
 				
         // Mozilla-like detailed properties to help debug
-        if (!js_error.HasProperty("fileName")) {
-            js_error.SetProperty("fileName", js_context.CreateString(source_url));
+        if (!js_error.HasProperty(JSAtoms::fileName)) {
+            js_error.SetProperty(JSAtoms::fileName, js_context.CreateString(source_url));
         }
-        if (!js_error.HasProperty("lineNumber")) {
-          js_error.SetProperty("lineNumber", js_context.CreateNumber(line_number));
+        if (!js_error.HasProperty(JSAtoms::lineNumber)) {
+          js_error.SetProperty(JSAtoms::lineNumber, js_context.CreateNumber(line_number));
         }	
 	
         throw js_runtime_error(js_error);
@@ -57,17 +78,18 @@ namespace HAL { namespace detail {
     }
 
     const auto exception_message = to_string(exception);
-    HAL_LOG_ERROR(internal_component_name, ": ", exception_message);
+    HAL_LOG_ERROR_RATE(HAL_LOG_SCRIPT_ERROR_RATE, internal_component_name, ": ", exception_message);
     throw std::runtime_error(exception_message);
   }
   
   void ThrowInvalidArgument(const std::string& internal_component_name, const std::string& message) {
-    HAL_LOG_ERROR(internal_component_name, ": ", message);
+    HAL_LOG_ERROR_RATE(HAL_LOG_SCRIPT_ERROR_RATE, internal_component_name, ": ", message);
     throw std::invalid_argument(message);
   }
   
   std::vector<JSValue> to_vector(const JSContext& js_context, size_t count, const JSValueRef js_value_ref_array[]) {
     std::vector<JSValue> js_value_vector;
+    js_value_vector.reserve(count);
     std::transform(js_value_ref_array,
                    js_value_ref_array + count,
                    std::back_inserter(js_value_vector),
@@ -77,6 +99,7 @@ namespace HAL { namespace detail {
   
   std::vector<JSValue> to_vector(const JSContext& js_context, const std::vector<JSString>& js_string_vector) {
     std::vector<JSValue> js_value_vector;
+    js_value_vector.reserve(js_string_vector.size());
     std::transform(js_string_vector.begin(),
                    js_string_vector.end(),
                    std::back_inserter(js_value_vector),
@@ -86,6 +109,7 @@ namespace HAL { namespace detail {
   
   std::vector<JSValueRef> to_vector(const std::vector<JSValue>& js_value_vector) {
     std::vector<JSValueRef> js_value_ref_vector;
+    js_value_ref_vector.reserve(js_value_vector.size());
     std::transform(js_value_vector.begin(),
                    js_value_vector.end(),
                    std::back_inserter(js_value_ref_vector),
@@ -95,6 +119,7 @@ namespace HAL { namespace detail {
   
   std::vector<JSStringRef> to_vector(const std::vector<JSString>& js_string_vector) {
     std::vector<JSStringRef> js_string_ref_vector;
+    js_string_ref_vector.reserve(js_string_vector.size());
     std::transform(js_string_vector.begin(),
                    js_string_vector.end(),
                    std::back_inserter(js_string_ref_vector),
@@ -102,29 +127,14 @@ namespace HAL { namespace detail {
     return js_string_ref_vector;
   }
   
+#ifdef HAL_CONSTEXPR_ENABLE
+  static_assert(JSPropertyAttributeSet(JSPropertyAttribute::ReadOnly).get_bits()   == kJSPropertyAttributeReadOnly  , "JSPropertyAttributeSet bits must match JavaScriptCore's");
+  static_assert(JSPropertyAttributeSet(JSPropertyAttribute::DontEnum).get_bits()   == kJSPropertyAttributeDontEnum  , "JSPropertyAttributeSet bits must match JavaScriptCore's");
+  static_assert(JSPropertyAttributeSet(JSPropertyAttribute::DontDelete).get_bits() == kJSPropertyAttributeDontDelete, "JSPropertyAttributeSet bits must match JavaScriptCore's");
+#endif
+  
   JSPropertyAttributes ToJSPropertyAttributes(const std::unordered_set<JSPropertyAttribute>& attributes) HAL_NOEXCEPT {
-    JSPropertyAttributes result = kJSPropertyAttributeNone;
-    for (auto attribute : attributes) {
-      switch (attribute) {
-        case JSPropertyAttribute::None:
-          result |= kJSPropertyAttributeNone;
-          break;
-          
-        case JSPropertyAttribute::ReadOnly:
-          result |= kJSPropertyAttributeReadOnly;
-          break;
-          
-        case JSPropertyAttribute::DontEnum:
-          result |= kJSPropertyAttributeDontEnum;
-          break;
-          
-        case JSPropertyAttribute::DontDelete:
-          result |= kJSPropertyAttributeDontDelete;
-          break;
-      }
-    }
-    
-    return result;
+    return ToJSPropertyAttributes(JSPropertyAttributeSet(attributes));
   }
   
   std::unordered_set<JSPropertyAttribute> FromJSPropertyAttributes(::JSPropertyAttributes attributes) HAL_NOEXCEPT {
@@ -286,7 +296,7 @@ namespace HAL { namespace detail {
   // The operation can be descibed as round towards zero, then select
   // the 32 least bits of the resulting value in 2s-complement
   // representation.
-  int32_t to_int32_t(double number) {
+  int32_t to_int32_t_out_of_range(double number) {
     int64_t bits = bitwise_cast<int64_t>(number);
     int32_t exp = (static_cast<int32_t>(bits >> 52) & 0x7ff) - 0x3ff;
     
@@ -328,4 +338,299 @@ namespace HAL { namespace detail {
     return bits < 0 ? -result : result;
   }
   
+  bool ToArrayIndex(JSStringRef string_ref, std::uint32_t& index) HAL_NOEXCEPT {
+    const auto length = JSStringGetLength(string_ref);
+    
+    // 4294967294 has 10 digits.
+    if (length == 0 || length > 10) {
+      return false;
+    }
+    
+    const auto characters = JSStringGetCharactersPtr(string_ref);
+    if (characters[0] == '0') {
+      if (length != 1) {
+        return false;
+      }
+      index = 0;
+      return true;
+    }
+    
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+      const auto character = characters[i];
+      if (character < '0' || character > '9') {
+        return false;
+      }
+      value = value * 10 + (character - '0');
+    }
+    
+    if (value > 0xFFFFFFFEu) {
+      return false;
+    }
+    
+    index = static_cast<std::uint32_t>(value);
+    return true;
+  }
+  
+  namespace {
+    
+    template<typename C>
+    bool IsJSONDigit(C character) HAL_NOEXCEPT {
+      return character >= '0' && character <= '9';
+    }
+    
+    template<typename C>
+    bool IsJSONHexDigit(C character) HAL_NOEXCEPT {
+      return IsJSONDigit(character) || (character >= 'a' && character <= 'f') || (character >= 'A' && character <= 'F');
+    }
+    
+    // Each scanner starts at the first code unit of a token. On success
+    // it leaves offset just past the token, and on failure at the
+    // offending code unit.
+    template<typename C>
+    bool ScanJSONString(const C* input, std::size_t length, std::size_t& offset) HAL_NOEXCEPT {
+      ++offset;
+      while (offset < length) {
+        const auto character = input[offset];
+        if (character == '"') {
+          ++offset;
+          return true;
+        }
+        
+        if (static_cast<std::uint32_t>(character) < 0x20) {
+          return false;
+        }
+        
+        if (character == '\\') {
+          if (++offset >= length) {
+            return false;
+          }
+          
+          switch (input[offset]) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+              ++offset;
+              continue;
+            case 'u':
+              for (int i = 0; i < 4; ++i) {
+                if (++offset >= length || !IsJSONHexDigit(input[offset])) {
+                  return false;
+                }
+              }
+              ++offset;
+              continue;
+            default:
+              return false;
+          }
+        }
+        
+        ++offset;
+      }
+      
+      return false;
+    }
+    
+    template<typename C>
+    bool ScanJSONDigits(const C* input, std::size_t length, std::size_t& offset) HAL_NOEXCEPT {
+      if (offset >= length || !IsJSONDigit(input[offset])) {
+        return false;
+      }
+      
+      while (offset < length && IsJSONDigit(input[offset])) {
+        ++offset;
+      }
+      return true;
+    }
+    
+    template<typename C>
+    bool ScanJSONNumber(const C* input, std::size_t length, std::size_t& offset) HAL_NOEXCEPT {
+      if (input[offset] == '-') {
+        ++offset;
+      }
+      
+      if (offset < length && input[offset] == '0') {
+        ++offset;
+      } else if (!ScanJSONDigits(input, length, offset)) {
+        return false;
+      }
+      
+      if (offset < length && input[offset] == '.') {
+        ++offset;
+        if (!ScanJSONDigits(input, length, offset)) {
+          return false;
+        }
+      }
+      
+      if (offset < length && (input[offset] == 'e' || input[offset] == 'E')) {
+        ++offset;
+        if (offset < length && (input[offset] == '+' || input[offset] == '-')) {
+          ++offset;
+        }
+        if (!ScanJSONDigits(input, length, offset)) {
+          return false;
+        }
+      }
+      
+      return true;
+    }
+    
+    template<typename C>
+    bool ScanJSONLiteral(const C* input, std::size_t length, std::size_t& offset, const char* literal) HAL_NOEXCEPT {
+      for (; *literal; ++literal, ++offset) {
+        if (offset >= length || input[offset] != *literal) {
+          return false;
+        }
+      }
+      return true;
+    }
+    
+    template<typename C>
+    bool ScanJSONScalar(const C* input, std::size_t length, std::size_t& offset) HAL_NOEXCEPT {
+      const auto character = input[offset];
+      if (character == '"') {
+        return ScanJSONString(input, length, offset);
+      }
+      if (character == '-' || IsJSONDigit(character)) {
+        return ScanJSONNumber(input, length, offset);
+      }
+      if (character == 't') {
+        return ScanJSONLiteral(input, length, offset, "true");
+      }
+      if (character == 'f') {
+        return ScanJSONLiteral(input, length, offset, "false");
+      }
+      if (character == 'n') {
+        return ScanJSONLiteral(input, length, offset, "null");
+      }
+      return false;
+    }
+    
+    template<typename C>
+    void SkipJSONWhitespace(const C* input, std::size_t length, std::size_t& offset) HAL_NOEXCEPT {
+      while (offset < length && (input[offset] == ' ' || input[offset] == '\t' || input[offset] == '\n' || input[offset] == '\r')) {
+        ++offset;
+      }
+    }
+    
+    // Containers are tracked on an explicit stack, so deeply nested
+    // input can't overflow the native stack.
+    template<typename C>
+    bool ScanJSONValueImpl(const C* input, std::size_t length, std::size_t& offset) {
+      enum class Expect { Value, FirstValue, Key, FirstKey, Colon, Separator };
+      std::vector<char> containers;
+      auto expect = Expect::Value;
+      while (true) {
+        if (expect != Expect::Separator || !containers.empty()) {
+          SkipJSONWhitespace(input, length, offset);
+        }
+        
+        if (expect == Expect::Separator && containers.empty()) {
+          return true;
+        }
+        
+        if (offset >= length) {
+          return false;
+        }
+        
+        const auto character = input[offset];
+        if (expect == Expect::FirstValue && character == ']') {
+          containers.pop_back();
+          ++offset;
+          expect = Expect::Separator;
+        } else if (expect == Expect::FirstKey && character == '}') {
+          containers.pop_back();
+          ++offset;
+          expect = Expect::Separator;
+        } else if (expect == Expect::Value || expect == Expect::FirstValue) {
+          if (character == '[' || character == '{') {
+            containers.push_back(static_cast<char>(character));
+            ++offset;
+            expect = character == '[' ? Expect::FirstValue : Expect::FirstKey;
+          } else if (ScanJSONScalar(input, length, offset)) {
+            expect = Expect::Separator;
+          } else {
+            return false;
+          }
+        } else if (expect == Expect::Key || expect == Expect::FirstKey) {
+          if (character != '"' || !ScanJSONString(input, length, offset)) {
+            return false;
+          }
+          expect = Expect::Colon;
+        } else if (expect == Expect::Colon) {
+          if (character != ':') {
+            return false;
+          }
+          ++offset;
+          expect = Expect::Value;
+        } else {
+          const bool in_array = containers.back() == '[';
+          if (character == ',') {
+            ++offset;
+            expect = in_array ? Expect::Value : Expect::Key;
+          } else if (character == (in_array ? ']' : '}')) {
+            containers.pop_back();
+            ++offset;
+          } else {
+            return false;
+          }
+        }
+      }
+    }
+    
+    template<typename C>
+    std::size_t FindJSONErrorOffsetImpl(const C* input, std::size_t length) {
+      std::size_t offset = 0;
+      SkipJSONWhitespace(input, length, offset);
+      if (!ScanJSONValueImpl(input, length, offset)) {
+        return std::min(offset, length);
+      }
+      
+      SkipJSONWhitespace(input, length, offset);
+      return offset == length ? std::string::npos : offset;
+    }
+    
+  } // namespace {
+  
+  std::size_t FindJSONErrorOffset(const char* input, std::size_t length) {
+    return FindJSONErrorOffsetImpl(input, length);
+  }
+  
+  std::size_t FindJSONErrorOffset(const JSChar* input, std::size_t length) {
+    return FindJSONErrorOffsetImpl(input, length);
+  }
+  
+  bool ScanJSONValue(const char* input, std::size_t length, std::size_t& offset) {
+    return ScanJSONValueImpl(input, length, offset);
+  }
+  
+  bool ScanJSONValue(const JSChar* input, std::size_t length, std::size_t& offset) {
+    return ScanJSONValueImpl(input, length, offset);
+  }
+  
+  std::string EscapeJSONString(const std::string& string) {
+    std::string result;
+    result.reserve(string.size());
+    for (const auto c : string) {
+      switch (c) {
+        case '"':
+          result += "\\\"";
+          break;
+        case '\\':
+          result += "\\\\";
+          break;
+        case '\n':
+          result += "\\n";
+          break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20) {
+            result += "\\u00";
+            result += "0123456789abcdef"[(c >> 4) & 0xf];
+            result += "0123456789abcdef"[c & 0xf];
+          } else {
+            result += c;
+          }
+      }
+    }
+    return result;
+  }
+  
 }} // namespace HAL { namespace detail {
@@ -0,0 +1,381 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSValueCloner.hpp"
+
+#include "HAL/JSContext.hpp"
+#include "HAL/JSValue.hpp"
+#include "HAL/JSArrayBuffer.hpp"
+#include "HAL/JSRunLoop.hpp"
+#include "HAL/detail/JSAtoms.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSUtil.hpp"
+
+#include <cstring>
+
+namespace HAL { namespace detail {
+
+  namespace {
+
+    // Holds a value of the context of run_loop, and hands it to the run
+    // loop's thread to be released there.
+    struct RunLoopRetainedValue {
+      RunLoopRetainedValue(const JSRunLoop& run_loop, const std::shared_ptr<JSValue>& js_value) HAL_NOEXCEPT
+      : run_loop(run_loop)
+      , js_value(js_value) {
+      }
+
+      // Only the task deletes the value, so no copy of it is left here
+      // to race with the run loop's thread. If the task can't be posted,
+      // or is discarded unrun, the value is leaked rather than released
+      // on the wrong thread.
+      ~RunLoopRetainedValue() HAL_NOEXCEPT {
+        const auto js_value_ptr = new std::shared_ptr<JSValue>(std::move(js_value));
+        try {
+          run_loop.Post([js_value_ptr](const JSContext&) {
+            delete js_value_ptr;
+          });
+        } catch (...) {
+          HAL_LOG_WARN("JSValueCloner: unable to post the release of a value, which is leaked.");
+        }
+      }
+
+      JSRunLoop                run_loop;
+      std::shared_ptr<JSValue> js_value;
+    };
+
+  } // namespace {
+
+  JSValueCloner::JSValueCloner(JSContextRef source_context_ref, Target& target, const std::string& component_name)
+  : source_context_ref__(source_context_ref)
+  , target__(target)
+  , component_name__(component_name)
+  , string_ref__(nullptr, JSStringRelease) {
+  }
+
+  JSValueCloner::Value JSValueCloner::Clone(JSValueRef js_value_ref) {
+    const auto value = CloneValue(js_value_ref);
+
+    // Each object may add more, so this loop visits every object
+    // reachable from the root exactly once.
+    for (; next_object__ < objects__.size(); ++next_object__) {
+      // A copy, since objects__ grows as the properties are copied.
+      const auto object = objects__[next_object__];
+      if (object.type == ObjectType::Array) {
+        CopyElements(next_object__, object.source_ref);
+      } else if (object.type == ObjectType::Object) {
+        CopyProperties(next_object__, object.source_ref);
+      }
+    }
+
+    return value;
+  }
+
+  std::shared_ptr<void> JSValueCloner::RetainOnRunLoop(JSContextRef context_ref, JSValueRef js_value_ref) {
+    const JSContext js_context(context_ref);
+    return std::make_shared<RunLoopRetainedValue>(JSRunLoop::Get(js_context), std::make_shared<JSValue>(js_context, js_value_ref));
+  }
+
+  JSValueCloner::Value JSValueCloner::CloneValue(JSValueRef js_value_ref) {
+    Value value { ValueType::Undefined, 0, nullptr, 0 };
+    JSValueRef exception { nullptr };
+    switch (JSValueGetType(source_context_ref__, js_value_ref)) {
+      case kJSTypeUndefined:
+        break;
+
+      case kJSTypeNull:
+        value.type = ValueType::Null;
+        break;
+
+      case kJSTypeBoolean:
+        value.type   = ValueType::Boolean;
+        value.number = JSValueToBoolean(source_context_ref__, js_value_ref) ? 1 : 0;
+        break;
+
+      case kJSTypeNumber:
+        value.type   = ValueType::Number;
+        value.number = JSValueToNumber(source_context_ref__, js_value_ref, &exception);
+        ThrowIfException(exception);
+        break;
+
+      case kJSTypeString:
+        string_ref__.reset(JSValueToStringCopy(source_context_ref__, js_value_ref, &exception));
+        ThrowIfException(exception);
+        value.type   = ValueType::String;
+        value.string = string_ref__.get();
+        break;
+
+      case kJSTypeObject: {
+        const auto js_object_ref = JSValueToObject(source_context_ref__, js_value_ref, &exception);
+        ThrowIfException(exception);
+        value.type   = ValueType::Object;
+        value.object = CloneObject(js_object_ref);
+        break;
+      }
+
+      default:
+        ThrowRuntimeError(component_name__, "Unable to clone a value of this type.");
+    }
+    return value;
+  }
+
+  std::size_t JSValueCloner::CloneObject(JSObjectRef js_object_ref) {
+    const auto position = ids__.find(js_object_ref);
+    if (position != ids__.end()) {
+      return position -> second;
+    }
+
+    if (JSObjectIsFunction(source_context_ref__, js_object_ref)) {
+      ThrowRuntimeError(component_name__, "Unable to clone a function.");
+    }
+
+    Object object { ObjectType::Object, js_object_ref, 0, nullptr, 0, 0, 0, 0, 0 };
+    JSValueRef exception { nullptr };
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    const auto type = JSValueGetTypedArrayType(source_context_ref__, js_object_ref, &exception);
+    ThrowIfException(exception);
+    if (type == kJSTypedArrayTypeArrayBuffer) {
+      object.type        = ObjectType::ArrayBuffer;
+      object.bytes       = JSObjectGetArrayBufferBytesPtr(source_context_ref__, js_object_ref, &exception);
+      ThrowIfException(exception);
+      object.byte_length = JSObjectGetArrayBufferByteLength(source_context_ref__, js_object_ref, &exception);
+      ThrowIfException(exception);
+      return AddObject(object);
+    }
+
+    if (type != kJSTypedArrayTypeNone) {
+      // Views of the same ArrayBuffer stay views of the same one.
+      const auto buffer_ref = JSObjectGetTypedArrayBuffer(source_context_ref__, js_object_ref, &exception);
+      ThrowIfException(exception);
+      object.type             = ObjectType::TypedArray;
+      object.buffer           = CloneObject(buffer_ref);
+      object.byte_offset      = JSObjectGetTypedArrayByteOffset(source_context_ref__, js_object_ref, &exception);
+      ThrowIfException(exception);
+      object.length           = JSObjectGetTypedArrayLength(source_context_ref__, js_object_ref, &exception);
+      ThrowIfException(exception);
+      object.typed_array_type = static_cast<std::uint32_t>(type);
+      return AddObject(object);
+    }
+#endif
+
+    if (IsDate(js_object_ref)) {
+      object.type = ObjectType::Date;
+      object.time = JSValueToNumber(source_context_ref__, js_object_ref, &exception);
+      ThrowIfException(exception);
+      return AddObject(object);
+    }
+
+    if (IsArray(js_object_ref)) {
+      object.type = ObjectType::Array;
+    }
+    return AddObject(object);
+  }
+
+  std::size_t JSValueCloner::AddObject(const Object& object) {
+    const auto id = objects__.size();
+    target__.AddObject(object);
+    objects__.push_back(object);
+    ids__.emplace(object.source_ref, id);
+    return id;
+  }
+
+  void JSValueCloner::CopyProperties(std::size_t id, JSObjectRef js_object_ref) {
+    std::unique_ptr<std::remove_pointer<JSPropertyNameArrayRef>::type, void(*)(JSPropertyNameArrayRef)> property_names(JSObjectCopyPropertyNames(source_context_ref__, js_object_ref), JSPropertyNameArrayRelease);
+    const auto count = JSPropertyNameArrayGetCount(property_names.get());
+    for (std::size_t i = 0; i < count; ++i) {
+      const auto property_name_ref = JSPropertyNameArrayGetNameAtIndex(property_names.get(), i);
+      JSValueRef exception { nullptr };
+      const auto value_ref = JSObjectGetProperty(source_context_ref__, js_object_ref, property_name_ref, &exception);
+      ThrowIfException(exception);
+      target__.SetProperty(id, property_name_ref, 0, CloneValue(value_ref));
+    }
+  }
+
+  void JSValueCloner::CopyElements(std::size_t id, JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    const auto length_ref = JSObjectGetProperty(source_context_ref__, js_object_ref, static_cast<JSStringRef>(JSAtoms::length), &exception);
+    ThrowIfException(exception);
+    const auto length = JSValueToNumber(source_context_ref__, length_ref, &exception);
+    ThrowIfException(exception);
+
+    for (unsigned i = 0; i < static_cast<unsigned>(length); ++i) {
+      const auto element_ref = JSObjectGetPropertyAtIndex(source_context_ref__, js_object_ref, i, &exception);
+      ThrowIfException(exception);
+      target__.SetProperty(id, nullptr, i, CloneValue(element_ref));
+    }
+  }
+
+  bool JSValueCloner::IsArray(JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    if (!is_array_function_ref__) {
+      const auto array_ref = JSObjectGetProperty(source_context_ref__, JSContextGetGlobalObject(source_context_ref__), static_cast<JSStringRef>(JSAtoms::Array), &exception);
+      ThrowIfException(exception);
+      const auto array_constructor_ref = JSValueToObject(source_context_ref__, array_ref, &exception);
+      ThrowIfException(exception);
+      const auto is_array_ref = JSObjectGetProperty(source_context_ref__, array_constructor_ref, static_cast<JSStringRef>(JSAtoms::isArray), &exception);
+      ThrowIfException(exception);
+      is_array_function_ref__ = JSValueToObject(source_context_ref__, is_array_ref, &exception);
+      ThrowIfException(exception);
+    }
+
+    const JSValueRef arguments[] = { js_object_ref };
+    const auto result_ref = JSObjectCallAsFunction(source_context_ref__, is_array_function_ref__, nullptr, 1, arguments, &exception);
+    ThrowIfException(exception);
+    return JSValueToBoolean(source_context_ref__, result_ref);
+  }
+
+  bool JSValueCloner::IsDate(JSObjectRef js_object_ref) {
+    JSValueRef exception { nullptr };
+    if (!date_constructor_ref__) {
+      const auto date_ref = JSObjectGetProperty(source_context_ref__, JSContextGetGlobalObject(source_context_ref__), static_cast<JSStringRef>(JSAtoms::Date), &exception);
+      ThrowIfException(exception);
+      date_constructor_ref__ = JSValueToObject(source_context_ref__, date_ref, &exception);
+      ThrowIfException(exception);
+    }
+
+    const auto result = JSValueIsInstanceOfConstructor(source_context_ref__, js_object_ref, date_constructor_ref__, &exception);
+    ThrowIfException(exception);
+    return result;
+  }
+
+  void JSValueCloner::ThrowIfException(JSValueRef exception) const {
+    if (exception) {
+      ThrowRuntimeError(component_name__, JSValue(JSContext(source_context_ref__), exception));
+    }
+  }
+
+  JSValueCloneTarget::JSValueCloneTarget(JSContextRef source_context_ref, JSContextRef context_ref, bool share_array_buffers) HAL_NOEXCEPT
+  : source_context_ref__(source_context_ref)
+  , context_ref__(context_ref)
+  , share_array_buffers__(share_array_buffers) {
+  }
+
+  JSValueCloneTarget::~JSValueCloneTarget() HAL_NOEXCEPT {
+    for (const auto js_object_ref : object_refs__) {
+      detail::UnprotectJSValue(context_ref__, js_object_ref);
+    }
+  }
+
+  void JSValueCloneTarget::AddObject(const JSValueCloner::Object& object) {
+    JSValueRef  exception { nullptr };
+    JSObjectRef js_object_ref { nullptr };
+    switch (object.type) {
+      case JSValueCloner::ObjectType::Object:
+        js_object_ref = JSObjectMake(context_ref__, nullptr, nullptr);
+        break;
+
+      case JSValueCloner::ObjectType::Array:
+        js_object_ref = JSObjectMakeArray(context_ref__, 0, nullptr, &exception);
+        break;
+
+      case JSValueCloner::ObjectType::Date: {
+        const JSValueRef arguments[] = { JSValueMakeNumber(context_ref__, object.time) };
+        js_object_ref = JSObjectMakeDate(context_ref__, 1, arguments, &exception);
+        break;
+      }
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+      case JSValueCloner::ObjectType::ArrayBuffer:
+        js_object_ref = CreateArrayBuffer(object, &exception);
+        break;
+
+      case JSValueCloner::ObjectType::TypedArray:
+        js_object_ref = JSObjectMakeTypedArrayWithArrayBufferAndOffset(context_ref__, static_cast<JSTypedArrayType>(object.typed_array_type), object_refs__[object.buffer], object.byte_offset, object.length, &exception);
+        break;
+#endif
+
+      default:
+        break;
+    }
+
+    ThrowIfException(exception);
+    if (!js_object_ref) {
+      ThrowRuntimeError("JSContext", "Unable to clone an object.");
+    }
+    detail::ProtectJSValue(context_ref__, js_object_ref);
+    object_refs__.push_back(js_object_ref);
+  }
+
+  void JSValueCloneTarget::SetProperty(std::size_t id, JSStringRef name, unsigned index, const JSValueCloner::Value& value) {
+    JSValueRef exception { nullptr };
+    if (name) {
+      // JSStringRefs aren't tied to a context group, so the names are
+      // shared rather than copied.
+      JSObjectSetProperty(context_ref__, object_refs__[id], name, ToJSValueRef(value), kJSPropertyAttributeNone, &exception);
+    } else {
+      JSObjectSetPropertyAtIndex(context_ref__, object_refs__[id], index, ToJSValueRef(value), &exception);
+    }
+    ThrowIfException(exception);
+  }
+
+  JSValueRef JSValueCloneTarget::ToJSValueRef(const JSValueCloner::Value& value) const HAL_NOEXCEPT {
+    switch (value.type) {
+      case JSValueCloner::ValueType::Undefined:
+        return JSValueMakeUndefined(context_ref__);
+
+      case JSValueCloner::ValueType::Null:
+        return JSValueMakeNull(context_ref__);
+
+      case JSValueCloner::ValueType::Boolean:
+        return JSValueMakeBoolean(context_ref__, value.number != 0);
+
+      case JSValueCloner::ValueType::Number:
+        return JSValueMakeNumber(context_ref__, value.number);
+
+      case JSValueCloner::ValueType::String:
+        return JSValueMakeString(context_ref__, value.string);
+
+      case JSValueCloner::ValueType::Object:
+        return object_refs__[value.object];
+    }
+
+    return JSValueMakeUndefined(context_ref__);
+  }
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  JSObjectRef JSValueCloneTarget::CreateArrayBuffer(const JSValueCloner::Object& object, JSValueRef* exception) {
+    // Either the clone aliases the source bytes and keeps the source
+    // ArrayBuffer alive until it is collected, or it owns a copy.
+    void* bytes { nullptr };
+    std::unique_ptr<JSBytesDeallocator> deallocator_ptr;
+    if (share_array_buffers__) {
+      bytes = object.bytes;
+      const auto source_buffer = JSValueCloner::RetainOnRunLoop(source_context_ref__, object.source_ref);
+      deallocator_ptr.reset(new JSBytesDeallocator([source_buffer](void*) {
+      }));
+    } else {
+      std::unique_ptr<char[]> copy(new char[object.byte_length]);
+      std::memcpy(copy.get(), object.bytes, object.byte_length);
+      deallocator_ptr.reset(new JSBytesDeallocator([](void* bytes) {
+        delete[] static_cast<char*>(bytes);
+      }));
+      bytes = copy.release();
+    }
+
+    const auto js_object_ref = JSObjectMakeArrayBufferWithBytesNoCopy(context_ref__, bytes, object.byte_length, DeallocateBytes, deallocator_ptr.get(), exception);
+    if (*exception || !js_object_ref) {
+      if (!share_array_buffers__) {
+        delete[] static_cast<char*>(bytes);
+      }
+      return nullptr;
+    }
+
+    // JavaScriptCore now owns the deallocator.
+    deallocator_ptr.release();
+    return js_object_ref;
+  }
+#endif
+
+  void JSValueCloneTarget::ThrowIfException(JSValueRef exception) const {
+    if (exception) {
+      ThrowRuntimeError("JSContext", JSValue(JSContext(context_ref__), exception));
+    }
+  }
+
+}} // namespace HAL { namespace detail {
@@ -0,0 +1,149 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/detail/JSValueRetainRegistry.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSRetainedHandles.hpp"
+
+#include <cassert>
+
+namespace {
+  // The head of the list of all live registries.
+  HAL::detail::JSValueRetainRegistry* js_value_retain_registry_list__ = nullptr;
+
+#ifdef HAL_THREAD_SAFE_STATICS
+  HAL::detail::JSMutex js_value_retain_registry_list_mutex__ HAL_LOCK_NAME("JSValueRetainRegistry list");
+#endif
+}
+
+#undef  HAL_JSVALUERETAINREGISTRY_LIST_LOCK_GUARD
+#ifdef  HAL_THREAD_SAFE_STATICS
+#define HAL_JSVALUERETAINREGISTRY_LIST_LOCK_GUARD std::lock_guard<JSMutex> lock_list(js_value_retain_registry_list_mutex__)
+#else
+#define HAL_JSVALUERETAINREGISTRY_LIST_LOCK_GUARD
+#endif  // HAL_THREAD_SAFE_STATICS
+
+namespace HAL { namespace detail {
+
+  JSValueRetainRegistry::JSValueRetainRegistry(JSContextRef js_context_ref) HAL_NOEXCEPT
+  : js_context_ref__(js_context_ref) {
+    HAL_JSVALUERETAINREGISTRY_LIST_LOCK_GUARD;
+    next__ = js_value_retain_registry_list__;
+    if (next__) {
+      next__ -> previous__ = this;
+    }
+    js_value_retain_registry_list__ = this;
+  }
+
+  JSValueRetainRegistry::~JSValueRetainRegistry() HAL_NOEXCEPT {
+#ifdef HAL_TRACK_RETAINED_HANDLES
+    // Every JSValue holds its JSContext, so a value still retained
+    // here was retained without a JSValue and is never released.
+    for (const auto& entry : map__) {
+      if (entry.second.count > 0) {
+        HAL_LOG_ERROR("JSValueRetainRegistry: JSContextRef ", js_context_ref__, " destroyed with JSValueRef ", reinterpret_cast<JSValueRef>(entry.first), " still retained ", entry.second.count, " times, first at ", entry.second.site, "\n", entry.second.backtrace);
+      }
+    }
+#endif
+    HAL_JSVALUERETAINREGISTRY_LIST_LOCK_GUARD;
+    if (previous__) {
+      previous__ -> next__ = next__;
+    } else {
+      js_value_retain_registry_list__ = next__;
+    }
+    if (next__) {
+      next__ -> previous__ = previous__;
+    }
+  }
+
+  std::size_t JSValueRetainRegistry::Retain(JSContextRef js_context_ref, JSValueRef js_value_ref, std::size_t count) {
+    HAL_JSVALUERETAINREGISTRY_LOCK_GUARD;
+    const auto key = reinterpret_cast<std::intptr_t>(js_value_ref);
+
+    // An entry left at zero by a deferred release is still protected,
+    // so only a genuinely new entry needs JSValueProtect.
+    const auto insert_result = map__.emplace(key, Entry { 0 });
+    if (insert_result.second) {
+      ++protect_count__;
+      ++GetJSBudgetCounts().registry_insert_count;
+      detail::ProtectJSValue(js_context_ref, js_value_ref);
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      insert_result.first -> second.site      = JSRetainSite::current();
+      insert_result.first -> second.backtrace = CaptureRetainBacktrace();
+#endif
+    }
+
+    return insert_result.first -> second.count += count;
+  }
+
+  std::size_t JSValueRetainRegistry::Release(JSContextRef js_context_ref, JSValueRef js_value_ref, bool defer) {
+    HAL_JSVALUERETAINREGISTRY_LOCK_GUARD;
+    const auto key      = reinterpret_cast<std::intptr_t>(js_value_ref);
+    const auto position = map__.find(key);
+#ifdef HAL_TRACK_RETAINED_HANDLES
+    if (position == map__.end() || position -> second.count == 0) {
+      ReportRetainImbalance("JSValueRetainRegistry::Release", js_value_ref);
+      return 0;
+    }
+#endif
+    assert(position != map__.end());
+    assert(position -> second.count > 0);
+
+    const auto count = --position -> second.count;
+    if (count == 0 && !defer) {
+      detail::UnprotectJSValue(js_context_ref, js_value_ref);
+      map__.erase(position);
+    }
+
+    return count;
+  }
+
+  bool JSValueRetainRegistry::Flush(JSContextRef js_context_ref, JSValueRef js_value_ref) {
+    HAL_JSVALUERETAINREGISTRY_LOCK_GUARD;
+    const auto key      = reinterpret_cast<std::intptr_t>(js_value_ref);
+    const auto position = map__.find(key);
+
+    // The entry is gone if an earlier flush of the same JSValueRef
+    // already unprotected it, and non-zero if it was retained again.
+    if (position == map__.end() || position -> second.count != 0) {
+      return false;
+    }
+
+    detail::UnprotectJSValue(js_context_ref, js_value_ref);
+    map__.erase(position);
+    return true;
+  }
+
+  std::size_t JSValueRetainRegistry::size() const {
+    HAL_JSVALUERETAINREGISTRY_LOCK_GUARD;
+    return map__.size();
+  }
+
+  void JSValueRetainRegistry::ForEach(const std::function<void(JSValueRef js_value_ref, std::size_t count, const std::string& site, const std::string& backtrace)>& callback) const {
+    HAL_JSVALUERETAINREGISTRY_LOCK_GUARD;
+#ifndef HAL_TRACK_RETAINED_HANDLES
+    static const std::string site;
+    static const std::string backtrace;
+#endif
+    for (const auto& entry : map__) {
+#ifdef HAL_TRACK_RETAINED_HANDLES
+      const auto& site      = entry.second.site;
+      const auto& backtrace = entry.second.backtrace;
+#endif
+      callback(reinterpret_cast<JSValueRef>(entry.first), entry.second.count, site, backtrace);
+    }
+  }
+
+  void JSValueRetainRegistry::ForEachRegistry(const std::function<void(const JSValueRetainRegistry& js_value_retain_registry)>& callback) {
+    HAL_JSVALUERETAINREGISTRY_LIST_LOCK_GUARD;
+    for (auto registry = js_value_retain_registry_list__; registry; registry = registry -> next__) {
+      callback(*registry);
+    }
+  }
+
+}} // namespace HAL { namespace detail {
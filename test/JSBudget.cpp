@@ -0,0 +1,116 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "JSBudget.hpp"
+
+#include "HAL/HAL.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+  
+  // Counted for every allocation, since a scope only compares two
+  // snapshots of them.
+  HAL_THREAD_LOCAL std::uint64_t alloc_count;
+  HAL_THREAD_LOCAL std::uint64_t alloc_byte_count;
+  
+  HAL_THREAD_LOCAL const JSBudgetScope* current_scope;
+  
+  void* Allocate(std::size_t size) HAL_NOEXCEPT {
+    ++alloc_count;
+    alloc_byte_count += size;
+    return std::malloc(size == 0 ? 1 : size);
+  }
+  
+  JSBudget GetBudget() {
+    const auto& counts = HAL::detail::GetJSBudgetCounts();
+    JSBudget budget;
+    budget.allocs           = alloc_count;
+    budget.alloc_bytes      = alloc_byte_count;
+    budget.protects         = counts.protect_count;
+    budget.unprotects       = counts.unprotect_count;
+    budget.registry_inserts = counts.registry_insert_count;
+    budget.string_creates   = counts.string_create_count;
+    return budget;
+  }
+  
+} // namespace {
+
+std::ostream& operator << (std::ostream& ostream, const JSBudget& budget) {
+  ostream << "allocs = "             << budget.allocs
+          << ", alloc_bytes = "      << budget.alloc_bytes
+          << ", protects = "         << budget.protects
+          << ", unprotects = "       << budget.unprotects
+          << ", registry_inserts = " << budget.registry_inserts
+          << ", string_creates = "   << budget.string_creates;
+  return ostream;
+}
+
+JSBudgetScope::JSBudgetScope()
+: previous__(current_scope) {
+  // Taken last, so that nothing this constructor does is counted.
+  start__       = GetBudget();
+  current_scope = this;
+}
+
+JSBudgetScope::~JSBudgetScope() {
+  current_scope = previous__;
+}
+
+JSBudget JSBudgetScope::get_budget() const {
+  const auto now = GetBudget();
+  JSBudget budget;
+  budget.allocs           = now.allocs           - start__.allocs;
+  budget.alloc_bytes      = now.alloc_bytes      - start__.alloc_bytes;
+  budget.protects         = now.protects         - start__.protects;
+  budget.unprotects       = now.unprotects       - start__.unprotects;
+  budget.registry_inserts = now.registry_inserts - start__.registry_inserts;
+  budget.string_creates   = now.string_creates   - start__.string_creates;
+  return budget;
+}
+
+const JSBudgetScope* JSBudgetScope::current() {
+  return current_scope;
+}
+
+void* operator new(std::size_t size) {
+  if (auto ptr = Allocate(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) HAL_NOEXCEPT {
+  return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) HAL_NOEXCEPT {
+  return Allocate(size);
+}
+
+void operator delete(void* ptr) HAL_NOEXCEPT {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr) HAL_NOEXCEPT {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) HAL_NOEXCEPT {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) HAL_NOEXCEPT {
+  std::free(ptr);
+}
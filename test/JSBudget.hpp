@@ -0,0 +1,95 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_TEST_JSBUDGET_HPP_
+#define _HAL_TEST_JSBUDGET_HPP_
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <ostream>
+
+/*!
+ @struct
+ 
+ @discussion The costly operations made on the calling thread since a
+ JSBudgetScope started: calls of operator new and the bytes they
+ asked for, JSValueProtect and JSValueUnprotect calls, new retain
+ registry entries, and JSStringRefs created from native strings.
+ 
+ operator new is replaced by the test programs, so allocations by
+ JavaScriptCore's own allocator aren't counted, and on Windows
+ neither are those made inside the HAL DLL.
+ */
+struct JSBudget {
+  std::uint64_t allocs           { 0 };
+  std::uint64_t alloc_bytes      { 0 };
+  std::uint64_t protects         { 0 };
+  std::uint64_t unprotects       { 0 };
+  std::uint64_t registry_inserts { 0 };
+  std::uint64_t string_creates   { 0 };
+};
+
+std::ostream& operator << (std::ostream& ostream, const JSBudget& budget);
+
+/*!
+ @class
+ 
+ @discussion A JSBudgetScope counts what the code on its thread does
+ while it is in scope, for EXPECT_HAL_BUDGET. Scopes nest, and
+ EXPECT_HAL_BUDGET checks the innermost one:
+ 
+ JSBudgetScope budget_scope;
+ auto name = widget.GetProperty("name");
+ EXPECT_HAL_BUDGET(allocs <= 0 && protects <= 1);
+ */
+class JSBudgetScope final {
+  
+public:
+  
+  JSBudgetScope();
+  ~JSBudgetScope();
+  
+  JSBudgetScope(const JSBudgetScope&)            = delete;
+  JSBudgetScope& operator=(const JSBudgetScope&) = delete;
+  
+  // Return what was counted since this scope started.
+  JSBudget get_budget() const;
+  
+  // Return the innermost scope of the calling thread, or nullptr.
+  static const JSBudgetScope* current();
+  
+private:
+  
+  JSBudget             start__;
+  const JSBudgetScope* previous__;
+};
+
+// Expect condition, which may name any field of JSBudget, to hold for
+// what the innermost JSBudgetScope has counted so far, e.g.
+//
+// EXPECT_HAL_BUDGET(allocs <= 0 && protects == 0);
+#define EXPECT_HAL_BUDGET(condition) \
+  do { \
+    const auto hal_budget_scope = JSBudgetScope::current(); \
+    if (!hal_budget_scope) { \
+      ADD_FAILURE() << "EXPECT_HAL_BUDGET needs a JSBudgetScope"; \
+      break; \
+    } \
+    const auto hal_budget       = hal_budget_scope -> get_budget(); \
+    const auto allocs           = hal_budget.allocs; \
+    const auto alloc_bytes      = hal_budget.alloc_bytes; \
+    const auto protects         = hal_budget.protects; \
+    const auto unprotects       = hal_budget.unprotects; \
+    const auto registry_inserts = hal_budget.registry_inserts; \
+    const auto string_creates   = hal_budget.string_creates; \
+    (void)allocs; (void)alloc_bytes; (void)protects; (void)unprotects; (void)registry_inserts; (void)string_creates; \
+    EXPECT_TRUE(condition) << "HAL budget " #condition " exceeded: " << hal_budget; \
+  } while (false)
+
+#endif // _HAL_TEST_JSBUDGET_HPP_
@@ -8,6 +8,10 @@
 
 #include "HAL/HAL.hpp"
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #define XCTAssertEqual    ASSERT_EQ
@@ -40,3 +44,308 @@ TEST(JSContextGroupTests, BasicObjectCapabilities) {
   JSContextGroup js_context_group_6 = js_context_group_1;
   XCTAssertEqual(js_context_group_1, js_context_group_6);
 }
+
+TEST(JSContextGroupTests, Policy) {
+  JSContextGroup js_context_group_1;
+  XCTAssertEqual(kDefaultJSContextGroupPolicy, js_context_group_1.get_policy());
+  
+  JSContextGroup js_context_group_2(JSContextGroupPolicy::UnmanagedSingleContext);
+  XCTAssertEqual(false, js_context_group_2.is_refcounted());
+  
+  // Copies, and the contexts created in the group, share its policy.
+  JSContextGroup js_context_group_3 = js_context_group_2;
+  XCTAssertEqual(JSContextGroupPolicy::UnmanagedSingleContext, js_context_group_3.get_policy());
+  JSContext js_context = js_context_group_3.CreateContext();
+  XCTAssertEqual(JSContextGroupPolicy::UnmanagedSingleContext, js_context.get_context_group().get_policy());
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.JSEvaluateScript("6 * 7")));
+  
+  // So do the wrappers of their JavaScriptCore references, as in a
+  // callback.
+  XCTAssertEqual(JSContextGroupPolicy::UnmanagedSingleContext, JSContextGroup(static_cast<JSContextGroupRef>(js_context_group_2)).get_policy());
+  const JSContext js_context_copy(static_cast<JSContextRef>(js_context));
+  XCTAssertEqual(JSContextGroupPolicy::UnmanagedSingleContext, js_context_copy.get_context_group().get_policy());
+  
+  // A group HAL didn't create has the default policy.
+  const auto js_context_group_ref = JSContextGroupCreate();
+  XCTAssertEqual(kDefaultJSContextGroupPolicy, JSContextGroup(js_context_group_ref).get_policy());
+  JSContextGroupRelease(js_context_group_ref);
+}
+
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+TEST(JSContextGroupTests, ExecutionTimeLimit) {
+  JSContextGroup js_context_group;
+  JSContext js_context = js_context_group.CreateContext();
+  
+  int callback_count = 0;
+  js_context_group.SetExecutionTimeLimit(0.05, [&callback_count](const JSContext&) {
+    return ++callback_count > 1;
+  });
+  
+  // The callback lets the script run one more period before
+  // terminating it.
+  ASSERT_THROW(js_context.JSEvaluateScript("while (true) {}"), std::runtime_error);
+  XCTAssertEqual(2, callback_count);
+  
+  js_context_group.ClearExecutionTimeLimit();
+  js_context.JSEvaluateScript("for (var i = 0; i < 1000; ++i) {}");
+}
+#endif
+
+TEST(JSContextGroupTests, GetStatistics) {
+  JSContextGroup js_context_group;
+  XCTAssertEqual(0, js_context_group.GetStatistics().contexts.size());
+  
+  JSContext js_context = js_context_group.CreateContext();
+  const auto before = js_context_group.GetStatistics();
+  XCTAssertEqual(1, before.contexts.size());
+  XCTAssertEqual(static_cast<JSContextRef>(js_context), before.contexts.at(0).js_context_ref);
+  
+  JSValue  js_value  = js_context.CreateString("hello");
+  JSObject js_object = js_context.CreateObject();
+  const auto after = js_context_group.GetStatistics();
+  XCTAssertEqual(before.value_count + 1, after.value_count);
+  XCTAssertEqual(before.object_count + 1, after.object_count);
+  XCTAssertEqual(after.value_count, after.contexts.at(0).value_count);
+  
+  // Contexts of other groups aren't counted.
+  JSContextGroup other_js_context_group;
+  JSContext other_js_context = other_js_context_group.CreateContext();
+  XCTAssertEqual(after.value_count, js_context_group.GetStatistics().value_count);
+  
+#ifdef HAL_MEMORY_USAGE_STATISTICS_ENABLE
+  XCTAssertEqual(true, after.has_heap_statistics);
+  XCTAssertNotEqual(0, after.heap_size);
+#endif
+}
+
+TEST(JSContextGroupTests, JSStatistics) {
+  JSContextGroup js_context_group;
+  JSContext js_context = js_context_group.CreateContext();
+  
+  const auto statistics = JSStatistics::Capture(js_context_group);
+  const auto& samples   = statistics.get_samples();
+  const auto  contexts  = std::find_if(samples.begin(), samples.end(), [](const JSStatisticsSample& sample) {
+    return sample.name == "hal_context_group_contexts";
+  });
+  XCTAssertEqual(true, contexts != samples.end());
+  XCTAssertEqual(1, contexts -> value);
+  
+  const auto prometheus = statistics.ToPrometheus();
+  XCTAssertNotEqual(std::string::npos, prometheus.find("# HELP hal_context_group_contexts "));
+  XCTAssertNotEqual(std::string::npos, prometheus.find("\nhal_context_group_contexts 1\n"));
+  
+  // The JSON parses, and scripts get the same snapshot.
+  XCTAssertEqual(true, js_context.CreateValueFromJSON(statistics.ToJSON()).IsObject());
+  JSStatistics::Install(js_context);
+  XCTAssertEqual(true, static_cast<bool>(js_context.JSEvaluateScript("__hal_stats().samples.some(function (sample) { return sample.name === 'hal_context_group_contexts' && sample.value === 1; });")));
+  XCTAssertEqual(false, static_cast<bool>(js_context.JSEvaluateScript("Object.keys(this).indexOf('__hal_stats') >= 0;")));
+}
+
+TEST(JSContextGroupTests, Quotas) {
+  JSContextGroup js_context_group;
+  JSContext js_context = js_context_group.CreateContext();
+  JSRunLoop js_run_loop(js_context);
+  
+  std::vector<JSQuotaResource> soft_limits_exceeded;
+  JSContextGroupQuotas quotas;
+  quotas.external_memory_bytes.soft = 1024;
+  quotas.external_memory_bytes.hard = 4096;
+  quotas.queued_tasks.hard          = 2;
+  quotas.soft_limit_callback        = [&soft_limits_exceeded](JSQuotaResource resource, double, double) {
+    soft_limits_exceeded.push_back(resource);
+  };
+  js_context_group.SetQuotas(quotas);
+  
+  // The soft limit calls back once per crossing.
+  js_context.AdjustExternalMemory(2048);
+  js_context.AdjustExternalMemory(1);
+  XCTAssertEqual(1, soft_limits_exceeded.size());
+  XCTAssertEqual(true, soft_limits_exceeded.at(0) == JSQuotaResource::ExternalMemory);
+  XCTAssertEqual(2049, js_context_group.GetStatistics().quota_usage.external_memory_bytes);
+  
+  // Past the hard limit scripts are refused until the memory is freed.
+  js_context.AdjustExternalMemory(4096);
+  ASSERT_THROW(js_context.JSEvaluateScript("1"), std::runtime_error);
+  js_context.AdjustExternalMemory(-6145);
+  XCTAssertEqual(1, static_cast<int32_t>(js_context.JSEvaluateScript("1")));
+  
+  // A task past the hard limit is rejected, and the queue drains.
+  js_run_loop.Post([](const JSContext&) {});
+  js_run_loop.Post([](const JSContext&) {});
+  ASSERT_THROW(js_run_loop.Post([](const JSContext&) {}), std::runtime_error);
+  XCTAssertEqual(2, js_context_group.GetStatistics().quota_usage.queued_tasks);
+  XCTAssertEqual(2, js_run_loop.RunUntilIdle());
+  
+  const auto statistics = js_context_group.GetStatistics();
+  XCTAssertEqual(true, statistics.has_quotas);
+  XCTAssertEqual(0, statistics.quota_usage.queued_tasks);
+  XCTAssertEqual(2, statistics.quota_usage.hard_limit_exceeded_count);
+  XCTAssertEqual(2, statistics.quota_usage.terminated_count);
+  XCTAssertEqual(true, statistics.quota_usage.cpu_time_seconds > 0);
+  XCTAssertNotEqual(std::string::npos, JSStatistics::Capture(js_context_group).ToPrometheus().find("\nhal_quota_usage{resource=\"external_memory\"} 0\n"));
+  
+  js_context_group.ClearQuotas();
+  XCTAssertEqual(false, js_context_group.GetStatistics().has_quotas);
+}
+
+TEST(JSContextGroupTests, QuotasBelongToTheGroup) {
+  {
+    JSContextGroup js_context_group;
+    JSContextGroupQuotas quotas;
+    quotas.external_memory_bytes.hard = 4096;
+    js_context_group.SetQuotas(quotas);
+    
+    // A wrapper of the JSContextGroupRef shares the quotas and usage.
+    const JSContextGroup js_context_group_copy(static_cast<JSContextGroupRef>(js_context_group));
+    XCTAssertEqual(true, js_context_group_copy.GetStatistics().has_quotas);
+    js_context_group.CreateContext().AdjustExternalMemory(1024);
+    XCTAssertEqual(1024, js_context_group_copy.GetStatistics().quota_usage.external_memory_bytes);
+  }
+  
+  // Once the group is gone, its quotas are too, so a group created at
+  // the same address starts without them.
+  for (int i = 0; i < 16; ++i) {
+    JSContextGroup js_context_group;
+    const auto statistics = js_context_group.GetStatistics();
+    XCTAssertEqual(false, statistics.has_quotas);
+    XCTAssertEqual(0, statistics.quota_usage.external_memory_bytes);
+  }
+}
+
+#ifdef HAL_EXECUTION_TIME_LIMIT_ENABLE
+TEST(JSContextGroupTests, CPUTimeQuota) {
+  JSContextGroup js_context_group;
+  JSContext js_context = js_context_group.CreateContext();
+  
+  JSContextGroupQuotas quotas;
+  quotas.cpu_time_seconds.hard = 0.05;
+  js_context_group.SetQuotas(quotas);
+  
+  // A running script is terminated, and the group stays refused until
+  // its CPU time is reset.
+  ASSERT_THROW(js_context.JSEvaluateScript("while (true) {}"), std::runtime_error);
+  XCTAssertEqual(true, js_context_group.GetStatistics().quota_usage.cpu_time_seconds >= 0.05);
+  ASSERT_THROW(js_context.JSEvaluateScript("1"), std::runtime_error);
+  js_context_group.ResetQuotaCPUTime();
+  XCTAssertEqual(1, static_cast<int32_t>(js_context.JSEvaluateScript("1")));
+  
+  js_context_group.ClearQuotas();
+}
+#endif
+
+#ifdef HAL_LOCK_STATISTICS_ENABLE
+TEST(JSContextGroupTests, JSLockStatistics) {
+  detail::JSMutex mutex HAL_LOCK_NAME("JSContextGroupTests");
+  detail::ResetJSLockStatistics();
+  {
+    std::lock_guard<detail::JSMutex> lock(mutex);
+  }
+  XCTAssertEqual(true, mutex.try_lock());
+  mutex.unlock();
+  
+  const auto locks = detail::GetJSLockStatistics();
+  const auto lock  = std::find_if(locks.begin(), locks.end(), [](const detail::JSLockStatistics* statistics) {
+    return std::string(statistics -> name) == "JSContextGroupTests";
+  });
+  XCTAssertEqual(true, lock != locks.end());
+  XCTAssertEqual(2, (*lock) -> acquisitions.load());
+  XCTAssertEqual(0, (*lock) -> contended_acquisitions.load());
+  
+  const auto prometheus = JSStatistics::Capture().ToPrometheus();
+  XCTAssertNotEqual(std::string::npos, prometheus.find("hal_lock_acquisitions_total{lock=\"JSContextGroupTests\"} 2\n"));
+}
+#endif
+
+#ifdef HAL_PERFORMANCE_COUNTER_ENABLE
+namespace {
+  class CountedObject final : public detail::JSPerformanceCounter<CountedObject> {
+  };
+}
+
+TEST(JSContextGroupTests, JSPerformanceCounterThreads) {
+  using counter = detail::JSPerformanceCounter<CountedObject>;
+  
+  // More threads than shards, so that some share one, each creating,
+  // copying and moving objects, and destroying objects made on this
+  // thread, which counts them alive here and dead there.
+  const long thread_count = 2 * detail::kJSPerformanceCounterShardCount + 1;
+  const long iterations   = 1000;
+  std::vector<std::vector<CountedObject>> handed_over;
+  for (long i = 0; i < thread_count; ++i) {
+    handed_over.emplace_back(iterations);
+  }
+  
+  std::vector<std::thread> threads;
+  for (long i = 0; i < thread_count; ++i) {
+    threads.emplace_back([&handed_over, i, iterations]() {
+      for (long j = 0; j < iterations; ++j) {
+        CountedObject object;
+        CountedObject copy(object);
+        CountedObject moved(std::move(object));
+        copy  = moved;
+        moved = std::move(copy);
+      }
+      std::vector<CountedObject>().swap(handed_over.at(i));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  
+  const long objects = thread_count * iterations;
+  XCTAssertEqual(0, counter::get_objects_alive());
+  XCTAssertEqual(4 * objects, counter::get_objects_created());
+  XCTAssertEqual(4 * objects, counter::get_objects_destroyed());
+  XCTAssertEqual(objects, counter::get_objects_copy_constructed());
+  XCTAssertEqual(objects, counter::get_objects_move_constructed());
+  XCTAssertEqual(objects, counter::get_objects_copy_assigned());
+  XCTAssertEqual(objects, counter::get_objects_move_assigned());
+}
+#endif
+
+TEST(JSContextGroupTests, RunTimeSliced) {
+  int remaining = 3;
+  XCTAssertEqual(true, RunTimeSliced([&remaining]() { return --remaining > 0; }, std::chrono::seconds(10)));
+  XCTAssertEqual(0, remaining);
+  
+  // A budget of zero still runs one step per call.
+  remaining = 3;
+  XCTAssertEqual(false, RunTimeSliced([&remaining]() { return --remaining > 0; }, std::chrono::seconds(0)));
+  XCTAssertEqual(2, remaining);
+}
+
+#ifdef HAL_THREAD_AFFINITY
+TEST(JSContextGroupTests, ThreadAffinity) {
+  JSContextGroup js_context_group;
+  JSContext js_context = js_context_group.CreateContext();
+  XCTAssertEqual(std::this_thread::get_id(), js_context_group.get_owner_thread_id());
+  XCTAssertEqual(true, js_context.IsOwnerThread());
+  
+  // Copies keep the owner of the context group they were made from.
+  bool is_owner_thread = true;
+  std::thread([js_context, &is_owner_thread]() {
+    is_owner_thread = js_context.IsOwnerThread();
+  }).join();
+  XCTAssertEqual(false, is_owner_thread);
+}
+#endif
+
+TEST(JSContextGroupTests, JSRuntime) {
+  // The options can't change once JavaScriptCore has started.
+  JSContextGroup js_context_group;
+  XCTAssertEqual(true, JSRuntime::has_started());
+  JSRuntimeOptions options;
+  options.max_jit_tier = JSJITTier::Baseline;
+  ASSERT_THROW(JSRuntime::ApplyOptions(options), std::runtime_error);
+  
+  JSRuntimeOptions malformed;
+  malformed.extra_options["not an option"] = "1";
+  ASSERT_THROW(JSRuntime::ApplyOptions(malformed), std::invalid_argument);
+  
+  // Every option of JSRuntimeOptions is read back, set or not.
+  const auto effective_options = JSRuntime::GetEffectiveOptions();
+  const auto use_jit = std::find_if(effective_options.begin(), effective_options.end(), [](const JSRuntimeOptionValue& option) {
+    return option.name == "useJIT";
+  });
+  XCTAssertEqual(true, use_jit != effective_options.end());
+}
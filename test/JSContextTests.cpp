@@ -7,10 +7,30 @@
  */
 
 #include "HAL/HAL.hpp"
+#include "HAL/detail/JSTimerWheel.hpp"
+#include "HAL/detail/JSBudgetCounters.hpp"
+#include "HAL/detail/JSLoggerPolicyAsync.hpp"
+#include "HAL/detail/JSLoggerPolicyBufferedFile.hpp"
+#include "HAL/detail/JSBinaryLogger.hpp"
+#include "JSTemporaryPath.hpp"
 
 #include "gtest/gtest.h"
 #include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <sstream>
 #include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #define XCTAssertEqual    ASSERT_EQ
 #define XCTAssertNotEqual ASSERT_NE
@@ -77,6 +97,29 @@ TEST_F(JSContextTests, JSEvaluateScriptWithError) {
   }
 }
 
+TEST_F(JSContextTests, ExecuteScript) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.ExecuteScript("var executed = 42;");
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.get_global_object().GetProperty("executed")));
+  
+  try {
+    js_context.ExecuteScript("throw new TypeError('oops');", "batch.js", 7);
+    XCTAssertTrue(false);
+  } catch (const HAL::detail::js_runtime_error& e) {
+    XCTAssertEqual("TypeError", e.js_name());
+    XCTAssertEqual("batch.js", e.js_filename());
+    XCTAssertEqual("oops", std::string(e.what()));
+  }
+  
+  // The message is read from the Error when what is first called.
+  try {
+    js_context.ExecuteScript("throw new RangeError('late');");
+    XCTAssertTrue(false);
+  } catch (const std::runtime_error& e) {
+    XCTAssertEqual("late", std::string(e.what()));
+  }
+}
+
 TEST_F(JSContextTests, JSContext) {
   JSContext js_context_1 = js_context_group.CreateContext();
   JSContext js_context_2 = js_context_group.CreateContext();
@@ -117,3 +160,1480 @@ TEST_F(JSContextTests, JSContext) {
   JSContext js_context_12 = js_context_7;
   XCTAssertEqual(js_context_7, js_context_12);
 }
+
+TEST_F(JSContextTests, WrappedJSContextSharesCaches) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.set_function_cache_capacity(2);
+  const auto js_function = js_context.CreateFunction("return a * b;", {"a", "b"});
+  
+  // A JSContext wrapped around the JSGlobalContextRef, as in a
+  // callback, shares the caches and settings of the others.
+  const JSContext js_context_copy(static_cast<JSContextRef>(js_context));
+  XCTAssertEqual(js_context, js_context_copy);
+  XCTAssertEqual(2, js_context_copy.get_function_cache_capacity());
+  XCTAssertTrue(js_function == js_context_copy.CreateFunction("return a * b;", {"a", "b"}));
+  
+  js_context_copy.AdjustExternalMemory(100);
+  XCTAssertEqual(100, js_context.get_external_memory_size());
+  js_context_copy.AdjustExternalMemory(-100);
+}
+
+TEST_F(JSContextTests, DeferHandleRelease) {
+  JSContext js_context = js_context_group.CreateContext();
+  XCTAssertFalse(JSContext::get_defer_handle_release());
+  
+  JSContext::set_defer_handle_release(true);
+  XCTAssertTrue(JSContext::get_defer_handle_release());
+  
+  JSObject js_object = js_context.CreateObject();
+  for (int i = 0; i < 10; ++i) {
+    // Each temporary is released and then protected again by the next
+    // iteration, which cancels the deferred release.
+    JSValue js_value = js_context.CreateString("hello");
+    js_object.SetProperty("value", js_value);
+  }
+  
+  JSContext::FlushHandles();
+  js_context.GarbageCollect();
+  XCTAssertEqual("hello", static_cast<std::string>(js_object.GetProperty("value")));
+  
+  // A release that is cancelled by protecting the same JSValueRef again
+  // before the flush is skipped by it, and neither reaches
+  // JavaScriptCore.
+  const auto& counts = detail::GetJSBudgetCounts();
+  {
+    JSValue js_value = js_context.CreateString("cancelled");
+    js_object.SetProperty("cancelled", js_value);
+  }
+  const auto protect_count   = counts.protect_count;
+  const auto unprotect_count = counts.unprotect_count;
+  {
+    JSValue js_value = js_object.GetProperty("cancelled");
+    JSContext::FlushHandles();
+    XCTAssertEqual(protect_count  , counts.protect_count);
+    XCTAssertEqual(unprotect_count, counts.unprotect_count);
+  }
+  
+  // One that isn't cancelled is done by the flush.
+  JSContext::FlushHandles();
+  XCTAssertEqual(unprotect_count + 1, counts.unprotect_count);
+  
+  JSContext::set_defer_handle_release(false);
+  XCTAssertFalse(JSContext::get_defer_handle_release());
+}
+
+TEST_F(JSContextTests, CreateValueFromJSONData) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  const std::string json = "{\"name\": \"caf\xC3\xA9\", \"values\": [1, 2, 3]}";
+  auto js_value = js_context.CreateValueFromJSON(json.data(), json.size());
+  XCTAssertTrue(js_value.IsObject());
+  auto js_object = static_cast<JSObject>(js_value);
+  XCTAssertEqual("caf\xC3\xA9", static_cast<std::string>(js_object.GetProperty("name")));
+  XCTAssertEqual(3, static_cast<JSArray>(static_cast<JSObject>(js_object.GetProperty("values"))).GetLength());
+  
+  const std::u16string utf16 = u"[true, null]";
+  js_value = js_context.CreateValueFromJSON(reinterpret_cast<const JSChar*>(utf16.data()), utf16.size());
+  XCTAssertTrue(js_value.IsObject());
+  
+  // The error reports where the JSON goes wrong.
+  const std::string invalid = "{\"a\": [1, 2,]}";
+  try {
+    js_context.CreateValueFromJSON(invalid.data(), invalid.size());
+    XCTAssertTrue(false);
+  } catch (const std::runtime_error& e) {
+    XCTAssertEqual("Input is not valid JSON at offset 12", std::string(e.what()));
+  }
+  
+  ASSERT_THROW(js_context.CreateValueFromJSONFile("/nonexistent/file.json"), std::runtime_error);
+}
+
+TEST_F(JSContextTests, ParseJSONStream) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  const std::string json = "{\"meta\": {\"count\": 2}, \"items\": [{\"id\": 7, \"tags\": [\"a\"]}, {\"id\": 8, \"tags\": []}], \"a b\": [1, 2, 3], \"\\u0063af\\u00e9\": true}";
+  std::vector<std::string> paths;
+  std::vector<JSValue>     values;
+  const auto handler = [&paths, &values](const std::string& path, const JSValue& js_value) {
+    paths.push_back(path);
+    values.push_back(js_value);
+  };
+  
+  js_context.ParseJSONStream(json.data(), json.size(), {"$.items[*].id", "$['a b'][1]", "$.caf\xC3\xA9", "$.meta"}, handler);
+  XCTAssertEqual(5, paths.size());
+  XCTAssertEqual("$.meta", paths[0]);
+  XCTAssertEqual(2, static_cast<int32_t>(static_cast<JSObject>(values[0]).GetProperty("count")));
+  XCTAssertEqual("$.items[0].id", paths[1]);
+  XCTAssertEqual(7, static_cast<int32_t>(values[1]));
+  XCTAssertEqual("$.items[1].id", paths[2]);
+  XCTAssertEqual(8, static_cast<int32_t>(values[2]));
+  XCTAssertEqual("$['a b'][1]", paths[3]);
+  XCTAssertEqual(2, static_cast<int32_t>(values[3]));
+  XCTAssertEqual("$['caf\xC3\xA9']", paths[4]);
+  XCTAssertTrue(static_cast<bool>(values[4]));
+  
+  // UTF-16 input, and the whole document.
+  paths.clear();
+  values.clear();
+  const std::u16string utf16 = u" [true, {\"x\": null}] ";
+  js_context.ParseJSONStream(reinterpret_cast<const JSChar*>(utf16.data()), utf16.size(), {"$[1].x", "$"}, handler);
+  XCTAssertEqual(1, paths.size());
+  XCTAssertEqual("$", paths[0]);
+  XCTAssertTrue(values[0].IsObject());
+  
+  // Invalid JSON is reported even where nothing is selected.
+  const std::string invalid = "{\"a\": 1, \"b\": [1, 2,]}";
+  paths.clear();
+  try {
+    js_context.ParseJSONStream(invalid.data(), invalid.size(), {"$.a"}, handler);
+    XCTAssertTrue(false);
+  } catch (const std::runtime_error& e) {
+    XCTAssertEqual("Input is not valid JSON at offset 20", std::string(e.what()));
+  }
+  XCTAssertEqual(1, paths.size());
+  
+  ASSERT_THROW(js_context.ParseJSONStream(json.data(), json.size(), {"items"}, handler), std::invalid_argument);
+  ASSERT_THROW(js_context.ParseJSONStream(json.data(), json.size(), {"$.items["}, handler), std::invalid_argument);
+}
+
+TEST_F(JSContextTests, Clone) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSContextGroup other_context_group;
+  JSContext other_context = other_context_group.CreateContext();
+  
+  auto js_value = js_context.JSEvaluateScript("var o = { name: 'point', values: [1, 2, 3], when: new Date(0) }; o.self = o; o");
+  auto clone = static_cast<JSObject>(JSContext::Clone(js_value, other_context));
+  XCTAssertEqual("point", static_cast<std::string>(clone.GetProperty("name")));
+  XCTAssertTrue(static_cast<JSObject>(clone.GetProperty("values")).IsArray());
+  XCTAssertEqual(3, static_cast<JSArray>(static_cast<JSObject>(clone.GetProperty("values"))).GetLength());
+  XCTAssertEqual(0, static_cast<double>(clone.GetProperty("when")));
+  XCTAssertTrue(clone.GetProperty("self") == clone);
+  
+  // The clone is independent of its source.
+  js_context.JSEvaluateScript("o.name = 'changed'");
+  XCTAssertEqual("point", static_cast<std::string>(clone.GetProperty("name")));
+  
+  ASSERT_THROW(JSContext::Clone(js_context.JSEvaluateScript("({ f: function() {} })"), other_context), std::runtime_error);
+  
+  // An exception is wrapped with the context that threw it.
+  try {
+    JSContext::Clone(js_context.JSEvaluateScript("({ get x() { throw new TypeError('source'); } })"), other_context);
+    XCTAssertTrue(false);
+  } catch (const HAL::detail::js_runtime_error& e) {
+    XCTAssertEqual("TypeError", e.js_name());
+    XCTAssertEqual("source", e.js_message());
+  }
+  other_context.JSEvaluateScript("Object.defineProperty(Object.prototype, 'x', { set: function() { throw new RangeError('target'); }, configurable: true });");
+  try {
+    JSContext::Clone(js_context.JSEvaluateScript("({ x: 1 })"), other_context);
+    XCTAssertTrue(false);
+  } catch (const HAL::detail::js_runtime_error& e) {
+    XCTAssertEqual("RangeError", e.js_name());
+    XCTAssertEqual("target", e.js_message());
+  }
+  other_context.JSEvaluateScript("delete Object.prototype.x;");
+  
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  auto source_array = js_context.CreateTypedArray<double>(std::vector<double> { 1.5, 2.5 });
+  auto cloned_array = JSTypedArray<double>(static_cast<JSObject>(JSContext::Clone(source_array, other_context)));
+  XCTAssertEqual(2, cloned_array.GetLength());
+  XCTAssertEqual(2.5, cloned_array.GetBytesPtr()[1]);
+  XCTAssertNotEqual(source_array.GetBytesPtr(), cloned_array.GetBytesPtr());
+  
+  // Sharing needs the run loop the source is released on.
+  ASSERT_THROW(JSContext::Clone(source_array, other_context, true), std::runtime_error);
+  JSRunLoop js_run_loop(js_context);
+  auto shared_array = JSTypedArray<double>(static_cast<JSObject>(JSContext::Clone(source_array, other_context, true)));
+  XCTAssertEqual(source_array.GetBytesPtr(), shared_array.GetBytesPtr());
+#endif
+}
+
+TEST_F(JSContextTests, SaveState) {
+  const auto path = GetTemporaryPath("JSContextTests.state");
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.JSEvaluateScript("var shared = { name: 'shared' }; var config = { shared: shared, started: new Date(5), flags: [true, null] }; var cache = { shared: shared, 'ключ': 'значение' }; var unsaved = 1;");
+  js_context.SaveState({ "config", "cache" }, path);
+  ASSERT_THROW(js_context.SaveState({ "missing" }, path), std::invalid_argument);
+  
+  JSContextGroup other_context_group;
+  JSContext other_context = other_context_group.CreateContext();
+  XCTAssertTrue(other_context.RestoreState(path));
+  XCTAssertTrue(static_cast<bool>(other_context.JSEvaluateScript("config.shared === cache.shared && config.shared.name === 'shared'")));
+  XCTAssertEqual(5, static_cast<int32_t>(other_context.JSEvaluateScript("config.started.getTime()")));
+  XCTAssertTrue(static_cast<bool>(other_context.JSEvaluateScript("Array.isArray(config.flags) && config.flags[0] === true && config.flags[1] === null")));
+  XCTAssertEqual("значение", static_cast<std::string>(other_context.JSEvaluateScript("cache['ключ']")));
+  XCTAssertEqual("undefined", static_cast<std::string>(other_context.JSEvaluateScript("typeof unsaved")));
+  
+  // A missing file restores nothing, and a damaged one is rejected.
+  XCTAssertFalse(other_context.RestoreState(GetTemporaryPath("JSContextTests.missing")));
+  {
+    std::ofstream damaged(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    damaged << "HALS not a saved state";
+  }
+  ASSERT_THROW(other_context.RestoreState(path), std::runtime_error);
+  
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  // A typed array is restored over its ArrayBuffer, and one whose
+  // type, offset or length doesn't fit it is rejected.
+  js_context.JSEvaluateScript("var view = new Uint8Array(new ArrayBuffer(8), 2, 5); view[0] = 7;");
+  js_context.SaveState({ "view" }, path);
+  XCTAssertTrue(other_context.RestoreState(path));
+  XCTAssertTrue(static_cast<bool>(other_context.JSEvaluateScript("view instanceof Uint8Array && view.byteOffset === 2 && view.length === 5 && view[0] === 7")));
+  
+  std::string state;
+  {
+    std::ifstream file(path, std::ios_base::binary);
+    state.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  const std::uint64_t offset_and_length[] = { 2, 5 };
+  const std::uint32_t type = kJSTypedArrayTypeUint8Array;
+  std::string fields(reinterpret_cast<const char*>(offset_and_length), sizeof(offset_and_length));
+  fields.append(reinterpret_cast<const char*>(&type), sizeof(type));
+  const auto position = state.find(fields);
+  ASSERT_NE(std::string::npos, position);
+  
+  const auto restore_damaged = [&](std::size_t field_offset, const void* value, std::size_t size) {
+    auto damaged = state;
+    std::memcpy(&damaged[position + field_offset], value, size);
+    std::ofstream(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc) << damaged;
+    return other_context.RestoreState(path);
+  };
+  const std::uint64_t too_long     = 7;
+  const std::uint64_t past_the_end = 9;
+  const std::uint32_t unknown_type = 99;
+  ASSERT_THROW(restore_damaged(sizeof(std::uint64_t), &too_long, sizeof(too_long)), std::runtime_error);
+  ASSERT_THROW(restore_damaged(0, &past_the_end, sizeof(past_the_end)), std::runtime_error);
+  ASSERT_THROW(restore_damaged(2 * sizeof(std::uint64_t), &unknown_type, sizeof(unknown_type)), std::runtime_error);
+#endif
+  std::remove(path.c_str());
+}
+
+#ifdef HAL_SCRIPT_REF_ENABLE
+TEST_F(JSContextTests, JSScript) {
+  JSContext js_context_1 = js_context_group.CreateContext();
+  JSContext js_context_2 = js_context_group.CreateContext();
+  
+  JSScriptCache js_script_cache(js_context_group, 2);
+  auto js_script = js_script_cache.GetScript("this.count = (this.count || 0) + 1");
+  XCTAssertEqual(1, static_cast<int32_t>(js_context_1.JSEvaluateScript(js_script)));
+  XCTAssertEqual(2, static_cast<int32_t>(js_context_1.JSEvaluateScript(js_script)));
+  XCTAssertEqual(1, static_cast<int32_t>(js_context_2.JSEvaluateScript(js_script)));
+  
+  // The same source is parsed only once.
+  js_script_cache.GetScript("this.count = (this.count || 0) + 1");
+  XCTAssertEqual(1, js_script_cache.size());
+  
+  js_script_cache.GetScript("1");
+  js_script_cache.GetScript("2");
+  XCTAssertEqual(2, js_script_cache.size());
+  
+  ASSERT_THROW(js_script_cache.GetScript("var = ;"), std::runtime_error);
+  XCTAssertEqual(2, js_script_cache.size());
+  
+  JSContextGroup other_context_group;
+  JSContext other_context = other_context_group.CreateContext();
+  ASSERT_THROW(other_context.JSEvaluateScript(js_script), std::invalid_argument);
+  
+  ASSERT_THROW(js_context_1.JSEvaluateScript(JSScript(js_context_group, "throw new Error('oops')")), std::runtime_error);
+}
+
+TEST_F(JSContextTests, PrecompileAsync) {
+  JSContext js_context_1 = js_context_group.CreateContext();
+  const auto js_script_cache = js_context_group.GetScriptCache();
+  XCTAssertEqual(0, js_script_cache -> size());
+  XCTAssertTrue(js_script_cache -> Find("this.count = (this.count || 0) + 1", "next.js") == nullptr);
+  
+  std::vector<JSScriptSource> sources;
+  sources.emplace_back("this.count = (this.count || 0) + 1", "next.js");
+  sources.emplace_back("var = ;", "broken.js");
+  sources.emplace_back("this.greeting = 'hello'", "greeting.js", 10);
+  XCTAssertEqual(2, js_context_group.PrecompileAsync(std::move(sources)).get());
+  XCTAssertEqual(2, js_script_cache -> size());
+  
+  // Every context of the group shares the cache, and evaluating the
+  // same source, source URL and line number finds it.
+  const auto js_script = js_script_cache -> Find("this.count = (this.count || 0) + 1", "next.js");
+  XCTAssertTrue(js_script != nullptr);
+  XCTAssertTrue(js_script == js_script_cache -> Find("this.count = (this.count || 0) + 1", "next.js"));
+  XCTAssertEqual(1, static_cast<int32_t>(js_context_1.JSEvaluateScript("this.count = (this.count || 0) + 1", "next.js")));
+  JSContext js_context_2 = js_context_group.CreateContext();
+  js_context_2.ExecuteScript("this.greeting = 'hello'", "greeting.js", 10);
+  XCTAssertEqual("hello", static_cast<std::string>(js_context_2.get_global_object().GetProperty("greeting")));
+  
+  // Another line number is another script.
+  XCTAssertTrue(js_script_cache -> Find("this.greeting = 'hello'", "greeting.js", 11) == nullptr);
+  
+  // The script that didn't parse throws where it is evaluated.
+  ASSERT_THROW(js_context_1.JSEvaluateScript("var = ;", "broken.js"), std::runtime_error);
+  XCTAssertEqual(2, js_script_cache -> size());
+}
+#endif
+
+TEST_F(JSContextTests, FunctionCache) {
+  JSContext js_context = js_context_group.CreateContext();
+  XCTAssertEqual(0, js_context.get_function_cache_capacity());
+  
+  // Without a cache every call parses a new function.
+  auto js_function_1 = js_context.CreateFunction("return a + b;", {"a", "b"});
+  auto js_function_2 = js_context.CreateFunction("return a + b;", {"a", "b"});
+  XCTAssertFalse(js_function_1 == js_function_2);
+  
+  js_context.set_function_cache_capacity(2);
+  js_function_1 = js_context.CreateFunction("return a + b;", {"a", "b"});
+  js_function_2 = js_context.CreateFunction("return a + b;", {"a", "b"});
+  XCTAssertTrue(js_function_1 == js_function_2);
+  XCTAssertFalse(js_function_1 == js_context.CreateFunction("return a + b;", {"a", "c"}));
+  
+  std::vector<JSValue> args = {js_context.CreateNumber(1), js_context.CreateNumber(2)};
+  XCTAssertEqual(3, static_cast<int32_t>(js_function_2(args, js_context.get_global_object())));
+  
+  js_context.ClearFunctionCache();
+  XCTAssertFalse(js_function_1 == js_context.CreateFunction("return a + b;", {"a", "b"}));
+  
+  js_context.set_function_cache_capacity(0);
+  XCTAssertEqual(0, js_context.get_function_cache_capacity());
+}
+
+TEST_F(JSContextTests, CheckScriptSyntaxParallel) {
+  const std::vector<std::string> paths = {"syntax_valid_1.js", "syntax_invalid.js", "syntax_valid_2.js"};
+  std::ofstream(paths[0]) << "var a = 1;";
+  std::ofstream(paths[1]) << "var a = 1;\nvar = ;";
+  std::ofstream(paths[2]) << "function f() { return 'caf\xC3\xA9'; }";
+  
+  auto diagnostics = CheckScriptSyntaxParallel({paths[0], paths[1], paths[2], "syntax_missing.js"}, 2);
+  XCTAssertEqual(4, diagnostics.size());
+  XCTAssertTrue(diagnostics[0].valid);
+  XCTAssertFalse(diagnostics[1].valid);
+  XCTAssertEqual("syntax_invalid.js", diagnostics[1].path);
+  XCTAssertEqual(2, diagnostics[1].line_number);
+  XCTAssertTrue(diagnostics[2].valid);
+  XCTAssertFalse(diagnostics[3].valid);
+  XCTAssertEqual(0, diagnostics[3].line_number);
+  
+  for (const auto& path : paths) {
+    std::remove(path.c_str());
+  }
+}
+
+TEST_F(JSContextTests, JSModuleLoader) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSModuleLoader js_module_loader(js_context);
+  js_module_loader.RegisterModule("math", "exports.add = function(a, b) { return a + b; }; math_count = (typeof math_count === 'undefined' ? 0 : math_count) + 1;");
+  js_module_loader.RegisterModule("main", "var math = require('math'); module.exports = math.add(1, 2);");
+  
+  // Nothing is evaluated until the first require.
+  XCTAssertFalse(js_module_loader.IsLoaded("math"));
+  XCTAssertEqual(3, static_cast<int32_t>(js_module_loader.Require("main")));
+  XCTAssertTrue(js_module_loader.IsLoaded("math"));
+  
+  // Modules are evaluated once.
+  js_module_loader.Require("math");
+  XCTAssertEqual(1, static_cast<int32_t>(js_context.JSEvaluateScript("math_count")));
+  
+  ASSERT_THROW(js_module_loader.Require("missing"), std::runtime_error);
+  
+  js_context.get_global_object().SetProperty("require", js_module_loader.get_require_function());
+  XCTAssertEqual(3, static_cast<int32_t>(js_context.JSEvaluateScript("require('main')")));
+  XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("try { require('missing'); false; } catch (e) { e instanceof Error; }")));
+}
+
+TEST_F(JSContextTests, JSBundle) {
+  const auto path = GetTemporaryPath("JSContextTests.halb");
+  JSBundle::Write(path, {
+    {"main"     , "module.exports = require('lib/math').add(1, 2);"},
+    {"lib/math" , "exports.add = function(a, b) { return a + b; };"},
+    {"greeting" , "module.exports = '\xE2\x82\xAC caf\xC3\xA9';"}
+  });
+  ASSERT_THROW(JSBundle::Write(path, {{"a", "1"}, {"a", "2"}}), std::invalid_argument);
+  
+  {
+    JSBundle js_bundle(path);
+    XCTAssertEqual(3, js_bundle.size());
+    XCTAssertTrue(js_bundle.Contains("lib/math"));
+    XCTAssertFalse(js_bundle.Contains("lib"));
+    XCTAssertEqual("greeting", js_bundle.get_ids()[0]);
+    ASSERT_THROW(js_bundle.GetSource("missing"), std::runtime_error);
+    
+    // The stored hash is the one JSString computes.
+    const auto source = js_bundle.GetSource("lib/math");
+    const JSString expected("exports.add = function(a, b) { return a + b; };");
+    XCTAssertEqual(expected, source);
+    XCTAssertEqual(expected.hash_value(), source.hash_value());
+    XCTAssertEqual(JSString("module.exports = '\xE2\x82\xAC caf\xC3\xA9';").hash_value(), js_bundle.GetSource("greeting").hash_value());
+    
+    JSContext js_context = js_context_group.CreateContext();
+    JSModuleLoader js_module_loader(js_context);
+    js_module_loader.RegisterBundle(js_bundle);
+    XCTAssertEqual(3, static_cast<int32_t>(js_module_loader.Require("main")));
+    XCTAssertEqual("\xE2\x82\xAC caf\xC3\xA9", static_cast<std::string>(js_module_loader.Require("greeting")));
+  }
+  
+  std::ofstream(path, std::ios_base::binary | std::ios_base::trunc) << "not a bundle";
+  ASSERT_THROW(JSBundle js_bundle(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST_F(JSContextTests, JSContextPool) {
+  int initialize_count = 0;
+  JSContextPool js_context_pool(js_context_group, 2, [&initialize_count](const JSContext& js_context) {
+    ++initialize_count;
+    js_context.get_global_object().SetProperty("config", js_context.CreateString("initial"));
+  });
+  XCTAssertEqual(2, initialize_count);
+  XCTAssertEqual(2, js_context_pool.get_idle_count());
+  
+  {
+    auto lease = js_context_pool.Acquire();
+    XCTAssertEqual(1, js_context_pool.get_idle_count());
+    lease.get_context().JSEvaluateScript("config = 'changed'; this.scratch = 1;");
+  }
+  
+  // The returned context has its globals reset.
+  XCTAssertEqual(2, js_context_pool.get_idle_count());
+  {
+    auto lease = js_context_pool.Acquire();
+    auto global_object = lease.get_context().get_global_object();
+    XCTAssertEqual("initial", static_cast<std::string>(global_object.GetProperty("config")));
+    XCTAssertFalse(global_object.HasProperty("scratch"));
+    lease.MarkDirty();
+  }
+  
+  // A dirty context is discarded, and a new one is created on demand.
+  XCTAssertEqual(1, js_context_pool.get_idle_count());
+  auto lease_1 = js_context_pool.Acquire();
+  auto lease_2 = js_context_pool.Acquire();
+  XCTAssertEqual(3, initialize_count);
+  XCTAssertEqual(0, js_context_pool.get_idle_count());
+}
+
+TEST_F(JSContextTests, JSMemoryPressure) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.set_function_cache_capacity(4);
+  const auto js_function_1 = js_context.CreateFunction("return 1;");
+  js_context.CreateFunction("return 2;");
+  js_context.CreateFunction("return 3;");
+  const auto js_function_4 = js_context.CreateFunction("return 4;");
+  
+  JSContextPool js_context_pool(js_context_group, 2, nullptr);
+  
+  std::size_t handler_fraction_count = 0;
+  const auto id = JSMemoryPressure::AddHandler([&handler_fraction_count](double fraction) -> std::size_t {
+    ++handler_fraction_count;
+    return fraction == 0.5 ? 10 : 0;
+  });
+  
+  // Half of each cache is evicted, least recently used first.
+  auto result = OnMemoryPressure(JSMemoryPressureLevel::Moderate);
+  XCTAssertEqual(1, handler_fraction_count);
+  XCTAssertEqual(1, js_context_pool.get_idle_count());
+  XCTAssertEqual(true, result.cache_bytes_reclaimed > 10);
+  XCTAssertEqual(true, result.collected_context_group_count >= 1);
+  XCTAssertEqual(true, js_function_4 == js_context.CreateFunction("return 4;"));
+  XCTAssertFalse(js_function_1 == js_context.CreateFunction("return 1;"));
+  
+  JSMemoryPressure::RemoveHandler(id);
+  result = OnMemoryPressure(JSMemoryPressureLevel::Critical);
+  XCTAssertEqual(1, handler_fraction_count);
+  XCTAssertEqual(0, js_context_pool.get_idle_count());
+  XCTAssertFalse(js_function_4 == js_context.CreateFunction("return 4;"));
+  XCTAssertEqual(result.cache_bytes_reclaimed + result.heap_bytes_reclaimed, result.get_bytes_reclaimed());
+  
+  // The pool creates contexts again once they are needed.
+  auto lease = js_context_pool.Acquire();
+  XCTAssertEqual(0, js_context_pool.get_idle_count());
+}
+
+TEST_F(JSContextTests, JSWorkerPool) {
+  std::atomic<int> initialize_count { 0 };
+  std::vector<std::future<int32_t>> futures;
+  {
+    JSWorkerPool js_worker_pool(4, [&initialize_count](const JSContext& js_context) {
+      ++initialize_count;
+      js_context.JSEvaluateScript("function square(x) { return x * x; }");
+    });
+    XCTAssertEqual(4, js_worker_pool.get_thread_count());
+    
+    for (int i = 0; i < 100; ++i) {
+      futures.push_back(js_worker_pool.Submit([i](const JSContext& js_context) {
+        return static_cast<int32_t>(js_context.JSEvaluateScript("square(" + std::to_string(i) + ")"));
+      }));
+    }
+    
+    auto failure = js_worker_pool.Submit([](const JSContext& js_context) {
+      return js_context.JSEvaluateScript("throw new Error('oops')").IsUndefined();
+    });
+    ASSERT_THROW(failure.get(), std::runtime_error);
+  }
+  
+  XCTAssertEqual(4, initialize_count);
+  for (int i = 0; i < 100; ++i) {
+    XCTAssertEqual(i * i, futures[i].get());
+  }
+}
+
+TEST_F(JSContextTests, JSWorkerPlacement) {
+  for (const auto placement : { JSWorkerPlacement::Core, JSWorkerPlacement::NumaNode }) {
+    JSWorkerPool js_worker_pool(8, nullptr, placement);
+    XCTAssertEqual(placement, js_worker_pool.get_placement());
+    
+    // Pinned workers run tasks like any others.
+    std::vector<std::future<int32_t>> futures;
+    for (int i = 0; i < 16; ++i) {
+      futures.push_back(js_worker_pool.Submit([i](const JSContext& js_context) {
+        return static_cast<int32_t>(js_context.JSEvaluateScript(std::to_string(i) + " * 2"));
+      }));
+    }
+    for (int i = 0; i < 16; ++i) {
+      XCTAssertEqual(i * 2, futures[i].get());
+    }
+  }
+}
+
+TEST_F(JSContextTests, JSWorkerPoolPriority) {
+  JSWorkerPool js_worker_pool(1);
+  
+  // Hold the only worker so that the tasks below stay queued.
+  std::promise<void> started;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  auto gate = js_worker_pool.Submit([&started, released](const JSContext&) {
+    started.set_value();
+    released.wait();
+  });
+  started.get_future().wait();
+  
+  std::mutex order_mutex;
+  std::vector<std::string> order;
+  const auto record = [&order_mutex, &order](const std::string& name) {
+    return [&order_mutex, &order, name](const JSContext&) {
+      std::lock_guard<std::mutex> lock(order_mutex);
+      order.push_back(name);
+    };
+  };
+  
+  JSTaskQueueOptions drop_oldest;
+  drop_oldest.capacity = 1;
+  drop_oldest.policy   = JSBackpressurePolicy::DropOldest;
+  js_worker_pool.set_queue_options(JSTaskPriority::Background, drop_oldest);
+  auto dropped    = js_worker_pool.Submit(record("dropped"), JSTaskPriority::Background);
+  auto background = js_worker_pool.Submit(record("background"), JSTaskPriority::Background);
+  ASSERT_THROW(dropped.get(), std::future_error);
+  
+  JSTaskQueueOptions reject;
+  reject.capacity = 1;
+  js_worker_pool.set_queue_options(JSTaskPriority::Normal, reject);
+  auto normal = js_worker_pool.Submit(record("normal"));
+  ASSERT_THROW(js_worker_pool.Submit(record("rejected")), std::runtime_error);
+  
+  auto high = js_worker_pool.Submit(record("high"), JSTaskPriority::High);
+  release.set_value();
+  gate.get();
+  background.get();
+  normal.get();
+  high.get();
+  
+  // Higher priorities run first, whatever order they were queued in.
+  XCTAssertEqual(3, order.size());
+  XCTAssertEqual("high", order[0]);
+  XCTAssertEqual("normal", order[1]);
+  XCTAssertEqual("background", order[2]);
+  
+  const auto statistics = js_worker_pool.GetLaneStatistics(JSTaskPriority::Background);
+  XCTAssertEqual(2, statistics.enqueued_count);
+  XCTAssertEqual(1, statistics.run_count);
+  XCTAssertEqual(1, statistics.dropped_count);
+  XCTAssertEqual(0, statistics.queued_count);
+  XCTAssertEqual(1, js_worker_pool.GetLaneStatistics(JSTaskPriority::Normal).rejected_count);
+}
+
+TEST_F(JSContextTests, JSRunLoop) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.JSEvaluateScript("var completions = [];");
+  JSRunLoop js_run_loop(js_context);
+  
+  // Completions posted from other threads are delivered in the order
+  // each thread posted them.
+  std::vector<std::thread> producers;
+  for (int i = 0; i < 4; ++i) {
+    producers.emplace_back([js_run_loop, i]() {
+      for (int j = 0; j < 25; ++j) {
+        js_run_loop.Post([i, j](const JSContext& js_context) {
+          js_context.JSEvaluateScript("completions.push(" + std::to_string(i * 100 + j) + ");");
+        });
+      }
+    });
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  
+  XCTAssertEqual(100, js_run_loop.RunUntilIdle());
+  XCTAssertEqual(100, static_cast<int32_t>(js_context.JSEvaluateScript("completions.length")));
+  XCTAssertEqual(true, static_cast<bool>(js_context.JSEvaluateScript("completions.every(function(c, k) { return c % 100 === 0 || completions.indexOf(c - 1) < k; })")));
+  XCTAssertEqual(0, js_run_loop.RunUntilIdle());
+  
+  // RunFor sleeps while the queue is empty.
+  std::thread producer([js_run_loop]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    js_run_loop.Post([](const JSContext& js_context) {
+      js_context.JSEvaluateScript("completions = 'done';");
+    });
+  });
+  std::size_t task_count = 0;
+  while (task_count == 0) {
+    task_count = js_run_loop.RunFor(std::chrono::milliseconds(50));
+  }
+  producer.join();
+  XCTAssertEqual(1, task_count);
+  XCTAssertEqual("done", static_cast<std::string>(js_context.JSEvaluateScript("completions")));
+}
+
+TEST_F(JSContextTests, JSRunLoopPriority) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.JSEvaluateScript("var order = [];");
+  JSRunLoop js_run_loop(js_context);
+  const auto record = [](const std::string& name) {
+    return [name](const JSContext& js_context) {
+      js_context.JSEvaluateScript("order.push('" + name + "');");
+    };
+  };
+  
+  // Higher priorities run first, whatever order they were posted in.
+  js_run_loop.Post(record("background"), JSTaskPriority::Background);
+  js_run_loop.Post(record("normal"));
+  js_run_loop.Post(record("high"), JSTaskPriority::High);
+  XCTAssertEqual(3, js_run_loop.RunUntilIdle());
+  XCTAssertEqual("high,normal,background", static_cast<std::string>(js_context.JSEvaluateScript("order.join()")));
+  
+  auto statistics = js_run_loop.GetLaneStatistics(JSTaskPriority::High);
+  XCTAssertEqual(1, statistics.enqueued_count);
+  XCTAssertEqual(1, statistics.run_count);
+  XCTAssertEqual(0, statistics.queued_count);
+  XCTAssertEqual(true, statistics.max_queueing_delay >= statistics.p50_queueing_delay);
+  
+  // A full lane rejects, and Block acts as Reject on the owning thread.
+  JSTaskQueueOptions options;
+  options.capacity = 1;
+  js_run_loop.set_queue_options(JSTaskPriority::Normal, options);
+  js_run_loop.Post(record("kept"));
+  ASSERT_THROW(js_run_loop.Post(record("rejected")), std::runtime_error);
+  options.policy = JSBackpressurePolicy::Block;
+  js_run_loop.set_queue_options(JSTaskPriority::Normal, options);
+  ASSERT_THROW(js_run_loop.Post(record("rejected")), std::runtime_error);
+  XCTAssertEqual(2, js_run_loop.GetLaneStatistics(JSTaskPriority::Normal).rejected_count);
+  
+  // Another thread waits for the owning thread to make room.
+  std::thread producer([js_run_loop, record]() {
+    js_run_loop.Post(record("blocked"));
+  });
+  std::size_t task_count = 0;
+  while (task_count < 2) {
+    task_count += js_run_loop.RunFor(std::chrono::milliseconds(10));
+  }
+  producer.join();
+  XCTAssertEqual("kept,blocked", static_cast<std::string>(js_context.JSEvaluateScript("order.slice(3).join()")));
+  
+  // DropOldest keeps the newest tasks.
+  options.capacity = 2;
+  options.policy   = JSBackpressurePolicy::DropOldest;
+  js_run_loop.set_queue_options(JSTaskPriority::Background, options);
+  js_run_loop.Post(record("first"), JSTaskPriority::Background);
+  js_run_loop.Post(record("second"), JSTaskPriority::Background);
+  js_run_loop.Post(record("third"), JSTaskPriority::Background);
+  XCTAssertEqual(2, js_run_loop.RunUntilIdle());
+  XCTAssertEqual("second,third", static_cast<std::string>(js_context.JSEvaluateScript("order.slice(5).join()")));
+  
+  statistics = js_run_loop.GetLaneStatistics(JSTaskPriority::Background);
+  XCTAssertEqual(4, statistics.enqueued_count);
+  XCTAssertEqual(3, statistics.run_count);
+  XCTAssertEqual(1, statistics.dropped_count);
+}
+
+TEST_F(JSContextTests, JSMessageChannel) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSContextGroup other_context_group;
+  JSContext other_context = other_context_group.CreateContext();
+  JSRunLoop js_run_loop(js_context);
+  JSRunLoop other_run_loop(other_context);
+  JSMessageChannel js_message_channel(js_run_loop, other_run_loop);
+  auto port1 = js_message_channel.get_port1();
+  auto port2 = js_message_channel.get_port2();
+  
+  std::vector<JSObject> received;
+  port2.set_message_handler([&received](const JSContext& js_context, const JSValue& message) {
+    received.push_back(static_cast<JSObject>(message));
+  });
+  
+  // The message is serialized when it is posted.
+  auto message = js_context.JSEvaluateScript("var o = { name: 'point', values: [1, 2, 3], when: new Date(0) }; o.self = o; o");
+  port1.PostMessage(message);
+  js_context.JSEvaluateScript("o.name = 'changed'");
+  port1.PostMessage(message);
+  XCTAssertEqual(2, port2.get_pending_message_count());
+  
+  // Both messages are delivered by one task.
+  XCTAssertEqual(1, other_run_loop.RunUntilIdle());
+  XCTAssertEqual(2, received.size());
+  const auto clone = received[0];
+  XCTAssertEqual("point", static_cast<std::string>(clone.GetProperty("name")));
+  XCTAssertEqual("changed", static_cast<std::string>(received[1].GetProperty("name")));
+  XCTAssertEqual(3, static_cast<JSArray>(static_cast<JSObject>(clone.GetProperty("values"))).GetLength());
+  XCTAssertEqual(0, static_cast<double>(clone.GetProperty("when")));
+  XCTAssertTrue(clone.GetProperty("self") == clone);
+  
+  // Messages wait for a handler.
+  port2.PostMessage(other_context.CreateNumber(42));
+  XCTAssertEqual(1, js_run_loop.RunUntilIdle());
+  XCTAssertEqual(1, port1.get_pending_message_count());
+  port1.set_message_handler([](const JSContext& js_context, const JSValue& message) {
+    js_context.get_global_object().SetProperty("answer", message);
+  });
+  XCTAssertEqual(1, js_run_loop.RunUntilIdle());
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.JSEvaluateScript("answer")));
+  
+  ASSERT_THROW(port1.PostMessage(js_context.JSEvaluateScript("({ f: function() {} })")), std::runtime_error);
+  
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  auto source_array = js_context.CreateTypedArray<double>(std::vector<double> { 1.5, 2.5 });
+  port1.PostMessage(source_array, { static_cast<JSObject>(source_array.GetBuffer()) });
+  XCTAssertEqual(1, other_run_loop.RunUntilIdle());
+  auto transferred_array = JSTypedArray<double>(received.back());
+  XCTAssertEqual(2.5, transferred_array.GetBytesPtr()[1]);
+  XCTAssertEqual(source_array.GetBytesPtr(), transferred_array.GetBytesPtr());
+  
+  ASSERT_THROW(port1.PostMessage(source_array, { source_array }), std::invalid_argument);
+#endif
+  
+  port1.Close();
+  port1.PostMessage(message);
+  XCTAssertEqual(0, port2.get_pending_message_count());
+}
+
+TEST_F(JSContextTests, JSPromiseResolver) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSRunLoop js_run_loop(js_context);
+  auto global_object = js_context.get_global_object();
+  
+  auto fulfilled = js_run_loop.CreatePromise();
+  global_object.SetProperty("fulfilled", fulfilled.first);
+  js_context.JSEvaluateScript("var result; fulfilled.then(function(value) { result = value; });");
+  
+  const auto resolver = fulfilled.second;
+  std::thread([resolver]() {
+    resolver.Resolve([](const JSContext& js_context) -> JSValue {
+      return js_context.CreateNumber(42);
+    });
+  }).join();
+  XCTAssertEqual(false, resolver.Reject("too late"));
+  XCTAssertEqual(true, js_context.JSEvaluateScript("result").IsUndefined());
+  
+  XCTAssertEqual(1, js_run_loop.RunUntilIdle());
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.JSEvaluateScript("result")));
+  
+  // A promise whose resolvers are all destroyed is rejected.
+  global_object.SetProperty("abandoned", js_run_loop.CreatePromise().first);
+  js_context.JSEvaluateScript("var reason; abandoned.catch(function(error) { reason = error.message; });");
+  XCTAssertEqual(1, js_run_loop.RunUntilIdle());
+  XCTAssertEqual("The promise was abandoned by its JSPromiseResolver", static_cast<std::string>(js_context.JSEvaluateScript("reason")));
+}
+
+#ifndef _WIN32
+TEST_F(JSContextTests, JSRunLoopWatch) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSRunLoop js_run_loop(js_context);
+  int descriptors[2];
+  XCTAssertEqual(0, pipe(descriptors));
+  
+  std::string received;
+  const auto id = js_run_loop.Watch(descriptors[0], kJSIOReadable, [&received, descriptors](const JSContext&, const JSIOEvent&) {
+    char buffer[16];
+    const auto length = read(descriptors[0], buffer, sizeof(buffer));
+    if (length > 0) {
+      received.append(buffer, static_cast<std::size_t>(length));
+    }
+  });
+  XCTAssertEqual(0, js_run_loop.RunUntilIdle());
+  
+  // RunFor sleeps until the descriptor is readable.
+  std::thread writer([descriptors]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    XCTAssertEqual(4, write(descriptors[1], "ping", 4));
+  });
+  std::size_t handler_count = 0;
+  while (handler_count == 0) {
+    handler_count = js_run_loop.RunFor(std::chrono::milliseconds(50));
+  }
+  writer.join();
+  XCTAssertEqual(1, handler_count);
+  XCTAssertEqual("ping", received);
+  
+  XCTAssertTrue(js_run_loop.Unwatch(id));
+  XCTAssertFalse(js_run_loop.Unwatch(id));
+  XCTAssertEqual(4, write(descriptors[1], "pong", 4));
+  XCTAssertEqual(0, js_run_loop.RunUntilIdle());
+  close(descriptors[0]);
+  close(descriptors[1]);
+}
+#endif
+
+TEST_F(JSContextTests, JSRunLoopGet) {
+  JSContext js_context = js_context_group.CreateContext();
+  ASSERT_THROW(JSRunLoop::Get(js_context), std::runtime_error);
+  {
+    JSRunLoop js_run_loop(js_context);
+    int count = 0;
+    JSRunLoop::Get(js_context).Post([&count](const JSContext&) { ++count; });
+    XCTAssertEqual(1, js_run_loop.RunUntilIdle());
+    XCTAssertEqual(1, count);
+  }
+  ASSERT_THROW(JSRunLoop::Get(js_context), std::runtime_error);
+}
+
+TEST_F(JSContextTests, JSTimerWheel) {
+  detail::JSTimerWheel timer_wheel;
+  timer_wheel.Schedule(1, 70);
+  timer_wheel.Schedule(2, 5);
+  timer_wheel.Schedule(3, 5000);
+  timer_wheel.Schedule(4, 1ull << 30);
+  timer_wheel.Schedule(5, 5);
+  XCTAssertEqual(true, timer_wheel.Cancel(5));
+  XCTAssertEqual(false, timer_wheel.Cancel(5));
+  XCTAssertEqual(5, timer_wheel.GetNextEventTick());
+  
+  std::vector<std::uint64_t> expired_ids;
+  timer_wheel.Advance(4999, expired_ids);
+  XCTAssertEqual(std::vector<std::uint64_t>({ 2, 1 }), expired_ids);
+  
+  expired_ids.clear();
+  timer_wheel.Advance(1ull << 30, expired_ids);
+  XCTAssertEqual(std::vector<std::uint64_t>({ 3, 4 }), expired_ids);
+  XCTAssertEqual(0, timer_wheel.size());
+  XCTAssertEqual(0, timer_wheel.GetNextEventTick());
+}
+
+TEST_F(JSContextTests, JSTimers) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSRunLoop js_run_loop(js_context);
+  JSTimers js_timers(js_run_loop);
+  js_timers.Install(js_context.get_global_object());
+  
+  js_context.JSEvaluateScript(
+    "var log = [];"
+    "setTimeout(function(label) { log.push(label); }, 20, 'second');"
+    "setTimeout(function() { log.push('first'); }, 0);"
+    "clearTimeout(setTimeout(function() { log.push('cleared'); }, 10));"
+    "var ticks = 0;"
+    "var interval = setInterval(function() { if (++ticks === 3) { clearInterval(interval); } }, 5);");
+  XCTAssertEqual(3, js_timers.get_timer_count());
+  
+  for (int i = 0; i < 100 && js_timers.get_timer_count() > 0; ++i) {
+    js_run_loop.RunFor(std::chrono::milliseconds(10));
+  }
+  XCTAssertEqual(0, js_timers.get_timer_count());
+  XCTAssertEqual("first,second", static_cast<std::string>(js_context.JSEvaluateScript("log.join()")));
+  XCTAssertEqual(3, static_cast<int32_t>(js_context.JSEvaluateScript("ticks")));
+  
+  ASSERT_THROW(js_context.JSEvaluateScript("setTimeout('log.push(1)', 0)"), std::runtime_error);
+}
+
+TEST_F(JSContextTests, JSConsole) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  // The sink is called on the thread of the JSConsole.
+  std::mutex mutex;
+  std::vector<std::pair<JSConsoleLevel, std::string>> messages;
+  JSConsole js_console([&mutex, &messages](JSConsoleLevel level, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    messages.emplace_back(level, message);
+  });
+  js_console.Install(js_context);
+  XCTAssertEqual(JSConsoleLevel::Log, js_console.get_level());
+  
+  js_context.JSEvaluateScript(
+    "console.log('hello', 42, 1.5, true, null, undefined);"
+    "console.debug('rejected');"
+    "console.warn([1, 'two'], { a: 1 });"
+    "console.error(new Error('oops'));");
+  js_console.Flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(3, messages.size());
+    XCTAssertEqual(JSConsoleLevel::Log, messages[0].first);
+    XCTAssertEqual("hello 42 1.5 true null undefined", messages[0].second);
+    XCTAssertEqual(JSConsoleLevel::Warn, messages[1].first);
+    XCTAssertEqual("[1,\"two\"] {\"a\":1}", messages[1].second);
+    XCTAssertEqual(JSConsoleLevel::Error, messages[2].first);
+    XCTAssertEqual("Error: oops", messages[2].second);
+    messages.clear();
+  }
+  
+  // Objects are converted when console is called, not when written.
+  js_console.set_level(JSConsoleLevel::Debug);
+  js_context.JSEvaluateScript("var o = { n: 1 }; console.debug(o); o.n = 2;");
+  js_console.set_level(JSConsoleLevel::Off);
+  js_context.JSEvaluateScript("console.error('rejected');");
+  js_console.Flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(1, messages.size());
+    XCTAssertEqual("{\"n\":1}", messages[0].second);
+  }
+  XCTAssertEqual(0, js_console.get_dropped_count());
+  XCTAssertEqual(std::string("warn"), to_string(JSConsoleLevel::Warn));
+}
+
+TEST_F(JSContextTests, JSConsoleNumbers) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  std::mutex mutex;
+  std::vector<std::string> messages;
+  JSConsole js_console([&mutex, &messages](JSConsoleLevel, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    messages.push_back(message);
+  });
+  js_console.Install(js_context);
+  
+  // Numbers are written as String would write them, including
+  // exponents and integers beyond 2^53.
+  const char* numbers = "[1e-7, Math.pow(2, 60), 0.1, 0.1 + 0.2, -1234.5678, 1e21, 123e20, -1.5e-10, 0.000001, 1.2345e-6, 9007199254740993, 5e-324, Number.MAX_VALUE, -0, 100, NaN, -Infinity]";
+  const auto expected = static_cast<std::string>(js_context.JSEvaluateScript(std::string(numbers) + ".map(String).join(' ')"));
+  XCTAssertEqual("1e-7 1152921504606847000 0.1 0.30000000000000004 -1234.5678 1e+21 1.23e+22 -1.5e-10 0.000001 0.0000012345 9007199254740992 5e-324 1.7976931348623157e+308 0 100 NaN -Infinity", expected);
+  js_context.JSEvaluateScript(std::string("console.log.apply(console, ") + numbers + ")");
+  js_console.Flush();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(1, messages.size());
+    XCTAssertEqual(expected, messages[0]);
+  }
+}
+
+TEST_F(JSContextTests, JSConsoleDroppedMessages) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  // The sink holds the thread of the JSConsole until open is set, so
+  // the messages logged meanwhile fill the queue.
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool entered = false;
+  bool open    = false;
+  std::vector<std::pair<JSConsoleLevel, std::string>> messages;
+  JSConsole js_console([&](JSConsoleLevel level, const std::string& message) {
+    std::unique_lock<std::mutex> lock(mutex);
+    messages.emplace_back(level, message);
+    entered = true;
+    condition.notify_all();
+    condition.wait(lock, [&open] { return open; });
+  }, 2);
+  js_console.Install(js_context);
+  
+  js_context.JSEvaluateScript("console.log('first');");
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&entered] { return entered; });
+  }
+  
+  // Two of these fit in the queue and the other three are dropped.
+  js_context.JSEvaluateScript("for (var i = 0; i < 5; ++i) { console.log('message', i); }");
+  XCTAssertEqual(3, js_console.get_dropped_count());
+  
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    open = true;
+  }
+  condition.notify_all();
+  js_console.Flush();
+  
+  // The drops are reported once the message being written when they
+  // happened is done, before the queued messages.
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(4, messages.size());
+  XCTAssertEqual("first", messages[0].second);
+  XCTAssertEqual(JSConsoleLevel::Warn, messages[1].first);
+  XCTAssertEqual("JSConsole: dropped 3 messages", messages[1].second);
+  XCTAssertEqual("message 0", messages[2].second);
+  XCTAssertEqual("message 1", messages[3].second);
+  XCTAssertEqual(3, js_console.get_dropped_count());
+}
+
+namespace {
+  struct SlotValue {
+    explicit SlotValue(int& destroyed_count) : destroyed_count(destroyed_count) {
+    }
+    ~SlotValue() {
+      ++destroyed_count;
+    }
+    int& destroyed_count;
+    int  value { 0 };
+  };
+}
+
+TEST_F(JSContextTests, ContextSlots) {
+  static const auto index = JSContext::AllocateSlot();
+  const auto other_index  = JSContext::AllocateSlot();
+  XCTAssertNotEqual(index, other_index);
+  
+  int destroyed_count = 0;
+  {
+    JSContext js_context = js_context_group.CreateContext();
+    XCTAssertTrue(js_context.GetSlot<SlotValue>(index) == nullptr);
+    js_context.SetSlot(index, std::make_shared<SlotValue>(destroyed_count));
+    js_context.GetSlot<SlotValue>(index) -> value = 42;
+    
+    // A JSContext made from the JSContextRef, as in a callback, has
+    // the same slots.
+    JSContext js_context_copy(static_cast<JSContextRef>(js_context));
+    XCTAssertEqual(42, js_context_copy.GetSlot<SlotValue>(index) -> value);
+    XCTAssertTrue(js_context_copy.GetSlot<SlotValue>(other_index) == nullptr);
+    
+    JSContext other_js_context = js_context_group.CreateContext();
+    XCTAssertTrue(other_js_context.GetSlot<SlotValue>(index) == nullptr);
+    
+    // Replacing a value destroys it once nothing holds it.
+    auto old_value = js_context.GetSlot<SlotValue>(index);
+    js_context_copy.SetSlot(index, std::make_shared<SlotValue>(destroyed_count));
+    XCTAssertEqual(0, destroyed_count);
+    XCTAssertEqual(42, old_value -> value);
+    old_value.reset();
+    XCTAssertEqual(1, destroyed_count);
+    XCTAssertEqual(0, js_context.GetSlot<SlotValue>(index) -> value);
+    
+    // GetOrCreateSlot only creates a value for an empty slot.
+    int create_count = 0;
+    const auto create = [&destroyed_count, &create_count] {
+      ++create_count;
+      return std::make_shared<SlotValue>(destroyed_count);
+    };
+    const auto created = other_js_context.GetOrCreateSlot<SlotValue>(index, create);
+    XCTAssertTrue(created == other_js_context.GetOrCreateSlot<SlotValue>(index, create));
+    XCTAssertTrue(js_context.GetOrCreateSlot<SlotValue>(index, create) == js_context.GetSlot<SlotValue>(index));
+    XCTAssertEqual(1, create_count);
+    
+    ASSERT_THROW(js_context.SetSlot(JSContext::AllocateSlot() + 1, std::make_shared<int>(0)), std::invalid_argument);
+  }
+  
+  // And the values are destroyed with the last JSContext.
+  XCTAssertEqual(3, destroyed_count);
+}
+
+TEST_F(JSContextTests, JSIdleGarbageCollector) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSRunLoop js_run_loop(js_context);
+  
+  JSIdleGarbageCollectorOptions options;
+  options.full_collection_budget               = std::chrono::milliseconds(1);
+  options.full_collection_allocation_threshold = 10;
+  JSIdleGarbageCollector js_idle_garbage_collector(js_run_loop, options);
+  XCTAssertEqual(10, js_idle_garbage_collector.get_options().full_collection_allocation_threshold);
+  
+  // Nothing has been allocated yet, so an idle gap is left alone.
+  js_run_loop.RunFor(std::chrono::milliseconds(20));
+  XCTAssertEqual(0, js_idle_garbage_collector.get_full_collection_count());
+  
+  for (int i = 0; i < 20; ++i) {
+    js_context.CreateNumber(i);
+  }
+  
+  // No collection happens inside a deferred window.
+  js_idle_garbage_collector.DeferUntil(std::chrono::steady_clock::now() + std::chrono::hours(1));
+  js_run_loop.RunFor(std::chrono::milliseconds(20));
+  XCTAssertEqual(0, js_idle_garbage_collector.get_full_collection_count());
+  
+  js_idle_garbage_collector.DeferUntil(std::chrono::steady_clock::now());
+  js_run_loop.RunFor(std::chrono::milliseconds(20));
+  XCTAssertEqual(1, js_idle_garbage_collector.get_full_collection_count());
+}
+
+TEST_F(JSContextTests, GarbageCollectionCallback) {
+  JSContext js_context = js_context_group.CreateContext();
+  std::vector<JSGarbageCollectionEvent> events;
+  JSContext::set_garbage_collection_callback([&events](const JSContext&, JSGarbageCollectionEvent event, std::chrono::nanoseconds pause) {
+    events.push_back(event);
+    if (event == JSGarbageCollectionEvent::Begin) {
+      XCTAssertEqual(0, pause.count());
+    }
+  });
+  
+  const auto before = JSContext::GetGarbageCollectionStatistics();
+  js_context.GarbageCollect();
+  const auto after  = JSContext::GetGarbageCollectionStatistics();
+  JSContext::set_garbage_collection_callback(nullptr);
+  js_context.GarbageCollect();
+  
+  XCTAssertEqual(2, events.size());
+  XCTAssertEqual(true, events[0] == JSGarbageCollectionEvent::Begin);
+  XCTAssertEqual(true, events[1] == JSGarbageCollectionEvent::End);
+  XCTAssertEqual(before.collection_count + 1, after.collection_count);
+  XCTAssertEqual(true, after.total_pause_nanoseconds >= before.total_pause_nanoseconds);
+  XCTAssertEqual(true, after.max_pause_nanoseconds >= before.max_pause_nanoseconds);
+}
+
+TEST_F(JSContextTests, JSContextTemplate) {
+  JSContext config_context = js_context_group.CreateContext();
+  const auto config = config_context.JSEvaluateScript("({ name: 'hal', limits: [1, 2, 3] })");
+  
+  int initialize_count = 0;
+  JSContextTemplate js_context_template(js_context_group);
+  js_context_template.AddScript("function greet(name) { return 'hello ' + name; }");
+  js_context_template.AddConstant("config", config, {JSPropertyAttribute::ReadOnly});
+  js_context_template.AddInitializer([&initialize_count](const JSContext& js_context) {
+    ++initialize_count;
+    js_context.get_global_object().SetProperty("initialized", js_context.CreateBoolean(true));
+  });
+  
+  JSContext js_context_1 = js_context_template.CreateContext();
+  JSContext js_context_2 = js_context_template.CreateContext();
+  XCTAssertEqual(2, initialize_count);
+  XCTAssertEqual("hello hal", static_cast<std::string>(js_context_1.JSEvaluateScript("greet(config.name)")));
+  XCTAssertEqual(true, static_cast<bool>(js_context_2.JSEvaluateScript("initialized")));
+  
+  // Each context gets its own copy of a constant.
+  js_context_1.JSEvaluateScript("config.limits.push(4)");
+  XCTAssertEqual(3, static_cast<int32_t>(js_context_2.JSEvaluateScript("config.limits.length")));
+  
+#ifdef HAL_SCRIPT_REF_ENABLE
+  // Scripts are parsed when they are added.
+  ASSERT_THROW(js_context_template.AddScript("function ("), std::runtime_error);
+#endif
+}
+
+TEST_F(JSContextTests, JSTrace) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  JSTrace::Start();
+  XCTAssertTrue(JSTrace::IsEnabled());
+  js_context.JSEvaluateScript("(function () { return 42; })()");
+  js_context.GarbageCollect();
+  JSTrace::Stop();
+  XCTAssertFalse(JSTrace::IsEnabled());
+  
+  // Nothing is recorded after Stop.
+  js_context.JSEvaluateScript("42");
+  const auto trace = JSTrace::ToJSON();
+  XCTAssertTrue(js_context.CreateValueFromJSON(trace).IsObject());
+  
+#ifdef HAL_TRACE_ENABLE
+  XCTAssertEqual(2, JSTrace::get_event_count());
+  XCTAssertEqual(0, JSTrace::get_dropped_event_count());
+  XCTAssertNotEqual(std::string::npos, trace.find("\"name\":\"JSEvaluateScript\",\"cat\":\"script\",\"ph\":\"X\""));
+  XCTAssertNotEqual(std::string::npos, trace.find("\"name\":\"GarbageCollect\""));
+  
+  // Start discards the last trace.
+  JSTrace::Start();
+  JSTrace::Stop();
+  XCTAssertEqual(0, JSTrace::get_event_count());
+#else
+  XCTAssertEqual(0, JSTrace::get_event_count());
+#endif
+}
+
+TEST_F(JSContextTests, JSStackProfiler) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSFunctionCallback callback = [](const std::vector<JSValue>&, JSObject& this_object) {
+    return this_object.get_context().CreateNumber(42);
+  };
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("native", js_context.CreateFunction("native", callback));
+  
+  ASSERT_THROW(JSStackProfiler::Start(0), std::invalid_argument);
+  JSStackProfiler::Start(2);
+  js_context.JSEvaluateScript("function hot() { return native(); } for (var i = 0; i < 10; ++i) { hot(); }");
+  JSStackProfiler::Stop();
+  XCTAssertFalse(JSStackProfiler::IsEnabled());
+  
+#ifdef HAL_STACK_PROFILE_ENABLE
+  // Every second call is sampled, and each sample ends in the native
+  // callback with the script frames above it.
+  XCTAssertEqual(5, JSStackProfiler::get_sample_count());
+  const auto folded = JSStackProfiler::ToFoldedStacks();
+  XCTAssertNotEqual(std::string::npos, folded.find(";hot@"));
+  XCTAssertNotEqual(std::string::npos, folded.find(";JSFunction:JSFunctionCallback 5\n"));
+#else
+  XCTAssertEqual(0, JSStackProfiler::get_sample_count());
+  XCTAssertEqual("", JSStackProfiler::ToFoldedStacks());
+#endif
+}
+
+#ifdef HAL_API_STATISTICS_ENABLE
+TEST_F(JSContextTests, APIStatistics) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.ResetAPIStatistics();
+  
+  auto js_object = js_context.CreateObject();
+  js_object.SetProperty("answer", js_context.CreateNumber(42));
+  XCTAssertEqual(true, js_object.HasProperty("answer"));
+  XCTAssertEqual(42, static_cast<int32_t>(js_object.GetProperty("answer")));
+  js_context.JSEvaluateScript("1 + 1");
+  
+  // A JSContext wrapping the same JSGlobalContextRef shares the counts.
+  const JSContext js_context_copy(static_cast<JSContextRef>(js_context));
+  const auto api_statistics = js_context_copy.GetAPIStatistics();
+  const auto calls = [&api_statistics](const std::string& category) -> std::uint64_t {
+    for (const auto& entry : api_statistics) {
+      if (category == entry.category) {
+        return entry.calls;
+      }
+    }
+    return 0;
+  };
+  XCTAssertEqual(1, calls("SetProperty"));
+  XCTAssertEqual(1, calls("HasProperty"));
+  XCTAssertEqual(1, calls("GetProperty"));
+  XCTAssertEqual(1, calls("ValueConversion"));
+  XCTAssertEqual(1, calls("EvaluateScript"));
+  
+  // The first call of each category is timed.
+  for (const auto& entry : api_statistics) {
+    XCTAssertEqual(entry.calls > 0 ? 1 : 0, entry.sampled_calls);
+  }
+  
+  const auto prometheus = JSStatistics::Capture(js_context_group).ToPrometheus();
+  XCTAssertNotEqual(std::string::npos, prometheus.find("hal_api_calls_total{category=\"EvaluateScript\"} 1\n"));
+}
+#endif
+
+#ifdef HAL_CPU_TIME_ENABLE
+TEST_F(JSContextTests, CPUTimeStatistics) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.ResetCPUTimeStatistics();
+  
+  // The callback busy waits, so its time is native CPU time.
+  js_context.get_global_object().SetProperty("spin", js_context.CreateFunction(JSFunctionArgumentsCallback([](const JSArguments&, JSObject& this_object) -> JSValue {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    while (std::chrono::steady_clock::now() < deadline) {
+    }
+    return this_object.get_context().CreateUndefined();
+  })));
+  js_context.JSEvaluateScript("var sum = 0; for (var i = 0; i < 1000000; ++i) { sum += i; } spin();");
+  
+  const auto cpu_time = js_context.GetCPUTimeStatistics();
+  XCTAssertEqual(1, cpu_time.entry_count);
+  XCTAssertEqual(1, cpu_time.callback_count);
+  XCTAssertEqual(true, cpu_time.native_time >= std::chrono::milliseconds(10));
+  XCTAssertEqual(true, cpu_time.js_time > std::chrono::nanoseconds(0));
+  
+  js_context.ResetCPUTimeStatistics();
+  XCTAssertEqual(0, js_context.GetCPUTimeStatistics().callback_count);
+}
+#endif
+
+TEST_F(JSContextTests, JSAllocationProfiler) {
+  JSContext js_context = js_context_group.CreateContext();
+  ASSERT_THROW(JSAllocationProfiler::Start(0), std::invalid_argument);
+  JSAllocationProfiler::Start(1);
+  {
+    HAL_ALLOCATION_SITE("CreateObjects");
+    for (int i = 0; i < 10; ++i) {
+      js_context.CreateObject();
+    }
+  }
+  JSAllocationProfiler::Stop();
+  XCTAssertFalse(JSAllocationProfiler::IsEnabled());
+  
+#ifdef HAL_ALLOCATION_PROFILE_ENABLE
+  const auto sites = JSAllocationProfiler::GetTopSites(1);
+  XCTAssertEqual(1, sites.size());
+  XCTAssertEqual(0, sites[0].site.find("CreateObjects ("));
+  XCTAssertEqual("JSObject", std::string(sites[0].kind));
+  XCTAssertEqual(true, sites[0].sample_count >= 10);
+  XCTAssertNotEqual(std::string::npos, JSAllocationProfiler::ToReport().find("CreateObjects ("));
+#else
+  XCTAssertEqual(0, JSAllocationProfiler::get_sample_count());
+  XCTAssertEqual(0, JSAllocationProfiler::GetTopSites().size());
+#endif
+}
+
+namespace {
+  
+  // A sink for JSLoggerPolicyAsync that keeps what its writer thread
+  // writes, and on which thread.
+  struct RecordingLogSink {
+    explicit RecordingLogSink(const std::string&) {
+    }
+    
+    void Write(const std::string& log_message) {
+      std::lock_guard<std::mutex> lock(GetMutex());
+      GetMessages().push_back(std::make_pair(log_message, std::this_thread::get_id()));
+    }
+    
+    static std::mutex& GetMutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+    
+    static std::vector<std::pair<std::string, std::thread::id>>& GetMessages() {
+      static std::vector<std::pair<std::string, std::thread::id>> messages;
+      return messages;
+    }
+  };
+  
+} // namespace {
+
+TEST_F(JSContextTests, JSLoggerPolicyAsync) {
+  const std::size_t thread_count  = 4;
+  const std::size_t message_count = 100;
+  const auto& messages = RecordingLogSink::GetMessages();
+  {
+    detail::JSLoggerPolicyAsync<RecordingLogSink> policy("unused");
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < thread_count; ++i) {
+      threads.emplace_back([&policy, i, message_count]() {
+        for (std::size_t j = 0; j < message_count; ++j) {
+          policy.Write(std::to_string(i) + ":" + std::to_string(j));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    
+    // Flush returns once the writer thread has written every message.
+    policy.Flush();
+    XCTAssertEqual(0, policy.get_dropped_count());
+    std::lock_guard<std::mutex> lock(RecordingLogSink::GetMutex());
+    XCTAssertEqual(thread_count * message_count, messages.size());
+    
+    // Each thread's messages keep their order, and are written by the
+    // writer thread.
+    std::vector<std::size_t> next(thread_count, 0);
+    for (const auto& message : messages) {
+      const auto separator = message.first.find(':');
+      const auto i         = std::stoul(message.first.substr(0, separator));
+      XCTAssertEqual(next[i], std::stoul(message.first.substr(separator + 1)));
+      ++next[i];
+      XCTAssertEqual(messages.front().second, message.second);
+      XCTAssertNotEqual(std::this_thread::get_id(), message.second);
+    }
+  }
+  
+  // Destroying the policy writes what is still queued.
+  {
+    detail::JSLoggerPolicyAsync<RecordingLogSink> policy("unused");
+    policy.Write("last");
+  }
+  XCTAssertEqual(thread_count * message_count + 1, messages.size());
+  XCTAssertEqual("last", messages.back().first);
+}
+
+TEST_F(JSContextTests, JSLoggerPolicyBufferedFile) {
+  detail::JSLoggerFileOptions options;
+  options.path             = "JSLoggerPolicyBufferedFile.log";
+  options.flush_interval   = std::chrono::hours(1);
+  options.max_file_bytes   = 16;
+  options.max_backup_count = 1;
+  {
+    detail::JSLoggerPolicyBufferedFile policy("unused.log", options);
+    policy.Write("first line");
+    
+    // Buffered until a flush.
+    std::ifstream unflushed(options.path);
+    std::string line;
+    XCTAssertFalse(std::getline(unflushed, line));
+    
+    policy.Write("second line");
+  }
+  
+  std::string line;
+  std::ifstream rotated(options.path + ".1");
+  XCTAssertTrue(std::getline(rotated, line));
+  XCTAssertEqual("first line", line);
+  std::ifstream current(options.path);
+  XCTAssertTrue(std::getline(current, line));
+  XCTAssertEqual("second line", line);
+  
+  std::remove(options.path.c_str());
+  std::remove((options.path + ".1").c_str());
+}
+
+TEST_F(JSContextTests, JSLoggerSeverityThreshold) {
+  // HAL_LOG_PRINT is used rather than HAL_LOG_DEBUG, which may not be
+  // compiled in, so that only the run time threshold is tested.
+  const auto threshold = static_cast<detail::JSLoggerSeverityType>(detail::JSLoggerPimpl::get_severity_threshold());
+  int evaluations = 0;
+  
+  detail::SetJSLoggerSeverityThreshold(detail::JSLoggerSeverityType::JS_WARN);
+  XCTAssertFalse(detail::IsJSLoggerSeverityEnabled(detail::JSLoggerSeverityType::JS_DEBUG));
+  HAL_LOG_PRINT(JS_DEBUG, "JSLoggerSeverityThreshold: ", ++evaluations);
+  HAL_LOG_PRINT_EVERY_N(JS_DEBUG, 1, "JSLoggerSeverityThreshold: ", ++evaluations);
+  XCTAssertEqual(0, evaluations);
+  
+  detail::SetJSLoggerSeverityThreshold(detail::JSLoggerSeverityType::JS_DEBUG);
+  XCTAssertTrue(detail::IsJSLoggerSeverityEnabled(detail::JSLoggerSeverityType::JS_DEBUG));
+  HAL_LOG_PRINT(JS_DEBUG, "JSLoggerSeverityThreshold: ", ++evaluations);
+  HAL_LOG_PRINT_EVERY_N(JS_DEBUG, 1, "JSLoggerSeverityThreshold: ", ++evaluations);
+  XCTAssertEqual(2, evaluations);
+  
+  detail::SetJSLoggerSeverityThreshold(threshold);
+}
+
+TEST_F(JSContextTests, JSBinaryLogger) {
+  const std::string path = "JSBinaryLogger.binlog";
+  {
+    detail::JSBinaryLogger logger(path);
+    const auto format_id = logger.RegisterFormat("JSContextTests.cpp", 42, static_cast<int>(detail::JSLoggerSeverityType::JS_WARN));
+    logger.Print(format_id, "count = ", 7, ", ratio = ", 0.5, ", name = ", std::string("hal"));
+  }
+  
+  std::ifstream input(path, std::ios_base::binary | std::ios_base::in);
+  std::ostringstream output;
+  detail::DecodeJSBinaryLog(input, output);
+  const auto text = output.str();
+  XCTAssertNotEqual(std::string::npos, text.find(" WARN: count = 7, ratio = 0.5, name = hal (JSContextTests.cpp:42)\n"));
+  
+  std::istringstream not_a_log("HAL 0000000001 not a binary log");
+  ASSERT_THROW(detail::DecodeJSBinaryLog(not_a_log, output), std::runtime_error);
+  
+  input.close();
+  std::remove(path.c_str());
+}
+
+TEST_F(JSContextTests, JSLogRateLimiter) {
+  detail::JSLogSampler sampler;
+  std::vector<std::uint64_t> suppressed_counts;
+  for (int i = 0; i < 7; ++i) {
+    std::uint64_t suppressed_count = 0;
+    if (sampler.Allow(3, suppressed_count)) {
+      suppressed_counts.push_back(suppressed_count);
+    }
+  }
+  XCTAssertEqual(std::vector<std::uint64_t>({ 0, 2, 2 }), suppressed_counts);
+  
+  detail::JSLogRateLimiter rate_limiter;
+  std::uint64_t suppressed_count = 0;
+  int allowed_count = 0;
+  for (int i = 0; i < 10; ++i) {
+    if (rate_limiter.Allow(2, suppressed_count)) {
+      ++allowed_count;
+    }
+  }
+  XCTAssertEqual(2, allowed_count);
+  
+  std::this_thread::sleep_for(std::chrono::milliseconds(600));
+  XCTAssertTrue(rate_limiter.Allow(2, suppressed_count));
+  XCTAssertEqual(8, suppressed_count);
+  
+  std::ostringstream os;
+  os << detail::JSLogSuppressedCount { 8 };
+  XCTAssertEqual(" (8 similar messages suppressed)", os.str());
+}
+
+TEST_F(JSContextTests, GetIntrinsic) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object   = js_context.get_global_object();
+  
+  auto json = js_context.GetIntrinsic(JSIntrinsic::JSON);
+  XCTAssertTrue(json.HasProperty("stringify"));
+  XCTAssertTrue(js_context.GetIntrinsic(JSIntrinsic::Array).IsFunction());
+  XCTAssertTrue(js_context.CreateArray().IsArray());
+  
+  // The cached Error is still used after a script replaces the global.
+  js_context.JSEvaluateScript("Error = function() {};");
+  XCTAssertTrue(js_context.CreateError().IsError());
+  
+  global_object.SetProperty("dispatcher", js_context.CreateNumber(1));
+  XCTAssertEqual(1, static_cast<int32_t>(js_context.GetCachedGlobal("dispatcher")));
+  global_object.SetProperty("dispatcher", js_context.CreateNumber(2));
+  XCTAssertEqual(1, static_cast<int32_t>(js_context.GetCachedGlobal("dispatcher")));
+  js_context.ClearCachedGlobals();
+  XCTAssertEqual(2, static_cast<int32_t>(js_context.GetCachedGlobal("dispatcher")));
+  XCTAssertTrue(js_context.GetCachedGlobal("missing").IsUndefined());
+}
@@ -0,0 +1,67 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/HAL.hpp"
+
+#include "gtest/gtest.h"
+
+// test/CMakeLists.txt only builds this test with a compiler and
+// standard that have coroutines.
+#ifndef HAL_COROUTINE_ENABLE
+#error "JSCoroutineTests needs C++20 coroutines."
+#endif
+
+#define XCTAssertEqual    ASSERT_EQ
+#define XCTAssertNotEqual ASSERT_NE
+#define XCTAssertTrue     ASSERT_TRUE
+#define XCTAssertFalse    ASSERT_FALSE
+
+using namespace HAL;
+
+class JSCoroutineTests : public testing::Test {
+ protected:
+  virtual void SetUp() {
+  }
+  
+  virtual void TearDown() {
+  }
+  
+  JSContextGroup js_context_group;
+};
+
+namespace {
+  JSAsync DoubleLater(JSContext js_context, JSObject input) {
+    const auto value = co_await input;
+    co_await JSDelay();
+    co_return js_context.CreateNumber(static_cast<int32_t>(value) * 2);
+  }
+}
+
+TEST_F(JSCoroutineTests, JSAsync) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSRunLoop js_run_loop(js_context);
+  auto global_object = js_context.get_global_object();
+  
+  auto fulfilled = js_run_loop.CreatePromise();
+  global_object.SetProperty("doubled", DoubleLater(js_context, fulfilled.first));
+  js_context.JSEvaluateScript("var result; doubled.then(function(value) { result = value; });");
+  fulfilled.second.Resolve([](const JSContext& js_context) -> JSValue {
+    return js_context.CreateNumber(21);
+  });
+  js_run_loop.RunUntilIdle();
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.JSEvaluateScript("result")));
+  
+  // Awaiting a rejected promise throws, which rejects the coroutine's
+  // promise.
+  auto rejected = js_run_loop.CreatePromise();
+  global_object.SetProperty("failed", DoubleLater(js_context, rejected.first));
+  js_context.JSEvaluateScript("var reason; failed.catch(function(error) { reason = error.message; });");
+  rejected.second.Reject("nope");
+  js_run_loop.RunUntilIdle();
+  XCTAssertEqual("Error: nope", static_cast<std::string>(js_context.JSEvaluateScript("reason")));
+}
@@ -9,8 +9,24 @@
 #include "HAL/HAL.hpp"
 #include "Widget.hpp"
 #include "ChildWidget.hpp"
+#include "FlatChildWidget.hpp"
 #include "OtherWidget.hpp"
+#include "SharedWidget.hpp"
+#include "CachedWidget.hpp"
+#include "FlatCachedWidget.hpp"
+#include "WideWidget.hpp"
+#include "PinnedWidget.hpp"
+#include "ArgumentsWidget.hpp"
+#include "BoundWidget.hpp"
+#include "StaticWidget.hpp"
+#include "IndexedWidget.hpp"
+#include "DeferredWidget.hpp"
+#include "RecycledWidget.hpp"
+#include "NamesWidget.hpp"
+#include <cmath>
 #include <functional>
+#include <memory>
+#include <thread>
 
 #include "gtest/gtest.h"
 
@@ -74,6 +90,552 @@ TEST_F(JSExportTests, JSExportClassDefinitionBuilder) {
   auto native_class = builder.build();
 }
 
+TEST_F(JSExportTests, FunctionTrampolines) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("widget", js_context.CreateObject(JSExport<WideWidget>::Class()));
+  global_object.SetProperty("other_widget", js_context.CreateObject(JSExport<WideWidget>::Class()));
+  global_object.SetProperty("count", js_context.CreateNumber(static_cast<double>(WideWidget::kFunctionCount)));
+  
+  // Each function is dispatched to its own callback, whether through
+  // its index or, past the trampolines, through its name.
+  XCTAssertEqual(-1, static_cast<int32_t>(js_context.JSEvaluateScript(
+      "var mismatch = -1;"
+      "for (var i = 0; i < count; ++i) { if (widget['f' + i]() !== i) { mismatch = i; break; } }"
+      "mismatch;")));
+  
+  // Also when called on another object of the class.
+  XCTAssertEqual(70, static_cast<int32_t>(js_context.JSEvaluateScript("widget.f69.call(other_widget) + widget.f1.call(other_widget)")));
+  XCTAssertEqual(3, static_cast<int32_t>(js_context.JSEvaluateScript("var f3 = widget.f3; f3.call(widget)")));
+}
+
+TEST_F(JSExportTests, ValuePropertyTrampolines) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("widget", js_context.CreateObject(JSExport<WideWidget>::Class()));
+  global_object.SetProperty("other_widget", js_context.CreateObject(JSExport<WideWidget>::Class()));
+  global_object.SetProperty("count", js_context.CreateNumber(static_cast<double>(WideWidget::kValueCount)));
+  
+  // Each getter and setter reaches its own value, whether through its
+  // index or, past the trampolines, through its name, and the
+  // constants keep their values and ignore writes.
+  XCTAssertEqual(-1, static_cast<int32_t>(js_context.JSEvaluateScript(
+      "for (var i = 0; i < count; ++i) { widget['v' + i] = i * 2; }"
+      "for (var i = 0; i < count; i += 10) { widget['c' + i] = -1; }"
+      "var mismatch = -1;"
+      "for (var i = 0; i < count; ++i) {"
+      "  if (widget['v' + i] !== i * 2 || other_widget['v' + i] !== 0) { mismatch = i; break; }"
+      "  if (i % 10 === 0 && (widget['c' + i] !== i || other_widget['c' + i] !== i)) { mismatch = i; break; }"
+      "}"
+      "mismatch;")));
+  
+  // GetNamed and SetNamed use the same entries.
+  auto widget = static_cast<JSObject>(global_object.GetProperty("widget"));
+  XCTAssertTrue(JSExport<WideWidget>::SetNamed(widget, "v69", js_context.CreateNumber(5)));
+  XCTAssertEqual(5, static_cast<int32_t>(JSExport<WideWidget>::GetNamed(widget, "v69")));
+  XCTAssertEqual(60, static_cast<int32_t>(JSExport<WideWidget>::GetNamed(widget, "c60")));
+  XCTAssertEqual(5, static_cast<int32_t>(js_context.JSEvaluateScript("widget.v69")));
+}
+
+TEST_F(JSExportTests, PinConstants) {
+  detail::JSExportClassDefinitionBuilder<Widget> builder("Widget");
+  XCTAssertFalse(builder.PinConstants());
+  
+  builder
+      .AddValueProperty("number", std::mem_fn(&Widget::js_get_number), std::mem_fn(&Widget::js_set_number))
+      .AddConstantProperty("pi", std::mem_fn(&Widget::js_get_pi))
+      .PinConstants(true);
+  XCTAssertTrue(builder.PinConstants());
+}
+
+TEST_F(JSExportTests, PinnedConstantProperty) {
+  const auto count = PinnedWidget::get_answer_count();
+  
+  // The constant is evaluated once, by the first object of the
+  // JSContext, and stored as a read-only data property of the
+  // prototype shared by every object.
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("widget", js_context.CreateObject(JSExport<PinnedWidget>::Class()));
+  global_object.SetProperty("other_widget", js_context.CreateObject(JSExport<PinnedWidget>::Class()));
+  XCTAssertEqual(count + 1, PinnedWidget::get_answer_count());
+  
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.JSEvaluateScript("widget.answer + other_widget.answer - widget.answer")));
+  XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript(
+      "var descriptor = Object.getOwnPropertyDescriptor(Object.getPrototypeOf(widget), 'answer');"
+      "descriptor !== undefined && descriptor.value === 42 && !descriptor.writable && !descriptor.configurable;")));
+  XCTAssertFalse(static_cast<bool>(js_context.JSEvaluateScript("widget.hasOwnProperty('answer')")));
+  
+  // Writes and deletes are ignored.
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.JSEvaluateScript("widget.answer = 0; delete widget.answer; widget.answer")));
+  XCTAssertEqual(count + 1, PinnedWidget::get_answer_count());
+  
+  // Another JSContext evaluates it again for its own prototype.
+  JSContext other_js_context = js_context_group.CreateContext();
+  other_js_context.get_global_object().SetProperty("widget", other_js_context.CreateObject(JSExport<PinnedWidget>::Class()));
+  XCTAssertEqual(42, static_cast<int32_t>(other_js_context.JSEvaluateScript("widget.answer")));
+  XCTAssertEqual(count + 2, PinnedWidget::get_answer_count());
+}
+
+TEST_F(JSExportTests, JSArgumentsFunctionProperty) {
+  detail::JSExportClassDefinitionBuilder<Widget> builder("Widget");
+  builder
+      .AddFunctionProperty("sayhello", std::mem_fn(&Widget::js_sayHello))
+      .AddFunctionProperty("first", [](Widget&, const JSArguments& arguments, JSObject&) {
+        return arguments.ToJSValue(0);
+      });
+  
+  auto native_class = builder.build();
+}
+
+TEST_F(JSExportTests, JSArgumentsFunctionPropertyCall) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.get_global_object().SetProperty("widget", js_context.CreateObject(JSExport<ArgumentsWidget>::Class()));
+  
+  XCTAssertEqual(0, static_cast<int32_t>(js_context.JSEvaluateScript("widget.count()")));
+  XCTAssertEqual(3, static_cast<int32_t>(js_context.JSEvaluateScript("widget.count(1, 'a', {})")));
+  
+  // The typed accessors convert with the JavaScript rules.
+  XCTAssertEqual(4.5, static_cast<double>(js_context.JSEvaluateScript("widget.sum(1.5, 3.9)")));
+  XCTAssertEqual(2, static_cast<int32_t>(js_context.JSEvaluateScript("widget.sum('1', 4294967297)")));
+  XCTAssertEqual("7:yes:present", static_cast<std::string>(js_context.JSEvaluateScript("widget.describe(7, 'x', null)")));
+  XCTAssertEqual("true:no:present", static_cast<std::string>(js_context.JSEvaluateScript("widget.describe(true, 0, 0, 1)")));
+  
+  // Missing arguments read as undefined.
+  XCTAssertEqual("undefined:no:missing", static_cast<std::string>(js_context.JSEvaluateScript("widget.describe()")));
+  XCTAssertTrue(std::isnan(static_cast<double>(js_context.JSEvaluateScript("widget.sum()"))));
+  XCTAssertTrue(js_context.JSEvaluateScript("widget.first()").IsUndefined());
+  XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("var object = {}; widget.first(object, 1) === object")));
+  
+  // An exception set on the view is thrown in JavaScript.
+  XCTAssertEqual("fail called with 2 arguments", static_cast<std::string>(js_context.JSEvaluateScript(
+      "var message; try { widget.fail(1, 2); } catch (e) { message = e.message; } message")));
+}
+
+TEST_F(JSExportTests, ConvertToTypePrimitive) {
+  detail::JSExportClassDefinitionBuilder<Widget> builder("Widget");
+  XCTAssertFalse(static_cast<bool>(builder.ConvertToTypePrimitive()));
+  builder.ConvertToTypePrimitive([](const Widget&, JSValue::Type type, const JSObjectView&) {
+    return type == JSValue::Type::Number ? detail::JSExportPrimitive::Number(42) : detail::JSExportPrimitive::Forward();
+  });
+  XCTAssertTrue(static_cast<bool>(builder.ConvertToTypePrimitive()));
+  
+  JSContext js_context = js_context_group.CreateContext();
+  const auto context_ref = static_cast<JSContextRef>(js_context);
+  XCTAssertTrue(detail::JSExportPrimitive::Forward().ToJSValueRef(context_ref) == nullptr);
+  XCTAssertEqual(42, static_cast<int32_t>(JSValue(js_context, detail::JSExportPrimitive::Number(42).ToJSValueRef(context_ref))));
+  XCTAssertEqual("hello", static_cast<std::string>(JSValue(js_context, detail::JSExportPrimitive::String("hello").ToJSValueRef(context_ref))));
+  
+  // As above, the definition is not installed.
+  auto native_class = builder.build();
+}
+
+TEST_F(JSExportTests, CreateObjects) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  auto widgets = js_context.CreateObjects<Widget>(100, [](Widget& widget, std::size_t index) {
+    widget.set_number(static_cast<std::int32_t>(index));
+  });
+  XCTAssertEqual(100, widgets.GetLength());
+  
+  js_context.get_global_object().SetProperty("widgets", widgets);
+  XCTAssertEqual(99, static_cast<std::int32_t>(js_context.JSEvaluateScript("widgets[99].number;")));
+  XCTAssertEqual("world", static_cast<std::string>(js_context.JSEvaluateScript("widgets[0].name;")));
+  
+  const auto widget = static_cast<JSObject>(widgets.GetProperty(42));
+  XCTAssertEqual(42, widget.GetPrivate<Widget>() -> get_number());
+  
+  XCTAssertEqual(0, js_context.CreateObjects<Widget>(0).GetLength());
+}
+
+TEST_F(JSExportTests, CreateSharedObject) {
+  const auto catalog = std::make_shared<const WidgetCatalog>(WidgetCatalog { "shared", 7 });
+  
+  JSContext js_context_1 = js_context_group.CreateContext();
+  JSContext js_context_2 = js_context_group.CreateContext();
+  auto widget_1 = js_context_1.CreateSharedObject<SharedWidget>(catalog);
+  auto widget_2 = js_context_2.CreateSharedObject<SharedWidget>(catalog);
+  XCTAssertEqual(3, catalog.use_count());
+  XCTAssertEqual(catalog.get(), widget_1.GetPrivate<SharedWidget>() -> get_shared_ptr().get());
+  XCTAssertEqual(catalog.get(), widget_2.GetPrivate<SharedWidget>() -> get_shared_ptr().get());
+  
+  js_context_2.get_global_object().SetProperty("widget", widget_2);
+  XCTAssertEqual("shared", static_cast<std::string>(js_context_2.JSEvaluateScript("widget.name;")));
+  XCTAssertEqual(7, static_cast<std::int32_t>(js_context_2.JSEvaluateScript("widget.number;")));
+  
+  ASSERT_THROW(js_context_1.CreateSharedObject<SharedWidget>(std::shared_ptr<const WidgetCatalog>()), std::invalid_argument);
+}
+
+TEST_F(JSExportTests, CachedValueProperty) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  js_context.get_global_object().SetProperty("widget", widget);
+  const auto native_widget = widget.GetPrivate<CachedWidget>();
+  
+  // Repeat reads don't call the getter.
+  XCTAssertEqual(6, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.area + widget.area - widget.area;")));
+  XCTAssertEqual(1, native_widget -> get_area_count());
+  
+  // The setter invalidates its own property, and the native object the
+  // ones that depend on it.
+  XCTAssertEqual(12, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.width = 4; widget.width * widget.area / 4;")));
+  XCTAssertEqual(2, native_widget -> get_area_count());
+  
+  XCTAssertEqual(5, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.resize(1, 5); widget.area;")));
+  XCTAssertEqual(3, native_widget -> get_area_count());
+  
+  // Each object caches its own values.
+  auto other_widget = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  XCTAssertEqual(6, static_cast<std::int32_t>(other_widget.GetProperty("area")));
+  XCTAssertEqual(3, native_widget -> get_area_count());
+  
+  ASSERT_THROW(native_widget -> JSExport<CachedWidget>::Invalidate("resize"), std::invalid_argument);
+}
+
+TEST_F(JSExportTests, CachedValuePropertyOfFlattenedParent) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget = js_context.CreateObject(JSExport<FlatCachedWidget>::Class());
+  js_context.get_global_object().SetProperty("widget", widget);
+  const auto native_widget = widget.GetPrivate<FlatCachedWidget>();
+  
+  XCTAssertEqual(6, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.area + widget.area - widget.area;")));
+  XCTAssertEqual(1, native_widget -> get_area_count());
+  
+  // CachedWidget's setter of "width" invalidates "area" through
+  // JSExport<CachedWidget>, which finds the value cached through the
+  // inherited property.
+  XCTAssertEqual(12, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.width = 4; widget.area;")));
+  XCTAssertEqual(2, native_widget -> get_area_count());
+  
+  // And so does invalidating through the child.
+  native_widget -> JSExport<FlatCachedWidget>::Invalidate("area");
+  XCTAssertEqual(12, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.area;")));
+  XCTAssertEqual(3, native_widget -> get_area_count());
+  native_widget -> JSExport<FlatCachedWidget>::InvalidateAll();
+  XCTAssertEqual(12, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.area;")));
+  XCTAssertEqual(4, native_widget -> get_area_count());
+}
+
+TEST_F(JSExportTests, ConvertToTypePrimitiveCallback) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  js_context.get_global_object().SetProperty("widget", widget);
+  const auto native_widget = widget.GetPrivate<CachedWidget>();
+  
+  XCTAssertEqual(6, static_cast<std::int32_t>(js_context.JSEvaluateScript("Number(widget);")));
+  XCTAssertEqual(13, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.resize(2, 6); widget + 1;")));
+  XCTAssertEqual(0, native_widget -> get_area_count());
+  
+  // The conversion to a string is forwarded to the prototype chain.
+  XCTAssertEqual("[object CachedWidget]", static_cast<std::string>(js_context.JSEvaluateScript("String(widget);")));
+}
+
+TEST_F(JSExportTests, ToJSONCallback) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  js_context.get_global_object().SetProperty("widget", widget);
+  const auto native_widget = widget.GetPrivate<CachedWidget>();
+  
+  XCTAssertEqual("{\"width\":2,\"height\":3,\"area\":6}", static_cast<std::string>(js_context.JSEvaluateScript("JSON.stringify(widget);")));
+  XCTAssertEqual("[{\"width\":4,\"height\":3,\"area\":12}]", static_cast<std::string>(js_context.JSEvaluateScript("widget.width = 4; JSON.stringify([widget]);")));
+  XCTAssertEqual(0, native_widget -> get_area_count());
+  
+  // toJSON isn't enumerable.
+  XCTAssertFalse(js_context.JSEvaluateScript("Object.keys(widget).indexOf('toJSON') >= 0;"));
+  
+  ASSERT_THROW(detail::JSExportClassDefinitionBuilder<CachedWidget>("CachedWidget").ToJSON(nullptr), std::invalid_argument);
+}
+
+TEST_F(JSExportTests, Iterator) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  js_context.get_global_object().SetProperty("widget", widget);
+  const auto native_widget = widget.GetPrivateAs<CachedWidget>();
+  
+  // 6 cells in batches of 4.
+  XCTAssertEqual("0,1,2,3,4,5", static_cast<std::string>(js_context.JSEvaluateScript("[...widget].join(',');")));
+  XCTAssertEqual(2, native_widget -> get_batch_count());
+  
+  // A loop that exits early asks for no more batches.
+  XCTAssertEqual(1, static_cast<std::int32_t>(js_context.JSEvaluateScript("var first; for (var cell of widget) { first = cell + 1; break; } first;")));
+  XCTAssertEqual(3, native_widget -> get_batch_count());
+  
+  // An exhausted cursor isn't asked again when the last batch is full.
+  XCTAssertEqual(4, static_cast<std::int32_t>(js_context.JSEvaluateScript("widget.resize(2, 2); Array.from(widget).length;")));
+  XCTAssertEqual(4, native_widget -> get_batch_count());
+  
+  // A batch shorter than the batch size isn't the last one while the
+  // callback returns true.
+  native_widget -> set_batch_limit(3);
+  XCTAssertEqual("0,1,2,3", static_cast<std::string>(js_context.JSEvaluateScript("[...widget].join(',');")));
+  XCTAssertEqual(6, native_widget -> get_batch_count());
+  native_widget -> set_batch_limit(1);
+  XCTAssertEqual("0,1,2,3", static_cast<std::string>(js_context.JSEvaluateScript("Array.from(widget).join(',');")));
+  XCTAssertEqual(10, native_widget -> get_batch_count());
+  
+  // The iterator is shared through the prototype, and isn't enumerable.
+  XCTAssertTrue(js_context.JSEvaluateScript("Object.getPrototypeOf(widget).hasOwnProperty(Symbol.iterator);"));
+  XCTAssertFalse(js_context.JSEvaluateScript("var keys = []; for (var key in widget) { keys.push(key); } keys.indexOf('@@HAL.iterator') >= 0;"));
+  
+  ASSERT_THROW(detail::JSExportClassDefinitionBuilder<CachedWidget>("CachedWidget").Iterator(nullptr, 4), std::invalid_argument);
+  ASSERT_THROW(detail::JSExportClassDefinitionBuilder<CachedWidget>("CachedWidget").Iterator([](CachedWidget&) { return detail::JSExportNextBatch(); }, 0), std::invalid_argument);
+}
+
+TEST_F(JSExportTests, DrainDirty) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget1 = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  auto widget2 = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  js_context.get_global_object().SetProperty("widget1", widget1);
+  js_context.get_global_object().SetProperty("widget2", widget2);
+  const auto native_widget1 = widget1.GetPrivateAs<CachedWidget>();
+  JSExport<CachedWidget>::DrainDirty([](CachedWidget&, const std::vector<std::string>&) {});
+  
+  // Reads mark nothing.
+  js_context.JSEvaluateScript("widget1.area; widget2.width;");
+  XCTAssertEqual(0, JSExport<CachedWidget>::GetDirtyCount());
+  
+  // Each object is visited once, in the order of its first write.
+  js_context.JSEvaluateScript("widget2.width = 5; widget1.width = 3; widget2.width = 6;");
+  XCTAssertEqual(2, JSExport<CachedWidget>::GetDirtyCount());
+  std::vector<CachedWidget*> widgets;
+  std::vector<std::string>   names;
+  XCTAssertEqual(2, JSExport<CachedWidget>::DrainDirty([&](CachedWidget& widget, const std::vector<std::string>& property_names) {
+    widgets.push_back(&widget);
+    names.insert(names.end(), property_names.begin(), property_names.end());
+  }));
+  XCTAssertEqual(2, widgets.size());
+  XCTAssertEqual(native_widget1, widgets[1]);
+  XCTAssertEqual(2, names.size());
+  XCTAssertEqual("width", names[0]);
+  XCTAssertEqual(0, JSExport<CachedWidget>::GetDirtyCount());
+  
+  // Writes made while draining wait for the next drain.
+  js_context.JSEvaluateScript("widget1.width = 4;");
+  XCTAssertEqual(1, JSExport<CachedWidget>::DrainDirty([&](CachedWidget&, const std::vector<std::string>&) {
+    js_context.JSEvaluateScript("widget1.width = 7;");
+  }));
+  XCTAssertEqual(1, JSExport<CachedWidget>::GetDirtyCount());
+  XCTAssertEqual(1, JSExport<CachedWidget>::DrainDirty([](CachedWidget&, const std::vector<std::string>&) {}));
+}
+
+TEST_F(JSExportTests, GetNamedAndSetNamed) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  auto widget = js_context.CreateObject(JSExport<Widget>::Class());
+  XCTAssertEqual("world", static_cast<std::string>(JSExport<Widget>::GetNamed(widget, "name")));
+  XCTAssertTrue(JSExport<Widget>::SetNamed(widget, "number", js_context.CreateNumber(7)));
+  XCTAssertEqual(7, widget.GetPrivateAs<Widget>() -> get_number());
+  XCTAssertEqual(7, static_cast<std::int32_t>(JSExport<Widget>::GetNamed(widget, "number")));
+  XCTAssertEqual(7, static_cast<std::int32_t>(widget.GetProperty("number")));
+  
+  // Constants and cached values are cached as for JavaScript reads.
+  XCTAssertEqual(static_cast<double>(widget.GetProperty("pi")), static_cast<double>(JSExport<Widget>::GetNamed(widget, "pi")));
+  auto cached_widget = js_context.CreateObject(JSExport<CachedWidget>::Class());
+  const auto native_cached_widget = cached_widget.GetPrivateAs<CachedWidget>();
+  XCTAssertEqual(6, static_cast<std::int32_t>(JSExport<CachedWidget>::GetNamed(cached_widget, "area")));
+  XCTAssertEqual(6, static_cast<std::int32_t>(cached_widget.GetProperty("area")));
+  XCTAssertEqual(1, native_cached_widget -> get_area_count());
+  XCTAssertTrue(JSExport<CachedWidget>::SetNamed(cached_widget, "width", js_context.CreateNumber(4)));
+  XCTAssertEqual(12, static_cast<std::int32_t>(JSExport<CachedWidget>::GetNamed(cached_widget, "area")));
+  XCTAssertEqual(2, native_cached_widget -> get_area_count());
+  
+  // Anything else goes through JavaScriptCore: a derived class, which
+  // may override the property, another property and another object.
+  auto child_widget = js_context.CreateObject(JSExport<ChildWidget>::Class());
+  XCTAssertEqual("hello pi", static_cast<std::string>(JSExport<Widget>::GetNamed(child_widget, "pi")));
+  XCTAssertTrue(JSExport<Widget>::SetNamed(widget, "color", js_context.CreateString("red")));
+  XCTAssertEqual("red", static_cast<std::string>(JSExport<Widget>::GetNamed(widget, "color")));
+  auto object = js_context.CreateObject();
+  XCTAssertTrue(JSExport<Widget>::SetNamed(object, "number", js_context.CreateNumber(3)));
+  XCTAssertEqual(3, static_cast<std::int32_t>(JSExport<Widget>::GetNamed(object, "number")));
+}
+
+TEST_F(JSExportTests, DirectMemberPointerProperties) {
+  detail::JSExportClassDefinitionBuilder<Widget> builder("Widget");
+  builder
+      .AddValueProperty<&Widget::js_get_name, &Widget::js_set_name>("name")
+      .AddValueProperty<&Widget::js_get_pi>("pi")
+      .AddFunctionProperty<&Widget::js_sayHello>("sayHello");
+  
+  // The definition is not installed, since that would replace the
+  // one JSExport<Widget> uses for the other tests.
+  auto native_class = builder.build();
+}
+
+TEST_F(JSExportTests, DirectMemberPointerPropertiesCall) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("widget", js_context.CreateObject(JSExport<BoundWidget>::Class()));
+  global_object.SetProperty("other_widget", js_context.CreateObject(JSExport<BoundWidget>::Class()));
+  
+  // The getter and setter reach the member functions of each object.
+  XCTAssertEqual("world", static_cast<std::string>(js_context.JSEvaluateScript("widget.name")));
+  XCTAssertEqual("hal", static_cast<std::string>(js_context.JSEvaluateScript("widget.name = 'hal'; widget.name")));
+  XCTAssertEqual("world", static_cast<std::string>(js_context.JSEvaluateScript("other_widget.name")));
+  
+  // A property without a setter is read-only, and a non-const getter
+  // may change the object.
+  XCTAssertEqual(3, static_cast<int32_t>(js_context.JSEvaluateScript("widget.ticks; widget.ticks = 10; widget.ticks; widget.ticks")));
+  XCTAssertEqual(1, static_cast<int32_t>(js_context.JSEvaluateScript("other_widget.ticks")));
+  
+  // Both function signatures are called with their arguments and this.
+  XCTAssertEqual("hello hal", static_cast<std::string>(js_context.JSEvaluateScript("widget.greet()")));
+  XCTAssertEqual("hi world", static_cast<std::string>(js_context.JSEvaluateScript("widget.greet.call(other_widget, 'hi')")));
+  XCTAssertEqual(7.5, static_cast<double>(js_context.JSEvaluateScript("widget.scale(2.5, 3)")));
+  ASSERT_THROW(js_context.JSEvaluateScript("widget.greet.call({})"), std::runtime_error);
+  
+  // GetNamed and SetNamed use the same bindings.
+  auto widget = static_cast<JSObject>(global_object.GetProperty("widget"));
+  XCTAssertTrue(JSExport<BoundWidget>::SetNamed(widget, "name", js_context.CreateString("named")));
+  XCTAssertEqual("named", static_cast<std::string>(JSExport<BoundWidget>::GetNamed(widget, "name")));
+}
+
+TEST_F(JSExportTests, StaticPropertyTables) {
+  using Builder = detail::JSExportClassDefinitionBuilder<Widget>;
+  
+  static const ::JSStaticValue widget_values[] = {
+    Builder::StaticValue<&Widget::js_get_name, &Widget::js_set_name>("name"),
+    Builder::StaticValue<&Widget::js_get_pi>("pi", false),
+    Builder::EndOfStaticValues()
+  };
+  
+  static const ::JSStaticFunction widget_functions[] = {
+    Builder::StaticFunction<&Widget::js_sayHello>("sayHello"),
+    Builder::EndOfStaticFunctions()
+  };
+  
+  XCTAssertTrue(widget_values[0].setProperty != nullptr);
+  XCTAssertEqual(kJSPropertyAttributeDontDelete, widget_values[0].attributes);
+  XCTAssertTrue(widget_values[1].setProperty == nullptr);
+  XCTAssertEqual(kJSPropertyAttributeDontDelete | kJSPropertyAttributeReadOnly | kJSPropertyAttributeDontEnum, widget_values[1].attributes);
+  XCTAssertEqual(kJSPropertyAttributeDontDelete | kJSPropertyAttributeReadOnly, widget_functions[0].attributes);
+  
+  Builder builder("Widget");
+  builder
+      .StaticValues(widget_values)
+      .StaticFunctions(widget_functions)
+      .AddValueProperty("number", std::mem_fn(&Widget::js_get_number));
+  XCTAssertEqual(widget_values, builder.StaticValues());
+  XCTAssertEqual(widget_functions, builder.StaticFunctions());
+  
+  // As above, the definition is not installed.
+  auto native_class = builder.build();
+}
+
+TEST_F(JSExportTests, StaticPropertyTablesCall) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("widget", js_context.CreateObject(JSExport<StaticWidget>::Class()));
+  global_object.SetProperty("other_widget", js_context.CreateObject(JSExport<StaticWidget>::Class()));
+  
+  // The table entries reach the member functions of each object, and
+  // combine with the property added one at a time.
+  XCTAssertEqual("static", static_cast<std::string>(js_context.JSEvaluateScript("widget.label")));
+  XCTAssertEqual("table", static_cast<std::string>(js_context.JSEvaluateScript("widget.label = 'table'; widget.label")));
+  XCTAssertEqual("static", static_cast<std::string>(js_context.JSEvaluateScript("other_widget.label")));
+  XCTAssertEqual(5, static_cast<int32_t>(js_context.JSEvaluateScript("widget.size")));
+  
+  // version is read-only and not enumerable.
+  XCTAssertEqual(2, static_cast<int32_t>(js_context.JSEvaluateScript("widget.version = 3; widget.version")));
+  XCTAssertEqual("label,size", static_cast<std::string>(js_context.JSEvaluateScript(
+      "var names = []; for (var name in widget) { if (name === 'label' || name === 'version' || name === 'size') { names.push(name); } } names.sort().join()")));
+  
+  // Both function signatures are called with their arguments and this.
+  XCTAssertEqual("table,1,a", static_cast<std::string>(js_context.JSEvaluateScript("widget.join(1, 'a')")));
+  XCTAssertEqual("static", static_cast<std::string>(js_context.JSEvaluateScript("widget.join.call(other_widget)")));
+  XCTAssertEqual(5, static_cast<int32_t>(js_context.JSEvaluateScript("widget.twice(2.5)")));
+  ASSERT_THROW(js_context.JSEvaluateScript("widget.twice.call({}, 1)"), std::runtime_error);
+}
+
+TEST_F(JSExportTests, IndexedPropertyCallbacks) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("widget", js_context.CreateObject(JSExport<IndexedWidget>::Class()));
+  global_object.SetProperty("other_widget", js_context.CreateObject(JSExport<IndexedWidget>::Class()));
+  
+  // Array indexes within the length reach the native elements.
+  XCTAssertEqual(20, static_cast<int32_t>(js_context.JSEvaluateScript("widget[2]")));
+  XCTAssertEqual(5, static_cast<int32_t>(js_context.JSEvaluateScript("widget[2] = 5; widget['2']")));
+  XCTAssertEqual(20, static_cast<int32_t>(js_context.JSEvaluateScript("other_widget[2]")));
+  XCTAssertEqual(45, static_cast<int32_t>(js_context.JSEvaluateScript(
+      "var sum = 0; for (var i = 0; i < widget.length; ++i) { sum += widget[i]; } sum")));
+  
+  // A declined index falls through to an ordinary property.
+  XCTAssertTrue(js_context.JSEvaluateScript("widget[10]").IsUndefined());
+  XCTAssertEqual("x", static_cast<std::string>(js_context.JSEvaluateScript("widget[10] = 'x'; widget[10]")));
+  XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("widget.hasOwnProperty('10') && !other_widget.hasOwnProperty('10')")));
+  
+  // Names that aren't canonical array indexes never reach the
+  // callbacks.
+  XCTAssertEqual(7, static_cast<int32_t>(js_context.JSEvaluateScript("widget['02'] = 7; widget['02']")));
+  XCTAssertEqual(-1, static_cast<int32_t>(js_context.JSEvaluateScript("widget['1.0'] = -1; widget['1.0']")));
+  XCTAssertEqual(15, static_cast<int32_t>(js_context.JSEvaluateScript("widget[2] + widget[1]")));
+}
+
+TEST_F(JSExportTests, NativeMethodFunctionProperty) {
+  detail::JSExportClassDefinitionBuilder<Widget> builder("Widget");
+  builder
+      .AddFunctionProperty("sayhello", &Widget::js_sayHello)
+      .AddFunctionProperty("getNumber", &Widget::get_number)
+      .AddFunctionProperty("setNumber", &Widget::set_number)
+      .AddFunctionProperty("setName", &Widget::set_name);
+  auto native_class = builder.build();
+  
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject  this_object = js_context.CreateObject();
+  Widget    widget(js_context);
+  
+  const auto number = js_context.CreateNumber(7.9);
+  const auto name   = js_context.CreateString("foo");
+  const JSValueRef arguments_array[] = { static_cast<JSValueRef>(number), static_cast<JSValueRef>(name) };
+  
+  const auto set_number = detail::MakeNativeMethodCallback(&Widget::set_number);
+  auto result = set_number(widget, JSArguments(static_cast<JSContextRef>(js_context), 1, arguments_array), this_object);
+  XCTAssertTrue(result.IsUndefined());
+  XCTAssertEqual(7, widget.get_number());
+  
+  const auto get_number = detail::MakeNativeMethodCallback(&Widget::get_number);
+  result = get_number(widget, JSArguments(static_cast<JSContextRef>(js_context), 0, nullptr), this_object);
+  XCTAssertTrue(result.IsNumber());
+  XCTAssertEqual(7, static_cast<std::int32_t>(result));
+  
+  const auto set_name = detail::MakeNativeMethodCallback(&Widget::set_name);
+  set_name(widget, JSArguments(static_cast<JSContextRef>(js_context), 1, arguments_array + 1), this_object);
+  XCTAssertEqual("foo", widget.get_name());
+}
+
+namespace {
+  struct Scaler {
+    JSResult<double> Scale(double factor) {
+      if (factor <= 0) {
+        return JSResult<double>::Error("factor must be positive");
+      }
+      return factor * 2;
+    }
+  };
+}
+
+TEST_F(JSExportTests, NativeMethodJSResult) {
+  JSContext js_context  = js_context_group.CreateContext();
+  JSObject  this_object = js_context.CreateObject();
+  Scaler    scaler;
+  
+  const auto good = js_context.CreateNumber(1.5);
+  const auto bad  = js_context.CreateNumber(-1);
+  const JSValueRef arguments_array[] = { static_cast<JSValueRef>(good), static_cast<JSValueRef>(bad) };
+  const auto scale = detail::MakeNativeMethodCallback(&Scaler::Scale);
+  
+  JSValueRef exception { nullptr };
+  auto result = scale(scaler, JSArguments(static_cast<JSContextRef>(js_context), 1, arguments_array, &exception), this_object);
+  XCTAssertFalse(exception);
+  XCTAssertEqual(3, static_cast<double>(result));
+  
+  // The failure is reported through the exception slot, not thrown.
+  result = scale(scaler, JSArguments(static_cast<JSContextRef>(js_context), 1, arguments_array + 1, &exception), this_object);
+  XCTAssertTrue(exception);
+  XCTAssertTrue(result.IsUndefined());
+}
+
 TEST_F(JSExportTests, JSExport) {
   JSContext js_context = js_context_group.CreateContext();
   JSObject global_object   = js_context.get_global_object();
@@ -207,6 +769,220 @@ TEST_F(JSExportTests, JSExportPrototypeChain) {
   XCTAssertEqual("child widget", static_cast<std::string>(result));
 }
 
+TEST_F(JSExportTests, JSExportInstanceOf) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject widget       = js_context.CreateObject(JSExport<Widget>::Class());
+  JSObject child_widget = js_context.CreateObject(JSExport<ChildWidget>::Class());
+  
+  // A ChildWidget is a Widget through its JSClass parent, but not the
+  // other way around.
+  XCTAssertTrue(static_cast<JSValue>(widget).IsInstanceOfConstructor(widget));
+  XCTAssertTrue(static_cast<JSValue>(child_widget).IsInstanceOfConstructor(widget));
+  XCTAssertTrue(static_cast<JSValue>(child_widget).IsInstanceOfConstructor(child_widget));
+  XCTAssertFalse(static_cast<JSValue>(widget).IsInstanceOfConstructor(child_widget));
+  XCTAssertFalse(static_cast<JSValue>(js_context.CreateObject()).IsInstanceOfConstructor(widget));
+}
+
+namespace {
+  std::size_t lazy_object_count = 0;
+  
+  JSObject CreateLazyObject(const JSContext& js_context) {
+    ++lazy_object_count;
+    auto js_object = js_context.CreateObject();
+    js_object.SetProperty("answer", js_context.CreateNumber(42));
+    return js_object;
+  }
+}
+
+TEST_F(JSExportTests, JSExportClassName) {
+  XCTAssertEqual(std::string("Widget"), JSExportClassName<Widget>::get());
+  XCTAssertEqual("Widget", JSExport<Widget>::Class().get_name());
+  
+  // Undeclared names are the type name, mangled or not, and so are
+  // only stable within one build.
+  const std::string flat_name = JSExportClassName<FlatChildWidget>::get();
+  XCTAssertNotEqual(std::string::npos, flat_name.find("FlatChildWidget"));
+  XCTAssertEqual(flat_name, JSExportClassName<FlatChildWidget>::get());
+  
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget = js_context.CreateObject(JSExport<Widget>::Class());
+  XCTAssertNotEqual(nullptr, widget.GetPrivate<Widget>());
+  XCTAssertEqual(nullptr, widget.GetPrivate<OtherWidget>());
+}
+
+TEST_F(JSExportTests, JSExportRegistry) {
+  JSExportRegistry::Register<Widget>("LazyWidget");
+  JSExportRegistry::Register("LazyObject", &CreateLazyObject);
+  XCTAssertTrue(JSExportRegistry::IsRegistered("LazyWidget"));
+  XCTAssertFalse(JSExportRegistry::IsRegistered("NotRegistered"));
+  
+  JSContext js_context = js_context_group.CreateContext();
+  JSExportRegistry::Install(js_context);
+  
+  // Nothing is created until a script reads the property.
+  lazy_object_count = 0;
+  XCTAssertTrue(js_context.JSEvaluateScript("'LazyObject' in this;"));
+  XCTAssertEqual(0, lazy_object_count);
+  
+  XCTAssertEqual(42, static_cast<int32_t>(js_context.JSEvaluateScript("LazyObject.answer;")));
+  XCTAssertTrue(js_context.JSEvaluateScript("LazyObject === LazyObject;"));
+  XCTAssertTrue(js_context.JSEvaluateScript("Object.getOwnPropertyDescriptor(this, 'LazyObject').hasOwnProperty('value');"));
+  XCTAssertEqual(1, lazy_object_count);
+  
+  auto result = js_context.JSEvaluateScript("LazyWidget.name;");
+  XCTAssertTrue(result.IsString());
+  XCTAssertEqual("world", static_cast<std::string>(result));
+}
+
+TEST_F(JSExportTests, NegativePropertyCache) {
+  detail::JSExportNegativePropertyCache cache;
+  const JSString to_string("toString");
+  const JSString has_own_property("hasOwnProperty");
+  
+  // Disabled by default.
+  cache.Insert(static_cast<JSStringRef>(to_string));
+  XCTAssertFalse(cache.Contains(static_cast<JSStringRef>(to_string)));
+  XCTAssertEqual(0, cache.size());
+  
+  cache.set_capacity(2);
+  cache.Insert(static_cast<JSStringRef>(to_string));
+  XCTAssertTrue(cache.Contains(static_cast<JSStringRef>(to_string)));
+  XCTAssertTrue(cache.Contains(static_cast<JSStringRef>(JSString("toString"))));
+  XCTAssertFalse(cache.Contains(static_cast<JSStringRef>(has_own_property)));
+  XCTAssertFalse(cache.Contains(static_cast<JSStringRef>(JSString("toStrin"))));
+  
+  cache.Insert(static_cast<JSStringRef>(has_own_property));
+  XCTAssertEqual(2, cache.size());
+  
+  // A full cache starts over.
+  cache.Insert(static_cast<JSStringRef>(JSString("valueOf")));
+  XCTAssertEqual(1, cache.size());
+  XCTAssertFalse(cache.Contains(static_cast<JSStringRef>(to_string)));
+  
+  cache.Clear();
+  XCTAssertEqual(0, cache.size());
+  XCTAssertFalse(cache.Contains(static_cast<JSStringRef>(JSString("valueOf"))));
+}
+
+TEST_F(JSExportTests, NegativePropertyCacheOfClass) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.get_global_object().SetProperty("other_widget", js_context.CreateObject(JSExport<OtherWidget>::Class()));
+  
+  // Only the first probe for a missing name reaches HasProperty.
+  const auto has_property_count = OtherWidget::get_has_property_count();
+  XCTAssertTrue(js_context.JSEvaluateScript("other_widget.missing === undefined && other_widget.missing === undefined && !('missing' in other_widget);"));
+  XCTAssertEqual(has_property_count + 1, OtherWidget::get_has_property_count());
+  
+  // The properties HasProperty forwards are still found.
+  XCTAssertEqual(1, static_cast<std::int32_t>(js_context.JSEvaluateScript("other_widget.CONST1;")));
+  XCTAssertEqual(1, static_cast<std::int32_t>(js_context.JSEvaluateScript("other_widget.CONST1;")));
+  XCTAssertEqual(has_property_count + 2, OtherWidget::get_has_property_count());
+  
+  JSExport<OtherWidget>::InvalidateNegativePropertyCache();
+  XCTAssertTrue(js_context.JSEvaluateScript("other_widget.missing === undefined;"));
+  XCTAssertEqual(has_property_count + 3, OtherWidget::get_has_property_count());
+}
+
+TEST_F(JSExportTests, HotPropertyNameCache) {
+  detail::JSExportHotPropertyNameCache cache;
+  const JSString width("width");
+  
+  // Disabled by default.
+  XCTAssertTrue(cache.Find(static_cast<JSStringRef>(width)) == nullptr);
+  XCTAssertEqual(0, cache.size());
+  
+  cache.set_threshold(2);
+  XCTAssertTrue(cache.Find(static_cast<JSStringRef>(width)) == nullptr);
+  
+  // The second lookup interns the name, and later lookups of another
+  // JSStringRef with the same characters find the same JSString.
+  const auto interned = cache.Find(static_cast<JSStringRef>(JSString("width")));
+  XCTAssertTrue(interned != nullptr);
+  XCTAssertEqual(width, *interned);
+  XCTAssertEqual(1, cache.size());
+  XCTAssertEqual(interned, cache.Find(static_cast<JSStringRef>(width)));
+  XCTAssertEqual(interned, cache.Find(static_cast<JSStringRef>(*interned)));
+  XCTAssertTrue(cache.Find(static_cast<JSStringRef>(JSString("widt"))) == nullptr);
+  
+  // At most kCapacity names are interned.
+  for (std::size_t i = 0; i < 2 * detail::JSExportHotPropertyNameCache::kCapacity; ++i) {
+    const JSString name("name" + std::to_string(i));
+    cache.Find(static_cast<JSStringRef>(name));
+    cache.Find(static_cast<JSStringRef>(name));
+  }
+  XCTAssertEqual(detail::JSExportHotPropertyNameCache::kCapacity, cache.size());
+  XCTAssertTrue(cache.Find(static_cast<JSStringRef>(JSString("name15"))) == nullptr);
+  
+  cache.set_threshold(0);
+  XCTAssertEqual(0, cache.size());
+  XCTAssertTrue(cache.Find(static_cast<JSStringRef>(width)) == nullptr);
+}
+
+TEST_F(JSExportTests, JSExportFlattenedParent) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject global_object = js_context.get_global_object();
+  JSObject widget = js_context.CreateObject(JSExport<FlatChildWidget>::Class());
+  global_object.SetProperty("FlatChildWidget", widget);
+  
+  // The inherited properties are served by the child's own JSClass.
+  auto result = js_context.JSEvaluateScript("FlatChildWidget.name;");
+  XCTAssertTrue(result.IsString());
+  XCTAssertEqual("world", static_cast<std::string>(result));
+  
+  result = js_context.JSEvaluateScript("FlatChildWidget.my_name;");
+  XCTAssertEqual("flat child widget", static_cast<std::string>(result));
+  
+  result = js_context.JSEvaluateScript("FlatChildWidget.number = 7; FlatChildWidget.number;");
+  XCTAssertEqual(7, static_cast<int32_t>(result));
+  XCTAssertEqual(7, widget.GetPrivate<FlatChildWidget>()->get_number());
+  
+  result = js_context.JSEvaluateScript("FlatChildWidget.sayHello('foo');");
+  XCTAssertTrue(result.IsString());
+  
+  XCTAssertTrue(static_cast<JSValue>(widget).IsInstanceOfConstructor(js_context.CreateObject(JSExport<Widget>::Class())));
+}
+
+TEST_F(JSExportTests, JSExportHasInstance) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("Widget", js_context.CreateObject(JSExport<Widget>::Class()));
+  global_object.SetProperty("widget", js_context.CreateObject(JSExport<Widget>::Class()));
+  global_object.SetProperty("child_widget", js_context.CreateObject(JSExport<ChildWidget>::Class()));
+  global_object.SetProperty("other_widget", js_context.CreateObject(JSExport<OtherWidget>::Class()));
+  
+  // Objects of other JSClasses, even ones with private data that has
+  // no JSExport header, such as native functions, aren't instances.
+  global_object.SetProperty("native_function", js_context.CreateFunction([](const JSArguments&, JSObject& this_object) -> JSValue {
+    return this_object.get_context().CreateUndefined();
+  }));
+  XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("widget instanceof Widget;")));
+  XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("child_widget instanceof Widget;")));
+  XCTAssertFalse(static_cast<bool>(js_context.JSEvaluateScript("other_widget instanceof Widget;")));
+  XCTAssertFalse(static_cast<bool>(js_context.JSEvaluateScript("native_function instanceof Widget;")));
+  XCTAssertFalse(static_cast<bool>(js_context.JSEvaluateScript("({}) instanceof Widget;")));
+  XCTAssertFalse(static_cast<bool>(js_context.JSEvaluateScript("1 instanceof Widget;")));
+}
+
+TEST_F(JSExportTests, JSExportArgumentsConstructor) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject global_object = js_context.get_global_object();
+  global_object.SetProperty("FlatChildWidget", js_context.CreateObject(JSExport<FlatChildWidget>::Class()));
+  
+  // FlatChildWidget has a (const JSContext&, const JSArguments&)
+  // constructor, so 'new' passes its arguments to it.
+  auto result = js_context.JSEvaluateScript("new FlatChildWidget('foo', 3);");
+  XCTAssertTrue(result.IsObject());
+  JSObject widget = static_cast<JSObject>(result);
+  const auto widget_ptr = widget.GetPrivate<FlatChildWidget>();
+  XCTAssertNotEqual(nullptr, widget_ptr);
+  XCTAssertEqual("foo", widget_ptr->get_name());
+  XCTAssertEqual(3, widget_ptr->get_number());
+  
+  // CreateObject still uses the JSContext constructor.
+  JSObject default_widget = js_context.CreateObject(JSExport<FlatChildWidget>::Class());
+  XCTAssertEqual("world", default_widget.GetPrivate<FlatChildWidget>()->get_name());
+}
+
 TEST_F(JSExportTests, JSExportGetPrivate) {
   JSContext js_context = js_context_group.CreateContext();
   JSObject global_object = js_context.get_global_object();
@@ -230,6 +1006,628 @@ TEST_F(JSExportTests, JSExportGetPrivate) {
   XCTAssertEqual(nullptr, wrong_widget_ptr2);
 }
 
+TEST_F(JSExportTests, JSExportGetPrivateAs) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  JSObject widget       = js_context.CreateObject(JSExport<Widget>::Class());
+  JSObject child_widget = js_context.CreateObject(JSExport<ChildWidget>::Class());
+  JSObject other_widget = js_context.CreateObject(JSExport<OtherWidget>::Class());
+  
+  XCTAssertEqual(widget.GetPrivate<Widget>().get(), widget.GetPrivateAs<Widget>());
+  XCTAssertNotEqual(nullptr, widget.GetPrivateAs<Widget>());
+  XCTAssertEqual(nullptr, widget.GetPrivateAs<OtherWidget>());
+  XCTAssertEqual(nullptr, other_widget.GetPrivateAs<Widget>());
+  XCTAssertEqual(nullptr, js_context.CreateObject().GetPrivateAs<Widget>());
+  
+  // A derived class' native object is one of its parent too.
+  XCTAssertNotEqual(nullptr, child_widget.GetPrivateAs<ChildWidget>());
+  XCTAssertEqual(child_widget.GetPrivateAs<ChildWidget>(), child_widget.GetPrivateAs<Widget>());
+  XCTAssertEqual(nullptr, widget.GetPrivateAs<ChildWidget>());
+  
+  // The native class decides, not the prototype chain.
+  js_context.get_global_object().SetProperty("widget", widget);
+  js_context.get_global_object().SetProperty("child_widget", child_widget);
+  XCTAssertEqual(nullptr, static_cast<JSObject>(js_context.JSEvaluateScript("Object.create(widget);")).GetPrivateAs<Widget>());
+  XCTAssertEqual(nullptr, static_cast<JSObject>(js_context.JSEvaluateScript("Object.setPrototypeOf(widget, Object.getPrototypeOf(child_widget));")).GetPrivateAs<ChildWidget>());
+  XCTAssertNotEqual(nullptr, static_cast<JSObject>(js_context.JSEvaluateScript("Object.setPrototypeOf(child_widget, null);")).GetPrivateAs<Widget>());
+  
+  auto handle = widget.GetPrivateHandle<Widget>();
+  XCTAssertTrue(static_cast<bool>(handle));
+  XCTAssertEqual(widget.GetPrivateAs<Widget>(), handle.get());
+  XCTAssertEqual(1, handle.use_count());
+  {
+    auto handle_copy = handle;
+    XCTAssertEqual(2, handle.use_count());
+    XCTAssertTrue(handle_copy == handle);
+  }
+  XCTAssertEqual(1, handle.use_count());
+  XCTAssertFalse(static_cast<bool>(other_widget.GetPrivateHandle<Widget>()));
+  
+  // The handle keeps the native object alive without its JSObject.
+  handle -> set_number(7);
+  widget = js_context.CreateObject();
+  js_context.GarbageCollect();
+  XCTAssertEqual(7, handle -> get_number());
+  
+  handle = JSExportHandle<Widget>();
+  XCTAssertEqual(0, handle.use_count());
+}
+
+TEST_F(JSExportTests, JSExportWeakHandle) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto widget       = js_context.CreateObject(JSExport<Widget>::Class());
+  auto child_widget = js_context.CreateObject(JSExport<ChildWidget>::Class());
+  
+  // A weak handle doesn't count as an owner until it is locked.
+  const auto weak_handle = widget.GetWeakHandle<Widget>();
+  XCTAssertFalse(weak_handle.expired());
+  XCTAssertEqual(1, widget.GetPrivateHandle<Widget>().use_count());
+  {
+    const auto handle = weak_handle.Lock();
+    XCTAssertEqual(widget.GetPrivateAs<Widget>(), handle.get());
+    XCTAssertEqual(1, handle.use_count());
+  }
+  
+  // The same object gets the same slot, and only as its own class.
+  const auto weak_handle_copy = widget.GetWeakHandle<Widget>();
+  XCTAssertEqual(weak_handle.Lock().get(), weak_handle_copy.Lock().get());
+  XCTAssertTrue(child_widget.GetWeakHandle<Widget>().expired());
+  XCTAssertFalse(child_widget.GetWeakHandle<ChildWidget>().expired());
+  XCTAssertTrue(js_context.CreateObject().GetWeakHandle<Widget>().expired());
+  XCTAssertFalse(static_cast<bool>(JSExportWeakHandle<Widget>().Lock()));
+  
+  // A released slot matches none of its earlier references, even once
+  // it is reused.
+  int native_object = 0;
+  detail::JSExportSlotValue value;
+  value.native_object_ptr = &native_object;
+  const auto reference = detail::AcquireJSExportSlot(value);
+  detail::JSExportSlotValue found;
+  XCTAssertTrue(detail::FindJSExportSlot(reference, found));
+  XCTAssertEqual(&native_object, found.native_object_ptr);
+  detail::ReleaseJSExportSlot(reference);
+  XCTAssertFalse(detail::FindJSExportSlot(reference, found));
+  const auto reused_reference = detail::AcquireJSExportSlot(value);
+  XCTAssertEqual(reference.index, reused_reference.index);
+  XCTAssertFalse(detail::FindJSExportSlot(reference, found));
+  XCTAssertTrue(detail::FindJSExportSlot(reused_reference, found));
+  detail::ReleaseJSExportSlot(reused_reference);
+  
+  // Calling a function with an object that has no native object, or
+  // the native object of another class, throws instead of
+  // dereferencing its private data.
+  js_context.get_global_object().SetProperty("widget", widget);
+  js_context.get_global_object().SetProperty("other_widget", js_context.CreateObject(JSExport<OtherWidget>::Class()));
+  ASSERT_THROW(js_context.JSEvaluateScript("widget.sayHello.call({});"), std::runtime_error);
+  ASSERT_THROW(js_context.JSEvaluateScript("widget.sayHello.call(other_widget);"), std::runtime_error);
+}
+
+TEST_F(JSExportTests, JSExportWeakHandleAfterGarbageCollect) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  // Once JavaScript can't reach the object, Lock fails even if the
+  // collector hasn't swept it yet, rather than reviving it.
+  auto widget = js_context.CreateObject(JSExport<Widget>::Class());
+  const auto weak_handle = widget.GetWeakHandle<Widget>();
+  XCTAssertTrue(static_cast<bool>(weak_handle.Lock()));
+  widget = js_context.CreateObject();
+  js_context.GarbageCollect();
+  XCTAssertFalse(static_cast<bool>(weak_handle.Lock()));
+  
+  // While JavaScript still holds it, it stays lockable.
+  auto kept = js_context.CreateObject(JSExport<Widget>::Class());
+  js_context.get_global_object().SetProperty("kept", kept);
+  const auto kept_handle = kept.GetWeakHandle<Widget>();
+  kept = js_context.CreateObject();
+  js_context.GarbageCollect();
+  XCTAssertFalse(kept_handle.expired());
+  XCTAssertTrue(static_cast<bool>(kept_handle.Lock()));
+}
+
+TEST_F(JSExportTests, JSExportWrap) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  const std::int32_t models[] = { 1, 2 };
+  std::size_t init_count = 0;
+  const auto init = [&init_count](const std::int32_t* model) {
+    return [&init_count, model](Widget& widget) {
+      ++init_count;
+      widget.set_number(*model);
+    };
+  };
+  
+  // The same native pointer gets the same JavaScript object.
+  auto first  = JSExport<Widget>::Wrap(js_context, &models[0], init(&models[0]));
+  auto second = JSExport<Widget>::Wrap(js_context, &models[0], init(&models[0]));
+  XCTAssertEqual(static_cast<JSObjectRef>(first), static_cast<JSObjectRef>(second));
+  XCTAssertEqual(1, init_count);
+  XCTAssertEqual(1, first.GetPrivateAs<Widget>() -> get_number());
+  
+  auto other = JSExport<Widget>::Wrap(js_context, &models[1], init(&models[1]));
+  XCTAssertNotEqual(static_cast<JSObjectRef>(first), static_cast<JSObjectRef>(other));
+  XCTAssertEqual(2, init_count);
+  XCTAssertEqual(2, other.GetPrivateAs<Widget>() -> get_number());
+  
+  // Each class and each context has wrappers of its own.
+  auto child = JSExport<ChildWidget>::Wrap(js_context, &models[0]);
+  XCTAssertNotEqual(static_cast<JSObjectRef>(first), static_cast<JSObjectRef>(child));
+  JSContext other_context = js_context_group.CreateContext();
+  XCTAssertNotEqual(static_cast<JSObjectRef>(first), static_cast<JSObjectRef>(JSExport<Widget>::Wrap(other_context, &models[0])));
+  
+  js_context.get_global_object().SetProperty("first", first);
+  js_context.get_global_object().SetProperty("second", second);
+  XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("first === second;")));
+  
+  ASSERT_THROW(JSExport<Widget>::Wrap(js_context, nullptr), std::invalid_argument);
+}
+
+TEST_F(JSExportTests, JSExportWrapAfterGarbageCollect) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  const std::int32_t models[] = { 1, 2, 3 };
+  std::size_t init_count = 0;
+  const auto init = [&init_count](Widget&) {
+    ++init_count;
+  };
+  
+  // Wrappers only reachable through the cache are collected, after
+  // which Wrap makes a live object rather than returning the dead one,
+  // whether or not it has been finalized yet.
+  for (const auto& model : models) {
+    JSExport<Widget>::Wrap(js_context, &model, init);
+  }
+  XCTAssertEqual(3, init_count);
+  js_context.GarbageCollect();
+  
+  for (const auto& model : models) {
+    auto widget = JSExport<Widget>::Wrap(js_context, &model, init);
+    js_context.get_global_object().SetProperty("widget", widget);
+    XCTAssertEqual("world", static_cast<std::string>(js_context.JSEvaluateScript("widget.name;")));
+  }
+  XCTAssertTrue(init_count >= 3 && init_count <= 6);
+  
+  // A wrapper kept alive by JavaScript is still found.
+  auto kept = JSExport<Widget>::Wrap(js_context, &models[0], init);
+  js_context.get_global_object().SetProperty("kept", kept);
+  js_context.GarbageCollect();
+  XCTAssertEqual(static_cast<JSObjectRef>(kept), static_cast<JSObjectRef>(JSExport<Widget>::Wrap(js_context, &models[0], init)));
+}
+
+TEST_F(JSExportTests, JSExportGetObject) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  JSObject widget = js_context.CreateObject(JSExport<Widget>::Class());
+  auto widget_ptr = widget.GetPrivate<Widget>();
+  XCTAssertNotEqual(nullptr, widget_ptr);
+  
+  // Test getting back to the JSObject from the C++ object.
+  JSObject js_object = widget_ptr->get_object();
+  XCTAssertEqual(static_cast<JSObjectRef>(widget), static_cast<JSObjectRef>(js_object));
+  XCTAssertFalse(js_object.IsError());
+  
+  // A copy of the C++ object is not the private data of any JSObject.
+  Widget widget_copy(*widget_ptr);
+  XCTAssertTrue(widget_copy.get_object().IsError());
+}
+
+TEST_F(JSExportTests, ExternalMemoryCost) {
+  JSContext js_context = js_context_group.CreateContext();
+  const auto external_memory_size = js_context.get_external_memory_size();
+  {
+    JSObject widget = js_context.CreateObject(JSExport<Widget>::Class());
+    auto widget_ptr = widget.GetPrivate<Widget>();
+    XCTAssertNotEqual(nullptr, widget_ptr);
+    XCTAssertEqual(0, widget_ptr -> get_external_memory_cost());
+    
+    widget_ptr -> set_external_memory_cost(1024 * 1024);
+    XCTAssertEqual(external_memory_size + 1024 * 1024, js_context.get_external_memory_size());
+    
+    // Updating the cost only charges the difference.
+    widget_ptr -> set_external_memory_cost(512);
+    XCTAssertEqual(external_memory_size + 512, js_context.get_external_memory_size());
+    
+    // A copy doesn't hold the native allocation of the original.
+    Widget widget_copy(*widget_ptr);
+    XCTAssertEqual(0, widget_copy.get_external_memory_cost());
+    
+    widget_ptr -> set_external_memory_cost(0);
+    XCTAssertEqual(external_memory_size, js_context.get_external_memory_size());
+  }
+  
+  Widget widget(js_context);
+  widget.set_external_memory_cost(4096);
+  XCTAssertEqual(external_memory_size + 4096, js_context.get_external_memory_size());
+  
+  js_context.set_external_memory_gc_threshold(1024);
+  XCTAssertEqual(1024, js_context.get_external_memory_gc_threshold());
+}
+
+TEST_F(JSExportTests, JSExportClassBudget) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject widget = js_context.CreateObject(JSExport<Widget>::Class());
+  auto widget_ptr = widget.GetPrivate<Widget>();
+  XCTAssertNotEqual(nullptr, widget_ptr);
+  
+  const auto before = JSExport<Widget>::GetClassStatistics();
+  XCTAssertTrue(before.live_count >= 1);
+  XCTAssertTrue(before.instance_bytes >= before.live_count * sizeof(Widget));
+  
+  // The budget leaves room for garbage collected Widgets of other tests.
+  const auto over_budget_count = std::make_shared<int>(0);
+  JSExportClassBudget budget;
+  budget.total_bytes = before.get_total_bytes() + 1024 * 1024;
+  budget.callback    = [over_budget_count](const JSExportClassStatistics&) {
+    ++*over_budget_count;
+  };
+  JSExport<Widget>::SetClassBudget(budget);
+  XCTAssertEqual(0, *over_budget_count);
+  
+  widget_ptr -> set_external_memory_cost(2 * 1024 * 1024);
+  XCTAssertEqual(before.external_memory_bytes + 2 * 1024 * 1024, JSExport<Widget>::GetClassStatistics().external_memory_bytes);
+  XCTAssertEqual(1, *over_budget_count);
+  
+  // The callback fires once each time the class goes over budget.
+  widget_ptr -> set_external_memory_cost(3 * 1024 * 1024);
+  XCTAssertEqual(1, *over_budget_count);
+  widget_ptr -> set_external_memory_cost(0);
+  widget_ptr -> set_external_memory_cost(2 * 1024 * 1024);
+  XCTAssertEqual(2, *over_budget_count);
+  
+  widget_ptr -> set_external_memory_cost(0);
+  JSExport<Widget>::SetClassBudget(JSExportClassBudget());
+}
+
+TEST_F(JSExportTests, JSWeakObject) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject widget = js_context.CreateObject(JSExport<Widget>::Class());
+  
+  JSWeakObject js_weak_object(widget);
+  JSWeakObject js_weak_object_copy = js_weak_object;
+  XCTAssertTrue(js_weak_object.IsAlive());
+  XCTAssertEqual(static_cast<JSObjectRef>(widget), static_cast<JSObjectRef>(static_cast<JSObject>(js_weak_object_copy.Lock())));
+  
+  JSWeakObjectMap js_weak_object_map(js_context);
+  const int key = 0;
+  XCTAssertTrue(js_weak_object_map.Get(&key).IsUndefined());
+  
+  js_weak_object_map.Set(&key, widget);
+  XCTAssertEqual(static_cast<JSObjectRef>(widget), static_cast<JSObjectRef>(static_cast<JSObject>(js_weak_object_map.Get(&key))));
+  
+  js_weak_object_map.Remove(&key);
+  XCTAssertTrue(js_weak_object_map.Get(&key).IsUndefined());
+  
+  JSContext other_js_context = js_context_group.CreateContext();
+  ASSERT_THROW(JSWeakObjectMap(other_js_context).Set(&key, widget), std::invalid_argument);
+}
+
+namespace {
+  
+  // JSGarbageCollect only asks for a collection, so allocate and
+  // collect until done returns true, or give up after enough rounds
+  // that it never will.
+  template<typename Predicate>
+  bool CollectUntil(const JSContext& js_context, Predicate done) {
+    for (int round = 0; round < 100 && !done(); ++round) {
+      js_context.JSEvaluateScript("for (var i = 0; i < 10000; ++i) { new Object(); } undefined;");
+      js_context.GarbageCollect();
+    }
+    return done();
+  }
+  
+  bool CollectUntilDead(const JSContext& js_context, const JSWeakObject& js_weak_object) {
+    return CollectUntil(js_context, [&js_weak_object] { return !js_weak_object.IsAlive(); });
+  }
+  
+} // namespace {
+
+TEST_F(JSExportTests, JSWeakObjectAfterGarbageCollect) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSWeakObjectMap js_weak_object_map(js_context);
+  const int dropped_key = 0;
+  const int kept_key    = 1;
+  
+  // Neither weak reference keeps its object alive, so once the last
+  // JSObject is gone the collector reclaims it.
+  JSObject dropped = js_context.CreateObject(JSExport<Widget>::Class());
+  JSWeakObject dropped_weak_object(dropped);
+  js_weak_object_map.Set(&dropped_key, dropped);
+  dropped = js_context.CreateObject();
+  
+  // One that JavaScript still references stays alive.
+  JSObject kept = js_context.CreateObject(JSExport<Widget>::Class());
+  js_context.get_global_object().SetProperty("kept", kept);
+  JSWeakObject kept_weak_object(kept);
+  js_weak_object_map.Set(&kept_key, kept);
+  kept = js_context.CreateObject();
+  
+  XCTAssertTrue(CollectUntilDead(js_context, dropped_weak_object));
+  XCTAssertTrue(dropped_weak_object.Lock().IsUndefined());
+  XCTAssertTrue(js_weak_object_map.Get(&dropped_key).IsUndefined());
+  
+  XCTAssertTrue(kept_weak_object.IsAlive());
+  const auto kept_ref = static_cast<JSObjectRef>(static_cast<JSObject>(js_context.get_global_object().GetProperty("kept")));
+  XCTAssertEqual(kept_ref, static_cast<JSObjectRef>(static_cast<JSObject>(kept_weak_object.Lock())));
+  XCTAssertEqual(kept_ref, static_cast<JSObjectRef>(static_cast<JSObject>(js_weak_object_map.Get(&kept_key))));
+}
+
+TEST_F(JSExportTests, JSExportFinalizer) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSExportFinalizer::RunPending();
+  XCTAssertEqual(0, JSExportFinalizer::get_pending_count());
+  
+  // Deferred native objects wait on this thread's queue.
+  detail::DeferNativeObjectDestruction(detail::CreateNativeObject<Widget>(js_context));
+  detail::DeferNativeObjectDestruction(detail::CreateNativeObject<Widget>(js_context));
+  detail::DeferNativeObjectDestruction(detail::CreateNativeObject<Widget>(js_context));
+  XCTAssertEqual(3, JSExportFinalizer::get_pending_count());
+  
+  XCTAssertEqual(2, JSExportFinalizer::RunPending(2));
+  XCTAssertEqual(1, JSExportFinalizer::get_pending_count());
+  XCTAssertEqual(1, JSExportFinalizer::RunPending());
+  XCTAssertEqual(0, JSExportFinalizer::get_pending_count());
+}
+
+TEST_F(JSExportTests, GetPropertyNamesCallback) {
+  JSContext js_context = js_context_group.CreateContext();
+  js_context.get_global_object().SetProperty("widget", js_context.CreateObject(JSExport<NamesWidget>::Class()));
+  
+  // Every AddName overload adds exactly its name, including UTF-8 and
+  // UTF-16 names given with a length and no terminating NUL.
+  XCTAssertEqual("alpha,beta,epsilon,eta,gamma,iota,kappa,theta,zeta,\xC3\xB1u,\xCE\xB4" "elta", static_cast<std::string>(js_context.JSEvaluateScript(
+      "Object.keys(widget).sort().join()")));
+  
+  // Each enumerated name reads its own value.
+  XCTAssertEqual(66, static_cast<int32_t>(js_context.JSEvaluateScript(
+      "var sum = 0; for (var name in widget) { sum += widget[name]; } sum")));
+  XCTAssertEqual(6, static_cast<int32_t>(js_context.JSEvaluateScript("widget['\\u00F1u']")));
+  XCTAssertTrue(js_context.JSEvaluateScript("widget.beta_").IsUndefined());
+}
+
+TEST_F(JSExportTests, DeferredFinalization) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSExportFinalizer::RunPending();
+  const auto destroyed_count = DeferredWidget::get_destroyed_count();
+  
+  for (int i = 0; i < 100; ++i) {
+    js_context.CreateObject(JSExport<DeferredWidget>::Class());
+  }
+  
+  // The collection finalizes the objects but only queues their native
+  // objects, which RunPending then destroys.
+  XCTAssertTrue(CollectUntil(js_context, [] { return JSExportFinalizer::get_pending_count() > 0; }));
+  XCTAssertEqual(destroyed_count, DeferredWidget::get_destroyed_count());
+  
+  const auto pending_count = JSExportFinalizer::get_pending_count();
+  XCTAssertEqual(1, JSExportFinalizer::RunPending(1));
+  XCTAssertEqual(destroyed_count + 1, DeferredWidget::get_destroyed_count());
+  XCTAssertEqual(pending_count - 1, JSExportFinalizer::RunPending());
+  XCTAssertEqual(destroyed_count + pending_count, DeferredWidget::get_destroyed_count());
+  XCTAssertEqual(0, JSExportFinalizer::get_pending_count());
+}
+
+TEST_F(JSExportTests, JSExportRecycler) {
+  static_assert(!detail::JSExportCanRecycle<Widget>::value, "Widget has no Recycle member function");
+  
+  JSContext js_context       = js_context_group.CreateContext();
+  JSContext other_js_context = js_context_group.CreateContext();
+  detail::JSExportClassInfo class_info;
+  
+  const auto first  = detail::CreateNativeObject<Widget>(js_context);
+  const auto second = detail::CreateNativeObject<Widget>(js_context);
+  const auto third  = detail::CreateNativeObject<Widget>(js_context);
+  XCTAssertTrue(detail::RecycleNativeObject(class_info, js_context, first, 2));
+  XCTAssertTrue(detail::RecycleNativeObject(class_info, js_context, second, 2));
+  XCTAssertFalse(detail::RecycleNativeObject(class_info, js_context, third, 2));
+  detail::DestroyNativeObject(third);
+  XCTAssertEqual(2, detail::GetRecycledNativeObjectCount(class_info));
+  
+  // Objects are only reused in the JSContext they were created in.
+  XCTAssertEqual(nullptr, detail::ReuseNativeObject(class_info, other_js_context));
+  XCTAssertEqual(second, detail::ReuseNativeObject(class_info, js_context));
+  XCTAssertEqual(1, detail::GetRecycledNativeObjectCount(class_info));
+  detail::DestroyNativeObject(second);
+  
+  XCTAssertEqual(1, detail::PurgeRecycledNativeObjects(class_info));
+  XCTAssertEqual(0, detail::GetRecycledNativeObjectCount(class_info));
+  XCTAssertEqual(nullptr, detail::ReuseNativeObject(class_info, js_context));
+}
+
+TEST_F(JSExportTests, RecycledNativeObjects) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSExport<RecycledWidget>::PurgeRecycled();
+  
+  const auto recycled_count = RecycledWidget::get_recycled_count();
+  for (int i = 0; i < 20; ++i) {
+    js_context.CreateObject(JSExport<RecycledWidget>::Class()).SetProperty("value", js_context.CreateNumber(7));
+  }
+  
+  // Finalized native objects are reset and kept, up to the capacity.
+  // Once it is reached the collector destroys the rest, so later
+  // collections can't change the count.
+  XCTAssertTrue(CollectUntil(js_context, [] { return JSExport<RecycledWidget>::GetRecycledCount() == RecycledWidget::kRecycleCapacity; }));
+  XCTAssertTrue(RecycledWidget::get_recycled_count() - recycled_count >= RecycledWidget::kRecycleCapacity);
+  
+  // A new object reuses one without constructing another, and the
+  // rest are destroyed when purged.
+  const auto constructed_count = RecycledWidget::get_constructed_count();
+  const auto destroyed_count   = RecycledWidget::get_destroyed_count();
+  auto widget = js_context.CreateObject(JSExport<RecycledWidget>::Class());
+  XCTAssertEqual(constructed_count, RecycledWidget::get_constructed_count());
+  XCTAssertEqual(RecycledWidget::kRecycleCapacity - 1, JSExport<RecycledWidget>::GetRecycledCount());
+  XCTAssertEqual(RecycledWidget::kRecycleCapacity - 1, JSExport<RecycledWidget>::PurgeRecycled());
+  XCTAssertEqual(destroyed_count + RecycledWidget::kRecycleCapacity - 1, RecycledWidget::get_destroyed_count());
+  XCTAssertEqual(0, JSExport<RecycledWidget>::GetRecycledCount());
+  
+  // The reused object was reset by Recycle.
+  XCTAssertEqual(0, static_cast<int32_t>(widget.GetProperty("value")));
+}
+
+#ifdef HAL_CALLBACK_LATENCY_ENABLE
+TEST_F(JSExportTests, JSLatencyHistogram) {
+  detail::JSLatencyHistogram histogram;
+  XCTAssertEqual(0, histogram.GetPercentile(50));
+  
+  for (std::uint64_t nanoseconds = 1; nanoseconds <= 1000; ++nanoseconds) {
+    histogram.Record(nanoseconds);
+  }
+  XCTAssertEqual(1000, histogram.get_count());
+  XCTAssertEqual(500500, histogram.get_total_nanoseconds());
+  XCTAssertEqual(1000, histogram.get_max_nanoseconds());
+  
+  // Percentiles are within a sixteenth of the recorded value.
+  const auto median = histogram.GetPercentile(50);
+  XCTAssertTrue(median >= 500 && median <= 500 + 500 / 16);
+  XCTAssertEqual(1000, histogram.GetPercentile(100));
+  
+  histogram.Reset();
+  XCTAssertEqual(0, histogram.get_count());
+}
+
+TEST_F(JSExportTests, CallbackLatency) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("Widget", js_context.CreateObject(JSExport<Widget>::Class()));
+  detail::ResetCallbackLatencies();
+  
+  js_context.JSEvaluateScript("var widget = new Widget(); for (var i = 0; i < 10; ++i) { widget.number; widget.sayHello(); }");
+  XCTAssertEqual(1, JSExport<Widget>::GetCallbackLatency(detail::JSExportCallbackKind::CallAsConstructor).get_count());
+  XCTAssertEqual(10, JSExport<Widget>::GetCallbackLatency(detail::JSExportCallbackKind::GetNamedValueProperty).get_count());
+  XCTAssertEqual(10, JSExport<Widget>::GetCallbackLatency(detail::JSExportCallbackKind::CallNamedFunction).get_count());
+  XCTAssertEqual(0, JSExport<Widget>::GetCallbackLatency(detail::JSExportCallbackKind::SetNamedValueProperty).get_count());
+  
+  const auto latencies = detail::GetCallbackLatencies();
+  XCTAssertEqual(3, latencies.size());
+  for (const auto& latency : latencies) {
+    XCTAssertEqual(JSExportClassName<Widget>::get(), latency.class_name);
+  }
+}
+#endif
+
+TEST_F(JSExportTests, JSCallbackRecorder) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("Widget", js_context.CreateObject(JSExport<Widget>::Class()));
+  
+  JSCallbackRecorder::Start();
+  XCTAssertTrue(JSCallbackRecorder::IsEnabled());
+  js_context.JSEvaluateScript("Widget.number; Widget.number = 3; Widget.sayHello('foo', 1);");
+  JSCallbackRecorder::Stop();
+  XCTAssertFalse(JSCallbackRecorder::IsEnabled());
+  
+  const auto recording = JSCallbackRecorder::ToBinary();
+  const auto records   = JSCallbackRecorder::ParseBinary(recording);
+  XCTAssertEqual(JSCallbackRecorder::get_record_count(), records.size());
+  
+#ifdef HAL_CALLBACK_RECORD_ENABLE
+  XCTAssertEqual(3, records.size());
+  XCTAssertEqual(0, JSCallbackRecorder::get_dropped_record_count());
+  XCTAssertEqual(JSExportClassName<Widget>::get(), records[0].class_name);
+  XCTAssertTrue(JSCallbackRecordKind::GetNamedValueProperty == records[0].kind);
+  XCTAssertEqual("number", records[0].property_name);
+  XCTAssertTrue(JSCallbackRecordKind::SetNamedValueProperty == records[1].kind);
+  XCTAssertEqual(1, records[1].argument_types.size());
+  XCTAssertTrue(JSValue::Type::Number == records[1].argument_types[0]);
+  XCTAssertTrue(JSCallbackRecordKind::CallNamedFunction == records[2].kind);
+  XCTAssertEqual("sayHello", records[2].property_name);
+  XCTAssertEqual(2, records[2].argument_types.size());
+  XCTAssertTrue(JSValue::Type::String == records[2].argument_types[0]);
+  
+  // The replayed setter is called with a number of its own.
+  const auto durations = JSCallbackRecorder::Replay(js_context, records, [](const JSContext& js_context, const std::string&) -> JSValue {
+    return js_context.get_global_object().GetProperty("Widget");
+  });
+  XCTAssertEqual(3, durations.size());
+  XCTAssertEqual(0, static_cast<int32_t>(js_context.JSEvaluateScript("Widget.number")));
+  
+  // Classes without an object are skipped.
+  const auto skipped = JSCallbackRecorder::Replay(js_context, records);
+  XCTAssertEqual(3, skipped.size());
+  XCTAssertEqual(0, skipped[0]);
+#else
+  XCTAssertEqual(0, records.size());
+#endif
+  
+  ASSERT_THROW(JSCallbackRecorder::ParseBinary("not a recording"), std::runtime_error);
+  ASSERT_THROW(JSCallbackRecorder::ParseBinary(recording.substr(0, recording.size() - 1)), std::runtime_error);
+}
+
+#ifdef HAL_PROPERTY_PROFILE_ENABLE
+TEST_F(JSExportTests, PropertyProfile) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("Widget", js_context.CreateObject(JSExport<Widget>::Class()));
+  JSExport<Widget>::ResetPropertyProfile();
+  
+  js_context.JSEvaluateScript("var widget = new Widget(); for (var i = 0; i < 10; ++i) { widget.number; } widget.number = 3; widget.sayHello(); widget.sayHello();");
+  const auto profile = JSExport<Widget>::GetPropertyProfile();
+  XCTAssertEqual(3, profile.size());
+  
+  std::uint64_t number_gets = 0;
+  std::uint64_t number_sets = 0;
+  std::uint64_t hello_calls = 0;
+  for (const auto& entry : profile) {
+    if (entry.name == "number" && entry.kind == detail::JSPropertyProfileKind::Get) {
+      number_gets = entry.count;
+    } else if (entry.name == "number" && entry.kind == detail::JSPropertyProfileKind::Set) {
+      number_sets = entry.count;
+    } else if (entry.name == "sayHello" && entry.kind == detail::JSPropertyProfileKind::Call) {
+      hello_calls = entry.count;
+    }
+  }
+  XCTAssertEqual(10, number_gets);
+  XCTAssertEqual(1, number_sets);
+  XCTAssertEqual(2, hello_calls);
+  
+  // Sorted by total time.
+  for (std::size_t i = 1; i < profile.size(); ++i) {
+    XCTAssertTrue(profile[i - 1].total_nanoseconds >= profile[i].total_nanoseconds);
+  }
+  
+  JSExport<Widget>::ResetPropertyProfile();
+  XCTAssertEqual(0, JSExport<Widget>::GetPropertyProfile().size());
+}
+#endif
+
+TEST_F(JSExportTests, JSExportPool) {
+  const auto size = detail::kJSExportNativeObjectHeaderSize + sizeof(Widget);
+  
+  // A freed block is the next one handed out on the same thread.
+  void* block_1 = JSExportAllocator<Widget>::Allocate(size);
+  void* block_2 = JSExportAllocator<Widget>::Allocate(size);
+  XCTAssertNotEqual(block_1, block_2);
+  JSExportAllocator<Widget>::Deallocate(block_2, size);
+  void* block_3 = JSExportAllocator<Widget>::Allocate(size);
+  XCTAssertEqual(block_2, block_3);
+  JSExportAllocator<Widget>::Deallocate(block_3, size);
+  JSExportAllocator<Widget>::Deallocate(block_1, size);
+  
+  // A thread's cached blocks go back to their slab when it exits, and
+  // a slab whose blocks are all back is returned to the heap.
+  const auto slab_count = detail::JSExportPool<Widget>::get_slab_count();
+  std::thread([size]() {
+    JSExportAllocator<Widget>::Deallocate(JSExportAllocator<Widget>::Allocate(size), size);
+  }).join();
+  XCTAssertEqual(slab_count, detail::JSExportPool<Widget>::get_slab_count());
+  
+  // A block still in use, here cached by this thread, keeps its slab.
+  void* block_4 = nullptr;
+  std::thread([size, &block_4]() {
+    block_4 = JSExportAllocator<Widget>::Allocate(size);
+  }).join();
+  XCTAssertEqual(slab_count + 1, detail::JSExportPool<Widget>::get_slab_count());
+  JSExportAllocator<Widget>::Deallocate(block_4, size);
+  XCTAssertEqual(block_4, JSExportAllocator<Widget>::Allocate(size));
+  JSExportAllocator<Widget>::Deallocate(block_4, size);
+  XCTAssertEqual(slab_count + 1, detail::JSExportPool<Widget>::get_slab_count());
+  
+  JSContext js_context = js_context_group.CreateContext();
+  for (int i = 0; i < 1000; ++i) {
+    JSObject widget = js_context.CreateObject(JSExport<Widget>::Class());
+    XCTAssertNotEqual(nullptr, widget.GetPrivate<Widget>());
+  }
+  js_context.GarbageCollect();
+}
+
 TEST_F(JSExportTests, JSExportConstructorCount) {
   JSContext js_context = js_context_group.CreateContext();
   JSObject global_object = js_context.get_global_object();
@@ -1418,3 +2816,44 @@ TEST_F(JSExportTests, LRUCache) {
   XCTAssertTrue(keys.empty());
 }
 
+
+TEST_F(JSExportTests, JSExportNameTable) {
+  const std::vector<std::string> names { "pi", "sayHello", "spät", "", "name", "number" };
+  detail::JSExportNameTable table(names);
+  XCTAssertEqual(names.size(), table.size());
+  
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    XCTAssertEqual(i, table.Find(static_cast<JSStringRef>(JSString(names[i]))));
+  }
+  
+  XCTAssertEqual(detail::JSExportNameTable::npos, table.Find(static_cast<JSStringRef>(JSString("nam"))));
+  XCTAssertEqual(detail::JSExportNameTable::npos, table.Find(static_cast<JSStringRef>(JSString("sayGoodbye"))));
+  XCTAssertEqual(detail::JSExportNameTable::npos, detail::JSExportNameTable().Find(static_cast<JSStringRef>(JSString("pi"))));
+}
+
+TEST_F(JSExportTests, ConstantCachePerContext) {
+  auto js_context1 = js_context_group.CreateContext();
+  auto js_context2 = js_context_group.CreateContext();
+  auto widget_class = JSExport<OtherWidget>::Class();
+  js_context1.get_global_object().SetProperty("Widget", js_context1.CreateObject(widget_class));
+  js_context2.get_global_object().SetProperty("Widget", js_context2.CreateObject(widget_class));
+  
+  JSExport<OtherWidget>::ResizeCache(8);
+  const auto statistics1 = JSExport<OtherWidget>::GetCacheStatistics();
+  
+  // Each JSContext gets its own entry.
+  XCTAssertEqual(1, static_cast<std::uint32_t>(js_context1.JSEvaluateScript("Widget.CONST1;")));
+  XCTAssertEqual(1, static_cast<std::uint32_t>(js_context2.JSEvaluateScript("Widget.CONST1;")));
+  XCTAssertEqual(2, HAL::detail::JSExportClass<OtherWidget>::GetCachedKeys().size());
+  XCTAssertEqual(1, static_cast<std::uint32_t>(js_context1.JSEvaluateScript("Widget.CONST1;")));
+  
+  const auto statistics2 = JSExport<OtherWidget>::GetCacheStatistics();
+  XCTAssertEqual(2, statistics2.misses - statistics1.misses);
+  XCTAssertEqual(1, statistics2.hits   - statistics1.hits);
+  
+  HAL::detail::JSExportClass<OtherWidget>::EvictCache(js_context1);
+  XCTAssertEqual(1, HAL::detail::JSExportClass<OtherWidget>::GetCachedKeys().size());
+  
+  JSExport<OtherWidget>::EvictAllCache();
+  XCTAssertTrue(HAL::detail::JSExportClass<OtherWidget>::GetCachedKeys().empty());
+}
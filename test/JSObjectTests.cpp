@@ -7,8 +7,12 @@
  */
 
 #include "HAL/HAL.hpp"
+#include "JSBudget.hpp"
+#include "JSTemporaryPath.hpp"
 
 #include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
 
 #define XCTAssertEqual    ASSERT_EQ
 #define XCTAssertNotEqual ASSERT_NE
@@ -38,7 +42,8 @@ TEST_F(JSObjectTests, ObjectSizes) {
   
   // JSValue and JSObject are base classes, so have an extra pointer for the
   // virtual function table.
-  XCTAssertEqual(sizeof(JSContext) + sizeof(std::intptr_t) + sizeof(std::intptr_t) + sizeof(std::intptr_t), sizeof(JSValue));
+  // JSValue also carries its JSHandleScope id.
+  XCTAssertEqual(sizeof(JSContext) + sizeof(std::intptr_t) + sizeof(std::intptr_t) + sizeof(std::intptr_t) + sizeof(std::uint64_t), sizeof(JSValue));
   XCTAssertEqual(sizeof(JSContext) + sizeof(std::intptr_t) + sizeof(std::intptr_t), sizeof(JSObject));
 }
 
@@ -57,6 +62,27 @@ TEST_F(JSObjectTests, JSPropertyAttribute) {
   XCTAssertEqual(1, attributes.size());
 }
 
+TEST_F(JSObjectTests, JSPropertyAttributeSet) {
+  JSPropertyAttributeSet attributes;
+  XCTAssertTrue(attributes.empty());
+  XCTAssertTrue(attributes.Contains(JSPropertyAttribute::None));
+  XCTAssertFalse(attributes.Contains(JSPropertyAttribute::ReadOnly));
+  
+  attributes |= JSPropertyAttribute::DontDelete;
+  XCTAssertTrue(attributes.Contains(JSPropertyAttribute::DontDelete));
+  XCTAssertFalse(attributes.Contains(JSPropertyAttribute::DontEnum));
+  
+  const JSPropertyAttributeSet read_only_dont_delete = JSPropertyAttribute::ReadOnly | JSPropertyAttribute::DontDelete;
+  XCTAssertTrue(read_only_dont_delete == JSPropertyAttributeSet({JSPropertyAttribute::ReadOnly, JSPropertyAttribute::DontDelete}));
+  XCTAssertEqual(kJSPropertyAttributeReadOnly | kJSPropertyAttributeDontDelete, detail::ToJSPropertyAttributes(read_only_dont_delete));
+  
+  // The set-based API converts to and from the bitmask.
+  const std::unordered_set<JSPropertyAttribute> attribute_set { JSPropertyAttribute::ReadOnly, JSPropertyAttribute::DontDelete };
+  XCTAssertTrue(read_only_dont_delete == JSPropertyAttributeSet(attribute_set));
+  XCTAssertTrue(attribute_set == read_only_dont_delete.ToUnorderedSet());
+  XCTAssertEqual(detail::ToJSPropertyAttributes(read_only_dont_delete), detail::ToJSPropertyAttributes(attribute_set));
+}
+
 TEST_F(JSObjectTests, JSObject_ptr_t) {
   JSContext js_context = js_context_group.CreateContext();
   JSObject js_object = js_context.CreateObject();
@@ -317,6 +343,70 @@ TEST_F(JSObjectTests, GetProperties) {
   XCTAssertTrue(js_properties.at("object").IsObject());
 }
 
+TEST_F(JSObjectTests, ForEachProperty) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto js_object = static_cast<JSObject>(js_context.JSEvaluateScript("var o = { a: 1, b: 'two', c: 3, d: 4 }; o;"));
+
+  double sum = 0;
+  std::size_t visited = 0;
+  XCTAssertTrue(js_object.ForEachProperty([&](JSStringRef, const JSValueView& value) {
+    ++visited;
+    if (value.IsNumber()) {
+      sum += value.ToNumber();
+    }
+    return true;
+  }));
+  XCTAssertEqual(4, visited);
+  XCTAssertEqual(8, sum);
+
+  // The visitor stops the walk by returning false, and keeps only what
+  // it copies.
+  JSString found;
+  XCTAssertFalse(js_object.ForEachProperty([&found](JSStringRef name, const JSValueView& value) {
+    if (value.IsString()) {
+      found = JSString(name);
+      return false;
+    }
+    return true;
+  }));
+  XCTAssertEqual("b", static_cast<std::string>(found));
+}
+
+TEST_F(JSObjectTests, BatchedProperties) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject js_object = js_context.CreateObject();
+
+  static const std::vector<JSString> names { "width", "height", "title" };
+  js_object.SetProperties(names, { js_context.CreateNumber(640), js_context.CreateNumber(480), js_context.CreateString("main") });
+
+  const auto values = js_object.GetProperties(names);
+  XCTAssertEqual(3, values.size());
+  XCTAssertEqual(640, static_cast<int32_t>(values.at(0)));
+  XCTAssertEqual(480, static_cast<int32_t>(values.at(1)));
+  XCTAssertEqual("main", static_cast<std::string>(values.at(2)));
+
+  XCTAssertTrue(js_object.GetProperties({ "missing" }).at(0).IsUndefined());
+  ASSERT_THROW(js_object.SetProperties(names, { js_context.CreateNumber(1) }), std::invalid_argument);
+}
+
+TEST_F(JSObjectTests, JSPropertyNameArray) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto js_object = static_cast<JSObject>(js_context.JSEvaluateScript("var o = { a: 1, b: 2, c: 3 }; o;"));
+
+  const auto property_names = js_object.GetPropertyNames();
+  XCTAssertEqual(3, property_names.GetCount());
+  XCTAssertEqual("b", static_cast<std::string>(property_names[1]));
+
+  std::string joined;
+  for (const auto& property_name : property_names) {
+    joined += static_cast<std::string>(property_name);
+  }
+  XCTAssertEqual("abc", joined);
+
+  const auto position = std::find(property_names.begin(), property_names.end(), JSString("c"));
+  XCTAssertEqual(2, position.index());
+}
+
 TEST_F(JSObjectTests, JSObjectToJSArray) {
   JSContext js_context = js_context_group.CreateContext();
 
@@ -418,6 +508,273 @@ TEST_F(JSObjectTests, DoubleVectorFromJSArray) {
   XCTAssertEqual(1.123, items.at(2));
 }
 
+TEST_F(JSObjectTests, LargeNumericVectorFromJSArray) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  // Large arrays are converted in bulk, with the same ToNumber,
+  // ToInt32 and ToUint32 semantics as small ones.
+  auto js_value = js_context.JSEvaluateScript("var a = []; for (var i = 0; i < 1000; ++i) { a.push(i % 2 ? -i - 0.5 : String(i)); } a;");
+  JSArray js_array = static_cast<JSArray>(static_cast<JSObject>(js_value));
+  
+  const auto doubles = static_cast<std::vector<double>>(js_array);
+  XCTAssertEqual(1000, doubles.size());
+  XCTAssertEqual(0, doubles.at(0));
+  XCTAssertEqual(-1.5, doubles.at(1));
+  XCTAssertEqual(998, doubles.at(998));
+  
+  const auto ints = static_cast<std::vector<int32_t>>(js_array);
+  XCTAssertEqual(1000, ints.size());
+  XCTAssertEqual(-1, ints.at(1));
+  XCTAssertEqual(-999, ints.at(999));
+  
+  const auto uints = static_cast<std::vector<uint32_t>>(js_array);
+  XCTAssertEqual(1000, uints.size());
+  XCTAssertEqual(4294967295u, uints.at(1));
+  XCTAssertEqual(10u, uints.at(10));
+  
+  // A typed array is copied directly.
+  js_value = js_context.JSEvaluateScript("new Float64Array(64).fill(0.75);");
+  const auto typed = static_cast<std::vector<double>>(static_cast<JSArray>(static_cast<JSObject>(js_value)));
+  XCTAssertEqual(64, typed.size());
+  XCTAssertEqual(0.75, typed.at(63));
+  
+  // A subarray's elements start at its byteOffset, whether or not its
+  // elements need converting.
+  js_value = js_context.JSEvaluateScript("var b = new Float64Array(64); for (var i = 0; i < 64; ++i) { b[i] = i; } b.subarray(8, 48);");
+  const auto sub_doubles = static_cast<std::vector<double>>(static_cast<JSArray>(static_cast<JSObject>(js_value)));
+  XCTAssertEqual(40, sub_doubles.size());
+  XCTAssertEqual(8, sub_doubles.at(0));
+  XCTAssertEqual(47, sub_doubles.at(39));
+  const auto sub_ints = static_cast<std::vector<int32_t>>(static_cast<JSArray>(static_cast<JSObject>(js_value)));
+  XCTAssertEqual(40, sub_ints.size());
+  XCTAssertEqual(8, sub_ints.at(0));
+  XCTAssertEqual(47, sub_ints.at(39));
+}
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+TEST_F(JSObjectTests, NumericVectorFromTypedArray) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto to_array = [&js_context](const char* script) {
+    return static_cast<JSArray>(static_cast<JSObject>(js_context.JSEvaluateScript(script)));
+  };
+
+  // Element types are widened and narrowed with the ToNumber,
+  // ToInt32 and ToUint32 rules, whatever the length.
+  const auto doubles = static_cast<std::vector<double>>(to_array("new Int16Array([-3, 4]);"));
+  XCTAssertEqual(2, doubles.size());
+  XCTAssertEqual(-3, doubles.at(0));
+
+  const auto ints = static_cast<std::vector<int32_t>>(to_array("new Float64Array([1.75, -2.5, 4294967297]);"));
+  XCTAssertEqual(3, ints.size());
+  XCTAssertEqual(1, ints.at(0));
+  XCTAssertEqual(-2, ints.at(1));
+  XCTAssertEqual(1, ints.at(2));
+
+  const auto uints = static_cast<std::vector<uint32_t>>(to_array("new Int8Array([-1]);"));
+  XCTAssertEqual(4294967295u, uints.at(0));
+
+  // A view starts at its own byte offset.
+  const auto view = static_cast<std::vector<int32_t>>(to_array("new Int32Array([1, 2, 3, 4]).subarray(2);"));
+  XCTAssertEqual(2, view.size());
+  XCTAssertEqual(3, view.at(0));
+}
+#endif
+
+TEST_F(JSObjectTests, JSArrayFromNativeRange) {
+  JSContext js_context = js_context_group.CreateContext();
+
+  std::vector<double> doubles(100);
+  for (std::size_t i = 0; i < doubles.size(); ++i) {
+    doubles[i] = i + 0.5;
+  }
+  JSArray js_array = js_context.CreateArray(doubles);
+  XCTAssertEqual(100, js_array.GetLength());
+  XCTAssertEqual(99.5, static_cast<double>(js_array.GetProperty(99)));
+  XCTAssertTrue(doubles == static_cast<std::vector<double>>(js_array));
+
+  const int32_t ints[] = { 1, -2, 3 };
+  js_array = js_context.CreateArray(std::begin(ints), std::end(ints));
+  XCTAssertEqual(3, js_array.GetLength());
+  XCTAssertEqual(-2, static_cast<int32_t>(js_array.GetProperty(1)));
+
+  const std::vector<bool> bools { true, false };
+  js_array = js_context.CreateArray(bools.begin(), bools.end());
+  XCTAssertTrue(bools == static_cast<std::vector<bool>>(js_array));
+
+  const std::vector<JSValue> js_values { js_context.CreateString("hello"), js_context.CreateNull() };
+  js_array = js_context.CreateArray(js_values.begin(), js_values.end());
+  XCTAssertEqual("hello", static_cast<std::string>(js_array.GetProperty(0)));
+  XCTAssertTrue(js_array.GetProperty(1).IsNull());
+
+  XCTAssertEqual(0, js_context.CreateArray(doubles.begin(), doubles.begin()).GetLength());
+}
+
+TEST_F(JSObjectTests, JSArrayCopyColumns) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto js_value = js_context.JSEvaluateScript("var rows = []; for (var i = 0; i < 50; ++i) { rows.push({ x: i + 0.5, y: -i, t: i % 2 === 0 }); } rows.push(7); rows;");
+  JSArray js_array = static_cast<JSArray>(static_cast<JSObject>(js_value));
+
+  static const JSString x("x");
+  static const JSString y("y");
+  static const JSString t("t");
+  std::vector<double>  xs(64);
+  std::vector<int32_t> ys(64);
+  bool                 ts[64];
+  const auto rows = js_array.CopyColumns({ JSArrayColumn(x, xs.data()), JSArrayColumn(y, ys.data()), JSArrayColumn(t, ts) }, 64);
+  XCTAssertEqual(51, rows);
+  XCTAssertEqual(10.5, xs.at(10));
+  XCTAssertEqual(-49, ys.at(49));
+  XCTAssertTrue(ts[0]);
+  XCTAssertFalse(ts[1]);
+
+  // A row that isn't an object converts undefined.
+  XCTAssertTrue(std::isnan(xs.at(50)));
+  XCTAssertEqual(0, ys.at(50));
+  XCTAssertFalse(ts[50]);
+
+  XCTAssertEqual(2, js_array.CopyColumns({ JSArrayColumn(x, xs.data()) }, 2));
+}
+
+TEST_F(JSObjectTests, JSArrayIteration) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto js_value = js_context.JSEvaluateScript("var a = []; for (var i = 0; i < 100; ++i) { a.push(i); } a;");
+  JSArray js_array = static_cast<JSArray>(static_cast<JSObject>(js_value));
+
+  double sum = 0;
+  for (const auto& element : js_array) {
+    sum += static_cast<double>(element);
+  }
+  XCTAssertEqual(4950, sum);
+
+  // Searching stops at the first match.
+  uint32_t visited = 0;
+  const auto found = js_array.ForEach([&visited](const JSValue& element, uint32_t) {
+    ++visited;
+    return static_cast<int32_t>(element) != 10;
+  });
+  XCTAssertEqual(10, found);
+  XCTAssertEqual(11, visited);
+
+  const auto position = std::find_if(js_array.begin(), js_array.end(), [](const JSValue& element) {
+    return static_cast<int32_t>(element) == 42;
+  });
+  XCTAssertEqual(42, position.index());
+
+  XCTAssertEqual(3, js_array.ForEach([](const JSValue&, uint32_t index) { return index != 3; }));
+  XCTAssertEqual(0, js_context.CreateArray().ForEach([](const JSValue&, uint32_t) { return false; }));
+}
+
+#ifdef HAL_TYPED_ARRAY_ENABLE
+TEST_F(JSObjectTests, JSTypedArray) {
+  JSContext js_context = js_context_group.CreateContext();
+
+  // The vector's elements become the backing store, so writes from
+  // JavaScript are visible natively without a copy.
+  auto js_typed_array = js_context.CreateTypedArray<double>(std::vector<double> { 1.5, 2.5, 3.5 });
+  XCTAssertTrue(js_typed_array.IsTypedArray());
+  XCTAssertFalse(js_typed_array.IsArrayBuffer());
+  XCTAssertEqual(3, js_typed_array.GetLength());
+  XCTAssertEqual(3 * sizeof(double), js_typed_array.GetByteLength());
+
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("typed", js_typed_array);
+  js_context.JSEvaluateScript("typed[1] = 42;");
+  XCTAssertEqual(42, js_typed_array.GetBytesPtr()[1]);
+
+  js_typed_array.GetBytesPtr()[2] = 7;
+  XCTAssertEqual(7, static_cast<double>(js_context.JSEvaluateScript("typed[2];")));
+
+  auto js_array_buffer = js_typed_array.GetBuffer();
+  XCTAssertTrue(js_array_buffer.IsArrayBuffer());
+  XCTAssertEqual(3 * sizeof(double), js_array_buffer.GetByteLength());
+
+  // A JSObject is converted only to a typed array of its own type.
+  const auto js_object = static_cast<JSObject>(js_context.JSEvaluateScript("new Int32Array(4);"));
+  XCTAssertEqual(4, JSTypedArray<int32_t>(js_object).GetLength());
+  ASSERT_THROW(JSTypedArray<float>(js_object).GetLength(), std::runtime_error);
+
+  static std::uint8_t bytes[16];
+  auto buffer = js_context.CreateArrayBuffer(bytes, sizeof(bytes), [](void*) {});
+  XCTAssertEqual(static_cast<void*>(bytes), buffer.GetBytesPtr());
+  XCTAssertEqual(16, buffer.GetByteLength());
+}
+
+TEST_F(JSObjectTests, JSWebAssembly) {
+  JSContext js_context_1 = js_context_group.CreateContext();
+  if (!static_cast<bool>(js_context_1.JSEvaluateScript("typeof WebAssembly === 'object'"))) {
+    ASSERT_THROW(js_context_1.CompileWebAssemblyModule("", 0), std::runtime_error);
+    return;
+  }
+  
+  // A module exporting one page of memory, store(value), which stores
+  // value at address 0, and load(), which loads the value at address
+  // 4.
+  static const std::uint8_t bytes[] = {
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x09, 0x02, 0x60, 0x01, 0x7f, 0x00, 0x60, 0x00, 0x01, 0x7f,
+    0x03, 0x03, 0x02, 0x00, 0x01,
+    0x05, 0x03, 0x01, 0x00, 0x01,
+    0x07, 0x19, 0x03,
+    0x06, 'm', 'e', 'm', 'o', 'r', 'y', 0x02, 0x00,
+    0x05, 's', 't', 'o', 'r', 'e', 0x00, 0x00,
+    0x04, 'l', 'o', 'a', 'd', 0x00, 0x01,
+    0x0a, 0x13, 0x02,
+    0x09, 0x00, 0x41, 0x00, 0x20, 0x00, 0x36, 0x02, 0x00, 0x0b,
+    0x07, 0x00, 0x41, 0x04, 0x28, 0x02, 0x00, 0x0b
+  };
+  
+  JSWebAssemblyModuleCache js_module_cache(js_context_group, 2);
+  const auto js_module = js_module_cache.GetModule("kernel", bytes, sizeof(bytes));
+  XCTAssertTrue(js_module == js_module_cache.GetModule("kernel", bytes, sizeof(bytes)));
+  XCTAssertEqual(1, js_module_cache.size());
+  
+  // Native code and the module share the bytes of the memory.
+  auto js_instance = js_module.Instantiate(js_context_1);
+  auto exports     = js_instance.GetExports();
+  auto memory      = js_instance.GetMemory();
+  XCTAssertEqual(65536, memory.GetByteLength());
+  static_cast<JSObject>(exports.GetProperty("store")).Call(exports, 42);
+  XCTAssertEqual(42, static_cast<std::int32_t*>(memory.GetBytesPtr())[0]);
+  static_cast<std::int32_t*>(memory.GetBytesPtr())[1] = 7;
+  XCTAssertEqual(7, static_cast<int32_t>(static_cast<JSObject>(exports.GetProperty("load")).Call(exports)));
+  ASSERT_THROW(js_instance.GetMemory("table"), std::runtime_error);
+  
+  // Each instance has memory of its own, in any context of the group.
+  JSContext js_context_2 = js_context_group.CreateContext();
+  XCTAssertEqual(0, static_cast<std::int32_t*>(js_module.Instantiate(js_context_2).GetMemory().GetBytesPtr())[0]);
+  
+  JSContextGroup other_context_group;
+  ASSERT_THROW(js_module.Instantiate(other_context_group.CreateContext()), std::invalid_argument);
+  
+  // An invalid module leaves the cache as it was.
+  ASSERT_THROW(js_module_cache.GetModule("broken", bytes, 12), std::runtime_error);
+  XCTAssertEqual(1, js_module_cache.size());
+  
+  // A module file is compiled from its mapping, and is cached by its
+  // path.
+  const auto path = GetTemporaryPath("JSObjectTests.wasm");
+  std::ofstream(path, std::ios_base::binary | std::ios_base::trunc).write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+  auto file_instance = js_context_1.CompileWebAssemblyModuleFile(path).Instantiate(js_context_1);
+  static_cast<std::int32_t*>(file_instance.GetMemory().GetBytesPtr())[1] = 5;
+  XCTAssertEqual(5, static_cast<int32_t>(static_cast<JSObject>(file_instance.GetExports().GetProperty("load")).Call(file_instance.GetExports())));
+  
+  const auto file_module = js_module_cache.GetModuleFile(path);
+  XCTAssertTrue(file_module == js_module_cache.GetModuleFile(path));
+  XCTAssertEqual(2, js_module_cache.size());
+  std::remove(path.c_str());
+  
+  // The cached module outlives the file.
+  file_instance = file_module.Instantiate(js_context_1);
+  static_cast<JSObject>(file_instance.GetExports().GetProperty("store")).Call(file_instance.GetExports(), 3);
+  XCTAssertEqual(3, static_cast<std::int32_t*>(file_instance.GetMemory().GetBytesPtr())[0]);
+  XCTAssertTrue(file_module == js_module_cache.GetModuleFile(path));
+  
+  ASSERT_THROW(js_context_1.CompileWebAssemblyModuleFile(GetTemporaryPath("JSObjectTests.missing.wasm")), std::runtime_error);
+  ASSERT_THROW(js_module_cache.GetModuleFile(GetTemporaryPath("JSObjectTests.missing.wasm")), std::runtime_error);
+  XCTAssertEqual(2, js_module_cache.size());
+}
+#endif
+
 TEST_F(JSObjectTests, IntVectorFromJSArray) {
   JSContext js_context = js_context_group.CreateContext();
 
@@ -467,6 +824,15 @@ TEST_F(JSObjectTests, JSDate) {
   JSDate js_date = js_context.CreateDate();
   XCTAssertFalse(js_date.IsArray());
   XCTAssertFalse(js_date.IsError());
+  
+  const auto time_point = std::chrono::system_clock::time_point(std::chrono::milliseconds(1418000000123));
+  JSDate js_date_at = js_context.CreateDate(time_point);
+  XCTAssertTrue(time_point == js_date_at.ToTimePoint());
+  auto get_time = static_cast<JSObject>(js_date_at.GetProperty("getTime"));
+  XCTAssertEqual(1418000000123, static_cast<double>(get_time(js_date_at)));
+  
+  JSDate invalid_date = js_context.CreateDate({js_context.CreateString("not a date")});
+  ASSERT_THROW(invalid_date.ToTimePoint(), std::runtime_error);
 }
 
 TEST_F(JSObjectTests, JSError) {
@@ -481,6 +847,22 @@ TEST_F(JSObjectTests, JSRegExp) {
   JSRegExp js_regexp = js_context.CreateRegExp();
   XCTAssertFalse(js_regexp.IsArray());
   XCTAssertFalse(js_regexp.IsError());
+  
+  JSRegExp digits = js_context.CreateRegExp("\\d+", "g");
+  XCTAssertTrue(digits.Test("abc 123"));
+  XCTAssertEqual(7, static_cast<int32_t>(digits.GetProperty("lastIndex")));
+  XCTAssertFalse(digits.Test("abc"));
+  
+  XCTAssertTrue(digits.Test("12"));
+  JSRegExp same_digits = js_context.CreateRegExp("\\d+", "g");
+  XCTAssertTrue(digits == same_digits);
+  XCTAssertEqual(0, static_cast<int32_t>(same_digits.GetProperty("lastIndex")));
+  XCTAssertEqual("123", static_cast<std::string>(static_cast<JSObject>(same_digits.Exec("abc 123")).GetProperty(0)));
+  XCTAssertTrue(same_digits.Exec("abc").IsNull());
+  
+  js_context.set_regexp_cache_capacity(0);
+  XCTAssertFalse(js_context.CreateRegExp("\\d+", "g") == digits);
+  ASSERT_THROW(js_context.CreateRegExp("("), std::runtime_error);
 }
 
 TEST_F(JSObjectTests, JSFunction) {
@@ -517,6 +899,28 @@ TEST_F(JSObjectTests, JSFunctionCallback) {
   
 }
 
+TEST_F(JSObjectTests, JSFunctionArgumentsCallback) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSFunction js_function = js_context.CreateFunction("add", [](const JSArguments& arguments, JSObject& this_object) -> JSValue {
+    if (arguments.size() < 2) {
+      throw std::invalid_argument("add needs two numbers");
+    }
+    return this_object.get_context().CreateNumber(arguments[0].ToNumber() + arguments[1].ToNumber());
+  });
+  
+  XCTAssertTrue(js_function.IsFunction());
+  XCTAssertEqual(5, static_cast<int32_t>(js_function(std::vector<JSValue> { js_context.CreateNumber(2), js_context.CreateNumber(3) }, js_function)));
+  
+  auto global_object = js_context.get_global_object();
+  global_object.SetProperty("add", js_function);
+  XCTAssertEqual("add", static_cast<std::string>(js_context.JSEvaluateScript("add.name;")));
+  XCTAssertEqual(7, static_cast<int32_t>(js_context.JSEvaluateScript("add.call(null, 3, 4);")));
+  XCTAssertEqual(9, static_cast<int32_t>(js_context.JSEvaluateScript("add.apply(null, [4, 5]);")));
+  
+  // A C++ exception becomes a JavaScript Error.
+  XCTAssertEqual("add needs two numbers", static_cast<std::string>(js_context.JSEvaluateScript("try { add(1); } catch (e) { e.message; }")));
+}
+
 TEST_F(JSObjectTests, JSON_stringify) {
   auto js_context = js_context_group.CreateContext();
   auto global_object = js_context.get_global_object();
@@ -546,3 +950,321 @@ TEST_F(JSObjectTests, JSON_stringify) {
   XCTAssertEqual("[\"Hello\",123,3.141592653589793,true,{}]", static_cast<std::string>(js_result));
 }
 
+
+TEST_F(JSObjectTests, JSObjectView) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject js_object = js_context.CreateObject();
+  js_object.SetProperty("foo", js_context.CreateNumber(42));
+  
+  JSObjectView js_object_view(static_cast<JSContextRef>(js_context), static_cast<JSObjectRef>(js_object));
+  XCTAssertFalse(js_object_view.IsFunction());
+  XCTAssertEqual(nullptr, js_object_view.GetPrivate());
+  
+  JSValueView js_value_view = js_object_view;
+  XCTAssertTrue(js_value_view.IsObject());
+  XCTAssertEqual("[object Object]", static_cast<std::string>(js_value_view.ToJSString()));
+  
+  JSObject js_object_copy = js_object_view.ToJSObject();
+  XCTAssertTrue(js_object_copy.HasProperty("foo"));
+  XCTAssertEqual(42, static_cast<int32_t>(js_object_copy.GetProperty("foo")));
+}
+
+TEST_F(JSObjectTests, JSObjectTemplate) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject global_object = js_context.get_global_object();
+  
+  const JSObjectTemplate point_template({"x", "y"});
+  XCTAssertEqual(2, point_template.size());
+  
+  auto point = point_template.Instantiate(js_context, js_context.CreateNumber(1), js_context.CreateNumber(2));
+  XCTAssertEqual(1, static_cast<int32_t>(point.GetProperty("x")));
+  XCTAssertEqual(2, static_cast<int32_t>(point.GetProperty("y")));
+  
+  // Properties are added in template order.
+  global_object.SetProperty("point", point);
+  XCTAssertEqual("{\"x\":1,\"y\":2}", static_cast<std::string>(js_context.JSEvaluateScript("JSON.stringify(point);")));
+  
+  const std::vector<JSValue> values { js_context.CreateString("three"), js_context.CreateBoolean(true) };
+  point = point_template.Instantiate(js_context, values);
+  XCTAssertEqual("three", static_cast<std::string>(point.GetProperty("x")));
+  XCTAssertTrue(static_cast<bool>(point.GetProperty("y")));
+  
+  try {
+    point_template.Instantiate(js_context, js_context.CreateNumber(1));
+    XCTAssertTrue(false);
+  } catch (const std::invalid_argument&) {
+  } catch (...) {
+    XCTAssertTrue(false);
+  }
+  
+  const JSObjectTemplate constant_template({{"answer", {JSPropertyAttribute::ReadOnly, JSPropertyAttribute::DontDelete}}});
+  auto constant = constant_template.Instantiate(js_context, js_context.CreateNumber(42));
+  XCTAssertFalse(constant.DeleteProperty("answer"));
+  XCTAssertEqual(42, static_cast<int32_t>(constant.GetProperty("answer")));
+}
+
+TEST_F(JSObjectTests, JSConstantTable) {
+  const JSConstantTable constants(
+    "# Shared by every JSContext.\n"
+    "MAX_ITEMS = 100\n"
+    "RATIO     = 0.5\n"
+    "\n"
+    "ENABLED   = true\n"
+    "FALLBACK  = null\n"
+    "GREETING  = \"Hello, \"world\"\"\n");
+  XCTAssertEqual(5, constants.size());
+  XCTAssertTrue(constants.HasConstant("RATIO"));
+  XCTAssertFalse(constants.HasConstant("ratio"));
+  
+  for (int i = 0; i < 2; ++i) {
+    JSContext js_context = js_context_group.CreateContext();
+    js_context.get_global_object().SetProperty("Config", constants.CreateObject(js_context));
+    XCTAssertEqual(100, static_cast<int32_t>(js_context.JSEvaluateScript("Config.MAX_ITEMS;")));
+    XCTAssertEqual(0.5, static_cast<double>(js_context.JSEvaluateScript("Config.RATIO;")));
+    XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("Config.ENABLED;")));
+    XCTAssertTrue(js_context.JSEvaluateScript("Config.FALLBACK;").IsNull());
+    XCTAssertEqual("Hello, \"world\"", static_cast<std::string>(js_context.JSEvaluateScript("Config.GREETING;")));
+    XCTAssertEqual(100, static_cast<int32_t>(js_context.JSEvaluateScript("Config[0];")));
+    XCTAssertTrue(js_context.JSEvaluateScript("Config[5];").IsUndefined());
+    XCTAssertTrue(static_cast<bool>(js_context.JSEvaluateScript("'RATIO' in Config;")));
+    XCTAssertEqual("MAX_ITEMS,RATIO,ENABLED,FALLBACK,GREETING", static_cast<std::string>(js_context.JSEvaluateScript("Object.keys(Config).join();")));
+    
+    // Writes are ignored.
+    XCTAssertEqual(100, static_cast<int32_t>(js_context.JSEvaluateScript("Config.MAX_ITEMS = 1; Config.MAX_ITEMS;")));
+  }
+  
+  try {
+    JSConstantTable("NAME = value\n");
+    XCTAssertTrue(false);
+  } catch (const std::runtime_error&) {
+  } catch (...) {
+    XCTAssertTrue(false);
+  }
+  
+  try {
+    JSConstantTable("A = 1\nA = 2\n");
+    XCTAssertTrue(false);
+  } catch (const std::runtime_error&) {
+  } catch (...) {
+    XCTAssertTrue(false);
+  }
+}
+
+namespace UnitTestMarshal {
+  struct Position {
+    double x { 0 };
+    double y { 0 };
+  };
+
+  struct Marker {
+    std::string           label;
+    int32_t               id { 0 };
+    bool                  visible { false };
+    Position              position;
+    std::vector<double>   weights;
+    std::vector<Position> path;
+  };
+}
+
+namespace HAL {
+  template<>
+  struct JSMarshalTraits<UnitTestMarshal::Position> {
+    template<typename Visitor>
+    static void VisitFields(Visitor& visitor) {
+      visitor("x", &UnitTestMarshal::Position::x);
+      visitor("y", &UnitTestMarshal::Position::y);
+    }
+  };
+
+  template<>
+  struct JSMarshalTraits<UnitTestMarshal::Marker> {
+    template<typename Visitor>
+    static void VisitFields(Visitor& visitor) {
+      visitor("label", &UnitTestMarshal::Marker::label);
+      visitor("id", &UnitTestMarshal::Marker::id, JSPropertyAttribute::ReadOnly);
+      visitor("visible", &UnitTestMarshal::Marker::visible);
+      visitor("position", &UnitTestMarshal::Marker::position);
+      visitor("weights", &UnitTestMarshal::Marker::weights);
+      visitor("path", &UnitTestMarshal::Marker::path);
+    }
+  };
+}
+
+TEST_F(JSObjectTests, JSMarshal) {
+  JSContext js_context = js_context_group.CreateContext();
+
+  UnitTestMarshal::Marker marker;
+  marker.label    = "home";
+  marker.id       = 7;
+  marker.visible  = true;
+  marker.position.x = 1.5;
+  marker.position.y = -2.5;
+  marker.weights    = { 0.25, 0.5 };
+  marker.path.resize(2);
+  marker.path[1].x  = 3;
+  marker.path[1].y  = 4;
+
+  auto js_marker = JSMarshal<UnitTestMarshal::Marker>::ToJSObject(js_context, marker);
+  js_context.get_global_object().SetProperty("marker", js_marker);
+  XCTAssertEqual("home", static_cast<std::string>(js_context.JSEvaluateScript("marker.label;")));
+  XCTAssertEqual(-2.5, static_cast<double>(js_context.JSEvaluateScript("marker.position.y;")));
+  XCTAssertEqual(4, static_cast<int32_t>(js_context.JSEvaluateScript("marker.path[1].y;")));
+
+  // id is read-only, the other fields aren't.
+  js_context.JSEvaluateScript("marker.id = 8; marker.weights.push(1); marker.position.x = 9;");
+
+  const auto result = JSMarshal<UnitTestMarshal::Marker>::FromJSValue(js_context.JSEvaluateScript("marker;"));
+  XCTAssertEqual("home", result.label);
+  XCTAssertEqual(7, result.id);
+  XCTAssertTrue(result.visible);
+  XCTAssertEqual(9, result.position.x);
+  XCTAssertEqual(3, result.weights.size());
+  XCTAssertEqual(1, result.weights.at(2));
+  XCTAssertEqual(2, result.path.size());
+  XCTAssertEqual(3, result.path.at(1).x);
+
+  ASSERT_THROW(JSMarshal<UnitTestMarshal::Marker>::FromJSValue(js_context.CreateNumber(1)), std::runtime_error);
+}
+
+TEST_F(JSObjectTests, TryGetProperty) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto js_object = static_cast<JSObject>(js_context.JSEvaluateScript("({ a: 1, get b() { throw new RangeError('no b'); }, f: function(x) { return x * 2; }, g: function() { throw 'thrown'; } });"));
+
+  auto a = js_object.TryGetProperty("a");
+  XCTAssertTrue(a.ok());
+  XCTAssertEqual(1, static_cast<int32_t>(a.value()));
+
+  auto b = js_object.TryGetProperty("b");
+  XCTAssertFalse(b.ok());
+  XCTAssertTrue(b.has_exception());
+  XCTAssertEqual("RangeError: no b", b.error_message());
+  ASSERT_THROW(b.ValueOrThrow(), std::runtime_error);
+
+  auto f = static_cast<JSObject>(js_object.GetProperty("f"));
+  auto doubled = f.TryCall({js_context.CreateNumber(21)}, js_object);
+  XCTAssertTrue(doubled.ok());
+  XCTAssertEqual(42, static_cast<int32_t>(doubled.ValueOrThrow()));
+
+  auto g = static_cast<JSObject>(js_object.GetProperty("g"));
+  auto thrown = g.TryCall({}, js_object);
+  XCTAssertTrue(thrown.has_exception());
+  XCTAssertEqual("thrown", static_cast<std::string>(thrown.exception()));
+
+  XCTAssertFalse(js_object.TryCall({}, js_object).ok());
+
+  auto number = js_context.JSEvaluateScript("({ valueOf: function() { throw new Error('no number'); } });").TryToNumber();
+  XCTAssertFalse(number.ok());
+  XCTAssertEqual("Error: no number", number.error_message());
+  XCTAssertEqual(3.5, js_context.CreateNumber(3.5).TryToNumber().value());
+}
+
+TEST_F(JSObjectTests, JSPreparedCall) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  js_context.JSEvaluateScript("var handler = { total: 0, add: function(x, y) { this.total += x * y; return this.total; } };");
+  auto handler = static_cast<JSObject>(global_object.GetProperty("handler"));
+  auto add     = static_cast<JSObject>(handler.GetProperty("add"));
+  
+  JSPreparedCall prepared_add(add, handler, 2);
+  XCTAssertEqual(2, prepared_add.get_arity());
+  XCTAssertEqual(6, static_cast<int32_t>(prepared_add.Invoke(2, 3)));
+  XCTAssertEqual(10, prepared_add.InvokeForNumber(js_context.CreateNumber(1), 4.0));
+  XCTAssertTrue(prepared_add.InvokeForBoolean(1, 1));
+  XCTAssertEqual(11, static_cast<int32_t>(handler.GetProperty("total")));
+  
+  ASSERT_THROW(prepared_add.Invoke(1), std::invalid_argument);
+  ASSERT_THROW(JSPreparedCall(handler, 0), std::invalid_argument);
+  
+  auto thrower = static_cast<JSObject>(js_context.JSEvaluateScript("(function() { throw new Error('oops'); })"));
+  JSPreparedCall prepared_thrower(thrower, 0);
+  ASSERT_THROW(prepared_thrower.Invoke(), std::runtime_error);
+}
+
+TEST_F(JSObjectTests, VariadicCall) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto global_object = js_context.get_global_object();
+  js_context.JSEvaluateScript("var handler = { total: 0, add: function(x, y, name, flag) { this.total += x * y; return name + ':' + this.total + ':' + flag; } };");
+  auto handler = static_cast<JSObject>(global_object.GetProperty("handler"));
+  auto add     = static_cast<JSObject>(handler.GetProperty("add"));
+  
+  XCTAssertEqual("a:6:true", static_cast<std::string>(add.Call(handler, 2, 3.0, "a", true)));
+  XCTAssertEqual("b:10:false", static_cast<std::string>(add.Call(handler, js_context.CreateNumber(1), 4u, std::string("b"), false)));
+  XCTAssertEqual("c:10:undefined", static_cast<std::string>(add.Call(handler, 0, 0, JSString("c"))));
+  XCTAssertEqual(10, static_cast<int32_t>(handler.GetProperty("total")));
+  
+  auto point = static_cast<JSObject>(js_context.JSEvaluateScript("(function Point(x, y) { this.x = x; this.y = y; })"));
+  auto origin = point.Construct();
+  XCTAssertTrue(origin.GetProperty("x").IsUndefined());
+  auto corner = point.Construct(1, 2.5);
+  XCTAssertEqual(1, static_cast<int32_t>(corner.GetProperty("x")));
+  XCTAssertEqual(2.5, static_cast<double>(corner.GetProperty("y")));
+  
+  ASSERT_THROW(handler.Call(handler, 1), std::runtime_error);
+  ASSERT_THROW(handler.Construct(1), std::runtime_error);
+  
+  // Integers of any width convert to numbers.
+  const std::size_t size = 5;
+  const long        scale = -2;
+  const long long   big   = 1LL << 40;
+  XCTAssertEqual("d:0:undefined", static_cast<std::string>(add.Call(handler, size, scale, "d")));
+  XCTAssertEqual(static_cast<double>(big), static_cast<double>(point.Construct(big, 7UL).GetProperty("x")));
+  XCTAssertEqual(0, static_cast<int32_t>(handler.GetProperty("total")));
+  
+  // Unlike the std::vector overloads, Call converts its arguments
+  // without allocating.
+  {
+    JSBudgetScope budget_scope;
+    add.Call(handler, 2, 3, true);
+    EXPECT_HAL_BUDGET(allocs == 0 && string_creates == 0);
+  }
+  const auto two = js_context.CreateNumber(2);
+  {
+    JSBudgetScope budget_scope;
+    add.Call(handler, two, size, scale);
+    EXPECT_HAL_BUDGET(allocs == 0 && string_creates == 0);
+  }
+}
+
+TEST_F(JSObjectTests, CallBatched) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto handler = static_cast<JSObject>(js_context.JSEvaluateScript("({ scale: 3, apply: function(x) { return x * this.scale; } })"));
+  auto apply   = static_cast<JSObject>(handler.GetProperty("apply"));
+  
+  const auto results = apply.CallBatched(std::vector<JSValue> { js_context.CreateNumber(1), js_context.CreateString("2") }, handler);
+  XCTAssertEqual(2, results.size());
+  XCTAssertEqual(3, static_cast<int32_t>(results.at(0)));
+  XCTAssertEqual(6, static_cast<int32_t>(results.at(1)));
+  
+  const auto numbers = apply.CallBatched(std::vector<double> { 0.5, 2, 4 }, handler);
+  XCTAssertEqual(3, numbers.size());
+  XCTAssertEqual(1.5, numbers.at(0));
+  XCTAssertEqual(12, numbers.at(2));
+  
+  XCTAssertTrue(apply.CallBatched(std::vector<double>(), handler).empty());
+  
+  auto thrower = static_cast<JSObject>(js_context.JSEvaluateScript("(function(x) { if (x > 1) { throw new Error('too big'); } return x; })"));
+  ASSERT_THROW(thrower.CallBatched(std::vector<double> { 1, 2 }, handler), std::runtime_error);
+  ASSERT_THROW(handler.CallBatched(std::vector<double> { 1 }, handler), std::runtime_error);
+}
+
+TEST_F(JSObjectTests, JSPropertyPath) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto sprite = static_cast<JSObject>(js_context.JSEvaluateScript("({ position: { x: 4, y: 5 }, get broken() { throw new Error('broken'); } })"));
+  
+  const JSPropertyPath position_x("position.x");
+  XCTAssertEqual(2, position_x.size());
+  XCTAssertEqual(4, static_cast<int32_t>(position_x.GetValue(sprite)));
+  js_context.get_global_object().SetProperty("sprite", sprite);
+  js_context.JSEvaluateScript("sprite.position.x = 6;");
+  XCTAssertEqual(6, static_cast<int32_t>(position_x.GetValue(sprite)));
+  
+  XCTAssertTrue(JSPropertyPath("position.z").GetValue(sprite).IsUndefined());
+  
+  const auto missing = JSPropertyPath("size.width").TryGetValue(sprite);
+  XCTAssertFalse(missing.ok());
+  XCTAssertEqual("size is not an object", missing.error_message());
+  ASSERT_THROW(JSPropertyPath("size.width").GetValue(sprite), std::runtime_error);
+  
+  XCTAssertTrue(JSPropertyPath("broken.x").TryGetValue(sprite).has_exception());
+  ASSERT_THROW(JSPropertyPath("position..x"), std::invalid_argument);
+}
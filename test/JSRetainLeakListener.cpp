@@ -0,0 +1,99 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#include "HAL/HAL.hpp"
+#include "HAL/detail/JSRetainedHandles.hpp"
+
+#include "gtest/gtest.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace {
+  
+  /*!
+   @class
+   
+   @discussion A JSRetainLeakListener reports the JSValueRefs and
+   JSObjectRefs each test leaves protected, and the unprotects of
+   handles HAL didn't hold, once the test's fixture is destroyed.
+   
+   It is installed when the HAL_RETAIN_LEAK_CHECK environment variable
+   is set. With HAL_RETAIN_LEAK_CHECK=fatal a test program with leaks
+   exits with a failure after its tests have run. Build with
+   HAL_TRACK_RETAINED_HANDLES to see where leaked handles were first
+   retained, and set HAL_RETAIN_LEAK_CHECK=backtrace for their stacks.
+   */
+  class JSRetainLeakListener final : public ::testing::EmptyTestEventListener {
+    
+  public:
+    
+    explicit JSRetainLeakListener(bool fatal)
+    : fatal__(fatal) {
+    }
+    
+    virtual void OnTestStart(const ::testing::TestInfo&) override {
+      // The registries are only walked once tests run, after every
+      // static registry has been constructed.
+      if (!checker__) {
+        checker__.reset(new HAL::detail::JSRetainLeakChecker());
+      } else {
+        checker__ -> Reset();
+      }
+      imbalance_count__ = HAL::detail::GetRetainImbalanceCount();
+    }
+    
+    virtual void OnTestEnd(const ::testing::TestInfo& test_info) override {
+      const auto leaks           = checker__ -> DumpLeaks();
+      const auto imbalance_count = HAL::detail::GetRetainImbalanceCount() - imbalance_count__;
+      if (leaks.empty() && imbalance_count == 0) {
+        return;
+      }
+      
+      ++leaking_test_count__;
+      std::cerr << "[ HAL LEAK ] " << test_info.test_case_name() << "." << test_info.name() << ": ";
+      if (imbalance_count > 0) {
+        std::cerr << imbalance_count << " unbalanced unprotects" << std::endl;
+      }
+      std::cerr << leaks;
+    }
+    
+    virtual void OnTestProgramEnd(const ::testing::UnitTest&) override {
+      if (leaking_test_count__ == 0) {
+        return;
+      }
+      
+      std::cerr << "[ HAL LEAK ] " << leaking_test_count__ << " tests leaked retained handles" << std::endl;
+      if (fatal__) {
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    
+  private:
+    
+    const bool fatal__;
+    std::unique_ptr<HAL::detail::JSRetainLeakChecker> checker__;
+    std::size_t imbalance_count__ { 0 };
+    std::size_t leaking_test_count__ { 0 };
+  };
+  
+  const bool js_retain_leak_listener_installed = []() {
+    const auto mode = std::getenv("HAL_RETAIN_LEAK_CHECK");
+    if (!mode) {
+      return false;
+    }
+    
+#ifdef HAL_TRACK_RETAINED_HANDLES
+    HAL::detail::SetRetainBacktraces(std::strcmp(mode, "backtrace") == 0);
+#endif
+    ::testing::UnitTest::GetInstance() -> listeners().Append(new JSRetainLeakListener(std::strcmp(mode, "fatal") == 0));
+    return true;
+  }();
+  
+} // namespace {
@@ -7,7 +7,9 @@
  */
 
 #include "HAL/HAL.hpp"
+#include "HAL/detail/JSStringTranscode.hpp"
 
+#include <limits>
 #include <string>
 #include <iostream>
 
@@ -99,5 +101,208 @@ TEST(JSStringTests, UTF8) {
   XCTAssertEqual(string1.length(), string2.length());
   XCTAssertEqual(static_cast<std::string>(string1), static_cast<std::string>(string2));
   XCTAssertEqual("spät", static_cast<std::string>(string2));
+  
+  // UTF-8 that isn't null-terminated, as JSPropertyNameAccumulator
+  // passes it.
+  const char buffer[] = "spät!";
+  const auto js_string_ref = detail::CreateJSStringRefWithUTF8(buffer, 5);
+  XCTAssertEqual("spät", static_cast<std::string>(JSString(js_string_ref)));
+  JSStringRelease(js_string_ref);
+}
+
+
+TEST(JSStringTests, LazyUTF8) {
+  JSString string1 { "hello, lazy" };
+  JSStringRef string1_ref = static_cast<JSStringRef>(string1);
+  
+  // Copies and moves of a not yet converted JSString stay lazy and
+  // still convert correctly.
+  JSString string2 = JSString(string1_ref);
+  JSString string3 = string2;
+  JSString string4 = std::move(string3);
+  XCTAssertEqual(std::hash<JSString>()(string1), std::hash<JSString>()(string4));
+  XCTAssertEqual("hello, lazy", static_cast<std::string>(string4));
+  XCTAssertEqual("hello, lazy", static_cast<std::string>(string2));
+  
+  // A moved from JSString keeps its JSStringRef and converts again.
+  JSString string5 = std::move(string4);
+  XCTAssertEqual("hello, lazy", static_cast<std::string>(string4));
+  XCTAssertEqual("hello, lazy", static_cast<std::string>(string5));
+}
+
+TEST(JSStringTests, Intern) {
+  const JSString& atom1 = JSString::Intern("hello, atom");
+  const JSString& atom2 = JSString::Intern(std::string("hello, atom"));
+  
+  // Interning the same string twice returns the same JSString.
+  XCTAssertEqual(&atom1, &atom2);
+  XCTAssertEqual(static_cast<JSStringRef>(atom1), static_cast<JSStringRef>(atom2));
+  XCTAssertEqual("hello, atom", static_cast<std::string>(atom1));
+  XCTAssertEqual(JSString("hello, atom"), atom1);
+  
+  XCTAssertNotEqual(&atom1, &JSString::Intern("hello, other atom"));
+}
+
+TEST(JSStringTests, UTF16) {
+  const std::u16string u16string = u"spät";
+  JSString string1 { u16string };
+  XCTAssertEqual(4, string1.length());
+  XCTAssertEqual("spät", static_cast<std::string>(string1));
+  XCTAssertEqual(JSString("spät"), string1);
+  
+  const auto view = string1.u16view();
+  XCTAssertEqual(4, view.size());
+  XCTAssertEqual(u'ä', view[2]);
+  XCTAssertTrue(u16string == static_cast<std::u16string>(view));
+  XCTAssertTrue(u16string == static_cast<std::u16string>(JSString("spät")));
+  
+  JSString string2 { u16string.data(), 2 };
+  XCTAssertEqual("sp", static_cast<std::string>(string2));
+}
+
+TEST(JSStringTests, HashAndCompare) {
+  JSString string1 = "hello";
+  JSString string2 { static_cast<JSStringRef>(JSString("hello")) };
+  JSString string3 { std::u16string(u"hello") };
+  
+  // Hashes come from the UTF-16 code units, so they agree no matter
+  // how the string was constructed.
+  XCTAssertEqual(string1.hash_value(), string2.hash_value());
+  XCTAssertEqual(string1.hash_value(), string3.hash_value());
+  XCTAssertEqual(string1, string3);
+  XCTAssertNotEqual(string1, JSString("hell"));
+  XCTAssertNotEqual(string1, JSString("hellp"));
+  
+  XCTAssertTrue(JSString("hell") < string1);
+  XCTAssertTrue(string1 < JSString("hellp"));
+  XCTAssertFalse(string1 < string3);
+  XCTAssertFalse(string3 < string1);
+  XCTAssertTrue(JSString() < string1);
+}
+
+TEST(JSStringTests, MoveAndSlice) {
+  std::string source = "hello, world";
+  JSString string1 { std::move(source) };
+  XCTAssertEqual("hello, world", static_cast<std::string>(string1));
+  XCTAssertEqual(12, string1.length());
+  
+  const char buffer[] = "hello, world";
+  JSString string2 { buffer + 7, 5 };
+  XCTAssertEqual("world", static_cast<std::string>(string2));
+  XCTAssertEqual(JSString("world"), string2);
 }
 
+TEST(JSStringTests, ASCIIFastPath) {
+  // Long enough to take the vector path, with non-ASCII characters
+  // and a surrogate pair in the middle.
+  const std::string ascii(1000, 'x');
+  const std::string mixed = ascii + "spät 😀 " + ascii;
+  
+  JSString string1 { ascii };
+  XCTAssertEqual(1000, string1.length());
+  XCTAssertEqual(ascii, static_cast<std::string>(JSString(static_cast<JSStringRef>(string1))));
+  
+  JSString string2 { mixed };
+  XCTAssertEqual(2008, string2.length());
+  XCTAssertEqual(mixed, static_cast<std::string>(JSString(static_cast<JSStringRef>(string2))));
+  
+  // ASCII that isn't null-terminated, whether it fits the stack
+  // buffer or not, and ASCII containing null characters, which
+  // JSStringCreateWithUTF8CString would cut short.
+  for (const auto length : { std::size_t { 5 }, std::size_t { 999 } }) {
+    const auto js_string_ref = detail::CreateJSStringRefWithUTF8(ascii.data(), length);
+    XCTAssertEqual(length, JSStringGetLength(js_string_ref));
+    XCTAssertEqual(ascii.substr(0, length), static_cast<std::string>(JSString(js_string_ref)));
+    JSStringRelease(js_string_ref);
+  }
+  const std::string with_null("a\0b", 3);
+  JSString string3 { with_null };
+  XCTAssertEqual(3, string3.length());
+  XCTAssertEqual(with_null, static_cast<std::string>(JSString(static_cast<JSStringRef>(string3))));
+  XCTAssertTrue(JSString(std::string()).empty());
+  
+  XCTAssertEqual(1000, detail::CountASCII(ascii.data(), ascii.size()));
+  XCTAssertEqual(1002, detail::CountASCII(mixed.data(), mixed.size()));
+}
+
+TEST(JSStringTests, FromExternalBuffer) {
+  const std::u16string source = u"var x = 'spät';";
+  bool released = false;
+  auto string1 = JSString::FromExternalBuffer(source.data(), source.size(), [&released]() { released = true; });
+  XCTAssertTrue(released);
+  XCTAssertEqual("var x = 'spät';", static_cast<std::string>(string1));
+  
+  // 0xE4 is 'ä' in Latin-1.
+  const char latin1[] = "sp\xE4t";
+  released = false;
+  auto string2 = JSString::FromExternalLatin1Buffer(latin1, 4, [&released]() { released = true; });
+  XCTAssertTrue(released);
+  XCTAssertEqual(JSString("spät"), string2);
+  
+  // Latin-1 that is ASCII takes the 8-bit path.
+  released = false;
+  auto string3 = JSString::FromExternalLatin1Buffer(latin1, 2, [&released]() { released = true; });
+  XCTAssertTrue(released);
+  XCTAssertEqual(JSString("sp"), string3);
+  XCTAssertEqual(JSString("sp").hash_value(), string3.hash_value());
+  
+  XCTAssertTrue(JSString::FromExternalBuffer(nullptr, 0).empty());
+  XCTAssertTrue(JSString::FromExternalLatin1Buffer(nullptr, 0).empty());
+}
+
+TEST(JSStringTests, JSStringBuilder) {
+  JSStringBuilder builder(16);
+  XCTAssertTrue(builder.empty());
+  XCTAssertTrue(builder.capacity() >= 16);
+  
+  builder.Append("var x = ").Append(std::string("'sp\xC3\xA4t'")).Append(u';');
+  builder.Append(u" // ").Append(JSString("😀"));
+  XCTAssertEqual(21, builder.size());
+  XCTAssertEqual("var x = 'spät'; // 😀", static_cast<std::string>(builder.ToJSString()));
+  
+  // A truncated sequence becomes a replacement character.
+  builder.clear();
+  builder.Append("a\xE2\x82", 3);
+  XCTAssertEqual(u"a�", static_cast<std::u16string>(builder.ToJSString()));
+  
+  JSContextGroup js_context_group;
+  JSContext js_context = js_context_group.CreateContext();
+  auto js_value = builder.Append("b").ToJSValue(js_context);
+  XCTAssertTrue(js_value.IsString());
+}
+
+TEST(JSStringTests, JSStringBuilderJSON) {
+  JSStringBuilder builder;
+  builder.Append("[").AppendJSONString("a\"b\\c\n\x01").Append(",").AppendJSONString(JSString("spät"));
+  builder.Append(",").AppendJSONNumber(42).Append(",").AppendJSONNumber(-7).Append(",").AppendJSONNumber(0.5);
+  builder.Append(",").AppendJSONNumber(std::numeric_limits<double>::infinity()).Append("]");
+  XCTAssertEqual("[\"a\\\"b\\\\c\\n\\u0001\",\"spät\",42,-7,0.5,null]", static_cast<std::string>(builder.ToJSString()));
+  
+  JSContextGroup js_context_group;
+  JSContext js_context = js_context_group.CreateContext();
+  JSObject array = static_cast<JSObject>(builder.ToJSONValue(js_context));
+  XCTAssertEqual("a\"b\\c\n\x01", static_cast<std::string>(array.GetProperty(0u)));
+  XCTAssertEqual(0.1, static_cast<double>(JSStringBuilder().AppendJSONNumber(0.1).ToJSONValue(js_context)));
+  
+  ASSERT_THROW(JSStringBuilder().Append("{").ToJSONValue(js_context), std::runtime_error);
+}
+
+TEST(JSStringTests, ToArrayIndex) {
+  std::uint32_t index = 7;
+  XCTAssertTrue(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("0")), index));
+  XCTAssertEqual(0, index);
+  XCTAssertTrue(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("42")), index));
+  XCTAssertEqual(42, index);
+  XCTAssertTrue(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("4294967294")), index));
+  XCTAssertEqual(4294967294u, index);
+  
+  // Not canonical array indexes.
+  XCTAssertFalse(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("")), index));
+  XCTAssertFalse(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("01")), index));
+  XCTAssertFalse(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("-1")), index));
+  XCTAssertFalse(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("1.5")), index));
+  XCTAssertFalse(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("length")), index));
+  XCTAssertFalse(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("4294967295")), index));
+  XCTAssertFalse(detail::ToArrayIndex(static_cast<JSStringRef>(JSString("10000000000")), index));
+  XCTAssertEqual(4294967294u, index);
+}
@@ -0,0 +1,31 @@
+/**
+ * HAL
+ *
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License.
+ * Please see the LICENSE included with this distribution for details.
+ */
+
+#ifndef _HAL_TEST_JSTEMPORARYPATH_HPP_
+#define _HAL_TEST_JSTEMPORARYPATH_HPP_
+
+#include <cstdlib>
+#include <string>
+
+// Return the path of a file called name in the temporary directory,
+// where the tests write their files rather than in the working
+// directory.
+inline std::string GetTemporaryPath(const std::string& name) {
+#ifdef _WIN32
+  const char* directory = std::getenv("TEMP");
+  const char  separator = '\\';
+  const char* fallback  = ".";
+#else
+  const char* directory = std::getenv("TMPDIR");
+  const char  separator = '/';
+  const char* fallback  = "/tmp";
+#endif
+  return std::string(directory && *directory ? directory : fallback) + separator + name;
+}
+
+#endif // _HAL_TEST_JSTEMPORARYPATH_HPP_
@@ -7,8 +7,14 @@
  */
 
 #include "HAL/HAL.hpp"
+#include "HAL/detail/JSNodePool.hpp"
+#include "JSBudget.hpp"
 
 #include "gtest/gtest.h"
+#include "gtest/gtest-spi.h"
+#include <limits>
+#include <sstream>
+#include <thread>
 
 #define XCTAssertEqual    ASSERT_EQ
 #define XCTAssertNotEqual ASSERT_NE
@@ -196,6 +202,32 @@ TEST_F(JSValueTests, ToJSONString) {
   XCTAssertEqual("42", js_uint32_sjon);
 }
 
+TEST_F(JSValueTests, WriteJSON) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  JSValue js_undefined = js_context.CreateUndefined();
+  std::ostringstream undefined_stream;
+  XCTAssertFalse(js_undefined.WriteJSON(undefined_stream));
+  XCTAssertEqual("", undefined_stream.str());
+  
+  JSValue js_object = js_context.JSEvaluateScript("({ name: 'caf\\u00e9', values: [1, 2] })");
+  std::ostringstream object_stream;
+  XCTAssertTrue(js_object.WriteJSON(object_stream));
+  XCTAssertEqual("{\"name\":\"caf\xC3\xA9\",\"values\":[1,2]}", object_stream.str());
+  
+  // A large string arrives in several chunks, and a character outside
+  // the BMP is never split between two of them.
+  JSValue js_large = js_context.JSEvaluateScript("var s = ''; for (var i = 0; i < 5000; ++i) { s += 'a\\ud83d\\ude00'; } s;");
+  std::size_t chunks = 0;
+  std::string large;
+  XCTAssertTrue(js_large.WriteJSON([&](const char* data, std::size_t length) {
+    ++chunks;
+    large.append(data, length);
+  }));
+  XCTAssertTrue(chunks > 1);
+  XCTAssertEqual(static_cast<std::string>(js_large.ToJSONString()), large);
+}
+
 TEST_F(JSValueTests, String) {
   JSContext js_context = js_context_group.CreateContext();
   JSValue js_value = js_context.CreateString("hello, world");
@@ -300,3 +332,450 @@ TEST_F(JSValueTests, JSON_Stringify) {
   js_result = js_context.JSEvaluateScript("JSON.stringify(js_string);");
   XCTAssertEqual("\"Hello, World\"", static_cast<std::string>(js_result));
 }
+
+TEST_F(JSValueTests, RetainedHandles) {
+  JSContext js_context = js_context_group.CreateContext();
+  const auto js_context_ref = static_cast<JSContextRef>(js_context);
+  
+  const auto before = detail::GetRetainedHandles();
+  const auto values_before = before.by_context.count(js_context_ref) ? before.by_context.at(js_context_ref).values : 0;
+  
+  JSValue js_value = js_context.CreateString("hello");
+  JSValue js_value_copy = js_value;
+  
+  // Copies of a JSValue share one retained JSValueRef.
+  const auto after = detail::GetRetainedHandles();
+  XCTAssertEqual(values_before + 1, after.by_context.at(js_context_ref).values);
+  XCTAssertTrue(after.by_value_type.at("String") >= 1);
+  XCTAssertFalse(detail::DumpRetainedHandles().empty());
+}
+
+TEST_F(JSValueTests, RetainLeakChecker) {
+  JSContext js_context = js_context_group.CreateContext();
+  const auto imbalance_count = detail::GetRetainImbalanceCount();
+  detail::JSRetainLeakChecker checker;
+  
+  {
+    JSValue js_value = js_context.CreateString("leak");
+    JSObject js_object = js_context.CreateObject();
+    const auto leaks = checker.GetLeaks();
+    XCTAssertEqual(2, leaks.size());
+    XCTAssertFalse(checker.DumpLeaks().empty());
+  }
+  
+  // Everything created since the checker was reset is released.
+  XCTAssertTrue(checker.GetLeaks().empty());
+  XCTAssertTrue(checker.DumpLeaks().empty());
+  XCTAssertEqual(imbalance_count, detail::GetRetainImbalanceCount());
+}
+
+TEST_F(JSValueTests, JSCompactValue) {
+  JSContext js_context = js_context_group.CreateContext();
+  XCTAssertEqual(2 * sizeof(void*), sizeof(JSCompactValue));
+  
+  std::vector<JSCompactValue> values;
+  for (int i = 0; i < 100; ++i) {
+    values.emplace_back(js_context.CreateNumber(i));
+  }
+  values.emplace_back(js_context.JSEvaluateScript("({ answer: 42 })"));
+  
+  // The values are protected without any JSValue holding them.
+  js_context.GarbageCollect();
+  XCTAssertEqual(99, static_cast<int32_t>(values.at(99).ToJSValue()));
+  XCTAssertEqual(42, static_cast<int32_t>(values.back().ToJSObject().GetProperty("answer")));
+  XCTAssertTrue(values.at(7).get_view().IsNumber());
+  XCTAssertEqual(static_cast<JSContextRef>(js_context), values.at(7).get_context_ref());
+  
+  JSCompactValue copy = values.at(7);
+  JSCompactValue moved = std::move(values.at(7));
+  XCTAssertTrue(values.at(7).empty());
+  XCTAssertEqual(static_cast<JSValueRef>(copy), static_cast<JSValueRef>(moved));
+  XCTAssertEqual(7, static_cast<int32_t>(moved.ToJSValue()));
+  
+  XCTAssertTrue(JSCompactValue().empty());
+}
+
+TEST_F(JSValueTests, NodePool) {
+  detail::JSNodePoolUnorderedMap<std::intptr_t, int> map;
+  for (std::intptr_t i = 0; i < 16; ++i) {
+    map.emplace(i, 0);
+  }
+  map.clear();
+
+  // Nodes freed on this thread are reused by the next insertions.
+  const auto before = detail::GetNodePoolStatistics();
+  for (std::intptr_t i = 0; i < 16; ++i) {
+    map.emplace(i, 0);
+  }
+  const auto after = detail::GetNodePoolStatistics();
+#if !defined(_MSC_VER) || _MSC_VER > 1800
+  XCTAssertTrue(after.reuse_count - before.reuse_count >= 16);
+#endif
+  XCTAssertTrue(after.allocation_count - before.allocation_count >= 16);
+}
+
+TEST_F(JSValueTests, JSHandleScope) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSValue escaped = js_context.CreateUndefined();
+  {
+    JSHandleScope handle_scope;
+    XCTAssertEqual(0, handle_scope.size());
+    
+    auto js_string = js_context.CreateString("hello, world");
+    auto js_string_copy = js_string;
+    XCTAssertEqual(1, handle_scope.size());
+    
+    {
+      JSHandleScope nested_handle_scope;
+      auto js_number = js_context.CreateNumber(42);
+      XCTAssertEqual(1, nested_handle_scope.size());
+      escaped = js_number;
+    }
+    
+    XCTAssertEqual("hello, world", static_cast<std::string>(js_string_copy));
+  }
+  
+  js_context.GarbageCollect();
+  XCTAssertTrue(escaped.IsNumber());
+  XCTAssertEqual(42, static_cast<int32_t>(escaped));
+}
+
+TEST_F(JSValueTests, JSArena) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSContext other_context = js_context_group.CreateContext();
+  JSValue escaped = js_context.CreateUndefined();
+  {
+    std::unique_ptr<JSArena> arena(new JSArena(js_context));
+    for (int32_t i = 0; i < 2000; ++i) {
+      auto js_number = js_context.CreateNumber(i);
+      auto js_number_copy = js_number;
+    }
+    XCTAssertEqual(2000, arena -> size());
+    
+    // Values of other contexts aren't tracked.
+    auto other_number = other_context.CreateNumber(1);
+    XCTAssertEqual(2000, arena -> size());
+    
+    {
+      // The innermost of an arena and a handle scope takes a value.
+      JSHandleScope handle_scope;
+      auto js_string = js_context.CreateString("hello, world");
+      XCTAssertEqual(1, handle_scope.size());
+      XCTAssertEqual(2000, arena -> size());
+    }
+    
+    escaped = js_context.CreateString("escaped");
+    
+    std::vector<JSValue, JSArenaAllocator<JSValue>> arguments { JSArenaAllocator<JSValue>(*arena) };
+    arguments.push_back(js_context.CreateBoolean(true));
+    XCTAssertTrue(arena -> get_allocated_size() >= sizeof(JSValue));
+    XCTAssertTrue(arguments[0].IsBoolean());
+    arguments.clear();
+  }
+  
+  // An escaped value is promoted when the arena is destroyed.
+  js_context.GarbageCollect();
+  XCTAssertEqual("escaped", static_cast<std::string>(escaped));
+}
+
+TEST_F(JSValueTests, JSValueMove) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSValue js_value = js_context.CreateString("hello, world");
+  JSValue js_value_moved = std::move(js_value);
+  XCTAssertEqual("hello, world", static_cast<std::string>(js_value_moved));
+  
+  // A moved-from JSValue can still be assigned to.
+  js_value = js_context.CreateNumber(42);
+  XCTAssertEqual(42, static_cast<int32_t>(js_value));
+  
+  std::vector<JSValue> js_values;
+  for (int32_t i = 0; i < 100; ++i) {
+    js_values.push_back(js_context.CreateNumber(i));
+  }
+  js_context.GarbageCollect();
+  for (int32_t i = 0; i < 100; ++i) {
+    XCTAssertEqual(i, static_cast<int32_t>(js_values.at(i)));
+  }
+}
+
+TEST_F(JSValueTests, AppendTo) {
+  JSContext js_context = js_context_group.CreateContext();
+  std::string buffer = "name: ";
+  js_context.CreateString("spät").AppendTo(buffer);
+  buffer += ", value: ";
+  js_context.CreateNumber(42).AppendTo(buffer);
+  XCTAssertEqual("name: spät, value: 42", buffer);
+  
+  js_context.CreateString().AppendTo(buffer);
+  XCTAssertEqual("name: spät, value: 42", buffer);
+}
+
+TEST_F(JSValueTests, JSArguments) {
+  JSContext js_context = js_context_group.CreateContext();
+  const auto number = js_context.CreateNumber(-2.5);
+  const auto string = js_context.CreateString("hello");
+  const auto truth  = js_context.CreateBoolean(true);
+  const JSValueRef arguments_array[] = { static_cast<JSValueRef>(number), static_cast<JSValueRef>(string), static_cast<JSValueRef>(truth) };
+  
+  JSArguments arguments(static_cast<JSContextRef>(js_context), 3, arguments_array);
+  XCTAssertEqual(3, arguments.size());
+  XCTAssertFalse(arguments.empty());
+  XCTAssertEqual(-2.5, arguments.ToNumber(0));
+  XCTAssertEqual(-2, arguments.ToInt32(0));
+  XCTAssertEqual("hello", static_cast<std::string>(arguments.ToJSString(1)));
+  XCTAssertTrue(arguments.ToBoolean(2));
+  XCTAssertTrue(arguments[1].IsString());
+  
+  // Missing arguments read as undefined.
+  XCTAssertTrue(arguments[3].IsUndefined());
+  XCTAssertFalse(arguments.ToBoolean(3));
+  
+  const auto js_values = arguments.ToVector();
+  XCTAssertEqual(3, js_values.size());
+  XCTAssertEqual(string, js_values.at(1));
+  
+  JSArguments no_arguments(static_cast<JSContextRef>(js_context), 0, nullptr);
+  XCTAssertTrue(no_arguments.empty());
+  XCTAssertTrue(no_arguments[0].IsUndefined());
+}
+
+TEST_F(JSValueTests, GetType) {
+  JSContext js_context = js_context_group.CreateContext();
+  XCTAssertEqual(JSValue::Type::Undefined, js_context.CreateUndefined().GetType());
+  XCTAssertEqual(JSValue::Type::Null     , js_context.CreateNull().GetType());
+  XCTAssertEqual(JSValue::Type::Boolean  , js_context.CreateBoolean(true).GetType());
+  XCTAssertEqual(JSValue::Type::Number   , js_context.CreateNumber(1).GetType());
+  XCTAssertEqual(JSValue::Type::String   , js_context.CreateString("hello").GetType());
+  XCTAssertEqual(JSValue::Type::Object   , js_context.JSEvaluateScript("({});").GetType());
+  
+  // The type is kept, so the tests after the first agree with it.
+  const auto js_value = js_context.JSEvaluateScript("42;");
+  XCTAssertTrue(js_value.IsNumber());
+  XCTAssertFalse(js_value.IsString());
+  XCTAssertFalse(js_value.IsObject());
+  
+  JSValue js_value_copy = js_value;
+  XCTAssertTrue(js_value_copy.IsNumber());
+  js_value_copy = js_context.CreateString("hello");
+  XCTAssertTrue(js_value_copy.IsString());
+  XCTAssertFalse(js_value_copy.IsNumber());
+}
+
+TEST_F(JSValueTests, JSResult) {
+  JSResult<std::string> ok_result("hello");
+  XCTAssertTrue(ok_result.ok());
+  XCTAssertEqual("hello", ok_result.value());
+  
+  auto error_result = JSResult<std::string>::Error("bad argument");
+  XCTAssertFalse(error_result.ok());
+  XCTAssertEqual("bad argument", error_result.error_message());
+  
+  error_result = ok_result;
+  XCTAssertTrue(error_result.ok());
+  XCTAssertEqual("hello", error_result.value());
+  
+  XCTAssertTrue(JSResult<void>().ok());
+  XCTAssertFalse(JSResult<void>::Error("failed").ok());
+}
+
+TEST_F(JSValueTests, JSArgumentsSetError) {
+  JSContext js_context = js_context_group.CreateContext();
+  JSValueRef exception { nullptr };
+  
+  JSArguments arguments(static_cast<JSContextRef>(js_context), 0, nullptr, &exception);
+  XCTAssertFalse(arguments.HasException());
+  arguments.SetError("bad argument");
+  XCTAssertTrue(arguments.HasException());
+  
+  JSError js_error = static_cast<JSObject>(JSValue(js_context, exception));
+  XCTAssertEqual("bad argument", js_error.message());
+}
+
+TEST_F(JSValueTests, ImmediateValues) {
+  JSContext js_context = js_context_group.CreateContext();
+  const auto js_context_ref = static_cast<JSContextRef>(js_context);
+  
+  const auto before = detail::GetRetainedHandles();
+  const auto values_before = before.by_context.count(js_context_ref) ? before.by_context.at(js_context_ref).values : 0;
+  
+  JSValue js_undefined = js_context.CreateUndefined();
+  JSValue js_null      = js_context.CreateNull();
+  JSValue js_true      = js_context.CreateBoolean(true);
+  JSValue js_false     = js_context.CreateBoolean(false);
+  JSValue js_true_copy = js_true;
+  
+  // Immediate values aren't retained.
+  const auto after = detail::GetRetainedHandles();
+  const auto values_after = after.by_context.count(js_context_ref) ? after.by_context.at(js_context_ref).values : 0;
+  XCTAssertEqual(values_before, values_after);
+  
+  XCTAssertTrue(js_undefined.IsUndefined());
+  XCTAssertTrue(js_null.IsNull());
+  XCTAssertTrue(static_cast<bool>(js_true_copy));
+  XCTAssertFalse(static_cast<bool>(js_false));
+  XCTAssertTrue(js_true_copy == js_context.JSEvaluateScript("true"));
+  
+  JSBoolean js_boolean = js_context.CreateBoolean(false);
+  js_boolean = true;
+  XCTAssertTrue(static_cast<bool>(js_boolean));
+  XCTAssertTrue(static_cast<JSValue>(js_context.CreateNativeNull()).IsNull());
+}
+
+TEST_F(JSValueTests, IntegerConversions) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  XCTAssertEqual(-1, static_cast<int32_t>(js_context.CreateNumber(-1.9)));
+  XCTAssertEqual(2147483647, static_cast<int32_t>(js_context.CreateNumber(2147483647.5)));
+  XCTAssertEqual(-2147483647 - 1, static_cast<int32_t>(js_context.CreateNumber(2147483648.0)));
+  XCTAssertEqual(2147483653u, static_cast<uint32_t>(js_context.CreateNumber(2147483653.0)));
+  XCTAssertEqual(4294967295u, static_cast<uint32_t>(js_context.CreateNumber(-1)));
+  XCTAssertEqual(0, static_cast<int32_t>(js_context.CreateNumber(std::numeric_limits<double>::quiet_NaN())));
+  XCTAssertEqual(0, static_cast<int32_t>(js_context.CreateNumber(std::numeric_limits<double>::infinity())));
+  
+  XCTAssertEqual(9007199254740992, static_cast<int64_t>(js_context.JSEvaluateScript("Math.pow(2, 53)")));
+  XCTAssertEqual(-5, static_cast<int64_t>(js_context.CreateNumber(-5.5)));
+  XCTAssertEqual(std::numeric_limits<int64_t>::max(), static_cast<int64_t>(js_context.CreateNumber(1e300)));
+  XCTAssertEqual(0, static_cast<int64_t>(js_context.JSEvaluateScript("NaN")));
+  XCTAssertEqual(42, static_cast<int64_t>(js_context.JSEvaluateScript("({ valueOf: function() { return 42.5; } })")));
+}
+
+TEST_F(JSValueTests, JSValueWriter) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  // A small tree is created node by node.
+  JSValueWriter writer;
+  writer.BeginObject();
+  writer.Key("name").Value("sp\xC3\xA4t").Key(JSString("ok")).Value(true);
+  writer.Key("sizes").BeginArray().Value(1).Value(2.5).Null().Value(std::numeric_limits<double>::quiet_NaN()).EndArray();
+  writer.Key("empty").BeginObject().EndObject();
+  writer.EndObject();
+  XCTAssertFalse(writer.is_json());
+  XCTAssertEqual(9, writer.size());
+  auto js_value = writer.ToJSValue(js_context);
+  XCTAssertEqual("{\"name\":\"spät\",\"ok\":true,\"sizes\":[1,2.5,null,null],\"empty\":{}}", static_cast<std::string>(js_value.ToJSONString()));
+  
+  // A large one is written as JSON text and parsed once.
+  JSValueWriter large_writer;
+  large_writer.BeginArray();
+  for (std::int32_t i = 0; i < 100; ++i) {
+    large_writer.BeginObject().Key("id").Value(i).Key("label").Value("a\"b").EndObject();
+  }
+  large_writer.EndArray();
+  XCTAssertTrue(large_writer.is_json());
+  
+  // The array, and an object and its two values for each element.
+  // Keys aren't counted.
+  XCTAssertEqual(301, large_writer.size());
+  JSObject js_array = static_cast<JSObject>(large_writer.ToJSValue(js_context));
+  XCTAssertEqual(100, static_cast<int32_t>(js_array.GetProperty("length")));
+  JSObject last = static_cast<JSObject>(js_array.GetProperty(99u));
+  XCTAssertEqual(99, static_cast<int32_t>(last.GetProperty("id")));
+  XCTAssertEqual("a\"b", static_cast<std::string>(last.GetProperty("label")));
+  
+  XCTAssertEqual("42", static_cast<std::string>(JSValueWriter().Value(42).ToJSValue(js_context).ToJSONString()));
+  
+  // Calls that don't fit the tree.
+  ASSERT_THROW(JSValueWriter().BeginObject().Value(1), std::runtime_error);
+  ASSERT_THROW(JSValueWriter().BeginArray().Key("a"), std::runtime_error);
+  ASSERT_THROW(JSValueWriter().BeginArray().EndObject(), std::runtime_error);
+  ASSERT_THROW(JSValueWriter().Value(1).Value(2), std::runtime_error);
+  ASSERT_THROW(JSValueWriter().BeginArray().ToJSValue(js_context), std::runtime_error);
+}
+
+TEST_F(JSValueTests, JSPreparedValue) {
+  JSContext js_context = js_context_group.CreateContext();
+  
+  // Everything is prepared on a thread without a JSContext.
+  std::vector<JSPreparedJSON>   prepared_json;
+  std::vector<JSPreparedString> prepared_strings;
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  JSPreparedTypedArray<float> prepared_samples(4);
+#endif
+  std::thread feed_thread([&] {
+    JSValueWriter small_writer;
+    small_writer.BeginObject().Key("id").Value(7).EndObject();
+    prepared_json.emplace_back(small_writer);
+    
+    JSValueWriter large_writer;
+    large_writer.BeginArray();
+    for (std::int32_t i = 0; i < 100; ++i) {
+      large_writer.Value(i);
+    }
+    large_writer.EndArray();
+    prepared_json.emplace_back(large_writer);
+    prepared_json.emplace_back(std::string("[1,"));
+    
+    prepared_strings.emplace_back(std::string("sp\xC3\xA4t"));
+    prepared_strings.emplace_back(std::u16string(u"feed"));
+#ifdef HAL_TYPED_ARRAY_ENABLE
+    for (std::size_t i = 0; i < prepared_samples.size(); ++i) {
+      prepared_samples[i] = static_cast<float>(i) / 2;
+    }
+#endif
+  });
+  feed_thread.join();
+  
+  XCTAssertEqual("{\"id\":7}", static_cast<std::string>(prepared_json[0].get_text()));
+  auto small = static_cast<JSObject>(js_context.AdoptJSON(prepared_json[0]));
+  XCTAssertEqual(7, static_cast<int32_t>(small.GetProperty("id")));
+  auto large = static_cast<JSObject>(js_context.AdoptJSON(prepared_json[1]));
+  XCTAssertEqual(100, static_cast<int32_t>(large.GetProperty("length")));
+  ASSERT_THROW(js_context.AdoptJSON(prepared_json[2]), std::runtime_error);
+  
+  XCTAssertEqual("sp\xC3\xA4t", static_cast<std::string>(js_context.AdoptString(prepared_strings[0])));
+  XCTAssertEqual("feed", static_cast<std::string>(js_context.AdoptString(prepared_strings[1])));
+  
+#ifdef HAL_TYPED_ARRAY_ENABLE
+  const auto samples_data = prepared_samples.data();
+  auto samples = js_context.AdoptTypedArray(std::move(prepared_samples));
+  XCTAssertEqual(4, samples.GetLength());
+  XCTAssertEqual(1.5, static_cast<double>(samples.GetProperty(3u)));
+  XCTAssertEqual(samples_data, samples.GetBytesPtr());
+#endif
+}
+
+TEST_F(JSValueTests, JSBudgetScope) {
+  JSContext js_context = js_context_group.CreateContext();
+  auto js_object = js_context.CreateObject();
+  auto js_value  = static_cast<JSValue>(js_object);
+  {
+    // Copying a wrapper only counts another reference to a JSValueRef
+    // that is already protected.
+    JSBudgetScope budget_scope;
+    JSObject object_copy = js_object;
+    JSValue  value_copy  = js_value;
+    EXPECT_HAL_BUDGET(protects == 0 && registry_inserts == 0 && string_creates == 0);
+  }
+  {
+    JSBudgetScope budget_scope;
+    JSString js_string("budget");
+    EXPECT_HAL_BUDGET(string_creates == 1 && protects == 0);
+    
+    // Only the innermost scope is checked.
+    {
+      JSBudgetScope inner_budget_scope;
+      std::unique_ptr<int> number(new int(1));
+      EXPECT_HAL_BUDGET(allocs == 1 && alloc_bytes == sizeof(int) && string_creates == 0);
+    }
+    EXPECT_HAL_BUDGET(allocs >= 1 && string_creates == 1);
+  }
+  {
+    // Protects outside the retain registries count too, such as those
+    // of a JSCompactValue and of the context's cached globals.
+    JSBudgetScope budget_scope;
+    {
+      JSCompactValue compact_value(js_value);
+      JSCompactValue compact_copy = compact_value;
+    }
+    EXPECT_HAL_BUDGET(protects == 2 && unprotects == 2 && registry_inserts == 0);
+    js_context.GetCachedGlobal("budget_global");
+    EXPECT_HAL_BUDGET(protects >= 3 && string_creates >= 1);
+  }
+  
+  EXPECT_NONFATAL_FAILURE({
+    JSBudgetScope budget_scope;
+    std::unique_ptr<int> number(new int(1));
+    EXPECT_HAL_BUDGET(allocs <= 0);
+  }, "allocs <= 0");
+  EXPECT_NONFATAL_FAILURE(EXPECT_HAL_BUDGET(allocs <= 0), "needs a JSBudgetScope");
+}